@@ -46,6 +46,7 @@ int (*bnYield)(void);
 
 void (*bnEnd)(struct BigNum *bn);
 int (*bnPrealloc)(struct BigNum *bn, unsigned bits);
+unsigned (*bnAllocated)(struct BigNum const *bn);
 int (*bnCopy)(struct BigNum *dest, struct BigNum const *src);
 void (*bnNorm)(struct BigNum *bn);
 void (*bnExtractBigBytes)(struct BigNum const *bn, unsigned char *dest,
@@ -102,3 +103,9 @@ int (*bnDoubleBasePrecompExpMod)(struct BigNum *dest,
 	struct BnBasePrecomp const *pre1, struct BigNum const *exp1,
 	struct BnBasePrecomp const *pre2, struct BigNum const *exp2,
 	struct BigNum const *mod);
+int (*bnExpModCTBegin)(struct BnExpModCT *ws, struct BigNum const *mod,
+	unsigned maxebits);
+void (*bnExpModCTEnd)(struct BnExpModCT *ws);
+int (*bnExpModCT)(struct BigNum *dest, struct BigNum const *n,
+	struct BigNum const *exp, struct BigNum const *mod,
+	struct BnExpModCT const *ws);
@@ -55,6 +55,19 @@ extern int (*bnYield)(void);
  */
 void bnInit(void);
 
+/*
+ * Select the word size of the bignum package, before the first
+ * bnBegin() or bnInit() call.  0 selects the widest compiled in
+ * package.  A library built with BNINIT_RUNTIME contains the 32-bit
+ * and, if the machine has a fast 64x64->128 multiply, the 64-bit
+ * package, otherwise only the package bn00.c picks is available.
+ * Returns -1 if the package of this size is not compiled in.
+ */
+int bnInitWordSize(unsigned bits);
+
+/* The word size of the selected package in bits. */
+unsigned bnWordSize(void);
+
 /*
  * This initializes an empty struct BigNum to a zero value.
  * Do not use this on a BigNum which has had a value stored in it!
@@ -74,6 +87,12 @@ extern void (*bnEnd)(struct BigNum *bn);
  */
 extern int (*bnPrealloc)(struct BigNum *bn, unsigned bits);
 
+/*
+ * Return the number of bytes the BigNum allocated for its words, this may
+ * be more than the current value needs.
+ */
+extern unsigned (*bnAllocated)(struct BigNum const *bn);
+
 /* Hopefully obvious.  dest = src.   dest may be the same as src. */
 extern int (*bnCopy)(struct BigNum *dest, struct BigNum const *src);
 
@@ -227,6 +246,28 @@ extern int (*bnDoubleBasePrecompExpMod)(struct BigNum *dest,
 	struct BnBasePrecomp const *pre1, struct BigNum const *exp1,
 	struct BnBasePrecomp const *pre2, struct BigNum const *exp2,
 	struct BigNum const *mod);
+
+/*
+ * Workspace for constant time base^exp (mod mod) computation with a
+ * fixed mod, for secret exponents of up to maxebits bits.
+ */
+struct BnExpModCT {
+	void *ptr;	/* Pointer to the workspace words */
+	unsigned msize;	/* Words in modulus (normalized) */
+	unsigned maxebits;	/* Maximum exponent bits */
+	unsigned size;	/* Bytes in workspace */
+};
+
+extern int (*bnExpModCTBegin)(struct BnExpModCT *ws,
+	struct BigNum const *mod, unsigned maxebits);
+extern void (*bnExpModCTEnd)(struct BnExpModCT *ws);
+/*
+ * dest = n^exp (mod mod), the time and the memory accesses do not depend
+ * on the bits of exp and n.  The modulus must be odd.
+ */
+extern int (*bnExpModCT)(struct BigNum *dest, struct BigNum const *n,
+	struct BigNum const *exp, struct BigNum const *mod,
+	struct BnExpModCT const *ws);
 #endif /* SWIF */
 
 #ifdef __cplusplus
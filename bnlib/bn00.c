@@ -7,22 +7,32 @@
 
 #include "bnsize00.h"
 
+#ifndef BNINIT_RUNTIME
+#define BNINIT_RUNTIME 0
+#endif
+
 #if BNSIZE64
 
 /* Include all of the C source file by reference */
 #include "bn64.c"
+#if !BNINIT_RUNTIME
 #include "bninit64.c"
+#endif
 
 #elif BNSIZE32
 
 /* Include all of the C source file by reference */
 #include "bn32.c"
+#if !BNINIT_RUNTIME
 #include "bninit32.c"
+#endif
 
 #else /* BNSIZE16 */
 
 /* Include all of the C source file by reference */
 #include "bn16.c"
+#if !BNINIT_RUNTIME
 #include "bninit16.c"
+#endif
 
 #endif
@@ -77,6 +77,7 @@ bnInit_16(void)
 {
 	bnEnd = bnEnd_16;
 	bnPrealloc = bnPrealloc_16;
+	bnAllocated = bnAllocated_16;
 	bnCopy = bnCopy_16;
 	bnNorm = bnNorm_16;
 	bnExtractBigBytes = bnExtractBigBytes_16;
@@ -111,6 +112,9 @@ bnInit_16(void)
 	bnBasePrecompEnd = bnBasePrecompEnd_16;
 	bnBasePrecompExpMod = bnBasePrecompExpMod_16;
 	bnDoubleBasePrecompExpMod = bnDoubleBasePrecompExpMod_16;
+	bnExpModCTBegin = bnExpModCTBegin_16;
+	bnExpModCTEnd = bnExpModCTEnd_16;
+	bnExpModCT = bnExpModCT_16;
 }
 
 void
@@ -268,6 +272,13 @@ bnInsertLittleBytes_16(struct BigNum *bn, unsigned char const *src,
 	return 0;
 }
 
+/* Return the number of bytes of the allocated words. */
+unsigned
+bnAllocated_16(struct BigNum const *bn)
+{
+	return bn->allocated * (unsigned)sizeof(BNWORD16);
+}
+
 /* Return the least-significant word of the input. */
 unsigned
 bnLSWord_16(struct BigNum const *bn)
@@ -1186,3 +1197,81 @@ bnDoubleBasePrecompExpMod_16(struct BigNum *dest,
 		dest->size = lbnNorm_16((BNWORD16 *)dest->ptr, msize);
 	return i;
 }
+
+/*
+ * Allocate the workspace of bnExpModCT_16 for the modulus "mod" and
+ * exponents of up to "maxebits" bits.  The workspace depends only on the
+ * size of the modulus, not on its value.
+ */
+int
+bnExpModCTBegin_16(struct BnExpModCT *ws, struct BigNum const *mod,
+	unsigned maxebits)
+{
+	unsigned msize = lbnNorm_16((BNWORD16 *)mod->ptr, mod->size);
+	unsigned size;
+
+	/* Clear ws in case of failure */
+	ws->ptr = 0;
+	ws->msize = 0;
+	ws->maxebits = 0;
+	ws->size = 0;
+
+	if (!msize || !maxebits)
+		return -1;
+	size = lbnExpModCTSize_16(msize, maxebits);
+	ws->ptr = lbnMemAlloc(size * sizeof(BNWORD16));
+	if (!ws->ptr)
+		return -1;	/* Out of memory */
+	ws->msize = msize;
+	ws->maxebits = maxebits;
+	ws->size = size * sizeof(BNWORD16);
+	return 0;
+}
+
+void
+bnExpModCTEnd_16(struct BnExpModCT *ws)
+{
+	if (ws->ptr)
+		lbnMemFree(ws->ptr, ws->size);
+	ws->ptr = 0;
+	ws->msize = 0;
+	ws->maxebits = 0;
+	ws->size = 0;
+}
+
+/*
+ * dest = n^exp (mod mod) in constant time, see lbnExpModCT_16.  Returns
+ * -1 if the workspace does not fit: the modulus changed its size, the
+ * exponent has more than ws->maxebits bits, or n is longer than mod.  The
+ * time depends on ws->maxebits, not on the actual bits of exp.
+ */
+int
+bnExpModCT_16(struct BigNum *dest, struct BigNum const *n,
+	struct BigNum const *exp, struct BigNum const *mod,
+	struct BnExpModCT const *ws)
+{
+	unsigned nsize, esize, msize;
+	int i;
+
+	nsize = lbnNorm_16((BNWORD16 *)n->ptr, n->size);
+	esize = lbnNorm_16((BNWORD16 *)exp->ptr, exp->size);
+	msize = lbnNorm_16((BNWORD16 *)mod->ptr, mod->size);
+
+	if (!ws->ptr || msize != ws->msize || nsize > msize)
+		return -1;
+	if ((((BNWORD16 *)mod->ptr)[BIGLITTLE(-1,0)] & 1) == 0)
+		return -1;	/* Illegal modulus! */
+	if (lbnBits_16((BNWORD16 *)exp->ptr, esize) > ws->maxebits)
+		return -1;
+
+	bnSizeCheck(dest, msize);
+
+	i = lbnExpModCT_16((BNWORD16 *)dest->ptr, (BNWORD16 *)n->ptr, nsize,
+		(BNWORD16 *)exp->ptr, esize, ws->maxebits,
+		(BNWORD16 *)mod->ptr, msize, (BNWORD16 *)ws->ptr);
+	if (i == 0)
+		dest->size = lbnNorm_16((BNWORD16 *)dest->ptr, msize);
+
+	MALLOCDB;
+	return i;
+}
@@ -77,6 +77,7 @@ bnInit_32(void)
 {
 	bnEnd = bnEnd_32;
 	bnPrealloc = bnPrealloc_32;
+	bnAllocated = bnAllocated_32;
 	bnCopy = bnCopy_32;
 	bnNorm = bnNorm_32;
 	bnExtractBigBytes = bnExtractBigBytes_32;
@@ -111,6 +112,9 @@ bnInit_32(void)
 	bnBasePrecompEnd = bnBasePrecompEnd_32;
 	bnBasePrecompExpMod = bnBasePrecompExpMod_32;
 	bnDoubleBasePrecompExpMod = bnDoubleBasePrecompExpMod_32;
+	bnExpModCTBegin = bnExpModCTBegin_32;
+	bnExpModCTEnd = bnExpModCTEnd_32;
+	bnExpModCT = bnExpModCT_32;
 }
 
 void
@@ -268,6 +272,13 @@ bnInsertLittleBytes_32(struct BigNum *bn, unsigned char const *src,
 	return 0;
 }
 
+/* Return the number of bytes of the allocated words. */
+unsigned
+bnAllocated_32(struct BigNum const *bn)
+{
+	return bn->allocated * (unsigned)sizeof(BNWORD32);
+}
+
 /* Return the least-significant word of the input. */
 unsigned
 bnLSWord_32(struct BigNum const *bn)
@@ -529,6 +540,10 @@ bnMul_32(struct BigNum *dest, struct BigNum const *a, struct BigNum const *b)
 		lbnMul_32((BNWORD32 *)dest->ptr, (BNWORD32 *)a->ptr, s,
 		                                 srcbuf, t);
 		LBNFREE(srcbuf, t);
+	} else if (s == t) {
+		/* No overlap, lbnMulX_32 may use the Karatsuba multiply */
+		lbnMulX_32((BNWORD32 *)dest->ptr, (BNWORD32 *)a->ptr,
+		                                  (BNWORD32 *)b->ptr, s);
 	} else {
 		lbnMul_32((BNWORD32 *)dest->ptr, (BNWORD32 *)a->ptr, s,
 		                                 (BNWORD32 *)b->ptr, t);
@@ -1186,3 +1201,81 @@ bnDoubleBasePrecompExpMod_32(struct BigNum *dest,
 		dest->size = lbnNorm_32((BNWORD32 *)dest->ptr, msize);
 	return i;
 }
+
+/*
+ * Allocate the workspace of bnExpModCT_32 for the modulus "mod" and
+ * exponents of up to "maxebits" bits.  The workspace depends only on the
+ * size of the modulus, not on its value.
+ */
+int
+bnExpModCTBegin_32(struct BnExpModCT *ws, struct BigNum const *mod,
+	unsigned maxebits)
+{
+	unsigned msize = lbnNorm_32((BNWORD32 *)mod->ptr, mod->size);
+	unsigned size;
+
+	/* Clear ws in case of failure */
+	ws->ptr = 0;
+	ws->msize = 0;
+	ws->maxebits = 0;
+	ws->size = 0;
+
+	if (!msize || !maxebits)
+		return -1;
+	size = lbnExpModCTSize_32(msize, maxebits);
+	ws->ptr = lbnMemAlloc(size * sizeof(BNWORD32));
+	if (!ws->ptr)
+		return -1;	/* Out of memory */
+	ws->msize = msize;
+	ws->maxebits = maxebits;
+	ws->size = size * sizeof(BNWORD32);
+	return 0;
+}
+
+void
+bnExpModCTEnd_32(struct BnExpModCT *ws)
+{
+	if (ws->ptr)
+		lbnMemFree(ws->ptr, ws->size);
+	ws->ptr = 0;
+	ws->msize = 0;
+	ws->maxebits = 0;
+	ws->size = 0;
+}
+
+/*
+ * dest = n^exp (mod mod) in constant time, see lbnExpModCT_32.  Returns
+ * -1 if the workspace does not fit: the modulus changed its size, the
+ * exponent has more than ws->maxebits bits, or n is longer than mod.  The
+ * time depends on ws->maxebits, not on the actual bits of exp.
+ */
+int
+bnExpModCT_32(struct BigNum *dest, struct BigNum const *n,
+	struct BigNum const *exp, struct BigNum const *mod,
+	struct BnExpModCT const *ws)
+{
+	unsigned nsize, esize, msize;
+	int i;
+
+	nsize = lbnNorm_32((BNWORD32 *)n->ptr, n->size);
+	esize = lbnNorm_32((BNWORD32 *)exp->ptr, exp->size);
+	msize = lbnNorm_32((BNWORD32 *)mod->ptr, mod->size);
+
+	if (!ws->ptr || msize != ws->msize || nsize > msize)
+		return -1;
+	if ((((BNWORD32 *)mod->ptr)[BIGLITTLE(-1,0)] & 1) == 0)
+		return -1;	/* Illegal modulus! */
+	if (lbnBits_32((BNWORD32 *)exp->ptr, esize) > ws->maxebits)
+		return -1;
+
+	bnSizeCheck(dest, msize);
+
+	i = lbnExpModCT_32((BNWORD32 *)dest->ptr, (BNWORD32 *)n->ptr, nsize,
+		(BNWORD32 *)exp->ptr, esize, ws->maxebits,
+		(BNWORD32 *)mod->ptr, msize, (BNWORD32 *)ws->ptr);
+	if (i == 0)
+		dest->size = lbnNorm_32((BNWORD32 *)dest->ptr, msize);
+
+	MALLOCDB;
+	return i;
+}
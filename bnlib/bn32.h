@@ -3,6 +3,7 @@
  */
 struct BigNum;
 struct BnBasePrecomp;
+struct BnExpModCT;
 
 void bnInit_32(void);
 void bnEnd_32(struct BigNum *bn);
@@ -18,6 +19,7 @@ void bnExtractLittleBytes_32(struct BigNum const *bn, unsigned char *dest,
 	unsigned lsbyte, unsigned dlen);
 int bnInsertLittleBytes_32(struct BigNum *bn, unsigned char const *src,
 	unsigned lsbyte, unsigned len);
+unsigned bnAllocated_32(struct BigNum const *bn);
 unsigned bnLSWord_32(struct BigNum const *src);
 int bnReadBit_32(struct BigNum const *bn, unsigned bit);
 unsigned bnBits_32(struct BigNum const *src);
@@ -61,3 +63,9 @@ int bnDoubleBasePrecompExpMod_32(struct BigNum *dest,
 	struct BnBasePrecomp const *pre1, struct BigNum const *exp1,
 	struct BnBasePrecomp const *pre2, struct BigNum const *exp2,
 	struct BigNum const *mod);
+int bnExpModCTBegin_32(struct BnExpModCT *ws, struct BigNum const *mod,
+	unsigned maxebits);
+void bnExpModCTEnd_32(struct BnExpModCT *ws);
+int bnExpModCT_32(struct BigNum *dest, struct BigNum const *n,
+	struct BigNum const *exp, struct BigNum const *mod,
+	struct BnExpModCT const *ws);
@@ -0,0 +1,11 @@
+/*
+ * bn32rt.c - the 32-bit bn package next to the one bn00.c picks, for
+ * the run time word size selection in bninit00.c.  Empty if bn00.c
+ * already uses the 32-bit package.
+ */
+
+#include "bnsize00.h"
+
+#if BNSIZE64
+#include "bn32.c"
+#endif
@@ -77,6 +77,7 @@ bnInit_64(void)
 {
 	bnEnd = bnEnd_64;
 	bnPrealloc = bnPrealloc_64;
+	bnAllocated = bnAllocated_64;
 	bnCopy = bnCopy_64;
 	bnNorm = bnNorm_64;
 	bnExtractBigBytes = bnExtractBigBytes_64;
@@ -111,6 +112,9 @@ bnInit_64(void)
 	bnBasePrecompEnd = bnBasePrecompEnd_64;
 	bnBasePrecompExpMod = bnBasePrecompExpMod_64;
 	bnDoubleBasePrecompExpMod = bnDoubleBasePrecompExpMod_64;
+	bnExpModCTBegin = bnExpModCTBegin_64;
+	bnExpModCTEnd = bnExpModCTEnd_64;
+	bnExpModCT = bnExpModCT_64;
 }
 
 void
@@ -268,6 +272,13 @@ bnInsertLittleBytes_64(struct BigNum *bn, unsigned char const *src,
 	return 0;
 }
 
+/* Return the number of bytes of the allocated words. */
+unsigned
+bnAllocated_64(struct BigNum const *bn)
+{
+	return bn->allocated * (unsigned)sizeof(BNWORD64);
+}
+
 /* Return the least-significant word of the input. */
 unsigned
 bnLSWord_64(struct BigNum const *bn)
@@ -529,6 +540,10 @@ bnMul_64(struct BigNum *dest, struct BigNum const *a, struct BigNum const *b)
 		lbnMul_64((BNWORD64 *)dest->ptr, (BNWORD64 *)a->ptr, s,
 		                                 srcbuf, t);
 		LBNFREE(srcbuf, t);
+	} else if (s == t) {
+		/* No overlap, lbnMulX_64 may use the Karatsuba multiply */
+		lbnMulX_64((BNWORD64 *)dest->ptr, (BNWORD64 *)a->ptr,
+		                                  (BNWORD64 *)b->ptr, s);
 	} else {
 		lbnMul_64((BNWORD64 *)dest->ptr, (BNWORD64 *)a->ptr, s,
 		                                 (BNWORD64 *)b->ptr, t);
@@ -1186,3 +1201,81 @@ bnDoubleBasePrecompExpMod_64(struct BigNum *dest,
 		dest->size = lbnNorm_64((BNWORD64 *)dest->ptr, msize);
 	return i;
 }
+
+/*
+ * Allocate the workspace of bnExpModCT_64 for the modulus "mod" and
+ * exponents of up to "maxebits" bits.  The workspace depends only on the
+ * size of the modulus, not on its value.
+ */
+int
+bnExpModCTBegin_64(struct BnExpModCT *ws, struct BigNum const *mod,
+	unsigned maxebits)
+{
+	unsigned msize = lbnNorm_64((BNWORD64 *)mod->ptr, mod->size);
+	unsigned size;
+
+	/* Clear ws in case of failure */
+	ws->ptr = 0;
+	ws->msize = 0;
+	ws->maxebits = 0;
+	ws->size = 0;
+
+	if (!msize || !maxebits)
+		return -1;
+	size = lbnExpModCTSize_64(msize, maxebits);
+	ws->ptr = lbnMemAlloc(size * sizeof(BNWORD64));
+	if (!ws->ptr)
+		return -1;	/* Out of memory */
+	ws->msize = msize;
+	ws->maxebits = maxebits;
+	ws->size = size * sizeof(BNWORD64);
+	return 0;
+}
+
+void
+bnExpModCTEnd_64(struct BnExpModCT *ws)
+{
+	if (ws->ptr)
+		lbnMemFree(ws->ptr, ws->size);
+	ws->ptr = 0;
+	ws->msize = 0;
+	ws->maxebits = 0;
+	ws->size = 0;
+}
+
+/*
+ * dest = n^exp (mod mod) in constant time, see lbnExpModCT_64.  Returns
+ * -1 if the workspace does not fit: the modulus changed its size, the
+ * exponent has more than ws->maxebits bits, or n is longer than mod.  The
+ * time depends on ws->maxebits, not on the actual bits of exp.
+ */
+int
+bnExpModCT_64(struct BigNum *dest, struct BigNum const *n,
+	struct BigNum const *exp, struct BigNum const *mod,
+	struct BnExpModCT const *ws)
+{
+	unsigned nsize, esize, msize;
+	int i;
+
+	nsize = lbnNorm_64((BNWORD64 *)n->ptr, n->size);
+	esize = lbnNorm_64((BNWORD64 *)exp->ptr, exp->size);
+	msize = lbnNorm_64((BNWORD64 *)mod->ptr, mod->size);
+
+	if (!ws->ptr || msize != ws->msize || nsize > msize)
+		return -1;
+	if ((((BNWORD64 *)mod->ptr)[BIGLITTLE(-1,0)] & 1) == 0)
+		return -1;	/* Illegal modulus! */
+	if (lbnBits_64((BNWORD64 *)exp->ptr, esize) > ws->maxebits)
+		return -1;
+
+	bnSizeCheck(dest, msize);
+
+	i = lbnExpModCT_64((BNWORD64 *)dest->ptr, (BNWORD64 *)n->ptr, nsize,
+		(BNWORD64 *)exp->ptr, esize, ws->maxebits,
+		(BNWORD64 *)mod->ptr, msize, (BNWORD64 *)ws->ptr);
+	if (i == 0)
+		dest->size = lbnNorm_64((BNWORD64 *)dest->ptr, msize);
+
+	MALLOCDB;
+	return i;
+}
@@ -3,6 +3,7 @@
  */
 struct BigNum;
 struct BnBasePrecomp;
+struct BnExpModCT;
 
 void bnInit_64(void);
 void bnEnd_64(struct BigNum *bn);
@@ -18,6 +19,7 @@ void bnExtractLittleBytes_64(struct BigNum const *bn, unsigned char *dest,
 	unsigned lsbyte, unsigned dlen);
 int bnInsertLittleBytes_64(struct BigNum *bn, unsigned char const *src,
 	unsigned lsbyte, unsigned len);
+unsigned bnAllocated_64(struct BigNum const *bn);
 unsigned bnLSWord_64(struct BigNum const *src);
 int bnReadBit_64(struct BigNum const *bn, unsigned bit);
 unsigned bnBits_64(struct BigNum const *src);
@@ -61,3 +63,9 @@ int bnDoubleBasePrecompExpMod_64(struct BigNum *dest,
 	struct BnBasePrecomp const *pre1, struct BigNum const *exp1,
 	struct BnBasePrecomp const *pre2, struct BigNum const *exp2,
 	struct BigNum const *mod);
+int bnExpModCTBegin_64(struct BnExpModCT *ws, struct BigNum const *mod,
+	unsigned maxebits);
+void bnExpModCTEnd_64(struct BnExpModCT *ws);
+int bnExpModCT_64(struct BigNum *dest, struct BigNum const *n,
+	struct BigNum const *exp, struct BigNum const *mod,
+	struct BnExpModCT const *ws);
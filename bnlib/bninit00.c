@@ -0,0 +1,69 @@
+/*
+ * bninit00.c - Provide an init function that selects the bn package at
+ * run time.  Compile it with bn00.c, lbn00.c, bn32rt.c and lbn32rt.c
+ * and define BNINIT_RUNTIME to 1 for bn00.c, which then does not include
+ * its own bninit??.c file.
+ *
+ * The default is the widest package.  The 32-bit package is useful if
+ * the 64-bit one turns out to be slow on the machine at hand, for
+ * example because the 64x64->128 multiply is emulated.
+ */
+
+#include "bnsize00.h"
+#include "bn.h"
+
+#if BNSIZE64
+#include "bn64.h"
+#include "bn32.h"
+#elif BNSIZE32
+#include "bn32.h"
+#else /* BNSIZE16 */
+#include "bn16.h"
+#endif
+
+static unsigned bnSelected = 0;
+
+int
+bnInitWordSize(unsigned bits)
+{
+#if BNSIZE64
+	if (!bits || bits == 64) {
+		bnInit_64();
+		bnSelected = 64;
+		return 0;
+	}
+	if (bits == 32) {
+		bnInit_32();
+		bnSelected = 32;
+		return 0;
+	}
+#elif BNSIZE32
+	if (!bits || bits == 32) {
+		bnInit_32();
+		bnSelected = 32;
+		return 0;
+	}
+#else /* BNSIZE16 */
+	if (!bits || bits == 16) {
+		bnInit_16();
+		bnSelected = 16;
+		return 0;
+	}
+#endif
+	return -1;
+}
+
+/* Keeps a size that bnInitWordSize() selected before. */
+void
+bnInit(void)
+{
+	(void)bnInitWordSize(bnSelected);
+}
+
+unsigned
+bnWordSize(void)
+{
+	if (!bnSelected)
+		bnInit();
+	return bnSelected;
+}
@@ -14,3 +14,22 @@ bnInit(void)
 {
 	bnInit_16();
 }
+
+/*
+ * Only the 16-bit package is compiled in, see bninit00.c for a library
+ * with more than one package.
+ */
+int
+bnInitWordSize(unsigned bits)
+{
+	if (bits && bits != 16)
+		return -1;
+	bnInit_16();
+	return 0;
+}
+
+unsigned
+bnWordSize(void)
+{
+	return 16;
+}
@@ -14,3 +14,22 @@ bnInit(void)
 {
 	bnInit_32();
 }
+
+/*
+ * Only the 32-bit package is compiled in, see bninit00.c for a library
+ * with more than one package.
+ */
+int
+bnInitWordSize(unsigned bits)
+{
+	if (bits && bits != 32)
+		return -1;
+	bnInit_32();
+	return 0;
+}
+
+unsigned
+bnWordSize(void)
+{
+	return 32;
+}
@@ -14,3 +14,22 @@ bnInit(void)
 {
 	bnInit_64();
 }
+
+/*
+ * Only the 64-bit package is compiled in, see bninit00.c for a library
+ * with more than one package.
+ */
+int
+bnInitWordSize(unsigned bits)
+{
+	if (bits && bits != 64)
+		return -1;
+	bnInit_64();
+	return 0;
+}
+
+unsigned
+bnWordSize(void)
+{
+	return 64;
+}
@@ -0,0 +1,658 @@
+/* Copyright 2008, Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *     * Neither the name of Google Inc. nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * curve25519-donna-c64: Curve25519 elliptic curve, public key function,
+ * variant for 64 bit platforms
+ *
+ * http://code.google.com/p/curve25519-donna/
+ *
+ * Adam Langley <agl@imperialviolet.org>
+ *
+ * Derived from public domain C code by Daniel J. Bernstein <djb@cr.yp.to>
+ *
+ * More information about curve25519 can be found here
+ *   http://cr.yp.to/ecdh.html
+ *
+ * This variant uses five 51 bit limbs and 128 bit products. The build uses it
+ * instead of curve25519-donna.c if the compiler supports a 128 bit integer
+ * type, the function name and the interface are the same.
+ *
+ * The public key function curve25519_donna_basepoint uses a table of
+ * Edwards25519 base point multiples instead of the Montgomery ladder.
+ */
+
+#if defined(__SIZEOF_INT128__)
+
+#include <string.h>
+#include <stdint.h>
+
+typedef uint8_t u8;
+typedef uint64_t limb;
+typedef limb felem[5];
+typedef unsigned __int128 uint128_t;
+
+#define LIMB_MASK 0x7ffffffffffffULL
+
+/* Sum two numbers: output += in */
+static inline void fsum(limb *output, const limb *in) {
+  output[0] += in[0];
+  output[1] += in[1];
+  output[2] += in[2];
+  output[3] += in[3];
+  output[4] += in[4];
+}
+
+/* Find the difference of two numbers: output = in - output
+ * (note the order of the arguments!)
+ *
+ * Assumes that out[i] < 2**52. On return, out[i] < 2**55
+ */
+static inline void fdifference_backwards(felem out, const felem in) {
+  /* 152 is 19 << 3 */
+  static const limb two54m152 = (((limb)1) << 54) - 152;
+  static const limb two54m8 = (((limb)1) << 54) - 8;
+
+  out[0] = in[0] + two54m152 - out[0];
+  out[1] = in[1] + two54m8 - out[1];
+  out[2] = in[2] + two54m8 - out[2];
+  out[3] = in[3] + two54m8 - out[3];
+  out[4] = in[4] + two54m8 - out[4];
+}
+
+/* Multiply a number by a scalar: output = in * scalar */
+static inline void fscalar_product(felem output, const felem in, const limb scalar) {
+  uint128_t a;
+
+  a = ((uint128_t) in[0]) * scalar;
+  output[0] = ((limb)a) & LIMB_MASK;
+
+  a = ((uint128_t) in[1]) * scalar + ((limb) (a >> 51));
+  output[1] = ((limb)a) & LIMB_MASK;
+
+  a = ((uint128_t) in[2]) * scalar + ((limb) (a >> 51));
+  output[2] = ((limb)a) & LIMB_MASK;
+
+  a = ((uint128_t) in[3]) * scalar + ((limb) (a >> 51));
+  output[3] = ((limb)a) & LIMB_MASK;
+
+  a = ((uint128_t) in[4]) * scalar + ((limb) (a >> 51));
+  output[4] = ((limb)a) & LIMB_MASK;
+
+  output[0] += (limb)((a >> 51) * 19);
+}
+
+/* Multiply two numbers: output = in2 * in
+ *
+ * output may be the same as one of the inputs, the function reads all input
+ * limbs before it writes the output.
+ *
+ * Assumes that in[i] < 2**55 and likewise for in2.
+ * On return, output[i] < 2**52
+ */
+static inline void fmul(felem output, const felem in2, const felem in) {
+  uint128_t t[5];
+  limb r0, r1, r2, r3, r4, s0, s1, s2, s3, s4, c;
+
+  r0 = in[0];
+  r1 = in[1];
+  r2 = in[2];
+  r3 = in[3];
+  r4 = in[4];
+
+  s0 = in2[0];
+  s1 = in2[1];
+  s2 = in2[2];
+  s3 = in2[3];
+  s4 = in2[4];
+
+  t[0]  =  ((uint128_t) r0) * s0;
+  t[1]  =  ((uint128_t) r0) * s1 + ((uint128_t) r1) * s0;
+  t[2]  =  ((uint128_t) r0) * s2 + ((uint128_t) r2) * s0 + ((uint128_t) r1) * s1;
+  t[3]  =  ((uint128_t) r0) * s3 + ((uint128_t) r3) * s0 + ((uint128_t) r1) * s2 + ((uint128_t) r2) * s1;
+  t[4]  =  ((uint128_t) r0) * s4 + ((uint128_t) r4) * s0 + ((uint128_t) r3) * s1 + ((uint128_t) r1) * s3 + ((uint128_t) r2) * s2;
+
+  r4 *= 19;
+  r1 *= 19;
+  r2 *= 19;
+  r3 *= 19;
+
+  t[0] += ((uint128_t) r4) * s1 + ((uint128_t) r1) * s4 + ((uint128_t) r2) * s3 + ((uint128_t) r3) * s2;
+  t[1] += ((uint128_t) r4) * s2 + ((uint128_t) r2) * s4 + ((uint128_t) r3) * s3;
+  t[2] += ((uint128_t) r4) * s3 + ((uint128_t) r3) * s4;
+  t[3] += ((uint128_t) r4) * s4;
+
+                  r0 = (limb)t[0] & LIMB_MASK; c = (limb)(t[0] >> 51);
+  t[1] += c;      r1 = (limb)t[1] & LIMB_MASK; c = (limb)(t[1] >> 51);
+  t[2] += c;      r2 = (limb)t[2] & LIMB_MASK; c = (limb)(t[2] >> 51);
+  t[3] += c;      r3 = (limb)t[3] & LIMB_MASK; c = (limb)(t[3] >> 51);
+  t[4] += c;      r4 = (limb)t[4] & LIMB_MASK; c = (limb)(t[4] >> 51);
+  r0 +=   c * 19; c = r0 >> 51; r0 = r0 & LIMB_MASK;
+  r1 +=   c;      c = r1 >> 51; r1 = r1 & LIMB_MASK;
+  r2 +=   c;
+
+  output[0] = r0;
+  output[1] = r1;
+  output[2] = r2;
+  output[3] = r3;
+  output[4] = r4;
+}
+
+/* Square a number count times: output = in ** (2 ** count) */
+static inline void fsquare_times(felem output, const felem in, limb count) {
+  uint128_t t[5];
+  limb r0, r1, r2, r3, r4, c;
+  limb d0, d1, d2, d4, d419;
+
+  r0 = in[0];
+  r1 = in[1];
+  r2 = in[2];
+  r3 = in[3];
+  r4 = in[4];
+
+  do {
+    d0 = r0 * 2;
+    d1 = r1 * 2;
+    d2 = r2 * 2 * 19;
+    d419 = r4 * 19;
+    d4 = d419 * 2;
+
+    t[0] = ((uint128_t) r0) * r0 + ((uint128_t) d4) * r1 + (((uint128_t) d2) * (r3     ));
+    t[1] = ((uint128_t) d0) * r1 + ((uint128_t) d4) * r2 + (((uint128_t) r3) * (r3 * 19));
+    t[2] = ((uint128_t) d0) * r2 + ((uint128_t) r1) * r1 + (((uint128_t) d4) * (r3     ));
+    t[3] = ((uint128_t) d0) * r3 + ((uint128_t) d1) * r2 + (((uint128_t) r4) * (d419   ));
+    t[4] = ((uint128_t) d0) * r4 + ((uint128_t) d1) * r3 + (((uint128_t) r2) * (r2     ));
+
+                    r0 = (limb)t[0] & LIMB_MASK; c = (limb)(t[0] >> 51);
+    t[1] += c;      r1 = (limb)t[1] & LIMB_MASK; c = (limb)(t[1] >> 51);
+    t[2] += c;      r2 = (limb)t[2] & LIMB_MASK; c = (limb)(t[2] >> 51);
+    t[3] += c;      r3 = (limb)t[3] & LIMB_MASK; c = (limb)(t[3] >> 51);
+    t[4] += c;      r4 = (limb)t[4] & LIMB_MASK; c = (limb)(t[4] >> 51);
+    r0 +=   c * 19; c = r0 >> 51; r0 = r0 & LIMB_MASK;
+    r1 +=   c;      c = r1 >> 51; r1 = r1 & LIMB_MASK;
+    r2 +=   c;
+  } while (--count);
+
+  output[0] = r0;
+  output[1] = r1;
+  output[2] = r2;
+  output[3] = r3;
+  output[4] = r4;
+}
+
+/* Load a little-endian 64-bit number */
+static limb load_limb(const u8 *in) {
+  return
+    ((limb)in[0]) |
+    (((limb)in[1]) << 8) |
+    (((limb)in[2]) << 16) |
+    (((limb)in[3]) << 24) |
+    (((limb)in[4]) << 32) |
+    (((limb)in[5]) << 40) |
+    (((limb)in[6]) << 48) |
+    (((limb)in[7]) << 56);
+}
+
+static void store_limb(u8 *out, limb in) {
+  out[0] = in & 0xff;
+  out[1] = (in >> 8) & 0xff;
+  out[2] = (in >> 16) & 0xff;
+  out[3] = (in >> 24) & 0xff;
+  out[4] = (in >> 32) & 0xff;
+  out[5] = (in >> 40) & 0xff;
+  out[6] = (in >> 48) & 0xff;
+  out[7] = (in >> 56) & 0xff;
+}
+
+/* Take a little-endian, 32-byte number and expand it into polynomial form */
+static void fexpand(limb *output, const u8 *in) {
+  output[0] = load_limb(in) & LIMB_MASK;
+  output[1] = (load_limb(in+6) >> 3) & LIMB_MASK;
+  output[2] = (load_limb(in+12) >> 6) & LIMB_MASK;
+  output[3] = (load_limb(in+19) >> 1) & LIMB_MASK;
+  output[4] = (load_limb(in+24) >> 12) & LIMB_MASK;
+}
+
+/* Take a fully reduced polynomial form number and contract it into a
+ * little-endian, 32-byte array
+ */
+static void fcontract(u8 *output, const felem input) {
+  limb t[5];
+
+  t[0] = input[0];
+  t[1] = input[1];
+  t[2] = input[2];
+  t[3] = input[3];
+  t[4] = input[4];
+
+  t[1] += t[0] >> 51; t[0] &= LIMB_MASK;
+  t[2] += t[1] >> 51; t[1] &= LIMB_MASK;
+  t[3] += t[2] >> 51; t[2] &= LIMB_MASK;
+  t[4] += t[3] >> 51; t[3] &= LIMB_MASK;
+  t[0] += 19 * (t[4] >> 51); t[4] &= LIMB_MASK;
+
+  t[1] += t[0] >> 51; t[0] &= LIMB_MASK;
+  t[2] += t[1] >> 51; t[1] &= LIMB_MASK;
+  t[3] += t[2] >> 51; t[2] &= LIMB_MASK;
+  t[4] += t[3] >> 51; t[3] &= LIMB_MASK;
+  t[0] += 19 * (t[4] >> 51); t[4] &= LIMB_MASK;
+
+  /* now t is between 0 and 2^255-1, properly carried. */
+  /* case 1: between 0 and 2^255-20. case 2: between 2^255-19 and 2^255-1. */
+
+  t[0] += 19;
+
+  t[1] += t[0] >> 51; t[0] &= LIMB_MASK;
+  t[2] += t[1] >> 51; t[1] &= LIMB_MASK;
+  t[3] += t[2] >> 51; t[2] &= LIMB_MASK;
+  t[4] += t[3] >> 51; t[3] &= LIMB_MASK;
+  t[0] += 19 * (t[4] >> 51); t[4] &= LIMB_MASK;
+
+  /* now between 19 and 2^255-1 in both cases, and offset by 19. */
+
+  t[0] += 0x8000000000000ULL - 19;
+  t[1] += 0x8000000000000ULL - 1;
+  t[2] += 0x8000000000000ULL - 1;
+  t[3] += 0x8000000000000ULL - 1;
+  t[4] += 0x8000000000000ULL - 1;
+
+  /* now between 2^255 and 2^256-20, and offset by 2^255. */
+
+  t[1] += t[0] >> 51; t[0] &= LIMB_MASK;
+  t[2] += t[1] >> 51; t[1] &= LIMB_MASK;
+  t[3] += t[2] >> 51; t[2] &= LIMB_MASK;
+  t[4] += t[3] >> 51; t[3] &= LIMB_MASK;
+  t[4] &= LIMB_MASK;
+
+  store_limb(output,    t[0] | (t[1] << 51));
+  store_limb(output+8,  (t[1] >> 13) | (t[2] << 38));
+  store_limb(output+16, (t[2] >> 26) | (t[3] << 25));
+  store_limb(output+24, (t[3] >> 39) | (t[4] << 12));
+}
+
+/* Input: Q, Q', Q-Q'
+ * Output: 2Q, Q+Q'
+ *
+ *   x2 z2: long form
+ *   x3 z3: long form
+ *   x z: short form, destroyed
+ *   xprime zprime: short form, destroyed
+ *   qmqp: short form, preserved
+ */
+static void fmonty(limb *x2, limb *z2, /* output 2Q */
+                   limb *x3, limb *z3, /* output Q + Q' */
+                   limb *x, limb *z,   /* input Q */
+                   limb *xprime, limb *zprime, /* input Q' */
+                   const limb *qmqp /* input Q - Q' */) {
+  limb origx[5], origxprime[5], zzz[5], xx[5], zz[5], xxprime[5],
+        zzprime[5], zzzprime[5];
+
+  memcpy(origx, x, 5 * sizeof(limb));
+  fsum(x, z);
+  fdifference_backwards(z, origx);  /* does x - z */
+
+  memcpy(origxprime, xprime, sizeof(limb) * 5);
+  fsum(xprime, zprime);
+  fdifference_backwards(zprime, origxprime);
+  fmul(xxprime, xprime, z);
+  fmul(zzprime, x, zprime);
+  memcpy(origxprime, xxprime, sizeof(limb) * 5);
+  fsum(xxprime, zzprime);
+  fdifference_backwards(zzprime, origxprime);
+  fsquare_times(x3, xxprime, 1);
+  fsquare_times(zzzprime, zzprime, 1);
+  fmul(z3, zzzprime, qmqp);
+
+  fsquare_times(xx, x, 1);
+  fsquare_times(zz, z, 1);
+  fmul(x2, xx, zz);
+  fdifference_backwards(zz, xx);  /* does zz = xx - zz */
+  fscalar_product(zzz, zz, 121665);
+  fsum(zzz, xx);
+  fmul(z2, zz, zzz);
+}
+
+/* Maybe swap the contents of two limb arrays (a and b), each 5 elements
+ * long. Perform the swap iff iswap is non-zero.
+ *
+ * This function performs the swap without leaking any side-channel
+ * information.
+ */
+static void swap_conditional(limb a[5], limb b[5], limb iswap) {
+  unsigned i;
+  const limb swap = -iswap;
+
+  for (i = 0; i < 5; ++i) {
+    const limb x = swap & (a[i] ^ b[i]);
+    a[i] ^= x;
+    b[i] ^= x;
+  }
+}
+
+/* Calculates nQ where Q is the x-coordinate of a point on the curve
+ *
+ *   resultx/resultz: the x coordinate of the resulting curve point (short form)
+ *   n: a little endian, 32-byte number
+ *   q: a point of the curve (short form)
+ */
+static void cmult(limb *resultx, limb *resultz, const u8 *n, const limb *q) {
+  limb a[5] = {0}, b[5] = {1}, c[5] = {1}, d[5] = {0};
+  limb *nqpqx = a, *nqpqz = b, *nqx = c, *nqz = d, *t;
+  limb e[5] = {0}, f[5] = {1}, g[5] = {0}, h[5] = {1};
+  limb *nqpqx2 = e, *nqpqz2 = f, *nqx2 = g, *nqz2 = h;
+
+  unsigned i, j;
+
+  memcpy(nqpqx, q, sizeof(limb) * 5);
+
+  for (i = 0; i < 32; ++i) {
+    u8 byte = n[31 - i];
+    for (j = 0; j < 8; ++j) {
+      const limb bit = byte >> 7;
+
+      swap_conditional(nqx, nqpqx, bit);
+      swap_conditional(nqz, nqpqz, bit);
+      fmonty(nqx2, nqz2,
+             nqpqx2, nqpqz2,
+             nqx, nqz,
+             nqpqx, nqpqz,
+             q);
+      swap_conditional(nqx2, nqpqx2, bit);
+      swap_conditional(nqz2, nqpqz2, bit);
+
+      t = nqx;
+      nqx = nqx2;
+      nqx2 = t;
+      t = nqz;
+      nqz = nqz2;
+      nqz2 = t;
+      t = nqpqx;
+      nqpqx = nqpqx2;
+      nqpqx2 = t;
+      t = nqpqz;
+      nqpqz = nqpqz2;
+      nqpqz2 = t;
+
+      byte <<= 1;
+    }
+  }
+
+  memcpy(resultx, nqx, sizeof(limb) * 5);
+  memcpy(resultz, nqz, sizeof(limb) * 5);
+}
+
+/* -----------------------------------------------------------------------------
+ * Shamelessly copied from djb's code, tightened a little
+ * ----------------------------------------------------------------------------- */
+static void crecip(felem out, const felem z) {
+  felem a, t0, b, c;
+
+  /* 2 */ fsquare_times(a, z, 1); /* a = 2 */
+  /* 8 */ fsquare_times(t0, a, 2);
+  /* 9 */ fmul(b, t0, z); /* b = 9 */
+  /* 11 */ fmul(a, b, a); /* a = 11 */
+  /* 22 */ fsquare_times(t0, a, 1);
+  /* 2^5 - 2^0 = 31 */ fmul(b, t0, b);
+  /* 2^10 - 2^5 */ fsquare_times(t0, b, 5);
+  /* 2^10 - 2^0 */ fmul(b, t0, b);
+  /* 2^20 - 2^10 */ fsquare_times(t0, b, 10);
+  /* 2^20 - 2^0 */ fmul(c, t0, b);
+  /* 2^40 - 2^20 */ fsquare_times(t0, c, 20);
+  /* 2^40 - 2^0 */ fmul(t0, t0, c);
+  /* 2^50 - 2^10 */ fsquare_times(t0, t0, 10);
+  /* 2^50 - 2^0 */ fmul(b, t0, b);
+  /* 2^100 - 2^50 */ fsquare_times(t0, b, 50);
+  /* 2^100 - 2^0 */ fmul(c, t0, b);
+  /* 2^200 - 2^100 */ fsquare_times(t0, c, 100);
+  /* 2^200 - 2^0 */ fmul(t0, t0, c);
+  /* 2^250 - 2^50 */ fsquare_times(t0, t0, 50);
+  /* 2^250 - 2^0 */ fmul(t0, t0, b);
+  /* 2^255 - 2^5 */ fsquare_times(t0, t0, 5);
+  /* 2^255 - 21 */ fmul(out, t0, a);
+}
+
+int curve25519_donna(u8 *, const u8 *, const u8 *);
+
+int curve25519_donna(u8 *mypublic, const u8 *secret, const u8 *basepoint) {
+  limb bp[5], x[5], z[5], zmone[5];
+  uint8_t e[32];
+  int i;
+
+  for (i = 0; i < 32; ++i) e[i] = secret[i];
+  e[0] &= 248;
+  e[31] &= 127;
+  e[31] |= 64;
+
+  fexpand(bp, basepoint);
+  cmult(x, z, e, bp);
+  crecip(zmone, z);
+  fmul(z, x, zmone);
+  fcontract(mypublic, z);
+  return 0;
+}
+
+/* -----------------------------------------------------------------------------
+ * Fixed-base scalar multiplication for the public key: the scalar times the
+ * Edwards25519 base point with a table of precomputed multiples, then the
+ * birational map to the Montgomery u coordinate, u = (1 + y) / (1 - y).
+ *
+ * The method follows the ref10 ge_scalarmult_base function of the Ed25519
+ * reference implementation: the scalar in 64 signed radix 16 digits, one
+ * constant time table lookup and one mixed addition per digit, 4 doublings.
+ * ----------------------------------------------------------------------------- */
+
+#include "curve25519-donna-c64-base.h"
+
+/* Propagate the carries, on return output[i] < 2**52 */
+static inline void fcarry(felem t) {
+  t[1] += t[0] >> 51; t[0] &= LIMB_MASK;
+  t[2] += t[1] >> 51; t[1] &= LIMB_MASK;
+  t[3] += t[2] >> 51; t[2] &= LIMB_MASK;
+  t[4] += t[3] >> 51; t[3] &= LIMB_MASK;
+  t[0] += 19 * (t[4] >> 51); t[4] &= LIMB_MASK;
+}
+
+/* output = a + b, assumes a[i], b[i] < 2**52 */
+static inline void fadd(felem output, const felem a, const felem b) {
+  output[0] = a[0] + b[0];
+  output[1] = a[1] + b[1];
+  output[2] = a[2] + b[2];
+  output[3] = a[3] + b[3];
+  output[4] = a[4] + b[4];
+  fcarry(output);
+}
+
+/* output = a - b, assumes a[i], b[i] < 2**52 - 38 */
+static inline void fsub(felem output, const felem a, const felem b) {
+  /* 2 * p in the limbs: 2**52 - 38, 2**52 - 2, ... */
+  static const limb two52m38 = (((limb)1) << 52) - 38;
+  static const limb two52m2 = (((limb)1) << 52) - 2;
+
+  output[0] = a[0] + two52m38 - b[0];
+  output[1] = a[1] + two52m2 - b[1];
+  output[2] = a[2] + two52m2 - b[2];
+  output[3] = a[3] + two52m2 - b[3];
+  output[4] = a[4] + two52m2 - b[4];
+  fcarry(output);
+}
+
+/* Extended coordinates: x = X/Z, y = Y/Z, x * y = T/Z */
+typedef struct {
+  felem X, Y, Z, T;
+} gePoint;
+
+/* Completed coordinates: x = X/Z, y = Y/T */
+typedef struct {
+  felem X, Y, Z, T;
+} geCompleted;
+
+/* Precomputed affine point: y + x, y - x, 2 * d * x * y */
+typedef struct {
+  felem yplusx, yminusx, xy2d;
+} geNiels;
+
+static void geToExtended(gePoint *r, const geCompleted *p) {
+  fmul(r->X, p->X, p->T);
+  fmul(r->Y, p->Y, p->Z);
+  fmul(r->Z, p->Z, p->T);
+  fmul(r->T, p->X, p->Y);
+}
+
+/* r = 2 * p, uses X, Y and Z of p only */
+static void geDouble(geCompleted *r, const gePoint *p) {
+  felem t0;
+
+  fsquare_times(r->X, p->X, 1);
+  fsquare_times(r->Z, p->Y, 1);
+  fsquare_times(r->T, p->Z, 1);
+  fadd(r->T, r->T, r->T);
+  fadd(r->Y, p->X, p->Y);
+  fsquare_times(t0, r->Y, 1);
+  fadd(r->Y, r->Z, r->X);
+  fsub(r->Z, r->Z, r->X);
+  fsub(r->X, t0, r->Y);
+  fsub(r->T, r->T, r->Z);
+}
+
+/* r = p + q */
+static void geAddNiels(geCompleted *r, const gePoint *p, const geNiels *q) {
+  felem t0;
+
+  fadd(r->X, p->Y, p->X);
+  fsub(r->Y, p->Y, p->X);
+  fmul(r->Z, r->X, q->yplusx);
+  fmul(r->Y, r->Y, q->yminusx);
+  fmul(r->T, q->xy2d, p->T);
+  fadd(t0, p->Z, p->Z);
+  fsub(r->X, r->Z, r->Y);
+  fadd(r->Y, r->Z, r->Y);
+  fadd(r->Z, t0, r->T);
+  fsub(r->T, t0, r->T);
+}
+
+/* Copy the limbs of b to a iff mask is all ones, mask is 0 otherwise */
+static inline void fcopyMasked(felem a, const felem b, limb mask) {
+  unsigned i;
+
+  for (i = 0; i < 5; ++i)
+    a[i] ^= mask & (a[i] ^ b[i]);
+}
+
+/*
+ * t = digit * 256^pos * B for -8 <= digit <= 8. The function reads all
+ * entries of the row, thus the memory access does not depend on digit.
+ */
+static void geSelect(geNiels *t, int pos, signed char digit) {
+  const limb negative = (limb)((unsigned char)digit >> 7);
+  const limb absolute = (limb)((digit ^ -(int)negative) + (int)negative);
+  felem minusXy2d, zero = {0};
+  unsigned j;
+
+  memset(t, 0, sizeof(*t));
+  t->yplusx[0] = 1;                      /* the neutral element */
+  t->yminusx[0] = 1;
+  for (j = 0; j < 8; ++j) {
+    const limb mask = -(limb)(((absolute ^ (j + 1)) - 1) >> 63);
+    const limb (*entry)[5] = baseMultiples[pos][j];
+    unsigned k;
+
+    for (k = 0; k < 5; ++k) {
+      t->yplusx[k] ^= mask & (t->yplusx[k] ^ entry[0][k]);
+      t->yminusx[k] ^= mask & (t->yminusx[k] ^ entry[1][k]);
+      t->xy2d[k] ^= mask & (t->xy2d[k] ^ entry[2][k]);
+    }
+  }
+  /* -(x, y) = (-x, y): swap y + x and y - x, negate 2 * d * x * y */
+  swap_conditional(t->yplusx, t->yminusx, negative);
+  fsub(minusXy2d, zero, t->xy2d);
+  fcopyMasked(t->xy2d, minusXy2d, -negative);
+}
+
+int curve25519_donna_basepoint(u8 *, const u8 *);
+
+int curve25519_donna_basepoint(u8 *mypublic, const u8 *secret) {
+  signed char digits[64];
+  signed char carry;
+  gePoint h;
+  geCompleted r;
+  geNiels t;
+  felem zplusy, zminusy, u;
+  uint8_t e[32];
+  int i;
+
+  for (i = 0; i < 32; ++i) e[i] = secret[i];
+  e[0] &= 248;
+  e[31] &= 127;
+  e[31] |= 64;
+
+  for (i = 0; i < 32; ++i) {
+    digits[2 * i + 0] = (e[i] >> 0) & 15;
+    digits[2 * i + 1] = (e[i] >> 4) & 15;
+  }
+  /* each digit between 0 and 15, make them -8 ... 7, the last one 0 ... 8 */
+  carry = 0;
+  for (i = 0; i < 63; ++i) {
+    digits[i] += carry;
+    carry = digits[i] + 8;
+    carry >>= 4;
+    digits[i] -= carry << 4;
+  }
+  digits[63] += carry;
+
+  memset(&h, 0, sizeof(h));
+  h.Y[0] = 1;
+  h.Z[0] = 1;
+
+  for (i = 1; i < 64; i += 2) {
+    geSelect(&t, i / 2, digits[i]);
+    geAddNiels(&r, &h, &t);
+    geToExtended(&h, &r);
+  }
+  for (i = 0; i < 4; ++i) {
+    geDouble(&r, &h);
+    geToExtended(&h, &r);
+  }
+  for (i = 0; i < 64; i += 2) {
+    geSelect(&t, i / 2, digits[i]);
+    geAddNiels(&r, &h, &t);
+    geToExtended(&h, &r);
+  }
+
+  /* u = (1 + y) / (1 - y) = (Z + Y) / (Z - Y) */
+  fadd(zplusy, h.Z, h.Y);
+  fsub(zminusy, h.Z, h.Y);
+  crecip(u, zminusy);
+  fmul(u, zplusy, u);
+  fcontract(mypublic, u);
+
+  memset(e, 0, sizeof(e));
+  memset(digits, 0, sizeof(digits));
+  return 0;
+}
+
+#endif /* __SIZEOF_INT128__ */
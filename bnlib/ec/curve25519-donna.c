@@ -44,8 +44,13 @@
  * This is, almost, a clean room reimplementation from the curve25519 paper. It
  * uses many of the tricks described therein. Only the crecip function is taken
  * from the sample implementation.
+ *
+ * If the compiler supports a 128 bit integer type the build uses the variant
+ * with 51 bit limbs in curve25519-donna-c64.c instead.
  */
 
+#if !defined(__SIZEOF_INT128__)
+
 #include <string.h>
 #include <stdint.h>
 
@@ -729,3 +734,14 @@ int curve25519_donna(u8 *mypublic, const u8 *secret, const u8 *basepoint) {
   fcontract(mypublic, z);
   return 0;
 }
+
+/* The 32 bit variant has no table of base point multiples, it uses the ladder */
+int curve25519_donna_basepoint(u8 *, const u8 *);
+
+int curve25519_donna_basepoint(u8 *mypublic, const u8 *secret) {
+  static const u8 basepoint[32] = {9};
+
+  return curve25519_donna(mypublic, secret, basepoint);
+}
+
+#endif /* !__SIZEOF_INT128__ */
@@ -17,27 +17,85 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <bn.h>
 #include <bnprint.h>
 
 #include <ec/ec.h>
+#include <ec/ecfield.h>
+
+/* The curves, comb tables and random buffers come from the allocator of the library */
+#include <common/ZrtpAllocator.h>
 
 static BigNum _mpiZero;
 static BigNum _mpiOne;
-static BigNum _mpiTwo;
 static BigNum _mpiThree;
-static BigNum _mpiFour;
-static BigNum _mpiEight;
 
 static BigNum* mpiZero  = &_mpiZero;
 static BigNum* mpiOne   = &_mpiOne;
-static BigNum* mpiTwo   = &_mpiTwo;
 static BigNum* mpiThree = &_mpiThree;
-static BigNum* mpiFour  = &_mpiFour;
-static BigNum* mpiEight = &_mpiEight;
 static int initialized = 0;
 
+/*
+ * Fixed base comb tables, see ecMulBasePointScalar.
+ *
+ * The comb width EC_COMB_WIDTH defines the table size of 2^EC_COMB_WIDTH points. A
+ * table stores the sums of the points 2^(i*d)*G, where i is the index of a bit in the
+ * table index and d is the number of comb columns. The code builds a table once per
+ * curve type and keeps it until the application terminates. All curve structures of
+ * the same curve type share the table, thus the table is read-only after it was built.
+ */
+#define EC_COMB_WIDTH   5
+#define EC_COMB_POINTS  (1 << EC_COMB_WIDTH)
+
+typedef struct _EcCombTable {
+    int columns;                       /* number of comb columns d */
+    EcPoint points[EC_COMB_POINTS];    /* affine points, points[0] is not used */
+    const EcField *field;              /* fixed width field of the curve, may be NULL */
+    EcFieldPoint fieldPoints[EC_COMB_POINTS];  /* the points as fixed width field elements */
+} EcCombTable;
+
+static EcCombTable *combTables[Curve3617 + 1];
+
+/* Publish a fully built table, load a published table */
+#if defined(_MSC_VER)
+#include <windows.h>
+#define EC_LOAD_TABLE(slot)            ((EcCombTable *)InterlockedCompareExchangePointer((PVOID volatile *)(slot), NULL, NULL))
+#define EC_PUBLISH_TABLE(slot, table)  (InterlockedCompareExchangePointer((PVOID volatile *)(slot), (table), NULL) == NULL)
+#define EC_LOAD_CURVE(slot)            ((EcCurve *)InterlockedCompareExchangePointer((PVOID volatile *)(slot), NULL, NULL))
+#else
+#define EC_LOAD_TABLE(slot)            __atomic_load_n((slot), __ATOMIC_ACQUIRE)
+#define EC_PUBLISH_TABLE(slot, table)  __sync_bool_compare_and_swap((slot), NULL, (table))
+#define EC_LOAD_CURVE(slot)            __atomic_load_n((slot), __ATOMIC_ACQUIRE)
+#endif
+#define EC_PUBLISH_CURVE(slot, curve)  EC_PUBLISH_TABLE(slot, curve)
+
+/*
+ * Shared curve parameters, see ecGetCurveParams.
+ *
+ * The code parses the parameters of a curve type once and keeps them until the application
+ * terminates. All curve structures of the same curve type point to these parameters, thus
+ * the parameters are read-only after they were parsed. Each curve structure has its own
+ * scratch pad variables.
+ */
+static EcCurve *curveParams[Curve3617 + 1];
+
+/*
+ * Window width of the variable base scalar multiplication, the precomputed table
+ * contains the odd multiples P, 3P, ..., (2^EC_WINDOW_WIDTH - 1)P.
+ */
+#define EC_WINDOW_WIDTH   4
+#define EC_WINDOW_POINTS  (1 << (EC_WINDOW_WIDTH - 1))
+#define EC_WINDOW_DIGITS  ((521 / EC_WINDOW_WIDTH) + 2)
+
+/*
+ * Window width of the Curve41417 variable base scalar multiplication, the precomputed
+ * table contains the multiples 0, P, 2P, ..., (2^EC_ED_WINDOW_WIDTH - 1)P.
+ */
+#define EC_ED_WINDOW_WIDTH   4
+#define EC_ED_WINDOW_POINTS  (1 << EC_ED_WINDOW_WIDTH)
+
 
 /* The following parameters are given:
  - The prime modulus p
@@ -232,14 +290,17 @@ int bnSquareMod_ (struct BigNum *rslt, struct BigNum *n1, struct BigNum *mod, co
 static int ecGetAffineNist(const EcCurve *curve, EcPoint *R, const EcPoint *P);
 static int ecGetAffineEd(const EcCurve *curve, EcPoint *R, const EcPoint *P);
 static int ecGetAffine25519(const EcCurve *curve, EcPoint *R, const EcPoint *P);
+static int ecGetAffineFixed(const EcCurve *curve, EcPoint *R, const EcPoint *P);
 
 static int ecDoublePointNist(const EcCurve *curve, EcPoint *R, const EcPoint *P);
 static int ecDoublePointEd(const EcCurve *curve, EcPoint *R, const EcPoint *P);
 static int ecDoublePoint25519(const EcCurve *curve, EcPoint *R, const EcPoint *P);
+static int ecDoublePointFixed(const EcCurve *curve, EcPoint *R, const EcPoint *P);
 
 static int ecAddPointNist(const EcCurve *curve, EcPoint *R, const EcPoint *P, const EcPoint *Q);
 static int ecAddPointEd(const EcCurve *curve, EcPoint *R, const EcPoint *P, const EcPoint *Q);
 static int ecAddPoint25519(const EcCurve *curve, EcPoint *R, const EcPoint *P, const EcPoint *Q);
+static int ecAddPointFixed(const EcCurve *curve, EcPoint *R, const EcPoint *P, const EcPoint *Q);
 
 static int ecCheckPubKeyNist(const EcCurve *curve, const EcPoint *pub);
 static int ecCheckPubKey3617(const EcCurve *curve, const EcPoint *pub);
@@ -250,6 +311,8 @@ static int ecGenerateRandomNumber3617(const EcCurve *curve, BigNum *d);
 static int ecGenerateRandomNumber25519(const EcCurve *curve, BigNum *d);
 
 static int ecMulPointScalarNormal(const EcCurve *curve, EcPoint *R, const EcPoint *P, const BigNum *scalar);
+static int ecMulPointScalarWindow(const EcCurve *curve, EcPoint *R, const EcPoint *P, const BigNum *scalar);
+static int ecMulPointScalarEd(const EcCurve *curve, EcPoint *R, const EcPoint *P, const BigNum *scalar);
 static int ecMulPointScalar25519(const EcCurve *curve, EcPoint *R, const EcPoint *P, const BigNum *scalar);
 
 /* Forward declaration of new modulo functions for the EC curves */
@@ -261,14 +324,13 @@ static int newMod521(BigNum *r, const BigNum *a, const BigNum *modulo);
 static int mod3617(BigNum *r, const BigNum *a, const BigNum *modulo);
 static int mod25519(BigNum *r, const BigNum *a, const BigNum *modulo);
 
+static const EcCombTable *ecGetCombTable(const EcCurve *curve);
+
 static void commonInit()
 {
     bnBegin(mpiZero); bnSetQ(mpiZero, 0);
     bnBegin(mpiOne); bnSetQ(mpiOne, 1);
-    bnBegin(mpiTwo); bnSetQ(mpiTwo, 2);
     bnBegin(mpiThree); bnSetQ(mpiThree, 3);
-    bnBegin(mpiFour); bnSetQ(mpiFour, 4);
-    bnBegin(mpiEight); bnSetQ(mpiEight, 8);
 }
 
 static void curveCommonInit(EcCurve *curve)
@@ -303,13 +365,14 @@ static void curveCommonPrealloc(EcCurve *curve)
     bnPrealloc(curve->t3, maxBits);
 }
 
-int ecGetCurveNistECp(Curves curveId, EcCurve *curve)
+/*
+ * Parse the parameters of a NIST curve into a curve structure that owns its BigNums,
+ * ecGetCurveParams uses it to build the shared parameters.
+ */
+static int ecInitCurveNistECp(Curves curveId, EcCurve *curve)
 {
     curveData *cd;
 
-    if (curveId >= Curve25519 && curveId <= Curve3617)
-        return ecGetCurvesCurve(curveId, curve);
-
     if (!initialized) {
         commonInit();
         initialized = 1;
@@ -363,7 +426,14 @@ int ecGetCurveNistECp(Curves curveId, EcCurve *curve)
     curve->addOp = ecAddPointNist;
     curve->checkPubOp = ecCheckPubKeyNist;
     curve->randomOp = ecGenerateRandomNumberNist;
-    curve->mulScalar = ecMulPointScalarNormal;
+    curve->mulScalar = ecMulPointScalarWindow;
+
+    /* P-256 and P-384 use the fixed width field arithmetic for the point operations */
+    if (ecGetField(curveId) != NULL) {
+        curve->affineOp = ecGetAffineFixed;
+        curve->doubleOp = ecDoublePointFixed;
+        curve->addOp = ecAddPointFixed;
+    }
 
     bnReadAscii(curve->p, cd->p, 10);
     bnReadAscii(curve->n, cd->n, 10);
@@ -375,13 +445,14 @@ int ecGetCurveNistECp(Curves curveId, EcCurve *curve)
     bnReadAscii(curve->Gx, cd->Gx, 16);
     bnReadAscii(curve->Gy, cd->Gy, 16);
 
-    curveCommonPrealloc(curve);
     curve->id = curveId;
-
     return 0;
 }
 
-int ecGetCurvesCurve(Curves curveId, EcCurve *curve)
+/*
+ * Parse the parameters of the non-NIST curves, see ecInitCurveNistECp.
+ */
+static int ecInitCurvesCurve(Curves curveId, EcCurve *curve)
 {
     curveData *cd;
 
@@ -408,12 +479,12 @@ int ecGetCurvesCurve(Curves curveId, EcCurve *curve)
     case Curve3617:
         cd = &curve3617;
         curve->modOp = mod3617;
-        curve->affineOp = ecGetAffineEd;
+        curve->affineOp = ecGetAffineFixed;
         curve->doubleOp = ecDoublePointEd;
         curve->addOp = ecAddPointEd;
         curve->checkPubOp = ecCheckPubKey3617;
         curve->randomOp = ecGenerateRandomNumber3617;
-        curve->mulScalar = ecMulPointScalarNormal;
+        curve->mulScalar = ecMulPointScalarEd;
 
         bnReadAscii(curve->a, "3617", 10);
         break;
@@ -440,23 +511,142 @@ int ecGetCurvesCurve(Curves curveId, EcCurve *curve)
     bnReadAscii(curve->Gx, cd->Gx, 16);
     bnReadAscii(curve->Gy, cd->Gy, 16);
 
-    curveCommonPrealloc(curve);
     curve->id = curveId;
     return 0;
 }
 
+static void ecFreeCurveParams(EcCurve *curve);
+
+/*
+ * Get the shared, read-only parameters of a curve type, parse them if necessary.
+ *
+ * If two threads parse the parameters at the same time only one parameter structure
+ * survives, the other thread frees its structure and uses the published structure.
+ */
+static const EcCurve *ecGetCurveParams(Curves curveId)
+{
+    EcCurve *params;
+    EcCurve *newParams;
+    int ret;
+
+    if (curveId <= 0 || curveId > Curve3617)
+        return NULL;
+
+    params = EC_LOAD_CURVE(&curveParams[curveId]);
+    if (params != NULL)
+        return params;
+
+    newParams = (EcCurve *)zrtpAlloc(sizeof(EcCurve));
+    if (newParams == NULL)
+        return NULL;
+
+    if (curveId >= Curve25519)
+        ret = ecInitCurvesCurve(curveId, newParams);
+    else
+        ret = ecInitCurveNistECp(curveId, newParams);
+
+    if (ret < 0) {
+        ecFreeCurveParams(newParams);
+        return NULL;
+    }
+    if (EC_PUBLISH_CURVE(&curveParams[curveId], newParams))
+        return newParams;
+
+    ecFreeCurveParams(newParams);
+    return EC_LOAD_CURVE(&curveParams[curveId]);
+}
+
+/*
+ * Set up a curve structure that uses the shared parameters of its curve type and
+ * has its own scratch pad variables. The BigNum structures of the parameters in
+ * the curve structure stay empty, ecFreeCurveNistECp frees the scratch pad only.
+ */
+static int ecShareCurve(Curves curveId, EcCurve *curve)
+{
+    const EcCurve *params;
+
+    if (curve == NULL)
+        return -2;
+
+    bnBegin(&curve->_p);    curve->p = &curve->_p;
+    bnBegin(&curve->_n);    curve->n = &curve->_n;
+    bnBegin(&curve->_SEED); curve->SEED = &curve->_SEED;
+    bnBegin(&curve->_c);    curve->c = &curve->_c;
+    bnBegin(&curve->_a);    curve->a = &curve->_a;
+    bnBegin(&curve->_b);    curve->b = &curve->_b;
+    bnBegin(&curve->_Gx);   curve->Gx = &curve->_Gx;
+    bnBegin(&curve->_Gy);   curve->Gy = &curve->_Gy;
+
+    curveCommonInit(curve);
+
+    params = ecGetCurveParams(curveId);
+    if (params == NULL)
+        return -2;
+
+    curve->id = params->id;
+    curve->p = params->p;
+    curve->n = params->n;
+    curve->SEED = params->SEED;
+    curve->c = params->c;
+    curve->a = params->a;
+    curve->b = params->b;
+    curve->Gx = params->Gx;
+    curve->Gy = params->Gy;
+
+    curve->affineOp = params->affineOp;
+    curve->doubleOp = params->doubleOp;
+    curve->addOp = params->addOp;
+    curve->modOp = params->modOp;
+    curve->checkPubOp = params->checkPubOp;
+    curve->randomOp = params->randomOp;
+    curve->mulScalar = params->mulScalar;
+
+    curveCommonPrealloc(curve);
+
+    /* Build the fixed base table if this is the first curve structure of this type */
+    if (curveId != Curve25519 && ecGetCombTable(curve) == NULL)
+        return -1;
+
+    return 0;
+}
+
+int ecGetCurveNistECp(Curves curveId, EcCurve *curve)
+{
+    if (curveId >= Curve25519 && curveId <= Curve3617)
+        return ecGetCurvesCurve(curveId, curve);
+
+    return ecShareCurve(curveId, curve);
+}
+
+int ecGetCurvesCurve(Curves curveId, EcCurve *curve)
+{
+    if (curveId != Curve25519 && curveId != Curve3617)
+        curveId = 0;                            /* ecShareCurve returns -2 */
+
+    return ecShareCurve(curveId, curve);
+}
+
+/* Free the parameters and the scratch pad of a curve structure that owns its parameters */
+static void ecFreeCurveParams(EcCurve *curve)
+{
+    ecFreeCurveNistECp(curve);
+    zrtpFree(curve, sizeof(EcCurve));
+}
+
 void ecFreeCurveNistECp(EcCurve *curve) 
 {
     if (curve == NULL)
         return;
 
-    bnEnd(curve->p);
-    bnEnd(curve->n);
-    bnEnd(curve->SEED);
-    bnEnd(curve->c);
-    bnEnd(curve->b);
-    bnEnd(curve->Gx);
-    bnEnd(curve->Gy);
+    /* Shared parameters use the structures of ecGetCurveParams, these are empty */
+    bnEnd(&curve->_p);
+    bnEnd(&curve->_n);
+    bnEnd(&curve->_SEED);
+    bnEnd(&curve->_c);
+    bnEnd(&curve->_a);
+    bnEnd(&curve->_b);
+    bnEnd(&curve->_Gx);
+    bnEnd(&curve->_Gy);
 
     bnEnd(curve->S1);
     bnEnd(curve->U1);
@@ -567,6 +757,14 @@ int ecDoublePoint(const EcCurve *curve, EcPoint *R, const EcPoint *P)
     return curve->doubleOp(curve, R, P);
 }
 
+/* rslt = 2 * rslt mod mod, rslt < mod */
+static void bnDoubleMod_(struct BigNum *rslt, struct BigNum *mod)
+{
+    bnLShift(rslt, 1);
+    if (bnCmp(rslt, mod) >= 0)
+        bnSub(rslt, mod);
+}
+
 static int ecDoublePointNist(const EcCurve *curve, EcPoint *R, const EcPoint *P)
 {
     int ret = 0;
@@ -592,29 +790,40 @@ static int ecDoublePointNist(const EcCurve *curve, EcPoint *R, const EcPoint *P)
     else 
         ptP = P;
 
-    /* S = 4*X*Y^2, save Y^2 in t1 for later use */
-    bnMulMod_(curve->t1, ptP->y, ptP->y, curve->p, curve);       /* t1 = Y^2 */
-    bnMulMod_(curve->t0, ptP->x, mpiFour, curve->p, curve);      /* t0 = 4 * X */
-    bnMulMod_(curve->S1, curve->t0, curve->t1, curve->p, curve); /* S1 = t0 * t1 */
+    /*
+     * The NIST curves have a = -3, thus M = 3*X^2 + a*Z^4 = 3*(X - Z^2)*(X + Z^2). The
+     * small factors use additions, the doubling needs 4 multiplications and 4 squarings.
+     */
+    bnSquareMod_(curve->t2, ptP->z, curve->p, curve);            /* t2 = Z^2 */
+    bnSquareMod_(curve->t1, ptP->y, curve->p, curve);            /* t1 = Y^2, save for later use */
+
+    /* S = 4*X*Y^2 */
+    bnMulMod_(curve->S1, ptP->x, curve->t1, curve->p, curve);    /* S1 = X * t1 */
+    bnDoubleMod_(curve->S1, curve->p);
+    bnDoubleMod_(curve->S1, curve->p);                           /* S1 = 4 * S1 */
 
     /* M = 3*(X + Z^2)*(X - Z^2), use scratch variable U1 to store M value */
-    bnMulMod_(curve->t2, ptP->z, ptP->z, curve->p, curve);       /* t2 = Z^2 */
     bnCopy(curve->t0, ptP->x);
     bnAddMod_(curve->t0, curve->t2, curve->p);                   /* t0 = X + t2  */
-    bnMulMod_(curve->t3, curve->t0, mpiThree, curve->p, curve);  /* t3 = 3 * t0 */
-    bnCopy(curve->t0, ptP->x);
-    bnSubMod_(curve->t0, curve->t2, curve->p);                   /* t0 = X - t2 */
-    bnMulMod_(curve->U1, curve->t3, curve->t0, curve->p, curve); /* M = t3 * t0 */
-    
+    bnCopy(curve->t3, ptP->x);
+    bnSubMod_(curve->t3, curve->t2, curve->p);                   /* t3 = X - t2 */
+    bnMulMod_(curve->t2, curve->t0, curve->t3, curve->p, curve); /* t2 = t0 * t3 */
+    bnCopy(curve->U1, curve->t2);
+    bnDoubleMod_(curve->U1, curve->p);
+    bnAddMod_(curve->U1, curve->t2, curve->p);                   /* M = 3 * t2 */
+
     /* X' = M^2 - 2*S */
-    bnMulMod_(curve->t2, curve->U1, curve->U1, curve->p, curve); /* t2 = M^2 */
-    bnMulMod_(curve->t0, curve->S1, mpiTwo, curve->p, curve);    /* t0 = S * 2 */
+    bnSquareMod_(curve->t2, curve->U1, curve->p, curve);         /* t2 = M^2 */
+    bnCopy(curve->t0, curve->S1);
+    bnDoubleMod_(curve->t0, curve->p);                           /* t0 = S * 2 */
     bnCopy(R->x, curve->t2);
     bnSubMod_(R->x, curve->t0, curve->p);                        /* X' = t2 - t0 */
 
     /* Y' = M*(S - X') - 8*Y^4 */
-    bnMulMod_(curve->t3, curve->t1, curve->t1, curve->p, curve); /* t3 = Y^4 (t1 saved above) */
-    bnMulMod_(curve->t2, curve->t3, mpiEight, curve->p, curve);  /* t2 = t3 * 8 */
+    bnSquareMod_(curve->t2, curve->t1, curve->p, curve);         /* t2 = Y^4 (t1 saved above) */
+    bnDoubleMod_(curve->t2, curve->p);
+    bnDoubleMod_(curve->t2, curve->p);
+    bnDoubleMod_(curve->t2, curve->p);                           /* t2 = t2 * 8 */
     bnCopy(curve->t3, curve->S1);
     bnSubMod_(curve->t3, R->x, curve->p);                        /* t3 = S - X' */
     bnMulMod_(curve->t0, curve->U1, curve->t3, curve->p, curve); /* t0 = M * t3 */
@@ -622,8 +831,8 @@ static int ecDoublePointNist(const EcCurve *curve, EcPoint *R, const EcPoint *P)
     bnSubMod_(R->y, curve->t2, curve->p);                        /* Y' = t0 - t2 */
 
     /* Z' = 2*Y*Z */
-    bnMulMod_(curve->t0, ptP->y, mpiTwo, curve->p, curve);       /* t0 = 2 * Y */
-    bnMulMod_(R->z, curve->t0, ptP->z, curve->p, curve);         /* Z' = to * Z */
+    bnMulMod_(R->z, ptP->y, ptP->z, curve->p, curve);            /* Z' = Y * Z */
+    bnDoubleMod_(R->z, curve->p);                                /* Z' = 2 * Z' */
 
     if (P == R)
         FREE_EC_POINT(&tP);
@@ -690,6 +899,104 @@ static int ecDoublePoint25519(const EcCurve *curve, EcPoint *R, const EcPoint *P
     return -2;
 }
 
+/*
+ * Convert the coordinates of a point into fixed width field elements, see ecfield.c
+ */
+static int ecPointToField(const EcField *field, EcFieldPoint *R, const EcPoint *P)
+{
+    if (ecFieldFromBigNum(field, R->x, P->x) < 0 ||
+        ecFieldFromBigNum(field, R->y, P->y) < 0 ||
+        ecFieldFromBigNum(field, R->z, P->z) < 0)
+        return -1;
+    return 0;
+}
+
+static void ecPointFromField(const EcField *field, EcPoint *R, const EcFieldPoint *P)
+{
+    ecFieldToBigNum(field, R->x, P->x);
+    ecFieldToBigNum(field, R->y, P->y);
+    ecFieldToBigNum(field, R->z, P->z);
+}
+
+/*
+ * The fixed width field inverts Z with a constant time exponentiation instead of the
+ * variable time bnInv.
+ */
+static int ecGetAffineFixed(const EcCurve *curve, EcPoint *R, const EcPoint *P)
+{
+    const EcField *field = ecGetField(curve->id);
+    EcFieldPoint tP;
+
+    if (ecPointToField(field, &tP, P) < 0)
+        return curve->id == Curve3617 ? ecGetAffineEd(curve, R, P) : ecGetAffineNist(curve, R, P);
+
+    ecFieldGetAffine(field, &tP, &tP);
+    ecPointFromField(field, R, &tP);
+    return 0;
+}
+
+/* Convert an array of points, one inversion for the points of a fixed width field batch */
+int ecGetAffineBatch(const EcCurve *curve, EcPoint *points, int numPoints)
+{
+    const EcField *field = ecGetField(curve->id);
+    EcFieldPoint tP[EC_FIELD_BATCH_POINTS];
+    int base, n, i;
+
+    if (field == NULL || curve->id == Curve25519) {
+        for (i = 0; i < numPoints; i++)
+            ecGetAffine(curve, &points[i], &points[i]);
+        return 0;
+    }
+
+    for (base = 0; base < numPoints; base += n) {
+        n = numPoints - base;
+        if (n > EC_FIELD_BATCH_POINTS)
+            n = EC_FIELD_BATCH_POINTS;
+
+        /* coordinates that do not fit into the field use the BigNum functions */
+        for (i = 0; i < n; i++) {
+            if (ecPointToField(field, &tP[i], &points[base + i]) < 0)
+                break;
+        }
+        if (i < n) {
+            for (i = 0; i < n; i++)
+                ecGetAffine(curve, &points[base + i], &points[base + i]);
+            continue;
+        }
+        ecFieldBatchAffine(field, tP, n);
+        for (i = 0; i < n; i++)
+            ecPointFromField(field, &points[base + i], &tP[i]);
+    }
+    return 0;
+}
+
+static int ecDoublePointFixed(const EcCurve *curve, EcPoint *R, const EcPoint *P)
+{
+    const EcField *field = ecGetField(curve->id);
+    EcFieldPoint tP;
+
+    /* coordinates that do not fit into the field use the BigNum functions */
+    if (ecPointToField(field, &tP, P) < 0)
+        return ecDoublePointNist(curve, R, P);
+
+    ecFieldDoublePoint(field, &tP, &tP);
+    ecPointFromField(field, R, &tP);
+    return 0;
+}
+
+static int ecAddPointFixed(const EcCurve *curve, EcPoint *R, const EcPoint *P, const EcPoint *Q)
+{
+    const EcField *field = ecGetField(curve->id);
+    EcFieldPoint tP, tQ;
+
+    if (ecPointToField(field, &tP, P) < 0 || ecPointToField(field, &tQ, Q) < 0)
+        return ecAddPointNist(curve, R, P, Q);
+
+    ecFieldAddPoint(field, &tP, &tP, &tQ);
+    ecPointFromField(field, R, &tP);
+    return 0;
+}
+
 /* Add two elliptic curve points. Any of them may be the same object. */
 int ecAddPoint(const EcCurve *curve, EcPoint *R, const EcPoint *P, const EcPoint *Q)
 {
@@ -747,16 +1054,24 @@ static int ecAddPointNist(const EcCurve *curve, EcPoint *R, const EcPoint *P, co
     else
         ptQ = Q;
 
-    /* U1 = X1*Z2^2, where X1: P->x, Z2: Q->z */
-    bnMulMod_(curve->t1, ptQ->z, ptQ->z, curve->p, curve);    /* t1 = Z2^2 */
-    bnMulMod_(curve->U1, ptP->x, curve->t1, curve->p, curve); /* U1 = X1 * z_2 */
-
-    /* S1 = Y1*Z2^3, where Y1: P->y */
-    bnMulMod_(curve->t1, curve->t1, ptQ->z, curve->p, curve); /* t1 = Z2^3 */
-    bnMulMod_(curve->S1, ptP->y, curve->t1, curve->p, curve); /* S1 = Y1 * z_2 */
+    /*
+     * U1 = X1*Z2^2, S1 = Y1*Z2^3, where X1: P->x, Y1: P->y, Z2: Q->z. The points of
+     * precomputed tables are affine, with Z2 = 1 the mixed addition saves four
+     * multiplications.
+     */
+    if (!bnCmp(ptQ->z, mpiOne)) {
+        bnCopy(curve->U1, ptP->x);
+        bnCopy(curve->S1, ptP->y);
+    }
+    else {
+        bnSquareMod_(curve->t1, ptQ->z, curve->p, curve);         /* t1 = Z2^2 */
+        bnMulMod_(curve->U1, ptP->x, curve->t1, curve->p, curve); /* U1 = X1 * z_2 */
+        bnMulMod_(curve->t1, curve->t1, ptQ->z, curve->p, curve); /* t1 = Z2^3 */
+        bnMulMod_(curve->S1, ptP->y, curve->t1, curve->p, curve); /* S1 = Y1 * z_2 */
+    }
 
     /* U2 = X2*Z1^2, where X2: Q->x, Z1: P->z */
-    bnMulMod_(curve->t1, ptP->z, ptP->z, curve->p, curve);    /* t1 = Z1^2 */
+    bnSquareMod_(curve->t1, ptP->z, curve->p, curve);         /* t1 = Z1^2 */
     bnMulMod_(curve->H, ptQ->x, curve->t1, curve->p, curve);  /* H = X2 * t1 (store U2 in H) */
 
     /* H = U2 - U1 */
@@ -777,18 +1092,24 @@ static int ecAddPointNist(const EcCurve *curve, EcPoint *R, const EcPoint *P, co
             bnSetQ(R->x, 1);
             bnSetQ(R->y, 1);
             bnSetQ(R->z, 0);
-            return 0;
         }
-        return ecDoublePoint(curve, R, P);
+        else
+            ret = ecDoublePoint(curve, R, ptP);
+        if (P == R)
+            FREE_EC_POINT(&tP);
+        if (Q == R)
+            FREE_EC_POINT(&tQ);
+        return ret;
     }
     /* X3 = R^2 - H^3 - 2*U1*H^2, where X3: R->x */
-    bnMulMod_(curve->t0, curve->H, curve->H, curve->p, curve);   /* t0 = H^2 */
+    bnSquareMod_(curve->t0, curve->H, curve->p, curve);          /* t0 = H^2 */
     bnMulMod_(curve->t1, curve->U1, curve->t0, curve->p, curve); /* t1 = U1 * t0, (hold t1) */
     bnMulMod_(curve->t0, curve->t0, curve->H, curve->p, curve);  /* t0 = H^3, (hold t0) */
-    bnMulMod_(curve->t2, curve->R, curve->R, curve->p, curve);   /* t2 = R^2 */
+    bnSquareMod_(curve->t2, curve->R, curve->p, curve);          /* t2 = R^2 */
     bnCopy(curve->t3, curve->t2);
     bnSubMod_(curve->t3, curve->t0, curve->p);                   /* t3 = t2 - t0, (-H^3)*/
-    bnMulMod_(curve->t2, mpiTwo, curve->t1, curve->p, curve);    /* t2 = 2 * t1 */
+    bnCopy(curve->t2, curve->t1);
+    bnDoubleMod_(curve->t2, curve->p);                           /* t2 = 2 * t1 */
     bnCopy(R->x, curve->t3);
     bnSubMod_(R->x, curve->t2, curve->p);                        /* X3 = t3 - t2 */
 
@@ -800,8 +1121,12 @@ static int ecAddPointNist(const EcCurve *curve, EcPoint *R, const EcPoint *P, co
     bnSubMod_(R->y, curve->S1, curve->p);                        /* Y3 = t2 - S1 */
 
     /* Z3 = H*Z1*Z2, where Z1: P->z, Z2: Q->z, Z3: R->z */
-    bnMulMod_(curve->t2, curve->H, P->z, curve->p, curve);       /* t2 = H * Z1 */
-    bnMulMod_(R->z, curve->t2, Q->z, curve->p, curve);           /* Z3 = t2 * Z2 */
+    if (!bnCmp(ptQ->z, mpiOne))
+        bnMulMod_(R->z, curve->H, ptP->z, curve->p, curve);      /* Z3 = H * Z1 */
+    else {
+        bnMulMod_(curve->t2, curve->H, ptP->z, curve->p, curve); /* t2 = H * Z1 */
+        bnMulMod_(R->z, curve->t2, ptQ->z, curve->p, curve);     /* Z3 = t2 * Z2 */
+    }
 
     if (P == R)
         FREE_EC_POINT(&tP);
@@ -946,6 +1271,409 @@ static int ecMulPointScalarNormal(const EcCurve *curve, EcPoint *R, const EcPoin
     return ret;
 }
 
+/*
+ * Recode the scalar into the signed digits of ecMulPointScalarWindow, returns the
+ * number of digits. Sets negate if the function recoded n - k instead of k.
+ */
+static int ecRecodeScalar(const EcCurve *curve, const BigNum *scalar, int *digits, int *negate)
+{
+    BigNum k;
+    int numDigits, i;
+    unsigned low;
+
+    bnBegin(&k);
+    bnMod(&k, scalar, curve->n);
+
+    /* Use an odd scalar: k*P = -((n - k)*P) */
+    *negate = (bnLSWord(&k) & 1) == 0;
+    if (*negate) {
+        BigNum t;
+        bnBegin(&t);
+        bnCopy(&t, curve->n);
+        bnSub(&t, &k);
+        bnCopy(&k, &t);
+        bnEnd(&t);
+    }
+
+    /* Recode the scalar, the highest digit is always positive */
+    numDigits = bnBits(curve->n) / EC_WINDOW_WIDTH + 1;
+    for (i = 0; i < numDigits - 1; i++) {
+        low = bnLSWord(&k) & ((1u << (EC_WINDOW_WIDTH + 1)) - 1);
+        digits[i] = (int)low - (1 << EC_WINDOW_WIDTH);
+        if (digits[i] < 0)
+            bnAddQ(&k, (unsigned)(-digits[i]));
+        else
+            bnSubQ(&k, (unsigned)digits[i]);
+        bnRShift(&k, EC_WINDOW_WIDTH);
+    }
+    digits[i] = (int)bnLSWord(&k);
+    bnEnd(&k);
+    return numDigits;
+}
+
+/*
+ * Variable base scalar multiplication with a regular signed window, NIST curves only.
+ *
+ * The function recodes the odd scalar k into signed odd digits d_i of EC_WINDOW_WIDTH
+ * bits, k = sum(d_i * 2^(i*w)), d_i in {+-1, +-3, ..., +-(2^w - 1)}. Because no digit
+ * is zero the function performs the same sequence of point doublings and additions for
+ * all scalars of a curve: w doublings and one addition per digit. Thus the timing of
+ * the point operations does not depend on the bits of the scalar. If k is even the function
+ * uses the odd scalar n - k and negates the result, n is the (odd) order of the curve.
+ *
+ * Compared to ecMulPointScalarNormal this saves about half of the point additions.
+ *
+ * Note: the table lookup and the bnlib arithmetic are not constant time.
+ */
+static void ecMulPointWindowField(const EcField *field, EcFieldPoint *R, const EcFieldPoint *P,
+                                  const int *digits, int numDigits, int negate);
+
+static int ecMulPointScalarWindow(const EcCurve *curve, EcPoint *R, const EcPoint *P, const BigNum *scalar)
+{
+    EcPoint table[EC_WINDOW_POINTS];
+    EcPoint T;
+    const EcField *field;
+    EcFieldPoint fieldPoint;
+    int digits[EC_WINDOW_DIGITS];
+    int numDigits, negate, i, j;
+
+    numDigits = ecRecodeScalar(curve, scalar, digits, &negate);
+
+    field = ecGetField(curve->id);
+    if (field != NULL && ecPointToField(field, &fieldPoint, P) == 0) {
+        ecMulPointWindowField(field, &fieldPoint, &fieldPoint, digits, numDigits, negate);
+        ecPointFromField(field, R, &fieldPoint);
+        return 0;
+    }
+
+    /* Precompute the odd multiples: table[j] = (2j + 1) * P */
+    INIT_EC_POINT(&T);
+    for (j = 0; j < EC_WINDOW_POINTS; j++)
+        INIT_EC_POINT(&table[j]);
+
+    bnCopy(table[0].x, P->x);
+    bnCopy(table[0].y, P->y);
+    bnCopy(table[0].z, P->z);
+    ecDoublePoint(curve, &T, P);
+    for (j = 1; j < EC_WINDOW_POINTS; j++)
+        ecAddPoint(curve, &table[j], &table[j-1], &T);
+
+    j = digits[numDigits - 1] >> 1;
+    bnCopy(R->x, table[j].x);
+    bnCopy(R->y, table[j].y);
+    bnCopy(R->z, table[j].z);
+
+    for (i = numDigits - 2; i >= 0; i--) {
+        for (j = 0; j < EC_WINDOW_WIDTH; j++)
+            ecDoublePoint(curve, R, R);
+
+        j = (digits[i] < 0 ? -digits[i] : digits[i]) >> 1;
+        bnCopy(T.x, table[j].x);
+        bnCopy(T.z, table[j].z);
+        if (digits[i] < 0) {
+            bnCopy(T.y, curve->p);                  /* -(x, y, z) = (x, p - y, z) */
+            bnSub(T.y, table[j].y);
+        }
+        else
+            bnCopy(T.y, table[j].y);
+        ecAddPoint(curve, R, R, &T);
+    }
+
+    if (negate && bnCmp(R->y, mpiZero)) {
+        bnCopy(T.y, curve->p);
+        bnSub(T.y, R->y);
+        bnCopy(R->y, T.y);
+    }
+
+    for (j = 0; j < EC_WINDOW_POINTS; j++)
+        FREE_EC_POINT(&table[j]);
+    FREE_EC_POINT(&T);
+    return 0;
+}
+
+/*
+ * The variable base scalar multiplication of ecMulPointScalarWindow with fixed width
+ * field elements, R may be the same as P.
+ */
+static void ecMulPointWindowField(const EcField *field, EcFieldPoint *R, const EcFieldPoint *P,
+                                  const int *digits, int numDigits, int negate)
+{
+    EcFieldPoint table[EC_WINDOW_POINTS];
+    EcFieldPoint T, Q;
+    int i, j;
+
+    table[0] = *P;
+    ecFieldDoublePoint(field, &T, P);
+    for (j = 1; j < EC_WINDOW_POINTS; j++)
+        ecFieldAddPoint(field, &table[j], &table[j-1], &T);
+
+    Q = table[digits[numDigits - 1] >> 1];
+
+    for (i = numDigits - 2; i >= 0; i--) {
+        for (j = 0; j < EC_WINDOW_WIDTH; j++)
+            ecFieldDoublePoint(field, &Q, &Q);
+
+        j = (digits[i] < 0 ? -digits[i] : digits[i]) >> 1;
+        if (digits[i] < 0) {
+            ecFieldNegatePoint(field, &T, &table[j]);
+            ecFieldAddPoint(field, &Q, &Q, &T);
+        }
+        else
+            ecFieldAddPoint(field, &Q, &Q, &table[j]);
+    }
+    if (negate)
+        ecFieldNegatePoint(field, &Q, &Q);
+    *R = Q;
+}
+
+/*
+ * Variable base scalar multiplication for Curve41417 with fixed width field elements.
+ *
+ * The function uses a fixed window of EC_ED_WINDOW_WIDTH bits and the complete Edwards
+ * addition formulas. It processes all windows up to the bit length of p, selects the
+ * table point in constant time and adds it even if the window is zero (adds the neutral
+ * element). Thus the sequence of field operations and the memory access pattern do not
+ * depend on the scalar. The function does not reduce the scalar modulo n, the clamped
+ * secret keys of Curve41417 include the cofactor.
+ *
+ * Coordinates or scalars that do not fit into the field use ecMulPointScalarNormal.
+ */
+static void ecMulPointFieldEd(const EcField *field, EcFieldPoint *R, const EcFieldPoint *P,
+                              const BigNum *scalar, int numWindows)
+{
+    EcFieldPoint table[EC_ED_WINDOW_POINTS];
+    EcFieldPoint Q, T;
+    int i, j, index;
+
+    /* table[j] = j * P */
+    ecFieldSetNeutral(field, &table[0]);
+    table[1] = *P;
+    for (j = 2; j < EC_ED_WINDOW_POINTS; j++)
+        ecFieldAddPoint(field, &table[j], &table[j-1], &table[1]);
+
+    ecFieldSetNeutral(field, &Q);
+    for (i = numWindows - 1; i >= 0; i--) {
+        for (j = 0; j < EC_ED_WINDOW_WIDTH; j++)
+            ecFieldDoublePoint(field, &Q, &Q);
+
+        index = 0;
+        for (j = 0; j < EC_ED_WINDOW_WIDTH; j++)
+            index |= bnReadBit(scalar, i * EC_ED_WINDOW_WIDTH + j) << j;
+
+        ecFieldSelectPoint(field, &T, table, EC_ED_WINDOW_POINTS, index);
+        ecFieldAddPoint(field, &Q, &Q, &T);
+    }
+    *R = Q;
+}
+
+static int ecMulPointScalarEd(const EcCurve *curve, EcPoint *R, const EcPoint *P, const BigNum *scalar)
+{
+    const EcField *field = ecGetField(curve->id);
+    EcFieldPoint Q;
+    int numWindows;
+
+    numWindows = (bnBits(curve->p) + EC_ED_WINDOW_WIDTH - 1) / EC_ED_WINDOW_WIDTH;
+    if (field == NULL || bnBits(scalar) > (unsigned)(numWindows * EC_ED_WINDOW_WIDTH) ||
+        ecPointToField(field, &Q, P) < 0)
+        return ecMulPointScalarNormal(curve, R, P, scalar);
+
+    ecMulPointFieldEd(field, &Q, &Q, scalar, numWindows);
+    ecPointFromField(field, R, &Q);
+    return 0;
+}
+
+/*
+ * Take the affine coordinates as bytes and return the affine result as bytes, the
+ * point stays in fixed width field elements from the input to the output.
+ */
+int ecMulPointScalarBytes(const EcCurve *curve, unsigned char *x, unsigned char *y,
+                          const unsigned char *px, const unsigned char *py, int len, const BigNum *scalar)
+{
+    static const unsigned char one = 1;
+    const EcField *field = ecGetField(curve->id);
+    EcFieldPoint Q;
+    int digits[EC_WINDOW_DIGITS];
+    int numDigits, numWindows, negate;
+
+    if (field == NULL || ecFieldFromBytes(field, Q.x, px, len) < 0 || ecFieldFromBytes(field, Q.y, py, len) < 0)
+        return -1;
+    ecFieldFromBytes(field, Q.z, &one, 1);
+
+    if (curve->id == Curve3617) {
+        numWindows = (bnBits(curve->p) + EC_ED_WINDOW_WIDTH - 1) / EC_ED_WINDOW_WIDTH;
+        if (bnBits(scalar) > (unsigned)(numWindows * EC_ED_WINDOW_WIDTH))
+            return -1;
+        ecMulPointFieldEd(field, &Q, &Q, scalar, numWindows);
+    }
+    else {
+        numDigits = ecRecodeScalar(curve, scalar, digits, &negate);
+        ecMulPointWindowField(field, &Q, &Q, digits, numDigits, negate);
+    }
+    ecFieldGetAffine(field, &Q, &Q);
+
+    ecFieldToBytes(field, x, len, Q.x);
+    if (y != NULL)
+        ecFieldToBytes(field, y, len, Q.y);
+    return 0;
+}
+
+static void ecFreeCombTable(EcCombTable *table)
+{
+    int j;
+
+    for (j = 0; j < EC_COMB_POINTS; j++)
+        FREE_EC_POINT(&table->points[j]);
+    zrtpFree(table, sizeof(EcCombTable));
+}
+
+/*
+ * Build a comb table for the curve's base point.
+ *
+ * With t the bit length of the order n and d = ceil(t / EC_COMB_WIDTH) the table contains
+ * points[j] = sum(bit i of j set: 2^(i*d) * G), 0 < j < 2^EC_COMB_WIDTH. The function
+ * converts all points to affine coordinates with one batch conversion, this saves some
+ * work during point additions.
+ */
+static EcCombTable *ecBuildCombTable(const EcCurve *curve)
+{
+    EcCombTable *table;
+    int i, j, lowBit;
+
+    table = (EcCombTable *)zrtpAlloc(sizeof(EcCombTable));
+    if (table == NULL)
+        return NULL;
+
+    for (j = 0; j < EC_COMB_POINTS; j++)
+        INIT_EC_POINT(&table->points[j]);
+
+    table->columns = (bnBits(curve->n) + EC_COMB_WIDTH - 1) / EC_COMB_WIDTH;
+
+    /* points[2^i] = 2^(i*d) * G */
+    SET_EC_BASE_POINT(curve, &table->points[1]);
+    for (i = 1; i < EC_COMB_WIDTH; i++) {
+        EcPoint *prev = &table->points[1 << (i-1)];
+        EcPoint *next = &table->points[1 << i];
+
+        ecDoublePoint(curve, next, prev);
+        for (j = 1; j < table->columns; j++)
+            ecDoublePoint(curve, next, next);
+    }
+
+    /* all other points are sums of the previous points */
+    for (j = 3; j < EC_COMB_POINTS; j++) {
+        lowBit = j & -j;
+        if (lowBit == j)
+            continue;
+        ecAddPoint(curve, &table->points[j], &table->points[j ^ lowBit], &table->points[lowBit]);
+    }
+    ecGetAffineBatch(curve, &table->points[1], EC_COMB_POINTS - 1);
+    for (j = 1; j < EC_COMB_POINTS; j++)
+        bnSetQ(table->points[j].z, 1);
+
+    table->field = ecGetField(curve->id);
+    for (j = 1; j < EC_COMB_POINTS && table->field != NULL; j++) {
+        if (ecPointToField(table->field, &table->fieldPoints[j], &table->points[j]) < 0)
+            table->field = NULL;
+    }
+    return table;
+}
+
+/*
+ * Get the comb table of a curve, build it if necessary.
+ *
+ * If two threads build the table at the same time only one table survives, the other
+ * thread frees its table and uses the published table.
+ */
+static const EcCombTable *ecGetCombTable(const EcCurve *curve)
+{
+    EcCombTable *table;
+    EcCombTable *newTable;
+
+    if (curve->id <= 0 || curve->id > Curve3617 || curve->id == Curve25519)
+        return NULL;
+
+    table = EC_LOAD_TABLE(&combTables[curve->id]);
+    if (table != NULL)
+        return table;
+
+    newTable = ecBuildCombTable(curve);
+    if (newTable == NULL)
+        return NULL;
+
+    if (EC_PUBLISH_TABLE(&combTables[curve->id], newTable))
+        return newTable;
+
+    ecFreeCombTable(newTable);
+    return EC_LOAD_TABLE(&combTables[curve->id]);
+}
+
+/*
+ * Fixed base scalar multiplication with a comb table, see ecBuildCombTable.
+ *
+ * For each column c, from d-1 down to 0, the function doubles R and adds the table point
+ * selected by the bits c, d+c, 2d+c, ... of the scalar. If all these bits are zero the
+ * function adds the point to a dummy point, thus it performs one doubling and one
+ * addition per column for all scalars.
+ */
+int ecMulBasePointScalar(const EcCurve *curve, EcPoint *R, const BigNum *scalar)
+{
+    const EcCombTable *table = ecGetCombTable(curve);
+    EcPoint dummy;
+    int column, i, index;
+    int ret = 0;
+
+    if (table == NULL || bnBits(scalar) > (unsigned)(table->columns * EC_COMB_WIDTH)) {
+        EcPoint G;
+
+        INIT_EC_POINT(&G);
+        SET_EC_BASE_POINT(curve, &G);
+        ret = ecMulPointScalar(curve, R, &G, scalar);
+        FREE_EC_POINT(&G);
+        return ret;
+    }
+    if (table->field != NULL) {
+        EcFieldPoint Q, dummyPoint;
+
+        ecFieldSetNeutral(table->field, &Q);
+        for (column = table->columns - 1; column >= 0; column--) {
+            ecFieldDoublePoint(table->field, &Q, &Q);
+
+            index = 0;
+            for (i = 0; i < EC_COMB_WIDTH; i++)
+                index |= bnReadBit(scalar, i * table->columns + column) << i;
+
+            if (index != 0)
+                ecFieldAddPoint(table->field, &Q, &Q, &table->fieldPoints[index]);
+            else
+                ecFieldAddPoint(table->field, &dummyPoint, &Q, &table->fieldPoints[1]);
+        }
+        ecPointFromField(table->field, R, &Q);
+        return 0;
+    }
+    INIT_EC_POINT(&dummy);
+
+    bnSetQ(R->x, 0);
+    bnSetQ(R->y, 0);
+    bnSetQ(R->z, 0);
+
+    for (column = table->columns - 1; column >= 0; column--) {
+        ecDoublePoint(curve, R, R);
+
+        index = 0;
+        for (i = 0; i < EC_COMB_WIDTH; i++)
+            index |= bnReadBit(scalar, i * table->columns + column) << i;
+
+        if (index != 0)
+            ecAddPoint(curve, R, R, &table->points[index]);
+        else
+            ecAddPoint(curve, &dummy, R, &table->points[1]);
+    }
+    FREE_EC_POINT(&dummy);
+    return ret;
+}
+
+static const uint8_t zero25519[31] = {0};
+
 /* 
  * This function uses BigNumber only as containers to transport the 32 byte data.
  * This makes it compliant to the other functions and thus higher-level API does not change.
@@ -958,7 +1686,10 @@ static int ecMulPointScalar25519(const EcCurve *curve, EcPoint *R, const EcPoint
 
     bnExtractLittleBytes(P->x, basepoint, 0, 32);  /* 25519 function requires the X coordinate only (compressed) */
     bnExtractLittleBytes(scalar, secret, 0, 32);
-    curve25519_donna(result, secret, basepoint);
+    if (basepoint[0] == 9 && memcmp(basepoint + 1, zero25519, 31) == 0)
+        curve25519_donna_basepoint(result, secret);   /* public key: the fixed-base table */
+    else
+        curve25519_donna(result, secret, basepoint);
     bnInsertLittleBytes(R->x, result, 0, 32);
     return 0;
 }
@@ -1000,14 +1731,48 @@ int ecGenerateRandomNumber(const EcCurve *curve, BigNum *d)
 
 #define MAX_RANDOM_BYTES  128   // Curve 521 (our biggest curve) requires 66 (+8) bytes of random data
 
-static int ecGenerateRandomNumberNist(const EcCurve *curve, BigNum *d)
+/* Number of random bytes for one secret random number of the curve */
+static size_t ecRandomBytes(const EcCurve *curve)
+{
+    if (curve->id == Curve3617)
+        return 52;
+    if (curve->id == Curve25519)
+        return 32;
+    return ((bnBits(curve->n) + 64) + 7) / 8;
+}
+
+/*
+ * Convert the random bytes into a secret random number of the curve, the function
+ * modifies the random bytes. Returns -1 if the random bytes give no valid number.
+ */
+static int ecRandomFromBytes(const EcCurve *curve, BigNum *d, unsigned char *ran, size_t len)
 {
     BigNum c, nMinusOne;
-    uint8_t ran[MAX_RANDOM_BYTES];
-    size_t randomBytes = ((bnBits(curve->n) + 64) + 7) / 8;
 
-    if (randomBytes > MAX_RANDOM_BYTES)
-        return -1;
+    if (curve->id == Curve3617) {
+        /* prepare the secret random data: clear bottom 3 bits. Clearing top 2 bits
+         * makes is a 414 bit value
+         */
+        ran[51] &= ~0x7;
+        ran[0] &= 0x3f;
+        /* convert the random data into big numbers */
+        bnInsertBigBytes(d, ran, 0, 52);
+        return 0;
+    }
+    if (curve->id == Curve25519) {
+        // Same as in curve25519_donna, thus a no-op there if this function generates the secret.
+        ran[0] &= 248;
+        ran[31] &= 127;
+        ran[31] |= 64;
+
+        /* No specific preparation. The curve25519_donna functions prepares the data.
+         *
+         * convert the random data into big numbers. the bigNumber is a container only.
+         * we don not use the big number for any arithmetic
+         */
+        bnInsertLittleBytes(d, ran, 0, 32);
+        return 0;
+    }
 
     bnBegin(&c);
     bnBegin(&nMinusOne);
@@ -1015,19 +1780,38 @@ static int ecGenerateRandomNumberNist(const EcCurve *curve, BigNum *d)
     bnCopy(&nMinusOne, curve->n);
     bnSubMod_(&nMinusOne, mpiOne, curve->p);
 
-    bnSetQ(d, 0);
-
-    while (!bnCmpQ(d, 0)) {
-        /* use _random function */
-        _random(ran, randomBytes);
-        bnInsertBigBytes(&c, ran, 0, randomBytes);
-        bnMod(d, &c, &nMinusOne);
-        bnAddMod_(d, mpiOne, curve->p);
-    }
+    bnInsertBigBytes(&c, ran, 0, len);
+    bnMod(d, &c, &nMinusOne);
+    bnAddMod_(d, mpiOne, curve->p);
 
     bnEnd(&c);
     bnEnd(&nMinusOne);
 
+    return bnCmpQ(d, 0) ? 0 : -1;
+}
+
+/* Clear the random bytes, the compiler cannot optimize the stores away */
+static void ecWipeRandom(unsigned char *ran, size_t len)
+{
+    volatile unsigned char *p = ran;
+
+    while (len--)
+        *p++ = 0;
+}
+
+static int ecGenerateRandomNumberNist(const EcCurve *curve, BigNum *d)
+{
+    uint8_t ran[MAX_RANDOM_BYTES];
+    size_t randomBytes = ecRandomBytes(curve);
+
+    if (randomBytes > MAX_RANDOM_BYTES)
+        return -1;
+
+    do {
+        /* use _random function */
+        _random(ran, randomBytes);
+    } while (ecRandomFromBytes(curve, d, ran, randomBytes) < 0);
+
     return 0;
 }
 
@@ -1035,35 +1819,40 @@ static int ecGenerateRandomNumber3617(const EcCurve *curve, BigNum *d)
 {
     unsigned char random[52];
     _random(random, 52);
-
-    /* prepare the secret random data: clear bottom 3 bits. Clearing top 2 bits
-     * makes is a 414 bit value
-     */
-    random[51] &= ~0x7;
-    random[0] &= 0x3f;
-    /* convert the random data into big numbers */
-    bnInsertBigBytes(d, random, 0, 52);
-    return 0;
+    return ecRandomFromBytes(curve, d, random, 52);
 }
 
 static int ecGenerateRandomNumber25519(const EcCurve *curve, BigNum *d)
 {
     unsigned char random[32];
     _random(random, 32);
+    return ecRandomFromBytes(curve, d, random, 32);
+}
 
-    // Same as in curve25519_donna, thus a no-op there if this function generates the secret.
-    random[0] &= 248;
-    random[31] &= 127;
-    random[31] |= 64;
+int ecGenerateRandomNumberBatch(const EcCurve *curve, BigNum *d, int count)
+{
+    size_t randomBytes = ecRandomBytes(curve);
+    unsigned char *ran;
+    int i;
 
-    /* No specific preparation. The curve25519_donna functions prepares the data.
-     *
-     * convert the random data into big numbers. the bigNumber is a container only.
-     * we don not use the big number for any arithmetic
-     */
-    bnInsertLittleBytes(d, random, 0, 32);
-    return 0;
+    if (count <= 0)
+        return 0;
+    if (randomBytes > MAX_RANDOM_BYTES)
+        return -1;
+
+    ran = (unsigned char *)zrtpAlloc(randomBytes * count);
+    if (ran == NULL)
+        return -1;
 
+    /* One call of the random generator for all numbers */
+    _random(ran, randomBytes * count);
+    for (i = 0; i < count; i++) {
+        if (ecRandomFromBytes(curve, &d[i], ran + i * randomBytes, randomBytes) < 0)
+            ecGenerateRandomNumber(curve, &d[i]);
+    }
+    ecWipeRandom(ran, randomBytes * count);
+    zrtpFree(ran, randomBytes * count);
+    return 0;
 }
 
 int ecCheckPubKey(const EcCurve *curve, const EcPoint *pub)
@@ -1071,6 +1860,15 @@ int ecCheckPubKey(const EcCurve *curve, const EcPoint *pub)
     return curve->checkPubOp(curve, pub);
 }
 
+int ecCheckPubKeyBytes(Curves curveId, const unsigned char *x, const unsigned char *y, int len)
+{
+    const EcField *field = ecGetField(curveId);
+
+    if (field == NULL)
+        return -1;
+    return ecFieldCheckPoint(field, x, y, len);
+}
+
 static int ecCheckPubKeyNist(const NistECpCurve *curve, const EcPoint *pub)
 {
     /* Represent point at infinity by (0, 0), make sure it's not that */
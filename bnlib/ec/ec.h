@@ -138,6 +138,11 @@ extern void ecSetBasePoint(EcCurve *C, EcPoint *P);
  *                 Before reusing a EC curve structure make sure to call ecFreeCurveNistECp
  *                 to return memory.
  *
+ *                 The library parses the parameters of a curve type once, all curve
+ *                 structures of this type point to the same read-only parameters. Each
+ *                 curve structure has its own scratch pad variables, thus different threads
+ *                 may use different curve structures of the same type at the same time.
+ *
  * \param curveId  Which curve to initialize
  *
  * \param curve    Pointer to a EcCurve structure
@@ -201,6 +206,44 @@ int ecAddPoint(const EcCurve *curve, EcPoint *R, const EcPoint *P, const EcPoint
  */
 int ecMulPointScalar(const EcCurve *curve, EcPoint *R, const EcPoint *P, const BigNum *scalar);
 
+/**
+ * \brief          Mulitply an EC point with a scalar value, point and result as bytes.
+ *
+ *                 The function uses the fixed width field elements of the NIST P-256 and
+ *                 P-384 curves and of curve 3617 from the input coordinates to the affine
+ *                 result, it does not convert the point to or from BigNums.
+ *
+ * \param          curve  Address of EC curve structure
+ * \param          x      Receives the x coordinate of the affine result, big endian, len bytes
+ * \param          y      Receives the y coordinate of the affine result, may be NULL
+ * \param          px     The affine x coordinate of the point, big endian, len bytes
+ * \param          py     The affine y coordinate of the point, big endian, len bytes
+ * \param          len    Length of each coordinate in bytes
+ * \param          scalar Address of the scalar multi-precision integer value
+ *
+ * \return         0 if successful, -1 if the curve has no fixed width field or a coordinate
+ *                 is not smaller than p
+ */
+int ecMulPointScalarBytes(const EcCurve *curve, unsigned char *x, unsigned char *y,
+                          const unsigned char *px, const unsigned char *py, int len, const BigNum *scalar);
+
+/**
+ * \brief          Mulitply the curve's base point with a scalar value.
+ *
+ *                 For the NIST curves and curve 3617 the function uses a precomputed comb
+ *                 table of the base point, computed once per curve type when the application
+ *                 initializes the first curve structure of this type. This is much faster than
+ *                 ecMulPointScalar with the base point. For other curves the function calls
+ *                 ecMulPointScalar.
+ *
+ * \param          curve  Address of EC curve structure
+ * \param          R      Address of resulting EC point structure
+ * \param          scalar Address of the scalar multi-precision integer value
+ *
+ * \return         0 if successful
+ */
+int ecMulBasePointScalar(const EcCurve *curve, EcPoint *R, const BigNum *scalar);
+
 /**
  * \brief          Convert an EC point from Jacobian projective coordinates to normal affine x/y coordinates.
  *
@@ -212,6 +255,23 @@ int ecMulPointScalar(const EcCurve *curve, EcPoint *R, const EcPoint *P, const B
  */
 int ecGetAffine(const EcCurve *curve, EcPoint *R, const EcPoint *P);
 
+/**
+ * \brief          Convert an array of EC points to affine x/y coordinates.
+ *
+ *                 For the curves with fixed width field arithmetic (P-256, P-384, curve 3617)
+ *                 the function uses Montgomery's simultaneous inversion, one inversion for
+ *                 a batch of points instead of one inversion per point. Use it to normalize
+ *                 precomputed tables or many public keys. Other curves convert each point
+ *                 with ecGetAffine.
+ *
+ * \param          curve      Address of EC curve structure
+ * \param          points     Array of EC points, the function converts them in place
+ * \param          numPoints  Number of points in the array
+ *
+ * \return         0 if successful
+ */
+int ecGetAffineBatch(const EcCurve *curve, EcPoint *points, int numPoints);
+
 /**
  * @brief Generate a random number.
  *
@@ -226,6 +286,22 @@ int ecGetAffine(const EcCurve *curve, EcPoint *R, const EcPoint *P);
  */
 int ecGenerateRandomNumber(const NistECpCurve *curve, BigNum *d);
 
+/**
+ * @brief Generate several random numbers.
+ *
+ * The method works like @c ecGenerateRandomNumber but draws the random data of all
+ * numbers with one call of the random generator.
+ *
+ * @param curve the curve to use.
+ *
+ * @param d array of @c count BigNums, receives the generated random numbers.
+ *
+ * @param count number of random numbers to generate.
+ *
+ * @return 0 if random data generation is OK, <0 in case of an error.
+ */
+int ecGenerateRandomNumberBatch(const NistECpCurve *curve, BigNum *d, int count);
+
 /**
  * @brief Check a public key.
  *
@@ -245,6 +321,26 @@ int ecGenerateRandomNumber(const NistECpCurve *curve, BigNum *d);
  */
 int ecCheckPubKey(const EcCurve *curve, const EcPoint *pub);
 
+/**
+ * @brief Check a public key that is given as big endian bytes.
+ *
+ * The function performs the same checks as @c ecCheckPubKey with the fixed width
+ * field arithmetic of the curve. It does not allocate memory, does not need the
+ * curve parameters and its run time does not depend on the public key.
+ *
+ * @param curveId the curve to use.
+ *
+ * @param x the x coordinate, big endian bytes.
+ *
+ * @param y the y coordinate, big endian bytes.
+ *
+ * @param len length of each coordinate in bytes.
+ *
+ * @returns 1 if the check was ok, 0 if it failed, -1 if the curve has no fixed
+ *          width field arithmetic.
+ */
+int ecCheckPubKeyBytes(Curves curveId, const unsigned char *x, const unsigned char *y, int len);
+
 int ecGetCurvesCurve(Curves curveId, EcCurve *curve);
 
 void ecFreeCurvesCurve(EcCurve *curve);
@@ -252,9 +348,23 @@ void ecFreeCurvesCurve(EcCurve *curve);
 /**
  * This is a special function for DJB's curve 25519. Actually it's the scalar multiplication
  * mypublic = basepoint * secret
+ *
+ * All data are 32 byte arrays in little endian format. Callers that use the byte arrays
+ * directly avoid the BigNum conversions of ecMulPointScalar(). The implementation uses
+ * 51 bit limbs if the compiler supports a 128 bit integer type, 25.5 bit limbs otherwise.
  */
 int curve25519_donna(unsigned char *mypublic, const unsigned char *secret, const unsigned char *basepoint);
 
+/**
+ * Curve 25519 public key: mypublic = 9 * secret, the same result as curve25519_donna()
+ * with the base point 9.
+ *
+ * The 64 bit implementation computes the product on the birationally equivalent
+ * Edwards25519 curve with a table of precomputed base point multiples, several times
+ * faster than the Montgomery ladder. It runs in constant time as the ladder does.
+ */
+int curve25519_donna_basepoint(unsigned char *mypublic, const unsigned char *secret);
+
 /*
  * Some additional functions that are not available in bnlib
  */
@@ -14,22 +14,39 @@
  * limitations under the License.
  */
 
+#include <stddef.h>
+
 #include <ec/ec.h>
 #include <ec/ecdh.h>
 
 int ecdhGeneratePublic(const EcCurve *curve, EcPoint *Q, const BigNum *d)
 {
-    EcPoint G;
+    ecMulBasePointScalar(curve, Q, d);
+    ecGetAffine(curve, Q, Q);
+
+    return ecCheckPubKey(curve, Q);
+}
 
-    INIT_EC_POINT(&G);
-    SET_EC_BASE_POINT(curve, &G);
+int ecdhGeneratePublicBatch(const EcCurve *curve, int count, EcPoint *Q, BigNum *d)
+{
+    int i;
 
-    ecMulPointScalar(curve, Q, &G, d);
-    ecGetAffine(curve, Q, Q);
+    if (ecGenerateRandomNumberBatch(curve, d, count) < 0)
+        return 0;
 
-    FREE_EC_POINT(&G);
+    for (i = 0; i < count; i++)
+        ecMulBasePointScalar(curve, &Q[i], &d[i]);
+    ecGetAffineBatch(curve, Q, count);
 
-    return ecCheckPubKey(curve, Q);
+    /* Replace the rare invalid keys, same as the single key generation */
+    for (i = 0; i < count; i++) {
+        while (!ecCheckPubKey(curve, &Q[i])) {
+            ecGenerateRandomNumber(curve, &d[i]);
+            ecMulBasePointScalar(curve, &Q[i], &d[i]);
+            ecGetAffine(curve, &Q[i], &Q[i]);
+        }
+    }
+    return 1;
 }
 
 int ecdhComputeAgreement(const EcCurve *curve, BigNum *agreement, const EcPoint *Q, const BigNum *d)
@@ -48,3 +65,27 @@ int ecdhComputeAgreement(const EcCurve *curve, BigNum *agreement, const EcPoint
 
     return 0;
 }
+
+int ecdhComputeAgreementBytes(const EcCurve *curve, unsigned char *agreement, const unsigned char *Q,
+                              int len, const BigNum *d)
+{
+    EcPoint pub;
+    BigNum sec;
+
+    if (ecMulPointScalarBytes(curve, agreement, NULL, Q, Q + len, len, d) == 0)
+        return 0;
+
+    /* Curves without fixed width field */
+    bnBegin(&sec);
+    INIT_EC_POINT(&pub);
+    bnSetQ(pub.z, 1);
+    bnInsertBigBytes(pub.x, Q, 0, len);
+    bnInsertBigBytes(pub.y, Q + len, 0, len);
+
+    ecdhComputeAgreement(curve, &sec, &pub, d);
+    bnExtractBigBytes(&sec, agreement, 0, len);
+
+    bnEnd(&sec);
+    FREE_EC_POINT(&pub);
+    return 0;
+}
@@ -43,6 +43,27 @@ extern "C"
  */
 int ecdhGeneratePublic(const EcCurve *curve, EcPoint *Q, const BigNum *d);
 
+/**
+ * @brief Generates several ephemeral key pairs.
+ *
+ * The function draws the secret random numbers of all keys with one call of
+ * the random generator, computes the public points with the comb table of the
+ * curve and converts all points to affine coordinates with one simultaneous
+ * inversion, see @c ecGetAffineBatch. It replaces the rare keys that fail the
+ * public key check, as a caller of @c ecdhGeneratePublic does.
+ *
+ * @param curve is the curve to use.
+ *
+ * @param count number of key pairs to generate.
+ *
+ * @param Q array of @c count points, receives the public points.
+ *
+ * @param d array of @c count BigNums, receives the secret random numbers.
+ *
+ * @return @c true (!0) if the key pairs were generated, @c false otherwise.
+ */
+int ecdhGeneratePublicBatch(const EcCurve *curve, int count, EcPoint *Q, BigNum *d);
+
 /**
  * @brief Computes the key agreement value.
  *
@@ -60,6 +81,27 @@ int ecdhGeneratePublic(const EcCurve *curve, EcPoint *Q, const BigNum *d);
  */
 int ecdhComputeAgreement(const EcCurve *curve, BigNum *agreement, const EcPoint *Q, const BigNum *d);
 
+/**
+ * @brief Computes the key agreement value, public key and agreed value as bytes.
+ *
+ * Same as @c ecdhComputeAgreement, the other party's public point is given by the
+ * big endian coordinates x || y. For the curves with fixed width field
+ * elements the public point does not go through BigNums.
+ *
+ * @param curve is the curve to use, must be the same curve as used in
+ *              @c ecdhGeneratePublic.
+ *
+ * @param agreement the functions writes the agreed value in this buffer, len bytes.
+ *
+ * @param Q is the other party's public point, 2 * len bytes.
+ *
+ * @param len is the length of a coordinate in bytes.
+ *
+ * @param d is the secret random number.
+ */
+int ecdhComputeAgreementBytes(const EcCurve *curve, unsigned char *agreement, const unsigned char *Q,
+                              int len, const BigNum *d);
+
 #ifdef __cplusplus
 }
 #endif
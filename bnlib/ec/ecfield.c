@@ -0,0 +1,909 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Fixed width field arithmetic for the NIST P-256 and P-384 curves and for
+ * Curve41417 (Curve3617).
+ *
+ * The reduction functions use the special form of the NIST primes (Solinas
+ * primes, see FIPS 186-3, D.2). They split the double width product into 32 bit
+ * words and fold the high words into the low words. The Curve41417 prime
+ * p = 2^414 - 17 folds the bits above bit 414 with a multiplication by 17.
+ */
+
+#include <string.h>
+
+#include <bn.h>
+#include <ec/ecfield.h>
+
+struct _EcField {
+    int limbs;
+    const uint64_t *p;
+    const uint64_t *d;                  /* Edwards curve parameter d, NULL for the NIST curves */
+    const uint64_t *b;                  /* NIST curve parameter b, NULL for Curve41417 */
+    void (*reduce)(uint64_t *r, const uint64_t *t);
+    void (*doublePoint)(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P);
+    void (*addPoint)(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P, const EcFieldPoint *Q);
+    void (*negatePoint)(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P);
+    void (*setNeutral)(const EcField *f, EcFieldPoint *R);
+};
+
+static void reduce256(uint64_t *r, const uint64_t *t);
+static void reduce384(uint64_t *r, const uint64_t *t);
+static void reduce41417(uint64_t *r, const uint64_t *t);
+
+static void doublePointJacobian(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P);
+static void addPointJacobian(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P, const EcFieldPoint *Q);
+static void negatePointJacobian(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P);
+static void setInfinity(const EcField *f, EcFieldPoint *R);
+
+static void doublePointEd(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P);
+static void addPointEd(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P, const EcFieldPoint *Q);
+static void negatePointEd(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P);
+static void setNeutralEd(const EcField *f, EcFieldPoint *R);
+
+/* p = 2^256 - 2^224 + 2^192 + 2^96 - 1 */
+static const uint64_t prime256[4] = {
+    0xffffffffffffffffULL, 0x00000000ffffffffULL, 0x0000000000000000ULL, 0xffffffff00000001ULL
+};
+
+static const uint64_t b256[4] = {
+    0x3bce3c3e27d2604bULL, 0x651d06b0cc53b0f6ULL, 0xb3ebbd55769886bcULL, 0x5ac635d8aa3a93e7ULL
+};
+
+/* p = 2^384 - 2^128 - 2^96 + 2^32 - 1 */
+static const uint64_t prime384[6] = {
+    0x00000000ffffffffULL, 0xffffffff00000000ULL, 0xfffffffffffffffeULL,
+    0xffffffffffffffffULL, 0xffffffffffffffffULL, 0xffffffffffffffffULL
+};
+
+static const uint64_t b384[6] = {
+    0x2a85c8edd3ec2aefULL, 0xc656398d8a2ed19dULL, 0x0314088f5013875aULL,
+    0x181d9c6efe814112ULL, 0x988e056be3f82d19ULL, 0xb3312fa7e23ee7e4ULL
+};
+
+/* p = 2^414 - 17 */
+static const uint64_t prime41417[7] = {
+    0xffffffffffffffefULL, 0xffffffffffffffffULL, 0xffffffffffffffffULL, 0xffffffffffffffffULL,
+    0xffffffffffffffffULL, 0xffffffffffffffffULL, 0x000000003fffffffULL
+};
+
+/* x^2 + y^2 = 1 + 3617 x^2 y^2 */
+static const uint64_t d41417[7] = { 3617, 0, 0, 0, 0, 0, 0 };
+
+static const EcField field256 = { 4, prime256, NULL, b256, reduce256,
+                                  doublePointJacobian, addPointJacobian, negatePointJacobian, setInfinity };
+static const EcField field384 = { 6, prime384, NULL, b384, reduce384,
+                                  doublePointJacobian, addPointJacobian, negatePointJacobian, setInfinity };
+static const EcField field41417 = { 7, prime41417, d41417, NULL, reduce41417,
+                                    doublePointEd, addPointEd, negatePointEd, setNeutralEd };
+
+const EcField *ecGetField(Curves curveId)
+{
+    switch (curveId) {
+    case NIST256P:
+        return &field256;
+
+    case NIST384P:
+        return &field384;
+
+    case Curve3617:
+        return &field41417;
+
+    default:
+        return NULL;
+    }
+}
+
+/*
+ * Limb helper functions
+ */
+
+/* Compute a * b + add + carry, the result always fits into 128 bits */
+static inline void mulAdd(uint64_t a, uint64_t b, uint64_t add, uint64_t carry, uint64_t *lo, uint64_t *hi)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 t = (unsigned __int128)a * b + add + carry;
+    *lo = (uint64_t)t;
+    *hi = (uint64_t)(t >> 64);
+#else
+    uint64_t a0 = a & 0xffffffff, a1 = a >> 32;
+    uint64_t b0 = b & 0xffffffff, b1 = b >> 32;
+    uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    uint64_t mid = (p00 >> 32) + (p01 & 0xffffffff) + (p10 & 0xffffffff);
+    uint64_t l = (mid << 32) | (p00 & 0xffffffff);
+    uint64_t h = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+
+    l += add;
+    h += l < add;
+    l += carry;
+    h += l < carry;
+    *lo = l;
+    *hi = h;
+#endif
+}
+
+static inline uint64_t addCarry(uint64_t a, uint64_t b, uint64_t *carry)
+{
+    uint64_t s = a + b;
+    uint64_t c = s < a;
+    uint64_t r = s + *carry;
+
+    c |= r < s;
+    *carry = c;
+    return r;
+}
+
+static inline uint64_t subBorrow(uint64_t a, uint64_t b, uint64_t *borrow)
+{
+    uint64_t d = a - b;
+    uint64_t bw = a < b;
+    uint64_t r = d - *borrow;
+
+    bw |= d < *borrow;
+    *borrow = bw;
+    return r;
+}
+
+/*
+ * Propagate the carries of signed 32 bit word accumulators, return the final carry.
+ *
+ * After the function returns each accumulator contains a value 0 <= acc < 2^32.
+ */
+static int64_t propagate(int64_t *acc, int words)
+{
+    int64_t carry = 0;
+    int i;
+
+    for (i = 0; i < words; i++) {
+        int64_t v = acc[i] + carry;
+        int64_t low = v & 0xffffffff;
+
+        carry = (v - low) / ((int64_t)1 << 32);  /* exact division, no rounding */
+        acc[i] = low;
+    }
+    return carry;
+}
+
+/* r = a - p if a >= p, a < 2p */
+static void condSubPrime(const EcField *f, uint64_t *r, const uint64_t *a, uint64_t carry)
+{
+    uint64_t t[EC_FIELD_MAX_LIMBS];
+    uint64_t borrow = 0;
+    uint64_t mask;
+    int i;
+
+    for (i = 0; i < f->limbs; i++)
+        t[i] = subBorrow(a[i], f->p[i], &borrow);
+
+    /* keep a if there was no carry out of a and a borrow occured */
+    mask = 0 - ((1 ^ carry) & borrow);
+    for (i = 0; i < f->limbs; i++)
+        r[i] = (a[i] & mask) | (t[i] & ~mask);
+}
+
+static void packWords(uint64_t *r, const int64_t *acc, int limbs)
+{
+    int i;
+
+    for (i = 0; i < limbs; i++)
+        r[i] = (uint64_t)acc[2*i] | ((uint64_t)acc[2*i + 1] << 32);
+}
+
+static void unpackWords(int64_t *acc, const uint64_t *t, int limbs)
+{
+    int i;
+
+    for (i = 0; i < limbs; i++) {
+        acc[2*i] = (int64_t)(t[i] & 0xffffffff);
+        acc[2*i + 1] = (int64_t)(t[i] >> 32);
+    }
+}
+
+/*
+ * P-256: 2^256 = 2^224 - 2^192 - 2^96 + 1 mod p
+ *
+ * A word at position k >= 8 (value A * 2^(32*k)) folds into the positions k-8 (+A),
+ * k-5 (-A), k-2 (-A) and k-1 (+A). Folding from the highest word downwards also
+ * folds the values that move into positions >= 8.
+ */
+static void reduce256(uint64_t *r, const uint64_t *t)
+{
+    int64_t acc[16];
+    int64_t c;
+    int k;
+
+    unpackWords(acc, t, 8);
+
+    for (k = 15; k >= 8; k--) {
+        int64_t v = acc[k];
+        acc[k-8] += v;
+        acc[k-5] -= v;
+        acc[k-2] -= v;
+        acc[k-1] += v;
+    }
+    c = propagate(acc, 8);
+
+    /* The first fold of the carry leaves a carry of -1, 0, or 1, the second fold clears it */
+    for (k = 0; k < 2; k++) {
+        acc[0] += c;
+        acc[3] -= c;
+        acc[6] -= c;
+        acc[7] += c;
+        c = propagate(acc, 8);
+    }
+    packWords(r, acc, 4);
+    condSubPrime(&field256, r, r, 0);
+}
+
+/*
+ * P-384: 2^384 = 2^128 + 2^96 - 2^32 + 1 mod p
+ *
+ * A word at position k >= 12 folds into the positions k-12 (+A), k-11 (-A),
+ * k-9 (+A) and k-8 (+A).
+ */
+static void reduce384(uint64_t *r, const uint64_t *t)
+{
+    int64_t acc[24];
+    int64_t c;
+    int k;
+
+    unpackWords(acc, t, 12);
+
+    for (k = 23; k >= 12; k--) {
+        int64_t v = acc[k];
+        acc[k-12] += v;
+        acc[k-11] -= v;
+        acc[k-9] += v;
+        acc[k-8] += v;
+    }
+    c = propagate(acc, 12);
+
+    for (k = 0; k < 2; k++) {
+        acc[0] += c;
+        acc[1] -= c;
+        acc[3] += c;
+        acc[4] += c;
+        c = propagate(acc, 12);
+    }
+    packWords(r, acc, 6);
+    condSubPrime(&field384, r, r, 0);
+}
+
+/*
+ * Curve41417: 2^414 = 17 mod p
+ *
+ * The function splits the product at bit 414, t = H * 2^414 + L = L + 17 * H mod p.
+ * A second fold of the few bits above bit 414 and a conditional subtraction of p
+ * give the fully reduced result. The product of two field elements is smaller than
+ * 2^828, thus the high part H fits into 7 limbs.
+ */
+static void reduce41417(uint64_t *r, const uint64_t *t)
+{
+    uint64_t h[7], s[7];
+    uint64_t high, carry, mask;
+    int i;
+
+    for (i = 0; i < 7; i++)
+        h[i] = (t[6 + i] >> 30) | (t[7 + i] << 34);
+    for (i = 0; i < 6; i++)
+        r[i] = t[i];
+    r[6] = t[6] & 0x3fffffff;
+
+    /* r = L + 17 * H < 2^419 */
+    carry = 0;
+    for (i = 0; i < 7; i++)
+        mulAdd(h[i], 17, r[i], carry, &r[i], &carry);
+
+    /* fold the bits above bit 414 again, r < 2^414 + 2^11 */
+    high = (r[6] >> 30) | (carry << 34);
+    r[6] &= 0x3fffffff;
+    mulAdd(high, 17, r[0], 0, &r[0], &carry);
+    for (i = 1; i < 7; i++)
+        r[i] = addCarry(r[i], 0, &carry);
+
+    /* r - p = r + 17 - 2^414, use it if r + 17 has bit 414 set */
+    carry = 0;
+    s[0] = addCarry(r[0], 17, &carry);
+    for (i = 1; i < 7; i++)
+        s[i] = addCarry(r[i], 0, &carry);
+    mask = 0 - (s[6] >> 30);
+    s[6] &= 0x3fffffff;
+    for (i = 0; i < 7; i++)
+        r[i] = (s[i] & mask) | (r[i] & ~mask);
+}
+
+/*
+ * Field functions, all results are fully reduced
+ */
+
+static void feMul(const EcField *f, uint64_t *r, const uint64_t *a, const uint64_t *b)
+{
+    uint64_t t[2 * EC_FIELD_MAX_LIMBS];
+    uint64_t carry;
+    int i, j;
+
+    for (i = 0; i < 2 * f->limbs; i++)
+        t[i] = 0;
+
+    for (i = 0; i < f->limbs; i++) {
+        carry = 0;
+        for (j = 0; j < f->limbs; j++)
+            mulAdd(a[i], b[j], t[i+j], carry, &t[i+j], &carry);
+        t[i + f->limbs] = carry;
+    }
+    f->reduce(r, t);
+}
+
+static void feAdd(const EcField *f, uint64_t *r, const uint64_t *a, const uint64_t *b)
+{
+    uint64_t carry = 0;
+    int i;
+
+    for (i = 0; i < f->limbs; i++)
+        r[i] = addCarry(a[i], b[i], &carry);
+    condSubPrime(f, r, r, carry);
+}
+
+static void feSub(const EcField *f, uint64_t *r, const uint64_t *a, const uint64_t *b)
+{
+    uint64_t borrow = 0;
+    uint64_t carry = 0;
+    uint64_t mask;
+    int i;
+
+    for (i = 0; i < f->limbs; i++)
+        r[i] = subBorrow(a[i], b[i], &borrow);
+
+    /* add p if the result is negative */
+    mask = 0 - borrow;
+    for (i = 0; i < f->limbs; i++)
+        r[i] = addCarry(r[i], f->p[i] & mask, &carry);
+}
+
+static void feCopy(const EcField *f, uint64_t *r, const uint64_t *a)
+{
+    memcpy(r, a, f->limbs * sizeof(uint64_t));
+}
+
+static int feIsZero(const EcField *f, const uint64_t *a)
+{
+    uint64_t bits = 0;
+    int i;
+
+    for (i = 0; i < f->limbs; i++)
+        bits |= a[i];
+    return bits == 0;
+}
+
+static int feIsOne(const EcField *f, const uint64_t *a)
+{
+    uint64_t bits = a[0] ^ 1;
+    int i;
+
+    for (i = 1; i < f->limbs; i++)
+        bits |= a[i];
+    return bits == 0;
+}
+
+static void feSetSmall(const EcField *f, uint64_t *r, uint64_t value)
+{
+    memset(r, 0, f->limbs * sizeof(uint64_t));
+    r[0] = value;
+}
+
+static void setInfinity(const EcField *f, EcFieldPoint *R)
+{
+    feSetSmall(f, R->x, 1);
+    feSetSmall(f, R->y, 1);
+    feSetSmall(f, R->z, 0);
+}
+
+/*
+ * Conversion functions
+ */
+
+int ecFieldFromBigNum(const EcField *f, uint64_t *r, const BigNum *a)
+{
+    unsigned char buffer[EC_FIELD_MAX_LIMBS * 8];
+    uint64_t t[2 * EC_FIELD_MAX_LIMBS];
+    int i, j;
+
+    if (bnBits(a) > (unsigned)(f->limbs * 64))
+        return -1;
+
+    bnExtractLittleBytes(a, buffer, 0, f->limbs * 8);
+    for (i = 0; i < f->limbs; i++) {
+        uint64_t limb = 0;
+        for (j = 7; j >= 0; j--)
+            limb = (limb << 8) | buffer[i*8 + j];
+        t[i] = limb;
+        t[i + f->limbs] = 0;
+    }
+    /* a < 2^(64*limbs), the reduction of a double width value reduces it modulo p */
+    f->reduce(r, t);
+    return 0;
+}
+
+void ecFieldToBigNum(const EcField *f, BigNum *r, const uint64_t *a)
+{
+    unsigned char buffer[EC_FIELD_MAX_LIMBS * 8];
+    int i, j;
+
+    for (i = 0; i < f->limbs; i++) {
+        for (j = 0; j < 8; j++)
+            buffer[i*8 + j] = (unsigned char)(a[i] >> (8 * j));
+    }
+    /* bnInsertLittleBytes does not clear higher words of r */
+    bnSetQ(r, 0);
+    bnInsertLittleBytes(r, buffer, 0, f->limbs * 8);
+}
+
+/*
+ * Convert big endian bytes into limbs, return an all ones mask if the value is
+ * smaller than p. The function sets r to zero if the value is not smaller than p,
+ * thus the field functions always get valid field elements.
+ */
+static uint64_t feFromBytes(const EcField *f, uint64_t *r, const unsigned char *bytes, int len)
+{
+    uint64_t borrow = 0;
+    uint64_t mask;
+    int i;
+
+    memset(r, 0, f->limbs * sizeof(uint64_t));
+    for (i = 0; i < len; i++) {
+        int pos = len - 1 - i;
+        r[pos / 8] |= (uint64_t)bytes[i] << (8 * (pos % 8));
+    }
+    for (i = 0; i < f->limbs; i++)
+        (void)subBorrow(r[i], f->p[i], &borrow);
+
+    /* a borrow occured if r < p */
+    mask = 0 - borrow;
+    for (i = 0; i < f->limbs; i++)
+        r[i] &= mask;
+    return mask;
+}
+
+int ecFieldFromBytes(const EcField *f, uint64_t *r, const unsigned char *bytes, int len)
+{
+    if (len <= 0 || len > f->limbs * 8) {
+        memset(r, 0, f->limbs * sizeof(uint64_t));
+        return -1;
+    }
+    return feFromBytes(f, r, bytes, len) != 0 ? 0 : -1;
+}
+
+void ecFieldToBytes(const EcField *f, unsigned char *bytes, int len, const uint64_t *a)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        int pos = len - 1 - i;
+        bytes[i] = pos < f->limbs * 8 ? (unsigned char)(a[pos / 8] >> (8 * (pos % 8))) : 0;
+    }
+}
+
+int ecFieldCheckPoint(const EcField *f, const unsigned char *x, const unsigned char *y, int len)
+{
+    uint64_t px[EC_FIELD_MAX_LIMBS], py[EC_FIELD_MAX_LIMBS];
+    uint64_t t1[EC_FIELD_MAX_LIMBS], t2[EC_FIELD_MAX_LIMBS], t3[EC_FIELD_MAX_LIMBS];
+    uint64_t valid, bits;
+    int i;
+
+    if (len <= 0 || len > f->limbs * 8)
+        return 0;
+
+    valid = feFromBytes(f, px, x, len);
+    valid &= feFromBytes(f, py, y, len);
+
+    /* (0, 0) represents the point at infinity */
+    bits = 0;
+    for (i = 0; i < f->limbs; i++)
+        bits |= px[i] | py[i];
+    valid &= 0 - ((bits | (0 - bits)) >> 63);
+
+    feMul(f, t1, py, py);                       /* t1 = y^2 */
+    feMul(f, t2, px, px);                       /* t2 = x^2 */
+    if (f->d == NULL) {
+        /* y^2 = x^3 - 3x + b */
+        feSetSmall(f, t3, 3);
+        feSub(f, t2, t2, t3);                   /* t2 = x^2 - 3 */
+        feMul(f, t2, t2, px);                   /* t2 = x^3 - 3x */
+        feAdd(f, t2, t2, f->b);                 /* t2 = x^3 - 3x + b */
+    }
+    else {
+        /* x^2 + y^2 = 1 + d x^2 y^2 */
+        feAdd(f, t3, t1, t2);                   /* t3 = x^2 + y^2 */
+        feMul(f, t2, t2, t1);                   /* t2 = x^2 y^2 */
+        feMul(f, t2, t2, f->d);                 /* t2 = d x^2 y^2 */
+        feSetSmall(f, t1, 1);
+        feAdd(f, t2, t2, t1);                   /* t2 = 1 + d x^2 y^2 */
+        feCopy(f, t1, t3);
+    }
+    /* all results are fully reduced, equal elements have equal limbs */
+    bits = 0;
+    for (i = 0; i < f->limbs; i++)
+        bits |= t1[i] ^ t2[i];
+    valid &= ((bits | (0 - bits)) >> 63) - 1;
+
+    return (int)(valid & 1);
+}
+
+/*
+ * Point functions, the field selects the coordinate system
+ */
+
+void ecFieldDoublePoint(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P)
+{
+    f->doublePoint(f, R, P);
+}
+
+void ecFieldAddPoint(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P, const EcFieldPoint *Q)
+{
+    f->addPoint(f, R, P, Q);
+}
+
+void ecFieldNegatePoint(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P)
+{
+    f->negatePoint(f, R, P);
+}
+
+void ecFieldSetNeutral(const EcField *f, EcFieldPoint *R)
+{
+    f->setNeutral(f, R);
+}
+
+void ecFieldSelectPoint(const EcField *f, EcFieldPoint *R, const EcFieldPoint *table, int numPoints, int index)
+{
+    uint64_t mask;
+    int i, k;
+
+    memset(R, 0, sizeof(EcFieldPoint));
+    for (k = 0; k < numPoints; k++) {
+        /* mask is all ones if k == index, zero otherwise */
+        mask = 0 - (((uint64_t)(uint32_t)(k ^ index) - 1) >> 63);
+        for (i = 0; i < f->limbs; i++) {
+            R->x[i] |= table[k].x[i] & mask;
+            R->y[i] |= table[k].y[i] & mask;
+            R->z[i] |= table[k].z[i] & mask;
+        }
+    }
+}
+
+/*
+ * Inversion and affine coordinates
+ */
+
+/*
+ * r = a^(p-2) = a^-1 mod p (Fermat's little theorem), r = 0 if a = 0. The exponent is
+ * public, the function uses a fixed window of 4 bits, thus the sequence of field
+ * operations depends only on p.
+ */
+void ecFieldInvert(const EcField *f, uint64_t *r, const uint64_t *a)
+{
+    uint64_t table[16][EC_FIELD_MAX_LIMBS];
+    uint64_t e[EC_FIELD_MAX_LIMBS];
+    uint64_t t[EC_FIELD_MAX_LIMBS];
+    int started = 0;
+    int i, j, w;
+
+    /* the low limbs of the primes are >= 2, no borrow */
+    feCopy(f, e, f->p);
+    e[0] -= 2;
+
+    /* table[i] = a^i */
+    feSetSmall(f, table[0], 1);
+    feCopy(f, table[1], a);
+    for (i = 2; i < 16; i++)
+        feMul(f, table[i], table[i-1], a);
+
+    for (i = f->limbs * 64 - 4; i >= 0; i -= 4) {
+        w = (int)(e[i / 64] >> (i % 64)) & 15;
+        if (!started) {
+            if (w == 0)
+                continue;
+            feCopy(f, t, table[w]);
+            started = 1;
+            continue;
+        }
+        for (j = 0; j < 4; j++)
+            feMul(f, t, t, t);
+        if (w != 0)
+            feMul(f, t, t, table[w]);
+    }
+    feCopy(f, r, t);
+}
+
+/* Set R to the affine coordinates of P, zi = 1 / Z of P */
+static void setAffine(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P, const uint64_t *zi)
+{
+    uint64_t t[EC_FIELD_MAX_LIMBS];
+
+    if (f->d != NULL) {                         /* Edwards: x = X / Z, y = Y / Z */
+        feMul(f, R->x, P->x, zi);
+        feMul(f, R->y, P->y, zi);
+    }
+    else {                                      /* Jacobian: x = X / Z^2, y = Y / Z^3 */
+        feMul(f, t, zi, zi);
+        feMul(f, R->x, P->x, t);
+        feMul(f, t, t, zi);
+        feMul(f, R->y, P->y, t);
+    }
+    feSetSmall(f, R->z, 1);
+}
+
+void ecFieldGetAffine(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P)
+{
+    uint64_t zi[EC_FIELD_MAX_LIMBS];
+
+    if (feIsZero(f, P->z)) {                    /* the point at infinity has no affine coordinates */
+        if (R != P)
+            *R = *P;
+        return;
+    }
+    ecFieldInvert(f, zi, P->z);
+    setAffine(f, R, P, zi);
+}
+
+/*
+ * Montgomery's trick: with the products acc[i] = Z0 * ... * Zi a single inversion gives
+ * inv = 1 / acc[n-1], then 1 / Zi = inv * acc[i-1] and the inverse of the next shorter
+ * product is inv * Zi. The function needs three multiplications per point and one
+ * inversion per EC_FIELD_BATCH_POINTS points.
+ */
+void ecFieldBatchAffine(const EcField *f, EcFieldPoint *points, int numPoints)
+{
+    uint64_t acc[EC_FIELD_BATCH_POINTS][EC_FIELD_MAX_LIMBS];
+    uint64_t inv[EC_FIELD_MAX_LIMBS], zi[EC_FIELD_MAX_LIMBS], one[EC_FIELD_MAX_LIMBS];
+    EcFieldPoint *pts;
+    int base, n, i;
+
+    feSetSmall(f, one, 1);
+
+    for (base = 0; base < numPoints; base += EC_FIELD_BATCH_POINTS) {
+        pts = points + base;
+        n = numPoints - base;
+        if (n > EC_FIELD_BATCH_POINTS)
+            n = EC_FIELD_BATCH_POINTS;
+
+        /* points at infinity count as 1 and keep their coordinates */
+        for (i = 0; i < n; i++) {
+            const uint64_t *z = feIsZero(f, pts[i].z) ? one : pts[i].z;
+
+            if (i == 0)
+                feCopy(f, acc[0], z);
+            else
+                feMul(f, acc[i], acc[i-1], z);
+        }
+        ecFieldInvert(f, inv, acc[n-1]);
+
+        for (i = n - 1; i >= 0; i--) {
+            if (feIsZero(f, pts[i].z))
+                continue;
+            if (i > 0) {
+                feMul(f, zi, inv, acc[i-1]);
+                feMul(f, inv, inv, pts[i].z);
+            }
+            else
+                feCopy(f, zi, inv);
+            setAffine(f, &pts[i], &pts[i], zi);
+        }
+    }
+}
+
+/*
+ * Jacobian coordinates, same formulas as ecDoublePointNist and ecAddPointNist
+ */
+
+static void doublePointJacobian(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P)
+{
+    uint64_t delta[EC_FIELD_MAX_LIMBS], gamma[EC_FIELD_MAX_LIMBS], beta[EC_FIELD_MAX_LIMBS];
+    uint64_t alpha[EC_FIELD_MAX_LIMBS], t0[EC_FIELD_MAX_LIMBS], t1[EC_FIELD_MAX_LIMBS];
+
+    if (feIsZero(f, P->y) || feIsZero(f, P->z)) {
+        setInfinity(f, R);
+        return;
+    }
+    feMul(f, delta, P->z, P->z);                /* delta = Z^2 */
+    feMul(f, gamma, P->y, P->y);                /* gamma = Y^2 */
+    feMul(f, beta, P->x, gamma);                /* beta = X * gamma */
+
+    feSub(f, t0, P->x, delta);                  /* alpha = 3 * (X - delta) * (X + delta) */
+    feAdd(f, t1, P->x, delta);
+    feMul(f, t0, t0, t1);
+    feAdd(f, alpha, t0, t0);
+    feAdd(f, alpha, alpha, t0);
+
+    feAdd(f, t0, P->y, P->z);                   /* Z' = (Y + Z)^2 - gamma - delta */
+    feMul(f, t0, t0, t0);
+    feSub(f, t0, t0, gamma);
+    feSub(f, R->z, t0, delta);
+
+    feAdd(f, beta, beta, beta);                 /* beta = 4 * beta */
+    feAdd(f, beta, beta, beta);
+    feMul(f, t0, alpha, alpha);                 /* X' = alpha^2 - 8 * beta */
+    feAdd(f, t1, beta, beta);
+    feSub(f, R->x, t0, t1);
+
+    feSub(f, t0, beta, R->x);                   /* Y' = alpha * (4 * beta - X') - 8 * gamma^2 */
+    feMul(f, t0, alpha, t0);
+    feMul(f, t1, gamma, gamma);
+    feAdd(f, t1, t1, t1);
+    feAdd(f, t1, t1, t1);
+    feAdd(f, t1, t1, t1);
+    feSub(f, R->y, t0, t1);
+}
+
+static void addPointJacobian(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P, const EcFieldPoint *Q)
+{
+    uint64_t u1[EC_FIELD_MAX_LIMBS], u2[EC_FIELD_MAX_LIMBS], s1[EC_FIELD_MAX_LIMBS];
+    uint64_t s2[EC_FIELD_MAX_LIMBS], h[EC_FIELD_MAX_LIMBS], r[EC_FIELD_MAX_LIMBS];
+    uint64_t t0[EC_FIELD_MAX_LIMBS], t1[EC_FIELD_MAX_LIMBS];
+
+    /* if P is (@,@), R = Q; if Q is (@,@), R = P */
+    if (feIsZero(f, P->z)) {
+        if (R != Q)
+            *R = *Q;
+        return;
+    }
+    if (feIsZero(f, Q->z)) {
+        if (R != P)
+            *R = *P;
+        return;
+    }
+
+    /* U2 = X2 * Z1^2, S2 = Y2 * Z1^3 */
+    feMul(f, t0, P->z, P->z);
+    feMul(f, u2, Q->x, t0);
+    feMul(f, t0, t0, P->z);
+    feMul(f, s2, Q->y, t0);
+
+    /* U1 = X1 * Z2^2, S1 = Y1 * Z2^3, the points of precomputed tables have Z = 1 */
+    if (feIsOne(f, Q->z)) {
+        feCopy(f, u1, P->x);
+        feCopy(f, s1, P->y);
+    }
+    else {
+        feMul(f, t0, Q->z, Q->z);
+        feMul(f, u1, P->x, t0);
+        feMul(f, t0, t0, Q->z);
+        feMul(f, s1, P->y, t0);
+    }
+    feSub(f, h, u2, u1);                        /* H = U2 - U1 */
+    feSub(f, r, s2, s1);                        /* r = S2 - S1 */
+
+    if (feIsZero(f, h)) {
+        if (feIsZero(f, r))                     /* P == Q */
+            doublePointJacobian(f, R, P);
+        else                                    /* P == -Q */
+            setInfinity(f, R);
+        return;
+    }
+
+    /* Z3 = Z1 * Z2 * H */
+    if (feIsOne(f, Q->z))
+        feMul(f, R->z, P->z, h);
+    else {
+        feMul(f, t0, P->z, Q->z);
+        feMul(f, R->z, t0, h);
+    }
+
+    feMul(f, t0, h, h);                         /* t0 = H^2 */
+    feMul(f, t1, t0, h);                        /* t1 = H^3 */
+    feMul(f, u1, u1, t0);                       /* u1 = U1 * H^2 */
+
+    feMul(f, t0, r, r);                         /* X3 = r^2 - H^3 - 2 * U1 * H^2 */
+    feSub(f, t0, t0, t1);
+    feSub(f, t0, t0, u1);
+    feSub(f, R->x, t0, u1);
+
+    feSub(f, t0, u1, R->x);                     /* Y3 = r * (U1 * H^2 - X3) - S1 * H^3 */
+    feMul(f, t0, r, t0);
+    feMul(f, t1, s1, t1);
+    feSub(f, R->y, t0, t1);
+}
+
+static void negatePointJacobian(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P)
+{
+    uint64_t zero[EC_FIELD_MAX_LIMBS];
+
+    feSetSmall(f, zero, 0);
+    if (R != P) {
+        feCopy(f, R->x, P->x);
+        feCopy(f, R->z, P->z);
+    }
+    feSub(f, R->y, zero, P->y);                 /* -(X, Y, Z) = (X, -Y, Z) */
+}
+
+/*
+ * Projective Edwards coordinates, a = 1, same formulas as ecDoublePointEd and ecAddPointEd.
+ *
+ * The parameter d of Curve41417 is not a square, thus the addition formulas are complete:
+ * they work for all points including the neutral element (0, 1) and P == Q. The functions
+ * have no special cases and the same sequence of field operations for all points.
+ */
+
+static void doublePointEd(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P)
+{
+    uint64_t b[EC_FIELD_MAX_LIMBS], c[EC_FIELD_MAX_LIMBS], d[EC_FIELD_MAX_LIMBS];
+    uint64_t e[EC_FIELD_MAX_LIMBS], h[EC_FIELD_MAX_LIMBS], j[EC_FIELD_MAX_LIMBS];
+
+    feAdd(f, b, P->x, P->y);                    /* B = (X + Y)^2 */
+    feMul(f, b, b, b);
+    feMul(f, c, P->x, P->x);                    /* C = X^2 */
+    feMul(f, d, P->y, P->y);                    /* D = Y^2 */
+    feAdd(f, e, c, d);                          /* E = C + D */
+    feMul(f, h, P->z, P->z);                    /* H = Z^2 */
+    feAdd(f, h, h, h);
+    feSub(f, j, e, h);                          /* J = E - 2H */
+
+    feSub(f, b, b, e);
+    feSub(f, c, c, d);
+    feMul(f, R->x, b, j);                       /* X' = (B - E) * J */
+    feMul(f, R->y, e, c);                       /* Y' = E * (C - D) */
+    feMul(f, R->z, e, j);                       /* Z' = E * J */
+}
+
+static void addPointEd(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P, const EcFieldPoint *Q)
+{
+    uint64_t a[EC_FIELD_MAX_LIMBS], b[EC_FIELD_MAX_LIMBS], c[EC_FIELD_MAX_LIMBS];
+    uint64_t d[EC_FIELD_MAX_LIMBS], e[EC_FIELD_MAX_LIMBS], g[EC_FIELD_MAX_LIMBS];
+    uint64_t t0[EC_FIELD_MAX_LIMBS], t1[EC_FIELD_MAX_LIMBS];
+
+    feMul(f, a, P->z, Q->z);                    /* A = Z1 * Z2 */
+    feMul(f, b, a, a);                          /* B = A^2 */
+    feMul(f, c, P->x, Q->x);                    /* C = X1 * X2 */
+    feMul(f, d, P->y, Q->y);                    /* D = Y1 * Y2 */
+    feMul(f, e, c, d);                          /* E = d * C * D */
+    feMul(f, e, e, f->d);
+
+    feAdd(f, t0, P->x, P->y);                   /* t0 = A * ((X1 + Y1) * (X2 + Y2) - C - D) */
+    feAdd(f, t1, Q->x, Q->y);
+    feMul(f, t0, t0, t1);
+    feSub(f, t0, t0, c);
+    feSub(f, t0, t0, d);
+    feMul(f, t0, t0, a);
+
+    feSub(f, t1, d, c);                         /* t1 = A * (D - C) */
+    feMul(f, t1, t1, a);
+
+    feAdd(f, g, b, e);                          /* G = B + E */
+    feSub(f, b, b, e);                          /* F = B - E */
+
+    feMul(f, R->x, b, t0);                      /* X3 = F * t0 */
+    feMul(f, R->y, g, t1);                      /* Y3 = G * t1 */
+    feMul(f, R->z, b, g);                       /* Z3 = F * G */
+}
+
+static void negatePointEd(const EcField *f, EcFieldPoint *R, const EcFieldPoint *P)
+{
+    uint64_t zero[EC_FIELD_MAX_LIMBS];
+
+    feSetSmall(f, zero, 0);
+    if (R != P) {
+        feCopy(f, R->y, P->y);
+        feCopy(f, R->z, P->z);
+    }
+    feSub(f, R->x, zero, P->x);                 /* -(X, Y, Z) = (-X, Y, Z) */
+}
+
+static void setNeutralEd(const EcField *f, EcFieldPoint *R)
+{
+    feSetSmall(f, R->x, 0);
+    feSetSmall(f, R->y, 1);
+    feSetSmall(f, R->z, 1);
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ECFIELD_H_
+#define _ECFIELD_H_
+
+#include <stdint.h>
+
+#include <ec/ec.h>
+
+/**
+ * @file ecfield.h
+ * @brief Fixed width field arithmetic for the NIST P-256 and P-384 curves and Curve41417
+ *
+ * The functions use arrays of 64 bit limbs, least significant limb first: 4 limbs
+ * for P-256, 6 limbs for P-384, 7 limbs for Curve41417. They do not allocate memory
+ * and contain no branches that depend on the values of the field elements, except
+ * the special cases of the Jacobian point functions (point at infinity, equal points)
+ * that the BigNum functions in ec.c handle the same way. The Edwards point functions
+ * of Curve41417 use complete formulas without special cases.
+ *
+ * These functions are internal to the EC implementation, ec.c uses them for the
+ * Jacobian point doubling and point addition of the P-256 and P-384 curves, for
+ * the projective Edwards point doubling and point addition of Curve41417, and for
+ * the conversion of points to affine coordinates.
+ *
+ * @ingroup BNLIB_EC
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EC_FIELD_MAX_LIMBS  7
+
+/** Number of points that ecFieldBatchAffine converts with one inversion */
+#define EC_FIELD_BATCH_POINTS  32
+
+/**
+ * @brief A point in Jacobian (NIST) or projective Edwards coordinates, using fixed width field elements.
+ */
+typedef struct _EcFieldPoint {
+    uint64_t x[EC_FIELD_MAX_LIMBS];
+    uint64_t y[EC_FIELD_MAX_LIMBS];
+    uint64_t z[EC_FIELD_MAX_LIMBS];
+} EcFieldPoint;
+
+typedef struct _EcField EcField;
+
+/**
+ * @brief Get the fixed width field of a curve.
+ *
+ * @param curveId  The curve identifier
+ *
+ * @return Pointer to the field description, NULL if the curve has no fixed width field.
+ */
+const EcField *ecGetField(Curves curveId);
+
+/**
+ * @brief Convert a BigNum into a field element.
+ *
+ * @param field  The field description
+ * @param r      Receives the field element
+ * @param a      The BigNum, must be smaller than the prime of the field
+ *
+ * @return 0 if successful, -1 if the BigNum is too large for the field
+ */
+int ecFieldFromBigNum(const EcField *field, uint64_t *r, const BigNum *a);
+
+/**
+ * @brief Convert a field element into a BigNum.
+ *
+ * @param field  The field description
+ * @param r      Receives the value
+ * @param a      The field element
+ */
+void ecFieldToBigNum(const EcField *field, BigNum *r, const uint64_t *a);
+
+/**
+ * @brief Convert big endian bytes into a field element.
+ *
+ * @param field  The field description
+ * @param r      Receives the field element, 0 if the value is not smaller than p
+ * @param bytes  The big endian bytes
+ * @param len    Number of bytes, at most 8 bytes per limb
+ *
+ * @return 0 if successful, -1 if the value is not smaller than p
+ */
+int ecFieldFromBytes(const EcField *field, uint64_t *r, const unsigned char *bytes, int len);
+
+/**
+ * @brief Convert a field element into big endian bytes.
+ *
+ * @param field  The field description
+ * @param bytes  Receives the big endian bytes
+ * @param len    Number of bytes, leading zero bytes if the element is shorter
+ * @param a      The field element
+ */
+void ecFieldToBytes(const EcField *field, unsigned char *bytes, int len, const uint64_t *a);
+
+/**
+ * @brief Check if a public key is a valid point of the curve.
+ *
+ * ECC partial validation, NIST SP800-56A, section 5.6.2.6: the point is not the
+ * point at infinity, the coordinates are smaller than p and the point satisfies
+ * the curve equation. The function does not allocate memory and its run time does
+ * not depend on the coordinates.
+ *
+ * @param field  The field description
+ * @param x      The x coordinate, big endian bytes
+ * @param y      The y coordinate, big endian bytes
+ * @param len    Length of each coordinate in bytes
+ *
+ * @return 1 if the point is valid, 0 otherwise
+ */
+int ecFieldCheckPoint(const EcField *field, const unsigned char *x, const unsigned char *y, int len);
+
+/**
+ * @brief Double a point, the parameter <b>a</b> of a NIST curve must be -3.
+ *
+ * @param field  The field description
+ * @param R      Receives the resulting point, may be the same as P
+ * @param P      The point to double
+ */
+void ecFieldDoublePoint(const EcField *field, EcFieldPoint *R, const EcFieldPoint *P);
+
+/**
+ * @brief Add two points.
+ *
+ * @param field  The field description
+ * @param R      Receives the resulting point, may be the same as P or Q
+ * @param P      The first point
+ * @param Q      The second point
+ */
+void ecFieldAddPoint(const EcField *field, EcFieldPoint *R, const EcFieldPoint *P, const EcFieldPoint *Q);
+
+/**
+ * @brief Negate a point.
+ *
+ * @param field  The field description
+ * @param R      Receives the resulting point, may be the same as P
+ * @param P      The point to negate
+ */
+void ecFieldNegatePoint(const EcField *field, EcFieldPoint *R, const EcFieldPoint *P);
+
+/**
+ * @brief Set a point to the neutral element of the curve's group.
+ *
+ * The point at infinity for the NIST curves, (0, 1) for Curve41417.
+ *
+ * @param field  The field description
+ * @param R      Receives the neutral element
+ */
+void ecFieldSetNeutral(const EcField *field, EcFieldPoint *R);
+
+/**
+ * @brief Select a point of a table in constant time.
+ *
+ * The function reads all points of the table, the memory access pattern does not
+ * depend on the index.
+ *
+ * @param field      The field description
+ * @param R          Receives a copy of table[index]
+ * @param table      The table of points
+ * @param numPoints  Number of points in the table
+ * @param index      Index of the point to select, 0 <= index < numPoints
+ */
+void ecFieldSelectPoint(const EcField *field, EcFieldPoint *R, const EcFieldPoint *table, int numPoints, int index);
+
+/**
+ * @brief Compute the inverse of a field element.
+ *
+ * The function computes a^(p-2) mod p with a fixed window, the sequence of field
+ * operations does not depend on the value of a.
+ *
+ * @param field  The field description
+ * @param r      Receives the inverse, 0 if a is 0, may be the same as a
+ * @param a      The field element
+ */
+void ecFieldInvert(const EcField *field, uint64_t *r, const uint64_t *a);
+
+/**
+ * @brief Convert a point to affine coordinates.
+ *
+ * The function converts Jacobian coordinates (NIST) or projective Edwards coordinates
+ * (Curve41417), the result has Z = 1. The point at infinity does not change.
+ *
+ * @param field  The field description
+ * @param R      Receives the affine point, may be the same as P
+ * @param P      The point to convert
+ */
+void ecFieldGetAffine(const EcField *field, EcFieldPoint *R, const EcFieldPoint *P);
+
+/**
+ * @brief Convert an array of points to affine coordinates.
+ *
+ * The function uses Montgomery's simultaneous inversion: it needs one inversion for
+ * up to EC_FIELD_BATCH_POINTS points and three multiplications per point, instead of
+ * one inversion per point. Points at infinity do not change.
+ *
+ * @param field      The field description
+ * @param points     The points, the function converts them in place
+ * @param numPoints  Number of points
+ */
+void ecFieldBatchAffine(const EcField *field, EcFieldPoint *points, int numPoints);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+#endif
@@ -128,6 +128,29 @@
 #define BNWORD64 uint64_t
 #endif
 
-/* We don't even try to find a 128-bit type at the moment */
+/*
+ * A 128-bit type lets the 64-bit library use plain C multiplication: GCC and
+ * clang provide unsigned __int128 on 64-bit targets and compile the 64x64->128
+ * bit product to a single mul (x86-64) or mul/umulh (AArch64) pair.
+ */
+#if !defined(BNWORD128) && defined(BNWORD64) && defined(__SIZEOF_INT128__)
+#define BNWORD128 unsigned __int128
+#endif
+
+/*
+ * Compilers without a 128-bit type, use the 64x64->128 bit intrinsics of
+ * MSVC on 64-bit targets.
+ */
+#if !defined(BNWORD128) && !defined(mul64_ppmm) && defined(BNWORD64) && defined(_MSC_VER)
+#if defined(_M_X64)
+#include <intrin.h>
+#pragma intrinsic(_umul128)
+#define mul64_ppmm(ph,pl,x,y) ((pl) = _umul128((x), (y), &(ph)))
+#elif defined(_M_ARM64)
+#include <intrin.h>
+#pragma intrinsic(__umulh)
+#define mul64_ppmm(ph,pl,x,y) ((ph) = __umulh((x), (y)), (pl) = (x) * (y))
+#endif
+#endif
 
 #endif /* !LBN_H */
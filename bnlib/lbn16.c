@@ -833,6 +833,59 @@ lbnMulX_16(BNWORD16 *prod, BNWORD16 const *num1, BNWORD16 const *num2,
 #endif /* !defined(BNWORD32) || !PRODUCT_SCAN */
 #endif /* !lbmMulX_16 */
 
+/*
+ * Finish a Montgomery reduction: subtract "mod" from the "mlen" words of
+ * "n" and the "carry" word above them until the result is less than
+ * "mod".
+ */
+static void
+lbnMontFinal_16(BNWORD16 *n, BNWORD16 const *mod, unsigned mlen,
+	BNWORD16 carry)
+{
+	while (carry)
+		carry -= lbnSubN_16(n, mod, mlen);
+	while (lbnCmp_16(n, mod, mlen) >= 0)
+		(void)lbnSubN_16(n, mod, mlen);
+}
+
+/*
+ * Like lbnMontFinal_16, but the number must be less than 2*mod, which is
+ * true for the results of a Montgomery multiply of numbers less than
+ * mod.  This subtracts mod once or not at all, and it does the same
+ * operations in both cases: the time does not depend on the values.
+ */
+static void
+lbnMontFinalCT_16(BNWORD16 *n, BNWORD16 const *mod, unsigned mlen,
+	BNWORD16 carry)
+{
+	BNWORD16 const *pm = mod;
+	BNWORD16 *pn = n;
+	BNWORD16 borrow = 0;
+	BNWORD16 mask, x, y, t;
+	unsigned i;
+
+	/* Get the borrow of n - mod */
+	for (i = 0; i < mlen; i++) {
+		x = BIGLITTLE(*--pn,*pn++);
+		y = BIGLITTLE(*--pm,*pm++);
+		t = x - y;
+		borrow = (x < y) | (t < borrow);
+	}
+
+	/* Subtract mod if there is a carry or if n >= mod */
+	mask = (BNWORD16)0 - (carry | (borrow ^ 1));
+	pm = mod;
+	pn = n;
+	borrow = 0;
+	for (i = 0; i < mlen; i++) {
+		x = BIGLITTLE(pn[-1],*pn);
+		y = BIGLITTLE(*--pm,*pm++) & mask;
+		t = x - y;
+		BIGLITTLE(*--pn,*pn++) = t - borrow;
+		borrow = (x < y) | (t < borrow);
+	}
+}
+
 #if !defined(lbnMontMul_16) && defined(BNWORD32) && PRODUCT_SCAN
 /*
  * Test code for product-scanning multiply.  This seems to slow the C
@@ -847,9 +900,12 @@ lbnMulX_16(BNWORD16 *prod, BNWORD16 const *num1, BNWORD16 const *num2,
  * The second half multiplies the upper half, adding in the modulus
  * times the Montgomery multipliers.  The results of this multiply
  * are stored.
+ *
+ * The result in the high half of prod and the returned carry word are
+ * less than 2*mod, see lbnMontFinal_16.
  */
-static void
-lbnMontMul_16(BNWORD16 *prod, BNWORD16 const *num1, BNWORD16 const *num2,
+static BNWORD16
+lbnMontMulLazy_16(BNWORD16 *prod, BNWORD16 const *num1, BNWORD16 const *num2,
 	BNWORD16 const *mod, unsigned len, BNWORD16 inv)
 {
 	BNWORD32 x, y;
@@ -861,7 +917,7 @@ lbnMontMul_16(BNWORD16 *prod, BNWORD16 const *num1, BNWORD16 const *num2,
 
 	/* Special case of zero */
 	if (!len)
-		return;
+		return 0;
 
 	/*
 	 * This computes directly into the high half of prod, so just
@@ -931,12 +987,17 @@ lbnMontMul_16(BNWORD16 *prod, BNWORD16 const *num1, BNWORD16 const *num2,
 
 	/* Last round of second half, simplified. */
 	BIGLITTLE(*(prod-len),*(prod+len-1)) = (BNWORD16)x;
-	carry = (x >> 16);
+	return (BNWORD16)(x >> 16);
+}
+#define lbnMontMulLazy_16 lbnMontMulLazy_16
 
-	while (carry)
-		carry -= lbnSubN_16(prod, mod, len);
-	while (lbnCmp_16(prod, mod, len) >= 0)
-		(void)lbnSubN_16(prod, mod, len);
+static void
+lbnMontMul_16(BNWORD16 *prod, BNWORD16 const *num1, BNWORD16 const *num2,
+	BNWORD16 const *mod, unsigned len, BNWORD16 inv)
+{
+	BNWORD16 carry = lbnMontMulLazy_16(prod, num1, num2, mod, len, inv);
+
+	lbnMontFinal_16(BIGLITTLE(prod-len,prod+len), mod, len, carry);
 }
 /* Suppress later definition */
 #define lbnMontMul_16 lbnMontMul_16
@@ -1848,7 +1909,7 @@ lbnMontInv1_16(BNWORD16 const x)
 }
 #endif /* !lbnMontInv1_16 */
 
-#if defined(BNWORD32) && PRODUCT_SCAN
+#if defined(BNWORD32) && PRODUCT_SCAN && !defined(lbnMontReduceLazy_16)
 /*
  * Test code for product-scanning Montgomery reduction.
  * This seems to slow the C code down rather than speed it up.
@@ -1859,9 +1920,12 @@ lbnMontInv1_16(BNWORD16 const x)
  * The second half multiplies the upper half, adding in the modulus
  * times the Montgomery multipliers.  The results of this multiply
  * are stored.
+ *
+ * This is the lazy reduction, see lbnMontReduceLazy_16 below.
  */
-void
-lbnMontReduce_16(BNWORD16 *n, BNWORD16 const *mod, unsigned mlen, BNWORD16 inv)
+static BNWORD16
+lbnMontReduceLazy_16(BNWORD16 *n, BNWORD16 const *mod, unsigned mlen,
+	BNWORD16 inv)
 {
 	BNWORD32 x, y;
 	BNWORD16 const *pm;
@@ -1872,7 +1936,7 @@ lbnMontReduce_16(BNWORD16 *n, BNWORD16 const *mod, unsigned mlen, BNWORD16 inv)
 
 	/* Special case of zero */
 	if (!mlen)
-		return;
+		return 0;
 
 	/* Pass 1 - compute Montgomery multipliers */
 	/* First iteration can have certain simplifications. */
@@ -1931,14 +1995,9 @@ lbnMontReduce_16(BNWORD16 *n, BNWORD16 const *mod, unsigned mlen, BNWORD16 inv)
 	t = BIGLITTLE(*(n-mlen),*(n+mlen-1));
 	x += t;
 	BIGLITTLE(*(n-mlen),*(n+mlen-1)) = (BNWORD16)x;
-	carry = (unsigned)(x >> 16);
-
-	while (carry)
-		carry -= lbnSubN_16(n, mod, mlen);
-	while (lbnCmp_16(n, mod, mlen) >= 0)
-		(void)lbnSubN_16(n, mod, mlen);
+	return (BNWORD16)(x >> 16);
 }
-#define lbnMontReduce_16 lbnMontReduce_16
+#define lbnMontReduceLazy_16 lbnMontReduceLazy_16
 #endif
 
 /*
@@ -2002,13 +2061,17 @@ lbnMontReduce_16(BNWORD16 *n, BNWORD16 const *mod, unsigned mlen, BNWORD16 inv)
  * 
  * TODO: Change to a full inverse and use Karatsuba's multiplication
  * rather than this word-at-a-time.
+ *
+ * lbnMontReduceLazy_16 does not subtract m at the end, it returns the
+ * carry word above the result instead.  The result and the carry are
+ * less than 2*m, see lbnMontFinal_16 and lbnMontFinalCT_16.
  */
-#ifndef lbnMontReduce_16
-void
-lbnMontReduce_16(BNWORD16 *n, BNWORD16 const *mod, unsigned const mlen,
+#ifndef lbnMontReduceLazy_16
+static BNWORD16
+lbnMontReduceLazy_16(BNWORD16 *n, BNWORD16 const *mod, unsigned const mlen,
                 BNWORD16 inv)
 {
-	BNWORD16 t;
+	BNWORD16 t, x;
 	BNWORD16 c = 0;
 	unsigned len = mlen;
 
@@ -2017,12 +2080,34 @@ lbnMontReduce_16(BNWORD16 *n, BNWORD16 const *mod, unsigned const mlen,
 
 	assert(len);
 
+	/*
+	 * Add the carry out of each step to the word above the low-order
+	 * part, the carry out of this add goes to the next word, where the
+	 * next step adds its carry out.  There is no carry loop, thus the
+	 * time does not depend on the values.
+	 */
 	do {
 		t = lbnMulAdd1_16(n, mod, mlen, inv * BIGLITTLE(n[-1],n[0]));
-		c += lbnAdd1_16(BIGLITTLE(n-mlen,n+mlen), len, t);
+		x = BIGLITTLE(*(n-mlen-1),*(n+mlen)) + c;
+		c = (x < c);
+		x += t;
+		c += (x < t);
+		BIGLITTLE(*(n-mlen-1),*(n+mlen)) = x;
 		BIGLITTLE(--n,++n);
 	} while (--len);
 
+	return c;
+}
+#define lbnMontReduceLazy_16 lbnMontReduceLazy_16
+#endif /* !lbnMontReduceLazy_16 */
+
+#ifndef lbnMontReduce_16
+void
+lbnMontReduce_16(BNWORD16 *n, BNWORD16 const *mod, unsigned const mlen,
+                BNWORD16 inv)
+{
+	BNWORD16 c = lbnMontReduceLazy_16(n, mod, mlen, inv);
+
 	/*
 	 * All that adding can cause an overflow past the modulus size,
 	 * but it's unusual, and never by much, so a subtraction loop
@@ -2030,10 +2115,7 @@ lbnMontReduce_16(BNWORD16 *n, BNWORD16 const *mod, unsigned const mlen,
 	 * This subtraction happens infrequently - I've only ever seen it
 	 * invoked once per reduction, and then just under 22.5% of the time.
 	 */
-	while (c)
-		c -= lbnSubN_16(n, mod, mlen);
-	while (lbnCmp_16(n, mod, mlen) >= 0)
-		(void)lbnSubN_16(n, mod, mlen);
+	lbnMontFinal_16(BIGLITTLE(n-mlen,n+mlen), mod, mlen, c);
 }
 #endif /* !lbnMontReduce_16 */
 
@@ -2070,6 +2152,20 @@ lbnMontReduce_16(BNWORD16 *n, BNWORD16 const *mod, unsigned const mlen,
 	
 #endif /* !lbnMontSquare_16 */
 
+/*
+ * The lazy versions of lbnMontMul_16 and lbnMontSquare_16 return the carry
+ * word above the result, see lbnMontReduceLazy_16.
+ */
+#ifndef lbnMontMulLazy_16
+#define lbnMontMulLazy_16(prod, n1, n2, mod, len, inv) \
+	(lbnMulX_16(prod, n1, n2, len), lbnMontReduceLazy_16(prod, mod, len, inv))
+#endif /* !lbnMontMulLazy_16 */
+
+#ifndef lbnMontSquareLazy_16
+#define lbnMontSquareLazy_16(prod, n, mod, len, inv) \
+	(lbnSquare_16(prod, n, len), lbnMontReduceLazy_16(prod, mod, len, inv))
+#endif /* !lbnMontSquareLazy_16 */
+
 /*
  * Convert a number to Montgomery form - requires mlen + nlen words
  * of memory in "n".
@@ -2573,6 +2669,213 @@ yield:
 	return y;	/* Success */
 }
 
+/*
+ * Constant time modular exponentiation.
+ *
+ * lbnExpMod_16 above uses a sliding window: which squarings and multiplies
+ * it does, and which table entries it reads, depend on the bits of the
+ * exponent.  lbnExpModCT_16 uses a fixed window of wbits bits instead.  It
+ * does wbits squarings and one multiply for each window of the exponent,
+ * also for windows of zero bits, and the final subtraction of the
+ * Montgomery steps does the same operations whether it subtracts or not.
+ *
+ * The table holds all 2^wbits powers of n, scattered: word j of entry i
+ * is at table[j*entries + i], thus an entry is spread over the cache
+ * lines of the table.  The gather reads all entries and selects the
+ * words of the wanted entry with masks, thus the memory accesses do not
+ * depend on the exponent either.
+ *
+ * lbnExpModCT_16 always processes "ebits" exponent bits, the exponent must
+ * not have more bits.  The workspace "ws" is a plain array of
+ * lbnExpModCTSize_16(mlen, ebits) words, the caller allocates it once and
+ * can use it for many exponentiations, lbnExpModCT_16 does not allocate
+ * memory.
+ */
+#define BNEXPMODCT_MAX_WINDOW 5
+static unsigned const bnExpModCTThreshTable[] = {
+	96, 320, (unsigned)-1
+};
+
+/* The window size for exponents of "ebits" bits, 3 up to 5 bits */
+static unsigned
+lbnExpModCTWindow_16(unsigned ebits)
+{
+	unsigned wbits = 0;
+
+	while (ebits > bnExpModCTThreshTable[wbits])
+		wbits++;
+	return wbits + 3;
+}
+
+/*
+ * The size of the workspace in words: the table, two product buffers,
+ * the gather buffer, and the padding to align the table to 64 bytes.
+ */
+unsigned
+lbnExpModCTSize_16(unsigned mlen, unsigned ebits)
+{
+	unsigned entries = 1u << lbnExpModCTWindow_16(ebits);
+
+	return (entries + 5) * mlen + 64 / sizeof(BNWORD16);
+}
+
+/* Store "src" as entry "index" of the scattered table */
+static void
+lbnExpModCTScatter_16(BNWORD16 *table, unsigned entries,
+	BNWORD16 const *src, unsigned mlen, unsigned index)
+{
+	table += index;
+	while (mlen--) {
+		*table = BIGLITTLE(*--src,*src++);
+		table += entries;
+	}
+}
+
+/* Read entry "index" of the scattered table, reading all entries */
+static void
+lbnExpModCTGather_16(BNWORD16 *dest, BNWORD16 const *table, unsigned entries,
+	unsigned mlen, unsigned index)
+{
+	BNWORD16 mask[1 << BNEXPMODCT_MAX_WINDOW];
+	BNWORD16 w;
+	unsigned i, x;
+
+	for (i = 0; i < entries; i++) {
+		x = i ^ index;
+		/* All ones if x is 0, else 0 */
+		mask[i] = (BNWORD16)0 -
+		          (BNWORD16)(((x - 1) & ~x) >> (sizeof(x)*8 - 1));
+	}
+	while (mlen--) {
+		w = 0;
+		for (i = 0; i < entries; i++)
+			w |= table[i] & mask[i];
+		BIGLITTLE(*--dest,*dest++) = w;
+		table += entries;
+	}
+}
+
+/*
+ * Get the "wbits" bits of "e" that start at bit "pos", the bits above
+ * the "elen" words of e are 0.  This depends on pos, not on the bits.
+ */
+static unsigned
+lbnExpModCTBits_16(BNWORD16 const *e, unsigned elen, unsigned pos,
+	unsigned wbits)
+{
+	unsigned bits = 0;
+	unsigned k;
+
+	while (wbits--) {
+		k = pos + wbits;
+		bits <<= 1;
+		if (k / 16 < elen)
+			bits |= (unsigned)(BIGLITTLE(e[-1-(int)(k/16)],e[k/16])
+			                   >> (k % 16)) & 1;
+	}
+	return bits;
+}
+
+int
+lbnExpModCT_16(BNWORD16 *result, BNWORD16 const *n, unsigned nlen,
+	BNWORD16 const *e, unsigned elen, unsigned ebits,
+	BNWORD16 *mod, unsigned mlen, BNWORD16 *ws)
+{
+	BNWORD16 *table;	/* Scattered powers of n */
+	BNWORD16 *a, *b;	/* Working buffers/accumulators */
+	BNWORD16 *g;		/* Gathered table entry */
+	BNWORD16 *t;		/* Pointer into the working buffers */
+	BNWORD16 inv;		/* mod^-1 modulo 2^16 */
+	BNWORD16 carry;		/* Carry of the lazy Montgomery steps */
+	unsigned wbits;		/* Window size */
+	unsigned entries;	/* Table entries, 2^wbits */
+	unsigned pos;		/* Exponent bit of the current window */
+	unsigned i;
+
+	assert(mlen);
+	assert(nlen <= mlen);
+	assert(ebits);
+	assert(lbnBits_16(e, elen) <= ebits);
+
+	wbits = lbnExpModCTWindow_16(ebits);
+	entries = 1u << wbits;
+
+	/* Align the table, it is the first part of the workspace */
+	while ((size_t)ws & 63)
+		ws++;
+	table = ws;
+	ws += entries * mlen;
+	a = BIGLITTLE(ws + 2*mlen, ws);
+	b = a + 2*mlen;
+	g = BIGLITTLE(b + mlen, b + 2*mlen);
+
+	/* Compute the necessary modular inverse */
+	inv = lbnMontInv1_16(mod[BIGLITTLE(-1,0)]);	/* LSW of modulus */
+
+	/* Entry 0 is the Montgomery form of 1, R mod "mod" */
+	t = BIGLITTLE(a-mlen, a+mlen);
+	lbnZero_16(a, 2*mlen);
+	BIGLITTLE(t[-1],t[0]) = 1;
+	(void)lbnDiv_16(t, a, mlen+1, mod, mlen);
+	lbnExpModCTScatter_16(table, entries, a, mlen, 0);
+
+	/* Entry 1 is the Montgomery form of n, keep a copy in g */
+	lbnCopy_16(t, n, nlen);
+	lbnZero_16(a, mlen);
+	(void)lbnDiv_16(t, a, mlen+nlen, mod, mlen);
+	lbnExpModCTScatter_16(table, entries, a, mlen, 1);
+	lbnCopy_16(g, a, mlen);
+	lbnCopy_16(BIGLITTLE(b-mlen, b+mlen), a, mlen);
+
+	/* The other entries, the accumulator is the high half of b */
+	for (i = 2; i < entries; i++) {
+		carry = lbnMontMulLazy_16(a, BIGLITTLE(b-mlen, b+mlen), g,
+		                          mod, mlen, inv);
+		t = BIGLITTLE(a-mlen, a+mlen);
+		lbnMontFinalCT_16(t, mod, mlen, carry);
+		lbnExpModCTScatter_16(table, entries, t, mlen, i);
+		/* Swap a and b */
+		t = a; a = b; b = t;
+	}
+
+	/* Start with the most significant window */
+	pos = (ebits + wbits - 1) / wbits * wbits - wbits;
+	lbnExpModCTGather_16(BIGLITTLE(b-mlen, b+mlen), table, entries, mlen,
+	                     lbnExpModCTBits_16(e, elen, pos, wbits));
+
+	while (pos) {
+		pos -= wbits;
+		for (i = 0; i < wbits; i++) {
+			carry = lbnMontSquareLazy_16(a, BIGLITTLE(b-mlen, b+mlen),
+			                             mod, mlen, inv);
+			lbnMontFinalCT_16(BIGLITTLE(a-mlen, a+mlen), mod, mlen,
+			                  carry);
+			t = a; a = b; b = t;
+		}
+		lbnExpModCTGather_16(g, table, entries, mlen,
+		                     lbnExpModCTBits_16(e, elen, pos, wbits));
+		carry = lbnMontMulLazy_16(a, BIGLITTLE(b-mlen, b+mlen), g,
+		                          mod, mlen, inv);
+		lbnMontFinalCT_16(BIGLITTLE(a-mlen, a+mlen), mod, mlen, carry);
+		t = a; a = b; b = t;
+	}
+
+	/* Convert result out of Montgomery form */
+	t = BIGLITTLE(b-mlen, b+mlen);
+	lbnCopy_16(b, t, mlen);
+	lbnZero_16(t, mlen);
+	carry = lbnMontReduceLazy_16(b, mod, mlen, inv);
+	lbnMontFinalCT_16(t, mod, mlen, carry);
+	lbnCopy_16(result, t, mlen);
+
+	/* The intermediate values tell about the exponent, wipe them */
+	lbnZero_16(a, 2*mlen);
+	lbnZero_16(b, 2*mlen);
+	lbnZero_16(g, mlen);
+
+	return 0;
+}
+
 /*
  * Compute and return n1^e1 * n2^e2 mod "mod".
  * result may be either input buffer, or something separate.
@@ -121,6 +121,10 @@ void lbnFromMont_16(BNWORD16 *n, BNWORD16 *mod, unsigned len);
 int lbnExpMod_16(BNWORD16 *result, BNWORD16 const *n, unsigned nlen,
 	BNWORD16 const *exp, unsigned elen, BNWORD16 *mod, unsigned mlen);
 #endif
+unsigned lbnExpModCTSize_16(unsigned mlen, unsigned ebits);
+int lbnExpModCT_16(BNWORD16 *result, BNWORD16 const *n, unsigned nlen,
+	BNWORD16 const *exp, unsigned elen, unsigned ebits,
+	BNWORD16 *mod, unsigned mlen, BNWORD16 *ws);
 #ifndef lbnDoubleExpMod_16
 int lbnDoubleExpMod_16(BNWORD16 *result,
 	BNWORD16 const *n1, unsigned n1len, BNWORD16 const *e1, unsigned e1len,
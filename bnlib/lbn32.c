@@ -740,8 +740,8 @@ lbnRshift_32(BNWORD32 *num, unsigned len, unsigned shift)
  * provided that the low len1 bits of prod are free.  (This corresponds
  * nicely to the place the result is returned from lbnMontReduce_32.)
  *
- * TODO: Use Karatsuba multiply.  The overlap constraints may have
- * to get rewhacked.
+ * The overlap prevents a Karatsuba multiply here, the multiply of two
+ * numbers of the same length, lbnMulX_32, uses it.
  */
 #ifndef lbnMul_32
 void
@@ -782,7 +782,7 @@ lbnMul_32(BNWORD32 *prod, BNWORD32 const *num1, unsigned len1,
  * to make the C code slower, so PRODUCT_SCAN is not defined.
  */
 static void
-lbnMulX_32(BNWORD32 *prod, BNWORD32 const *num1, BNWORD32 const *num2,
+lbnMulXBase_32(BNWORD32 *prod, BNWORD32 const *num1, BNWORD32 const *num2,
 	unsigned len)
 {
 	BNWORD64 x, y;
@@ -829,10 +829,263 @@ lbnMulX_32(BNWORD32 *prod, BNWORD32 const *num1, BNWORD32 const *num2,
 }
 #else /* !defined(BNWORD64) || !PRODUCT_SCAN */
 /* Default trivial macro definition */
-#define lbnMulX_32(prod, num1, num2, len) lbnMul_32(prod, num1, len, num2, len)
+#define lbnMulXBase_32(prod, num1, num2, len) \
+	lbnMul_32(prod, num1, len, num2, len)
 #endif /* !defined(BNWORD64) || !PRODUCT_SCAN */
 #endif /* !lbmMulX_32 */
 
+/*
+ * Karatsuba multiply and square.  Split both numbers of length "len" in
+ * a low half of h = (len+1)/2 words and a high half of l = len-h words,
+ * a = a1*W + a0 and b = b1*W + b0 with W = 2^(32*h), then
+ *
+ *   a*b = a1*b1 * W^2 + (a0*b0 + a1*b1 - (a0-a1)*(b0-b1)) * W + a0*b0
+ *
+ * needs three multiplies of half the length instead of four.  The
+ * multiplies below BN_KARATSUBA_MUL_32 words use the schoolbook code,
+ * the squares below BN_KARATSUBA_SQUARE_32 words likewise.  The best
+ * thresholds depend on the CPU and the compiler, the defaults are the
+ * result of some timing on x86-64.  Define BN_KARATSUBA_MAX_32 as 0 to
+ * turn Karatsuba off.
+ *
+ * The Karatsuba code needs a scratch area of about 6*len words, it
+ * lives on the stack, thus only numbers up to BN_KARATSUBA_MAX_32 words
+ * use it.  The default covers 8192-bit numbers.
+ *
+ * The Karatsuba code does the same operations for all numbers of
+ * the same length, the signs of the differences select the values
+ * with masks, not with branches.
+ */
+#ifndef BN_KARATSUBA_MUL_32
+#define BN_KARATSUBA_MUL_32 32
+#endif
+#ifndef BN_KARATSUBA_SQUARE_32
+#define BN_KARATSUBA_SQUARE_32 32
+#endif
+#ifndef BN_KARATSUBA_MAX_32
+#define BN_KARATSUBA_MAX_32 (8192/32)
+#endif
+
+#if BN_KARATSUBA_MAX_32 && (!defined(lbnMulX_32) || !defined(lbnSquare_32))
+#if BN_KARATSUBA_MUL_32 < 8 || BN_KARATSUBA_SQUARE_32 < 8
+#error The Karatsuba thresholds must be at least 8 words
+#endif
+
+#define BN_KARATSUBA_SCRATCH_32 (6*BN_KARATSUBA_MAX_32 + 64)
+
+/*
+ * Add the single-word "carry" to all "len" words of "num", return the
+ * carry out.  Unlike lbnAdd1_32 this does not stop early.
+ */
+static BNWORD32
+lbnKaraCarry_32(BNWORD32 *num, unsigned len, BNWORD32 carry)
+{
+	BNWORD32 t;
+
+	while (len--) {
+		t = BIGLITTLE(*--num,*num) + carry;
+		carry = (t < carry);
+		BIGLITTLE(*num,*num++) = t;
+	}
+	return carry;
+}
+
+/*
+ * Negate "num" modulo 2^(32*len) if "mask" is all ones, leave it
+ * unchanged if "mask" is 0.
+ */
+static void
+lbnKaraCondNeg_32(BNWORD32 *num, unsigned len, BNWORD32 mask)
+{
+	BNWORD32 t;
+	BNWORD32 carry = mask & 1;
+
+	while (len--) {
+		t = (BIGLITTLE(*--num,*num) ^ mask) + carry;
+		carry = (t < carry);
+		BIGLITTLE(*num,*num++) = t;
+	}
+}
+
+/*
+ * Store |num1 - num2| in the "len" words of "diff".  num1 has "len"
+ * words, num2 has "len2" words, len2 is len or len-1.  Return all ones
+ * if num1 < num2, else 0.
+ */
+static BNWORD32
+lbnKaraDiff_32(BNWORD32 *diff, BNWORD32 const *num1, unsigned len,
+	BNWORD32 const *num2, unsigned len2)
+{
+	BNWORD32 borrow, t;
+
+	lbnCopy_32(diff, num1, len);
+	borrow = lbnSubN_32(diff, num2, len2);
+	if (len2 < len) {
+		t = BIGLITTLE(diff[-(int)len], diff[len-1]);
+		BIGLITTLE(diff[-(int)len], diff[len-1]) = t - borrow;
+		borrow = (t < borrow);
+	}
+	borrow = 0 - borrow;
+	lbnKaraCondNeg_32(diff, len, borrow);
+	return borrow;
+}
+
+/*
+ * Add the middle product "sum", 2*h+1 words, to "prod", 2*len words,
+ * at word h.
+ */
+static void
+lbnKaraAddMid_32(BNWORD32 *prod, unsigned len, BNWORD32 const *sum, unsigned h)
+{
+	BNWORD32 carry;
+
+	carry = lbnAddN_32(BIGLITTLE(prod-h,prod+h), sum, 2*h+1);
+	(void)lbnKaraCarry_32(BIGLITTLE(prod-3*h-1,prod+3*h+1), 2*len-3*h-1,
+	                      carry);
+}
+
+/*
+ * Store z0 + z2 in "sum", 2*h+1 words.  z0 are the low 2*h words of
+ * "prod", z2 the 2*l words that follow.
+ */
+static void
+lbnKaraSum_32(BNWORD32 *sum, BNWORD32 const *prod, unsigned h, unsigned l)
+{
+	BNWORD32 carry;
+
+	lbnCopy_32(sum, prod, 2*h);
+	BIGLITTLE(sum[-2*(int)h-1], sum[2*h]) = 0;
+	carry = lbnAddN_32(sum, BIGLITTLE(prod-2*h,prod+2*h), 2*l);
+	(void)lbnKaraCarry_32(BIGLITTLE(sum-2*l,sum+2*l), 2*(h-l)+1, carry);
+}
+#endif /* BN_KARATSUBA_MAX_32 */
+
+#ifndef lbnMulX_32
+#if BN_KARATSUBA_MAX_32
+/*
+ * Karatsuba multiply of num1 and num2, "len" words each, product in
+ * the 2*len words of "prod".  "scratch" must not overlap the other
+ * arrays.
+ */
+static void
+lbnKaraMul_32(BNWORD32 *prod, BNWORD32 const *num1, BNWORD32 const *num2,
+	unsigned len, BNWORD32 *scratch)
+{
+	BNWORD32 *d1, *d2, *mid, *sum, *next;
+	BNWORD32 sign;
+	unsigned h, l;
+
+	if (len < BN_KARATSUBA_MUL_32) {
+		lbnMulXBase_32(prod, num1, num2, len);
+		return;
+	}
+	h = (len+1)/2;
+	l = len-h;
+
+	/* Scratch: d1 and d2 h words, mid and sum 2*h+1 words */
+	d1 = scratch;
+	d2 = BIGLITTLE(d1-h,d1+h);
+	mid = BIGLITTLE(d2-h,d2+h);
+	sum = BIGLITTLE(mid-2*h-1,mid+2*h+1);
+	next = BIGLITTLE(sum-2*h-1,sum+2*h+1);
+
+	sign = lbnKaraDiff_32(d1, num1, h, BIGLITTLE(num1-h,num1+h), l) ^
+	       lbnKaraDiff_32(d2, num2, h, BIGLITTLE(num2-h,num2+h), l);
+
+	/* z0 = a0*b0 and z2 = a1*b1 go to their place in the product */
+	lbnKaraMul_32(prod, num1, num2, h, next);
+	lbnKaraMul_32(BIGLITTLE(prod-2*h,prod+2*h), BIGLITTLE(num1-h,num1+h),
+	              BIGLITTLE(num2-h,num2+h), l, next);
+	lbnKaraMul_32(mid, d1, d2, h, next);
+	BIGLITTLE(mid[-2*(int)h-1], mid[2*h]) = 0;
+
+	/*
+	 * (a0-a1)*(b0-b1) = |d1|*|d2| if the signs are equal, subtract
+	 * it in this case, else add it.
+	 */
+	lbnKaraSum_32(sum, prod, h, l);
+	lbnKaraCondNeg_32(mid, 2*h+1, ~sign);
+	(void)lbnAddN_32(sum, mid, 2*h+1);
+
+	lbnKaraAddMid_32(prod, len, sum, h);
+}
+#endif /* BN_KARATSUBA_MAX_32 */
+
+/*
+ * Multiply num1 and num2 of length "len", product in the 2*len words of
+ * "prod".  There may not be any overlap of the input and output.
+ */
+void
+lbnMulX_32(BNWORD32 *prod, BNWORD32 const *num1, BNWORD32 const *num2,
+	unsigned len)
+{
+#if BN_KARATSUBA_MAX_32
+	if (len >= BN_KARATSUBA_MUL_32 && len <= BN_KARATSUBA_MAX_32) {
+		BNWORD32 scratch[BN_KARATSUBA_SCRATCH_32];
+
+		lbnKaraMul_32(prod, num1, num2, len,
+		    BIGLITTLE(scratch+BN_KARATSUBA_SCRATCH_32,scratch));
+		return;
+	}
+#endif
+	lbnMulXBase_32(prod, num1, num2, len);
+}
+#define lbnMulX_32 lbnMulX_32
+#endif /* !lbnMulX_32 */
+
+/*
+ * Finish a Montgomery reduction: subtract "mod" from the "mlen" words of
+ * "n" and the "carry" word above them until the result is less than
+ * "mod".
+ */
+static void
+lbnMontFinal_32(BNWORD32 *n, BNWORD32 const *mod, unsigned mlen,
+	BNWORD32 carry)
+{
+	while (carry)
+		carry -= lbnSubN_32(n, mod, mlen);
+	while (lbnCmp_32(n, mod, mlen) >= 0)
+		(void)lbnSubN_32(n, mod, mlen);
+}
+
+/*
+ * Like lbnMontFinal_32, but the number must be less than 2*mod, which is
+ * true for the results of a Montgomery multiply of numbers less than
+ * mod.  This subtracts mod once or not at all, and it does the same
+ * operations in both cases: the time does not depend on the values.
+ */
+static void
+lbnMontFinalCT_32(BNWORD32 *n, BNWORD32 const *mod, unsigned mlen,
+	BNWORD32 carry)
+{
+	BNWORD32 const *pm = mod;
+	BNWORD32 *pn = n;
+	BNWORD32 borrow = 0;
+	BNWORD32 mask, x, y, t;
+	unsigned i;
+
+	/* Get the borrow of n - mod */
+	for (i = 0; i < mlen; i++) {
+		x = BIGLITTLE(*--pn,*pn++);
+		y = BIGLITTLE(*--pm,*pm++);
+		t = x - y;
+		borrow = (x < y) | (t < borrow);
+	}
+
+	/* Subtract mod if there is a carry or if n >= mod */
+	mask = (BNWORD32)0 - (carry | (borrow ^ 1));
+	pm = mod;
+	pn = n;
+	borrow = 0;
+	for (i = 0; i < mlen; i++) {
+		x = BIGLITTLE(pn[-1],*pn);
+		y = BIGLITTLE(*--pm,*pm++) & mask;
+		t = x - y;
+		BIGLITTLE(*--pn,*pn++) = t - borrow;
+		borrow = (x < y) | (t < borrow);
+	}
+}
+
 #if !defined(lbnMontMul_32) && defined(BNWORD64) && PRODUCT_SCAN
 /*
  * Test code for product-scanning multiply.  This seems to slow the C
@@ -847,9 +1100,12 @@ lbnMulX_32(BNWORD32 *prod, BNWORD32 const *num1, BNWORD32 const *num2,
  * The second half multiplies the upper half, adding in the modulus
  * times the Montgomery multipliers.  The results of this multiply
  * are stored.
+ *
+ * The result in the high half of prod and the returned carry word are
+ * less than 2*mod, see lbnMontFinal_32.
  */
-static void
-lbnMontMul_32(BNWORD32 *prod, BNWORD32 const *num1, BNWORD32 const *num2,
+static BNWORD32
+lbnMontMulLazy_32(BNWORD32 *prod, BNWORD32 const *num1, BNWORD32 const *num2,
 	BNWORD32 const *mod, unsigned len, BNWORD32 inv)
 {
 	BNWORD64 x, y;
@@ -861,7 +1117,7 @@ lbnMontMul_32(BNWORD32 *prod, BNWORD32 const *num1, BNWORD32 const *num2,
 
 	/* Special case of zero */
 	if (!len)
-		return;
+		return 0;
 
 	/*
 	 * This computes directly into the high half of prod, so just
@@ -931,12 +1187,17 @@ lbnMontMul_32(BNWORD32 *prod, BNWORD32 const *num1, BNWORD32 const *num2,
 
 	/* Last round of second half, simplified. */
 	BIGLITTLE(*(prod-len),*(prod+len-1)) = (BNWORD32)x;
-	carry = (x >> 32);
+	return (BNWORD32)(x >> 32);
+}
+#define lbnMontMulLazy_32 lbnMontMulLazy_32
 
-	while (carry)
-		carry -= lbnSubN_32(prod, mod, len);
-	while (lbnCmp_32(prod, mod, len) >= 0)
-		(void)lbnSubN_32(prod, mod, len);
+static void
+lbnMontMul_32(BNWORD32 *prod, BNWORD32 const *num1, BNWORD32 const *num2,
+	BNWORD32 const *mod, unsigned len, BNWORD32 inv)
+{
+	BNWORD32 carry = lbnMontMulLazy_32(prod, num1, num2, mod, len, inv);
+
+	lbnMontFinal_32(BIGLITTLE(prod-len,prod+len), mod, len, carry);
 }
 /* Suppress later definition */
 #define lbnMontMul_32 lbnMontMul_32
@@ -947,8 +1208,8 @@ lbnMontMul_32(BNWORD32 *prod, BNWORD32 const *num1, BNWORD32 const *num2,
  * Trial code for product-scanning squaring.  This seems to slow the C
  * code down rather than speed it up.
  */
-void
-lbnSquare_32(BNWORD32 *prod, BNWORD32 const *num, unsigned len)
+static void
+lbnSquareBase_32(BNWORD32 *prod, BNWORD32 const *num, unsigned len)
 {
 	BNWORD64 x, y, z;
 	BNWORD32 const *p1, *p2;
@@ -1021,7 +1282,7 @@ lbnSquare_32(BNWORD32 *prod, BNWORD32 const *num, unsigned len)
 	BIGLITTLE(*--prod,*prod) = (BNWORD32)x;
 }
 /* Suppress later definition */
-#define lbnSquare_32 lbnSquare_32
+#define lbnSquareBase_32 lbnSquareBase_32
 #endif
 
 /*
@@ -1062,11 +1323,10 @@ lbnSquare_32(BNWORD32 *prod, BNWORD32 const *num, unsigned len)
  * input, so it doesn't need special care.
  *
  * TODO: Merge the shift by 1 with the squaring loop.
- * TODO: Use Karatsuba.  (a*W+b)^2 = a^2 * (W^2+W) + b^2 * (W+1) - (a-b)^2 * W.
  */
-#ifndef lbnSquare_32
-void
-lbnSquare_32(BNWORD32 *prod, BNWORD32 const *num, unsigned len)
+#if !defined(lbnSquare_32) && !defined(lbnSquareBase_32)
+static void
+lbnSquareBase_32(BNWORD32 *prod, BNWORD32 const *num, unsigned len)
 {
 	BNWORD32 t;
 	BNWORD32 *prodx = prod;		/* Working copy of the argument */
@@ -1118,6 +1378,73 @@ lbnSquare_32(BNWORD32 *prod, BNWORD32 const *num, unsigned len)
 	/* And set the low bit appropriately */
 	BIGLITTLE(prod[-1],prod[0]) |= BIGLITTLE(num[-1],num[0]) & 1;
 }
+#endif /* !lbnSquare_32 && !lbnSquareBase_32 */
+
+#ifndef lbnSquare_32
+#if BN_KARATSUBA_MAX_32
+/*
+ * Karatsuba square of "num", "len" words, result in the 2*len words
+ * of "prod".  With a = a1*W + a0 as in lbnKaraMul_32
+ *
+ *   a^2 = a1^2 * W^2 + (a0^2 + a1^2 - (a0-a1)^2) * W + a0^2
+ *
+ * "scratch" must not overlap the other arrays.
+ */
+static void
+lbnKaraSquare_32(BNWORD32 *prod, BNWORD32 const *num, unsigned len,
+	BNWORD32 *scratch)
+{
+	BNWORD32 *d, *mid, *sum, *next;
+	BNWORD32 borrow;
+	unsigned h, l;
+
+	if (len < BN_KARATSUBA_SQUARE_32) {
+		lbnSquareBase_32(prod, num, len);
+		return;
+	}
+	h = (len+1)/2;
+	l = len-h;
+
+	/* Scratch: d h words, mid 2*h words and sum 2*h+1 words */
+	d = scratch;
+	mid = BIGLITTLE(d-h,d+h);
+	sum = BIGLITTLE(mid-2*h,mid+2*h);
+	next = BIGLITTLE(sum-2*h-1,sum+2*h+1);
+
+	(void)lbnKaraDiff_32(d, num, h, BIGLITTLE(num-h,num+h), l);
+
+	lbnKaraSquare_32(prod, num, h, next);
+	lbnKaraSquare_32(BIGLITTLE(prod-2*h,prod+2*h), BIGLITTLE(num-h,num+h),
+	                 l, next);
+	lbnKaraSquare_32(mid, d, h, next);
+
+	/* The middle product is not negative, thus the borrow fits */
+	lbnKaraSum_32(sum, prod, h, l);
+	borrow = lbnSubN_32(sum, mid, 2*h);
+	BIGLITTLE(sum[-2*(int)h-1], sum[2*h]) -= borrow;
+
+	lbnKaraAddMid_32(prod, len, sum, h);
+}
+#endif /* BN_KARATSUBA_MAX_32 */
+
+/*
+ * Square a number, see lbnSquareBase_32.  There may not be any overlap
+ * of the input and output.
+ */
+void
+lbnSquare_32(BNWORD32 *prod, BNWORD32 const *num, unsigned len)
+{
+#if BN_KARATSUBA_MAX_32
+	if (len >= BN_KARATSUBA_SQUARE_32 && len <= BN_KARATSUBA_MAX_32) {
+		BNWORD32 scratch[BN_KARATSUBA_SCRATCH_32];
+
+		lbnKaraSquare_32(prod, num, len,
+		    BIGLITTLE(scratch+BN_KARATSUBA_SCRATCH_32,scratch));
+		return;
+	}
+#endif
+	lbnSquareBase_32(prod, num, len);
+}
 #endif /* !lbnSquare_32 */
 
 /*
@@ -1848,7 +2175,7 @@ lbnMontInv1_32(BNWORD32 const x)
 }
 #endif /* !lbnMontInv1_32 */
 
-#if defined(BNWORD64) && PRODUCT_SCAN
+#if defined(BNWORD64) && PRODUCT_SCAN && !defined(lbnMontReduceLazy_32)
 /*
  * Test code for product-scanning Montgomery reduction.
  * This seems to slow the C code down rather than speed it up.
@@ -1859,9 +2186,12 @@ lbnMontInv1_32(BNWORD32 const x)
  * The second half multiplies the upper half, adding in the modulus
  * times the Montgomery multipliers.  The results of this multiply
  * are stored.
+ *
+ * This is the lazy reduction, see lbnMontReduceLazy_32 below.
  */
-void
-lbnMontReduce_32(BNWORD32 *n, BNWORD32 const *mod, unsigned mlen, BNWORD32 inv)
+static BNWORD32
+lbnMontReduceLazy_32(BNWORD32 *n, BNWORD32 const *mod, unsigned mlen,
+	BNWORD32 inv)
 {
 	BNWORD64 x, y;
 	BNWORD32 const *pm;
@@ -1872,7 +2202,7 @@ lbnMontReduce_32(BNWORD32 *n, BNWORD32 const *mod, unsigned mlen, BNWORD32 inv)
 
 	/* Special case of zero */
 	if (!mlen)
-		return;
+		return 0;
 
 	/* Pass 1 - compute Montgomery multipliers */
 	/* First iteration can have certain simplifications. */
@@ -1931,14 +2261,9 @@ lbnMontReduce_32(BNWORD32 *n, BNWORD32 const *mod, unsigned mlen, BNWORD32 inv)
 	t = BIGLITTLE(*(n-mlen),*(n+mlen-1));
 	x += t;
 	BIGLITTLE(*(n-mlen),*(n+mlen-1)) = (BNWORD32)x;
-	carry = (unsigned)(x >> 32);
-
-	while (carry)
-		carry -= lbnSubN_32(n, mod, mlen);
-	while (lbnCmp_32(n, mod, mlen) >= 0)
-		(void)lbnSubN_32(n, mod, mlen);
+	return (BNWORD32)(x >> 32);
 }
-#define lbnMontReduce_32 lbnMontReduce_32
+#define lbnMontReduceLazy_32 lbnMontReduceLazy_32
 #endif
 
 /*
@@ -2002,13 +2327,17 @@ lbnMontReduce_32(BNWORD32 *n, BNWORD32 const *mod, unsigned mlen, BNWORD32 inv)
  * 
  * TODO: Change to a full inverse and use Karatsuba's multiplication
  * rather than this word-at-a-time.
+ *
+ * lbnMontReduceLazy_32 does not subtract m at the end, it returns the
+ * carry word above the result instead.  The result and the carry are
+ * less than 2*m, see lbnMontFinal_32 and lbnMontFinalCT_32.
  */
-#ifndef lbnMontReduce_32
-void
-lbnMontReduce_32(BNWORD32 *n, BNWORD32 const *mod, unsigned const mlen,
+#ifndef lbnMontReduceLazy_32
+static BNWORD32
+lbnMontReduceLazy_32(BNWORD32 *n, BNWORD32 const *mod, unsigned const mlen,
                 BNWORD32 inv)
 {
-	BNWORD32 t;
+	BNWORD32 t, x;
 	BNWORD32 c = 0;
 	unsigned len = mlen;
 
@@ -2017,12 +2346,34 @@ lbnMontReduce_32(BNWORD32 *n, BNWORD32 const *mod, unsigned const mlen,
 
 	assert(len);
 
+	/*
+	 * Add the carry out of each step to the word above the low-order
+	 * part, the carry out of this add goes to the next word, where the
+	 * next step adds its carry out.  There is no carry loop, thus the
+	 * time does not depend on the values.
+	 */
 	do {
 		t = lbnMulAdd1_32(n, mod, mlen, inv * BIGLITTLE(n[-1],n[0]));
-		c += lbnAdd1_32(BIGLITTLE(n-mlen,n+mlen), len, t);
+		x = BIGLITTLE(*(n-mlen-1),*(n+mlen)) + c;
+		c = (x < c);
+		x += t;
+		c += (x < t);
+		BIGLITTLE(*(n-mlen-1),*(n+mlen)) = x;
 		BIGLITTLE(--n,++n);
 	} while (--len);
 
+	return c;
+}
+#define lbnMontReduceLazy_32 lbnMontReduceLazy_32
+#endif /* !lbnMontReduceLazy_32 */
+
+#ifndef lbnMontReduce_32
+void
+lbnMontReduce_32(BNWORD32 *n, BNWORD32 const *mod, unsigned const mlen,
+                BNWORD32 inv)
+{
+	BNWORD32 c = lbnMontReduceLazy_32(n, mod, mlen, inv);
+
 	/*
 	 * All that adding can cause an overflow past the modulus size,
 	 * but it's unusual, and never by much, so a subtraction loop
@@ -2030,10 +2381,7 @@ lbnMontReduce_32(BNWORD32 *n, BNWORD32 const *mod, unsigned const mlen,
 	 * This subtraction happens infrequently - I've only ever seen it
 	 * invoked once per reduction, and then just under 22.5% of the time.
 	 */
-	while (c)
-		c -= lbnSubN_32(n, mod, mlen);
-	while (lbnCmp_32(n, mod, mlen) >= 0)
-		(void)lbnSubN_32(n, mod, mlen);
+	lbnMontFinal_32(BIGLITTLE(n-mlen,n+mlen), mod, mlen, c);
 }
 #endif /* !lbnMontReduce_32 */
 
@@ -2070,6 +2418,20 @@ lbnMontReduce_32(BNWORD32 *n, BNWORD32 const *mod, unsigned const mlen,
 	
 #endif /* !lbnMontSquare_32 */
 
+/*
+ * The lazy versions of lbnMontMul_32 and lbnMontSquare_32 return the carry
+ * word above the result, see lbnMontReduceLazy_32.
+ */
+#ifndef lbnMontMulLazy_32
+#define lbnMontMulLazy_32(prod, n1, n2, mod, len, inv) \
+	(lbnMulX_32(prod, n1, n2, len), lbnMontReduceLazy_32(prod, mod, len, inv))
+#endif /* !lbnMontMulLazy_32 */
+
+#ifndef lbnMontSquareLazy_32
+#define lbnMontSquareLazy_32(prod, n, mod, len, inv) \
+	(lbnSquare_32(prod, n, len), lbnMontReduceLazy_32(prod, mod, len, inv))
+#endif /* !lbnMontSquareLazy_32 */
+
 /*
  * Convert a number to Montgomery form - requires mlen + nlen words
  * of memory in "n".
@@ -2573,6 +2935,213 @@ yield:
 	return y;	/* Success */
 }
 
+/*
+ * Constant time modular exponentiation.
+ *
+ * lbnExpMod_32 above uses a sliding window: which squarings and multiplies
+ * it does, and which table entries it reads, depend on the bits of the
+ * exponent.  lbnExpModCT_32 uses a fixed window of wbits bits instead.  It
+ * does wbits squarings and one multiply for each window of the exponent,
+ * also for windows of zero bits, and the final subtraction of the
+ * Montgomery steps does the same operations whether it subtracts or not.
+ *
+ * The table holds all 2^wbits powers of n, scattered: word j of entry i
+ * is at table[j*entries + i], thus an entry is spread over the cache
+ * lines of the table.  The gather reads all entries and selects the
+ * words of the wanted entry with masks, thus the memory accesses do not
+ * depend on the exponent either.
+ *
+ * lbnExpModCT_32 always processes "ebits" exponent bits, the exponent must
+ * not have more bits.  The workspace "ws" is a plain array of
+ * lbnExpModCTSize_32(mlen, ebits) words, the caller allocates it once and
+ * can use it for many exponentiations, lbnExpModCT_32 does not allocate
+ * memory.
+ */
+#define BNEXPMODCT_MAX_WINDOW 5
+static unsigned const bnExpModCTThreshTable[] = {
+	96, 320, (unsigned)-1
+};
+
+/* The window size for exponents of "ebits" bits, 3 up to 5 bits */
+static unsigned
+lbnExpModCTWindow_32(unsigned ebits)
+{
+	unsigned wbits = 0;
+
+	while (ebits > bnExpModCTThreshTable[wbits])
+		wbits++;
+	return wbits + 3;
+}
+
+/*
+ * The size of the workspace in words: the table, two product buffers,
+ * the gather buffer, and the padding to align the table to 64 bytes.
+ */
+unsigned
+lbnExpModCTSize_32(unsigned mlen, unsigned ebits)
+{
+	unsigned entries = 1u << lbnExpModCTWindow_32(ebits);
+
+	return (entries + 5) * mlen + 64 / sizeof(BNWORD32);
+}
+
+/* Store "src" as entry "index" of the scattered table */
+static void
+lbnExpModCTScatter_32(BNWORD32 *table, unsigned entries,
+	BNWORD32 const *src, unsigned mlen, unsigned index)
+{
+	table += index;
+	while (mlen--) {
+		*table = BIGLITTLE(*--src,*src++);
+		table += entries;
+	}
+}
+
+/* Read entry "index" of the scattered table, reading all entries */
+static void
+lbnExpModCTGather_32(BNWORD32 *dest, BNWORD32 const *table, unsigned entries,
+	unsigned mlen, unsigned index)
+{
+	BNWORD32 mask[1 << BNEXPMODCT_MAX_WINDOW];
+	BNWORD32 w;
+	unsigned i, x;
+
+	for (i = 0; i < entries; i++) {
+		x = i ^ index;
+		/* All ones if x is 0, else 0 */
+		mask[i] = (BNWORD32)0 -
+		          (BNWORD32)(((x - 1) & ~x) >> (sizeof(x)*8 - 1));
+	}
+	while (mlen--) {
+		w = 0;
+		for (i = 0; i < entries; i++)
+			w |= table[i] & mask[i];
+		BIGLITTLE(*--dest,*dest++) = w;
+		table += entries;
+	}
+}
+
+/*
+ * Get the "wbits" bits of "e" that start at bit "pos", the bits above
+ * the "elen" words of e are 0.  This depends on pos, not on the bits.
+ */
+static unsigned
+lbnExpModCTBits_32(BNWORD32 const *e, unsigned elen, unsigned pos,
+	unsigned wbits)
+{
+	unsigned bits = 0;
+	unsigned k;
+
+	while (wbits--) {
+		k = pos + wbits;
+		bits <<= 1;
+		if (k / 32 < elen)
+			bits |= (unsigned)(BIGLITTLE(e[-1-(int)(k/32)],e[k/32])
+			                   >> (k % 32)) & 1;
+	}
+	return bits;
+}
+
+int
+lbnExpModCT_32(BNWORD32 *result, BNWORD32 const *n, unsigned nlen,
+	BNWORD32 const *e, unsigned elen, unsigned ebits,
+	BNWORD32 *mod, unsigned mlen, BNWORD32 *ws)
+{
+	BNWORD32 *table;	/* Scattered powers of n */
+	BNWORD32 *a, *b;	/* Working buffers/accumulators */
+	BNWORD32 *g;		/* Gathered table entry */
+	BNWORD32 *t;		/* Pointer into the working buffers */
+	BNWORD32 inv;		/* mod^-1 modulo 2^32 */
+	BNWORD32 carry;		/* Carry of the lazy Montgomery steps */
+	unsigned wbits;		/* Window size */
+	unsigned entries;	/* Table entries, 2^wbits */
+	unsigned pos;		/* Exponent bit of the current window */
+	unsigned i;
+
+	assert(mlen);
+	assert(nlen <= mlen);
+	assert(ebits);
+	assert(lbnBits_32(e, elen) <= ebits);
+
+	wbits = lbnExpModCTWindow_32(ebits);
+	entries = 1u << wbits;
+
+	/* Align the table, it is the first part of the workspace */
+	while ((size_t)ws & 63)
+		ws++;
+	table = ws;
+	ws += entries * mlen;
+	a = BIGLITTLE(ws + 2*mlen, ws);
+	b = a + 2*mlen;
+	g = BIGLITTLE(b + mlen, b + 2*mlen);
+
+	/* Compute the necessary modular inverse */
+	inv = lbnMontInv1_32(mod[BIGLITTLE(-1,0)]);	/* LSW of modulus */
+
+	/* Entry 0 is the Montgomery form of 1, R mod "mod" */
+	t = BIGLITTLE(a-mlen, a+mlen);
+	lbnZero_32(a, 2*mlen);
+	BIGLITTLE(t[-1],t[0]) = 1;
+	(void)lbnDiv_32(t, a, mlen+1, mod, mlen);
+	lbnExpModCTScatter_32(table, entries, a, mlen, 0);
+
+	/* Entry 1 is the Montgomery form of n, keep a copy in g */
+	lbnCopy_32(t, n, nlen);
+	lbnZero_32(a, mlen);
+	(void)lbnDiv_32(t, a, mlen+nlen, mod, mlen);
+	lbnExpModCTScatter_32(table, entries, a, mlen, 1);
+	lbnCopy_32(g, a, mlen);
+	lbnCopy_32(BIGLITTLE(b-mlen, b+mlen), a, mlen);
+
+	/* The other entries, the accumulator is the high half of b */
+	for (i = 2; i < entries; i++) {
+		carry = lbnMontMulLazy_32(a, BIGLITTLE(b-mlen, b+mlen), g,
+		                          mod, mlen, inv);
+		t = BIGLITTLE(a-mlen, a+mlen);
+		lbnMontFinalCT_32(t, mod, mlen, carry);
+		lbnExpModCTScatter_32(table, entries, t, mlen, i);
+		/* Swap a and b */
+		t = a; a = b; b = t;
+	}
+
+	/* Start with the most significant window */
+	pos = (ebits + wbits - 1) / wbits * wbits - wbits;
+	lbnExpModCTGather_32(BIGLITTLE(b-mlen, b+mlen), table, entries, mlen,
+	                     lbnExpModCTBits_32(e, elen, pos, wbits));
+
+	while (pos) {
+		pos -= wbits;
+		for (i = 0; i < wbits; i++) {
+			carry = lbnMontSquareLazy_32(a, BIGLITTLE(b-mlen, b+mlen),
+			                             mod, mlen, inv);
+			lbnMontFinalCT_32(BIGLITTLE(a-mlen, a+mlen), mod, mlen,
+			                  carry);
+			t = a; a = b; b = t;
+		}
+		lbnExpModCTGather_32(g, table, entries, mlen,
+		                     lbnExpModCTBits_32(e, elen, pos, wbits));
+		carry = lbnMontMulLazy_32(a, BIGLITTLE(b-mlen, b+mlen), g,
+		                          mod, mlen, inv);
+		lbnMontFinalCT_32(BIGLITTLE(a-mlen, a+mlen), mod, mlen, carry);
+		t = a; a = b; b = t;
+	}
+
+	/* Convert result out of Montgomery form */
+	t = BIGLITTLE(b-mlen, b+mlen);
+	lbnCopy_32(b, t, mlen);
+	lbnZero_32(t, mlen);
+	carry = lbnMontReduceLazy_32(b, mod, mlen, inv);
+	lbnMontFinalCT_32(t, mod, mlen, carry);
+	lbnCopy_32(result, t, mlen);
+
+	/* The intermediate values tell about the exponent, wipe them */
+	lbnZero_32(a, 2*mlen);
+	lbnZero_32(b, 2*mlen);
+	lbnZero_32(g, mlen);
+
+	return 0;
+}
+
 /*
  * Compute and return n1^e1 * n2^e2 mod "mod".
  * result may be either input buffer, or something separate.
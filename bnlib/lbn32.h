@@ -60,6 +60,10 @@ BNWORD32 lbnRshift_32(BNWORD32 *num, unsigned len, unsigned shift);
 void lbnMul_32(BNWORD32 *prod, BNWORD32 const *num1, unsigned len1,
 	BNWORD32 const *num2, unsigned len2);
 #endif
+#ifndef lbnMulX_32
+void lbnMulX_32(BNWORD32 *prod, BNWORD32 const *num1, BNWORD32 const *num2,
+	unsigned len);
+#endif
 #ifndef lbnSquare_32
 void lbnSquare_32(BNWORD32 *prod, BNWORD32 const *num, unsigned len);
 #endif
@@ -121,6 +125,10 @@ void lbnFromMont_32(BNWORD32 *n, BNWORD32 *mod, unsigned len);
 int lbnExpMod_32(BNWORD32 *result, BNWORD32 const *n, unsigned nlen,
 	BNWORD32 const *exp, unsigned elen, BNWORD32 *mod, unsigned mlen);
 #endif
+unsigned lbnExpModCTSize_32(unsigned mlen, unsigned ebits);
+int lbnExpModCT_32(BNWORD32 *result, BNWORD32 const *n, unsigned nlen,
+	BNWORD32 const *exp, unsigned elen, unsigned ebits,
+	BNWORD32 *mod, unsigned mlen, BNWORD32 *ws);
 #ifndef lbnDoubleExpMod_32
 int lbnDoubleExpMod_32(BNWORD32 *result,
 	BNWORD32 const *n1, unsigned n1len, BNWORD32 const *e1, unsigned e1len,
@@ -0,0 +1,11 @@
+/*
+ * lbn32rt.c - the 32-bit lbn package next to the one lbn00.c picks, for
+ * the run time word size selection in bninit00.c.  Empty if lbn00.c
+ * already uses the 32-bit package.
+ */
+
+#include "bnsize00.h"
+
+#if BNSIZE64
+#include "lbn32.c"
+#endif
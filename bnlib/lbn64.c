@@ -135,8 +135,17 @@ extern int (*bnYield)(void);	/* From bn.c */
  * one of my pet peeves about math libraries.  I'm sorry.)
  */
 #ifndef PRODUCT_SCAN
+#ifdef BNWORD128
+/*
+ * With a native 128-bit type (unsigned __int128, see lbn.h) the product
+ * scanning code keeps the accumulator in registers and is noticeably
+ * faster than the operand scanning code, thus use it.
+ */
+#define PRODUCT_SCAN 1
+#else
 #define PRODUCT_SCAN 0
 #endif
+#endif
 
 /*
  * Copy an array of words.  <Marvin mode on>  Thrilling, isn't it? </Marvin>
@@ -740,8 +749,8 @@ lbnRshift_64(BNWORD64 *num, unsigned len, unsigned shift)
  * provided that the low len1 bits of prod are free.  (This corresponds
  * nicely to the place the result is returned from lbnMontReduce_64.)
  *
- * TODO: Use Karatsuba multiply.  The overlap constraints may have
- * to get rewhacked.
+ * The overlap prevents a Karatsuba multiply here, the multiply of two
+ * numbers of the same length, lbnMulX_64, uses it.
  */
 #ifndef lbnMul_64
 void
@@ -782,7 +791,7 @@ lbnMul_64(BNWORD64 *prod, BNWORD64 const *num1, unsigned len1,
  * to make the C code slower, so PRODUCT_SCAN is not defined.
  */
 static void
-lbnMulX_64(BNWORD64 *prod, BNWORD64 const *num1, BNWORD64 const *num2,
+lbnMulXBase_64(BNWORD64 *prod, BNWORD64 const *num1, BNWORD64 const *num2,
 	unsigned len)
 {
 	BNWORD128 x, y;
@@ -829,10 +838,263 @@ lbnMulX_64(BNWORD64 *prod, BNWORD64 const *num1, BNWORD64 const *num2,
 }
 #else /* !defined(BNWORD128) || !PRODUCT_SCAN */
 /* Default trivial macro definition */
-#define lbnMulX_64(prod, num1, num2, len) lbnMul_64(prod, num1, len, num2, len)
+#define lbnMulXBase_64(prod, num1, num2, len) \
+	lbnMul_64(prod, num1, len, num2, len)
 #endif /* !defined(BNWORD128) || !PRODUCT_SCAN */
 #endif /* !lbmMulX_64 */
 
+/*
+ * Karatsuba multiply and square.  Split both numbers of length "len" in
+ * a low half of h = (len+1)/2 words and a high half of l = len-h words,
+ * a = a1*W + a0 and b = b1*W + b0 with W = 2^(64*h), then
+ *
+ *   a*b = a1*b1 * W^2 + (a0*b0 + a1*b1 - (a0-a1)*(b0-b1)) * W + a0*b0
+ *
+ * needs three multiplies of half the length instead of four.  The
+ * multiplies below BN_KARATSUBA_MUL_64 words use the schoolbook code,
+ * the squares below BN_KARATSUBA_SQUARE_64 words likewise.  The best
+ * thresholds depend on the CPU and the compiler, the defaults are the
+ * result of some timing on x86-64.  Define BN_KARATSUBA_MAX_64 as 0 to
+ * turn Karatsuba off.
+ *
+ * The Karatsuba code needs a scratch area of about 6*len words, it
+ * lives on the stack, thus only numbers up to BN_KARATSUBA_MAX_64 words
+ * use it.  The default covers 8192-bit numbers.
+ *
+ * The Karatsuba code does the same operations for all numbers of
+ * the same length, the signs of the differences select the values
+ * with masks, not with branches.
+ */
+#ifndef BN_KARATSUBA_MUL_64
+#define BN_KARATSUBA_MUL_64 24
+#endif
+#ifndef BN_KARATSUBA_SQUARE_64
+#define BN_KARATSUBA_SQUARE_64 96
+#endif
+#ifndef BN_KARATSUBA_MAX_64
+#define BN_KARATSUBA_MAX_64 (8192/64)
+#endif
+
+#if BN_KARATSUBA_MAX_64 && (!defined(lbnMulX_64) || !defined(lbnSquare_64))
+#if BN_KARATSUBA_MUL_64 < 8 || BN_KARATSUBA_SQUARE_64 < 8
+#error The Karatsuba thresholds must be at least 8 words
+#endif
+
+#define BN_KARATSUBA_SCRATCH_64 (6*BN_KARATSUBA_MAX_64 + 64)
+
+/*
+ * Add the single-word "carry" to all "len" words of "num", return the
+ * carry out.  Unlike lbnAdd1_64 this does not stop early.
+ */
+static BNWORD64
+lbnKaraCarry_64(BNWORD64 *num, unsigned len, BNWORD64 carry)
+{
+	BNWORD64 t;
+
+	while (len--) {
+		t = BIGLITTLE(*--num,*num) + carry;
+		carry = (t < carry);
+		BIGLITTLE(*num,*num++) = t;
+	}
+	return carry;
+}
+
+/*
+ * Negate "num" modulo 2^(64*len) if "mask" is all ones, leave it
+ * unchanged if "mask" is 0.
+ */
+static void
+lbnKaraCondNeg_64(BNWORD64 *num, unsigned len, BNWORD64 mask)
+{
+	BNWORD64 t;
+	BNWORD64 carry = mask & 1;
+
+	while (len--) {
+		t = (BIGLITTLE(*--num,*num) ^ mask) + carry;
+		carry = (t < carry);
+		BIGLITTLE(*num,*num++) = t;
+	}
+}
+
+/*
+ * Store |num1 - num2| in the "len" words of "diff".  num1 has "len"
+ * words, num2 has "len2" words, len2 is len or len-1.  Return all ones
+ * if num1 < num2, else 0.
+ */
+static BNWORD64
+lbnKaraDiff_64(BNWORD64 *diff, BNWORD64 const *num1, unsigned len,
+	BNWORD64 const *num2, unsigned len2)
+{
+	BNWORD64 borrow, t;
+
+	lbnCopy_64(diff, num1, len);
+	borrow = lbnSubN_64(diff, num2, len2);
+	if (len2 < len) {
+		t = BIGLITTLE(diff[-(int)len], diff[len-1]);
+		BIGLITTLE(diff[-(int)len], diff[len-1]) = t - borrow;
+		borrow = (t < borrow);
+	}
+	borrow = 0 - borrow;
+	lbnKaraCondNeg_64(diff, len, borrow);
+	return borrow;
+}
+
+/*
+ * Add the middle product "sum", 2*h+1 words, to "prod", 2*len words,
+ * at word h.
+ */
+static void
+lbnKaraAddMid_64(BNWORD64 *prod, unsigned len, BNWORD64 const *sum, unsigned h)
+{
+	BNWORD64 carry;
+
+	carry = lbnAddN_64(BIGLITTLE(prod-h,prod+h), sum, 2*h+1);
+	(void)lbnKaraCarry_64(BIGLITTLE(prod-3*h-1,prod+3*h+1), 2*len-3*h-1,
+	                      carry);
+}
+
+/*
+ * Store z0 + z2 in "sum", 2*h+1 words.  z0 are the low 2*h words of
+ * "prod", z2 the 2*l words that follow.
+ */
+static void
+lbnKaraSum_64(BNWORD64 *sum, BNWORD64 const *prod, unsigned h, unsigned l)
+{
+	BNWORD64 carry;
+
+	lbnCopy_64(sum, prod, 2*h);
+	BIGLITTLE(sum[-2*(int)h-1], sum[2*h]) = 0;
+	carry = lbnAddN_64(sum, BIGLITTLE(prod-2*h,prod+2*h), 2*l);
+	(void)lbnKaraCarry_64(BIGLITTLE(sum-2*l,sum+2*l), 2*(h-l)+1, carry);
+}
+#endif /* BN_KARATSUBA_MAX_64 */
+
+#ifndef lbnMulX_64
+#if BN_KARATSUBA_MAX_64
+/*
+ * Karatsuba multiply of num1 and num2, "len" words each, product in
+ * the 2*len words of "prod".  "scratch" must not overlap the other
+ * arrays.
+ */
+static void
+lbnKaraMul_64(BNWORD64 *prod, BNWORD64 const *num1, BNWORD64 const *num2,
+	unsigned len, BNWORD64 *scratch)
+{
+	BNWORD64 *d1, *d2, *mid, *sum, *next;
+	BNWORD64 sign;
+	unsigned h, l;
+
+	if (len < BN_KARATSUBA_MUL_64) {
+		lbnMulXBase_64(prod, num1, num2, len);
+		return;
+	}
+	h = (len+1)/2;
+	l = len-h;
+
+	/* Scratch: d1 and d2 h words, mid and sum 2*h+1 words */
+	d1 = scratch;
+	d2 = BIGLITTLE(d1-h,d1+h);
+	mid = BIGLITTLE(d2-h,d2+h);
+	sum = BIGLITTLE(mid-2*h-1,mid+2*h+1);
+	next = BIGLITTLE(sum-2*h-1,sum+2*h+1);
+
+	sign = lbnKaraDiff_64(d1, num1, h, BIGLITTLE(num1-h,num1+h), l) ^
+	       lbnKaraDiff_64(d2, num2, h, BIGLITTLE(num2-h,num2+h), l);
+
+	/* z0 = a0*b0 and z2 = a1*b1 go to their place in the product */
+	lbnKaraMul_64(prod, num1, num2, h, next);
+	lbnKaraMul_64(BIGLITTLE(prod-2*h,prod+2*h), BIGLITTLE(num1-h,num1+h),
+	              BIGLITTLE(num2-h,num2+h), l, next);
+	lbnKaraMul_64(mid, d1, d2, h, next);
+	BIGLITTLE(mid[-2*(int)h-1], mid[2*h]) = 0;
+
+	/*
+	 * (a0-a1)*(b0-b1) = |d1|*|d2| if the signs are equal, subtract
+	 * it in this case, else add it.
+	 */
+	lbnKaraSum_64(sum, prod, h, l);
+	lbnKaraCondNeg_64(mid, 2*h+1, ~sign);
+	(void)lbnAddN_64(sum, mid, 2*h+1);
+
+	lbnKaraAddMid_64(prod, len, sum, h);
+}
+#endif /* BN_KARATSUBA_MAX_64 */
+
+/*
+ * Multiply num1 and num2 of length "len", product in the 2*len words of
+ * "prod".  There may not be any overlap of the input and output.
+ */
+void
+lbnMulX_64(BNWORD64 *prod, BNWORD64 const *num1, BNWORD64 const *num2,
+	unsigned len)
+{
+#if BN_KARATSUBA_MAX_64
+	if (len >= BN_KARATSUBA_MUL_64 && len <= BN_KARATSUBA_MAX_64) {
+		BNWORD64 scratch[BN_KARATSUBA_SCRATCH_64];
+
+		lbnKaraMul_64(prod, num1, num2, len,
+		    BIGLITTLE(scratch+BN_KARATSUBA_SCRATCH_64,scratch));
+		return;
+	}
+#endif
+	lbnMulXBase_64(prod, num1, num2, len);
+}
+#define lbnMulX_64 lbnMulX_64
+#endif /* !lbnMulX_64 */
+
+/*
+ * Finish a Montgomery reduction: subtract "mod" from the "mlen" words of
+ * "n" and the "carry" word above them until the result is less than
+ * "mod".
+ */
+static void
+lbnMontFinal_64(BNWORD64 *n, BNWORD64 const *mod, unsigned mlen,
+	BNWORD64 carry)
+{
+	while (carry)
+		carry -= lbnSubN_64(n, mod, mlen);
+	while (lbnCmp_64(n, mod, mlen) >= 0)
+		(void)lbnSubN_64(n, mod, mlen);
+}
+
+/*
+ * Like lbnMontFinal_64, but the number must be less than 2*mod, which is
+ * true for the results of a Montgomery multiply of numbers less than
+ * mod.  This subtracts mod once or not at all, and it does the same
+ * operations in both cases: the time does not depend on the values.
+ */
+static void
+lbnMontFinalCT_64(BNWORD64 *n, BNWORD64 const *mod, unsigned mlen,
+	BNWORD64 carry)
+{
+	BNWORD64 const *pm = mod;
+	BNWORD64 *pn = n;
+	BNWORD64 borrow = 0;
+	BNWORD64 mask, x, y, t;
+	unsigned i;
+
+	/* Get the borrow of n - mod */
+	for (i = 0; i < mlen; i++) {
+		x = BIGLITTLE(*--pn,*pn++);
+		y = BIGLITTLE(*--pm,*pm++);
+		t = x - y;
+		borrow = (x < y) | (t < borrow);
+	}
+
+	/* Subtract mod if there is a carry or if n >= mod */
+	mask = (BNWORD64)0 - (carry | (borrow ^ 1));
+	pm = mod;
+	pn = n;
+	borrow = 0;
+	for (i = 0; i < mlen; i++) {
+		x = BIGLITTLE(pn[-1],*pn);
+		y = BIGLITTLE(*--pm,*pm++) & mask;
+		t = x - y;
+		BIGLITTLE(*--pn,*pn++) = t - borrow;
+		borrow = (x < y) | (t < borrow);
+	}
+}
+
 #if !defined(lbnMontMul_64) && defined(BNWORD128) && PRODUCT_SCAN
 /*
  * Test code for product-scanning multiply.  This seems to slow the C
@@ -847,9 +1109,12 @@ lbnMulX_64(BNWORD64 *prod, BNWORD64 const *num1, BNWORD64 const *num2,
  * The second half multiplies the upper half, adding in the modulus
  * times the Montgomery multipliers.  The results of this multiply
  * are stored.
+ *
+ * The result in the high half of prod and the returned carry word are
+ * less than 2*mod, see lbnMontFinal_64.
  */
-static void
-lbnMontMul_64(BNWORD64 *prod, BNWORD64 const *num1, BNWORD64 const *num2,
+static BNWORD64
+lbnMontMulLazy_64(BNWORD64 *prod, BNWORD64 const *num1, BNWORD64 const *num2,
 	BNWORD64 const *mod, unsigned len, BNWORD64 inv)
 {
 	BNWORD128 x, y;
@@ -861,7 +1126,7 @@ lbnMontMul_64(BNWORD64 *prod, BNWORD64 const *num1, BNWORD64 const *num2,
 
 	/* Special case of zero */
 	if (!len)
-		return;
+		return 0;
 
 	/*
 	 * This computes directly into the high half of prod, so just
@@ -931,12 +1196,17 @@ lbnMontMul_64(BNWORD64 *prod, BNWORD64 const *num1, BNWORD64 const *num2,
 
 	/* Last round of second half, simplified. */
 	BIGLITTLE(*(prod-len),*(prod+len-1)) = (BNWORD64)x;
-	carry = (x >> 64);
+	return (BNWORD64)(x >> 64);
+}
+#define lbnMontMulLazy_64 lbnMontMulLazy_64
 
-	while (carry)
-		carry -= lbnSubN_64(prod, mod, len);
-	while (lbnCmp_64(prod, mod, len) >= 0)
-		(void)lbnSubN_64(prod, mod, len);
+static void
+lbnMontMul_64(BNWORD64 *prod, BNWORD64 const *num1, BNWORD64 const *num2,
+	BNWORD64 const *mod, unsigned len, BNWORD64 inv)
+{
+	BNWORD64 carry = lbnMontMulLazy_64(prod, num1, num2, mod, len, inv);
+
+	lbnMontFinal_64(BIGLITTLE(prod-len,prod+len), mod, len, carry);
 }
 /* Suppress later definition */
 #define lbnMontMul_64 lbnMontMul_64
@@ -947,8 +1217,8 @@ lbnMontMul_64(BNWORD64 *prod, BNWORD64 const *num1, BNWORD64 const *num2,
  * Trial code for product-scanning squaring.  This seems to slow the C
  * code down rather than speed it up.
  */
-void
-lbnSquare_64(BNWORD64 *prod, BNWORD64 const *num, unsigned len)
+static void
+lbnSquareBase_64(BNWORD64 *prod, BNWORD64 const *num, unsigned len)
 {
 	BNWORD128 x, y, z;
 	BNWORD64 const *p1, *p2;
@@ -1021,7 +1291,7 @@ lbnSquare_64(BNWORD64 *prod, BNWORD64 const *num, unsigned len)
 	BIGLITTLE(*--prod,*prod) = (BNWORD64)x;
 }
 /* Suppress later definition */
-#define lbnSquare_64 lbnSquare_64
+#define lbnSquareBase_64 lbnSquareBase_64
 #endif
 
 /*
@@ -1062,11 +1332,10 @@ lbnSquare_64(BNWORD64 *prod, BNWORD64 const *num, unsigned len)
  * input, so it doesn't need special care.
  *
  * TODO: Merge the shift by 1 with the squaring loop.
- * TODO: Use Karatsuba.  (a*W+b)^2 = a^2 * (W^2+W) + b^2 * (W+1) - (a-b)^2 * W.
  */
-#ifndef lbnSquare_64
-void
-lbnSquare_64(BNWORD64 *prod, BNWORD64 const *num, unsigned len)
+#if !defined(lbnSquare_64) && !defined(lbnSquareBase_64)
+static void
+lbnSquareBase_64(BNWORD64 *prod, BNWORD64 const *num, unsigned len)
 {
 	BNWORD64 t;
 	BNWORD64 *prodx = prod;		/* Working copy of the argument */
@@ -1118,6 +1387,73 @@ lbnSquare_64(BNWORD64 *prod, BNWORD64 const *num, unsigned len)
 	/* And set the low bit appropriately */
 	BIGLITTLE(prod[-1],prod[0]) |= BIGLITTLE(num[-1],num[0]) & 1;
 }
+#endif /* !lbnSquare_64 && !lbnSquareBase_64 */
+
+#ifndef lbnSquare_64
+#if BN_KARATSUBA_MAX_64
+/*
+ * Karatsuba square of "num", "len" words, result in the 2*len words
+ * of "prod".  With a = a1*W + a0 as in lbnKaraMul_64
+ *
+ *   a^2 = a1^2 * W^2 + (a0^2 + a1^2 - (a0-a1)^2) * W + a0^2
+ *
+ * "scratch" must not overlap the other arrays.
+ */
+static void
+lbnKaraSquare_64(BNWORD64 *prod, BNWORD64 const *num, unsigned len,
+	BNWORD64 *scratch)
+{
+	BNWORD64 *d, *mid, *sum, *next;
+	BNWORD64 borrow;
+	unsigned h, l;
+
+	if (len < BN_KARATSUBA_SQUARE_64) {
+		lbnSquareBase_64(prod, num, len);
+		return;
+	}
+	h = (len+1)/2;
+	l = len-h;
+
+	/* Scratch: d h words, mid 2*h words and sum 2*h+1 words */
+	d = scratch;
+	mid = BIGLITTLE(d-h,d+h);
+	sum = BIGLITTLE(mid-2*h,mid+2*h);
+	next = BIGLITTLE(sum-2*h-1,sum+2*h+1);
+
+	(void)lbnKaraDiff_64(d, num, h, BIGLITTLE(num-h,num+h), l);
+
+	lbnKaraSquare_64(prod, num, h, next);
+	lbnKaraSquare_64(BIGLITTLE(prod-2*h,prod+2*h), BIGLITTLE(num-h,num+h),
+	                 l, next);
+	lbnKaraSquare_64(mid, d, h, next);
+
+	/* The middle product is not negative, thus the borrow fits */
+	lbnKaraSum_64(sum, prod, h, l);
+	borrow = lbnSubN_64(sum, mid, 2*h);
+	BIGLITTLE(sum[-2*(int)h-1], sum[2*h]) -= borrow;
+
+	lbnKaraAddMid_64(prod, len, sum, h);
+}
+#endif /* BN_KARATSUBA_MAX_64 */
+
+/*
+ * Square a number, see lbnSquareBase_64.  There may not be any overlap
+ * of the input and output.
+ */
+void
+lbnSquare_64(BNWORD64 *prod, BNWORD64 const *num, unsigned len)
+{
+#if BN_KARATSUBA_MAX_64
+	if (len >= BN_KARATSUBA_SQUARE_64 && len <= BN_KARATSUBA_MAX_64) {
+		BNWORD64 scratch[BN_KARATSUBA_SCRATCH_64];
+
+		lbnKaraSquare_64(prod, num, len,
+		    BIGLITTLE(scratch+BN_KARATSUBA_SCRATCH_64,scratch));
+		return;
+	}
+#endif
+	lbnSquareBase_64(prod, num, len);
+}
 #endif /* !lbnSquare_64 */
 
 /*
@@ -1848,7 +2184,7 @@ lbnMontInv1_64(BNWORD64 const x)
 }
 #endif /* !lbnMontInv1_64 */
 
-#if defined(BNWORD128) && PRODUCT_SCAN
+#if defined(BNWORD128) && PRODUCT_SCAN && !defined(lbnMontReduceLazy_64)
 /*
  * Test code for product-scanning Montgomery reduction.
  * This seems to slow the C code down rather than speed it up.
@@ -1859,9 +2195,12 @@ lbnMontInv1_64(BNWORD64 const x)
  * The second half multiplies the upper half, adding in the modulus
  * times the Montgomery multipliers.  The results of this multiply
  * are stored.
+ *
+ * This is the lazy reduction, see lbnMontReduceLazy_64 below.
  */
-void
-lbnMontReduce_64(BNWORD64 *n, BNWORD64 const *mod, unsigned mlen, BNWORD64 inv)
+static BNWORD64
+lbnMontReduceLazy_64(BNWORD64 *n, BNWORD64 const *mod, unsigned mlen,
+	BNWORD64 inv)
 {
 	BNWORD128 x, y;
 	BNWORD64 const *pm;
@@ -1872,7 +2211,7 @@ lbnMontReduce_64(BNWORD64 *n, BNWORD64 const *mod, unsigned mlen, BNWORD64 inv)
 
 	/* Special case of zero */
 	if (!mlen)
-		return;
+		return 0;
 
 	/* Pass 1 - compute Montgomery multipliers */
 	/* First iteration can have certain simplifications. */
@@ -1931,14 +2270,9 @@ lbnMontReduce_64(BNWORD64 *n, BNWORD64 const *mod, unsigned mlen, BNWORD64 inv)
 	t = BIGLITTLE(*(n-mlen),*(n+mlen-1));
 	x += t;
 	BIGLITTLE(*(n-mlen),*(n+mlen-1)) = (BNWORD64)x;
-	carry = (unsigned)(x >> 64);
-
-	while (carry)
-		carry -= lbnSubN_64(n, mod, mlen);
-	while (lbnCmp_64(n, mod, mlen) >= 0)
-		(void)lbnSubN_64(n, mod, mlen);
+	return (BNWORD64)(x >> 64);
 }
-#define lbnMontReduce_64 lbnMontReduce_64
+#define lbnMontReduceLazy_64 lbnMontReduceLazy_64
 #endif
 
 /*
@@ -2002,13 +2336,17 @@ lbnMontReduce_64(BNWORD64 *n, BNWORD64 const *mod, unsigned mlen, BNWORD64 inv)
  * 
  * TODO: Change to a full inverse and use Karatsuba's multiplication
  * rather than this word-at-a-time.
+ *
+ * lbnMontReduceLazy_64 does not subtract m at the end, it returns the
+ * carry word above the result instead.  The result and the carry are
+ * less than 2*m, see lbnMontFinal_64 and lbnMontFinalCT_64.
  */
-#ifndef lbnMontReduce_64
-void
-lbnMontReduce_64(BNWORD64 *n, BNWORD64 const *mod, unsigned const mlen,
+#ifndef lbnMontReduceLazy_64
+static BNWORD64
+lbnMontReduceLazy_64(BNWORD64 *n, BNWORD64 const *mod, unsigned const mlen,
                 BNWORD64 inv)
 {
-	BNWORD64 t;
+	BNWORD64 t, x;
 	BNWORD64 c = 0;
 	unsigned len = mlen;
 
@@ -2017,12 +2355,34 @@ lbnMontReduce_64(BNWORD64 *n, BNWORD64 const *mod, unsigned const mlen,
 
 	assert(len);
 
+	/*
+	 * Add the carry out of each step to the word above the low-order
+	 * part, the carry out of this add goes to the next word, where the
+	 * next step adds its carry out.  There is no carry loop, thus the
+	 * time does not depend on the values.
+	 */
 	do {
 		t = lbnMulAdd1_64(n, mod, mlen, inv * BIGLITTLE(n[-1],n[0]));
-		c += lbnAdd1_64(BIGLITTLE(n-mlen,n+mlen), len, t);
+		x = BIGLITTLE(*(n-mlen-1),*(n+mlen)) + c;
+		c = (x < c);
+		x += t;
+		c += (x < t);
+		BIGLITTLE(*(n-mlen-1),*(n+mlen)) = x;
 		BIGLITTLE(--n,++n);
 	} while (--len);
 
+	return c;
+}
+#define lbnMontReduceLazy_64 lbnMontReduceLazy_64
+#endif /* !lbnMontReduceLazy_64 */
+
+#ifndef lbnMontReduce_64
+void
+lbnMontReduce_64(BNWORD64 *n, BNWORD64 const *mod, unsigned const mlen,
+                BNWORD64 inv)
+{
+	BNWORD64 c = lbnMontReduceLazy_64(n, mod, mlen, inv);
+
 	/*
 	 * All that adding can cause an overflow past the modulus size,
 	 * but it's unusual, and never by much, so a subtraction loop
@@ -2030,10 +2390,7 @@ lbnMontReduce_64(BNWORD64 *n, BNWORD64 const *mod, unsigned const mlen,
 	 * This subtraction happens infrequently - I've only ever seen it
 	 * invoked once per reduction, and then just under 22.5% of the time.
 	 */
-	while (c)
-		c -= lbnSubN_64(n, mod, mlen);
-	while (lbnCmp_64(n, mod, mlen) >= 0)
-		(void)lbnSubN_64(n, mod, mlen);
+	lbnMontFinal_64(BIGLITTLE(n-mlen,n+mlen), mod, mlen, c);
 }
 #endif /* !lbnMontReduce_64 */
 
@@ -2070,6 +2427,20 @@ lbnMontReduce_64(BNWORD64 *n, BNWORD64 const *mod, unsigned const mlen,
 	
 #endif /* !lbnMontSquare_64 */
 
+/*
+ * The lazy versions of lbnMontMul_64 and lbnMontSquare_64 return the carry
+ * word above the result, see lbnMontReduceLazy_64.
+ */
+#ifndef lbnMontMulLazy_64
+#define lbnMontMulLazy_64(prod, n1, n2, mod, len, inv) \
+	(lbnMulX_64(prod, n1, n2, len), lbnMontReduceLazy_64(prod, mod, len, inv))
+#endif /* !lbnMontMulLazy_64 */
+
+#ifndef lbnMontSquareLazy_64
+#define lbnMontSquareLazy_64(prod, n, mod, len, inv) \
+	(lbnSquare_64(prod, n, len), lbnMontReduceLazy_64(prod, mod, len, inv))
+#endif /* !lbnMontSquareLazy_64 */
+
 /*
  * Convert a number to Montgomery form - requires mlen + nlen words
  * of memory in "n".
@@ -2573,6 +2944,213 @@ yield:
 	return y;	/* Success */
 }
 
+/*
+ * Constant time modular exponentiation.
+ *
+ * lbnExpMod_64 above uses a sliding window: which squarings and multiplies
+ * it does, and which table entries it reads, depend on the bits of the
+ * exponent.  lbnExpModCT_64 uses a fixed window of wbits bits instead.  It
+ * does wbits squarings and one multiply for each window of the exponent,
+ * also for windows of zero bits, and the final subtraction of the
+ * Montgomery steps does the same operations whether it subtracts or not.
+ *
+ * The table holds all 2^wbits powers of n, scattered: word j of entry i
+ * is at table[j*entries + i], thus an entry is spread over the cache
+ * lines of the table.  The gather reads all entries and selects the
+ * words of the wanted entry with masks, thus the memory accesses do not
+ * depend on the exponent either.
+ *
+ * lbnExpModCT_64 always processes "ebits" exponent bits, the exponent must
+ * not have more bits.  The workspace "ws" is a plain array of
+ * lbnExpModCTSize_64(mlen, ebits) words, the caller allocates it once and
+ * can use it for many exponentiations, lbnExpModCT_64 does not allocate
+ * memory.
+ */
+#define BNEXPMODCT_MAX_WINDOW 5
+static unsigned const bnExpModCTThreshTable[] = {
+	96, 320, (unsigned)-1
+};
+
+/* The window size for exponents of "ebits" bits, 3 up to 5 bits */
+static unsigned
+lbnExpModCTWindow_64(unsigned ebits)
+{
+	unsigned wbits = 0;
+
+	while (ebits > bnExpModCTThreshTable[wbits])
+		wbits++;
+	return wbits + 3;
+}
+
+/*
+ * The size of the workspace in words: the table, two product buffers,
+ * the gather buffer, and the padding to align the table to 64 bytes.
+ */
+unsigned
+lbnExpModCTSize_64(unsigned mlen, unsigned ebits)
+{
+	unsigned entries = 1u << lbnExpModCTWindow_64(ebits);
+
+	return (entries + 5) * mlen + 64 / sizeof(BNWORD64);
+}
+
+/* Store "src" as entry "index" of the scattered table */
+static void
+lbnExpModCTScatter_64(BNWORD64 *table, unsigned entries,
+	BNWORD64 const *src, unsigned mlen, unsigned index)
+{
+	table += index;
+	while (mlen--) {
+		*table = BIGLITTLE(*--src,*src++);
+		table += entries;
+	}
+}
+
+/* Read entry "index" of the scattered table, reading all entries */
+static void
+lbnExpModCTGather_64(BNWORD64 *dest, BNWORD64 const *table, unsigned entries,
+	unsigned mlen, unsigned index)
+{
+	BNWORD64 mask[1 << BNEXPMODCT_MAX_WINDOW];
+	BNWORD64 w;
+	unsigned i, x;
+
+	for (i = 0; i < entries; i++) {
+		x = i ^ index;
+		/* All ones if x is 0, else 0 */
+		mask[i] = (BNWORD64)0 -
+		          (BNWORD64)(((x - 1) & ~x) >> (sizeof(x)*8 - 1));
+	}
+	while (mlen--) {
+		w = 0;
+		for (i = 0; i < entries; i++)
+			w |= table[i] & mask[i];
+		BIGLITTLE(*--dest,*dest++) = w;
+		table += entries;
+	}
+}
+
+/*
+ * Get the "wbits" bits of "e" that start at bit "pos", the bits above
+ * the "elen" words of e are 0.  This depends on pos, not on the bits.
+ */
+static unsigned
+lbnExpModCTBits_64(BNWORD64 const *e, unsigned elen, unsigned pos,
+	unsigned wbits)
+{
+	unsigned bits = 0;
+	unsigned k;
+
+	while (wbits--) {
+		k = pos + wbits;
+		bits <<= 1;
+		if (k / 64 < elen)
+			bits |= (unsigned)(BIGLITTLE(e[-1-(int)(k/64)],e[k/64])
+			                   >> (k % 64)) & 1;
+	}
+	return bits;
+}
+
+int
+lbnExpModCT_64(BNWORD64 *result, BNWORD64 const *n, unsigned nlen,
+	BNWORD64 const *e, unsigned elen, unsigned ebits,
+	BNWORD64 *mod, unsigned mlen, BNWORD64 *ws)
+{
+	BNWORD64 *table;	/* Scattered powers of n */
+	BNWORD64 *a, *b;	/* Working buffers/accumulators */
+	BNWORD64 *g;		/* Gathered table entry */
+	BNWORD64 *t;		/* Pointer into the working buffers */
+	BNWORD64 inv;		/* mod^-1 modulo 2^64 */
+	BNWORD64 carry;		/* Carry of the lazy Montgomery steps */
+	unsigned wbits;		/* Window size */
+	unsigned entries;	/* Table entries, 2^wbits */
+	unsigned pos;		/* Exponent bit of the current window */
+	unsigned i;
+
+	assert(mlen);
+	assert(nlen <= mlen);
+	assert(ebits);
+	assert(lbnBits_64(e, elen) <= ebits);
+
+	wbits = lbnExpModCTWindow_64(ebits);
+	entries = 1u << wbits;
+
+	/* Align the table, it is the first part of the workspace */
+	while ((size_t)ws & 63)
+		ws++;
+	table = ws;
+	ws += entries * mlen;
+	a = BIGLITTLE(ws + 2*mlen, ws);
+	b = a + 2*mlen;
+	g = BIGLITTLE(b + mlen, b + 2*mlen);
+
+	/* Compute the necessary modular inverse */
+	inv = lbnMontInv1_64(mod[BIGLITTLE(-1,0)]);	/* LSW of modulus */
+
+	/* Entry 0 is the Montgomery form of 1, R mod "mod" */
+	t = BIGLITTLE(a-mlen, a+mlen);
+	lbnZero_64(a, 2*mlen);
+	BIGLITTLE(t[-1],t[0]) = 1;
+	(void)lbnDiv_64(t, a, mlen+1, mod, mlen);
+	lbnExpModCTScatter_64(table, entries, a, mlen, 0);
+
+	/* Entry 1 is the Montgomery form of n, keep a copy in g */
+	lbnCopy_64(t, n, nlen);
+	lbnZero_64(a, mlen);
+	(void)lbnDiv_64(t, a, mlen+nlen, mod, mlen);
+	lbnExpModCTScatter_64(table, entries, a, mlen, 1);
+	lbnCopy_64(g, a, mlen);
+	lbnCopy_64(BIGLITTLE(b-mlen, b+mlen), a, mlen);
+
+	/* The other entries, the accumulator is the high half of b */
+	for (i = 2; i < entries; i++) {
+		carry = lbnMontMulLazy_64(a, BIGLITTLE(b-mlen, b+mlen), g,
+		                          mod, mlen, inv);
+		t = BIGLITTLE(a-mlen, a+mlen);
+		lbnMontFinalCT_64(t, mod, mlen, carry);
+		lbnExpModCTScatter_64(table, entries, t, mlen, i);
+		/* Swap a and b */
+		t = a; a = b; b = t;
+	}
+
+	/* Start with the most significant window */
+	pos = (ebits + wbits - 1) / wbits * wbits - wbits;
+	lbnExpModCTGather_64(BIGLITTLE(b-mlen, b+mlen), table, entries, mlen,
+	                     lbnExpModCTBits_64(e, elen, pos, wbits));
+
+	while (pos) {
+		pos -= wbits;
+		for (i = 0; i < wbits; i++) {
+			carry = lbnMontSquareLazy_64(a, BIGLITTLE(b-mlen, b+mlen),
+			                             mod, mlen, inv);
+			lbnMontFinalCT_64(BIGLITTLE(a-mlen, a+mlen), mod, mlen,
+			                  carry);
+			t = a; a = b; b = t;
+		}
+		lbnExpModCTGather_64(g, table, entries, mlen,
+		                     lbnExpModCTBits_64(e, elen, pos, wbits));
+		carry = lbnMontMulLazy_64(a, BIGLITTLE(b-mlen, b+mlen), g,
+		                          mod, mlen, inv);
+		lbnMontFinalCT_64(BIGLITTLE(a-mlen, a+mlen), mod, mlen, carry);
+		t = a; a = b; b = t;
+	}
+
+	/* Convert result out of Montgomery form */
+	t = BIGLITTLE(b-mlen, b+mlen);
+	lbnCopy_64(b, t, mlen);
+	lbnZero_64(t, mlen);
+	carry = lbnMontReduceLazy_64(b, mod, mlen, inv);
+	lbnMontFinalCT_64(t, mod, mlen, carry);
+	lbnCopy_64(result, t, mlen);
+
+	/* The intermediate values tell about the exponent, wipe them */
+	lbnZero_64(a, 2*mlen);
+	lbnZero_64(b, 2*mlen);
+	lbnZero_64(g, mlen);
+
+	return 0;
+}
+
 /*
  * Compute and return n1^e1 * n2^e2 mod "mod".
  * result may be either input buffer, or something separate.
@@ -60,6 +60,10 @@ BNWORD64 lbnRshift_64(BNWORD64 *num, unsigned len, unsigned shift);
 void lbnMul_64(BNWORD64 *prod, BNWORD64 const *num1, unsigned len1,
 	BNWORD64 const *num2, unsigned len2);
 #endif
+#ifndef lbnMulX_64
+void lbnMulX_64(BNWORD64 *prod, BNWORD64 const *num1, BNWORD64 const *num2,
+	unsigned len);
+#endif
 #ifndef lbnSquare_64
 void lbnSquare_64(BNWORD64 *prod, BNWORD64 const *num, unsigned len);
 #endif
@@ -121,6 +125,10 @@ void lbnFromMont_64(BNWORD64 *n, BNWORD64 *mod, unsigned len);
 int lbnExpMod_64(BNWORD64 *result, BNWORD64 const *n, unsigned nlen,
 	BNWORD64 const *exp, unsigned elen, BNWORD64 *mod, unsigned mlen);
 #endif
+unsigned lbnExpModCTSize_64(unsigned mlen, unsigned ebits);
+int lbnExpModCT_64(BNWORD64 *result, BNWORD64 const *n, unsigned nlen,
+	BNWORD64 const *exp, unsigned elen, unsigned ebits,
+	BNWORD64 *mod, unsigned mlen, BNWORD64 *ws);
 #ifndef lbnDoubleExpMod_64
 int lbnDoubleExpMod_64(BNWORD64 *result,
 	BNWORD64 const *n1, unsigned n1len, BNWORD64 const *e1, unsigned e1len,
@@ -66,6 +66,9 @@ void free();
 
 #include "kludge.h"
 
+/* The buffers come from the allocator of the library, see ZrtpAllocator.h */
+#include <common/ZrtpAllocator.h>
+
 /*
  * memset_volatile is a volatile pointer to the memset function.
  * You can call (*memset_volatile)(buf, val, len) or even
@@ -84,24 +87,218 @@ lbnMemWipe(void *ptr, unsigned bytes)
 #define lbnMemWipe(ptr, bytes) memset(ptr, 0, bytes)
 #endif
 
+/*
+ * Per-thread cache of freed buffers.
+ *
+ * The math library allocates and frees temporary buffers for nearly every
+ * operation, a DH or ECDH key agreement calls malloc() and free() thousands
+ * of times.  If LBN_MEM_CACHE is enabled lbnMemFree() wipes a buffer and keeps
+ * it in a cache that belongs to the calling thread, lbnMemAlloc() reuses the
+ * cached buffers of the calling thread.  After the first key agreement of a
+ * thread the following key agreements of the same type run without heap
+ * allocations.
+ *
+ * The cache rounds the buffer sizes up to powers of two, from
+ * LBN_MEM_CACHE_MIN up to LBN_MEM_CACHE_MAX bytes, and keeps at most
+ * LBN_MEM_CACHE_BYTES bytes of buffers of each size.  Larger buffers use
+ * zrtpAlloc() and zrtpFree() directly.  The cache relies on the rule that
+ * lbnMemFree() gets the same size as lbnMemAlloc().  lbnMemCacheFlush()
+ * frees the cached buffers of the calling thread, the cache does this
+ * automatically if the thread terminates.
+ *
+ * The cache uses POSIX thread specific data and requires the BNSECURE
+ * variant of lbnRealloc() that does not call realloc().
+ */
+/* The free lists of the static arena already serve the purpose of the cache */
+#ifdef ZRTP_STATIC_ALLOCATION
+#undef LBN_MEM_CACHE
+#define LBN_MEM_CACHE 0
+#endif
+
+#ifndef LBN_MEM_CACHE
+#if defined(_WIN32) || !BNSECURE || defined(lbnMemRealloc)
+#define LBN_MEM_CACHE 0
+#else
+#define LBN_MEM_CACHE 1
+#endif
+#endif
+
+#if LBN_MEM_CACHE
+
+#include <pthread.h>
+
+#ifndef LBN_MEM_CACHE_MIN
+#define LBN_MEM_CACHE_MIN 64
+#endif
+#ifndef LBN_MEM_CACHE_MAX
+#define LBN_MEM_CACHE_MAX 8192
+#endif
+#ifndef LBN_MEM_CACHE_BYTES
+#define LBN_MEM_CACHE_BYTES 32768
+#endif
+
+/* Number of buffer sizes: 64, 128, ..., 8192 */
+#define LBN_MEM_CACHE_CLASSES 8
+
+/* A cached buffer stores the link to the next cached buffer of its size */
+struct lbnMemBlock {
+	struct lbnMemBlock *next;
+};
+
+struct lbnMemCache {
+	unsigned count[LBN_MEM_CACHE_CLASSES];
+	struct lbnMemBlock *blocks[LBN_MEM_CACHE_CLASSES];
+};
+
+static pthread_key_t cacheKey;
+static pthread_once_t cacheOnce = PTHREAD_ONCE_INIT;
+static int cacheKeyValid = 0;
+
+/* Free all buffers of a cache, the buffers were wiped when they were freed */
+static void
+lbnMemCacheRelease(struct lbnMemCache *cache)
+{
+	struct lbnMemBlock *block;
+	unsigned i;
+
+	for (i = 0; i < LBN_MEM_CACHE_CLASSES; i++) {
+		while ((block = cache->blocks[i]) != 0) {
+			cache->blocks[i] = block->next;
+			zrtpFree(block, (unsigned)LBN_MEM_CACHE_MIN << i);
+		}
+		cache->count[i] = 0;
+	}
+}
+
+static void
+lbnMemCacheDestroy(void *cache)
+{
+	lbnMemCacheRelease((struct lbnMemCache *)cache);
+	free(cache);
+}
+
+static void
+lbnMemCacheInit(void)
+{
+	cacheKeyValid = pthread_key_create(&cacheKey, lbnMemCacheDestroy) == 0;
+}
+
+/* Get the cache of the calling thread, create it if necessary */
+static struct lbnMemCache *
+lbnMemGetCache(int create)
+{
+	struct lbnMemCache *cache;
+
+	pthread_once(&cacheOnce, lbnMemCacheInit);
+	if (!cacheKeyValid)
+		return 0;
+
+	cache = (struct lbnMemCache *)pthread_getspecific(cacheKey);
+	if (!cache && create) {
+		cache = (struct lbnMemCache *)calloc(1, sizeof(*cache));
+		if (cache && pthread_setspecific(cacheKey, cache) != 0) {
+			free(cache);
+			cache = 0;
+		}
+	}
+	return cache;
+}
+
+/* Size class of a buffer, -1 if the cache does not handle the size */
+static int
+lbnMemClass(unsigned bytes)
+{
+	unsigned size = LBN_MEM_CACHE_MIN;
+	int i;
+
+	for (i = 0; i < LBN_MEM_CACHE_CLASSES; i++, size <<= 1) {
+		if (bytes <= size)
+			return i;
+	}
+	return -1;
+}
+
+void
+lbnMemCacheFlush(void)
+{
+	struct lbnMemCache *cache = lbnMemGetCache(0);
+
+	if (cache)
+		lbnMemCacheRelease(cache);
+}
+
 #ifndef lbnMemAlloc
 void *
 lbnMemAlloc(unsigned bytes)
 {
-	return malloc(bytes);
+	struct lbnMemCache *cache;
+	struct lbnMemBlock *block;
+	int i = lbnMemClass(bytes);
+
+	if (i < 0)
+		return zrtpAlloc(bytes);
+
+	cache = lbnMemGetCache(1);
+	if (cache && (block = cache->blocks[i]) != 0) {
+		cache->blocks[i] = block->next;
+		cache->count[i]--;
+		block->next = 0;
+		return block;
+	}
+	return zrtpAlloc((unsigned)LBN_MEM_CACHE_MIN << i);
 }
-#define lbnMemAlloc(bytes) malloc(bytes)
 #endif
 
 #ifndef lbnMemFree
 void
 lbnMemFree(void *ptr, unsigned bytes)
 {
+	struct lbnMemCache *cache;
+	struct lbnMemBlock *block = (struct lbnMemBlock *)ptr;
+	int i = lbnMemClass(bytes);
+
 	lbnMemWipe(ptr, bytes);
-	free(ptr);
+	if (i >= 0) {
+		cache = lbnMemGetCache(1);
+		if (cache && cache->count[i] < (LBN_MEM_CACHE_BYTES / LBN_MEM_CACHE_MIN) >> i) {
+			block->next = cache->blocks[i];
+			cache->blocks[i] = block;
+			cache->count[i]++;
+			return;
+		}
+		bytes = (unsigned)LBN_MEM_CACHE_MIN << i;
+	}
+	zrtpFree(ptr, bytes);
 }
 #endif
 
+#else /* !LBN_MEM_CACHE */
+
+void
+lbnMemCacheFlush(void)
+{
+}
+
+#ifndef lbnMemAlloc
+void *
+lbnMemAlloc(unsigned bytes)
+{
+	return zrtpAlloc(bytes);
+}
+#define lbnMemAlloc(bytes) zrtpAlloc(bytes)
+#endif
+
+#ifndef lbnMemFree
+void
+lbnMemFree(void *ptr, unsigned bytes)
+{
+	lbnMemWipe(ptr, bytes);
+	zrtpFree(ptr, bytes);
+}
+#endif
+
+#endif /* !LBN_MEM_CACHE */
+
 #ifndef lbnRealloc
 #if defined(lbnMemRealloc) || !BNSECURE
 void *
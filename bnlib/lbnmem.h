@@ -18,6 +18,14 @@ void *lbnMemAlloc(unsigned bytes);
 void lbnMemFree(void *ptr, unsigned bytes);
 #endif
 
+/*
+ * Free the buffers that lbnMemFree keeps in the cache of the calling
+ * thread, see LBN_MEM_CACHE in lbnmem.c.  lbnMemFree wipes all buffers
+ * before it caches them, thus calling this function is not necessary
+ * for security, it just returns the memory.
+ */
+void lbnMemCacheFlush(void);
+
 /* This wipes out a buffer of bytes if necessary needed. */
 
 #ifndef lbnMemWipe
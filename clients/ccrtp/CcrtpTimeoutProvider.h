@@ -34,16 +34,21 @@
  */
 
 #include <list>
-#include <sys/time.h>
 
 #include <commoncpp/config.h>
 #include <commoncpp/thread.h>
 
+#include <common/osSpecifics.h>
+#ifdef ZRTP_LOCK_PROFILING
+#include <mutex>
+#include <libzrtpcpp/ZrtpProfiledMutex.h>
+#endif
+
 /**
  * Represents a request of a "timeout" (delivery of a command to a
  * "timeout receiver" after at least a specified time period).
  *
- * Slightly modified to use gettimeofday directly.
+ * Slightly modified to use the monotonic clock, see zrtpGetMonotonicTime().
  *
  * NOTE: This class is only used internally.
  * @author Erik Eliasson
@@ -58,16 +63,13 @@ public:
     TPRequest( TOSubscriber tsi, int timeoutMs, const TOCommand &command):
         subscriber(tsi)
     {
-        struct timeval tv;
-        gettimeofday(&tv, NULL );
-
-        when_ms = ((uint64)tv.tv_sec) * (uint64)1000 + ((uint64)tv.tv_usec) / (uint64)1000;
+        when_ms = zrtpGetMonotonicTime();
         when_ms += timeoutMs;
         this->command = command;
     }
 
     /**
-     * @param t  ms since Epoch
+     * @param t  ms of the monotonic clock
      */
     bool happensBefore(uint64 t)
     {
@@ -91,10 +93,7 @@ public:
      */
     int getMsToTimeout ()
     {
-        struct timeval tv;
-        gettimeofday(&tv, NULL );
-
-        uint64 now = ((uint64)tv.tv_sec) * (uint64)1000 + ((uint64)tv.tv_usec) / (uint64)1000;
+        uint64 now = zrtpGetMonotonicTime();
 
         if (happensBefore(now)) {
             return 0;
@@ -132,7 +131,7 @@ public:
 
 private:
     TOSubscriber subscriber;
-    uint64 when_ms;     // Time since Epoch in ms when the timeout
+    uint64 when_ms;     // Monotonic clock time in ms when the timeout
     // will happen
 
     TOCommand command;      // Command that will be delivered to the
@@ -200,7 +199,8 @@ public:
             synchLock.leave();
             return;
         }
-        if (requests.back()->happensBefore(request)){
+        // A request that expires at the same time as the last request goes to the end as well
+        if (!request->happensBefore(requests.back())) {
             requests.push_back(request);
             signal();
             synchLock.leave();
@@ -285,7 +285,11 @@ private:
     // will expire. Nearest in future is first in list.
     std::list<TPRequest<TOCommand, TOSubscriber> *> requests;
 
+#ifdef ZRTP_LOCK_PROFILING
+    ZrtpProfiledMutex<std::recursive_mutex, ZrtpMetrics::TimeoutLock> synchLock;
+#else
     ost::Mutex synchLock;   // Protects the internal data structures
+#endif
 
     bool stop;      // Flag to tell the worker thread
     // to terminate. Set to true and
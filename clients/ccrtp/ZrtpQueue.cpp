@@ -21,26 +21,31 @@
 
 #include <string>
 #include <stdio.h>
+#include <string.h>
 
 #include <ZrtpQueue.h>
 #include <libzrtpcpp/ZIDCache.h>
 #include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZRtpPool.h>
+#include <libzrtpcpp/ZrtpDemux.h>
 #include <libzrtpcpp/ZrtpStateClass.h>
 #include <libzrtpcpp/ZrtpUserCallback.h>
+#include <common/MemoryUsage.h>
+#include <common/zrtpByteOrder.h>
 
-static TimeoutProvider<std::string, ost::ZrtpQueue*>* staticTimeoutProvider = NULL;
+static ShardedTimeoutWheel<int32_t, ost::ZrtpQueue*>* staticTimeoutProvider = NULL;
 
 NAMESPACE_COMMONCPP
 using namespace GnuZrtpCodes;
 
 ZrtpQueue::ZrtpQueue(uint32 size, RTPApplication& app) :
-        AVPQueue(size,app)
+        AVPQueue(size,app), timeoutEntry(this, ZrtpTimeoutCommand)
 {
     init();
 }
 
 ZrtpQueue::ZrtpQueue(uint32 ssrc, uint32 size, RTPApplication& app) :
-        AVPQueue(ssrc,size,app)
+        AVPQueue(ssrc,size,app), timeoutEntry(this, ZrtpTimeoutCommand)
 {
     init();
 }
@@ -57,6 +62,11 @@ void ZrtpQueue::init()
 
     clientIdString = clientId;
     peerSSRC = 0;
+    recvBuffer = NULL;
+    recvBufferSize = 0;
+    lastRecvSsrc = 0;
+    lastRecvContext = NULL;
+    recvContextsChanged = false;
 }
 
 ZrtpQueue::~ZrtpQueue() {
@@ -68,6 +78,7 @@ ZrtpQueue::~ZrtpQueue() {
         delete zrtpUserCallback;
         zrtpUserCallback = NULL;
     }
+    delete[] recvBuffer;
 }
 
 int32_t
@@ -87,7 +98,7 @@ ZrtpQueue::initialize(const char *zidFilename, bool autoEnable, ZrtpConfigure* c
     config->setParanoidMode(enableParanoidMode);
 
     if (staticTimeoutProvider == NULL) {
-        staticTimeoutProvider = new TimeoutProvider<std::string, ZrtpQueue*>();
+        staticTimeoutProvider = new ShardedTimeoutWheel<int32_t, ZrtpQueue*>();
         staticTimeoutProvider->start();
     }
     ZIDCache* zf = getZidCacheInstance();
@@ -107,7 +118,7 @@ ZrtpQueue::initialize(const char *zidFilename, bool autoEnable, ZrtpConfigure* c
     }
     if (ret > 0) {
         const uint8_t* ownZid = zf->getZid();
-        zrtpEngine = new ZRtp((uint8_t*)ownZid, (ZrtpCallback*)this, clientIdString, config, mitmMode, signSas);
+        zrtpEngine = ZRtpPool::getEngine((uint8_t*)ownZid, (ZrtpCallback*)this, clientIdString, config, mitmMode, signSas);
     }
     if (configOwn != NULL) {
         delete configOwn;
@@ -131,6 +142,7 @@ void ZrtpQueue::stopZrtp() {
         delete zrtpEngine;
         zrtpEngine = NULL;
         started = false;
+        packetFilter.reset();
     }
 }
 
@@ -144,67 +156,114 @@ ZrtpQueue::takeInDataPacket(void)
     tpport_t transport_port;
 
     uint32 nextSize = (uint32)getNextDataPacketSize();
-    unsigned char* buffer = new unsigned char[nextSize];
+    if (nextSize > recvBufferSize) {
+        delete[] recvBuffer;
+        recvBuffer = new unsigned char[nextSize];
+        recvBufferSize = nextSize;
+    }
+    unsigned char* buffer = recvBuffer;
     int32 rtn = (int32)recvData(buffer, nextSize, network_address, transport_port);
     if ( (rtn < 0) || ((uint32)rtn > getMaxRecvPacketSize()) ){
-        delete[] buffer;
         return 0;
     }
 
-    IncomingZRTPPkt* packet = NULL;
-    // check if this could be a real RTP/SRTP packet.
-    if ((*buffer & 0xf0) != 0x10) {
-        return (rtpDataPacket(buffer, rtn, network_address, transport_port));
+    // Classify the packet by its first bytes, refer to RFC 7983. The classifier
+    // checks the minimum length of each class and the ZRTP magic cookie.
+    int32_t packetClass = ZrtpDemux::classify(buffer, rtn);
+
+    // check if this could be a real RTP/SRTP packet. ccRTP receives RTCP on
+    // its own port, RTCP packet types on the data port are invalid (RFC 5761).
+    if (packetClass == ZrtpDemux::Rtp) {
+        // The queue owns the packets it accepts and deletes them together
+        // with their buffer, thus they need an own buffer.
+        unsigned char* packet = new unsigned char[rtn];
+        memcpy(packet, buffer, rtn);
+        return (rtpDataPacket(packet, rtn, network_address, transport_port));
     }
 
-    // We assume all other packets are ZRTP packets here. Process
-    // if ZRTP processing is enabled. Because valid RTP packets are
-    // already handled we delete any packets here after processing.
+    // Dismiss RTCP, STUN, DTLS, TURN and malformed packets, the queue does
+    // not process them.
+    if (packetClass != ZrtpDemux::Zrtp)
+        return 0;
+
+    // Process the ZRTP packet if ZRTP processing is enabled. The ZRTP engine
+    // does not keep the packet, thus process it in the receive buffer.
     if (enableZrtp && zrtpEngine != NULL) {
-        // Fixed header length + smallest ZRTP packet (includes CRC)
-        if (rtn < (int32)(12 + sizeof(HelloAckPacket_t))) // data too small, dismiss
+        // Drop malformed packets and floods before the CRC check and the DH computations
+        uint64_t source = ((uint64_t)ntohl(network_address.getAddress().s_addr) << 16) | transport_port;
+        if (!packetFilter.checkPacket(buffer, rtn, source))
             return 0;
 
         // Get CRC value into crc (see above how to compute the offset)
         uint16_t temp = rtn - CRC_SIZE;
-        uint32_t crc = *(uint32_t*)(buffer + temp);
-        crc = ntohl(crc);
+        uint32_t crc = zrtpLoadBe32(buffer + temp);
 
         if (!zrtpCheckCksum(buffer, temp, crc)) {
-            delete[] buffer;
             if (zrtpUserCallback != NULL)
                 zrtpUserCallback->showMessage(Warning, WarningCRCmismatch);
             return 0;
         }
 
-        packet = new IncomingZRTPPkt(buffer,rtn);
-
-        uint32 magic = packet->getZrtpMagic();
-
-        // Check if it is really a ZRTP packet, if not delete it and return 0
-        if (magic != ZRTP_MAGIC || zrtpEngine == NULL) {
-            delete packet;
+        if (!packetFilter.checkBinding(buffer, rtn))
             return 0;
-        }
+
         // cover the case if the other party sends _only_ ZRTP packets at the
         // beginning of a session. Start ZRTP in this case as well.
         if (!started) {
             startZrtp();
          }
-        // this now points beyond the undefined and length field.
-        // We need them, thus adjust
-        unsigned char* extHeader =
-                const_cast<unsigned char*>(packet->getHdrExtContent());
-        extHeader -= 4;
+        // The ZRTP message starts with the undefined and length field of
+        // the header extension, it follows the fixed header and the CSRCs.
+        unsigned char* extHeader = buffer + 12 + (*buffer & 0x0f) * 4;
 
         // store peer's SSRC, used when creating the CryptoContext
-        peerSSRC = packet->getSSRC();
+        peerSSRC = zrtpPacketSsrc(buffer);
         zrtpEngine->processZrtpMessage(extHeader, peerSSRC, rtn);
     }
-    delete packet;
     return 0;
 }
 
+CryptoContext*
+ZrtpQueue::getRecvCryptoContext(uint32 ssrc)
+{
+    if (recvContextsChanged.load(std::memory_order_acquire) && recvContextsChanged.exchange(false)) {
+        recvContexts.clear();
+        lastRecvContext = NULL;
+    }
+    if (lastRecvContext != NULL && lastRecvSsrc == ssrc)
+        return lastRecvContext;
+
+    CryptoContext* pcc;
+    std::unordered_map<uint32, CryptoContext*>::const_iterator it = recvContexts.find(ssrc);
+    if (it != recvContexts.end()) {
+        pcc = it->second;
+    }
+    else {
+        pcc = getInQueueCryptoContext(ssrc);
+
+        // If no crypto context is available for this SSRC but we are already in
+        // Secure state then create a CryptoContext for this SSRC.
+        // Assumption: every SSRC stream sent via this connection is secured
+        // _and_ uses the same crypto parameters.
+        if (pcc == NULL) {
+            pcc = getInQueueCryptoContext(0);
+            if (pcc != NULL) {
+                pcc = pcc->newCryptoContextForSSRC(ssrc, 0, 0L);
+                if (pcc != NULL) {
+                    pcc->deriveSrtpKeys(0);
+                    setInQueueCryptoContext(pcc);
+                }
+            }
+        }
+        if (pcc == NULL)
+            return NULL;
+        recvContexts[ssrc] = pcc;
+    }
+    lastRecvSsrc = ssrc;
+    lastRecvContext = pcc;
+    return pcc;
+}
+
 size_t
 ZrtpQueue::rtpDataPacket(unsigned char* buffer, int32 rtn, InetHostAddress network_address, tpport_t transport_port)
 {
@@ -228,22 +287,8 @@ ZrtpQueue::rtpDataPacket(unsigned char* buffer, int32 rtn, InetHostAddress netwo
     }
 
     // Look for a CryptoContext for this packet's SSRC
-    CryptoContext* pcc = getInQueueCryptoContext(packet->getSSRC());
-
-    // If no crypto context is available for this SSRC but we are already in
-    // Secure state then create a CryptoContext for this SSRC.
-    // Assumption: every SSRC stream sent via this connection is secured
-    // _and_ uses the same crypto parameters.
-    if (pcc == NULL) {
-        pcc = getInQueueCryptoContext(0);
-        if (pcc != NULL) {
-            pcc = pcc->newCryptoContextForSSRC(packet->getSSRC(), 0, 0L);
-            if (pcc != NULL) {
-                pcc->deriveSrtpKeys(0);
-                setInQueueCryptoContext(pcc);
-            }
-        }
-    }
+    CryptoContext* pcc = getRecvCryptoContext(packet->getSSRC());
+
     // If no crypto context: then either ZRTP is off or in early state
     // If crypto context is available then unprotect data here. If an error
     // occurs report the error and discard the packet.
@@ -371,7 +416,7 @@ int32_t ZrtpQueue::sendDataZRTP(const unsigned char *data, int32_t length) {
 
     // advance pointer to CRC storage
     pt += temp;
-    *(uint32_t*)pt = htonl(crc);
+    zrtpStoreBe32(pt, crc);
 
     dispatchImmediate(packet);
     delete packet;
@@ -544,6 +589,18 @@ bool ZrtpQueue::srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part)
         //
         setInQueueCryptoContext(recvCryptoContext);
         setInQueueCryptoContextCtrl(recvCryptoContextCtrl);
+
+        // The peer sends its RTP packets with the SSRC of its ZRTP packets in
+        // the common case. Create this context now, thus the first SRTP packet
+        // does not wait for the key derivation.
+        if (peerSSRC != 0 && getInQueueCryptoContext(peerSSRC) == NULL) {
+            CryptoContext* pcc = recvCryptoContext->newCryptoContextForSSRC(peerSSRC, 0, 0L);
+            if (pcc != NULL) {
+                pcc->deriveSrtpKeys(0);
+                setInQueueCryptoContext(pcc);
+            }
+        }
+        recvContextsChanged = true;
     }
     return true;
 }
@@ -567,6 +624,7 @@ void ZrtpQueue::srtpSecretsOff(EnableSecurity part) {
     if (part == ForReceiver) {
         removeInQueueCryptoContext(NULL);
         removeInQueueCryptoContextCtrl(NULL);
+        recvContextsChanged = true;
     }
     if (zrtpUserCallback != NULL) {
         zrtpUserCallback->secureOff();
@@ -574,22 +632,24 @@ void ZrtpQueue::srtpSecretsOff(EnableSecurity part) {
 }
 
 int32_t ZrtpQueue::activateTimer(int32_t time) {
-    std::string s("ZRTP");
+    return activateTimerSlack(time, 0);
+}
+
+int32_t ZrtpQueue::activateTimerSlack(int32_t time, int32_t slack) {
     if (staticTimeoutProvider != NULL) {
-        staticTimeoutProvider->requestTimeout(time, this, s);
+        staticTimeoutProvider->requestTimeout(time, &timeoutEntry, slack);
     }
     return 1;
 }
 
 int32_t ZrtpQueue::cancelTimer() {
-    std::string s("ZRTP");
     if (staticTimeoutProvider != NULL) {
-        staticTimeoutProvider->cancelRequest(this, s);
+        staticTimeoutProvider->cancelRequest(&timeoutEntry);
     }
     return 1;
 }
 
-void ZrtpQueue::handleTimeout(const std::string &c) {
+void ZrtpQueue::handleTimeout(int32_t c) {
     if (zrtpEngine != NULL) {
         zrtpEngine->processTimeout();
     }
@@ -796,6 +856,12 @@ bool ZrtpQueue::setSignatureData(uint8* data, int32 length) {
     return 0;
 }
 
+bool ZrtpQueue::sasSignatureReady(const uint8* data, int32 length) {
+    if (zrtpEngine != NULL)
+        return zrtpEngine->sasSignatureReady(data, length);
+    return false;
+}
+
 const uint8* ZrtpQueue::getSignatureData() {
     if (zrtpEngine != NULL)
         return zrtpEngine->getSignatureData();
@@ -832,6 +898,19 @@ int32_t ZrtpQueue::getCurrentProtocolVersion() {
     return 0;
 }
 
+int32_t ZrtpQueue::getFilterCounters(int32_t* counters) {
+    return packetFilter.getCounters(counters);
+}
+
+void ZrtpQueue::addMemoryUsage(MemoryUsage& usage) {
+    usage.add(MemoryUsage::Session, sizeof(ZrtpQueue) + recvBufferSize);
+
+    synchEnter();
+    if (zrtpEngine != NULL)
+        zrtpEngine->addMemoryUsage(usage);
+    synchLeave();
+}
+
 
 IncomingZRTPPkt::IncomingZRTPPkt(const unsigned char* const block, size_t len) :
         IncomingRTPPkt(block,len) {
@@ -18,14 +18,23 @@
 #ifndef _ZRTPQUEUE_H_
 #define _ZRTPQUEUE_H_
 
+#include <atomic>
+#include <unordered_map>
+
 #include <ccrtp/cqueue.h>
 #include <ccrtp/rtppkt.h>
 #include <libzrtpcpp/ZrtpCallback.h>
 #include <libzrtpcpp/ZrtpConfigure.h>
-#include "CcrtpTimeoutProvider.h"
+#include <libzrtpcpp/ZrtpPacketFilter.h>
+#include <common/TimeoutWheel.h>
+#ifdef ZRTP_LOCK_PROFILING
+#include <mutex>
+#include <libzrtpcpp/ZrtpProfiledMutex.h>
+#endif
 
 class __EXPORT ZrtpUserCallback;
 class __EXPORT ZRtp;
+class MemoryUsage;
 
 NAMESPACE_COMMONCPP
 
@@ -181,9 +190,30 @@ NAMESPACE_COMMONCPP
  * shows the ZRTP specific extensions and describes overloaded
  * methods and a possible different behaviour.
  *
+ * <b>Packet I/O</b>
+ *
+ * ZrtpQueue receives and sends each packet with ccRTP's
+ * <em>recvData</em> and <em>sendData</em>. The ccRTP transport
+ * channel of the session owns the sockets, thus ZrtpQueue cannot
+ * receive or send several datagrams with one system call, for
+ * example with <em>recvmmsg</em> or <em>sendmmsg</em>. Also ccRTP
+ * unprotects the SRTP packets with its own crypto contexts, not with
+ * the batch functions of GNU ZRTP's <em>SrtpHandler</em>.
+ * Applications that need batched I/O at high packet rates should use
+ * the GNU ZRTP core with an own transport, see the <em>no_client</em>
+ * and <em>tivi</em> glue code, and protect or unprotect the packets
+ * with <em>SrtpHandler::protectBatch</em> and
+ * <em>SrtpHandler::unprotectBatch</em>.
+ *
+ * A server with many sessions may serve them with the few threads of a
+ * ZrtpSessionPool instead of one service thread per session, see
+ * <em>PooledZRTPSession</em>.
+ *
  * @author Werner Dittmann <Werner.Dittmann@t-online.de>
  */
 
+class ZrtpSessionPool;
+
 class __EXPORT ZrtpQueue : public AVPQueue, ZrtpCallback {
 
 public:
@@ -682,6 +712,24 @@ public:
      */
     bool setSignatureData(uint8* data, int32 length);
 
+    /**
+     * Complete an asynchronous SAS signature
+     *
+     * If the ZrtpConfigure enables asynchronous SAS signatures the
+     * signSAS() callback only starts the signature and the application
+     * calls this method from any thread when the signature is ready.
+     *
+     * @param data
+     *    The signature data including the signature type block, a length of
+     *    zero sends the Confirm packet without signature.
+     * @param length
+     *    The length of the signature data in bytes. This length must be
+     *    multiple of 4.
+     * @return
+     *    True if ZRTP requested a signature and took the data, false otherwise.
+     */
+    bool sasSignatureReady(const uint8* data, int32 length);
+
     /**
      * Get signature data
      *
@@ -810,8 +858,36 @@ public:
       */
      int32_t getCurrentProtocolVersion();
 
+     /**
+      * Get the counters of ZRTP packets that the packet filter dropped.
+      *
+      * The queue drops malformed packets, floods of packets and packets
+      * that do not belong to the peer's hash chain before it checks the CRC,
+      * see ZrtpPacketFilter.
+      *
+      * @param counters
+      *    Pointer to a buffer of at least 3 integers.
+      * @return
+      *    Number of counters copied to the buffer.
+      */
+     int32_t getFilterCounters(int32_t* counters);
+
+     /**
+      * Add the memory of this queue to a footprint report.
+      *
+      * The function adds the size of the queue and of its receive buffer
+      * to the category MemoryUsage::Session and the memory of the ZRTP
+      * engine, see ZRtp::addMemoryUsage(). ccRTP owns the SRTP crypto
+      * contexts of the queue, they are not part of the report.
+      *
+      * @param usage
+      *    The footprint report
+      */
+     void addMemoryUsage(MemoryUsage& usage);
+
 protected:
-    friend class TimeoutProvider<std::string, ost::ZrtpQueue*>;
+    friend class TimeoutWheel<int32_t, ost::ZrtpQueue*>;
+    friend class ZrtpSessionPool;
 
     /**
      * A hook that gets called if the decoding of an incoming SRTP
@@ -835,7 +911,7 @@ protected:
      *
      * Just call the ZRTP engine for further processing.
      */
-    void handleTimeout(const std::string &c);
+    void handleTimeout(int32_t c);
 
     /**
      * This function is used by the service thread to process
@@ -856,6 +932,8 @@ protected:
 
     int32_t activateTimer(int32_t time);
 
+    int32_t activateTimerSlack(int32_t time, int32_t slack);
+
     int32_t cancelTimer();
 
     void sendInfo(GnuZrtpCodes::MessageSeverity severity, int32_t subCode);
@@ -906,6 +984,18 @@ private:
                          InetHostAddress network_address,
                          tpport_t transport_port);
 
+    /**
+     * Get the receive crypto context of a SSRC.
+     *
+     * Looks up the context in the queue's own SSRC index, the last found
+     * context is checked first. If the index does not know the SSRC the
+     * function asks ccRTP and, if only the template context exists, creates
+     * the context for the new SSRC.
+     *
+     * Only the service thread calls this function.
+     */
+    CryptoContext* getRecvCryptoContext(uint32 ssrc);
+
     ZRtp *zrtpEngine;
     ZrtpUserCallback* zrtpUserCallback;
 
@@ -916,13 +1006,29 @@ private:
     int32 secureParts;
 
     int16 senderZrtpSeqNo;
+#ifdef ZRTP_LOCK_PROFILING
+    ZrtpProfiledMutex<std::recursive_mutex, ZrtpMetrics::QueueLock> synchLock;
+#else
     ost::Mutex synchLock;   // Mutex for ZRTP (used by ZrtpStateClass)
+#endif
     uint32 peerSSRC;
     uint64 zrtpUnprotect;
     bool started;
     bool mitmMode;
     bool signSas;
     bool enableParanoidMode;
+    TimeoutEntry<int32_t, ost::ZrtpQueue*> timeoutEntry;   // the ZRTP engine uses one timer
+    unsigned char* recvBuffer;  // receive buffer of the service thread, reused for each packet
+    uint32 recvBufferSize;
+    ZrtpPacketFilter packetFilter;  // checks received ZRTP packets before the CRC check
+
+    // Index of the receive crypto contexts, ccRTP owns the contexts. Other
+    // threads only set recvContextsChanged to tell the service thread that
+    // the contexts changed and the index is invalid.
+    std::unordered_map<uint32, CryptoContext*> recvContexts;
+    uint32 lastRecvSsrc;
+    CryptoContext* lastRecvContext;
+    std::atomic<bool> recvContextsChanged;
 };
 
 class IncomingZRTPPkt : public IncomingRTPPkt {
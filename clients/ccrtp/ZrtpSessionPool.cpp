@@ -0,0 +1,279 @@
+/*
+  Copyright (C) 2026 the ZRTPCPP contributors
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <set>
+#include <thread>
+#include <utility>
+
+#include <ZrtpSessionPool.h>
+
+NAMESPACE_COMMONCPP
+
+typedef std::chrono::steady_clock::time_point PoolTime;
+
+/*
+ * Maximum number of packets a service thread sends for one queue before it
+ * serves the other queues.
+ */
+static const int32_t maxDispatch = 32;
+
+static const int32_t maxEvents = 64;
+
+/*
+ * A service thread of the pool. The thread owns an epoll instance that
+ * watches the data sockets of its queues and an eventfd that wakes up the
+ * thread if a queue was added or if the pool stops.
+ *
+ * The thread holds the lock except while it waits in epoll_wait, thus
+ * removeQueue returns only after the thread stopped to use the queue. The
+ * epoll events carry the socket, not the entry, because a queue may be
+ * removed after epoll_wait returned its event.
+ */
+class ZrtpSessionPool::Worker {
+public:
+    Worker(): epollFd(-1), wakeFd(-1), running(true) {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epollFd >= 0 && wakeFd >= 0) {
+            struct epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = wakeFd;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+        }
+        thread = std::thread(&Worker::run, this);
+    }
+
+    ~Worker() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            running = false;
+        }
+        wakeUp();
+        thread.join();
+        for (auto& item : entries)
+            delete item.second;
+        if (wakeFd >= 0)
+            close(wakeFd);
+        if (epollFd >= 0)
+            close(epollFd);
+    }
+
+    bool addQueue(ZrtpQueue& queue, SOCKET socket) {
+        std::lock_guard<std::mutex> guard(lock);
+
+        if (epollFd < 0 || entries.find(socket) != entries.end())
+            return false;
+
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = socket;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, socket, &event) < 0)
+            return false;
+
+        Entry* entry = new Entry;
+        entry->queue = &queue;
+        entry->socket = socket;
+        entry->deadline = std::chrono::steady_clock::now();
+        entries[socket] = entry;
+        deadlines.insert(std::make_pair(entry->deadline, entry));
+        wakeUp();
+        return true;
+    }
+
+    bool removeQueue(ZrtpQueue& queue) {
+        std::lock_guard<std::mutex> guard(lock);
+
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            Entry* entry = it->second;
+            if (entry->queue != &queue)
+                continue;
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, entry->socket, NULL);
+            deadlines.erase(std::make_pair(entry->deadline, entry));
+            entries.erase(it);
+            delete entry;
+            finishQueue(queue);
+            return true;
+        }
+        return false;
+    }
+
+    size_t getNumQueues() {
+        std::lock_guard<std::mutex> guard(lock);
+        return entries.size();
+    }
+
+private:
+    typedef struct _Entry {
+        ZrtpQueue* queue;
+        SOCKET socket;
+        PoolTime deadline;      ///< time of the next data transmission and RTCP service
+    } Entry;
+
+    void wakeUp() {
+        uint64_t one = 1;
+        if (wakeFd >= 0 && write(wakeFd, &one, sizeof(one)) < 0) {
+            // the counter is not zero, the thread wakes up anyway
+        }
+    }
+
+    void run() {
+        struct epoll_event events[maxEvents];
+        std::unique_lock<std::mutex> guard(lock);
+
+        while (running) {
+            // Serve the queues whose scheduled transmission or RTCP check is due
+            PoolTime now = std::chrono::steady_clock::now();
+            while (!deadlines.empty() && deadlines.begin()->first <= now) {
+                Entry* entry = deadlines.begin()->second;
+                deadlines.erase(deadlines.begin());
+                microtimeout_t timeout = serviceQueue(*entry->queue);
+                entry->deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout);
+                deadlines.insert(std::make_pair(entry->deadline, entry));
+            }
+            int32_t waitMs = -1;
+            if (!deadlines.empty()) {
+                std::chrono::microseconds wait = std::chrono::duration_cast<std::chrono::microseconds>(
+                        deadlines.begin()->first - std::chrono::steady_clock::now());
+                waitMs = (wait.count() <= 0) ? 0 : static_cast<int32_t>((wait.count() + 999) / 1000);
+            }
+            guard.unlock();
+            int num = epoll_wait(epollFd, events, maxEvents, waitMs);
+            guard.lock();
+
+            for (int i = 0; i < num; i++) {
+                int fd = events[i].data.fd;
+                if (fd == wakeFd) {
+                    uint64_t count;
+                    if (read(wakeFd, &count, sizeof(count)) < 0) {
+                        // another wake up already reset the counter
+                    }
+                    continue;
+                }
+                auto it = entries.find(fd);
+                if (it != entries.end())
+                    receivePacket(*it->second->queue);
+            }
+        }
+    }
+
+    int epollFd;
+    int wakeFd;
+    bool running;
+    std::unordered_map<SOCKET, Entry*> entries;
+    std::set<std::pair<PoolTime, Entry*> > deadlines;
+    std::mutex lock;
+    std::thread thread;
+};
+
+ZrtpSessionPool::ZrtpSessionPool(int32_t threads) {
+    if (threads <= 0)
+        threads = static_cast<int32_t>(std::thread::hardware_concurrency());
+    if (threads <= 0)
+        threads = 1;
+
+    for (int32_t i = 0; i < threads; i++)
+        workers.push_back(new Worker);
+}
+
+ZrtpSessionPool::~ZrtpSessionPool() {
+    for (size_t i = 0; i < workers.size(); i++)
+        delete workers[i];
+}
+
+bool ZrtpSessionPool::addQueue(ZrtpQueue& queue, SOCKET socket) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (sessions.find(&queue) != sessions.end())
+        return false;
+
+    Worker* worker = workers[0];
+    size_t lowest = worker->getNumQueues();
+    for (size_t i = 1; i < workers.size() && lowest > 0; i++) {
+        size_t num = workers[i]->getNumQueues();
+        if (num < lowest) {
+            worker = workers[i];
+            lowest = num;
+        }
+    }
+    if (!worker->addQueue(queue, socket))
+        return false;
+    sessions[&queue] = worker;
+    return true;
+}
+
+bool ZrtpSessionPool::removeSession(ZrtpQueue& session) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto it = sessions.find(&session);
+    if (it == sessions.end())
+        return false;
+
+    Worker* worker = it->second;
+    sessions.erase(it);
+    return worker->removeQueue(session);
+}
+
+size_t ZrtpSessionPool::getNumSessions() {
+    std::lock_guard<std::mutex> guard(lock);
+    return sessions.size();
+}
+
+/*
+ * The same steps as the run loop of ccRTP's SingleThreadRTPSession: the RTCP
+ * service and the data packets that are due. Returns the time until the next
+ * service of the queue in microseconds.
+ */
+microtimeout_t ZrtpSessionPool::serviceQueue(ZrtpQueue& queue) {
+    queue.controlReceptionService();
+    queue.controlTransmissionService();
+
+    microtimeout_t timeout = queue.getSchedulingTimeout();
+    for (int32_t i = 0; timeout < 1000 && i < maxDispatch; i++) {
+        queue.dispatchDataPacket();
+        timeout = queue.getSchedulingTimeout();
+    }
+    microtimeout_t maxWait = timeval2microtimeout(queue.getRTCPCheckInterval());
+    return (timeout > maxWait) ? maxWait : timeout;
+}
+
+// Take in the packet even if the queue is not active, epoll would report the socket again
+void ZrtpSessionPool::receivePacket(ZrtpQueue& queue) {
+    queue.takeInDataPacket();
+}
+
+void ZrtpSessionPool::finishQueue(ZrtpQueue& queue) {
+    queue.dispatchBYE("GNU ccRTP stack finishing.");
+}
+
+END_NAMESPACE
+
+/** EMACS **
+ * Local variables:
+ * mode: c++
+ * c-default-style: ellemtel
+ * c-basic-offset: 4
+ * End:
+ */
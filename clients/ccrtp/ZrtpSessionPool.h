@@ -0,0 +1,162 @@
+/*
+  Copyright (C) 2026 the ZRTPCPP contributors
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _ZRTPSESSIONPOOL_H_
+#define _ZRTPSESSIONPOOL_H_
+
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+
+#include <ZrtpQueue.h>
+
+NAMESPACE_COMMONCPP
+
+/**
+ * @brief Service threads that serve many ZRTP sessions.
+ *
+ * A <em>SymmetricZRTPSession</em> runs its own service thread that waits
+ * for the next packet or the next scheduled transmission of its session.
+ * A server with many sessions thus runs as many threads and each packet
+ * wakes up a different thread.
+ *
+ * The pool runs a small number of service threads, one per CPU core by
+ * default. Each thread waits with one @c epoll call for the data sockets
+ * of all its sessions, takes in the received packets and performs the
+ * scheduled data transmission and the RTCP service of its sessions. The
+ * sessions of the pool use the <em>PooledZRTPSession</em> type, it is a
+ * ccRTP session without own service thread:
+ *
+ * @code
+ * ...
+ * #include <libzrtpcpp/zrtpccrtp.h>
+ * #include <libzrtpcpp/ZrtpSessionPool.h>
+ * ...
+ *     ZrtpSessionPool pool;
+ *     PooledZRTPSession* session = new PooledZRTPSession(InetHostAddress("localhost"), port, port + 1,
+ *                                                        RTPDataQueue::defaultMembersHashSize,
+ *                                                        defaultApplication());
+ *     session->initialize("server.zid");
+ *     ...
+ *     session->enableStack();
+ *     pool.addSession(*session);
+ *     ...
+ *     pool.removeSession(*session);
+ *     delete session;
+ * @endcode
+ *
+ * The ZRTP timers of all sessions use the shared timeout provider of
+ * ZrtpQueue, they do not need a service thread of the session.
+ *
+ * A service thread calls the methods of the session's queue while it
+ * holds the lock of the thread, thus the callbacks of a session, for
+ * example <em>onNewSyncSource</em> or the ZrtpUserCallback methods, must
+ * not add or remove sessions of the pool.
+ *
+ * The pool uses @c epoll and is available on Linux only.
+ */
+class __EXPORT ZrtpSessionPool {
+
+public:
+    /**
+     * Create the pool and start its service threads.
+     *
+     * @param threads
+     *    Number of service threads, 0 starts one thread per CPU core.
+     */
+    ZrtpSessionPool(int32_t threads = 0);
+
+    /**
+     * Stop the service threads.
+     *
+     * The pool does not own the sessions, the application removes and
+     * deletes them.
+     */
+    ~ZrtpSessionPool();
+
+    /**
+     * Add a session to the pool.
+     *
+     * The pool assigns the session to the service thread with the lowest
+     * number of sessions. The application must not start the service
+     * thread of the session, thus it uses a <em>PooledZRTPSession</em> or
+     * another ccRTP session type without service thread.
+     *
+     * @param session
+     *    The session, a ccRTP session that uses the ZrtpQueue.
+     * @return
+     *    @c true if the pool added the session, @c false if the session
+     *    was already in the pool or if @c epoll failed.
+     */
+    template <class Session>
+    bool addSession(Session& session) {
+        return addQueue(session, session.getDSO()->getRecvSocket());
+    }
+
+    /**
+     * Remove a session from the pool.
+     *
+     * After the function returns the service threads do not use the
+     * session anymore and the application may delete it. The function
+     * sends a RTCP BYE packet for the session.
+     *
+     * @param session
+     *    The session.
+     * @return
+     *    @c true if the session was in the pool.
+     */
+    bool removeSession(ZrtpQueue& session);
+
+    /**
+     * Get the number of sessions in the pool.
+     */
+    size_t getNumSessions();
+
+    /**
+     * Get the number of service threads.
+     */
+    int32_t getNumThreads()     { return static_cast<int32_t>(workers.size()); }
+
+private:
+    class Worker;
+
+    bool addQueue(ZrtpQueue& queue, SOCKET socket);
+
+    /*
+     * The next functions call the protected ccRTP functions of a queue,
+     * ZrtpQueue declares the pool as friend.
+     */
+    static microtimeout_t serviceQueue(ZrtpQueue& queue);
+    static void receivePacket(ZrtpQueue& queue);
+    static void finishQueue(ZrtpQueue& queue);
+
+    std::vector<Worker*> workers;
+    std::unordered_map<ZrtpQueue*, Worker*> sessions;
+    std::mutex lock;            ///< protects the assignment of the sessions to the workers
+};
+
+END_NAMESPACE
+
+#endif // _ZRTPSESSIONPOOL_H_
+
+/** EMACS **
+ * Local variables:
+ * mode: c++
+ * c-default-style: ellemtel
+ * c-basic-offset: 4
+ * End:
+ */
@@ -44,6 +44,23 @@ typedef SingleThreadRTPSession<SymmetricRTPChannel,
                                ZrtpQueue> SymmetricZRTPSession;
 
 
+/**
+ * @typedef PooledZRTPSession
+ *
+ * Uses one pair of sockets, (1) for RTP data and (2) for RTCP
+ * transmission/reception.
+ *
+ * This session uses the ZrtpQueue but has no service thread. The threads of
+ * a ZrtpSessionPool serve the session, thus a server may serve many
+ * sessions with a few threads.
+ *
+ * @short Symmetric UDP/IPv4 RTP session served by a ZrtpSessionPool.
+ **/
+typedef TRTPSessionBase<SymmetricRTPChannel,
+                        SymmetricRTPChannel,
+                        ZrtpQueue> PooledZRTPSession;
+
+
 #ifdef CCXX_IPV6
 /**
  * @typedef SymmetricZRTPSession
@@ -29,6 +29,7 @@
 #define _CTZRTPCALLBACK_H_
 
 #include <CtZrtpSession.h>
+#include <srtp/SrtpHandler.h>
 
 /**
  * @brief Tivi callback functions for state changes, warnings, and enrollment.
@@ -68,6 +69,21 @@ public:
     virtual ~CtZrtpSendCb() {};
 
     virtual void sendRtp(CtZrtpSession const *session, uint8_t* packet, size_t length, CtZrtpSession::streamName streamNm) =0;
+
+    /**
+     * @brief Send a ZRTP packet that consists of several fragments.
+     *
+     * The fragments contain the RTP header, the ZRTP message of the engine and
+     * the CRC, thus the stream does not copy the message. The fragments have
+     * the layout of @c struct @c iovec, the callback may pass them to @c sendmsg.
+     * The fragments are valid during the call only.
+     *
+     * @return
+     *     @c true if the callback sent the packet. The default implementation
+     *     returns @c false and the stream copies the fragments and calls @c sendRtp.
+     */
+    virtual bool sendRtpv(CtZrtpSession const *session, const SrtpIoVec fragments[], int32_t count, size_t length,
+                          CtZrtpSession::streamName streamNm) { return false; }
 };
 
 #endif
\ No newline at end of file
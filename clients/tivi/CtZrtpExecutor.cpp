@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2026, the ZRTPCPP contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Tivi client glue code for ZRTP.
+ */
+
+#include <CtZrtpExecutor.h>
+#include <CtZrtpStream.h>
+
+CtZrtpExecutor::CtZrtpExecutor(): head(&stub), tail(&stub), sleeping(false), stopped(false) {
+}
+
+CtZrtpExecutor::~CtZrtpExecutor() {
+    stop();
+}
+
+void CtZrtpExecutor::start() {
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (!worker.joinable()) {
+        stopped = false;
+        worker = std::thread(&CtZrtpExecutor::execute, this);
+    }
+}
+
+void CtZrtpExecutor::stop() {
+    std::thread stopping;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        stopped = true;
+        stopping.swap(worker);
+        wakeup.notify_one();
+    }
+    if (!stopping.joinable())
+        return;
+    // A task may stop the executor, the executor thread cannot join itself
+    if (stopping.get_id() == std::this_thread::get_id())
+        stopping.detach();
+    else
+        stopping.join();
+}
+
+void CtZrtpExecutor::push(Task* task) {
+    task->next.store(NULL, std::memory_order_relaxed);
+    Task* previous = head.exchange(task, std::memory_order_acq_rel);
+    previous->next.store(task, std::memory_order_release);
+}
+
+void CtZrtpExecutor::post(Task* task) {
+    push(task);
+
+    // Wake the executor only if it sleeps, it holds the lock while it prepares to sleep.
+    // The fences order the queue update and the flag check, see execute()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.exchange(false)) {
+        std::lock_guard<std::mutex> guard(lock);
+        wakeup.notify_one();
+    }
+}
+
+CtZrtpExecutor::Task* CtZrtpExecutor::pop() {
+    Task* task = tail;
+    Task* next = task->next.load(std::memory_order_acquire);
+
+    if (task == &stub) {
+        if (next == NULL)
+            return NULL;                // empty
+        tail = next;
+        task = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != NULL) {
+        tail = next;
+        return task;
+    }
+    // The task is the last one, a producer may link a new task meanwhile
+    if (task != head.load(std::memory_order_acquire))
+        return NULL;
+    push(&stub);
+    next = task->next.load(std::memory_order_acquire);
+    if (next != NULL) {
+        tail = next;
+        return task;
+    }
+    return NULL;
+}
+
+void CtZrtpExecutor::execute() {
+    std::unique_lock<std::mutex> guard(lock);
+
+    while (!stopped) {
+        guard.unlock();
+        Task* task;
+        while ((task = pop()) != NULL) {
+            task->run();
+        }
+        timers.runExpired();
+        int32_t waitMs = timers.nextTimeoutMs();
+        guard.lock();
+
+        if (stopped)
+            break;
+        // Check the queue again after announcing the sleep, a producer that posts
+        // meanwhile sees the flag and notifies
+        sleeping.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if ((task = pop()) != NULL) {
+            sleeping.store(false);
+            guard.unlock();
+            task->run();
+            guard.lock();
+            continue;
+        }
+        if (waitMs < 0)
+            wakeup.wait(guard);
+        else if (waitMs > 0)
+            wakeup.wait_for(guard, std::chrono::milliseconds(waitMs));
+        sleeping.store(false);
+    }
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2026, the ZRTPCPP contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Tivi client glue code for ZRTP.
+ */
+
+#ifndef _CTZRTPEXECUTOR_H_
+#define _CTZRTPEXECUTOR_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <CtZrtpSession.h>
+#include <common/TimeoutWheel.h>
+
+class CtZrtpStream;
+
+/**
+ * @brief A thread that runs all functions of its sessions.
+ *
+ * An application binds sessions to an executor with
+ * @c CtZrtpSession::bindExecutor and posts tasks that call the session
+ * functions, for example to process the received packets. The executor runs
+ * the tasks and the timers of its sessions in its thread, thus the streams of
+ * these sessions do not use a mutex.
+ *
+ * @c post uses a lock free queue, producers never block. The executor sleeps
+ * on a condition variable only if the queue is empty and no timer expired.
+ */
+class __EXPORT CtZrtpExecutor {
+
+public:
+    /**
+     * @brief A unit of work for the executor.
+     *
+     * The executor calls @c run once and does not use the task afterwards,
+     * thus @c run may delete the task or the application may reuse it.
+     */
+    class Task {
+    public:
+        Task(): next(NULL) {}
+
+        virtual ~Task() {}
+
+        virtual void run() =0;
+
+    private:
+        friend class CtZrtpExecutor;
+        std::atomic<Task*> next;
+    };
+
+    CtZrtpExecutor();
+
+    /**
+     * Destructor also terminates the executor thread, tasks that are still in
+     * the queue do not run.
+     */
+    ~CtZrtpExecutor();
+
+    /**
+     * @brief Start the executor thread.
+     */
+    void start();
+
+    /**
+     * @brief Terminate the executor thread.
+     */
+    void stop();
+
+    /**
+     * @brief Post a task to the executor.
+     *
+     * The function is thread safe and does not block.
+     */
+    void post(Task* task);
+
+    /**
+     * @brief Check if the caller runs in the executor thread.
+     */
+    bool isExecutorThread() { return std::this_thread::get_id() == worker.get_id(); }
+
+    /**
+     * @brief Get the timers of the executor's sessions.
+     */
+    TimeoutWheel<int32_t, CtZrtpStream*>* getTimers() { return &timers; }
+
+private:
+    class StubTask : public Task {
+        void run() {}
+    };
+
+    CtZrtpExecutor(const CtZrtpExecutor&);
+    CtZrtpExecutor& operator=(const CtZrtpExecutor&);
+
+    void push(Task* task);
+    Task* pop();
+    void execute();
+
+    // Intrusive multi producer, single consumer queue (Vyukov)
+    std::atomic<Task*> head;        //!< last posted task, the producers use it
+    Task* tail;                     //!< next task to run, the executor thread uses it
+    StubTask stub;
+
+    TimeoutWheel<int32_t, CtZrtpStream*> timers;
+
+    std::mutex lock;
+    std::condition_variable wakeup;
+    std::atomic<bool> sleeping;
+    bool stopped;
+    std::thread worker;
+};
+
+#endif /* _CTZRTPEXECUTOR_H_ */
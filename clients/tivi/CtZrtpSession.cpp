@@ -19,15 +19,26 @@
  * @author Werner Dittmann <Werner.Dittmann@t-online.de>
  */
 
+#include <algorithm>
 #include <string>
 #include <stdio.h>
+#include <vector>
 
 #include <libzrtpcpp/ZIDCache.h>
+#include <libzrtpcpp/ZIDCacheAsync.h>
 #include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZRtpPool.h>
+#include <libzrtpcpp/ZrtpDemux.h>
+#include <common/MemoryUsage.h>
+#include <cryptcommon/ZrtpRandom.h>
+#include <zrtp/crypto/aesCFB.h>
+#include <zrtp/crypto/hmac256.h>
+#include <srtp/CryptoContext.h>
 
 #include <CtZrtpStream.h>
 #include <CtZrtpCallback.h>
 #include <CtZrtpSession.h>
+#include <CtZrtpExecutor.h>
 
 #include <clients/tivi/timeoutHelper/Thread.h>
 
@@ -37,33 +48,60 @@ const char *getZrtpBuildInfo()
 {
     return zrtpBuildInfo;
 }
-CtZrtpSession::CtZrtpSession() : zrtpMaster(NULL), mitmMode(false), signSas(false), enableParanoidMode(false), isReady(false),
-    zrtpEnabled(true), sdesEnabled(true), discriminatorMode(false) {
+CtZrtpSession::CtZrtpSession() : callerTimers(NULL), executor(NULL), ownZid(NULL), zrtpMaster(NULL), mitmMode(false), signSas(false), enableParanoidMode(false), isReady(false),
+    zrtpEnabled(true), sdesEnabled(true), discriminatorMode(false), stateExport(false) {
 
     clientIdString = clientId;
-    streams[AudioStream] = NULL;
-    streams[VideoStream] = NULL;
+    for (int32_t sn = 0; sn < AllStreams; sn++)
+        streams[sn] = NULL;
+}
+
+static std::string cacheFileName(const char *zidFilename) {
+    if (zidFilename != NULL)
+        return std::string(zidFilename);
+
+    char *home = getenv("HOME");
+    std::string baseDir = (home != NULL) ? (std::string(home) + std::string("/."))
+                                            : std::string(".");
+    return baseDir + std::string("GNUZRTP.zid");
 }
 
 int CtZrtpSession::initCache(const char *zidFilename) {
+    // Don't open the cache twice if a background open is running
+    if (ZIDCacheAsync::waitOpen() < 0)
+        return -1;
+
     ZIDCache* zf = getZidCacheInstance();
     if (!zf->isOpen()) {
-        std::string fname;
-        if (zidFilename == NULL) {
-            char *home = getenv("HOME");
-            std::string baseDir = (home != NULL) ? (std::string(home) + std::string("/."))
-                                                    : std::string(".");
-            fname = baseDir + std::string("GNUZRTP.zid");
-            zidFilename = fname.c_str();
-        }
-        if (zf->open((char *)zidFilename) < 0) {
+        std::string fname = cacheFileName(zidFilename);
+        if (zf->open((char *)fname.c_str()) < 0) {
             return -1;
         }
     }
     return 1;
 }
 
+int CtZrtpSession::initCacheAsync(const char *zidFilename) {
+    if (ZIDCacheAsync::isOpenPending() || getZidCacheInstance()->isOpen())
+        return 1;
+
+    ZIDCacheAsync::openAsync(cacheFileName(zidFilename));
+    return 1;
+}
+
 int CtZrtpSession::init(bool audio, bool video, int32_t callId, ZrtpConfigure* config)
+{
+    return initRange(audio ? AudioStream : VideoStream, video ? VideoStream + 1 : VideoStream, callId, config);
+}
+
+int CtZrtpSession::initStreams(int32_t numStreams, int32_t callId, ZrtpConfigure* config)
+{
+    if (numStreams < 1 || numStreams > AllStreams)
+        return -1;
+    return initRange(AudioStream, numStreams, callId, config);
+}
+
+int CtZrtpSession::initRange(int32_t first, int32_t end, int32_t callId, ZrtpConfigure* config)
 {
     int32_t ret = 1;
 
@@ -81,36 +119,19 @@ int CtZrtpSession::init(bool audio, bool video, int32_t callId, ZrtpConfigure* c
     config->setParanoidMode(enableParanoidMode);
     callId_ = callId;
 
+    // Wait for a cache that opens in the background only if the own ZID comes from the cache
     ZIDCache* zf = getZidCacheInstance();
-    if (!zf->isOpen()) {
-        ret = -1;
+    if (ownZid == NULL || !ZIDCacheAsync::isOpenPending()) {
+        ZIDCacheAsync::waitOpen();
+        if (!zf->isOpen()) {
+            ret = -1;
+        }
     }
     if (ret > 0) {
-        const uint8_t* ownZid = zf->getZid();
-        CtZrtpStream *stream;
-
-        // Create CTZrtpStream object only once, they are availbe for the whole
-        // lifetime of the session.
-        if (audio) {
-            if (streams[AudioStream] == NULL)
-                streams[AudioStream] = new CtZrtpStream();
-            stream = streams[AudioStream];
-            stream->zrtpEngine = new ZRtp((uint8_t*)ownZid, stream, clientIdString, config, mitmMode, signSas);
-            stream->type = Master;
-            stream->index = AudioStream;
-            stream->session = this;
-            stream->discriminatorMode = discriminatorMode;
-        }
-        if (video) {
-            if (streams[VideoStream] == NULL)
-                streams[VideoStream] = new CtZrtpStream();
-            stream = streams[VideoStream];
-            stream->zrtpEngine = new ZRtp((uint8_t*)ownZid, stream, clientIdString, config);
-            stream->type = Slave;
-            stream->index = VideoStream;
-            stream->session = this;
-            stream->discriminatorMode = discriminatorMode;
-        }
+        const uint8_t* zid = (ownZid != NULL) ? ownZid : zf->getZid();
+
+        for (int32_t sn = first; sn < end; sn++)
+            initStream(sn, zid, config);
         isReady = true;
     }
     if (configOwn != NULL) {
@@ -120,10 +141,64 @@ int CtZrtpSession::init(bool audio, bool video, int32_t callId, ZrtpConfigure* c
     return ret;
 }
 
+// Create CTZrtpStream object only once, they are availbe for the whole
+// lifetime of the session. Stream 0 is the Master, all others are Slaves.
+void CtZrtpSession::initStream(int32_t streamNm, const uint8_t* zid, ZrtpConfigure* config)
+{
+    if (streams[streamNm] == NULL)
+        streams[streamNm] = new CtZrtpStream();
+    CtZrtpStream *stream = streams[streamNm];
+    stream->timeoutSource = (callerTimers != NULL) ? callerTimers : CtZrtpStream::getSharedTimeouts();
+    if (executor != NULL)
+        stream->disableLocks();
+    if (streamNm == AudioStream) {
+        stream->zrtpEngine = ZRtpPool::getEngine((uint8_t*)zid, stream, clientIdString, config, mitmMode, signSas);
+        stream->type = Master;
+    }
+    else {
+        stream->zrtpEngine = ZRtpPool::getEngine((uint8_t*)zid, stream, clientIdString, config);
+        stream->type = Slave;
+    }
+    stream->index = (streamName)streamNm;
+    stream->session = this;
+    stream->discriminatorMode = discriminatorMode;
+    stream->setStateExport(stateExport);
+}
+
 CtZrtpSession::~CtZrtpSession() {
 
-    delete streams[AudioStream];
-    delete streams[VideoStream];
+    for (int32_t sn = 0; sn < AllStreams; sn++)
+        delete streams[sn];
+    if (executor == NULL)
+        delete callerTimers;
+}
+
+static bool noStreams(CtZrtpStream* const* streams) {
+    for (int32_t sn = 0; sn < CtZrtpSession::AllStreams; sn++) {
+        if (streams[sn] != NULL)
+            return false;
+    }
+    return true;
+}
+
+void CtZrtpSession::useCallerTimers() {
+    if (callerTimers == NULL && noStreams(streams))
+        callerTimers = new TimeoutWheel<int32_t, CtZrtpStream*>();
+}
+
+int32_t CtZrtpSession::nextTimeoutMs() {
+    return (callerTimers != NULL) ? callerTimers->nextTimeoutMs() : -1;
+}
+
+int32_t CtZrtpSession::runExpiredTimers(uint64_t now) {
+    return (callerTimers != NULL) ? callerTimers->runExpired(now) : 0;
+}
+
+void CtZrtpSession::bindExecutor(CtZrtpExecutor* exec) {
+    if (callerTimers == NULL && exec != NULL && noStreams(streams)) {
+        executor = exec;
+        callerTimers = exec->getTimers();
+    }
 }
 
 void zrtp_log(const char *tag, const char *buf);
@@ -175,6 +250,9 @@ void *findGlobalCfgKey(char *key, int iKeyLen, int &iSize, char **opt, int *type
      */
     conf->setSelectionPolicy(ZrtpConfigure::PreferNonNist);
 
+    // The mobile client merges the timer wakeups of its streams
+    conf->setTimerSlack(10);
+
     // Set the Disclosure flag if the client SW has DR active.
     if (iEnableDisclosure == 1)
         conf->setDisclosureFlag(true);
@@ -298,44 +376,56 @@ void *findGlobalCfgKey(char *key, int iKeyLen, int &iSize, char **opt, int *type
 }
 
 void CtZrtpSession::setUserCallback(CtZrtpCb* ucb, streamName streamNm) {
-    if (!(streamNm >= 0 && streamNm <= AllStreams && streams[streamNm] != NULL))
-        return;
-
     if (streamNm == AllStreams) {
-        for (int sn = 0; sn < AllStreams; sn++)
-            streams[sn]->setUserCallback(ucb);
+        for (int sn = 0; sn < AllStreams; sn++) {
+            if (streams[sn] != NULL)
+                streams[sn]->setUserCallback(ucb);
+        }
+        return;
     }
+    if (!(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
+        return;
+
     else
         streams[streamNm]->setUserCallback(ucb);
 }
 
 void CtZrtpSession::setSendCallback(CtZrtpSendCb* scb, streamName streamNm) {
-    if (!(streamNm >= 0 && streamNm <= AllStreams && streams[streamNm] != NULL))
-        return;
-
     if (streamNm == AllStreams) {
-        for (int sn = 0; sn < AllStreams; sn++)
-            streams[sn]->setSendCallback(scb);
+        for (int sn = 0; sn < AllStreams; sn++) {
+            if (streams[sn] != NULL)
+                streams[sn]->setSendCallback(scb);
+        }
+        return;
     }
+    if (!(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
+        return;
+
     else
         streams[streamNm]->setSendCallback(scb);
 
 }
 
 void CtZrtpSession::masterStreamSecure(CtZrtpStream *masterStream) {
-    // Here we know that the AudioStream is the master and VideoStream the slave.
-    // Otherwise we need to loop and find the Master stream and the Slave streams.
-
+    // Start all Slave streams the application started already. Their engines
+    // send their Hello now, thus the multi-stream negotiations run in parallel.
     multiStreamParameter = masterStream->zrtpEngine->getMultiStrParams(&zrtpMaster);
-    CtZrtpStream *strm = streams[VideoStream];
-    if (strm->enableZrtp) {
-        strm->zrtpEngine->setMultiStrParams(multiStreamParameter, zrtpMaster);
-        strm->zrtpEngine->startZrtpEngine();
-        strm->started = true;
-        strm->tiviState = eLookingPeer;
+
+    CtZrtpStream* startedStreams[AllStreams];
+    int32_t numStarted = 0;
+
+    for (int32_t sn = 0; sn < AllStreams; sn++) {
+        CtZrtpStream *strm = streams[sn];
+        if (strm == NULL || strm->type != Slave || !strm->enableZrtp || strm->started)
+            continue;
+        startSlave(strm);
+        startedStreams[numStarted++] = strm;
+    }
+    // Report after all engines started, a callback shall not delay another stream
+    for (int32_t i = 0; i < numStarted; i++) {
+        CtZrtpStream *strm = startedStreams[i];
         if (strm->zrtpUserCallback != 0)
             strm->zrtpUserCallback->onNewZrtpStatus(this, NULL, strm->index);
-
     }
 }
 
@@ -343,13 +433,21 @@ int CtZrtpSession::startIfNotStarted(unsigned int uiSSRC, int streamNm) {
     if (!(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
         return 0;
 
-    if ((streamNm == VideoStream && !isSecure(AudioStream)) || streams[streamNm]->started)
+    if (streams[streamNm]->started)
         return 0;
 
-    start(uiSSRC, streamNm == VideoStream ? CtZrtpSession::VideoStream : CtZrtpSession::AudioStream);
+    // A Slave stream waits until the Master is secure, see masterStreamSecure
+    start(uiSSRC, (streamName)streamNm);
     return 0;
 }
 
+void CtZrtpSession::startSlave(CtZrtpStream* stream) {
+    stream->zrtpEngine->setMultiStrParams(multiStreamParameter, zrtpMaster);
+    stream->zrtpEngine->startZrtpEngine();
+    stream->started = true;
+    stream->tiviState = eLookingPeer;
+}
+
 void CtZrtpSession::start(unsigned int uiSSRC, CtZrtpSession::streamName streamNm) {
     if (!zrtpEnabled || !(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
         return;
@@ -367,11 +465,8 @@ void CtZrtpSession::start(unsigned int uiSSRC, CtZrtpSession::streamName streamN
         return;
     }
     // Process a Slave stream.
-    if (!multiStreamParameter.empty()) {        // Multi-stream parameters available
-        stream->zrtpEngine->setMultiStrParams(multiStreamParameter, zrtpMaster);
-        stream->zrtpEngine->startZrtpEngine();
-        stream->started = true;
-        stream->tiviState = eLookingPeer;
+    if (!multiStreamParameter.empty() && !stream->started) {        // Multi-stream parameters available
+        startSlave(stream);
         if (stream->zrtpUserCallback != 0)
             stream->zrtpUserCallback->onNewZrtpStatus(this, NULL, stream->index);
     }
@@ -385,9 +480,10 @@ void CtZrtpSession::stop(streamName streamNm) {
 }
 
 void CtZrtpSession::release() {
-    release(AudioStream);
-    release(VideoStream);
+    for (int32_t sn = 0; sn < AllStreams; sn++)
+        release((streamName)sn);
     zrtpMaster = NULL;
+    multiStreamParameter.clear();
 }
 
 void CtZrtpSession::release(streamName streamNm) {
@@ -441,6 +537,210 @@ int32_t CtZrtpSession::processIncomingRtp(uint8_t *buffer, size_t length, size_t
     return stream->processIncomingRtp(buffer, length, newLength);
 }
 
+int32_t CtZrtpSession::processIncomingPacket(uint8_t *buffer, size_t length, size_t *newLength, streamName streamNm, int32_t *packetClass) {
+    int32_t pktClass = ZrtpDemux::classify(buffer, length);
+    if (packetClass != NULL)
+        *packetClass = pktClass;
+
+    if (!isReady || !(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
+        return fail;
+
+    CtZrtpStream *stream = streams[streamNm];
+    if (stream->isStopped)
+        return fail;
+
+    return stream->processIncomingPacket(buffer, length, newLength, pktClass);
+}
+
+CtZrtpStream* CtZrtpSession::readyStream(streamName streamNm) {
+    if (!isReady || !(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
+        return NULL;
+
+    CtZrtpStream *stream = streams[streamNm];
+    return stream->isStopped ? NULL : stream;
+}
+
+/*
+ * A packet of the batch that takes the SRTP fast path. The batch functions sort
+ * the packets by SRTP context, the stable sort keeps the order of each stream.
+ */
+typedef struct _batchEntry {
+    CryptoContext* context;
+    CtZrtpStream* stream;
+    int32_t packet;
+} batchEntry_t;
+
+static bool lessContext(const batchEntry_t& a, const batchEntry_t& b) {
+    return std::less<CryptoContext*>()(a.context, b.context);
+}
+
+// Call the SrtpHandler batch function for each group of packets with the same context
+template <typename Function>
+static void processGroups(std::vector<batchEntry_t>& entries, CtZrtpSession::mediaPacket packets[], Function process) {
+    std::stable_sort(entries.begin(), entries.end(), lessContext);
+
+    std::vector<PacketSpan> spans;
+    size_t first = 0;
+    while (first < entries.size()) {
+        size_t last = first;
+        while (last < entries.size() && entries[last].context == entries[first].context)
+            last++;
+
+        spans.clear();
+        for (size_t i = first; i < last; i++) {
+            CtZrtpSession::mediaPacket* pkt = &packets[entries[i].packet];
+            PacketSpan span = {pkt->buffer, pkt->length, pkt->length, 0};
+            spans.push_back(span);
+        }
+        process(entries[first].context, &spans[0], (int32_t)spans.size());
+
+        for (size_t i = first; i < last; i++) {
+            CtZrtpSession::mediaPacket* pkt = &packets[entries[i].packet];
+            pkt->newLength = spans[i - first].newLength;
+            pkt->result = spans[i - first].result;
+        }
+        first = last;
+    }
+}
+
+int32_t CtZrtpSession::processOutgoingRtpBatch(mediaPacket packets[], int32_t count) {
+    std::vector<batchEntry_t> entries;
+    int32_t sent = 0;
+
+    for (int32_t i = 0; i < count; i++) {
+        mediaPacket* pkt = &packets[i];
+        CtZrtpStream* stream = pkt->session->readyStream(pkt->streamNm);
+        CryptoContext* context = (stream != NULL) ? stream->sendFastPath() : NULL;
+
+        if (context != NULL) {
+            batchEntry_t entry = {context, stream, i};
+            entries.push_back(entry);
+            continue;
+        }
+        pkt->result = pkt->session->processOutoingRtp(pkt->buffer, pkt->length, &pkt->newLength, pkt->streamNm) ? 1 : 0;
+        sent += pkt->result;
+    }
+    // One call for all streams, the packets of different streams share the crypto lanes
+    std::vector<CryptoContext*> contexts;
+    std::vector<PacketSpan> spans;
+    for (batchEntry_t& entry : entries) {
+        mediaPacket* pkt = &packets[entry.packet];
+        PacketSpan span = {pkt->buffer, pkt->length, pkt->length, 0};
+        contexts.push_back(entry.context);
+        spans.push_back(span);
+    }
+    if (!entries.empty())
+        SrtpHandler::protectMulti(&contexts[0], &spans[0], (int32_t)spans.size());
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        packets[entries[i].packet].newLength = spans[i].newLength;
+        packets[entries[i].packet].result = spans[i].result;
+    }
+    for (batchEntry_t& entry : entries) {
+        if (packets[entry.packet].result == 1) {
+            entry.stream->zrtpProtect++;
+            sent++;
+        }
+    }
+    return sent;
+}
+
+int32_t CtZrtpSession::processIncomingRtpBatch(mediaPacket packets[], int32_t count) {
+    return incomingBatch(packets, count, false);
+}
+
+int32_t CtZrtpSession::processIncomingPacketBatch(mediaPacket packets[], int32_t count) {
+    return incomingBatch(packets, count, true);
+}
+
+int32_t CtZrtpSession::incomingBatch(mediaPacket packets[], int32_t count, bool demux) {
+    std::vector<batchEntry_t> entries;
+    std::vector<batchEntry_t> zrtpEntries;
+    int32_t good = 0;
+
+    // Hand the collected ZRTP packets of each stream to its engine, keeps the order of each stream
+    auto processZrtpGroups = [packets](std::vector<batchEntry_t>& pending) {
+        std::vector<uint8_t*> buffers;
+        std::vector<size_t> lengths;
+
+        while (!pending.empty()) {
+            CtZrtpStream* stream = pending[0].stream;
+            std::vector<batchEntry_t> others;
+
+            buffers.clear();
+            lengths.clear();
+            for (batchEntry_t& entry : pending) {
+                if (entry.stream != stream) {
+                    others.push_back(entry);
+                    continue;
+                }
+                buffers.push_back(packets[entry.packet].buffer);
+                lengths.push_back(packets[entry.packet].length);
+                packets[entry.packet].result = 0;   // the application drops ZRTP packets
+            }
+            stream->processZrtpBatch(&buffers[0], &lengths[0], (int32_t)buffers.size());
+            pending.swap(others);
+        }
+    };
+
+    for (int32_t i = 0; i < count; i++) {
+        mediaPacket* pkt = &packets[i];
+        CtZrtpStream* stream = pkt->session->readyStream(pkt->streamNm);
+        CryptoContext* context = NULL;
+        bool rtp;
+
+        if (demux) {
+            pkt->packetClass = ZrtpDemux::classify(pkt->buffer, pkt->length);
+            rtp = (pkt->packetClass == ZrtpDemux::Rtp);
+        }
+        else
+            rtp = (pkt->length > 0 && (*pkt->buffer & 0xc0) == 0x80);
+
+        // Only RTP packets take the fast path, ZRTP packets need the engine
+        if (stream != NULL && rtp)
+            context = stream->recvFastPath();
+
+        if (context != NULL) {
+            batchEntry_t entry = {context, stream, i};
+            entries.push_back(entry);
+            continue;
+        }
+        if (demux && stream != NULL && pkt->packetClass == ZrtpDemux::Zrtp) {
+            batchEntry_t entry = {NULL, stream, i};
+            zrtpEntries.push_back(entry);
+            continue;
+        }
+        // The engine sees the ZRTP packets before the packets that follow them
+        processZrtpGroups(zrtpEntries);
+
+        if (!demux)
+            pkt->result = pkt->session->processIncomingRtp(pkt->buffer, pkt->length, &pkt->newLength, pkt->streamNm);
+        else if (stream != NULL)
+            pkt->result = stream->processIncomingPacket(pkt->buffer, pkt->length, &pkt->newLength, pkt->packetClass);
+        else
+            pkt->result = fail;
+        if (pkt->result == 1)
+            good++;
+    }
+    processZrtpGroups(zrtpEntries);
+    processGroups(entries, packets, SrtpHandler::unprotectBatch);
+
+    // Same statistics and warnings as the single packet path
+    for (batchEntry_t& entry : entries) {
+        mediaPacket* pkt = &packets[entry.packet];
+        CtZrtpStream* stream = entry.stream;
+
+        if (stream->supressCounter < supressWarn)
+            stream->supressCounter++;
+        if (pkt->result == 1)
+            stream->zrtpUnprotect++;
+        pkt->result = stream->checkUnprotect(pkt->result);
+        if (pkt->result == 1)
+            good++;
+    }
+    return good;
+}
+
 bool CtZrtpSession::isStarted(streamName streamNm) {
     if (!isReady || !(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
         return false;
@@ -584,6 +884,15 @@ void CtZrtpSession::setClientId(std::string id) {
     clientIdString = id;
 }
 
+void CtZrtpSession::setZid(const uint8_t* zid) {
+    if (zid == NULL) {
+        ownZid = NULL;
+        return;
+    }
+    memcpy(ownZidData, zid, sizeof(ownZidData));
+    ownZid = ownZidData;
+}
+
 bool CtZrtpSession::createSdes(char *cryptoString, size_t *maxLen, streamName streamNm, const sdesSuites suite) {
 
     if (!isReady || !sdesEnabled || !(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
@@ -701,9 +1010,201 @@ int32_t CtZrtpSession::getSrtpTraceData(SrtpErrorData* data, streamName streamNm
     return stream->getSrtpTraceData(data);
 }
 
+void CtZrtpSession::setSrtpTraceSize(int32_t size, streamName streamNm) {
+    if (!isReady || !(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
+        return;
+
+    CtZrtpStream *stream = streams[streamNm];
+    stream->setSrtpTraceSize(size);
+}
+
+void CtZrtpSession::setSrtpGracePeriod(int32_t time, int32_t packets, streamName streamNm) {
+    if (!isReady || !(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
+        return;
+
+    CtZrtpStream *stream = streams[streamNm];
+    stream->setSrtpGracePeriod(time, packets);
+}
+
+void CtZrtpSession::setSrtpErrorReportInterval(int32_t interval, streamName streamNm) {
+    if (!isReady || !(streamNm >= 0 && streamNm < AllStreams && streams[streamNm] != NULL))
+        return;
+
+    CtZrtpStream *stream = streams[streamNm];
+    stream->setSrtpErrorReportInterval(interval);
+}
+
+
+
+void CtZrtpSession::setStateExport(bool yesNo) {
+    stateExport = yesNo;
+}
+
+/*
+ * The session state: magic, version, flags, then the number of streams and
+ * for each stream its number, the 16 bit length of the stream state and the
+ * stream state. An encrypted state has a random IV before the encrypted
+ * streams and the HMAC of all data before the HMAC at the end.
+ */
+static const char stateMagic[4] = {'Z', 'S', 'T', 'A'};
+static const uint8_t stateVersion = 1;
+static const uint8_t stateEncrypted = 1;
+static const int32_t stateHeaderLength = sizeof(stateMagic) + 2;
+static const int32_t stateIvLength = 16;
+
+static void stateKeys(const uint8_t* key, int32_t keyLength, uint8_t* encKey, uint8_t* macKey) {
+    static const char encLabel[] = "ZRTP session state encryption key";
+    static const char macLabel[] = "ZRTP session state MAC key";
+    uint32_t macLength;
+
+    hmac_sha256(key, keyLength, (const uint8_t*)encLabel, sizeof(encLabel) - 1, encKey, &macLength);
+    hmac_sha256(key, keyLength, (const uint8_t*)macLabel, sizeof(macLabel) - 1, macKey, &macLength);
+}
+
+int32_t CtZrtpSession::exportState(uint8_t* buffer, int32_t maxLen, const uint8_t* key, int32_t keyLength) {
+    if (!isReady || !stateExport)
+        return -1;
+
+    std::string state(stateMagic, sizeof(stateMagic));
+    state.push_back(static_cast<char>(stateVersion));
+    state.push_back(static_cast<char>(key != NULL ? stateEncrypted : 0));
+
+    uint8_t iv[stateIvLength];
+    if (key != NULL) {
+        ZrtpRandom::getRandomData(iv, sizeof(iv));
+        state.append(reinterpret_cast<char*>(iv), sizeof(iv));
+    }
+    size_t streamsStart = state.size();
+    state.push_back(0);
+
+    int32_t numStreams = 0;
+    std::string streamState;
+    for (int32_t sn = 0; sn < AllStreams; sn++) {
+        streamState.clear();
+        if (streams[sn] == NULL || !streams[sn]->exportState(streamState))
+            continue;
+        state.push_back(static_cast<char>(sn));
+        state.push_back(static_cast<char>(streamState.size() & 0xff));
+        state.push_back(static_cast<char>(streamState.size() >> 8));
+        state.append(streamState);
+        numStreams++;
+    }
+    memset(&streamState[0], 0, streamState.size());
+
+    int32_t length = (int32_t)state.size() + (key != NULL ? SHA256_DIGEST_LENGTH : 0);
+    if (numStreams == 0 || length > maxLen) {
+        memset(&state[0], 0, state.size());
+        return -1;
+    }
+    state[streamsStart] = static_cast<char>(numStreams);
+    memcpy(buffer, state.data(), state.size());
+    memset(&state[0], 0, state.size());
+
+    if (key != NULL) {
+        uint8_t encKey[SHA256_DIGEST_LENGTH];
+        uint8_t macKey[SHA256_DIGEST_LENGTH];
+        uint32_t macLength;
+
+        stateKeys(key, keyLength, encKey, macKey);
+        // The CFB mode updates the IV
+        aesCfbEncrypt(encKey, sizeof(encKey), iv, buffer + streamsStart, length - SHA256_DIGEST_LENGTH - streamsStart);
+        hmac_sha256(macKey, sizeof(macKey), buffer, length - SHA256_DIGEST_LENGTH, buffer + length - SHA256_DIGEST_LENGTH,
+                    &macLength);
+        memset(encKey, 0, sizeof(encKey));
+        memset(macKey, 0, sizeof(macKey));
+    }
+    return length;
+}
 
+int32_t CtZrtpSession::importState(const uint8_t* data, int32_t length, const uint8_t* key, int32_t keyLength) {
+    if (!isReady || data == NULL || length < stateHeaderLength + 1 || memcmp(data, stateMagic, sizeof(stateMagic)) != 0 ||
+        data[sizeof(stateMagic)] != stateVersion)
+        return -1;
+
+    // An unencrypted state needs no key and an encrypted state needs the key
+    bool encrypted = (data[sizeof(stateMagic) + 1] & stateEncrypted) != 0;
+    if (encrypted != (key != NULL))
+        return -1;
+
+    std::vector<uint8_t> state(data, data + length);
+    uint8_t* p = state.data() + stateHeaderLength;
+    uint8_t* end = state.data() + length;
+
+    if (encrypted) {
+        uint8_t encKey[SHA256_DIGEST_LENGTH];
+        uint8_t macKey[SHA256_DIGEST_LENGTH];
+        uint8_t mac[SHA256_DIGEST_LENGTH];
+        uint8_t iv[stateIvLength];
+        uint32_t macLength;
+
+        if (length < stateHeaderLength + stateIvLength + 1 + SHA256_DIGEST_LENGTH)
+            return -1;
+        end -= SHA256_DIGEST_LENGTH;
+        stateKeys(key, keyLength, encKey, macKey);
+        hmac_sha256(macKey, sizeof(macKey), state.data(), end - state.data(), mac, &macLength);
+        bool valid = srtpTagEqual(end, mac, SHA256_DIGEST_LENGTH);
+        if (valid) {
+            memcpy(iv, p, sizeof(iv));
+            p += stateIvLength;
+            aesCfbDecrypt(encKey, sizeof(encKey), iv, p, end - p);
+        }
+        memset(encKey, 0, sizeof(encKey));
+        memset(macKey, 0, sizeof(macKey));
+        if (!valid)
+            return -1;
+    }
+
+    // Check the stream numbers and lengths first, then import the streams
+    int32_t numStreams = *p++;
+    const uint8_t* streamData[AllStreams];
+    size_t streamLength[AllStreams];
+    int32_t streamNumbers[AllStreams];
+    bool rc = numStreams <= AllStreams;
+
+    for (int32_t i = 0; rc && i < numStreams; i++) {
+        if (end - p < 3) {
+            rc = false;
+            break;
+        }
+        int32_t sn = *p++;
+        streamLength[i] = p[0] | (p[1] << 8);
+        p += 2;
+        rc = sn < AllStreams && streams[sn] != NULL && !streams[sn]->started && (size_t)(end - p) >= streamLength[i];
+        for (int32_t j = 0; rc && j < i; j++)
+            rc = streamNumbers[j] != sn;
+        streamNumbers[i] = sn;
+        streamData[i] = p;
+        p += rc ? streamLength[i] : 0;
+    }
+    rc = rc && p == end;
+
+    int32_t imported = 0;
+    for (int32_t i = 0; rc && i < numStreams; i++) {
+        // The ZRTP engine of the stream reports the secure state
+        if (streams[streamNumbers[i]]->importState(streamData[i], streamLength[i]))
+            imported++;
+    }
+    memset(state.data(), 0, state.size());
+    if (!rc)
+        return -1;
+
+    // The restored Master provides the multi-stream parameters for new Slave streams
+    if (streams[AudioStream] != NULL && streams[AudioStream]->started && multiStreamParameter.empty())
+        multiStreamParameter = streams[AudioStream]->zrtpEngine->getMultiStrParams(&zrtpMaster);
+    return imported;
+}
+
+void CtZrtpSession::addMemoryUsage(MemoryUsage& usage) {
+    usage.add(MemoryUsage::Session, sizeof(CtZrtpSession));
+
+    for (int32_t i = 0; i < AllStreams; i++) {
+        if (streams[i] != NULL)
+            streams[i]->addMemoryUsage(usage);
+    }
+}
 
 void CtZrtpSession::cleanCache() {
+    ZIDCacheAsync::waitOpen();
     getZidCacheInstance()->cleanup();
 }
 
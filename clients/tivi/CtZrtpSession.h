@@ -46,6 +46,9 @@ class CtZrtpSendCb;
 class ZrtpConfigure;
 class ZRtp;
 class CMutexClass;
+class CtZrtpExecutor;
+class MemoryUsage;
+template <class TOCommand, class TOSubscriber> class TimeoutWheel;
 typedef struct _SrtpErrorData SrtpErrorData;
 
 extern "C" __EXPORT const char *getZrtpBuildInfo();
@@ -54,9 +57,11 @@ class __EXPORT CtZrtpSession {
 
 public:
     typedef enum _streamName {
-        AudioStream = 0,
-        VideoStream = 1,
-        AllStreams  = 2             //!< AllStreams is max number of streams
+        AudioStream  = 0,           //!< the Master stream
+        VideoStream  = 1,
+        ScreenStream = 2,
+        DataStream   = 3,
+        AllStreams   = 8            //!< AllStreams is max number of streams
     } streamName;
 
     typedef enum _streamType {
@@ -93,6 +98,22 @@ public:
         fail         = 1       /** General, unspecified failure */
     } returnCodes;
 
+    /**
+     * @brief Describes one packet for the batch media functions.
+     *
+     * The caller sets @c session, @c streamNm, @c buffer and @c length, the
+     * batch functions set @c newLength and @c result of each packet.
+     */
+    typedef struct _mediaPacket {
+        CtZrtpSession* session;     //!< the session of the packet
+        streamName streamNm;        //!< the stream of the session
+        uint8_t* buffer;            //!< the RTP/SRTP packet data
+        size_t length;              //!< length of the packet data in bytes
+        size_t newLength;           //!< length of the resulting packet data in bytes
+        int32_t result;             //!< result code of the packet
+        int32_t packetClass;        //!< class of the packet, set by @c processIncomingPacketBatch
+    } mediaPacket;
+
     CtZrtpSession();
 
     ~CtZrtpSession();
@@ -111,6 +132,26 @@ public:
      */
     static int initCache(const char *zidFilename);
 
+    /**
+     * @brief Open the cache file singleton in the background.
+     *
+     * Use this function instead of @c initCache to start the application
+     * without waiting until the cache file or database is open, see
+     * ZIDCacheAsync::openAsync(). The function returns immediately.
+     *
+     * @c init waits for the cache only if the application did not set the
+     * own ZID, see @c setZid. ZRTP waits for the cache only before it reads
+     * or saves the peer's record.
+     *
+     * @param zidFilename
+     *     The name of the ZID file, can be a relative or absolut
+     *     filename.
+     *
+     * @return
+     *     1, the open runs in the background
+     */
+    static int initCacheAsync(const char *zidFilename);
+
     /** @brief Initialize CtZrtpSession.
      *
      * Before an application can use ZRTP it has to initialize the
@@ -151,6 +192,79 @@ public:
      */
     int init(bool audio, bool video, int32_t callId = 0, ZrtpConfigure* config = NULL);
 
+    /** @brief Initialize CtZrtpSession with several streams.
+     *
+     * Works in the same way as @c init but initializes the streams
+     * @c 0 to @c numStreams-1. Stream @c 0 (AudioStream) is the @c Master
+     * stream, all other streams are @c Slave streams, for example
+     * @c VideoStream, @c ScreenStream, @c DataStream. A stream number without
+     * a name is a number below @c AllStreams casted to @c streamName.
+     *
+     * @param numStreams
+     *     number of streams, 1 up to @c AllStreams
+     *
+     * @param callId
+     *     The Tivi engine's call id.
+     *
+     * @param config
+     *     this parameter points to ZRTP configuration data. If it is
+     *     NULL then the session uses a default setting. Default is NULL.
+     *
+     * @return
+     *     1 on success, ZRTP processing enabled, -1 on failure,
+     *     ZRTP processing disabled.
+     */
+    int initStreams(int32_t numStreams, int32_t callId = 0, ZrtpConfigure* config = NULL);
+
+    /**
+     * @brief Drive the timers of the session from the application's event loop.
+     *
+     * By default the streams of all sessions share a timeout provider with
+     * its own threads, thus the ZRTP engines run their timeout processing in
+     * these threads. After this call the session's streams use timers of the
+     * session instead. The application calls @c nextTimeoutMs to get the
+     * wait time of its event loop and @c runExpiredTimers to process the
+     * timeouts, thus the ZRTP engines run in the event loop's thread only.
+     *
+     * Call this function before @c init.
+     */
+    void useCallerTimers();
+
+    /**
+     * @brief Get the time until the next timer of the session expires.
+     *
+     * @return
+     *     Milli-seconds until the next timer expires, 0 if a timer expired
+     *     already, -1 if no timer is active or the session does not use
+     *     caller driven timers.
+     */
+    int32_t nextTimeoutMs();
+
+    /**
+     * @brief Process the expired timers of the session.
+     *
+     * @param now
+     *     The current time in milli-seconds of the monotonic clock, for example
+     *     @c CLOCK_MONOTONIC on Linux, zero reads the clock.
+     *
+     * @return
+     *     Number of processed timers.
+     */
+    int32_t runExpiredTimers(uint64_t now = 0);
+
+    /**
+     * @brief Bind the session to an executor thread.
+     *
+     * The session uses the timers of the executor and its streams do not use
+     * a mutex. The application must call all functions of the session in the
+     * executor thread, usually in tasks that it posts to the executor, see
+     * @c CtZrtpExecutor::post.
+     *
+     * Call this function before @c init and do not combine it with
+     * @c useCallerTimers.
+     */
+    void bindExecutor(CtZrtpExecutor* executor);
+
     /**
      * @brief Fills a ZrtpConfiguration based on selected algorithms.
      *
@@ -180,8 +294,9 @@ public:
     /**
      * @brief Start a stream if it is not already started.
      *
-     * The method starts a stream if it is not already started and it starts
-     * a video stream (Slave) only if the audio stream (Master) is already secure.
+     * The method starts a stream if it is not already started. If the stream
+     * is a @c Slave stream and the @c Master stream is not yet secure the
+     * method marks it for start, refer to @c start.
      */
     int startIfNotStarted(unsigned int uiSSRC, int streamNm);
 
@@ -199,6 +314,10 @@ public:
      * If the @c Master stream is already in secure mode then the function copies
      * the multi-stream parameters to the @c slave and starts it immediately.
      *
+     * When the @c Master stream enters secure mode the session starts all
+     * waiting @c Slave streams at once, thus their multi-stream negotiations
+     * run in parallel.
+     *
      * @param uiSSRC the local SSRC for the stream
      *
      * @param streamNm which stream to start.
@@ -297,6 +416,93 @@ public:
      */
     int32_t processIncomingRtp(uint8_t *buffer, size_t length, size_t *newLength, streamName streamNm);
 
+    /**
+     * @brief Classify and process an incoming packet of a shared port.
+     *
+     * The function classifies the packet with @c ZrtpDemux::classify, refer
+     * to RFC 7983, and routes it with one switch: RTP to SRTP unprotect, RTCP
+     * to SRTCP unprotect and ZRTP to the ZRTP engine. The application processes
+     * STUN, DTLS and TURN packets itself, the function returns them unmodified.
+     *
+     * Unlike @c processIncomingRtp this function unprotects SRTCP packets that
+     * share the port with RTP (RFC 5761).
+     *
+     * @param buffer contains the received datagram
+     *
+     * @param length length of the datagram
+     *
+     * @param newLength returns the new length of the RTP or RTCP data
+     *
+     * @param streamNm specifies which stream to use
+     *
+     * @param packetClass if not @c NULL returns the class of the packet, see
+     *                    @c ZrtpDemux::PacketClass
+     *
+     * @return
+     *       - 1: success, the application processes the packet as indicated
+     *            by its class
+     *       - 0: drop packet, not an error
+     *       - -1: SRTP/SRTCP authentication failed,
+     *       - -2: SRTP/SRTCP replay check failed
+     */
+    int32_t processIncomingPacket(uint8_t *buffer, size_t length, size_t *newLength, streamName streamNm, int32_t *packetClass = NULL);
+
+    /**
+     * @brief Process a batch of outgoing packets of several sessions.
+     *
+     * The function processes the packets like @c processOutoingRtp. It
+     * protects the packets of all SRTP streams in secure state with one call
+     * of @c SrtpHandler::protectMulti, thus the packets of different streams
+     * share the AES and SHA1 lanes and the packets of the same stream keep
+     * their order. Other packets take the single packet path.
+     *
+     * The caller must not process packets of the same streams concurrently.
+     *
+     * @param packets array of packet descriptors, @c result is 1 if the
+     *                application shall send the packet, 0 otherwise
+     *
+     * @param count number of packet descriptors in the array
+     *
+     * @return number of packets to send
+     */
+    static int32_t processOutgoingRtpBatch(mediaPacket packets[], int32_t count);
+
+    /**
+     * @brief Process a batch of incoming packets of several sessions.
+     *
+     * The function processes the packets like @c processIncomingRtp. It
+     * groups the SRTP packets by their SRTP context and unprotects each group
+     * with one call of the SrtpHandler batch function. The packets of a group
+     * do not record SRTP trace data, see @c getSrtpTraceData.
+     *
+     * @param packets array of packet descriptors, @c result contains the
+     *                return code of @c processIncomingRtp
+     *
+     * @param count number of packet descriptors in the array
+     *
+     * @return number of packets with result 1
+     */
+    static int32_t processIncomingRtpBatch(mediaPacket packets[], int32_t count);
+
+    /**
+     * @brief Classify and process a batch of incoming packets of several sessions.
+     *
+     * The function classifies the packets like @c processIncomingPacket and
+     * sets @c packetClass of each packet. The RTP packets take the same SRTP
+     * batch path as in @c processIncomingRtpBatch, the other packets the
+     * single packet path of @c processIncomingPacket. The ZRTP packets of a
+     * stream go to the ZRTP engine together, the engine processes them under
+     * one lock acquisition and drops resent copies of a message of the batch.
+     *
+     * @param packets array of packet descriptors, @c result contains the
+     *                return code of @c processIncomingPacket
+     *
+     * @param count number of packet descriptors in the array
+     *
+     * @return number of packets with result 1
+     */
+    static int32_t processIncomingPacketBatch(mediaPacket packets[], int32_t count);
+
     /**
      * @brief Check if a stream was started.
      *
@@ -412,6 +618,16 @@ public:
     /**
      * @brief Return information to tivi client.
      *
+     * Besides the security information the function returns the handshake
+     * timing of the stream. The keys @c t_hello, @c t_helloack, @c t_commit,
+     * @c t_dh1, @c t_dh2, @c t_confirm1, @c t_confirm2, @c t_conf2ack and
+     * @c t_secure return the time of the first message of a handshake phase
+     * in microseconds since the start of the stream, @c -1 if the handshake
+     * did not reach the phase. Bit @c n of @c t_sent is set if this client
+     * sent the message of phase @c n. The keys @c cpu_keygen,
+     * @c cpu_agreement, @c cpu_kdf and @c cpu_cache return the CPU time of
+     * the computations in microseconds, see ZRtp::getDetailInfo().
+     *
      * @param key which information to return
      *
      * @param buffer points to buffer that gets the information
@@ -433,6 +649,9 @@ public:
 
     /**
      * @brief Read statistic counters of ZRTP
+     *
+     * The counters of the ZRTP packet filter follow the retry counters of the ZRTP
+     * engine, see ZrtpPacketFilter::getCounters().
      * 
      * @param buffer Pointer to buffer of 32-bit integers. The buffer must be able to
      *         hold at least getNumberOfCountersZrtp() 32-bit integers
@@ -478,6 +697,20 @@ public:
      */
     void setClientId(std::string id);
 
+    /**
+     * @brief Set the ZID of the session.
+     *
+     * By default the session uses the ZID of the ZID cache. A process that
+     * runs both endpoints of a call, for example a test or load program, sets
+     * a different ZID for each endpoint. The session copies the ZID.
+     *
+     * Setting the ZID must be done before calling CtZrtpSession#init().
+     *
+     * @param zid
+     *     The 12 bytes of the ZID, NULL to use the ZID of the cache again
+     */
+    void setZid(const uint8_t* zid);
+
     /**
      * @brief Creates an SDES crypto string for the SDES/ZRTP stream.
      *
@@ -725,6 +958,121 @@ public:
      */
     int32_t getSrtpTraceData(SrtpErrorData* data, streamName streamNm);
 
+    /**
+     * @brief Set the size of the SRTP error trace of a stream.
+     *
+     * A stream allocates its trace when it records the first SRTP error, thus
+     * streams without errors do not use memory for it. A new size discards the
+     * recorded trace data.
+     *
+     * @param size Number of @c SrtpErrorData elements, 1 to @c NumSrtpErrorData.
+     *             Zero switches off the trace of the stream.
+     *
+     * @param streamNm stream identifier.
+     */
+    void setSrtpTraceSize(int32_t size, streamName streamNm);
+
+    /**
+     * @brief Set the grace window of the previous receive SRTP context of a stream.
+     *
+     * After a key change or if ZRTP switches off SRTP the previous context
+     * still unprotects packets that were in flight, for @c time milliseconds
+     * but for at most @c packets packets. The default is 500 ms and 50 packets.
+     *
+     * @param time length of the window in milliseconds.
+     * @param packets maximum number of packets in the window, zero switches
+     *                the grace window off.
+     * @param streamNm stream identifier.
+     */
+    void setSrtpGracePeriod(int32_t time, int32_t packets, streamName streamNm);
+
+    /**
+     * @brief Set the minimum time between two SRTP error warnings of a stream.
+     *
+     * A stream reports a burst of SRTP errors at most once per interval, the
+     * warning adds the counts of the errors since the previous warning. The
+     * default is 1000 ms.
+     *
+     * @param interval time in milliseconds, zero reports each error of a burst.
+     * @param streamNm stream identifier.
+     */
+    void setSrtpErrorReportInterval(int32_t interval, streamName streamNm);
+
+    /**
+     * @brief Enable or disable the export of the session state.
+     *
+     * The SRTP contexts clear their master keys after the key derivation.
+     * If the state export is enabled they keep them, thus exportState() can
+     * move the secure streams to another host. The application sets the
+     * mode before it calls init().
+     *
+     * @param yesNo Enable the state export if true, disable if false.
+     */
+    void setStateExport(bool yesNo);
+
+    /**
+     * @brief Export the state of the secure streams.
+     *
+     * The state moves an established call to another host without a new
+     * ZRTP negotiation, for example to another media node. It contains the
+     * ZRTP secure state of each secure stream, refer to ZRtp::getSecureState(),
+     * and its SRTP and SRTCP contexts with the master keys, ROC, replay window
+     * and SRTCP index. The state does not contain streams that are not secure
+     * or use SDES, the other host negotiates them again.
+     *
+     * The application stops the media processing of the session before it
+     * exports the state and does not use the session afterwards. The other
+     * host calls importState() and continues the media processing.
+     *
+     * The state contains all keys of the session. If the application
+     * provides a key the function encrypts the state with AES-256 (CFB mode)
+     * and authenticates it with a SHA-256 HMAC, the keys of both derive from
+     * the provided key.
+     *
+     * @param buffer buffer that receives the state.
+     * @param maxLen length of the buffer.
+     * @param key key to encrypt the state, @c NULL stores the state unencrypted.
+     * @param keyLength length of the key in bytes.
+     *
+     * @return the length of the state, -1 if the buffer is too short, no
+     *         stream is secure or the state export was not enabled, refer to
+     *         setStateExport().
+     */
+    int32_t exportState(uint8_t* buffer, int32_t maxLen, const uint8_t* key = NULL, int32_t keyLength = 0);
+
+    /**
+     * @brief Import a state that exportState() produced.
+     *
+     * The application initializes the session with the same streams as the
+     * exporting session, sets the callbacks of the streams and then imports
+     * the state instead of starting the streams. The imported streams are
+     * secure, they report their state with CtZrtpCb::onNewZrtpStatus(). If
+     * the state contains the Master stream the application can start new
+     * Slave streams as usual.
+     *
+     * @param data the state.
+     * @param length length of the state.
+     * @param key the key that encrypted the state, @c NULL if the state is
+     *            not encrypted.
+     * @param keyLength length of the key in bytes.
+     *
+     * @return the number of imported streams, -1 if the session is not
+     *         initialized, a stream of the state runs already or the state is
+     *         not valid.
+     */
+    int32_t importState(const uint8_t* data, int32_t length, const uint8_t* key = NULL, int32_t keyLength = 0);
+
+    /**
+     * @brief Add the memory of this session to a footprint report.
+     *
+     * The function adds the memory of the session, of its streams, their
+     * ZRTP engines and crypto contexts. The caller may collect the
+     * footprint of several sessions in one MemoryUsage object.
+     *
+     * @param usage the footprint report, refer to MemoryUsage for the categories.
+     */
+    void addMemoryUsage(MemoryUsage& usage);
+
     /**
      * @brief Get the Tivi engine's call id.
      */
@@ -739,7 +1087,8 @@ protected:
      *
      * The session's master stream entered secure state and computed all
      * necessary information to kick of slave streams. The session checks
-     * if slave streams are available and if they are ready to start.
+     * if slave streams are available and if they are ready to start, and
+     * starts all of them.
      *
      * @param stream is the stream that enters secure mode. This must be a
      *               @c Master stream
@@ -751,10 +1100,19 @@ private:
     void synchEnter();
     void synchLeave();
 
+    CtZrtpStream* readyStream(streamName streamNm);
+    static int32_t incomingBatch(mediaPacket packets[], int32_t count, bool demux);
+    int initRange(int32_t first, int32_t end, int32_t callId, ZrtpConfigure* config);
+    void initStream(int32_t streamNm, const uint8_t* zid, ZrtpConfigure* config);
+    void startSlave(CtZrtpStream* stream);
+
     CtZrtpStream *streams[AllStreams];
+    TimeoutWheel<int32_t, CtZrtpStream*>* callerTimers;     //!< NULL if the streams use the shared provider
+    CtZrtpExecutor* executor;                               //!< owns the callerTimers if not NULL
     std::string  clientIdString;
     std::string  multiStreamParameter;
-    const uint8_t* ownZid;
+    const uint8_t* ownZid;                                  //!< NULL if the session uses the ZID of the cache
+    uint8_t ownZidData[12];
     ZRtp*    zrtpMaster;
     int32_t callId_;
 
@@ -765,6 +1123,7 @@ private:
     bool zrtpEnabled;
     bool sdesEnabled;
     bool discriminatorMode;
+    bool stateExport;
 };
 
 #endif /* _CTZRTPSESSION_H_ */
\ No newline at end of file
@@ -22,18 +22,22 @@
 #include <stdint.h>
 
 #include <common/osSpecifics.h>
+#include <common/MemoryUsage.h>
+#include <common/ZrtpReclaimer.h>
+#include <common/zrtpByteOrder.h>
 
 #include <libzrtpcpp/ZRtp.h>
 #include <libzrtpcpp/ZrtpStateClass.h>
 #include <libzrtpcpp/ZrtpCrc32.h>
+#include <libzrtpcpp/ZrtpDemux.h>
 #include <srtp/CryptoContext.h>
 #include <srtp/CryptoContextCtrl.h>
 
 #include <CtZrtpStream.h>
 #include <CtZrtpCallback.h>
-#include <TiviTimeoutProvider.h>
 #include <cryptcommon/aes.h>
 #include <cryptcommon/ZrtpRandom.h>
+#include <clients/tivi/timeoutHelper/Thread.h>
 
 // #define DEBUG_CTSTREAM
 #ifdef DEBUG_CTSTREAM
@@ -52,7 +56,6 @@ void checkRemoteAxoIdKey(const string user, const string devId, const string pub
 int getCallInfo(int iCallID, const char *key, char *p, int iMax);
 #endif
 
-static TimeoutProvider<std::string, CtZrtpStream*>* staticTimeoutProvider = NULL;
 
 static std::map<int32_t, std::string*> infoMap;
 static std::map<int32_t, std::string*> warningMap;
@@ -94,22 +97,21 @@ CtZrtpStream::CtZrtpStream():
     index(CtZrtpSession::AudioStream), type(CtZrtpSession::NoStream), zrtpEngine(NULL),
     ownSSRC(0), zrtpProtect(0), sdesProtect(0), zrtpUnprotect(0), sdesUnprotect(0), unprotectFailed(0),
     enableZrtp(0), started(false), isStopped(false), discriminatorMode(false), session(NULL), tiviState(CtZrtpSession::eLookingPeer),
-    prevTiviState(CtZrtpSession::eLookingPeer), recvSrtp(NULL), recvSrtcp(NULL), sendSrtp(NULL), sendSrtcp(NULL),
-    zrtpUserCallback(NULL), zrtpSendCallback(NULL), senderZrtpSeqNo(0), peerSSRC(0), zrtpHashMatch(false),
-    sasVerified(false), helloReceived(false), useSdesForMedia(false), useZrtpTunnel(false), zrtpEncapSignaled(false), 
-    sdes(NULL), supressCounter(0), srtpAuthErrorBurst(0), srtpReplayErrorBurst(0), srtpDecodeErrorBurst(0), 
-    zrtpCrcErrors(0), role(NoRole), errorInfoIndex(0), numErrorArrayWrap(0)
+    prevTiviState(CtZrtpSession::eLookingPeer), recvSrtp(NULL), recvSrtcp(NULL), sendSrtp(NULL), sendSrtcp(NULL), graceSrtp(NULL),
+    gracePacketsLeft(0), graceEnd(0), graceFirst(false), graceTime(srtpGraceTime), gracePackets(srtpGracePackets), secureSteady(false),
+    zrtpUserCallback(NULL), zrtpSendCallback(NULL), sdesTempBuffer(NULL), senderZrtpSeqNo(0), peerSSRC(0), zrtpHashMatch(false),
+    sasVerified(false), helloReceived(false), useSdesForMedia(false), useZrtpTunnel(false), zrtpEncapSignaled(false), stateExport(false),
+    sdes(NULL), supressCounter(0), srtpAuthErrorBurst(0), srtpReplayErrorBurst(0), srtpDecodeErrorBurst(0),
+    reportAuthErrors(0), reportReplayErrors(0), reportDecodeErrors(0), nextErrorReport(0),
+    errorReportInterval(srtpErrorReportInterval), zrtpCrcErrors(0), role(NoRole), srtpErrorInfo(NULL), srtpTraceSize(NumSrtpErrorData), errorInfoIndex(0),
+    numErrorArrayWrap(0), timeoutSource(NULL),
+    timeoutEntry(this, ZrtpTimeoutCommand)
 {
-    synchLock = new CMutexClass();
+    synchLock = new CtZrtpStreamLock();
 
-    if (staticTimeoutProvider == NULL) {
-        staticTimeoutProvider = new TimeoutProvider<std::string, CtZrtpStream*>();
-        staticTimeoutProvider->Event(&staticTimeoutProvider);  // Event argument is dummy, not used
-    }
     initStrings();
     ZrtpRandom::getRandomData((uint8_t*)&senderZrtpSeqNo, 2);
     senderZrtpSeqNo &= 0x7fff;
-    memset((void*)srtpErrorInfo, 0, sizeof(srtpErrorInfo));
 }
 
 void CtZrtpStream::setUserCallback(CtZrtpCb* ucb) {
@@ -164,30 +166,50 @@ void CtZrtpStream::stopStream() {
     srtpAuthErrorBurst = 0;
     srtpReplayErrorBurst = 0;
     srtpDecodeErrorBurst = 0;
+    reportAuthErrors = 0;
+    reportReplayErrors = 0;
+    reportDecodeErrors = 0;
+    nextErrorReport = 0;
     zrtpCrcErrors = 0;
+    packetFilter.reset();
     helloReceived = false;
 
     peerHelloHashes.clear();
 
-    delete zrtpEngine;
-    zrtpEngine = NULL;
+    // Stop the engine here, the reclaimer may wipe and free it later on its own thread
+    if (zrtpEngine != NULL) {
+        zrtpEngine->detachCallback();
+        ZrtpReclaimer::reclaim(zrtpEngine);
+        zrtpEngine = NULL;
+    }
+    secureSteady = false;
 
-    delete recvSrtp;
-    recvSrtp = NULL;
+    graceSrtp = NULL;
+    ZrtpReclaimer::reclaim(recvSrtp.exchange(NULL));
 
-    delete recvSrtcp;
+    ZrtpReclaimer::reclaim(recvSrtcp);
     recvSrtcp = NULL;
 
-    delete sendSrtp;
-    sendSrtp = NULL;
+    ZrtpReclaimer::reclaim(sendSrtp.exchange(NULL));
 
-    delete sendSrtcp;
+    ZrtpReclaimer::reclaim(sendSrtcp);
     sendSrtcp = NULL;
 
-    delete sdes;
+    for (CryptoContext* context : retiredSrtp)
+        ZrtpReclaimer::reclaim(context);
+    retiredSrtp.clear();
+
+    ZrtpReclaimer::reclaim(sdes);
     sdes = NULL;
 
-    memset((void*)srtpErrorInfo, 0, sizeof(srtpErrorInfo));
+    if (sdesTempBuffer != NULL) {
+        memset(sdesTempBuffer, 0, maxSdesString);
+        delete[] sdesTempBuffer;
+        sdesTempBuffer = NULL;
+    }
+
+    delete[] srtpErrorInfo.exchange(NULL);
+    errorInfoIndex = 0;
     numErrorArrayWrap = 0;
 
     // Don't delete the next classes, we don't own them.
@@ -198,7 +220,9 @@ void CtZrtpStream::stopStream() {
 
 bool CtZrtpStream::processOutgoingRtp(uint8_t *buffer, size_t length, size_t *newLength) {
     bool rc = true;
-    if (sendSrtp == NULL) {                 // ZRTP/SRTP inactive
+    CryptoContext* srtp = sendSrtp.load(std::memory_order_acquire);
+
+    if (srtp == NULL) {                     // ZRTP/SRTP inactive
         *newLength = length;
         // Check if ZRTP engine is started and check states to determine if we should send the RTP packet.
         // Do not send in states: CommitSent, WaitDHPart2, WaitConfirm1, WaitConfirm2, WaitConfAck
@@ -224,13 +248,14 @@ bool CtZrtpStream::processOutgoingRtp(uint8_t *buffer, size_t length, size_t *ne
     }
     // At this point ZRTP/SRTP is active
     if (useSdesForMedia && sdes != NULL) {       // We still have a SDES - other client did not send zrtp-hash thus we protect twice
-        rc = sdes->outgoingRtp(buffer, length, newLength);
-        if (!rc) {
-            return rc;
+        rc = sdes->outgoingRtpTwice(srtp, buffer, length, newLength);
+        if (rc) {
+            sdesProtect++;
+            zrtpProtect++;
         }
-        sdesProtect++;
+        return rc;
     }
-    rc = SrtpHandler::protect(sendSrtp, buffer, length, newLength);
+    rc = SrtpHandler::protect(srtp, buffer, length, newLength);
     if (rc) {
         zrtpProtect++;
     }
@@ -238,108 +263,183 @@ bool CtZrtpStream::processOutgoingRtp(uint8_t *buffer, size_t length, size_t *ne
 }
 
 int32_t CtZrtpStream::processIncomingRtp(uint8_t *buffer, const size_t length, size_t *newLength) {
-    int32_t rc = 0;
+    // The arrival time jitter is entropy, costs only a clock read if the harvester runs
+    ZrtpRandom::addEventEntropy(static_cast<uint32_t>(length));
+
     // check if this could be a real RTP/SRTP packet.
-    if ((*buffer & 0xc0) == 0x80) {             // A real RTP, check if we are in secure mode
-        if (supressCounter < supressWarn)       // Don't report SRTP problems while in startup mode
-            supressCounter++;
+    if ((*buffer & 0xc0) == 0x80)               // A real RTP, check if we are in secure mode
+        return unprotectRtp(buffer, length, newLength);
 
-        if (recvSrtp == NULL) {                 // no ZRTP/SRTP available
-            if (!useSdesForMedia || sdes == NULL) {  // no SDES stream available, just set length and return
-                *newLength = length;
-                /*
-                 * In discriminator mode:
-                 * If we receive RTP rather than SRTP we must silently discard the packets.
-                 * No message (discard silently)
-                 */
-                if (discriminatorMode) {
-                    return 0;                   // discards packet silently
-                }
-                return 1;
-            }
-            rc = sdes->incomingRtp(buffer, length, newLength, srtpErrorElement());
-            if (rc == 1) {                      // SDES unprotect OK, do some statistics and return success
-                sdesUnprotect++;
-                if (*sdesTempBuffer != 0)       // clear SDES crypto string if not already done
-                    memset(sdesTempBuffer, 0, maxSdesString);
+    // At this point we assume the packet is not a RTP packet. Check if it is a ZRTP packet.
+    return processZrtp(buffer, length);
+}
+
+int32_t CtZrtpStream::processIncomingPacket(uint8_t *buffer, const size_t length, size_t *newLength, int32_t packetClass) {
+    switch (packetClass) {
+    case ZrtpDemux::Rtp:
+        return unprotectRtp(buffer, length, newLength);
+
+    case ZrtpDemux::Rtcp:
+        return unprotectRtcp(buffer, length, newLength);
+
+    case ZrtpDemux::Zrtp:
+        return processZrtp(buffer, length);
+
+    case ZrtpDemux::Stun:
+    case ZrtpDemux::Dtls:
+    case ZrtpDemux::Turn:
+        *newLength = length;                    // the application processes these packets
+        return 1;
+
+    default:
+        return 0;
+    }
+}
+
+int32_t CtZrtpStream::unprotectRtp(uint8_t *buffer, const size_t length, size_t *newLength) {
+    int32_t rc = 0;
+
+    if (supressCounter < supressWarn)       // Don't report SRTP problems while in startup mode
+        supressCounter++;
+
+    // During the grace window try the context of the last good packet first
+    CryptoContext* grace = graceContext();
+    if (grace != NULL && graceFirst.load(std::memory_order_relaxed)) {
+        rc = SrtpHandler::unprotect(grace, buffer, length, newLength);
+        if (rc == 1) {
+            zrtpUnprotect++;
+            return checkUnprotect(rc);
+        }
+        if (rc != -1)                       // same result with the new context
+            return checkUnprotect(rc);
+        graceFirst.store(false, std::memory_order_relaxed);
+        grace = NULL;
+    }
+
+    CryptoContext* srtp = recvSrtp.load(std::memory_order_acquire);
+    if (srtp == NULL) {                     // no ZRTP/SRTP available
+        if (!useSdesForMedia || sdes == NULL) {  // no SDES stream available, just set length and return
+            *newLength = length;
+            /*
+             * In discriminator mode:
+             * If we receive RTP rather than SRTP we must silently discard the packets.
+             * No message (discard silently)
+             */
+            if (discriminatorMode) {
+                return 0;                   // discards packet silently
             }
+            return 1;
+        }
+        rc = sdes->incomingRtp(buffer, length, newLength, &lastSrtpError);
+        if (rc == 1) {                      // SDES unprotect OK, do some statistics and return success
+            sdesUnprotect++;
+            if (sdesTempBuffer != NULL && *sdesTempBuffer != 0)   // clear SDES crypto string if not already done
+                memset(sdesTempBuffer, 0, maxSdesString);
+        }
+    }
+    else {
+        // At this point we have an active ZRTP/SRTP context, unprotect with ZRTP/SRTP first
+        bool zrtpDone;
+        if (useSdesForMedia && sdes != NULL) {    // We still have a SDES - other client did not send matching zrtp-hash
+            rc = sdes->incomingRtpTwice(srtp, buffer, length, newLength, &zrtpDone, &lastSrtpError);
         }
         else {
-            // At this point we have an active ZRTP/SRTP context, unprotect with ZRTP/SRTP first
-            rc = SrtpHandler::unprotect(recvSrtp, buffer, length, newLength, srtpErrorElement());
-            if (rc == 1) {
-                zrtpUnprotect++;
-                // Got a good SRTP, check state and if in WaitConfAck (an Initiator state)
-                // then simulate a conf2Ack, refer to RFC 6189, chapter 4.6, last paragraph
+            rc = SrtpHandler::unprotect(srtp, buffer, length, newLength, &lastSrtpError);
+            zrtpDone = (rc == 1);
+        }
+        if (zrtpDone) {
+            zrtpUnprotect++;
+            // Got a good SRTP, check state and if in WaitConfAck (an Initiator state)
+            // then simulate a conf2Ack, refer to RFC 6189, chapter 4.6, last paragraph.
+            // After the engine reached secure state skip the checks
+            if (!secureSteady.load(std::memory_order_relaxed)) {
                 if (zrtpEngine->inState(WaitConfAck)) {
                     zrtpEngine->conf2AckSecure();
                 }
-                if (useSdesForMedia && sdes != NULL) {    // We still have a SDES - other client did not send matching zrtp-hash
-                    rc = sdes->incomingRtp(buffer, *newLength, newLength, srtpErrorElement());
+                if (zrtpEngine->inState(SecureState)) {
+                    secureSteady.store(true, std::memory_order_relaxed);
                 }
             }
-            else if (sdes != NULL) {
-                rc = sdes->incomingRtp(buffer, length, newLength, srtpErrorElement());
-            }
-        }
-        if (rc == 1) {
-            srtpAuthErrorBurst = 0;
-            srtpReplayErrorBurst = 0;
-            srtpDecodeErrorBurst = 0;
-            return 1;
         }
-        // We come to this point only if we have some problems during SRTP unprotect
-        else if (rc == 0) {
-            srtpDecodeErrorBurst++; 
-            errorInfoIndex++;
-        }
-        else if (rc == -1) {
-            srtpAuthErrorBurst++;
-            errorInfoIndex++;
-        }
-        else if (rc == -2) {
-            srtpReplayErrorBurst++;
-            errorInfoIndex++;
+        else if (sdes != NULL) {
+            rc = sdes->incomingRtp(buffer, length, newLength, &lastSrtpError);
         }
+    }
+    // A late packet with the old keys
+    if (rc == -1 && grace != NULL && SrtpHandler::unprotect(grace, buffer, length, newLength) == 1) {
+        graceFirst.store(true, std::memory_order_relaxed);
+        zrtpUnprotect++;
+        rc = 1;
+    }
+    return checkUnprotect(rc);
+}
+
+int32_t CtZrtpStream::unprotectRtcp(uint8_t *buffer, const size_t length, size_t *newLength) {
+    CryptoContextCtrl* srtcp = recvSrtcp;
 
+    if (srtcp == NULL) {
+        if (useSdesForMedia && sdes != NULL)
+            return sdes->incomingSrtcp(buffer, length, newLength);
+        *newLength = length;
+        // In discriminator mode silently discard RTCP, refer to the RTP case
+        return discriminatorMode ? 0 : 1;
+    }
+    int32_t rc = SrtpHandler::unprotectCtrl(srtcp, buffer, length, newLength);
+    if (rc != 1)
         unprotectFailed++;
-        if (supressCounter >= supressWarn) {
-            if (rc == 0 && srtpDecodeErrorBurst > srtpErrorBurstThreshold && zrtpUserCallback != NULL) {
-                zrtpUserCallback->onZrtpWarning(session, (char*)srtpDecodeFailedMsg, index);
-            }
-            if (rc == -1 && srtpAuthErrorBurst >= srtpErrorBurstThreshold) {
-                sendInfo(Warning, WarningSRTPauthError);
-            }
-            if (rc == -2 && srtpReplayErrorBurst >= srtpErrorBurstThreshold){
-                sendInfo(Warning, WarningSRTPreplayError);
-            }
+    return rc;
+}
+
+int32_t CtZrtpStream::processZrtp(uint8_t *buffer, const size_t length) {
+    size_t useLength;
+
+    // In any case, let the application drop the packet
+    uint8_t* zrtpMsg = checkZrtp(buffer, length, &useLength);
+    if (zrtpMsg != NULL)
+        zrtpEngine->processZrtpMessage(zrtpMsg, peerSSRC, useLength);
+    return 0;
+}
+
+// ZRTP messages the batch function hands to the engine at once
+static const int32_t maxZrtpBatch = 16;
+
+void CtZrtpStream::processZrtpBatch(uint8_t* buffers[], const size_t lengths[], int32_t count) {
+    uint8_t* messages[maxZrtpBatch];
+    size_t useLengths[maxZrtpBatch];
+    int32_t numMessages = 0;
+
+    for (int32_t i = 0; i < count; i++) {
+        messages[numMessages] = checkZrtp(buffers[i], lengths[i], &useLengths[numMessages]);
+        if (messages[numMessages] != NULL)
+            numMessages++;
+        if (numMessages == maxZrtpBatch || (i == count - 1 && numMessages > 0)) {
+            zrtpEngine->processZrtpMessages(messages, useLengths, numMessages, peerSSRC);
+            numMessages = 0;
         }
-        return rc;
     }
+}
 
-    // At this point we assume the packet is not a RTP packet. Check if it is a ZRTP packet.
-    // Process it if ZRTP processing is started. In any case, let the application drop
-    // the packet.
+uint8_t* CtZrtpStream::checkZrtp(uint8_t *buffer, const size_t length, size_t* useLength) {
+
+    // Process it only if ZRTP processing is started
     if (started) {
         // Fixed header length + smallest ZRTP packet (includes CRC)
         if (length < (12 + sizeof(HelloAckPacket_t))) // data too small, dismiss
-            return 0;
+            return NULL;
 
-        size_t useLength = length;
+        *useLength = length;
  
-        uint32_t magic = *(uint32_t*)(buffer + 4);
-        magic = zrtpNtohl(magic);
-
         // Check if it is really a ZRTP packet, return, no further processing
-        if (magic != ZRTP_MAGIC) {
-            return 0;
+        if (zrtpPacketMagic(buffer) != ZRTP_MAGIC) {
+            return NULL;
         }
         if (useZrtpTunnel) {
             size_t newLength;
+            int32_t rc;
             *buffer = 0x80;                                    // make it look like a real RTP packet
-            rc = sdes->incomingZrtpTunnel(buffer, length, &newLength, srtpErrorElement());
+            rc = sdes->incomingZrtpTunnel(buffer, length, &newLength, &lastSrtpError);
             if (rc < 0) {
-                errorInfoIndex++;
+                recordSrtpError(0);
                 if (rc == -1) {
                     zrtp_log("CtZrtpStream", "Receiving tunneled ZRTP - SRTP failure -1");
                     sendInfo(Warning, WarningSRTPauthError*-1);
@@ -348,11 +448,11 @@ int32_t CtZrtpStream::processIncomingRtp(uint8_t *buffer, const size_t length, s
                     zrtp_log("CtZrtpStream", "Receiving tunneled ZRTP - SRTP failure -2");
                     sendInfo(Warning, WarningSRTPreplayError*-1);
                 }
-                return 0;
+                return NULL;
             }
-            if (*sdesTempBuffer != 0)                          // clear SDES crypto string if not already done
+            if (sdesTempBuffer != NULL && *sdesTempBuffer != 0) // clear SDES crypto string if not already done
                 memset(sdesTempBuffer, 0, maxSdesString);
-            useLength = newLength + CRC_SIZE;                  // length check assumes a ZRTP CRC
+            *useLength = newLength + CRC_SIZE;                  // length check assumes a ZRTP CRC
         }
         else {
             /*
@@ -361,14 +461,19 @@ int32_t CtZrtpStream::processIncomingRtp(uint8_t *buffer, const size_t length, s
              * No message (discard silently)
              */
             if (discriminatorMode) {
-                return 0;
+                return NULL;
             }
             DEBUG(char tmpBuffer[500];)
             useZrtpTunnel = false;
+
+            // Drop a flood of packets before the CRC check and the DH computations, the
+            // SSRC identifies the source
+            if (!packetFilter.checkPacket(buffer, length, zrtpPacketSsrc(buffer)))
+                return NULL;
+
             // Get CRC value into crc (see above how to compute the offset)
             uint16_t temp = length - CRC_SIZE;
-            uint32_t crc = *(uint32_t*)(buffer + temp);
-            crc = zrtpNtohl(crc);
+            uint32_t crc = zrtpLoadBe32(buffer + temp);
             if (!zrtpCheckCksum(buffer, temp, crc)) {
                 zrtpCrcErrors++;
                 if (zrtpCrcErrors > 15) {
@@ -377,20 +482,107 @@ int32_t CtZrtpStream::processIncomingRtp(uint8_t *buffer, const size_t length, s
                     sendInfo(Warning, WarningCRCmismatch);
                     zrtpCrcErrors = 0;
                 }
-                return 0;
+                return NULL;
             }
+            if (!packetFilter.checkBinding(buffer, length))
+                return NULL;
         }
         // this now points to the plain ZRTP message.
         unsigned char* zrtpMsg = (buffer + 12);
 
         // store peer's SSRC in host order, used when creating the CryptoContext
-        if (peerSSRC == 0) {
-            peerSSRC = *(uint32_t*)(buffer + 8);
-            peerSSRC = zrtpNtohl(peerSSRC);
-        }
-        zrtpEngine->processZrtpMessage(zrtpMsg, peerSSRC, useLength);
+        if (peerSSRC == 0)
+            peerSSRC = zrtpPacketSsrc(buffer);
+        return zrtpMsg;
     }
-    return 0;
+    return NULL;
+}
+
+int32_t CtZrtpStream::checkUnprotect(int32_t rc) {
+    if (rc == 1) {
+        srtpAuthErrorBurst = 0;
+        srtpReplayErrorBurst = 0;
+        srtpDecodeErrorBurst = 0;
+        return 1;
+    }
+    // We come to this point only if we have some problems during SRTP unprotect
+    else if (rc == 0) {
+        srtpDecodeErrorBurst++; 
+        recordSrtpError(srtpDecodeErrorBurst);
+    }
+    else if (rc == -1) {
+        srtpAuthErrorBurst++;
+        recordSrtpError(srtpAuthErrorBurst);
+    }
+    else if (rc == -2) {
+        srtpReplayErrorBurst++;
+        recordSrtpError(srtpReplayErrorBurst);
+    }
+
+    unprotectFailed++;
+    if (supressCounter >= supressWarn) {
+        reportSrtpError(rc);
+    }
+    return rc;
+}
+
+/*
+ * Report a burst of SRTP errors at most once per errorReportInterval, even if
+ * an attacker or a bad key change makes every packet fail. The warning carries
+ * the counts of the errors since the previous warning.
+ */
+void CtZrtpStream::reportSrtpError(int32_t rc) {
+    bool burst = false;
+
+    if (rc == 0) {
+        reportDecodeErrors++;
+        burst = srtpDecodeErrorBurst > srtpErrorBurstThreshold;
+    }
+    else if (rc == -1) {
+        reportAuthErrors++;
+        burst = srtpAuthErrorBurst >= srtpErrorBurstThreshold;
+    }
+    else if (rc == -2) {
+        reportReplayErrors++;
+        burst = srtpReplayErrorBurst >= srtpErrorBurstThreshold;
+    }
+    if (!burst || zrtpUserCallback == NULL)
+        return;
+
+    int64_t now = (int64_t)zrtpGetMonotonicTime();
+    if (now < nextErrorReport)
+        return;
+    nextErrorReport = now + errorReportInterval;
+
+    std::string msg((rc == 0) ? srtpDecodeFailedMsg :
+                    *warningMap[(rc == -1) ? WarningSRTPauthError : WarningSRTPreplayError]);
+    char counts[100];
+    snprintf(counts, sizeof(counts), " (errors: %u authentication, %u replay, %u decode)",
+             reportAuthErrors, reportReplayErrors, reportDecodeErrors);
+    msg.append(counts);
+    reportAuthErrors = 0;
+    reportReplayErrors = 0;
+    reportDecodeErrors = 0;
+
+    zrtpUserCallback->onZrtpWarning(session, (char*)msg.c_str(), index);
+}
+
+CryptoContext* CtZrtpStream::sendFastPath() {
+    // A stream that protects twice (SDES and ZRTP) takes the single packet path
+    if (useSdesForMedia && sdes != NULL)
+        return NULL;
+    return sendSrtp.load(std::memory_order_acquire);
+}
+
+CryptoContext* CtZrtpStream::recvFastPath() {
+    // Before secure state a good packet may trigger a ZRTP state change, an SDES
+    // stream may unprotect a packet that ZRTP/SRTP rejects
+    if (!secureSteady.load(std::memory_order_relaxed) || sdes != NULL)
+        return NULL;
+    // The grace window may need the previous context
+    if (graceSrtp.load(std::memory_order_relaxed) != NULL)
+        return NULL;
+    return recvSrtp.load(std::memory_order_acquire);
 }
 
 int CtZrtpStream::getSignalingHelloHash(char *hHash, int32_t index) {
@@ -412,6 +604,9 @@ void CtZrtpStream::setSignalingHelloHash(const char *hHash) {
     zrtpEngine->setT1ResendExtend(200);
     zrtpEngine->setT2Resend(-1);
 
+    // The peer talks ZRTP, prepare the key pair while the discovery runs
+    zrtpEngine->startSpeculativeKeyGeneration();
+
     std::string hashStr;
     hashStr.assign(hHash);
 
@@ -536,6 +731,23 @@ int CtZrtpStream::getInfo(const char *key, char *p, int maxLen) {
     T_ZRTP_LB("lbClient",  zrtpEngine->getPeerClientId().c_str());
     T_ZRTP_LB("lbVersion", client.c_str());
 
+    // Handshake phase times and CPU times in microseconds, -1 if a phase was not reached
+    const ZRtp::zrtpInfo *times = zrtpEngine->getDetailInfo();
+    T_ZRTP_L("t_hello",       times->phaseTime[ZRtp::PhaseHello]);
+    T_ZRTP_L("t_helloack",    times->phaseTime[ZRtp::PhaseHelloAck]);
+    T_ZRTP_L("t_commit",      times->phaseTime[ZRtp::PhaseCommit]);
+    T_ZRTP_L("t_dh1",         times->phaseTime[ZRtp::PhaseDHPart1]);
+    T_ZRTP_L("t_dh2",         times->phaseTime[ZRtp::PhaseDHPart2]);
+    T_ZRTP_L("t_confirm1",    times->phaseTime[ZRtp::PhaseConfirm1]);
+    T_ZRTP_L("t_confirm2",    times->phaseTime[ZRtp::PhaseConfirm2]);
+    T_ZRTP_L("t_conf2ack",    times->phaseTime[ZRtp::PhaseConf2Ack]);
+    T_ZRTP_L("t_secure",      times->phaseTime[ZRtp::PhaseSecure]);
+    T_ZRTP_I("t_sent",        times->phaseSent);
+    T_ZRTP_L("cpu_keygen",    times->cpuTime[ZRtp::CpuDhKeygen]);
+    T_ZRTP_L("cpu_agreement", times->cpuTime[ZRtp::CpuDhAgreement]);
+    T_ZRTP_L("cpu_kdf",       times->cpuTime[ZRtp::CpuKdf]);
+    T_ZRTP_L("cpu_cache",     times->cpuTime[ZRtp::CpuCache]);
+
     if (recvSrtp != NULL || sendSrtp != NULL) {
         info = zrtpEngine->getDetailInfo();
 
@@ -587,12 +799,16 @@ int CtZrtpStream::getInfo(const char *key, char *p, int maxLen) {
     return 0;
 }
 
+// The counters of the packet filter follow the counters of the ZRTP engine
 int CtZrtpStream::getNumberOfCountersZrtp() {
-    return zrtpEngine->getNumberOfCountersZrtp();
+    return zrtpEngine->getNumberOfCountersZrtp() + packetFilter.getNumberOfCounters();
 }
 
 int CtZrtpStream::getCountersZrtp(int32_t* counters) {
-    return zrtpEngine->getCountersZrtp(counters);
+    int number = zrtpEngine->getCountersZrtp(counters);
+    if (number < 0)
+        return number;
+    return number + packetFilter.getCounters(counters + number);
 }
 
 int CtZrtpStream::enrollAccepted(char *p) {
@@ -653,6 +869,8 @@ bool CtZrtpStream::parseSdes(char *recvCryptoStr, size_t recvLength, char *sendC
     if (!sipInvite) {
         size_t len;
         if (sendCryptoStr == NULL) {
+            if (sdesTempBuffer == NULL)
+                sdesTempBuffer = new char[maxSdesString]();
             sendCryptoStr = sdesTempBuffer;
             len = maxSdesString;
             sendLength = &len;
@@ -682,12 +900,13 @@ bool CtZrtpStream::parseSdes(char *recvCryptoStr, size_t recvLength, char *sendC
 
 bool CtZrtpStream::getSavedSdes(char *sendCryptoStr, size_t *sendLength) {
 
-    size_t len = strlen(sdesTempBuffer);
+    const char *saved = (sdesTempBuffer != NULL) ? sdesTempBuffer : "";
+    size_t len = strlen(saved);
 
     if (len >= *sendLength)
         return false;
 
-    strcpy(sendCryptoStr, sdesTempBuffer);
+    strcpy(sendCryptoStr, saved);
     *sendLength = len;
 
     if (zrtpUserCallback != NULL)
@@ -756,27 +975,39 @@ void CtZrtpStream::setAuxSecret(const unsigned char *secret, uint32_t length) {
  */
 int32_t CtZrtpStream::sendDataZRTP(const unsigned char *data, int32_t length) {
 
+    uint8_t zrtpBuffer[maxZrtpSize];     /* The callbacks send the packet before they return */
     uint16_t totalLen = length + 12;     /* Fixed number of bytes of ZRTP header */
     uint32_t crc;
 
-    uint16_t* pus;
-    uint32_t* pui;
-
     size_t newLength;
 
     if ((totalLen) > maxZrtpSize)
         return 0;
 
-    /* Get some handy pointers */
-    pus = (uint16_t*)zrtpBuffer;
-    pui = (uint32_t*)zrtpBuffer;
-
     /* set up fixed ZRTP header */
     *(zrtpBuffer + 1) = 0;
-    pus[1] = zrtpHtons(senderZrtpSeqNo++);
-    pui[1] = zrtpHtonl(ZRTP_MAGIC);
-    pui[2] = zrtpHtonl(ownSSRC);            // ownSSRC is stored in host order
+    zrtpStoreBe16(zrtpBuffer + 2, senderZrtpSeqNo++);
+    zrtpStoreBe32(zrtpBuffer + 4, ZRTP_MAGIC);
+    zrtpStoreBe32(zrtpBuffer + 8, ownSSRC);     // ownSSRC is stored in host order
+
+    // Send the plain ZRTP packet without copying the message from the engine's packet buffer
+    if (!useZrtpTunnel && !discriminatorMode && zrtpSendCallback != NULL) {
+        uint8_t crcData[CRC_SIZE];
 
+        *zrtpBuffer = 0x10;                                            // invalid RTP version - refer to ZRTP spec chap 5
+        crc = zrtpGenerateCksum(zrtpBuffer, 12);
+        crc = zrtpUpdateCksum(crc, data, length - CRC_SIZE);
+        crc = zrtpEndCksum(crc);
+        zrtpStoreBe32(crcData, crc);
+
+        SrtpIoVec fragments[3] = {{zrtpBuffer, 12}, {(uint8_t*)data, (size_t)(length - CRC_SIZE)}, {crcData, CRC_SIZE}};
+        if (!zrtpSendCallback->sendRtpv(session, fragments, 3, totalLen, index)) {
+            memcpy(zrtpBuffer+12, data, length - CRC_SIZE);
+            memcpy(zrtpBuffer+totalLen-CRC_SIZE, crcData, CRC_SIZE);
+            zrtpSendCallback->sendRtp(session, zrtpBuffer, totalLen, index);
+        }
+        return 1;
+    }
     memcpy(zrtpBuffer+12, data, length);    // Copy ZRTP message data behind the header data
 
     if (useZrtpTunnel) {
@@ -798,7 +1029,7 @@ int32_t CtZrtpStream::sendDataZRTP(const unsigned char *data, int32_t length) {
         *zrtpBuffer = 0x10;                                            // invalid RTP version - refer to ZRTP spec chap 5
         crc = zrtpGenerateCksum(zrtpBuffer, totalLen-CRC_SIZE);        // Setup and compute ZRTP CRC
         crc = zrtpEndCksum(crc);                                       // convert and store CRC in ZRTP packet.
-        *(uint32_t*)(zrtpBuffer+totalLen-CRC_SIZE) = zrtpHtonl(crc);
+        zrtpStoreBe32(zrtpBuffer + totalLen - CRC_SIZE, crc);
     }
 
     /* Send the ZRTP packet using callback */
@@ -836,6 +1067,19 @@ bool CtZrtpStream::srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part)
     if (secrets->symEncAlgorithm == TwoFish)
         cipher = SrtpEncryptionTWOCM;
 
+    // AES-GCM: the cipher mode authenticates, no separate authentication
+    if (secrets->authAlgorithm == AesGcm) {
+        cipher = (secrets->initKeyLen == 128) ? SrtpEncryptionAESGCM128 : SrtpEncryptionAESGCM256;
+        authn = SrtpAuthenticationNull;
+        authKeyLen = 0;
+    }
+
+    if (secrets->authAlgorithm == ChaCha20Poly1305) {
+        cipher = SrtpEncryptionCHACHA20POLY1305;
+        authn = SrtpAuthenticationNull;
+        authKeyLen = 0;
+    }
+
     role = secrets->role;
 
     if (part == ForSender) {
@@ -902,10 +1146,13 @@ bool CtZrtpStream::srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part)
         if (senderCryptoContext == NULL) {
             return false;
         }
-        senderCryptoContext->deriveSrtpKeys(0L);
-        sendSrtp = senderCryptoContext;
+        senderCryptoContext->setExportable(stateExport);
+        senderCryptoContextCtrl->setExportable(stateExport);
+
+        // One master key schedule and one key stream pass for SRTP and SRTCP
+        senderCryptoContext->deriveSrtpKeys(0L, senderCryptoContextCtrl);
+        retireSrtp(sendSrtp.exchange(senderCryptoContext, std::memory_order_release));
 
-        senderCryptoContextCtrl->deriveSrtcpKeys();
         sendSrtcp = senderCryptoContextCtrl;
     }
     if (part == ForReceiver) {
@@ -971,10 +1218,14 @@ bool CtZrtpStream::srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part)
         if (recvCryptoContext == NULL) {
             return false;
         }
-        recvCryptoContext->deriveSrtpKeys(0L);
-        recvSrtp = recvCryptoContext;
+        recvCryptoContext->setExportable(stateExport);
+        recvCryptoContextCtrl->setExportable(stateExport);
+        recvCryptoContext->deriveSrtpKeys(0L, recvCryptoContextCtrl);
+        // Publish the previous context first, packets in flight under the old keys stay valid
+        startGrace(recvSrtp.load(std::memory_order_relaxed));
+        retireSrtp(recvSrtp.exchange(recvCryptoContext, std::memory_order_release));
+        secureSteady = false;
 
-        recvCryptoContextCtrl->deriveSrtcpKeys();
         recvSrtcp = recvCryptoContextCtrl;
 
         supressCounter = 0;         // supress SRTP warnings for some packets after we switch to SRTP
@@ -1031,36 +1282,92 @@ void CtZrtpStream::srtpSecretsOn(std::string cipher, std::string sas, bool verif
 
 void CtZrtpStream::srtpSecretsOff(EnableSecurity part) {
     if (part == ForSender) {
-        delete sendSrtp;
+        retireSrtp(sendSrtp.exchange(NULL));
         delete sendSrtcp;
-        sendSrtp = NULL;
         sendSrtcp = NULL;
     }
     if (part == ForReceiver) {
-        delete recvSrtp;
+        startGrace(recvSrtp.load(std::memory_order_relaxed));
+        retireSrtp(recvSrtp.exchange(NULL));
         delete recvSrtcp;
-        recvSrtp = NULL;
         recvSrtcp = NULL;
+        secureSteady = false;
+    }
+}
+
+void CtZrtpStream::retireSrtp(CryptoContext* context) {
+    // The media path may still use the context, delete it when the stream stops
+    if (context != NULL)
+        retiredSrtp.push_back(context);
+}
+
+void CtZrtpStream::startGrace(CryptoContext* context) {
+    if (context == NULL || graceTime <= 0 || gracePackets <= 0) {
+        graceSrtp.store(NULL, std::memory_order_release);
+        return;
+    }
+    gracePacketsLeft.store(gracePackets, std::memory_order_relaxed);
+    graceEnd.store((int64_t)zrtpGetMonotonicTime() + graceTime, std::memory_order_relaxed);
+    // Packets in flight use the old keys, try the old context first
+    graceFirst.store(true, std::memory_order_relaxed);
+    graceSrtp.store(context, std::memory_order_release);
+}
+
+CryptoContext* CtZrtpStream::graceContext() {
+    CryptoContext* grace = graceSrtp.load(std::memory_order_acquire);
+    if (grace == NULL)
+        return NULL;
+
+    if (gracePacketsLeft.fetch_sub(1, std::memory_order_relaxed) <= 0 ||
+        (int64_t)zrtpGetMonotonicTime() > graceEnd.load(std::memory_order_relaxed)) {
+        // The ZRTP engine may have started a new window meanwhile
+        graceSrtp.compare_exchange_strong(grace, NULL);
+        return NULL;
     }
+    return grace;
+}
+
+void CtZrtpStream::setSrtpGracePeriod(int32_t time, int32_t packets) {
+    graceTime = time;
+    gracePackets = packets;
+}
+
+void CtZrtpStream::setSrtpErrorReportInterval(int32_t interval) {
+    errorReportInterval = (interval < 0) ? 0 : interval;
+    nextErrorReport = 0;
+}
+
+TimeoutSource<int32_t, CtZrtpStream*>* CtZrtpStream::getSharedTimeouts() {
+    // Created on first use, thus sessions with caller driven timers do not start the threads
+    static ShardedTimeoutWheel<int32_t, CtZrtpStream*>* provider = NULL;
+    static std::once_flag created;
+
+    std::call_once(created, []() {
+        provider = new ShardedTimeoutWheel<int32_t, CtZrtpStream*>();
+        provider->start();
+    });
+    return provider;
 }
 
 int32_t CtZrtpStream::activateTimer(int32_t time) {
-    std::string s("ZRTP");
-    if (staticTimeoutProvider != NULL) {
-        staticTimeoutProvider->requestTimeout(time, this, s);
+    return activateTimerSlack(time, 0);
+}
+
+int32_t CtZrtpStream::activateTimerSlack(int32_t time, int32_t slack) {
+    if (timeoutSource != NULL) {
+        timeoutSource->requestTimeout(time, &timeoutEntry, slack);
     }
     return 1;
 }
 
 int32_t CtZrtpStream::cancelTimer() {
-    std::string s("ZRTP");
-    if (staticTimeoutProvider != NULL) {
-        staticTimeoutProvider->cancelRequest(this, s);
+    if (timeoutSource != NULL) {
+        timeoutSource->cancelRequest(&timeoutEntry);
     }
     return 1;
 }
 
-void CtZrtpStream::handleTimeout(const std::string &c) {
+void CtZrtpStream::handleTimeout(int32_t c) {
     if (zrtpEngine != NULL) {
         zrtpEngine->processTimeout();
     }
@@ -1215,11 +1522,27 @@ void CtZrtpStream::zrtpNotSuppOther() {
 }
 
 void CtZrtpStream::synchEnter() {
-    synchLock->Lock();
+    if (synchLock != NULL)
+#ifdef ZRTP_LOCK_PROFILING
+        synchLock->lock();
+#else
+        synchLock->Lock();
+#endif
 }
 
 void CtZrtpStream::synchLeave() {
-    synchLock->Unlock();
+    if (synchLock != NULL)
+#ifdef ZRTP_LOCK_PROFILING
+        synchLock->unlock();
+#else
+        synchLock->Unlock();
+#endif
+}
+
+void CtZrtpStream::disableLocks() {
+    // The stream runs in one executor thread only
+    delete synchLock;
+    synchLock = NULL;
 }
 
 void CtZrtpStream::zrtpAskEnrollment(GnuZrtpCodes::InfoEnrollment  info) {
@@ -1299,16 +1622,30 @@ bool CtZrtpStream::checkSASSignature(uint8_t* sasHash) {
     return true;
 }
 
-SrtpErrorData* CtZrtpStream::srtpErrorElement() {
-    if (errorInfoIndex >= NumSrtpErrorData) {
+void CtZrtpStream::recordSrtpError(uint32_t burst) {
+    if (srtpTraceSize <= 0)
+        return;
+
+    // A long burst records a sample of its errors, the trace keeps the errors before the burst
+    if (burst > srtpErrorBurstThreshold && (burst % srtpTraceSampleRate) != 0)
+        return;
+
+    SrtpErrorData* trace = srtpErrorInfo.load(std::memory_order_acquire);
+    if (trace == NULL) {
+        trace = new SrtpErrorData[srtpTraceSize]();
+        srtpErrorInfo.store(trace, std::memory_order_release);
+    }
+    trace[errorInfoIndex] = lastSrtpError;
+    errorInfoIndex++;
+    if (errorInfoIndex >= srtpTraceSize) {
         numErrorArrayWrap++;
-        errorInfoIndex %= NumSrtpErrorData;
+        errorInfoIndex = 0;
     }
-    return &srtpErrorInfo[errorInfoIndex];
 }
 
 int32_t CtZrtpStream::getSrtpTraceData(SrtpErrorData* data) {
-    if (errorInfoIndex == 0)
+    SrtpErrorData* trace = srtpErrorInfo.load(std::memory_order_acquire);
+    if (trace == NULL)
         return 0;
 
     int32_t index = errorInfoIndex;    // get the index for this run, other threads may change errorInfoIndex
@@ -1317,14 +1654,170 @@ int32_t CtZrtpStream::getSrtpTraceData(SrtpErrorData* data) {
     // start at index zero. The output array receives the data in chroncological order thus we need two
     // memcpy call to make it right.
     if (numErrorArrayWrap > 0) {
-        memcpy((void*)data, (void*)&srtpErrorInfo[index], (NumSrtpErrorData - index) * sizeof(SrtpErrorData));
-        memcpy((void*)&data[NumSrtpErrorData - index], (void*)srtpErrorInfo, index * sizeof(SrtpErrorData));
-        return NumSrtpErrorData;
+        memcpy((void*)data, (void*)&trace[index], (srtpTraceSize - index) * sizeof(SrtpErrorData));
+        memcpy((void*)&data[srtpTraceSize - index], (void*)trace, index * sizeof(SrtpErrorData));
+        return srtpTraceSize;
     }
-    memcpy((void*)data, (void*)srtpErrorInfo, index * sizeof(SrtpErrorData));
+    memcpy((void*)data, (void*)trace, index * sizeof(SrtpErrorData));
     return index;
 }
 
+void CtZrtpStream::setSrtpTraceSize(int32_t size) {
+    if (size < 0 || size > NumSrtpErrorData)
+        return;
+
+    delete[] srtpErrorInfo.exchange(NULL);
+    srtpTraceSize = size;
+    errorInfoIndex = 0;
+    numErrorArrayWrap = 0;
+}
+
+void CtZrtpStream::addMemoryUsage(MemoryUsage& usage) {
+    synchEnter();
+
+    size_t bytes = sizeof(CtZrtpStream);
+    if (sdesTempBuffer != NULL)
+        bytes += maxSdesString;
+    if (srtpErrorInfo.load() != NULL)
+        bytes += srtpTraceSize * sizeof(SrtpErrorData);
+    for (const std::string& hash : peerHelloHashes)
+        bytes += sizeof(std::string) + hash.capacity();
+    bytes += retiredSrtp.capacity() * sizeof(CryptoContext*);
+    usage.add(MemoryUsage::Session, bytes);
+
+    if (zrtpEngine != NULL)
+        zrtpEngine->addMemoryUsage(usage);
+    if (sdes != NULL)
+        sdes->addMemoryUsage(usage);
+
+    CryptoContext* contexts[] = {recvSrtp.load(), sendSrtp.load()};
+    for (CryptoContext* context : contexts) {
+        if (context != NULL)
+            context->addMemoryUsage(usage);
+    }
+    for (CryptoContext* context : retiredSrtp)
+        context->addMemoryUsage(usage);
+    if (recvSrtcp != NULL)
+        recvSrtcp->addMemoryUsage(usage);
+    if (sendSrtcp != NULL)
+        sendSrtcp->addMemoryUsage(usage);
+
+    synchLeave();
+}
+
+/*
+ * The stream state: role, own and peer SSRC, then the ZRTP secure state and
+ * the send SRTP, receive SRTP, send SRTCP and receive SRTCP states, each with
+ * a 16 bit length. Integers are in little endian order.
+ */
+static void appendUint(std::string& state, uint32_t value, int32_t length) {
+    for (int32_t i = 0; i < length; i++)
+        state.push_back(static_cast<char>(value >> (8 * i)));
+}
+
+static uint32_t getUint(const uint8_t** p, int32_t length) {
+    uint32_t value = 0;
+
+    for (int32_t i = 0; i < length; i++)
+        value |= (uint32_t)*(*p)++ << (8 * i);
+    return value;
+}
+
+template <class Context>
+static bool appendContext(std::string& state, const Context* context) {
+    if (context == NULL)
+        return false;
+
+    std::vector<uint8_t> buffer(context->getExportLength());
+    int32_t length = context->exportState(buffer.data(), (int32_t)buffer.size());
+    if (length < 0)
+        return false;
+    appendUint(state, length, 2);
+    state.append(reinterpret_cast<char*>(buffer.data()), length);
+    return true;
+}
+
+bool CtZrtpStream::exportState(std::string& state) {
+    synchEnter();
+
+    std::string secure = zrtpEngine->getSecureState();
+    CryptoContext* send = sendSrtp.load(std::memory_order_acquire);
+    CryptoContext* recv = recvSrtp.load(std::memory_order_acquire);
+    size_t start = state.size();
+    bool rc = false;
+
+    if (!secure.empty() && !useSdesForMedia) {
+        state.push_back(static_cast<char>(role));
+        appendUint(state, ownSSRC, 4);
+        appendUint(state, peerSSRC, 4);
+        appendUint(state, secure.size(), 2);
+        state.append(secure);
+        rc = appendContext(state, send) && appendContext(state, recv) &&
+             appendContext(state, sendSrtcp) && appendContext(state, recvSrtcp);
+    }
+    if (!rc)
+        state.resize(start);
+
+    synchLeave();
+    return rc;
+}
+
+bool CtZrtpStream::importState(const uint8_t* data, size_t length) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + length;
+    const uint8_t* parts[5];
+    size_t partLength[5];
+
+    if (started || length < 1 + 4 + 4)
+        return false;
+
+    int32_t newRole = *p++;
+    uint32_t own = getUint(&p, 4);
+    uint32_t peer = getUint(&p, 4);
+    for (int32_t i = 0; i < 5; i++) {
+        if (end - p < 2)
+            return false;
+        partLength[i] = getUint(&p, 2);
+        if ((size_t)(end - p) < partLength[i])
+            return false;
+        parts[i] = p;
+        p += partLength[i];
+    }
+    if (p != end)
+        return false;
+
+    CryptoContext* send = CryptoContext::importState(parts[1], partLength[1]);
+    CryptoContext* recv = CryptoContext::importState(parts[2], partLength[2]);
+    CryptoContextCtrl* sendCtrl = CryptoContextCtrl::importState(parts[3], partLength[3]);
+    CryptoContextCtrl* recvCtrl = CryptoContextCtrl::importState(parts[4], partLength[4]);
+
+    synchEnter();
+    bool rc = send != NULL && recv != NULL && sendCtrl != NULL && recvCtrl != NULL &&
+              zrtpEngine->setSecureState(std::string(reinterpret_cast<const char*>(parts[0]), partLength[0]));
+    if (rc) {
+        role = newRole;
+        ownSSRC = own;
+        peerSSRC = peer;
+        sendSrtcp = sendCtrl;
+        recvSrtcp = recvCtrl;
+        sendSrtp.store(send, std::memory_order_release);
+        recvSrtp.store(recv, std::memory_order_release);
+        useSdesForMedia = false;
+        enableZrtp = true;
+        started = true;
+        stateExport = true;
+    }
+    synchLeave();
+
+    if (!rc) {
+        delete send;
+        delete recv;
+        delete sendCtrl;
+        delete recvCtrl;
+    }
+    return rc;
+}
+
 void CtZrtpStream::initStrings() {
     if (initialized) {
         return;
@@ -22,15 +22,21 @@
 #ifndef _CTZRTPSTREAM_H_
 #define _CTZRTPSTREAM_H_
 
+#include <atomic>
 #include <map>
 #include <vector>
 
 #include <libzrtpcpp/ZrtpCallback.h>
 #include <libzrtpcpp/ZrtpSdesStream.h>
+#include <libzrtpcpp/ZrtpPacketFilter.h>
 #include <srtp/SrtpHandler.h>
 
 #include <CtZrtpSession.h>
-#include <TiviTimeoutProvider.h>
+#include <common/TimeoutWheel.h>
+#ifdef ZRTP_LOCK_PROFILING
+#include <mutex>
+#include <libzrtpcpp/ZrtpProfiledMutex.h>
+#endif
 
 // Define sizer of internal buffers.
 // NOTE: ZRTP buffer is large. An application shall never use ZRTP protocol
@@ -40,7 +46,11 @@ static const int maxSdesString = 256;
 
 static const uint32_t supressWarn = 200;
 static const uint32_t srtpErrorBurstThreshold = 20;
-static const int32_t NumSrtpErrorData = 200;
+static const int32_t srtpErrorReportInterval = 1000;   //!< default minimum time between two SRTP error warnings in ms
+static const uint32_t srtpTraceSampleRate = 16;  //!< a long error burst records every 16th error in the trace
+static const int32_t NumSrtpErrorData = 200;    //!< default and maximum size of the SRTP error trace
+static const int32_t srtpGraceTime = 500;       //!< default grace window of the previous SRTP context in ms
+static const int32_t srtpGracePackets = 50;     //!< default number of packets in the grace window
 
 class CryptoContext;
 class CryptoContextCtrl;
@@ -51,6 +61,12 @@ class CtZrtpSession;
 class ZrtpSdesStream;
 class CMutexClass;
 
+#ifdef ZRTP_LOCK_PROFILING
+typedef ZrtpProfiledMutex<std::mutex, ZrtpMetrics::StreamLock> CtZrtpStreamLock;
+#else
+typedef CMutexClass CtZrtpStreamLock;
+#endif
+
 class __EXPORT CtZrtpStream: public ZrtpCallback  {
 
 public:
@@ -81,7 +97,7 @@ protected:
 
     CtZrtpStream();
     friend class CtZrtpSession;
-    friend class TimeoutProvider<std::string, CtZrtpStream*>;
+    friend class TimeoutWheel<int32_t, CtZrtpStream*>;
 
 
     virtual ~CtZrtpStream();
@@ -90,7 +106,14 @@ protected:
      *
      * Just call the ZRTP engine for further processing.
      */
-    void handleTimeout(const std::string &c);
+    void handleTimeout(int32_t c);
+
+    /**
+     * Get the timeout provider that the streams share.
+     *
+     * The function starts the provider threads on first use.
+     */
+    static TimeoutSource<int32_t, CtZrtpStream*>* getSharedTimeouts();
 
     /**
      * Set the application's callback class.
@@ -166,6 +189,15 @@ protected:
      */
     int32_t processIncomingRtp(uint8_t* buffer, const size_t length, size_t* newLength);
 
+    /**
+     * @brief Process an incoming packet that ZrtpDemux classified.
+     *
+     * See CtZrtpSession::processIncomingPacket.
+     *
+     * @param packetClass the class of the packet, see ZrtpDemux::PacketClass
+     */
+    int32_t processIncomingPacket(uint8_t* buffer, const size_t length, size_t* newLength, int32_t packetClass);
+
     /**
      * @brief Get the ZRTP Hello hash to be used for signaling
      *
@@ -449,6 +481,80 @@ protected:
      */
     int32_t getSrtpTraceData(SrtpErrorData* data);
 
+    /**
+     * @brief Set the size of the SRTP error trace.
+     *
+     * The stream allocates the trace when it records the first SRTP error. A
+     * new size discards the recorded data.
+     *
+     * @param size Number of @c SrtpErrorData elements, 1 to @c NumSrtpErrorData.
+     *             Zero switches off the trace.
+     */
+    void setSrtpTraceSize(int32_t size);
+
+    /**
+     * @brief Set the grace window of the previous receive SRTP context.
+     *
+     * If the stream gets new SRTP keys or switches off SRTP the previous
+     * context still unprotects packets that were in flight. The window ends
+     * after @c time milliseconds or after @c packets received packets. The
+     * stream tries the context that unprotected the last good packet first.
+     * The new values apply to the next key change.
+     *
+     * @param time length of the window in milliseconds.
+     * @param packets maximum number of packets in the window, zero switches
+     *                the grace window off.
+     */
+    void setSrtpGracePeriod(int32_t time, int32_t packets);
+
+    /**
+     * @brief Set the minimum time between two SRTP error warnings.
+     *
+     * If a burst of SRTP errors reaches the threshold the stream reports the
+     * first error at once. Up to the end of the interval it only counts the
+     * errors, the next warning reports the counts of authentication, replay
+     * and decode errors since the previous warning.
+     *
+     * @param interval time in milliseconds, zero reports each error of a burst.
+     */
+    void setSrtpErrorReportInterval(int32_t interval);
+
+    /**
+     * @brief Add the memory of this stream to a footprint report.
+     *
+     * @param usage the footprint report, see CtZrtpSession::addMemoryUsage().
+     */
+    void addMemoryUsage(MemoryUsage& usage);
+
+    /**
+     * @brief Keep the SRTP master keys of the next key negotiation for exportState().
+     */
+    void setStateExport(bool yesNo) { stateExport = yesNo; }
+
+    /**
+     * @brief Append the secure state of this stream.
+     *
+     * The state contains the ZRTP secure state and the four SRTP and SRTCP
+     * contexts, see CtZrtpSession::exportState().
+     *
+     * @param state the function appends the state to this string.
+     * @return @c false if the stream is not secure or if its contexts did not
+     *         keep the master keys.
+     */
+    bool exportState(std::string& state);
+
+    /**
+     * @brief Restore the secure state of this stream.
+     *
+     * The stream must not run. The ZRTP engine enters the secure state and
+     * the stream uses the restored SRTP and SRTCP contexts.
+     *
+     * @param data the state that exportState() appended.
+     * @param length length of the state.
+     * @return @c false if the stream runs or the state is not valid.
+     */
+    bool importState(const uint8_t* data, size_t length);
+
     /*
      * The following methods implement the GNU ZRTP callback interface.
      * For detailed documentation refer to file ZrtpCallback.h
@@ -457,6 +563,8 @@ protected:
 
     int32_t activateTimer(int32_t time);
 
+    int32_t activateTimerSlack(int32_t time, int32_t slack);
+
     int32_t cancelTimer();
 
     void sendInfo(GnuZrtpCodes::MessageSeverity severity, int32_t subCode);
@@ -492,15 +600,32 @@ private:
     CtZrtpSession::tiviStatus  tiviState;  //!< Status reported to Tivi client
     CtZrtpSession::tiviStatus  prevTiviState;  //!< previous status reported to Tivi client
 
-    CryptoContext     *recvSrtp;           //!< The SRTP context for this stream
+    /*
+     * The media path reads the SRTP contexts without a lock. The ZRTP engine
+     * publishes a context after it derived the keys. If it switches off SRTP
+     * it retires the old context, stopStream deletes the retired contexts.
+     */
+    std::atomic<CryptoContext*> recvSrtp;  //!< The SRTP context for this stream
     CryptoContextCtrl *recvSrtcp;          //!< The SRTCP context for this stream
-    CryptoContext     *sendSrtp;           //!< The SRTP context for this stream
+    std::atomic<CryptoContext*> sendSrtp;  //!< The SRTP context for this stream
     CryptoContextCtrl *sendSrtcp;          //!< The SRTCP context for this stream
+    std::vector<CryptoContext*> retiredSrtp;
+
+    /*
+     * The previous receive context during the grace window, a retired
+     * context. graceFirst is true if it unprotected the last good packet.
+     */
+    std::atomic<CryptoContext*> graceSrtp;
+    std::atomic<int32_t> gracePacketsLeft;
+    std::atomic<int64_t> graceEnd;          //!< end of the window, monotonic clock in ms
+    std::atomic<bool> graceFirst;
+    int32_t graceTime;
+    int32_t gracePackets;
+    std::atomic<bool> secureSteady;        //!< ZRTP reached secure state, no state checks per packet
     CtZrtpCb          *zrtpUserCallback;
     CtZrtpSendCb      *zrtpSendCallback;
 
-    uint8_t zrtpBuffer[maxZrtpSize];
-    char sdesTempBuffer[maxSdesString];
+    char *sdesTempBuffer;                  //!< SDES crypto string for getSavedSdes, allocated on demand
     uint16_t senderZrtpSeqNo;
     uint32_t peerSSRC;
     std::vector<std::string> peerHelloHashes;
@@ -510,27 +635,98 @@ private:
     bool     useSdesForMedia;
     bool     useZrtpTunnel;
     bool     zrtpEncapSignaled;
+    bool     stateExport;                   //!< SRTP contexts keep the master keys, see setStateExport()
     ZrtpSdesStream *sdes;
 
     uint32_t supressCounter;
     uint32_t srtpAuthErrorBurst;
     uint32_t srtpReplayErrorBurst;
     uint32_t srtpDecodeErrorBurst;
+    uint32_t reportAuthErrors;              //!< errors since the last SRTP error warning
+    uint32_t reportReplayErrors;
+    uint32_t reportDecodeErrors;
+    int64_t nextErrorReport;                //!< earliest time of the next SRTP error warning, monotonic clock in ms
+    int32_t errorReportInterval;
     uint32_t zrtpCrcErrors;
+    ZrtpPacketFilter packetFilter;          //!< drops malformed, flooded and unbound ZRTP packets before the CRC check
 
-    CMutexClass *synchLock;
+    CtZrtpStreamLock *synchLock;
 
     char mixAlgoName[20];                   //!< stores name in during getInfo() call
 
     int role;                               //!< Initiator or Responder role
 
-    SrtpErrorData srtpErrorInfo[NumSrtpErrorData];
+    /*
+     * Unprotect stores the data of an SRTP error in lastSrtpError. Few streams
+     * ever see an error, thus the stream allocates the ring of the trace data
+     * when it records the first error.
+     */
+    SrtpErrorData lastSrtpError;
+    std::atomic<SrtpErrorData*> srtpErrorInfo;
+    int32_t srtpTraceSize;
     int32_t errorInfoIndex;
     uint32_t numErrorArrayWrap;
 
+    TimeoutSource<int32_t, CtZrtpStream*>* timeoutSource;   //!< the shared provider or the session's timers
+    TimeoutEntry<int32_t, CtZrtpStream*> timeoutEntry;    //!< the ZRTP engine uses one timer
+
     void initStrings();
     
-    SrtpErrorData* srtpErrorElement();
+    void recordSrtpError(uint32_t burst);
+
+    void reportSrtpError(int32_t rc);
+
+    void retireSrtp(CryptoContext* context);
+
+    /**
+     * Start the grace window of the previous receive context.
+     */
+    void startGrace(CryptoContext* context);
+
+    /**
+     * Get the previous receive context if the grace window runs, counts the
+     * packet and ends an expired window.
+     */
+    CryptoContext* graceContext();
+
+    void disableLocks();
+
+    int32_t checkUnprotect(int32_t rc);
+
+    /**
+     * Unprotect an incoming RTP packet, the incoming packet functions call it.
+     */
+    int32_t unprotectRtp(uint8_t* buffer, const size_t length, size_t* newLength);
+
+    /**
+     * Unprotect an incoming RTCP packet with the SRTCP or the SDES context.
+     */
+    int32_t unprotectRtcp(uint8_t* buffer, const size_t length, size_t* newLength);
+
+    /**
+     * Check and process an incoming ZRTP packet, the application drops it.
+     */
+    int32_t processZrtp(uint8_t* buffer, const size_t length);
+
+    /**
+     * Check several incoming ZRTP packets and hand them to the engine at once.
+     */
+    void processZrtpBatch(uint8_t* buffers[], const size_t lengths[], int32_t count);
+
+    /**
+     * Check an incoming ZRTP packet, returns the ZRTP message or @c NULL.
+     */
+    uint8_t* checkZrtp(uint8_t* buffer, const size_t length, size_t* useLength);
+
+    /**
+     * Get the SRTP context if outgoing packets need SRTP protection only.
+     */
+    CryptoContext* sendFastPath();
+
+    /**
+     * Get the SRTP context if incoming packets need SRTP unprotection only.
+     */
+    CryptoContext* recvFastPath();
 };
 
 #endif /* _CTZRTPSTREAM_H_ */
\ No newline at end of file
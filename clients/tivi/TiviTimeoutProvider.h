@@ -34,16 +34,23 @@
 
 #include <list>
 #include <stdint.h>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 
-#include "clients/tivi/timeoutHelper/Thread.h"
 #include <common/osSpecifics.h>
+#include <common/ZrtpAllocator.h>
+#ifdef ZRTP_LOCK_PROFILING
+#include <libzrtpcpp/ZrtpProfiledMutex.h>
+#endif
 
 /**
  * Represents a request of a "timeout" (delivery of a command to a
  * "timeout receiver" after at least a specified time period).
  *
- * Slightly modified to use gettimeofday directly.
+ * Slightly modified to use the monotonic clock, see zrtpGetMonotonicTime().
  *
  * @author Werner Dittmann
  */
@@ -52,18 +59,19 @@ class TPRequest
 {
 
 public:
+    ZRTP_ALLOCATOR_OPERATORS
 
     TPRequest( TOSubscriber tsi, int timeoutMs, const TOCommand &command):
         subscriber(tsi)
     {
-        when_ms = zrtpGetTickCount();
+        when_ms = zrtpGetMonotonicTime();
 
         when_ms += timeoutMs;
         this->command = command;
     }
 
     /**
-     * @param t  ms since Epoch
+     * @param t  ms of the monotonic clock
      */
     bool happensBefore(uint64_t t)
     {
@@ -87,7 +95,7 @@ public:
      */
     int getMsToTimeout ()
     {
-        uint64_t now = zrtpGetTickCount();
+        uint64_t now = zrtpGetMonotonicTime();
 
         if (happensBefore(now)) {
             return 0;
@@ -125,7 +133,7 @@ public:
 
 private:
     TOSubscriber subscriber;
-    uint64_t when_ms;       // Time since Epoch in ms when the timeout will happen
+    uint64_t when_ms;       // Monotonic clock time in ms when the timeout will happen
 
     TOCommand command;      // Command that will be delivered to the receiver (subscriber) of the timeout.
 };
@@ -133,20 +141,34 @@ private:
 /**
  * Class to generate objects giving timeout functionality.
  *
+ * The worker thread sleeps on a condition variable until the first request
+ * expires, it does not wake up periodically.
+ *
  * @author Erik Eliasson
  * @author Werner Dittmann
  */
 template<class TOCommand, class TOSubscriber>
-class TimeoutProvider : public CThread {
+class TimeoutProvider {
 
 private:
 
+    typedef std::unique_ptr<TPRequest<TOCommand, TOSubscriber> > RequestPtr;
+
     // The timeouts are ordered in the order of which they
     // will expire. Nearest in future is first in list.
-    std::list<std::unique_ptr<TPRequest<TOCommand, TOSubscriber> > > requests;
+    std::list<RequestPtr, ZrtpStdAllocator<RequestPtr> > requests;
+
+#ifdef ZRTP_LOCK_PROFILING
+    typedef ZrtpProfiledMutex<std::mutex, ZrtpMetrics::TimeoutLock> Lock;
+    typedef std::condition_variable_any Condition;
+#else
+    typedef std::mutex Lock;
+    typedef std::condition_variable Condition;
+#endif
 
-    CMutexClass synchLock;
-    CEventClass timeEvent;
+    Lock synchLock;
+    Condition timeEvent;
+    std::thread worker;
 
     bool stop;      // Flag to tell the worker thread
     // to terminate. Set to true and
@@ -164,25 +186,54 @@ public:
      * Destructor also terminates the Timeout thread.
      */
     ~TimeoutProvider() {
-        stop = true;
-        timeEvent.Set();
+        stopThread();
+    }
+
+    /**
+     * @brief Start the timeout thread.
+     *
+     * @param lpv
+     *    Not used, the argument keeps the interface of the former thread class.
+     */
+    bool Event(void* lpv = NULL) {
+        std::lock_guard<Lock> guard(synchLock);
+
+        if (!worker.joinable()) {
+            stop = false;
+            worker = std::thread(&TimeoutProvider::OnTask, this, lpv);
+        }
+        return true;
     }
 
     /**
      * @brief Reset the timeout provider, used in case if the provider is static before re-use
      */
     void reset() {
+        std::lock_guard<Lock> guard(synchLock);
+
         stop = false;
-        timeEvent.Reset();
         requests.clear();
     }
 
     /**
      * Terminates the Timeout provider thread.
      */
-    void stopThread(){
-        stop = true;
-        timeEvent.Set();
+    void stopThread() {
+        std::thread stopping;
+        {
+            std::lock_guard<Lock> guard(synchLock);
+
+            stop = true;
+            stopping.swap(worker);
+            timeEvent.notify_one();
+        }
+        if (!stopping.joinable())
+            return;
+        // A subscriber may stop the provider in its callback, the thread cannot join itself
+        if (stopping.get_id() == std::this_thread::get_id())
+            stopping.detach();
+        else
+            stopping.join();
     }
 
     /**
@@ -201,24 +252,17 @@ public:
         std::unique_ptr<TPRequest<TOCommand, TOSubscriber> > request(
                 new TPRequest<TOCommand, TOSubscriber>(subscriber, time_ms, command));
 
-        synchLock.Lock();
+        std::lock_guard<Lock> guard(synchLock);
 
-        if (requests.size()==0) {
-            requests.push_front(move(request));
-            timeEvent.Set();
-            synchLock.Unlock();
-            return;
-        }
-        if (request->happensBefore(requests.front().get())) {
+        // Only a new first request changes the wakeup time of the worker thread
+        if (requests.size() == 0 || request->happensBefore(requests.front().get())) {
             requests.push_front(move(request));
-            timeEvent.Set();
-            synchLock.Unlock();
+            timeEvent.notify_one();
             return;
         }
-        if (requests.back()->happensBefore(request.get())){
+        // A request that expires at the same time as the last request goes to the end as well
+        if (!request->happensBefore(requests.back().get())) {
             requests.push_back(move(request));
-            timeEvent.Set();
-            synchLock.Unlock();
             return;
         }
 
@@ -228,8 +272,6 @@ public:
                 break;
             }
         }
-        timeEvent.Set();
-        synchLock.Unlock();
     }
 
     /**
@@ -239,7 +281,8 @@ public:
      */
     void cancelRequest(TOSubscriber subscriber, const TOCommand &command)
     {
-        synchLock.Lock();
+        std::lock_guard<Lock> guard(synchLock);
+
         for(auto i = requests.begin(); i != requests.end(); ) {
             if( (*i)->getCommand() == command &&
                 (*i)->getSubscriber() == subscriber) {
@@ -248,46 +291,34 @@ public:
             }
             i++;
         }
-        synchLock.Unlock();
     }
 
-    virtual BOOL OnTask(LPVOID lpv)
+    bool OnTask(void* lpv)
     {
-        do {
-            synchLock.Lock();
-            int32_t time = 3600000;
-            int32_t size = 0;
+        std::unique_lock<Lock> guard(synchLock);
 
-            if ((size = requests.size()) > 0) {
-                time = requests.front()->getMsToTimeout();
-            }
-            if (time == 0 && size > 0) {
-                std::unique_ptr<TPRequest<TOCommand, TOSubscriber> >& req = requests.front();
-                TOSubscriber subs = req->getSubscriber();
-                TOCommand command = req->getCommand();
-
-                requests.pop_front();
-                if (stop) {         // This must be checked so that we will
-                    synchLock.Unlock();
-                    return FALSE;
-                }
-                synchLock.Unlock(); // call the command with free Mutex
-
-                subs->handleTimeout(command);
+        while (!stop) {
+            if (requests.size() == 0) {
+                timeEvent.wait(guard);
                 continue;
             }
-            else 
-                synchLock.Unlock();
-            if (stop) {     // If we are told to exit while executing cmd
-                return FALSE;
-            }
-            timeEvent.Wait(time);
-            timeEvent.Reset();
-            if (stop) {     // If we are told to exit while waiting we will exit
-                return FALSE;
+            int32_t time = requests.front()->getMsToTimeout();
+            if (time > 0) {
+                // Wake up at the deadline of the first request, a new first request notifies
+                timeEvent.wait_until(guard, std::chrono::steady_clock::now() + std::chrono::milliseconds(time));
+                continue;
             }
+            std::unique_ptr<TPRequest<TOCommand, TOSubscriber> >& req = requests.front();
+            TOSubscriber subs = req->getSubscriber();
+            TOCommand command = req->getCommand();
 
-        } while (true);
+            requests.pop_front();
+
+            guard.unlock();     // call the command with free Mutex
+            subs->handleTimeout(command);
+            guard.lock();
+        }
+        return false;
     }
 
 };
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2026, the ZRTPCPP contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+package wd.tivi;
+
+/**
+ * On-device benchmark harness of the ZRTP library.
+ *
+ * Build the native library with
+ * <pre>
+ *     ndk-build APP_MODULES=zrtpbench APP_ABI="armeabi-v7a arm64-v8a"
+ * </pre>
+ * and run the benchmarks in a background thread, each run takes several
+ * seconds up to minutes:
+ * <pre>
+ *     String json = ZrtpBench.run("cryptobench", new String[] {"-m", "500"},
+ *                                 context.getCacheDir().getPath());
+ * </pre>
+ *
+ * The result is a JSON document with the fields {@code benchmark},
+ * {@code abi}, {@code pointer_bits}, {@code build}, {@code exit_code} and
+ * {@code report}. The report is the JSON output of the benchmark, the
+ * options of the benchmarks are the same as on the command line. To compare
+ * the generic and the ARMv8 crypto code run cryptobench with {@code -c 0}
+ * and without.
+ */
+public class ZrtpBench {
+    static {
+        System.loadLibrary("zrtpbench");
+    }
+
+    /**
+     * Run a benchmark.
+     *
+     * @param benchmark
+     *     cryptobench, srtpbench or handshakebench
+     * @param args
+     *     the command line options of the benchmark, may be {@code null}
+     * @param workDir
+     *     a writable directory for the output and the ZID cache of the
+     *     handshake benchmark
+     * @return
+     *     the JSON document, {@code null} for an unknown benchmark
+     */
+    public static native String run(String benchmark, String[] args, String workDir);
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * JNI interface of the on-device benchmark harness, see ZrtpBench.java.
+ *
+ * The harness runs cryptobench, srtpbench and handshakebench inside the
+ * application process. The Android.mk module compiles the benchmarks with
+ * ZRTP_BENCH_LIBRARY, thus their main functions become cryptobenchMain,
+ * srtpbenchMain and handshakebenchMain. The harness redirects stdout to a
+ * file while a benchmark runs and returns the benchmark's JSON document
+ * embedded in a JSON document that identifies the device ABI and the build.
+ */
+
+#include <jni.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+extern "C" {
+extern char zrtpBuildInfo[];
+}
+
+extern int cryptobenchMain(int argc, char* argv[]);
+extern int srtpbenchMain(int argc, char* argv[]);
+extern int handshakebenchMain(int argc, char* argv[]);
+
+#if defined(__aarch64__)
+static const char* abi = "arm64-v8a";
+#elif defined(__arm__)
+static const char* abi = "armeabi-v7a";
+#elif defined(__x86_64__)
+static const char* abi = "x86_64";
+#elif defined(__i386__)
+static const char* abi = "x86";
+#else
+static const char* abi = "unknown";
+#endif
+
+typedef int (*BenchMain)(int argc, char* argv[]);
+
+static const struct {
+    const char* name;
+    BenchMain main;
+} benchmarks[] = {
+    { "cryptobench",    cryptobenchMain },
+    { "srtpbench",      srtpbenchMain },
+    { "handshakebench", handshakebenchMain },
+};
+
+// The benchmarks use static data and stdout, only one benchmark runs at a time
+static std::mutex runLock;
+
+static std::string getString(JNIEnv* env, jstring string)
+{
+    std::string result;
+
+    if (string == NULL)
+        return result;
+    const char* chars = env->GetStringUTFChars(string, NULL);
+    if (chars != NULL) {
+        result = chars;
+        env->ReleaseStringUTFChars(string, chars);
+    }
+    return result;
+}
+
+/*
+ * Run a benchmark with stdout redirected to the file outFile and return the
+ * output. The benchmarks modify their arguments, thus each argument is a
+ * writable copy.
+ */
+static std::string runCaptured(BenchMain entry, std::vector<std::string>& args, const std::string& outFile, int* exitCode)
+{
+    std::vector<std::vector<char> > buffers;
+    std::vector<char*> argv;
+    std::string output;
+
+    for (size_t i = 0; i < args.size(); i++) {
+        buffers.push_back(std::vector<char>(args[i].begin(), args[i].end()));
+        buffers.back().push_back('\0');
+    }
+    for (size_t i = 0; i < buffers.size(); i++)
+        argv.push_back(&buffers[i][0]);
+    argv.push_back(NULL);
+
+    int fd = open(outFile.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        *exitCode = -1;
+        return output;
+    }
+    fflush(stdout);
+    int savedStdout = dup(STDOUT_FILENO);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+
+    *exitCode = entry(static_cast<int>(args.size()), &argv[0]);
+
+    fflush(stdout);
+    dup2(savedStdout, STDOUT_FILENO);
+    close(savedStdout);
+
+    FILE* in = fopen(outFile.c_str(), "r");
+    if (in != NULL) {
+        char buffer[4096];
+        size_t length;
+        while ((length = fread(buffer, 1, sizeof(buffer), in)) > 0)
+            output.append(buffer, length);
+        fclose(in);
+    }
+    remove(outFile.c_str());
+    return output;
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_wd_tivi_ZrtpBench_run(JNIEnv* env, jclass clazz, jstring jbenchmark, jobjectArray jargs, jstring jworkDir)
+{
+    std::string name = getString(env, jbenchmark);
+    std::string workDir = getString(env, jworkDir);
+    BenchMain entry = NULL;
+
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        if (name == benchmarks[i].name)
+            entry = benchmarks[i].main;
+    }
+    if (entry == NULL || workDir.empty())
+        return NULL;
+
+    // The harness options come first, the application's arguments may override them
+    std::vector<std::string> args;
+    args.push_back(name);
+    if (name == "srtpbench") {
+        args.push_back("-j");
+    }
+    else if (name == "handshakebench") {
+        args.push_back("-f");
+        args.push_back(workDir + "/handshakebench.zid");
+    }
+    jsize count = jargs != NULL ? env->GetArrayLength(jargs) : 0;
+    for (jsize i = 0; i < count; i++) {
+        jstring arg = static_cast<jstring>(env->GetObjectArrayElement(jargs, i));
+        args.push_back(getString(env, arg));
+        env->DeleteLocalRef(arg);
+    }
+
+    int exitCode;
+    std::string report;
+    {
+        std::lock_guard<std::mutex> guard(runLock);
+        report = runCaptured(entry, args, workDir + "/zrtpbench.out", &exitCode);
+    }
+    // A benchmark that fails before its first result does not write JSON
+    if (report.empty() || report[0] != '{')
+        report = "null";
+
+    char header[512];
+    snprintf(header, sizeof(header),
+             "{\n\"benchmark\": \"%s\",\n\"abi\": \"%s\",\n\"pointer_bits\": %d,\n\"build\": \"%s\",\n\"exit_code\": %d,\n\"report\": ",
+             name.c_str(), abi, static_cast<int>(sizeof(void*) * 8), zrtpBuildInfo, exitCode);
+
+    std::string result(header);
+    result.append(report);
+    result.append("}\n");
+    return env->NewStringUTF(result.c_str());
+}
@@ -40,7 +40,7 @@ dummy := $(shell echo "char zrtpBuildInfo[] = \"@VERSION@:$(commit):$(TARGET_ARC
 LOCAL_C_INCLUDES += $(ROOT_SRC_PATH) $(ROOT_SRC_PATH)/srtp $(ROOT_SRC_PATH)/zrtp $(ROOT_SRC_PATH)/bnlib \
                     $(ROOT_SRC_PATH)/clients/tivi $(ROOT_SRC_PATH)/clients/tivi/android/jni/@sql_include@
 
-LOCAL_CFLAGS := -DSUPPORT_NON_NIST @sql_cipher_define@
+LOCAL_CFLAGS := -DSUPPORT_NON_NIST -DZRTP_SHARED_KEY_SCHEDULES @sql_cipher_define@
 
 # For this Android build we can set the visibility to hidden. Access to ZRTP is only inside
 # the shared lib that we build later for Silent Phone.
@@ -51,3 +51,24 @@ LOCAL_SRC_FILES += @sqlite_src@
 LOCAL_SRC_FILES += @zrtpcpp_src_spc@
 
 include $(BUILD_STATIC_LIBRARY)
+
+#
+# Define and build the on-device benchmark harness, a shared lib with the
+# JNI interface of clients/tivi/android/bench/ZrtpBench.java. The default
+# APP_MODULES do not contain the harness, build it with
+#     ndk-build APP_MODULES=zrtpbench
+#
+include $(CLEAR_VARS)
+LOCAL_MODULE := zrtpbench
+LOCAL_CPP_FEATURES := @local_cpp_features@
+
+LOCAL_C_INCLUDES += $(ROOT_SRC_PATH) $(ROOT_SRC_PATH)/srtp $(ROOT_SRC_PATH)/zrtp $(ROOT_SRC_PATH)/bnlib
+
+LOCAL_CFLAGS := -DSUPPORT_NON_NIST -DZRTP_BENCH_LIBRARY
+
+LOCAL_SRC_FILES := clients/tivi/android/bench/ZrtpBenchJni.cpp
+LOCAL_SRC_FILES += demo/cryptobench.cpp demo/srtpbench.cpp demo/handshakebench.cpp
+
+LOCAL_STATIC_LIBRARIES := zrtpcpp
+
+include $(BUILD_SHARED_LIBRARY)
@@ -149,6 +149,141 @@ typedef int int32_t;
 
 %apply (uint8_t *BYTE, size_t LENGTH)   { (uint8_t* packet, size_t length) };
 
+/*
+ * Typemap for Java direct ByteBuffers. The C++ code works on the buffer memory
+ * itself, thus the JNI call does not copy the packet data in either direction.
+ * The Java code allocates the buffer with ByteBuffer.allocateDirect(). The
+ * "capacity" parameter receives the capacity of the buffer.
+ */
+%typemap(in)     (uint8_t *DIRECT, size_t CAPACITY) {
+    $1 = (uint8_t *) JCALL1(GetDirectBufferAddress, jenv, $input);
+    if ($1 == NULL) {
+        SWIG_JavaThrowException(jenv, SWIG_JavaIllegalArgumentException, "buffer is not a direct ByteBuffer");
+        return $null;
+    }
+    $2 = (size_t)    JCALL1(GetDirectBufferCapacity, jenv, $input);
+}
+%typemap(jni)    (uint8_t *DIRECT, size_t CAPACITY) "jobject"
+%typemap(jtype)  (uint8_t *DIRECT, size_t CAPACITY) "java.nio.ByteBuffer"
+%typemap(jstype) (uint8_t *DIRECT, size_t CAPACITY) "java.nio.ByteBuffer"
+%typemap(javain) (uint8_t *DIRECT, size_t CAPACITY) "$javainput"
+
+%apply (uint8_t *DIRECT, size_t CAPACITY) { (uint8_t *directBuffer, size_t capacity) };
+%apply (uint8_t *DIRECT, size_t CAPACITY) { (uint8_t *descriptors, size_t descriptorCapacity) };
+
+%{
+// Space behind each outgoing packet for the SRTP authentication tag, the largest tag is the AEAD tag
+static const size_t directSrtpReserve = 16;
+
+// A batch descriptor has four native order int: offset, length, new length and result
+static const int32_t directDescriptorInts = 4;
+
+// Number of packets per call of the CtZrtpSession batch functions
+static const int32_t directBatchChunk = 32;
+
+static int32_t processBatchDirect(CtZrtpSession* session, bool outgoing, uint8_t* buffer, size_t capacity,
+                                  uint8_t* descriptors, size_t descriptorCapacity, int32_t count,
+                                  CtZrtpSession::streamName streamNm)
+{
+    const size_t descriptorSize = directDescriptorInts * sizeof(int32_t);
+    const size_t reserve = outgoing ? directSrtpReserve : 0;
+
+    if (count < 0 || (size_t)count * descriptorSize > descriptorCapacity)
+        return -1;
+
+    CtZrtpSession::mediaPacket packets[directBatchChunk];
+    int32_t slots[directBatchChunk];
+    int32_t processed = 0;
+
+    for (int32_t first = 0; first < count; first += directBatchChunk) {
+        int32_t last = (count - first > directBatchChunk) ? first + directBatchChunk : count;
+        int32_t numPackets = 0;
+
+        for (int32_t i = first; i < last; i++) {
+            int32_t d[directDescriptorInts];
+            memcpy(d, descriptors + i * descriptorSize, descriptorSize);
+
+            // A packet outside of the buffer is not processed, its result is 0
+            if (d[0] < 0 || d[1] < 0 || (size_t)d[0] + (size_t)d[1] + reserve > capacity) {
+                d[2] = 0;
+                d[3] = 0;
+                memcpy(descriptors + i * descriptorSize, d, descriptorSize);
+                continue;
+            }
+            CtZrtpSession::mediaPacket& pkt = packets[numPackets];
+            pkt.session = session;
+            pkt.streamNm = streamNm;
+            pkt.buffer = buffer + d[0];
+            pkt.length = (size_t)d[1];
+            pkt.newLength = 0;
+            pkt.result = 0;
+            slots[numPackets++] = i;
+        }
+        if (outgoing)
+            processed += CtZrtpSession::processOutgoingRtpBatch(packets, numPackets);
+        else
+            processed += CtZrtpSession::processIncomingRtpBatch(packets, numPackets);
+
+        for (int32_t k = 0; k < numPackets; k++) {
+            int32_t results[2] = { (int32_t)packets[k].newLength, packets[k].result };
+            memcpy(descriptors + slots[k] * descriptorSize + 2 * sizeof(int32_t), results, sizeof(results));
+        }
+    }
+    return processed;
+}
+%}
+
+/*
+ * Media functions that work on direct ByteBuffers, the Java media thread uses
+ * them instead of processOutoingRtp and processIncomingRtp to avoid the copies
+ * of the byte[] typemaps.
+ *
+ * The single packet functions process "length" bytes at "offset" of the buffer.
+ * They return the new length of the packet if the application shall send
+ * respectively process it, otherwise 0 or the negative result code of
+ * processIncomingRtp. An outgoing packet needs 16 bytes behind its data for the
+ * SRTP authentication tag.
+ *
+ * The batch functions process "count" packets of one stream with one JNI call.
+ * The "descriptors" buffer contains four native order int per packet (use
+ * ByteBuffer.order(ByteOrder.nativeOrder())): the offset and the length of the
+ * packet in "directBuffer", the functions set the new length and the result
+ * code of the batch functions of CtZrtpSession. The batch functions return the
+ * number of packets with result 1, -1 if "descriptors" is too small.
+ */
+%extend CtZrtpSession {
+    int32_t processOutgoingRtpDirect(uint8_t *directBuffer, size_t capacity, int32_t offset, int32_t length,
+                                     CtZrtpSession::streamName streamNm) {
+        size_t newLength = 0;
+
+        if (offset < 0 || length < 0 || (size_t)offset + (size_t)length + directSrtpReserve > capacity)
+            return 0;
+        if (!$self->processOutoingRtp(directBuffer + offset, (size_t)length, &newLength, streamNm))
+            return 0;
+        return (int32_t)newLength;
+    }
+
+    int32_t processIncomingRtpDirect(uint8_t *directBuffer, size_t capacity, int32_t offset, int32_t length,
+                                     CtZrtpSession::streamName streamNm) {
+        size_t newLength = 0;
+
+        if (offset < 0 || length < 0 || (size_t)offset + (size_t)length > capacity)
+            return 0;
+        int32_t rc = $self->processIncomingRtp(directBuffer + offset, (size_t)length, &newLength, streamNm);
+        return (rc == 1) ? (int32_t)newLength : rc;
+    }
+
+    int32_t processOutgoingRtpBatchDirect(uint8_t *directBuffer, size_t capacity, uint8_t *descriptors,
+                                          size_t descriptorCapacity, int32_t count, CtZrtpSession::streamName streamNm) {
+        return processBatchDirect($self, true, directBuffer, capacity, descriptors, descriptorCapacity, count, streamNm);
+    }
+
+    int32_t processIncomingRtpBatchDirect(uint8_t *directBuffer, size_t capacity, uint8_t *descriptors,
+                                          size_t descriptorCapacity, int32_t count, CtZrtpSession::streamName streamNm) {
+        return processBatchDirect($self, false, directBuffer, capacity, descriptors, descriptorCapacity, count, streamNm);
+    }
+}
+
 /*
  * Use the director feature for the callback classes only.
  * CAVEAT: these a pure virtual C++ classes. The Java implementation MUST overwrite
@@ -0,0 +1,663 @@
+/*
+ * Copyright (c) 2026, the ZRTPCPP contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * Load generator for the tivi interface.
+ *
+ * Creates pairs of CtZrtpSession objects in one process, runs a ZRTP handshake
+ * per pair and then SRTP traffic on all secure pairs. Each executor thread,
+ * see CtZrtpExecutor, runs the sessions of a shard, the peer of a session
+ * runs in the next shard. The sessions send their packets to the executor of
+ * the peer, the lock-free task queue of the executor is the network. The
+ * network delays each packet by half the round trip time and drops packets
+ * with the configured loss rate.
+ *
+ * The program starts the pairs with the configured arrival rate and waits
+ * until all pairs are secure or 30 seconds after the last start. Then it runs
+ * the media phase, each secure session sends one RTP packet per interval, and
+ * measures the SRTP packets per second and per CPU second of the executor
+ * threads.
+ *
+ * The report contains:
+ * - the handshakes per second of the setup phase and the time from the start
+ *   of a pair until both sessions are secure
+ * - the SRTP packets per second and per core
+ * - the executor lag: a 1 ms tick task measures the time from posting until
+ *   the executor runs it, the executor runs the ZRTP timers in the same loop
+ * - the latency of the ZID cache reads and saves, the program wraps the
+ *   shared cache layer with a timing layer
+ *
+ * With more than one stream per session the pair is secure when all streams
+ * are secure, the slave streams start in multi-stream mode when the audio
+ * stream is secure. The media phase sends on the audio stream only.
+ *
+ * Usage: zrtpload [-n pairs] [-s streams] [-r rate] [-t threads] [-l loss] [-R rtt] [-d seconds] [-i interval] [-f zidfile]
+ *
+ * The program removes the ZID cache file before it starts. The output is a
+ * JSON document.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <CtZrtpSession.h>
+#include <CtZrtpCallback.h>
+#include <CtZrtpExecutor.h>
+#include <common/osSpecifics.h>
+#include <libzrtpcpp/ZIDCache.h>
+#include <libzrtpcpp/ZIDCacheSharded.h>
+
+static int32_t numPairs = 1000;
+static int32_t numStreams = 1;
+static double arrivalRate = 200.0;      // pairs per second, 0 starts all pairs at once
+static int32_t numThreads = 0;          // 0 uses one executor per CPU
+static double lossPercent = 0.0;
+static int32_t rttMs = 0;
+static int32_t mediaSeconds = 10;
+static int32_t intervalMs = 20;
+
+static const int64_t setupTimeoutUs = 30000000;
+static const size_t mediaPayload = 160;
+
+static int64_t nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * Random numbers for the loss model, each executor thread has its own state.
+ */
+static uint32_t randomNumber()
+{
+    static thread_local uint64_t state = 0;
+
+    if (state == 0)
+        state = (uint64_t)std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return (uint32_t)((state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+/*
+ * Latency samples of a thread. The samples of all threads stay registered
+ * until the program ends, the program reads them after the executors stopped.
+ */
+typedef struct _ThreadSamples {
+    std::vector<int64_t> cacheGet;
+    std::vector<int64_t> cacheSave;
+} ThreadSamples;
+
+static std::mutex samplesLock;
+static std::vector<ThreadSamples*> allSamples;
+
+static ThreadSamples* threadSamples()
+{
+    static thread_local ThreadSamples* samples = NULL;
+
+    if (samples == NULL) {
+        samples = new ThreadSamples;
+        std::lock_guard<std::mutex> guard(samplesLock);
+        allSamples.push_back(samples);
+    }
+    return samples;
+}
+
+/*
+ * Timing layer of the ZID cache, measures the wall time of the record reads
+ * and saves of the ZRTP engines.
+ */
+class TimedCache: public ZIDCache {
+public:
+    explicit TimedCache(ZIDCache* backend): backend(backend) {}
+    ~TimedCache() { delete backend; }
+
+    int open(char *name) { return backend->open(name); }
+    bool isOpen() { return backend->isOpen(); }
+    void close() { backend->close(); }
+    ZIDRecord *getRecord(unsigned char *zid) {
+        int64_t start = nowUs();
+        ZIDRecord* record = backend->getRecord(zid);
+        threadSamples()->cacheGet.push_back(nowUs() - start);
+        return record;
+    }
+    unsigned int saveRecord(ZIDRecord *zidRecord) {
+        int64_t start = nowUs();
+        unsigned int result = backend->saveRecord(zidRecord);
+        threadSamples()->cacheSave.push_back(nowUs() - start);
+        return result;
+    }
+    const unsigned char* getZid() { return backend->getZid(); }
+    int32_t getPeerName(const uint8_t *peerZid, std::string *name) { return backend->getPeerName(peerZid, name); }
+    void putPeerName(const uint8_t *peerZid, const std::string name) { backend->putPeerName(peerZid, name); }
+    void cleanup() { backend->cleanup(); }
+    void *prepareReadAll() { return backend->prepareReadAll(); }
+    void *readNextRecord(void *stmt, std::string *output) { return backend->readNextRecord(stmt, output); }
+    void closeOpenStatment(void *stmt) { backend->closeOpenStatment(stmt); }
+    void setCrashSafetyWindow(int32_t milliseconds) { backend->setCrashSafetyWindow(milliseconds); }
+    bool setCacheKey(const uint8_t *key, int32_t keyLength, bool rawKey, int32_t kdfIterations) {
+        return backend->setCacheKey(key, keyLength, rawKey, kdfIterations);
+    }
+    int32_t exportRecords(FILE* out) { return backend->exportRecords(out); }
+    int32_t importRecords(FILE* in) { return backend->importRecords(in); }
+    int32_t compact() { return backend->compact(); }
+    int32_t compactStep(int32_t maxRecords) { return backend->compactStep(maxRecords); }
+
+private:
+    ZIDCache* backend;
+};
+
+class Endpoint;
+class Shard;
+
+/*
+ * A packet on its way to the executor of the receiving endpoint.
+ */
+class PacketTask: public CtZrtpExecutor::Task {
+public:
+    Endpoint* receiver;
+    CtZrtpSession::streamName streamNm;
+    int64_t dueUs;
+    size_t length;
+    uint8_t data[1500];
+
+    void run();
+};
+
+/*
+ * Runs an endpoint function in the executor thread of the endpoint.
+ */
+class EndpointTask: public CtZrtpExecutor::Task {
+public:
+    EndpointTask(): endpoint(NULL), function(NULL) {}
+
+    Endpoint* endpoint;
+    void (Endpoint::*function)();
+
+    void run() { (endpoint->*function)(); }
+};
+
+class TickTask: public CtZrtpExecutor::Task {
+public:
+    TickTask(): shard(NULL), postedUs(0) {}
+
+    Shard* shard;
+    int64_t postedUs;
+
+    void run();
+};
+
+/*
+ * Snapshot of the media counters and the CPU time of an executor thread.
+ */
+class MarkTask: public CtZrtpExecutor::Task {
+public:
+    MarkTask(): shard(NULL), packets(0), cpuUs(0), done(false) {}
+
+    Shard* shard;
+    uint64_t packets;
+    uint64_t cpuUs;
+    std::atomic<bool> done;
+
+    void run();
+};
+
+/*
+ * The data of a shard except the executor are used in the executor thread
+ * only. The main thread reads the counters after the executor stopped.
+ */
+class Shard {
+public:
+    Shard(): nextMediaUs(0), tickPending(false), srtpProtected(0), srtpUnprotected(0),
+        authFailures(0), replayDrops(0), lostPackets(0) {
+        tick.shard = this;
+    }
+
+    CtZrtpExecutor executor;
+    std::deque<PacketTask*> delayed;        //!< packets in the order of their due time
+    std::vector<Endpoint*> media;           //!< the secure endpoints of the shard
+    int64_t nextMediaUs;
+    TickTask tick;
+    std::atomic<bool> tickPending;
+
+    uint64_t srtpProtected;
+    uint64_t srtpUnprotected;
+    uint64_t authFailures;
+    uint64_t replayDrops;
+    uint64_t lostPackets;
+    std::vector<int64_t> secureTimes;       //!< us from the start of a pair until both endpoints are secure
+    std::vector<int64_t> lagTimes;          //!< us from posting a tick until the executor runs it
+};
+
+class Pair;
+
+class Endpoint: public CtZrtpCb, public CtZrtpSendCb {
+public:
+    Endpoint(): pair(NULL), shard(NULL), peer(NULL), session(NULL), ssrc(0), sequence(0), timestamp(0), secure(false), secureStreams(0) {
+        startTask.endpoint = this;
+        startTask.function = &Endpoint::start;
+        releaseTask.endpoint = this;
+        releaseTask.function = &Endpoint::release;
+    }
+
+    Pair* pair;
+    Shard* shard;
+    Endpoint* peer;
+    CtZrtpSession* session;
+    uint8_t zid[12];
+    uint32_t ssrc;
+    uint16_t sequence;
+    uint32_t timestamp;
+    bool secure;
+    int32_t secureStreams;                  //!< bit per secure stream
+    EndpointTask startTask;
+    EndpointTask releaseTask;
+
+    void start();
+    void release();
+    void receive(uint8_t* data, size_t length, CtZrtpSession::streamName streamNm);
+    void sendMedia();
+    void transmit(const uint8_t* data, size_t length, CtZrtpSession::streamName streamNm);
+
+    void onNewZrtpStatus(CtZrtpSession *session, char *p, CtZrtpSession::streamName streamNm);
+    void onNeedEnroll(CtZrtpSession *session, CtZrtpSession::streamName streamNm, int32_t info) {}
+    void onPeer(CtZrtpSession *session, char *name, int iIsVerified, CtZrtpSession::streamName streamNm) {}
+    void onZrtpWarning(CtZrtpSession *session, char *p, CtZrtpSession::streamName streamNm) {}
+    void onDiscriminatorException(CtZrtpSession *session, char *message, CtZrtpSession::streamName streamNm) {}
+
+    void sendRtp(CtZrtpSession const *session, uint8_t* packet, size_t length, CtZrtpSession::streamName streamNm) {
+        transmit(packet, length, streamNm);
+    }
+};
+
+class Pair {
+public:
+    Pair(): startUs(0), secureCount(0) {
+        caller.pair = this;
+        callee.pair = this;
+        caller.peer = &callee;
+        callee.peer = &caller;
+    }
+
+    Endpoint caller;
+    Endpoint callee;
+    int64_t startUs;
+    std::atomic<int32_t> secureCount;
+};
+
+static std::atomic<int32_t> securePairs(0);
+static std::atomic<int32_t> releasedEndpoints(0);
+
+void PacketTask::run()
+{
+    Shard* shard = receiver->shard;
+
+    // Keep the order of the delayed packets, all packets have the same delay
+    if (dueUs > nowUs() || !shard->delayed.empty()) {
+        shard->delayed.push_back(this);
+        return;
+    }
+    receiver->receive(data, length, streamNm);
+    delete this;
+}
+
+void TickTask::run()
+{
+    int64_t now = nowUs();
+
+    shard->lagTimes.push_back(now - postedUs);
+    shard->tickPending.store(false, std::memory_order_release);
+
+    while (!shard->delayed.empty() && shard->delayed.front()->dueUs <= now) {
+        PacketTask* packet = shard->delayed.front();
+        shard->delayed.pop_front();
+        packet->receiver->receive(packet->data, packet->length, packet->streamNm);
+        delete packet;
+    }
+    if (now < shard->nextMediaUs)
+        return;
+    for (size_t i = 0; i < shard->media.size(); i++)
+        shard->media[i]->sendMedia();
+    shard->nextMediaUs += (int64_t)intervalMs * 1000;
+    if (shard->nextMediaUs < now)
+        shard->nextMediaUs = now + (int64_t)intervalMs * 1000;
+}
+
+void MarkTask::run()
+{
+    packets = shard->srtpProtected + shard->srtpUnprotected;
+    cpuUs = zrtpGetThreadCpuTime();
+    done.store(true, std::memory_order_release);
+}
+
+void Endpoint::start()
+{
+    session = new CtZrtpSession();
+    session->bindExecutor(&shard->executor);
+    session->setZid(zid);
+    session->initStreams(numStreams);
+    session->setUserCallback(this, CtZrtpSession::AllStreams);
+    session->setSendCallback(this, CtZrtpSession::AllStreams);
+
+    // The callee starts first and posts the start of the caller, thus the Hello
+    // of each endpoint reaches an endpoint that started already
+    if (this == &pair->callee)
+        peer->shard->executor.post(&peer->startTask);
+    for (int32_t sn = 0; sn < numStreams; sn++)
+        session->start(ssrc + sn, (CtZrtpSession::streamName)sn);
+}
+
+void Endpoint::release()
+{
+    delete session;
+    session = NULL;
+    secure = false;
+    secureStreams = 0;
+    shard->media.erase(std::remove(shard->media.begin(), shard->media.end(), this), shard->media.end());
+    releasedEndpoints++;
+}
+
+void Endpoint::onNewZrtpStatus(CtZrtpSession *session, char *p, CtZrtpSession::streamName streamNm)
+{
+    if (secure || !session->isSecure(streamNm))
+        return;
+    secureStreams |= 1 << streamNm;
+    if (secureStreams != (1 << numStreams) - 1)
+        return;
+    secure = true;
+    shard->media.push_back(this);
+    if (++pair->secureCount == 2) {
+        shard->secureTimes.push_back(nowUs() - pair->startUs);
+        securePairs++;
+    }
+}
+
+void Endpoint::receive(uint8_t* data, size_t length, CtZrtpSession::streamName streamNm)
+{
+    if (session == NULL)
+        return;
+
+    size_t newLength = 0;
+    int32_t rc = session->processIncomingRtp(data, length, &newLength, streamNm);
+
+    // ZRTP packets start with 0x10, RTP packets with version 2
+    if ((data[0] & 0xc0) != 0x80 || !secure)
+        return;
+    if (rc == 1)
+        shard->srtpUnprotected++;
+    else if (rc == -1)
+        shard->authFailures++;
+    else if (rc == -2)
+        shard->replayDrops++;
+}
+
+void Endpoint::sendMedia()
+{
+    uint8_t buffer[12 + mediaPayload + 32];
+
+    buffer[0] = 0x80;
+    buffer[1] = 0;                          // PCMU
+    buffer[2] = (uint8_t)(sequence >> 8);
+    buffer[3] = (uint8_t)sequence;
+    buffer[4] = (uint8_t)(timestamp >> 24);
+    buffer[5] = (uint8_t)(timestamp >> 16);
+    buffer[6] = (uint8_t)(timestamp >> 8);
+    buffer[7] = (uint8_t)timestamp;
+    buffer[8] = (uint8_t)(ssrc >> 24);
+    buffer[9] = (uint8_t)(ssrc >> 16);
+    buffer[10] = (uint8_t)(ssrc >> 8);
+    buffer[11] = (uint8_t)ssrc;
+    memset(buffer + 12, 0x55, mediaPayload);
+    sequence++;
+    timestamp += mediaPayload;
+
+    size_t newLength = 0;
+    if (!session->processOutoingRtp(buffer, 12 + mediaPayload, &newLength, CtZrtpSession::AudioStream))
+        return;
+    shard->srtpProtected++;
+    transmit(buffer, newLength, CtZrtpSession::AudioStream);
+}
+
+void Endpoint::transmit(const uint8_t* data, size_t length, CtZrtpSession::streamName streamNm)
+{
+    if (length > sizeof(((PacketTask*)0)->data))
+        return;
+    if (lossPercent > 0.0 && randomNumber() < (uint32_t)(lossPercent / 100.0 * 4294967295.0)) {
+        shard->lostPackets++;
+        return;
+    }
+    PacketTask* packet = new PacketTask;
+    packet->receiver = peer;
+    packet->streamNm = streamNm;
+    packet->dueUs = nowUs() + (int64_t)rttMs * 500;
+    packet->length = length;
+    memcpy(packet->data, data, length);
+    peer->shard->executor.post(packet);
+}
+
+static void postTicks(std::vector<Shard*>& shards)
+{
+    for (size_t i = 0; i < shards.size(); i++) {
+        if (shards[i]->tickPending.exchange(true, std::memory_order_acq_rel))
+            continue;
+        shards[i]->tick.postedUs = nowUs();
+        shards[i]->executor.post(&shards[i]->tick);
+    }
+}
+
+/*
+ * Post a mark task to each shard and wait until all ran, returns the sums.
+ */
+static void markShards(std::vector<Shard*>& shards, uint64_t* packets, uint64_t* cpuUs)
+{
+    std::vector<MarkTask> marks(shards.size());
+
+    for (size_t i = 0; i < shards.size(); i++) {
+        marks[i].shard = shards[i];
+        shards[i]->executor.post(&marks[i]);
+    }
+    *packets = 0;
+    *cpuUs = 0;
+    for (size_t i = 0; i < shards.size(); i++) {
+        while (!marks[i].done.load(std::memory_order_acquire))
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        *packets += marks[i].packets;
+        *cpuUs += marks[i].cpuUs;
+    }
+}
+
+static void printPercentiles(const char* name, std::vector<int64_t>& samples, double scale)
+{
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    const double quantiles[] = { 0.5, 0.99, 0.999 };
+    const char* names[] = { "p50", "p99", "p999" };
+
+    printf(",\n  \"%s\": {\"count\": %zu", name, n);
+    for (int32_t i = 0; i < 3; i++)
+        printf(", \"%s\": %.3f", names[i], n > 0 ? samples[(size_t)(quantiles[i] * (n - 1))] / scale : 0.0);
+    printf(", \"max\": %.3f}", n > 0 ? samples[n - 1] / scale : 0.0);
+}
+
+static void usage()
+{
+    fprintf(stderr, "Usage: zrtpload [-n pairs] [-s streams] [-r rate] [-t threads] [-l loss] [-R rtt] [-d seconds] [-i interval] [-f zidfile]\n");
+    fprintf(stderr, "  -n pairs     number of session pairs, default 1000\n");
+    fprintf(stderr, "  -s streams   streams per session, default 1\n");
+    fprintf(stderr, "  -r rate      started pairs per second, 0 starts all at once, default 200\n");
+    fprintf(stderr, "  -t threads   executor threads, default one per CPU\n");
+    fprintf(stderr, "  -l loss      packet loss in percent, default 0\n");
+    fprintf(stderr, "  -R rtt       round trip time in ms, default 0\n");
+    fprintf(stderr, "  -d seconds   duration of the media phase, default 10\n");
+    fprintf(stderr, "  -i interval  media packet interval in ms, default 20\n");
+    fprintf(stderr, "  -f zidfile   ZID cache file, default zrtpload.zid\n");
+}
+
+int main(int argc, char* argv[])
+{
+    const char* zidFile = "zrtpload.zid";
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc || argv[i][0] != '-' || strlen(argv[i]) != 2) {
+            usage();
+            return 1;
+        }
+        const char* value = argv[++i];
+        switch (argv[i - 1][1]) {
+            case 'n': numPairs = atoi(value); break;
+            case 's': numStreams = atoi(value); break;
+            case 'r': arrivalRate = atof(value); break;
+            case 't': numThreads = atoi(value); break;
+            case 'l': lossPercent = atof(value); break;
+            case 'R': rttMs = atoi(value); break;
+            case 'd': mediaSeconds = atoi(value); break;
+            case 'i': intervalMs = atoi(value); break;
+            case 'f': zidFile = value; break;
+            default:
+                usage();
+                return 1;
+        }
+    }
+    if (numThreads <= 0)
+        numThreads = std::max(1, (int32_t)std::thread::hardware_concurrency());
+    if (numPairs <= 0 || numStreams < 1 || numStreams > CtZrtpSession::AllStreams || arrivalRate < 0.0 || lossPercent < 0.0 || lossPercent >= 100.0 || rttMs < 0 ||
+        mediaSeconds < 0 || intervalMs <= 0) {
+        usage();
+        return 1;
+    }
+    remove(zidFile);
+    if (CtZrtpSession::initCache(zidFile) < 0) {
+        fprintf(stderr, "Cannot open the ZID cache %s\n", zidFile);
+        return 1;
+    }
+    ZIDCacheSharded::install();
+    setZidCacheInstance(new TimedCache(getZidCacheInstance()));
+
+    std::vector<Shard*> shards;
+    for (int32_t i = 0; i < numThreads; i++) {
+        shards.push_back(new Shard);
+        shards.back()->executor.start();
+    }
+    std::vector<Pair*> pairs;
+    for (int32_t i = 0; i < numPairs; i++) {
+        Pair* pair = new Pair;
+        pair->caller.shard = shards[i % numThreads];
+        pair->callee.shard = shards[(i + 1) % numThreads];
+        for (int32_t k = 0; k < 12; k++) {
+            pair->caller.zid[k] = (uint8_t)rand();
+            pair->callee.zid[k] = (uint8_t)rand();
+        }
+        pair->caller.ssrc = (uint32_t)rand();
+        pair->callee.ssrc = (uint32_t)rand();
+        pairs.push_back(pair);
+    }
+
+    // Setup phase: start the pairs with the arrival rate
+    int64_t setupStart = nowUs();
+    int64_t lastStart = setupStart;
+    int32_t started = 0;
+    while (securePairs.load() < numPairs) {
+        int64_t now = nowUs();
+        while (started < numPairs &&
+               (arrivalRate == 0.0 || now - setupStart >= (int64_t)(started * 1000000.0 / arrivalRate))) {
+            Pair* pair = pairs[started++];
+            pair->startUs = now;
+            pair->callee.shard->executor.post(&pair->callee.startTask);
+            lastStart = now;
+        }
+        if (started == numPairs && now - lastStart > setupTimeoutUs)
+            break;
+        postTicks(shards);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    int64_t setupUs = nowUs() - setupStart;
+    int32_t secure = securePairs.load();
+
+    // Media phase
+    uint64_t packetsStart, cpuStart, packetsEnd, cpuEnd;
+    markShards(shards, &packetsStart, &cpuStart);
+    int64_t mediaStart = nowUs();
+    while (nowUs() - mediaStart < (int64_t)mediaSeconds * 1000000) {
+        postTicks(shards);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    markShards(shards, &packetsEnd, &cpuEnd);
+    int64_t mediaUs = nowUs() - mediaStart;
+
+    for (int32_t i = 0; i < started; i++) {
+        pairs[i]->caller.shard->executor.post(&pairs[i]->caller.releaseTask);
+        pairs[i]->callee.shard->executor.post(&pairs[i]->callee.releaseTask);
+    }
+    while (releasedEndpoints.load() < started * 2)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    for (size_t i = 0; i < shards.size(); i++)
+        shards[i]->executor.stop();
+
+    uint64_t authFailures = 0, replayDrops = 0, lostPackets = 0;
+    std::vector<int64_t> secureTimes, lagTimes, cacheGet, cacheSave;
+    for (size_t i = 0; i < shards.size(); i++) {
+        Shard* shard = shards[i];
+        authFailures += shard->authFailures;
+        replayDrops += shard->replayDrops;
+        lostPackets += shard->lostPackets;
+        secureTimes.insert(secureTimes.end(), shard->secureTimes.begin(), shard->secureTimes.end());
+        lagTimes.insert(lagTimes.end(), shard->lagTimes.begin(), shard->lagTimes.end());
+    }
+    for (size_t i = 0; i < allSamples.size(); i++) {
+        cacheGet.insert(cacheGet.end(), allSamples[i]->cacheGet.begin(), allSamples[i]->cacheGet.end());
+        cacheSave.insert(cacheSave.end(), allSamples[i]->cacheSave.begin(), allSamples[i]->cacheSave.end());
+    }
+    uint64_t mediaPackets = packetsEnd - packetsStart;
+    double mediaCpu = (cpuEnd - cpuStart) / 1e6;
+
+    printf("{\n  \"pairs\": %d,\n  \"streams\": %d,\n  \"threads\": %d,\n  \"arrival_rate\": %.1f,\n  \"loss_percent\": %.2f,\n"
+           "  \"rtt_ms\": %d,\n  \"media_interval_ms\": %d", numPairs, numStreams, numThreads, arrivalRate, lossPercent, rttMs, intervalMs);
+    printf(",\n  \"secure_pairs\": %d,\n  \"failed_pairs\": %d,\n  \"setup_seconds\": %.3f,\n  \"handshakes_per_second\": %.1f",
+           secure, numPairs - secure, setupUs / 1e6, setupUs > 0 ? secure / (setupUs / 1e6) : 0.0);
+    printPercentiles("time_to_secure_ms", secureTimes, 1000.0);
+    printf(",\n  \"media_seconds\": %.3f,\n  \"srtp_packets\": %llu,\n  \"srtp_packets_per_second\": %.1f,\n"
+           "  \"srtp_packets_per_core_second\": %.1f,\n  \"srtp_auth_failures\": %llu,\n  \"srtp_replay_drops\": %llu,\n"
+           "  \"lost_packets\": %llu", mediaUs / 1e6, (unsigned long long)mediaPackets,
+           mediaUs > 0 ? mediaPackets / (mediaUs / 1e6) : 0.0, mediaCpu > 0.0 ? mediaPackets / mediaCpu : 0.0,
+           (unsigned long long)authFailures, (unsigned long long)replayDrops, (unsigned long long)lostPackets);
+    printPercentiles("executor_lag_ms", lagTimes, 1000.0);
+    printPercentiles("cache_get_us", cacheGet, 1.0);
+    printPercentiles("cache_save_us", cacheSave, 1.0);
+    printf("\n}\n");
+
+    // Packets that are still in the executor queues do not run, the program ends anyway
+    for (size_t i = 0; i < shards.size(); i++) {
+        while (!shards[i]->delayed.empty()) {
+            delete shards[i]->delayed.front();
+            shards[i]->delayed.pop_front();
+        }
+        delete shards[i];
+    }
+    for (size_t i = 0; i < pairs.size(); i++)
+        delete pairs[i];
+    for (size_t i = 0; i < allSamples.size(); i++)
+        delete allSamples[i];
+    return secure == numPairs ? 0 : 1;
+}
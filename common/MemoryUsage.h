@@ -0,0 +1,107 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MEMORYUSAGE_H_
+#define _MEMORYUSAGE_H_
+
+/**
+ * @file MemoryUsage.h
+ * @brief Memory footprint report of sessions, engines and crypto contexts
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Collects the number of bytes per object category.
+ *
+ * The ZRTP engine, the SRTP crypto contexts and the client sessions add the
+ * size of their objects and of the memory they own to a MemoryUsage object,
+ * for example ZRtp::addMemoryUsage(). The functions add to the current
+ * values, thus an application can collect the footprint of several sessions
+ * in one object.
+ *
+ * The values are the sizes the objects request. The heap allocator may use
+ * some more bytes per allocation. The functions do not count the shared
+ * memory, for example the shared curve parameters, the SRTP memory pool
+ * chunks or the ZID cache itself.
+ */
+class MemoryUsage {
+public:
+    /**
+     * The categories of the footprint report.
+     */
+    typedef enum {
+        Session = 0,        //!< client session and stream objects, for example CtZrtpSession or ZrtpQueue
+        Engine,             //!< ZRTP engine, state engine and the packets the engine keeps
+        Handshake,          //!< handshake data the engine releases when it enters SecureState
+        KeyAgreement,       //!< DH and EC contexts, including the BigNum storage
+        Srtp,               //!< SRTP and SRTCP crypto contexts, including the replay windows
+        Cipher,             //!< cipher key schedules and GCM contexts
+        Cache,              //!< ZID cache records the engine uses
+        NumberOfCategories
+    } Category;
+
+    MemoryUsage() { clear(); }
+
+    /**
+     * @brief Add a number of bytes to a category.
+     */
+    void add(Category category, size_t bytes) { categories[category] += bytes; }
+
+    /**
+     * @brief Get the number of bytes of a category.
+     */
+    size_t get(Category category) const { return categories[category]; }
+
+    /**
+     * @brief Get the number of bytes of all categories.
+     */
+    size_t getTotal() const {
+        size_t total = 0;
+        for (int32_t i = 0; i < NumberOfCategories; i++)
+            total += categories[i];
+        return total;
+    }
+
+    /**
+     * @brief Reset all categories to zero.
+     */
+    void clear() {
+        for (int32_t i = 0; i < NumberOfCategories; i++)
+            categories[i] = 0;
+    }
+
+    /**
+     * @brief Get the name of a category, for example to print a report.
+     */
+    static const char* getName(Category category) {
+        static const char* names[NumberOfCategories] = {
+            "session", "engine", "handshake", "keyAgreement", "srtp", "cipher", "cache"
+        };
+        return (category >= 0 && category < NumberOfCategories) ? names[category] : "unknown";
+    }
+
+private:
+    size_t categories[NumberOfCategories];
+};
+
+/**
+ * @}
+ */
+#endif
@@ -0,0 +1,523 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _TIMEOUTWHEEL_H_
+#define _TIMEOUTWHEEL_H_
+
+/**
+ * @file TimeoutWheel.h
+ * @brief Timeout provider based on a hashed timing wheel
+ * @ingroup GNU_ZRTP
+ * @{
+ *
+ * The provider uses the C++11 thread support only, thus the ccrtp and the
+ * tivi client use the same provider.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <common/osSpecifics.h>
+#include <common/zrtpProbes.h>
+#ifdef ZRTP_LOCK_PROFILING
+#include <libzrtpcpp/ZrtpProfiledMutex.h>
+#endif
+
+template <class TOCommand, class TOSubscriber> class TimeoutWheel;
+
+/**
+ * @brief Command of the ZRTP engine timer.
+ *
+ * The ZRTP engine uses one timer per stream, thus the clients use an integral
+ * command and do not copy or compare strings for each timer request.
+ */
+const int32_t ZrtpTimeoutCommand = 1;
+
+/**
+ * @brief A timeout request that the subscriber embeds.
+ *
+ * The entry holds the subscriber, the command and the links of the wheel
+ * slot, thus requesting and cancelling a timeout does not allocate memory.
+ * An entry holds at most one pending timeout, a new request replaces a
+ * pending one. The destructor cancels a pending timeout.
+ */
+template <class TOCommand, class TOSubscriber>
+class TimeoutEntry {
+
+public:
+    TimeoutEntry(TOSubscriber subscriber, const TOCommand& command):
+        subscriber(subscriber), command(command), owner(nullptr), next(nullptr), prev(nullptr),
+        expireTick(0), deadlineTick(0), pending(false) {}
+
+    ~TimeoutEntry() {
+        if (owner != nullptr)
+            owner->cancelRequest(this);
+    }
+
+    TOSubscriber getSubscriber() { return subscriber; }
+
+    const TOCommand& getCommand() { return command; }
+
+private:
+    friend class TimeoutWheel<TOCommand, TOSubscriber>;
+
+    TimeoutEntry(const TimeoutEntry&) = delete;
+    TimeoutEntry& operator=(const TimeoutEntry&) = delete;
+
+    TOSubscriber subscriber;
+    TOCommand command;
+    TimeoutWheel<TOCommand, TOSubscriber>* owner;   ///< the wheel of the last request
+    TimeoutEntry* next;
+    TimeoutEntry* prev;                             ///< nullptr if the entry is the first of its slot
+    uint64_t expireTick;                            ///< the timeout may expire from this tick on
+    uint64_t deadlineTick;                          ///< the tick the timeout must expire, the expire tick plus the slack
+    bool pending;
+};
+
+/**
+ * @brief Interface of a timeout provider.
+ *
+ * A client that implements @c ZrtpCallback::activateTimer and
+ * @c ZrtpCallback::cancelTimer with this interface works with the provider
+ * threads of this file as well as with timers that the application's event
+ * loop drives.
+ */
+template <class TOCommand, class TOSubscriber>
+class TimeoutSource {
+
+public:
+    typedef TimeoutEntry<TOCommand, TOSubscriber> Entry;
+
+    virtual ~TimeoutSource() {}
+
+    /**
+     * @brief Request a timeout trigger, a pending timeout of the entry is replaced.
+     *
+     * The timeout may expire up to @c slackMs later than requested. The
+     * provider expires timeouts whose slack overlaps together, this saves
+     * wakeups of the worker thread.
+     */
+    virtual void requestTimeout(int32_t timeMs, Entry* entry, int32_t slackMs = 0) = 0;
+
+    /**
+     * @brief Cancel the timeout of an entry.
+     */
+    virtual void cancelRequest(Entry* entry) = 0;
+};
+
+/**
+ * @brief Timeout provider with a hashed timing wheel.
+ *
+ * The wheel has a fixed number of slots, each slot covers one tick. A timeout
+ * goes into the slot of its expiry tick modulo the number of slots, thus
+ * requesting and cancelling a timeout is O(1): the entry links itself into
+ * the slot or unlinks itself. A timeout longer than one round of the wheel
+ * stays in its slot until the round of its expiry tick.
+ *
+ * The worker thread processes the slots tick by tick and calls
+ * @c subscriber->handleTimeout(command) for the expired entries. It calls
+ * the subscriber without holding the lock, the subscriber may request or
+ * cancel timeouts in its callback. A timeout expires up to one tick late,
+ * never early.
+ *
+ * A timeout with slack may expire up to its slack later. The worker thread
+ * wakes up at the earliest deadline of the pending timeouts, the expiry tick
+ * plus the slack, and expires all timeouts whose expiry tick passed. Thus
+ * timeouts whose slack overlaps expire with one wakeup, similar to the timer
+ * slack of Linux.
+ *
+ * An application with its own event loop does not start the worker thread.
+ * It calls @c nextTimeoutMs to compute the wait time of its loop and
+ * @c runExpired to call the subscribers of the expired timeouts in the
+ * loop's thread.
+ */
+template <class TOCommand, class TOSubscriber>
+class TimeoutWheel: public TimeoutSource<TOCommand, TOSubscriber> {
+
+public:
+    typedef TimeoutEntry<TOCommand, TOSubscriber> Entry;
+
+    static const int32_t tickMs = 4;        ///< time covered by one slot
+    static const size_t numSlots = 1024;    ///< a power of 2, one round is about 4 seconds
+
+    TimeoutWheel(): pendingCount(0), currentTick(0), waitTick(UINT64_MAX), running(false), stopped(false) {
+        for (size_t i = 0; i < numSlots; i++)
+            slots[i] = nullptr;
+    }
+
+    /**
+     * Destructor also terminates the worker thread.
+     */
+    ~TimeoutWheel() { stopThread(); }
+
+    /**
+     * @brief Start the worker thread.
+     */
+    void start() {
+        std::lock_guard<Lock> guard(lock);
+
+        if (!running) {
+            running = true;
+            stopped = false;
+            worker = std::thread(&TimeoutWheel::run, this);
+        }
+    }
+
+    /**
+     * @brief Terminate the worker thread.
+     *
+     * Pending timeouts stay in the wheel, start() continues to process them.
+     */
+    void stopThread() {
+        std::thread stopping;
+        {
+            std::lock_guard<Lock> guard(lock);
+
+            stopped = true;
+            running = false;
+            stopping.swap(worker);
+            wakeup.notify_one();
+        }
+        if (!stopping.joinable())
+            return;
+        // A subscriber may stop the provider in its callback, the worker thread cannot join itself
+        if (stopping.get_id() == std::this_thread::get_id())
+            stopping.detach();
+        else
+            stopping.join();
+    }
+
+    /**
+     * @brief Request a timeout trigger.
+     *
+     * @param timeMs
+     *    Number of milli-seconds until the timeout is wanted.
+     * @param entry
+     *    The subscriber's entry. A pending timeout of this entry is replaced.
+     * @param slackMs
+     *    Number of milli-seconds the timeout may expire later.
+     */
+    void requestTimeout(int32_t timeMs, Entry* entry, int32_t slackMs = 0) {
+        std::lock_guard<Lock> guard(lock);
+
+        uint64_t nowTick = now() / tickMs;
+        if (pendingCount == 0)
+            currentTick = nowTick;      // the wheel was idle, no slot is behind
+        if (entry->pending)
+            unlink(entry);
+
+        // Round up, the timeout must not expire early. The current tick is processed already
+        uint64_t tick = (now() + (timeMs > 0 ? timeMs : 0) + tickMs - 1) / tickMs;
+        entry->expireTick = (tick > currentTick) ? tick : currentTick + 1;
+        // Round down, the timeout must not expire later than its slack
+        entry->deadlineTick = entry->expireTick + (slackMs > 0 ? slackMs / tickMs : 0);
+        entry->owner = this;
+        link(entry);
+        ZRTP_PROBE2(timer_arm, entry, timeMs);
+
+        // Wake the worker thread only if it sleeps beyond the new deadline
+        if (entry->deadlineTick < waitTick)
+            wakeup.notify_one();
+    }
+
+    /**
+     * @brief Cancel the timeout of an entry.
+     *
+     * Does nothing if the entry has no pending timeout.
+     */
+    void cancelRequest(Entry* entry) {
+        std::lock_guard<Lock> guard(lock);
+
+        if (entry->pending) {
+            unlink(entry);
+            ZRTP_PROBE1(timer_cancel, entry);
+        }
+    }
+
+    /**
+     * @brief Get the number of pending timeouts.
+     */
+    size_t getPending() {
+        std::lock_guard<Lock> guard(lock);
+        return pendingCount;
+    }
+
+    /**
+     * @brief Get the time until the next timeout expires.
+     *
+     * The time is the earliest deadline of the pending timeouts, runExpired
+     * then expires all timeouts whose slack started.
+     *
+     * @return
+     *    Milli-seconds until the next timeout expires, 0 if a timeout expired
+     *    already, -1 if no timeout is pending.
+     */
+    int32_t nextTimeoutMs() {
+        std::lock_guard<Lock> guard(lock);
+
+        if (pendingCount == 0)
+            return -1;
+        uint64_t expireMs = nextDeadlineTick() * tickMs;
+        uint64_t nowMs = now();
+        return (expireMs <= nowMs) ? 0 : (int32_t)(expireMs - nowMs);
+    }
+
+    /**
+     * @brief Process the expired timeouts in the caller's thread.
+     *
+     * Do not use this function if the worker thread runs.
+     *
+     * @param nowMs
+     *    The current time in milli-seconds of the monotonic clock, zero reads
+     *    the clock.
+     * @return
+     *    Number of expired timeouts.
+     */
+    int32_t runExpired(uint64_t nowMs = 0) {
+        std::unique_lock<Lock> guard(lock);
+
+        if (nowMs == 0)
+            nowMs = now();
+        return processTicks(guard, nowMs / tickMs);
+    }
+
+    /**
+     * @brief Get the current time of the monotonic clock in milli-seconds.
+     *
+     * @see zrtpGetMonotonicTime()
+     */
+    static uint64_t now() {
+        return zrtpGetMonotonicTime();
+    }
+
+private:
+#ifdef ZRTP_LOCK_PROFILING
+    typedef ZrtpProfiledMutex<std::mutex, ZrtpMetrics::TimeoutLock> Lock;
+    typedef std::condition_variable_any Condition;
+#else
+    typedef std::mutex Lock;
+    typedef std::condition_variable Condition;
+#endif
+
+    void link(Entry* entry) {
+        Entry*& head = slots[entry->expireTick & (numSlots - 1)];
+
+        entry->prev = nullptr;
+        entry->next = head;
+        if (head != nullptr)
+            head->prev = entry;
+        head = entry;
+        entry->pending = true;
+        pendingCount++;
+    }
+
+    void unlink(Entry* entry) {
+        if (entry->prev != nullptr)
+            entry->prev->next = entry->next;
+        else
+            slots[entry->expireTick & (numSlots - 1)] = entry->next;
+        if (entry->next != nullptr)
+            entry->next->prev = entry->prev;
+        entry->next = entry->prev = nullptr;
+        entry->pending = false;
+        pendingCount--;
+    }
+
+    // The earliest deadline. A timeout in a slot after the earliest deadline
+    // found so far expires later, the search stops there. Without slack the
+    // first slot that holds a timeout of its current round has the deadline.
+    uint64_t nextDeadlineTick() {
+        uint64_t first = UINT64_MAX;
+
+        for (size_t i = 1; i <= numSlots; i++) {
+            uint64_t tick = currentTick + i;
+            if (tick > first)
+                break;
+            for (Entry* entry = slots[tick & (numSlots - 1)]; entry != nullptr; entry = entry->next) {
+                if (entry->deadlineTick < first)
+                    first = entry->deadlineTick;
+            }
+        }
+        return first;
+    }
+
+    // Process the ticks one by one up to nowTick, a late caller catches up
+    int32_t processTicks(std::unique_lock<Lock>& guard, uint64_t nowTick) {
+        int32_t expired = 0;
+
+        while (pendingCount > 0 && currentTick < nowTick) {
+            uint64_t tick = currentTick + 1;
+            Entry*& head = slots[tick & (numSlots - 1)];
+            Entry* entry = head;
+
+            while (entry != nullptr) {
+                if (entry->expireTick > tick) {     // expires in a later round
+                    entry = entry->next;
+                    continue;
+                }
+                unlink(entry);
+                TOSubscriber subscriber = entry->subscriber;
+                TOCommand command = entry->command;
+                expired++;
+                ZRTP_PROBE2(timer_fire, entry, (nowTick - tick) * tickMs);
+
+                guard.unlock();     // call the subscriber with free mutex
+                subscriber->handleTimeout(command);
+                guard.lock();
+
+                if (stopped)
+                    return expired;
+                entry = head;       // the callback may have modified the slot
+            }
+            currentTick = tick;
+        }
+        return expired;
+    }
+
+    void run() {
+        std::unique_lock<Lock> guard(lock);
+
+        while (!stopped) {
+            if (pendingCount == 0) {
+                waitTick = UINT64_MAX;
+                wakeup.wait(guard);
+                continue;
+            }
+            // Sleep until the next deadline, no periodic wakeups while the timeouts are far away
+            uint64_t nowMs = now();
+            uint64_t nowTick = nowMs / tickMs;
+            uint64_t nextTick = nextDeadlineTick();
+            if (nextTick > nowTick) {
+                // The clock may be an application clock, wait for the interval
+                waitTick = nextTick;
+                wakeup.wait_for(guard, std::chrono::milliseconds(nextTick * tickMs - nowMs));
+                waitTick = UINT64_MAX;
+                continue;
+            }
+            processTicks(guard, nowTick);
+        }
+    }
+
+    Lock lock;
+    Condition wakeup;
+    Entry* slots[numSlots];
+    size_t pendingCount;
+    uint64_t currentTick;           ///< the last processed tick
+    uint64_t waitTick;              ///< the tick the worker thread sleeps until
+
+    std::thread worker;
+    bool running;
+    bool stopped;
+};
+
+/**
+ * @brief Timeout provider with several timing wheels and worker threads.
+ *
+ * The provider distributes the subscribers to a number of shards, each
+ * shard is a @c TimeoutWheel with its own worker thread. The hash of the
+ * subscriber selects the shard, thus all timeouts of a subscriber use the
+ * same shard and its callbacks never run concurrently. A slow callback
+ * delays the timeouts of its shard only.
+ */
+template <class TOCommand, class TOSubscriber>
+class ShardedTimeoutWheel: public TimeoutSource<TOCommand, TOSubscriber> {
+
+public:
+    typedef TimeoutWheel<TOCommand, TOSubscriber> Wheel;
+    typedef typename Wheel::Entry Entry;
+
+    /**
+     * @brief Create the shards.
+     *
+     * @param shards
+     *    Number of shards, zero selects the number of processor cores.
+     */
+    explicit ShardedTimeoutWheel(size_t shards = 0) {
+        if (shards == 0)
+            shards = std::thread::hardware_concurrency();
+        if (shards == 0)
+            shards = 1;
+        for (size_t i = 0; i < shards; i++)
+            wheels.push_back(std::unique_ptr<Wheel>(new Wheel()));
+    }
+
+    /**
+     * @brief Start the worker threads.
+     */
+    void start() {
+        for (auto& wheel : wheels)
+            wheel->start();
+    }
+
+    /**
+     * @brief Terminate the worker threads.
+     */
+    void stopThread() {
+        for (auto& wheel : wheels)
+            wheel->stopThread();
+    }
+
+    /**
+     * @brief Request a timeout trigger, see @c TimeoutWheel::requestTimeout.
+     */
+    void requestTimeout(int32_t timeMs, Entry* entry, int32_t slackMs = 0) {
+        getShard(entry)->requestTimeout(timeMs, entry, slackMs);
+    }
+
+    /**
+     * @brief Cancel the timeout of an entry, see @c TimeoutWheel::cancelRequest.
+     */
+    void cancelRequest(Entry* entry) {
+        getShard(entry)->cancelRequest(entry);
+    }
+
+    /**
+     * @brief Get the number of pending timeouts of all shards.
+     */
+    size_t getPending() {
+        size_t pending = 0;
+        for (auto& wheel : wheels)
+            pending += wheel->getPending();
+        return pending;
+    }
+
+    /**
+     * @brief Get the number of shards.
+     */
+    size_t getShards() { return wheels.size(); }
+
+private:
+    Wheel* getShard(Entry* entry) {
+        // Pointer hashes are often the address, mix the bits to use the low bits of aligned objects
+        uint64_t hash = (uint64_t)std::hash<TOSubscriber>()(entry->getSubscriber());
+        hash = (hash ^ (hash >> 29)) * 0x9e3779b97f4a7c15ULL;
+        return wheels[(size_t)((hash >> 32) % wheels.size())].get();
+    }
+
+    std::vector<std::unique_ptr<Wheel> > wheels;
+};
+
+/**
+ * @}
+ */
+#endif
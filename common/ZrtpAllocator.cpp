@@ -0,0 +1,76 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <cstdlib>
+
+#include <common/ZrtpAllocator.h>
+#include <common/ZrtpStaticPool.h>
+
+// The default allocator, in the static allocation mode it uses the static arena
+static void* defaultAllocate(void* context, size_t bytes)
+{
+#ifdef ZRTP_STATIC_ALLOCATION
+    return zrtpStaticAlloc(bytes);
+#else
+    return malloc(bytes);
+#endif
+}
+
+static void defaultRelease(void* context, void* ptr, size_t bytes)
+{
+#ifdef ZRTP_STATIC_ALLOCATION
+    zrtpStaticFree(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+static const ZrtpAllocator defaultAllocator = {defaultAllocate, defaultRelease, NULL};
+
+static ZrtpAllocator allocator = defaultAllocator;
+
+int zrtpSetAllocator(const ZrtpAllocator* newAllocator)
+{
+    if (newAllocator == NULL) {
+        allocator = defaultAllocator;
+        return 0;
+    }
+    if (newAllocator->allocate == NULL || newAllocator->release == NULL)
+        return -1;
+
+    allocator = *newAllocator;
+    return 0;
+}
+
+void zrtpGetAllocator(ZrtpAllocator* current)
+{
+    *current = allocator;
+}
+
+void* zrtpAlloc(size_t bytes)
+{
+    return allocator.allocate(allocator.context, bytes);
+}
+
+void zrtpFree(void* ptr, size_t bytes)
+{
+    if (ptr != NULL)
+        allocator.release(allocator.context, ptr, bytes);
+}
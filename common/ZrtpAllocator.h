@@ -0,0 +1,160 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPALLOCATOR_H_
+#define _ZRTPALLOCATOR_H_
+
+/**
+ * @file ZrtpAllocator.h
+ * @brief The allocator of the library
+ * @ingroup GNU_ZRTP
+ * @{
+ *
+ * The library allocates the memory of a call through one allocator: the ZRtp
+ * engine, its state engine and DH context, the DH secret, the ZID cache
+ * records, the bignum and elliptic curve buffers, the SRTP crypto contexts,
+ * ciphers and key schedules (see SrtpMemoryPool) and the timeout requests of
+ * TiviTimeoutProvider. An application may install its own allocator, for
+ * example jemalloc arenas, a pool of huge pages or per-thread arenas of its
+ * media workers.
+ *
+ * The default allocator uses @c malloc and @c free, in the static allocation
+ * mode (see ZrtpStaticPool.h) it uses the static arena.
+ *
+ * The application installs its allocator before it creates the first object
+ * of the library and must not change it while objects of the library exist:
+ * the library releases each block with the allocator that was installed when
+ * it allocated the block. The functions of the allocator must be thread safe.
+ */
+
+#include <stddef.h>
+
+/**
+ * @brief Function table of an allocator.
+ */
+typedef struct _ZrtpAllocator {
+    /** Allocate a block aligned for any type, return @c NULL if no memory is available */
+    void* (*allocate)(void* context, size_t bytes);
+
+    /**
+     * Release a block. @c bytes is the size that the library requested for
+     * the block or 0 if the caller does not know it, @c ptr is never @c NULL.
+     */
+    void (*release)(void* context, void* ptr, size_t bytes);
+
+    /** The first argument of the functions, for example an arena of the application */
+    void* context;
+} ZrtpAllocator;
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/**
+ * @brief Install an allocator.
+ *
+ * @param allocator
+ *    The allocator, the library copies the function table. @c NULL installs
+ *    the default allocator.
+ * @return
+ *    0 on success, -1 if a function of the table is missing.
+ */
+extern int zrtpSetAllocator(const ZrtpAllocator* allocator);
+
+/**
+ * @brief Get the installed allocator.
+ *
+ * @param allocator
+ *    Receives the function table.
+ */
+extern void zrtpGetAllocator(ZrtpAllocator* allocator);
+
+/**
+ * @brief Allocate a block with the installed allocator.
+ *
+ * @return
+ *    Pointer to the block, @c NULL if no memory is available.
+ */
+extern void* zrtpAlloc(size_t bytes);
+
+/**
+ * @brief Release a block to the installed allocator.
+ *
+ * @param ptr
+ *    Pointer to the block, may be @c NULL.
+ * @param bytes
+ *    Size of the block as requested from zrtpAlloc(), 0 if unknown.
+ */
+extern void zrtpFree(void* ptr, size_t bytes);
+
+#if defined(__cplusplus)
+}
+
+#include <new>
+
+/**
+ * @brief Allocate a block for a C++ object, throws @c std::bad_alloc if no memory is available.
+ */
+static inline void* zrtpNew(size_t bytes) {
+    void* ptr = zrtpAlloc(bytes);
+    if (ptr == NULL)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+/**
+ * @brief Class specific operator new and delete of the objects that use the allocator.
+ *
+ * Add the macro to the public part of a class declaration.
+ */
+#define ZRTP_ALLOCATOR_OPERATORS \
+    static void* operator new(size_t size) { return zrtpNew(size); } \
+    static void operator delete(void* ptr, size_t size) { zrtpFree(ptr, size); }
+
+/**
+ * @brief Standard allocator that uses the allocator of the library, for example for the lists of a timeout provider.
+ */
+template <class T>
+class ZrtpStdAllocator {
+public:
+    typedef T value_type;
+
+    ZrtpStdAllocator() {}
+
+    template <class U>
+    ZrtpStdAllocator(const ZrtpStdAllocator<U>&) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(zrtpNew(n * sizeof(T))); }
+
+    void deallocate(T* ptr, size_t n) { zrtpFree(ptr, n * sizeof(T)); }
+
+    template <class U>
+    struct rebind { typedef ZrtpStdAllocator<U> other; };
+};
+
+template <class T, class U>
+inline bool operator==(const ZrtpStdAllocator<T>&, const ZrtpStdAllocator<U>&) { return true; }
+
+template <class T, class U>
+inline bool operator!=(const ZrtpStdAllocator<T>&, const ZrtpStdAllocator<U>&) { return false; }
+
+#endif
+
+/**
+ * @}
+ */
+#endif // _ZRTPALLOCATOR_H_
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <common/ZrtpReclaimer.h>
+
+/*
+ * The background thread of the reclaimer. The thread takes all pending tasks at
+ * once and runs them without holding the lock. The destructor runs the tasks that
+ * are still pending, they wipe key material.
+ */
+class ReclaimWorker {
+public:
+    ReclaimWorker(): pending(0), deferred(false), running(false) {}
+
+    ~ReclaimWorker() { setDeferred(false); }
+
+    void setDeferred(bool enable);
+
+    bool isDeferred();
+
+    void submit(std::function<void()>& task);
+
+    void flush();
+
+    size_t getPending();
+
+private:
+    void run();
+
+    std::mutex lock;
+    std::condition_variable wakeup;
+    std::condition_variable idle;
+    std::thread worker;
+    std::deque<std::function<void()> > tasks;
+    size_t pending;             // tasks submitted and not yet done
+    bool deferred;
+    bool running;
+};
+
+void ReclaimWorker::setDeferred(bool enable)
+{
+    std::thread stopped;
+    {
+        std::unique_lock<std::mutex> guard(lock);
+
+        deferred = enable;
+        if (enable && !running) {
+            running = true;
+            worker = std::thread(&ReclaimWorker::run, this);
+        }
+        else if (!enable && running) {
+            while (pending > 0)
+                idle.wait(guard);
+            running = false;
+            stopped.swap(worker);
+            wakeup.notify_one();
+        }
+    }
+    // Join outside of the lock, the worker thread needs the lock to terminate
+    if (stopped.joinable())
+        stopped.join();
+}
+
+bool ReclaimWorker::isDeferred()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return deferred;
+}
+
+void ReclaimWorker::submit(std::function<void()>& task)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        if (deferred) {
+            tasks.push_back(std::move(task));
+            pending++;
+            wakeup.notify_one();
+            return;
+        }
+    }
+    task();
+}
+
+void ReclaimWorker::flush()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (pending > 0)
+        idle.wait(guard);
+}
+
+size_t ReclaimWorker::getPending()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return pending;
+}
+
+void ReclaimWorker::run()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    std::deque<std::function<void()> > batch;
+
+    while (running) {
+        if (tasks.empty()) {
+            wakeup.wait(guard);
+            continue;
+        }
+        batch.swap(tasks);
+
+        guard.unlock();
+        size_t done = batch.size();
+        for (std::function<void()>& task : batch)
+            task();
+        batch.clear();
+        guard.lock();
+
+        pending -= done;
+        if (pending == 0)
+            idle.notify_all();
+    }
+}
+
+static ReclaimWorker reclaimWorker;
+
+void ZrtpReclaimer::setDeferred(bool deferred)
+{
+    reclaimWorker.setDeferred(deferred);
+}
+
+bool ZrtpReclaimer::isDeferred()
+{
+    return reclaimWorker.isDeferred();
+}
+
+void ZrtpReclaimer::submit(std::function<void()> task)
+{
+    reclaimWorker.submit(task);
+}
+
+void ZrtpReclaimer::flush()
+{
+    reclaimWorker.flush();
+}
+
+size_t ZrtpReclaimer::getPending()
+{
+    return reclaimWorker.getPending();
+}
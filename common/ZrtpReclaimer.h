@@ -0,0 +1,109 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPRECLAIMER_H_
+#define _ZRTPRECLAIMER_H_
+
+/**
+ * @file ZrtpReclaimer.h
+ * @brief Deferred release of ZRTP engines and SRTP crypto contexts
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stddef.h>
+#include <functional>
+#include <common/osSpecifics.h>
+
+/**
+ * @brief Release objects in batches on a background thread.
+ *
+ * Deleting a ZRtp engine or a CryptoContext wipes the keys and releases the key
+ * schedules, hash contexts, the DH context and the ZID record. If many calls end
+ * at the same time, for example at the end of a conference, the thread that
+ * handles the hangups spends a noticeable time in these destructors.
+ *
+ * If the application enables the deferred mode, the clients hand the released
+ * objects to the reclaimer. A background thread takes all pending objects at
+ * once and deletes them, the blocks of the SRTP objects go back to SrtpMemoryPool
+ * and the allocator of the library. Without the deferred mode the reclaimer
+ * deletes the objects immediately.
+ *
+ * Only objects that do not call back into the client may be deferred: the
+ * client stops a ZRtp engine with ZRtp::detachCallback() before it hands over
+ * the engine.
+ *
+ * The deferred mode is disabled by default. All functions are thread safe.
+ */
+class __EXPORT ZrtpReclaimer {
+public:
+    /**
+     * @brief Enable or disable the deferred mode.
+     *
+     * Disabling the deferred mode waits until the background thread released
+     * all pending objects and stops the thread.
+     *
+     * @param deferred
+     *    If true release the objects on the background thread.
+     */
+    static void setDeferred(bool deferred);
+
+    /**
+     * @brief Check if the deferred mode is enabled.
+     */
+    static bool isDeferred();
+
+    /**
+     * @brief Run a release task on the background thread.
+     *
+     * Runs the task immediately if the deferred mode is disabled. The task
+     * must not throw an exception.
+     *
+     * @param task
+     *    The task that releases the objects.
+     */
+    static void submit(std::function<void()> task);
+
+    /**
+     * @brief Delete an object on the background thread.
+     *
+     * @param object
+     *    The object, may be @c NULL.
+     */
+    template <class T>
+    static void reclaim(T* object) {
+        if (object != NULL)
+            submit([object]() { delete object; });
+    }
+
+    /**
+     * @brief Wait until the background thread released all pending objects.
+     */
+    static void flush();
+
+    /**
+     * @brief Get the number of pending release tasks.
+     *
+     * @return
+     *    number of submitted tasks that did not run yet.
+     */
+    static size_t getPending();
+};
+
+/**
+ * @}
+ */
+#endif // _ZRTPRECLAIMER_H_
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <common/ZrtpStaticPool.h>
+
+// Only the static allocation mode reserves the arena
+#ifdef ZRTP_STATIC_ALLOCATION
+
+#include <cstdlib>
+#include <mutex>
+
+#define POOL_MIN_BLOCK      32
+#define POOL_CLASSES        10          // 32, 64, ..., 16384 bytes
+
+/*
+ * Each block starts with a header that stores the size class, the header
+ * keeps the user data aligned to 16 bytes. A free block stores the pointer to
+ * the next free block of its size class after the header.
+ */
+#define POOL_HEADER         16
+
+typedef struct _BlockHeader {
+    uint32_t sizeClass;
+} BlockHeader;
+
+typedef struct _FreeBlock {
+    struct _FreeBlock* next;
+} FreeBlock;
+
+alignas(16) static unsigned char arena[ZRTP_STATIC_POOL_BYTES];
+
+static std::mutex poolLock;
+static FreeBlock* freeLists[POOL_CLASSES];
+static size_t carved;
+static size_t inUse;
+static size_t peak;
+static uint32_t failures;
+
+static inline int32_t sizeClass(size_t bytes)
+{
+    size_t size = POOL_MIN_BLOCK;
+
+    for (int32_t i = 0; i < POOL_CLASSES; i++, size <<= 1) {
+        if (bytes + POOL_HEADER <= size)
+            return i;
+    }
+    return -1;
+}
+
+void* zrtpStaticAlloc(size_t bytes)
+{
+    int32_t index = sizeClass(bytes);
+
+    std::lock_guard<std::mutex> guard(poolLock);
+
+    if (index < 0) {
+        failures++;
+        return NULL;
+    }
+    size_t blockSize = (size_t)POOL_MIN_BLOCK << index;
+    unsigned char* block;
+
+    FreeBlock* freeBlock = freeLists[index];
+    if (freeBlock != NULL) {
+        freeLists[index] = freeBlock->next;
+        block = reinterpret_cast<unsigned char*>(freeBlock) - POOL_HEADER;
+    }
+    else {
+        if (carved + blockSize > sizeof(arena)) {
+            failures++;
+            return NULL;
+        }
+        block = arena + carved;
+        carved += blockSize;
+        reinterpret_cast<BlockHeader*>(block)->sizeClass = static_cast<uint32_t>(index);
+    }
+    inUse += blockSize;
+    if (inUse > peak)
+        peak = inUse;
+    return block + POOL_HEADER;
+}
+
+void zrtpStaticFree(void* ptr)
+{
+    if (ptr == NULL)
+        return;
+    if (!zrtpStaticPoolOwns(ptr)) {
+        free(ptr);
+        return;
+    }
+    unsigned char* block = static_cast<unsigned char*>(ptr) - POOL_HEADER;
+    uint32_t index = reinterpret_cast<BlockHeader*>(block)->sizeClass;
+
+    std::lock_guard<std::mutex> guard(poolLock);
+
+    FreeBlock* freeBlock = static_cast<FreeBlock*>(ptr);
+    freeBlock->next = freeLists[index];
+    freeLists[index] = freeBlock;
+    inUse -= (size_t)POOL_MIN_BLOCK << index;
+}
+
+int zrtpStaticPoolOwns(const void* ptr)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(ptr);
+
+    return p >= arena && p < arena + sizeof(arena);
+}
+
+void zrtpStaticPoolGetStats(ZrtpStaticPoolStats* stats)
+{
+    std::lock_guard<std::mutex> guard(poolLock);
+
+    stats->capacity = sizeof(arena);
+    stats->carved = carved;
+    stats->inUse = inUse;
+    stats->peak = peak;
+    stats->failures = failures;
+}
+
+#endif // ZRTP_STATIC_ALLOCATION
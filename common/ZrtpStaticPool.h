@@ -0,0 +1,149 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPSTATICPOOL_H_
+#define _ZRTPSTATICPOOL_H_
+
+/**
+ * @file ZrtpStaticPool.h
+ * @brief Statically reserved memory for the static allocation mode
+ * @ingroup GNU_ZRTP
+ * @{
+ *
+ * If the library is built with @c ZRTP_STATIC_ALLOCATION (CMake option
+ * @c STATIC_ALLOCATION) the objects of a call come from one statically
+ * reserved arena instead of the heap: the ZRtp engine, its state engine and
+ * DH context, the DH secret, the bignum and elliptic curve buffers, the SRTP
+ * crypto contexts, ciphers and key schedules (see SrtpMemoryPool) and the
+ * timeout requests of TiviTimeoutProvider. The arena is the default
+ * allocator of the library in this mode, see ZrtpAllocator.h. Systems without
+ * a general heap can use the library this way and the call setup has no
+ * allocator latency.
+ *
+ * The arena hands out blocks in power of two size classes from 32 up to
+ * 16384 bytes. It carves a new block from the unused end of the arena only
+ * if the free list of the size class is empty, a released block returns to
+ * the free list of its class. Thus after the first calls at the maximum load
+ * the arena serves all requests from the free lists. The caller must wipe
+ * secret data before it releases a block.
+ *
+ * The compile time limits @c ZRTP_MAX_SESSIONS, @c ZRTP_MAX_STREAMS and
+ * @c ZRTP_MAX_TIMERS size the arena, @c ZRTP_STATIC_STREAM_BYTES is the
+ * memory that one active stream needs, including the temporary bignum buffers
+ * of its DH key agreement. If the arena is exhausted the allocation fails
+ * like an allocation on an exhausted heap and the pool counts the failure,
+ * see zrtpStaticPoolGetStats().
+ *
+ * All functions are thread safe.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Maximum number of concurrent sessions */
+#ifndef ZRTP_MAX_SESSIONS
+#define ZRTP_MAX_SESSIONS           4
+#endif
+
+/** @brief Maximum number of streams of a session, for example audio and video */
+#ifndef ZRTP_MAX_STREAMS
+#define ZRTP_MAX_STREAMS            2
+#endif
+
+/** @brief Maximum number of pending timeout requests */
+#ifndef ZRTP_MAX_TIMERS
+#define ZRTP_MAX_TIMERS             (ZRTP_MAX_SESSIONS * ZRTP_MAX_STREAMS * 2)
+#endif
+
+/** @brief Arena bytes of one active stream */
+#ifndef ZRTP_STATIC_STREAM_BYTES
+#define ZRTP_STATIC_STREAM_BYTES    65536
+#endif
+
+/** @brief Arena bytes of one timeout request */
+#define ZRTP_STATIC_TIMER_BYTES     128
+
+/** @brief Arena bytes of the objects that all sessions share, for example curve parameters */
+#ifndef ZRTP_STATIC_SHARED_BYTES
+#define ZRTP_STATIC_SHARED_BYTES    65536
+#endif
+
+/** @brief Size of the arena in bytes */
+#ifndef ZRTP_STATIC_POOL_BYTES
+#define ZRTP_STATIC_POOL_BYTES      (ZRTP_MAX_SESSIONS * ZRTP_MAX_STREAMS * ZRTP_STATIC_STREAM_BYTES + \
+                                     ZRTP_MAX_TIMERS * ZRTP_STATIC_TIMER_BYTES + ZRTP_STATIC_SHARED_BYTES)
+#endif
+
+/**
+ * @brief Usage of the arena.
+ */
+typedef struct _ZrtpStaticPoolStats {
+    size_t capacity;        //!< size of the arena in bytes
+    size_t carved;          //!< bytes of the arena that belong to a size class
+    size_t inUse;           //!< bytes of the allocated blocks
+    size_t peak;            //!< largest value of @c inUse
+    uint32_t failures;      //!< allocations that the arena could not serve
+} ZrtpStaticPoolStats;
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/**
+ * @brief Allocate a block from the arena.
+ *
+ * @param bytes
+ *    Size of the block in bytes.
+ * @return
+ *    Pointer to the block, aligned to 16 bytes, @c NULL if the arena cannot
+ *    serve the request.
+ */
+extern void* zrtpStaticAlloc(size_t bytes);
+
+/**
+ * @brief Release a block to its free list.
+ *
+ * A pointer that does not belong to the arena goes to @c free.
+ *
+ * @param ptr
+ *    Pointer to the block, may be @c NULL.
+ */
+extern void zrtpStaticFree(void* ptr);
+
+/**
+ * @brief Check if a pointer belongs to the arena.
+ *
+ * @return 1 if @c ptr points into the arena, 0 otherwise.
+ */
+extern int zrtpStaticPoolOwns(const void* ptr);
+
+/**
+ * @brief Get the usage of the arena.
+ *
+ * @param stats
+ *    Receives the usage data.
+ */
+extern void zrtpStaticPoolGetStats(ZrtpStaticPoolStats* stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+/**
+ * @}
+ */
+#endif // _ZRTPSTATICPOOL_H_
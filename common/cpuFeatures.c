@@ -0,0 +1,153 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <common/cpuFeatures.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+
+#include <cpuid.h>
+
+#ifndef bit_SHA
+#define bit_SHA (1 << 29)
+#endif
+#ifndef bit_AVX2
+#define bit_AVX2 (1 << 5)
+#endif
+#ifndef bit_BMI2
+#define bit_BMI2 (1 << 8)
+#endif
+#ifndef bit_RDRND
+#define bit_RDRND (1 << 30)
+#endif
+#ifndef bit_RDSEED
+#define bit_RDSEED (1 << 18)
+#endif
+
+static uint32_t probeCpu()
+{
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int xcr0 = 0, xcr0High;
+    uint32_t features = 0;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return 0;
+
+    if (ecx & bit_AES)
+        features |= ZRTP_CPU_AES;
+    if ((ecx & bit_PCLMUL) && (ecx & bit_SSSE3))
+        features |= ZRTP_CPU_CLMUL;
+    if (ecx & bit_SSE4_2)
+        features |= ZRTP_CPU_CRC32C;
+    if (ecx & bit_RDRND)
+        features |= ZRTP_CPU_RDRAND;
+    /* The operating system must save the AVX registers */
+    if (ecx & bit_OSXSAVE)
+        __asm__ ("xgetbv" : "=a"(xcr0), "=d"(xcr0High) : "c"(0));
+    if (ecx & bit_SSE4_1) {
+        if (__get_cpuid_max(0, 0) >= 7) {
+            __cpuid_count(7, 0, eax, ebx, ecx, edx);
+            if (ebx & bit_SHA)
+                features |= ZRTP_CPU_SHA1 | ZRTP_CPU_SHA256;
+#if defined(__x86_64__)
+            if ((ebx & bit_AVX2) && (ebx & bit_BMI2) && (xcr0 & 6) == 6)
+                features |= ZRTP_CPU_SHA512;
+#endif
+            if ((ebx & bit_AVX2) && (xcr0 & 6) == 6)
+                features |= ZRTP_CPU_AVX2;
+            if (ebx & bit_RDSEED)
+                features |= ZRTP_CPU_RDSEED;
+        }
+    }
+    return features;
+}
+
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__) && defined(__APPLE__)
+
+/* All 64 bit Apple ARM CPUs support the crypto and CRC32 extensions */
+static uint32_t probeCpu()
+{
+    return ZRTP_CPU_AES | ZRTP_CPU_CLMUL | ZRTP_CPU_SHA1 | ZRTP_CPU_SHA256 | ZRTP_CPU_CRC32C;
+}
+
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__) && defined(__linux__)
+
+#include <sys/auxv.h>
+
+#ifndef HWCAP_AES
+#define HWCAP_AES   (1 << 3)
+#endif
+#ifndef HWCAP_PMULL
+#define HWCAP_PMULL (1 << 4)
+#endif
+#ifndef HWCAP_SHA1
+#define HWCAP_SHA1  (1 << 5)
+#endif
+#ifndef HWCAP_SHA2
+#define HWCAP_SHA2  (1 << 6)
+#endif
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+
+static uint32_t probeCpu()
+{
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    uint32_t features = 0;
+
+    if (hwcap & HWCAP_AES)
+        features |= ZRTP_CPU_AES;
+    if (hwcap & HWCAP_PMULL)
+        features |= ZRTP_CPU_CLMUL;
+    if (hwcap & HWCAP_SHA1)
+        features |= ZRTP_CPU_SHA1;
+    if (hwcap & HWCAP_SHA2)
+        features |= ZRTP_CPU_SHA256;
+    if (hwcap & HWCAP_CRC32)
+        features |= ZRTP_CPU_CRC32C;
+    return features;
+}
+
+#else
+
+static uint32_t probeCpu()
+{
+    return 0;
+}
+
+#endif
+
+/*
+ * -1: not yet probed. The probe is idempotent, thus a concurrent first call
+ * from several threads is harmless.
+ */
+static volatile int cpuFeatures = -1;
+static volatile uint32_t featureMask = 0xffffffff;
+
+uint32_t zrtpCpuFeatures()
+{
+    if (cpuFeatures < 0)
+        cpuFeatures = (int)probeCpu();
+    return (uint32_t)cpuFeatures & featureMask;
+}
+
+void zrtpSetCpuFeatureMask(uint32_t mask)
+{
+    featureMask = mask;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _CPUFEATURES_H_
+#define _CPUFEATURES_H_
+
+/**
+ * @file cpuFeatures.h
+ * @brief Runtime detection of the CPU features that the crypto functions use
+ * @defgroup GNU_ZRTP The GNU ZRTP C++ implementation
+ * @{
+ *
+ * The library probes the CPU once, with @c cpuid on x86 and the auxiliary
+ * vector on Linux AArch64. The hardware AES, GHASH, SHA1, SHA256, SHA512 and
+ * CRC32c functions check the feature bits to select their implementation at
+ * runtime, thus one binary uses the best functions on each CPU.
+ *
+ * Like @c osSpecifics.h this header does not include system specific
+ * headers, refer to @c cpuFeatures.c for the CPU specific code.
+ */
+
+#include <stdint.h>
+
+#define ZRTP_CPU_AES        0x01    //!< AES-NI or ARMv8 AES instructions
+#define ZRTP_CPU_CLMUL      0x02    //!< PCLMULQDQ and SSSE3, GHASH
+#define ZRTP_CPU_SHA1       0x04    //!< x86 SHA extensions or ARMv8 SHA1 instructions
+#define ZRTP_CPU_SHA256     0x08    //!< x86 SHA extensions or ARMv8 SHA2 instructions
+#define ZRTP_CPU_SHA512     0x10    //!< AVX2 and BMI2 with operating system support
+#define ZRTP_CPU_CRC32C     0x20    //!< SSE4.2 or ARMv8 CRC32 instructions
+#define ZRTP_CPU_AVX2       0x40    //!< AVX2 with operating system support, multi-buffer hashing
+#define ZRTP_CPU_RDRAND     0x80    //!< x86 RDRAND instruction
+#define ZRTP_CPU_RDSEED     0x100   //!< x86 RDSEED instruction
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/**
+ * @brief Get the CPU features that the crypto functions may use.
+ *
+ * The first call probes the CPU, the function returns the cached result
+ * afterwards. A concurrent first call from several threads is harmless.
+ *
+ * @return the @c ZRTP_CPU_* bits of the available features, cleared by the
+ *         mask of @c zrtpSetCpuFeatureMask
+ */
+extern uint32_t zrtpCpuFeatures();
+
+/**
+ * @brief Restrict the CPU features that the crypto functions use.
+ *
+ * An application may disable features, for example to compare the
+ * performance of the portable and the hardware functions. The functions
+ * check the features on each call, contexts that are already initialized
+ * may keep their selection.
+ *
+ * @param mask the @c ZRTP_CPU_* bits that the crypto functions may use,
+ *        @c 0xffffffff enables all available features (the default)
+ */
+extern void zrtpSetCpuFeatureMask(uint32_t mask);
+
+#if defined(__cplusplus)
+}
+#endif
+
+/**
+ * @}
+ */
+#endif
@@ -39,11 +39,38 @@ uint64_t  zrtpGetTickCount()
    ret <<= 32;
    ret |= ft.dwLowDateTime;
 
-   return ret / 10;             //return msec
+   // FILETIME counts 100ns units
+   return ret / 10000;          //return msec
+}
+
+static uint64_t defaultMonotonicTime(void)
+{
+   static LARGE_INTEGER frequency;
+   LARGE_INTEGER counter;
+
+   if (frequency.QuadPart == 0)
+       QueryPerformanceFrequency(&frequency);
+   QueryPerformanceCounter(&counter);
+
+   return (uint64_t)(counter.QuadPart / (frequency.QuadPart / 1000));
+}
+
+uint64_t zrtpGetThreadCpuTime()
+{
+   FILETIME creation, exitTime, kernel, user;
+   unsigned long long ret;
+
+   if (!GetThreadTimes(GetCurrentThread(), &creation, &exitTime, &kernel, &user))
+       return 0;
+   ret = ((unsigned long long)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+   ret += ((unsigned long long)user.dwHighDateTime << 32) | user.dwLowDateTime;
+
+   return ret / 10;             // 100ns units to us
 }
 #else
 # include <netinet/in.h>
 # include <sys/time.h>
+# include <time.h>
 
 uint64_t zrtpGetTickCount()
 {
@@ -53,8 +80,53 @@ uint64_t zrtpGetTickCount()
    return ((uint64_t)tv.tv_sec) * (uint64_t)1000 + ((uint64_t)tv.tv_usec) / (uint64_t)1000;
 }
 
+static uint64_t defaultMonotonicTime(void)
+{
+#if defined(CLOCK_MONOTONIC_COARSE) || defined(CLOCK_MONOTONIC)
+   struct timespec ts;
+
+   // The coarse clock reads the time of the last tick, no hardware access
+# if defined(CLOCK_MONOTONIC_COARSE)
+   if (clock_gettime(CLOCK_MONOTONIC_COARSE, &ts) == 0)
+       return ((uint64_t)ts.tv_sec) * (uint64_t)1000 + ((uint64_t)ts.tv_nsec) / (uint64_t)1000000;
+# endif
+# if defined(CLOCK_MONOTONIC)
+   if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+       return ((uint64_t)ts.tv_sec) * (uint64_t)1000 + ((uint64_t)ts.tv_nsec) / (uint64_t)1000000;
+# endif
+#endif
+   return zrtpGetTickCount();
+}
+
+uint64_t zrtpGetThreadCpuTime()
+{
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+   struct timespec ts;
+
+   if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+       return 0;
+   return ((uint64_t)ts.tv_sec) * (uint64_t)1000000 + ((uint64_t)ts.tv_nsec) / (uint64_t)1000;
+#else
+   return 0;
+#endif
+}
+
 #endif
 
+static zrtpClockFunction monotonicClock = NULL;
+
+uint64_t zrtpGetMonotonicTime()
+{
+   zrtpClockFunction clock = monotonicClock;
+
+   return (clock != NULL) ? clock() : defaultMonotonicTime();
+}
+
+void zrtpSetMonotonicClock(zrtpClockFunction clock)
+{
+   monotonicClock = clock;
+}
+
 uint32_t zrtpNtohl (uint32_t net)
 {
     return ntohl(net);
@@ -66,10 +66,52 @@ extern "C"
 /**
  * Get surrent system time in milli-second.
  *
+ * The system time may jump if the system adjusts its clock, use
+ * zrtpGetMonotonicTime() to measure time intervals.
+ *
  * @return current time in ms.
  */
 extern uint64_t zrtpGetTickCount();
 
+/**
+ * The type of a monotonic clock function, returns the time in milli-seconds.
+ */
+typedef uint64_t (*zrtpClockFunction)(void);
+
+/**
+ * Get the time of the monotonic clock in milli-seconds.
+ *
+ * The timers and the statistics use this clock. The clock does not jump if
+ * the system adjusts its time. Its start is unspecified, thus only the
+ * difference of two calls is meaningful. The default clock is cheap enough
+ * to call for each packet: on Linux it reads @c CLOCK_MONOTONIC_COARSE, on
+ * Windows the performance counter. The application may set another clock
+ * with zrtpSetMonotonicClock().
+ *
+ * @return current time of the monotonic clock in ms.
+ */
+extern uint64_t zrtpGetMonotonicTime();
+
+/**
+ * Set the clock of zrtpGetMonotonicTime().
+ *
+ * Set the clock before the application creates ZRTP sessions or timers, the
+ * running timers would mix the times of both clocks.
+ *
+ * @param clock the clock function, @c NULL selects the default clock.
+ */
+extern void zrtpSetMonotonicClock(zrtpClockFunction clock);
+
+/**
+ * Get the CPU time of the calling thread in micro-seconds.
+ *
+ * The difference of two calls is the CPU time the thread used between the
+ * calls, the waiting time for I/O or locks does not count.
+ *
+ * @return CPU time of the calling thread in us, 0 if the system does not support it.
+ */
+extern uint64_t zrtpGetThreadCpuTime();
+
 /**
  * Convert a 32bit variable from network to host order.
  *
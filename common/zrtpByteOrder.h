@@ -0,0 +1,195 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPBYTEORDER_H_
+#define _ZRTPBYTEORDER_H_
+
+/**
+ * @file zrtpByteOrder.h
+ * @brief Inline byte order functions and header field accessors of RTP, RTCP and ZRTP packets
+ * @ingroup GNU_ZRTP
+ * @{
+ *
+ * The functions zrtpNtohl() etc. of @c osSpecifics.h are real function calls.
+ * The packet paths call the inline functions of this file instead, they
+ * compile to a load and a byte swap instruction. The load and store functions
+ * do not require an aligned pointer, the packet buffers of the applications
+ * are not always aligned.
+ *
+ * Without a known byte order of the compiler the functions compose the
+ * values byte by byte, this works on all platforms.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+# define ZRTP_BSWAP16(x)    __builtin_bswap16(x)
+# define ZRTP_BSWAP32(x)    __builtin_bswap32(x)
+# define ZRTP_BSWAP64(x)    __builtin_bswap64(x)
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64) || defined(_M_ARM) || defined(_M_ARM64))
+# include <stdlib.h>
+# define ZRTP_BSWAP16(x)    _byteswap_ushort(x)
+# define ZRTP_BSWAP32(x)    _byteswap_ulong(x)
+# define ZRTP_BSWAP64(x)    _byteswap_uint64(x)
+#elif defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+# define ZRTP_BIG_ENDIAN_HOST
+#else
+# define ZRTP_BYTEWISE_ORDER
+#endif
+
+/**
+ * Convert a 16 bit value between host and network byte order.
+ */
+static inline uint16_t zrtpBe16(uint16_t value)
+{
+#if defined(ZRTP_BIG_ENDIAN_HOST)
+    return value;
+#elif defined(ZRTP_BYTEWISE_ORDER)
+    uint8_t bytes[2];
+    memcpy(bytes, &value, sizeof(value));
+    return (uint16_t)((bytes[0] << 8) | bytes[1]);
+#else
+    return ZRTP_BSWAP16(value);
+#endif
+}
+
+/**
+ * Convert a 32 bit value between host and network byte order.
+ */
+static inline uint32_t zrtpBe32(uint32_t value)
+{
+#if defined(ZRTP_BIG_ENDIAN_HOST)
+    return value;
+#elif defined(ZRTP_BYTEWISE_ORDER)
+    uint8_t bytes[4];
+    memcpy(bytes, &value, sizeof(value));
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+#else
+    return ZRTP_BSWAP32(value);
+#endif
+}
+
+/**
+ * Convert a 64 bit value between host and network byte order.
+ */
+static inline uint64_t zrtpBe64(uint64_t value)
+{
+#if defined(ZRTP_BIG_ENDIAN_HOST)
+    return value;
+#elif defined(ZRTP_BYTEWISE_ORDER)
+    return ((uint64_t)zrtpBe32((uint32_t)value) << 32) | zrtpBe32((uint32_t)(value >> 32));
+#else
+    return ZRTP_BSWAP64(value);
+#endif
+}
+
+/**
+ * Load a 16 bit value in network byte order from an unaligned address.
+ */
+static inline uint16_t zrtpLoadBe16(const uint8_t* data)
+{
+    uint16_t value;
+    memcpy(&value, data, sizeof(value));
+    return zrtpBe16(value);
+}
+
+/**
+ * Load a 32 bit value in network byte order from an unaligned address.
+ */
+static inline uint32_t zrtpLoadBe32(const uint8_t* data)
+{
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return zrtpBe32(value);
+}
+
+/**
+ * Load a 64 bit value in network byte order from an unaligned address.
+ */
+static inline uint64_t zrtpLoadBe64(const uint8_t* data)
+{
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return zrtpBe64(value);
+}
+
+/**
+ * Store a 16 bit value in network byte order at an unaligned address.
+ */
+static inline void zrtpStoreBe16(uint8_t* data, uint16_t value)
+{
+    value = zrtpBe16(value);
+    memcpy(data, &value, sizeof(value));
+}
+
+/**
+ * Store a 32 bit value in network byte order at an unaligned address.
+ */
+static inline void zrtpStoreBe32(uint8_t* data, uint32_t value)
+{
+    value = zrtpBe32(value);
+    memcpy(data, &value, sizeof(value));
+}
+
+/**
+ * Store a 64 bit value in network byte order at an unaligned address.
+ */
+static inline void zrtpStoreBe64(uint8_t* data, uint64_t value)
+{
+    value = zrtpBe64(value);
+    memcpy(data, &value, sizeof(value));
+}
+
+/*
+ * The header fields of RTP, RTCP and ZRTP packets. The caller checks that the
+ * packet contains the field.
+ */
+
+/** The sequence number of a RTP packet, needs 4 bytes. */
+static inline uint16_t zrtpRtpSequence(const uint8_t* packet) { return zrtpLoadBe16(packet + 2); }
+
+/** The timestamp of a RTP packet, needs 8 bytes. */
+static inline uint32_t zrtpRtpTimestamp(const uint8_t* packet) { return zrtpLoadBe32(packet + 4); }
+
+/** The SSRC of a RTP packet, needs 12 bytes. */
+static inline uint32_t zrtpRtpSsrc(const uint8_t* packet) { return zrtpLoadBe32(packet + 8); }
+
+/** The number of CSRC entries of a RTP packet. */
+static inline int32_t zrtpRtpCsrcCount(const uint8_t* packet) { return packet[0] & 0x0f; }
+
+/** True if the RTP packet has a header extension. */
+static inline int zrtpRtpHasExtension(const uint8_t* packet) { return (packet[0] & 0x10) != 0; }
+
+/** The length of a RTP header extension in 32 bit words, without the extension header, needs 4 bytes. */
+static inline uint16_t zrtpRtpExtensionWords(const uint8_t* extension) { return zrtpLoadBe16(extension + 2); }
+
+/** The SSRC of the sender of a RTCP packet, needs 8 bytes. */
+static inline uint32_t zrtpRtcpSsrc(const uint8_t* packet) { return zrtpLoadBe32(packet + 4); }
+
+/** The sequence number of a ZRTP packet, needs 4 bytes. */
+static inline uint16_t zrtpPacketSequence(const uint8_t* packet) { return zrtpLoadBe16(packet + 2); }
+
+/** The magic cookie of a ZRTP packet, needs 8 bytes. */
+static inline uint32_t zrtpPacketMagic(const uint8_t* packet) { return zrtpLoadBe32(packet + 4); }
+
+/** The SSRC of a ZRTP packet, needs 12 bytes. */
+static inline uint32_t zrtpPacketSsrc(const uint8_t* packet) { return zrtpLoadBe32(packet + 8); }
+
+/**
+ * @}
+ */
+#endif // _ZRTPBYTEORDER_H_
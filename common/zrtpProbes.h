@@ -0,0 +1,79 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPPROBES_H_
+#define _ZRTPPROBES_H_
+
+/**
+ * @file zrtpProbes.h
+ * @brief Static USDT probes of the ZRTP and SRTP hot paths
+ * @ingroup GNU_ZRTP
+ * @{
+ *
+ * A build with the cmake option @c USDT defines @c ZRTP_USDT_PROBES and the
+ * macros expand to the @c DTRACE_PROBE macros of @c <sys/sdt.h>. A probe is
+ * a single @c nop instruction and an ELF note, tools like perf, bpftrace or
+ * SystemTap attach to it at run time, for example:
+ *
+ @verbatim
+ bpftrace -e 'usdt:/usr/lib/libzrtpcpp.so:zrtpcpp:srtp_auth_fail { @[arg0] = count(); }'
+ @endverbatim
+ *
+ * The provider name of all probes is @c zrtpcpp. The probes do not use
+ * semaphores, thus an enabled build always evaluates the probe arguments.
+ * The arguments are plain values the code has at hand already.
+ *
+ * Without @c ZRTP_USDT_PROBES the macros expand to nothing and do not
+ * evaluate their arguments.
+ *
+ * Probes:
+ * - @c srtp_protect_entry(ssrc, length), @c srtp_protect_return(result, newLength)
+ * - @c srtp_unprotect_entry(ssrc, length), @c srtp_unprotect_return(result, newLength)
+ *   result is the return value of SrtpHandler::unprotect()
+ * - @c srtp_replay_fail(ssrc, seq), @c srtp_auth_fail(ssrc, seq)
+ * - @c srtcp_replay_fail(ssrc, index), @c srtcp_auth_fail(ssrc, index)
+ * - @c zrtp_state(engine, oldState, newState, msgType), msgType is the ZRTP message
+ *   that triggered the transition or @c TypeUnknown for other events
+ * - @c timer_arm(entry, timeMs), @c timer_cancel(entry), @c timer_fire(entry, lateMs)
+ * - @c cache_get_entry(engine), @c cache_get_return(engine, record)
+ * - @c cache_save_entry(engine, async), @c cache_save_return(engine)
+ * - @c dh_compute_entry(engine, dhSize), @c dh_compute_return(engine, dhSize)
+ */
+
+#if defined(ZRTP_USDT_PROBES)
+#include <sys/sdt.h>
+
+#define ZRTP_PROBE(name)                    DTRACE_PROBE(zrtpcpp, name)
+#define ZRTP_PROBE1(name, a1)               DTRACE_PROBE1(zrtpcpp, name, a1)
+#define ZRTP_PROBE2(name, a1, a2)           DTRACE_PROBE2(zrtpcpp, name, a1, a2)
+#define ZRTP_PROBE3(name, a1, a2, a3)       DTRACE_PROBE3(zrtpcpp, name, a1, a2, a3)
+#define ZRTP_PROBE4(name, a1, a2, a3, a4)   DTRACE_PROBE4(zrtpcpp, name, a1, a2, a3, a4)
+
+#else
+
+// The sizeof expressions mark the arguments as used but do not evaluate them
+#define ZRTP_PROBE(name)                    do { } while (0)
+#define ZRTP_PROBE1(name, a1)               do { (void)sizeof(a1); } while (0)
+#define ZRTP_PROBE2(name, a1, a2)           do { (void)sizeof(a1); (void)sizeof(a2); } while (0)
+#define ZRTP_PROBE3(name, a1, a2, a3)       do { (void)sizeof(a1); (void)sizeof(a2); (void)sizeof(a3); } while (0)
+#define ZRTP_PROBE4(name, a1, a2, a3, a4)   do { (void)sizeof(a1); (void)sizeof(a2); (void)sizeof(a3); (void)sizeof(a4); } while (0)
+
+#endif
+
+/**
+ * @}
+ */
+#endif
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#if !(defined(_WIN32) || defined(_WIN64))
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+#include <stdlib.h>
+#define ZRTP_HAVE_ARC4RANDOM
+#endif
+
+#include <cryptcommon/ZrtpEntropy.h>
+#include <common/cpuFeatures.h>
+
+#ifndef GRND_NONBLOCK
+#define GRND_NONBLOCK 0x0001
+#endif
+
+static int32_t readUrandom(uint8_t* buffer, int32_t length)
+{
+    int32_t num = 0;
+
+#if !(defined(_WIN32) || defined(_WIN64))
+    int rnd = open("/dev/urandom", O_RDONLY);
+    if (rnd >= 0) {
+        ssize_t got = read(rnd, buffer, length);
+        num = got > 0 ? (int32_t)got : 0;
+        close(rnd);
+    }
+#else
+    (void)buffer;
+    (void)length;
+#endif
+    return num;
+}
+
+int32_t ZrtpSystemEntropy::getEntropy(uint8_t* buffer, int32_t length)
+{
+    if (length <= 0)
+        return 0;
+
+#if defined(ZRTP_HAVE_ARC4RANDOM)
+    arc4random_buf(buffer, length);
+    return length;
+#else
+#if defined(__linux__) && defined(SYS_getrandom)
+    // One system call instead of open, read and close. Requests up to 256 bytes are never interrupted
+    long got = syscall(SYS_getrandom, buffer, (size_t)length, GRND_NONBLOCK);
+    if (got == length)
+        return length;
+#endif
+    return readUrandom(buffer, length);
+#endif
+}
+
+// The instances exist until the process ends, the harvester thread may still use them during exit
+ZrtpSystemEntropy* ZrtpSystemEntropy::getInstance()
+{
+    static ZrtpSystemEntropy* instance = new ZrtpSystemEntropy();
+    return instance;
+}
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+
+#if defined(__x86_64__)
+typedef unsigned long long RandomWord;
+#else
+typedef unsigned int RandomWord;
+#endif
+
+// RDSEED fails if the CPU's entropy conditioner is exhausted, RDRAND fails only on a hardware problem
+static const int32_t seedRetries = 16;
+static const int32_t randRetries = 10;
+
+static bool rdseed(RandomWord* word)
+{
+    unsigned char ok;
+    __asm__ volatile ("rdseed %0; setc %1" : "=r"(*word), "=qm"(ok) : : "cc");
+    return ok != 0;
+}
+
+static bool rdrand(RandomWord* word)
+{
+    unsigned char ok;
+    __asm__ volatile ("rdrand %0; setc %1" : "=r"(*word), "=qm"(ok) : : "cc");
+    return ok != 0;
+}
+
+static bool cpuRandomWord(RandomWord* word, uint32_t features)
+{
+    if (features & ZRTP_CPU_RDSEED) {
+        for (int32_t i = 0; i < seedRetries; i++) {
+            if (rdseed(word))
+                return true;
+        }
+    }
+    if (features & ZRTP_CPU_RDRAND) {
+        for (int32_t i = 0; i < randRetries; i++) {
+            if (rdrand(word))
+                return true;
+        }
+    }
+    return false;
+}
+
+int32_t ZrtpCpuEntropy::getEntropy(uint8_t* buffer, int32_t length)
+{
+    uint32_t features = zrtpCpuFeatures();
+    int32_t num = 0;
+    RandomWord word;
+
+    while (num < length && cpuRandomWord(&word, features)) {
+        int32_t copied = (length - num < (int32_t)sizeof(word)) ? length - num : (int32_t)sizeof(word);
+        memcpy(buffer + num, &word, copied);
+        num += copied;
+    }
+    word = 0;
+    return num;
+}
+
+ZrtpCpuEntropy* ZrtpCpuEntropy::getInstance()
+{
+    static ZrtpCpuEntropy* instance = new ZrtpCpuEntropy();
+
+    if ((zrtpCpuFeatures() & (ZRTP_CPU_RDSEED | ZRTP_CPU_RDRAND)) == 0)
+        return NULL;
+    return instance;
+}
+
+#else
+
+int32_t ZrtpCpuEntropy::getEntropy(uint8_t*, int32_t)
+{
+    return 0;
+}
+
+ZrtpCpuEntropy* ZrtpCpuEntropy::getInstance()
+{
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPENTROPY_H_
+#define _ZRTPENTROPY_H_
+
+/**
+ * @file ZrtpEntropy.h
+ * @brief Entropy sources of the ZRTP random number generator
+ * @ingroup GNU_ZRTP
+ * @{
+ *
+ * The random number generator collects its seed from entropy sources, see
+ * ZrtpRandom::addEntropySource(). The library provides the operating
+ * system's random generator and the random instructions of x86 CPUs, an
+ * application may add its own sources, for example a hardware random
+ * generator.
+ */
+
+#include <stdint.h>
+
+/**
+ * @brief Interface of an entropy source.
+ *
+ * The random generator calls the source while it holds no lock of the
+ * generator, either from the background harvester or during a reseed if the
+ * harvester does not run. A source must not block for a long time.
+ */
+class ZrtpEntropySource {
+public:
+    virtual ~ZrtpEntropySource() {}
+
+    /**
+     * @brief Get the name of the source, for example for logging.
+     */
+    virtual const char* getName() const =0;
+
+    /**
+     * @brief Fill a buffer with entropy data.
+     *
+     * @param buffer
+     *    Receives the entropy data.
+     * @param length
+     *    Length of the buffer in bytes.
+     * @return
+     *    number of bytes the source stored, 0 if the source has no data.
+     */
+    virtual int32_t getEntropy(uint8_t* buffer, int32_t length) =0;
+};
+
+/**
+ * @brief The random generator of the operating system.
+ *
+ * Uses @c getrandom on Linux and Android, @c arc4random_buf on Apple and BSD
+ * systems and reads @c /dev/urandom if these functions are not available.
+ * The source does not wait if the system random generator is not yet
+ * initialized, it falls back to @c /dev/urandom instead. This is the
+ * default source of the random generator.
+ */
+class ZrtpSystemEntropy : public ZrtpEntropySource {
+public:
+    const char* getName() const { return "system"; }
+
+    int32_t getEntropy(uint8_t* buffer, int32_t length);
+
+    /**
+     * @brief Get the shared instance of the source.
+     */
+    static ZrtpSystemEntropy* getInstance();
+};
+
+/**
+ * @brief The random instructions of x86 CPUs.
+ *
+ * Uses @c RDSEED and falls back to @c RDRAND if @c RDSEED has no data. The
+ * instructions do not enter the kernel. The source is not a default source,
+ * an application that trusts the CPU's random generator adds it with
+ * ZrtpRandom::addEntropySource().
+ */
+class ZrtpCpuEntropy : public ZrtpEntropySource {
+public:
+    const char* getName() const { return "cpu"; }
+
+    int32_t getEntropy(uint8_t* buffer, int32_t length);
+
+    /**
+     * @brief Get the shared instance of the source.
+     *
+     * @return the source, @c NULL if the CPU has no random instructions.
+     */
+    static ZrtpCpuEntropy* getInstance();
+};
+
+/**
+ * @}
+ */
+#endif // _ZRTPENTROPY_H_
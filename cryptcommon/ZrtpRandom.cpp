@@ -14,18 +14,34 @@
  * limitations under the License.
  */
 
-#include <fcntl.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
+#include <vector>
+#if !(defined(_WIN32) || defined(_WIN64))
+#include <pthread.h>
+#endif
 
 #include <cryptcommon/ZrtpRandom.h>
+#include <cryptcommon/ZrtpEntropy.h>
 #include <cryptcommon/aescpp.h>
 #include <zrtp/crypto/sha2.h>
+#ifdef ZRTP_LOCK_PROFILING
+#include <libzrtpcpp/ZrtpProfiledMutex.h>
+#endif
 
 static sha512_ctx mainCtx;
 
+#ifdef ZRTP_LOCK_PROFILING
+static ZrtpProfiledMutex<std::mutex, ZrtpMetrics::RandomLock> lockRandom;
+#else
 static std::mutex lockRandom;
+#endif
 
 static bool initialized = false;
+static uint64_t reseedCounter = 0;
 
 /*
  * memset_volatile is a volatile pointer to the memset function.
@@ -37,82 +53,226 @@ static bool initialized = false;
 static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
 
 /*
- * Random bits are produced as follows.
- * First stir new entropy into the random state (zrtp->rand_ctx).
- * Then make a copy of the random context and finalize it.
- * Use the digest to seed an AES-256 context and, if space remains, to
- * initialize a counter.
- * Then encrypt the counter with the AES-256 context, incrementing it
- * per block, until we have produced the desired quantity of data.
+ * Each thread owns a fast key erasure generator, see
+ * https://blog.cr.yp.to/20170723-random.html
+ * The generator encrypts a counter with its AES-256 key to fill a buffer. It
+ * uses the first 32 bytes of the buffer as the new key and erases them, the
+ * remaining bytes are the random data. The generator erases the bytes it hands
+ * out, thus neither the key nor the buffer reveals previous random data.
+ *
+ * The generator reseeds its key from the shared SHA-512 pool if it generated
+ * more than reseedInterval bytes or if an application added entropy to the
+ * pool since the last reseed. Only the reseed takes the global lock, it reads
+ * the entropy sources if the background harvester does not run.
  */
-/*----------------------------------------------------------------------------*/
-int ZrtpRandom::getRandomData(uint8_t* buffer, uint32_t length) {
+static const size_t threadBufferSize = 512;
+static const uint64_t reseedInterval = 1024 * 1024;
+
+static std::atomic<uint32_t> seedGeneration(0);
 
+class ThreadRandom {
+public:
     AESencrypt aesCtx;
-    sha512_ctx randCtx2;
-    uint8_t    md[SHA512_DIGEST_SIZE];
-    uint8_t    ctr[AES_BLOCK_SIZE];
-    uint8_t    rdata[AES_BLOCK_SIZE];
-    uint32_t   generated = length;
-
-    /*
-     * Add entropy from system state
-     * We will include whatever happens to be in the buffer, it can't hurt
-     */
-    lockRandom.lock();
-    ZrtpRandom::addEntropy(buffer, length, true);
+    uint8_t    buffer[threadBufferSize];
+    size_t     position;       //!< next unused byte in buffer
+    uint64_t   generated;      //!< bytes generated since the last reseed
+    uint32_t   generation;     //!< seedGeneration of the last reseed
+    bool       seeded;
+
+    ThreadRandom(): position(threadBufferSize), generated(0), generation(0), seeded(false) {}
+
+    ~ThreadRandom() {
+        memset_volatile(&aesCtx, 0, sizeof(aesCtx));
+        memset_volatile(buffer, 0, sizeof(buffer));
+    }
 
-    /* Copy the mainCtx and finalize it into the md buffer */
-    memcpy(&randCtx2, &mainCtx, sizeof(sha512_ctx));
-    sha512_end(md, &randCtx2);
+    void refill() {
+        memset(buffer, 0, sizeof(buffer));
+        // The key changes with each refill, thus a block index is a sufficient counter
+        for (size_t i = 0; i < threadBufferSize / AES_BLOCK_SIZE; i++) {
+            buffer[i * AES_BLOCK_SIZE + AES_BLOCK_SIZE - 1] = static_cast<uint8_t>(i);
+        }
+        aesCtx.ecb_encrypt(buffer, buffer, sizeof(buffer));
+        aesCtx.key256(buffer);
+        memset_volatile(buffer, 0, 32);
+        position = 32;
+    }
+
+    void reseed() {
+        sha512_ctx randCtx2;
+        uint8_t    md[SHA512_DIGEST_SIZE];
+        ThreadRandom* self = this;
+
+        lockRandom.lock();
+        generation = seedGeneration.load(std::memory_order_acquire);
+        ZrtpRandom::addEntropy(NULL, 0, true);
+        memcpy(&randCtx2, &mainCtx, sizeof(sha512_ctx));
+        lockRandom.unlock();
+
+        // Separate the threads even if the system seed is not available
+        sha512_hash(reinterpret_cast<uint8_t*>(&self), sizeof(self), &randCtx2);
+        sha512_end(md, &randCtx2);
+
+        aesCtx.key256(md);
+        position = threadBufferSize;
+        generated = 0;
+        seeded = true;
+
+        memset_volatile(&randCtx2, 0, sizeof(randCtx2));
+        memset_volatile(md, 0, sizeof(md));
+    }
+};
+
+static thread_local ThreadRandom threadRandom;
+static thread_local ZrtpRandomHook* threadHook = NULL;
+
+/*
+ * The entropy sources and the background harvester. The harvester collects
+ * the data of the sources and the event samples without the pool lock and
+ * mixes a digest of them into the pool, thus a reseed does not call the
+ * sources while the harvester runs. The lock order is lockRandom before
+ * lockSources. The objects exist until the process ends because a harvester
+ * that the application did not stop may still use them during exit.
+ */
+static const int32_t maxHarvestBytes = 64;
+static const int32_t eventWords = 16;
 
+static std::mutex lockSources;
+static std::vector<ZrtpEntropySource*>* entropySources = NULL;
+
+struct Harvester {
+    std::thread thread;
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stop;
+    uint32_t intervalMs;
+    int32_t bytesPerSource;
+};
+static std::mutex lockHarvester;
+static Harvester* harvester = NULL;
+static std::atomic<bool> harvesting(false);
+
+static std::atomic<uint64_t> eventPool[eventWords];
+static std::atomic<uint32_t> eventCount(0);
+
+// Call with lockSources
+static std::vector<ZrtpEntropySource*>& sourceList() {
+    if (entropySources == NULL) {
+        entropySources = new std::vector<ZrtpEntropySource*>();
+        entropySources->push_back(ZrtpSystemEntropy::getInstance());
+    }
+    return *entropySources;
+}
+
+static void harvestOnce(int32_t bytesPerSource) {
+    sha512_ctx ctx;
+    uint8_t buffer[maxHarvestBytes];
+    uint8_t md[SHA512_DIGEST_SIZE];
+
+    sha512_begin(&ctx);
+    {
+        std::lock_guard<std::mutex> guard(lockSources);
+        std::vector<ZrtpEntropySource*>& list = sourceList();
+
+        for (size_t i = 0; i < list.size(); i++) {
+            int32_t got = list[i]->getEntropy(buffer, bytesPerSource);
+            if (got > 0)
+                sha512_hash(buffer, got, &ctx);
+        }
+    }
+    for (int32_t i = 0; i < eventWords; i++) {
+        uint64_t word = eventPool[i].load(std::memory_order_relaxed);
+        sha512_hash(reinterpret_cast<uint8_t*>(&word), sizeof(word), &ctx);
+    }
+    sha512_end(md, &ctx);
+
+    lockRandom.lock();
+    ZrtpRandom::addEntropy(md, sizeof(md), true);
     lockRandom.unlock();
 
-    /* Key an AES context from this buffer */
-    aesCtx.key256(md);
+    memset_volatile(&ctx, 0, sizeof(ctx));
+    memset_volatile(buffer, 0, sizeof(buffer));
+    memset_volatile(md, 0, sizeof(md));
+}
+
+static void harvestLoop(Harvester* h) {
+    std::unique_lock<std::mutex> guard(h->lock);
 
-    /* Initialize counter, using excess from md if available */
-    memset (ctr, 0, sizeof(ctr));
-    if (SHA512_DIGEST_SIZE > (256/8)) {
-        uint32_t ctrbytes = SHA512_DIGEST_SIZE - (256/8);
-        if (ctrbytes > AES_BLOCK_SIZE)
-            ctrbytes = AES_BLOCK_SIZE;
-        memcpy(ctr + sizeof(ctr) - ctrbytes, md + (256/8), ctrbytes);
+    while (!h->stop) {
+        h->wake.wait_for(guard, std::chrono::milliseconds(h->intervalMs));
+        if (h->stop)
+            break;
+        guard.unlock();
+        harvestOnce(h->bytesPerSource);
+        guard.lock();
     }
+}
+
+#if !(defined(_WIN32) || defined(_WIN64))
+// A forked child must not repeat the random data of its parent
+static void reseedAfterFork() {
+    seedGeneration.fetch_add(1, std::memory_order_release);
+    // The child has no harvester thread, the reseeds read the sources again
+    harvester = NULL;
+    harvesting.store(false, std::memory_order_release);
+}
+#endif
+
+/*----------------------------------------------------------------------------*/
+int ZrtpRandom::getRandomData(uint8_t* buffer, uint32_t length) {
+
+    ZrtpRandomHook* hook = threadHook;
+    if (hook != NULL && hook->provideRandom(buffer, length))
+        return length;
+
+    ThreadRandom& rng = threadRandom;
+    uint32_t generated = length;
+    uint8_t* start = buffer;
 
-    /* Encrypt counter, copy to destination buffer, increment counter */
+    if (!rng.seeded || rng.generated >= reseedInterval ||
+        rng.generation != seedGeneration.load(std::memory_order_acquire)) {
+        rng.reseed();
+    }
     while (length) {
-        uint8_t *ctrptr;
-        uint32_t copied;
-        aesCtx.encrypt(ctr, rdata);
-        copied = (sizeof(rdata) < length) ? sizeof(rdata) : length;
-        memcpy (buffer, rdata, copied);
+        if (rng.position == threadBufferSize) {
+            rng.refill();
+        }
+        uint32_t copied = threadBufferSize - rng.position;
+        if (copied > length)
+            copied = length;
+        memcpy(buffer, rng.buffer + rng.position, copied);
+        memset_volatile(rng.buffer + rng.position, 0, copied);
+        rng.position += copied;
         buffer += copied;
         length -= copied;
-
-        /* Increment counter */
-        ctrptr = ctr + sizeof(ctr) - 1;
-        while (ctrptr >= ctr) {
-            if ((*ctrptr-- += 1) != 0) {
-                break;
-            }
-        }
     }
-    memset_volatile(&randCtx2, 0, sizeof(randCtx2));
-    memset_volatile(md, 0, sizeof(md));
-    memset_volatile(&aesCtx, 0, sizeof(aesCtx));
-    memset_volatile(ctr, 0, sizeof(ctr));
-    memset_volatile(rdata, 0, sizeof(rdata));
+    rng.generated += generated;
 
+    if (hook != NULL)
+        hook->randomDrawn(start, generated);
     return generated;
 }
 
+ZrtpRandomHook* ZrtpRandom::setThreadHook(ZrtpRandomHook* hook) {
+    ZrtpRandomHook* previous = threadHook;
+    threadHook = hook;
+    return previous;
+}
+
+ZrtpRandomHook* ZrtpRandom::getThreadHook() {
+    return threadHook;
+}
+
 
 int ZrtpRandom::addEntropy(const uint8_t *buffer, uint32_t length, bool isLocked)
 {
 
     uint8_t newSeed[64];
-    size_t len = getSystemSeed(newSeed, sizeof(newSeed));
+    size_t len = 0;
+
+    // While the harvester runs it feeds the pool, the caller does not enter the kernel
+    if (!harvesting.load(std::memory_order_acquire))
+        len = getSystemSeed(newSeed, sizeof(newSeed));
 
     if (!isLocked) lockRandom.lock();
 
@@ -120,44 +280,133 @@ int ZrtpRandom::addEntropy(const uint8_t *buffer, uint32_t length, bool isLocked
 
     if (buffer && length) {
         sha512_hash(buffer, length, &mainCtx);
+        // New application entropy: all thread generators reseed
+        seedGeneration.fetch_add(1, std::memory_order_release);
     }
     if (len > 0) {
         sha512_hash(newSeed, len, &mainCtx);
         length += len;
     }
+    // Each reseed gets another pool state even if no new entropy arrived
+    reseedCounter++;
+    sha512_hash(reinterpret_cast<uint8_t*>(&reseedCounter), sizeof(reseedCounter), &mainCtx);
+
     if (!isLocked) lockRandom.unlock();
 
+    memset_volatile(newSeed, 0, sizeof(newSeed));
     return length;
 }
 
+void ZrtpRandom::addEntropySource(ZrtpEntropySource* source) {
+    if (source == NULL)
+        return;
+
+    std::lock_guard<std::mutex> guard(lockSources);
+    std::vector<ZrtpEntropySource*>& list = sourceList();
+
+    for (size_t i = 0; i < list.size(); i++) {
+        if (list[i] == source)
+            return;
+    }
+    list.push_back(source);
+}
+
+void ZrtpRandom::removeEntropySource(ZrtpEntropySource* source) {
+    std::lock_guard<std::mutex> guard(lockSources);
+    std::vector<ZrtpEntropySource*>& list = sourceList();
+
+    for (size_t i = 0; i < list.size(); i++) {
+        if (list[i] == source) {
+            list.erase(list.begin() + i);
+            return;
+        }
+    }
+}
+
+bool ZrtpRandom::startHarvester(uint32_t intervalMs, int32_t bytesPerSource) {
+    std::lock_guard<std::mutex> guard(lockHarvester);
+
+    if (harvester != NULL)
+        return false;
+    if (bytesPerSource <= 0 || bytesPerSource > maxHarvestBytes)
+        bytesPerSource = maxHarvestBytes;
+
+    // The pool has entropy before the reseeds stop reading the sources
+    harvestOnce(bytesPerSource);
+
+    Harvester* h = new Harvester;
+    h->stop = false;
+    h->intervalMs = intervalMs > 0 ? intervalMs : 1;
+    h->bytesPerSource = bytesPerSource;
+    h->thread = std::thread(harvestLoop, h);
+    harvester = h;
+    harvesting.store(true, std::memory_order_release);
+    return true;
+}
+
+void ZrtpRandom::stopHarvester() {
+    std::lock_guard<std::mutex> guard(lockHarvester);
+    Harvester* h = harvester;
+
+    if (h == NULL)
+        return;
+    harvesting.store(false, std::memory_order_release);
+    harvester = NULL;
+    {
+        std::lock_guard<std::mutex> stopGuard(h->lock);
+        h->stop = true;
+    }
+    h->wake.notify_one();
+    h->thread.join();
+    delete h;
+}
+
+bool ZrtpRandom::isHarvesting() {
+    return harvesting.load(std::memory_order_relaxed);
+}
+
+void ZrtpRandom::addEventEntropy(uint32_t eventData) {
+    if (!harvesting.load(std::memory_order_relaxed))
+        return;
+
+    // Lost updates of concurrent callers only lose some samples
+    uint64_t now = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    uint32_t index = eventCount.fetch_add(1, std::memory_order_relaxed);
+    std::atomic<uint64_t>& word = eventPool[index % eventWords];
+    uint64_t value = word.load(std::memory_order_relaxed);
+
+    word.store(((value << 7) | (value >> 57)) ^ now ^ (static_cast<uint64_t>(eventData) << 32), std::memory_order_relaxed);
+}
+
 
 void ZrtpRandom::initialize() {
     if (initialized)
         return;
 
     sha512_begin(&mainCtx);
+#if !(defined(_WIN32) || defined(_WIN64))
+    pthread_atfork(NULL, NULL, reseedAfterFork);
+#endif
     initialized = true;
 }
 
 /*
- * This works for Linux and similar systems. For other systems add
- * other functions (using #ifdef conditional compile) to get some
- * random data that we can use as seed for the internal PRNG below.
+ * Collect a seed from the entropy sources, each source contributes a part of
+ * the seed. The default source is the system random generator, see
+ * ZrtpEntropy.cpp for the system specific functions.
  */
-
 size_t ZrtpRandom::getSystemSeed(uint8_t *seed, size_t length)
 {
+    std::lock_guard<std::mutex> guard(lockSources);
+    std::vector<ZrtpEntropySource*>& list = sourceList();
     size_t num = 0;
 
-#if !(defined(_WIN32) || defined(_WIN64))
-    int rnd = open("/dev/urandom", O_RDONLY);
-    if (rnd >= 0) {
-        num = read(rnd, seed, length);
-        close(rnd);
+    for (size_t i = 0; i < list.size() && num < length; i++) {
+        size_t part = (i == list.size() - 1) ? length - num : length / list.size();
+        int32_t got = list[i]->getEntropy(seed + num, static_cast<int32_t>(part));
+        if (got > 0)
+            num += got;
     }
-    else
-        return num;
-#endif
     return num;
 }
 
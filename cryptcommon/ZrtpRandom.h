@@ -32,6 +32,30 @@
 #include <sys/types.h>
 
 #ifdef __cplusplus
+/**
+ * @brief Observes and replaces the random data of a thread.
+ *
+ * A trace recorder observes the random data that @c getRandomData generates,
+ * a trace replayer provides the recorded random data instead. Refer to
+ * ZrtpRandom::setThreadHook.
+ */
+class ZrtpRandomHook {
+public:
+    virtual ~ZrtpRandomHook() {}
+
+    /**
+     * @brief Provide the random data instead of the generator.
+     *
+     * @return true if the hook filled the buffer, false to use the generator.
+     */
+    virtual bool provideRandom(uint8_t* buffer, uint32_t length) { (void)buffer; (void)length; return false; }
+
+    /// @brief The generator filled the buffer with random data.
+    virtual void randomDrawn(const uint8_t* buffer, uint32_t length) { (void)buffer; (void)length; }
+};
+
+class ZrtpEntropySource;
+
 class ZrtpRandom {
 public:
     /**
@@ -54,12 +78,91 @@ public:
     /**
      * @brief Get some random data.
      *
+     * Each thread uses its own generator that reseeds from the shared entropy
+     * pool periodically and after @c addEntropy added application entropy.
+     * The function does not lock or read the system seed between reseeds.
+     *
      * @param buffer that will contain the random data
      * @param length how many bytes of random data to generate
      * @return the number of generated random data bytes
      */
     static int getRandomData(uint8_t *buffer, uint32_t length);
 
+    /**
+     * @brief Set the random hook of the calling thread.
+     *
+     * The @c getRandomData calls of this thread use the hook until the thread
+     * sets another hook or @c NULL. The caller owns the hook.
+     *
+     * @param hook the new hook or @c NULL
+     * @return the previous hook of this thread
+     */
+    static ZrtpRandomHook* setThreadHook(ZrtpRandomHook* hook);
+
+    /// @brief Get the random hook of the calling thread, @c NULL if not set.
+    static ZrtpRandomHook* getThreadHook();
+
+    /**
+     * @brief Add an entropy source.
+     *
+     * The generator seeds its pool from all sources, the system random
+     * generator is the default source, see ZrtpEntropy.h. The caller owns the
+     * source and must remove it before it deletes the source.
+     *
+     * @param source the entropy source
+     */
+    static void addEntropySource(ZrtpEntropySource* source);
+
+    /**
+     * @brief Remove an entropy source.
+     *
+     * After the function returns the generator does not use the source anymore.
+     * A system without a system random generator may remove the default source
+     * and add its own source.
+     *
+     * @param source the entropy source
+     */
+    static void removeEntropySource(ZrtpEntropySource* source);
+
+    /**
+     * @brief Start the background harvester.
+     *
+     * Without the harvester each reseed and each @c addEntropy call reads the
+     * entropy sources, usually a system call. The harvester thread reads the
+     * sources and the event samples of @c addEventEntropy periodically and
+     * mixes them into the pool, then the thread generators reseed from the pool
+     * without a system call. The function harvests once before it returns.
+     *
+     * @param intervalMs the harvesting interval in milliseconds
+     * @param bytesPerSource bytes that the harvester reads from each source per
+     *        interval, at most 64
+     * @return @c false if the harvester runs already
+     */
+    static bool startHarvester(uint32_t intervalMs = 1000, int32_t bytesPerSource = 32);
+
+    /**
+     * @brief Stop the background harvester.
+     *
+     * The reseeds read the entropy sources again. A forked child process has
+     * no harvester, it may start its own.
+     */
+    static void stopHarvester();
+
+    /// @brief Check if the background harvester runs.
+    static bool isHarvesting();
+
+    /**
+     * @brief Add the timing of an event as entropy.
+     *
+     * The function stores a sample of a high resolution clock and the event
+     * data without a lock or a system call, the harvester mixes the samples
+     * into the pool. Without the harvester the function does nothing, thus the
+     * packet path may call it for each packet.
+     *
+     * @param eventData some data of the event, for example the packet length
+     */
+    static void addEventEntropy(uint32_t eventData);
+
 private:
     static void initialize();
     static size_t getSystemSeed(uint8_t *seed, size_t length);
@@ -0,0 +1,461 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Constant time bitsliced AES encryption.
+ *
+ * The bitsliced representation follows the 64 bit layout of Thomas Pornin's
+ * BearSSL "ct64" AES: eight words hold four blocks, word i holds bit i of all
+ * bytes, the bits of the four blocks are interleaved. The S-box is the Boyar
+ * and Peralta circuit of 113 logic operations, ShiftRows and MixColumns are
+ * shifts and rotations within the words.
+ *
+ * All operations of a round act on each 64 bit word on its own. With a vector
+ * type of two 64 bit lanes the same code processes two groups of four blocks,
+ * the compiler emits SSE2 or NEON instructions for the vector operations.
+ */
+
+#include <string.h>
+
+#include "aes_ct.h"
+#include "brg_endian.h"
+
+/* The round keys of the key schedule must be in memory in AES byte order */
+#if !defined(AES_NO_CT) && PLATFORM_BYTE_ORDER == IS_LITTLE_ENDIAN
+#define AES_CT_SUPPORTED
+#endif
+
+#if defined(AES_CT_SUPPORTED)
+
+#if AES_CT_BLOCKS == 8
+typedef uint64_t ct_word __attribute__((vector_size(16)));
+#else
+typedef uint64_t ct_word;
+#endif
+
+/* Number of 64 bit lanes of a word, each lane holds four blocks */
+#define CT_LANES    (AES_CT_BLOCKS / 4)
+
+static uint32_t dec32le(const unsigned char *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void enc32le(unsigned char *p, uint32_t x)
+{
+    p[0] = (unsigned char)x;
+    p[1] = (unsigned char)(x >> 8);
+    p[2] = (unsigned char)(x >> 16);
+    p[3] = (unsigned char)(x >> 24);
+}
+
+/* Spread the 16 bytes of a block to the even bytes of two 64 bit words */
+static void interleave_in(uint64_t *q0, uint64_t *q1, const uint32_t *w)
+{
+    uint64_t x0 = w[0], x1 = w[1], x2 = w[2], x3 = w[3];
+
+    x0 |= (x0 << 16);
+    x1 |= (x1 << 16);
+    x2 |= (x2 << 16);
+    x3 |= (x3 << 16);
+    x0 &= (uint64_t)0x0000FFFF0000FFFF;
+    x1 &= (uint64_t)0x0000FFFF0000FFFF;
+    x2 &= (uint64_t)0x0000FFFF0000FFFF;
+    x3 &= (uint64_t)0x0000FFFF0000FFFF;
+    x0 |= (x0 << 8);
+    x1 |= (x1 << 8);
+    x2 |= (x2 << 8);
+    x3 |= (x3 << 8);
+    x0 &= (uint64_t)0x00FF00FF00FF00FF;
+    x1 &= (uint64_t)0x00FF00FF00FF00FF;
+    x2 &= (uint64_t)0x00FF00FF00FF00FF;
+    x3 &= (uint64_t)0x00FF00FF00FF00FF;
+    *q0 = x0 | (x2 << 8);
+    *q1 = x1 | (x3 << 8);
+}
+
+/* The reverse of interleave_in */
+static void interleave_out(uint32_t *w, uint64_t q0, uint64_t q1)
+{
+    uint64_t x0, x1, x2, x3;
+
+    x0 = q0 & (uint64_t)0x00FF00FF00FF00FF;
+    x1 = q1 & (uint64_t)0x00FF00FF00FF00FF;
+    x2 = (q0 >> 8) & (uint64_t)0x00FF00FF00FF00FF;
+    x3 = (q1 >> 8) & (uint64_t)0x00FF00FF00FF00FF;
+    x0 |= (x0 >> 8);
+    x1 |= (x1 >> 8);
+    x2 |= (x2 >> 8);
+    x3 |= (x3 >> 8);
+    x0 &= (uint64_t)0x0000FFFF0000FFFF;
+    x1 &= (uint64_t)0x0000FFFF0000FFFF;
+    x2 &= (uint64_t)0x0000FFFF0000FFFF;
+    x3 &= (uint64_t)0x0000FFFF0000FFFF;
+    w[0] = (uint32_t)x0 | (uint32_t)(x0 >> 16);
+    w[1] = (uint32_t)x1 | (uint32_t)(x1 >> 16);
+    w[2] = (uint32_t)x2 | (uint32_t)(x2 >> 16);
+    w[3] = (uint32_t)x3 | (uint32_t)(x3 >> 16);
+}
+
+/*
+ * Transpose the bits of eight words: afterwards word i holds bit i of all
+ * bytes. The transposition is its own inverse. A macro because the round keys
+ * use plain 64 bit words and the data uses ct_word.
+ */
+#define SWAPN(cl, ch, s, x, y) do { \
+        ct_type a = (x), b = (y); \
+        (x) = (a & (uint64_t)(cl)) | ((b & (uint64_t)(cl)) << (s)); \
+        (y) = ((a & (uint64_t)(ch)) >> (s)) | (b & (uint64_t)(ch)); \
+    } while (0)
+
+#define SWAP2(x, y) SWAPN(0x5555555555555555, 0xAAAAAAAAAAAAAAAA, 1, x, y)
+#define SWAP4(x, y) SWAPN(0x3333333333333333, 0xCCCCCCCCCCCCCCCC, 2, x, y)
+#define SWAP8(x, y) SWAPN(0x0F0F0F0F0F0F0F0F, 0xF0F0F0F0F0F0F0F0, 4, x, y)
+
+#define ORTHO(q) do { \
+        SWAP2(q[0], q[1]); SWAP2(q[2], q[3]); SWAP2(q[4], q[5]); SWAP2(q[6], q[7]); \
+        SWAP4(q[0], q[2]); SWAP4(q[1], q[3]); SWAP4(q[4], q[6]); SWAP4(q[5], q[7]); \
+        SWAP8(q[0], q[4]); SWAP8(q[1], q[5]); SWAP8(q[2], q[6]); SWAP8(q[3], q[7]); \
+    } while (0)
+
+static void key_ortho(uint64_t q[8])
+{
+    typedef uint64_t ct_type;
+    ORTHO(q);
+}
+
+static void ct_ortho(ct_word q[8])
+{
+    typedef ct_word ct_type;
+    ORTHO(q);
+}
+
+/* The AES S-box of all bytes, Boyar and Peralta circuit */
+static void ct_sbox(ct_word q[8])
+{
+    ct_word x0, x1, x2, x3, x4, x5, x6, x7;
+    ct_word y1, y2, y3, y4, y5, y6, y7, y8, y9;
+    ct_word y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+    ct_word y20, y21;
+    ct_word z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+    ct_word z10, z11, z12, z13, z14, z15, z16, z17;
+    ct_word t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+    ct_word t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+    ct_word t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+    ct_word t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+    ct_word t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+    ct_word t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+    ct_word t60, t61, t62, t63, t64, t65, t66, t67;
+    ct_word s0, s1, s2, s3, s4, s5, s6, s7;
+
+    x0 = q[7];
+    x1 = q[6];
+    x2 = q[5];
+    x3 = q[4];
+    x4 = q[3];
+    x5 = q[2];
+    x6 = q[1];
+    x7 = q[0];
+
+    /* Top linear transformation */
+    y14 = x3 ^ x5;
+    y13 = x0 ^ x6;
+    y9 = x0 ^ x3;
+    y8 = x0 ^ x5;
+    t0 = x1 ^ x2;
+    y1 = t0 ^ x7;
+    y4 = y1 ^ x3;
+    y12 = y13 ^ y14;
+    y2 = y1 ^ x0;
+    y5 = y1 ^ x6;
+    y3 = y5 ^ y8;
+    t1 = x4 ^ y12;
+    y15 = t1 ^ x5;
+    y20 = t1 ^ x1;
+    y6 = y15 ^ x7;
+    y10 = y15 ^ t0;
+    y11 = y20 ^ y9;
+    y7 = x7 ^ y11;
+    y17 = y10 ^ y11;
+    y19 = y10 ^ y8;
+    y16 = t0 ^ y11;
+    y21 = y13 ^ y16;
+    y18 = x0 ^ y16;
+
+    /* Non-linear section */
+    t2 = y12 & y15;
+    t3 = y3 & y6;
+    t4 = t3 ^ t2;
+    t5 = y4 & x7;
+    t6 = t5 ^ t2;
+    t7 = y13 & y16;
+    t8 = y5 & y1;
+    t9 = t8 ^ t7;
+    t10 = y2 & y7;
+    t11 = t10 ^ t7;
+    t12 = y9 & y11;
+    t13 = y14 & y17;
+    t14 = t13 ^ t12;
+    t15 = y8 & y10;
+    t16 = t15 ^ t12;
+    t17 = t4 ^ t14;
+    t18 = t6 ^ t16;
+    t19 = t9 ^ t14;
+    t20 = t11 ^ t16;
+    t21 = t17 ^ y20;
+    t22 = t18 ^ y19;
+    t23 = t19 ^ y21;
+    t24 = t20 ^ y18;
+
+    t25 = t21 ^ t22;
+    t26 = t21 & t23;
+    t27 = t24 ^ t26;
+    t28 = t25 & t27;
+    t29 = t28 ^ t22;
+    t30 = t23 ^ t24;
+    t31 = t22 ^ t26;
+    t32 = t31 & t30;
+    t33 = t32 ^ t24;
+    t34 = t23 ^ t33;
+    t35 = t27 ^ t33;
+    t36 = t24 & t35;
+    t37 = t36 ^ t34;
+    t38 = t27 ^ t36;
+    t39 = t29 & t38;
+    t40 = t25 ^ t39;
+
+    t41 = t40 ^ t37;
+    t42 = t29 ^ t33;
+    t43 = t29 ^ t40;
+    t44 = t33 ^ t37;
+    t45 = t42 ^ t41;
+    z0 = t44 & y15;
+    z1 = t37 & y6;
+    z2 = t33 & x7;
+    z3 = t43 & y16;
+    z4 = t40 & y1;
+    z5 = t29 & y7;
+    z6 = t42 & y11;
+    z7 = t45 & y17;
+    z8 = t41 & y10;
+    z9 = t44 & y12;
+    z10 = t37 & y3;
+    z11 = t33 & y4;
+    z12 = t43 & y13;
+    z13 = t40 & y5;
+    z14 = t29 & y2;
+    z15 = t42 & y9;
+    z16 = t45 & y14;
+    z17 = t41 & y8;
+
+    /* Bottom linear transformation */
+    t46 = z15 ^ z16;
+    t47 = z10 ^ z11;
+    t48 = z5 ^ z13;
+    t49 = z9 ^ z10;
+    t50 = z2 ^ z12;
+    t51 = z2 ^ z5;
+    t52 = z7 ^ z8;
+    t53 = z0 ^ z3;
+    t54 = z6 ^ z7;
+    t55 = z16 ^ z17;
+    t56 = z12 ^ t48;
+    t57 = t50 ^ t53;
+    t58 = z4 ^ t46;
+    t59 = z3 ^ t54;
+    t60 = t46 ^ t57;
+    t61 = z14 ^ t57;
+    t62 = t52 ^ t58;
+    t63 = t49 ^ t58;
+    t64 = z4 ^ t59;
+    t65 = t61 ^ t62;
+    t66 = z1 ^ t63;
+    s0 = t59 ^ t63;
+    s6 = t56 ^ ~t62;
+    s7 = t48 ^ ~t60;
+    t67 = t64 ^ t65;
+    s3 = t53 ^ t66;
+    s4 = t51 ^ t66;
+    s5 = t47 ^ t65;
+    s1 = t64 ^ ~s3;
+    s2 = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+static void add_round_key(ct_word q[8], const uint64_t *sk)
+{
+    int i;
+
+    for (i = 0; i < 8; i++)
+        q[i] ^= sk[i];
+}
+
+static void shift_rows(ct_word q[8])
+{
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        ct_word x = q[i];
+
+        q[i] = (x & (uint64_t)0x000000000000FFFF)
+            | ((x & (uint64_t)0x00000000FFF00000) >> 4)
+            | ((x & (uint64_t)0x00000000000F0000) << 12)
+            | ((x & (uint64_t)0x0000FF0000000000) >> 8)
+            | ((x & (uint64_t)0x000000FF00000000) << 8)
+            | ((x & (uint64_t)0xF000000000000000) >> 12)
+            | ((x & (uint64_t)0x0FFF000000000000) << 4);
+    }
+}
+
+#define ROTR32(x)   (((x) << 32) | ((x) >> 32))
+#define ROTR16(x)   (((x) >> 16) | ((x) << 48))
+
+static void mix_columns(ct_word q[8])
+{
+    ct_word q0, q1, q2, q3, q4, q5, q6, q7;
+    ct_word r0, r1, r2, r3, r4, r5, r6, r7;
+
+    q0 = q[0];
+    q1 = q[1];
+    q2 = q[2];
+    q3 = q[3];
+    q4 = q[4];
+    q5 = q[5];
+    q6 = q[6];
+    q7 = q[7];
+    r0 = ROTR16(q0);
+    r1 = ROTR16(q1);
+    r2 = ROTR16(q2);
+    r3 = ROTR16(q3);
+    r4 = ROTR16(q4);
+    r5 = ROTR16(q5);
+    r6 = ROTR16(q6);
+    r7 = ROTR16(q7);
+
+    q[0] = q7 ^ r7 ^ r0 ^ ROTR32(q0 ^ r0);
+    q[1] = q0 ^ r0 ^ q7 ^ r7 ^ r1 ^ ROTR32(q1 ^ r1);
+    q[2] = q1 ^ r1 ^ r2 ^ ROTR32(q2 ^ r2);
+    q[3] = q2 ^ r2 ^ q7 ^ r7 ^ r3 ^ ROTR32(q3 ^ r3);
+    q[4] = q3 ^ r3 ^ q7 ^ r7 ^ r4 ^ ROTR32(q4 ^ r4);
+    q[5] = q4 ^ r4 ^ r5 ^ ROTR32(q5 ^ r5);
+    q[6] = q5 ^ r5 ^ r6 ^ ROTR32(q6 ^ r6);
+    q[7] = q6 ^ r6 ^ r7 ^ ROTR32(q7 ^ r7);
+}
+
+/* Encrypt up to AES_CT_BLOCKS blocks */
+static void encrypt_pass(const unsigned char *in, unsigned char *out, int nb, const aes_ct_ctx *ct)
+{
+    uint64_t w[8][CT_LANES];
+    ct_word q[8];
+    uint32_t x[4];
+    int b, j, u;
+
+    /* block b goes to lane b / 4 of the words b % 4 and b % 4 + 4 */
+    memset(w, 0, sizeof(w));
+    for (b = 0; b < nb; b++) {
+        for (j = 0; j < 4; j++)
+            x[j] = dec32le(in + 16 * b + 4 * j);
+        interleave_in(&w[b & 3][b >> 2], &w[(b & 3) + 4][b >> 2], x);
+    }
+    memcpy(q, w, sizeof(q));
+    ct_ortho(q);
+
+    add_round_key(q, ct->sk);
+    for (u = 1; u < ct->rounds; u++) {
+        ct_sbox(q);
+        shift_rows(q);
+        mix_columns(q);
+        add_round_key(q, ct->sk + (u << 3));
+    }
+    ct_sbox(q);
+    shift_rows(q);
+    add_round_key(q, ct->sk + (ct->rounds << 3));
+
+    ct_ortho(q);
+    memcpy(w, q, sizeof(w));
+    for (b = 0; b < nb; b++) {
+        interleave_out(x, w[b & 3][b >> 2], w[(b & 3) + 4][b >> 2]);
+        for (j = 0; j < 4; j++)
+            enc32le(out + 16 * b + 4 * j, x[j]);
+    }
+}
+
+int aes_ct_available(void)
+{
+    return 1;
+}
+
+void aes_ct_key(aes_ct_ctx ct[1], const aes_encrypt_ctx cx[1])
+{
+    const unsigned char *ks = (const unsigned char *)cx->ks;
+    uint64_t q[8];
+    uint32_t x[4];
+    int r, j;
+
+    /* Number of rounds is stored in the context as rounds * 16, see aeskey.c */
+    ct->rounds = cx->inf.b[0] >> 4;
+
+    /* The same round key for all four blocks of a word */
+    for (r = 0; r <= ct->rounds; r++) {
+        for (j = 0; j < 4; j++)
+            x[j] = dec32le(ks + 16 * r + 4 * j);
+        interleave_in(&q[0], &q[4], x);
+        q[1] = q[2] = q[3] = q[0];
+        q[5] = q[6] = q[7] = q[4];
+        key_ortho(q);
+        memcpy(ct->sk + 8 * r, q, sizeof(q));
+    }
+    memset(q, 0, sizeof(q));
+    memset(x, 0, sizeof(x));
+}
+
+void aes_ct_ecb_encrypt(const unsigned char *in, unsigned char *out, int nb, const aes_ct_ctx ct[1])
+{
+    while (nb > 0) {
+        int n = (nb < AES_CT_BLOCKS) ? nb : AES_CT_BLOCKS;
+
+        encrypt_pass(in, out, n, ct);
+        in += n * AES_BLOCK_SIZE;
+        out += n * AES_BLOCK_SIZE;
+        nb -= n;
+    }
+}
+
+#else
+
+int aes_ct_available(void)
+{
+    return 0;
+}
+
+void aes_ct_key(aes_ct_ctx ct[1], const aes_encrypt_ctx cx[1])
+{
+    memset(ct, 0, sizeof(aes_ct_ctx));
+}
+
+void aes_ct_ecb_encrypt(const unsigned char *in, unsigned char *out, int nb, const aes_ct_ctx ct[1])
+{
+}
+
+#endif
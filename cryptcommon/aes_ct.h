@@ -0,0 +1,104 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _AES_CT_H
+#define _AES_CT_H
+
+/**
+ * @file aes_ct.h
+ * @brief Constant time bitsliced AES encryption for CPUs without hardware AES
+ *
+ * The table driven AES of @c aescrypt.c reads its tables at addresses that
+ * depend on the key and the data, thus its timing depends on the cache. CPUs
+ * without AES instructions, for example ARMv7 or older x86 CPUs, use these
+ * functions for the SRTP counter mode instead. The functions compute the
+ * S-box with logic operations on bitsliced data and do not access memory at
+ * secret dependent addresses.
+ *
+ * A bitsliced round processes four blocks in 64 bit words. If the compiler
+ * supports vector types (GCC and clang) the functions use 128 bit vectors,
+ * SSE2 on x86 and NEON on ARM, and process eight blocks per round.
+ *
+ * The functions convert the round keys of an @c aes_encrypt_ctx into the
+ * bitsliced form once, the caller keeps them in an @c aes_ct_ctx. Define
+ * @c AES_NO_CT to disable the functions at compile time.
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include "aes.h"
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/** Number of blocks that one bitsliced pass encrypts */
+#if !defined(AES_NO_CT) && (defined(__GNUC__) || defined(__clang__))
+#define AES_CT_BLOCKS 8
+#else
+#define AES_CT_BLOCKS 4
+#endif
+
+/**
+ * @brief The bitsliced round keys.
+ */
+typedef struct _aes_ct_ctx {
+    uint64_t sk[(14 + 1) * 8];      //!< eight words per round key
+    int rounds;                     //!< number of rounds, 10, 12 or 14
+} aes_ct_ctx;
+
+/**
+ * @brief Check if the bitsliced AES is available.
+ *
+ * The functions need the key schedule in little endian byte order, see
+ * aes_hw.c, and are not available if @c AES_NO_CT is defined.
+ *
+ * @return 1 if the functions are available, 0 otherwise
+ */
+int aes_ct_available(void);
+
+/**
+ * @brief Compute the bitsliced round keys.
+ *
+ * @param ct receives the bitsliced round keys
+ * @param cx the AES encryption context, initialized by one of the @c aes_encrypt_key* functions
+ */
+void aes_ct_key(aes_ct_ctx ct[1], const aes_encrypt_ctx cx[1]);
+
+/**
+ * @brief Encrypt several blocks with the bitsliced AES.
+ *
+ * The function encrypts @c AES_CT_BLOCKS blocks per pass, a partial pass
+ * takes the same time as a full pass.
+ *
+ * @param in the input blocks
+ * @param out the output blocks, may be the same as @c in
+ * @param nb number of 16 byte blocks to encrypt
+ * @param ct the bitsliced round keys, see @c aes_ct_key
+ */
+void aes_ct_ecb_encrypt(const unsigned char *in, unsigned char *out, int nb, const aes_ct_ctx ct[1]);
+
+#if defined(__cplusplus)
+}
+#endif
+
+/**
+ * @}
+ */
+#endif
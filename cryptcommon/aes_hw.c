@@ -0,0 +1,301 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Hardware AES for x86 (AES-NI) and AArch64 (ARMv8 Crypto Extensions).
+ *
+ * The standard key setup functions store the round keys as 32 bit words in
+ * little endian byte order, thus on little endian CPUs the key schedule
+ * memory has the same layout as the AES round keys that the AES instructions
+ * expect. The functions use the target attribute to enable the instructions
+ * only for the functions that use them. Thus the file does not need special
+ * compiler flags and the library still runs on CPUs without hardware AES.
+ */
+
+#include "aes_hw.h"
+
+#include <common/cpuFeatures.h>
+
+#if !defined(AES_NO_HW) && (defined(__GNUC__) || defined(__clang__))
+#  if defined(__x86_64__) || defined(__i386__)
+#    define AES_HW_X86
+#  elif defined(__aarch64__) && !defined(__AARCH64EB__) && (defined(__clang__) || __GNUC__ >= 6)
+#    define AES_HW_ARM
+#  endif
+#endif
+
+/* Number of rounds is stored in the context as rounds * 16, see aeskey.c */
+#define AES_ROUNDS(cx)  ((cx)->inf.b[0] >> 4)
+
+#if defined(AES_HW_X86) || defined(AES_HW_ARM)
+
+/* All keys must use the same number of rounds, see aes_hw_encrypt_lanes */
+static int sameRounds(int nb, const aes_encrypt_ctx *cx[])
+{
+    int i;
+
+    for (i = 1; i < nb; i++) {
+        if (AES_ROUNDS(cx[i]) != AES_ROUNDS(cx[0]))
+            return 0;
+    }
+    return 1;
+}
+
+#endif
+
+#if defined(AES_HW_X86)
+
+#include <wmmintrin.h>
+#include <emmintrin.h>
+
+#define AES_HW_TARGET __attribute__((target("aes,sse2")))
+
+static int checkCpu(void)
+{
+    return (zrtpCpuFeatures() & ZRTP_CPU_AES) ? 1 : 0;
+}
+
+AES_HW_TARGET
+void aes_hw_encrypt(const unsigned char *in, unsigned char *out, const aes_encrypt_ctx cx[1])
+{
+    const __m128i *rk = (const __m128i*)cx->ks;
+    int rounds = AES_ROUNDS(cx);
+    int i;
+
+    __m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i*)in), _mm_loadu_si128(rk));
+    for (i = 1; i < rounds; i++)
+        s = _mm_aesenc_si128(s, _mm_loadu_si128(rk + i));
+    s = _mm_aesenclast_si128(s, _mm_loadu_si128(rk + rounds));
+    _mm_storeu_si128((__m128i*)out, s);
+}
+
+AES_HW_TARGET
+void aes_hw_ecb_encrypt(const unsigned char *in, unsigned char *out, int nb, const aes_encrypt_ctx cx[1])
+{
+    const __m128i *rk = (const __m128i*)cx->ks;
+    int rounds = AES_ROUNDS(cx);
+    int i;
+
+    for (; nb >= 4; nb -= 4, in += 4 * AES_BLOCK_SIZE, out += 4 * AES_BLOCK_SIZE) {
+        __m128i k = _mm_loadu_si128(rk);
+        __m128i s0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)in), k);
+        __m128i s1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(in + 16)), k);
+        __m128i s2 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(in + 32)), k);
+        __m128i s3 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(in + 48)), k);
+
+        for (i = 1; i < rounds; i++) {
+            k = _mm_loadu_si128(rk + i);
+            s0 = _mm_aesenc_si128(s0, k);
+            s1 = _mm_aesenc_si128(s1, k);
+            s2 = _mm_aesenc_si128(s2, k);
+            s3 = _mm_aesenc_si128(s3, k);
+        }
+        k = _mm_loadu_si128(rk + rounds);
+        _mm_storeu_si128((__m128i*)out, _mm_aesenclast_si128(s0, k));
+        _mm_storeu_si128((__m128i*)(out + 16), _mm_aesenclast_si128(s1, k));
+        _mm_storeu_si128((__m128i*)(out + 32), _mm_aesenclast_si128(s2, k));
+        _mm_storeu_si128((__m128i*)(out + 48), _mm_aesenclast_si128(s3, k));
+    }
+    for (; nb > 0; nb--, in += AES_BLOCK_SIZE, out += AES_BLOCK_SIZE)
+        aes_hw_encrypt(in, out, cx);
+}
+
+AES_HW_TARGET
+void aes_hw_encrypt_lanes(const unsigned char *in, unsigned char *out, int nb, const aes_encrypt_ctx *cx[])
+{
+    int rounds, i;
+
+    if (nb <= 0)
+        return;
+    if (!sameRounds(nb, cx)) {
+        for (; nb > 0; nb--, in += AES_BLOCK_SIZE, out += AES_BLOCK_SIZE, cx++)
+            aes_hw_encrypt(in, out, cx[0]);
+        return;
+    }
+    rounds = AES_ROUNDS(cx[0]);
+
+    /* Same interleaving as aes_hw_ecb_encrypt, but each block has its round keys */
+    for (; nb >= 4; nb -= 4, in += 4 * AES_BLOCK_SIZE, out += 4 * AES_BLOCK_SIZE, cx += 4) {
+        const __m128i *rk0 = (const __m128i*)cx[0]->ks;
+        const __m128i *rk1 = (const __m128i*)cx[1]->ks;
+        const __m128i *rk2 = (const __m128i*)cx[2]->ks;
+        const __m128i *rk3 = (const __m128i*)cx[3]->ks;
+        __m128i s0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)in), _mm_loadu_si128(rk0));
+        __m128i s1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(in + 16)), _mm_loadu_si128(rk1));
+        __m128i s2 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(in + 32)), _mm_loadu_si128(rk2));
+        __m128i s3 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(in + 48)), _mm_loadu_si128(rk3));
+
+        for (i = 1; i < rounds; i++) {
+            s0 = _mm_aesenc_si128(s0, _mm_loadu_si128(rk0 + i));
+            s1 = _mm_aesenc_si128(s1, _mm_loadu_si128(rk1 + i));
+            s2 = _mm_aesenc_si128(s2, _mm_loadu_si128(rk2 + i));
+            s3 = _mm_aesenc_si128(s3, _mm_loadu_si128(rk3 + i));
+        }
+        _mm_storeu_si128((__m128i*)out, _mm_aesenclast_si128(s0, _mm_loadu_si128(rk0 + rounds)));
+        _mm_storeu_si128((__m128i*)(out + 16), _mm_aesenclast_si128(s1, _mm_loadu_si128(rk1 + rounds)));
+        _mm_storeu_si128((__m128i*)(out + 32), _mm_aesenclast_si128(s2, _mm_loadu_si128(rk2 + rounds)));
+        _mm_storeu_si128((__m128i*)(out + 48), _mm_aesenclast_si128(s3, _mm_loadu_si128(rk3 + rounds)));
+    }
+    for (; nb > 0; nb--, in += AES_BLOCK_SIZE, out += AES_BLOCK_SIZE, cx++)
+        aes_hw_encrypt(in, out, cx[0]);
+}
+
+#elif defined(AES_HW_ARM)
+
+#include <arm_neon.h>
+
+#if defined(__clang__)
+#  define AES_HW_TARGET __attribute__((target("crypto")))
+#else
+#  define AES_HW_TARGET __attribute__((target("+crypto")))
+#endif
+
+static int checkCpu(void)
+{
+    return (zrtpCpuFeatures() & ZRTP_CPU_AES) ? 1 : 0;
+}
+
+AES_HW_TARGET
+void aes_hw_encrypt(const unsigned char *in, unsigned char *out, const aes_encrypt_ctx cx[1])
+{
+    const uint8_t *rk = (const uint8_t*)cx->ks;
+    int rounds = AES_ROUNDS(cx);
+    int i;
+
+    uint8x16_t s = vld1q_u8(in);
+    for (i = 0; i < rounds - 1; i++)
+        s = vaesmcq_u8(vaeseq_u8(s, vld1q_u8(rk + i * AES_BLOCK_SIZE)));
+    s = vaeseq_u8(s, vld1q_u8(rk + (rounds - 1) * AES_BLOCK_SIZE));
+    s = veorq_u8(s, vld1q_u8(rk + rounds * AES_BLOCK_SIZE));
+    vst1q_u8(out, s);
+}
+
+AES_HW_TARGET
+void aes_hw_ecb_encrypt(const unsigned char *in, unsigned char *out, int nb, const aes_encrypt_ctx cx[1])
+{
+    const uint8_t *rk = (const uint8_t*)cx->ks;
+    int rounds = AES_ROUNDS(cx);
+    int i;
+
+    for (; nb >= 4; nb -= 4, in += 4 * AES_BLOCK_SIZE, out += 4 * AES_BLOCK_SIZE) {
+        uint8x16_t k;
+        uint8x16_t s0 = vld1q_u8(in);
+        uint8x16_t s1 = vld1q_u8(in + 16);
+        uint8x16_t s2 = vld1q_u8(in + 32);
+        uint8x16_t s3 = vld1q_u8(in + 48);
+
+        for (i = 0; i < rounds - 1; i++) {
+            k = vld1q_u8(rk + i * AES_BLOCK_SIZE);
+            s0 = vaesmcq_u8(vaeseq_u8(s0, k));
+            s1 = vaesmcq_u8(vaeseq_u8(s1, k));
+            s2 = vaesmcq_u8(vaeseq_u8(s2, k));
+            s3 = vaesmcq_u8(vaeseq_u8(s3, k));
+        }
+        k = vld1q_u8(rk + (rounds - 1) * AES_BLOCK_SIZE);
+        s0 = vaeseq_u8(s0, k);
+        s1 = vaeseq_u8(s1, k);
+        s2 = vaeseq_u8(s2, k);
+        s3 = vaeseq_u8(s3, k);
+
+        k = vld1q_u8(rk + rounds * AES_BLOCK_SIZE);
+        vst1q_u8(out, veorq_u8(s0, k));
+        vst1q_u8(out + 16, veorq_u8(s1, k));
+        vst1q_u8(out + 32, veorq_u8(s2, k));
+        vst1q_u8(out + 48, veorq_u8(s3, k));
+    }
+    for (; nb > 0; nb--, in += AES_BLOCK_SIZE, out += AES_BLOCK_SIZE)
+        aes_hw_encrypt(in, out, cx);
+}
+
+AES_HW_TARGET
+void aes_hw_encrypt_lanes(const unsigned char *in, unsigned char *out, int nb, const aes_encrypt_ctx *cx[])
+{
+    int rounds, i;
+
+    if (nb <= 0)
+        return;
+    if (!sameRounds(nb, cx)) {
+        for (; nb > 0; nb--, in += AES_BLOCK_SIZE, out += AES_BLOCK_SIZE, cx++)
+            aes_hw_encrypt(in, out, cx[0]);
+        return;
+    }
+    rounds = AES_ROUNDS(cx[0]);
+
+    /* Same interleaving as aes_hw_ecb_encrypt, but each block has its round keys */
+    for (; nb >= 4; nb -= 4, in += 4 * AES_BLOCK_SIZE, out += 4 * AES_BLOCK_SIZE, cx += 4) {
+        const uint8_t *rk0 = (const uint8_t*)cx[0]->ks;
+        const uint8_t *rk1 = (const uint8_t*)cx[1]->ks;
+        const uint8_t *rk2 = (const uint8_t*)cx[2]->ks;
+        const uint8_t *rk3 = (const uint8_t*)cx[3]->ks;
+        uint8x16_t s0 = vld1q_u8(in);
+        uint8x16_t s1 = vld1q_u8(in + 16);
+        uint8x16_t s2 = vld1q_u8(in + 32);
+        uint8x16_t s3 = vld1q_u8(in + 48);
+
+        for (i = 0; i < rounds - 1; i++) {
+            s0 = vaesmcq_u8(vaeseq_u8(s0, vld1q_u8(rk0 + i * AES_BLOCK_SIZE)));
+            s1 = vaesmcq_u8(vaeseq_u8(s1, vld1q_u8(rk1 + i * AES_BLOCK_SIZE)));
+            s2 = vaesmcq_u8(vaeseq_u8(s2, vld1q_u8(rk2 + i * AES_BLOCK_SIZE)));
+            s3 = vaesmcq_u8(vaeseq_u8(s3, vld1q_u8(rk3 + i * AES_BLOCK_SIZE)));
+        }
+        i = (rounds - 1) * AES_BLOCK_SIZE;
+        s0 = vaeseq_u8(s0, vld1q_u8(rk0 + i));
+        s1 = vaeseq_u8(s1, vld1q_u8(rk1 + i));
+        s2 = vaeseq_u8(s2, vld1q_u8(rk2 + i));
+        s3 = vaeseq_u8(s3, vld1q_u8(rk3 + i));
+
+        i = rounds * AES_BLOCK_SIZE;
+        vst1q_u8(out, veorq_u8(s0, vld1q_u8(rk0 + i)));
+        vst1q_u8(out + 16, veorq_u8(s1, vld1q_u8(rk1 + i)));
+        vst1q_u8(out + 32, veorq_u8(s2, vld1q_u8(rk2 + i)));
+        vst1q_u8(out + 48, veorq_u8(s3, vld1q_u8(rk3 + i)));
+    }
+    for (; nb > 0; nb--, in += AES_BLOCK_SIZE, out += AES_BLOCK_SIZE, cx++)
+        aes_hw_encrypt(in, out, cx[0]);
+}
+
+#else
+
+static int checkCpu(void)
+{
+    return 0;
+}
+
+void aes_hw_encrypt(const unsigned char *in, unsigned char *out, const aes_encrypt_ctx cx[1])
+{
+    aes_encrypt(in, out, cx);
+}
+
+void aes_hw_ecb_encrypt(const unsigned char *in, unsigned char *out, int nb, const aes_encrypt_ctx cx[1])
+{
+    for (; nb > 0; nb--, in += AES_BLOCK_SIZE, out += AES_BLOCK_SIZE)
+        aes_encrypt(in, out, cx);
+}
+
+void aes_hw_encrypt_lanes(const unsigned char *in, unsigned char *out, int nb, const aes_encrypt_ctx *cx[])
+{
+    int j;
+
+    for (j = 0; j < nb; j++)
+        aes_encrypt(in + j * AES_BLOCK_SIZE, out + j * AES_BLOCK_SIZE, cx[j]);
+}
+
+#endif
+
+int aes_hw_available(void)
+{
+    return checkCpu();
+}
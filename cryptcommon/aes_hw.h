@@ -0,0 +1,104 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _AES_HW_H
+#define _AES_HW_H
+
+/**
+ * @file aes_hw.h
+ * @brief Hardware AES encryption for the standalone AES implementation
+ *
+ * The functions use the AES-NI instructions on x86 and the ARMv8 Crypto
+ * Extensions on AArch64. The functions use the encryption key schedule that
+ * the standard @c aes_encrypt_key* functions computed, thus the existing key
+ * setup, the @c aes_encrypt_ctx structure and the @c AESencrypt class stay
+ * unchanged. The standard @c aes_encrypt and @c aes_ecb_encrypt functions
+ * dispatch to the functions at runtime if the CPU supports the instructions.
+ *
+ * Define @c AES_NO_HW to disable the hardware support at compile time.
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include "aes.h"
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/**
+ * @brief Check if the CPU supports hardware AES.
+ *
+ * The function checks the CPU features only once and caches the result.
+ *
+ * @return 1 if hardware AES is available, 0 otherwise
+ */
+int aes_hw_available(void);
+
+/**
+ * @brief Encrypt one block with hardware AES.
+ *
+ * Call this function only if @c aes_hw_available() returned 1.
+ *
+ * @param in the 16 byte input block
+ * @param out the 16 byte output block
+ * @param cx the AES encryption context, initialized by one of the @c aes_encrypt_key* functions
+ */
+void aes_hw_encrypt(const unsigned char *in, unsigned char *out, const aes_encrypt_ctx cx[1]);
+
+/**
+ * @brief Encrypt several blocks with hardware AES.
+ *
+ * The function encrypts four blocks in parallel to keep the AES pipeline of
+ * the CPU busy. Call this function only if @c aes_hw_available() returned 1.
+ *
+ * @param in the input blocks
+ * @param out the output blocks
+ * @param nb number of 16 byte blocks to encrypt
+ * @param cx the AES encryption context, initialized by one of the @c aes_encrypt_key* functions
+ */
+void aes_hw_ecb_encrypt(const unsigned char *in, unsigned char *out, int nb, const aes_encrypt_ctx cx[1]);
+
+/** Number of blocks per call of @c aes_hw_encrypt_lanes that keeps the AES pipeline busy */
+#define AES_HW_LANES 8
+
+/**
+ * @brief Encrypt blocks of independent keys with hardware AES.
+ *
+ * The function encrypts block @c i with the key of @c cx[i] and runs the
+ * rounds of four blocks interleaved. Thus it keeps the AES pipeline busy even
+ * if each key has only a few blocks to encrypt, for example a batch of short
+ * SRTP packets of different streams. If the keys use different key lengths
+ * the function encrypts the blocks one after the other. Call this function
+ * only if @c aes_hw_available() returned 1.
+ *
+ * @param in the input blocks, one per key
+ * @param out the output blocks
+ * @param nb number of 16 byte blocks to encrypt
+ * @param cx the AES encryption contexts, one per block
+ */
+void aes_hw_encrypt_lanes(const unsigned char *in, unsigned char *out, int nb, const aes_encrypt_ctx *cx[]);
+
+#if defined(__cplusplus)
+}
+#endif
+
+/**
+ * @}
+ */
+#endif
@@ -29,6 +29,7 @@ Issue Date: 20/12/2007
 #include <assert.h>
 
 #include "aesopt.h"
+#include "aes_hw.h"
 
 #if defined( AES_MODES )
 #if defined(__cplusplus)
@@ -140,6 +141,13 @@ AES_RETURN aes_ecb_encrypt(const unsigned char *ibuf, unsigned char *obuf,
     if(len & (AES_BLOCK_SIZE - 1))
         return EXIT_FAILURE;
 
+#if !defined( AES_NO_HW )
+    if(aes_hw_available() && (ctx->inf.b[0] == 10 * 16 || ctx->inf.b[0] == 12 * 16 || ctx->inf.b[0] == 14 * 16))
+    {   aes_hw_ecb_encrypt(ibuf, obuf, nb, ctx);
+        return EXIT_SUCCESS;
+    }
+#endif
+
 #if defined( USE_VIA_ACE_IF_PRESENT )
 
     if(ctx->inf.b[1] == 0xff)
@@ -20,6 +20,7 @@ Issue Date: 20/12/2007
 
 #include "aesopt.h"
 #include "aestab.h"
+#include "aes_hw.h"
 
 #if defined(__cplusplus)
 extern "C"
@@ -97,6 +98,13 @@ AES_RETURN aes_encrypt(const unsigned char *in, unsigned char *out, const aes_en
     if( cx->inf.b[0] != 10 * 16 && cx->inf.b[0] != 12 * 16 && cx->inf.b[0] != 14 * 16 )
         return EXIT_FAILURE;
 
+#if !defined( AES_NO_HW )
+    if( aes_hw_available() )
+    {   aes_hw_encrypt(in, out, cx);
+        return EXIT_SUCCESS;
+    }
+#endif
+
     kp = cx->ks;
     state_in(b0, in, kp);
 
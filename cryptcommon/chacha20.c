@@ -0,0 +1,344 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * ChaCha20 and AEAD_CHACHA20_POLY1305, refer to RFC 8439.
+ *
+ * The SIMD code computes four blocks at once: each vector holds the same
+ * state word of the four blocks, thus the quarter rounds need no shuffles.
+ * A 4x4 transpose at the end puts the words of each block together. SSE2
+ * and NEON are part of the x86-64 and AArch64 base architectures, thus the
+ * code does not need a runtime check of the CPU features.
+ */
+
+#include <string.h>
+
+#include "chacha20.h"
+#include "poly1305.h"
+
+#if !defined(CHACHA20_NO_SIMD)
+#  if defined(__SSE2__)
+#    define CHACHA20_SSE2
+#  elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(__ARM_BIG_ENDIAN)
+#    define CHACHA20_NEON
+#  endif
+#endif
+
+static uint32_t getLe32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void putLe32(uint32_t v, unsigned char *p)
+{
+    int i;
+    for (i = 0; i < 4; i++) {
+        p[i] = (unsigned char)v;
+        v >>= 8;
+    }
+}
+
+/* "expand 32-byte k" */
+static void setupState(uint32_t s[16], const unsigned char *key, const unsigned char *nonce, uint32_t counter)
+{
+    int i;
+
+    s[0] = 0x61707865;
+    s[1] = 0x3320646e;
+    s[2] = 0x79622d32;
+    s[3] = 0x6b206574;
+    for (i = 0; i < 8; i++)
+        s[4 + i] = getLe32(key + i * 4);
+    s[12] = counter;
+    for (i = 0; i < 3; i++)
+        s[13 + i] = getLe32(nonce + i * 4);
+}
+
+#if !defined(CHACHA20_SSE2) && !defined(CHACHA20_NEON)
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define QUARTERROUND(a, b, c, d) \
+    a += b; d ^= a; d = ROTL32(d, 16); \
+    c += d; b ^= c; b = ROTL32(b, 12); \
+    a += b; d ^= a; d = ROTL32(d, 8);  \
+    c += d; b ^= c; b = ROTL32(b, 7);
+
+static void chachaBlock(const uint32_t s[16], unsigned char out[CHACHA20_BLOCK_SIZE])
+{
+    uint32_t x[16];
+    int i;
+
+    for (i = 0; i < 16; i++)
+        x[i] = s[i];
+
+    for (i = 0; i < 10; i++) {
+        QUARTERROUND(x[0], x[4], x[8],  x[12])
+        QUARTERROUND(x[1], x[5], x[9],  x[13])
+        QUARTERROUND(x[2], x[6], x[10], x[14])
+        QUARTERROUND(x[3], x[7], x[11], x[15])
+        QUARTERROUND(x[0], x[5], x[10], x[15])
+        QUARTERROUND(x[1], x[6], x[11], x[12])
+        QUARTERROUND(x[2], x[7], x[8],  x[13])
+        QUARTERROUND(x[3], x[4], x[9],  x[14])
+    }
+    for (i = 0; i < 16; i++)
+        putLe32(x[i] + s[i], out + i * 4);
+}
+
+#define SIMD_BLOCKS 1
+
+#else
+
+#if defined(CHACHA20_SSE2)
+
+#include <emmintrin.h>
+
+typedef __m128i vec_t;
+
+#define VADD(a, b)      _mm_add_epi32(a, b)
+#define VXOR(a, b)      _mm_xor_si128(a, b)
+#define VROTL(v, n)     _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+#define VROTL16(v)      _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1)
+#define VDUP(w)         _mm_set1_epi32((int)(w))
+#define VCOUNTER(w)     _mm_add_epi32(_mm_set1_epi32((int)(w)), _mm_set_epi32(3, 2, 1, 0))
+#define VLOAD(p)        _mm_loadu_si128((const __m128i *)(p))
+#define VSTORE(p, v)    _mm_storeu_si128((__m128i *)(p), v)
+
+/* Transpose four vectors: afterwards a holds word 0 of a, b, c and d and so on */
+#define VTRANSPOSE(a, b, c, d) {                \
+    __m128i t0 = _mm_unpacklo_epi32(a, b);      \
+    __m128i t1 = _mm_unpacklo_epi32(c, d);      \
+    __m128i t2 = _mm_unpackhi_epi32(a, b);      \
+    __m128i t3 = _mm_unpackhi_epi32(c, d);      \
+    a = _mm_unpacklo_epi64(t0, t1);             \
+    b = _mm_unpackhi_epi64(t0, t1);             \
+    c = _mm_unpacklo_epi64(t2, t3);             \
+    d = _mm_unpackhi_epi64(t2, t3);             \
+}
+
+#else
+
+#include <arm_neon.h>
+
+typedef uint32x4_t vec_t;
+
+static const uint32_t laneOffsets[4] = {0, 1, 2, 3};
+
+#define VADD(a, b)      vaddq_u32(a, b)
+#define VXOR(a, b)      veorq_u32(a, b)
+#define VROTL(v, n)     vsriq_n_u32(vshlq_n_u32(v, n), v, 32 - (n))
+#define VROTL16(v)      vreinterpretq_u32_u16(vrev32q_u16(vreinterpretq_u16_u32(v)))
+#define VDUP(w)         vdupq_n_u32(w)
+#define VCOUNTER(w)     vaddq_u32(vdupq_n_u32(w), vld1q_u32(laneOffsets))
+#define VLOAD(p)        vreinterpretq_u32_u8(vld1q_u8(p))
+#define VSTORE(p, v)    vst1q_u8(p, vreinterpretq_u8_u32(v))
+
+#define VTRANSPOSE(a, b, c, d) {                                    \
+    uint32x4x2_t t0 = vtrnq_u32(a, b);                              \
+    uint32x4x2_t t1 = vtrnq_u32(c, d);                              \
+    a = vcombine_u32(vget_low_u32(t0.val[0]), vget_low_u32(t1.val[0]));   \
+    b = vcombine_u32(vget_low_u32(t0.val[1]), vget_low_u32(t1.val[1]));   \
+    c = vcombine_u32(vget_high_u32(t0.val[0]), vget_high_u32(t1.val[0])); \
+    d = vcombine_u32(vget_high_u32(t0.val[1]), vget_high_u32(t1.val[1])); \
+}
+
+#endif
+
+#define VQUARTERROUND(a, b, c, d) \
+    a = VADD(a, b); d = VXOR(d, a); d = VROTL16(d);    \
+    c = VADD(c, d); b = VXOR(b, c); b = VROTL(b, 12);  \
+    a = VADD(a, b); d = VXOR(d, a); d = VROTL(d, 8);   \
+    c = VADD(c, d); b = VXOR(b, c); b = VROTL(b, 7);
+
+#define SIMD_BLOCKS 4
+
+/* XOR four key stream blocks, starting at the counter in s[12], with 256 bytes of input */
+static void chachaBlocks4(const uint32_t s[16], const unsigned char *in, unsigned char *out)
+{
+    vec_t x[16], o[16];
+    int i;
+
+    for (i = 0; i < 16; i++)
+        o[i] = VDUP(s[i]);
+    o[12] = VCOUNTER(s[12]);
+    for (i = 0; i < 16; i++)
+        x[i] = o[i];
+
+    for (i = 0; i < 10; i++) {
+        VQUARTERROUND(x[0], x[4], x[8],  x[12])
+        VQUARTERROUND(x[1], x[5], x[9],  x[13])
+        VQUARTERROUND(x[2], x[6], x[10], x[14])
+        VQUARTERROUND(x[3], x[7], x[11], x[15])
+        VQUARTERROUND(x[0], x[5], x[10], x[15])
+        VQUARTERROUND(x[1], x[6], x[11], x[12])
+        VQUARTERROUND(x[2], x[7], x[8],  x[13])
+        VQUARTERROUND(x[3], x[4], x[9],  x[14])
+    }
+    for (i = 0; i < 16; i++)
+        x[i] = VADD(x[i], o[i]);
+
+    /* After the transpose x[4*g + b] holds the words 4*g to 4*g+3 of block b */
+    for (i = 0; i < 16; i += 4) {
+        int b;
+        VTRANSPOSE(x[i], x[i + 1], x[i + 2], x[i + 3])
+        for (b = 0; b < 4; b++) {
+            int offset = b * CHACHA20_BLOCK_SIZE + i * 4;
+            VSTORE(out + offset, VXOR(VLOAD(in + offset), x[i + b]));
+        }
+    }
+}
+
+#endif
+
+/* Compute SIMD_BLOCKS key stream blocks that start at the counter in s[12] */
+static void keyStreamBlocks(uint32_t s[16], unsigned char keyStream[SIMD_BLOCKS * CHACHA20_BLOCK_SIZE])
+{
+#if SIMD_BLOCKS > 1
+    memset(keyStream, 0, SIMD_BLOCKS * CHACHA20_BLOCK_SIZE);
+    chachaBlocks4(s, keyStream, keyStream);
+#else
+    chachaBlock(s, keyStream);
+#endif
+    s[12] += SIMD_BLOCKS;
+}
+
+static void xorBytes(unsigned char *out, const unsigned char *in, const unsigned char *keyStream, size_t len)
+{
+    size_t i;
+    for (i = 0; i < len; i++)
+        out[i] = in[i] ^ keyStream[i];
+}
+
+static void streamXor(uint32_t s[16], const unsigned char *in, unsigned char *out, size_t len)
+{
+    unsigned char keyStream[SIMD_BLOCKS * CHACHA20_BLOCK_SIZE];
+
+#if SIMD_BLOCKS > 1
+    while (len >= SIMD_BLOCKS * CHACHA20_BLOCK_SIZE) {
+        chachaBlocks4(s, in, out);
+        s[12] += SIMD_BLOCKS;
+        in += SIMD_BLOCKS * CHACHA20_BLOCK_SIZE;
+        out += SIMD_BLOCKS * CHACHA20_BLOCK_SIZE;
+        len -= SIMD_BLOCKS * CHACHA20_BLOCK_SIZE;
+    }
+#endif
+    while (len > 0) {
+        size_t chunk = (len < sizeof(keyStream)) ? len : sizeof(keyStream);
+
+        keyStreamBlocks(s, keyStream);
+        xorBytes(out, in, keyStream, chunk);
+        in += chunk;
+        out += chunk;
+        len -= chunk;
+    }
+    memset(keyStream, 0, sizeof(keyStream));
+}
+
+void chacha20_xor(const unsigned char key[CHACHA20_KEY_SIZE], const unsigned char nonce[CHACHA20_NONCE_SIZE],
+                  uint32_t counter, const unsigned char *in, unsigned char *out, size_t len)
+{
+    uint32_t s[16];
+
+    setupState(s, key, nonce, counter);
+    streamXor(s, in, out, len);
+    memset(s, 0, sizeof(s));
+}
+
+/*
+ * The one-time Poly1305 key is the first half of key stream block 0, the
+ * encryption starts with block 1. Audio packets are short, thus the first
+ * call computes the Poly1305 key and the key stream of the first packet
+ * bytes together. See RFC 8439, chapter 2.8.
+ */
+typedef struct _aead_state {
+    uint32_t s[16];
+    unsigned char first[SIMD_BLOCKS * CHACHA20_BLOCK_SIZE];
+} aead_state;
+
+static size_t aeadStart(aead_state *st, const unsigned char *key, const unsigned char *nonce, size_t len)
+{
+    size_t firstLen = (SIMD_BLOCKS - 1) * CHACHA20_BLOCK_SIZE;
+
+    setupState(st->s, key, nonce, 0);
+    keyStreamBlocks(st->s, st->first);
+    return (len < firstLen) ? len : firstLen;
+}
+
+/* The MAC covers AAD || pad || cipher text || pad || length of AAD || length of cipher text */
+static void aeadTag(const unsigned char *otk, const unsigned char *data, size_t len,
+                    const unsigned char *aad, size_t aadLen, unsigned char tag[CHACHA20_POLY1305_TAG_SIZE])
+{
+    static const unsigned char zeros[POLY1305_BLOCK_SIZE] = {0};
+    unsigned char lengths[16];
+    poly1305_ctx ctx;
+
+    poly1305_init(&ctx, otk);
+
+    poly1305_update(&ctx, aad, aadLen);
+    if (aadLen % POLY1305_BLOCK_SIZE)
+        poly1305_update(&ctx, zeros, POLY1305_BLOCK_SIZE - aadLen % POLY1305_BLOCK_SIZE);
+    poly1305_update(&ctx, data, len);
+    if (len % POLY1305_BLOCK_SIZE)
+        poly1305_update(&ctx, zeros, POLY1305_BLOCK_SIZE - len % POLY1305_BLOCK_SIZE);
+
+    putLe32((uint32_t)aadLen, lengths);
+    putLe32((uint32_t)((uint64_t)aadLen >> 32), lengths + 4);
+    putLe32((uint32_t)len, lengths + 8);
+    putLe32((uint32_t)((uint64_t)len >> 32), lengths + 12);
+    poly1305_update(&ctx, lengths, sizeof(lengths));
+
+    poly1305_finish(&ctx, tag);
+}
+
+void chacha20_poly1305_encrypt(const unsigned char key[CHACHA20_KEY_SIZE], const unsigned char nonce[CHACHA20_NONCE_SIZE],
+                               unsigned char *data, size_t len, const unsigned char *aad, size_t aadLen,
+                               unsigned char tag[CHACHA20_POLY1305_TAG_SIZE])
+{
+    aead_state st;
+    size_t firstLen = aeadStart(&st, key, nonce, len);
+
+    xorBytes(data, data, st.first + CHACHA20_BLOCK_SIZE, firstLen);
+    streamXor(st.s, data + firstLen, data + firstLen, len - firstLen);
+    aeadTag(st.first, data, len, aad, aadLen, tag);
+
+    memset(&st, 0, sizeof(st));
+}
+
+int chacha20_poly1305_decrypt(const unsigned char key[CHACHA20_KEY_SIZE], const unsigned char nonce[CHACHA20_NONCE_SIZE],
+                              unsigned char *data, size_t len, const unsigned char *aad, size_t aadLen,
+                              const unsigned char tag[CHACHA20_POLY1305_TAG_SIZE])
+{
+    aead_state st;
+    unsigned char computed[CHACHA20_POLY1305_TAG_SIZE];
+    unsigned char diff = 0;
+    size_t firstLen = aeadStart(&st, key, nonce, len);
+    int i;
+
+    aeadTag(st.first, data, len, aad, aadLen, computed);
+
+    /* compare in constant time */
+    for (i = 0; i < CHACHA20_POLY1305_TAG_SIZE; i++)
+        diff |= (unsigned char)(computed[i] ^ tag[i]);
+    memset(computed, 0, sizeof(computed));
+
+    if (diff == 0) {
+        xorBytes(data, data, st.first + CHACHA20_BLOCK_SIZE, firstLen);
+        streamXor(st.s, data + firstLen, data + firstLen, len - firstLen);
+    }
+    memset(&st, 0, sizeof(st));
+    return diff == 0;
+}
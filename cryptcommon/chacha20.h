@@ -0,0 +1,106 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _CHACHA20_H
+#define _CHACHA20_H
+
+/**
+ * @file chacha20.h
+ * @brief The ChaCha20 stream cipher and the ChaCha20-Poly1305 AEAD
+ *
+ * The functions implement ChaCha20 and AEAD_CHACHA20_POLY1305 as defined in
+ * RFC 8439. On CPUs with SSE2 or NEON the functions compute four key stream
+ * blocks in parallel, otherwise they use portable C code. In contrast to AES
+ * the cipher does not need special CPU instructions to be fast and it has no
+ * table lookups, thus it is a good choice for devices without hardware AES.
+ *
+ * Define @c CHACHA20_NO_SIMD to disable the SIMD code at compile time.
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define CHACHA20_KEY_SIZE   32
+#define CHACHA20_NONCE_SIZE 12
+#define CHACHA20_BLOCK_SIZE 64
+#define CHACHA20_POLY1305_TAG_SIZE 16
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/**
+ * @brief Encrypt or decrypt data with ChaCha20.
+ *
+ * The function XORs the key stream that starts at block @c counter with the
+ * input. Input and output may be the same buffer.
+ *
+ * @param key the 32 byte key
+ * @param nonce the 12 byte nonce
+ * @param counter the number of the first key stream block
+ * @param in the input data
+ * @param out the output data, at least @c len bytes
+ * @param len length of the data in bytes
+ */
+void chacha20_xor(const unsigned char key[CHACHA20_KEY_SIZE], const unsigned char nonce[CHACHA20_NONCE_SIZE],
+                  uint32_t counter, const unsigned char *in, unsigned char *out, size_t len);
+
+/**
+ * @brief AEAD_CHACHA20_POLY1305 encryption, in place.
+ *
+ * @param key the 32 byte key
+ * @param nonce the 12 byte nonce
+ * @param data the data to encrypt, contains the cipher text on return
+ * @param len length of the data in bytes
+ * @param aad the additional authenticated data, not encrypted
+ * @param aadLen length of the additional authenticated data
+ * @param tag receives the 16 byte authentication tag
+ */
+void chacha20_poly1305_encrypt(const unsigned char key[CHACHA20_KEY_SIZE], const unsigned char nonce[CHACHA20_NONCE_SIZE],
+                               unsigned char *data, size_t len, const unsigned char *aad, size_t aadLen,
+                               unsigned char tag[CHACHA20_POLY1305_TAG_SIZE]);
+
+/**
+ * @brief AEAD_CHACHA20_POLY1305 decryption, in place.
+ *
+ * The function checks the tag first and decrypts the data only if the tag
+ * is valid.
+ *
+ * @param key the 32 byte key
+ * @param nonce the 12 byte nonce
+ * @param data the cipher text, contains the plain text on return
+ * @param len length of the data in bytes
+ * @param aad the additional authenticated data
+ * @param aadLen length of the additional authenticated data
+ * @param tag the received 16 byte authentication tag
+ * @return 1 if the tag is valid, 0 otherwise
+ */
+int chacha20_poly1305_decrypt(const unsigned char key[CHACHA20_KEY_SIZE], const unsigned char nonce[CHACHA20_NONCE_SIZE],
+                              unsigned char *data, size_t len, const unsigned char *aad, size_t aadLen,
+                              const unsigned char tag[CHACHA20_POLY1305_TAG_SIZE]);
+
+#if defined(__cplusplus)
+}
+#endif
+
+/**
+ * @}
+ */
+#endif
@@ -0,0 +1,240 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * GHASH for AES-GCM, refer to NIST SP 800-38D.
+ *
+ * The table based multiplication uses Shoup's 4 bit tables. The carry-less
+ * multiplication follows the Intel white paper "Intel Carry-Less
+ * Multiplication Instruction and its Usage for Computing the GCM Mode".
+ */
+
+#include <string.h>
+
+#include "ghash.h"
+
+#include <common/cpuFeatures.h>
+
+#if !defined(GHASH_NO_HW) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define GHASH_CLMUL
+#include <wmmintrin.h>
+#include <tmmintrin.h>
+#endif
+
+static uint64_t getBe64(const unsigned char *p)
+{
+    return ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) | ((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32) |
+           ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) | ((uint64_t)p[6] << 8) | (uint64_t)p[7];
+}
+
+static void putBe64(uint64_t v, unsigned char *p)
+{
+    int i;
+    for (i = 7; i >= 0; i--) {
+        p[i] = (unsigned char)v;
+        v >>= 8;
+    }
+}
+
+/* Reduction values for the 4 bit shift, see Shoup's method */
+static const uint64_t last4[16] = {
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+static void genTable(ghash_ctx *ctx)
+{
+    uint64_t vh, vl;
+    int i, j;
+
+    vh = getBe64(ctx->h);
+    vl = getBe64(ctx->h + 8);
+
+    ctx->hl[8] = vl;
+    ctx->hh[8] = vh;
+    ctx->hl[0] = 0;
+    ctx->hh[0] = 0;
+
+    for (i = 4; i > 0; i >>= 1) {
+        uint32_t t = (uint32_t)(vl & 1) * 0xe1000000U;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ ((uint64_t)t << 32);
+        ctx->hl[i] = vl;
+        ctx->hh[i] = vh;
+    }
+    for (i = 2; i <= 8; i *= 2) {
+        vh = ctx->hh[i];
+        vl = ctx->hl[i];
+        for (j = 1; j < i; j++) {
+            ctx->hh[i + j] = vh ^ ctx->hh[j];
+            ctx->hl[i + j] = vl ^ ctx->hl[j];
+        }
+    }
+}
+
+/* x = x * H using the 4 bit tables */
+static void multTable(const ghash_ctx *ctx, unsigned char x[GHASH_BLOCK_SIZE])
+{
+    uint64_t zh, zl;
+    unsigned char lo, hi, rem;
+    int i;
+
+    lo = x[15] & 0xf;
+    zh = ctx->hh[lo];
+    zl = ctx->hl[lo];
+
+    for (i = 15; i >= 0; i--) {
+        lo = x[i] & 0xf;
+        hi = (x[i] >> 4) & 0xf;
+
+        if (i != 15) {
+            rem = (unsigned char)(zl & 0xf);
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4);
+            zh ^= last4[rem] << 48;
+            zh ^= ctx->hh[lo];
+            zl ^= ctx->hl[lo];
+        }
+        rem = (unsigned char)(zl & 0xf);
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4);
+        zh ^= last4[rem] << 48;
+        zh ^= ctx->hh[hi];
+        zl ^= ctx->hl[hi];
+    }
+    putBe64(zh, x);
+    putBe64(zl, x + 8);
+}
+
+#if defined(GHASH_CLMUL)
+
+#define GHASH_TARGET __attribute__((target("pclmul,ssse3")))
+
+static int checkCpu(void)
+{
+    return (zrtpCpuFeatures() & ZRTP_CPU_CLMUL) ? 1 : 0;
+}
+
+/* Multiply in GF(2^128), both values in reflected (byte swapped) order */
+GHASH_TARGET
+static __m128i gfmul(__m128i a, __m128i b)
+{
+    __m128i tmp2, tmp3, tmp4, tmp5, tmp6, tmp7, tmp8, tmp9;
+
+    tmp3 = _mm_clmulepi64_si128(a, b, 0x00);
+    tmp4 = _mm_clmulepi64_si128(a, b, 0x10);
+    tmp5 = _mm_clmulepi64_si128(a, b, 0x01);
+    tmp6 = _mm_clmulepi64_si128(a, b, 0x11);
+
+    tmp4 = _mm_xor_si128(tmp4, tmp5);
+    tmp5 = _mm_slli_si128(tmp4, 8);
+    tmp4 = _mm_srli_si128(tmp4, 8);
+    tmp3 = _mm_xor_si128(tmp3, tmp5);
+    tmp6 = _mm_xor_si128(tmp6, tmp4);
+
+    /* shift the 256 bit result left by one bit */
+    tmp7 = _mm_srli_epi32(tmp3, 31);
+    tmp8 = _mm_srli_epi32(tmp6, 31);
+    tmp3 = _mm_slli_epi32(tmp3, 1);
+    tmp6 = _mm_slli_epi32(tmp6, 1);
+
+    tmp9 = _mm_srli_si128(tmp7, 12);
+    tmp8 = _mm_slli_si128(tmp8, 4);
+    tmp7 = _mm_slli_si128(tmp7, 4);
+    tmp3 = _mm_or_si128(tmp3, tmp7);
+    tmp6 = _mm_or_si128(tmp6, tmp8);
+    tmp6 = _mm_or_si128(tmp6, tmp9);
+
+    /* reduce modulo x^128 + x^7 + x^2 + x + 1 */
+    tmp7 = _mm_slli_epi32(tmp3, 31);
+    tmp8 = _mm_slli_epi32(tmp3, 30);
+    tmp9 = _mm_slli_epi32(tmp3, 25);
+
+    tmp7 = _mm_xor_si128(tmp7, tmp8);
+    tmp7 = _mm_xor_si128(tmp7, tmp9);
+    tmp8 = _mm_srli_si128(tmp7, 4);
+    tmp7 = _mm_slli_si128(tmp7, 12);
+    tmp3 = _mm_xor_si128(tmp3, tmp7);
+
+    tmp2 = _mm_srli_epi32(tmp3, 1);
+    tmp4 = _mm_srli_epi32(tmp3, 2);
+    tmp5 = _mm_srli_epi32(tmp3, 7);
+    tmp2 = _mm_xor_si128(tmp2, tmp4);
+    tmp2 = _mm_xor_si128(tmp2, tmp5);
+    tmp2 = _mm_xor_si128(tmp2, tmp8);
+    tmp3 = _mm_xor_si128(tmp3, tmp2);
+    tmp6 = _mm_xor_si128(tmp6, tmp3);
+
+    return tmp6;
+}
+
+GHASH_TARGET
+static void updateClmul(const ghash_ctx *ctx, unsigned char y[GHASH_BLOCK_SIZE], const unsigned char *data, size_t len)
+{
+    const __m128i swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m128i h = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)ctx->h), swap);
+    __m128i x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)y), swap);
+
+    for (; len >= GHASH_BLOCK_SIZE; len -= GHASH_BLOCK_SIZE, data += GHASH_BLOCK_SIZE) {
+        x = _mm_xor_si128(x, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)data), swap));
+        x = gfmul(x, h);
+    }
+    if (len > 0) {
+        unsigned char last[GHASH_BLOCK_SIZE] = {0};
+        memcpy(last, data, len);
+        x = _mm_xor_si128(x, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)last), swap));
+        x = gfmul(x, h);
+    }
+    _mm_storeu_si128((__m128i*)y, _mm_shuffle_epi8(x, swap));
+}
+
+#else
+
+static int checkCpu(void)
+{
+    return 0;
+}
+
+#endif
+
+void ghash_init(ghash_ctx *ctx, const unsigned char h[GHASH_BLOCK_SIZE])
+{
+    memcpy(ctx->h, h, GHASH_BLOCK_SIZE);
+    ctx->useClmul = checkCpu();
+    genTable(ctx);
+}
+
+void ghash_update(const ghash_ctx *ctx, unsigned char y[GHASH_BLOCK_SIZE], const unsigned char *data, size_t len)
+{
+    int i;
+
+#if defined(GHASH_CLMUL)
+    if (ctx->useClmul) {
+        updateClmul(ctx, y, data, len);
+        return;
+    }
+#endif
+    for (; len >= GHASH_BLOCK_SIZE; len -= GHASH_BLOCK_SIZE, data += GHASH_BLOCK_SIZE) {
+        for (i = 0; i < GHASH_BLOCK_SIZE; i++)
+            y[i] ^= data[i];
+        multTable(ctx, y);
+    }
+    if (len > 0) {
+        for (i = 0; i < (int)len; i++)
+            y[i] ^= data[i];
+        multTable(ctx, y);
+    }
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _GHASH_H
+#define _GHASH_H
+
+/**
+ * @file ghash.h
+ * @brief The GHASH function of the Galois/Counter Mode (GCM)
+ *
+ * The functions implement GHASH as defined in NIST SP 800-38D. On x86 CPUs
+ * that support the PCLMULQDQ instruction the functions use carry-less
+ * multiplication, otherwise they use a 4 bit table based multiplication.
+ *
+ * The functions are independent of the block cipher. The caller computes
+ * the hash subkey H and the counter mode encryption.
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define GHASH_BLOCK_SIZE 16
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/**
+ * The GHASH context, holds the precomputed multiplication tables for H.
+ */
+typedef struct _ghash_ctx {
+    uint64_t hl[16];                    //!< low 64 bits of the multiples of H
+    uint64_t hh[16];                    //!< high 64 bits of the multiples of H
+    unsigned char h[GHASH_BLOCK_SIZE];  //!< the hash subkey H
+    int useClmul;                       //!< use carry-less multiplication
+} ghash_ctx;
+
+/**
+ * @brief Initialize a GHASH context with a hash subkey.
+ *
+ * @param ctx the GHASH context
+ * @param h the hash subkey H, the block cipher encryption of the zero block
+ */
+void ghash_init(ghash_ctx *ctx, const unsigned char h[GHASH_BLOCK_SIZE]);
+
+/**
+ * @brief Hash data into a GHASH state.
+ *
+ * The function processes the data in 16 byte blocks and pads a last
+ * incomplete block with zero bytes. Thus only the last call of a data
+ * section (AAD or cipher text) may have a length that is not a multiple
+ * of 16.
+ *
+ * @param ctx the GHASH context
+ * @param y the 16 byte GHASH state, initialize to zero before the first call
+ * @param data the data to hash
+ * @param len length of the data in bytes
+ */
+void ghash_update(const ghash_ctx *ctx, unsigned char y[GHASH_BLOCK_SIZE], const unsigned char *data, size_t len);
+
+#if defined(__cplusplus)
+}
+#endif
+
+/**
+ * @}
+ */
+#endif
@@ -17,6 +17,7 @@
 
 #include <cryptcommon/macSkein.h>
 #include <cstdlib>
+#include <cstring>
 
 void macSkein(const uint8_t* key, uint64_t key_length,
               const uint8_t* data, uint64_t data_length,
@@ -68,10 +69,35 @@ void* initializeSkeinMacContext(void* ctx, const uint8_t* key, uint64_t key_leng
     return (void*)pctx;
 }
 
+/*
+ * Data that fits into one Skein-512 block: copy it directly into the block
+ * buffer and finalize, this skips the buffer management of the update
+ * function. Short SRTCP and small audio packets take this path.
+ */
+static bool macSkein512Short(SkeinCtx_t* pctx, const uint8_t* data1, uint64_t data1Length,
+                             const uint8_t* data2, uint64_t data2Length, uint8_t* mac)
+{
+    Skein_512_Ctxt_t* ctx512 = &pctx->m.s512;
+    uint64_t length = data1Length + data2Length;
+
+    if (pctx->skeinSize != Skein512 || ctx512->h.bCnt != 0 || length > SKEIN_512_BLOCK_BYTES)
+        return false;
+
+    memcpy(ctx512->b, data1, data1Length);
+    if (data2Length > 0)
+        memcpy(ctx512->b + data1Length, data2, data2Length);
+    ctx512->h.bCnt = length;
+    Skein_512_Final(ctx512, mac);
+    skeinReset(pctx);
+    return true;
+}
+
 void macSkeinCtx(void* ctx, const uint8_t* data, uint64_t data_length, uint8_t* mac)
 {
     auto* pctx = (SkeinCtx_t*)ctx;
 
+    if (macSkein512Short(pctx, data, data_length, NULL, 0, mac))
+        return;
     skeinUpdate(pctx, data, data_length);
     skeinFinal(pctx, mac);
     skeinReset(pctx);
@@ -91,6 +117,30 @@ void macSkeinCtx(void* ctx,
     skeinReset(pctx);
 }
 
+void macSkeinCtx(void* ctx, const uint8_t* const data[], const uint64_t dataLength[], size_t count, uint8_t* mac)
+{
+    auto* pctx = (SkeinCtx_t*)ctx;
+
+    for (size_t i = 0; i < count; i++) {
+        skeinUpdate(pctx, data[i], dataLength[i]);
+    }
+    skeinFinal(pctx, mac);
+    skeinReset(pctx);
+}
+
+void macSkeinCtx(void* ctx, const uint8_t* data1, uint64_t data1Length,
+                 const uint8_t* data2, uint64_t data2Length, uint8_t* mac)
+{
+    auto* pctx = (SkeinCtx_t*)ctx;
+
+    if (macSkein512Short(pctx, data1, data1Length, data2, data2Length, mac))
+        return;
+    skeinUpdate(pctx, data1, data1Length);
+    skeinUpdate(pctx, data2, data2Length);
+    skeinFinal(pctx, mac);
+    skeinReset(pctx);
+}
+
 void freeSkeinMacContext(void* ctx)
 {
     if (ctx)
@@ -87,6 +87,11 @@ void macSkein(const uint8_t* key, uint64_t keyLength,
  * An application uses this context to hash several data with on Skein MAC
  * Context with the same key, key length and mac length
  *
+ * The function processes the key and the configuration block once and saves
+ * the resulting chaining state in the context. After each MAC computation the
+ * @c macSkeinCtx functions restore this state, thus a MAC costs only the
+ * message blocks and the output block.
+ *
  * @param key
  *    The MAC key.
  * @param keyLength
@@ -105,6 +110,11 @@ void* createSkeinMacContext(const uint8_t* key, uint64_t keyLength, size_t macLe
  * An application uses this context to hash several data with on Skein MAC
  * Context with the same key, key length and mac length
  *
+ * The function processes the key and the configuration block once and saves
+ * the resulting chaining state in the context. After each MAC computation the
+ * @c macSkeinCtx functions restore this state, thus a MAC costs only the
+ * message blocks and the output block.
+ *
  * @param ctx
  *     Pointer to initialized Skein MAC context
  * @param key
@@ -155,6 +165,48 @@ void macSkeinCtx(void* ctx, const std::vector<const uint8_t*>& data,
                  const std::vector<uint64_t>& dataLength,
                  uint8_t* mac);
 
+/**
+ * Compute Skein MAC over an array of data chunks.
+ *
+ * This functions takes several data chunks and computes the Skein MAC. It
+ * does not allocate memory.
+ *
+ * @param ctx
+ *     Pointer to initialized Skein MAC context
+ * @param data
+ *    Array of pointers that point to the data chunks.
+ * @param dataLength
+ *    Array of integers that hold the length of each data chunk.
+ * @param count
+ *    Number of data chunks.
+ * @param mac
+ *    Points to a buffer that receives the computed digest.
+ */
+void macSkeinCtx(void* ctx, const uint8_t* const data[], const uint64_t dataLength[], size_t count, uint8_t* mac);
+
+/**
+ * Compute Skein MAC over two data chunks.
+ *
+ * This functions takes two data chunks and computes the Skein MAC, for
+ * example a SRTP packet and its ROC. It does not allocate memory and is
+ * the preferred function for per-packet processing.
+ *
+ * @param ctx
+ *     Pointer to initialized Skein MAC context
+ * @param data1
+ *    Points to the first data chunk.
+ * @param data1Length
+ *    Length of the first data chunk in bytes
+ * @param data2
+ *    Points to the second data chunk.
+ * @param data2Length
+ *    Length of the second data chunk in bytes
+ * @param mac
+ *    Points to a buffer that receives the computed digest.
+ */
+void macSkeinCtx(void* ctx, const uint8_t* data1, uint64_t data1Length,
+                 const uint8_t* data2, uint64_t data2Length, uint8_t* mac);
+
 /**
  * Free Skein MAC context.
  *
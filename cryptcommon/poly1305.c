@@ -0,0 +1,306 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Poly1305, refer to RFC 8439, chapter 2.5.
+ *
+ * The accumulator and r use limbs that are smaller than the machine words,
+ * thus the products of the limbs and their sums do not overflow and the
+ * carries propagate only once per block. The code follows the well known
+ * "poly1305-donna" implementations by Andrew Moon.
+ */
+
+#include <string.h>
+
+#include "poly1305.h"
+
+static uint32_t getLe32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void putLe32(uint32_t v, unsigned char *p)
+{
+    int i;
+    for (i = 0; i < 4; i++) {
+        p[i] = (unsigned char)v;
+        v >>= 8;
+    }
+}
+
+#if defined(POLY1305_LIMBS64)
+
+typedef unsigned __int128 uint128_t;
+
+static uint64_t getLe64(const unsigned char *p)
+{
+    return (uint64_t)getLe32(p) | ((uint64_t)getLe32(p + 4) << 32);
+}
+
+static void putLe64(uint64_t v, unsigned char *p)
+{
+    putLe32((uint32_t)v, p);
+    putLe32((uint32_t)(v >> 32), p + 4);
+}
+
+#define MASK44 0xfffffffffffULL
+#define MASK42 0x3ffffffffffULL
+
+void poly1305_init(poly1305_ctx *ctx, const unsigned char key[POLY1305_KEY_SIZE])
+{
+    uint64_t t0 = getLe64(key);
+    uint64_t t1 = getLe64(key + 8);
+
+    /* r &= 0xffffffc0ffffffc0ffffffc0fffffff, split in 44, 44 and 42 bits */
+    ctx->r[0] = t0 & 0xffc0fffffffULL;
+    ctx->r[1] = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffffULL;
+    ctx->r[2] = (t1 >> 24) & 0x00ffffffc0fULL;
+
+    ctx->h[0] = ctx->h[1] = ctx->h[2] = 0;
+
+    ctx->pad[0] = getLe64(key + 16);
+    ctx->pad[1] = getLe64(key + 24);
+
+    ctx->leftover = 0;
+}
+
+static void poly1305_blocks(poly1305_ctx *ctx, const unsigned char *m, size_t len, uint64_t hibit)
+{
+    const uint64_t r0 = ctx->r[0], r1 = ctx->r[1], r2 = ctx->r[2];
+    const uint64_t s1 = r1 * (5 << 2), s2 = r2 * (5 << 2);
+    uint64_t h0 = ctx->h[0], h1 = ctx->h[1], h2 = ctx->h[2];
+
+    while (len >= POLY1305_BLOCK_SIZE) {
+        uint64_t t0 = getLe64(m);
+        uint64_t t1 = getLe64(m + 8);
+        uint128_t d0, d1, d2;
+        uint64_t c;
+
+        /* h += m */
+        h0 += t0 & MASK44;
+        h1 += ((t0 >> 44) | (t1 << 20)) & MASK44;
+        h2 += ((t1 >> 24) & MASK42) | hibit;
+
+        /* h *= r, reduce modulo 2^130 - 5 */
+        d0 = (uint128_t)h0 * r0 + (uint128_t)h1 * s2 + (uint128_t)h2 * s1;
+        d1 = (uint128_t)h0 * r1 + (uint128_t)h1 * r0 + (uint128_t)h2 * s2;
+        d2 = (uint128_t)h0 * r2 + (uint128_t)h1 * r1 + (uint128_t)h2 * r0;
+
+        c = (uint64_t)(d0 >> 44); h0 = (uint64_t)d0 & MASK44;
+        d1 += c; c = (uint64_t)(d1 >> 44); h1 = (uint64_t)d1 & MASK44;
+        d2 += c; c = (uint64_t)(d2 >> 42); h2 = (uint64_t)d2 & MASK42;
+        h0 += c * 5; c = h0 >> 44; h0 &= MASK44;
+        h1 += c;
+
+        m += POLY1305_BLOCK_SIZE;
+        len -= POLY1305_BLOCK_SIZE;
+    }
+    ctx->h[0] = h0;
+    ctx->h[1] = h1;
+    ctx->h[2] = h2;
+}
+
+static void poly1305_tag(poly1305_ctx *ctx, unsigned char tag[POLY1305_TAG_SIZE])
+{
+    uint64_t h0 = ctx->h[0], h1 = ctx->h[1], h2 = ctx->h[2];
+    uint64_t g0, g1, g2, c, mask;
+
+    /* fully carry h */
+    c = h1 >> 44; h1 &= MASK44;
+    h2 += c; c = h2 >> 42; h2 &= MASK42;
+    h0 += c * 5; c = h0 >> 44; h0 &= MASK44;
+    h1 += c; c = h1 >> 44; h1 &= MASK44;
+    h2 += c; c = h2 >> 42; h2 &= MASK42;
+    h0 += c * 5; c = h0 >> 44; h0 &= MASK44;
+    h1 += c;
+
+    /* g = h - p = h + 5 - 2^130, select h if h < p, otherwise g */
+    g0 = h0 + 5; c = g0 >> 44; g0 &= MASK44;
+    g1 = h1 + c; c = g1 >> 44; g1 &= MASK44;
+    g2 = h2 + c - ((uint64_t)1 << 42);
+
+    mask = (g2 >> 63) - 1;
+    g0 &= mask; g1 &= mask; g2 &= mask;
+    mask = ~mask;
+    h0 = (h0 & mask) | g0;
+    h1 = (h1 & mask) | g1;
+    h2 = (h2 & mask) | g2;
+
+    /* tag = (h + s) mod 2^128 */
+    h0 += ctx->pad[0] & MASK44; c = h0 >> 44; h0 &= MASK44;
+    h1 += (((ctx->pad[0] >> 44) | (ctx->pad[1] << 20)) & MASK44) + c; c = h1 >> 44; h1 &= MASK44;
+    h2 += ((ctx->pad[1] >> 24) & MASK42) + c; h2 &= MASK42;
+
+    putLe64(h0 | (h1 << 44), tag);
+    putLe64((h1 >> 20) | (h2 << 24), tag + 8);
+}
+
+#define HIBIT ((uint64_t)1 << 40)
+
+#else   /* 26 bit limbs */
+
+#define MASK26 0x3ffffff
+
+void poly1305_init(poly1305_ctx *ctx, const unsigned char key[POLY1305_KEY_SIZE])
+{
+    int i;
+
+    /* r &= 0xffffffc0ffffffc0ffffffc0fffffff, split in 26 bit limbs */
+    ctx->r[0] = getLe32(key) & 0x3ffffff;
+    ctx->r[1] = (getLe32(key + 3) >> 2) & 0x3ffff03;
+    ctx->r[2] = (getLe32(key + 6) >> 4) & 0x3ffc0ff;
+    ctx->r[3] = (getLe32(key + 9) >> 6) & 0x3f03fff;
+    ctx->r[4] = (getLe32(key + 12) >> 8) & 0x00fffff;
+
+    for (i = 0; i < 5; i++)
+        ctx->h[i] = 0;
+    for (i = 0; i < 4; i++)
+        ctx->pad[i] = getLe32(key + 16 + i * 4);
+
+    ctx->leftover = 0;
+}
+
+static void poly1305_blocks(poly1305_ctx *ctx, const unsigned char *m, size_t len, uint32_t hibit)
+{
+    const uint32_t r0 = ctx->r[0], r1 = ctx->r[1], r2 = ctx->r[2], r3 = ctx->r[3], r4 = ctx->r[4];
+    const uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+    uint32_t h0 = ctx->h[0], h1 = ctx->h[1], h2 = ctx->h[2], h3 = ctx->h[3], h4 = ctx->h[4];
+
+    while (len >= POLY1305_BLOCK_SIZE) {
+        uint64_t d0, d1, d2, d3, d4;
+        uint32_t c;
+
+        /* h += m */
+        h0 += getLe32(m) & MASK26;
+        h1 += (getLe32(m + 3) >> 2) & MASK26;
+        h2 += (getLe32(m + 6) >> 4) & MASK26;
+        h3 += (getLe32(m + 9) >> 6) & MASK26;
+        h4 += (getLe32(m + 12) >> 8) | hibit;
+
+        /* h *= r, reduce modulo 2^130 - 5 */
+        d0 = (uint64_t)h0 * r0 + (uint64_t)h1 * s4 + (uint64_t)h2 * s3 + (uint64_t)h3 * s2 + (uint64_t)h4 * s1;
+        d1 = (uint64_t)h0 * r1 + (uint64_t)h1 * r0 + (uint64_t)h2 * s4 + (uint64_t)h3 * s3 + (uint64_t)h4 * s2;
+        d2 = (uint64_t)h0 * r2 + (uint64_t)h1 * r1 + (uint64_t)h2 * r0 + (uint64_t)h3 * s4 + (uint64_t)h4 * s3;
+        d3 = (uint64_t)h0 * r3 + (uint64_t)h1 * r2 + (uint64_t)h2 * r1 + (uint64_t)h3 * r0 + (uint64_t)h4 * s4;
+        d4 = (uint64_t)h0 * r4 + (uint64_t)h1 * r3 + (uint64_t)h2 * r2 + (uint64_t)h3 * r1 + (uint64_t)h4 * r0;
+
+        c = (uint32_t)(d0 >> 26); h0 = (uint32_t)d0 & MASK26;
+        d1 += c; c = (uint32_t)(d1 >> 26); h1 = (uint32_t)d1 & MASK26;
+        d2 += c; c = (uint32_t)(d2 >> 26); h2 = (uint32_t)d2 & MASK26;
+        d3 += c; c = (uint32_t)(d3 >> 26); h3 = (uint32_t)d3 & MASK26;
+        d4 += c; c = (uint32_t)(d4 >> 26); h4 = (uint32_t)d4 & MASK26;
+        h0 += c * 5; c = h0 >> 26; h0 &= MASK26;
+        h1 += c;
+
+        m += POLY1305_BLOCK_SIZE;
+        len -= POLY1305_BLOCK_SIZE;
+    }
+    ctx->h[0] = h0;
+    ctx->h[1] = h1;
+    ctx->h[2] = h2;
+    ctx->h[3] = h3;
+    ctx->h[4] = h4;
+}
+
+static void poly1305_tag(poly1305_ctx *ctx, unsigned char tag[POLY1305_TAG_SIZE])
+{
+    uint32_t h0 = ctx->h[0], h1 = ctx->h[1], h2 = ctx->h[2], h3 = ctx->h[3], h4 = ctx->h[4];
+    uint32_t g0, g1, g2, g3, g4, c, mask;
+    uint64_t f;
+
+    /* fully carry h */
+    c = h1 >> 26; h1 &= MASK26;
+    h2 += c; c = h2 >> 26; h2 &= MASK26;
+    h3 += c; c = h3 >> 26; h3 &= MASK26;
+    h4 += c; c = h4 >> 26; h4 &= MASK26;
+    h0 += c * 5; c = h0 >> 26; h0 &= MASK26;
+    h1 += c;
+
+    /* g = h - p = h + 5 - 2^130, select h if h < p, otherwise g */
+    g0 = h0 + 5; c = g0 >> 26; g0 &= MASK26;
+    g1 = h1 + c; c = g1 >> 26; g1 &= MASK26;
+    g2 = h2 + c; c = g2 >> 26; g2 &= MASK26;
+    g3 = h3 + c; c = g3 >> 26; g3 &= MASK26;
+    g4 = h4 + c - (1UL << 26);
+
+    mask = (g4 >> 31) - 1;
+    g0 &= mask; g1 &= mask; g2 &= mask; g3 &= mask; g4 &= mask;
+    mask = ~mask;
+    h0 = (h0 & mask) | g0;
+    h1 = (h1 & mask) | g1;
+    h2 = (h2 & mask) | g2;
+    h3 = (h3 & mask) | g3;
+    h4 = (h4 & mask) | g4;
+
+    /* h = h mod 2^128 in 32 bit words, tag = (h + s) mod 2^128 */
+    h0 = h0 | (h1 << 26);
+    h1 = (h1 >> 6) | (h2 << 20);
+    h2 = (h2 >> 12) | (h3 << 14);
+    h3 = (h3 >> 18) | (h4 << 8);
+
+    f = (uint64_t)h0 + ctx->pad[0];             putLe32((uint32_t)f, tag);
+    f = (uint64_t)h1 + ctx->pad[1] + (f >> 32); putLe32((uint32_t)f, tag + 4);
+    f = (uint64_t)h2 + ctx->pad[2] + (f >> 32); putLe32((uint32_t)f, tag + 8);
+    f = (uint64_t)h3 + ctx->pad[3] + (f >> 32); putLe32((uint32_t)f, tag + 12);
+}
+
+#define HIBIT (1UL << 24)
+
+#endif
+
+void poly1305_update(poly1305_ctx *ctx, const unsigned char *data, size_t len)
+{
+    size_t i;
+
+    /* complete a buffered block first */
+    if (ctx->leftover > 0) {
+        size_t want = POLY1305_BLOCK_SIZE - ctx->leftover;
+        if (want > len)
+            want = len;
+        memcpy(ctx->buffer + ctx->leftover, data, want);
+        ctx->leftover += want;
+        data += want;
+        len -= want;
+        if (ctx->leftover < POLY1305_BLOCK_SIZE)
+            return;
+        poly1305_blocks(ctx, ctx->buffer, POLY1305_BLOCK_SIZE, HIBIT);
+        ctx->leftover = 0;
+    }
+    if (len >= POLY1305_BLOCK_SIZE) {
+        size_t full = len & ~(size_t)(POLY1305_BLOCK_SIZE - 1);
+        poly1305_blocks(ctx, data, full, HIBIT);
+        data += full;
+        len -= full;
+    }
+    for (i = 0; i < len; i++)
+        ctx->buffer[i] = data[i];
+    ctx->leftover = len;
+}
+
+void poly1305_finish(poly1305_ctx *ctx, unsigned char tag[POLY1305_TAG_SIZE])
+{
+    /* the last incomplete block gets a 1 byte after the data and no high bit */
+    if (ctx->leftover > 0) {
+        size_t i = ctx->leftover;
+        ctx->buffer[i++] = 1;
+        for (; i < POLY1305_BLOCK_SIZE; i++)
+            ctx->buffer[i] = 0;
+        poly1305_blocks(ctx, ctx->buffer, POLY1305_BLOCK_SIZE, 0);
+    }
+    poly1305_tag(ctx, tag);
+
+    memset(ctx, 0, sizeof(poly1305_ctx));
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _POLY1305_H
+#define _POLY1305_H
+
+/**
+ * @file poly1305.h
+ * @brief The Poly1305 one-time authenticator
+ *
+ * The functions implement Poly1305 as defined in RFC 8439. If the compiler
+ * supports 128 bit integers the functions use 44 bit limbs, otherwise they
+ * use 26 bit limbs that fit the 32 bit multiplications of 32 bit CPUs.
+ *
+ * A Poly1305 key must authenticate one message only.
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define POLY1305_KEY_SIZE   32
+#define POLY1305_BLOCK_SIZE 16
+#define POLY1305_TAG_SIZE   16
+
+#if defined(__SIZEOF_INT128__) && !defined(POLY1305_NO_INT128)
+#define POLY1305_LIMBS64
+#endif
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/**
+ * The Poly1305 context.
+ */
+typedef struct _poly1305_ctx {
+#if defined(POLY1305_LIMBS64)
+    uint64_t r[3];                      //!< the clamped key part r
+    uint64_t h[3];                      //!< the accumulator
+    uint64_t pad[2];                    //!< the key part s
+#else
+    uint32_t r[5];
+    uint32_t h[5];
+    uint32_t pad[4];
+#endif
+    unsigned char buffer[POLY1305_BLOCK_SIZE];  //!< an incomplete block
+    size_t leftover;                    //!< number of bytes in buffer
+} poly1305_ctx;
+
+/**
+ * @brief Initialize a Poly1305 context with a one-time key.
+ *
+ * @param ctx the Poly1305 context
+ * @param key the 32 byte one-time key r || s
+ */
+void poly1305_init(poly1305_ctx *ctx, const unsigned char key[POLY1305_KEY_SIZE]);
+
+/**
+ * @brief Authenticate data.
+ *
+ * @param ctx the Poly1305 context
+ * @param data the data
+ * @param len length of the data in bytes
+ */
+void poly1305_update(poly1305_ctx *ctx, const unsigned char *data, size_t len);
+
+/**
+ * @brief Compute the tag and clear the context.
+ *
+ * @param ctx the Poly1305 context
+ * @param tag receives the 16 byte tag
+ */
+void poly1305_finish(poly1305_ctx *ctx, unsigned char tag[POLY1305_TAG_SIZE]);
+
+#if defined(__cplusplus)
+}
+#endif
+
+/**
+ * @}
+ */
+#endif
@@ -1711,6 +1711,64 @@ void Twofish_encrypt( Twofish_key * xkey, Twofish_Byte p[16], Twofish_Byte c[16]
     } 
  
  
+/*
+ * Four rounds of Twofish on four independent blocks. The blocks do not
+ * depend on each other, thus the CPU can overlap the table lookups of the
+ * four blocks.
+ */
+#define ENCRYPT_RND4( A,B,C,D, r ) \
+    ENCRYPT_RND( A##0,B##0,C##0,D##0,T0,T1,xkey,r );\
+    ENCRYPT_RND( A##1,B##1,C##1,D##1,T2,T3,xkey,r );\
+    ENCRYPT_RND( A##2,B##2,C##2,D##2,T4,T5,xkey,r );\
+    ENCRYPT_RND( A##3,B##3,C##3,D##3,T6,T7,xkey,r )
+
+#define ENCRYPT_CYCLE4( r ) \
+    ENCRYPT_RND4( A,B,C,D, 2*(r)   );\
+    ENCRYPT_RND4( C,D,A,B, 2*(r)+1 )
+
+/*
+ * Twofish encryption of several independent blocks (ECB).
+ *
+ * Arguments:
+ * xkey         expanded key array
+ * p            numBlocks * 16 bytes of plaintext
+ * c            numBlocks * 16 bytes in which to store the ciphertext
+ * numBlocks    number of blocks
+ */
+void Twofish_encrypt_blocks( Twofish_key * xkey, const Twofish_Byte* p, Twofish_Byte* c, int numBlocks)
+    {
+    Twofish_UInt32 A0,B0,C0,D0, A1,B1,C1,D1, A2,B2,C2,D2, A3,B3,C3,D3;
+    Twofish_UInt32 T0,T1,T2,T3,T4,T5,T6,T7;
+
+    for( ; numBlocks >= 4; numBlocks -= 4, p += 64, c += 64 )
+        {
+        GET_INPUT( p,    A0,B0,C0,D0, xkey, 0 );
+        GET_INPUT( p+16, A1,B1,C1,D1, xkey, 0 );
+        GET_INPUT( p+32, A2,B2,C2,D2, xkey, 0 );
+        GET_INPUT( p+48, A3,B3,C3,D3, xkey, 0 );
+
+        ENCRYPT_CYCLE4( 0 );
+        ENCRYPT_CYCLE4( 1 );
+        ENCRYPT_CYCLE4( 2 );
+        ENCRYPT_CYCLE4( 3 );
+        ENCRYPT_CYCLE4( 4 );
+        ENCRYPT_CYCLE4( 5 );
+        ENCRYPT_CYCLE4( 6 );
+        ENCRYPT_CYCLE4( 7 );
+
+        PUT_OUTPUT( C0,D0,A0,B0, c,    xkey, 4 );
+        PUT_OUTPUT( C1,D1,A1,B1, c+16, xkey, 4 );
+        PUT_OUTPUT( C2,D2,A2,B2, c+32, xkey, 4 );
+        PUT_OUTPUT( C3,D3,A3,B3, c+48, xkey, 4 );
+        }
+    for( ; numBlocks > 0; numBlocks--, p += 16, c += 16 )
+        {
+        GET_INPUT( p, A0,B0,C0,D0, xkey, 0 );
+        ENCRYPT( A0,B0,C0,D0,T0,T1,xkey );
+        PUT_OUTPUT( C0,D0,A0,B0, c, xkey, 4 );
+        }
+    }
+
 /* 
  * Twofish block decryption. 
  * 
@@ -193,6 +193,28 @@ extern void Twofish_encrypt(
                             ); 
 
 
+/**
+ * Encrypt several independent blocks of data (ECB).
+ *
+ * This function encrypts @c numBlocks blocks of 16 bytes each. It
+ * processes four blocks in parallel and is faster than calling
+ * Twofish_encrypt() for each block, for example to compute the key
+ * stream of a counter mode.
+ *
+ * @param xkey      pointer to Twofish_key, internal form of the key
+ *                  produces by Twofish_prepare_key()
+ * @param p         Plaintext blocks, <code>numBlocks * 16</code> bytes
+ * @param c         Place to store the ciphertext blocks, <code>numBlocks * 16</code> bytes
+ * @param numBlocks Number of blocks
+ */
+extern void Twofish_encrypt_blocks(
+                                   Twofish_key * xkey,
+                                   const Twofish_Byte* p,
+                                   Twofish_Byte* c,
+                                   int numBlocks
+                                   );
+
+
 /**
  * Decrypt a single block of data. 
  * 
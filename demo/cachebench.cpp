@@ -0,0 +1,348 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * ZID cache benchmark.
+ *
+ * Fills the ZID cache with the records and names of a number of peers and
+ * measures the latency of the cache functions the engines use during a
+ * handshake. The benchmark runs these operations:
+ *
+ * - get-hit: getRecord of a peer in the cache
+ * - get-miss: getRecord of an unknown peer, the record is not saved
+ * - new-peer: getRecord and saveRecord of an unknown peer, the cache grows
+ * - save: getRecord and saveRecord of a peer in the cache with a new RS1
+ * - get-name: getPeerName of a peer in the cache
+ * - put-name: putPeerName of a peer in the cache
+ *
+ * The build of the library selects the cache backend (file, SQLite, SQLCipher,
+ * empty, memory mapped file or shared memory), build the library with another
+ * backend and run cachebench again to compare the backends. The option -l
+ * installs the LRU layer ZIDCacheLru, the option -s installs the sharded layer
+ * ZIDCacheSharded in front of the backend. With both options the sharded layer
+ * is in front of the LRU layer.
+ *
+ * Usage: cachebench [-n peers] [-o operations] [-t threads] [-f cachefile] [-l capacity] [-s shards]
+ *
+ * The benchmark removes the cache file before it starts. With more than one
+ * thread the threads share the operations of a run, the backends without a
+ * layer have no lock of their own, thus the benchmark serializes their calls
+ * with a lock, as an application would. The output is a JSON document, the
+ * latencies are microseconds per operation. The "populate_ms" value is the
+ * time to fill the cache, "open_ms" is the time to open the filled cache
+ * again and "disk_bytes" is the size of the cache file and of the journal
+ * files of SQLite.
+ */
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include <libzrtpcpp/ZIDCache.h>
+#include <libzrtpcpp/ZIDRecord.h>
+#include <libzrtpcpp/ZIDCacheLru.h>
+#include <libzrtpcpp/ZIDCacheSharded.h>
+
+#ifndef CACHEBENCH_BACKEND
+#define CACHEBENCH_BACKEND "unknown"
+#endif
+
+typedef enum _BenchOperation {
+    GetHit = 0,
+    GetMiss,
+    NewPeer,
+    SaveRecord,
+    GetName,
+    PutName,
+    NumOperations
+} BenchOperation;
+
+static const char* operationNames[NumOperations] = {
+    "get-hit", "get-miss", "new-peer", "save", "get-name", "put-name"
+};
+
+// Peers in the cache, unknown peers and new peers use different first bytes of the ZID
+static const uint8_t knownPeer = 0x4b;
+static const uint8_t unknownPeer = 0x55;
+static const uint8_t newPeer = 0x4e;
+
+static std::atomic<uint32_t> newPeers(0);
+
+// Serializes the calls of the backends without a layer
+static std::mutex cacheLock;
+static bool useLock;
+
+static void makeZid(uint8_t kind, uint32_t index, uint8_t* zid)
+{
+    memset(zid, 0, IDENTIFIER_LEN);
+    zid[0] = kind;
+    zid[IDENTIFIER_LEN - 4] = (uint8_t)(index >> 24);
+    zid[IDENTIFIER_LEN - 3] = (uint8_t)(index >> 16);
+    zid[IDENTIFIER_LEN - 2] = (uint8_t)(index >> 8);
+    zid[IDENTIFIER_LEN - 1] = (uint8_t)index;
+}
+
+static void setSecret(ZIDRecord* record, uint32_t index)
+{
+    uint8_t rs[RS_LENGTH];
+
+    for (int32_t i = 0; i < RS_LENGTH; i++)
+        rs[i] = (uint8_t)(index * 31 + i);
+    record->setNewRs1(rs, -1);
+}
+
+static std::string peerName(uint32_t index)
+{
+    char name[32];
+
+    snprintf(name, sizeof(name), "peer-%u", index);
+    return std::string(name);
+}
+
+static void runOperation(ZIDCache* cache, BenchOperation operation, uint32_t index)
+{
+    uint8_t zid[IDENTIFIER_LEN];
+    ZIDRecord* record;
+    std::string name;
+
+    std::unique_lock<std::mutex> guard(cacheLock, std::defer_lock);
+    if (useLock)
+        guard.lock();
+
+    switch (operation) {
+    case GetHit:
+        makeZid(knownPeer, index, zid);
+        delete cache->getRecord(zid);
+        break;
+
+    case GetMiss:
+        makeZid(unknownPeer, index, zid);
+        delete cache->getRecord(zid);
+        break;
+
+    case NewPeer:
+        makeZid(newPeer, newPeers++, zid);
+        record = cache->getRecord(zid);
+        if (record != NULL) {
+            setSecret(record, index);
+            cache->saveRecord(record);
+            delete record;
+        }
+        break;
+
+    case SaveRecord:
+        makeZid(knownPeer, index, zid);
+        record = cache->getRecord(zid);
+        if (record != NULL) {
+            setSecret(record, index + 1);
+            cache->saveRecord(record);
+            delete record;
+        }
+        break;
+
+    case GetName:
+        makeZid(knownPeer, index, zid);
+        cache->getPeerName(zid, &name);
+        break;
+
+    case PutName:
+        makeZid(knownPeer, index, zid);
+        cache->putPeerName(zid, peerName(index + 1));
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void runThread(ZIDCache* cache, BenchOperation operation, uint32_t peers, uint32_t first, uint32_t count,
+                      double* latencies)
+{
+    // A simple LCG selects the peers, each thread uses its own sequence
+    uint32_t state = first * 2654435761U + 1;
+
+    for (uint32_t i = 0; i < count; i++) {
+        state = state * 1664525U + 1013904223U;
+        uint32_t index = (state >> 8) % peers;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        runOperation(cache, operation, index);
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        latencies[first + i] = std::chrono::duration<double, std::micro>(end - start).count();
+    }
+}
+
+static double percentile(const std::vector<double>& sorted, double fraction)
+{
+    size_t index = (size_t)(fraction * (double)(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static long long diskSize(const char* name)
+{
+    static const char* suffixes[] = { "", "-wal", "-shm", "-journal" };
+    long long size = 0;
+
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+        std::string file = std::string(name) + suffixes[i];
+        struct stat st;
+        if (stat(file.c_str(), &st) == 0)
+            size += (long long)st.st_size;
+    }
+    return size;
+}
+
+static void usage()
+{
+    fprintf(stderr, "Usage: cachebench [-n peers] [-o operations] [-t threads] [-f cachefile] [-l capacity] [-s shards]\n");
+    fprintf(stderr, "  -n peers       number of peers in the cache, default 10000\n");
+    fprintf(stderr, "  -o operations  operations per run, default 10000\n");
+    fprintf(stderr, "  -t threads     number of threads, default 1\n");
+    fprintf(stderr, "  -f cachefile   name of the ZID cache file, default cachebench.zid\n");
+    fprintf(stderr, "  -l capacity    install the LRU layer with this capacity\n");
+    fprintf(stderr, "  -s shards      install the sharded layer with this number of shards\n");
+}
+
+int main(int argc, char* argv[])
+{
+    int32_t peers = 10000;
+    int32_t operations = 10000;
+    int32_t threads = 1;
+    int32_t lruCapacity = 0;
+    int32_t shards = 0;
+    const char* cacheFile = "cachebench.zid";
+
+    for (int i = 1; i < argc; i++) {
+        bool valid = i + 1 < argc;
+        if (valid && strcmp(argv[i], "-n") == 0) {
+            peers = atoi(argv[++i]);
+        }
+        else if (valid && strcmp(argv[i], "-o") == 0) {
+            operations = atoi(argv[++i]);
+        }
+        else if (valid && strcmp(argv[i], "-t") == 0) {
+            threads = atoi(argv[++i]);
+        }
+        else if (valid && strcmp(argv[i], "-f") == 0) {
+            cacheFile = argv[++i];
+        }
+        else if (valid && strcmp(argv[i], "-l") == 0) {
+            lruCapacity = atoi(argv[++i]);
+        }
+        else if (valid && strcmp(argv[i], "-s") == 0) {
+            shards = atoi(argv[++i]);
+        }
+        else {
+            valid = false;
+        }
+        if (!valid) {
+            usage();
+            return 1;
+        }
+    }
+    if (peers <= 0 || operations <= 0 || threads <= 0 || lruCapacity < 0 || shards < 0) {
+        usage();
+        return 1;
+    }
+    if (lruCapacity > 0)
+        ZIDCacheLru::install((size_t)lruCapacity);
+    if (shards > 0)
+        ZIDCacheSharded::install((size_t)shards);
+    useLock = threads > 1 && lruCapacity == 0 && shards == 0;
+
+    ZIDCache* cache = getZidCacheInstance();
+    remove(cacheFile);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (cache->open(const_cast<char*>(cacheFile)) < 0) {
+        fprintf(stderr, "Cannot open the ZID cache %s\n", cacheFile);
+        return 1;
+    }
+    double createMs = elapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < peers; i++) {
+        uint8_t zid[IDENTIFIER_LEN];
+
+        makeZid(knownPeer, (uint32_t)i, zid);
+        ZIDRecord* record = cache->getRecord(zid);
+        if (record == NULL)
+            continue;
+        setSecret(record, (uint32_t)i);
+        cache->saveRecord(record);
+        delete record;
+        cache->putPeerName(zid, peerName((uint32_t)i));
+    }
+    double populateMs = elapsedMs(start);
+
+    // Close and open the filled cache to measure the startup time
+    cache->close();
+    start = std::chrono::steady_clock::now();
+    if (cache->open(const_cast<char*>(cacheFile)) < 0) {
+        fprintf(stderr, "Cannot open the ZID cache %s again\n", cacheFile);
+        return 1;
+    }
+    double openMs = elapsedMs(start);
+
+    printf("{\n  \"backend\": \"%s\",\n  \"lru_capacity\": %d,\n  \"shards\": %d,\n", CACHEBENCH_BACKEND,
+           lruCapacity, shards);
+    printf("  \"peers\": %d,\n  \"operations\": %d,\n  \"threads\": %d,\n", peers, operations, threads);
+    printf("  \"create_ms\": %.3f,\n  \"populate_ms\": %.3f,\n  \"open_ms\": %.3f,\n", createMs, populateMs, openMs);
+    printf("  \"results\": [");
+
+    std::vector<double> latencies(operations);
+    for (int32_t op = 0; op < NumOperations; op++) {
+        std::vector<std::thread> workers;
+        uint32_t perThread = (uint32_t)operations / (uint32_t)threads;
+
+        start = std::chrono::steady_clock::now();
+        for (int32_t t = 0; t < threads; t++) {
+            uint32_t first = (uint32_t)t * perThread;
+            uint32_t count = (t == threads - 1) ? (uint32_t)operations - first : perThread;
+            workers.push_back(std::thread(runThread, cache, (BenchOperation)op, (uint32_t)peers, first, count,
+                                          latencies.data()));
+        }
+        for (size_t t = 0; t < workers.size(); t++)
+            workers[t].join();
+        double wallMs = elapsedMs(start);
+
+        std::vector<double> sorted(latencies);
+        std::sort(sorted.begin(), sorted.end());
+        printf("%s\n    { \"operation\": \"%s\", \"ops_per_sec\": %.0f, \"p50_us\": %.2f, \"p90_us\": %.2f, "
+               "\"p99_us\": %.2f, \"p999_us\": %.2f, \"max_us\": %.2f }", op == 0 ? "" : ",", operationNames[op],
+               wallMs > 0.0 ? operations * 1000.0 / wallMs : 0.0, percentile(sorted, 0.5), percentile(sorted, 0.9),
+               percentile(sorted, 0.99), percentile(sorted, 0.999), sorted.back());
+    }
+    cache->close();
+
+    printf("\n  ],\n  \"disk_bytes\": %lld\n}\n", diskSize(cacheFile));
+    return 0;
+}
@@ -0,0 +1,371 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Crypto primitive benchmark.
+ *
+ * Measures the crypto primitives that ZRTP and SRTP use: AES and Twofish
+ * blocks, CTR and F8 mode, the HMAC and Skein MAC functions, SHA256 and SHA384,
+ * the ZRTP KDF, the CRC32C checksum and the DH key generation and agreement of
+ * each public key type. The crypto backend (standalone or OpenSSL) is selected
+ * when building the library, build the library with the other backend and run
+ * cryptobench again to compare the backends.
+ *
+ * Usage: cryptobench [-m milliseconds] [-s size[,size...]] [-c mask]
+ *
+ * The output is a JSON document, each result contains the operations per second,
+ * nanoseconds per operation and, for the data functions, cycles per byte. On x86
+ * the cycles are time stamp counter cycles, on other CPUs the results do not
+ * contain cycles. The option -c sets the CPU feature mask, -c 0 for example
+ * measures the generic code instead of the CPU specific code.
+ */
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#include <common/cpuFeatures.h>
+#include <srtp/crypto/SrtpSymCrypto.h>
+#include <srtp/crypto/hmac.h>
+#include <cryptcommon/macSkein.h>
+#include <zrtp/crypto/hmac256.h>
+#include <zrtp/crypto/hmac384.h>
+#include <zrtp/crypto/sha256.h>
+#include <zrtp/crypto/sha384.h>
+#include <zrtp/crypto/zrtpDH.h>
+#include <libzrtpcpp/ZrtpCrc32.h>
+#include <common/osSpecifics.h>
+
+#ifdef ZRTP_OPENSSL
+static const char* backend = "OpenSSL";
+#else
+static const char* backend = "standalone";
+#endif
+
+static const int32_t defaultSizes[] = {16, 64, 160, 1024, 4096};
+
+static const int32_t defaultMilliseconds = 200;
+static int32_t minMilliseconds = defaultMilliseconds;
+static bool firstResult = true;
+
+// Keeps the compiler from removing the computations of a benchmark
+static volatile uint8_t sink;
+
+static inline uint64_t readCycles()
+{
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/*
+ * Run the function until the minimal time elapsed, double the number of calls
+ * of each round. Print one JSON result, bytes is 0 for functions that do not
+ * process data, for example the DH functions.
+ */
+template <typename Function>
+static void measure(const char* name, size_t bytes, Function function)
+{
+    uint64_t calls = 1;
+    uint64_t done = 0;
+    uint64_t cycles = 0;
+    double seconds = 0.0;
+
+    function();             // warm up caches and lazy initializations
+
+    while (seconds * 1000.0 < minMilliseconds) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        uint64_t startCycles = readCycles();
+
+        for (uint64_t i = 0; i < calls; i++)
+            function();
+
+        cycles += readCycles() - startCycles;
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        done += calls;
+        calls *= 2;
+    }
+    printf("%s\n    {\"name\": \"%s\", \"bytes\": %zu, \"ops_per_s\": %.1f, \"ns_per_op\": %.1f, \"cycles_per_byte\": ",
+           firstResult ? "" : ",", name, bytes, done / seconds, seconds * 1e9 / done);
+#ifdef HAVE_TSC
+    if (bytes > 0)
+        printf("%.3f}", (double)cycles / ((double)done * bytes));
+    else
+        printf("null}");
+#else
+    printf("null}");
+#endif
+    firstResult = false;
+}
+
+static void benchCiphers(const std::vector<int32_t>& sizes, uint8_t* data, uint8_t* out)
+{
+    static const struct {
+        int32_t algorithm;
+        int32_t keyLength;
+        const char* name;
+    } ciphers[] = {
+        { SrtpEncryptionAESCM, 16, "aes128" },
+        { SrtpEncryptionAESCM, 32, "aes256" },
+        { SrtpEncryptionTWOCM, 16, "twofish128" },
+        { SrtpEncryptionTWOCM, 32, "twofish256" },
+    };
+    static const int32_t fAlgorithms[] = { SrtpEncryptionAESF8, SrtpEncryptionAESF8, SrtpEncryptionTWOF8, SrtpEncryptionTWOF8 };
+
+    uint8_t key[32];
+    uint8_t salt[14];
+    uint8_t iv[16];
+    char name[64];
+
+    for (int i = 0; i < 32; i++)
+        key[i] = (uint8_t)(i * 7 + 1);
+    memset(salt, 0x5a, sizeof(salt));
+    memset(iv, 0xa5, sizeof(iv));
+
+    for (size_t c = 0; c < sizeof(ciphers) / sizeof(ciphers[0]); c++) {
+        SrtpSymCrypto cipher(key, ciphers[c].keyLength, ciphers[c].algorithm);
+
+        snprintf(name, sizeof(name), "%s-block", ciphers[c].name);
+        measure(name, SRTP_BLOCK_SIZE, [&]() { cipher.encrypt(data, out); sink = out[0]; });
+
+        for (size_t s = 0; s < sizes.size(); s++) {
+            uint32_t size = (uint32_t)sizes[s];
+
+            snprintf(name, sizeof(name), "%s-ctr", ciphers[c].name);
+            measure(name, size, [&]() { cipher.ctr_encrypt(data, size, out, iv); sink = out[0]; });
+        }
+
+        // F8 uses a second cipher that holds the IV key
+        SrtpSymCrypto f8Cipher(key, ciphers[c].keyLength, fAlgorithms[c]);
+        SrtpSymCrypto f8IvCipher(fAlgorithms[c]);
+        f8Cipher.f8_deriveForIV(&f8IvCipher, key, ciphers[c].keyLength, salt, sizeof(salt));
+
+        for (size_t s = 0; s < sizes.size(); s++) {
+            uint32_t size = (uint32_t)sizes[s];
+
+            snprintf(name, sizeof(name), "%s-f8", ciphers[c].name);
+            measure(name, size, [&]() { f8Cipher.f8_encrypt(data, size, out, iv, &f8IvCipher); sink = out[0]; });
+        }
+    }
+}
+
+static void benchMacs(const std::vector<int32_t>& sizes, uint8_t* data, uint8_t* out)
+{
+    uint8_t key[64];
+    uint8_t roc[4] = {0, 0, 0, 1};
+
+    for (int i = 0; i < 64; i++)
+        key[i] = (uint8_t)(i * 3 + 11);
+
+    // The SRTP packet path: packet and ROC with a prepared context
+    void* sha1Ctx = createSha1HmacContext(key, 20);
+    for (size_t s = 0; s < sizes.size(); s++) {
+        measure("hmac-sha1", sizes[s], [&]() { hmacSha1Ctx2(sha1Ctx, data, sizes[s], roc, sizeof(roc), out); sink = out[0]; });
+    }
+    freeSha1HmacContext(sha1Ctx);
+
+    void* skeinCtx = createSkeinMacContext(key, 32, 32, Skein512);
+    for (size_t s = 0; s < sizes.size(); s++) {
+        measure("skein-mac", sizes[s], [&]() { macSkeinCtx(skeinCtx, data, sizes[s], roc, sizeof(roc), out); sink = out[0]; });
+    }
+    freeSkeinMacContext(skeinCtx);
+
+    hmacSha256Context sha256Ctx;
+    hmacSha384Context sha384Ctx;
+    initializeSha256HmacContext(&sha256Ctx, key, 32);
+    initializeSha384HmacContext(&sha384Ctx, key, 48);
+
+    for (size_t s = 0; s < sizes.size(); s++) {
+        const uint8_t* chunks[1] = { data };
+        const uint64_t lengths[1] = { (uint64_t)sizes[s] };
+        uint32_t macLength;
+
+        measure("hmac-sha256", sizes[s], [&]() { hmacSha256Ctx(&sha256Ctx, chunks, lengths, 1, out, &macLength); sink = out[0]; });
+        measure("hmac-sha384", sizes[s], [&]() { hmacSha384Ctx(&sha384Ctx, chunks, lengths, 1, out, &macLength); sink = out[0]; });
+    }
+    memset(&sha256Ctx, 0, sizeof(sha256Ctx));
+    memset(&sha384Ctx, 0, sizeof(sha384Ctx));
+}
+
+static void benchHashes(const std::vector<int32_t>& sizes, uint8_t* data, uint8_t* out)
+{
+    for (size_t s = 0; s < sizes.size(); s++) {
+        measure("sha256", sizes[s], [&]() { sha256(data, sizes[s], out); sink = out[0]; });
+        measure("sha384", sizes[s], [&]() { sha384(data, sizes[s], out); sink = out[0]; });
+    }
+    for (size_t s = 0; s < sizes.size(); s++) {
+        uint16_t size = (uint16_t)(sizes[s] > 0xffff ? 0xffff : sizes[s]);
+
+        measure("crc32c", size, [&]() { uint32_t crc = zrtpGenerateCksum(data, size); sink = (uint8_t)crc; });
+    }
+}
+
+/*
+ * The ZRTP KDF (RFC 6189, chapter 4.5.1): HMAC over counter, label, context and
+ * the length of the output, one prepared key context for all outputs. ZRTP
+ * derives seven keys of one negotiated hash after the DH exchange.
+ */
+static void benchKdf(uint8_t* out)
+{
+    static const char label[] = "Initiator SRTP master key";
+    uint8_t key[48];
+    uint8_t context[12 + 12 + 48];
+    uint32_t counter = zrtpHtonl(1);
+    uint32_t length = zrtpHtonl(256);
+
+    memset(key, 0x33, sizeof(key));
+    memset(context, 0x44, sizeof(context));
+
+    const uint8_t* chunks[4] = { (const uint8_t*)&counter, (const uint8_t*)label, context, (const uint8_t*)&length };
+    uint64_t lengths[4] = { sizeof(counter), sizeof(label), sizeof(context), sizeof(length) };
+
+    measure("kdf-sha256-7", 0, [&]() {
+        hmacSha256Context ctx;
+        uint32_t macLength;
+        initializeSha256HmacContext(&ctx, key, 32);
+        lengths[2] = 12 + 12 + 32;
+        for (int i = 0; i < 7; i++)
+            hmacSha256Ctx(&ctx, chunks, lengths, 4, out, &macLength);
+        sink = out[0];
+    });
+    measure("kdf-sha384-7", 0, [&]() {
+        hmacSha384Context ctx;
+        uint32_t macLength;
+        initializeSha384HmacContext(&ctx, key, 48);
+        lengths[2] = 12 + 12 + 48;
+        for (int i = 0; i < 7; i++)
+            hmacSha384Ctx(&ctx, chunks, lengths, 4, out, &macLength);
+        sink = out[0];
+    });
+}
+
+static void benchDh()
+{
+    // The OpenSSL backend supports the NIST curves only
+#ifdef ZRTP_OPENSSL
+    static const char* types[] = { "DH2k", "DH3k", "EC25", "EC38" };
+#else
+    static const char* types[] = { "DH2k", "DH3k", "EC25", "EC38", "E255", "E414" };
+#endif
+    uint8_t peerKey[1024];
+    uint8_t secret[1024];
+    char name[64];
+
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        const char* type = types[t];
+
+        // The constructor creates the private key, generatePublicKey the public key
+        snprintf(name, sizeof(name), "dh-%s-keygen", type);
+        measure(name, 0, [&]() {
+            ZrtpDH dh(type);
+            dh.generatePublicKey();
+        });
+
+        ZrtpDH own(type);
+        ZrtpDH peer(type);
+        own.generatePublicKey();
+        peer.generatePublicKey();
+        peer.getPubKeyBytes(peerKey);
+
+        snprintf(name, sizeof(name), "dh-%s-agree", type);
+        measure(name, 0, [&]() { own.computeSecretKey(peerKey, secret); sink = secret[0]; });
+    }
+}
+
+static void usage()
+{
+    fprintf(stderr, "Usage: cryptobench [-m milliseconds] [-s size[,size...]] [-c mask]\n");
+    fprintf(stderr, "  -m ms        minimal measuring time of each result, default 200\n");
+    fprintf(stderr, "  -s sizes     comma separated data sizes in bytes, default 16,64,160,1024,4096\n");
+    fprintf(stderr, "  -c mask      CPU feature mask, 0 disables the CPU specific code\n");
+}
+
+#ifdef ZRTP_BENCH_LIBRARY
+int cryptobenchMain(int argc, char* argv[])
+#else
+int main(int argc, char* argv[])
+#endif
+{
+    std::vector<int32_t> sizes(defaultSizes, defaultSizes + sizeof(defaultSizes) / sizeof(defaultSizes[0]));
+
+    // The Android benchmark harness runs the benchmark repeatedly in one process
+    minMilliseconds = defaultMilliseconds;
+    zrtpSetCpuFeatureMask(0xffffffff);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            minMilliseconds = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            sizes.clear();
+            for (char* p = strtok(argv[++i], ","); p != NULL; p = strtok(NULL, ","))
+                sizes.push_back(atoi(p));
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            zrtpSetCpuFeatureMask((uint32_t)strtoul(argv[++i], NULL, 0));
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+    int32_t maxSize = 0;
+    for (size_t s = 0; s < sizes.size(); s++) {
+        if (sizes[s] <= 0) {
+            usage();
+            return 1;
+        }
+        if (sizes[s] > maxSize)
+            maxSize = sizes[s];
+    }
+    if (minMilliseconds <= 0 || sizes.empty()) {
+        usage();
+        return 1;
+    }
+    std::vector<uint8_t> data(maxSize + 64);
+    std::vector<uint8_t> out(maxSize + 64);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (uint8_t)i;
+
+    printf("{\n  \"backend\": \"%s\",\n  \"cpu_features\": %u,\n  \"tsc\": %s,\n  \"results\": [",
+           backend, zrtpCpuFeatures(),
+#ifdef HAVE_TSC
+           "true"
+#else
+           "false"
+#endif
+           );
+
+    benchCiphers(sizes, &data[0], &out[0]);
+    benchMacs(sizes, &data[0], &out[0]);
+    benchHashes(sizes, &data[0], &out[0]);
+    benchKdf(&out[0]);
+    benchDh();
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,510 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * ZRTP handshake benchmark.
+ *
+ * Connects two ZRtp engines in one thread through an in-memory callback and
+ * measures the wall time and the CPU time of a complete handshake, from
+ * startZrtpEngine() until both engines are secure and the last packet is
+ * delivered. The benchmark runs each combination of public key type, hash and
+ * symmetric cipher in three modes, it skips the combinations of a 384 bit
+ * curve and a 256 bit hash:
+ *
+ * - dh-cold: DH handshake of engines with new ZIDs, the ZID cache has no
+ *   record of the peer
+ * - dh-warm: DH handshake of engines that did a handshake before, the cache
+ *   has the retained secrets of the peer
+ * - multistream: multi-stream handshake of streams of a secure master stream
+ *
+ * The engines use the default configuration flags, thus they compute the key
+ * agreement and access the ZID cache synchronously in the benchmark thread
+ * and the CPU time contains the complete work of both engines. The timers use
+ * a virtual clock: the loopback does not lose packets, if no engine has a
+ * packet to process the clock advances to the next timer of an engine and
+ * fires it. Thus the results do not contain timer waits, the "virtual_ms"
+ * value of a result is the virtual time the timers added per handshake and is
+ * zero for a handshake without retransmissions.
+ *
+ * Usage: handshakebench [-n handshakes] [-p pubkeys] [-h hashes] [-c ciphers] [-f zidfile] [-t tracefile]
+ *
+ * The lists are comma separated algorithm names, for example -p EC25,DH3k. The
+ * benchmark removes the ZID cache file before it starts. The output is a JSON
+ * document, the times of a result are microseconds per handshake. The
+ * "negotiated" value contains the algorithms the engines agreed on, the
+ * engines may select another algorithm than the configured one, for example
+ * the mandatory cipher if the Hello packet cannot announce the cipher. The
+ * "cache_hits" value counts the engines that found the RS1 of the peer, the
+ * streams of a multi-stream session take this state from their master.
+ *
+ * The option -t records the first engine of the first dh-cold handshake in a
+ * trace file, zrtpreplay replays it, see ZrtpTraceRecorder.
+ */
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <common/osSpecifics.h>
+#include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZrtpCallback.h>
+#include <libzrtpcpp/ZrtpConfigure.h>
+#include <libzrtpcpp/ZIDCache.h>
+#include <libzrtpcpp/ZrtpTrace.h>
+
+using namespace GnuZrtpCodes;
+
+/*
+ * The virtual time in milli-seconds, the engines of a pair arm their timers
+ * relative to this time.
+ */
+static int64_t virtualNow = 0;
+
+/*
+ * The engines of a pair send their packets to the inbox of the other engine.
+ * The benchmark runs in one thread, thus the inboxes and the callback need
+ * no locks.
+ */
+typedef std::deque<std::vector<uint8_t> > Inbox;
+
+class BenchCallback: public ZrtpCallback {
+public:
+    BenchCallback(): peer(NULL), timerActive(false), timerDeadline(0), secure(false), failed(false) {}
+
+    Inbox* peer;
+    bool timerActive;
+    int64_t timerDeadline;
+    bool secure;
+    bool failed;
+
+    int32_t sendDataZRTP(const uint8_t* data, int32_t length) {
+        peer->push_back(std::vector<uint8_t>(data, data + length));
+        return 1;
+    }
+    int32_t activateTimer(int32_t time) {
+        timerActive = true;
+        timerDeadline = virtualNow + time;
+        return 1;
+    }
+    int32_t cancelTimer() { timerActive = false; return 1; }
+    void sendInfo(MessageSeverity severity, int32_t subCode) {}
+    bool srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part) { return true; }
+    void srtpSecretsOff(EnableSecurity part) {}
+    void srtpSecretsOn(std::string c, std::string s, bool verified) { secure = true; }
+    void handleGoClear() {}
+    void zrtpNegotiationFailed(MessageSeverity severity, int32_t subCode) { failed = true; }
+    void zrtpNotSuppOther() { failed = true; }
+    void synchEnter() {}
+    void synchLeave() {}
+    void zrtpAskEnrollment(InfoEnrollment info) {}
+    void zrtpInformEnrollment(InfoEnrollment info) {}
+    void signSAS(uint8_t* sasHash) {}
+    bool checkSASSignature(uint8_t* sasHash) { return true; }
+};
+
+class EnginePair {
+public:
+    EnginePair(): engineA(NULL), engineB(NULL) {
+        callbackA.peer = &inboxB;
+        callbackB.peer = &inboxA;
+    }
+    ~EnginePair() {
+        delete engineA;
+        delete engineB;
+    }
+
+    Inbox inboxA;
+    Inbox inboxB;
+    BenchCallback callbackA;
+    BenchCallback callbackB;
+    ZRtp* engineA;
+    ZRtp* engineB;
+};
+
+static bool deliver(Inbox& inbox, ZRtp* engine)
+{
+    if (inbox.empty())
+        return false;
+
+    // processZrtpMessage expects the ZRTP message behind a 12 byte RTP header
+    std::vector<uint8_t> buffer(12 + inbox.front().size());
+    memcpy(&buffer[12], &inbox.front()[0], inbox.front().size());
+    inbox.pop_front();
+
+    engine->processZrtpMessage(&buffer[12], 0x12345678, buffer.size());
+    return true;
+}
+
+/*
+ * Fire the earliest timer of the pair and advance the virtual clock to its
+ * deadline. Returns false if no timer is active, the handshake is stuck then.
+ */
+static bool fireTimer(EnginePair* pair)
+{
+    BenchCallback* callback = NULL;
+    ZRtp* engine = NULL;
+
+    if (pair->callbackA.timerActive) {
+        callback = &pair->callbackA;
+        engine = pair->engineA;
+    }
+    if (pair->callbackB.timerActive && (callback == NULL || pair->callbackB.timerDeadline < callback->timerDeadline)) {
+        callback = &pair->callbackB;
+        engine = pair->engineB;
+    }
+    if (callback == NULL)
+        return false;
+
+    if (callback->timerDeadline > virtualNow)
+        virtualNow = callback->timerDeadline;
+    callback->timerActive = false;
+    engine->processTimeout();
+    return true;
+}
+
+typedef struct _Measurement {
+    int32_t handshakes;
+    int32_t failed;
+    int32_t cacheHits;          // engines that found the RS1 of the peer
+    int64_t wallSum;            // us
+    int64_t wallMin;            // us
+    int64_t cpuSum;             // us
+    int64_t virtualSum;         // ms
+} Measurement;
+
+static void clearMeasurement(Measurement* m)
+{
+    memset(m, 0, sizeof(Measurement));
+    m->wallMin = -1;
+}
+
+/*
+ * Start both engines and deliver the packets until both engines are secure.
+ * A handshake fails after 60 seconds of virtual time.
+ */
+static bool runHandshake(EnginePair* pair, Measurement* m)
+{
+    int64_t virtualStart = virtualNow;
+    uint64_t cpuStart = zrtpGetThreadCpuTime();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    pair->engineA->startZrtpEngine();
+    pair->engineB->startZrtpEngine();
+
+    bool success = true;
+    while (!(pair->callbackA.secure && pair->callbackB.secure)) {
+        if (pair->callbackA.failed || pair->callbackB.failed || virtualNow - virtualStart > 60000) {
+            success = false;
+            break;
+        }
+        bool delivered = deliver(pair->inboxA, pair->engineA);
+        delivered = deliver(pair->inboxB, pair->engineB) || delivered;
+        if (!delivered && !fireTimer(pair)) {
+            success = false;
+            break;
+        }
+    }
+    // Deliver the remaining packets, for example the Conf2Ack
+    while (success && (deliver(pair->inboxA, pair->engineA) || deliver(pair->inboxB, pair->engineB)))
+        ;
+
+    int64_t wall = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    int64_t cpu = static_cast<int64_t>(zrtpGetThreadCpuTime() - cpuStart);
+
+    if (m == NULL)
+        return success;
+    if (!success) {
+        m->failed++;
+        return false;
+    }
+    m->handshakes++;
+    m->wallSum += wall;
+    m->cpuSum += cpu;
+    m->virtualSum += virtualNow - virtualStart;
+    if (m->wallMin < 0 || wall < m->wallMin)
+        m->wallMin = wall;
+    if ((pair->engineA->getDetailInfo()->secretsMatched & ZRtp::Rs1) != 0)
+        m->cacheHits++;
+    if ((pair->engineB->getDetailInfo()->secretsMatched & ZRtp::Rs1) != 0)
+        m->cacheHits++;
+    return true;
+}
+
+static void randomZid(uint8_t* zid)
+{
+    for (int32_t k = 0; k < IDENTIFIER_LEN; k++)
+        zid[k] = (uint8_t)rand();
+}
+
+static EnginePair* createPair(const uint8_t* zidA, const uint8_t* zidB, ZrtpConfigure* config, ZrtpConfigure* configA = NULL)
+{
+    EnginePair* pair = new EnginePair;
+    pair->engineA = new ZRtp(const_cast<uint8_t*>(zidA), &pair->callbackA, "handshakebench A", configA != NULL ? configA : config);
+    pair->engineB = new ZRtp(const_cast<uint8_t*>(zidB), &pair->callbackB, "handshakebench B", config);
+    return pair;
+}
+
+static EnginePair* createStreams(EnginePair* master)
+{
+    EnginePair* pair = new EnginePair;
+    pair->engineA = new ZRtp(&pair->callbackA, master->engineA);
+    pair->engineB = new ZRtp(&pair->callbackB, master->engineB);
+    return pair;
+}
+
+static bool firstResult;
+static ZrtpTraceRecorder* recorder = NULL;
+
+static void printResult(const char* mode, const char* pubKey, const char* hash, const char* cipher,
+                        const char* negotiated, const Measurement& m)
+{
+    int32_t n = m.handshakes > 0 ? m.handshakes : 1;
+
+    printf("%s\n    {\"mode\": \"%s\", \"pubkey\": \"%s\", \"hash\": \"%s\", \"cipher\": \"%s\", \"negotiated\": \"%s\", "
+           "\"handshakes\": %d, \"failed\": %d, \"cache_hits\": %d, \"wall_us\": %lld, \"wall_min_us\": %lld, "
+           "\"cpu_us\": %lld, \"virtual_ms\": %lld}",
+           firstResult ? "" : ",", mode, pubKey, hash, cipher, negotiated, m.handshakes, m.failed, m.cacheHits,
+           (long long)(m.wallSum / n), (long long)m.wallMin, (long long)(m.cpuSum / n), (long long)(m.virtualSum / n));
+    firstResult = false;
+}
+
+static std::string negotiatedNames(EnginePair* pair)
+{
+    const ZRtp::zrtpInfo* info = pair->engineA->getDetailInfo();
+    std::string names;
+
+    names.append(info->pubKey != NULL ? info->pubKey : "-").append("/");
+    names.append(info->hash != NULL ? info->hash : "-").append("/");
+    names.append(info->cipher != NULL ? info->cipher : "-");
+    return names;
+}
+
+/*
+ * Run the three modes of one combination, returns the number of failed handshakes.
+ */
+static int32_t benchCombination(const char* pubKey, const char* hash, const char* cipher, int32_t handshakes)
+{
+    ZrtpConfigure config;
+    config.clear();
+    config.addAlgo(PubKeyAlgorithm, zrtpPubKeys.getByName(pubKey));
+    config.addAlgo(PubKeyAlgorithm, zrtpPubKeys.getByName("Mult"));
+    config.addAlgo(HashAlgorithm, zrtpHashes.getByName(hash));
+    config.addAlgo(CipherAlgorithm, zrtpSymCiphers.getByName(cipher));
+    config.addAlgo(SasType, zrtpSasTypes.getByName("B32 "));
+    config.addAlgo(AuthLength, zrtpAuthLengths.getByName("HS32"));
+    config.addAlgo(AuthLength, zrtpAuthLengths.getByName("HS80"));
+    // The ChaCha20 cipher requires the Poly1305 tag, without it the engines fall back to AES
+    if (strcmp(cipher, "CC20") == 0)
+        config.addAlgo(AuthLength, zrtpAuthLengths.getByName("CP16"));
+
+    Measurement m;
+    std::string negotiated;
+    uint8_t zidA[IDENTIFIER_LEN];
+    uint8_t zidB[IDENTIFIER_LEN];
+    int32_t failed = 0;
+
+    clearMeasurement(&m);
+    for (int32_t i = 0; i < handshakes; i++) {
+        randomZid(zidA);
+        randomZid(zidB);
+        ZrtpConfigure traced(config);
+        traced.setTrace(recorder);
+        EnginePair* pair = createPair(zidA, zidB, &config, recorder != NULL ? &traced : NULL);
+        recorder = NULL;
+        runHandshake(pair, &m);
+        if (negotiated.empty() && pair->callbackA.secure)
+            negotiated = negotiatedNames(pair);
+        delete pair;
+    }
+    printResult("dh-cold", pubKey, hash, cipher, negotiated.c_str(), m);
+    failed += m.failed;
+
+    // The first handshake of the two ZIDs fills the cache
+    randomZid(zidA);
+    randomZid(zidB);
+    EnginePair* master = createPair(zidA, zidB, &config);
+    if (!runHandshake(master, NULL)) {
+        delete master;
+        return failed + 1;
+    }
+    delete master;
+
+    clearMeasurement(&m);
+    master = NULL;
+    for (int32_t i = 0; i < handshakes; i++) {
+        EnginePair* pair = createPair(zidA, zidB, &config);
+        if (runHandshake(pair, &m) && master == NULL) {
+            master = pair;          // keep a secure pair as master of the multi-stream handshakes
+            continue;
+        }
+        delete pair;
+    }
+    printResult("dh-warm", pubKey, hash, cipher, negotiated.c_str(), m);
+    failed += m.failed;
+
+    if (master == NULL)
+        return failed;
+
+    clearMeasurement(&m);
+    for (int32_t i = 0; i < handshakes; i++) {
+        EnginePair* pair = createStreams(master);
+        runHandshake(pair, &m);
+        delete pair;
+    }
+    printResult("multistream", pubKey, hash, cipher, negotiated.c_str(), m);
+    failed += m.failed;
+
+    delete master;
+    return failed;
+}
+
+static const char* defaultPubKeys[] = {
+    "DH2k", "DH3k", "EC25", "EC38",
+#ifdef SUPPORT_NON_NIST
+    "E255", "E414",
+#endif
+};
+static const char* defaultHashes[] = { "S256", "S384", "SKN2", "SKN3" };
+static const char* defaultCiphers[] = { "AES1", "AES3", "2FS1", "2FS3", "CC20" };
+
+static bool parseList(const char* arg, EnumBase& algos, std::vector<std::string>& names)
+{
+    std::string list(arg);
+    size_t start = 0;
+
+    names.clear();
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos)
+            end = list.size();
+        std::string name = list.substr(start, end - start);
+        // The algorithm names have 4 characters, "B32 " for example ends with a blank
+        name.resize(4, ' ');
+        if (!algos.getByName(name.c_str()).isValid()) {
+            fprintf(stderr, "Unknown algorithm %s\n", list.substr(start, end - start).c_str());
+            return false;
+        }
+        names.push_back(name);
+        start = end + 1;
+    }
+    return true;
+}
+
+/*
+ * The 384 bit curves require a 384 bit hash, the engines do not negotiate them
+ * with a 256 bit hash.
+ */
+static bool validCombination(const std::string& pubKey, const std::string& hash)
+{
+    bool strongPubKey = pubKey == "EC38" || pubKey == "E414";
+    bool strongHash = hash == "S384" || hash == "SKN3";
+    return !strongPubKey || strongHash;
+}
+
+static void usage()
+{
+    fprintf(stderr, "Usage: handshakebench [-n handshakes] [-p pubkeys] [-h hashes] [-c ciphers] [-f zidfile] [-t tracefile]\n");
+    fprintf(stderr, "  -n handshakes  handshakes per mode and combination, default 10\n");
+    fprintf(stderr, "  -p pubkeys     public key types, default all\n");
+    fprintf(stderr, "  -h hashes      hash algorithms, default all\n");
+    fprintf(stderr, "  -c ciphers     symmetric ciphers, default all\n");
+    fprintf(stderr, "  -f zidfile     ZID cache file, default handshakebench.zid\n");
+    fprintf(stderr, "  -t tracefile   record a trace of the first handshake\n");
+}
+
+#ifdef ZRTP_BENCH_LIBRARY
+int handshakebenchMain(int argc, char* argv[])
+#else
+int main(int argc, char* argv[])
+#endif
+{
+    std::vector<std::string> pubKeys(defaultPubKeys, defaultPubKeys + sizeof(defaultPubKeys) / sizeof(defaultPubKeys[0]));
+    std::vector<std::string> hashes(defaultHashes, defaultHashes + sizeof(defaultHashes) / sizeof(defaultHashes[0]));
+    std::vector<std::string> ciphers(defaultCiphers, defaultCiphers + sizeof(defaultCiphers) / sizeof(defaultCiphers[0]));
+    int32_t handshakes = 10;
+    const char* zidFile = "handshakebench.zid";
+    const char* traceFile = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        bool valid = i + 1 < argc;
+        if (valid && strcmp(argv[i], "-n") == 0) {
+            handshakes = atoi(argv[++i]);
+        }
+        else if (valid && strcmp(argv[i], "-p") == 0) {
+            valid = parseList(argv[++i], zrtpPubKeys, pubKeys);
+        }
+        else if (valid && strcmp(argv[i], "-h") == 0) {
+            valid = parseList(argv[++i], zrtpHashes, hashes);
+        }
+        else if (valid && strcmp(argv[i], "-c") == 0) {
+            valid = parseList(argv[++i], zrtpSymCiphers, ciphers);
+        }
+        else if (valid && strcmp(argv[i], "-f") == 0) {
+            zidFile = argv[++i];
+        }
+        else if (valid && strcmp(argv[i], "-t") == 0) {
+            traceFile = argv[++i];
+        }
+        else {
+            valid = false;
+        }
+        if (!valid) {
+            usage();
+            return 1;
+        }
+    }
+    if (handshakes <= 0) {
+        usage();
+        return 1;
+    }
+    remove(zidFile);
+    if (getZidCacheInstance()->open(const_cast<char*>(zidFile)) < 0) {
+        fprintf(stderr, "Cannot open the ZID cache %s\n", zidFile);
+        return 1;
+    }
+    ZrtpTraceRecorder* traceRecorder = NULL;
+    if (traceFile != NULL) {
+        traceRecorder = new ZrtpTraceRecorder(traceFile);
+        if (!traceRecorder->isOpen()) {
+            fprintf(stderr, "Cannot create the trace file %s\n", traceFile);
+            return 1;
+        }
+        recorder = traceRecorder;
+    }
+    printf("{\n  \"handshakes\": %d,\n  \"results\": [", handshakes);
+    firstResult = true;
+
+    int32_t failed = 0;
+    for (size_t p = 0; p < pubKeys.size(); p++) {
+        for (size_t h = 0; h < hashes.size(); h++) {
+            if (!validCombination(pubKeys[p], hashes[h]))
+                continue;
+            for (size_t c = 0; c < ciphers.size(); c++)
+                failed += benchCombination(pubKeys[p].c_str(), hashes[h].c_str(), ciphers[c].c_str(), handshakes);
+        }
+    }
+
+    printf("\n  ],\n  \"failed_handshakes\": %d\n}\n", failed);
+    delete traceRecorder;
+    getZidCacheInstance()->close();
+    return failed == 0 ? 0 : 1;
+}
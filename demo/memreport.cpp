@@ -0,0 +1,389 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Memory footprint report.
+ *
+ * Runs ZRTP handshakes between pairs of engines in one process and reports the
+ * memory of an engine after its construction, after the start and in secure
+ * state, then reports the memory of the SRTP and SRTCP crypto contexts of each
+ * crypto suite. Each result contains the bytes per category of MemoryUsage, see
+ * ZRtp::addMemoryUsage() and CryptoContext::addMemoryUsage().
+ *
+ * The demo replaces the global operator new and delete with a counting
+ * allocator. The "heap" value of a result is the number of bytes that the
+ * counting allocator handed out per engine or per context. The value also
+ * contains the memory that the report does not account for, for example the
+ * packet queues of the demo or the rounding of the SRTP memory pool. The
+ * BigNum library allocates with malloc, thus the "heap" value does not contain
+ * the BigNum storage of the key agreement.
+ *
+ * Usage: memreport [-n pairs] [-f zidfile]
+ *
+ * The output is a JSON document.
+ */
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <common/MemoryUsage.h>
+#include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZrtpCallback.h>
+#include <libzrtpcpp/ZrtpConfigure.h>
+#include <libzrtpcpp/ZIDCache.h>
+#include <srtp/CryptoContext.h>
+#include <srtp/CryptoContextCtrl.h>
+
+using namespace GnuZrtpCodes;
+
+/*
+ * The counting allocator keeps the size of a block in front of the block.
+ */
+static std::atomic<int64_t> heapBytes(0);
+static const size_t blockHeader = 16;
+
+void* operator new(size_t size)
+{
+    size_t* block = static_cast<size_t*>(malloc(size + blockHeader));
+    if (block == NULL)
+        throw std::bad_alloc();
+    *block = size;
+    heapBytes.fetch_add(size, std::memory_order_relaxed);
+    return reinterpret_cast<uint8_t*>(block) + blockHeader;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr == NULL)
+        return;
+    size_t* block = reinterpret_cast<size_t*>(reinterpret_cast<uintptr_t>(ptr) - blockHeader);
+    heapBytes.fetch_sub(*block, std::memory_order_relaxed);
+    free(block);
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    try { return operator new(size); } catch (...) { return NULL; }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    try { return operator new(size); } catch (...) { return NULL; }
+}
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { operator delete(ptr); }
+
+/*
+ * The engines of a pair send their packets to the inbox of the other engine.
+ */
+struct Inbox {
+    std::mutex lock;
+    std::deque<std::vector<uint8_t> > packets;
+};
+
+class LoopbackCallback: public ZrtpCallback {
+public:
+    LoopbackCallback(): peer(NULL), timerActive(false), secure(false), failed(false) {}
+
+    Inbox* peer;
+    std::atomic<bool> timerActive;
+    std::atomic<bool> secure;
+    std::atomic<bool> failed;
+    std::recursive_mutex synchLock;
+
+    int32_t sendDataZRTP(const uint8_t* data, int32_t length) {
+        std::lock_guard<std::mutex> guard(peer->lock);
+        peer->packets.push_back(std::vector<uint8_t>(data, data + length));
+        return 1;
+    }
+    int32_t activateTimer(int32_t time) { timerActive = true; return 1; }
+    int32_t cancelTimer() { timerActive = false; return 1; }
+    void sendInfo(MessageSeverity severity, int32_t subCode) {}
+    bool srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part) { return true; }
+    void srtpSecretsOff(EnableSecurity part) {}
+    void srtpSecretsOn(std::string c, std::string s, bool verified) { secure = true; }
+    void handleGoClear() {}
+    void zrtpNegotiationFailed(MessageSeverity severity, int32_t subCode) { failed = true; }
+    void zrtpNotSuppOther() { failed = true; }
+    void synchEnter() { synchLock.lock(); }
+    void synchLeave() { synchLock.unlock(); }
+    void zrtpAskEnrollment(InfoEnrollment info) {}
+    void zrtpInformEnrollment(InfoEnrollment info) {}
+    void signSAS(uint8_t* sasHash) {}
+    bool checkSASSignature(uint8_t* sasHash) { return true; }
+};
+
+typedef struct _EnginePair {
+    Inbox inboxA;
+    Inbox inboxB;
+    LoopbackCallback callbackA;
+    LoopbackCallback callbackB;
+    ZRtp* engineA;
+    ZRtp* engineB;
+} EnginePair;
+
+static bool deliver(Inbox& inbox, ZRtp* engine, LoopbackCallback& callback)
+{
+    std::vector<uint8_t> packet;
+    {
+        std::lock_guard<std::mutex> guard(inbox.lock);
+        if (inbox.packets.empty())
+            return false;
+        packet.swap(inbox.packets.front());
+        inbox.packets.pop_front();
+    }
+    // processZrtpMessage expects the ZRTP message behind a 12 byte RTP header
+    std::vector<uint8_t> buffer(12 + packet.size());
+    memcpy(&buffer[12], &packet[0], packet.size());
+
+    callback.synchEnter();
+    engine->processZrtpMessage(&buffer[12], 0x12345678, buffer.size());
+    callback.synchLeave();
+    return true;
+}
+
+/*
+ * Deliver the packets until both engines are secure, the loopback does not lose
+ * packets, thus the timers fire only while a worker thread computes a key.
+ */
+static bool runHandshake(EnginePair* pair)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int32_t idle = 0;
+
+    while (!(pair->callbackA.secure && pair->callbackB.secure)) {
+        if (pair->callbackA.failed || pair->callbackB.failed)
+            return false;
+        if (std::chrono::steady_clock::now() - start > std::chrono::seconds(10))
+            return false;
+
+        bool delivered = deliver(pair->inboxA, pair->engineA, pair->callbackA);
+        delivered = deliver(pair->inboxB, pair->engineB, pair->callbackB) || delivered;
+        if (delivered) {
+            idle = 0;
+            continue;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (++idle < 50)
+            continue;
+        idle = 0;
+        if (pair->callbackA.timerActive)
+            pair->engineA->processTimeout();
+        if (pair->callbackB.timerActive)
+            pair->engineB->processTimeout();
+    }
+    // Deliver the remaining packets, for example the Conf2Ack
+    while (deliver(pair->inboxA, pair->engineA, pair->callbackA) || deliver(pair->inboxB, pair->engineB, pair->callbackB))
+        ;
+    return true;
+}
+
+static bool firstResult;
+
+static void printResult(const char* name, const MemoryUsage& usage, int64_t heap, int32_t objects)
+{
+    printf("%s\n    {\"name\": \"%s\"", firstResult ? "" : ",", name);
+    for (int32_t i = 0; i < MemoryUsage::NumberOfCategories; i++) {
+        MemoryUsage::Category category = static_cast<MemoryUsage::Category>(i);
+        printf(", \"%s\": %zu", MemoryUsage::getName(category), usage.get(category) / objects);
+    }
+    printf(", \"total\": %zu, \"heap\": %lld}", usage.getTotal() / objects, (long long)(heap / objects));
+    firstResult = false;
+}
+
+static void engineUsage(std::vector<EnginePair*>& pairs, MemoryUsage& usage)
+{
+    usage.clear();
+    for (size_t i = 0; i < pairs.size(); i++) {
+        pairs[i]->callbackA.synchEnter();
+        pairs[i]->engineA->addMemoryUsage(usage);
+        pairs[i]->callbackA.synchLeave();
+        pairs[i]->callbackB.synchEnter();
+        pairs[i]->engineB->addMemoryUsage(usage);
+        pairs[i]->callbackB.synchLeave();
+    }
+}
+
+static int32_t reportEngines(int32_t numPairs)
+{
+    ZrtpConfigure config;
+    config.setStandardConfig();
+
+    MemoryUsage usage;
+    std::vector<EnginePair*> pairs;
+    int32_t engines = numPairs * 2;
+    int32_t failed = 0;
+
+    pairs.reserve(numPairs);
+    int64_t base = heapBytes.load();
+    for (int32_t i = 0; i < numPairs; i++) {
+        uint8_t zidA[IDENTIFIER_LEN];
+        uint8_t zidB[IDENTIFIER_LEN];
+        for (int32_t k = 0; k < IDENTIFIER_LEN; k++) {
+            zidA[k] = (uint8_t)rand();
+            zidB[k] = (uint8_t)rand();
+        }
+        EnginePair* pair = new EnginePair;
+        pair->callbackA.peer = &pair->inboxB;
+        pair->callbackB.peer = &pair->inboxA;
+        pair->engineA = new ZRtp(zidA, &pair->callbackA, "memreport A", &config);
+        pair->engineB = new ZRtp(zidB, &pair->callbackB, "memreport B", &config);
+        pairs.push_back(pair);
+    }
+    engineUsage(pairs, usage);
+    printResult("zrtp-created", usage, heapBytes.load() - base, engines);
+
+    for (size_t i = 0; i < pairs.size(); i++) {
+        pairs[i]->engineA->startZrtpEngine();
+        pairs[i]->engineB->startZrtpEngine();
+    }
+    engineUsage(pairs, usage);
+    printResult("zrtp-started", usage, heapBytes.load() - base, engines);
+
+    for (size_t i = 0; i < pairs.size(); i++) {
+        if (!runHandshake(pairs[i]))
+            failed++;
+    }
+    engineUsage(pairs, usage);
+    printResult("zrtp-secure", usage, heapBytes.load() - base, engines);
+
+    for (size_t i = 0; i < pairs.size(); i++) {
+        delete pairs[i]->engineA;
+        delete pairs[i]->engineB;
+        delete pairs[i];
+    }
+    return failed;
+}
+
+typedef struct _SrtpSuite {
+    int32_t ealg;
+    int32_t aalg;
+    int32_t keyLength;          // encryption key length in bytes
+    int32_t tagLength;          // authentication tag length in bytes
+    const char* name;
+} SrtpSuite;
+
+static const SrtpSuite suites[] = {
+    { SrtpEncryptionAESCM, SrtpAuthenticationSha1Hmac,  16, 10, "srtp-aes-cm-128-hmac-sha1" },
+    { SrtpEncryptionAESCM, SrtpAuthenticationSkeinHmac, 32,  4, "srtp-aes-cm-256-skein"     },
+    { SrtpEncryptionAESF8, SrtpAuthenticationSha1Hmac,  16, 10, "srtp-aes-f8-128-hmac-sha1" },
+    { SrtpEncryptionTWOCM, SrtpAuthenticationSha1Hmac,  16, 10, "srtp-2fish-cm-128-hmac-sha1" },
+    { SrtpEncryptionAESGCM128, SrtpAuthenticationNull,  16, 16, "srtp-aes-gcm-128"          },
+    { SrtpEncryptionCHACHA20POLY1305, SrtpAuthenticationNull, 32, 16, "srtp-chacha20-poly1305" },
+};
+
+/*
+ * Report one sender pair of contexts, SRTP and SRTCP, per suite.
+ */
+static void reportSrtp(int32_t numContexts)
+{
+    uint8_t masterKey[32];
+    uint8_t masterSalt[14];
+
+    for (int32_t i = 0; i < 32; i++)
+        masterKey[i] = (uint8_t)(i * 7 + 1);
+    for (int32_t i = 0; i < 14; i++)
+        masterSalt[i] = (uint8_t)(i * 13 + 5);
+
+    for (size_t s = 0; s < sizeof(suites) / sizeof(suites[0]); s++) {
+        const SrtpSuite* suite = &suites[s];
+        bool aead = suite->aalg == SrtpAuthenticationNull;
+        int32_t saltLength = aead ? 12 : 14;
+        std::vector<CryptoContext*> contexts;
+        std::vector<CryptoContextCtrl*> controls;
+        MemoryUsage usage;
+
+        contexts.reserve(numContexts);
+        controls.reserve(numContexts);
+        int64_t base = heapBytes.load();
+        for (int32_t i = 0; i < numContexts; i++) {
+            CryptoContext* context = new CryptoContext(0x12345678 + i, 0, 0L, suite->ealg, suite->aalg,
+                                                       masterKey, suite->keyLength, masterSalt, saltLength,
+                                                       suite->keyLength, 20, saltLength, suite->tagLength);
+            CryptoContextCtrl* control = new CryptoContextCtrl(0x12345678 + i, suite->ealg, suite->aalg,
+                                                               masterKey, suite->keyLength, masterSalt, saltLength,
+                                                               suite->keyLength, 20, saltLength, suite->tagLength);
+            context->deriveSrtpKeys(0, control);
+            contexts.push_back(context);
+            controls.push_back(control);
+        }
+        int64_t heap = heapBytes.load() - base;
+        for (int32_t i = 0; i < numContexts; i++) {
+            contexts[i]->addMemoryUsage(usage);
+            controls[i]->addMemoryUsage(usage);
+        }
+        printResult(suite->name, usage, heap, numContexts);
+
+        for (int32_t i = 0; i < numContexts; i++) {
+            delete contexts[i];
+            delete controls[i];
+        }
+    }
+}
+
+static void usage()
+{
+    fprintf(stderr, "Usage: memreport [-n pairs] [-f zidfile]\n");
+    fprintf(stderr, "  -n pairs     number of engine pairs and crypto contexts, default 16\n");
+    fprintf(stderr, "  -f zidfile   ZID cache file, default memreport.zid\n");
+}
+
+int main(int argc, char* argv[])
+{
+    int32_t numPairs = 16;
+    const char* zidFile = "memreport.zid";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            numPairs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            zidFile = argv[++i];
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (numPairs <= 0) {
+        usage();
+        return 1;
+    }
+    if (getZidCacheInstance()->open(const_cast<char*>(zidFile)) < 0) {
+        fprintf(stderr, "Cannot open the ZID cache %s\n", zidFile);
+        return 1;
+    }
+    printf("{\n  \"pairs\": %d,\n  \"results\": [", numPairs);
+    firstResult = true;
+
+    int32_t failed = reportEngines(numPairs);
+    reportSrtp(numPairs);
+
+    printf("\n  ],\n  \"failed_handshakes\": %d\n}\n", failed);
+    return failed == 0 ? 0 : 1;
+}
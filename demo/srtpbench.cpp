@@ -0,0 +1,250 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * SRTP micro benchmark.
+ *
+ * Measures packets per second and nanoseconds per packet of SrtpHandler::protect
+ * and SrtpHandler::unprotect for all encryption and authentication algorithms
+ * and several payload sizes. The crypto backend (standalone or OpenSSL) is
+ * selected when building the library, build the library with the other backend
+ * and run srtpbench again to compare the backends.
+ *
+ * Usage: srtpbench [-n packets] [-t threads] [-s size[,size...]] [-j]
+ *
+ * With more than one thread each thread protects and unprotects its own packet
+ * stream with its own crypto contexts. The result shows the sum of all threads.
+ * With @c -j the benchmark writes the results as JSON, in the same layout as
+ * cryptobench.
+ */
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <srtp/SrtpHandler.h>
+#include <srtp/CryptoContext.h>
+
+#ifdef ZRTP_OPENSSL
+static const char* backend = "OpenSSL";
+#else
+static const char* backend = "standalone";
+#endif
+
+typedef struct _BenchAlgorithm {
+    int32_t ealg;
+    int32_t aalg;
+    int32_t keyLength;          // encryption key length in bytes
+    int32_t tagLength;          // authentication tag length in bytes
+    const char* name;
+} BenchAlgorithm;
+
+// Null encryption is not listed: the key derivation needs a cipher
+static const BenchAlgorithm algorithms[] = {
+    { SrtpEncryptionAESCM, SrtpAuthenticationNull,      16,  0, "AES-CM-128   NULL-MAC"  },
+    { SrtpEncryptionAESCM, SrtpAuthenticationSha1Hmac,  16, 10, "AES-CM-128   HMAC-SHA1" },
+    { SrtpEncryptionAESCM, SrtpAuthenticationSha1Hmac,  32,  4, "AES-CM-256   HMAC-SHA1" },
+    { SrtpEncryptionAESCM, SrtpAuthenticationSkeinHmac, 16,  4, "AES-CM-128   Skein-MAC" },
+    { SrtpEncryptionAESF8, SrtpAuthenticationSha1Hmac,  16, 10, "AES-F8-128   HMAC-SHA1" },
+    { SrtpEncryptionTWOCM, SrtpAuthenticationSha1Hmac,  16, 10, "2FISH-CM-128 HMAC-SHA1" },
+    { SrtpEncryptionTWOCM, SrtpAuthenticationSkeinHmac, 32,  4, "2FISH-CM-256 Skein-MAC" },
+    { SrtpEncryptionTWOF8, SrtpAuthenticationSha1Hmac,  16, 10, "2FISH-F8-128 HMAC-SHA1" },
+    { SrtpEncryptionAESGCM128, SrtpAuthenticationNull,  16, 16, "AES-GCM-128"            },
+    { SrtpEncryptionAESGCM256, SrtpAuthenticationNull,  32, 16, "AES-GCM-256"            },
+};
+
+static const int32_t defaultSizes[] = {20, 60, 160, 320, 640, 1000, 1400};
+
+typedef struct _BenchResult {
+    double protectSeconds;
+    double unprotectSeconds;
+    int32_t errors;
+} BenchResult;
+
+static CryptoContext* createContext(const BenchAlgorithm* alg)
+{
+    uint8_t masterKey[32];
+    uint8_t masterSalt[14];
+
+    for (int i = 0; i < 32; i++)
+        masterKey[i] = (uint8_t)(i * 7 + 1);
+    for (int i = 0; i < 14; i++)
+        masterSalt[i] = (uint8_t)(i * 13 + 5);
+
+    bool gcm = alg->ealg == SrtpEncryptionAESGCM128 || alg->ealg == SrtpEncryptionAESGCM256;
+
+    CryptoContext* pcc = new CryptoContext(0x12345678, 0, 0L,
+                                           alg->ealg, alg->aalg,
+                                           masterKey, alg->keyLength,
+                                           masterSalt, gcm ? 12 : 14,
+                                           alg->keyLength,
+                                           20,                  // authentication key length (SHA1)
+                                           gcm ? 12 : 14,       // session salt length
+                                           alg->tagLength);
+    pcc->deriveSrtpKeys(0);
+    return pcc;
+}
+
+static void runBench(const BenchAlgorithm* alg, int32_t payloadSize, int32_t packets, BenchResult* result)
+{
+    CryptoContext* sender = createContext(alg);
+    CryptoContext* receiver = createContext(alg);
+
+    const int32_t packetLength = RTP_HEADER_LENGTH + payloadSize;
+    std::vector<std::vector<uint8_t> > srtp(packets);
+    std::vector<size_t> srtpLength(packets);
+
+    // Prepare all RTP packets first, the buffers have room for the tag
+    for (int32_t n = 0; n < packets; n++) {
+        std::vector<uint8_t>& buffer = srtp[n];
+
+        buffer.resize(packetLength + 64);
+        for (int32_t i = 0; i < packetLength; i++)
+            buffer[i] = (uint8_t)i;
+        buffer[0] = 0x80;
+        buffer[1] = 0;
+        buffer[2] = (uint8_t)(n >> 8);
+        buffer[3] = (uint8_t)n;
+        buffer[8] = 0x12; buffer[9] = 0x34; buffer[10] = 0x56; buffer[11] = 0x78;
+    }
+    result->errors = 0;
+
+    // Protect, the result of each packet is the input of the unprotect run
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int32_t n = 0; n < packets; n++) {
+        if (!SrtpHandler::protect(sender, &srtp[n][0], packetLength, &srtpLength[n]))
+            result->errors++;
+    }
+    std::chrono::steady_clock::duration protectTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int32_t n = 0; n < packets; n++) {
+        size_t newLength;
+        if (SrtpHandler::unprotect(receiver, &srtp[n][0], srtpLength[n], &newLength) != 1)
+            result->errors++;
+    }
+    std::chrono::steady_clock::duration unprotectTime = std::chrono::steady_clock::now() - start;
+
+    result->protectSeconds = std::chrono::duration<double>(protectTime).count();
+    result->unprotectSeconds = std::chrono::duration<double>(unprotectTime).count();
+
+    delete sender;
+    delete receiver;
+}
+
+static void usage()
+{
+    fprintf(stderr, "Usage: srtpbench [-n packets] [-t threads] [-s size[,size...]]\n");
+    fprintf(stderr, "  -n packets   number of packets per run and thread, default 20000\n");
+    fprintf(stderr, "  -t threads   number of threads, default 1\n");
+    fprintf(stderr, "  -s sizes     comma separated payload sizes in bytes, default 20,60,160,320,640,1000,1400\n");
+    fprintf(stderr, "  -j           write the results as JSON\n");
+}
+
+#ifdef ZRTP_BENCH_LIBRARY
+int srtpbenchMain(int argc, char* argv[])
+#else
+int main(int argc, char* argv[])
+#endif
+{
+    int32_t packets = 20000;
+    int32_t threads = 1;
+    bool json = false;
+    std::vector<int32_t> sizes(defaultSizes, defaultSizes + sizeof(defaultSizes) / sizeof(defaultSizes[0]));
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            packets = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            sizes.clear();
+            for (char* p = strtok(argv[++i], ","); p != NULL; p = strtok(NULL, ","))
+                sizes.push_back(atoi(p));
+        }
+        else if (strcmp(argv[i], "-j") == 0) {
+            json = true;
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+    // Packets use a 16 bit sequence number without ROC handling in the benchmark
+    if (packets <= 0 || packets > 65535 || threads <= 0 || sizes.empty()) {
+        usage();
+        return 1;
+    }
+
+    if (json) {
+        printf("{\n  \"backend\": \"%s\",\n  \"packets\": %d,\n  \"threads\": %d,\n  \"results\": [",
+               backend, packets, threads);
+    }
+    else {
+        printf("SRTP benchmark, backend: %s, packets per run: %d, threads: %d\n\n", backend, packets, threads);
+        printf("%-24s %6s %12s %10s %12s %10s\n", "algorithm", "bytes",
+               "protect/s", "ns/pkt", "unprotect/s", "ns/pkt");
+    }
+    const char* separator = "";
+
+    const int32_t numAlgorithms = sizeof(algorithms) / sizeof(algorithms[0]);
+
+    for (int32_t a = 0; a < numAlgorithms; a++) {
+        for (size_t s = 0; s < sizes.size(); s++) {
+            std::vector<BenchResult> results(threads);
+            std::vector<std::thread> workers;
+
+            for (int32_t t = 0; t < threads; t++)
+                workers.push_back(std::thread(runBench, &algorithms[a], sizes[s], packets, &results[t]));
+            for (int32_t t = 0; t < threads; t++)
+                workers[t].join();
+
+            // Sum the packet rates of all threads, ns per packet is the average of the threads
+            double protectRate = 0.0, unprotectRate = 0.0;
+            double protectNs = 0.0, unprotectNs = 0.0;
+            int32_t errors = 0;
+            for (int32_t t = 0; t < threads; t++) {
+                protectRate += packets / results[t].protectSeconds;
+                unprotectRate += packets / results[t].unprotectSeconds;
+                protectNs += results[t].protectSeconds * 1e9 / packets;
+                unprotectNs += results[t].unprotectSeconds * 1e9 / packets;
+                errors += results[t].errors;
+            }
+            if (json) {
+                printf("%s\n    {\"name\": \"%s\", \"bytes\": %d, \"protect_per_s\": %.1f, \"protect_ns\": %.1f, "
+                       "\"unprotect_per_s\": %.1f, \"unprotect_ns\": %.1f, \"errors\": %d}", separator,
+                       algorithms[a].name, sizes[s], protectRate, protectNs / threads,
+                       unprotectRate, unprotectNs / threads, errors);
+                separator = ",";
+            }
+            else {
+                printf("%-24s %6d %12.0f %10.1f %12.0f %10.1f%s\n", algorithms[a].name, sizes[s],
+                       protectRate, protectNs / threads, unprotectRate, unprotectNs / threads,
+                       errors != 0 ? "  ERRORS" : "");
+            }
+        }
+    }
+    if (json)
+        printf("\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,440 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * SRTP comparison benchmark of ZRTPCPP and libsrtp.
+ *
+ * Runs the same packets through SrtpHandler::protect/unprotect of a
+ * SrtpSession and through srtp_protect/srtp_unprotect of a libsrtp 2 session.
+ * Both stacks use the same master key and salt, derive the session keys from
+ * them and demultiplex the SSRCs themselves: a SrtpSession with a template
+ * context and a libsrtp session with an ssrc_any policy. Thus both stacks
+ * produce the same SRTP packets, the benchmark checks this before it measures.
+ *
+ * The workloads run with AES-CM-128/HMAC-SHA1-80 and AES-CM-128/HMAC-SHA1-32
+ * and each payload size:
+ *
+ * - in-order: one SSRC, the receiver gets the packets in order
+ * - reordered: one SSRC, the receiver gets each block of 8 packets in reverse
+ *   order, this is within the replay window of both stacks
+ * - ssrcs: many SSRCs (option -m), the packets of the SSRCs interleave
+ * - ssrcs-reordered: many SSRCs, the packets of each SSRC are reordered
+ *
+ * Each SSRC gets one packet before the measurement, thus the measurement
+ * does not contain the creation of the stream contexts.
+ *
+ * Usage: srtpcompare [-n packets] [-s size[,size...]] [-m ssrcs]
+ *
+ * The output is a JSON document, each result contains the packets per second
+ * and the cycles per packet of protect and unprotect. On x86 the cycles are
+ * time stamp counter cycles, on other CPUs the results do not contain cycles.
+ * The target is built only if pkg-config finds libsrtp2.
+ */
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#include <srtp2/srtp.h>
+
+#include <srtp/SrtpHandler.h>
+#include <srtp/SrtpSession.h>
+#include <srtp/CryptoContext.h>
+
+#ifdef ZRTP_OPENSSL
+static const char* backend = "OpenSSL";
+#else
+static const char* backend = "standalone";
+#endif
+
+static const int32_t defaultSizes[] = {20, 160, 640, 1400};
+
+static const int32_t masterKeyLength = 16;
+static const int32_t masterSaltLength = 14;
+static const int32_t reorderBlock = 8;
+static const int32_t bufferReserve = 64;        // room for the tag, more than SRTP_MAX_TRAILER_LEN
+
+typedef struct _Suite {
+    const char* name;
+    int32_t tagLength;
+} Suite;
+
+static const Suite suites[] = {
+    { "AES_CM_128_HMAC_SHA1_80", 10 },
+    { "AES_CM_128_HMAC_SHA1_32",  4 },
+};
+
+typedef struct _Workload {
+    const char* name;
+    bool manySsrcs;
+    bool reordered;
+} Workload;
+
+static const Workload workloads[] = {
+    { "in-order",        false, false },
+    { "reordered",       false, true  },
+    { "ssrcs",           true,  false },
+    { "ssrcs-reordered", true,  true  },
+};
+
+typedef struct _Measurement {
+    double protectSeconds;
+    double unprotectSeconds;
+    uint64_t protectCycles;
+    uint64_t unprotectCycles;
+    int32_t errors;
+} Measurement;
+
+static uint8_t masterKey[masterKeyLength + masterSaltLength];
+static bool firstResult = true;
+
+static inline uint64_t readCycles()
+{
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/*
+ * The packets of a workload: packet k belongs to SSRC k % ssrcs and has the
+ * sequence number k / ssrcs + 1, sequence number 0 is the warm up packet.
+ */
+class Packets {
+public:
+    Packets(int32_t count, int32_t ssrcs, int32_t payloadSize):
+            ssrcs(ssrcs), length(RTP_HEADER_LENGTH + payloadSize), srtpLength(count) {
+        packets.resize(count);
+        for (int32_t k = 0; k < count; k++)
+            fill(packets[k], 0x10000000 + k % ssrcs, (uint16_t)(k / ssrcs + 1));
+        warmUp.resize(ssrcs);
+        for (int32_t s = 0; s < ssrcs; s++)
+            fill(warmUp[s], 0x10000000 + s, 0);
+    }
+
+    void fill(std::vector<uint8_t>& buffer, uint32_t ssrc, uint16_t seq) {
+        buffer.resize(length + bufferReserve);
+        for (int32_t i = 0; i < length; i++)
+            buffer[i] = (uint8_t)i;
+        buffer[0] = 0x80;
+        buffer[1] = 0;
+        buffer[2] = (uint8_t)(seq >> 8);
+        buffer[3] = (uint8_t)seq;
+        buffer[8] = (uint8_t)(ssrc >> 24);
+        buffer[9] = (uint8_t)(ssrc >> 16);
+        buffer[10] = (uint8_t)(ssrc >> 8);
+        buffer[11] = (uint8_t)ssrc;
+    }
+
+    int32_t ssrcs;
+    int32_t length;
+    std::vector<std::vector<uint8_t> > packets;
+    std::vector<std::vector<uint8_t> > warmUp;
+    std::vector<int32_t> srtpLength;
+};
+
+/*
+ * The receive order: reverse each block of 8 packets of each SSRC.
+ */
+static std::vector<int32_t> receiveOrder(int32_t count, int32_t ssrcs, bool reordered)
+{
+    std::vector<int32_t> order(count);
+    int32_t block = reorderBlock * ssrcs;
+
+    for (int32_t k = 0; k < count; k++) {
+        int32_t start = k - k % block;
+        // An incomplete last block stays in order
+        if (!reordered || start + block > count) {
+            order[k] = k;
+            continue;
+        }
+        // Within a block packet j of a SSRC is at offset j * ssrcs + SSRC index
+        int32_t offset = k - start;
+        order[k] = start + (reorderBlock - 1 - offset / ssrcs) * ssrcs + offset % ssrcs;
+    }
+    return order;
+}
+
+/*
+ * ZRTPCPP: one SrtpSession per direction with a template context.
+ */
+static SrtpSession* createSession(int32_t tagLength)
+{
+    CryptoContext* templateCtx = new CryptoContext(0, 0, 0L, SrtpEncryptionAESCM, SrtpAuthenticationSha1Hmac,
+                                                   masterKey, masterKeyLength,
+                                                   masterKey + masterKeyLength, masterSaltLength,
+                                                   masterKeyLength, 20, masterSaltLength, tagLength);
+    return new SrtpSession(templateCtx);
+}
+
+static void runZrtpcpp(Packets& p, const std::vector<int32_t>& order, int32_t tagLength, Measurement* m)
+{
+    SrtpSession* sender = createSession(tagLength);
+    SrtpSession* receiver = createSession(tagLength);
+    size_t newLength;
+
+    for (int32_t s = 0; s < p.ssrcs; s++) {
+        if (!SrtpHandler::protect(sender, &p.warmUp[s][0], p.length, &newLength) ||
+            SrtpHandler::unprotect(receiver, &p.warmUp[s][0], newLength, &newLength) != 1)
+            m->errors++;
+    }
+    int32_t count = (int32_t)p.packets.size();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t cycles = readCycles();
+    for (int32_t k = 0; k < count; k++) {
+        if (!SrtpHandler::protect(sender, &p.packets[k][0], p.length, &newLength))
+            m->errors++;
+        p.srtpLength[k] = (int32_t)newLength;
+    }
+    m->protectCycles = readCycles() - cycles;
+    m->protectSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    cycles = readCycles();
+    for (int32_t k = 0; k < count; k++) {
+        int32_t n = order[k];
+        if (SrtpHandler::unprotect(receiver, &p.packets[n][0], p.srtpLength[n], &newLength) != 1)
+            m->errors++;
+    }
+    m->unprotectCycles = readCycles() - cycles;
+    m->unprotectSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    delete sender;
+    delete receiver;
+}
+
+/*
+ * libsrtp: one session per direction with an ssrc_any policy.
+ */
+static srtp_t createLibsrtpSession(int32_t tagLength, bool outbound)
+{
+    srtp_policy_t policy;
+    memset(&policy, 0, sizeof(policy));
+
+    if (tagLength == 4)
+        srtp_crypto_policy_set_aes_cm_128_hmac_sha1_32(&policy.rtp);
+    else
+        srtp_crypto_policy_set_aes_cm_128_hmac_sha1_80(&policy.rtp);
+    srtp_crypto_policy_set_aes_cm_128_hmac_sha1_80(&policy.rtcp);
+    policy.ssrc.type = outbound ? ssrc_any_outbound : ssrc_any_inbound;
+    policy.key = masterKey;
+    policy.window_size = 128;           // REPLAY_WINDOW_SIZE of ZRTPCPP
+    policy.allow_repeat_tx = 0;
+    policy.next = NULL;
+
+    srtp_t session = NULL;
+    if (srtp_create(&session, &policy) != srtp_err_status_ok)
+        return NULL;
+    return session;
+}
+
+static void runLibsrtp(Packets& p, const std::vector<int32_t>& order, int32_t tagLength, Measurement* m)
+{
+    srtp_t sender = createLibsrtpSession(tagLength, true);
+    srtp_t receiver = createLibsrtpSession(tagLength, false);
+    if (sender == NULL || receiver == NULL) {
+        m->errors = (int32_t)p.packets.size();
+        return;
+    }
+    int len;
+
+    for (int32_t s = 0; s < p.ssrcs; s++) {
+        len = p.length;
+        if (srtp_protect(sender, &p.warmUp[s][0], &len) != srtp_err_status_ok ||
+            srtp_unprotect(receiver, &p.warmUp[s][0], &len) != srtp_err_status_ok)
+            m->errors++;
+    }
+    int32_t count = (int32_t)p.packets.size();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t cycles = readCycles();
+    for (int32_t k = 0; k < count; k++) {
+        len = p.length;
+        if (srtp_protect(sender, &p.packets[k][0], &len) != srtp_err_status_ok)
+            m->errors++;
+        p.srtpLength[k] = len;
+    }
+    m->protectCycles = readCycles() - cycles;
+    m->protectSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    cycles = readCycles();
+    for (int32_t k = 0; k < count; k++) {
+        int32_t n = order[k];
+        len = p.srtpLength[n];
+        if (srtp_unprotect(receiver, &p.packets[n][0], &len) != srtp_err_status_ok)
+            m->errors++;
+    }
+    m->unprotectCycles = readCycles() - cycles;
+    m->unprotectSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    srtp_dealloc(sender);
+    srtp_dealloc(receiver);
+}
+
+/*
+ * Protect the same packets with both stacks and unprotect each result with
+ * the other stack. Returns the number of packets that differ or fail.
+ */
+static int32_t checkInterop(int32_t tagLength)
+{
+    Packets zrtpcpp(64, 1, 160);
+    Packets libsrtp(64, 1, 160);
+    SrtpSession* zSender = createSession(tagLength);
+    SrtpSession* zReceiver = createSession(tagLength);
+    srtp_t lSender = createLibsrtpSession(tagLength, true);
+    srtp_t lReceiver = createLibsrtpSession(tagLength, false);
+    int32_t errors = 0;
+
+    if (lSender == NULL || lReceiver == NULL) {
+        delete zSender;
+        delete zReceiver;
+        return 64;
+    }
+    for (int32_t k = 0; k < 64; k++) {
+        size_t zLength;
+        int lLength = libsrtp.length;
+        if (!SrtpHandler::protect(zSender, &zrtpcpp.packets[k][0], zrtpcpp.length, &zLength) ||
+            srtp_protect(lSender, &libsrtp.packets[k][0], &lLength) != srtp_err_status_ok ||
+            zLength != (size_t)lLength || memcmp(&zrtpcpp.packets[k][0], &libsrtp.packets[k][0], zLength) != 0) {
+            errors++;
+            continue;
+        }
+        // Each stack unprotects the packet of the other one
+        size_t newLength;
+        if (SrtpHandler::unprotect(zReceiver, &libsrtp.packets[k][0], lLength, &newLength) != 1 ||
+            srtp_unprotect(lReceiver, &zrtpcpp.packets[k][0], &lLength) != srtp_err_status_ok)
+            errors++;
+    }
+    delete zSender;
+    delete zReceiver;
+    srtp_dealloc(lSender);
+    srtp_dealloc(lReceiver);
+    return errors;
+}
+
+static void printResult(const char* stack, const Suite& suite, const Workload& workload, int32_t ssrcs,
+                        int32_t payloadSize, int32_t count, const Measurement& m)
+{
+    printf("%s\n    {\"stack\": \"%s\", \"suite\": \"%s\", \"workload\": \"%s\", \"ssrcs\": %d, \"bytes\": %d, "
+           "\"protect_pps\": %.0f, \"unprotect_pps\": %.0f, \"protect_cycles\": ",
+           firstResult ? "" : ",", stack, suite.name, workload.name, ssrcs, payloadSize,
+           count / m.protectSeconds, count / m.unprotectSeconds);
+#ifdef HAVE_TSC
+    printf("%.0f, \"unprotect_cycles\": %.0f", (double)m.protectCycles / count, (double)m.unprotectCycles / count);
+#else
+    printf("null, \"unprotect_cycles\": null");
+#endif
+    printf(", \"errors\": %d}", m.errors);
+    firstResult = false;
+}
+
+static void usage()
+{
+    fprintf(stderr, "Usage: srtpcompare [-n packets] [-s size[,size...]] [-m ssrcs]\n");
+    fprintf(stderr, "  -n packets   number of packets per run, default 20000\n");
+    fprintf(stderr, "  -s sizes     comma separated payload sizes in bytes, default 20,160,640,1400\n");
+    fprintf(stderr, "  -m ssrcs     number of SSRCs of the ssrcs workloads, default 100\n");
+}
+
+int main(int argc, char* argv[])
+{
+    int32_t packets = 20000;
+    int32_t manySsrcs = 100;
+    std::vector<int32_t> sizes(defaultSizes, defaultSizes + sizeof(defaultSizes) / sizeof(defaultSizes[0]));
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            packets = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            sizes.clear();
+            for (char* p = strtok(argv[++i], ","); p != NULL; p = strtok(NULL, ","))
+                sizes.push_back(atoi(p));
+        }
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            manySsrcs = atoi(argv[++i]);
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+    // The packets of one SSRC use a 16 bit sequence number without ROC handling
+    if (packets <= 0 || packets >= 65535 || manySsrcs <= 0 || sizes.empty()) {
+        usage();
+        return 1;
+    }
+    for (size_t s = 0; s < sizes.size(); s++) {
+        if (sizes[s] <= 0 || sizes[s] > 1500) {
+            usage();
+            return 1;
+        }
+    }
+
+    if (srtp_init() != srtp_err_status_ok) {
+        fprintf(stderr, "Cannot initialize libsrtp\n");
+        return 1;
+    }
+    for (int32_t i = 0; i < masterKeyLength + masterSaltLength; i++)
+        masterKey[i] = (uint8_t)(i * 7 + 1);
+
+    int32_t interopErrors = 0;
+    for (size_t s = 0; s < sizeof(suites) / sizeof(suites[0]); s++)
+        interopErrors += checkInterop(suites[s].tagLength);
+
+    printf("{\n  \"backend\": \"%s\",\n  \"libsrtp\": \"%s\",\n  \"packets\": %d,\n  \"interop_errors\": %d,\n  \"results\": [",
+           backend, srtp_get_version_string(), packets, interopErrors);
+
+    int32_t errors = interopErrors;
+    for (size_t s = 0; s < sizeof(suites) / sizeof(suites[0]); s++) {
+        for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+            int32_t ssrcs = workloads[w].manySsrcs ? manySsrcs : 1;
+            std::vector<int32_t> order = receiveOrder(packets, ssrcs, workloads[w].reordered);
+
+            for (size_t z = 0; z < sizes.size(); z++) {
+                Measurement m;
+
+                memset(&m, 0, sizeof(m));
+                Packets zrtpcpp(packets, ssrcs, sizes[z]);
+                runZrtpcpp(zrtpcpp, order, suites[s].tagLength, &m);
+                printResult("zrtpcpp", suites[s], workloads[w], ssrcs, sizes[z], packets, m);
+                errors += m.errors;
+
+                memset(&m, 0, sizeof(m));
+                Packets libsrtp(packets, ssrcs, sizes[z]);
+                runLibsrtp(libsrtp, order, suites[s].tagLength, &m);
+                printResult("libsrtp", suites[s], workloads[w], ssrcs, sizes[z], packets, m);
+                errors += m.errors;
+            }
+        }
+    }
+    printf("\n  ]\n}\n");
+
+    srtp_shutdown();
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,590 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Timeout provider benchmark.
+ *
+ * Runs the timers of many ZRTP engines on a timeout provider and measures the
+ * cost of requestTimeout and cancelRequest and how late the timeouts expire.
+ * The benchmark runs these providers:
+ *
+ * - list: TimeoutProvider of TiviTimeoutProvider.h, a sorted list of requests
+ * - wheel: TimeoutWheel, one timing wheel and one worker thread
+ * - sharded: ShardedTimeoutWheel, one wheel and worker thread per shard
+ *
+ * Each subscriber runs the timers of a ZRTP engine, see ZrtpStateClass: T1
+ * starts with 50 ms and doubles up to 800 ms for 20 resends, T2 starts with
+ * 150 ms and doubles up to 1200 ms for 10 resends. A subscriber arms the next
+ * interval in its timeout callback, as the engine does when it resends a
+ * packet, after the last resend it starts again with T1. An answer of the peer
+ * cancels the timer and starts the next one: an answer to T1 starts T2, an
+ * answer to T2 starts T1 of the next handshake. The benchmark arms the timers
+ * of all subscribers and runs two phases per provider and number of
+ * subscribers:
+ *
+ * - churn: the load threads answer their subscribers as fast as they can,
+ *   each answer is a cancelRequest and a requestTimeout. The result contains
+ *   the operations per second and the latency of an answer.
+ * - expiry: the load threads answer a timer at a random time between zero and
+ *   twice its interval, thus about half of the timers expire. The result
+ *   contains the lateness of the expired timers, the time from the requested
+ *   expiry until the callback.
+ *
+ * The "heap_bytes_per_timer" value is the memory the provider allocates per
+ * pending timer, the benchmark counts the blocks of the library allocator,
+ * see ZrtpAllocator.h. The wheels do not allocate, their subscribers embed a
+ * TimeoutEntry of "entry_bytes". The "provider_bytes" value is the size of the
+ * provider objects. If the library is built with LOCK_PROFILING the result
+ * contains the acquisitions and the wait time of the provider locks, see
+ * ZrtpMetrics::TimeoutLock, otherwise these values are null.
+ *
+ * Usage: timerbench [-s subscribers] [-p providers] [-t threads] [-d duration] [-w shards]
+ *
+ * The lists are comma separated, for example -s 1000,100000 -p wheel,sharded.
+ * The list provider searches its list for each request and cancel, with many
+ * subscribers a phase may complete only a few operations. The output is a
+ * JSON document.
+ */
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <common/osSpecifics.h>
+#include <common/ZrtpAllocator.h>
+#include <common/TimeoutWheel.h>
+#include <clients/tivi/TiviTimeoutProvider.h>
+#include <libzrtpcpp/ZrtpMetrics.h>
+
+class BenchSubscriber;
+
+typedef TimeoutEntry<int32_t, BenchSubscriber*> BenchEntry;
+
+/*
+ * The heap bytes of the library allocator. The benchmark wraps the installed
+ * allocator, the library passes the size of a block to the release function.
+ */
+static ZrtpAllocator libraryAllocator;
+static std::atomic<int64_t> heapBytes(0);
+
+static void* countingAllocate(void* context, size_t bytes)
+{
+    void* ptr = libraryAllocator.allocate(libraryAllocator.context, bytes);
+    if (ptr != NULL)
+        heapBytes += (int64_t)bytes;
+    return ptr;
+}
+
+static void countingRelease(void* context, void* ptr, size_t bytes)
+{
+    heapBytes -= (int64_t)bytes;
+    libraryAllocator.release(libraryAllocator.context, ptr, bytes);
+}
+
+static uint64_t nowNs()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * The lateness of the expired timeouts in buckets of 50 us, the last bucket
+ * counts the timeouts that expired more than two seconds late.
+ */
+static const int32_t latenessBucketUs = 50;
+static const int32_t latenessBuckets = 2000 * 1000 / latenessBucketUs + 1;
+
+class LatenessHistogram {
+public:
+    LatenessHistogram(): buckets(new std::atomic<uint64_t>[latenessBuckets]()), recording(false) {}
+
+    void record(uint64_t latenessNs) {
+        uint64_t bucket = latenessNs / (latenessBucketUs * 1000);
+        buckets[bucket < (uint64_t)latenessBuckets ? bucket : latenessBuckets - 1].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t getCount() {
+        uint64_t count = 0;
+        for (int32_t i = 0; i < latenessBuckets; i++)
+            count += buckets[i].load(std::memory_order_relaxed);
+        return count;
+    }
+
+    // The upper limit of the bucket that contains the percentile, in milli-seconds
+    double percentileMs(double fraction) {
+        uint64_t count = getCount();
+        if (count == 0)
+            return 0.0;
+        uint64_t rank = (uint64_t)(fraction * (double)(count - 1));
+        uint64_t seen = 0;
+        for (int32_t i = 0; i < latenessBuckets; i++) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if (seen > rank)
+                return (i + 1) * latenessBucketUs / 1000.0;
+        }
+        return latenessBuckets * latenessBucketUs / 1000.0;
+    }
+
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+    std::atomic<bool> recording;
+};
+
+/*
+ * The interface of the benchmark to a provider.
+ */
+class BenchProvider {
+public:
+    virtual ~BenchProvider() {}
+    virtual void start() = 0;
+    virtual void stop() = 0;
+    virtual void request(BenchSubscriber* subscriber, int32_t timeMs) = 0;
+    virtual void cancel(BenchSubscriber* subscriber) = 0;
+    virtual size_t getProviderBytes() = 0;
+    virtual size_t getEntryBytes() = 0;
+};
+
+/*
+ * The timers of a ZRTP engine, see ZrtpStateClass.
+ */
+typedef struct _BenchTimer {
+    int32_t start;
+    int32_t capping;
+    int32_t maxResend;
+} BenchTimer;
+
+static const BenchTimer benchTimers[2] = {
+    {50, 800, 20},        // T1, Hello
+    {150, 1200, 10}       // T2, Commit, DHPart2, Confirm2
+};
+
+/*
+ * A subscriber, the timer state of one ZRTP engine. The lock protects the
+ * state as the stream lock protects the engine of a client, the load thread
+ * and the worker thread of the provider take it.
+ */
+class BenchSubscriber {
+public:
+    BenchSubscriber(): entry(this, ZrtpTimeoutCommand), provider(NULL), histogram(NULL), deadlineNs(0),
+        answerNs(0), armed(false), timer(0), time(0), counter(0), random(0), expired(0), resends(0) {}
+
+    void init(BenchProvider* p, LatenessHistogram* h, uint32_t seed) {
+        provider = p;
+        histogram = h;
+        random = seed | 1;
+    }
+
+    // Start the first interval of a timer
+    void startTimer(int32_t next) {
+        timer = next;
+        time = benchTimers[timer].start;
+        counter = 0;
+        arm();
+    }
+
+    // The peer answered, cancel the timer and start the next one
+    void answer() {
+        provider->cancel(this);
+        armed = false;
+        startTimer(timer == 0 ? 1 : 0);
+    }
+
+    void handleTimeout(const int32_t& command) {
+        std::lock_guard<std::mutex> guard(lock);
+
+        uint64_t now = nowNs();
+        // A timeout that the provider fired while a load thread replaced it
+        if (!armed || now + 1000000 < deadlineNs)
+            return;
+        if (histogram->recording.load(std::memory_order_relaxed))
+            histogram->record(now > deadlineNs ? now - deadlineNs : 0);
+        armed = false;
+        expired++;
+
+        // Resend, after the last resend the handshake fails and starts again
+        time += time;
+        time = (time > benchTimers[timer].capping) ? benchTimers[timer].capping : time;
+        if (++counter > benchTimers[timer].maxResend) {
+            startTimer(0);
+            return;
+        }
+        resends++;
+        arm();
+    }
+
+    BenchEntry entry;
+    std::mutex lock;
+    BenchProvider* provider;
+    LatenessHistogram* histogram;
+    uint64_t deadlineNs;            // the time the timer is due
+    uint64_t answerNs;              // the time the peer answers in the expiry phase
+    bool armed;
+    int32_t timer;                  // index of benchTimers
+    int32_t time;                   // the current interval in milli-seconds
+    int32_t counter;                // resends of the current timer
+    uint32_t random;
+    uint64_t expired;
+    uint64_t resends;
+
+private:
+    void arm() {
+        uint64_t now = nowNs();
+
+        deadlineNs = now + (uint64_t)time * 1000000;
+        // xorshift32, the answer comes between zero and twice the interval
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        answerNs = now + (uint64_t)(random % (uint32_t)(2 * time)) * 1000000;
+        armed = true;
+        provider->request(this, time);
+    }
+};
+
+class ListBenchProvider: public BenchProvider {
+public:
+    void start() { provider.Event(); }
+    void stop() { provider.stopThread(); }
+    void request(BenchSubscriber* subscriber, int32_t timeMs) { provider.requestTimeout(timeMs, subscriber, ZrtpTimeoutCommand); }
+    void cancel(BenchSubscriber* subscriber) { provider.cancelRequest(subscriber, ZrtpTimeoutCommand); }
+    size_t getProviderBytes() { return sizeof(provider); }
+    size_t getEntryBytes() { return 0; }
+
+private:
+    TimeoutProvider<int32_t, BenchSubscriber*> provider;
+};
+
+class WheelBenchProvider: public BenchProvider {
+public:
+    void start() { provider.start(); }
+    void stop() { provider.stopThread(); }
+    void request(BenchSubscriber* subscriber, int32_t timeMs) { provider.requestTimeout(timeMs, &subscriber->entry); }
+    void cancel(BenchSubscriber* subscriber) { provider.cancelRequest(&subscriber->entry); }
+    size_t getProviderBytes() { return sizeof(provider); }
+    size_t getEntryBytes() { return sizeof(BenchEntry); }
+
+private:
+    TimeoutWheel<int32_t, BenchSubscriber*> provider;
+};
+
+class ShardedBenchProvider: public BenchProvider {
+public:
+    explicit ShardedBenchProvider(size_t shards): provider(shards) {}
+
+    void start() { provider.start(); }
+    void stop() { provider.stopThread(); }
+    void request(BenchSubscriber* subscriber, int32_t timeMs) { provider.requestTimeout(timeMs, &subscriber->entry); }
+    void cancel(BenchSubscriber* subscriber) { provider.cancelRequest(&subscriber->entry); }
+    size_t getProviderBytes() { return sizeof(provider) + provider.getShards() * sizeof(TimeoutWheel<int32_t, BenchSubscriber*>); }
+    size_t getEntryBytes() { return sizeof(BenchEntry); }
+
+private:
+    ShardedTimeoutWheel<int32_t, BenchSubscriber*> provider;
+};
+
+static const char* providerNames[] = {"list", "wheel", "sharded"};
+
+static BenchProvider* createProvider(const std::string& name, size_t shards)
+{
+    if (name == "list")
+        return new ListBenchProvider();
+    if (name == "wheel")
+        return new WheelBenchProvider();
+    if (name == "sharded")
+        return new ShardedBenchProvider(shards);
+    return NULL;
+}
+
+/*
+ * A load thread answers the subscribers of its slice. In the churn phase it
+ * answers each subscriber on each pass, in the expiry phase only the
+ * subscribers whose answer time passed. The thread measures every 16th
+ * answer.
+ */
+typedef struct _LoadResult {
+    uint64_t operations;
+    std::vector<uint32_t> latencies;    // nano-seconds of the measured answers
+} LoadResult;
+
+static void runLoad(BenchSubscriber* subscribers, size_t count, bool churn, uint64_t endNs,
+                    LoadResult* result)
+{
+    uint64_t answers = 0;
+
+    result->operations = 0;
+    while (nowNs() < endNs) {
+        uint64_t passAnswers = answers;
+        for (size_t i = 0; i < count; i++) {
+            BenchSubscriber& subscriber = subscribers[i];
+            bool measure = (answers & 15) == 0;
+            uint64_t start = (measure || !churn) ? nowNs() : 0;
+            {
+                std::lock_guard<std::mutex> guard(subscriber.lock);
+
+                if (!churn && (!subscriber.armed || start < subscriber.answerNs))
+                    continue;
+                subscriber.answer();
+            }
+            if (measure)
+                result->latencies.push_back((uint32_t)std::min<uint64_t>(nowNs() - start, UINT32_MAX));
+            answers++;
+            // Check the end time now and then, a pass over many subscribers may take long
+            if ((answers & 1023) == 0 && nowNs() >= endNs)
+                break;
+        }
+        // Nothing to answer in this pass, wait for the next answers
+        if (!churn && passAnswers == answers)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    result->operations = answers * 2;
+}
+
+typedef struct _PhaseResult {
+    double opsPerSec;
+    double answerP50Us;
+    double answerP99Us;
+    bool haveLocks;
+    uint64_t lockAcquisitions;
+    uint64_t lockContended;
+    double lockWaitNsPerAcquisition;
+} PhaseResult;
+
+static double percentileUs(std::vector<uint32_t>& sorted, double fraction)
+{
+    if (sorted.empty())
+        return 0.0;
+    return sorted[(size_t)(fraction * (double)(sorted.size() - 1))] / 1000.0;
+}
+
+static void getLockCounters(ZrtpMetrics::LockCounters* counters)
+{
+    ZrtpMetrics::Snapshot* snapshot = new ZrtpMetrics::Snapshot;
+
+    ZrtpMetrics::getSnapshot(snapshot);
+    *counters = snapshot->locks[ZrtpMetrics::TimeoutLock];
+    delete snapshot;
+}
+
+static void runPhase(std::vector<BenchSubscriber>& subscribers, int32_t threads, bool churn, int32_t durationMs,
+                     PhaseResult* result)
+{
+    std::vector<std::thread> workers;
+    std::vector<LoadResult> loads(threads);
+    size_t perThread = subscribers.size() / (size_t)threads;
+
+    ZrtpMetrics::LockCounters before, after;
+    getLockCounters(&before);
+
+    uint64_t start = nowNs();
+    uint64_t endNs = start + (uint64_t)durationMs * 1000000;
+    for (int32_t t = 0; t < threads; t++) {
+        size_t first = (size_t)t * perThread;
+        size_t count = (t == threads - 1) ? subscribers.size() - first : perThread;
+        workers.push_back(std::thread(runLoad, &subscribers[first], count, churn, endNs, &loads[t]));
+    }
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+    double seconds = (nowNs() - start) / 1e9;
+
+    getLockCounters(&after);
+
+    uint64_t operations = 0;
+    std::vector<uint32_t> latencies;
+    for (size_t t = 0; t < loads.size(); t++) {
+        operations += loads[t].operations;
+        latencies.insert(latencies.end(), loads[t].latencies.begin(), loads[t].latencies.end());
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    result->opsPerSec = seconds > 0.0 ? operations / seconds : 0.0;
+    result->answerP50Us = percentileUs(latencies, 0.5);
+    result->answerP99Us = percentileUs(latencies, 0.99);
+    result->lockAcquisitions = after.acquisitions - before.acquisitions;
+    result->lockContended = after.contended - before.contended;
+    result->haveLocks = result->lockAcquisitions > 0;
+    result->lockWaitNsPerAcquisition = result->haveLocks ?
+            (double)(after.waitTimeSum - before.waitTimeSum) / (double)result->lockAcquisitions : 0.0;
+}
+
+static void printLocks(const PhaseResult& phase)
+{
+    if (phase.haveLocks)
+        printf("\"lock_acquisitions\": %llu, \"lock_contended\": %llu, \"lock_wait_ns\": %.1f",
+               (unsigned long long)phase.lockAcquisitions, (unsigned long long)phase.lockContended,
+               phase.lockWaitNsPerAcquisition);
+    else
+        printf("\"lock_acquisitions\": null, \"lock_contended\": null, \"lock_wait_ns\": null");
+}
+
+static bool firstResult = true;
+
+static void benchProvider(const std::string& name, int32_t count, int32_t threads, int32_t durationMs, size_t shards)
+{
+    LatenessHistogram histogram;
+    std::unique_ptr<BenchProvider> provider(createProvider(name, shards));
+    // The subscribers must not move, the providers keep pointers to them
+    std::vector<BenchSubscriber> subscribers(count);
+
+    for (int32_t i = 0; i < count; i++)
+        subscribers[i].init(provider.get(), &histogram, (uint32_t)i * 2654435761U);
+    provider->start();
+
+    // Arm the timers of all subscribers and count the heap bytes of the pending timers
+    int64_t heapBefore = heapBytes.load();
+    uint64_t start = nowNs();
+    for (int32_t i = 0; i < count; i++) {
+        std::lock_guard<std::mutex> guard(subscribers[i].lock);
+        subscribers[i].startTimer(0);
+    }
+    double armMs = (nowNs() - start) / 1e6;
+    int64_t heapPending = heapBytes.load() - heapBefore;
+    size_t pending = 0;
+    for (int32_t i = 0; i < count; i++) {
+        std::lock_guard<std::mutex> guard(subscribers[i].lock);
+        pending += subscribers[i].armed ? 1 : 0;
+    }
+
+    PhaseResult churn, expiry;
+    runPhase(subscribers, threads, true, durationMs, &churn);
+
+    histogram.recording = true;
+    runPhase(subscribers, threads, false, durationMs, &expiry);
+    histogram.recording = false;
+
+    provider->stop();
+    uint64_t expired = 0, resends = 0;
+    for (int32_t i = 0; i < count; i++) {
+        expired += subscribers[i].expired;
+        resends += subscribers[i].resends;
+    }
+
+    printf("%s\n    { \"provider\": \"%s\", \"subscribers\": %d, \"arm_ms\": %.3f,\n", firstResult ? "" : ",",
+           name.c_str(), count, armMs);
+    printf("      \"heap_bytes_per_timer\": %.1f, \"entry_bytes\": %u, \"provider_bytes\": %u,\n",
+           pending > 0 ? (double)heapPending / (double)pending : 0.0, (uint32_t)provider->getEntryBytes(),
+           (uint32_t)provider->getProviderBytes());
+    printf("      \"churn\": { \"ops_per_sec\": %.0f, \"answer_p50_us\": %.2f, \"answer_p99_us\": %.2f, ",
+           churn.opsPerSec, churn.answerP50Us, churn.answerP99Us);
+    printLocks(churn);
+    printf(" },\n      \"expiry\": { \"ops_per_sec\": %.0f, \"expired\": %llu, \"late_p50_ms\": %.2f, "
+           "\"late_p99_ms\": %.2f, \"late_p999_ms\": %.2f, ", expiry.opsPerSec,
+           (unsigned long long)histogram.getCount(), histogram.percentileMs(0.5), histogram.percentileMs(0.99),
+           histogram.percentileMs(0.999));
+    printLocks(expiry);
+    printf(" },\n      \"total_expired\": %llu, \"total_resends\": %llu }", (unsigned long long)expired,
+           (unsigned long long)resends);
+    firstResult = false;
+    fflush(stdout);
+}
+
+static bool parseList(const char* list, std::vector<std::string>& names)
+{
+    std::string all(list);
+    size_t start = 0;
+
+    names.clear();
+    while (start <= all.size()) {
+        size_t end = all.find(',', start);
+        if (end == std::string::npos)
+            end = all.size();
+        std::string name = all.substr(start, end - start);
+        if (name.empty())
+            return false;
+        names.push_back(name);
+        start = end + 1;
+    }
+    return !names.empty();
+}
+
+static void usage()
+{
+    fprintf(stderr, "Usage: timerbench [-s subscribers] [-p providers] [-t threads] [-d duration] [-w shards]\n");
+    fprintf(stderr, "  -s subscribers  numbers of subscribers, default 1000,10000,100000\n");
+    fprintf(stderr, "  -p providers    list, wheel, sharded, default all\n");
+    fprintf(stderr, "  -t threads      load threads, default 4\n");
+    fprintf(stderr, "  -d duration     milli-seconds per phase, default 1000\n");
+    fprintf(stderr, "  -w shards       shards of the sharded provider, default the number of cores\n");
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> counts;
+    std::vector<std::string> providers(providerNames, providerNames + sizeof(providerNames) / sizeof(providerNames[0]));
+    int32_t threads = 4;
+    int32_t durationMs = 1000;
+    int32_t shards = 0;
+
+    parseList("1000,10000,100000", counts);
+    for (int i = 1; i < argc; i++) {
+        bool valid = i + 1 < argc;
+        if (valid && strcmp(argv[i], "-s") == 0) {
+            valid = parseList(argv[++i], counts);
+        }
+        else if (valid && strcmp(argv[i], "-p") == 0) {
+            valid = parseList(argv[++i], providers);
+            for (size_t p = 0; valid && p < providers.size(); p++) {
+                std::unique_ptr<BenchProvider> provider(createProvider(providers[p], 1));
+                valid = provider.get() != NULL;
+            }
+        }
+        else if (valid && strcmp(argv[i], "-t") == 0) {
+            threads = atoi(argv[++i]);
+        }
+        else if (valid && strcmp(argv[i], "-d") == 0) {
+            durationMs = atoi(argv[++i]);
+        }
+        else if (valid && strcmp(argv[i], "-w") == 0) {
+            shards = atoi(argv[++i]);
+        }
+        else {
+            valid = false;
+        }
+        for (size_t c = 0; valid && c < counts.size(); c++)
+            valid = atoi(counts[c].c_str()) > 0;
+        if (!valid) {
+            usage();
+            return 1;
+        }
+    }
+    if (threads <= 0 || durationMs <= 0 || shards < 0) {
+        usage();
+        return 1;
+    }
+
+    // Count the blocks of the library allocator, no object of the library exists yet
+    zrtpGetAllocator(&libraryAllocator);
+    ZrtpAllocator counting = {countingAllocate, countingRelease, NULL};
+    zrtpSetAllocator(&counting);
+
+    printf("{\n  \"threads\": %d,\n  \"duration_ms\": %d,\n  \"results\": [", threads, durationMs);
+    for (size_t c = 0; c < counts.size(); c++) {
+        for (size_t p = 0; p < providers.size(); p++)
+            benchProvider(providers[p], atoi(counts[c].c_str()), threads, durationMs, (size_t)shards);
+    }
+    printf("\n  ]\n}\n");
+
+    zrtpSetAllocator(NULL);
+    return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * ZID cache export, import and compaction tool.
+ *
+ * Usage: zidcachetool export <cache> <file>
+ *        zidcachetool import <cache> <file>
+ *        zidcachetool compact <cache>
+ *
+ * The tool uses the cache backend the library was built with. The export file
+ * has the binary format of ZIDCacheExport.h, an export of one backend can be
+ * imported into another backend. Importing into a new cache moves the own ZID
+ * with the peer records. The export file contains the retained secrets.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+
+#include <libzrtpcpp/ZIDCache.h>
+
+static void usage()
+{
+    fprintf(stderr, "Usage: zidcachetool export <cache> <file>\n"
+                    "       zidcachetool import <cache> <file>\n"
+                    "       zidcachetool compact <cache>\n");
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        usage();
+        return 1;
+    }
+    const char* command = argv[1];
+    bool exporting = strcmp(command, "export") == 0;
+    bool importing = strcmp(command, "import") == 0;
+    bool compacting = strcmp(command, "compact") == 0;
+
+    if (!(((exporting || importing) && argc == 4) || (compacting && argc == 3))) {
+        usage();
+        return 1;
+    }
+    ZIDCache* cache = getZidCacheInstance();
+    if (cache->open(argv[2]) < 0) {
+        fprintf(stderr, "Cannot open ZID cache %s\n", argv[2]);
+        return 1;
+    }
+    FILE* file = NULL;
+    if (!compacting && (file = fopen(argv[3], exporting ? "wb" : "rb")) == NULL) {
+        fprintf(stderr, "Cannot open %s\n", argv[3]);
+        cache->close();
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    int32_t result;
+    if (exporting)
+        result = cache->exportRecords(file);
+    else if (importing)
+        result = cache->importRecords(file);
+    else
+        result = cache->compact();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (file != NULL && fclose(file) != 0)
+        result = -1;
+    cache->close();
+
+    if (result < 0) {
+        fprintf(stderr, "%s failed\n", command);
+        return 1;
+    }
+    printf("%s: %d records %s in %.3f s\n", command, result, compacting ? "removed" : "processed", seconds);
+    return 0;
+}
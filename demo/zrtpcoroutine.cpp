@@ -0,0 +1,193 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Concurrent ZRTP handshakes with the coroutine interface.
+ *
+ * Connects pairs of ZrtpCoroutineSession through an in-memory loopback and
+ * starts one coroutine per pair. The coroutine starts both sessions, awaits
+ * the handshake results and compares the SAS of both sessions. All pairs run
+ * concurrently on the threads of one ZrtpLoopExecutor, the engines compute
+ * the key agreement in the key agreement worker and share the ZID cache
+ * through ZIDCacheSharded.
+ *
+ * Usage: zrtpcoroutine [-n pairs] [-t threads] [-f zidfile]
+ *
+ * The program removes the ZID cache file before it starts and prints the
+ * number of secure and failed pairs and the wall time.
+ */
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <libzrtpcpp/ZrtpCoroutine.h>
+#include <libzrtpcpp/ZIDCache.h>
+#include <libzrtpcpp/ZIDCacheSharded.h>
+
+using namespace GnuZrtpCodes;
+
+/*
+ * A session of the loopback, it delivers its packets to the peer session. The
+ * receiving session expects a packet with an RTP like header.
+ */
+class LoopSession : public ZrtpCoroutineSession {
+public:
+    LoopSession(ZrtpExecutor& executor, ZrtpConfigure* config, const uint8_t* zid):
+        ZrtpCoroutineSession(executor, config, zid, "zrtpcoroutine"), peer(NULL) {}
+
+    LoopSession* peer;
+
+    int32_t sendDataZRTP(const uint8_t* data, int32_t length) override {
+        if (length <= 0)
+            return 0;
+        // The data contains the space for the CRC, the loopback does not compute it
+        std::vector<uint8_t> packet(12 + length, 0);
+        memcpy(&packet[12], data, length);
+        peer->receive(&packet[0], packet.size(), 0x12345678);
+        return 1;
+    }
+
+    bool srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part) override { return true; }
+
+    void srtpSecretsOff(EnableSecurity part) override {}
+};
+
+typedef struct _Pair {
+    LoopSession* a;
+    LoopSession* b;
+} Pair;
+
+static std::mutex doneLock;
+static std::condition_variable doneSignal;
+static int32_t finished = 0;
+static std::atomic<int32_t> securePairs(0);
+
+static ZrtpTask<> runPair(Pair* pair)
+{
+    pair->a->start();
+    pair->b->start();
+
+    ZrtpSecureResult resultA = co_await pair->a->secure();
+    ZrtpSecureResult resultB = co_await pair->b->secure();
+    if (resultA.secure && resultB.secure && resultA.sas == resultB.sas)
+        securePairs++;
+
+    std::lock_guard<std::mutex> guard(doneLock);
+    finished++;
+    doneSignal.notify_all();
+}
+
+static void randomZid(uint8_t* zid)
+{
+    for (int32_t k = 0; k < IDENTIFIER_LEN; k++)
+        zid[k] = (uint8_t)rand();
+}
+
+static void usage()
+{
+    fprintf(stderr, "Usage: zrtpcoroutine [-n pairs] [-t threads] [-f zidfile]\n");
+}
+
+int main(int argc, char* argv[])
+{
+    int32_t numPairs = 100;
+    int32_t threads = 2;
+    const char* zidFile = "zrtpcoroutine.zid";
+
+    for (int i = 1; i < argc; i++) {
+        bool valid = i + 1 < argc;
+        if (valid && strcmp(argv[i], "-n") == 0) {
+            numPairs = atoi(argv[++i]);
+        }
+        else if (valid && strcmp(argv[i], "-t") == 0) {
+            threads = atoi(argv[++i]);
+        }
+        else if (valid && strcmp(argv[i], "-f") == 0) {
+            zidFile = argv[++i];
+        }
+        else {
+            valid = false;
+        }
+        if (!valid) {
+            usage();
+            return 1;
+        }
+    }
+    if (numPairs <= 0 || threads <= 0) {
+        usage();
+        return 1;
+    }
+    // The engines access the cache from all executor threads
+    ZIDCacheSharded::install();
+    remove(zidFile);
+    if (getZidCacheInstance()->open(const_cast<char*>(zidFile)) < 0) {
+        fprintf(stderr, "Cannot open the ZID cache %s\n", zidFile);
+        return 1;
+    }
+
+    ZrtpConfigure config;
+    config.setStandardConfig();
+    config.setAsyncKeyAgreement(true);
+
+    ZrtpLoopExecutor* executor = new ZrtpLoopExecutor(threads);
+    std::vector<Pair> pairs(numPairs);
+    for (int32_t i = 0; i < numPairs; i++) {
+        uint8_t zidA[IDENTIFIER_LEN];
+        uint8_t zidB[IDENTIFIER_LEN];
+
+        randomZid(zidA);
+        randomZid(zidB);
+        pairs[i].a = new LoopSession(*executor, &config, zidA);
+        pairs[i].b = new LoopSession(*executor, &config, zidB);
+        pairs[i].a->peer = pairs[i].b;
+        pairs[i].b->peer = pairs[i].a;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < numPairs; i++)
+        runPair(&pairs[i]).start();
+    {
+        std::unique_lock<std::mutex> guard(doneLock);
+        doneSignal.wait_for(guard, std::chrono::seconds(120), [numPairs]() { return finished == numPairs; });
+    }
+    long long wallMs = (long long)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+    // Close all sessions before deleting one, a closing session may still send to its peer
+    for (int32_t i = 0; i < numPairs; i++) {
+        pairs[i].a->close();
+        pairs[i].b->close();
+    }
+    for (int32_t i = 0; i < numPairs; i++) {
+        delete pairs[i].a;
+        delete pairs[i].b;
+    }
+    delete executor;
+    getZidCacheInstance()->close();
+
+    printf("{\"pairs\": %d, \"threads\": %d, \"secure_pairs\": %d, \"failed_pairs\": %d, \"wall_ms\": %lld}\n",
+           numPairs, threads, securePairs.load(), numPairs - securePairs.load(), wallMs);
+    return securePairs == numPairs ? 0 : 1;
+}
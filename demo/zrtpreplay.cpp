@@ -0,0 +1,103 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * ZRTP trace replay.
+ *
+ * Replays a trace file that a ZrtpTraceRecorder wrote, for example with the
+ * option -t of handshakebench, and measures the wall time and the CPU time of
+ * the engine. The replay is deterministic: the engine gets the recorded
+ * messages, timeouts, random data and ZID record, thus each replay does the
+ * same work. The replay does not wait for the recorded timers, the
+ * "recorded_us" value is the time the recorded engine needed.
+ *
+ * Usage: zrtpreplay [-n replays] tracefile
+ *
+ * The output is a JSON document, the times are microseconds per replay. The
+ * "mismatches" value counts the sent packets and timer requests of all
+ * replays that differ from the recorded ones, zrtpreplay exits with 1 if a
+ * replay does not match.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include <libzrtpcpp/ZrtpTrace.h>
+
+static void usage()
+{
+    fprintf(stderr, "Usage: zrtpreplay [-n replays] tracefile\n");
+    fprintf(stderr, "  -n replays     number of replays, default 100\n");
+}
+
+int main(int argc, char* argv[])
+{
+    int32_t replays = 100;
+    const char* traceFile = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-n") == 0) {
+            replays = atoi(argv[++i]);
+        }
+        else if (traceFile == NULL && argv[i][0] != '-') {
+            traceFile = argv[i];
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (traceFile == NULL || replays <= 0) {
+        usage();
+        return 1;
+    }
+
+    ZrtpTraceReplayer replayer;
+    if (!replayer.load(traceFile)) {
+        fprintf(stderr, "Cannot load the trace %s: %s\n", traceFile, replayer.getError().c_str());
+        return 1;
+    }
+
+    ZrtpTraceReplayer::Result result;
+    int64_t wallSum = 0;
+    int64_t wallMin = -1;
+    int64_t cpuSum = 0;
+    int32_t mismatches = 0;
+    int32_t randomMismatches = 0;
+    int32_t secure = 0;
+
+    for (int32_t i = 0; i < replays; i++) {
+        replayer.replay(&result);
+        wallSum += result.wallTime;
+        cpuSum += result.cpuTime;
+        if (wallMin < 0 || result.wallTime < wallMin)
+            wallMin = result.wallTime;
+        mismatches += result.mismatches;
+        randomMismatches += result.randomMismatches;
+        if (result.secure)
+            secure++;
+    }
+
+    printf("{\n  \"trace\": \"%s\",\n  \"replays\": %d,\n  \"events\": %d,\n  \"outputs\": %d,\n"
+           "  \"secure\": %d,\n  \"mismatches\": %d,\n  \"random_mismatches\": %d,\n"
+           "  \"recorded_us\": %lld,\n  \"wall_us\": %lld,\n  \"wall_min_us\": %lld,\n  \"cpu_us\": %lld\n}\n",
+           traceFile, replays, result.events, result.outputs, secure, mismatches, randomMismatches,
+           (long long)result.recordedTime, (long long)(wallSum / replays), (long long)wallMin,
+           (long long)(cpuSum / replays));
+    return mismatches == 0 && randomMismatches == 0 ? 0 : 1;
+}
@@ -21,10 +21,15 @@
 #include <cstring>
 #include <cstdio>
 #include <cstdint>
+#include <atomic>
+#include <utility>
 
 #include <common/osSpecifics.h>
+#include <common/zrtpByteOrder.h>
+#include <common/MemoryUsage.h>
 
 #include "srtp/CryptoContext.h"
+#include "srtp/CryptoContextCtrl.h"
 #include "crypto/SrtpSymCrypto.h"
 
 CryptoContext::CryptoContext( uint32_t ssrc,
@@ -39,72 +44,117 @@ CryptoContext::CryptoContext( uint32_t ssrc,
                               int32_t ekeyl,
                               int32_t akeyl,
                               int32_t skeyl,
-                              int32_t tagLength):
+                              int32_t tagLength,
+                              int32_t replayWindowSize):
 
-        ssrcCtx(ssrc), mkiLength(0),mki(NULL), roc(roc),guessed_roc(0),
-        s_l(0),key_deriv_rate(key_deriv_rate), labelBase(0), seqNumSet(false), 
-        macCtx(NULL), cipher(NULL), f8Cipher(NULL)
+        ssrcCtx(ssrc), roc(roc), guessed_roc(0), s_l(0), seqNumSet(false), labelBase(0),
+        cipher(NULL), f8Cipher(NULL), macCtx(NULL), k_s(NULL), key_deriv_rate(key_deriv_rate), keyId(0),
+        keyStreamRing(NULL), mkiLength(0), mki(NULL), exportable(false), spareKeyId(-1),
+        spareCipher(NULL), spareF8Cipher(NULL), spareK_s(NULL), spareMacCtx(NULL), sharedKeys(NULL)
 {
-    replay_window[0] = replay_window[1] = 0;
+    if (replayWindowSize <= 0)
+        replayWindowSize = REPLAY_WINDOW_SIZE;
+    if (replayWindowSize > SRTP_MAX_REPLAY_WINDOW_SIZE)
+        replayWindowSize = SRTP_MAX_REPLAY_WINDOW_SIZE;
+    this->replayWindowSize = (replayWindowSize + 63) & ~63;
+
+    // One more word than the window needs: the window's oldest and newest
+    // packets may be in partially used words
+    replayWords = this->replayWindowSize / 64 + 1;
+    replayWindow = (replayWords <= SRTP_INLINE_REPLAY_WORDS) ? replayWindowInline : new uint64_t[replayWords];
+    memset(replayWindow, 0, replayWords * sizeof(uint64_t));
     this->ealg = ealg;
     this->aalg = aalg;
-    this->ekeyl = ekeyl;
-    this->akeyl = akeyl;
-    this->skeyl = skeyl;
+    counters.setSuite(ZrtpMetrics::getSrtpSuite(ealg, aalg, false));
+    this->ekeyl = ekeyl < SRTP_MAX_KEY_LENGTH ? ekeyl : SRTP_MAX_KEY_LENGTH;
+    this->akeyl = akeyl < SRTP_MAX_AUTH_KEY_LENGTH ? akeyl : SRTP_MAX_AUTH_KEY_LENGTH;
+    this->skeyl = skeyl < SRTP_MAX_SALT_LENGTH ? skeyl : SRTP_MAX_SALT_LENGTH;
 
+    if (master_key_length > SRTP_MAX_KEY_LENGTH)
+        master_key_length = SRTP_MAX_KEY_LENGTH;
     this->master_key_length = master_key_length;
-    this->master_key = new uint8_t[master_key_length];
     memcpy(this->master_key, master_key, master_key_length);
 
+    // The key derivation uses a 14 byte (112 bit) salt. Pad shorter salts,
+    // for example the 12 byte AES-GCM salt, with zeros (RFC 7714, chapter 11).
+    if (master_salt_length > SRTP_MAX_SALT_LENGTH)
+        master_salt_length = SRTP_MAX_SALT_LENGTH;
     this->master_salt_length = master_salt_length;
-    this->master_salt = new uint8_t[master_salt_length];
+    memset(this->master_salt, 0, SRTP_MAX_SALT_LENGTH);
     memcpy(this->master_salt, master_salt, master_salt_length);
 
+    memset(sessionSalts, 0, sizeof(sessionSalts));
+
+    // A SHA1 HMAC context may hold resources of the crypto library, it must be zero before its first use
+    memset(&hmacCtx, 0, sizeof(hmacCtx));
+    memset(&spareHmacCtx, 0, sizeof(spareHmacCtx));
+
     switch (ealg) {
         case SrtpEncryptionNull:
             n_e = 0;
-            k_e = NULL;
             n_s = 0;
-            k_s = NULL;
             break;
 
+#ifndef ZRTP_MINIMAL_ALGORITHMS
         case SrtpEncryptionTWOF8:
             f8Cipher = new SrtpSymCrypto(SrtpEncryptionTWOF8);
 
         case SrtpEncryptionTWOCM:
-            n_e = ekeyl;
-            k_e = new uint8_t[n_e];
-            n_s = skeyl;
-            k_s = new uint8_t[n_s];
+            n_e = this->ekeyl;
+            n_s = this->skeyl;
+            k_s = sessionSalts[0];
             cipher = new SrtpSymCrypto(SrtpEncryptionTWOCM);
             break;
+#endif
 
         case SrtpEncryptionAESF8:
             f8Cipher = new SrtpSymCrypto(SrtpEncryptionAESF8);
 
         case SrtpEncryptionAESCM:
-            n_e = ekeyl;
-            k_e = new uint8_t[n_e];
-            n_s = skeyl;
-            k_s = new uint8_t[n_s];
+            n_e = this->ekeyl;
+            n_s = this->skeyl;
+            k_s = sessionSalts[0];
+            cipher = new SrtpSymCrypto(SrtpEncryptionAESCM);
+            break;
+
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+        case SrtpEncryptionAESGCM128:
+        case SrtpEncryptionAESGCM256:
+            n_e = this->ekeyl;
+            n_s = this->skeyl;
+            k_s = sessionSalts[0];
             cipher = new SrtpSymCrypto(SrtpEncryptionAESCM);
+            // AEAD does not use a separate authentication, RFC 7714
+            this->aalg = SrtpAuthenticationNull;
             break;
+
+        case SrtpEncryptionCHACHA20POLY1305:
+            n_e = this->ekeyl;
+            n_s = this->skeyl;
+            k_s = sessionSalts[0];
+            cipher = new SrtpSymCrypto(SrtpEncryptionCHACHA20POLY1305);
+            this->aalg = SrtpAuthenticationNull;
+            break;
+#endif
     }
 
-    switch (aalg ) {
+    switch (this->aalg) {
         case SrtpAuthenticationNull:
             n_a = 0;
-            k_a = NULL;
             this->tagLength = 0;
             break;
 
         case SrtpAuthenticationSha1Hmac:
+#ifndef ZRTP_MINIMAL_ALGORITHMS
         case SrtpAuthenticationSkeinHmac:
-            n_a = akeyl;
-            k_a = new uint8_t[n_a];
+#endif
+            n_a = this->akeyl;
             this->tagLength = tagLength;
             break;
     }
+    if (isAead())
+        this->tagLength = SRTP_GCM_TAG_LENGTH;
+    selectTransform();
 }
 
 /*
@@ -116,35 +166,78 @@ CryptoContext::CryptoContext( uint32_t ssrc,
  */
 static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
 
+/*
+ * The session keys that the clones of one context share. The first clone that
+ * derives its keys publishes them, the shared keys own its ciphers from then
+ * on. The keys are immutable once they are ready, the clones copy the MAC
+ * context because computing a MAC changes it.
+ */
+struct CryptoContext::SharedKeys {
+    enum { Empty, Publishing, Ready };
+
+    explicit SharedKeys(const CryptoContext* owner): refs(1), state(Empty), owner(owner), cipher(NULL), f8Cipher(NULL), aalg(SrtpAuthenticationNull), hasMac(false) {
+        memset(salt, 0, sizeof(salt));
+        memset(&hmac, 0, sizeof(hmac));
+    }
+
+    ~SharedKeys() {
+        delete cipher;
+        delete f8Cipher;
+        if (aalg == SrtpAuthenticationSha1Hmac)
+            releaseSha1HmacContext(&hmac.hmacSha1Ctx);
+        memset_volatile(salt, 0, sizeof(salt));
+        memset_volatile(&hmac, 0, sizeof(hmac));
+    }
+
+    void release() {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+
+    std::atomic<int32_t> refs;
+    std::atomic<int32_t> state;
+    const CryptoContext* owner;         //!< the context that creates the clones, NULL if deleted
+    SrtpSymCrypto* cipher;
+    SrtpSymCrypto* f8Cipher;
+    uint8_t salt[SRTP_MAX_SALT_LENGTH];
+    HmacCtx hmac;
+    int32_t aalg;
+    bool hasMac;
+};
+
 CryptoContext::~CryptoContext() {
 
     if (mki)
         delete [] mki;
 
-    if (master_key_length > 0) {
-        memset_volatile(master_key, 0, master_key_length);
-        master_key_length = 0;
-        delete [] master_key;
-    }
-    if (master_salt_length > 0) {
-        memset_volatile(master_salt, 0, master_salt_length);
-        master_salt_length = 0;
-        delete [] master_salt;
+    if (replayWindow != replayWindowInline)
+        delete [] replayWindow;
+    setKeyStreamPrecompute(0, 0);
+
+    memset_volatile(master_key, 0, sizeof(master_key));
+    master_key_length = 0;
+    memset_volatile(master_salt, 0, sizeof(master_salt));
+    master_salt_length = 0;
+    memset_volatile(k_e, 0, sizeof(k_e));
+    memset_volatile(k_a, 0, sizeof(k_a));
+    memset_volatile(sessionSalts, 0, sizeof(sessionSalts));
+    n_e = n_a = n_s = 0;
+
+    if (aalg == SrtpAuthenticationSha1Hmac) {
+        releaseSha1HmacContext(&hmacCtx.hmacSha1Ctx);
+        releaseSha1HmacContext(&spareHmacCtx.hmacSha1Ctx);
     }
-    if (n_e > 0) {
-        memset_volatile(k_e, 0, n_e);
-        n_e = 0;
-        delete [] k_e;
-    }
-    if (n_s > 0) {
-        memset_volatile(k_s, 0, n_s);
-        n_s = 0;
-        delete [] k_s;
-    }
-    if (n_a > 0) {
-        memset_volatile(k_a, 0, n_a);
-        n_a = 0;
-        delete [] k_a;
+
+    // The shared keys own the ciphers this context uses after useSharedKeys or publishSharedKeys
+    if (sharedKeys != NULL) {
+        if (cipher == sharedKeys->cipher)
+            cipher = NULL;
+        if (f8Cipher == sharedKeys->f8Cipher)
+            f8Cipher = NULL;
+        if (sharedKeys->owner == this)
+            sharedKeys->owner = NULL;
+        sharedKeys->release();
+        sharedKeys = NULL;
     }
     if (cipher != NULL) {
         delete cipher;
@@ -154,37 +247,53 @@ CryptoContext::~CryptoContext() {
         delete f8Cipher;
         f8Cipher = NULL;
     }
+    delete spareCipher;
+    delete spareF8Cipher;
+}
+
+/*
+ * Compute the CM IV (refer to chapter 4.1.1 in RFC 3711):
+ *
+ * k_s   XX XX XX XX XX XX XX XX XX XX XX XX XX XX
+ * SSRC              XX XX XX XX
+ * index                         XX XX XX XX XX XX
+ * ------------------------------------------------------XOR
+ * IV    XX XX XX XX XX XX XX XX XX XX XX XX XX XX 00 00
+ */
+static void computeCmIv(uint8_t* iv, uint64_t index, uint32_t ssrc, const uint8_t* salt)
+{
+    memcpy(iv, salt, 4);
+
+    int i;
+    for (i = 4; i < 8; i++ ) {
+        iv[i] = (0xFF & (ssrc >> ((7-i)*8))) ^ salt[i];
+    }
+    for (i = 8; i < 14; i++ ) {
+        iv[i] = (0xFF & (unsigned char)(index >> ((13-i)*8) ) ) ^ salt[i];
+    }
+    iv[14] = iv[15] = 0;
 }
 
 void CryptoContext::srtpEncrypt(uint8_t* pkt, uint8_t* payload, uint32_t paylen, uint64_t index, uint32_t ssrc ) {
+    srtpEncrypt(pkt, payload, paylen, payload, index, ssrc);
+}
+
+void CryptoContext::srtpEncrypt(const uint8_t* pkt, const uint8_t* payload, uint32_t paylen, uint8_t* out, uint64_t index, uint32_t ssrc ) {
 
     if (ealg == SrtpEncryptionNull) {
+        if (out != payload)
+            memcpy(out, payload, paylen);
         return;
     }
     if (ealg == SrtpEncryptionAESCM || ealg == SrtpEncryptionTWOCM) {
 
-        /* Compute the CM IV (refer to chapter 4.1.1 in RFC 3711):
-         *
-         * k_s   XX XX XX XX XX XX XX XX XX XX XX XX XX XX
-         * SSRC              XX XX XX XX
-         * index                         XX XX XX XX XX XX
-         * ------------------------------------------------------XOR
-         * IV    XX XX XX XX XX XX XX XX XX XX XX XX XX XX 00 00
-         */
-
-        unsigned char iv[16];
-        memcpy(iv, k_s, 4);
-
-        int i;
-        for (i = 4; i < 8; i++ ) {
-            iv[i] = (0xFF & (ssrc >> ((7-i)*8))) ^ k_s[i];
-        }
-        for (i = 8; i < 14; i++ ) {
-            iv[i] = (0xFF & (unsigned char)(index >> ((13-i)*8) ) ) ^ k_s[i];
+        if (keyStreamRing != NULL && ssrc == ssrcCtx && useKeyStream(payload, paylen, out, index)) {
+            return;
         }
-        iv[14] = iv[15] = 0;
+        unsigned char iv[16];
+        computeCmIv(iv, index, ssrc, k_s);
 
-        cipher->ctr_encrypt(payload, paylen, iv);
+        cipher->ctr_encrypt(payload, paylen, out, iv);
     }
 
     if (ealg == SrtpEncryptionAESF8 || ealg == SrtpEncryptionTWOF8) {
@@ -198,16 +307,408 @@ void CryptoContext::srtpEncrypt(uint8_t* pkt, uint8_t* payload, uint32_t paylen,
          */
 
         unsigned char iv[16];
-        uint32_t *ui32p = (uint32_t *)iv;
 
         memcpy(iv, pkt, 12);
         iv[0] = 0;
 
         // set ROC in network order into IV
-        ui32p[3] = zrtpHtonl(roc);
+        zrtpStoreBe32(iv + 12, roc);
+
+        cipher->f8_encrypt(payload, paylen, out, iv, f8Cipher);
+    }
+}
+
+bool CryptoContext::srtpKeyStream(uint8_t* keyStream, uint32_t length, uint64_t index, uint32_t ssrc)
+{
+    if (ealg != SrtpEncryptionAESCM && ealg != SrtpEncryptionTWOCM) {
+        return false;
+    }
+    unsigned char iv[16];
+    computeCmIv(iv, index, ssrc, k_s);
+
+    cipher->get_ctr_cipher_stream(keyStream, length, iv);
+    return true;
+}
+
+/*
+ * The key stream ring has one producer, the thread that calls precomputeKeyStream(),
+ * and one consumer, the thread that protects the packets. The state of a slot
+ * tells who owns it, the owner changes the state with compare and exchange, thus
+ * the consumer never reads a slot while the producer writes it.
+ */
+enum KeyStreamSlotState {
+    SlotFree,
+    SlotWriting,
+    SlotReady,
+    SlotReading
+};
+
+struct KeyStreamSlot {
+    std::atomic<int32_t>  state;
+    std::atomic<uint64_t> index;
+    uint8_t* keyStream;
+};
+
+struct KeyStreamRing {
+    int32_t  depth;
+    uint32_t maxLength;
+    std::atomic<uint64_t> nextIndex;    // index of the next packet to send, set by the consumer
+    uint64_t fillIndex;                 // next index to compute, used by the producer only
+    KeyStreamSlot* slots;
+    uint8_t* data;
+};
+
+bool CryptoContext::setKeyStreamPrecompute(int32_t depth, uint32_t maxPayloadLength)
+{
+    if (keyStreamRing != NULL) {
+        memset_volatile(keyStreamRing->data, 0, keyStreamRing->depth * keyStreamRing->maxLength);
+        delete [] keyStreamRing->data;
+        delete [] keyStreamRing->slots;
+        delete keyStreamRing;
+        keyStreamRing = NULL;
+    }
+    if (depth <= 0 || maxPayloadLength == 0)
+        return true;
+
+    if (ealg != SrtpEncryptionAESCM && ealg != SrtpEncryptionTWOCM)
+        return false;
+
+    // The key stream of the ring would not follow a key switch
+    if (key_deriv_rate != 0)
+        return false;
+
+    KeyStreamRing* ring = new KeyStreamRing;
+    ring->depth = depth;
+    ring->maxLength = maxPayloadLength;
+    ring->nextIndex.store(((uint64_t)roc << 16) | s_l);
+    ring->fillIndex = 0;
+    ring->slots = new KeyStreamSlot[depth];
+    ring->data = new uint8_t[depth * maxPayloadLength];
+
+    for (int32_t i = 0; i < depth; i++) {
+        ring->slots[i].state.store(SlotFree);
+        ring->slots[i].index.store(0);
+        ring->slots[i].keyStream = ring->data + i * maxPayloadLength;
+    }
+    keyStreamRing = ring;
+    return true;
+}
+
+void CryptoContext::addMemoryUsage(MemoryUsage& usage) const
+{
+    size_t bytes = sizeof(CryptoContext) + mkiLength;
+
+    if (replayWindow != replayWindowInline)
+        bytes += replayWords * sizeof(uint64_t);
+    if (keyStreamRing != NULL)
+        bytes += sizeof(KeyStreamRing) + keyStreamRing->depth * (sizeof(KeyStreamSlot) + keyStreamRing->maxLength);
+    usage.add(MemoryUsage::Srtp, bytes);
+
+    // The shared ciphers count once, for the context that created the shared keys
+    bool shared = sharedKeys != NULL && sharedKeys->state.load(std::memory_order_acquire) == SharedKeys::Ready;
+    SrtpSymCrypto* ciphers[] = {cipher, f8Cipher, spareCipher, spareF8Cipher};
+    for (SrtpSymCrypto* c : ciphers) {
+        if (c != NULL && !(shared && (c == sharedKeys->cipher || c == sharedKeys->f8Cipher)))
+            c->addMemoryUsage(usage);
+    }
+    if (shared && sharedKeys->owner == this) {
+        usage.add(MemoryUsage::Srtp, sizeof(SharedKeys));
+        if (sharedKeys->cipher != NULL)
+            sharedKeys->cipher->addMemoryUsage(usage);
+        if (sharedKeys->f8Cipher != NULL)
+            sharedKeys->f8Cipher->addMemoryUsage(usage);
+    }
+}
+
+int32_t CryptoContext::precomputeKeyStream()
+{
+    KeyStreamRing* ring = keyStreamRing;
+    int32_t computed = 0;
+
+    if (ring == NULL || cipher == NULL)
+        return 0;
+
+    uint64_t next = ring->nextIndex.load(std::memory_order_acquire);
+    if (ring->fillIndex < next || ring->fillIndex > next + ring->depth)
+        ring->fillIndex = next;
+
+    for (; ring->fillIndex < next + ring->depth; ring->fillIndex++) {
+        uint64_t index = ring->fillIndex;
+        KeyStreamSlot* slot = &ring->slots[index % ring->depth];
+
+        int32_t state = slot->state.load(std::memory_order_acquire);
+        if (state == SlotReady && slot->index.load(std::memory_order_relaxed) == index)
+            continue;                           // already computed
+        if (state == SlotReading || !slot->state.compare_exchange_strong(state, SlotWriting))
+            break;                              // the consumer uses this slot, try later
+
+        unsigned char iv[16];
+        computeCmIv(iv, index, ssrcCtx, k_s);
+        cipher->get_ctr_cipher_stream(slot->keyStream, ring->maxLength, iv);
+
+        slot->index.store(index, std::memory_order_relaxed);
+        slot->state.store(SlotReady, std::memory_order_release);
+        computed++;
+    }
+    return computed;
+}
+
+bool CryptoContext::useKeyStream(const uint8_t* payload, uint32_t paylen, uint8_t* out, uint64_t index)
+{
+    KeyStreamRing* ring = keyStreamRing;
+    KeyStreamSlot* slot = &ring->slots[index % ring->depth];
+    bool used = false;
+
+    int32_t state = SlotReady;
+    if (paylen <= ring->maxLength && slot->index.load(std::memory_order_relaxed) == index &&
+        slot->state.compare_exchange_strong(state, SlotReading, std::memory_order_acquire)) {
+
+        // The producer may have changed the slot between the index check and the exchange
+        if (slot->index.load(std::memory_order_relaxed) == index) {
+            uint32_t i = 0;
+            for (; i + sizeof(uint64_t) <= paylen; i += sizeof(uint64_t)) {
+                uint64_t data, stream;
+                memcpy(&data, payload + i, sizeof(uint64_t));
+                memcpy(&stream, slot->keyStream + i, sizeof(uint64_t));
+                data ^= stream;
+                memcpy(out + i, &data, sizeof(uint64_t));
+            }
+            for (; i < paylen; i++)
+                out[i] = payload[i] ^ slot->keyStream[i];
+            used = true;
+        }
+        slot->state.store(used ? SlotFree : SlotReady, std::memory_order_release);
+    }
+    ring->nextIndex.store(index + 1, std::memory_order_release);
+    return used;
+}
+
+/*
+ * Compute the AES-GCM IV (refer to chapter 8.1 in RFC 7714), ChaCha20-Poly1305
+ * uses the same IV:
+ *
+ * 00 00 || SSRC || ROC || SEQ
+ * k_s   XX XX XX XX XX XX XX XX XX XX XX XX
+ * ------------------------------------------XOR
+ * IV    XX XX XX XX XX XX XX XX XX XX XX XX
+ */
+static void computeGcmIv(uint8_t* iv, uint64_t index, uint32_t ssrc, const uint8_t* salt)
+{
+    int i;
+
+    iv[0] = salt[0];
+    iv[1] = salt[1];
+    for (i = 2; i < 6; i++) {
+        iv[i] = (0xFF & (ssrc >> ((5-i)*8))) ^ salt[i];
+    }
+    for (i = 6; i < 12; i++) {
+        iv[i] = (0xFF & (unsigned char)(index >> ((11-i)*8))) ^ salt[i];
+    }
+}
+
+void CryptoContext::srtpAeadEncrypt(uint8_t* pkt, uint32_t hdrLength, uint32_t paylen, uint64_t index, uint32_t ssrc, uint8_t* tag)
+{
+    uint8_t iv[SRTP_GCM_IV_LENGTH];
+
+    computeGcmIv(iv, index, ssrc, k_s);
+    if (ealg == SrtpEncryptionCHACHA20POLY1305)
+        cipher->chacha_encrypt(pkt + hdrLength, paylen, pkt, hdrLength, iv, tag);
+    else
+        cipher->gcm_encrypt(pkt + hdrLength, paylen, pkt, hdrLength, iv, tag);
+}
+
+bool CryptoContext::srtpAeadDecrypt(uint8_t* pkt, uint32_t hdrLength, uint32_t paylen, uint64_t index, uint32_t ssrc, const uint8_t* tag)
+{
+    uint8_t iv[SRTP_GCM_IV_LENGTH];
+
+    computeGcmIv(iv, index, ssrc, k_s);
+    if (ealg == SrtpEncryptionCHACHA20POLY1305)
+        return cipher->chacha_decrypt(pkt + hdrLength, paylen, pkt, hdrLength, iv, tag);
+    return cipher->gcm_decrypt(pkt + hdrLength, paylen, pkt, hdrLength, iv, tag);
+}
+
+/*
+ * The cipher and MAC policies of the transforms. Each policy handles one
+ * algorithm, srtpEncrypt() and srtpAuthenticate() do the same for all
+ * algorithms. A CM policy still checks the key stream ring because an
+ * application may enable it after the construction.
+ */
+struct CryptoContext::NullCipher {
+    static void encrypt(CryptoContext*, uint8_t*, uint8_t*, uint32_t, uint64_t, uint32_t) {}
+};
+
+struct CryptoContext::CounterMode {
+    static void encrypt(CryptoContext* pcc, uint8_t*, uint8_t* payload, uint32_t paylen, uint64_t index, uint32_t ssrc) {
+        if (pcc->keyStreamRing != NULL && ssrc == pcc->ssrcCtx && pcc->useKeyStream(payload, paylen, payload, index))
+            return;
+
+        unsigned char iv[16];
+        computeCmIv(iv, index, ssrc, pcc->k_s);
+        pcc->cipher->ctr_encrypt(payload, paylen, iv);
+    }
+};
+
+struct CryptoContext::F8Mode {
+    static void encrypt(CryptoContext* pcc, uint8_t* pkt, uint8_t* payload, uint32_t paylen, uint64_t index, uint32_t ssrc) {
+        pcc->srtpEncrypt(pkt, payload, paylen, index, ssrc);
+    }
+};
+
+struct CryptoContext::AesGcm {
+    static void encrypt(CryptoContext* pcc, uint8_t* pkt, uint32_t hdrLength, uint32_t paylen, const uint8_t* iv, uint8_t* tag) {
+        pcc->cipher->gcm_encrypt(pkt + hdrLength, paylen, pkt, hdrLength, iv, tag);
+    }
+    static bool decrypt(CryptoContext* pcc, uint8_t* pkt, uint32_t hdrLength, uint32_t paylen, const uint8_t* iv, const uint8_t* tag) {
+        return pcc->cipher->gcm_decrypt(pkt + hdrLength, paylen, pkt, hdrLength, iv, tag);
+    }
+};
+
+struct CryptoContext::ChaCha20Poly1305 {
+    static void encrypt(CryptoContext* pcc, uint8_t* pkt, uint32_t hdrLength, uint32_t paylen, const uint8_t* iv, uint8_t* tag) {
+        pcc->cipher->chacha_encrypt(pkt + hdrLength, paylen, pkt, hdrLength, iv, tag);
+    }
+    static bool decrypt(CryptoContext* pcc, uint8_t* pkt, uint32_t hdrLength, uint32_t paylen, const uint8_t* iv, const uint8_t* tag) {
+        return pcc->cipher->chacha_decrypt(pkt + hdrLength, paylen, pkt, hdrLength, iv, tag);
+    }
+};
+
+struct CryptoContext::NullMac {
+    static void authenticate(CryptoContext*, uint8_t*, uint32_t, uint32_t, uint8_t*) {}
+    static bool verify(CryptoContext*, uint8_t*, uint32_t, uint32_t, const uint8_t*) { return true; }
+};
+
+struct CryptoContext::HmacSha1 {
+    static void authenticate(CryptoContext* pcc, uint8_t* pkt, uint32_t pktlen, uint32_t roc, uint8_t* tag) {
+        unsigned char temp[20];
+        uint32_t beRoc = zrtpBe32(roc);
+
+        hmacSha1Ctx2(pcc->macCtx, pkt, pktlen, (unsigned char *)&beRoc, sizeof(beRoc), temp);
+        memcpy(tag, temp, pcc->tagLength);
+    }
+    static bool verify(CryptoContext* pcc, uint8_t* pkt, uint32_t pktlen, uint32_t roc, const uint8_t* tag) {
+        uint8_t mac[20];
+        authenticate(pcc, pkt, pktlen, roc, mac);
+        return srtpTagEqual(tag, mac, pcc->tagLength);
+    }
+};
+
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+struct CryptoContext::SkeinMac {
+    static void authenticate(CryptoContext* pcc, uint8_t* pkt, uint32_t pktlen, uint32_t roc, uint8_t* tag) {
+        unsigned char temp[20];
+        uint32_t beRoc = zrtpBe32(roc);
+
+        macSkeinCtx(pcc->macCtx, pkt, pktlen, (unsigned char *)&beRoc, sizeof(beRoc), temp);
+        memcpy(tag, temp, pcc->tagLength);
+    }
+    static bool verify(CryptoContext* pcc, uint8_t* pkt, uint32_t pktlen, uint32_t roc, const uint8_t* tag) {
+        uint8_t mac[20];
+        authenticate(pcc, pkt, pktlen, roc, mac);
+        return srtpTagEqual(tag, mac, pcc->tagLength);
+    }
+};
+#endif
+
+/*
+ * The transform of a cipher and MAC. Unprotect checks the tag before it
+ * decrypts, as srtpVerifyDecrypt() does.
+ */
+template <class Cipher, class Mac>
+struct CryptoContext::SrtpTransform {
+    static void protect(CryptoContext* pcc, uint8_t* pkt, uint32_t pktlen, uint8_t* payload, uint32_t paylen,
+                        uint64_t index, uint32_t ssrc, uint8_t* tag) {
+        Cipher::encrypt(pcc, pkt, payload, paylen, index, ssrc);
+        Mac::authenticate(pcc, pkt, pktlen, (uint32_t)(index >> 16), tag);
+    }
+    static bool unprotect(CryptoContext* pcc, uint8_t* pkt, uint32_t pktlen, uint8_t* payload, uint32_t paylen,
+                          uint64_t index, uint32_t ssrc, const uint8_t* tag) {
+        if (!Mac::verify(pcc, pkt, pktlen, (uint32_t)(index >> 16), tag))
+            return false;
+        Cipher::encrypt(pcc, pkt, payload, paylen, index, ssrc);
+        return true;
+    }
+};
+
+template <class Aead>
+struct CryptoContext::AeadTransform {
+    static void protect(CryptoContext* pcc, uint8_t* pkt, uint32_t, uint8_t* payload, uint32_t paylen,
+                        uint64_t index, uint32_t ssrc, uint8_t* tag) {
+        uint8_t iv[SRTP_GCM_IV_LENGTH];
+
+        computeGcmIv(iv, index, ssrc, pcc->k_s);
+        Aead::encrypt(pcc, pkt, (uint32_t)(payload - pkt), paylen, iv, tag);
+    }
+    static bool unprotect(CryptoContext* pcc, uint8_t* pkt, uint32_t, uint8_t* payload, uint32_t paylen,
+                          uint64_t index, uint32_t ssrc, const uint8_t* tag) {
+        uint8_t iv[SRTP_GCM_IV_LENGTH];
+
+        computeGcmIv(iv, index, ssrc, pcc->k_s);
+        return Aead::decrypt(pcc, pkt, (uint32_t)(payload - pkt), paylen, iv, tag);
+    }
+};
+
+template <class Cipher>
+void CryptoContext::selectMac()
+{
+    if (tagLength == 0 || aalg == SrtpAuthenticationNull) {
+        protectTransform = &SrtpTransform<Cipher, NullMac>::protect;
+        unprotectTransform = &SrtpTransform<Cipher, NullMac>::unprotect;
+    }
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+    else if (aalg == SrtpAuthenticationSkeinHmac) {
+        protectTransform = &SrtpTransform<Cipher, SkeinMac>::protect;
+        unprotectTransform = &SrtpTransform<Cipher, SkeinMac>::unprotect;
+    }
+#endif
+    else {
+        protectTransform = &SrtpTransform<Cipher, HmacSha1>::protect;
+        unprotectTransform = &SrtpTransform<Cipher, HmacSha1>::unprotect;
+    }
+}
+
+void CryptoContext::selectTransform()
+{
+    switch (ealg) {
+        case SrtpEncryptionAESCM:
+        case SrtpEncryptionTWOCM:
+            selectMac<CounterMode>();
+            break;
+
+        case SrtpEncryptionAESF8:
+        case SrtpEncryptionTWOF8:
+            selectMac<F8Mode>();
+            break;
+
+        case SrtpEncryptionAESGCM128:
+        case SrtpEncryptionAESGCM256:
+            protectTransform = &AeadTransform<AesGcm>::protect;
+            unprotectTransform = &AeadTransform<AesGcm>::unprotect;
+            break;
+
+        case SrtpEncryptionCHACHA20POLY1305:
+            protectTransform = &AeadTransform<ChaCha20Poly1305>::protect;
+            unprotectTransform = &AeadTransform<ChaCha20Poly1305>::unprotect;
+            break;
+
+        default:
+            selectMac<NullCipher>();
+            break;
+    }
+}
 
-        cipher->f8_encrypt(payload, paylen, iv, f8Cipher);
+bool CryptoContext::srtpEncryptLane(uint8_t* pkt, uint8_t* payload, uint32_t paylen, uint64_t index, uint32_t ssrc,
+                                    SrtpCtrLane* lane) {
+
+    if ((ealg != SrtpEncryptionAESCM && ealg != SrtpEncryptionTWOCM) || (keyStreamRing != NULL && ssrc == ssrcCtx)) {
+        srtpEncrypt(pkt, payload, paylen, index, ssrc);
+        return false;
     }
+    computeCmIv(lane->iv, index, ssrc, k_s);
+    lane->cipher = cipher;
+    lane->input = payload;
+    lane->output = payload;
+    lane->length = paylen;
+    return true;
 }
 
 /* Warning: tag must have been initialized */
@@ -217,38 +718,140 @@ void CryptoContext::srtpAuthenticate(uint8_t* pkt, uint32_t pktlen, uint32_t roc
     if (aalg == SrtpAuthenticationNull) {
         return;
     }
-    uint32_t macL;
-
     unsigned char temp[20];
-
-    std::vector<const uint8_t*>chunks;
-    std::vector<uint64_t> chunkLength;
-    uint32_t beRoc = zrtpHtonl(roc);
-
-    chunks.push_back(pkt);
-    chunkLength.push_back(pktlen);
-
-    chunks.push_back((unsigned char *)&beRoc);
-    chunkLength.push_back(4);
+    uint32_t beRoc = zrtpBe32(roc);
 
     switch (aalg) {
     case SrtpAuthenticationSha1Hmac:
-        hmacSha1Ctx(macCtx,
-                    chunks,           // data chunks to hash
-                    chunkLength,      // length of the data to hash
-                    temp, &macL);
+        hmacSha1Ctx2(macCtx,
+                     pkt, pktlen,       // the packet data
+                     (unsigned char *)&beRoc, sizeof(beRoc),
+                     temp);
         /* truncate the result */
         memcpy(tag, temp, getTagLength());
         break;
+#ifndef ZRTP_MINIMAL_ALGORITHMS
     case SrtpAuthenticationSkeinHmac:
         macSkeinCtx(macCtx,
-                    chunks,           // data chunks to hash
-                    chunkLength,      // length of the data to hash
+                    pkt, pktlen,        // the packet data
+                    (unsigned char *)&beRoc, sizeof(beRoc),
                     temp);
         /* truncate the result */
         memcpy(tag, temp, getTagLength());
         break;
+#endif
+    }
+}
+
+void CryptoContext::srtpAuthenticate(std::vector<const uint8_t*>& data, std::vector<uint64_t>& dataLength,
+                                     uint32_t roc, uint8_t* tag)
+{
+    if (aalg == SrtpAuthenticationNull) {
+        return;
+    }
+    unsigned char temp[20];
+    uint32_t beRoc = zrtpBe32(roc);
+    uint32_t macLength;
+
+    data.push_back((const uint8_t*)&beRoc);
+    dataLength.push_back(sizeof(beRoc));
+
+    switch (aalg) {
+    case SrtpAuthenticationSha1Hmac:
+        hmacSha1Ctx(macCtx, data, dataLength, temp, &macLength);
+        memcpy(tag, temp, getTagLength());
+        break;
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+    case SrtpAuthenticationSkeinHmac:
+        macSkeinCtx(macCtx, data, dataLength, temp);
+        memcpy(tag, temp, getTagLength());
+        break;
+#endif
+    }
+    data.pop_back();
+    dataLength.pop_back();
+}
+
+void CryptoContext::srtpAuthenticate(const uint8_t* data[], uint64_t dataLength[], size_t count, uint32_t roc,
+                                     uint8_t* tag)
+{
+    if (aalg == SrtpAuthenticationNull) {
+        return;
+    }
+    unsigned char temp[20];
+    uint32_t beRoc = zrtpBe32(roc);
+
+    data[count] = (const uint8_t*)&beRoc;
+    dataLength[count] = sizeof(beRoc);
+
+    switch (aalg) {
+    case SrtpAuthenticationSha1Hmac:
+        hmacSha1Ctx(macCtx, data, dataLength, count + 1, temp);
+        memcpy(tag, temp, getTagLength());
+        break;
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+    case SrtpAuthenticationSkeinHmac:
+        macSkeinCtx(macCtx, data, dataLength, count + 1, temp);
+        memcpy(tag, temp, getTagLength());
+        break;
+#endif
     }
+    data[count] = NULL;
+}
+
+bool CryptoContext::srtpAuthenticateLane(const uint8_t* pkt, uint32_t pktlen, const uint32_t* beRoc, hmacSha1Lane* lane)
+{
+    if (aalg != SrtpAuthenticationSha1Hmac || tagLength == 0)
+        return false;
+
+    lane->ctx = macCtx;
+    lane->data1 = pkt;
+    lane->data1Length = pktlen;
+    lane->data2 = (const uint8_t*)beRoc;
+    lane->data2Length = sizeof(*beRoc);
+    return true;
+}
+
+bool CryptoContext::srtpVerifyTag(uint8_t* pkt, uint32_t pktlen, uint32_t roc, const uint8_t* tag)
+{
+    if (aalg == SrtpAuthenticationNull || tagLength == 0)
+        return true;
+
+    uint8_t mac[20];
+    srtpAuthenticate(pkt, pktlen, roc, mac);
+    return srtpTagEqual(tag, mac, tagLength);
+}
+
+bool CryptoContext::srtpVerifyTag(std::vector<const uint8_t*>& data, std::vector<uint64_t>& dataLength, uint32_t roc,
+                                  const uint8_t* tag)
+{
+    if (aalg == SrtpAuthenticationNull || tagLength == 0)
+        return true;
+
+    uint8_t mac[20];
+    srtpAuthenticate(data, dataLength, roc, mac);
+    return srtpTagEqual(tag, mac, tagLength);
+}
+
+bool CryptoContext::srtpVerifyTag(const uint8_t* data[], uint64_t dataLength[], size_t count, uint32_t roc,
+                                  const uint8_t* tag)
+{
+    if (aalg == SrtpAuthenticationNull || tagLength == 0)
+        return true;
+
+    uint8_t mac[20];
+    srtpAuthenticate(data, dataLength, count, roc, mac);
+    return srtpTagEqual(tag, mac, tagLength);
+}
+
+bool CryptoContext::srtpVerifyDecrypt(uint8_t* pkt, uint32_t pktlen, uint8_t* payload, uint32_t paylen, uint64_t index,
+                                      uint32_t ssrc, const uint8_t* tag)
+{
+    if (!srtpVerifyTag(pkt, pktlen, (uint32_t)(index >> 16), tag))
+        return false;
+
+    srtpEncrypt(pkt, payload, paylen, index, ssrc);
+    return true;
 }
 
 /* used by the key derivation method */
@@ -285,51 +888,254 @@ static void computeIv(unsigned char* iv, uint64_t label, uint64_t index,
     iv[14] = iv[15] = 0;
 }
 
-/* Derive the srtp session keys from the master key */
-void CryptoContext::deriveSrtpKeys(uint64_t index)
-{
+/*
+ * One key stream of the key derivation: the derived key, its length and the
+ * IV of its label.
+ */
+struct KeyLabel {
+    uint8_t* key;
+    int32_t length;
     uint8_t iv[16];
+};
+
+// Enough for the six labels of an SRTP and an SRTCP context with maximum key lengths
+static const int32_t maxKeyBlocks = 6 * ((SRTP_MAX_KEY_LENGTH + SRTP_BLOCK_SIZE - 1) / SRTP_BLOCK_SIZE);
+
+/*
+ * Compute the key streams of the labels with one call of the cipher. The
+ * counter blocks of a label are its IV with the block number in the last two
+ * bytes, the same blocks as get_ctr_cipher_stream() uses.
+ */
+static void deriveKeyStreams(SrtpSymCrypto* kdCipher, KeyLabel* labels, int32_t numLabels)
+{
+    uint8_t blocks[maxKeyBlocks * SRTP_BLOCK_SIZE];
+    uint8_t keyStream[maxKeyBlocks * SRTP_BLOCK_SIZE];
+    int32_t numBlocks = 0;
+
+    for (int32_t i = 0; i < numLabels; i++)
+        numBlocks += (labels[i].length + SRTP_BLOCK_SIZE - 1) / SRTP_BLOCK_SIZE;
+
+    if (numBlocks > maxKeyBlocks) {
+        for (int32_t i = 0; i < numLabels; i++)
+            kdCipher->get_ctr_cipher_stream(labels[i].key, labels[i].length, labels[i].iv);
+        return;
+    }
+    uint8_t* block = blocks;
+    for (int32_t i = 0; i < numLabels; i++) {
+        for (uint16_t ctr = 0; ctr * SRTP_BLOCK_SIZE < labels[i].length; ctr++) {
+            memcpy(block, labels[i].iv, 14);
+            block[14] = (uint8_t)(ctr >> 8);
+            block[15] = (uint8_t)ctr;
+            block += SRTP_BLOCK_SIZE;
+        }
+    }
+    kdCipher->encryptBlocks(blocks, keyStream, numBlocks);
+
+    const uint8_t* stream = keyStream;
+    for (int32_t i = 0; i < numLabels; i++) {
+        if (labels[i].length > 0)
+            memcpy(labels[i].key, stream, labels[i].length);
+        stream += ((labels[i].length + SRTP_BLOCK_SIZE - 1) / SRTP_BLOCK_SIZE) * SRTP_BLOCK_SIZE;
+    }
+    memset(keyStream, 0, sizeof(keyStream));
+}
+
+/*
+ * Derive a key set from the master key: prepare kdCipher (and kdF8Cipher) with
+ * the session key, store the session salt and initialize the MAC context inside
+ * hmacStore. Returns the MAC context.
+ */
+void* CryptoContext::deriveKeySet(uint64_t index, SrtpSymCrypto* kdCipher, SrtpSymCrypto* kdF8Cipher,
+                                  uint8_t* salt, HmacCtx* hmacStore)
+{
+    KeyLabel labels[3] = {{k_e, n_e, {0}}, {k_a, n_a, {0}}, {salt, n_s, {0}}};
+
+    // compute the session encryption key, authentication key and salt
+    for (int32_t i = 0; i < 3; i++)
+        computeIv(labels[i].iv, labelBase + i, index, key_deriv_rate, master_salt);
 
     // prepare cipher to compute derived keys.
-    cipher->setNewKey(master_key, master_key_length);
-    memset(master_key, 0, master_key_length);
+    kdCipher->setNewKey(master_key, master_key_length);
+    deriveKeyStreams(kdCipher, labels, 3);
 
-    // compute the session encryption key
-    uint64_t label = labelBase + 0;
-    computeIv(iv, label, index, key_deriv_rate, master_salt);
-    cipher->get_ctr_cipher_stream(k_e, n_e, iv);
+    return installKeySet(kdCipher, kdF8Cipher, salt, hmacStore);
+}
 
-    // compute the session authentication key
-    label = labelBase + 0x01;
-    computeIv(iv, label, index, key_deriv_rate, master_salt);
-    cipher->get_ctr_cipher_stream(k_a, n_a, iv);
+/*
+ * Initialize the MAC context with the session authentication key and prepare
+ * kdCipher (and kdF8Cipher) with the session key. Returns the MAC context.
+ */
+void* CryptoContext::installKeySet(SrtpSymCrypto* kdCipher, SrtpSymCrypto* kdF8Cipher, uint8_t* salt, HmacCtx* hmacStore)
+{
+    void* mac = NULL;
 
     // Initialize MAC context with the derived key
     switch (aalg) {
     case SrtpAuthenticationSha1Hmac:
-        macCtx = &hmacCtx.hmacSha1Ctx;
-        macCtx = initializeSha1HmacContext(macCtx, k_a, n_a);
+        mac = initializeSha1HmacContext(&hmacStore->hmacSha1Ctx, k_a, n_a);
         break;
+#ifndef ZRTP_MINIMAL_ALGORITHMS
     case SrtpAuthenticationSkeinHmac:
-        macCtx = &hmacCtx.hmacSkeinCtx;
-
         // Skein MAC uses number of bits as MAC size, not just bytes
-        macCtx = initializeSkeinMacContext(macCtx, k_a, n_a, tagLength*8, Skein512);
+        mac = initializeSkeinMacContext(&hmacStore->hmacSkeinCtx, k_a, n_a, tagLength*8, Skein512);
         break;
+#endif
     }
     memset(k_a, 0, n_a);
 
-    // compute the session salt
-    label = labelBase + 0x02;
-    computeIv(iv, label, index, key_deriv_rate, master_salt);
-    cipher->get_ctr_cipher_stream(k_s, n_s, iv);
-    memset(master_salt, 0, master_salt_length);
-
     // as last step prepare cipher with derived key.
-    cipher->setNewKey(k_e, n_e);
-    if (f8Cipher != NULL)
-        cipher->f8_deriveForIV(f8Cipher, k_e, n_e, k_s, n_s);
+    kdCipher->setNewKey(k_e, n_e);
+    if (kdF8Cipher != NULL)
+        kdCipher->f8_deriveForIV(kdF8Cipher, k_e, n_e, salt, n_s);
     memset(k_e, 0, n_e);
+
+    return mac;
+}
+
+/* Derive the srtp session keys from the master key */
+void CryptoContext::deriveSrtpKeys(uint64_t index)
+{
+    deriveSrtpKeys(index, NULL);
+}
+
+/*
+ * The SRTCP context can use the key schedule of this context if both contexts
+ * use the same cipher, master key and master salt.
+ */
+bool CryptoContext::sharesMasterKey(const CryptoContextCtrl* ctrl) const
+{
+    return cipher != NULL && ctrl->cipher != NULL &&
+           cipher->getAlgorithm() == ctrl->cipher->getAlgorithm() &&
+           master_key_length == ctrl->master_key_length &&
+           memcmp(master_key, ctrl->master_key, master_key_length) == 0 &&
+           master_salt_length == ctrl->master_salt_length &&
+           memcmp(master_salt, ctrl->master_salt, master_salt_length) == 0;
+}
+
+/*
+ * Use the session keys that another clone of the same context derived. Only
+ * clones without a key derivation rate and with the default label base share
+ * keys, their keys do not depend on the index.
+ */
+bool CryptoContext::useSharedKeys()
+{
+    if (sharedKeys == NULL || key_deriv_rate != 0 || labelBase != 0 ||
+        sharedKeys->state.load(std::memory_order_acquire) != SharedKeys::Ready)
+        return false;
+
+    if (cipher != sharedKeys->cipher) {
+        delete cipher;
+        delete f8Cipher;
+        cipher = sharedKeys->cipher;
+        f8Cipher = sharedKeys->f8Cipher;
+    }
+    if (n_s > 0)
+        memcpy(k_s, sharedKeys->salt, n_s);
+    hmacCtx = sharedKeys->hmac;
+    macCtx = sharedKeys->hasMac ? (void*)&hmacCtx : NULL;
+    return true;
+}
+
+/*
+ * The first clone that derived its keys hands its ciphers, the session salt
+ * and a copy of the initialized MAC context to the shared keys.
+ */
+void CryptoContext::publishSharedKeys()
+{
+    if (sharedKeys == NULL || key_deriv_rate != 0 || labelBase != 0)
+        return;
+
+    int32_t expected = SharedKeys::Empty;
+    if (!sharedKeys->state.compare_exchange_strong(expected, SharedKeys::Publishing, std::memory_order_acq_rel))
+        return;
+
+    // The clones must not compute the GHASH tables concurrently on first use
+    if (ealg == SrtpEncryptionAESGCM128 || ealg == SrtpEncryptionAESGCM256)
+        cipher->gcmPrepare();
+    sharedKeys->cipher = cipher;
+    sharedKeys->f8Cipher = f8Cipher;
+    if (n_s > 0)
+        memcpy(sharedKeys->salt, k_s, n_s);
+    sharedKeys->hmac = hmacCtx;
+    sharedKeys->hasMac = macCtx != NULL;
+    sharedKeys->aalg = aalg;
+    sharedKeys->state.store(SharedKeys::Ready, std::memory_order_release);
+}
+
+void CryptoContext::deriveSrtpKeys(uint64_t index, CryptoContextCtrl* ctrl)
+{
+    if (ctrl != NULL && !sharesMasterKey(ctrl)) {
+        ctrl->deriveSrtcpKeys();
+        ctrl = NULL;
+    }
+    if (ctrl == NULL && useSharedKeys()) {
+        // Another clone derived the same keys already
+    }
+    else if (ctrl == NULL) {
+        macCtx = deriveKeySet(index, cipher, f8Cipher, k_s, &hmacCtx);
+        publishSharedKeys();
+    }
+    else {
+        // The SRTCP labels do not use the key derivation rate, RFC 3711 chapter 4.3.2
+        KeyLabel labels[6] = {{k_e, n_e, {0}}, {k_a, n_a, {0}}, {k_s, n_s, {0}},
+                              {ctrl->k_e, ctrl->n_e, {0}}, {ctrl->k_a, ctrl->n_a, {0}}, {ctrl->k_s, ctrl->n_s, {0}}};
+        for (int32_t i = 0; i < 3; i++) {
+            computeIv(labels[i].iv, labelBase + i, index, key_deriv_rate, master_salt);
+            computeIv(labels[i + 3].iv, ctrl->labelBase + i, 0, 0, ctrl->master_salt);
+        }
+        cipher->setNewKey(master_key, master_key_length);
+        deriveKeyStreams(cipher, labels, 6);
+
+        macCtx = installKeySet(cipher, f8Cipher, k_s, &hmacCtx);
+        ctrl->installSrtcpKeys();
+    }
+    keyId = (key_deriv_rate == 0) ? 0 : (int64_t)(index / key_deriv_rate);
+    spareKeyId = -1;
+
+    // Without a key derivation rate the context never needs the master key again,
+    // unless the application exports the state
+    if (key_deriv_rate == 0 && !exportable) {
+        memset(master_key, 0, master_key_length);
+        memset(master_salt, 0, master_salt_length);
+    }
+}
+
+void CryptoContext::switchSrtpKeys(uint64_t index)
+{
+    if (cipher == NULL)
+        return;
+
+    int64_t period = (int64_t)(index / key_deriv_rate);
+
+    if (spareCipher == NULL) {
+        spareCipher = new SrtpSymCrypto(cipher->getAlgorithm());
+        if (f8Cipher != NULL)
+            spareF8Cipher = new SrtpSymCrypto(f8Cipher->getAlgorithm());
+        spareK_s = sessionSalts[1];
+    }
+    // macCtx points into one of the unions, the spare key set uses the other
+    HmacCtx* spareStore = (macCtx == (void*)&hmacCtx) ? &spareHmacCtx : &hmacCtx;
+
+    if (period != keyId) {
+        // Not precomputed, for example a late packet or a jump of the index
+        if (period != spareKeyId) {
+            spareMacCtx = deriveKeySet(index, spareCipher, spareF8Cipher, spareK_s, spareStore);
+            spareKeyId = period;
+        }
+        std::swap(cipher, spareCipher);
+        std::swap(f8Cipher, spareF8Cipher);
+        std::swap(k_s, spareK_s);
+        std::swap(macCtx, spareMacCtx);
+        std::swap(keyId, spareKeyId);
+        spareStore = (macCtx == (void*)&hmacCtx) ? &spareHmacCtx : &hmacCtx;
+    }
+    // Pre-derive the keys of the next period once the index passed the middle
+    // of the current period. The key derivation rate is a power of 2 (RFC 3711).
+    if (spareKeyId != period + 1 && (index % key_deriv_rate) >= (uint64_t)key_deriv_rate / 2) {
+        spareMacCtx = deriveKeySet((uint64_t)(period + 1) * key_deriv_rate,
+                                   spareCipher, spareF8Cipher, spareK_s, spareStore);
+        spareKeyId = period + 1;
+    }
 }
 
 /* Based on the algorithm provided in Appendix A - draft-ietf-srtp-05.txt */
@@ -387,14 +1193,12 @@ bool CryptoContext::checkReplay(uint16_t newSeq)
         return true;           /* Packet not yet received*/
     }
     else {
-        if (-delta >= REPLAY_WINDOW_SIZE) {
+        if (-delta >= replayWindowSize) {
             return false;      /* Packet too old */
         }
 
-        delta = -delta;
-        int idx = (int)delta / 64;
-        uint64_t bit = (uint64_t)1UL << (delta % 64);
-        if ((replay_window[idx] & bit) == bit) {
+        uint64_t bit = (uint64_t)1UL << (guessed_index % 64);
+        if ((replayWindow[(guessed_index / 64) % replayWords] & bit) == bit) {
             return false;  /* Packet already received ! */
         }
         else {
@@ -404,61 +1208,53 @@ bool CryptoContext::checkReplay(uint16_t newSeq)
 }
 
 // This function assumes that it never gets a sequence number that is out of order
-// greater or equal than REPLAY_WINDOW_SIZE. Thus an application MUST perform a 
+// greater or equal than replayWindowSize. Thus an application MUST perform a
 // replay check first and discard any packet which fails this check. This restriction
-// applies to older packets only, a new (not seen) packet's sequence number can jump 
-// ahead by more than REPLAY_WINDOW_SIZE.
+// applies to older packets only, a new (not seen) packet's sequence number can jump
+// ahead by more than replayWindowSize.
 void CryptoContext::update(uint16_t newSeq)
 {
     // Get the index of the new sequence number and compute the delta to the
-    // index of the highest sequence number we received so far. If the delta 
+    // index of the highest sequence number we received so far. If the delta
     // is negative then we received an older packet, thus we will not
     // update the locally stored remote sequence number (s_l) below.
-    int64_t delta = guessIndex(newSeq) - (((uint64_t)roc) << 16 | s_l );
-    int64_t rocDelta = delta;
-    uint64_t carry = 0;
-
-    // update the replay shift register
-    // The shift register array stores bits of newer packets (higher sequence numbers) at 
-    // index 0 and shifts older packets (lower sequence numbers) left to index one
-    if (delta > 0) {                         // We got a new packet, no yet seen
-        if (delta >= REPLAY_WINDOW_SIZE) {
-            replay_window[0] = 1;
-            replay_window[1] = 0;
+    uint64_t newIndex = guessIndex(newSeq);
+    uint64_t localIndex = ((uint64_t)roc) << 16 | s_l;
+    int64_t delta = newIndex - localIndex;
+
+    // update the replay bitmap
+    // If we got a new packet, not yet seen, then clear the words that the window
+    // enters. These words hold bits of packets that are older than the window.
+    if (delta > 0) {
+        uint64_t words = (newIndex / 64) - (localIndex / 64);
+
+        if (words >= (uint64_t)replayWords) {
+            memset(replayWindow, 0, replayWords * sizeof(uint64_t));
         }
         else {
-            if (delta < REPLAY_WINDOW_SIZE/2) {
-                carry = replay_window[0] >> ((REPLAY_WINDOW_SIZE/2) - delta);
-                replay_window[0] = (replay_window[0] << delta) | 1;
-                replay_window[1] = (replay_window[1] << delta) | carry;
-            }
-            else {
-                replay_window[1] = replay_window[0] << (delta - REPLAY_WINDOW_SIZE/2);
-                replay_window[0] = 1;
-            }
+            for (uint64_t w = localIndex / 64 + 1; w <= newIndex / 64; w++)
+                replayWindow[w % replayWords] = 0;
         }
     }
-    else {
-        delta = -delta;
-        int idx = (int)delta / 64;
-        uint64_t bit = (uint64_t)1UL << (delta % 64);
-        replay_window[idx] |= bit;
-    }
+    replayWindow[(newIndex / 64) % replayWords] |= (uint64_t)1UL << (newIndex % 64);
 
     // update the locally stored ROC and highest sequence number if we received a not
     // yet received packet, i.e. the delta is > 0
-    if (rocDelta > 0 && newSeq > s_l) {
+    if (delta > 0 && newSeq > s_l) {
         s_l = newSeq;
     }
+    if (delta < 0)
+        counters.countLatePacket();
     // Reset local stored sequence number (low 16 bits) also if ROC increases
     // The guessed_roc is bigger than roc only if we received a not yet seen packet.
     if (guessed_roc > roc) {
         roc = guessed_roc;
         s_l = newSeq;
+        counters.countRocRollover();
     }
 }
 
-CryptoContext* CryptoContext::newCryptoContextForSSRC(uint32_t ssrc, int roc, int64_t keyDerivRate)
+CryptoContext* CryptoContext::newCryptoContextForSSRC(uint32_t ssrc, int roc, int64_t keyDerivRate, int32_t replayWindowSize)
 {
     CryptoContext* pcc = new CryptoContext(
         ssrc,
@@ -473,7 +1269,20 @@ CryptoContext* CryptoContext::newCryptoContextForSSRC(uint32_t ssrc, int roc, in
         this->ekeyl,                             // encryption keyl
         this->akeyl,                             // authentication key len
         this->skeyl,                             // session salt len
-        this->tagLength);                        // authentication tag len
-
+        this->tagLength,                         // authentication tag len
+        replayWindowSize > 0 ? replayWindowSize : this->replayWindowSize);
+    pcc->exportable = exportable;
+
+#ifdef ZRTP_SHARED_KEY_SCHEDULES
+    // Only the embedded crypto sets ZRTP_SHARED_KEY_SCHEDULES. The OpenSSL and
+    // gcrypt keys hold library handles with per-packet state that the clones
+    // cannot share
+    if (keyDerivRate == 0 && cipher != NULL) {
+        if (sharedKeys == NULL)
+            sharedKeys = new SharedKeys(this);
+        sharedKeys->refs.fetch_add(1, std::memory_order_relaxed);
+        pcc->sharedKeys = sharedKeys;
+    }
+#endif
     return pcc;
 }
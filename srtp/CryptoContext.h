@@ -26,6 +26,63 @@
 
 #define REPLAY_WINDOW_SIZE 128
 
+/**
+ * Maximum SRTP replay window size in packets. The window must be smaller
+ * than half of the sequence number space, otherwise the index guessing
+ * (RFC 3711, Appendix A) cannot distinguish old and new packets.
+ */
+#define SRTP_MAX_REPLAY_WINDOW_SIZE 32768
+
+/**
+ * Maximum lengths of the master key, master salt and session keys in bytes.
+ * The CryptoContext stores the keys in arrays of this size and ignores key
+ * data beyond these lengths.
+ */
+#define SRTP_MAX_KEY_LENGTH         32
+#define SRTP_MAX_SALT_LENGTH        14
+#define SRTP_MAX_AUTH_KEY_LENGTH    32
+
+/**
+ * Number of replay window words that the CryptoContext stores inline. Larger
+ * replay windows use an allocated bitmap.
+ */
+#define SRTP_INLINE_REPLAY_WORDS    (REPLAY_WINDOW_SIZE / 64 + 1)
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Compare two authentication tags in constant time.
+ *
+ * The run time depends on the tag length only, not on the tag data. The
+ * function compares 64 bit words and no branch depends on the data.
+ *
+ * @param tag
+ *    The received tag.
+ * @param mac
+ *    The computed tag.
+ * @param length
+ *    The length of the tags in bytes.
+ * @return
+ *    @c true if the tags are equal.
+ */
+static inline bool srtpTagEqual(const uint8_t* tag, const uint8_t* mac, int32_t length)
+{
+    uint64_t diff = 0;
+    int32_t i = 0;
+
+    for (; i + 8 <= length; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, tag + i, 8);
+        memcpy(&b, mac + i, 8);
+        diff |= a ^ b;
+    }
+    for (; i < length; i++)
+        diff |= (uint64_t)(tag[i] ^ mac[i]);
+
+    return diff == 0;
+}
+
 const int SrtpAuthenticationNull      = 0;
 const int SrtpAuthenticationSha1Hmac  = 1;
 const int SrtpAuthenticationSkeinHmac = 2;
@@ -35,6 +92,9 @@ const int SrtpEncryptionAESCM = 1;
 const int SrtpEncryptionAESF8 = 2;
 const int SrtpEncryptionTWOCM = 3;
 const int SrtpEncryptionTWOF8 = 4;
+const int SrtpEncryptionAESGCM128 = 5;
+const int SrtpEncryptionAESGCM256 = 6;
+const int SrtpEncryptionCHACHA20POLY1305 = 7;
 
 // Check if included via CryptoContextCtrl.cpp - avoid double definitions
 #ifndef CRYPTOCONTEXTCTRL_H
@@ -42,11 +102,20 @@ const int SrtpEncryptionTWOF8 = 4;
 #include <stdint.h>
 #ifdef ZRTP_OPENSSL
 #include <openssl/hmac.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/evp.h>
+#endif
 #endif
 #include "crypto/hmac.h"
 #include "cryptcommon/macSkein.h"
+#include "srtp/SrtpStatistics.h"
+#include "srtp/SrtpMemoryPool.h"
 
 class SrtpSymCrypto;
+class MemoryUsage;
+class CryptoContextCtrl;
+typedef struct _SrtpCtrLane SrtpCtrLane;
+struct KeyStreamRing;
 
 /**
  * @brief Implementation for a SRTP cryptographic context.
@@ -158,13 +227,19 @@ public:
      * @param ealg
      *    The encryption algorithm to use. Possible values are <code>
      *    SrtpEncryptionNull, SrtpEncryptionAESCM, SrtpEncryptionAESF8,
-     *    SrtpEncryptionTWOCM, SrtpEncryptionTWOF8</code>. See chapter 4.1.1
-     *    for AESCM (Counter mode) and 4.1.2 for AES F8 mode.
+     *    SrtpEncryptionTWOCM, SrtpEncryptionTWOF8, SrtpEncryptionAESGCM128,
+     *    SrtpEncryptionAESGCM256, SrtpEncryptionCHACHA20POLY1305</code>. See
+     *    chapter 4.1.1 for AESCM (Counter mode) and 4.1.2 for AES F8 mode. The
+     *    AES-GCM modes are AEAD modes as defined in RFC 7714, they ignore @c aalg
+     *    and use a 16 byte tag and a 12 byte salt. The ChaCha20-Poly1305 mode
+     *    works the same way with a 32 byte key, it uses the IV and AAD of RFC
+     *    7714 and the AEAD of RFC 8439. The minimal algorithm build
+     *    (@c ZRTP_MINIMAL_ALGORITHMS) supports only Null, AESCM and AESF8.
      *
      * @param aalg
      *    The authentication algorithm to use. Possible values are <code>
      *    SrtpEncryptionNull, SrtpAuthenticationSha1Hmac, SrtpAuthenticationSkeinHmac
-     *    </code>.
+     *    </code>. The minimal algorithm build does not support Skein.
      *
      * @param masterKey
      *    Pointer to the master key for this SRTP cryptographic context.
@@ -209,6 +284,11 @@ public:
      *    to the RTP packet. The @c CryptoContext supports @c SrtpAuthenticationSha1Hmac
      *    with 4 and 10 byte (32 and 80 bits) and @c SrtpAuthenticationSkeinHmac
      *    with 4 and 8 bytes (32 and 64 bits) tag length. Refer to chapter 4.2. in RFC 3711.
+     *
+     * @param replayWindowSize
+     *    The size of the replay window in packets. The context rounds the
+     *    size up to a multiple of 64 and limits it to @c SRTP_MAX_REPLAY_WINDOW_SIZE.
+     *    The cost of the replay check does not depend on the window size.
      */
     CryptoContext(uint32_t ssrc, int32_t roc,
                    int64_t  keyDerivRate,
@@ -221,7 +301,8 @@ public:
                    int32_t  ekeyl,
                    int32_t  akeyl,
                    int32_t  skeyl,
-                   int32_t  tagLength);
+                   int32_t  tagLength,
+                   int32_t  replayWindowSize = REPLAY_WINDOW_SIZE);
 
     /**
      * @brief Destructor.
@@ -230,6 +311,12 @@ public:
      */
     ~CryptoContext();
 
+    /**
+     * @brief Allocate and release CryptoContext objects with the SrtpMemoryPool.
+     */
+    static void* operator new(size_t size) { return SrtpMemoryPool::allocate(size); }
+    static void operator delete(void* ptr, size_t size) { SrtpMemoryPool::release(ptr, size); }
+
     /**
      * @brief Set the Roll-Over-Counter.
      *
@@ -275,6 +362,147 @@ public:
      */
     void srtpEncrypt(uint8_t* pkt, uint8_t* payload, uint32_t paylen, uint64_t index, uint32_t ssrc);
 
+    /**
+     * @brief Perform SRTP encryption, out-of-place.
+     *
+     * Same as above but reads the data from @c payload and stores the result
+     * in @c out. The buffers must not overlap unless they are identical.
+     *
+     * @param pkt
+     *    Pointer to the RTP header of the output packet, used for F8.
+     *
+     * @param payload
+     *    The data to encrypt.
+     *
+     * @param paylen
+     *    Length of payload.
+     *
+     * @param out
+     *    Buffer for the encrypted data, at least @c paylen bytes.
+     *
+     * @param index
+     *    The 48 bit SRTP packet index. See the <code>guessIndex</code>
+     *    method.
+     *
+     * @param ssrc
+     *    The RTP SSRC data in <em>host</em> order.
+     */
+    void srtpEncrypt(const uint8_t* pkt, const uint8_t* payload, uint32_t paylen, uint8_t* out, uint64_t index, uint32_t ssrc);
+
+    /**
+     * @brief Prepare the SRTP encryption of a packet as a counter-mode job.
+     *
+     * The batch functions collect the jobs of several packets and contexts
+     * and encrypt them with SrtpSymCrypto::ctrEncryptLanes(). If the context
+     * does not use a counter mode, or if the key stream ring holds the key
+     * stream of the packet, the function encrypts the payload in place as
+     * srtpEncrypt() does.
+     *
+     * @param pkt
+     *    Pointer to RTP packet buffer, used for F8.
+     *
+     * @param payload
+     *    The data to encrypt, in place.
+     *
+     * @param paylen
+     *    Length of payload.
+     *
+     * @param index
+     *    The 48 bit SRTP packet index.
+     *
+     * @param ssrc
+     *    The RTP SSRC data in <em>host</em> order.
+     *
+     * @param lane
+     *    Receives the counter-mode job.
+     *
+     * @return
+     *    @c true if the job in @c lane encrypts the payload, @c false if the
+     *    function encrypted the payload already.
+     */
+    bool srtpEncryptLane(uint8_t* pkt, uint8_t* payload, uint32_t paylen, uint64_t index, uint32_t ssrc, SrtpCtrLane* lane);
+
+    /**
+     * @brief Compute the SRTP key stream of a packet.
+     *
+     * Only the counter modes (AES-CM, Twofish-CM) support this. The application
+     * can XOR the key stream with the payload, for example if the payload is
+     * stored in several fragments.
+     *
+     * @param keyStream
+     *    Buffer that receives the key stream, at least @c length bytes.
+     *
+     * @param length
+     *    Number of key stream bytes, usually the payload length.
+     *
+     * @param index
+     *    The 48 bit SRTP packet index. See the <code>guessIndex</code>
+     *    method.
+     *
+     * @param ssrc
+     *    The RTP SSRC data in <em>host</em> order.
+     *
+     * @return
+     *    @c false if the encryption algorithm is not a counter mode.
+     */
+    bool srtpKeyStream(uint8_t* keyStream, uint32_t length, uint64_t index, uint32_t ssrc);
+
+    /**
+     * @brief Perform SRTP AEAD encryption (AES-GCM, ChaCha20-Poly1305).
+     *
+     * This method encrypts the payload in place and computes the tag over the
+     * RTP header and the encrypted payload, refer to RFC 7714, chapter 7.1.
+     *
+     * @param pkt
+     *    Pointer to RTP packet buffer, the RTP header is the AAD.
+     *
+     * @param hdrLength
+     *    Length of the RTP header including CSRC and header extension.
+     *
+     * @param paylen
+     *    Length of payload.
+     *
+     * @param index
+     *    The 48 bit SRTP packet index.
+     *
+     * @param ssrc
+     *    The RTP SSRC data in <em>host</em> order.
+     *
+     * @param tag
+     *    Points to a buffer that receives the tag, must be able to hold
+     *    <code>tagLength</code> bytes.
+     */
+    void srtpAeadEncrypt(uint8_t* pkt, uint32_t hdrLength, uint32_t paylen, uint64_t index, uint32_t ssrc, uint8_t* tag);
+
+    /**
+     * @brief Perform SRTP AEAD decryption (AES-GCM, ChaCha20-Poly1305).
+     *
+     * This method checks the tag and decrypts the payload in place if the
+     * tag is valid.
+     *
+     * @param pkt
+     *    Pointer to SRTP packet buffer.
+     *
+     * @param hdrLength
+     *    Length of the RTP header including CSRC and header extension.
+     *
+     * @param paylen
+     *    Length of payload without tag and MKI.
+     *
+     * @param index
+     *    The 48 bit SRTP packet index.
+     *
+     * @param ssrc
+     *    The RTP SSRC data in <em>host</em> order.
+     *
+     * @param tag
+     *    Points to the received tag.
+     *
+     * @return
+     *    true if the tag is valid, false otherwise.
+     */
+    bool srtpAeadDecrypt(uint8_t* pkt, uint32_t hdrLength, uint32_t paylen, uint64_t index, uint32_t ssrc, const uint8_t* tag);
+
     /**
      * @brief Compute the authentication tag.
      *
@@ -296,6 +524,202 @@ public:
      */
     void srtpAuthenticate(uint8_t* pkt, uint32_t pktlen, uint32_t roc, uint8_t* tag);
 
+    /**
+     * @brief Compute the authentication tag over several data chunks.
+     *
+     * Same as above for a RTP packet that is stored in several fragments. The
+     * function appends the ROC chunk to the vectors during the computation and
+     * removes it before it returns.
+     *
+     * @param data
+     *    Pointers to the data chunks of the RTP packet.
+     *
+     * @param dataLength
+     *    Length of each data chunk.
+     *
+     * @param roc
+     *    The 32 bit SRTP roll-over-counter.
+     *
+     * @param tag
+     *    Points to a buffer that hold the computed tag. This buffer must
+     *    be able to hold <code>tagLength</code> bytes.
+     */
+    void srtpAuthenticate(std::vector<const uint8_t*>& data, std::vector<uint64_t>& dataLength, uint32_t roc, uint8_t* tag);
+
+    /**
+     * @brief Compute the authentication tag over an array of data chunks.
+     *
+     * Same as above without memory allocation. The arrays must have room for
+     * @c count + 1 chunks, the function uses the element after the last data
+     * chunk for the ROC chunk during the computation.
+     *
+     * @param data
+     *    Pointers to the data chunks of the RTP packet.
+     *
+     * @param dataLength
+     *    Length of each data chunk.
+     *
+     * @param count
+     *    Number of data chunks.
+     *
+     * @param roc
+     *    The 32 bit SRTP roll-over-counter.
+     *
+     * @param tag
+     *    Points to a buffer that hold the computed tag. This buffer must
+     *    be able to hold <code>tagLength</code> bytes.
+     */
+    void srtpAuthenticate(const uint8_t* data[], uint64_t dataLength[], size_t count, uint32_t roc, uint8_t* tag);
+
+    /**
+     * @brief Prepare the authentication of a packet as a SHA1 HMAC job.
+     *
+     * The batch functions collect the jobs of several packets and contexts
+     * and compute them with hmacSha1CtxLanes(), then copy @c getTagLength()
+     * bytes of the job's digest to the tag. The job reads the HMAC context of
+     * this crypto context, thus the context must not change its keys until the
+     * job is done.
+     *
+     * @param pkt
+     *    Pointer to RTP packet buffer that contains the data to authenticate.
+     *
+     * @param pktlen
+     *    Length of the RTP packet buffer
+     *
+     * @param beRoc
+     *    The 32 bit SRTP roll-over-counter in network order, must stay valid until
+     *    the job is done.
+     *
+     * @param lane
+     *    Receives the HMAC job.
+     *
+     * @return
+     *    @c true if the context uses SHA1 HMAC and a tag, otherwise the caller
+     *    uses srtpAuthenticate().
+     */
+    bool srtpAuthenticateLane(const uint8_t* pkt, uint32_t pktlen, const uint32_t* beRoc, hmacSha1Lane* lane);
+
+    /**
+     * @brief Compute and check the authentication tag.
+     *
+     * Computes the authentication tag and compares it with the received tag in
+     * constant time, see srtpTagEqual().
+     *
+     * @param pkt
+     *    Pointer to RTP packet buffer that contains the data to authenticate.
+     *
+     * @param pktlen
+     *    Length of the RTP packet buffer
+     *
+     * @param roc
+     *    The 32 bit SRTP roll-over-counter.
+     *
+     * @param tag
+     *    The received tag, <code>tagLength</code> bytes.
+     *
+     * @return
+     *    @c true if the tag is valid or the context uses no authentication.
+     */
+    bool srtpVerifyTag(uint8_t* pkt, uint32_t pktlen, uint32_t roc, const uint8_t* tag);
+
+    /**
+     * @brief Compute and check the authentication tag over several data chunks.
+     *
+     * Same as above for a RTP packet that is stored in several fragments.
+     */
+    bool srtpVerifyTag(std::vector<const uint8_t*>& data, std::vector<uint64_t>& dataLength, uint32_t roc,
+                       const uint8_t* tag);
+
+    /**
+     * @brief Compute and check the authentication tag over an array of data chunks.
+     *
+     * Same as above without memory allocation, the arrays must have room for
+     * @c count + 1 chunks, see srtpAuthenticate().
+     */
+    bool srtpVerifyTag(const uint8_t* data[], uint64_t dataLength[], size_t count, uint32_t roc, const uint8_t* tag);
+
+    /**
+     * @brief Check the authentication tag, then decrypt the payload.
+     *
+     * The function decrypts the payload only if the tag is valid, thus a forged
+     * packet costs the MAC only and the buffer keeps the encrypted data.
+     *
+     * @param pkt
+     *    Pointer to RTP packet buffer, without the SRTP tag.
+     *
+     * @param pktlen
+     *    Length of the RTP packet buffer, without the SRTP tag.
+     *
+     * @param payload
+     *    Pointer to the payload inside the packet buffer.
+     *
+     * @param paylen
+     *    Length of the payload.
+     *
+     * @param index
+     *    The 48 bit SRTP packet index, the upper 32 bits are the ROC.
+     *
+     * @param ssrc
+     *    The RTP SSRC of the packet.
+     *
+     * @param tag
+     *    The received tag, <code>tagLength</code> bytes.
+     *
+     * @return
+     *    @c false if the tag is not valid.
+     */
+    bool srtpVerifyDecrypt(uint8_t* pkt, uint32_t pktlen, uint8_t* payload, uint32_t paylen, uint64_t index,
+                           uint32_t ssrc, const uint8_t* tag);
+
+    /**
+     * @brief Encrypt and authenticate an SRTP packet in place.
+     *
+     * The constructor selects a transform for the cipher and authentication
+     * algorithms of the context. The transforms are specializations of a
+     * template, thus they do not check the algorithms for each packet. An AEAD
+     * transform uses the RTP header as AAD, the other transforms do the same
+     * as srtpEncrypt() followed by srtpAuthenticate().
+     *
+     * @param pkt
+     *    Pointer to RTP packet buffer, without the SRTP tag.
+     *
+     * @param pktlen
+     *    Length of the RTP packet buffer, without the SRTP tag.
+     *
+     * @param payload
+     *    Pointer to the payload inside the packet buffer.
+     *
+     * @param paylen
+     *    Length of the payload.
+     *
+     * @param index
+     *    The 48 bit SRTP packet index, the upper 32 bits are the ROC.
+     *
+     * @param ssrc
+     *    The RTP SSRC of the packet.
+     *
+     * @param tag
+     *    Receives the tag, <code>tagLength</code> bytes.
+     */
+    void srtpProtect(uint8_t* pkt, uint32_t pktlen, uint8_t* payload, uint32_t paylen, uint64_t index, uint32_t ssrc,
+                     uint8_t* tag) {
+        protectTransform(this, pkt, pktlen, payload, paylen, index, ssrc, tag);
+    }
+
+    /**
+     * @brief Check the tag of an SRTP packet and decrypt it in place.
+     *
+     * Uses the transform that srtpProtect() uses. The parameters are the
+     * same as for srtpVerifyDecrypt().
+     *
+     * @return
+     *    @c false if the tag is not valid.
+     */
+    bool srtpUnprotect(uint8_t* pkt, uint32_t pktlen, uint8_t* payload, uint32_t paylen, uint64_t index, uint32_t ssrc,
+                       const uint8_t* tag) {
+        return unprotectTransform(this, pkt, pktlen, payload, paylen, index, ssrc, tag);
+    }
+
     /**
      * @brief Perform key derivation according to SRTP specification
      *
@@ -306,12 +730,60 @@ public:
      * This method clears the key data once it was processed by the encryptions'
      * set key functions.
      *
+     * If the key derivation rate is not zero the context keeps the master key
+     * and master salt and derives new session keys when the SRTP index enters
+     * a new key derivation period, see selectSrtpKeys().
+     *
      * @param index
      *    The 48 bit SRTP packet index. See the <code>guessIndex</code>
      *    method. Usually 0.
      */
     void deriveSrtpKeys(uint64_t index);
 
+    /**
+     * @brief Derive the SRTP keys and the SRTCP keys of one direction.
+     *
+     * The SRTP and the SRTCP context of a direction usually use the same master
+     * key and master salt. In this case the function sets up the master key
+     * schedule once and computes the key streams of the six labels in one CTR
+     * pass. Otherwise it calls deriveSrtpKeys() and
+     * CryptoContextCtrl::deriveSrtcpKeys().
+     *
+     * @param index
+     *    The 48 bit SRTP packet index, usually 0.
+     * @param ctrl
+     *    The SRTCP context of the same direction, may be @c NULL.
+     */
+    void deriveSrtpKeys(uint64_t index, CryptoContextCtrl* ctrl);
+
+    /**
+     * @brief Select the session keys for a SRTP packet index.
+     *
+     * Implements the key derivation rate (RFC 3711, chapter 4.3.1). The context
+     * holds two key sets: the active key set and a spare key set. If the index
+     * enters a new key derivation period then the context switches the key sets,
+     * this is a pointer swap only if the spare key set already holds the keys of
+     * this period. When the index passes the middle of a period the context
+     * derives the keys of the next period into the spare key set, thus the
+     * packet at the period boundary does not wait for the key derivation. Late
+     * packets of the previous period use the spare key set until the context
+     * derives the keys of the next period.
+     *
+     * SrtpHandler calls this function before it protects or unprotects a
+     * packet. The function does nothing if the key derivation rate is zero.
+     *
+     * @param index
+     *    The 48 bit SRTP packet index of the packet.
+     */
+    void selectSrtpKeys(uint64_t index) { if (key_deriv_rate != 0) switchSrtpKeys(index); }
+
+    /**
+     * @brief Get the key derivation rate.
+     *
+     * @return the key derivation rate, zero if the context derives the keys once.
+     */
+    int64_t getKeyDerivRate() const { return key_deriv_rate; }
+
     /**
      * @brief Compute (guess) the new SRTP index based on the sequence number of
      * a received RTP packet.
@@ -332,8 +804,8 @@ public:
      * The method check if a received packet is either to old or was already
      * received.
      *
-     * The method supports a 64 packet history relative the the given
-     * sequence number.
+     * The method supports a history of <code>replayWindowSize</code>
+     * packets relative to the highest received sequence number.
      *
      * @param newSeqNumber
      *    The sequence number of the received RTP packet in host order.
@@ -361,6 +833,16 @@ public:
      */
     int32_t getTagLength() const { return tagLength; }
 
+    /**
+     * @brief Check if this context uses an AEAD algorithm (AES-GCM, ChaCha20-Poly1305).
+     *
+     * @return true if the context uses AES-GCM or ChaCha20-Poly1305.
+     */
+    bool isAead() const {
+        return ealg == SrtpEncryptionAESGCM128 || ealg == SrtpEncryptionAESGCM256 ||
+               ealg == SrtpEncryptionCHACHA20POLY1305;
+    }
+
     /**
      * @brief Get the length of the MKI in bytes.
      *
@@ -410,61 +892,301 @@ public:
      *     The Roll-Over-Counter for this context, usually 0
      * @param keyDerivRate
      *     The key derivation rate for this context, usally 0
+     * @param replayWindowSize
+     *     The replay window size for this context. If 0 then use the replay
+     *     window size of this context.
+     * The SSRC is not part of the session key derivation, thus all contexts
+     * without a key derivation rate that an application gets from one context
+     * use the same session keys. The first of them that derives its keys
+     * shares its cipher key schedule, its session salt and its initialized
+     * MAC context with the others, their deriveSrtpKeys() does not derive the
+     * keys again. Each context keeps its own ROC and replay window. Only a build
+     * that defines ZRTP_SHARED_KEY_SCHEDULES shares the keys, the embedded
+     * crypto does this. The OpenSSL and gcrypt keys hold library handles with
+     * per-packet state, each context derives its own keys.
+     *
      * @return
      *     a new CryptoContext with all relevant data set.
      */
-    CryptoContext* newCryptoContextForSSRC(uint32_t ssrc, int roc, int64_t keyDerivRate);
+    CryptoContext* newCryptoContextForSSRC(uint32_t ssrc, int roc, int64_t keyDerivRate, int32_t replayWindowSize = 0);
+
+    /**
+     * @brief Get the size of the replay window in packets.
+     *
+     * @return the replay window size.
+     */
+    int32_t getReplayWindowSize() const { return replayWindowSize; }
+
+    /**
+     * @brief Enable the key stream precomputation of a sending SRTP context.
+     *
+     * The SRTP index of the next packet to send is predictable: the index of
+     * the last protected packet plus one. If enabled, the application calls
+     * precomputeKeyStream() on an idle or background thread to fill a small
+     * ring with the key stream of the upcoming indices. Then srtpEncrypt() just
+     * XORs the precomputed key stream with the payload. If no key stream is
+     * available for a packet, for example if the sequence number jumped or the
+     * payload is too long, srtpEncrypt() computes it as usual.
+     *
+     * Only the counter modes (AES-CM, Twofish-CM) support precomputation, and
+     * only if the key derivation rate is zero. Use it only on a sending context. The application must not call this function
+     * while another thread uses the context.
+     *
+     * @param depth
+     *    Number of precomputed packets, zero disables precomputation.
+     *
+     * @param maxPayloadLength
+     *    Maximum payload length of a packet that gets a precomputed key stream.
+     *
+     * @return
+     *    @c false if the encryption algorithm or the key derivation rate do not
+     *    support precomputation.
+     */
+    bool setKeyStreamPrecompute(int32_t depth, uint32_t maxPayloadLength);
+
+    /**
+     * @brief Fill the key stream ring.
+     *
+     * Computes the key stream for the upcoming SRTP indices that do not have a
+     * precomputed key stream yet. The application may call this function on an
+     * other thread than the thread that protects the packets. Only one thread
+     * must call this function at a time.
+     *
+     * @return
+     *    Number of computed key stream entries.
+     */
+    int32_t precomputeKeyStream();
+
+    /**
+     * @brief Get a snapshot of the packet counters.
+     *
+     * A metrics exporter may call this function on any thread at any time,
+     * it does not need a lock.
+     *
+     * @param stats
+     *    The function stores the counter values in this structure.
+     */
+    void getStatistics(SrtpStatistics* stats) const { counters.getStatistics(stats); }
+
+    /**
+     * @brief Add the memory of this context to a footprint report.
+     *
+     * The context adds its own size and the memory it owns to the category
+     * MemoryUsage::Srtp, its ciphers add their memory to the category
+     * MemoryUsage::Cipher.
+     *
+     * @param usage
+     *    The footprint report
+     */
+    void addMemoryUsage(MemoryUsage& usage) const;
+
+    /**
+     * @brief Get the packet counters.
+     *
+     * SrtpHandler uses the counters to count the packets and errors.
+     *
+     * @return the packet counters of this context.
+     */
+    SrtpCounters* getCounters() { return &counters; }
+
+    /**
+     * @brief Keep the master key and master salt for exportState().
+     *
+     * Without a key derivation rate the context clears the master key and
+     * master salt after the key derivation. An application that moves
+     * established sessions to another host sets this flag before it calls
+     * deriveSrtpKeys(), then the context keeps them. The contexts that
+     * newCryptoContextForSSRC() creates inherit the flag.
+     *
+     * @param enable
+     *    @c true to keep the master key and master salt.
+     */
+    void setExportable(bool enable) { exportable = enable; }
+
+    /**
+     * @brief Get the length of the state that exportState() stores.
+     *
+     * @return the length of the state in bytes.
+     */
+    int32_t getExportLength() const;
+
+    /**
+     * @brief Store the state of this context.
+     *
+     * The state contains the parameters, the master key and master salt, the
+     * ROC, the highest sequence number and the replay window, thus
+     * importState() on another host creates a context that continues the
+     * SRTP stream. The state does not contain the packet counters.
+     *
+     * The application must not protect or unprotect packets with this
+     * context while it exports the state, and it must not use this context
+     * after the other host took over the stream. The state contains the
+     * master key, keep it as secret as the key itself.
+     *
+     * @param data
+     *    Buffer for the state, at least getExportLength() bytes.
+     *
+     * @param length
+     *    Length of the buffer.
+     *
+     * @return
+     *    the length of the state, -1 if the buffer is too short or if the
+     *    context did not keep the master key, see setExportable().
+     */
+    int32_t exportState(uint8_t* data, int32_t length) const;
+
+    /**
+     * @brief Create a context from a state that exportState() stored.
+     *
+     * The function creates the context, derives the session keys and
+     * restores the ROC and the replay window. The new context keeps the
+     * master key, thus the application can move it again.
+     *
+     * @param data
+     *    The state.
+     *
+     * @param length
+     *    Length of the state.
+     *
+     * @return
+     *    the new context, @c NULL if the state is not valid.
+     */
+    static CryptoContext* importState(const uint8_t* data, int32_t length);
 
 private:
+    friend class SrtpReceiveTable;
+
     typedef union _hmacCtx {
         SkeinCtx_t       hmacSkeinCtx;
-#ifdef ZRTP_OPENSSL
+#if defined(ZRTP_OPENSSL) && OPENSSL_VERSION_NUMBER >= 0x30000000L
+        EVP_MAC_CTX*     hmacSha1Ctx;
+#elif defined(ZRTP_OPENSSL)
         HMAC_CTX         hmacSha1Ctx;
 #else
         hmacSha1Context  hmacSha1Ctx;
 #endif
     } HmacCtx;
 
+    typedef void (*ProtectTransform)(CryptoContext* pcc, uint8_t* pkt, uint32_t pktlen, uint8_t* payload,
+                                     uint32_t paylen, uint64_t index, uint32_t ssrc, uint8_t* tag);
+    typedef bool (*UnprotectTransform)(CryptoContext* pcc, uint8_t* pkt, uint32_t pktlen, uint8_t* payload,
+                                       uint32_t paylen, uint64_t index, uint32_t ssrc, const uint8_t* tag);
 
-    uint32_t ssrcCtx;
-    uint32_t mkiLength;
-    uint8_t* mki;
+    // The transforms and their cipher and MAC policies, see CryptoContext.cpp
+    template <class Cipher, class Mac> struct SrtpTransform;
+    template <class Aead> struct AeadTransform;
+    struct NullCipher;
+    struct CounterMode;
+    struct F8Mode;
+    struct AesGcm;
+    struct ChaCha20Poly1305;
+    struct NullMac;
+    struct HmacSha1;
+    struct SkeinMac;
+
+    void selectTransform();
+
+    template <class Cipher> void selectMac();
 
+    /*
+     * The fields that the packet path uses come first and stay together,
+     * followed by the MAC state. Key material is stored inline, the cold data
+     * that only the key derivation uses is at the end.
+     */
+    uint32_t ssrcCtx;
     uint32_t roc;
     uint32_t guessed_roc;
     uint16_t s_l;
+    bool  seqNumSet;
+    uint8_t labelBase;
+    int32_t ealg;
+    int32_t aalg;
+    int32_t tagLength;
+    int32_t n_s;
+
+    /*
+     * Bitmask for replay check. The bit of SRTP index i is at word
+     * (i / 64) % replayWords, thus advancing the window clears whole words
+     * and never shifts the bitmap. Points to replayWindowInline if the window
+     * is not larger than REPLAY_WINDOW_SIZE.
+     */
+    uint64_t* replayWindow;
+    int32_t  replayWords;
+    int32_t  replayWindowSize;
+
+    SrtpSymCrypto* cipher;
+    SrtpSymCrypto* f8Cipher;
+    void*   macCtx;
+    uint8_t* k_s;                       //!< session salt, points into sessionSalts
     int64_t  key_deriv_rate;
+    int64_t keyId;
+    KeyStreamRing* keyStreamRing;
+    ProtectTransform protectTransform;
+    UnprotectTransform unprotectTransform;
+
+    uint64_t replayWindowInline[SRTP_INLINE_REPLAY_WORDS];
+    uint8_t  sessionSalts[2][SRTP_MAX_SALT_LENGTH];
+
+    HmacCtx hmacCtx;
 
-    /* bitmask for replay check */
-    uint64_t replay_window[2];
+    SrtpCounters counters;
 
-    uint8_t* master_key;
+    /* Cold data */
+    uint32_t mkiLength;
+    uint8_t* mki;
+
+    uint8_t  master_key[SRTP_MAX_KEY_LENGTH];
     uint32_t master_key_length;
-    uint8_t* master_salt;
+    uint8_t  master_salt[SRTP_MAX_SALT_LENGTH];
     uint32_t master_salt_length;
+    bool     exportable;                //!< keep the master key after the key derivation
 
-    /* Session Encryption, Authentication keys, Salt */
+    /* Session Encryption, Authentication keys, only used during key derivation */
     int32_t  n_e;
-    uint8_t* k_e;
+    uint8_t  k_e[SRTP_MAX_KEY_LENGTH];
     int32_t  n_a;
-    uint8_t* k_a;
-    int32_t  n_s;
-    uint8_t* k_s;
+    uint8_t  k_a[SRTP_MAX_AUTH_KEY_LENGTH];
 
-    int32_t ealg;
-    int32_t aalg;
     int32_t ekeyl;
     int32_t akeyl;
     int32_t skeyl;
-    int32_t tagLength;
-    uint8_t labelBase;
-    bool  seqNumSet;
 
-    void*   macCtx;
-    HmacCtx hmacCtx;
+    /*
+     * Key derivation rate support: keyId is the key derivation period
+     * (index / key_deriv_rate) of the active keys above. The spare key set
+     * holds the keys of period spareKeyId, -1 if empty. Switching the key
+     * sets swaps the pointers, macCtx and spareMacCtx point to different
+     * HmacCtx unions.
+     */
+    int64_t spareKeyId;
+    SrtpSymCrypto* spareCipher;
+    SrtpSymCrypto* spareF8Cipher;
+    uint8_t* spareK_s;
+    void*   spareMacCtx;
+    HmacCtx spareHmacCtx;
 
-    SrtpSymCrypto* cipher;
-    SrtpSymCrypto* f8Cipher;
+    /*
+     * The session keys of the contexts that newCryptoContextForSSRC created
+     * from this context, or the keys this clone shares with the others. NULL
+     * if the context does not share keys.
+     */
+    struct SharedKeys;
+    SharedKeys* sharedKeys;
+
+    bool useSharedKeys();
+
+    void publishSharedKeys();
+
+    void* deriveKeySet(uint64_t index, SrtpSymCrypto* kdCipher, SrtpSymCrypto* kdF8Cipher,
+                       uint8_t* salt, HmacCtx* hmacStore);
+
+    void* installKeySet(SrtpSymCrypto* kdCipher, SrtpSymCrypto* kdF8Cipher, uint8_t* salt, HmacCtx* hmacStore);
+
+    bool sharesMasterKey(const CryptoContextCtrl* ctrl) const;
+
+    void switchSrtpKeys(uint64_t index);
+
+    bool useKeyStream(const uint8_t* payload, uint32_t paylen, uint8_t* out, uint64_t index);
 };
 
 #endif
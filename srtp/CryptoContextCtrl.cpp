@@ -23,12 +23,25 @@
 #include <cstdint>
 
 #include <common/osSpecifics.h>
+#include <common/zrtpByteOrder.h>
+#include <common/MemoryUsage.h>
 
 #include "srtp/CryptoContextCtrl.h"
 #include "srtp/CryptoContext.h"
 
 #include "srtp/crypto/SrtpSymCrypto.h"
+#include <common/ZrtpAllocator.h>
 
+// The key arrays use the allocator of the library
+static uint8_t* newKey(size_t length)
+{
+    return static_cast<uint8_t*>(zrtpNew(length));
+}
+
+static void deleteKey(uint8_t* key, size_t length)
+{
+    zrtpFree(key, length);
+}
 
 CryptoContextCtrl::CryptoContextCtrl(uint32_t ssrc,
                                 const int32_t ealg,
@@ -41,24 +54,31 @@ CryptoContextCtrl::CryptoContextCtrl(uint32_t ssrc,
                                 int32_t akeyl,
                                 int32_t skeyl,
                                 int32_t tagLength):
-ssrcCtx(ssrc), mkiLength(0),mki(NULL), replay_window(0), srtcpIndex(0),
+ssrcCtx(ssrc), mkiLength(0),mki(NULL), replay_window(0), exportable(false), srtcpIndex(0),
 labelBase(3), macCtx(NULL), cipher(NULL), f8Cipher(NULL)        // SRTCP labels start at 3
 
 {
     this->ealg = ealg;
     this->aalg = aalg;
+    counters.setSuite(ZrtpMetrics::getSrtpSuite(ealg, aalg, true));
     this->ekeyl = ekeyl;
     this->akeyl = akeyl;
     this->skeyl = skeyl;
 
     this->master_key_length = master_key_length;
-    this->master_key = new uint8_t[master_key_length];
+    this->master_key = newKey(master_key_length);
     memcpy(this->master_key, master_key, master_key_length);
 
+    // The key derivation uses a 14 byte (112 bit) salt. Pad shorter salts,
+    // for example the 12 byte AES-GCM salt, with zeros (RFC 7714, chapter 11).
     this->master_salt_length = master_salt_length;
-    this->master_salt = new uint8_t[master_salt_length];
+    this->master_salt = newKey(master_salt_length < 14 ? 14 : master_salt_length);
+    memset(this->master_salt, 0, master_salt_length < 14 ? 14 : master_salt_length);
     memcpy(this->master_salt, master_salt, master_salt_length);
 
+    // A SHA1 HMAC context may hold resources of the crypto library, it must be zero before its first use
+    memset(&hmacCtx, 0, sizeof(hmacCtx));
+
     switch (ealg) {
         case SrtpEncryptionNull:
             n_e = 0;
@@ -67,30 +87,54 @@ labelBase(3), macCtx(NULL), cipher(NULL), f8Cipher(NULL)        // SRTCP labels
             k_s = NULL;
             break;
 
+#ifndef ZRTP_MINIMAL_ALGORITHMS
         case SrtpEncryptionTWOF8:
             f8Cipher = new SrtpSymCrypto(SrtpEncryptionTWOF8);
 
         case SrtpEncryptionTWOCM:
             n_e = ekeyl;
-            k_e = new uint8_t[n_e];
+            k_e = newKey(n_e);
             n_s = skeyl;
-            k_s = new uint8_t[n_s];
+            k_s = newKey(n_s);
             cipher = new SrtpSymCrypto(SrtpEncryptionTWOCM);
             break;
+#endif
 
         case SrtpEncryptionAESF8:
             f8Cipher = new SrtpSymCrypto(SrtpEncryptionAESF8);
 
         case SrtpEncryptionAESCM:
             n_e = ekeyl;
-            k_e = new uint8_t[n_e];
+            k_e = newKey(n_e);
             n_s = skeyl;
-            k_s = new uint8_t[n_s];
+            k_s = newKey(n_s);
             cipher = new SrtpSymCrypto(SrtpEncryptionAESCM);
             break;
+
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+        case SrtpEncryptionAESGCM128:
+        case SrtpEncryptionAESGCM256:
+            n_e = ekeyl;
+            k_e = newKey(n_e);
+            n_s = skeyl;
+            k_s = newKey(n_s);
+            cipher = new SrtpSymCrypto(SrtpEncryptionAESCM);
+            // AEAD does not use a separate authentication, RFC 7714
+            this->aalg = SrtpAuthenticationNull;
+            break;
+
+        case SrtpEncryptionCHACHA20POLY1305:
+            n_e = ekeyl;
+            k_e = newKey(n_e);
+            n_s = skeyl;
+            k_s = newKey(n_s);
+            cipher = new SrtpSymCrypto(SrtpEncryptionCHACHA20POLY1305);
+            this->aalg = SrtpAuthenticationNull;
+            break;
+#endif
     }
 
-    switch (aalg) {
+    switch (this->aalg) {
         case SrtpAuthenticationNull:
             n_a = 0;
             k_a = NULL;
@@ -98,12 +142,35 @@ labelBase(3), macCtx(NULL), cipher(NULL), f8Cipher(NULL)        // SRTCP labels
             break;
 
         case SrtpAuthenticationSha1Hmac:
+#ifndef ZRTP_MINIMAL_ALGORITHMS
         case SrtpAuthenticationSkeinHmac:
+#endif
             n_a = akeyl;
-            k_a = new uint8_t[n_a];
+            k_a = newKey(n_a);
             this->tagLength = tagLength;
             break;
     }
+    if (isAead())
+        this->tagLength = SRTP_GCM_TAG_LENGTH;
+}
+
+bool CryptoContextCtrl::isAead() const
+{
+    return ealg == SrtpEncryptionAESGCM128 || ealg == SrtpEncryptionAESGCM256 ||
+           ealg == SrtpEncryptionCHACHA20POLY1305;
+}
+
+void CryptoContextCtrl::addMemoryUsage(MemoryUsage& usage) const
+{
+    size_t bytes = sizeof(CryptoContextCtrl) + mkiLength + n_e + n_a + n_s;
+
+    bytes += master_key_length + (master_salt_length < 14 ? 14 : master_salt_length);
+    usage.add(MemoryUsage::Srtp, bytes);
+
+    if (cipher != NULL)
+        cipher->addMemoryUsage(usage);
+    if (f8Cipher != NULL)
+        f8Cipher->addMemoryUsage(usage);
 }
 
 /*
@@ -122,29 +189,31 @@ CryptoContextCtrl::~CryptoContextCtrl(){
 
     if (master_key_length > 0) {
         memset_volatile(master_key, 0, master_key_length);
+        deleteKey(master_key, master_key_length);
         master_key_length = 0;
-        delete [] master_key;
     }
     if (master_salt_length > 0) {
         memset_volatile(master_salt, 0, master_salt_length);
+        deleteKey(master_salt, master_salt_length < 14 ? 14 : master_salt_length);
         master_salt_length = 0;
-        delete [] master_salt;
     }
     if (n_e > 0) {
         memset_volatile(k_e, 0, n_e);
+        deleteKey(k_e, n_e);
         n_e = 0;
-        delete [] k_e;
     }
     if (n_s > 0) {
         memset_volatile(k_s, 0, n_s);
+        deleteKey(k_s, n_s);
         n_s = 0;
-        delete [] k_s;
     }
     if (n_a > 0) {
-        n_a = 0;
         memset_volatile(k_a, 0, n_a);
-        delete [] k_a;
+        deleteKey(k_a, n_a);
+        n_a = 0;
     }
+    if (aalg == SrtpAuthenticationSha1Hmac)
+        releaseSha1HmacContext(&hmacCtx.hmacSha1Ctx);
     if (cipher != NULL) {
         delete cipher;
         cipher = NULL;
@@ -224,45 +293,110 @@ void CryptoContextCtrl::srtcpEncrypt( uint8_t* rtp, int32_t len, uint32_t index,
     }
 }
 
+/*
+ * Compute the AES-GCM IV and the AAD (refer to chapter 9 in RFC 7714), ChaCha20-Poly1305
+ * uses the same IV and AAD:
+ *
+ * 00 00 || SSRC || 00 00 || 0 || SRTCP index
+ * k_s   XX XX XX XX XX XX XX XX XX XX XX XX
+ * ------------------------------------------XOR
+ * IV    XX XX XX XX XX XX XX XX XX XX XX XX
+ *
+ * AAD: fixed RTCP header (8 bytes) || E flag || SRTCP index
+ */
+static void computeGcmIvAad(uint8_t* iv, uint8_t* aad, const uint8_t* rtcp, uint32_t index, uint32_t ssrc, const uint8_t* salt)
+{
+    uint32_t idx = index & ~0x80000000;
+
+    iv[0] = salt[0];
+    iv[1] = salt[1];
+    iv[2] = ((ssrc >> 24) & 0xff) ^ salt[2];
+    iv[3] = ((ssrc >> 16) & 0xff) ^ salt[3];
+    iv[4] = ((ssrc >> 8) & 0xff) ^ salt[4];
+    iv[5] = (ssrc & 0xff) ^ salt[5];
+    iv[6] = salt[6];
+    iv[7] = salt[7];
+    iv[8] = ((idx >> 24) & 0xff) ^ salt[8];
+    iv[9] = ((idx >> 16) & 0xff) ^ salt[9];
+    iv[10] = ((idx >> 8) & 0xff) ^ salt[10];
+    iv[11] = (idx & 0xff) ^ salt[11];
+
+    memcpy(aad, rtcp, 8);
+    aad[8] = index >> 24;
+    aad[9] = index >> 16;
+    aad[10] = index >> 8;
+    aad[11] = index;
+}
+
+void CryptoContextCtrl::srtcpAeadEncrypt(uint8_t* rtcp, int32_t len, uint32_t index, uint32_t ssrc, uint8_t* tag)
+{
+    uint8_t iv[SRTP_GCM_IV_LENGTH];
+    uint8_t aad[12];
+
+    computeGcmIvAad(iv, aad, rtcp, index, ssrc, k_s);
+    if (ealg == SrtpEncryptionCHACHA20POLY1305)
+        cipher->chacha_encrypt(rtcp + 8, len - 8, aad, sizeof(aad), iv, tag);
+    else
+        cipher->gcm_encrypt(rtcp + 8, len - 8, aad, sizeof(aad), iv, tag);
+}
+
+bool CryptoContextCtrl::srtcpAeadDecrypt(uint8_t* rtcp, int32_t len, uint32_t index, uint32_t ssrc, const uint8_t* tag)
+{
+    uint8_t iv[SRTP_GCM_IV_LENGTH];
+    uint8_t aad[12];
+
+    // Unencrypted SRTCP packets (E flag not set) use the whole packet as AAD,
+    // not supported
+    if ((index & 0x80000000) == 0)
+        return false;
+
+    computeGcmIvAad(iv, aad, rtcp, index, ssrc, k_s);
+    if (ealg == SrtpEncryptionCHACHA20POLY1305)
+        return cipher->chacha_decrypt(rtcp + 8, len - 8, aad, sizeof(aad), iv, tag);
+    return cipher->gcm_decrypt(rtcp + 8, len - 8, aad, sizeof(aad), iv, tag);
+}
+
 /* Warning: tag must have been initialized */
 void CryptoContextCtrl::srtcpAuthenticate(uint8_t* rtp, int32_t len, uint32_t index, uint8_t* tag )
 {
     if (aalg == SrtpAuthenticationNull) {
         return;
     }
-    uint32_t macL;
-
     unsigned char temp[20];
-    std::vector<const uint8_t*>chunks;
-    std::vector<uint64_t> chunkLength;
-    uint32_t beIndex = zrtpHtonl(index);
-
-    chunks.push_back(rtp);
-    chunkLength.push_back(len);
-
-    chunks.push_back((unsigned char *)&beIndex);
-    chunkLength.push_back(4);
+    uint32_t beIndex = zrtpBe32(index);
 
     switch (aalg) {
     case SrtpAuthenticationSha1Hmac:
-        hmacSha1Ctx(macCtx,
-                    chunks,           // data chunks to hash
-                    chunkLength,      // length of the data to hash
-                    temp, &macL);
+        hmacSha1Ctx2(macCtx,
+                     rtp, len,          // the packet data
+                     (unsigned char *)&beIndex, sizeof(beIndex),
+                     temp);
         /* truncate the result */
         memcpy(tag, temp, getTagLength());
         break;
+#ifndef ZRTP_MINIMAL_ALGORITHMS
     case SrtpAuthenticationSkeinHmac:
         macSkeinCtx(macCtx,
-                    chunks,           // data chunks to hash
-                    chunkLength,      // length of the data to hash
+                    rtp, len,           // the packet data
+                    (unsigned char *)&beIndex, sizeof(beIndex),
                     temp);
         /* truncate the result */
         memcpy(tag, temp, getTagLength());
         break;
+#endif
     }
 }
 
+bool CryptoContextCtrl::srtcpVerifyTag(uint8_t* rtp, int32_t len, uint32_t index, const uint8_t* tag)
+{
+    if (aalg == SrtpAuthenticationNull)
+        return true;
+
+    uint8_t mac[20];
+    srtcpAuthenticate(rtp, len, index, mac);
+    return srtpTagEqual(tag, mac, getTagLength());
+}
+
 /* used by the key derivation method */
 static void computeIv(unsigned char* iv, uint8_t label, uint8_t* master_salt)
 {
@@ -288,7 +422,6 @@ void CryptoContextCtrl::deriveSrtcpKeys()
 
     // prepare cipher to compute derived keys.
     cipher->setNewKey(master_key, master_key_length);
-    memset(master_key, 0, master_key_length);
 
     // compute the session encryption key
     uint8_t label = labelBase;
@@ -300,27 +433,41 @@ void CryptoContextCtrl::deriveSrtcpKeys()
     computeIv(iv, label, master_salt);
     cipher->get_ctr_cipher_stream(k_a, n_a, iv);
 
+    // compute the session salt
+    label = labelBase + 2;
+    computeIv(iv, label, master_salt);
+    cipher->get_ctr_cipher_stream(k_s, n_s, iv);
+
+    installSrtcpKeys();
+}
+
+/*
+ * Set up the MAC and the cipher with the derived session keys in k_e, k_a and k_s.
+ */
+void CryptoContextCtrl::installSrtcpKeys()
+{
+    if (!exportable) {
+        memset(master_key, 0, master_key_length);
+        memset(master_salt, 0, master_salt_length);
+    }
+
     // Initialize MAC context with the derived key
     switch (aalg) {
     case SrtpAuthenticationSha1Hmac:
         macCtx = &hmacCtx.hmacSha1Ctx;
         macCtx = initializeSha1HmacContext(macCtx, k_a, n_a);
         break;
+#ifndef ZRTP_MINIMAL_ALGORITHMS
     case SrtpAuthenticationSkeinHmac:
         macCtx = &hmacCtx.hmacSkeinCtx;
 
         // Skein MAC uses number of bits as MAC size, not just bytes
         macCtx = initializeSkeinMacContext(macCtx, k_a, n_a, tagLength*8, Skein512);
         break;
+#endif
     }
     memset(k_a, 0, n_a);
 
-    // compute the session salt
-    label = labelBase + 2;
-    computeIv(iv, label, master_salt);
-    cipher->get_ctr_cipher_stream(k_s, n_s, iv);
-    memset(master_salt, 0, master_salt_length);
-
     // as last step prepare cipher with derived key.
     cipher->setNewKey(k_e, n_e);
     if (f8Cipher != NULL)
@@ -366,6 +513,8 @@ void CryptoContextCtrl::update(uint32_t index)
     }
     else {
         replay_window |= ( (uint64_t)1 << -delta );
+        if (delta < 0)
+            counters.countLatePacket();
     }
     if (index > s_l)
         s_l = index;
@@ -385,6 +534,7 @@ CryptoContextCtrl* CryptoContextCtrl::newCryptoContextForSSRC(uint32_t ssrc)
             this->akeyl,                             // authentication key len
             this->skeyl,                             // session salt len
             this->tagLength);                        // authentication tag len
+    pcc->exportable = exportable;
 
     return pcc;
 }
@@ -27,8 +27,11 @@
 
 #include "crypto/hmac.h"
 #include "cryptcommon/macSkein.h"
+#include "srtp/SrtpStatistics.h"
+#include "srtp/SrtpMemoryPool.h"
 
 class SrtpSymCrypto;
+class MemoryUsage;
 
 /**
  * The implementation for a SRTCP cryptographic context.
@@ -70,8 +73,9 @@ class CryptoContextCtrl {
      * @param ealg
      *    The encryption algorithm to use. Possible values are <code>
      *    SrtpEncryptionNull, SrtpEncryptionAESCM, SrtpEncryptionAESF8,
-     *    </code>. See chapter 4.1.1 for AESCM (Counter mode) and 4.1.2
-     *    for AES F8 mode.
+     *    SrtpEncryptionAESGCM128, SrtpEncryptionAESGCM256,
+     *    SrtpEncryptionCHACHA20POLY1305</code>. See chapter 4.1.1 for AESCM
+     *    (Counter mode) and 4.1.2 for AES F8 mode.
      *
      * @param aalg
      *    The authentication algorithm to use. Possible values are <code>
@@ -140,6 +144,12 @@ class CryptoContextCtrl {
      */
     ~CryptoContextCtrl();
 
+    /**
+     * @brief Allocate and release CryptoContextCtrl objects with the SrtpMemoryPool.
+     */
+    static void* operator new(size_t size) { return SrtpMemoryPool::allocate(size); }
+    static void operator delete(void* ptr, size_t size) { SrtpMemoryPool::release(ptr, size); }
+
     /**
      * @brief Perform SRTCP encryption.
      *
@@ -160,6 +170,58 @@ class CryptoContextCtrl {
      */
     void srtcpEncrypt(uint8_t* rtp, int32_t len, uint32_t index, uint32_t ssrc);
 
+    /**
+     * @brief Perform SRTCP AEAD encryption (AES-GCM, ChaCha20-Poly1305).
+     *
+     * This method encrypts the RTCP payload in place and computes the tag.
+     * The AAD consists of the fixed RTCP header and the E flag with the SRTCP
+     * index, refer to RFC 7714, chapter 9.
+     *
+     * @param rtcp
+     *    The RTCP packet, the first 8 bytes (header and sender SSRC) are not
+     *    encrypted.
+     *
+     * @param len
+     *    Length of the RTCP packet.
+     *
+     * @param index
+     *    The 31 bit SRTCP packet index with the E flag set.
+     *
+     * @param ssrc
+     *    The RTCP SSRC data in <em>host</em> order.
+     *
+     * @param tag
+     *    Points to a buffer that receives the tag, must be able to hold
+     *    <code>tagLength</code> bytes.
+     */
+    void srtcpAeadEncrypt(uint8_t* rtcp, int32_t len, uint32_t index, uint32_t ssrc, uint8_t* tag);
+
+    /**
+     * @brief Perform SRTCP AEAD decryption (AES-GCM, ChaCha20-Poly1305).
+     *
+     * This method checks the tag and decrypts the RTCP payload in place if the
+     * tag is valid.
+     *
+     * @param rtcp
+     *    The SRTCP packet.
+     *
+     * @param len
+     *    Length of the RTCP packet without tag, SRTCP index, and MKI.
+     *
+     * @param index
+     *    The 31 bit SRTCP packet index with the E flag.
+     *
+     * @param ssrc
+     *    The RTCP SSRC data in <em>host</em> order.
+     *
+     * @param tag
+     *    Points to the received tag.
+     *
+     * @return
+     *    true if the tag is valid, false otherwise.
+     */
+    bool srtcpAeadDecrypt(uint8_t* rtcp, int32_t len, uint32_t index, uint32_t ssrc, const uint8_t* tag);
+
     /**
      * @brief Compute the authentication tag.
      *
@@ -181,6 +243,29 @@ class CryptoContextCtrl {
      */
     void srtcpAuthenticate(uint8_t* rtp, int32_t len, uint32_t index, uint8_t* tag);
 
+    /**
+     * @brief Compute and check the authentication tag.
+     *
+     * Computes the authentication tag and compares it with the received tag in
+     * constant time, see srtpTagEqual().
+     *
+     * @param rtp
+     *    The RTCP packet that contains the data to authenticate.
+     *
+     * @param len
+     *    Length of the RTCP packet
+     *
+     * @param index
+     *    The SRTCP index field including the E flag.
+     *
+     * @param tag
+     *    The received tag, <code>tagLength</code> bytes.
+     *
+     * @return
+     *    @c true if the tag is valid or the context uses no authentication.
+     */
+    bool srtcpVerifyTag(uint8_t* rtp, int32_t len, uint32_t index, const uint8_t* tag);
+
     /**
      * @brief Perform key derivation according to SRTCP specification
      *
@@ -229,6 +314,13 @@ class CryptoContextCtrl {
      */
     inline int32_t getTagLength() const { return tagLength; }
 
+    /**
+     * @brief Check if this context uses an AEAD algorithm (AES-GCM, ChaCha20-Poly1305).
+     *
+     * @return true if the context uses AES-GCM or ChaCha20-Poly1305.
+     */
+    bool isAead() const;
+
     /**
      * @brief Get the length of the MKI in bytes.
      *
@@ -294,7 +386,91 @@ class CryptoContextCtrl {
      */
     CryptoContextCtrl* newCryptoContextForSSRC(uint32_t ssrc);
 
+    /**
+     * @brief Get a snapshot of the packet counters.
+     *
+     * A metrics exporter may call this function on any thread at any time,
+     * it does not need a lock.
+     *
+     * @param stats
+     *    The function stores the counter values in this structure.
+     */
+    void getStatistics(SrtpStatistics* stats) const { counters.getStatistics(stats); }
+
+    /**
+     * @brief Add the memory of this context to a footprint report.
+     *
+     * The context adds its own size and the memory it owns to the category
+     * MemoryUsage::Srtp, its ciphers add their memory to the category
+     * MemoryUsage::Cipher.
+     *
+     * @param usage
+     *    The footprint report
+     */
+    void addMemoryUsage(MemoryUsage& usage) const;
+
+    /**
+     * @brief Get the packet counters.
+     *
+     * SrtpHandler uses the counters to count the packets and errors.
+     *
+     * @return the packet counters of this context.
+     */
+    SrtpCounters* getCounters() { return &counters; }
+
+    /**
+     * @brief Keep the master key and master salt for exportState().
+     *
+     * Same as CryptoContext::setExportable(), the application sets the flag
+     * before it derives the keys.
+     */
+    void setExportable(bool enable) { exportable = enable; }
+
+    /**
+     * @brief Get the length of the state that exportState() stores.
+     *
+     * @return the length of the state in bytes.
+     */
+    int32_t getExportLength() const;
+
+    /**
+     * @brief Store the state of this context.
+     *
+     * The state contains the parameters, the master key and master salt, the
+     * SRTCP index, the highest received index and the replay window. Refer
+     * to CryptoContext::exportState() for the restrictions.
+     *
+     * @param data
+     *    Buffer for the state, at least getExportLength() bytes.
+     *
+     * @param length
+     *    Length of the buffer.
+     *
+     * @return
+     *    the length of the state, -1 if the buffer is too short or if the
+     *    context did not keep the master key.
+     */
+    int32_t exportState(uint8_t* data, int32_t length) const;
+
+    /**
+     * @brief Create a context from a state that exportState() stored.
+     *
+     * @param data
+     *    The state.
+     *
+     * @param length
+     *    Length of the state.
+     *
+     * @return
+     *    the new context with derived keys, @c NULL if the state is not valid.
+     */
+    static CryptoContextCtrl* importState(const uint8_t* data, int32_t length);
+
     private:
+        // CryptoContext derives the keys of both contexts of a direction, see CryptoContext::deriveSrtpKeys()
+        friend class CryptoContext;
+
+        void installSrtcpKeys();
 
         typedef union _hmacCtx {
             SkeinCtx_t       hmacSkeinCtx;
@@ -314,6 +490,7 @@ class CryptoContextCtrl {
         uint32_t master_key_length;
         uint8_t* master_salt;
         uint32_t master_salt_length;
+        bool     exportable;            //!< keep the master key after the key derivation
 
         /* Session Encryption, Authentication keys, Salt */
         int32_t  n_e;
@@ -337,6 +514,8 @@ class CryptoContextCtrl {
 
         SrtpSymCrypto* cipher;
         SrtpSymCrypto* f8Cipher;
+
+        SrtpCounters counters;
     };
 
 /**
@@ -0,0 +1,244 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Export and import of the SRTP and SRTCP context state.
+ *
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <string.h>
+
+#include "srtp/CryptoContext.h"
+#include "srtp/CryptoContextCtrl.h"
+
+/*
+ * The states start with a type byte that also holds the version. Integers
+ * are in little endian order.
+ *
+ * SRTP:  type | ealg aalg tagLength ekeyl akeyl skeyl labelBase seqNumSet |
+ *        ssrc(4) roc(4) s_l(2) | key derivation rate(8) key id(8) |
+ *        key length, key | salt length, salt | window size(4) | window words
+ *
+ * SRTCP: type | ealg aalg tagLength ekeyl akeyl skeyl labelBase | ssrc(4) |
+ *        s_l(4) replay window(8) SRTCP index(4) | key length, key | salt length, salt
+ */
+static const uint8_t srtpStateType = 0x51;
+static const uint8_t srtcpStateType = 0x61;
+
+static const int32_t srtpFixedLength = 1 + 8 + 10 + 16 + 1 + 1 + 4;
+static const int32_t srtcpFixedLength = 1 + 7 + 4 + 16 + 1 + 1;
+
+static void putUint(uint8_t** p, uint64_t value, int32_t length) {
+    for (int32_t i = 0; i < length; i++) {
+        *(*p)++ = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static uint64_t getUint(const uint8_t** p, int32_t length) {
+    uint64_t value = 0;
+
+    for (int32_t i = 0; i < length; i++) {
+        value |= (uint64_t)*(*p)++ << (8 * i);
+    }
+    return value;
+}
+
+static void putBytes(uint8_t** p, const uint8_t* data, uint32_t length) {
+    *(*p)++ = (uint8_t)length;
+    memcpy(*p, data, length);
+    *p += length;
+}
+
+/*
+ * Get a key or salt with its length byte. Returns NULL if the length is
+ * larger than the maximum or the remaining data.
+ */
+static const uint8_t* getBytes(const uint8_t** p, const uint8_t* end, int32_t maxLength, int32_t* length) {
+    if (*p >= end)
+        return NULL;
+    *length = *(*p)++;
+    if (*length > maxLength || end - *p < *length)
+        return NULL;
+    const uint8_t* data = *p;
+    *p += *length;
+    return data;
+}
+
+int32_t CryptoContext::getExportLength() const
+{
+    return srtpFixedLength + master_key_length + master_salt_length + replayWords * 8;
+}
+
+int32_t CryptoContext::exportState(uint8_t* data, int32_t length) const
+{
+    int32_t stateLength = getExportLength();
+
+    // Without the master key the state is useless
+    if (!exportable || length < stateLength)
+        return -1;
+
+    uint8_t* p = data;
+    *p++ = srtpStateType;
+    *p++ = (uint8_t)ealg;
+    *p++ = (uint8_t)aalg;
+    *p++ = (uint8_t)tagLength;
+    *p++ = (uint8_t)ekeyl;
+    *p++ = (uint8_t)akeyl;
+    *p++ = (uint8_t)skeyl;
+    *p++ = labelBase;
+    *p++ = seqNumSet ? 1 : 0;
+    putUint(&p, ssrcCtx, 4);
+    putUint(&p, roc, 4);
+    putUint(&p, s_l, 2);
+    putUint(&p, (uint64_t)key_deriv_rate, 8);
+    putUint(&p, (uint64_t)keyId, 8);
+    putBytes(&p, master_key, master_key_length);
+    putBytes(&p, master_salt, master_salt_length);
+    putUint(&p, (uint32_t)replayWindowSize, 4);
+    for (int32_t i = 0; i < replayWords; i++)
+        putUint(&p, replayWindow[i], 8);
+
+    return stateLength;
+}
+
+CryptoContext* CryptoContext::importState(const uint8_t* data, int32_t length)
+{
+    if (data == NULL || length < srtpFixedLength || data[0] != srtpStateType)
+        return NULL;
+
+    const uint8_t* p = data + 1;
+    const uint8_t* end = data + length;
+
+    int32_t algo = *p++;
+    int32_t auth = *p++;
+    int32_t tagLen = *p++;
+    int32_t ekeyLen = *p++;
+    int32_t akeyLen = *p++;
+    int32_t skeyLen = *p++;
+    uint8_t base = *p++;
+    bool seqSet = *p++ != 0;
+    uint32_t ssrc = (uint32_t)getUint(&p, 4);
+    uint32_t rocValue = (uint32_t)getUint(&p, 4);
+    uint16_t seq = (uint16_t)getUint(&p, 2);
+    int64_t rate = (int64_t)getUint(&p, 8);
+    int64_t period = (int64_t)getUint(&p, 8);
+
+    if (algo > SrtpEncryptionCHACHA20POLY1305 || auth > SrtpAuthenticationSkeinHmac || algo == SrtpEncryptionNull ||
+        rate < 0 || period < 0)
+        return NULL;
+
+    int32_t keyLength, saltLength;
+    const uint8_t* key = getBytes(&p, end, SRTP_MAX_KEY_LENGTH, &keyLength);
+    const uint8_t* salt = (key != NULL) ? getBytes(&p, end, SRTP_MAX_SALT_LENGTH, &saltLength) : NULL;
+    if (salt == NULL || end - p < 4)
+        return NULL;
+    int32_t windowSize = (int32_t)getUint(&p, 4);
+    if (windowSize <= 0 || windowSize > SRTP_MAX_REPLAY_WINDOW_SIZE || (windowSize & 63) != 0 ||
+        end - p != (windowSize / 64 + 1) * 8)
+        return NULL;
+
+    CryptoContext* pcc = new CryptoContext(ssrc, rocValue, rate, algo, auth,
+                                           const_cast<uint8_t*>(key), keyLength,
+                                           const_cast<uint8_t*>(salt), saltLength,
+                                           ekeyLen, akeyLen, skeyLen, tagLen, windowSize);
+    pcc->setLabelbase(base);
+    pcc->setExportable(true);
+    pcc->deriveSrtpKeys((uint64_t)period * (uint64_t)rate);
+
+    pcc->s_l = seq;
+    pcc->seqNumSet = seqSet;
+    for (int32_t i = 0; i < pcc->replayWords; i++)
+        pcc->replayWindow[i] = getUint(&p, 8);
+
+    return pcc;
+}
+
+int32_t CryptoContextCtrl::getExportLength() const
+{
+    return srtcpFixedLength + master_key_length + master_salt_length;
+}
+
+int32_t CryptoContextCtrl::exportState(uint8_t* data, int32_t length) const
+{
+    int32_t stateLength = getExportLength();
+
+    if (!exportable || length < stateLength)
+        return -1;
+
+    uint8_t* p = data;
+    *p++ = srtcpStateType;
+    *p++ = (uint8_t)ealg;
+    *p++ = (uint8_t)aalg;
+    *p++ = (uint8_t)tagLength;
+    *p++ = (uint8_t)ekeyl;
+    *p++ = (uint8_t)akeyl;
+    *p++ = (uint8_t)skeyl;
+    *p++ = labelBase;
+    putUint(&p, ssrcCtx, 4);
+    putUint(&p, s_l, 4);
+    putUint(&p, replay_window, 8);
+    putUint(&p, srtcpIndex, 4);
+    putBytes(&p, master_key, master_key_length);
+    putBytes(&p, master_salt, master_salt_length);
+
+    return stateLength;
+}
+
+CryptoContextCtrl* CryptoContextCtrl::importState(const uint8_t* data, int32_t length)
+{
+    if (data == NULL || length < srtcpFixedLength || data[0] != srtcpStateType)
+        return NULL;
+
+    const uint8_t* p = data + 1;
+    const uint8_t* end = data + length;
+
+    int32_t algo = *p++;
+    int32_t auth = *p++;
+    int32_t tagLen = *p++;
+    int32_t ekeyLen = *p++;
+    int32_t akeyLen = *p++;
+    int32_t skeyLen = *p++;
+    uint8_t base = *p++;
+    uint32_t ssrc = (uint32_t)getUint(&p, 4);
+    uint32_t seq = (uint32_t)getUint(&p, 4);
+    uint64_t window = getUint(&p, 8);
+    uint32_t index = (uint32_t)getUint(&p, 4);
+
+    if (algo > SrtpEncryptionCHACHA20POLY1305 || auth > SrtpAuthenticationSkeinHmac || algo == SrtpEncryptionNull ||
+        ekeyLen > SRTP_MAX_KEY_LENGTH || akeyLen > SRTP_MAX_AUTH_KEY_LENGTH || skeyLen > SRTP_MAX_SALT_LENGTH)
+        return NULL;
+
+    int32_t keyLength, saltLength;
+    const uint8_t* key = getBytes(&p, end, SRTP_MAX_KEY_LENGTH, &keyLength);
+    const uint8_t* salt = (key != NULL) ? getBytes(&p, end, SRTP_MAX_SALT_LENGTH, &saltLength) : NULL;
+    if (salt == NULL || p != end)
+        return NULL;
+
+    CryptoContextCtrl* pcc = new CryptoContextCtrl(ssrc, algo, auth,
+                                                   const_cast<uint8_t*>(key), keyLength,
+                                                   const_cast<uint8_t*>(salt), saltLength,
+                                                   ekeyLen, akeyLen, skeyLen, tagLen);
+    pcc->setLabelbase(base);
+    pcc->setExportable(true);
+    pcc->deriveSrtcpKeys();
+
+    pcc->s_l = seq;
+    pcc->replay_window = window;
+    pcc->srtcpIndex = index;
+
+    return pcc;
+}
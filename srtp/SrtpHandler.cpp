@@ -22,18 +22,115 @@
 #include <cstdlib>
 #include <cstring>
 #include <cstdint>
+#include <vector>
 
 #include <common/osSpecifics.h>
+#include <common/zrtpProbes.h>
+#include <common/zrtpByteOrder.h>
 
 #include "srtp/SrtpHandler.h"
 #include "srtp/CryptoContext.h"
 #include "srtp/CryptoContextCtrl.h"
+#include "srtp/SrtpSession.h"
+#include "srtp/SrtpReceiveTable.h"
+#include "srtp/crypto/SrtpSymCrypto.h"
+
+// Size of the work buffer on the stack for the scatter/gather functions,
+// larger packets use a buffer on the heap.
+#define SRTP_IOV_BUFFER_SIZE    1536
+#define SRTP_IOV_MAX_TAG_LENGTH 32
+#define SRTP_IOV_MAX_CHUNKS     32      // MAC chunks on the stack, the fragments and the ROC
+
+typedef enum {
+    CopyFromFragments,
+    CopyToFragments,
+    XorToFragments
+} FragmentOperation;
+
+/*
+ * Perform an operation on the bytes [offset, offset + length) of the fragments,
+ * the buffer contains or receives these bytes.
+ */
+static void processFragments(const SrtpIoVec fragments[], int32_t count, size_t offset, size_t length,
+                             uint8_t* buffer, FragmentOperation operation)
+{
+    for (int32_t i = 0; i < count && length > 0; i++) {
+        if (offset >= fragments[i].length) {
+            offset -= fragments[i].length;
+            continue;
+        }
+        uint8_t* data = fragments[i].data + offset;
+        size_t chunk = fragments[i].length - offset;
+        if (chunk > length)
+            chunk = length;
+        offset = 0;
+
+        switch (operation) {
+        case CopyFromFragments:
+            memcpy(buffer, data, chunk);
+            break;
+        case CopyToFragments:
+            memcpy(data, buffer, chunk);
+            break;
+        case XorToFragments:
+            for (size_t n = 0; n < chunk; n++)
+                data[n] ^= buffer[n];
+            break;
+        }
+        buffer += chunk;
+        length -= chunk;
+    }
+}
+
+/*
+ * The data chunks of the first length bytes of the fragments to compute the MAC.
+ * The arrays hold count + 1 chunks, the MAC functions append the ROC chunk. A
+ * packet of many fragments allocates the arrays.
+ */
+class FragmentChunks {
+public:
+    FragmentChunks(const SrtpIoVec fragments[], int32_t count, size_t length): number(0) {
+        data = (count < SRTP_IOV_MAX_CHUNKS) ? localData : new const uint8_t*[count + 1];
+        dataLength = (count < SRTP_IOV_MAX_CHUNKS) ? localLength : new uint64_t[count + 1];
+
+        for (int32_t i = 0; i < count && length > 0; i++) {
+            size_t chunk = (fragments[i].length < length) ? fragments[i].length : length;
+            if (chunk == 0)
+                continue;
+            data[number] = fragments[i].data;
+            dataLength[number] = chunk;
+            number++;
+            length -= chunk;
+        }
+    }
+
+    ~FragmentChunks() {
+        if (data != localData)
+            delete [] data;
+        if (dataLength != localLength)
+            delete [] dataLength;
+    }
+
+    const uint8_t** data;
+    uint64_t* dataLength;
+    size_t number;
+
+private:
+    const uint8_t* localData[SRTP_IOV_MAX_CHUNKS];
+    uint64_t localLength[SRTP_IOV_MAX_CHUNKS];
+};
+
+static size_t fragmentsLength(const SrtpIoVec fragments[], int32_t count)
+{
+    size_t length = 0;
+    for (int32_t i = 0; i < count; i++)
+        length += fragments[i].length;
+    return length;
+}
 
 bool SrtpHandler::decodeRtp(uint8_t* buffer, int32_t length, uint32_t *ssrc, uint16_t *seq, uint8_t** payload, int32_t *payloadlen)
 {
     int offset;
-    uint16_t *pus;
-    uint32_t *pui;
 
     /* Assume RTP header at the start of buffer. */
 
@@ -43,30 +140,21 @@ bool SrtpHandler::decodeRtp(uint8_t* buffer, int32_t length, uint32_t *ssrc, uin
     if (length < RTP_HEADER_LENGTH)
         return false;
 
-    /* Get some handy pointers */
-    pus = (uint16_t*)buffer;
-    pui = (uint32_t*)buffer;
-
-    uint16_t tmp16 = pus[1];                    // get seq number
-    *seq = zrtpNtohs(tmp16);                        // and return in host oder
-
-    uint32_t tmp32 = pui[2];                    // get SSRC
-    *ssrc = zrtpNtohl(tmp32);                       // and return in host order
+    *seq = zrtpRtpSequence(buffer);             // return in host order
+    *ssrc = zrtpRtpSsrc(buffer);
 
     /* Payload is located right after header plus CSRC */
-    int32_t numCC = buffer[0] & 0x0f;           // lower 4 bits in first byte is num of contrib SSRC
-    offset = RTP_HEADER_LENGTH + (numCC * sizeof(uint32_t));
+    offset = RTP_HEADER_LENGTH + (zrtpRtpCsrcCount(buffer) * sizeof(uint32_t));
 
     // Sanity check
     if (offset > length)
         return false;
 
     /* Adjust payload offset if RTP extension is used. */
-    if ((*buffer & 0x10) == 0x10) {             // packet contains RTP extension
-        pus = (uint16_t*)(buffer + offset);     // pus points to extension as 16bit pointer
-        tmp16 = pus[1];                         // the second 16 bit word is the length
-        tmp16 = zrtpNtohs(tmp16);                   // to host order
-        offset += (tmp16 + 1) * sizeof(uint32_t);
+    if (zrtpRtpHasExtension(buffer)) {
+        if (offset + 4 > length)                // the extension header contains the length
+            return false;
+        offset += (zrtpRtpExtensionWords(buffer + offset) + 1) * sizeof(uint32_t);
     }
     /* Sanity check */
     if (offset > length)
@@ -79,6 +167,38 @@ bool SrtpHandler::decodeRtp(uint8_t* buffer, int32_t length, uint32_t *ssrc, uin
     return true;
 }
 
+bool SrtpHandler::decodeRtpView(uint8_t* buffer, size_t length, RtpHeaderView* view)
+{
+    /* The same checks as decodeRtp, the view keeps all header fields */
+    if (length < RTP_HEADER_LENGTH || (*buffer & 0xC0) != 0x80)
+        return false;
+
+    view->marker = (buffer[1] & 0x80) != 0;
+    view->payloadType = buffer[1] & 0x7f;
+    view->sequence = zrtpRtpSequence(buffer);
+    view->timestamp = zrtpRtpTimestamp(buffer);
+    view->ssrc = zrtpRtpSsrc(buffer);
+    view->csrcCount = zrtpRtpCsrcCount(buffer);
+
+    size_t offset = RTP_HEADER_LENGTH + view->csrcCount * sizeof(uint32_t);
+    view->extension = NULL;
+    view->extensionLength = 0;
+
+    if (zrtpRtpHasExtension(buffer)) {
+        if (offset + 4 > length)
+            return false;
+        view->extension = buffer + offset;
+        view->extensionLength = (zrtpRtpExtensionWords(view->extension) + 1) * sizeof(uint32_t);
+        offset += view->extensionLength;
+    }
+    if (offset > length)
+        return false;
+
+    view->payload = buffer + offset;
+    view->payloadLength = length - offset;
+    return true;
+}
+
 static void fillErrorData(SrtpErrorData* data, SrtpErrorType type, uint8_t* buffer, size_t length, uint64_t guessedIndex)
 {
     data->errorType = type;
@@ -88,56 +208,268 @@ static void fillErrorData(SrtpErrorData* data, SrtpErrorType type, uint8_t* buff
 }
 
 bool SrtpHandler::protect(CryptoContext* pcc, uint8_t* buffer, size_t length, size_t* newLength)
+{
+    if (pcc == NULL) {
+        return false;
+    }
+    ZRTP_PROBE2(srtp_protect_entry, pcc->getSsrc(), length);
+    SrtpLatencyProbe probe(ZrtpMetrics::ProtectLatency);
+    bool result = protectRtp(pcc, pcc->getTagLength(), buffer, length, newLength, &probe);
+    probe.finish(pcc->getCounters()->getSuite());
+    ZRTP_PROBE2(srtp_protect_return, result, result ? *newLength : 0);
+    return result;
+}
+
+bool SrtpHandler::protect(CryptoContext* pcc, uint8_t* buffer, size_t length, size_t* newLength, RtpHeaderView& view)
+{
+    if (pcc == NULL) {
+        return false;
+    }
+    ZRTP_PROBE2(srtp_protect_entry, pcc->getSsrc(), length);
+    SrtpLatencyProbe probe(ZrtpMetrics::ProtectLatency);
+    bool result = decodeRtpView(buffer, length, &view);
+    probe.endStage(ZrtpMetrics::DecodeStage);
+    if (result) {
+        view.roc = pcc->getRoc();
+        view.index = ((uint64_t)view.roc << 16) | (uint64_t)view.sequence;
+        protectPayload(pcc, pcc->getTagLength(), buffer, length, view.payload, (int32_t)view.payloadLength,
+                       view.sequence, view.ssrc, newLength);
+        probe.endStage(ZrtpMetrics::CryptoStage);
+    }
+    else {
+        pcc->getCounters()->countDecodeError();
+    }
+    probe.finish(pcc->getCounters()->getSuite());
+    ZRTP_PROBE2(srtp_protect_return, result, result ? *newLength : 0);
+    return result;
+}
+
+bool SrtpHandler::protectRtp(CryptoContext* pcc, int32_t tagLength, uint8_t* buffer, size_t length, size_t* newLength,
+                             SrtpLatencyProbe* probe)
 {
     uint8_t* payload = NULL;
     int32_t payloadlen = 0;
     uint16_t seqnum;
     uint32_t ssrc;
 
+    bool decoded = decodeRtp(buffer, length, &ssrc, &seqnum, &payload, &payloadlen);
+    if (probe != NULL)
+        probe->endStage(ZrtpMetrics::DecodeStage);
+    if (!decoded) {
+        pcc->getCounters()->countDecodeError();
+        return false;
+    }
+    protectPayload(pcc, tagLength, buffer, length, payload, payloadlen, seqnum, ssrc, newLength);
+    if (probe != NULL)
+        probe->endStage(ZrtpMetrics::CryptoStage);
+    return true;
+}
+
+void SrtpHandler::protectPayload(CryptoContext* pcc, int32_t tagLength, uint8_t* buffer, size_t length, uint8_t* payload,
+                                 int32_t payloadlen, uint16_t seqnum, uint32_t ssrc, size_t* newLength)
+{
+    /* Encrypt the packet */
+    uint64_t index = ((uint64_t)pcc->getRoc() << 16) | (uint64_t)seqnum;
+    pcc->selectSrtpKeys(index);
+
+    // NO MKI support yet - here we assume MKI is zero. To build in MKI
+    // take MKI length into account when storing the authentication tag.
+
+    /* Encrypt and store the tag at end of RTP packet data, AEAD uses the RTP header as AAD */
+    pcc->srtpProtect(buffer, (uint32_t)length, payload, payloadlen, index, ssrc, buffer + length);
+    *newLength = length + tagLength;
+
+    /* Update the ROC if necessary */
+    if (seqnum == 0xFFFF ) {
+        pcc->setRoc(pcc->getRoc() + 1);
+        pcc->getCounters()->countRocRollover();
+    }
+    pcc->getCounters()->countPacket(length);
+}
+
+bool SrtpHandler::protect(CryptoContext* pcc, const uint8_t* input, size_t length, uint8_t* output, size_t outputCapacity,
+                          size_t* newLength)
+{
+    uint8_t* payload = NULL;
+    int32_t payloadlen = 0;
+    uint16_t seqnum;
+    uint32_t ssrc;
 
     if (pcc == NULL) {
         return false;
     }
-    if (!decodeRtp(buffer, length, &ssrc, &seqnum, &payload, &payloadlen))
+    const int32_t tagLength = pcc->getTagLength();
+
+    if (outputCapacity < length + tagLength)
         return false;
 
-    /* Encrypt the packet */
+    // decodeRtp does not modify the buffer
+    if (!decodeRtp(const_cast<uint8_t*>(input), length, &ssrc, &seqnum, &payload, &payloadlen)) {
+        pcc->getCounters()->countDecodeError();
+        return false;
+    }
+
+    uint32_t hdrLength = (uint32_t)(payload - input);
     uint64_t index = ((uint64_t)pcc->getRoc() << 16) | (uint64_t)seqnum;
+    pcc->selectSrtpKeys(index);
 
-    pcc->srtpEncrypt(buffer, payload, payloadlen, index, ssrc);
+    memcpy(output, input, hdrLength);
 
-    // NO MKI support yet - here we assume MKI is zero. To build in MKI
-    // take MKI length into account when storing the authentication tag.
+    if (pcc->isAead()) {
+        /* The GCM functions work in place, thus copy the payload first */
+        memcpy(output + hdrLength, payload, payloadlen);
+        pcc->srtpAeadEncrypt(output, hdrLength, payloadlen, index, ssrc, output + length);
+    }
+    else {
+        pcc->srtpEncrypt(output, payload, payloadlen, output + hdrLength, index, ssrc);
 
-    /* Compute MAC and store at end of RTP packet data */
-    if (pcc->getTagLength() > 0) {
-        pcc->srtpAuthenticate(buffer, length, pcc->getRoc(), buffer+length);
+        if (tagLength > 0) {
+            pcc->srtpAuthenticate(output, length, pcc->getRoc(), output + length);
+        }
     }
-    *newLength = length + pcc->getTagLength();
+    *newLength = length + tagLength;
 
     /* Update the ROC if necessary */
     if (seqnum == 0xFFFF ) {
         pcc->setRoc(pcc->getRoc() + 1);
+        pcc->getCounters()->countRocRollover();
     }
+    pcc->getCounters()->countPacket(length);
     return true;
 }
 
 int32_t SrtpHandler::unprotect(CryptoContext* pcc, uint8_t* buffer, size_t length, size_t* newLength, SrtpErrorData* errorData)
+{
+    if (pcc == NULL) {
+        return 0;
+    }
+    ZRTP_PROBE2(srtp_unprotect_entry, pcc->getSsrc(), length);
+    SrtpLatencyProbe probe(ZrtpMetrics::UnprotectLatency);
+    int32_t result = unprotectRtp(pcc, pcc->getTagLength() + pcc->getMkiLength(), buffer, length, newLength, errorData,
+                                  &probe);
+    probe.finish(pcc->getCounters()->getSuite());
+    ZRTP_PROBE2(srtp_unprotect_return, result, result == 1 ? *newLength : 0);
+    return result;
+}
+
+int32_t SrtpHandler::unprotect(CryptoContext* pcc, uint8_t* buffer, size_t length, size_t* newLength, RtpHeaderView& view,
+                               SrtpErrorData* errorData)
+{
+    if (pcc == NULL) {
+        return 0;
+    }
+    ZRTP_PROBE2(srtp_unprotect_entry, pcc->getSsrc(), length);
+    SrtpLatencyProbe probe(ZrtpMetrics::UnprotectLatency);
+    bool decoded = decodeRtpView(buffer, length, &view);
+    probe.endStage(ZrtpMetrics::DecodeStage);
+    if (!decoded) {
+        if (errorData != NULL)
+            fillErrorData(errorData, DecodeError, buffer, length, 0);
+        pcc->getCounters()->countDecodeError();
+        probe.finish(pcc->getCounters()->getSuite());
+        ZRTP_PROBE2(srtp_unprotect_return, 0, 0);
+        return 0;
+    }
+    int32_t result = unprotectPayload(pcc, pcc->getTagLength() + pcc->getMkiLength(), buffer, length, view.payload,
+                                      (int32_t)view.payloadLength, view.sequence, view.ssrc, newLength, errorData,
+                                      &view.index, &probe);
+    probe.finish(pcc->getCounters()->getSuite());
+    view.roc = (uint32_t)(view.index >> 16);
+
+    // The payload ends before the tag, the padding count is the last payload byte
+    if (*newLength < (size_t)(view.payload - buffer))
+        view.payloadLength = 0;
+    else
+        view.payloadLength = *newLength - (size_t)(view.payload - buffer);
+    if (result == 1 && (*buffer & 0x20) == 0x20 && view.payloadLength > 0) {
+        size_t padding = view.payload[view.payloadLength - 1];
+        view.payloadLength = (padding <= view.payloadLength) ? view.payloadLength - padding : 0;
+    }
+    ZRTP_PROBE2(srtp_unprotect_return, result, result == 1 ? *newLength : 0);
+    return result;
+}
+
+bool SrtpHandler::protectTwice(CryptoContext* inner, CryptoContext* outer, uint8_t* buffer, size_t length, size_t* newLength)
 {
     uint8_t* payload = NULL;
     int32_t payloadlen = 0;
     uint16_t seqnum;
     uint32_t ssrc;
 
-    if (pcc == NULL) {
-        return 0;
+    if (inner == NULL || outer == NULL) {
+        return false;
+    }
+    if (!decodeRtp(buffer, length, &ssrc, &seqnum, &payload, &payloadlen)) {
+        inner->getCounters()->countDecodeError();
+        return false;
     }
+    size_t innerLength;
+    protectPayload(inner, inner->getTagLength(), buffer, length, payload, payloadlen, seqnum, ssrc, &innerLength);
+
+    // The outer layer protects the inner tag as part of the payload, the data is still in the cache
+    payloadlen += (int32_t)(innerLength - length);
+    protectPayload(outer, outer->getTagLength(), buffer, innerLength, payload, payloadlen, seqnum, ssrc, newLength);
+    return true;
+}
+
+int32_t SrtpHandler::unprotectTwice(CryptoContext* outer, CryptoContext* inner, uint8_t* buffer, size_t length,
+                                    size_t* newLength, bool* outerDone, SrtpErrorData* errorData)
+{
+    uint8_t* payload = NULL;
+    int32_t payloadlen = 0;
+    uint16_t seqnum;
+    uint32_t ssrc;
 
+    *outerDone = false;
+    if (inner == NULL || outer == NULL) {
+        return 0;
+    }
     if (!decodeRtp(buffer, length, &ssrc, &seqnum, &payload, &payloadlen)) {
         if (errorData != NULL)
             fillErrorData(errorData, DecodeError, buffer, length, 0);
+        outer->getCounters()->countDecodeError();
+        return 0;
+    }
+    size_t outerLength;
+    int32_t rc = unprotectPayload(outer, outer->getTagLength() + outer->getMkiLength(), buffer, length, payload,
+                                  payloadlen, seqnum, ssrc, &outerLength, errorData);
+    if (rc != 1) {
+        *newLength = outerLength;
+        return rc;
+    }
+    *outerDone = true;
+
+    payloadlen -= (int32_t)(length - outerLength);
+    return unprotectPayload(inner, inner->getTagLength() + inner->getMkiLength(), buffer, outerLength, payload,
+                            payloadlen, seqnum, ssrc, newLength, errorData);
+}
+
+int32_t SrtpHandler::unprotectRtp(CryptoContext* pcc, int32_t srtpLength, uint8_t* buffer, size_t length, size_t* newLength,
+                                  SrtpErrorData* errorData, SrtpLatencyProbe* probe)
+{
+    uint8_t* payload = NULL;
+    int32_t payloadlen = 0;
+    uint16_t seqnum;
+    uint32_t ssrc;
+
+    // A packet, for example the last segment of a GRO buffer, may be shorter than tag and MKI
+    bool decoded = decodeRtp(buffer, length, &ssrc, &seqnum, &payload, &payloadlen) && payloadlen >= srtpLength;
+    if (probe != NULL)
+        probe->endStage(ZrtpMetrics::DecodeStage);
+    if (!decoded) {
+        if (errorData != NULL)
+            fillErrorData(errorData, DecodeError, buffer, length, 0);
+        pcc->getCounters()->countDecodeError();
         return 0;
     }
+    return unprotectPayload(pcc, srtpLength, buffer, length, payload, payloadlen, seqnum, ssrc, newLength, errorData,
+                            NULL, probe);
+}
+
+int32_t SrtpHandler::unprotectPayload(CryptoContext* pcc, int32_t srtpLength, uint8_t* buffer, size_t length, uint8_t* payload,
+                                      int32_t payloadlen, uint16_t seqnum, uint32_t ssrc, size_t* newLength,
+                                      SrtpErrorData* errorData, uint64_t* packetIndex, SrtpLatencyProbe* probe)
+{
     /*
      * This is the setting of the packet data when we come to this point:
      *
@@ -147,16 +479,17 @@ int32_t SrtpHandler::unprotect(CryptoContext* pcc, uint8_t* buffer, size_t lengt
      *
      * Because this is an SRTP packet we need to adjust some values here.
      * The SRTP MKI and authentication data is always at the end of a
-     * packet. Thus compute the positions of this data.
+     * packet. Thus compute the positions of this data. The caller computed
+     * srtpLength as tag length plus MKI length.
      */
-    uint32_t srtpDataIndex = length - (pcc->getTagLength() + pcc->getMkiLength());
+    uint32_t srtpDataIndex = length - srtpLength;
 
     // Compute new length
-    length -= pcc->getTagLength() + pcc->getMkiLength();
+    length -= srtpLength;
     *newLength = length;
 
     // recompute payloadlen by subtracting SRTP data
-    payloadlen -= pcc->getTagLength() + pcc->getMkiLength();
+    payloadlen -= srtpLength;
 
     // MKI is unused, so just skip it
     // const uint8* mki = buffer + srtpDataIndex;
@@ -164,34 +497,586 @@ int32_t SrtpHandler::unprotect(CryptoContext* pcc, uint8_t* buffer, size_t lengt
 
     /* Guess the index */
     uint64_t guessedIndex = pcc->guessIndex(seqnum);
+    if (packetIndex != NULL)
+        *packetIndex = guessedIndex;
 
     /* Replay control */
-    if (!pcc->checkReplay(seqnum)) {
+    bool fresh = pcc->checkReplay(seqnum);
+    if (probe != NULL)
+        probe->endStage(ZrtpMetrics::ReplayStage);
+    if (!fresh) {
         if (errorData != NULL)
             fillErrorData(errorData, ReplayError, buffer, length, guessedIndex);
+        pcc->getCounters()->countReplayDrop();
+        ZRTP_PROBE2(srtp_replay_fail, ssrc, seqnum);
         return -2;
     }
+    pcc->selectSrtpKeys(guessedIndex);
+
+    /* Check the tag, decrypt the content only if the tag is valid */
+    bool valid = pcc->srtpUnprotect(buffer, (uint32_t)length, payload, payloadlen, guessedIndex, ssrc, tag);
+    if (probe != NULL)
+        probe->endStage(ZrtpMetrics::CryptoStage);
+    if (!valid) {
+        if (errorData != NULL)
+            fillErrorData(errorData, AuthError, buffer, length, guessedIndex);
+        pcc->getCounters()->countAuthFailure();
+        ZRTP_PROBE2(srtp_auth_fail, ssrc, seqnum);
+        return -1;
+    }
 
-    if (pcc->getTagLength() > 0) {
-        uint32_t guessedRoc = guessedIndex >> 16;
-        uint8_t mac[20];
+    /* Update the Crypto-context */
+    pcc->update(seqnum);
+    pcc->getCounters()->countPacket(length);
 
-        pcc->srtpAuthenticate(buffer, (uint32_t)length, guessedRoc, mac);
-        if (memcmp(tag, mac, pcc->getTagLength()) != 0) {
-            if (errorData != NULL)
-                fillErrorData(errorData, AuthError, buffer, length, guessedIndex);
-            return -1;
+    return 1;
+}
+
+int32_t SrtpHandler::protectBatch(CryptoContext* pcc, PacketSpan packets[], int32_t count)
+{
+    int32_t done = 0;
+
+    if (pcc == NULL) {
+        for (int32_t i = 0; i < count; i++)
+            packets[i].result = 0;
+        return 0;
+    }
+    const int32_t tagLength = pcc->getTagLength();
+
+    for (int32_t i = 0; i < count; i++) {
+        PacketSpan* pkt = &packets[i];
+
+        pkt->result = protectRtp(pcc, tagLength, pkt->buffer, pkt->length, &pkt->newLength) ? 1 : 0;
+        done += pkt->result;
+    }
+    return done;
+}
+
+/* Number of packets that protectMulti() prepares for the lane functions at once */
+static const int32_t multiPackets = 16;
+
+int32_t SrtpHandler::protectMulti(CryptoContext* contexts[], PacketSpan packets[], int32_t count)
+{
+    SrtpCtrLane ctrLanes[multiPackets];
+    hmacSha1Lane macLanes[multiPackets];
+    CryptoContext* authContext[multiPackets];
+    PacketSpan* authPacket[multiPackets];
+    uint32_t authRoc[multiPackets];
+    uint32_t beRoc[multiPackets];
+    int32_t macLane[multiPackets];
+    int32_t done = 0;
+
+    for (int32_t base = 0; base < count; base += multiPackets) {
+        int32_t number = (count - base < multiPackets) ? count - base : multiPackets;
+        int32_t numCtr = 0, numAuth = 0, numMac = 0;
+
+        // Decode the packets and compute the indices in array order, collect the encryption jobs
+        for (int32_t i = 0; i < number; i++) {
+            CryptoContext* pcc = contexts[base + i];
+            PacketSpan* pkt = &packets[base + i];
+            uint8_t* payload = NULL;
+            int32_t payloadlen = 0;
+            uint16_t seqnum;
+            uint32_t ssrc;
+
+            pkt->result = 0;
+            if (pcc == NULL)
+                continue;
+            if (!decodeRtp(pkt->buffer, pkt->length, &ssrc, &seqnum, &payload, &payloadlen)) {
+                pcc->getCounters()->countDecodeError();
+                continue;
+            }
+            pkt->result = 1;
+            done++;
+
+            int32_t tagLength = pcc->getTagLength();
+            if (pcc->isAead() || pcc->getKeyDerivRate() != 0) {
+                protectPayload(pcc, tagLength, pkt->buffer, pkt->length, payload, payloadlen, seqnum, ssrc, &pkt->newLength);
+                continue;
+            }
+            uint64_t index = ((uint64_t)pcc->getRoc() << 16) | (uint64_t)seqnum;
+
+            if (pcc->srtpEncryptLane(pkt->buffer, payload, payloadlen, index, ssrc, &ctrLanes[numCtr]))
+                numCtr++;
+            if (tagLength > 0) {
+                authContext[numAuth] = pcc;
+                authPacket[numAuth] = pkt;
+                authRoc[numAuth] = pcc->getRoc();
+                numAuth++;
+            }
+            pkt->newLength = pkt->length + tagLength;
+
+            /* Update the ROC if necessary */
+            if (seqnum == 0xFFFF ) {
+                pcc->setRoc(pcc->getRoc() + 1);
+                pcc->getCounters()->countRocRollover();
+            }
+            pcc->getCounters()->countPacket(pkt->length);
+        }
+        SrtpSymCrypto::ctrEncryptLanes(ctrLanes, numCtr);
+
+        // The tags cover the encrypted packets
+        for (int32_t i = 0; i < numAuth; i++) {
+            PacketSpan* pkt = authPacket[i];
+
+            beRoc[i] = zrtpBe32(authRoc[i]);
+            macLane[i] = -1;
+            if (authContext[i]->srtpAuthenticateLane(pkt->buffer, (uint32_t)pkt->length, &beRoc[i], &macLanes[numMac]))
+                macLane[i] = numMac++;
+            else
+                authContext[i]->srtpAuthenticate(pkt->buffer, (uint32_t)pkt->length, authRoc[i], pkt->buffer + pkt->length);
+        }
+        hmacSha1CtxLanes(macLanes, numMac);
+
+        for (int32_t i = 0; i < numAuth; i++) {
+            if (macLane[i] >= 0)
+                memcpy(authPacket[i]->buffer + authPacket[i]->length, macLanes[macLane[i]].mac, authContext[i]->getTagLength());
+        }
+    }
+    return done;
+}
+
+int32_t SrtpHandler::unprotectBatch(CryptoContext* pcc, PacketSpan packets[], int32_t count)
+{
+    int32_t done = 0;
+
+    if (pcc == NULL) {
+        for (int32_t i = 0; i < count; i++)
+            packets[i].result = 0;
+        return 0;
+    }
+    const int32_t srtpLength = pcc->getTagLength() + pcc->getMkiLength();
+
+    for (int32_t i = 0; i < count; i++) {
+        PacketSpan* pkt = &packets[i];
+
+        pkt->result = unprotectRtp(pcc, srtpLength, pkt->buffer, pkt->length, &pkt->newLength, NULL);
+        if (pkt->result == 1)
+            done++;
+    }
+    return done;
+}
+
+int32_t SrtpHandler::unprotectMulti(SrtpReceiveTable* table, const int32_t slots[], PacketSpan packets[], int32_t count)
+{
+    SrtpCtrLane ctrLanes[multiPackets];
+    hmacSha1Lane macLanes[multiPackets];
+    PacketSpan* jobPacket[multiPackets];
+    uint8_t* jobPayload[multiPackets];
+    int32_t jobPayloadLength[multiPackets];
+    uint32_t jobSsrc[multiPackets];
+    int32_t jobSlot[multiPackets];
+    uint16_t jobSeq[multiPackets];
+    uint64_t jobIndex[multiPackets];
+    uint8_t jobValid[multiPackets];
+    bool jobRepeat[multiPackets];
+    uint32_t beRoc[multiPackets];
+    int32_t macLane[multiPackets];
+    int32_t done = 0;
+
+    if (table == NULL) {
+        for (int32_t i = 0; i < count; i++)
+            packets[i].result = 0;
+        return 0;
+    }
+
+    for (int32_t base = 0; base < count; base += multiPackets) {
+        int32_t number = (count - base < multiPackets) ? count - base : multiPackets;
+        int32_t numJobs = 0, numCtr = 0, numMac = 0;
+
+        // Decode the packets, collect the packets of valid slots
+        for (int32_t i = 0; i < number; i++) {
+            PacketSpan* pkt = &packets[base + i];
+            CryptoContext* pcc = table->getContext(slots[base + i]);
+            uint8_t* payload = NULL;
+            int32_t payloadlen = 0;
+            uint16_t seqnum;
+            uint32_t ssrc;
+
+            pkt->result = 0;
+            if (pcc == NULL)
+                continue;
+            int32_t srtpLength = pcc->getTagLength() + pcc->getMkiLength();
+            if (!decodeRtp(pkt->buffer, pkt->length, &ssrc, &seqnum, &payload, &payloadlen) || payloadlen < srtpLength) {
+                pcc->getCounters()->countDecodeError();
+                continue;
+            }
+            pkt->newLength = pkt->length - srtpLength;
+
+            jobPacket[numJobs] = pkt;
+            jobPayload[numJobs] = payload;
+            jobPayloadLength[numJobs] = payloadlen - srtpLength;
+            jobSsrc[numJobs] = ssrc;
+            jobSlot[numJobs] = slots[base + i];
+            jobSeq[numJobs] = seqnum;
+            jobRepeat[numJobs] = false;
+            for (int32_t k = 0; k < numJobs; k++) {
+                if (jobSlot[k] == jobSlot[numJobs])
+                    jobRepeat[numJobs] = true;
+            }
+            numJobs++;
+        }
+
+        // Indices and replay checks of the whole batch with the state at the start of the batch
+        table->checkBatch(jobSlot, jobSeq, numJobs, jobIndex, jobValid);
+
+        // A repeated slot depends on the earlier packets of the slot, it takes the single packet path
+        for (int32_t j = 0; j < numJobs; j++) {
+            CryptoContext* pcc = table->contexts[jobSlot[j]];
+            PacketSpan* pkt = jobPacket[j];
+
+            macLane[j] = -1;
+            if (jobRepeat[j] || !jobValid[j] || pcc->isAead() || pcc->getKeyDerivRate() != 0)
+                continue;
+            beRoc[j] = zrtpBe32((uint32_t)(jobIndex[j] >> 16));
+            if (pcc->srtpAuthenticateLane(pkt->buffer, (uint32_t)pkt->newLength, &beRoc[j], &macLanes[numMac]))
+                macLane[j] = numMac++;
+        }
+        hmacSha1CtxLanes(macLanes, numMac);
+
+        // Check the tags and update the state in array order, decrypt only packets with a valid tag
+        for (int32_t j = 0; j < numJobs; j++) {
+            int32_t slot = jobSlot[j];
+            CryptoContext* pcc = table->contexts[slot];
+            PacketSpan* pkt = jobPacket[j];
+            uint16_t seqnum = jobSeq[j];
+            uint64_t index = jobIndex[j];
+            bool valid = jobValid[j] != 0;
+            uint8_t* tag = pkt->buffer + pkt->newLength + pcc->getMkiLength();
+
+            table->setFirstSequence(slot, seqnum);
+            if (jobRepeat[j])
+                valid = table->check(slot, seqnum, &index);
+            if (!valid) {
+                pkt->result = -2;
+                pcc->getCounters()->countReplayDrop();
+                ZRTP_PROBE2(srtp_replay_fail, jobSsrc[j], seqnum);
+                continue;
+            }
+            bool tagValid;
+            if (macLane[j] >= 0) {
+                tagValid = srtpTagEqual(tag, macLanes[macLane[j]].mac, pcc->getTagLength());
+                if (tagValid && pcc->srtpEncryptLane(pkt->buffer, jobPayload[j], jobPayloadLength[j], index, jobSsrc[j],
+                                                     &ctrLanes[numCtr]))
+                    numCtr++;
+            }
+            else {
+                pcc->selectSrtpKeys(index);
+                tagValid = pcc->srtpUnprotect(pkt->buffer, (uint32_t)pkt->newLength, jobPayload[j], jobPayloadLength[j],
+                                              index, jobSsrc[j], tag);
+            }
+            if (!tagValid) {
+                pkt->result = -1;
+                pcc->getCounters()->countAuthFailure();
+                ZRTP_PROBE2(srtp_auth_fail, jobSsrc[j], seqnum);
+                continue;
+            }
+            table->update(slot, seqnum, index);
+            pcc->getCounters()->countPacket(pkt->newLength);
+            pkt->result = 1;
+            done++;
+        }
+        SrtpSymCrypto::ctrEncryptLanes(ctrLanes, numCtr);
+    }
+    return done;
+}
+
+int32_t SrtpHandler::protectGso(CryptoContext* contexts[], PacketSpan packets[], int32_t count, uint8_t* output,
+                                size_t outputCapacity, size_t segmentSize, size_t* outputLength)
+{
+    PacketSpan segments[maxGsoSegments];
+    size_t offset = 0;
+    int32_t number = 0;
+
+    for (int32_t i = 0; i < count; i++)
+        packets[i].result = 0;
+
+    // Lay out the packets while they fill whole segments, a shorter packet is the last one
+    while (number < count && number < maxGsoSegments) {
+        CryptoContext* pcc = contexts[number];
+        PacketSpan* pkt = &packets[number];
+        uint8_t* payload = NULL;
+        int32_t payloadlen = 0;
+        uint16_t seqnum;
+        uint32_t ssrc;
+
+        if (pcc == NULL)
+            break;
+        size_t srtpLength = pkt->length + pcc->getTagLength();
+        if (srtpLength > segmentSize || offset + srtpLength > outputCapacity)
+            break;
+
+        // Check the packet before the copy, protectMulti() must not leave a gap in the buffer
+        if (!decodeRtp(pkt->buffer, pkt->length, &ssrc, &seqnum, &payload, &payloadlen))
+            break;
+        memcpy(output + offset, pkt->buffer, pkt->length);
+
+        PacketSpan segment = {output + offset, pkt->length, 0, 0};
+        segments[number++] = segment;
+        offset += srtpLength;
+        if (srtpLength < segmentSize)
+            break;
+    }
+    int32_t done = protectMulti(contexts, segments, number);
+
+    for (int32_t i = 0; i < number; i++) {
+        packets[i].newLength = segments[i].newLength;
+        packets[i].result = segments[i].result;
+    }
+    *outputLength = offset;
+    return done;
+}
+
+int32_t SrtpHandler::splitGro(uint8_t* buffer, size_t length, size_t segmentSize, PacketSpan packets[], int32_t maxPackets)
+{
+    int32_t number = 0;
+
+    if (segmentSize == 0)
+        return 0;
+
+    for (size_t offset = 0; offset < length && number < maxPackets; offset += segmentSize) {
+        PacketSpan* pkt = &packets[number++];
+
+        pkt->buffer = buffer + offset;
+        pkt->length = (length - offset < segmentSize) ? length - offset : segmentSize;
+        pkt->newLength = 0;
+        pkt->result = 0;
+    }
+    return number;
+}
+
+int32_t SrtpHandler::unprotectGro(CryptoContext* pcc, uint8_t* buffer, size_t length, size_t segmentSize,
+                                  PacketSpan packets[], int32_t maxPackets, int32_t* segments)
+{
+    *segments = splitGro(buffer, length, segmentSize, packets, maxPackets);
+    return unprotectBatch(pcc, packets, *segments);
+}
+
+bool SrtpHandler::decodeRtpv(const SrtpIoVec fragments[], int32_t count, size_t length, uint32_t *ssrc, uint16_t *seq,
+                             uint8_t* header, size_t* headerLength)
+{
+    if (length < RTP_HEADER_LENGTH)
+        return false;
+
+    processFragments(fragments, count, 0, RTP_HEADER_LENGTH, header, CopyFromFragments);
+
+    if ((*header & 0xC0) != 0x80)             // check version bits
+        return false;
+
+    *seq = (uint16_t)((header[2] << 8) | header[3]);
+    *ssrc = ((uint32_t)header[8] << 24) | ((uint32_t)header[9] << 16) | ((uint32_t)header[10] << 8) | header[11];
+
+    /* Payload is located right after header plus CSRC */
+    size_t offset = RTP_HEADER_LENGTH + ((header[0] & 0x0f) * sizeof(uint32_t));
+    if (offset > length)
+        return false;
+
+    /* Adjust payload offset if RTP extension is used. */
+    if ((*header & 0x10) == 0x10) {
+        uint8_t extension[4];
+
+        if (offset + sizeof(extension) > length)
+            return false;
+        processFragments(fragments, count, offset, sizeof(extension), extension, CopyFromFragments);
+        offset += (((extension[2] << 8) | extension[3]) + 1) * sizeof(uint32_t);
+    }
+    if (offset > length)
+        return false;
+
+    *headerLength = offset;
+    return true;
+}
+
+bool SrtpHandler::protectv(CryptoContext* pcc, const SrtpIoVec fragments[], int32_t count, uint8_t* tag)
+{
+    uint8_t header[RTP_HEADER_LENGTH];
+    size_t hdrLength;
+    uint16_t seqnum;
+    uint32_t ssrc;
+
+    if (pcc == NULL) {
+        return false;
+    }
+    size_t length = fragmentsLength(fragments, count);
+
+    if (!decodeRtpv(fragments, count, length, &ssrc, &seqnum, header, &hdrLength)) {
+        pcc->getCounters()->countDecodeError();
+        return false;
+    }
+
+    uint32_t payloadlen = (uint32_t)(length - hdrLength);
+    uint64_t index = ((uint64_t)pcc->getRoc() << 16) | (uint64_t)seqnum;
+    pcc->selectSrtpKeys(index);
+
+    uint8_t localBuffer[SRTP_IOV_BUFFER_SIZE];
+    size_t workLength = pcc->isAead() ? length : payloadlen;
+    uint8_t* work = (workLength <= sizeof(localBuffer)) ? localBuffer : new uint8_t[workLength];
+
+    if (pcc->isAead()) {
+        /* AEAD needs the header as AAD and the payload in one buffer */
+        processFragments(fragments, count, 0, length, work, CopyFromFragments);
+        pcc->srtpAeadEncrypt(work, (uint32_t)hdrLength, payloadlen, index, ssrc, tag);
+        processFragments(fragments, count, hdrLength, payloadlen, work + hdrLength, CopyToFragments);
+    }
+    else {
+        if (pcc->srtpKeyStream(work, payloadlen, index, ssrc)) {
+            processFragments(fragments, count, hdrLength, payloadlen, work, XorToFragments);
+        }
+        else {
+            processFragments(fragments, count, hdrLength, payloadlen, work, CopyFromFragments);
+            pcc->srtpEncrypt(header, work, payloadlen, index, ssrc);
+            processFragments(fragments, count, hdrLength, payloadlen, work, CopyToFragments);
+        }
+        if (pcc->getTagLength() > 0) {
+            FragmentChunks chunks(fragments, count, length);
+
+            pcc->srtpAuthenticate(chunks.data, chunks.dataLength, chunks.number, pcc->getRoc(), tag);
         }
     }
-    /* Decrypt the content */
-    pcc->srtpEncrypt(buffer, payload, payloadlen, guessedIndex, ssrc);
+    if (work != localBuffer)
+        delete [] work;
+
+    /* Update the ROC if necessary */
+    if (seqnum == 0xFFFF ) {
+        pcc->setRoc(pcc->getRoc() + 1);
+        pcc->getCounters()->countRocRollover();
+    }
+    pcc->getCounters()->countPacket(length);
+    return true;
+}
 
+int32_t SrtpHandler::unprotectv(CryptoContext* pcc, const SrtpIoVec fragments[], int32_t count, size_t* newLength,
+                                SrtpErrorData* errorData)
+{
+    uint8_t header[RTP_HEADER_LENGTH] = {0};
+    uint8_t tag[SRTP_IOV_MAX_TAG_LENGTH];
+    size_t hdrLength;
+    uint16_t seqnum;
+    uint32_t ssrc;
+
+    if (pcc == NULL) {
+        return 0;
+    }
+    const int32_t tagLength = pcc->getTagLength();
+    const size_t srtpLength = tagLength + pcc->getMkiLength();
+    size_t length = fragmentsLength(fragments, count);
+
+    if (tagLength > SRTP_IOV_MAX_TAG_LENGTH || length < srtpLength ||
+        !decodeRtpv(fragments, count, length - srtpLength, &ssrc, &seqnum, header, &hdrLength)) {
+        if (errorData != NULL)
+            fillErrorData(errorData, DecodeError, header, length, 0);
+        pcc->getCounters()->countDecodeError();
+        return 0;
+    }
+    // The SRTP MKI and authentication data is always at the end of a packet
+    length -= srtpLength;
+    *newLength = length;
+    uint32_t payloadlen = (uint32_t)(length - hdrLength);
+
+    processFragments(fragments, count, length + pcc->getMkiLength(), tagLength, tag, CopyFromFragments);
+
+    /* Guess the index */
+    uint64_t guessedIndex = pcc->guessIndex(seqnum);
+
+    /* Replay control */
+    if (!pcc->checkReplay(seqnum)) {
+        if (errorData != NULL)
+            fillErrorData(errorData, ReplayError, header, length, guessedIndex);
+        pcc->getCounters()->countReplayDrop();
+        ZRTP_PROBE2(srtp_replay_fail, ssrc, seqnum);
+        return -2;
+    }
+    pcc->selectSrtpKeys(guessedIndex);
+    uint8_t localBuffer[SRTP_IOV_BUFFER_SIZE];
+    size_t workLength = pcc->isAead() ? length : payloadlen;
+    uint8_t* work = (workLength <= sizeof(localBuffer)) ? localBuffer : new uint8_t[workLength];
+    int32_t result = 1;
+
+    if (pcc->isAead()) {
+        /* Check the tag and decrypt the content in one step */
+        processFragments(fragments, count, 0, length, work, CopyFromFragments);
+        if (pcc->srtpAeadDecrypt(work, (uint32_t)hdrLength, payloadlen, guessedIndex, ssrc, tag))
+            processFragments(fragments, count, hdrLength, payloadlen, work + hdrLength, CopyToFragments);
+        else
+            result = -1;
+    }
+    else {
+        if (tagLength > 0) {
+            FragmentChunks chunks(fragments, count, length);
+
+            if (!pcc->srtpVerifyTag(chunks.data, chunks.dataLength, chunks.number, (uint32_t)(guessedIndex >> 16), tag))
+                result = -1;
+        }
+        if (result == 1) {
+            /* Decrypt the content */
+            if (pcc->srtpKeyStream(work, payloadlen, guessedIndex, ssrc)) {
+                processFragments(fragments, count, hdrLength, payloadlen, work, XorToFragments);
+            }
+            else {
+                processFragments(fragments, count, hdrLength, payloadlen, work, CopyFromFragments);
+                pcc->srtpEncrypt(header, work, payloadlen, guessedIndex, ssrc);
+                processFragments(fragments, count, hdrLength, payloadlen, work, CopyToFragments);
+            }
+        }
+    }
+    if (work != localBuffer)
+        delete [] work;
+
+    if (result != 1) {
+        if (errorData != NULL)
+            fillErrorData(errorData, AuthError, header, length, guessedIndex);
+        pcc->getCounters()->countAuthFailure();
+        ZRTP_PROBE2(srtp_auth_fail, ssrc, seqnum);
+        return result;
+    }
     /* Update the Crypto-context */
     pcc->update(seqnum);
+    pcc->getCounters()->countPacket(length);
 
     return 1;
 }
 
+bool SrtpHandler::getSsrc(const uint8_t* buffer, size_t length, uint32_t* ssrc)
+{
+    if (length < RTP_HEADER_LENGTH || (*buffer & 0xC0) != 0x80)
+        return false;
+
+    *ssrc = zrtpRtpSsrc(buffer);
+    return true;
+}
+
+bool SrtpHandler::protect(SrtpSession* session, uint8_t* buffer, size_t length, size_t* newLength)
+{
+    uint32_t ssrc;
+
+    if (session == NULL || !getSsrc(buffer, length, &ssrc))
+        return false;
+
+    return protect(session->getCryptoContext(ssrc), buffer, length, newLength);
+}
+
+int32_t SrtpHandler::unprotect(SrtpSession* session, uint8_t* buffer, size_t length, size_t* newLength, SrtpErrorData* errorData)
+{
+    uint32_t ssrc;
+
+    if (session == NULL || !getSsrc(buffer, length, &ssrc)) {
+        if (errorData != NULL && session != NULL && length >= RTP_HEADER_LENGTH)
+            fillErrorData(errorData, DecodeError, buffer, length, 0);
+        return 0;
+    }
+    CryptoContext* pcc = session->findCryptoContext(ssrc);
+    bool created = false;
+
+    if (pcc == NULL) {
+        pcc = session->getCryptoContext(ssrc);
+        created = true;
+    }
+    int32_t rc = unprotect(pcc, buffer, length, newLength, errorData);
+
+    if (created && rc != 1)
+        session->removeCryptoContext(ssrc);
+    return rc;
+}
 
 bool SrtpHandler::protectCtrl(CryptoContextCtrl* pcc, uint8_t* buffer, size_t length, size_t* newLength)
 {
@@ -199,29 +1084,53 @@ bool SrtpHandler::protectCtrl(CryptoContextCtrl* pcc, uint8_t* buffer, size_t le
     if (pcc == NULL) {
         return false;
     }
+    SrtpLatencyProbe probe(ZrtpMetrics::ProtectLatency);
+    bool result = protectRtcp(pcc, pcc->getTagLength(), buffer, length, newLength);
+    probe.finish(pcc->getCounters()->getSuite());
+    return result;
+}
+
+bool SrtpHandler::protectRtcp(CryptoContextCtrl* pcc, int32_t tagLength, uint8_t* buffer, size_t length, size_t* newLength)
+{
+    if (length < 8) {
+        pcc->getCounters()->countDecodeError();
+        return false;
+    }
+
     /* Encrypt the packet */
-    uint32_t ssrc = *(reinterpret_cast<uint32_t*>(buffer + 4)); // always SSRC of sender
-    ssrc = zrtpNtohl(ssrc);
+    uint32_t ssrc = zrtpRtcpSsrc(buffer);                       // always SSRC of sender
 
     uint32_t encIndex = pcc->getSrtcpIndex();
-    pcc->srtcpEncrypt(buffer + 8, length - 8, encIndex, ssrc);
 
-    encIndex |= 0x80000000;                                     // set the E flag
+    if (pcc->isAead()) {
+        encIndex |= 0x80000000;                                 // set the E flag
 
-    // Fill SRTCP index as last word
-    uint32_t* ip = reinterpret_cast<uint32_t*>(buffer+length);
-    *ip = zrtpHtonl(encIndex);
+        // AEAD stores the tag before the SRTCP index field, RFC 7714 chapter 17
+        pcc->srtcpAeadEncrypt(buffer, length, encIndex, ssrc, buffer + length);
+        zrtpStoreBe32(buffer + length + tagLength, encIndex);
+    }
+    else {
+        pcc->srtcpEncrypt(buffer + 8, length - 8, encIndex, ssrc);
 
-    // NO MKI support yet - here we assume MKI is zero. To build in MKI
-    // take MKI length into account when storing the authentication tag.
+        encIndex |= 0x80000000;                                 // set the E flag
+
+        // Fill SRTCP index as last word
+        zrtpStoreBe32(buffer + length, encIndex);
 
-    // Compute MAC and store in packet after the SRTCP index field
-    pcc->srtcpAuthenticate(buffer, length, encIndex, buffer + length + sizeof(uint32_t));
+        // NO MKI support yet - here we assume MKI is zero. To build in MKI
+        // take MKI length into account when storing the authentication tag.
+
+        // Compute MAC and store in packet after the SRTCP index field
+        pcc->srtcpAuthenticate(buffer, length, encIndex, buffer + length + sizeof(uint32_t));
+    }
 
     encIndex++;
     encIndex &= ~0x80000000;                                // clear the E-flag and modulo 2^31
     pcc->setSrtcpIndex(encIndex);
-    *newLength = length + pcc->getTagLength() + sizeof(uint32_t);
+    if (encIndex == 0)
+        pcc->getCounters()->countRocRollover();
+    pcc->getCounters()->countPacket(length);
+    *newLength = length + tagLength + sizeof(uint32_t);
 
     return true;
 }
@@ -232,42 +1141,320 @@ int32_t SrtpHandler::unprotectCtrl(CryptoContextCtrl* pcc, uint8_t* buffer, size
     if (pcc == NULL) {
         return 0;
     }
+    SrtpLatencyProbe probe(ZrtpMetrics::UnprotectLatency);
+    int32_t result = unprotectRtcp(pcc, pcc->getTagLength() + pcc->getMkiLength() + sizeof(uint32_t), buffer, length,
+                                   newLength);
+    probe.finish(pcc->getCounters()->getSuite());
+    return result;
+}
 
-    // Compute the total length of the payload
-    int32_t payloadLen = length - (pcc->getTagLength() + pcc->getMkiLength() + 4);
+int32_t SrtpHandler::unprotectRtcp(CryptoContextCtrl* pcc, int32_t srtcpLength, uint8_t* buffer, size_t length, size_t* newLength)
+{
+    // Compute the total length of the payload, the caller computed srtcpLength
+    // as tag length plus MKI length plus SRTCP index length
+    int32_t payloadLen = length - srtcpLength;
+    if (payloadLen < 8) {
+        pcc->getCounters()->countDecodeError();
+        return 0;
+    }
     *newLength = payloadLen;
 
-    // point to the SRTCP index field just after the real payload
-    const uint32_t* index = reinterpret_cast<uint32_t*>(buffer + payloadLen);
+    // point to the SRTCP index field just after the real payload, AEAD
+    // stores the tag first, then the index
+    const uint8_t* index = buffer + payloadLen + (pcc->isAead() ? pcc->getTagLength() : 0);
 
-    uint32_t encIndex = zrtpNtohl(*index);
+    uint32_t encIndex = zrtpLoadBe32(index);
     uint32_t remoteIndex = encIndex & ~0x80000000;    // get index without Encryption flag
 
     if (!pcc->checkReplay(remoteIndex)) {
-       return -2;
+        pcc->getCounters()->countReplayDrop();
+        ZRTP_PROBE2(srtcp_replay_fail, pcc->getSsrc(), remoteIndex);
+        return -2;
     }
 
-    uint8_t mac[20];
+    uint32_t ssrc = zrtpRtcpSsrc(buffer);                       // always SSRC of sender
 
+    if (pcc->isAead()) {
+        if (!pcc->srtcpAeadDecrypt(buffer, payloadLen, encIndex, ssrc, buffer + payloadLen)) {
+            pcc->getCounters()->countAuthFailure();
+            ZRTP_PROBE2(srtcp_auth_fail, ssrc, remoteIndex);
+            return -1;
+        }
+        pcc->update(remoteIndex);
+        pcc->getCounters()->countPacket(payloadLen);
+        return 1;
+    }
     // Now get a pointer to the authentication tag field
     const uint8_t* tag = buffer + (length - pcc->getTagLength());
 
     // Authenticate includes the index, but not MKI and not (obviously) the tag itself
-    pcc->srtcpAuthenticate(buffer, payloadLen, encIndex, mac);
-    if (memcmp(tag, mac, pcc->getTagLength()) != 0) {
+    if (!pcc->srtcpVerifyTag(buffer, payloadLen, encIndex, tag)) {
+        pcc->getCounters()->countAuthFailure();
+        ZRTP_PROBE2(srtcp_auth_fail, ssrc, remoteIndex);
         return -1;
     }
 
-    uint32_t ssrc = *(reinterpret_cast<uint32_t*>(buffer + 4)); // always SSRC of sender
-    ssrc = zrtpNtohl(ssrc);
-
     // Decrypt the content, exclude the very first SRTCP header (fixed, 8 bytes)
     if (encIndex & 0x80000000)
         pcc->srtcpEncrypt(buffer + 8, payloadLen - 8, remoteIndex, ssrc);
 
     // Update the Crypto-context
     pcc->update(remoteIndex);
+    pcc->getCounters()->countPacket(payloadLen);
 
     return 1;
 }
 
+
+int32_t SrtpHandler::protectCtrlBatch(CryptoContextCtrl* pcc, PacketSpan packets[], int32_t count)
+{
+    int32_t done = 0;
+
+    if (pcc == NULL) {
+        for (int32_t i = 0; i < count; i++)
+            packets[i].result = 0;
+        return 0;
+    }
+    const int32_t tagLength = pcc->getTagLength();
+
+    for (int32_t i = 0; i < count; i++) {
+        PacketSpan* pkt = &packets[i];
+
+        pkt->result = protectRtcp(pcc, tagLength, pkt->buffer, pkt->length, &pkt->newLength) ? 1 : 0;
+        done += pkt->result;
+    }
+    return done;
+}
+
+int32_t SrtpHandler::unprotectCtrlBatch(CryptoContextCtrl* pcc, PacketSpan packets[], int32_t count)
+{
+    int32_t done = 0;
+
+    if (pcc == NULL) {
+        for (int32_t i = 0; i < count; i++)
+            packets[i].result = 0;
+        return 0;
+    }
+    const int32_t srtcpLength = pcc->getTagLength() + pcc->getMkiLength() + sizeof(uint32_t);
+
+    for (int32_t i = 0; i < count; i++) {
+        PacketSpan* pkt = &packets[i];
+
+        pkt->result = unprotectRtcp(pcc, srtcpLength, pkt->buffer, pkt->length, &pkt->newLength);
+        if (pkt->result == 1)
+            done++;
+    }
+    return done;
+}
+
+/* Number of segments that the segment functions convert to fragments on the stack */
+#define SRTP_SEGMENTS_ON_STACK  16
+
+/*
+ * Get the fragments of a segmented packet to use the fragment functions.
+ */
+static const SrtpIoVec* segmentFragments(const SegmentedPacket* pkt, SrtpIoVec local[], std::vector<SrtpIoVec>& more)
+{
+    SrtpIoVec* fragments = local;
+
+    if (pkt->count > SRTP_SEGMENTS_ON_STACK) {
+        more.resize(pkt->count);
+        fragments = more.data();
+    }
+    for (int32_t i = 0; i < pkt->count; i++) {
+        fragments[i].data = pkt->segments[i].data;
+        fragments[i].length = pkt->segments[i].length;
+    }
+    return fragments;
+}
+
+/*
+ * Reduce the segments to the first length bytes, the removed bytes become tailroom of their segment.
+ */
+static void trimSegments(SrtpSegment segments[], int32_t count, size_t length)
+{
+    for (int32_t i = 0; i < count; i++) {
+        if (length >= segments[i].length) {
+            length -= segments[i].length;
+            continue;
+        }
+        segments[i].tailroom += segments[i].length - length;
+        segments[i].length = length;
+        length = 0;
+    }
+}
+
+int32_t SrtpHandler::protectSegments(CryptoContext* pcc, SegmentedPacket packets[], int32_t count)
+{
+    int32_t done = 0;
+
+    if (pcc == NULL) {
+        for (int32_t i = 0; i < count; i++)
+            packets[i].result = 0;
+        return 0;
+    }
+    const int32_t tagLength = pcc->getTagLength();
+
+    for (int32_t i = 0; i < count; i++) {
+        SegmentedPacket* pkt = &packets[i];
+
+        pkt->result = 0;
+        if (pkt->count <= 0 || pkt->segments[pkt->count - 1].tailroom < (size_t)tagLength)
+            continue;
+        SrtpSegment* last = &pkt->segments[pkt->count - 1];
+
+        if (pkt->count == 1) {
+            if (!protectRtp(pcc, tagLength, last->data, last->length, &pkt->newLength))
+                continue;
+        }
+        else {
+            SrtpIoVec local[SRTP_SEGMENTS_ON_STACK];
+            std::vector<SrtpIoVec> more;
+            const SrtpIoVec* fragments = segmentFragments(pkt, local, more);
+
+            // The tag goes directly behind the data of the last segment
+            if (!protectv(pcc, fragments, pkt->count, last->data + last->length))
+                continue;
+            pkt->newLength = fragmentsLength(fragments, pkt->count) + tagLength;
+        }
+        last->length += tagLength;
+        last->tailroom -= tagLength;
+        pkt->result = 1;
+        done++;
+    }
+    return done;
+}
+
+int32_t SrtpHandler::unprotectSegments(CryptoContext* pcc, SegmentedPacket packets[], int32_t count)
+{
+    int32_t done = 0;
+
+    if (pcc == NULL) {
+        for (int32_t i = 0; i < count; i++)
+            packets[i].result = 0;
+        return 0;
+    }
+    const int32_t srtpLength = pcc->getTagLength() + pcc->getMkiLength();
+
+    for (int32_t i = 0; i < count; i++) {
+        SegmentedPacket* pkt = &packets[i];
+
+        pkt->result = 0;
+        if (pkt->count <= 0)
+            continue;
+
+        if (pkt->count == 1) {
+            pkt->result = unprotectRtp(pcc, srtpLength, pkt->segments[0].data, pkt->segments[0].length,
+                                       &pkt->newLength, NULL);
+        }
+        else {
+            SrtpIoVec local[SRTP_SEGMENTS_ON_STACK];
+            std::vector<SrtpIoVec> more;
+            const SrtpIoVec* fragments = segmentFragments(pkt, local, more);
+
+            pkt->result = unprotectv(pcc, fragments, pkt->count, &pkt->newLength, NULL);
+        }
+        if (pkt->result == 1) {
+            trimSegments(pkt->segments, pkt->count, pkt->newLength);
+            done++;
+        }
+    }
+    return done;
+}
+
+int32_t SrtpHandler::protectCtrlSegments(CryptoContextCtrl* pcc, SegmentedPacket packets[], int32_t count)
+{
+    int32_t done = 0;
+
+    if (pcc == NULL) {
+        for (int32_t i = 0; i < count; i++)
+            packets[i].result = 0;
+        return 0;
+    }
+    const int32_t tagLength = pcc->getTagLength();
+    const size_t trailerLength = tagLength + sizeof(uint32_t);
+
+    for (int32_t i = 0; i < count; i++) {
+        SegmentedPacket* pkt = &packets[i];
+
+        pkt->result = 0;
+        if (pkt->count <= 0 || pkt->segments[pkt->count - 1].tailroom < trailerLength)
+            continue;
+        SrtpSegment* last = &pkt->segments[pkt->count - 1];
+
+        if (pkt->count == 1) {
+            if (!protectRtcp(pcc, tagLength, last->data, last->length, &pkt->newLength))
+                continue;
+        }
+        else {
+            SrtpIoVec local[SRTP_SEGMENTS_ON_STACK];
+            std::vector<SrtpIoVec> more;
+            const SrtpIoVec* fragments = segmentFragments(pkt, local, more);
+            size_t length = fragmentsLength(fragments, pkt->count);
+
+            uint8_t localBuffer[SRTP_IOV_BUFFER_SIZE];
+            uint8_t* work = (length + trailerLength <= sizeof(localBuffer)) ? localBuffer : new uint8_t[length + trailerLength];
+
+            processFragments(fragments, pkt->count, 0, length, work, CopyFromFragments);
+            bool protectedRtcp = protectRtcp(pcc, tagLength, work, length, &pkt->newLength);
+            if (protectedRtcp) {
+                processFragments(fragments, pkt->count, 0, length, work, CopyToFragments);
+                memcpy(last->data + last->length, work + length, trailerLength);
+            }
+            if (work != localBuffer)
+                delete [] work;
+            if (!protectedRtcp)
+                continue;
+        }
+        last->length += trailerLength;
+        last->tailroom -= trailerLength;
+        pkt->result = 1;
+        done++;
+    }
+    return done;
+}
+
+int32_t SrtpHandler::unprotectCtrlSegments(CryptoContextCtrl* pcc, SegmentedPacket packets[], int32_t count)
+{
+    int32_t done = 0;
+
+    if (pcc == NULL) {
+        for (int32_t i = 0; i < count; i++)
+            packets[i].result = 0;
+        return 0;
+    }
+    const int32_t srtcpLength = pcc->getTagLength() + pcc->getMkiLength() + sizeof(uint32_t);
+
+    for (int32_t i = 0; i < count; i++) {
+        SegmentedPacket* pkt = &packets[i];
+
+        pkt->result = 0;
+        if (pkt->count <= 0)
+            continue;
+
+        if (pkt->count == 1) {
+            pkt->result = unprotectRtcp(pcc, srtcpLength, pkt->segments[0].data, pkt->segments[0].length, &pkt->newLength);
+        }
+        else {
+            SrtpIoVec local[SRTP_SEGMENTS_ON_STACK];
+            std::vector<SrtpIoVec> more;
+            const SrtpIoVec* fragments = segmentFragments(pkt, local, more);
+            size_t length = fragmentsLength(fragments, pkt->count);
+
+            uint8_t localBuffer[SRTP_IOV_BUFFER_SIZE];
+            uint8_t* work = (length <= sizeof(localBuffer)) ? localBuffer : new uint8_t[length];
+
+            processFragments(fragments, pkt->count, 0, length, work, CopyFromFragments);
+            pkt->result = unprotectRtcp(pcc, srtcpLength, work, length, &pkt->newLength);
+            if (pkt->result == 1)
+                processFragments(fragments, pkt->count, 0, pkt->newLength, work, CopyToFragments);
+            if (work != localBuffer)
+                delete [] work;
+        }
+        if (pkt->result == 1) {
+            trimSegments(pkt->segments, pkt->count, pkt->newLength);
+            done++;
+        }
+    }
+    return done;
+}
@@ -22,6 +22,86 @@
 
 class CryptoContext;
 class CryptoContextCtrl;
+class SrtpSession;
+class SrtpReceiveTable;
+class SrtpLatencyProbe;
+
+/**
+ * @brief Describes one packet for the SrtpHandler batch functions.
+ *
+ * The caller sets @c buffer and @c length, the batch functions set @c newLength
+ * and @c result of each packet. The @c result uses the same values as the
+ * return codes of the related single packet function.
+ */
+typedef struct _PacketSpan {
+    uint8_t* buffer;            //!< the RTP/SRTP packet data
+    size_t   length;            //!< length of the packet data in bytes
+    size_t   newLength;         //!< length of the resulting packet data in bytes
+    int32_t  result;            //!< result code of the packet
+} PacketSpan;
+
+/**
+ * @brief Describes one fragment of a packet for the scatter/gather functions.
+ *
+ * The structure has the same layout as the POSIX @c struct @c iovec, thus an
+ * application can pass the fragments to @c sendmsg or @c writev.
+ */
+typedef struct _SrtpIoVec {
+    uint8_t* data;              //!< the fragment data
+    size_t   length;            //!< length of the fragment data in bytes
+} SrtpIoVec;
+
+/**
+ * @brief Describes one segment of a packet in NIC memory.
+ *
+ * The structure maps the segments of a DPDK @c rte_mbuf chain or an AF_XDP
+ * frame: @c data points to the first data byte of the segment, the buffer
+ * address plus the headroom, and @c tailroom is the number of free bytes after
+ * the data. SRTP and SRTCP only append data, thus the functions do not need
+ * the headroom.
+ */
+typedef struct _SrtpSegment {
+    uint8_t* data;              //!< the segment data
+    size_t   length;            //!< length of the segment data in bytes
+    size_t   tailroom;          //!< free bytes after the segment data
+} SrtpSegment;
+
+/**
+ * @brief Describes one packet for the SrtpHandler segment functions.
+ *
+ * The caller sets @c segments and @c count, the segment functions set
+ * @c newLength and @c result and update the @c length and @c tailroom of
+ * the segments.
+ */
+typedef struct _SegmentedPacket {
+    SrtpSegment* segments;      //!< the segments of the packet, in packet order
+    int32_t  count;             //!< number of segments
+    size_t   newLength;         //!< length of the resulting packet data in bytes
+    int32_t  result;            //!< result code of the packet
+} SegmentedPacket;
+
+/**
+ * @brief The parsed RTP header of a packet.
+ *
+ * The @c protect and @c unprotect functions that take a view fill it with the
+ * header fields they parse anyway, thus the application does not need to parse
+ * the header again. The pointers point into the packet buffer. After
+ * @c unprotect the payload is the decrypted payload without padding.
+ */
+typedef struct _RtpHeaderView {
+    uint32_t ssrc;              //!< SSRC in host order
+    uint16_t sequence;          //!< sequence number in host order
+    uint32_t timestamp;         //!< RTP timestamp in host order
+    uint8_t  payloadType;       //!< payload type
+    bool     marker;            //!< the marker bit
+    uint8_t  csrcCount;         //!< number of CSRC identifiers after the fixed header
+    uint8_t* extension;         //!< the header extension including its 4 byte header, @c NULL if none
+    size_t   extensionLength;   //!< length of the header extension in bytes
+    uint8_t* payload;           //!< the payload
+    size_t   payloadLength;     //!< length of the payload in bytes
+    uint64_t index;             //!< SRTP packet index, the guessed index when unprotecting
+    uint32_t roc;               //!< roll-over counter of the packet index
+} RtpHeaderView;
 
 /**
  * @brief SRTP and SRTCP protect and unprotect functions.
@@ -56,6 +136,33 @@ public:
      */
     static bool protect(CryptoContext* pcc, uint8_t* buffer, size_t length, size_t* newLength);
 
+    /**
+     * @brief Protect an RTP packet, out-of-place.
+     *
+     * The function reads the RTP packet from @c input and writes the SRTP packet,
+     * including the authentication tag, to @c output. Thus the application can
+     * protect the packet directly into its send buffer without copying the RTP
+     * packet first. The buffers must not overlap, use protect() above to protect
+     * a packet in place.
+     *
+     * @param pcc the SRTP CryptoContext instance
+     *
+     * @param input the RTP packet to protect, the function does not modify it
+     *
+     * @param length the length of the RTP packet data in bytes
+     *
+     * @param output the buffer for the resulting SRTP packet
+     *
+     * @param outputCapacity the size of the output buffer in bytes, must be at least
+     *                       @c length plus the tag length
+     *
+     * @param newLength the length of the resulting SRTP packet data in bytes
+     *
+     * @return @c true if protection was successful, @c false otherwise
+     */
+    static bool protect(CryptoContext* pcc, const uint8_t* input, size_t length, uint8_t* output, size_t outputCapacity,
+                        size_t* newLength);
+
     /**
      * @brief Unprotect a SRTP packet.
      * 
@@ -81,6 +188,82 @@ public:
      */
     static int32_t unprotect(CryptoContext* pcc, uint8_t* buffer, size_t length, size_t* newLength, SrtpErrorData* errorData=NULL);
 
+    /**
+     * @brief Protect an RTP packet and return its parsed header.
+     *
+     * Same as protect() above, the function also fills @c view with the RTP
+     * header of the packet. The payload in the view is the encrypted payload.
+     *
+     * @param view receives the RTP header fields, only valid if the function
+     *             returns @c true
+     *
+     * @return @c true if protection was successful, @c false otherwise
+     */
+    static bool protect(CryptoContext* pcc, uint8_t* buffer, size_t length, size_t* newLength, RtpHeaderView& view);
+
+    /**
+     * @brief Unprotect a SRTP packet and return its parsed header.
+     *
+     * Same as unprotect() above, the function also fills @c view with the RTP
+     * header of the packet. If the packet failed the authentication or replay
+     * check the view is valid except the payload, which is still encrypted.
+     *
+     * @param view receives the RTP header fields and the guessed index, not
+     *             valid if the function returns 0
+     *
+     * @return an integer value, see unprotect() above
+     */
+    static int32_t unprotect(CryptoContext* pcc, uint8_t* buffer, size_t length, size_t* newLength, RtpHeaderView& view,
+                             SrtpErrorData* errorData=NULL);
+
+    /**
+     * @brief Protect an RTP packet that is stored in several fragments.
+     *
+     * The fragments contain the RTP header, the header extensions and the payload,
+     * the RTP header may span fragments. The function encrypts the payload in the
+     * fragments and computes the MAC over all fragments, thus the application does
+     * not need to assemble the packet. The function stores the authentication tag
+     * in @c tag, the application sends it as the last fragment.
+     *
+     * Counter modes (AES-CM, Twofish-CM) XOR the key stream directly into the
+     * fragments. F8 and AES-GCM modes gather the packet into a temporary buffer.
+     *
+     * @param pcc the SRTP CryptoContext instance
+     *
+     * @param fragments the fragments of the RTP packet
+     *
+     * @param count number of fragments
+     *
+     * @param tag buffer for the authentication tag, must hold the tag length of
+     *            the CryptoContext
+     *
+     * @return @c true if protection was successful, @c false otherwise
+     */
+    static bool protectv(CryptoContext* pcc, const SrtpIoVec fragments[], int32_t count, uint8_t* tag);
+
+    /**
+     * @brief Unprotect a SRTP packet that is stored in several fragments.
+     *
+     * The fragments contain the complete SRTP packet including the MKI and the
+     * authentication tag. The function checks the tag and decrypts the payload in
+     * the fragments. On success the first @c newLength bytes of the fragments
+     * contain the RTP packet.
+     *
+     * @param pcc the SRTP CryptoContext instance
+     *
+     * @param fragments the fragments of the SRTP packet
+     *
+     * @param count number of fragments
+     *
+     * @param newLength the length of the resulting RTP packet data in bytes
+     *
+     * @param errorData Pointer to @c errorData structure or @c NULL, default is @c NULL
+     *
+     * @return an integer value, see unprotect()
+     */
+    static int32_t unprotectv(CryptoContext* pcc, const SrtpIoVec fragments[], int32_t count, size_t* newLength,
+                              SrtpErrorData* errorData=NULL);
+
     /**
      * @brief Protect an RTCP packet.
      *
@@ -115,8 +298,441 @@ public:
      */
     static int32_t unprotectCtrl(CryptoContextCtrl* pcc, uint8_t* buffer, size_t length, size_t* newLength);
 
+    /**
+     * @brief Protect a batch of RTP packets.
+     *
+     * The function protects all packets with the same SRTP CryptoContext. It
+     * checks the CryptoContext and gets the SRTP parameters only once for the
+     * whole batch. Each buffer must be big enough to store the authentication
+     * tag, see protect().
+     *
+     * The function sets the packet's @c result to 1 if protection was successful,
+     * to 0 otherwise.
+     *
+     * @param pcc the SRTP CryptoContext instance
+     *
+     * @param packets array of packet descriptors
+     *
+     * @param count number of packet descriptors in the array
+     *
+     * @return number of successfully protected packets
+     */
+    static int32_t protectBatch(CryptoContext* pcc, PacketSpan packets[], int32_t count);
+
+    /**
+     * @brief Protect a batch of RTP packets of different SRTP contexts.
+     *
+     * Packet @c i uses the CryptoContext @c contexts[i], several packets may
+     * use the same CryptoContext. The function encrypts the payloads of
+     * counter-mode contexts with SrtpSymCrypto::ctrEncryptLanes() and computes
+     * the SHA1 HMAC tags with hmacSha1CtxLanes(), thus hardware AES and the
+     * multi-buffer SHA1 process the short packets of several streams in
+     * parallel. Packets of AEAD contexts and of contexts with a key derivation
+     * rate take the single packet path. The packets of a context must be in
+     * sending order, the function computes the packet index and updates the ROC
+     * in array order.
+     *
+     * The function sets the packet's @c result to 1 if protection was successful,
+     * to 0 otherwise.
+     *
+     * @param contexts array of SRTP CryptoContext instances, one per packet
+     *
+     * @param packets array of packet descriptors
+     *
+     * @param count number of packet descriptors in the array
+     *
+     * @return number of successfully protected packets
+     */
+    static int32_t protectMulti(CryptoContext* contexts[], PacketSpan packets[], int32_t count);
+
+    /**
+     * @brief Unprotect a batch of SRTP packets.
+     *
+     * The function unprotects all packets with the same SRTP CryptoContext and
+     * processes the packets in array order. This is important for the replay
+     * check and index guessing, thus the array should contain the packets in
+     * the order as received.
+     *
+     * The function sets the packet's @c result to the value that unprotect()
+     * would return for this packet.
+     *
+     * @param pcc the SRTP CryptoContext instance
+     *
+     * @param packets array of packet descriptors
+     *
+     * @param count number of packet descriptors in the array
+     *
+     * @return number of successfully unprotected packets
+     */
+    static int32_t unprotectBatch(CryptoContext* pcc, PacketSpan packets[], int32_t count);
+
+    /**
+     * @brief Unprotect a batch of SRTP packets of different SRTP contexts.
+     *
+     * Packet @c i uses the receive context in slot @c slots[i] of the table,
+     * several packets may use the same slot. The function computes the packet
+     * indices and the replay checks of up to 16 packets from the arrays of
+     * the table before it does any cipher work, thus replayed packets cost no
+     * MAC. Then it checks the SHA1 HMAC tags with hmacSha1CtxLanes() and
+     * decrypts the payloads of counter-mode contexts with
+     * SrtpSymCrypto::ctrEncryptLanes(), as protectMulti() does. Packets of
+     * AEAD contexts and of contexts with a key derivation rate take the single
+     * packet path. The function processes the packets of a slot in array
+     * order, thus the array should contain them in the order as received.
+     *
+     * The function sets the packet's @c result to the value that unprotect()
+     * would return for this packet, 0 if the slot has no context.
+     *
+     * @param table the receive table with the SRTP contexts, if @c NULL the
+     *        function sets the results of all packets to 0
+     *
+     * @param slots array of table slots, one per packet
+     *
+     * @param packets array of packet descriptors
+     *
+     * @param count number of packet descriptors in the array
+     *
+     * @return number of successfully unprotected packets
+     */
+    static int32_t unprotectMulti(SrtpReceiveTable* table, const int32_t slots[], PacketSpan packets[], int32_t count);
+
+    /** Maximum number of packets of protectGso(), the Linux limit of segments per send */
+    static const int32_t maxGsoSegments = 64;
+
+    /**
+     * @brief Protect a batch of RTP packets into one buffer for a UDP GSO send.
+     *
+     * With UDP generic segmentation offload (socket option @c UDP_SEGMENT) one
+     * send of a buffer transmits several datagrams. The kernel splits the
+     * buffer at multiples of the segment size, only the last datagram may be
+     * shorter. The function copies the packets to consecutive segments of
+     * @c output and protects them there as protectMulti() does, the input
+     * buffers need no room for the tags and stay unchanged.
+     *
+     * The function stops before the first packet that does not fill a whole
+     * segment after protection, unless the packet is shorter and thus can be
+     * the last datagram. It also stops before a packet that does not decode, that
+     * does not fit into @c output or that has no CryptoContext, and after
+     * @c maxGsoSegments packets. The application sends the remaining packets
+     * with another call.
+     *
+     * The function sets the @c newLength and @c result of the packets in the
+     * buffer, @c result of the other packets is 0.
+     *
+     * @param contexts array of SRTP CryptoContext instances, one per packet
+     *
+     * @param packets array of packet descriptors
+     *
+     * @param count number of packet descriptors in the array
+     *
+     * @param output the buffer for the GSO send, must not overlap the packets
+     *
+     * @param outputCapacity size of the output buffer in bytes
+     *
+     * @param segmentSize the GSO segment size, the length of a SRTP packet
+     *
+     * @param outputLength receives the number of bytes to send
+     *
+     * @return number of protected packets, the first packets of the array
+     */
+    static int32_t protectGso(CryptoContext* contexts[], PacketSpan packets[], int32_t count, uint8_t* output,
+                              size_t outputCapacity, size_t segmentSize, size_t* outputLength);
+
+    /**
+     * @brief Split a buffer of coalesced datagrams into packet descriptors.
+     *
+     * UDP generic receive offload (socket option @c UDP_GRO) delivers several
+     * datagrams of a flow in one buffer, the control message @c UDP_GRO
+     * contains the segment size. All datagrams have the segment size, only the
+     * last datagram may be shorter. The descriptors point into the buffer, use
+     * unprotectMulti() if the datagrams belong to several SRTP contexts.
+     *
+     * @param buffer the received buffer
+     *
+     * @param length number of received bytes
+     *
+     * @param segmentSize the segment size of the datagrams
+     *
+     * @param packets receives the packet descriptors
+     *
+     * @param maxPackets number of packet descriptors in the array
+     *
+     * @return number of datagrams stored in @c packets
+     */
+    static int32_t splitGro(uint8_t* buffer, size_t length, size_t segmentSize, PacketSpan packets[], int32_t maxPackets);
+
+    /**
+     * @brief Unprotect the coalesced datagrams of a UDP GRO receive buffer.
+     *
+     * The function splits the buffer with splitGro() and unprotects the
+     * datagrams in place as unprotectBatch() does. The unprotected packets
+     * stay at their segments in the buffer, @c newLength of a descriptor is
+     * the length of the RTP packet.
+     *
+     * @param pcc the SRTP CryptoContext instance
+     *
+     * @param buffer the received buffer
+     *
+     * @param length number of received bytes
+     *
+     * @param segmentSize the segment size of the datagrams
+     *
+     * @param packets receives the packet descriptors and their results
+     *
+     * @param maxPackets number of packet descriptors in the array
+     *
+     * @param segments receives the number of datagrams stored in @c packets
+     *
+     * @return number of successfully unprotected packets
+     */
+    static int32_t unprotectGro(CryptoContext* pcc, uint8_t* buffer, size_t length, size_t segmentSize,
+                                PacketSpan packets[], int32_t maxPackets, int32_t* segments);
+
+    /**
+     * @brief Protect an RTP packet with two SRTP layers.
+     *
+     * The function produces the same packet as @c protect with the inner
+     * CryptoContext followed by @c protect with the outer CryptoContext. It
+     * decodes the RTP header once and runs the second layer while the packet
+     * data is still in the cache. The buffer must be big enough to store both
+     * authentication tags.
+     *
+     * @param inner the SRTP CryptoContext of the first layer, for example SDES
+     *
+     * @param outer the SRTP CryptoContext of the second layer, for example ZRTP
+     *
+     * @param buffer contains the RTP packet, the function stores the result in place
+     *
+     * @param length length of the RTP packet
+     *
+     * @param newLength the new length of the packet including both tags
+     *
+     * @return @c true if the packet was protected
+     */
+    static bool protectTwice(CryptoContext* inner, CryptoContext* outer, uint8_t* buffer, size_t length, size_t* newLength);
+
+    /**
+     * @brief Unprotect an SRTP packet with two SRTP layers.
+     *
+     * The reverse of @c protectTwice: the function unprotects with the outer
+     * CryptoContext first and then with the inner CryptoContext.
+     *
+     * @param outer the SRTP CryptoContext of the outer layer
+     *
+     * @param inner the SRTP CryptoContext of the inner layer
+     *
+     * @param buffer contains the SRTP packet, the function stores the result in place
+     *
+     * @param length length of the SRTP packet
+     *
+     * @param newLength the new length of the packet excluding the SRTP data
+     *
+     * @param outerDone set to @c true if the outer layer was unprotected. If
+     *                  it is @c false the packet data is as after a failed
+     *                  @c unprotect, the caller may try another context.
+     *
+     * @param errorData Pointer to @c errorData structure or @c NULL, default is @c NULL
+     *
+     * @return the same values as @c unprotect, of the layer that failed or 1
+     */
+    static int32_t unprotectTwice(CryptoContext* outer, CryptoContext* inner, uint8_t* buffer, size_t length,
+                                  size_t* newLength, bool* outerDone, SrtpErrorData* errorData=NULL);
+
+    /**
+     * @brief Protect an RTP packet using the SRTP session of the packet's SSRC.
+     *
+     * The function gets the packet's SSRC and looks up the SRTP CryptoContext
+     * in the session. If the session has no CryptoContext for this SSRC it
+     * creates one.
+     *
+     * @param session the SRTP session
+     *
+     * @param buffer the RTP packet to protect
+     *
+     * @param length the length of the RTP packet data in bytes
+     *
+     * @param newLength the length of the resulting SRTP packet data in bytes
+     *
+     * @return @c true if protection was successful, @c false otherwise
+     */
+    static bool protect(SrtpSession* session, uint8_t* buffer, size_t length, size_t* newLength);
+
+    /**
+     * @brief Unprotect a SRTP packet using the SRTP session of the packet's SSRC.
+     *
+     * The function gets the packet's SSRC and looks up the SRTP CryptoContext
+     * in the session. If the session has no CryptoContext for this SSRC it
+     * creates one. If the first packet of a new SSRC fails the checks then the
+     * function removes the new CryptoContext again, thus forged packets with
+     * random SSRCs do not fill the session.
+     *
+     * @param session the SRTP session
+     *
+     * @param buffer the SRTP packet to unprotect
+     *
+     * @param length the length of the SRTP packet data in bytes
+     *
+     * @param newLength the length of the resulting RTP packet data in bytes
+     *
+     * @param errorData Pointer to @c errorData structure or @c NULL, default is @c NULL
+     *
+     * @return an integer value, see unprotect() above
+     */
+    static int32_t unprotect(SrtpSession* session, uint8_t* buffer, size_t length, size_t* newLength, SrtpErrorData* errorData=NULL);
+
+    /**
+     * @brief Protect a batch of RTCP packets.
+     *
+     * The function protects all packets, for example the packets of a compound
+     * RTCP packet, with the same SRTCP CryptoContextCtrl. It checks the
+     * CryptoContextCtrl and gets the SRTCP parameters only once for the whole
+     * batch. Each packet gets its own SRTCP index. Each buffer must be big enough
+     * to store the SRTCP index and the authentication tag, see protectCtrl().
+     *
+     * The function sets the packet's @c result to 1 if protection was successful,
+     * to 0 otherwise.
+     *
+     * @param pcc the SRTCP CryptoContextCtrl instance
+     *
+     * @param packets array of packet descriptors
+     *
+     * @param count number of packet descriptors in the array
+     *
+     * @return number of successfully protected packets
+     */
+    static int32_t protectCtrlBatch(CryptoContextCtrl* pcc, PacketSpan packets[], int32_t count);
+
+    /**
+     * @brief Unprotect a batch of SRTCP packets.
+     *
+     * The function unprotects all packets with the same SRTCP CryptoContextCtrl
+     * and processes the packets in array order.
+     *
+     * The function sets the packet's @c result to the value that unprotectCtrl()
+     * would return for this packet.
+     *
+     * @param pcc the SRTCP CryptoContextCtrl instance
+     *
+     * @param packets array of packet descriptors
+     *
+     * @param count number of packet descriptors in the array
+     *
+     * @return number of successfully unprotected packets
+     */
+    static int32_t unprotectCtrlBatch(CryptoContextCtrl* pcc, PacketSpan packets[], int32_t count);
+
+    /**
+     * @brief Protect a batch of RTP packets in NIC buffer segments.
+     *
+     * The function works in place on the segments, the application does not
+     * need to linearize a segmented packet. It stores the authentication tag in
+     * the tailroom of the last segment and adds the tag length to the length of
+     * the last segment. A packet fails if the tailroom of its last segment is
+     * smaller than the tag. Single segment packets take the same path as
+     * protectBatch(), for segmented packets refer to protectv().
+     *
+     * The function sets the packet's @c result to 1 if protection was successful,
+     * to 0 otherwise.
+     *
+     * @param pcc the SRTP CryptoContext instance
+     *
+     * @param packets array of packet descriptors
+     *
+     * @param count number of packet descriptors in the array
+     *
+     * @return number of successfully protected packets
+     */
+    static int32_t protectSegments(CryptoContext* pcc, SegmentedPacket packets[], int32_t count);
+
+    /**
+     * @brief Unprotect a batch of SRTP packets in NIC buffer segments.
+     *
+     * The function works in place on the segments and processes the packets in
+     * array order. It removes the MKI and the authentication tag from the end of
+     * the packet, it reduces the length and increases the tailroom of the
+     * segments that contained these bytes.
+     *
+     * The function sets the packet's @c result to the value that unprotect()
+     * would return for this packet.
+     *
+     * @param pcc the SRTP CryptoContext instance
+     *
+     * @param packets array of packet descriptors
+     *
+     * @param count number of packet descriptors in the array
+     *
+     * @return number of successfully unprotected packets
+     */
+    static int32_t unprotectSegments(CryptoContext* pcc, SegmentedPacket packets[], int32_t count);
+
+    /**
+     * @brief Protect a batch of RTCP packets in NIC buffer segments.
+     *
+     * The function stores the SRTCP index and the authentication tag in the
+     * tailroom of the last segment, a packet fails if the tailroom is too small.
+     * Single segment packets are processed in place. RTCP packets are small and
+     * rarely segmented, thus the function copies a segmented packet to a
+     * temporary buffer.
+     *
+     * The function sets the packet's @c result to 1 if protection was successful,
+     * to 0 otherwise.
+     *
+     * @param pcc the SRTCP CryptoContextCtrl instance
+     *
+     * @param packets array of packet descriptors
+     *
+     * @param count number of packet descriptors in the array
+     *
+     * @return number of successfully protected packets
+     */
+    static int32_t protectCtrlSegments(CryptoContextCtrl* pcc, SegmentedPacket packets[], int32_t count);
+
+    /**
+     * @brief Unprotect a batch of SRTCP packets in NIC buffer segments.
+     *
+     * The function removes the SRTCP index, the MKI and the authentication tag
+     * from the end of the packet, see unprotectSegments(). It copies a
+     * segmented packet to a temporary buffer, see protectCtrlSegments().
+     *
+     * The function sets the packet's @c result to the value that unprotectCtrl()
+     * would return for this packet.
+     *
+     * @param pcc the SRTCP CryptoContextCtrl instance
+     *
+     * @param packets array of packet descriptors
+     *
+     * @param count number of packet descriptors in the array
+     *
+     * @return number of successfully unprotected packets
+     */
+    static int32_t unprotectCtrlSegments(CryptoContextCtrl* pcc, SegmentedPacket packets[], int32_t count);
+
 private:
+    static bool protectRtp(CryptoContext* pcc, int32_t tagLength, uint8_t* buffer, size_t length, size_t* newLength,
+                           SrtpLatencyProbe* probe=NULL);
+
+    static void protectPayload(CryptoContext* pcc, int32_t tagLength, uint8_t* buffer, size_t length, uint8_t* payload,
+                               int32_t payloadlen, uint16_t seqnum, uint32_t ssrc, size_t* newLength);
+
+    static int32_t unprotectPayload(CryptoContext* pcc, int32_t srtpLength, uint8_t* buffer, size_t length, uint8_t* payload,
+                                    int32_t payloadlen, uint16_t seqnum, uint32_t ssrc, size_t* newLength,
+                                    SrtpErrorData* errorData, uint64_t* packetIndex=NULL, SrtpLatencyProbe* probe=NULL);
+
+    static int32_t unprotectRtp(CryptoContext* pcc, int32_t srtpLength, uint8_t* buffer, size_t length, size_t* newLength,
+                                SrtpErrorData* errorData, SrtpLatencyProbe* probe=NULL);
+
+    static bool getSsrc(const uint8_t* buffer, size_t length, uint32_t* ssrc);
+
+    static bool protectRtcp(CryptoContextCtrl* pcc, int32_t tagLength, uint8_t* buffer, size_t length, size_t* newLength);
+
+    static int32_t unprotectRtcp(CryptoContextCtrl* pcc, int32_t srtcpLength, uint8_t* buffer, size_t length, size_t* newLength);
+
+    static bool decodeRtpv(const SrtpIoVec fragments[], int32_t count, size_t length, uint32_t *ssrc, uint16_t *seq,
+                           uint8_t* header, size_t* headerLength);
+
     static bool decodeRtp(uint8_t* buffer, int32_t length, uint32_t *ssrc, uint16_t *seq, uint8_t** payload, int32_t *payloadlen);
 
+    static bool decodeRtpView(uint8_t* buffer, size_t length, RtpHeaderView* view);
+
 };
 #endif // _SRTPHANDLER_H_
\ No newline at end of file
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <cstring>
+#include <new>
+#include <mutex>
+
+#include "srtp/SrtpMemoryPool.h"
+#include <common/ZrtpAllocator.h>
+
+#define SRTP_POOL_CLASSES   (SRTP_POOL_MAX_BLOCK / SRTP_POOL_GRANULARITY)
+
+/*
+ * A free block stores the pointer to the next free block of its size class
+ * in its first bytes.
+ */
+typedef struct _FreeBlock {
+    struct _FreeBlock* next;
+} FreeBlock;
+
+static std::mutex poolLock;
+static FreeBlock* freeLists[SRTP_POOL_CLASSES];
+static int32_t freeCounts[SRTP_POOL_CLASSES];
+static int32_t cacheLimit = 0;
+
+// see CryptoContext.cpp, the compiler must not optimize the clearing away
+static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
+
+// The blocks come from the allocator of the library, the free lists only cache them
+static inline void* blockNew(size_t size) { return zrtpNew(size); }
+static inline void blockDelete(void* ptr, size_t size) { zrtpFree(ptr, size); }
+
+static inline size_t sizeClass(size_t size)
+{
+    return (size + SRTP_POOL_GRANULARITY - 1) / SRTP_POOL_GRANULARITY - 1;
+}
+
+void SrtpMemoryPool::setCacheLimit(int32_t maxBlocks)
+{
+    std::lock_guard<std::mutex> guard(poolLock);
+
+    cacheLimit = maxBlocks < 0 ? 0 : maxBlocks;
+    for (int32_t i = 0; i < SRTP_POOL_CLASSES; i++) {
+        while (freeCounts[i] > cacheLimit) {
+            FreeBlock* block = freeLists[i];
+            freeLists[i] = block->next;
+            freeCounts[i]--;
+            blockDelete(block, (i + 1) * SRTP_POOL_GRANULARITY);
+        }
+    }
+}
+
+void SrtpMemoryPool::preallocate(size_t size, int32_t count)
+{
+    if (size == 0 || size > SRTP_POOL_MAX_BLOCK)
+        return;
+
+    size_t index = sizeClass(size);
+    size_t blockSize = (index + 1) * SRTP_POOL_GRANULARITY;
+
+    for (int32_t n = 0; n < count; n++) {
+        std::lock_guard<std::mutex> guard(poolLock);
+        if (freeCounts[index] >= cacheLimit)
+            return;
+
+        FreeBlock* block = static_cast<FreeBlock*>(blockNew(blockSize));
+        memset(block, 0, blockSize);
+        block->next = freeLists[index];
+        freeLists[index] = block;
+        freeCounts[index]++;
+    }
+}
+
+void* SrtpMemoryPool::allocate(size_t size)
+{
+    if (size == 0 || size > SRTP_POOL_MAX_BLOCK)
+        return blockNew(size);
+
+    // Always allocate the full block size, thus all blocks of a size class
+    // are interchangeable
+    size_t index = sizeClass(size);
+    {
+        std::lock_guard<std::mutex> guard(poolLock);
+        FreeBlock* block = freeLists[index];
+        if (block != NULL) {
+            freeLists[index] = block->next;
+            freeCounts[index]--;
+            block->next = NULL;
+            return block;
+        }
+    }
+    return blockNew((index + 1) * SRTP_POOL_GRANULARITY);
+}
+
+void SrtpMemoryPool::release(void* ptr, size_t size)
+{
+    if (ptr == NULL)
+        return;
+
+    memset_volatile(ptr, 0, size);
+
+    if (size == 0 || size > SRTP_POOL_MAX_BLOCK) {
+        blockDelete(ptr, size);
+        return;
+    }
+    size_t index = sizeClass(size);
+    {
+        std::lock_guard<std::mutex> guard(poolLock);
+        if (freeCounts[index] < cacheLimit) {
+            FreeBlock* block = static_cast<FreeBlock*>(ptr);
+            block->next = freeLists[index];
+            freeLists[index] = block;
+            freeCounts[index]++;
+            return;
+        }
+    }
+    blockDelete(ptr, (index + 1) * SRTP_POOL_GRANULARITY);
+}
+
+int32_t SrtpMemoryPool::getCachedBlocks()
+{
+    std::lock_guard<std::mutex> guard(poolLock);
+
+    int32_t blocks = 0;
+    for (int32_t i = 0; i < SRTP_POOL_CLASSES; i++)
+        blocks += freeCounts[i];
+    return blocks;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SRTPMEMORYPOOL_H_
+#define _SRTPMEMORYPOOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Block size granularity of the SRTP memory pool in bytes.
+ */
+#define SRTP_POOL_GRANULARITY   64
+
+/**
+ * @brief Largest block size in bytes that the SRTP memory pool caches.
+ */
+#define SRTP_POOL_MAX_BLOCK     8192
+
+/**
+ * @brief Optional memory pool for the SRTP crypto objects.
+ *
+ * Each call setup creates and each call tear down deletes the SRTP and SRTCP
+ * crypto contexts, their ciphers and the cipher key schedules. CryptoContext,
+ * CryptoContextCtrl and SrtpSymCrypto allocate their objects with this pool
+ * (class specific operator new and delete), the standalone crypto backend also
+ * allocates the AES and Twofish key schedules with it. Thus all users, for
+ * example ZrtpQueue::srtpSecretsReady() or CtZrtpStream::srtpSecretsReady(),
+ * use the pool without any change.
+ *
+ * The pool keeps released blocks in free lists, one list per size class, and
+ * reuses them instead of calling the global allocator. The pool is disabled by
+ * default, setCacheLimit() enables it. The pool always clears a block with
+ * zeros when the block is released, independent of the cache limit, thus no key
+ * material remains in freed or cached memory.
+ *
+ * All functions are thread safe.
+ */
+class SrtpMemoryPool {
+public:
+    /**
+     * @brief Set the maximum number of cached blocks per size class.
+     *
+     * @param maxBlocks
+     *    Maximum number of free blocks of each size class that the pool keeps
+     *    for reuse. Zero disables the pool and frees all cached blocks.
+     */
+    static void setCacheLimit(int32_t maxBlocks);
+
+    /**
+     * @brief Pre-allocate blocks for a size class.
+     *
+     * An application may fill the pool before a burst of call setups. The
+     * pool does not cache more blocks than the cache limit.
+     *
+     * @param size
+     *    Size of the objects, for example <code>sizeof(CryptoContext)</code>.
+     * @param count
+     *    Number of blocks to allocate.
+     */
+    static void preallocate(size_t size, int32_t count);
+
+    /**
+     * @brief Allocate a block.
+     *
+     * @param size
+     *    Size of the block in bytes.
+     * @return
+     *    Pointer to the block, throws @c std::bad_alloc if no memory is available.
+     */
+    static void* allocate(size_t size);
+
+    /**
+     * @brief Clear and release a block.
+     *
+     * @param ptr
+     *    Pointer to the block, may be @c NULL.
+     * @param size
+     *    Size of the block in bytes, the same size as used to allocate it.
+     */
+    static void release(void* ptr, size_t size);
+
+    /**
+     * @brief Get the number of cached blocks of all size classes.
+     *
+     * @return number of cached free blocks.
+     */
+    static int32_t getCachedBlocks();
+};
+
+#endif // _SRTPMEMORYPOOL_H_
@@ -0,0 +1,310 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <cstdint>
+#include <algorithm>
+
+#include "srtp/SrtpPipeline.h"
+#include "srtp/CryptoContext.h"
+#include "srtp/CryptoContextCtrl.h"
+
+/* Number of batches a worker processes of a stream before it serves the other streams */
+static const int32_t batchesPerTurn = 8;
+
+struct SrtpPipeline::Batch {
+    Operation   operation;
+    PacketSpan* packets;
+    int32_t     count;
+    void*       userData;
+};
+
+/*
+ * The stream data. The 'scheduled' flag is true while the stream is in a worker
+ * queue or while a worker processes its batches, thus only one worker at a time
+ * uses the contexts of a stream.
+ */
+class SrtpPipeline::Stream {
+public:
+    Stream(CryptoContext* srtp, CryptoContextCtrl* srtcp): srtp(srtp), srtcp(srtcp), scheduled(false) {}
+
+    CryptoContext* srtp;
+    CryptoContextCtrl* srtcp;
+    std::mutex lock;
+    std::deque<Batch> batches;
+    bool scheduled;
+};
+
+/*
+ * The owner takes streams from the front of the queue, other workers steal from
+ * the back.
+ */
+struct SrtpPipeline::Worker {
+    std::mutex lock;
+    std::deque<Stream*> ready;
+    std::thread thread;
+};
+
+/*
+ * A cell of the completion queue. The sequence number tells if the cell is free
+ * or contains a completion for the current round, refer to D. Vyukov's bounded
+ * MPMC queue.
+ */
+struct SrtpPipeline::Cell {
+    std::atomic<size_t> sequence;
+    SrtpCompletion completion;
+};
+
+SrtpPipeline::SrtpPipeline(int32_t numWorkers, int32_t capacity):
+        readyStreams(0), nextWorker(0), running(true), enqueuePos(0), dequeuePos(0), inFlight(0),
+        capacity(capacity > 0 ? capacity : 1)
+{
+    // The queue size is a power of 2 and holds all batches the pipeline accepts
+    size_t size = 2;
+    while (size < (size_t)this->capacity)
+        size <<= 1;
+    cells = new Cell[size];
+    cellMask = size - 1;
+    for (size_t i = 0; i < size; i++)
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+
+    if (numWorkers <= 0)
+        numWorkers = std::max(1, (int32_t)std::thread::hardware_concurrency());
+    for (int32_t i = 0; i < numWorkers; i++)
+        workers.push_back(new Worker);
+    for (int32_t i = 0; i < numWorkers; i++)
+        workers[i]->thread = std::thread(&SrtpPipeline::run, this, i);
+}
+
+SrtpPipeline::~SrtpPipeline()
+{
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        running = false;
+    }
+    wakeup.notify_all();
+    for (Worker* worker : workers) {
+        worker->thread.join();
+        delete worker;
+    }
+    for (Stream* stream : streams)
+        delete stream;
+    delete [] cells;
+}
+
+SrtpPipeline::Stream* SrtpPipeline::addStream(CryptoContext* srtp, CryptoContextCtrl* srtcp)
+{
+    Stream* stream = new Stream(srtp, srtcp);
+
+    std::lock_guard<std::mutex> guard(streamsLock);
+    streams.push_back(stream);
+    return stream;
+}
+
+void SrtpPipeline::removeStream(Stream* stream)
+{
+    if (stream == NULL)
+        return;
+    {
+        std::unique_lock<std::mutex> wait(idleLock);
+        idle.wait(wait, [stream] {
+            std::lock_guard<std::mutex> guard(stream->lock);
+            return !stream->scheduled;
+        });
+    }
+    {
+        std::lock_guard<std::mutex> guard(streamsLock);
+        streams.erase(std::remove(streams.begin(), streams.end(), stream), streams.end());
+    }
+    delete stream;
+}
+
+bool SrtpPipeline::submit(Stream* stream, Operation operation, PacketSpan packets[], int32_t count, void* userData)
+{
+    if (stream == NULL || packets == NULL || count <= 0)
+        return false;
+
+    if (inFlight.fetch_add(1, std::memory_order_relaxed) >= capacity) {
+        inFlight.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+    Batch batch = {operation, packets, count, userData};
+    bool newStream;
+    {
+        std::lock_guard<std::mutex> guard(stream->lock);
+        stream->batches.push_back(batch);
+        newStream = !stream->scheduled;
+        stream->scheduled = true;
+    }
+    if (newStream)
+        schedule(stream, (int32_t)(nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size()));
+    return true;
+}
+
+int32_t SrtpPipeline::poll(SrtpCompletion completions[], int32_t max)
+{
+    int32_t number = 0;
+
+    while (number < max) {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        Cell* cell = &cells[pos & cellMask];
+        intptr_t diff = (intptr_t)cell->sequence.load(std::memory_order_acquire) - (intptr_t)(pos + 1);
+
+        if (diff < 0)                   // queue is empty
+            break;
+        if (diff > 0)                   // another consumer took the cell, try again
+            continue;
+        if (!dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            continue;
+        completions[number++] = cell->completion;
+        cell->sequence.store(pos + cellMask + 1, std::memory_order_release);
+    }
+    if (number > 0)
+        inFlight.fetch_sub(number, std::memory_order_relaxed);
+    return number;
+}
+
+void SrtpPipeline::complete(const SrtpCompletion& completion)
+{
+    // The capacity check in submit() guarantees a free cell
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+        cell = &cells[pos & cellMask];
+        intptr_t diff = (intptr_t)cell->sequence.load(std::memory_order_acquire) - (intptr_t)pos;
+
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0) {            // a consumer did not yet release the cell
+            std::this_thread::yield();
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+        else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    cell->completion = completion;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+}
+
+void SrtpPipeline::schedule(Stream* stream, int32_t worker)
+{
+    {
+        std::lock_guard<std::mutex> guard(workers[worker]->lock);
+        workers[worker]->ready.push_back(stream);
+    }
+    readyStreams.fetch_add(1);
+    {
+        // Lock to not lose the wakeup of a worker that checks readyStreams right now
+        std::lock_guard<std::mutex> guard(sleepLock);
+    }
+    wakeup.notify_one();
+}
+
+SrtpPipeline::Stream* SrtpPipeline::take(int32_t self)
+{
+    const int32_t numWorkers = (int32_t)workers.size();
+    Stream* stream = NULL;
+
+    for (int32_t i = 0; i < numWorkers && stream == NULL; i++) {
+        Worker* worker = workers[(self + i) % numWorkers];
+        std::lock_guard<std::mutex> guard(worker->lock);
+
+        if (worker->ready.empty())
+            continue;
+        if (i == 0) {
+            stream = worker->ready.front();
+            worker->ready.pop_front();
+        }
+        else {
+            stream = worker->ready.back();
+            worker->ready.pop_back();
+        }
+    }
+    if (stream != NULL)
+        readyStreams.fetch_sub(1);
+    return stream;
+}
+
+/*
+ * Process some batches of a stream. Returns true if the stream has more batches,
+ * the stream is still scheduled in this case.
+ */
+bool SrtpPipeline::process(Stream* stream)
+{
+    bool done = false;
+
+    for (int32_t turn = 0; turn < batchesPerTurn && !done; turn++) {
+        Batch batch;
+        {
+            std::lock_guard<std::mutex> guard(stream->lock);
+            if (stream->batches.empty()) {
+                stream->scheduled = false;      // a submit schedules the stream again
+                done = true;
+                continue;
+            }
+            batch = stream->batches.front();
+            stream->batches.pop_front();
+        }
+        SrtpCompletion completion = {batch.userData, batch.packets, batch.count, 0};
+
+        switch (batch.operation) {
+            case Protect:
+                completion.done = SrtpHandler::protectBatch(stream->srtp, batch.packets, batch.count);
+                break;
+            case Unprotect:
+                completion.done = SrtpHandler::unprotectBatch(stream->srtp, batch.packets, batch.count);
+                break;
+            case ProtectCtrl:
+                completion.done = SrtpHandler::protectCtrlBatch(stream->srtcp, batch.packets, batch.count);
+                break;
+            case UnprotectCtrl:
+                completion.done = SrtpHandler::unprotectCtrlBatch(stream->srtcp, batch.packets, batch.count);
+                break;
+        }
+        complete(completion);
+    }
+    if (!done)
+        return true;
+    {
+        // The stream is idle, removeStream() may delete it now
+        std::lock_guard<std::mutex> guard(idleLock);
+    }
+    idle.notify_all();
+    return false;
+}
+
+void SrtpPipeline::run(int32_t self)
+{
+    for (;;) {
+        Stream* stream = take(self);
+
+        if (stream == NULL) {
+            std::unique_lock<std::mutex> wait(sleepLock);
+            wakeup.wait(wait, [this] { return readyStreams.load() > 0 || !running; });
+            if (!running && readyStreams.load() == 0)
+                return;
+            continue;
+        }
+        if (process(stream))
+            schedule(stream, self);
+    }
+}
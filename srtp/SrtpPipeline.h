@@ -0,0 +1,231 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SRTPPIPELINE_H_
+#define _SRTPPIPELINE_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+#include "srtp/SrtpHandler.h"
+
+class CryptoContext;
+class CryptoContextCtrl;
+
+/**
+ * @brief Describes a processed batch, see SrtpPipeline::poll().
+ */
+typedef struct _SrtpCompletion {
+    void*       userData;       //!< the user data of the batch
+    PacketSpan* packets;        //!< the packet descriptors of the batch, contain the results
+    int32_t     count;          //!< number of packets of the batch
+    int32_t     done;           //!< return value of the SrtpHandler batch function
+} SrtpCompletion;
+
+/**
+ * @brief Protects and unprotects batches of packets on a pool of worker threads.
+ *
+ * The application registers each SRTP/SRTCP stream, submits batches of
+ * packets and polls the completions. A batch uses the batch functions of
+ * SrtpHandler, for example SrtpHandler::protectBatch(). The pipeline
+ * processes the batches of one stream in submit order and on one worker at a
+ * time, thus the ROC, the replay window and the key selection of a context
+ * stay serialized. The batches of different streams run on all workers in
+ * parallel.
+ *
+ * Each worker has a queue of streams with pending batches. A submit puts a
+ * stream that has no pending batches to the queues round robin. A worker takes
+ * the streams of its own queue first and steals streams from the other queues
+ * if its own queue is empty. After some batches a worker puts a busy stream
+ * back to its queue, thus a busy stream does not starve the other streams.
+ *
+ * The workers store the completions in a lock-free queue. If one thread polls
+ * the completions then the completions of a stream are in submit order. The
+ * number of submitted but not yet polled batches is limited to the capacity
+ * of the pipeline.
+ *
+ * While a stream has batches in the pipeline the application must not use
+ * its contexts directly and must not change or delete the packet buffers.
+ *
+ @verbatim
+ SrtpPipeline pipeline(4, 1024);
+ SrtpPipeline::Stream* stream = pipeline.addStream(sendCtx, sendCtrlCtx);
+
+ pipeline.submit(stream, SrtpPipeline::Protect, packets, count, userData);
+ ...
+ SrtpCompletion done[64];
+ int32_t n = pipeline.poll(done, 64);
+ @endverbatim
+ *
+ * @sa SrtpHandler
+ */
+class SrtpPipeline {
+public:
+    /**
+     * The operations of a batch.
+     */
+    typedef enum {
+        Protect,            //!< SrtpHandler::protectBatch() with the SRTP context
+        Unprotect,          //!< SrtpHandler::unprotectBatch() with the SRTP context
+        ProtectCtrl,        //!< SrtpHandler::protectCtrlBatch() with the SRTCP context
+        UnprotectCtrl       //!< SrtpHandler::unprotectCtrlBatch() with the SRTCP context
+    } Operation;
+
+    class Stream;
+
+    /**
+     * @brief Construct a pipeline and start the workers.
+     *
+     * @param workers
+     *    Number of worker threads, zero uses the number of hardware threads.
+     *
+     * @param capacity
+     *    Maximum number of submitted but not yet polled batches.
+     */
+    SrtpPipeline(int32_t workers, int32_t capacity);
+
+    /**
+     * @brief Destructor.
+     *
+     * Processes the pending batches, stops the workers and deletes all streams.
+     * The destructor does not delete the contexts.
+     */
+    ~SrtpPipeline();
+
+    /**
+     * @brief Register a stream.
+     *
+     * @param srtp
+     *    The SRTP CryptoContext of the stream or @c NULL
+     *
+     * @param srtcp
+     *    The SRTCP CryptoContextCtrl of the stream or @c NULL
+     *
+     * @return the stream, the pipeline owns it.
+     */
+    Stream* addStream(CryptoContext* srtp, CryptoContextCtrl* srtcp = NULL);
+
+    /**
+     * @brief Remove and delete a stream.
+     *
+     * The function waits until the workers processed the pending batches of
+     * the stream. The completions of these batches stay in the completion
+     * queue.
+     *
+     * @param stream
+     *    The stream to remove
+     */
+    void removeStream(Stream* stream);
+
+    /**
+     * @brief Submit a batch of packets.
+     *
+     * The packet descriptors must stay valid until the application polled the
+     * completion of the batch.
+     *
+     * @param stream
+     *    The stream of the packets
+     *
+     * @param operation
+     *    The operation to perform on the packets
+     *
+     * @param packets
+     *    Array of packet descriptors, see SrtpHandler::protectBatch()
+     *
+     * @param count
+     *    Number of packet descriptors in the array
+     *
+     * @param userData
+     *    Pointer that the pipeline returns in the completion
+     *
+     * @return @c false if the pipeline reached its capacity, the application
+     *         should poll completions and submit again.
+     */
+    bool submit(Stream* stream, Operation operation, PacketSpan packets[], int32_t count, void* userData);
+
+    /**
+     * @brief Get the completions of processed batches.
+     *
+     * The function does not block. Several threads may poll the same pipeline.
+     *
+     * @param completions
+     *    Array that receives the completions
+     *
+     * @param max
+     *    Size of the array
+     *
+     * @return number of completions stored in the array
+     */
+    int32_t poll(SrtpCompletion completions[], int32_t max);
+
+    /**
+     * @brief Get the number of submitted but not yet polled batches.
+     */
+    int32_t getInFlight() const { return inFlight.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Get the number of worker threads.
+     */
+    int32_t getNumberOfWorkers() const { return static_cast<int32_t>(workers.size()); }
+
+private:
+    struct Batch;
+    struct Worker;
+    struct Cell;
+
+    SrtpPipeline(const SrtpPipeline& other) = delete;
+    SrtpPipeline& operator=(const SrtpPipeline& other) = delete;
+
+    void run(int32_t self);
+
+    Stream* take(int32_t self);
+
+    void schedule(Stream* stream, int32_t worker);
+
+    bool process(Stream* stream);
+
+    void complete(const SrtpCompletion& completion);
+
+    std::vector<Worker*> workers;
+    std::vector<Stream*> streams;
+    std::mutex streamsLock;
+
+    // The workers sleep if no stream has pending batches
+    std::mutex sleepLock;
+    std::condition_variable wakeup;
+    std::atomic<int32_t> readyStreams;
+    std::atomic<uint32_t> nextWorker;
+    bool running;
+
+    // removeStream() waits until a stream is idle
+    std::mutex idleLock;
+    std::condition_variable idle;
+
+    // Bounded multi-producer, multi-consumer completion queue
+    Cell* cells;
+    size_t cellMask;
+    std::atomic<size_t> enqueuePos;
+    std::atomic<size_t> dequeuePos;
+    std::atomic<int32_t> inFlight;
+    int32_t capacity;
+};
+
+#endif
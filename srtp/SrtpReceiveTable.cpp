@@ -0,0 +1,188 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <string.h>
+
+#include "srtp/SrtpReceiveTable.h"
+
+SrtpReceiveTable::SrtpReceiveTable(int32_t cap) : capacity(cap > 0 ? cap : 1)
+{
+    contexts = new CryptoContext*[capacity];
+    roc = new uint32_t[capacity];
+    s_l = new uint16_t[capacity];
+    seqSet = new uint8_t[capacity];
+    checked = new uint8_t[capacity];
+    windowSize = new int32_t[capacity];
+    replayWords = new int32_t[capacity];
+    window = new uint64_t[capacity * windowWords];
+
+    for (int32_t i = 0; i < capacity; i++) {
+        contexts[i] = NULL;
+        roc[i] = 0;
+        s_l[i] = 0;
+        seqSet[i] = 0;
+        checked[i] = 0;
+        windowSize[i] = 0;
+        replayWords[i] = 1;
+    }
+    memset(window, 0, capacity * windowWords * sizeof(uint64_t));
+}
+
+SrtpReceiveTable::~SrtpReceiveTable()
+{
+    delete[] contexts;
+    delete[] roc;
+    delete[] s_l;
+    delete[] seqSet;
+    delete[] checked;
+    delete[] windowSize;
+    delete[] replayWords;
+    delete[] window;
+}
+
+int32_t SrtpReceiveTable::attach(CryptoContext* pcc)
+{
+    if (pcc == NULL || pcc->replayWords > windowWords)
+        return -1;
+
+    for (int32_t slot = 0; slot < capacity; slot++) {
+        if (contexts[slot] != NULL)
+            continue;
+
+        contexts[slot] = pcc;
+        roc[slot] = pcc->roc;
+        s_l[slot] = pcc->s_l;
+        seqSet[slot] = pcc->seqNumSet ? 1 : 0;
+        checked[slot] = (pcc->aalg == SrtpAuthenticationNull && pcc->ealg == SrtpEncryptionNull) ? 0 : 1;
+        windowSize[slot] = pcc->replayWindowSize;
+        replayWords[slot] = pcc->replayWords;
+        memset(&window[slot * windowWords], 0, windowWords * sizeof(uint64_t));
+        memcpy(&window[slot * windowWords], pcc->replayWindow, pcc->replayWords * sizeof(uint64_t));
+        return slot;
+    }
+    return -1;
+}
+
+void SrtpReceiveTable::detach(int32_t slot)
+{
+    if (getContext(slot) == NULL)
+        return;
+    storeState(slot);
+    contexts[slot] = NULL;
+}
+
+void SrtpReceiveTable::storeState(int32_t slot) const
+{
+    CryptoContext* pcc = getContext(slot);
+
+    if (pcc == NULL)
+        return;
+    pcc->roc = roc[slot];
+    pcc->s_l = s_l[slot];
+    pcc->seqNumSet = seqSet[slot] != 0;
+    memcpy(pcc->replayWindow, &window[slot * windowWords], replayWords[slot] * sizeof(uint64_t));
+}
+
+bool SrtpReceiveTable::check(int32_t slot, uint16_t seq, uint64_t* index) const
+{
+    uint16_t last = seqSet[slot] ? s_l[slot] : seq;
+    uint32_t localRoc = roc[slot];
+    uint32_t guessedRoc = localRoc;
+
+    if (last < 32768) {
+        if (seq - last > 32768)
+            guessedRoc = localRoc - 1;
+    }
+    else if (last - 32768 > seq) {
+        guessedRoc = localRoc + 1;
+    }
+    uint64_t guessed = ((uint64_t)guessedRoc) << 16 | seq;
+    *index = guessed;
+
+    if (!checked[slot])
+        return true;
+
+    int64_t delta = guessed - ((((uint64_t)localRoc) << 16) | last);
+    if (delta > 0)
+        return true;
+    if (-delta >= windowSize[slot])
+        return false;
+    uint64_t word = window[slot * windowWords + (guessed / 64) % replayWords[slot]];
+    return ((word >> (guessed % 64)) & 1) == 0;
+}
+
+void SrtpReceiveTable::checkBatch(const int32_t slots[], const uint16_t seqs[], int32_t count, uint64_t indices[],
+                                  uint8_t valid[]) const
+{
+    int64_t delta[maxBatch];
+
+    // The index guess of RFC 3711, Appendix A, with compares instead of branches
+    for (int32_t i = 0; i < count; i++) {
+        int32_t slot = slots[i];
+        int32_t seq = seqs[i];
+        int32_t last = seqSet[slot] ? s_l[slot] : seq;
+        uint32_t localRoc = roc[slot];
+        uint32_t down = (uint32_t)((last < 32768) & (seq - last > 32768));
+        uint32_t up = (uint32_t)((last >= 32768) & (last - 32768 > seq));
+        uint64_t guessed = ((uint64_t)(localRoc - down + up)) << 16 | (uint32_t)seq;
+
+        indices[i] = guessed;
+        delta[i] = guessed - ((((uint64_t)localRoc) << 16) | (uint32_t)last);
+    }
+    for (int32_t i = 0; i < count; i++) {
+        int32_t slot = slots[i];
+        uint64_t word = window[slot * windowWords + (indices[i] / 64) % replayWords[slot]];
+        int32_t seen = (int32_t)((word >> (indices[i] % 64)) & 1);
+
+        valid[i] = (uint8_t)((checked[slot] == 0) | (delta[i] > 0) | ((-delta[i] < windowSize[slot]) & (seen == 0)));
+    }
+}
+
+void SrtpReceiveTable::update(int32_t slot, uint16_t seq, uint64_t index)
+{
+    uint64_t* bits = &window[slot * windowWords];
+    int32_t words = replayWords[slot];
+    uint64_t localIndex = ((uint64_t)roc[slot]) << 16 | s_l[slot];
+    int64_t delta = index - localIndex;
+    uint32_t guessedRoc = (uint32_t)(index >> 16);
+
+    if (delta > 0) {
+        if ((index / 64) - (localIndex / 64) >= (uint64_t)words) {
+            memset(bits, 0, words * sizeof(uint64_t));
+        }
+        else {
+            for (uint64_t w = localIndex / 64 + 1; w <= index / 64; w++)
+                bits[w % words] = 0;
+        }
+    }
+    bits[(index / 64) % words] |= (uint64_t)1UL << (index % 64);
+
+    if (delta > 0 && seq > s_l[slot])
+        s_l[slot] = seq;
+    if (delta < 0)
+        contexts[slot]->getCounters()->countLatePacket();
+    if (guessedRoc > roc[slot]) {
+        roc[slot] = guessedRoc;
+        s_l[slot] = seq;
+        // The F8 IV uses the ROC of the context
+        contexts[slot]->roc = guessedRoc;
+        contexts[slot]->getCounters()->countRocRollover();
+    }
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SRTPRECEIVETABLE_H_
+#define _SRTPRECEIVETABLE_H_
+
+#include <stdint.h>
+
+#include "srtp/CryptoContext.h"
+
+/**
+ * @file SrtpReceiveTable.h
+ * @brief The receive state of many SRTP contexts in contiguous arrays
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+/**
+ * @brief Stores the ROC, the highest sequence number and the replay window of
+ * many SRTP contexts as a structure of arrays.
+ *
+ * SrtpHandler::unprotectMulti() unprotects the packets of many receive
+ * contexts in one call. It computes the packet indices and the replay checks
+ * of a whole batch from the arrays of this table before it does any cipher
+ * work, thus the checks do not load the scattered CryptoContext objects and
+ * the compiler can vectorize them.
+ *
+ * The application attaches each receive context to a slot of the table.
+ * While a context is attached the table owns its receive state, thus the
+ * application unprotects the context's packets only with unprotectMulti()
+ * and calls detach() or storeState() before it uses the context otherwise,
+ * for example unprotect() or exportState(). Only contexts with a replay
+ * window of at most @c REPLAY_WINDOW_SIZE packets fit into the table.
+ *
+ @verbatim
+ SrtpReceiveTable table(256);
+ int32_t slot = table.attach(recvCtx);
+ ...
+ slots[i] = slot;           // the slot of packet i
+ SrtpHandler::unprotectMulti(&table, slots, packets, count);
+ ...
+ table.detach(slot);
+ @endverbatim
+ *
+ * The table is not thread safe.
+ */
+class SrtpReceiveTable {
+public:
+    /**
+     * @brief Construct a table.
+     *
+     * @param capacity
+     *    Maximum number of attached contexts.
+     */
+    explicit SrtpReceiveTable(int32_t capacity);
+
+    /**
+     * @brief Destructor.
+     *
+     * The destructor does not store the state back to the attached contexts
+     * and does not delete them.
+     */
+    ~SrtpReceiveTable();
+
+    /**
+     * @brief Attach a receive context to a free slot.
+     *
+     * Copies the receive state of the context to the slot.
+     *
+     * @param pcc
+     *    The SRTP CryptoContext of a received stream.
+     *
+     * @return
+     *    the slot, -1 if the table is full or the replay window of the context
+     *    is larger than @c REPLAY_WINDOW_SIZE.
+     */
+    int32_t attach(CryptoContext* pcc);
+
+    /**
+     * @brief Store the receive state back to the context and free the slot.
+     *
+     * @param slot
+     *    The slot that attach() returned.
+     */
+    void detach(int32_t slot);
+
+    /**
+     * @brief Store the receive state back to the context, the context stays attached.
+     *
+     * @param slot
+     *    The slot that attach() returned.
+     */
+    void storeState(int32_t slot) const;
+
+    /**
+     * @brief Get the context of a slot.
+     *
+     * @return the context, @c NULL if the slot is free or not valid.
+     */
+    CryptoContext* getContext(int32_t slot) const {
+        return (slot >= 0 && slot < capacity) ? contexts[slot] : NULL;
+    }
+
+    /**
+     * @brief Get the maximum number of attached contexts.
+     */
+    int32_t getCapacity() const { return capacity; }
+
+private:
+    friend class SrtpHandler;
+
+    static const int32_t windowWords = SRTP_INLINE_REPLAY_WORDS;
+    static const int32_t maxBatch = 16;     //!< maximum number of packets for checkBatch()
+
+    /**
+     * Replay check and index guess of a packet with the current state of its
+     * slot, the same as CryptoContext::guessIndex() and checkReplay().
+     */
+    bool check(int32_t slot, uint16_t seq, uint64_t* index) const;
+
+    /**
+     * The same as check() for a batch of packets with the state at the start
+     * of the batch. The loops are free of branches, thus the compiler can
+     * vectorize them. The result of a packet is only valid if no earlier
+     * packet of the batch changed the state of its slot.
+     */
+    void checkBatch(const int32_t slots[], const uint16_t seqs[], int32_t count, uint64_t indices[], uint8_t valid[]) const;
+
+    /**
+     * Initialize the sequence number of a slot on the first packet, as
+     * CryptoContext::guessIndex() does.
+     */
+    void setFirstSequence(int32_t slot, uint16_t seq) {
+        if (!seqSet[slot]) {
+            seqSet[slot] = 1;
+            s_l[slot] = seq;
+        }
+    }
+
+    /**
+     * Update the state of a slot after a valid packet, the same as
+     * CryptoContext::update().
+     */
+    void update(int32_t slot, uint16_t seq, uint64_t index);
+
+    SrtpReceiveTable(const SrtpReceiveTable& other);
+    SrtpReceiveTable& operator=(const SrtpReceiveTable& other);
+
+    int32_t capacity;
+    CryptoContext** contexts;
+
+    // The receive state, each array has one entry per slot
+    uint32_t* roc;
+    uint16_t* s_l;
+    uint8_t*  seqSet;
+    uint8_t*  checked;              //!< 0 if the context uses no security policy and no replay check
+    int32_t*  windowSize;           //!< replay window size in packets
+    int32_t*  replayWords;          //!< used replay window words of the slot
+    uint64_t* window;               //!< @c windowWords replay window words per slot
+};
+
+/**
+ * @}
+ */
+#endif // _SRTPRECEIVETABLE_H_
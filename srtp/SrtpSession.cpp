@@ -0,0 +1,145 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <cstring>
+#include <cstdint>
+
+#include "srtp/SrtpSession.h"
+#include "srtp/CryptoContext.h"
+
+SrtpSession::SrtpSession(CryptoContext* templateCtx, int64_t keyDerivRate):
+    templateCtx(templateCtx), keyDerivRate(keyDerivRate), numSlots(SRTP_SESSION_INITIAL_SLOTS), numContexts(0)
+{
+    slots = new CryptoContext*[numSlots];
+    memset(slots, 0, numSlots * sizeof(CryptoContext*));
+}
+
+SrtpSession::~SrtpSession()
+{
+    for (uint32_t i = 0; i < numSlots; i++) {
+        delete slots[i];
+    }
+    delete [] slots;
+    delete templateCtx;
+}
+
+/*
+ * SSRCs are random values (RFC 3550) but an attacker may choose them. The
+ * multiplicative hash spreads also sequential SSRCs over the table.
+ */
+uint32_t SrtpSession::slotOf(uint32_t ssrc) const
+{
+    return (ssrc * 0x9E3779B1U) & (numSlots - 1);
+}
+
+CryptoContext* SrtpSession::findCryptoContext(uint32_t ssrc) const
+{
+    for (uint32_t i = slotOf(ssrc); slots[i] != NULL; i = (i + 1) & (numSlots - 1)) {
+        if (slots[i]->getSsrc() == ssrc)
+            return slots[i];
+    }
+    return NULL;
+}
+
+CryptoContext* SrtpSession::getCryptoContext(uint32_t ssrc)
+{
+    CryptoContext* pcc = findCryptoContext(ssrc);
+    if (pcc != NULL || templateCtx == NULL)
+        return pcc;
+
+    pcc = templateCtx->newCryptoContextForSSRC(ssrc, 0, keyDerivRate);
+    if (pcc == NULL)
+        return NULL;
+    pcc->deriveSrtpKeys(0);
+    insert(pcc);
+    return pcc;
+}
+
+void SrtpSession::addCryptoContext(CryptoContext* pcc)
+{
+    if (pcc == NULL)
+        return;
+    removeCryptoContext(pcc->getSsrc());
+    insert(pcc);
+}
+
+bool SrtpSession::removeCryptoContext(uint32_t ssrc)
+{
+    const uint32_t mask = numSlots - 1;
+    uint32_t i = slotOf(ssrc);
+
+    for (; slots[i] != NULL; i = (i + 1) & mask) {
+        if (slots[i]->getSsrc() == ssrc)
+            break;
+    }
+    if (slots[i] == NULL)
+        return false;
+
+    delete slots[i];
+    slots[i] = NULL;
+    numContexts--;
+
+    // Backward shift deletion: move following entries of the probe sequence
+    // into the hole, thus a lookup never needs tombstones.
+    for (uint32_t j = (i + 1) & mask; slots[j] != NULL; j = (j + 1) & mask) {
+        uint32_t home = slotOf(slots[j]->getSsrc());
+
+        // Move entry j if its home slot is not cyclically in (i, j]
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            slots[i] = slots[j];
+            slots[j] = NULL;
+            i = j;
+        }
+    }
+    return true;
+}
+
+void SrtpSession::insert(CryptoContext* pcc)
+{
+    if ((uint32_t)(numContexts + 1) * 2 > numSlots)
+        grow();
+
+    uint32_t i = slotOf(pcc->getSsrc());
+    while (slots[i] != NULL)
+        i = (i + 1) & (numSlots - 1);
+
+    slots[i] = pcc;
+    numContexts++;
+}
+
+void SrtpSession::grow()
+{
+    CryptoContext** oldSlots = slots;
+    uint32_t oldNumSlots = numSlots;
+
+    numSlots *= 2;
+    slots = new CryptoContext*[numSlots];
+    memset(slots, 0, numSlots * sizeof(CryptoContext*));
+
+    for (uint32_t n = 0; n < oldNumSlots; n++) {
+        if (oldSlots[n] == NULL)
+            continue;
+        uint32_t i = slotOf(oldSlots[n]->getSsrc());
+        while (slots[i] != NULL)
+            i = (i + 1) & (numSlots - 1);
+        slots[i] = oldSlots[n];
+    }
+    delete [] oldSlots;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SRTPSESSION_H_
+#define _SRTPSESSION_H_
+
+#include <stdint.h>
+
+class CryptoContext;
+
+/**
+ * @brief Initial number of slots of the SrtpSession hash table.
+ *
+ * Must be a power of 2.
+ */
+#define SRTP_SESSION_INITIAL_SLOTS  8
+
+/**
+ * @brief Owns the SRTP crypto contexts of several SSRCs on one transport.
+ *
+ * Simulcast, RTX or conference mixers send several SSRC streams on one
+ * transport and all streams use the same SRTP parameters and master keys.
+ * An SrtpSession holds a pre-initialized template CryptoContext and creates
+ * the CryptoContext for a SSRC when it sees the first packet of this SSRC,
+ * see CryptoContext::newCryptoContextForSSRC().
+ *
+ * The session stores the contexts in an open addressing hash table (linear
+ * probing) keyed by the SSRC, thus a lookup takes constant time independent
+ * of the number of SSRC streams. The table grows if it is half full.
+ *
+ * A session is either for the sending or for the receiving direction, the
+ * same as a CryptoContext. The functions are not thread safe, the application
+ * must serialize access to a session.
+ *
+ @verbatim
+ CryptoContext* tmpl = new CryptoContext(0, 0, 0L, ...);   // do not derive keys
+ SrtpSession* recvSession = new SrtpSession(tmpl);
+
+ int32_t rc = SrtpHandler::unprotect(recvSession, buffer, length, newLength);
+ @endverbatim
+ *
+ * @sa SrtpHandler
+ */
+class SrtpSession {
+public:
+    /**
+     * @brief Construct a SRTP session.
+     *
+     * The session takes ownership of the template and deletes it when the
+     * session is deleted. The application must not call deriveSrtpKeys()
+     * on the template because the template must keep the master keys.
+     *
+     * @param templateCtx
+     *    The pre-initialized CryptoContext that the session uses to create
+     *    the CryptoContexts of the SSRCs.
+     *
+     * @param keyDerivRate
+     *    The key derivation rate of the new CryptoContexts, usually zero.
+     */
+    SrtpSession(CryptoContext* templateCtx, int64_t keyDerivRate = 0L);
+
+    /**
+     * @brief Destructor.
+     *
+     * Deletes the template and all CryptoContexts of this session.
+     */
+    ~SrtpSession();
+
+    /**
+     * @brief Get the CryptoContext of a SSRC, create it if necessary.
+     *
+     * If the session has no CryptoContext for this SSRC then the function
+     * creates a new CryptoContext using the template, derives the SRTP keys
+     * and stores it.
+     *
+     * @param ssrc
+     *    The RTP SSRC
+     *
+     * @return the CryptoContext of the SSRC or @c NULL if the session has no
+     *         template.
+     */
+    CryptoContext* getCryptoContext(uint32_t ssrc);
+
+    /**
+     * @brief Lookup the CryptoContext of a SSRC.
+     *
+     * @param ssrc
+     *    The RTP SSRC
+     *
+     * @return the CryptoContext of the SSRC or @c NULL if the session has
+     *         no CryptoContext for this SSRC.
+     */
+    CryptoContext* findCryptoContext(uint32_t ssrc) const;
+
+    /**
+     * @brief Add a CryptoContext to the session.
+     *
+     * Use this if a SSRC requires other parameters than the template, for
+     * example a ROC that is not zero. The session takes ownership of the
+     * CryptoContext and replaces (deletes) an existing CryptoContext with the
+     * same SSRC. The application must call deriveSrtpKeys() before it adds
+     * the CryptoContext.
+     *
+     * @param pcc
+     *    The CryptoContext, the function uses its SSRC as key.
+     */
+    void addCryptoContext(CryptoContext* pcc);
+
+    /**
+     * @brief Remove and delete the CryptoContext of a SSRC.
+     *
+     * @param ssrc
+     *    The RTP SSRC
+     *
+     * @return @c true if the session had a CryptoContext for this SSRC.
+     */
+    bool removeCryptoContext(uint32_t ssrc);
+
+    /**
+     * @brief Get the number of CryptoContexts in this session.
+     *
+     * @return number of CryptoContexts, the template does not count.
+     */
+    int32_t getNumberOfContexts() const { return numContexts; }
+
+    /**
+     * @brief Get the template CryptoContext of this session.
+     *
+     * @return the template CryptoContext
+     */
+    CryptoContext* getTemplate() const { return templateCtx; }
+
+private:
+    SrtpSession(const SrtpSession& other);
+    SrtpSession& operator=(const SrtpSession& other);
+
+    uint32_t slotOf(uint32_t ssrc) const;
+
+    void insert(CryptoContext* pcc);
+
+    void grow();
+
+    CryptoContext* templateCtx;
+    int64_t keyDerivRate;
+
+    CryptoContext** slots;
+    uint32_t numSlots;          //!< always a power of 2
+    int32_t numContexts;
+};
+
+#endif // _SRTPSESSION_H_
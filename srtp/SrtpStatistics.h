@@ -0,0 +1,168 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SRTPSTATISTICS_H_
+#define _SRTPSTATISTICS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+
+#include <libzrtpcpp/ZrtpMetrics.h>
+
+/**
+ * @brief Snapshot of the packet counters of a SRTP or SRTCP crypto context.
+ *
+ * @sa CryptoContext::getStatistics(), CryptoContextCtrl::getStatistics()
+ */
+typedef struct _SrtpStatistics {
+    uint64_t packets;           //!< successfully protected or unprotected packets
+    uint64_t bytes;             //!< bytes of these packets, without SRTP/SRTCP trailer
+    uint64_t authFailures;      //!< packets with a wrong authentication tag
+    uint64_t replayDrops;       //!< packets dropped by the replay check
+    uint64_t decodeErrors;      //!< packets that are too short or malformed
+    uint64_t rocRollovers;      //!< ROC increments, SRTCP: wraps of the SRTCP index
+    uint64_t latePackets;       //!< accepted packets older than the newest packet
+} SrtpStatistics;
+
+/**
+ * @brief Packet counters of a crypto context.
+ *
+ * Only the thread that protects or unprotects the packets of the crypto
+ * context updates the counters, thus a counter update is a relaxed load and
+ * store and needs no atomic read-modify-write. Other threads, for example a
+ * metrics exporter, may call getStatistics() at any time without a lock.
+ * The counters of a snapshot are consistent each, but not with each other.
+ *
+ * The packets, authentication failures and replay drops also count in the
+ * process wide ZrtpMetrics of the context's SRTP suite.
+ */
+class SrtpCounters {
+public:
+    SrtpCounters(): packets(0), bytes(0), authFailures(0), replayDrops(0), decodeErrors(0),
+                    rocRollovers(0), latePackets(0), suite(-1) {}
+
+    /**
+     * @brief Set the SRTP suite of the process wide metrics, see ZrtpMetrics::getSrtpSuite().
+     */
+    void setSuite(int32_t metricsSuite) { suite = metricsSuite; }
+
+    /**
+     * @brief Get the SRTP suite of the process wide metrics.
+     */
+    int32_t getSuite() const { return suite; }
+
+    void countPacket(size_t length) {
+        increment(packets, 1);
+        increment(bytes, length);
+        ZrtpMetrics::countSrtpPacket(suite, length);
+    }
+
+    void countAuthFailure() { increment(authFailures, 1); ZrtpMetrics::countSrtpAuthFailure(suite); }
+
+    void countReplayDrop() { increment(replayDrops, 1); ZrtpMetrics::countSrtpReplayDrop(suite); }
+
+    void countDecodeError() { increment(decodeErrors, 1); }
+
+    void countRocRollover() { increment(rocRollovers, 1); }
+
+    void countLatePacket() { increment(latePackets, 1); }
+
+    /**
+     * @brief Get a snapshot of the counters.
+     *
+     * @param stats
+     *    The function stores the counter values in this structure.
+     */
+    void getStatistics(SrtpStatistics* stats) const {
+        stats->packets = packets.load(std::memory_order_relaxed);
+        stats->bytes = bytes.load(std::memory_order_relaxed);
+        stats->authFailures = authFailures.load(std::memory_order_relaxed);
+        stats->replayDrops = replayDrops.load(std::memory_order_relaxed);
+        stats->decodeErrors = decodeErrors.load(std::memory_order_relaxed);
+        stats->rocRollovers = rocRollovers.load(std::memory_order_relaxed);
+        stats->latePackets = latePackets.load(std::memory_order_relaxed);
+    }
+
+private:
+    SrtpCounters(const SrtpCounters& other);
+    SrtpCounters& operator=(const SrtpCounters& other);
+
+    static void increment(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> packets;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> authFailures;
+    std::atomic<uint64_t> replayDrops;
+    std::atomic<uint64_t> decodeErrors;
+    std::atomic<uint64_t> rocRollovers;
+    std::atomic<uint64_t> latePackets;
+    int32_t suite;
+};
+
+/**
+ * @brief Measure the latency of a sampled SRTP operation.
+ *
+ * The SrtpHandler functions create a probe at the start of a protect or
+ * unprotect call. If ZrtpMetrics::sampleLatency() selects the call the probe
+ * reads the steady clock, each endStage() counts the time since the previous
+ * stage and finish() counts the time of the whole call. A probe that does not
+ * sample does nothing.
+ */
+class SrtpLatencyProbe {
+public:
+    /**
+     * @param latencyOperation
+     *    The ZrtpMetrics::LatencyOperation of the call
+     */
+    explicit SrtpLatencyProbe(int32_t latencyOperation): operation(latencyOperation),
+        sampled(ZrtpMetrics::sampleLatency()), start(sampled ? now() : 0), mark(start) {}
+
+    /**
+     * @brief Count the time since the previous stage in a ZrtpMetrics::LatencyStage.
+     */
+    void endStage(int32_t stage) {
+        if (!sampled)
+            return;
+        uint64_t current = now();
+        ZrtpMetrics::countStageLatency(operation, stage, current - mark);
+        mark = current;
+    }
+
+    /**
+     * @brief Count the time since the start in the latency of a SRTP suite.
+     */
+    void finish(int32_t suite) {
+        if (sampled)
+            ZrtpMetrics::countLatency(suite, operation, now() - start);
+    }
+
+private:
+    static uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    int32_t operation;
+    bool sampled;
+    uint64_t start;
+    uint64_t mark;
+};
+
+#endif // _SRTPSTATISTICS_H_
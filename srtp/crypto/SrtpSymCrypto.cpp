@@ -21,173 +21,462 @@
 #define MAKE_F8_TEST
 
 #include <stdlib.h>
+#include <new>
 #include <crypto/SrtpSymCrypto.h>
 #include <cryptcommon/twofish.h>
 #include <cryptcommon/aesopt.h>
+#include <cryptcommon/aes_hw.h>
+#include <cryptcommon/aes_ct.h>
+#include <cryptcommon/ghash.h>
+#include <cryptcommon/chacha20.h>
 #include <string.h>
 #include <stdio.h>
 #include <common/osSpecifics.h>
+#include <common/zrtpByteOrder.h>
+#include <common/MemoryUsage.h>
 
-SrtpSymCrypto::SrtpSymCrypto(int algo):key(NULL), algorithm(algo) {
+/*
+ * The ChaCha20 key: the SRTP key derivation uses the AES-CM PRF with the master
+ * key (RFC 3711, chapter 4.3.3), thus the key starts with an AES key schedule.
+ */
+typedef struct _chachaKey {
+    AESencrypt aes;
+    uint8_t key[CHACHA20_KEY_SIZE];
+} chachaKey_t;
+
+/* The AES and ChaCha20 keys start with the AES key schedule */
+static inline bool usesAesKey(int32_t algorithm)
+{
+    return algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8 ||
+           algorithm == SrtpEncryptionCHACHA20POLY1305;
+}
+
+/*
+ * The key schedules use the SrtpMemoryPool, it clears the memory on release.
+ */
+static void releaseKey(void* key, int32_t algorithm)
+{
+    if (key == NULL)
+        return;
+
+    if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
+        AESencrypt *saAes = reinterpret_cast<AESencrypt*>(key);
+        saAes->~AESencrypt();
+        SrtpMemoryPool::release(saAes, sizeof(AESencrypt));
+    }
+    else if (algorithm == SrtpEncryptionCHACHA20POLY1305) {
+        chachaKey_t *chacha = reinterpret_cast<chachaKey_t*>(key);
+        chacha->~chachaKey_t();
+        SrtpMemoryPool::release(chacha, sizeof(chachaKey_t));
+    }
+    else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
+        SrtpMemoryPool::release(key, sizeof(Twofish_key));
+    }
+}
+
+/*
+ * Without AES instructions the AES modes use the bitsliced AES, its timing
+ * does not depend on the key and the data. The table driven AES still
+ * computes the key schedule, the bitsliced AES converts it.
+ */
+static void* newCtKey(const AESencrypt* aes)
+{
+    if (aes_hw_available() || !aes_ct_available())
+        return NULL;
+
+    aes_ct_ctx* ct = reinterpret_cast<aes_ct_ctx*>(SrtpMemoryPool::allocate(sizeof(aes_ct_ctx)));
+    aes_ct_key(ct, aes->cx);
+    return ct;
+}
+
+static void releaseCtKey(void* ctKey)
+{
+    if (ctKey != NULL)
+        SrtpMemoryPool::release(ctKey, sizeof(aes_ct_ctx));
+}
+
+SrtpSymCrypto::SrtpSymCrypto(int algo):key(NULL), ctKey(NULL), gcmCtx(NULL), algorithm(algo) {
 }
 
 SrtpSymCrypto::SrtpSymCrypto( uint8_t* k, int32_t keyLength, int algo):
-    key(NULL), algorithm(algo) {
+    key(NULL), ctKey(NULL), gcmCtx(NULL), algorithm(algo) {
 
     setNewKey(k, keyLength);
 }
 
 SrtpSymCrypto::~SrtpSymCrypto() {
-    if (key != NULL) {
-        if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
-            AESencrypt *saAes = reinterpret_cast<AESencrypt*>(key);
-            memset(saAes->cx, 0, sizeof(aes_encrypt_ctx));
-            delete saAes;
-        }
-        else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
-            memset(key, 0, sizeof(Twofish_key));
-            delete[] (uint8_t*)key;
-        }
-        key = NULL;
-    }
+    gcmRelease();
+    releaseKey(key, algorithm);
+    key = NULL;
+    releaseCtKey(ctKey);
+    ctKey = NULL;
 }
 
+#ifndef ZRTP_MINIMAL_ALGORITHMS
 static int twoFishInit = 0;
+#endif
 
 bool SrtpSymCrypto::setNewKey(const uint8_t* k, int32_t keyLength) {
     // release an existing key before setting a new one
-    if (key != NULL) {
-        if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
-            AESencrypt *saAes = reinterpret_cast<AESencrypt*>(key);
-            memset(saAes->cx, 0, sizeof(aes_encrypt_ctx));
-            delete saAes;
-        }
-        else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
-            memset(key, 0, sizeof(Twofish_key));
-            delete[] (uint8_t*)key;
-        }
-        key = NULL;
-    }
+    gcmRelease();
+    releaseKey(key, algorithm);
+    key = NULL;
+    releaseCtKey(ctKey);
+    ctKey = NULL;
 
     if (!(keyLength == 16 || keyLength == 32)) {
         return false;
     }
     if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
-        AESencrypt *saAes = new AESencrypt();
+        AESencrypt *saAes = new (SrtpMemoryPool::allocate(sizeof(AESencrypt))) AESencrypt();
         if (keyLength == 16)
             saAes->key128(k);
         else
             saAes->key256(k);
         key = saAes;
+        ctKey = newCtKey(saAes);
+    }
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+    else if (algorithm == SrtpEncryptionCHACHA20POLY1305) {
+        if (keyLength != CHACHA20_KEY_SIZE)
+            return false;
+        chachaKey_t *chacha = new (SrtpMemoryPool::allocate(sizeof(chachaKey_t))) chachaKey_t();
+        chacha->aes.key256(k);
+        memcpy(chacha->key, k, CHACHA20_KEY_SIZE);
+        key = chacha;
     }
     else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
         if (!twoFishInit) {
             Twofish_initialise();
             twoFishInit = 1;
         }
-        key = new uint8_t[sizeof(Twofish_key)];
+        key = SrtpMemoryPool::allocate(sizeof(Twofish_key));
         memset(key, 0, sizeof(Twofish_key));
         Twofish_prepare_key((Twofish_Byte*)k, keyLength,  (Twofish_key*)key);
     }
+#endif
     else
         return false;
 
     return true;
 }
 
+void SrtpSymCrypto::addMemoryUsage(MemoryUsage& usage) const {
+    size_t bytes = sizeof(SrtpSymCrypto);
+
+    if (key != NULL) {
+        if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8)
+            bytes += sizeof(AESencrypt);
+        else if (algorithm == SrtpEncryptionCHACHA20POLY1305)
+            bytes += sizeof(chachaKey_t);
+        else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8)
+            bytes += sizeof(Twofish_key);
+    }
+    if (ctKey != NULL)
+        bytes += sizeof(aes_ct_ctx);
+    if (gcmCtx != NULL)
+        bytes += sizeof(ghash_ctx);
+    usage.add(MemoryUsage::Cipher, bytes);
+}
+
 void SrtpSymCrypto::encrypt(const uint8_t* input, uint8_t* output) {
-    if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
+    if (ctKey != NULL) {
+        aes_ct_ecb_encrypt(input, output, 1, reinterpret_cast<aes_ct_ctx*>(ctKey));
+    }
+    else if (usesAesKey(algorithm)) {
         AESencrypt *saAes = reinterpret_cast<AESencrypt*>(key);
         saAes->encrypt(input, output);
     }
+#ifndef ZRTP_MINIMAL_ALGORITHMS
     else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
         Twofish_encrypt((Twofish_key*)key, (Twofish_Byte*)input,
                         (Twofish_Byte*)output); 
     }
+#endif
 }
 
-void SrtpSymCrypto::get_ctr_cipher_stream(uint8_t* output, uint32_t length, uint8_t* iv) {
-    uint16_t ctr = 0;
-    unsigned char temp[SRTP_BLOCK_SIZE];
+void SrtpSymCrypto::encryptBlocks(const uint8_t* input, uint8_t* output, int32_t numBlocks) {
+    if (ctKey != NULL) {
+        aes_ct_ecb_encrypt(input, output, numBlocks, reinterpret_cast<aes_ct_ctx*>(ctKey));
+    }
+    else if (usesAesKey(algorithm)) {
+        AESencrypt *saAes = reinterpret_cast<AESencrypt*>(key);
+        saAes->ecb_encrypt(input, output, numBlocks * SRTP_BLOCK_SIZE);
+    }
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+    else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
+        Twofish_encrypt_blocks((Twofish_key*)key, (const Twofish_Byte*)input, (Twofish_Byte*)output, numBlocks);
+    }
+#endif
+}
 
-    for(ctr = 0; ctr < length/SRTP_BLOCK_SIZE; ctr++) {
-        //compute the cipher stream
-        iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
-        iv[15] = (uint8_t)((ctr & 0x00FF));
+/*
+ * XOR data with key stream, use 64 bit words if possible. Using memcpy to
+ * access the words avoids alignment problems, compilers replace it with a
+ * simple load or store.
+ */
+static inline void xorKeyStream(uint8_t* out, const uint8_t* in, const uint8_t* keyStream, uint32_t length)
+{
+    uint32_t i = 0;
+
+    for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+        uint64_t data, stream;
+        memcpy(&data, in + i, sizeof(uint64_t));
+        memcpy(&stream, keyStream + i, sizeof(uint64_t));
+        data ^= stream;
+        memcpy(out + i, &data, sizeof(uint64_t));
+    }
+    for (; i < length; i++) {
+        out[i] = in[i] ^ keyStream[i];
+    }
+}
 
-        encrypt(iv, &output[ctr*SRTP_BLOCK_SIZE]);
+/*
+ * The block ciphers of the counter mode. ctrTransform() gets the cipher as
+ * template parameter, thus its loop calls the cipher without checking the
+ * algorithm for each chunk.
+ */
+struct AesBlocks {
+    static void encrypt(void* key, const uint8_t* input, uint8_t* output, int32_t numBlocks) {
+        reinterpret_cast<AESencrypt*>(key)->ecb_encrypt(input, output, numBlocks * SRTP_BLOCK_SIZE);
     }
-    if ((length % SRTP_BLOCK_SIZE) > 0) {
-        // Treat the last bytes:
-        iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
-        iv[15] = (uint8_t)((ctr & 0x00FF));
+};
 
-        encrypt(iv, temp);
-        memcpy(&output[ctr*SRTP_BLOCK_SIZE], temp, length % SRTP_BLOCK_SIZE );
+struct AesCtBlocks {
+    static void encrypt(void* key, const uint8_t* input, uint8_t* output, int32_t numBlocks) {
+        aes_ct_ecb_encrypt(input, output, numBlocks, reinterpret_cast<aes_ct_ctx*>(key));
     }
-}
+};
 
-void SrtpSymCrypto::ctr_encrypt(const uint8_t* input, uint32_t input_length, uint8_t* output, uint8_t* iv) {
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+struct TwofishBlocks {
+    static void encrypt(void* key, const uint8_t* input, uint8_t* output, int32_t numBlocks) {
+        Twofish_encrypt_blocks((Twofish_key*)key, (const Twofish_Byte*)input, (Twofish_Byte*)output, numBlocks);
+    }
+};
+#endif
 
-    if (key == NULL)
-        return;
+/*
+ * Compute the key stream for SRTP_CTR_BLOCKS counter blocks with one call to
+ * the cipher and XOR it with the input. If input is NULL then just store the
+ * key stream.
+ *
+ * The counter occupies the last two bytes of the IV, refer to RFC 3711, chapter
+ * 4.1.1. On return these two bytes contain the last used counter value.
+ */
+template <class Blocks>
+static void ctrTransform(void* key, const uint8_t* input, uint8_t* output, uint32_t length, uint8_t* iv) {
 
+    uint8_t ctrBlocks[SRTP_CTR_BLOCKS * SRTP_BLOCK_SIZE];
+    uint8_t keyStream[SRTP_CTR_BLOCKS * SRTP_BLOCK_SIZE];
     uint16_t ctr = 0;
-    unsigned char temp[SRTP_BLOCK_SIZE];
 
-    int l = input_length/SRTP_BLOCK_SIZE;
-    for (ctr = 0; ctr < l; ctr++ ) {
-        iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
-        iv[15] = (uint8_t)((ctr & 0x00FF));
+    if (length == 0)
+        return;
+
+    // The fixed part of the counter blocks does not change, set it only once
+    for (int32_t i = 0; i < SRTP_CTR_BLOCKS; i++) {
+        memcpy(ctrBlocks + i * SRTP_BLOCK_SIZE, iv, SRTP_BLOCK_SIZE - 2);
+    }
+    while (length > 0) {
+        uint32_t chunk = (length < sizeof(keyStream)) ? length : sizeof(keyStream);
+        int32_t numBlocks = (chunk + SRTP_BLOCK_SIZE - 1) / SRTP_BLOCK_SIZE;
 
-        encrypt(iv, temp);
-        for (int i = 0; i < SRTP_BLOCK_SIZE; i++ ) {
-            *output++ = temp[i] ^ *input++;
+        for (int32_t i = 0; i < numBlocks; i++, ctr++) {
+            ctrBlocks[i * SRTP_BLOCK_SIZE + 14] = (uint8_t)((ctr & 0xFF00) >>  8);
+            ctrBlocks[i * SRTP_BLOCK_SIZE + 15] = (uint8_t)((ctr & 0x00FF));
         }
+        Blocks::encrypt(key, ctrBlocks, keyStream, numBlocks);
 
+        if (input == NULL) {
+            memcpy(output, keyStream, chunk);
+        }
+        else {
+            xorKeyStream(output, input, keyStream, chunk);
+            input += chunk;
+        }
+        output += chunk;
+        length -= chunk;
     }
-    l = input_length % SRTP_BLOCK_SIZE;
-    if (l > 0) {
-        // Treat the last bytes:
-        iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
-        iv[15] = (uint8_t)((ctr & 0x00FF));
+    ctr--;
+    iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
+    iv[15] = (uint8_t)((ctr & 0x00FF));
+}
 
-        encrypt(iv, temp);
-        for (int i = 0; i < l; i++ ) {
-            *output++ = temp[i] ^ *input++;
-        }
+/*
+ * Number of counter blocks of the small payload path, enough for a typical
+ * compressed audio frame.
+ */
+static const uint32_t smallCtrBlocks = 4;
+
+/*
+ * Counter mode for payloads of at most smallCtrBlocks blocks, for example
+ * 20 ms Opus or G.729 frames. The counter values 0 to 3 fit into the last
+ * byte of the counter block, thus the function sets up the counter blocks
+ * without the loop and the chunking of ctrTransform() and computes the key
+ * stream with one call to the cipher.
+ */
+template <class Blocks>
+static void ctrTransformSmall(void* key, const uint8_t* input, uint8_t* output, uint32_t length, uint8_t* iv) {
+
+    uint8_t ctrBlocks[smallCtrBlocks * SRTP_BLOCK_SIZE];
+    uint8_t keyStream[smallCtrBlocks * SRTP_BLOCK_SIZE];
+    int32_t numBlocks = (length + SRTP_BLOCK_SIZE - 1) / SRTP_BLOCK_SIZE;
+
+    memcpy(ctrBlocks, iv, SRTP_BLOCK_SIZE - 2);
+    ctrBlocks[14] = 0;
+    ctrBlocks[15] = 0;
+    memcpy(ctrBlocks + SRTP_BLOCK_SIZE, ctrBlocks, SRTP_BLOCK_SIZE);
+    ctrBlocks[SRTP_BLOCK_SIZE + 15] = 1;
+    memcpy(ctrBlocks + 2 * SRTP_BLOCK_SIZE, ctrBlocks, SRTP_BLOCK_SIZE);
+    ctrBlocks[2 * SRTP_BLOCK_SIZE + 15] = 2;
+    memcpy(ctrBlocks + 3 * SRTP_BLOCK_SIZE, ctrBlocks, SRTP_BLOCK_SIZE);
+    ctrBlocks[3 * SRTP_BLOCK_SIZE + 15] = 3;
+
+    Blocks::encrypt(key, ctrBlocks, keyStream, numBlocks);
+
+    if (input == NULL)
+        memcpy(output, keyStream, length);
+    else
+        xorKeyStream(output, input, keyStream, length);
+
+    iv[14] = 0;
+    iv[15] = (uint8_t)(numBlocks - 1);
+}
+
+void SrtpSymCrypto::ctrProcess(const uint8_t* input, uint8_t* output, uint32_t length, uint8_t* iv) {
+    bool small = length > 0 && length <= smallCtrBlocks * SRTP_BLOCK_SIZE;
+
+    if (ctKey != NULL) {
+        if (small)
+            ctrTransformSmall<AesCtBlocks>(ctKey, input, output, length, iv);
+        else
+            ctrTransform<AesCtBlocks>(ctKey, input, output, length, iv);
+    }
+    else if (usesAesKey(algorithm)) {
+        if (small)
+            ctrTransformSmall<AesBlocks>(key, input, output, length, iv);
+        else
+            ctrTransform<AesBlocks>(key, input, output, length, iv);
     }
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+    else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
+        if (small)
+            ctrTransformSmall<TwofishBlocks>(key, input, output, length, iv);
+        else
+            ctrTransform<TwofishBlocks>(key, input, output, length, iv);
+    }
+#endif
 }
 
-void SrtpSymCrypto::ctr_encrypt( uint8_t* data, uint32_t data_length, uint8_t* iv ) {
+void SrtpSymCrypto::get_ctr_cipher_stream(uint8_t* output, uint32_t length, uint8_t* iv) {
+    ctrProcess(NULL, output, length, iv);
+}
+
+void SrtpSymCrypto::ctr_encrypt(const uint8_t* input, uint32_t input_length, uint8_t* output, uint8_t* iv) {
 
     if (key == NULL)
         return;
 
-    uint16_t ctr = 0;
-    unsigned char temp[SRTP_BLOCK_SIZE];
+    ctrProcess(input, output, input_length, iv);
+}
 
-    int l = data_length/SRTP_BLOCK_SIZE;
-    for (ctr = 0; ctr < l; ctr++ ) {
-        iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
-        iv[15] = (uint8_t)((ctr & 0x00FF));
+void SrtpSymCrypto::ctr_encrypt( uint8_t* data, uint32_t data_length, uint8_t* iv ) {
 
-        encrypt(iv, temp);
-        for (int i = 0; i < SRTP_BLOCK_SIZE; i++ ) {
-            *data++ ^= temp[i];
-        }
+    if (key == NULL)
+        return;
 
-    }
-    l = data_length % SRTP_BLOCK_SIZE;
-    if (l > 0) {
-        // Treat the last bytes:
-        iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
-        iv[15] = (uint8_t)((ctr & 0x00FF));
+    ctrProcess(data, data, data_length, iv);
+}
 
-        encrypt(iv, temp);
-        for (int i = 0; i < l; i++ ) {
-            *data++ ^= temp[i];
+/* Number of counter blocks that ctrEncryptLanes() encrypts with one call */
+static const int32_t laneBlocks = SRTP_CTR_BLOCKS * AES_HW_LANES / 2;
+
+/*
+ * The jobs share the AES lanes: each round of the loop takes some counter
+ * blocks of each active job, encrypts them with one call and XORs the key
+ * stream. A finished job frees its slot for the next job.
+ */
+void SrtpSymCrypto::ctrEncryptLanes(SrtpCtrLane lanes[], int32_t count) {
+
+    SrtpCtrLane* active[AES_HW_LANES];
+    uint32_t done[AES_HW_LANES];
+    uint16_t ctr[AES_HW_LANES];
+    int32_t blocks[AES_HW_LANES];
+    const aes_encrypt_ctx* ctx[laneBlocks];
+    uint8_t ctrBlocks[laneBlocks * SRTP_BLOCK_SIZE];
+    uint8_t keyStream[laneBlocks * SRTP_BLOCK_SIZE];
+    int32_t numActive = 0;
+    int32_t next = 0;
+    bool hw = aes_hw_available() != 0;
+
+    for (;;) {
+        // Fill the free slots, jobs that cannot use the AES lanes run at once
+        while (numActive < AES_HW_LANES && next < count) {
+            SrtpCtrLane* lane = &lanes[next++];
+
+            if (lane->cipher == NULL || lane->cipher->key == NULL || lane->length == 0)
+                continue;
+            if (!hw || lane->cipher->algorithm != SrtpEncryptionAESCM) {
+                lane->cipher->ctrProcess(lane->input, lane->output, lane->length, lane->iv);
+                continue;
+            }
+            active[numActive] = lane;
+            done[numActive] = 0;
+            ctr[numActive] = 0;
+            numActive++;
         }
+        if (numActive == 0)
+            break;
+
+        int32_t perJob = laneBlocks / numActive;
+        int32_t nb = 0;
+        for (int32_t i = 0; i < numActive; i++) {
+            const aes_encrypt_ctx* cx = reinterpret_cast<AESencrypt*>(active[i]->cipher->key)->cx;
+            uint32_t left = active[i]->length - done[i];
+
+            blocks[i] = (int32_t)((left + SRTP_BLOCK_SIZE - 1) / SRTP_BLOCK_SIZE);
+            if (blocks[i] > perJob)
+                blocks[i] = perJob;
+            for (int32_t k = 0; k < blocks[i]; k++, nb++) {
+                uint8_t* block = ctrBlocks + nb * SRTP_BLOCK_SIZE;
+                uint16_t c = (uint16_t)(ctr[i] + k);
+
+                memcpy(block, active[i]->iv, SRTP_BLOCK_SIZE - 2);
+                block[14] = (uint8_t)((c & 0xFF00) >>  8);
+                block[15] = (uint8_t)((c & 0x00FF));
+                ctx[nb] = cx;
+            }
+        }
+        aes_hw_encrypt_lanes(ctrBlocks, keyStream, nb, ctx);
+
+        // XOR the key stream in the same order, keep the unfinished jobs
+        int32_t kept = 0;
+        nb = 0;
+        for (int32_t i = 0; i < numActive; i++) {
+            SrtpCtrLane* lane = active[i];
+            uint32_t left = lane->length - done[i];
+            uint32_t chunk = (uint32_t)blocks[i] * SRTP_BLOCK_SIZE;
+
+            if (chunk > left)
+                chunk = left;
+            xorKeyStream(lane->output + done[i], lane->input + done[i], keyStream + nb * SRTP_BLOCK_SIZE, chunk);
+            nb += blocks[i];
+            done[i] += chunk;
+            ctr[i] = (uint16_t)(ctr[i] + blocks[i]);
+
+            if (done[i] == lane->length) {
+                uint16_t last = (uint16_t)(ctr[i] - 1);
+                lane->iv[14] = (uint8_t)((last & 0xFF00) >>  8);
+                lane->iv[15] = (uint8_t)((last & 0x00FF));
+                continue;
+            }
+            active[kept] = lane;
+            done[kept] = done[i];
+            ctr[kept] = ctr[i];
+            kept++;
+        }
+        numActive = kept;
     }
 }
 
@@ -238,76 +527,210 @@ void SrtpSymCrypto::f8_deriveForIV(SrtpSymCrypto* f8Cipher, uint8_t* key, int32_
 void SrtpSymCrypto::f8_encrypt(const uint8_t* in, uint32_t in_length, uint8_t* out,
                          uint8_t* iv, SrtpSymCrypto* f8Cipher ) {
 
-
-    int offset = 0;
-
-    unsigned char ivAccent[SRTP_BLOCK_SIZE];
-    unsigned char S[SRTP_BLOCK_SIZE];
-
-    F8_CIPHER_CTX f8ctx;
+    /*
+     * IV' and the key stream block S(j) as 32 bit words, thus the F8 chaining
+     * S(j) = E(k_e, IV' XOR j XOR S(j-1)) works on words and not on bytes.
+     */
+    uint32_t ivAccent[SRTP_BLOCK_SIZE / sizeof(uint32_t)];
+    uint32_t S[SRTP_BLOCK_SIZE / sizeof(uint32_t)] = {0};
+    uint32_t J = 0;
 
     if (key == NULL)
         return;
-    /*
-     * Get memory for the derived IV (IV')
-     */
-    f8ctx.ivAccent = ivAccent;
+
     /*
      * Use the derived IV encryption setup to encrypt the original IV to produce IV'.
+     * IV' depends on the packet's IV, thus compute it for each packet.
      */
-    f8Cipher->encrypt(iv, f8ctx.ivAccent);
-
-    f8ctx.J = 0;                       // initialize the counter
-    f8ctx.S = S;               // get the key stream buffer
+    f8Cipher->encrypt(iv, reinterpret_cast<uint8_t*>(ivAccent));
+
+    while (in_length > 0) {
+        uint32_t chunk = (in_length < SRTP_BLOCK_SIZE) ? in_length : SRTP_BLOCK_SIZE;
+
+        S[0] ^= ivAccent[0];
+        S[1] ^= ivAccent[1];
+        S[2] ^= ivAccent[2];
+        S[3] ^= ivAccent[3] ^ zrtpBe32(J);
+        J++;
+        encrypt(reinterpret_cast<uint8_t*>(S), reinterpret_cast<uint8_t*>(S));
+
+        xorKeyStream(out, in, reinterpret_cast<uint8_t*>(S), chunk);
+        in += chunk;
+        out += chunk;
+        in_length -= chunk;
+    }
+}
 
-    memset(f8ctx.S, 0, SRTP_BLOCK_SIZE); // initial value for key stream
 
-    while (in_length >= SRTP_BLOCK_SIZE) {
-        processBlock(&f8ctx, in+offset, SRTP_BLOCK_SIZE, out+offset);
-        in_length -= SRTP_BLOCK_SIZE;
-        offset += SRTP_BLOCK_SIZE;
+/*
+ * AES-GCM, refer to NIST SP 800-38D and RFC 7714. The hash subkey H is
+ * computed with the first GCM call after a key was set.
+ */
+void SrtpSymCrypto::gcmRelease() {
+    if (gcmCtx != NULL) {
+        SrtpMemoryPool::release(gcmCtx, sizeof(ghash_ctx));
+        gcmCtx = NULL;
     }
-    if (in_length > 0) {
-        processBlock(&f8ctx, in+offset, in_length, out+offset);
+}
+
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+/*
+ * Compute the GHASH tables if necessary
+ */
+void SrtpSymCrypto::gcmPrepare() {
+    if (gcmCtx == NULL) {
+        uint8_t h[SRTP_BLOCK_SIZE] = {0};
+        encrypt(h, h);
+        ghash_ctx* ctx = static_cast<ghash_ctx*>(SrtpMemoryPool::allocate(sizeof(ghash_ctx)));
+        ghash_init(ctx, h);
+        gcmCtx = ctx;
+        memset(h, 0, sizeof(h));
     }
 }
 
-int SrtpSymCrypto::processBlock(F8_CIPHER_CTX *f8ctx, const uint8_t* in, int32_t length, uint8_t* out) {
+/*
+ * Setup J0 = IV || 0^31 || 1, compute the GHASH tables if necessary
+ */
+void SrtpSymCrypto::gcmInit(const uint8_t* iv, uint8_t* j0) {
+    gcmPrepare();
+    memcpy(j0, iv, SRTP_GCM_IV_LENGTH);
+    j0[12] = j0[13] = j0[14] = 0;
+    j0[15] = 1;
+}
+
+/*
+ * Encrypt or decrypt with the 32 bit counter of GCM, the first counter block
+ * is J0 + 1. If y is not NULL then hash the encrypted data.
+ */
+void SrtpSymCrypto::gcmCtrProcess(uint8_t* data, uint32_t length, const uint8_t* j0, uint8_t* y) {
 
-    int i;
-    const uint8_t *cp_in;
-    uint8_t* cp_in1, *cp_out;
-    uint32_t *ui32p;
+    uint8_t ctrBlocks[SRTP_CTR_BLOCKS * SRTP_BLOCK_SIZE];
+    uint8_t keyStream[SRTP_CTR_BLOCKS * SRTP_BLOCK_SIZE];
+    uint32_t ctr = ((uint32_t)j0[12] << 24) | ((uint32_t)j0[13] << 16) | ((uint32_t)j0[14] << 8) | j0[15];
 
-    /*
-     * XOR the previous key stream with IV'
-     * ( S(-1) xor IV' )
-     */
-    cp_in = f8ctx->ivAccent;
-    cp_out = f8ctx->S;
-    for (i = 0; i < SRTP_BLOCK_SIZE; i++) {
-        *cp_out++ ^= *cp_in++;
+    for (int32_t i = 0; i < SRTP_CTR_BLOCKS; i++) {
+        memcpy(ctrBlocks + i * SRTP_BLOCK_SIZE, j0, SRTP_GCM_IV_LENGTH);
     }
-    /*
-     * Now XOR (S(n-1) xor IV') with the current counter, then increment the counter
-     */
-    ui32p = (uint32_t *)f8ctx->S;
-    ui32p[3] ^= zrtpHtonl(f8ctx->J);
-    f8ctx->J++;
-    /*
-     * Now compute the new key stream using AES encrypt
-     */
-    encrypt(f8ctx->S, f8ctx->S);
-    /*
-     * as the last step XOR the plain text with the key stream to produce
-     * the ciphertext.
-     */
-    cp_out = out;
-    cp_in = in;
-    cp_in1 = f8ctx->S;
-    for (i = 0; i < length; i++) {
-        *cp_out++ = *cp_in++ ^ *cp_in1++;
+    while (length > 0) {
+        uint32_t chunk = (length < sizeof(keyStream)) ? length : sizeof(keyStream);
+        int32_t numBlocks = (chunk + SRTP_BLOCK_SIZE - 1) / SRTP_BLOCK_SIZE;
+
+        for (int32_t i = 0; i < numBlocks; i++) {
+            ctr++;
+            ctrBlocks[i * SRTP_BLOCK_SIZE + 12] = (uint8_t)(ctr >> 24);
+            ctrBlocks[i * SRTP_BLOCK_SIZE + 13] = (uint8_t)(ctr >> 16);
+            ctrBlocks[i * SRTP_BLOCK_SIZE + 14] = (uint8_t)(ctr >> 8);
+            ctrBlocks[i * SRTP_BLOCK_SIZE + 15] = (uint8_t)ctr;
+        }
+        encryptBlocks(ctrBlocks, keyStream, numBlocks);
+        xorKeyStream(data, data, keyStream, chunk);
+
+        if (y != NULL)
+            ghash_update(reinterpret_cast<ghash_ctx*>(gcmCtx), y, data, chunk);
+
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+/*
+ * Hash the length block and compute the tag: E(K, J0) XOR GHASH
+ */
+void SrtpSymCrypto::gcmTag(uint8_t* y, uint32_t aadLen, uint32_t dataLen, const uint8_t* j0, uint8_t* tag) {
+
+    uint8_t lengths[SRTP_BLOCK_SIZE] = {0};
+    uint64_t aadBits = (uint64_t)aadLen * 8;
+    uint64_t dataBits = (uint64_t)dataLen * 8;
+
+    for (int32_t i = 7; i >= 0; i--) {
+        lengths[i] = (uint8_t)aadBits;
+        lengths[i + 8] = (uint8_t)dataBits;
+        aadBits >>= 8;
+        dataBits >>= 8;
     }
-    return length;
+    ghash_update(reinterpret_cast<ghash_ctx*>(gcmCtx), y, lengths, sizeof(lengths));
+
+    encrypt(j0, tag);
+    for (int32_t i = 0; i < SRTP_GCM_TAG_LENGTH; i++)
+        tag[i] ^= y[i];
+}
+
+void SrtpSymCrypto::gcm_encrypt(uint8_t* data, uint32_t dataLen, const uint8_t* aad, uint32_t aadLen, const uint8_t* iv, uint8_t* tag) {
+
+    uint8_t j0[SRTP_BLOCK_SIZE];
+    uint8_t y[SRTP_BLOCK_SIZE] = {0};
+
+    if (key == NULL)
+        return;
+
+    gcmInit(iv, j0);
+
+    ghash_update(reinterpret_cast<ghash_ctx*>(gcmCtx), y, aad, aadLen);
+    gcmCtrProcess(data, dataLen, j0, y);
+    gcmTag(y, aadLen, dataLen, j0, tag);
+}
+
+bool SrtpSymCrypto::gcm_decrypt(uint8_t* data, uint32_t dataLen, const uint8_t* aad, uint32_t aadLen, const uint8_t* iv, const uint8_t* tag) {
+
+    uint8_t j0[SRTP_BLOCK_SIZE];
+    uint8_t y[SRTP_BLOCK_SIZE] = {0};
+    uint8_t computed[SRTP_BLOCK_SIZE];
+
+    if (key == NULL)
+        return false;
+
+    gcmInit(iv, j0);
+
+    ghash_update(reinterpret_cast<ghash_ctx*>(gcmCtx), y, aad, aadLen);
+    ghash_update(reinterpret_cast<ghash_ctx*>(gcmCtx), y, data, dataLen);
+    gcmTag(y, aadLen, dataLen, j0, computed);
+
+    // compare in constant time
+    if (!srtpTagEqual(tag, computed, SRTP_GCM_TAG_LENGTH))
+        return false;
+
+    gcmCtrProcess(data, dataLen, j0, NULL);
+    return true;
 }
 
+/*
+ * ChaCha20-Poly1305, refer to RFC 8439 and chapter 8.1 and 9.1 of RFC 7714 for the IV.
+ */
+void SrtpSymCrypto::chacha_encrypt(uint8_t* data, uint32_t dataLen, const uint8_t* aad, uint32_t aadLen, const uint8_t* iv, uint8_t* tag) {
+
+    if (key == NULL || algorithm != SrtpEncryptionCHACHA20POLY1305)
+        return;
+
+    chacha20_poly1305_encrypt(reinterpret_cast<chachaKey_t*>(key)->key, iv, data, dataLen, aad, aadLen, tag);
+}
+
+bool SrtpSymCrypto::chacha_decrypt(uint8_t* data, uint32_t dataLen, const uint8_t* aad, uint32_t aadLen, const uint8_t* iv, const uint8_t* tag) {
+
+    if (key == NULL || algorithm != SrtpEncryptionCHACHA20POLY1305)
+        return false;
+
+    return chacha20_poly1305_decrypt(reinterpret_cast<chachaKey_t*>(key)->key, iv, data, dataLen, aad, aadLen, tag) != 0;
+}
+
+#else
+/*
+ * The minimal algorithm profile builds neither AES-GCM nor ChaCha20-Poly1305,
+ * the AEAD decryption always fails.
+ */
+void SrtpSymCrypto::gcmPrepare() {
+}
+
+void SrtpSymCrypto::gcm_encrypt(uint8_t*, uint32_t, const uint8_t*, uint32_t, const uint8_t*, uint8_t*) {
+}
+
+bool SrtpSymCrypto::gcm_decrypt(uint8_t*, uint32_t, const uint8_t*, uint32_t, const uint8_t*, const uint8_t*) {
+    return false;
+}
+
+void SrtpSymCrypto::chacha_encrypt(uint8_t*, uint32_t, const uint8_t*, uint32_t, const uint8_t*, uint8_t*) {
+}
+
+bool SrtpSymCrypto::chacha_decrypt(uint8_t*, uint32_t, const uint8_t*, uint32_t, const uint8_t*, const uint8_t*) {
+    return false;
+}
+#endif
@@ -27,11 +27,30 @@
 
 #include <stdint.h>
 #include <srtp/CryptoContext.h>
+#include <srtp/SrtpMemoryPool.h>
 
 #ifndef SRTP_BLOCK_SIZE
 #define SRTP_BLOCK_SIZE 16
 #endif
 
+/**
+ * Number of counter blocks the CTR mode functions encrypt with one call to
+ * the cipher.
+ */
+#ifndef SRTP_CTR_BLOCKS
+#define SRTP_CTR_BLOCKS 8
+#endif
+
+/**
+ * Length of the AES-GCM authentication tag in bytes, see RFC 7714, chapter 13.
+ */
+#define SRTP_GCM_TAG_LENGTH 16
+
+/**
+ * Length of the AES-GCM IV in bytes, see RFC 7714, chapter 8.1.
+ */
+#define SRTP_GCM_IV_LENGTH 12
+
 typedef struct _f8_ctx {
     unsigned char *S;           ///< Intermetiade buffer
     unsigned char *ivAccent;    ///< second IV
@@ -55,6 +74,20 @@ typedef struct _f8_ctx {
  *
  * @author Werner Dittmann <Werner.Dittmann@t-online.de>
  */
+class SrtpSymCrypto;
+class MemoryUsage;
+
+/**
+ * @brief One counter-mode job of SrtpSymCrypto::ctrEncryptLanes().
+ */
+typedef struct _SrtpCtrLane {
+    SrtpSymCrypto* cipher;          //!< the counter-mode cipher of the job
+    const uint8_t* input;           //!< the data to encrypt
+    uint8_t* output;                //!< receives the encrypted data, may be the same as input
+    uint32_t length;                //!< number of bytes to encrypt
+    uint8_t iv[SRTP_BLOCK_SIZE];    //!< the counter-mode IV, refer to chapter 4.1.1 in RFC 3711
+} SrtpCtrLane;
+
 class SrtpSymCrypto {
 public:
     /**
@@ -63,8 +96,10 @@ public:
      * @param algo
      *    The Encryption algorithm to use.Possible values are <code>
      *    SrtpEncryptionNull, SrtpEncryptionAESCM, SrtpEncryptionAESF8
-     *    SrtpEncryptionTWOCM, SrtpEncryptionTWOF8</code>. See chapter 4.1.1
-     *    for CM (Counter mode) and 4.1.2 for F8 mode.
+     *    SrtpEncryptionTWOCM, SrtpEncryptionTWOF8, SrtpEncryptionCHACHA20POLY1305
+     *    </code>. See chapter 4.1.1 for CM (Counter mode) and 4.1.2 for F8 mode.
+     *    A ChaCha20-Poly1305 cipher also holds an AES key schedule for the
+     *    AES-CM key derivation.
      */
     SrtpSymCrypto(int algo = SrtpEncryptionAESCM);
 
@@ -78,13 +113,21 @@ public:
      * @param algo
      *    The Encryption algorithm to use.Possible values are <code>
      *    SrtpEncryptionNull, SrtpEncryptionAESCM, SrtpEncryptionAESF8
-     *    SrtpEncryptionTWOCM, SrtpEncryptionTWOF8</code>. See chapter 4.1.1
-     *    for CM (Counter mode) and 4.1.2 for F8 mode.
+     *    SrtpEncryptionTWOCM, SrtpEncryptionTWOF8, SrtpEncryptionCHACHA20POLY1305
+     *    </code>. See chapter 4.1.1 for CM (Counter mode) and 4.1.2 for F8 mode.
+     *    A ChaCha20-Poly1305 cipher also holds an AES key schedule for the
+     *    AES-CM key derivation.
      */
     SrtpSymCrypto(uint8_t* key, int32_t key_length, int algo = SrtpEncryptionAESCM);
 
     ~SrtpSymCrypto();
 
+    /**
+     * @brief Allocate and release SrtpSymCrypto objects with the SrtpMemoryPool.
+     */
+    static void* operator new(size_t size) { return SrtpMemoryPool::allocate(size); }
+    static void operator delete(void* ptr, size_t size) { SrtpMemoryPool::release(ptr, size); }
+
     /**
      * @brief Encrypts the input to the output.
      *
@@ -99,6 +142,22 @@ public:
      */
     void encrypt( const uint8_t* input, uint8_t* output );
 
+    /**
+     * @brief Encrypts several independent blocks.
+     *
+     * Encrypts @c numBlocks input blocks to output blocks (ECB). The cipher
+     * can process these blocks with one call which is faster than calling
+     * encrypt() for each block.
+     *
+     * @param input
+     *    Pointer to input blocks, must be <code>numBlocks * 16</code> bytes
+     * @param output
+     *    Pointer to output blocks, must be <code>numBlocks * 16</code> bytes
+     * @param numBlocks
+     *    Number of blocks to encrypt
+     */
+    void encryptBlocks(const uint8_t* input, uint8_t* output, int32_t numBlocks);
+
     /**
      * @brief Set new key
      *
@@ -113,6 +172,24 @@ public:
      */
     bool setNewKey(const uint8_t* key, int32_t keyLength);
 
+    /**
+     * @brief Get the encryption algorithm of this cipher.
+     *
+     * @return the algorithm, for example @c SrtpEncryptionAESCM
+     */
+    int32_t getAlgorithm() const { return algorithm; }
+
+    /**
+     * @brief Add the memory of this cipher to a footprint report.
+     *
+     * The cipher adds its own size, the size of its key schedule and of
+     * the GCM context to the category MemoryUsage::Cipher.
+     *
+     * @param usage
+     *    The footprint report
+     */
+    void addMemoryUsage(MemoryUsage& usage) const;
+
     /**
      * @brief Computes the cipher stream for AES CM mode.
      *
@@ -168,6 +245,23 @@ public:
      */
     void ctr_encrypt(uint8_t* data, uint32_t data_length, uint8_t* iv );
 
+    /**
+     * @brief Counter-mode encryption of independent jobs.
+     *
+     * The jobs may use different ciphers and keys, for example a batch of
+     * SRTP packets of different streams. With hardware AES the function
+     * encrypts the counter blocks of up to @c AES_HW_LANES jobs interleaved,
+     * thus short packets keep the AES pipeline busy as well. Otherwise, and
+     * for Twofish jobs, the function calls ctr_encrypt() for each job.
+     *
+     * @param lanes
+     *    The jobs, the function modifies the counter part of each IV.
+     *
+     * @param count
+     *    Number of jobs.
+     */
+    static void ctrEncryptLanes(SrtpCtrLane lanes[], int32_t count);
+
     /**
      * @brief Derive a cipher context to compute the IV'.
      *
@@ -235,9 +329,113 @@ public:
      */
     void f8_encrypt(const uint8_t* data, uint32_t dataLen, uint8_t* out, uint8_t* iv, SrtpSymCrypto* f8Cipher);
 
+    /**
+     * @brief AES-GCM authenticated encryption, in place.
+     *
+     * This method performs the GCM encryption as defined in NIST SP 800-38D
+     * and computes the authentication tag over the additional authenticated
+     * data and the encrypted data. The cipher must use an AES key.
+     *
+     * @param data
+     *    Pointer to input and output block, must be <code>dataLen</code>
+     *    bytes.
+     *
+     * @param dataLen
+     *    Number of bytes to encrypt.
+     *
+     * @param aad
+     *    Pointer to the additional authenticated data, not encrypted.
+     *
+     * @param aadLen
+     *    Length of the additional authenticated data.
+     *
+     * @param iv
+     *    The 12 byte initialization vector. Refer to RFC 7714, chapter 8.1 and 9.1.
+     *
+     * @param tag
+     *    Pointer to a buffer that receives the authentication tag, must be
+     *    <code>SRTP_GCM_TAG_LENGTH</code> bytes.
+     */
+    void gcm_encrypt(uint8_t* data, uint32_t dataLen, const uint8_t* aad, uint32_t aadLen, const uint8_t* iv, uint8_t* tag);
+
+    /**
+     * @brief AES-GCM authenticated decryption, in place.
+     *
+     * The method checks the authentication tag first and decrypts the data
+     * only if the tag is valid.
+     *
+     * @param data
+     *    Pointer to input and output block, must be <code>dataLen</code>
+     *    bytes.
+     *
+     * @param dataLen
+     *    Number of bytes to decrypt.
+     *
+     * @param aad
+     *    Pointer to the additional authenticated data.
+     *
+     * @param aadLen
+     *    Length of the additional authenticated data.
+     *
+     * @param iv
+     *    The 12 byte initialization vector. Refer to RFC 7714, chapter 8.1 and 9.1.
+     *
+     * @param tag
+     *    Pointer to the received authentication tag, must be
+     *    <code>SRTP_GCM_TAG_LENGTH</code> bytes.
+     *
+     * @return
+     *    true if the tag is valid, false otherwise. The data is not
+     *    decrypted if the tag is not valid.
+     */
+    bool gcm_decrypt(uint8_t* data, uint32_t dataLen, const uint8_t* aad, uint32_t aadLen, const uint8_t* iv, const uint8_t* tag);
+
+    /**
+     * @brief Compute the GHASH tables of the AES key now.
+     *
+     * The GCM functions compute the tables on first use. A cipher that
+     * several SRTP contexts share must have them before it is shared.
+     */
+    void gcmPrepare();
+
+    /**
+     * @brief ChaCha20-Poly1305 authenticated encryption, in place.
+     *
+     * This method performs the AEAD_CHACHA20_POLY1305 encryption as defined
+     * in RFC 8439. The cipher must use the algorithm
+     * <code>SrtpEncryptionCHACHA20POLY1305</code> and a 32 byte key. The
+     * parameters are the same as for gcm_encrypt(), the tag is
+     * <code>SRTP_GCM_TAG_LENGTH</code> bytes.
+     */
+    void chacha_encrypt(uint8_t* data, uint32_t dataLen, const uint8_t* aad, uint32_t aadLen, const uint8_t* iv, uint8_t* tag);
+
+    /**
+     * @brief ChaCha20-Poly1305 authenticated decryption, in place.
+     *
+     * The method checks the authentication tag first and decrypts the data
+     * only if the tag is valid. The parameters are the same as for
+     * gcm_decrypt().
+     *
+     * @return
+     *    true if the tag is valid, false otherwise.
+     */
+    bool chacha_decrypt(uint8_t* data, uint32_t dataLen, const uint8_t* aad, uint32_t aadLen, const uint8_t* iv, const uint8_t* tag);
+
 private:
+    void ctrProcess(const uint8_t* input, uint8_t* output, uint32_t length, uint8_t* iv);
+
+    void gcmCtrProcess(uint8_t* data, uint32_t length, const uint8_t* j0, uint8_t* y);
+
+    void gcmTag(uint8_t* y, uint32_t aadLen, uint32_t dataLen, const uint8_t* j0, uint8_t* tag);
+
+    void gcmInit(const uint8_t* iv, uint8_t* j0);
+
+    void gcmRelease();
+
     int processBlock(F8_CIPHER_CTX* f8ctx, const uint8_t* in, int32_t length, uint8_t* out);
     void* key;
+    void* ctKey;        // bitsliced AES key if the CPU has no AES instructions
+    void* gcmCtx;
     int32_t algorithm;
 };
 
@@ -35,38 +35,80 @@
  * @author Werner Dittmann <Werner.Dittmann@t-online.de>
  */
 
-extern void initializeGcrypt();
+extern int initializeGcrypt();
 
 #define MAKE_F8_TEST
 
 #include <gcrypt.h>            // the include of gcrypt
 #include <stdlib.h>
-#include <crypto/SrtpSymCrypto.h>
-#include <crypto/twofish.h>
+#include <string.h>
+#include <srtp/crypto/SrtpSymCrypto.h>
+#include <cryptcommon/twofish.h>
+#include <common/osSpecifics.h>
+#include <common/zrtpByteOrder.h>
 
 #include <stdio.h>
 
-SrtpSymCrypto::SrtpSymCrypto(int algo) : key(NULL), algorithm(algo) {
+// The gcrypt handles of a key keep per-packet state, SRTP contexts must not share the keys
+#ifdef ZRTP_SHARED_KEY_SCHEDULES
+#error "The gcrypt backend does not support ZRTP_SHARED_KEY_SCHEDULES"
+#endif
+
+/*
+ * The AES key: a gcrypt handle in ECB mode for single blocks (F8, key
+ * derivation) and a handle in CTR mode. Both handles are opened and keyed once
+ * per key. Each packet only sets the counter of the CTR handle, thus libgcrypt
+ * generates the whole key stream of a packet with its bulk AES-CTR code in one
+ * gcry_cipher_encrypt call.
+ */
+typedef struct _aesKey {
+    gcry_cipher_hd_t ecbHd;
+    gcry_cipher_hd_t ctrHd;
+} aesKey_t;
+
+static void releaseKey(void* key, int32_t algorithm) {
+    if (key == NULL)
+        return;
+    if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
+        aesKey_t* aes = reinterpret_cast<aesKey_t*>(key);
+        if (aes->ecbHd != NULL)
+            gcry_cipher_close(aes->ecbHd);
+        if (aes->ctrHd != NULL)
+            gcry_cipher_close(aes->ctrHd);
+        memset(key, 0, sizeof(aesKey_t));
+    }
+    else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
+        memset(key, 0, sizeof(Twofish_key));
+    }
+    delete[] (uint8_t*)key;
+}
+
+static gcry_cipher_hd_t openAesHandle(int algo, int mode, const uint8_t* k, int32_t keyLength) {
+    gcry_cipher_hd_t hd;
+
+    if (gcry_cipher_open(&hd, algo, mode, 0) != 0)
+        return NULL;
+    if (gcry_cipher_setkey(hd, k, keyLength) != 0) {
+        gcry_cipher_close(hd);
+        return NULL;
+    }
+    return hd;
+}
+
+SrtpSymCrypto::SrtpSymCrypto(int algo) : key(NULL), gcmCtx(NULL), algorithm(algo) {
     initializeGcrypt();
 }
 
 SrtpSymCrypto::SrtpSymCrypto( uint8_t* k, int32_t keyLength, int algo) :
-    key(NULL),  algorithm(algo) {
+    key(NULL), gcmCtx(NULL), algorithm(algo) {
 
     initializeGcrypt();
     setNewKey(k, keyLength);
 }
 
 SrtpSymCrypto::~SrtpSymCrypto() {
-    if (key) {
-        if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8)
-            gcry_cipher_close(static_cast<gcry_cipher_hd_t>(key));
-        else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
-            memset(key, 0, sizeof(Twofish_key));
-            delete[] (uint8_t*)key;
-        }
-        key = NULL;
-    }
+    releaseKey(key, algorithm);
+    key = NULL;
 }
 
 static int twoFishInit = 0;
@@ -74,12 +116,10 @@ static int twoFishInit = 0;
 bool SrtpSymCrypto::setNewKey(const uint8_t* k, int32_t keyLength) {
 
     // release an existing key before setting a new one
-    if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
-        if (key != NULL) {
-            gcry_cipher_close(static_cast<gcry_cipher_hd_t>(key));
-            key = NULL;
-        }
+    releaseKey(key, algorithm);
+    key = NULL;
 
+    if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
         int algo = 0;
         if (keyLength == 16) {
             algo = GCRY_CIPHER_AES;
@@ -90,19 +130,20 @@ bool SrtpSymCrypto::setNewKey(const uint8_t* k, int32_t keyLength) {
         else {
             return false;
         }
-        gcry_cipher_hd_t tmp;
-        gcry_cipher_open(&tmp, algo, GCRY_CIPHER_MODE_ECB, 0);
-        key = tmp;
-        gcry_cipher_setkey(static_cast<gcry_cipher_hd_t>(key), k, keyLength);
+        aesKey_t* aes = reinterpret_cast<aesKey_t*>(new uint8_t[sizeof(aesKey_t)]);
+        aes->ecbHd = openAesHandle(algo, GCRY_CIPHER_MODE_ECB, k, keyLength);
+        aes->ctrHd = openAesHandle(algo, GCRY_CIPHER_MODE_CTR, k, keyLength);
+        if (aes->ecbHd == NULL || aes->ctrHd == NULL) {
+            releaseKey(aes, algorithm);
+            return false;
+        }
+        key = aes;
     }
     else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
         if (!twoFishInit) {
             Twofish_initialise();
             twoFishInit = 1;
         }
-        if (key != NULL)
-            delete[] (uint8_t*)key;
-
         key = new uint8_t[sizeof(Twofish_key)];
         memset(key, 0, sizeof(Twofish_key));
         Twofish_prepare_key((Twofish_Byte*)k, keyLength,  (Twofish_key*)key);
@@ -117,101 +158,113 @@ bool SrtpSymCrypto::setNewKey(const uint8_t* k, int32_t keyLength) {
 void SrtpSymCrypto::encrypt(const uint8_t* input, uint8_t* output) {
     if (key != NULL) {
         if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8)
-            gcry_cipher_encrypt (static_cast<gcry_cipher_hd_t>(key),
-                                 output, SRTP_BLOCK_SIZE, input, SRTP_BLOCK_SIZE);
+            gcry_cipher_encrypt(reinterpret_cast<aesKey_t*>(key)->ecbHd,
+                                output, SRTP_BLOCK_SIZE, input, SRTP_BLOCK_SIZE);
         else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8)
             Twofish_encrypt((Twofish_key*)key, (Twofish_Byte*)input,
                             (Twofish_Byte*)output);
         }
 }
 
-void SrtpSymCrypto::get_ctr_cipher_stream( uint8_t* output, uint32_t length,
-                                     uint8_t* iv ) {
-    uint16_t ctr = 0;
+void SrtpSymCrypto::encryptBlocks(const uint8_t* input, uint8_t* output, int32_t numBlocks) {
+    if (key != NULL && numBlocks > 0 &&
+        (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8)) {
+        size_t length = (size_t)numBlocks * SRTP_BLOCK_SIZE;
+        gcry_cipher_encrypt(reinterpret_cast<aesKey_t*>(key)->ecbHd, output, length, input, length);
+        return;
+    }
+    for (int32_t i = 0; i < numBlocks; i++) {
+        encrypt(input, output);
+        input += SRTP_BLOCK_SIZE;
+        output += SRTP_BLOCK_SIZE;
+    }
+}
 
+/*
+ * XOR the key stream into output, or store the key stream if input is NULL.
+ *
+ * The counter occupies the last two bytes of the IV, refer to RFC 3711, chapter
+ * 4.1.1. On return these two bytes contain the last used counter value. The
+ * gcrypt counter covers the whole block, for SRTP packets (less than 2^16
+ * blocks) the result is the same.
+ */
+void SrtpSymCrypto::ctrProcess(const uint8_t* input, uint8_t* output, uint32_t length, uint8_t* iv) {
+
+    uint16_t ctr = 0;
     unsigned char temp[SRTP_BLOCK_SIZE];
 
-    for(ctr = 0; ctr < length/SRTP_BLOCK_SIZE; ctr++ ){
-        //compute the cipher stream
+    if (length == 0)
+        return;
+
+    if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
+        gcry_cipher_hd_t hd = reinterpret_cast<aesKey_t*>(key)->ctrHd;
+
+        iv[14] = iv[15] = 0;
+        if (input == NULL) {
+            memset(output, 0, length);
+            input = output;
+        }
+        gcry_cipher_setctr(hd, iv, SRTP_BLOCK_SIZE);
+        if (input == output)
+            gcry_cipher_encrypt(hd, output, length, NULL, 0);
+        else
+            gcry_cipher_encrypt(hd, output, length, input, length);
+
+        ctr = static_cast<uint16_t>((length - 1) / SRTP_BLOCK_SIZE);
         iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
         iv[15] = (uint8_t)((ctr & 0x00FF));
-
-        encrypt(iv, &output[ctr*SRTP_BLOCK_SIZE]);
+        return;
     }
-    if ((length % SRTP_BLOCK_SIZE) > 0) {
-        // Treat the last bytes:
+    while (length > 0) {
+        uint32_t chunk = (length < SRTP_BLOCK_SIZE) ? length : SRTP_BLOCK_SIZE;
+
         iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
         iv[15] = (uint8_t)((ctr & 0x00FF));
+        ctr++;
 
         encrypt(iv, temp);
-        memcpy(&output[ctr*SRTP_BLOCK_SIZE], temp, length % SRTP_BLOCK_SIZE);
+        for (uint32_t i = 0; i < chunk; i++) {
+            *output++ = (input == NULL) ? temp[i] : temp[i] ^ *input++;
+        }
+        length -= chunk;
     }
 }
 
-void SrtpSymCrypto::ctr_encrypt( const uint8_t* input, uint32_t input_length,
-			   uint8_t* output, uint8_t* iv ) {
-
+void SrtpSymCrypto::get_ctr_cipher_stream( uint8_t* output, uint32_t length,
+                                     uint8_t* iv ) {
     if (key == NULL)
         return;
 
-    uint16_t ctr = 0;
-    unsigned char temp[SRTP_BLOCK_SIZE];
-
-    int l = input_length/SRTP_BLOCK_SIZE;
-    for ( ctr = 0; ctr < l; ctr++ ) {
-        iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
-        iv[15] = (uint8_t)((ctr & 0x00FF));
+    ctrProcess(NULL, output, length, iv);
+}
 
-        encrypt(iv, temp);
-        for (int i = 0; i < SRTP_BLOCK_SIZE; i++ ) {
-            *output++ = temp[i] ^ *input++;
-        }
+void SrtpSymCrypto::ctr_encrypt( const uint8_t* input, uint32_t input_length,
+			   uint8_t* output, uint8_t* iv ) {
 
-    }
-    l = input_length % SRTP_BLOCK_SIZE;
-    if (l > 0) {
-        // Treat the last bytes:
-        iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
-        iv[15] = (uint8_t)((ctr & 0x00FF));
+    if (key == NULL)
+        return;
 
-        encrypt(iv, temp);
-        for (int i = 0; i < l; i++ ) {
-            *output++ = temp[i] ^ *input++;
-        }
-    }
+    ctrProcess(input, output, input_length, iv);
 }
 
 void SrtpSymCrypto::ctr_encrypt( uint8_t* data, uint32_t data_length, uint8_t* iv ) {
 
     if (key == NULL)
         return;
-    
-    uint16_t ctr = 0;
-    unsigned char temp[SRTP_BLOCK_SIZE];
 
-    int l = data_length/SRTP_BLOCK_SIZE;
-    for (ctr = 0; ctr < l; ctr++ ) {
-        iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
-        iv[15] = (uint8_t)((ctr & 0x00FF));
+    ctrProcess(data, data, data_length, iv);
+}
 
-        encrypt(iv, temp);
-        for (int i = 0; i < SRTP_BLOCK_SIZE; i++ ) {
-            *data++ ^= temp[i];
-        }
+/* libgcrypt selects its own AES implementation, encrypt the jobs one after the other */
+void SrtpSymCrypto::ctrEncryptLanes(SrtpCtrLane lanes[], int32_t count) {
 
-    }
-    l = data_length % SRTP_BLOCK_SIZE;
-    if (l > 0) {
-        // Treat the last bytes:
-        iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
-        iv[15] = (uint8_t)((ctr & 0x00FF));
+    for (int32_t i = 0; i < count; i++) {
+        SrtpCtrLane* lane = &lanes[i];
 
-        encrypt(iv, temp);
-        for (int i = 0; i < l; i++ ) {
-            *data++ ^= temp[i];
-        }
+        if (lane->cipher == NULL || lane->cipher->key == NULL || lane->length == 0)
+            continue;
+        lane->cipher->ctrProcess(lane->input, lane->output, lane->length, lane->iv);
     }
-
 }
 
 void SrtpSymCrypto::f8_encrypt(const uint8_t* data, uint32_t data_length, uint8_t* iv, SrtpSymCrypto* f8Cipher ) {
@@ -314,7 +367,7 @@ int SrtpSymCrypto::processBlock(F8_CIPHER_CTX *f8ctx, const uint8_t* in, int32_t
      * Now XOR (S(n-1) xor IV') with the current counter, then increment the counter
      */
     ui32p = (uint32_t *)f8ctx->S;
-    ui32p[3] ^= htonl(f8ctx->J);
+    ui32p[3] ^= zrtpBe32(f8ctx->J);
     f8ctx->J++;
     /*
      * Now compute the new key stream using encrypt
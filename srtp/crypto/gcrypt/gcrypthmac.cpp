@@ -20,98 +20,182 @@
  * Authors: Erik Eliasson <eliasson@it.kth.se>
  *          Johan Bilien <jobi@via.ecp.fr>
  */
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <gcrypt.h>
 
-#include <crypto/hmac.h>
-#include <stdio.h>
+#include <srtp/crypto/hmac.h>
+#include <vector>
 
-void hmac_sha1(uint8_t* key, int32_t keyLength,
-                 const uint8_t* data, int32_t dataLength,
-                 uint8_t* mac, int32_t* macLength)
-{
-    gcry_md_hd_t hd;
+extern int initializeGcrypt();
 
-     gcry_md_open(&hd, GCRY_MD_SHA1, GCRY_MD_FLAG_HMAC);
-    gcry_md_setkey(hd, key, keyLength);
+// A copy of the context storage would close the MAC handle twice, SRTP contexts must not share it
+#ifdef ZRTP_SHARED_KEY_SCHEDULES
+#error "The gcrypt backend does not support ZRTP_SHARED_KEY_SCHEDULES"
+#endif
 
-    gcry_md_write (hd, data, dataLength);
+/*
+ * The SHA1 HMAC context storage holds a gcrypt MAC handle. The handle keeps
+ * the key, thus each MAC computation only resets the handle with
+ * gcry_mac_reset and does not open the handle or set the key again.
+ */
+typedef struct _gcryptHmacCtx {
+    gcry_mac_hd_t macHd;
+} gcryptHmacCtx_t;
 
-    uint8_t* p = gcry_md_read (hd, GCRY_MD_SHA1);
-    memcpy(mac, p, SHA1_DIGEST_LENGTH);
-    if (macLength != NULL) {
-        *macLength = SHA1_DIGEST_LENGTH;
+static gcry_mac_hd_t newSha1MacHd(const uint8_t* key, uint64_t keyLength)
+{
+    gcry_mac_hd_t hd;
+
+    initializeGcrypt();
+    if (gcry_mac_open(&hd, GCRY_MAC_HMAC_SHA1, 0, NULL) != 0)
+        return NULL;
+    if (gcry_mac_setkey(hd, key, static_cast<size_t>(keyLength)) != 0) {
+        gcry_mac_close(hd);
+        return NULL;
     }
-    gcry_md_close (hd);
+    return hd;
 }
 
-void hmac_sha1( uint8_t* key, int32_t keyLength,
-                  const uint8_t* dataChunks[],
-                  uint32_t dataChunkLength[],
-                  uint8_t* mac, int32_t* macLength )
+static inline void sha1MacRead(gcry_mac_hd_t hd, uint8_t* mac, uint32_t* macLength)
 {
-    gcry_md_hd_t hd;
+    size_t length = SHA1_DIGEST_LENGTH;
 
-    gcry_md_open(&hd, GCRY_MD_SHA1, GCRY_MD_FLAG_HMAC);
-    gcry_md_setkey(hd, key, keyLength);
+    gcry_mac_read(hd, mac, &length);
+    if (macLength != NULL)
+        *macLength = static_cast<uint32_t>(length);
+}
 
-    while (*dataChunks) {
-        gcry_md_write (hd, *dataChunks, (uint32_t)(*dataChunkLength));
-        dataChunks++;
-        dataChunkLength++;
+void hmac_sha1(const uint8_t* key, int64_t keyLength,
+               const uint8_t* data, uint64_t dataLength,
+               uint8_t* mac, int32_t* macLength)
+{
+    gcry_mac_hd_t hd = newSha1MacHd(key, static_cast<uint64_t>(keyLength));
+
+    if (hd == NULL) {
+        if (macLength != NULL)
+            *macLength = 0;
+        return;
     }
-    uint8_t* p = gcry_md_read (hd, GCRY_MD_SHA1);
-    memcpy(mac, p, SHA1_DIGEST_LENGTH);
-    if (macLength != NULL) {
-        *macLength = SHA1_DIGEST_LENGTH;
+    gcry_mac_write(hd, data, dataLength);
+    sha1MacRead(hd, mac, reinterpret_cast<uint32_t*>(macLength));
+    gcry_mac_close(hd);
+}
+
+void hmac_sha1(const uint8_t* key, uint64_t keyLength,
+               const std::vector<const uint8_t*>& data,
+               const std::vector<uint64_t>& dataLength,
+               uint8_t* mac, int32_t* macLength)
+{
+    gcry_mac_hd_t hd = newSha1MacHd(key, keyLength);
+
+    if (hd == NULL) {
+        if (macLength != NULL)
+            *macLength = 0;
+        return;
     }
-    gcry_md_close (hd);
+    for (size_t i = 0, size = data.size(); i < size; i++) {
+        gcry_mac_write(hd, data[i], dataLength[i]);
+    }
+    sha1MacRead(hd, mac, reinterpret_cast<uint32_t*>(macLength));
+    gcry_mac_close(hd);
 }
 
-void* createSha1HmacContext(uint8_t* key, int32_t key_length)
+void* createSha1HmacContext(const uint8_t* key, uint64_t keyLength)
 {
-    gcry_md_hd_t ctx;
+    gcryptHmacCtx_t* ctx = (gcryptHmacCtx_t*)malloc(sizeof(gcryptHmacCtx_t));
 
-    gcry_md_open(&ctx, GCRY_MD_SHA1, GCRY_MD_FLAG_HMAC);
-    gcry_md_setkey(ctx, key, key_length);
+    ctx->macHd = newSha1MacHd(key, keyLength);
+    if (ctx->macHd == NULL) {
+        free(ctx);
+        return NULL;
+    }
     return ctx;
 }
 
-void hmacSha1Ctx(void* ctx, const uint8_t* data, uint32_t data_length,
-                uint8_t* mac, int32_t* mac_length)
+void* initializeSha1HmacContext(void* ctx, uint8_t* key, uint64_t keyLength)
 {
-    gcry_md_hd_t pctx = (gcry_md_hd_t)ctx;
+    gcryptHmacCtx_t* pctx = (gcryptHmacCtx_t*)ctx;
 
-    gcry_md_reset(pctx);
+    // The context storage must be zero before its first use, refer to releaseSha1HmacContext
+    if (pctx->macHd != NULL && gcry_mac_setkey(pctx->macHd, key, static_cast<size_t>(keyLength)) == 0)
+        return pctx;
 
-    gcry_md_write (pctx, data, data_length);
+    releaseSha1HmacContext(pctx);
+    pctx->macHd = newSha1MacHd(key, keyLength);
+    return pctx;
+}
+
+void hmacSha1Ctx(void* ctx, const uint8_t* data, uint64_t data_length,
+                 uint8_t* mac, int32_t* mac_length)
+{
+    gcry_mac_hd_t hd = ((gcryptHmacCtx_t*)ctx)->macHd;
 
-    uint8_t* p = gcry_md_read (pctx, GCRY_MD_SHA1);
-    memcpy(mac, p, SHA1_DIGEST_LENGTH);
-    if (mac_length != NULL) {
-        *mac_length = SHA1_DIGEST_LENGTH;
+    gcry_mac_reset(hd);
+    gcry_mac_write(hd, data, data_length);
+    sha1MacRead(hd, mac, reinterpret_cast<uint32_t*>(mac_length));
+}
+
+void hmacSha1Ctx(void* ctx,
+                 const std::vector<const uint8_t*>& data,
+                 const std::vector<uint64_t>& dataLength,
+                 uint8_t* mac, uint32_t* macLength)
+{
+    gcry_mac_hd_t hd = ((gcryptHmacCtx_t*)ctx)->macHd;
+
+    gcry_mac_reset(hd);
+    for (size_t i = 0, size = data.size(); i < size; i++) {
+        gcry_mac_write(hd, data[i], dataLength[i]);
+    }
+    sha1MacRead(hd, mac, macLength);
+}
+
+void hmacSha1Ctx(void* ctx, const uint8_t* const data[], const uint64_t dataLength[], size_t count, uint8_t* mac)
+{
+    gcry_mac_hd_t hd = ((gcryptHmacCtx_t*)ctx)->macHd;
+
+    gcry_mac_reset(hd);
+    for (size_t i = 0; i < count; i++) {
+        gcry_mac_write(hd, data[i], dataLength[i]);
     }
+    sha1MacRead(hd, mac, NULL);
 }
 
-void hmacSha1Ctx(void* ctx, const uint8_t* data[], uint32_t data_length[],
-                uint8_t* mac, int32_t* mac_length )
+void hmacSha1Ctx2(void* ctx, const uint8_t* data1, uint64_t data1Length,
+                  const uint8_t* data2, uint64_t data2Length, uint8_t* mac)
 {
-    gcry_md_hd_t pctx = (gcry_md_hd_t)ctx;
+    gcry_mac_hd_t hd = ((gcryptHmacCtx_t*)ctx)->macHd;
 
-    gcry_md_reset (pctx);
-    while (*data) {
-        gcry_md_write (pctx, *data, (uint32_t)(*data_length));
-        data++;
-        data_length++;
+    gcry_mac_reset(hd);
+    gcry_mac_write(hd, data1, data1Length);
+    gcry_mac_write(hd, data2, data2Length);
+    sha1MacRead(hd, mac, NULL);
+}
+
+/* libgcrypt selects its own SHA1 implementation, compute the jobs one after the other */
+void hmacSha1CtxLanes(hmacSha1Lane lanes[], int32_t count)
+{
+    for (int32_t i = 0; i < count; i++) {
+        hmacSha1Ctx2(lanes[i].ctx, lanes[i].data1, lanes[i].data1Length,
+                     lanes[i].data2, lanes[i].data2Length, lanes[i].mac);
     }
-    uint8_t* p = gcry_md_read (pctx, GCRY_MD_SHA1);
-    memcpy(mac, p, SHA1_DIGEST_LENGTH);
-    if (mac_length != NULL) {
-        *mac_length = SHA1_DIGEST_LENGTH;
+}
+
+void releaseSha1HmacContext(void* ctx)
+{
+    gcryptHmacCtx_t* pctx = (gcryptHmacCtx_t*)ctx;
+
+    if (pctx->macHd != NULL) {
+        gcry_mac_close(pctx->macHd);
+        pctx->macHd = NULL;
     }
 }
 
 void freeSha1HmacContext(void* ctx)
 {
-    gcry_md_hd_t pctx = (gcry_md_hd_t)ctx;
-    gcry_md_close (pctx);
+    if (ctx) {
+        releaseSha1HmacContext(ctx);
+        free(ctx);
+    }
 }
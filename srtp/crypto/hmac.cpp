@@ -19,6 +19,7 @@
  */
 
 #include "crypto/hmac.h"
+#include "crypto/sha1_hw.h"
 #include <cstring>
 #include <cstdio>
 
@@ -42,32 +43,37 @@ static int32_t hmacSha1Init(hmacSha1Context *ctx, const uint8_t *key, uint64_t k
     else {
         memcpy(localKey, key, kLength);
     }
-    /* prepare inner hash and hold the context */
+    /* prepare inner hash and keep its chaining state */
     for (i = 0; i < SHA1_BLOCK_SIZE; i++)
         localPad[i] = static_cast<uint_8t >(localKey[i] ^ 0x36);
 
-    sha1_begin(&ctx->innerCtx);
-    sha1_hash(localPad, SHA1_BLOCK_SIZE, &ctx->innerCtx);
+    sha1_begin(&ctx->ctx);
+    sha1_hash(localPad, SHA1_BLOCK_SIZE, &ctx->ctx);
+    memcpy(ctx->innerHash, ctx->ctx.hash, sizeof(ctx->innerHash));
 
-    /* prepare outer hash and hold the context */
+    /* prepare outer hash and keep its chaining state */
     for (i = 0; i < SHA1_BLOCK_SIZE; i++)
         localPad[i] = static_cast<uint_8t >(localKey[i] ^ 0x5c);
 
-    sha1_begin(&ctx->outerCtx);
-    sha1_hash(localPad, SHA1_BLOCK_SIZE, &ctx->outerCtx);
+    sha1_begin(&ctx->ctx);
+    sha1_hash(localPad, SHA1_BLOCK_SIZE, &ctx->ctx);
+    memcpy(ctx->outerHash, ctx->ctx.hash, sizeof(ctx->outerHash));
 
-    /* copy prepared inner hash to work hash - ready to process data */
-    memcpy(&ctx->ctx, &ctx->innerCtx, sizeof(sha1_ctx));
+    /* set prepared inner hash to work hash - ready to process data */
+    memcpy(ctx->ctx.hash, ctx->innerHash, sizeof(ctx->innerHash));
 
     memset(localKey, 0, sizeof(localKey));
+    memset(localPad, 0, sizeof(localPad));
 
     return 1;
 }
 
 static void hmacSha1Reset(hmacSha1Context *ctx)
 {
-    /* copy prepared inner hash to work hash context */
-    memcpy(&ctx->ctx, &ctx->innerCtx, sizeof(sha1_ctx));
+    /* restore the inner chaining state, the ipad block is hashed */
+    memcpy(ctx->ctx.hash, ctx->innerHash, sizeof(ctx->innerHash));
+    ctx->ctx.count[0] = SHA1_BLOCK_SIZE;
+    ctx->ctx.count[1] = 0;
 }
 
 static void hmacSha1Update(hmacSha1Context *ctx, const uint8_t *data, uint64_t dLength)
@@ -76,21 +82,63 @@ static void hmacSha1Update(hmacSha1Context *ctx, const uint8_t *data, uint64_t d
     sha1_hash(data, dLength, &ctx->ctx);
 }
 
+static void hmacSha1Outer(hmacSha1Context *ctx, uint8_t *mac)
+{
+    uint_32t i;
+
+    /*
+     * The outer hash processes exactly one block: the inner digest, the
+     * padding, and the length of opad block plus digest in bits. Build the
+     * block in SHA1 word order and compress it once.
+     */
+    memcpy(ctx->ctx.wbuf, ctx->ctx.hash, SHA1_DIGEST_SIZE);
+    ctx->ctx.wbuf[5] = 0x80000000;
+    for (i = 6; i < 15; i++)
+        ctx->ctx.wbuf[i] = 0;
+    ctx->ctx.wbuf[15] = (SHA1_BLOCK_SIZE + SHA1_DIGEST_SIZE) * 8;
+
+    memcpy(ctx->ctx.hash, ctx->outerHash, sizeof(ctx->outerHash));
+    sha1_compile(&ctx->ctx);
+
+    for (i = 0; i < SHA1_DIGEST_SIZE; ++i)
+        mac[i] = (unsigned char)(ctx->ctx.hash[i >> 2] >> (8 * (~i & 3)));
+}
+
 static void hmacSha1Final(hmacSha1Context *ctx, uint8_t *mac)
 {
-    uint8_t tmpDigest[SHA1_DIGEST_SIZE];
+    /* finalize work hash context, the inner digest is in ctx.hash */
+    sha1_end(mac, &ctx->ctx);
+    hmacSha1Outer(ctx, mac);
+}
 
-    /* finalize work hash context */
-    sha1_end(tmpDigest, &ctx->ctx);
+/*
+ * Inner hash of data that fits into one block together with the padding and
+ * the length, for example a small SRTP audio packet and the ROC. Builds the
+ * padded block in SHA1 word order and compresses it once, without the
+ * buffering of sha1_hash() and sha1_end().
+ */
+static void hmacSha1SingleBlock(hmacSha1Context *ctx, const uint8_t* data1, uint64_t data1Length,
+                                const uint8_t* data2, uint64_t data2Length, uint8_t* mac)
+{
+    uint8_t block[SHA1_BLOCK_SIZE] = {0};
+    uint64_t total = data1Length + data2Length;
+    const uint8_t* p = block;
+    int32_t i;
 
-    /* copy prepared outer hash to work hash */
-    memcpy(&ctx->ctx, &ctx->outerCtx, sizeof(sha1_ctx));
+    if (data1Length > 0)
+        memcpy(block, data1, data1Length);
+    if (data2Length > 0)
+        memcpy(block + data1Length, data2, data2Length);
+    block[total] = 0x80;
 
-    /* hash inner digest to work (outer) hash context */
-    sha1_hash(tmpDigest, SHA1_DIGEST_SIZE, &ctx->ctx);
+    for (i = 0; i < 14; i++, p += 4)
+        ctx->ctx.wbuf[i] = ((uint_32t)p[0] << 24) | ((uint_32t)p[1] << 16) | ((uint_32t)p[2] << 8) | p[3];
+    ctx->ctx.wbuf[14] = 0;
+    ctx->ctx.wbuf[15] = (uint_32t)((SHA1_BLOCK_SIZE + total) * 8);
 
-    /* finalize work hash context to get the hmac*/
-    sha1_end(mac, &ctx->ctx);
+    memcpy(ctx->ctx.hash, ctx->innerHash, sizeof(ctx->innerHash));
+    sha1_compile(&ctx->ctx);
+    hmacSha1Outer(ctx, mac);
 }
 
 
@@ -164,6 +212,146 @@ void hmacSha1Ctx(void* ctx,
     *macLength = SHA1_BLOCK_SIZE;
 }
 
+void hmacSha1Ctx(void* ctx, const uint8_t* const data[], const uint64_t dataLength[], size_t count, uint8_t* mac)
+{
+    auto *pctx = (hmacSha1Context*)ctx;
+
+    hmacSha1Reset(pctx);
+    for (size_t i = 0; i < count; i++) {
+        hmacSha1Update(pctx, data[i], dataLength[i]);
+    }
+    hmacSha1Final(pctx, mac);
+}
+
+void hmacSha1Ctx2(void* ctx, const uint8_t* data1, uint64_t data1Length,
+                  const uint8_t* data2, uint64_t data2Length, uint8_t* mac)
+{
+    auto *pctx = (hmacSha1Context*)ctx;
+
+    /* one block holds the data, the padding byte and the 8 byte length */
+    if (data1Length + data2Length <= SHA1_BLOCK_SIZE - 9) {
+        hmacSha1SingleBlock(pctx, data1, data1Length, data2, data2Length, mac);
+        return;
+    }
+    hmacSha1Reset(pctx);
+    hmacSha1Update(pctx, data1, data1Length);
+    hmacSha1Update(pctx, data2, data2Length);
+    hmacSha1Final(pctx, mac);
+}
+
+/*
+ * Get message block number offset / SHA1_BLOCK_SIZE of a lane in SHA1 word
+ * order: the two data chunks, the SHA1 padding, and in the last block the
+ * length in bits. The length includes the ipad block that is already hashed.
+ */
+static void laneBlock(const hmacSha1Lane* lane, uint64_t offset, uint64_t total, bool last, uint_32t wbuf[16])
+{
+    uint8_t block[SHA1_BLOCK_SIZE];
+    const uint8_t* p = block;
+    int32_t i;
+
+    if (offset + SHA1_BLOCK_SIZE <= lane->data1Length) {
+        p = lane->data1 + offset;
+    }
+    else {
+        for (i = 0; i < SHA1_BLOCK_SIZE; i++) {
+            uint64_t pos = offset + i;
+
+            if (pos < lane->data1Length)
+                block[i] = lane->data1[pos];
+            else if (pos < total)
+                block[i] = lane->data2[pos - lane->data1Length];
+            else
+                block[i] = (uint8_t)((pos == total) ? 0x80 : 0);
+        }
+        if (last) {
+            uint64_t bits = (SHA1_BLOCK_SIZE + total) * 8;
+            for (i = 0; i < 8; i++)
+                block[SHA1_BLOCK_SIZE - 1 - i] = (uint8_t)(bits >> (8 * i));
+        }
+    }
+    for (i = 0; i < 16; i++, p += 4)
+        wbuf[i] = ((uint_32t)p[0] << 24) | ((uint_32t)p[1] << 16) | ((uint_32t)p[2] << 8) | p[3];
+}
+
+void hmacSha1CtxLanes(hmacSha1Lane lanes[], int32_t count)
+{
+    /* The SHA1 instructions are faster than the multi-buffer compression */
+    if (sha1_hw_available() || !sha1_hw_lanes_available()) {
+        for (int32_t i = 0; i < count; i++) {
+            hmacSha1Ctx2(lanes[i].ctx, lanes[i].data1, lanes[i].data1Length,
+                         lanes[i].data2, lanes[i].data2Length, lanes[i].mac);
+        }
+        return;
+    }
+    uint_32t hash[SHA1_HW_LANES][SHA1_DIGEST_SIZE / 4];
+    uint_32t wbuf[SHA1_HW_LANES][16];
+    uint_32t scratchHash[SHA1_DIGEST_SIZE / 4] = {0};
+    uint_32t scratchBuf[16] = {0};
+    uint_32t* hashPtr[SHA1_HW_LANES];
+    const uint_32t* wbufPtr[SHA1_HW_LANES];
+    uint64_t total[SHA1_HW_LANES];
+    uint64_t blocks[SHA1_HW_LANES];
+
+    for (int32_t base = 0; base < count; base += SHA1_HW_LANES) {
+        hmacSha1Lane* lane = lanes + base;
+        int32_t n = (count - base < SHA1_HW_LANES) ? count - base : SHA1_HW_LANES;
+        uint64_t maxBlocks = 0;
+        int32_t j;
+
+        /* inner hash, continue at the chaining state after the ipad block */
+        for (j = 0; j < n; j++) {
+            memcpy(hash[j], ((hmacSha1Context*)lane[j].ctx)->innerHash, sizeof(hash[j]));
+            total[j] = lane[j].data1Length + lane[j].data2Length;
+            blocks[j] = (total[j] + 9 + SHA1_BLOCK_SIZE - 1) / SHA1_BLOCK_SIZE;
+            if (blocks[j] > maxBlocks)
+                maxBlocks = blocks[j];
+        }
+        for (uint64_t b = 0; b < maxBlocks; b++) {
+            for (j = 0; j < SHA1_HW_LANES; j++) {
+                if (j < n && b < blocks[j]) {
+                    laneBlock(&lane[j], b * SHA1_BLOCK_SIZE, total[j], b == blocks[j] - 1, wbuf[j]);
+                    hashPtr[j] = hash[j];
+                    wbufPtr[j] = wbuf[j];
+                }
+                else {
+                    hashPtr[j] = scratchHash;
+                    wbufPtr[j] = scratchBuf;
+                }
+            }
+            sha1_hw_compile_lanes(hashPtr, wbufPtr);
+        }
+
+        /* outer hash, one block with the inner digest, see hmacSha1Final */
+        for (j = 0; j < SHA1_HW_LANES; j++) {
+            if (j < n) {
+                memcpy(wbuf[j], hash[j], SHA1_DIGEST_SIZE);
+                wbuf[j][5] = 0x80000000;
+                memset(&wbuf[j][6], 0, 9 * sizeof(uint_32t));
+                wbuf[j][15] = (SHA1_BLOCK_SIZE + SHA1_DIGEST_SIZE) * 8;
+                memcpy(hash[j], ((hmacSha1Context*)lane[j].ctx)->outerHash, sizeof(hash[j]));
+                hashPtr[j] = hash[j];
+                wbufPtr[j] = wbuf[j];
+            }
+            else {
+                hashPtr[j] = scratchHash;
+                wbufPtr[j] = scratchBuf;
+            }
+        }
+        sha1_hw_compile_lanes(hashPtr, wbufPtr);
+
+        for (j = 0; j < n; j++) {
+            for (int32_t i = 0; i < SHA1_DIGEST_SIZE; ++i)
+                lane[j].mac[i] = (uint8_t)(hash[j][i >> 2] >> (8 * (~i & 3)));
+        }
+    }
+}
+
+void releaseSha1HmacContext(void* ctx)
+{
+    memset(ctx, 0, sizeof(hmacSha1Context));
+}
+
 void freeSha1HmacContext(void* ctx)
 {
     if (ctx) {
@@ -39,10 +39,14 @@
 #define SHA1_DIGEST_LENGTH 20
 #endif
 
+/*
+ * The HMAC context keeps only the SHA1 chaining state after hashing the
+ * ipad and opad blocks. This is all state there is after a full block.
+ */
 typedef struct _hmacSha1Context {
     sha1_ctx ctx;
-    sha1_ctx innerCtx;
-    sha1_ctx outerCtx;
+    uint_32t innerHash[SHA1_DIGEST_SIZE / 4];
+    uint_32t outerHash[SHA1_DIGEST_SIZE / 4];
 } hmacSha1Context;
 
 
@@ -168,6 +172,94 @@ void hmacSha1Ctx(void* ctx,
                  const std::vector<uint64_t>& dataLength,
                  uint8_t* mac, uint32_t* macLength);
 
+/**
+ * Compute SHA1 HMAC over an array of data chunks.
+ *
+ * This functions takes several data chunks and computes the SHA1 HMAC. It
+ * does not allocate memory. On return the SHA1 MAC context is ready to
+ * compute a HMAC for another data chunk.
+ *
+ * @param ctx
+ *     Pointer to initialized SHA1 HMAC context
+ * @param data
+ *    Array of pointers that point to the data chunks.
+ * @param dataLength
+ *    Array of integers that hold the length of each data chunk.
+ * @param count
+ *    Number of data chunks.
+ * @param mac
+ *    Points to a buffer that receives the computed digest. This
+ *    buffer must have a size of at least 20 bytes (SHA1_DIGEST_LENGTH).
+ */
+void hmacSha1Ctx(void* ctx, const uint8_t* const data[], const uint64_t dataLength[], size_t count, uint8_t* mac);
+
+/**
+ * Compute SHA1 HMAC over two data chunks.
+ *
+ * This functions takes two data chunks and computes the SHA1 HMAC, for
+ * example a SRTP packet and its ROC. It does not allocate memory and is
+ * the preferred function for per-packet processing. On return the SHA1
+ * MAC context is ready to compute a HMAC for other data.
+ *
+ * @param ctx
+ *     Pointer to initialized SHA1 HMAC context
+ * @param data1
+ *    Points to the first data chunk.
+ * @param data1Length
+ *    Length of the first data chunk in bytes
+ * @param data2
+ *    Points to the second data chunk.
+ * @param data2Length
+ *    Length of the second data chunk in bytes
+ * @param mac
+ *    Points to a buffer that receives the computed digest. This
+ *    buffer must have a size of at least 20 bytes (SHA1_DIGEST_LENGTH).
+ */
+void hmacSha1Ctx2(void* ctx, const uint8_t* data1, uint64_t data1Length,
+                  const uint8_t* data2, uint64_t data2Length, uint8_t* mac);
+
+/**
+ * One HMAC job of @c hmacSha1CtxLanes.
+ *
+ * The HMAC covers the data chunk followed by the second data chunk, the
+ * same as @c hmacSha1Ctx2.
+ */
+typedef struct _hmacSha1Lane {
+    void* ctx;                          //!< initialized SHA1 HMAC context
+    const uint8_t* data1;               //!< the first data chunk
+    uint64_t data1Length;               //!< length of the first data chunk in bytes
+    const uint8_t* data2;               //!< the second data chunk
+    uint64_t data2Length;               //!< length of the second data chunk in bytes
+    uint8_t mac[SHA1_DIGEST_LENGTH];    //!< receives the computed digest
+} hmacSha1Lane;
+
+/**
+ * Compute the SHA1 HMAC of several independent jobs.
+ *
+ * The jobs may use different contexts, several jobs may use the same context.
+ * If the CPU has no SHA1 instructions but supports a multi-buffer SHA1 then
+ * the function hashes up to eight jobs in parallel, otherwise it calls
+ * @c hmacSha1Ctx2 for each job.
+ *
+ * @param lanes
+ *    The HMAC jobs, the function stores the digests in the jobs.
+ * @param count
+ *    Number of jobs.
+ */
+void hmacSha1CtxLanes(hmacSha1Lane lanes[], int32_t count);
+
+/**
+ * Release the resources of a SHA1 HMAC context.
+ *
+ * The function releases the resources that @c initializeSha1HmacContext
+ * allocated for a context inside application storage, it does not free the
+ * storage. The storage must be zero before the first @c initializeSha1HmacContext,
+ * a context may be initialized again with a new key.
+ *
+ * @param ctx a pointer to SHA1 HMAC context
+ */
+void releaseSha1HmacContext(void* ctx);
+
 /**
  * Free SHA1 HMAC context.
  *
@@ -22,45 +22,106 @@
 
 #include <cstdlib>
 #include <openssl/aes.h>                // the include of openSSL
+#include <openssl/evp.h>
 #include <srtp/crypto/SrtpSymCrypto.h>
 #include <cryptcommon/twofish.h>
+#include <cryptcommon/ghash.h>
+#include <cryptcommon/chacha20.h>
+#include <common/MemoryUsage.h>
+#include <common/zrtpByteOrder.h>
 
-SrtpSymCrypto::SrtpSymCrypto(int algo):key(nullptr), algorithm(algo) {
+// The EVP context of a key keeps per-packet state, SRTP contexts must not share the keys
+#ifdef ZRTP_SHARED_KEY_SCHEDULES
+#error "The OpenSSL backend does not support ZRTP_SHARED_KEY_SCHEDULES"
+#endif
+
+/*
+ * The AES key: the key schedule for single blocks (F8, GCM, ECB) and an EVP
+ * context that is set up for AES-CTR once per key. Each packet only sets the IV
+ * of the EVP context, thus OpenSSL generates the whole key stream of a packet
+ * with its multi-block AES-CTR code in one EVP_EncryptUpdate call.
+ */
+typedef struct _aesKey {
+    AES_KEY aesKey;
+    EVP_CIPHER_CTX* ctrCtx;
+} aesKey_t;
+
+/*
+ * The ChaCha20 key: the SRTP key derivation uses the AES-CM PRF with the master
+ * key (RFC 3711, chapter 4.3.3), thus the key starts with an AES key. The AES
+ * key does not need the EVP context.
+ */
+typedef struct _chachaKey {
+    aesKey_t aes;
+    uint8_t key[CHACHA20_KEY_SIZE];
+} chachaKey_t;
+
+static void releaseKey(void* key, int32_t algorithm) {
+    if (key == nullptr)
+        return;
+    if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
+        auto* aes = reinterpret_cast<aesKey_t*>(key);
+        if (aes->ctrCtx != nullptr)
+            EVP_CIPHER_CTX_free(aes->ctrCtx);
+        memset(key, 0, sizeof(aesKey_t));
+    }
+    else if (algorithm == SrtpEncryptionCHACHA20POLY1305) {
+        memset(key, 0, sizeof(chachaKey_t));
+    }
+    else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
+        memset(key, 0, sizeof(Twofish_key));
+    }
+    delete[] (uint8_t*)key;
+}
+
+SrtpSymCrypto::SrtpSymCrypto(int algo):key(nullptr), ctKey(nullptr), gcmCtx(nullptr), algorithm(algo) {
 }
 
 SrtpSymCrypto::SrtpSymCrypto( uint8_t* k, int32_t keyLength, int algo ):
-    key(nullptr), algorithm(algo) {
+    key(nullptr), ctKey(nullptr), gcmCtx(nullptr), algorithm(algo) {
 
     setNewKey(k, keyLength);
 }
 
 SrtpSymCrypto::~SrtpSymCrypto() {
-    if (key != nullptr) {
-        if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
-            memset(key, 0, sizeof(AES_KEY) );
-        }
-        else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
-            memset(key, 0, sizeof(Twofish_key));
-        }
-        delete[] (uint8_t*)key;
-        key = nullptr;
-    }
+    gcmRelease();
+    releaseKey(key, algorithm);
+    key = nullptr;
 }
 
 static int twoFishInit = 0;
 
 bool SrtpSymCrypto::setNewKey(const uint8_t* k, int32_t keyLength) {
     // release an existing key before setting a new one
-    if (key != nullptr)
-        delete[] (uint8_t*)key;
+    gcmRelease();
+    releaseKey(key, algorithm);
+    key = nullptr;
 
     if (!(keyLength == 16 || keyLength == 32)) {
         return false;
     }
     if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
-        key = new uint8_t[sizeof(AES_KEY)];
-        memset(key, 0, sizeof(AES_KEY) );
-        AES_set_encrypt_key(k, keyLength*8, (AES_KEY *)key);
+        auto* aes = reinterpret_cast<aesKey_t*>(new uint8_t[sizeof(aesKey_t)]);
+        memset(aes, 0, sizeof(aesKey_t));
+        AES_set_encrypt_key(k, keyLength*8, &aes->aesKey);
+
+        aes->ctrCtx = EVP_CIPHER_CTX_new();
+        if (aes->ctrCtx == nullptr ||
+            EVP_EncryptInit_ex(aes->ctrCtx, (keyLength == 16) ? EVP_aes_128_ctr() : EVP_aes_256_ctr(),
+                               nullptr, k, nullptr) != 1) {
+            releaseKey(aes, algorithm);
+            return false;
+        }
+        key = aes;
+    }
+    else if (algorithm == SrtpEncryptionCHACHA20POLY1305) {
+        if (keyLength != CHACHA20_KEY_SIZE)
+            return false;
+        auto* chacha = reinterpret_cast<chachaKey_t*>(new uint8_t[sizeof(chachaKey_t)]);
+        memset(chacha, 0, sizeof(chachaKey_t));
+        AES_set_encrypt_key(k, keyLength*8, &chacha->aes.aesKey);
+        memcpy(chacha->key, k, CHACHA20_KEY_SIZE);
+        key = chacha;
     }
     else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
         if (!twoFishInit) {
@@ -78,9 +139,30 @@ bool SrtpSymCrypto::setNewKey(const uint8_t* k, int32_t keyLength) {
 }
 
 
+/*
+ * The report does not contain the EVP context of the AES key, OpenSSL does
+ * not publish its size.
+ */
+void SrtpSymCrypto::addMemoryUsage(MemoryUsage& usage) const {
+    size_t bytes = sizeof(SrtpSymCrypto);
+
+    if (key != nullptr) {
+        if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8)
+            bytes += sizeof(aesKey_t);
+        else if (algorithm == SrtpEncryptionCHACHA20POLY1305)
+            bytes += sizeof(chachaKey_t);
+        else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8)
+            bytes += sizeof(Twofish_key);
+    }
+    if (gcmCtx != nullptr)
+        bytes += sizeof(ghash_ctx);
+    usage.add(MemoryUsage::Cipher, bytes);
+}
+
 void SrtpSymCrypto::encrypt(const uint8_t* input, uint8_t* output ) {
-    if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
-        AES_encrypt(input, output, (AES_KEY *)key);
+    if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8 ||
+        algorithm == SrtpEncryptionCHACHA20POLY1305) {
+        AES_encrypt(input, output, &reinterpret_cast<aesKey_t*>(key)->aesKey);
     }
     else if (algorithm == SrtpEncryptionTWOCM || algorithm == SrtpEncryptionTWOF8) {
         Twofish_encrypt((Twofish_key*)key, (Twofish_Byte*)input,
@@ -88,59 +170,73 @@ void SrtpSymCrypto::encrypt(const uint8_t* input, uint8_t* output ) {
     }
 }
 
-void SrtpSymCrypto::get_ctr_cipher_stream(uint8_t* output, uint32_t length,
-                                    uint8_t* iv ) {
+void SrtpSymCrypto::encryptBlocks(const uint8_t* input, uint8_t* output, int32_t numBlocks) {
+    for (int32_t i = 0; i < numBlocks; i++) {
+        encrypt(input, output);
+        input += SRTP_BLOCK_SIZE;
+        output += SRTP_BLOCK_SIZE;
+    }
+}
+
+/*
+ * XOR the key stream into output, or store the key stream if input is NULL.
+ *
+ * The counter occupies the last two bytes of the IV, refer to RFC 3711, chapter
+ * 4.1.1. On return these two bytes contain the last used counter value. The
+ * OpenSSL counter covers the whole block, for SRTP packets (less than 2^16
+ * blocks) the result is the same.
+ */
+void SrtpSymCrypto::ctrProcess(const uint8_t* input, uint8_t* output, uint32_t length, uint8_t* iv) {
+
     uint16_t ctr = 0;
     unsigned char temp[SRTP_BLOCK_SIZE];
 
-    for(ctr = 0; ctr < length/SRTP_BLOCK_SIZE; ctr++) {
-        //compute the cipher stream
+    if (length == 0)
+        return;
+
+    if (algorithm == SrtpEncryptionAESCM || algorithm == SrtpEncryptionAESF8) {
+        EVP_CIPHER_CTX* ctx = reinterpret_cast<aesKey_t*>(key)->ctrCtx;
+        int outLength = 0;
+
+        iv[14] = iv[15] = 0;
+        if (input == nullptr) {
+            memset(output, 0, length);
+            input = output;
+        }
+        EVP_EncryptInit_ex(ctx, nullptr, nullptr, nullptr, iv);
+        EVP_EncryptUpdate(ctx, output, &outLength, input, static_cast<int>(length));
+
+        ctr = static_cast<uint16_t>((length - 1) / SRTP_BLOCK_SIZE);
         iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
         iv[15] = (uint8_t)((ctr & 0x00FF));
-
-        encrypt(iv, &output[ctr*SRTP_BLOCK_SIZE]);
+        return;
     }
-    if ((length % SRTP_BLOCK_SIZE) > 0) {
-        // Treat the last bytes:
+    while (length > 0) {
+        uint32_t chunk = (length < SRTP_BLOCK_SIZE) ? length : SRTP_BLOCK_SIZE;
+
         iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
         iv[15] = (uint8_t)((ctr & 0x00FF));
+        ctr++;
 
         encrypt(iv, temp);
-        memcpy(&output[ctr*SRTP_BLOCK_SIZE], temp, length % SRTP_BLOCK_SIZE );
+        for (uint32_t i = 0; i < chunk; i++) {
+            *output++ = (input == nullptr) ? temp[i] : temp[i] ^ *input++;
+        }
+        length -= chunk;
     }
 }
 
+void SrtpSymCrypto::get_ctr_cipher_stream(uint8_t* output, uint32_t length, uint8_t* iv) {
+    ctrProcess(nullptr, output, length, iv);
+}
+
 void SrtpSymCrypto::ctr_encrypt(const uint8_t* input, uint32_t input_length,
                            uint8_t* output, uint8_t* iv ) {
 
     if (key == nullptr)
         return;
 
-    uint16_t ctr = 0;
-    unsigned char temp[SRTP_BLOCK_SIZE];
-
-    int l = input_length/SRTP_BLOCK_SIZE;
-    for (ctr = 0; ctr < l; ctr++ ) {
-        iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
-        iv[15] = (uint8_t)((ctr & 0x00FF));
-
-        encrypt(iv, temp);
-        for (int i = 0; i < SRTP_BLOCK_SIZE; i++ ) {
-            *output++ = temp[i] ^ *input++;
-        }
-
-    }
-    l = input_length % SRTP_BLOCK_SIZE;
-    if (l > 0) {
-        // Treat the last bytes:
-        iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
-        iv[15] = (uint8_t)((ctr & 0x00FF));
-
-        encrypt(iv, temp);
-        for (int i = 0; i < l; i++ ) {
-            *output++ = temp[i] ^ *input++;
-        }
-    }
+    ctrProcess(input, output, input_length, iv);
 }
 
 void SrtpSymCrypto::ctr_encrypt( uint8_t* data, uint32_t data_length, uint8_t* iv ) {
@@ -148,30 +244,37 @@ void SrtpSymCrypto::ctr_encrypt( uint8_t* data, uint32_t data_length, uint8_t* i
     if (key == nullptr)
         return;
 
-    uint16_t ctr = 0;
-    unsigned char temp[SRTP_BLOCK_SIZE];
+    ctrProcess(data, data, data_length, iv);
+}
 
-    int l = data_length/SRTP_BLOCK_SIZE;
-    for (ctr = 0; ctr < l; ctr++ ) {
-        iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
-        iv[15] = (uint8_t)((ctr & 0x00FF));
+/*
+ * XOR data with key stream, use 64 bit words if possible.
+ */
+static inline void xorKeyStream(uint8_t* out, const uint8_t* in, const uint8_t* keyStream, uint32_t length)
+{
+    uint32_t i = 0;
+
+    for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+        uint64_t data, stream;
+        memcpy(&data, in + i, sizeof(uint64_t));
+        memcpy(&stream, keyStream + i, sizeof(uint64_t));
+        data ^= stream;
+        memcpy(out + i, &data, sizeof(uint64_t));
+    }
+    for (; i < length; i++) {
+        out[i] = in[i] ^ keyStream[i];
+    }
+}
 
-        encrypt(iv, temp);
-        for (int i = 0; i < SRTP_BLOCK_SIZE; i++ ) {
-            *data++ ^= temp[i];
-        }
+/* OpenSSL selects its own AES implementation, encrypt the jobs one after the other */
+void SrtpSymCrypto::ctrEncryptLanes(SrtpCtrLane lanes[], int32_t count) {
 
-    }
-    l = data_length % SRTP_BLOCK_SIZE;
-    if (l > 0) {
-        // Treat the last bytes:
-        iv[14] = (uint8_t)((ctr & 0xFF00) >>  8);
-        iv[15] = (uint8_t)((ctr & 0x00FF));
+    for (int32_t i = 0; i < count; i++) {
+        SrtpCtrLane* lane = &lanes[i];
 
-        encrypt(iv, temp);
-        for (int i = 0; i < l; i++ ) {
-            *data++ ^= temp[i];
-        }
+        if (lane->cipher == nullptr || lane->cipher->key == nullptr || lane->length == 0)
+            continue;
+        lane->cipher->ctrProcess(lane->input, lane->output, lane->length, lane->iv);
     }
 }
 
@@ -222,76 +325,190 @@ void SrtpSymCrypto::f8_deriveForIV(SrtpSymCrypto* f8Cipher, uint8_t* key, int32_
 void SrtpSymCrypto::f8_encrypt(const uint8_t* in, uint32_t in_length, uint8_t* out,
                          uint8_t* iv, SrtpSymCrypto* f8Cipher ) {
 
-
-    int offset = 0;
-
-    unsigned char ivAccent[SRTP_BLOCK_SIZE];
-    unsigned char S[SRTP_BLOCK_SIZE];
-
-    F8_CIPHER_CTX f8ctx;
+    /*
+     * IV' and the key stream block S(j) as 32 bit words, thus the F8 chaining
+     * S(j) = E(k_e, IV' XOR j XOR S(j-1)) works on words and not on bytes.
+     */
+    uint32_t ivAccent[SRTP_BLOCK_SIZE / sizeof(uint32_t)];
+    uint32_t S[SRTP_BLOCK_SIZE / sizeof(uint32_t)] = {0};
+    uint32_t J = 0;
 
     if (key == nullptr)
         return;
-    /*
-     * Get memory for the derived IV (IV')
-     */
-    f8ctx.ivAccent = ivAccent;
+
     /*
      * Use the derived IV encryption setup to encrypt the original IV to produce IV'.
+     * IV' depends on the packet's IV, thus compute it for each packet.
      */
-    f8Cipher->encrypt(iv, f8ctx.ivAccent);
-
-    f8ctx.J = 0;                       // initialize the counter
-    f8ctx.S = S;               // get the key stream buffer
+    f8Cipher->encrypt(iv, reinterpret_cast<uint8_t*>(ivAccent));
+
+    while (in_length > 0) {
+        uint32_t chunk = (in_length < SRTP_BLOCK_SIZE) ? in_length : SRTP_BLOCK_SIZE;
+
+        S[0] ^= ivAccent[0];
+        S[1] ^= ivAccent[1];
+        S[2] ^= ivAccent[2];
+        S[3] ^= ivAccent[3] ^ zrtpBe32(J);
+        J++;
+        encrypt(reinterpret_cast<uint8_t*>(S), reinterpret_cast<uint8_t*>(S));
+
+        xorKeyStream(out, in, reinterpret_cast<uint8_t*>(S), chunk);
+        in += chunk;
+        out += chunk;
+        in_length -= chunk;
+    }
+}
 
-    memset(f8ctx.S, 0, SRTP_BLOCK_SIZE); // initial value for key stream
 
-    while (in_length >= SRTP_BLOCK_SIZE) {
-        processBlock(&f8ctx, in+offset, SRTP_BLOCK_SIZE, out+offset);
-        in_length -= SRTP_BLOCK_SIZE;
-        offset += SRTP_BLOCK_SIZE;
+/*
+ * AES-GCM, refer to NIST SP 800-38D and RFC 7714. The hash subkey H is
+ * computed with the first GCM call after a key was set.
+ */
+void SrtpSymCrypto::gcmRelease() {
+    if (gcmCtx != nullptr) {
+        memset(gcmCtx, 0, sizeof(ghash_ctx));
+        delete reinterpret_cast<ghash_ctx*>(gcmCtx);
+        gcmCtx = nullptr;
     }
-    if (in_length > 0) {
-        processBlock(&f8ctx, in+offset, in_length, out+offset);
+}
+
+/*
+ * Compute the GHASH tables if necessary
+ */
+void SrtpSymCrypto::gcmPrepare() {
+    if (gcmCtx == nullptr) {
+        uint8_t h[SRTP_BLOCK_SIZE] = {0};
+        encrypt(h, h);
+        ghash_ctx* ctx = new ghash_ctx;
+        ghash_init(ctx, h);
+        gcmCtx = ctx;
+        memset(h, 0, sizeof(h));
     }
 }
 
-int SrtpSymCrypto::processBlock(F8_CIPHER_CTX *f8ctx, const uint8_t* in, int32_t length, uint8_t* out) {
+/*
+ * Setup J0 = IV || 0^31 || 1, compute the GHASH tables if necessary
+ */
+void SrtpSymCrypto::gcmInit(const uint8_t* iv, uint8_t* j0) {
+    gcmPrepare();
+    memcpy(j0, iv, SRTP_GCM_IV_LENGTH);
+    j0[12] = j0[13] = j0[14] = 0;
+    j0[15] = 1;
+}
+
+/*
+ * Encrypt or decrypt with the 32 bit counter of GCM, the first counter block
+ * is J0 + 1. If y is not nullptr then hash the encrypted data.
+ */
+void SrtpSymCrypto::gcmCtrProcess(uint8_t* data, uint32_t length, const uint8_t* j0, uint8_t* y) {
 
-    int i;
-    const uint8_t *cp_in;
-    uint8_t* cp_in1, *cp_out;
-    uint32_t *ui32p;
+    uint8_t ctrBlocks[SRTP_CTR_BLOCKS * SRTP_BLOCK_SIZE];
+    uint8_t keyStream[SRTP_CTR_BLOCKS * SRTP_BLOCK_SIZE];
+    uint32_t ctr = ((uint32_t)j0[12] << 24) | ((uint32_t)j0[13] << 16) | ((uint32_t)j0[14] << 8) | j0[15];
 
-    /*
-     * XOR the previous key stream with IV'
-     * ( S(-1) xor IV' )
-     */
-    cp_in = f8ctx->ivAccent;
-    cp_out = f8ctx->S;
-    for (i = 0; i < SRTP_BLOCK_SIZE; i++) {
-        *cp_out++ ^= *cp_in++;
+    for (int32_t i = 0; i < SRTP_CTR_BLOCKS; i++) {
+        memcpy(ctrBlocks + i * SRTP_BLOCK_SIZE, j0, SRTP_GCM_IV_LENGTH);
     }
-    /*
-     * Now XOR (S(n-1) xor IV') with the current counter, then increment the counter
-     */
-    ui32p = (uint32_t *)f8ctx->S;
-    ui32p[3] ^= zrtpHtonl(f8ctx->J);
-    f8ctx->J++;
-    /*
-     * Now compute the new key stream using AES encrypt
-     */
-    encrypt(f8ctx->S, f8ctx->S);
-    /*
-     * as the last step XOR the plain text with the key stream to produce
-     * the ciphertext.
-     */
-    cp_out = out;
-    cp_in = in;
-    cp_in1 = f8ctx->S;
-    for (i = 0; i < length; i++) {
-        *cp_out++ = *cp_in++ ^ *cp_in1++;
+    while (length > 0) {
+        uint32_t chunk = (length < sizeof(keyStream)) ? length : sizeof(keyStream);
+        int32_t numBlocks = (chunk + SRTP_BLOCK_SIZE - 1) / SRTP_BLOCK_SIZE;
+
+        for (int32_t i = 0; i < numBlocks; i++) {
+            ctr++;
+            ctrBlocks[i * SRTP_BLOCK_SIZE + 12] = (uint8_t)(ctr >> 24);
+            ctrBlocks[i * SRTP_BLOCK_SIZE + 13] = (uint8_t)(ctr >> 16);
+            ctrBlocks[i * SRTP_BLOCK_SIZE + 14] = (uint8_t)(ctr >> 8);
+            ctrBlocks[i * SRTP_BLOCK_SIZE + 15] = (uint8_t)ctr;
+        }
+        encryptBlocks(ctrBlocks, keyStream, numBlocks);
+        xorKeyStream(data, data, keyStream, chunk);
+
+        if (y != nullptr)
+            ghash_update(reinterpret_cast<ghash_ctx*>(gcmCtx), y, data, chunk);
+
+        data += chunk;
+        length -= chunk;
     }
-    return length;
 }
 
+/*
+ * Hash the length block and compute the tag: E(K, J0) XOR GHASH
+ */
+void SrtpSymCrypto::gcmTag(uint8_t* y, uint32_t aadLen, uint32_t dataLen, const uint8_t* j0, uint8_t* tag) {
+
+    uint8_t lengths[SRTP_BLOCK_SIZE] = {0};
+    uint64_t aadBits = (uint64_t)aadLen * 8;
+    uint64_t dataBits = (uint64_t)dataLen * 8;
+
+    for (int32_t i = 7; i >= 0; i--) {
+        lengths[i] = (uint8_t)aadBits;
+        lengths[i + 8] = (uint8_t)dataBits;
+        aadBits >>= 8;
+        dataBits >>= 8;
+    }
+    ghash_update(reinterpret_cast<ghash_ctx*>(gcmCtx), y, lengths, sizeof(lengths));
+
+    encrypt(j0, tag);
+    for (int32_t i = 0; i < SRTP_GCM_TAG_LENGTH; i++)
+        tag[i] ^= y[i];
+}
+
+void SrtpSymCrypto::gcm_encrypt(uint8_t* data, uint32_t dataLen, const uint8_t* aad, uint32_t aadLen, const uint8_t* iv, uint8_t* tag) {
+
+    uint8_t j0[SRTP_BLOCK_SIZE];
+    uint8_t y[SRTP_BLOCK_SIZE] = {0};
+
+    if (key == nullptr)
+        return;
+
+    gcmInit(iv, j0);
+
+    ghash_update(reinterpret_cast<ghash_ctx*>(gcmCtx), y, aad, aadLen);
+    gcmCtrProcess(data, dataLen, j0, y);
+    gcmTag(y, aadLen, dataLen, j0, tag);
+}
+
+bool SrtpSymCrypto::gcm_decrypt(uint8_t* data, uint32_t dataLen, const uint8_t* aad, uint32_t aadLen, const uint8_t* iv, const uint8_t* tag) {
+
+    uint8_t j0[SRTP_BLOCK_SIZE];
+    uint8_t y[SRTP_BLOCK_SIZE] = {0};
+    uint8_t computed[SRTP_BLOCK_SIZE];
+    uint8_t diff = 0;
+
+    if (key == nullptr)
+        return false;
+
+    gcmInit(iv, j0);
+
+    ghash_update(reinterpret_cast<ghash_ctx*>(gcmCtx), y, aad, aadLen);
+    ghash_update(reinterpret_cast<ghash_ctx*>(gcmCtx), y, data, dataLen);
+    gcmTag(y, aadLen, dataLen, j0, computed);
+
+    // compare in constant time
+    for (int32_t i = 0; i < SRTP_GCM_TAG_LENGTH; i++)
+        diff |= computed[i] ^ tag[i];
+    if (diff != 0)
+        return false;
+
+    gcmCtrProcess(data, dataLen, j0, nullptr);
+    return true;
+}
+
+/*
+ * ChaCha20-Poly1305, refer to RFC 8439 and chapter 8.1 and 9.1 of RFC 7714 for the IV.
+ */
+void SrtpSymCrypto::chacha_encrypt(uint8_t* data, uint32_t dataLen, const uint8_t* aad, uint32_t aadLen, const uint8_t* iv, uint8_t* tag) {
+
+    if (key == nullptr || algorithm != SrtpEncryptionCHACHA20POLY1305)
+        return;
+
+    chacha20_poly1305_encrypt(reinterpret_cast<chachaKey_t*>(key)->key, iv, data, dataLen, aad, aadLen, tag);
+}
+
+bool SrtpSymCrypto::chacha_decrypt(uint8_t* data, uint32_t dataLen, const uint8_t* aad, uint32_t aadLen, const uint8_t* iv, const uint8_t* tag) {
+
+    if (key == nullptr || algorithm != SrtpEncryptionCHACHA20POLY1305)
+        return false;
+
+    return chacha20_poly1305_decrypt(reinterpret_cast<chachaKey_t*>(key)->key, iv, data, dataLen, aad, aadLen, tag) != 0;
+}
@@ -19,7 +19,12 @@
  */
 
 #include <cstdint>
+#include <cstdlib>
 #include <openssl/hmac.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#endif
 #include <srtp/crypto/hmac.h>
 #include <vector>
 
@@ -32,6 +37,162 @@ void hmac_sha1(const uint8_t* key, int64_t keyLength,
          reinterpret_cast<uint32_t*>(macLength));
 }
 
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+/*
+ * OpenSSL 3 provides HMAC via the EVP_MAC interface only. The SHA1 HMAC context
+ * storage holds a pointer to the EVP_MAC_CTX. The context keeps the key, thus
+ * each MAC computation only restarts the context and does not fetch the MAC
+ * algorithm or set the key again.
+ */
+typedef struct _evpHmacCtx {
+    EVP_MAC_CTX* macCtx;
+} evpHmacCtx_t;
+
+static EVP_MAC* sha1Mac = nullptr;
+
+static EVP_MAC_CTX* newSha1MacCtx(const uint8_t* key, uint64_t keyLength)
+{
+    static const char digest[] = "SHA1";
+
+    // EVP_MAC_fetch is expensive, fetch the algorithm once and keep it
+    if (sha1Mac == nullptr) {
+        EVP_MAC* mac = EVP_MAC_fetch(nullptr, "HMAC", nullptr);
+        if (mac == nullptr)
+            return nullptr;
+        if (!__sync_bool_compare_and_swap(&sha1Mac, nullptr, mac))
+            EVP_MAC_free(mac);
+    }
+    EVP_MAC_CTX* ctx = EVP_MAC_CTX_new(sha1Mac);
+    if (ctx == nullptr)
+        return nullptr;
+
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<char*>(digest), 0),
+        OSSL_PARAM_construct_end()
+    };
+    if (EVP_MAC_init(ctx, key, static_cast<size_t>(keyLength), params) != 1) {
+        EVP_MAC_CTX_free(ctx);
+        return nullptr;
+    }
+    return ctx;
+}
+
+static inline void sha1MacFinal(EVP_MAC_CTX* ctx, uint8_t* mac, uint32_t* macLength)
+{
+    size_t length = 0;
+
+    EVP_MAC_final(ctx, mac, &length, SHA1_DIGEST_LENGTH);
+    if (macLength != nullptr)
+        *macLength = static_cast<uint32_t>(length);
+}
+
+void hmac_sha1(const uint8_t* key, uint64_t keyLength,
+               const std::vector<const uint8_t*>& data,
+               const std::vector<uint64_t>& dataLength,
+               uint8_t* mac, int32_t* macLength) {
+    EVP_MAC_CTX* ctx = newSha1MacCtx(key, keyLength);
+
+    if (ctx == nullptr) {
+        *macLength = 0;
+        return;
+    }
+    for (size_t i = 0, size = data.size(); i < size; i++) {
+        EVP_MAC_update(ctx, data[i], dataLength[i]);
+    }
+    sha1MacFinal(ctx, mac, reinterpret_cast<uint32_t*>(macLength));
+    EVP_MAC_CTX_free(ctx);
+}
+
+void* createSha1HmacContext(const uint8_t* key, uint64_t keyLength)
+{
+    auto* ctx = (evpHmacCtx_t*)malloc(sizeof(evpHmacCtx_t));
+
+    ctx->macCtx = newSha1MacCtx(key, keyLength);
+    if (ctx->macCtx == nullptr) {
+        free(ctx);
+        return nullptr;
+    }
+    return ctx;
+}
+
+void* initializeSha1HmacContext(void* ctx, uint8_t* key, uint64_t keyLength)
+{
+    auto* pctx = (evpHmacCtx_t*)ctx;
+
+    // The context storage must be zero before its first use, refer to releaseSha1HmacContext
+    if (pctx->macCtx != nullptr && EVP_MAC_init(pctx->macCtx, key, static_cast<size_t>(keyLength), nullptr) == 1)
+        return pctx;
+
+    releaseSha1HmacContext(pctx);
+    pctx->macCtx = newSha1MacCtx(key, keyLength);
+    return pctx;
+}
+
+void hmacSha1Ctx(void* ctx, const uint8_t* data, uint64_t data_length,
+                 uint8_t* mac, int32_t* mac_length)
+{
+    EVP_MAC_CTX* pctx = ((evpHmacCtx_t*)ctx)->macCtx;
+
+    EVP_MAC_init(pctx, nullptr, 0, nullptr);
+    EVP_MAC_update(pctx, data, data_length);
+    sha1MacFinal(pctx, mac, reinterpret_cast<uint32_t*>(mac_length));
+}
+
+void hmacSha1Ctx(void* ctx,
+                 const std::vector<const uint8_t*>& data,
+                 const std::vector<uint64_t>& dataLength,
+                 uint8_t* mac, uint32_t* macLength)
+{
+    EVP_MAC_CTX* pctx = ((evpHmacCtx_t*)ctx)->macCtx;
+
+    EVP_MAC_init(pctx, nullptr, 0, nullptr);
+    for (size_t i = 0, size = data.size(); i < size; i++) {
+        EVP_MAC_update(pctx, data[i], dataLength[i]);
+    }
+    sha1MacFinal(pctx, mac, macLength);
+}
+
+void hmacSha1Ctx(void* ctx, const uint8_t* const data[], const uint64_t dataLength[], size_t count, uint8_t* mac)
+{
+    EVP_MAC_CTX* pctx = ((evpHmacCtx_t*)ctx)->macCtx;
+
+    EVP_MAC_init(pctx, nullptr, 0, nullptr);
+    for (size_t i = 0; i < count; i++) {
+        EVP_MAC_update(pctx, data[i], dataLength[i]);
+    }
+    sha1MacFinal(pctx, mac, nullptr);
+}
+
+void hmacSha1Ctx2(void* ctx, const uint8_t* data1, uint64_t data1Length,
+                  const uint8_t* data2, uint64_t data2Length, uint8_t* mac)
+{
+    EVP_MAC_CTX* pctx = ((evpHmacCtx_t*)ctx)->macCtx;
+
+    EVP_MAC_init(pctx, nullptr, 0, nullptr);
+    EVP_MAC_update(pctx, data1, data1Length);
+    EVP_MAC_update(pctx, data2, data2Length);
+    sha1MacFinal(pctx, mac, nullptr);
+}
+
+void releaseSha1HmacContext(void* ctx)
+{
+    auto* pctx = (evpHmacCtx_t*)ctx;
+
+    if (pctx->macCtx != nullptr) {
+        EVP_MAC_CTX_free(pctx->macCtx);
+        pctx->macCtx = nullptr;
+    }
+}
+
+void freeSha1HmacContext(void* ctx)
+{
+    if (ctx) {
+        releaseSha1HmacContext(ctx);
+        free(ctx);
+    }
+}
+
+#else
 void hmac_sha1(const uint8_t* key, uint64_t keyLength,
                const std::vector<const uint8_t*>& data,
                const std::vector<uint64_t>& dataLength,
@@ -88,10 +249,49 @@ void hmacSha1Ctx(void* ctx,
     HMAC_Final(pctx, mac, reinterpret_cast<uint32_t*>(macLength) );
 }
 
+void hmacSha1Ctx(void* ctx, const uint8_t* const data[], const uint64_t dataLength[], size_t count, uint8_t* mac)
+{
+    auto* pctx = (HMAC_CTX*)ctx;
+    uint32_t macLength;
+
+    HMAC_Init_ex(pctx, nullptr, 0, nullptr, nullptr);
+    for (size_t i = 0; i < count; i++) {
+        HMAC_Update(pctx, data[i], dataLength[i]);
+    }
+    HMAC_Final(pctx, mac, &macLength);
+}
+
+void hmacSha1Ctx2(void* ctx, const uint8_t* data1, uint64_t data1Length,
+                  const uint8_t* data2, uint64_t data2Length, uint8_t* mac)
+{
+    auto* pctx = (HMAC_CTX*)ctx;
+    uint32_t macLength;
+
+    HMAC_Init_ex(pctx, nullptr, 0, nullptr, nullptr);
+    HMAC_Update(pctx, data1, data1Length);
+    HMAC_Update(pctx, data2, data2Length);
+    HMAC_Final(pctx, mac, &macLength);
+}
+
+void releaseSha1HmacContext(void* ctx)
+{
+    HMAC_CTX_cleanup((HMAC_CTX*)ctx);
+}
+
 void freeSha1HmacContext(void* ctx)
 {
     if (ctx) {
         HMAC_CTX_cleanup((HMAC_CTX*)ctx);
         free(ctx);
     }
-}
\ No newline at end of file
+}
+#endif
+
+/* OpenSSL selects its own SHA1 implementation, compute the jobs one after the other */
+void hmacSha1CtxLanes(hmacSha1Lane lanes[], int32_t count)
+{
+    for (int32_t i = 0; i < count; i++) {
+        hmacSha1Ctx2(lanes[i].ctx, lanes[i].data1, lanes[i].data1Length,
+                     lanes[i].data2, lanes[i].data2Length, lanes[i].mac);
+    }
+}
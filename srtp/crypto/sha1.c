@@ -36,6 +36,7 @@
 #include <string.h>     /* for memcpy() etc.        */
 
 #include "sha1.h"
+#include "sha1_hw.h"
 
 #if defined(__cplusplus)
 extern "C"
@@ -112,7 +113,7 @@ extern "C"
     one_cycle(v, 2,3,4,0,1, f,k,hf(i+3));   \
     one_cycle(v, 1,2,3,4,0, f,k,hf(i+4))
 
-VOID_RETURN sha1_compile(sha1_ctx ctx[1])
+static void sha1_compile_c(sha1_ctx ctx[1])
 {   uint_32t    *w = ctx->wbuf;
 
 #ifdef ARRAY
@@ -168,6 +169,14 @@ VOID_RETURN sha1_compile(sha1_ctx ctx[1])
 #endif
 }
 
+VOID_RETURN sha1_compile(sha1_ctx ctx[1])
+{
+    if (sha1_hw_available())
+        sha1_hw_compile(ctx->hash, ctx->wbuf);
+    else
+        sha1_compile_c(ctx);
+}
+
 VOID_RETURN sha1_begin(sha1_ctx ctx[1])
 {
     ctx->count[0] = ctx->count[1] = 0;
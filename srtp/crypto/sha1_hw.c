@@ -0,0 +1,302 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Hardware SHA1 compression for x86 (SHA extensions) and AArch64 (ARMv8
+ * Crypto Extensions).
+ *
+ * sha1_compile gets the message words already converted to host byte
+ * order, thus the functions load the words without a byte swap. The
+ * functions use the target attribute to enable the instructions only for
+ * the functions that use them.
+ *
+ * On x86 the file also contains a multi-buffer compression that uses AVX2
+ * and computes eight independent blocks, one in each 32 bit lane.
+ */
+
+#include "sha1_hw.h"
+
+#include <common/cpuFeatures.h>
+
+#if !defined(SHA1_NO_HW) && (defined(__GNUC__) || defined(__clang__))
+#  if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || __GNUC__ >= 5)
+#    define SHA1_HW_X86
+#  elif defined(__aarch64__) && !defined(__AARCH64EB__) && (defined(__clang__) || __GNUC__ >= 6)
+#    define SHA1_HW_ARM
+#  endif
+#endif
+
+#if defined(SHA1_HW_X86)
+
+#include <immintrin.h>
+
+#define SHA1_HW_TARGET __attribute__((target("sha,sse4.1")))
+
+static int checkCpu(void)
+{
+    return (zrtpCpuFeatures() & ZRTP_CPU_SHA1) ? 1 : 0;
+}
+
+/* Four rounds, compute the next message words while the rounds run */
+#define ROUNDS4(ein, eout, m, mNext, mXor, mLast, f)    \
+    ein = _mm_sha1nexte_epu32(ein, m);                  \
+    eout = abcd;                                        \
+    mNext = _mm_sha1msg2_epu32(mNext, m);               \
+    abcd = _mm_sha1rnds4_epu32(abcd, ein, f);           \
+    mLast = _mm_sha1msg1_epu32(mLast, m);               \
+    mXor = _mm_xor_si128(mXor, m)
+
+SHA1_HW_TARGET
+void sha1_hw_compile(uint_32t hash[5], const uint_32t wbuf[16])
+{
+    __m128i abcd, abcdSave, e0, e0Save, e1;
+    __m128i msg0, msg1, msg2, msg3;
+
+    /* SHA1 instructions expect A and W0 in the highest lane */
+    abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)hash), 0x1b);
+    e0 = _mm_set_epi32((int)hash[4], 0, 0, 0);
+    abcdSave = abcd;
+    e0Save = e0;
+
+    msg0 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)wbuf), 0x1b);
+    msg1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(wbuf + 4)), 0x1b);
+    msg2 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(wbuf + 8)), 0x1b);
+    msg3 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(wbuf + 12)), 0x1b);
+
+    /* Rounds 0 - 11 */
+    e0 = _mm_add_epi32(e0, msg0);
+    e1 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+    e1 = _mm_sha1nexte_epu32(e1, msg1);
+    e0 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+    msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+    e0 = _mm_sha1nexte_epu32(e0, msg2);
+    e1 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+    msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+    msg0 = _mm_xor_si128(msg0, msg2);
+
+    /* Rounds 12 - 67 */
+    ROUNDS4(e1, e0, msg3, msg0, msg1, msg2, 0);
+    ROUNDS4(e0, e1, msg0, msg1, msg2, msg3, 0);
+    ROUNDS4(e1, e0, msg1, msg2, msg3, msg0, 1);
+    ROUNDS4(e0, e1, msg2, msg3, msg0, msg1, 1);
+    ROUNDS4(e1, e0, msg3, msg0, msg1, msg2, 1);
+    ROUNDS4(e0, e1, msg0, msg1, msg2, msg3, 1);
+    ROUNDS4(e1, e0, msg1, msg2, msg3, msg0, 1);
+    ROUNDS4(e0, e1, msg2, msg3, msg0, msg1, 2);
+    ROUNDS4(e1, e0, msg3, msg0, msg1, msg2, 2);
+    ROUNDS4(e0, e1, msg0, msg1, msg2, msg3, 2);
+    ROUNDS4(e1, e0, msg1, msg2, msg3, msg0, 2);
+    ROUNDS4(e0, e1, msg2, msg3, msg0, msg1, 2);
+    ROUNDS4(e1, e0, msg3, msg0, msg1, msg2, 3);
+    ROUNDS4(e0, e1, msg0, msg1, msg2, msg3, 3);
+
+    /* Rounds 68 - 79 */
+    e1 = _mm_sha1nexte_epu32(e1, msg1);
+    e0 = abcd;
+    msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+    abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+    msg3 = _mm_xor_si128(msg3, msg1);
+
+    e0 = _mm_sha1nexte_epu32(e0, msg2);
+    e1 = abcd;
+    msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+    abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+
+    e1 = _mm_sha1nexte_epu32(e1, msg3);
+    e0 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+    e0 = _mm_sha1nexte_epu32(e0, e0Save);
+    abcd = _mm_add_epi32(abcd, abcdSave);
+
+    _mm_storeu_si128((__m128i*)hash, _mm_shuffle_epi32(abcd, 0x1b));
+    hash[4] = (uint_32t)_mm_extract_epi32(e0, 3);
+}
+
+#define SHA1_LANES_TARGET __attribute__((target("avx2")))
+
+static int checkCpuLanes(void)
+{
+    return (zrtpCpuFeatures() & ZRTP_CPU_AVX2) ? 1 : 0;
+}
+
+#define ROTL(x, n)  _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - (n)))
+
+/* Gather word i of the eight lanes into one vector */
+#define GATHER(p, i)  _mm256_set_epi32((int)p[7][i], (int)p[6][i], (int)p[5][i], (int)p[4][i], \
+                                       (int)p[3][i], (int)p[2][i], (int)p[1][i], (int)p[0][i])
+
+SHA1_LANES_TARGET
+void sha1_hw_compile_lanes(uint_32t *hash[SHA1_HW_LANES], const uint_32t *wbuf[SHA1_HW_LANES])
+{
+    static const uint_32t k[4] = { 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6 };
+    __m256i a, b, c, d, e, f, t, w[16];
+    __m256i state[5];
+    uint_32t out[SHA1_HW_LANES];
+    int i, j;
+
+    for (i = 0; i < 5; i++)
+        state[i] = GATHER(hash, i);
+    for (i = 0; i < 16; i++)
+        w[i] = GATHER(wbuf, i);
+
+    a = state[0]; b = state[1]; c = state[2]; d = state[3]; e = state[4];
+
+    for (i = 0; i < 80; i++) {
+        if (i >= 16) {
+            t = _mm256_xor_si256(_mm256_xor_si256(w[(i - 3) & 15], w[(i - 8) & 15]),
+                                 _mm256_xor_si256(w[(i - 14) & 15], w[i & 15]));
+            w[i & 15] = ROTL(t, 1);
+        }
+        if (i < 20)             /* ch */
+            f = _mm256_xor_si256(d, _mm256_and_si256(b, _mm256_xor_si256(c, d)));
+        else if (i >= 40 && i < 60)     /* maj */
+            f = _mm256_or_si256(_mm256_and_si256(b, c), _mm256_and_si256(d, _mm256_or_si256(b, c)));
+        else                    /* parity */
+            f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+
+        t = _mm256_add_epi32(_mm256_add_epi32(ROTL(a, 5), f),
+                             _mm256_add_epi32(_mm256_add_epi32(e, w[i & 15]), _mm256_set1_epi32((int)k[i / 20])));
+        e = d;
+        d = c;
+        c = ROTL(b, 30);
+        b = a;
+        a = t;
+    }
+    state[0] = _mm256_add_epi32(state[0], a);
+    state[1] = _mm256_add_epi32(state[1], b);
+    state[2] = _mm256_add_epi32(state[2], c);
+    state[3] = _mm256_add_epi32(state[3], d);
+    state[4] = _mm256_add_epi32(state[4], e);
+
+    for (i = 0; i < 5; i++) {
+        _mm256_storeu_si256((__m256i*)out, state[i]);
+        for (j = 0; j < SHA1_HW_LANES; j++)
+            hash[j][i] = out[j];
+    }
+}
+
+#elif defined(SHA1_HW_ARM)
+
+#include <arm_neon.h>
+
+#if defined(__clang__)
+#  define SHA1_HW_TARGET __attribute__((target("crypto")))
+#else
+#  define SHA1_HW_TARGET __attribute__((target("+crypto")))
+#endif
+
+static int checkCpu(void)
+{
+    return (zrtpCpuFeatures() & ZRTP_CPU_SHA1) ? 1 : 0;
+}
+
+SHA1_HW_TARGET
+void sha1_hw_compile(uint_32t hash[5], const uint_32t wbuf[16])
+{
+    static const uint32_t k[4] = { 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6 };
+    uint32x4_t abcd, abcdSave, msg[4], tmp[2];
+    uint32_t e[2], e0Save;
+    int g;
+
+    abcd = vld1q_u32(hash);
+    e[0] = hash[4];
+    abcdSave = abcd;
+    e0Save = e[0];
+
+    msg[0] = vld1q_u32(wbuf);
+    msg[1] = vld1q_u32(wbuf + 4);
+    msg[2] = vld1q_u32(wbuf + 8);
+    msg[3] = vld1q_u32(wbuf + 12);
+
+    tmp[0] = vaddq_u32(msg[0], vdupq_n_u32(k[0]));
+    tmp[1] = vaddq_u32(msg[1], vdupq_n_u32(k[0]));
+
+    /* 20 groups of four rounds, E alternates between e[0] and e[1] */
+    for (g = 0; g < 20; g++) {
+        uint32_t ein = e[g & 1];
+
+        e[(g + 1) & 1] = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        if (g < 5)
+            abcd = vsha1cq_u32(abcd, ein, tmp[g & 1]);
+        else if (g >= 10 && g < 15)
+            abcd = vsha1mq_u32(abcd, ein, tmp[g & 1]);
+        else
+            abcd = vsha1pq_u32(abcd, ein, tmp[g & 1]);
+
+        if (g < 18)
+            tmp[g & 1] = vaddq_u32(msg[(g + 2) & 3], vdupq_n_u32(k[(g + 2) / 5]));
+        if (g >= 1 && g < 17)
+            msg[(g + 3) & 3] = vsha1su1q_u32(msg[(g + 3) & 3], msg[(g + 2) & 3]);
+        if (g < 16)
+            msg[g & 3] = vsha1su0q_u32(msg[g & 3], msg[(g + 1) & 3], msg[(g + 2) & 3]);
+    }
+    abcd = vaddq_u32(abcd, abcdSave);
+    vst1q_u32(hash, abcd);
+    hash[4] = e[0] + e0Save;
+}
+
+static int checkCpuLanes(void)
+{
+    return 0;
+}
+
+void sha1_hw_compile_lanes(uint_32t *hash[SHA1_HW_LANES], const uint_32t *wbuf[SHA1_HW_LANES])
+{
+    (void)hash;
+    (void)wbuf;
+}
+
+#else
+
+static int checkCpu(void)
+{
+    return 0;
+}
+
+void sha1_hw_compile(uint_32t hash[5], const uint_32t wbuf[16])
+{
+    (void)hash;
+    (void)wbuf;
+}
+
+static int checkCpuLanes(void)
+{
+    return 0;
+}
+
+void sha1_hw_compile_lanes(uint_32t *hash[SHA1_HW_LANES], const uint_32t *wbuf[SHA1_HW_LANES])
+{
+    (void)hash;
+    (void)wbuf;
+}
+
+#endif
+
+int sha1_hw_available(void)
+{
+    return checkCpu();
+}
+
+int sha1_hw_lanes_available(void)
+{
+    return checkCpuLanes();
+}
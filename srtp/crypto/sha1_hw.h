@@ -0,0 +1,95 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SHA1_HW_H
+#define _SHA1_HW_H
+
+/**
+ * @file sha1_hw.h
+ * @brief Hardware SHA1 compression function
+ *
+ * The functions use the SHA extensions (SHA-NI) on x86 and the ARMv8 Crypto
+ * Extensions on AArch64. The standard @c sha1_compile function dispatches to
+ * the hardware function at runtime if the CPU supports the instructions.
+ *
+ * Define @c SHA1_NO_HW to disable the hardware support at compile time.
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <cryptcommon/brg_types.h>
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/**
+ * @brief Check if the CPU supports the SHA1 instructions.
+ *
+ * The function checks the CPU features only once and caches the result.
+ *
+ * @return 1 if hardware SHA1 is available, 0 otherwise
+ */
+int sha1_hw_available(void);
+
+/**
+ * @brief Compress one 64 byte block into the SHA1 chaining state.
+ *
+ * Call this function only if @c sha1_hw_available() returned 1.
+ *
+ * @param hash the five 32 bit words of the SHA1 chaining state
+ * @param wbuf the 16 message words of the block in host byte order, as
+ *        prepared for @c sha1_compile
+ */
+void sha1_hw_compile(uint_32t hash[5], const uint_32t wbuf[16]);
+
+/** Number of blocks that @c sha1_hw_compile_lanes compresses in parallel */
+#define SHA1_HW_LANES 8
+
+/**
+ * @brief Check if the CPU supports the multi-buffer SHA1 compression.
+ *
+ * The multi-buffer function uses AVX2 on x86.
+ *
+ * @return 1 if @c sha1_hw_compile_lanes is available, 0 otherwise
+ */
+int sha1_hw_lanes_available(void);
+
+/**
+ * @brief Compress eight independent 64 byte blocks into eight SHA1 chaining states.
+ *
+ * Each 32 bit lane of the vector registers computes the rounds of one block.
+ * This is faster than eight calls of the portable compression function, but
+ * usually slower than the SHA1 instructions. All pointers must be valid, a
+ * caller that has less than eight blocks uses scratch buffers for the unused
+ * lanes. Call this function only if @c sha1_hw_lanes_available() returned 1.
+ *
+ * @param hash the chaining states, five 32 bit words each
+ * @param wbuf the 16 message words of each block in host byte order, as
+ *        prepared for @c sha1_compile
+ */
+void sha1_hw_compile_lanes(uint_32t *hash[SHA1_HW_LANES], const uint_32t *wbuf[SHA1_HW_LANES]);
+
+#if defined(__cplusplus)
+}
+#endif
+
+/**
+ * @}
+ */
+#endif
@@ -109,6 +109,29 @@ Base32::~Base32() {
     binaryResult = NULL;
 }
 
+int Base32::b2a(const unsigned char* data, int noOfBits, char* buffer, size_t bufferLength) {
+    int quintets = divceil(noOfBits, 5);
+
+    if (noOfBits < 0 || bufferLength < (size_t)quintets + 1)
+        return -1;
+
+    /* quintet n holds the bits 5n ... 5n+4, most significant bit first, zero
+     * bits beyond the data as the Duff's device of b2a_l produces them
+     */
+    int lengthInBytes = (noOfBits + 7) / 8;
+    for (int n = 0; n < quintets; n++) {
+        int bit = n * 5;
+        int byte = bit / 8;
+        unsigned int x = (unsigned int)data[byte] << 8;
+
+        if (byte + 1 < lengthInBytes)
+            x |= data[byte + 1];
+        buffer[n] = chars[(x >> (11 - bit % 8)) & 0x1f];
+    }
+    buffer[quintets] = '\0';
+    return quintets;
+}
+
 const unsigned char* Base32::getDecoded(int &length) {
     length = resultLength;
     return binaryResult;
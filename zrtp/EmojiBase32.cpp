@@ -181,3 +181,29 @@ shared_ptr<string> EmojiBase32::u32StringToUtf8(const u32string& in)
     }
     return result;
 }
+
+int EmojiBase32::b2aUtf8(const unsigned char* data, size_t noOfBits, char* buffer, size_t bufferLength)
+{
+    size_t quintets = static_cast<size_t>(divceil(static_cast<int>(noOfBits), 5));
+    size_t lengthInBytes = (noOfBits + 7) / 8;
+    size_t offset = 0;
+
+    for (size_t n = 0; n < quintets; n++) {
+        size_t bit = n * 5;
+        size_t byte = bit / 8;
+        unsigned int x = static_cast<unsigned int>(data[byte]) << 8;
+
+        if (byte + 1 < lengthInBytes)
+            x |= data[byte + 1];
+        char32_t emoji = emojis[(x >> (11 - bit % 8)) & 0x1f];
+
+        // The longest UTF-8 sequence has 4 bytes, keep room for the nul
+        if (offset + 4 + 1 > bufferLength)
+            return -1;
+        U8_APPEND_UNSAFE(buffer, offset, emoji);
+    }
+    if (offset + 1 > bufferLength)
+        return -1;
+    buffer[offset] = '\0';
+    return static_cast<int>(offset);
+}
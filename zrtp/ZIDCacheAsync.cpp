@@ -0,0 +1,203 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <libzrtpcpp/ZIDCacheAsync.h>
+#include <libzrtpcpp/ZIDCache.h>
+
+/*
+ * The I/O worker thread. The destructor runs the queued requests before it
+ * stops the thread, thus queued saves reach the cache.
+ */
+class CacheWorker {
+public:
+    CacheWorker(): running(false), busy(false) {}
+
+    ~CacheWorker();
+
+    void submit(std::function<void()> request);
+
+    void flush();
+
+private:
+    void run();
+
+    std::mutex lock;
+    std::condition_variable wakeup;
+    std::condition_variable idle;
+    std::thread worker;
+    std::deque<std::function<void()> > requests;
+    bool running;
+    bool busy;
+};
+
+CacheWorker::~CacheWorker()
+{
+    flush();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        running = false;
+        wakeup.notify_one();
+    }
+    if (worker.joinable())
+        worker.join();
+}
+
+void CacheWorker::submit(std::function<void()> request)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    requests.push_back(std::move(request));
+    if (!running) {
+        running = true;
+        worker = std::thread(&CacheWorker::run, this);
+    }
+    wakeup.notify_one();
+}
+
+void CacheWorker::flush()
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    while (running && (busy || !requests.empty()))
+        idle.wait(guard);
+}
+
+void CacheWorker::run()
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    while (running) {
+        if (requests.empty()) {
+            idle.notify_all();
+            wakeup.wait(guard);
+            continue;
+        }
+        std::function<void()> request = std::move(requests.front());
+        requests.pop_front();
+
+        // Run the request without holding the lock, the cache access may block
+        busy = true;
+        guard.unlock();
+        request();
+        request = nullptr;
+        guard.lock();
+        busy = false;
+    }
+    idle.notify_all();
+}
+
+static CacheWorker cacheWorker;
+
+void ZIDCacheAsync::getRecordAsync(const uint8_t* zid, std::function<void(ZIDRecord*)> callback)
+{
+    std::shared_ptr<uint8_t> peerZid(new uint8_t[IDENTIFIER_LEN], std::default_delete<uint8_t[]>());
+    memcpy(peerZid.get(), zid, IDENTIFIER_LEN);
+
+    // A cache that failed to open in the background provides no records
+    cacheWorker.submit([peerZid, callback]() {
+        ZIDCache* zidCache = getZidCacheInstance();
+        callback(zidCache->isOpen() ? zidCache->getRecord(peerZid.get()) : NULL);
+    });
+}
+
+std::future<ZIDRecord*> ZIDCacheAsync::prefetchRecord(const uint8_t* zid)
+{
+    std::shared_ptr<std::promise<ZIDRecord*> > result = std::make_shared<std::promise<ZIDRecord*> >();
+    std::future<ZIDRecord*> future = result->get_future();
+
+    getRecordAsync(zid, [result](ZIDRecord* zidRecord) { result->set_value(zidRecord); });
+    return future;
+}
+
+void ZIDCacheAsync::saveRecordAsync(ZIDRecord* zidRecord)
+{
+    std::shared_ptr<ZIDRecord> copy(zidRecord->clone());
+
+    cacheWorker.submit([copy]() {
+        ZIDCache* zidCache = getZidCacheInstance();
+        if (zidCache->isOpen())
+            zidCache->saveRecord(copy.get());
+    });
+}
+
+void ZIDCacheAsync::flush()
+{
+    cacheWorker.flush();
+}
+
+/*
+ * The result of the last openAsync(). The state avoids the lock if the
+ * application never opens the cache in the background or the open finished.
+ */
+enum OpenState {
+    OpenNone,
+    OpenPending,
+    OpenDone
+};
+
+static std::atomic<int32_t> openState(OpenNone);
+static std::mutex openLock;
+static std::shared_future<int32_t> openResult;
+
+void ZIDCacheAsync::openAsync(const std::string& name)
+{
+    std::shared_ptr<std::promise<int32_t> > result = std::make_shared<std::promise<int32_t> >();
+    {
+        std::lock_guard<std::mutex> guard(openLock);
+        openResult = result->get_future().share();
+        openState.store(OpenPending, std::memory_order_release);
+    }
+    cacheWorker.submit([name, result]() {
+        ZIDCache* zidCache = getZidCacheInstance();
+        int32_t rc = zidCache->isOpen() ? 1 : zidCache->open(const_cast<char*>(name.c_str()));
+
+        // Hold the lock, a new openAsync() may have replaced the result
+        std::lock_guard<std::mutex> guard(openLock);
+        result->set_value(rc);
+        if (openResult.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            openState.store(OpenDone, std::memory_order_release);
+    });
+}
+
+bool ZIDCacheAsync::isOpenPending()
+{
+    return openState.load(std::memory_order_acquire) == OpenPending;
+}
+
+int32_t ZIDCacheAsync::waitOpen()
+{
+    if (openState.load(std::memory_order_acquire) == OpenNone)
+        return 1;
+
+    std::shared_future<int32_t> result;
+    {
+        std::lock_guard<std::mutex> guard(openLock);
+        result = openResult;
+    }
+    return result.get();
+}
@@ -22,12 +22,29 @@
 #include <string>
 #include <ctime>
 #include <cstdlib>
+#include <cstring>
+#include <chrono>
 
 #include <libzrtpcpp/ZIDCacheDb.h>
 #include <cryptcommon/aes.h>
 
 
-static ZIDCacheDb* instance;
+static ZIDCache* instance;
+
+/*
+ * memset_volatile is a volatile pointer to the memset function, the
+ * compiler does not optimise the call away that clears the cache key.
+ */
+static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
+
+// Export, import and compaction release the lock after each batch of records
+static const int32_t batchRecords = 1000;
+
+// The ZID filter uses filterBitsPerZid bits and filterHashes bit positions per ZID,
+// about 2% false positives. It doubles if it holds more ZIDs.
+static const size_t filterBitsPerZid = 8;
+static const int32_t filterHashes = 4;
+static const size_t filterMinimumBits = 1 << 16;
 
 /**
  * A poor man's factory.
@@ -44,40 +61,406 @@ ZIDCache* getZidCacheInstance() {
     return instance;
 }
 
+ZIDCache* setZidCacheInstance(ZIDCache* cache) {
+    ZIDCache* previous = instance;
+
+    instance = cache;
+    return previous;
+}
+
 
 ZIDCacheDb::~ZIDCacheDb() {
     close();
 }
 
 int ZIDCacheDb::open(char* name) {
+    std::lock_guard<std::mutex> guard(cacheLock);
 
     // check for an already active ZID file
     if (zidFile != nullptr) {
         return 0;
     }
-    if (cacheOps.openCache(name, &zidFile, errorBuffer) == 0)
+    int rc;
+    if (cacheKey.empty()) {
+        rc = cacheOps.openCache(name, &zidFile, errorBuffer);
+    }
+    else {
+        rc = cacheOps.openCacheKeyed(name, &zidFile, &cacheKey[0], static_cast<int32_t>(cacheKey.size()),
+                                     rawCacheKey ? 1 : 0, kdfIterations, errorBuffer);
+    }
+    if (rc == 0)
         cacheOps.readLocalZid(zidFile, associatedZid, NULL, errorBuffer);
     else {
         cacheOps.closeCache(zidFile);
         zidFile = NULL;
     }
-
+    if (zidFile != NULL && safetyWindow > 0) {
+        cacheOps.configureJournal(zidFile, 1, synchronousLevel, errorBuffer);
+        startWriter();
+    }
+    else if (zidFile != NULL && poolSize > 0) {
+        cacheOps.configureJournal(zidFile, 1, 2, errorBuffer);
+    }
+    // The connections of the pool need the key too
+    if (zidFile != NULL && poolSize > 0) {
+        openPool(name);
+    }
+    if (!cacheKey.empty()) {
+        memset_volatile(&cacheKey[0], 0, cacheKey.size());
+        cacheKey.clear();
+    }
+    if (zidFile != NULL) {
+        buildFilter(0);
+        loadAccountZids();
+    }
     return ((zidFile == NULL) ? -1 : 1);
 }
 
 void ZIDCacheDb::close() {
 
+    stopWriter();
+    closePool();
+
+    std::lock_guard<std::mutex> guard(cacheLock);
     if (zidFile != NULL) {
+        writePending();
         cacheOps.closeCache(zidFile);
         zidFile = NULL;
     }
+    zidFilter.clear();
+    filterCount = 0;
+    accountZids.clear();
+}
+
+/*
+ * Open the connections of the pool. A connection that fails to open just
+ * reduces the pool, without connections the lookups use the main connection.
+ */
+void ZIDCacheDb::openPool(char *name) {
+    std::lock_guard<std::mutex> guard(poolLock);
+
+    for (int32_t i = 0; i < poolSize; i++) {
+        void *connection = NULL;
+        int rc;
+        if (cacheKey.empty()) {
+            rc = cacheOps.openCacheConnection(name, &connection, NULL, 0, 0, 0, errorBuffer);
+        }
+        else {
+            rc = cacheOps.openCacheConnection(name, &connection, &cacheKey[0], static_cast<int32_t>(cacheKey.size()),
+                                              rawCacheKey ? 1 : 0, kdfIterations, errorBuffer);
+        }
+        if (rc != 0) {
+            cacheOps.closeCache(connection);
+            break;
+        }
+        connections.push_back(connection);
+        idleConnections.push_back(connection);
+    }
+}
+
+/*
+ * Wait until the lookups returned their connections, then close them, a
+ * lookup that waits for a connection gets none.
+ */
+void ZIDCacheDb::closePool() {
+    std::unique_lock<std::mutex> guard(poolLock);
+
+    poolCondition.wait(guard, [this] { return idleConnections.size() == connections.size(); });
+    for (auto connection : connections)
+        cacheOps.closeCache(connection);
+    connections.clear();
+    idleConnections.clear();
+    poolCondition.notify_all();
+}
+
+void *ZIDCacheDb::acquireConnection() {
+    std::unique_lock<std::mutex> guard(poolLock);
+
+    poolCondition.wait(guard, [this] { return !idleConnections.empty() || connections.empty(); });
+    if (connections.empty())
+        return NULL;
+    void *connection = idleConnections.back();
+    idleConnections.pop_back();
+    return connection;
+}
+
+void ZIDCacheDb::releaseConnection(void *connection) {
+    std::lock_guard<std::mutex> guard(poolLock);
+
+    idleConnections.push_back(connection);
+    poolCondition.notify_all();
+}
+
+void ZIDCacheDb::setConnectionPool(int32_t numConnections) {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    poolSize = (numConnections < 0) ? 0 : numConnections;
+}
+
+/*
+ * Read the local ZIDs of all accounts in one query, getAccountZid then needs
+ * no database access for a known account.
+ */
+void ZIDCacheDb::loadAccountZids() {
+    uint8_t zid[IDENTIFIER_LEN];
+    char account[1024];
+
+    accountZids.clear();
+    void *stmt = cacheOps.prepareReadAccountZids(zidFile, errorBuffer);
+    while ((stmt = cacheOps.readNextAccountZid(zidFile, stmt, zid, account, sizeof(account), errorBuffer)) != NULL) {
+        // readLocalZid uses the first ZID of an account
+        accountZids.insert(std::make_pair(std::string(account), std::string((const char*)zid, IDENTIFIER_LEN)));
+    }
+}
+
+int32_t ZIDCacheDb::getAccountZid(const std::string& account, uint8_t *zid) {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    if (zidFile == NULL) {
+        return -1;
+    }
+    if (account.empty()) {
+        memcpy(zid, associatedZid, IDENTIFIER_LEN);
+        return 1;
+    }
+    std::map<std::string, std::string>::const_iterator it = accountZids.find(account);
+    if (it != accountZids.end()) {
+        memcpy(zid, it->second.data(), IDENTIFIER_LEN);
+        return 1;
+    }
+    if (cacheOps.readLocalZid(zidFile, zid, account.c_str(), errorBuffer) != 0) {
+        return -1;
+    }
+    accountZids[account] = std::string((const char*)zid, IDENTIFIER_LEN);
+    return 1;
+}
+
+/*
+ * Read the ZIDs of all peer records and add them to a new filter. The filter
+ * has room for at least minimumZids ZIDs.
+ */
+void ZIDCacheDb::buildFilter(size_t minimumZids) {
+    std::vector<std::string> zids;
+    ZIDRecordDb zidRec;
+
+    void *stmt = cacheOps.prepareReadLocalZid(zidFile, associatedZid, errorBuffer);
+    while ((stmt = cacheOps.readNextZidRecord(zidFile, stmt, zidRec.getRecordData(), errorBuffer)) != NULL) {
+        zids.emplace_back((const char*)zidRec.getIdentifier(), IDENTIFIER_LEN);
+    }
+    if (minimumZids < zids.size() * 2)
+        minimumZids = zids.size() * 2;
+
+    size_t bits = filterMinimumBits;
+    while (bits < minimumZids * filterBitsPerZid)
+        bits <<= 1;
+
+    zidFilter.assign(bits / 64, 0);
+    filterCount = 0;
+    for (auto& zid : zids)
+        addToFilter((const uint8_t*)zid.data());
+}
+
+/*
+ * The ZIDs are random, their words are good hashes. Double hashing gives
+ * the bit positions.
+ */
+static void filterPositions(const uint8_t *zid, size_t mask, size_t* positions) {
+    uint32_t words[3];
+
+    memcpy(words, zid, sizeof(words));
+    uint64_t h1 = ((uint64_t)words[0] << 32) | words[1];
+    uint64_t h2 = (uint64_t)words[2] | 1;
+    for (int32_t i = 0; i < filterHashes; i++)
+        positions[i] = (size_t)(h1 + i * h2) & mask;
+}
+
+void ZIDCacheDb::addToFilter(const uint8_t *zid) {
+    size_t positions[filterHashes];
+
+    if (zidFilter.empty())
+        return;
+    if (filterCount * filterBitsPerZid >= zidFilter.size() * 64) {
+        buildFilter(filterCount * 2);           // adds this ZID too if the database contains it
+        if (mayContain(zid))
+            return;
+    }
+    filterPositions(zid, zidFilter.size() * 64 - 1, positions);
+    for (int32_t i = 0; i < filterHashes; i++)
+        zidFilter[positions[i] / 64] |= (uint64_t)1 << (positions[i] % 64);
+    filterCount++;
+}
+
+bool ZIDCacheDb::mayContain(const uint8_t *zid) {
+    size_t positions[filterHashes];
+
+    // Without filter all ZIDs may be in the database
+    if (zidFilter.empty())
+        return true;
+    filterPositions(zid, zidFilter.size() * 64 - 1, positions);
+    for (int32_t i = 0; i < filterHashes; i++) {
+        if ((zidFilter[positions[i] / 64] & ((uint64_t)1 << (positions[i] % 64))) == 0)
+            return false;
+    }
+    return true;
+}
+
+void ZIDCacheDb::startWriter() {
+
+    if (!writerRunning) {
+        writerRunning = true;
+        writer = std::thread(&ZIDCacheDb::runWriter, this);
+    }
+}
+
+void ZIDCacheDb::stopWriter() {
+    std::thread stopped;
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        if (!writerRunning) {
+            return;
+        }
+        writerRunning = false;
+        writerCondition.notify_one();
+        stopped.swap(writer);
+    }
+    // Join outside of the lock, the writer needs the lock to terminate
+    stopped.join();
+}
+
+void ZIDCacheDb::runWriter() {
+    std::unique_lock<std::mutex> guard(cacheLock);
+
+    while (writerRunning) {
+        if (pendingRecords.empty()) {
+            writerCondition.wait(guard);
+            continue;
+        }
+        // Collect the records saved during the window, stop waiting only if the writer stops
+        writerCondition.wait_for(guard, std::chrono::milliseconds(safetyWindow), [this] { return !writerRunning; });
+        writePending();
+    }
+}
+
+void ZIDCacheDb::writePending() {
+
+    if (pendingRecords.empty() || zidFile == NULL) {
+        return;
+    }
+    cacheOps.beginTransaction(zidFile, errorBuffer);
+    for (auto& pending : pendingRecords) {
+        cacheOps.updateRemoteZidRecord(zidFile, (const uint8_t*)pending.first.data(), associatedZid,
+                                       &pending.second, errorBuffer);
+    }
+    cacheOps.commitTransaction(zidFile, errorBuffer);
+    pendingRecords.clear();
+}
+
+bool ZIDCacheDb::setCacheKey(const uint8_t *key, int32_t keyLength, bool rawKey, int32_t kdfIterations) {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    if (!cacheKey.empty()) {
+        memset_volatile(&cacheKey[0], 0, cacheKey.size());
+    }
+    cacheKey.assign(key, key + keyLength);
+    rawCacheKey = rawKey;
+    this->kdfIterations = kdfIterations;
+    return true;
+}
+
+void ZIDCacheDb::setCrashSafetyWindow(int32_t milliseconds) {
+    bool disable = false;
+
+    if (milliseconds < 0) {
+        milliseconds = 0;
+    }
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        disable = safetyWindow > 0 && milliseconds == 0;
+        bool enable = safetyWindow == 0 && milliseconds > 0;
+        safetyWindow = milliseconds;
+
+        // open() configures the database if it is not open yet
+        if (zidFile == NULL) {
+            return;
+        }
+        if (enable) {
+            cacheOps.configureJournal(zidFile, 1, synchronousLevel, errorBuffer);
+            startWriter();
+        }
+    }
+    if (disable) {
+        stopWriter();
+
+        std::lock_guard<std::mutex> guard(cacheLock);
+        // The pool mode keeps the write ahead log
+        if (zidFile != NULL) {
+            writePending();
+            cacheOps.configureJournal(zidFile, poolSize > 0 ? 1 : 0, 2, errorBuffer);
+        }
+    }
+}
+
+void ZIDCacheDb::setSynchronousLevel(int32_t level) {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    synchronousLevel = level;
+    if (zidFile != NULL && safetyWindow > 0) {
+        cacheOps.configureJournal(zidFile, 1, synchronousLevel, errorBuffer);
+    }
 }
 
 ZIDRecord *ZIDCacheDb::getRecord(unsigned char *zid) {
-    ZIDRecordDb *zidRecord = new ZIDRecordDb();
+    return lookupRecord(zid, new ZIDRecordDb());
+}
+
+ZIDRecord *ZIDCacheDb::getRecordInto(unsigned char *zid, ZIDRecordStorage& storage) {
+    return lookupRecord(zid, storage.construct<ZIDRecordDb>());
+}
 
-    cacheOps.readRemoteZidRecord(zidFile, zid, associatedZid, zidRecord->getRecordData(), errorBuffer);
+// A queued record is newer than the record in the database
+bool ZIDCacheDb::readPending(unsigned char *zid, ZIDRecordDb *zidRecord) {
+    auto pending = pendingRecords.find(std::string((const char*)zid, IDENTIFIER_LEN));
+    if (pending == pendingRecords.end()) {
+        return false;
+    }
+    *zidRecord->getRecordData() = pending->second;
+    zidRecord->setZid(zid);
+    return true;
+}
 
+ZIDRecord *ZIDCacheDb::lookupRecord(unsigned char *zid, ZIDRecordDb *zidRecord) {
+    std::unique_lock<std::mutex> guard(cacheLock);
+
+    if (readPending(zid, zidRecord)) {
+        return zidRecord;
+    }
+    // A new peer needs no lookup, its record is not in the database
+    bool known = mayContain(zid);
+
+    // Read a known peer with a connection of the pool, without the lock
+    if (known && poolSize > 0) {
+        uint8_t localZid[IDENTIFIER_LEN];
+
+        memcpy(localZid, associatedZid, IDENTIFIER_LEN);
+        guard.unlock();
+        void *connection = acquireConnection();
+        if (connection != NULL) {
+            int rc = cacheOps.readRemoteZidRecord(connection, zid, localZid, zidRecord->getRecordData(), NULL);
+            releaseConnection(connection);
+            if (rc == 0 && zidRecord->isValid()) {
+                zidRecord->setZid(zid);
+                return zidRecord;
+            }
+        }
+        // Another thread may have saved or created the record meanwhile
+        guard.lock();
+        if (readPending(zid, zidRecord)) {
+            return zidRecord;
+        }
+    }
+    if (known) {
+        cacheOps.readRemoteZidRecord(zidFile, zid, associatedZid, zidRecord->getRecordData(), errorBuffer);
+    }
     zidRecord->setZid(zid);
 
     // We need to create a new ZID record.
@@ -85,24 +468,52 @@ ZIDRecord *ZIDCacheDb::getRecord(unsigned char *zid) {
         zidRecord->setValid();
         zidRecord->getRecordData()->secureSince = (int64_t)time(NULL);
         cacheOps.insertRemoteZidRecord(zidFile, zid, associatedZid, zidRecord->getRecordData(), errorBuffer);
+        addToFilter(zid);
     }
     return zidRecord;
 }
 
 unsigned int ZIDCacheDb::saveRecord(ZIDRecord *zidRec) {
+    std::lock_guard<std::mutex> guard(cacheLock);
     ZIDRecordDb *zidRecord = reinterpret_cast<ZIDRecordDb *>(zidRec);
 
+    if (writerRunning) {
+        // The writer starts the window when it gets the first record
+        if (pendingRecords.empty()) {
+            writerCondition.notify_one();
+        }
+        pendingRecords[std::string((const char*)zidRecord->getIdentifier(), IDENTIFIER_LEN)] = *zidRecord->getRecordData();
+        return 1;
+    }
     cacheOps.updateRemoteZidRecord(zidFile, zidRecord->getIdentifier(), associatedZid, zidRecord->getRecordData(), errorBuffer);
     return 1;
 }
 
 int32_t ZIDCacheDb::getPeerName(const uint8_t *peerZid, std::string *name) {
+    std::unique_lock<std::mutex> guard(cacheLock);
     zidNameRecord_t nameRec;
     char buffer[201] = {'\0'};
+    void *connection = NULL;
 
     nameRec.name = buffer;
     nameRec.nameLength = 200;
-    cacheOps.readZidNameRecord(zidFile, peerZid, associatedZid, NULL, &nameRec, errorBuffer);
+    if (poolSize > 0) {
+        uint8_t localZid[IDENTIFIER_LEN];
+
+        memcpy(localZid, associatedZid, IDENTIFIER_LEN);
+        guard.unlock();
+        connection = acquireConnection();
+        if (connection != NULL) {
+            cacheOps.readZidNameRecord(connection, peerZid, localZid, NULL, &nameRec, NULL);
+            releaseConnection(connection);
+        }
+        else {
+            guard.lock();
+        }
+    }
+    if (connection == NULL) {
+        cacheOps.readZidNameRecord(zidFile, peerZid, associatedZid, NULL, &nameRec, errorBuffer);
+    }
     if ((nameRec.flags & Valid) != Valid) {
         return 0;
     }
@@ -111,6 +522,7 @@ int32_t ZIDCacheDb::getPeerName(const uint8_t *peerZid, std::string *name) {
 }
 
 void ZIDCacheDb::putPeerName(const uint8_t *peerZid, const std::string name) {
+    std::lock_guard<std::mutex> guard(cacheLock);
     zidNameRecord_t nameRec;
     char buffer[201] = {'\0'};
 
@@ -132,11 +544,19 @@ void ZIDCacheDb::putPeerName(const uint8_t *peerZid, const std::string name) {
 }
 
 void ZIDCacheDb::cleanup() {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    // The records belong to the old local ZID
+    pendingRecords.clear();
     cacheOps.cleanCache(zidFile, errorBuffer);
     cacheOps.readLocalZid(zidFile, associatedZid, NULL, errorBuffer);
+    loadAccountZids();
 }
 
 void *ZIDCacheDb::prepareReadAll() {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    writePending();
     return cacheOps.prepareReadAllZid(zidFile, errorBuffer);
 }
 
@@ -178,6 +598,7 @@ void ZIDCacheDb::formatOutput(remoteZidRecord_t *remZid, const char *nameBuffer,
 }
 
 void *ZIDCacheDb::readNextRecord(void *stmt, std::string *output) {
+    std::lock_guard<std::mutex> guard(cacheLock);
     void *iStmnt = stmt;
     zidNameRecord_t nameRec;
     ZIDRecordDb zidRec;
@@ -199,5 +620,128 @@ void *ZIDCacheDb::readNextRecord(void *stmt, std::string *output) {
 }
 
 void ZIDCacheDb::closeOpenStatment(void *stmt) {
+    std::lock_guard<std::mutex> guard(cacheLock);
     cacheOps.closeStatement(stmt);
 }
+
+int32_t ZIDCacheDb::exportRecords(FILE* out) {
+    std::unique_lock<std::mutex> guard(cacheLock);
+    ZIDRecordDb zidRec;
+    zidExportRecord_t data;
+    int32_t count = 0;
+
+    if (zidFile == NULL || ZIDCacheExport::writeHeader(out, associatedZid) < 0) {
+        return -1;
+    }
+    writePending();
+    void *stmt = cacheOps.prepareReadLocalZid(zidFile, associatedZid, errorBuffer);
+    while ((stmt = cacheOps.readNextZidRecord(zidFile, stmt, zidRec.getRecordData(), errorBuffer)) != NULL) {
+        if (!zidRec.isValid())
+            continue;
+        zidRec.getExportData(&data);
+        if (ZIDCacheExport::writeRecord(out, &data) < 0) {
+            cacheOps.closeStatement(stmt);
+            return -1;
+        }
+        // Let lookups of live calls run between the batches
+        if (++count % batchRecords == 0) {
+            guard.unlock();
+            guard.lock();
+        }
+    }
+    return count;
+}
+
+int32_t ZIDCacheDb::importRecords(FILE* in) {
+    std::unique_lock<std::mutex> guard(cacheLock);
+    ZIDRecordDb zidRec;
+    zidExportRecord_t data;
+    uint8_t ownZid[IDENTIFIER_LEN];
+    int32_t count = 0;
+    int32_t result;
+
+    if (zidFile == NULL || ZIDCacheExport::readHeader(in, ownZid) < 0) {
+        return -1;
+    }
+    writePending();
+    if (memcmp(ownZid, associatedZid, IDENTIFIER_LEN) != 0) {
+        void *stmt = cacheOps.prepareReadLocalZid(zidFile, associatedZid, errorBuffer);
+        if ((stmt = cacheOps.readNextZidRecord(zidFile, stmt, zidRec.getRecordData(), errorBuffer)) != NULL) {
+            cacheOps.closeStatement(stmt);
+            return -1;
+        }
+        // A new cache takes over the identity of the exporting cache
+        if (cacheOps.writeLocalZid(zidFile, ownZid, NULL, errorBuffer) != 0) {
+            return -1;
+        }
+        memcpy(associatedZid, ownZid, IDENTIFIER_LEN);
+    }
+    cacheOps.beginTransaction(zidFile, errorBuffer);
+    while ((result = ZIDCacheExport::readRecord(in, &data)) > 0) {
+        memset(zidRec.getRecordData(), 0, zidRec.getRecordLength());
+        if (mayContain(data.identifier)) {
+            cacheOps.readRemoteZidRecord(zidFile, data.identifier, associatedZid, zidRec.getRecordData(), errorBuffer);
+        }
+        bool exists = zidRec.isValid();
+
+        zidRec.setExportData(&data);
+        if (zidRec.getRecordData()->secureSince == 0) {
+            zidRec.getRecordData()->secureSince = (int64_t)time(NULL);
+        }
+        // The imported record replaces a record a live call saved meanwhile
+        pendingRecords.erase(std::string((const char*)data.identifier, IDENTIFIER_LEN));
+        if (exists)
+            cacheOps.updateRemoteZidRecord(zidFile, data.identifier, associatedZid, zidRec.getRecordData(), errorBuffer);
+        else {
+            cacheOps.insertRemoteZidRecord(zidFile, data.identifier, associatedZid, zidRec.getRecordData(), errorBuffer);
+            addToFilter(data.identifier);
+        }
+
+        if (++count % batchRecords == 0) {
+            cacheOps.commitTransaction(zidFile, errorBuffer);
+            guard.unlock();
+            guard.lock();
+            if (zidFile == NULL) {
+                return -1;
+            }
+            cacheOps.beginTransaction(zidFile, errorBuffer);
+        }
+    }
+    cacheOps.commitTransaction(zidFile, errorBuffer);
+    return (result < 0) ? -1 : count;
+}
+
+int32_t ZIDCacheDb::compact() {
+    int32_t removed = 0;
+    int32_t deleted;
+
+    do {
+        std::lock_guard<std::mutex> guard(cacheLock);
+
+        if (zidFile == NULL) {
+            return -1;
+        }
+        writePending();
+        if (cacheOps.deleteStaleRemoteZidRecords(zidFile, associatedZid, (int64_t)time(NULL), batchRecords,
+                                                 &deleted, errorBuffer) != 0) {
+            return -1;
+        }
+        removed += deleted;
+    } while (deleted == batchRecords);
+    return removed;
+}
+
+int32_t ZIDCacheDb::compactStep(int32_t maxRecords) {
+    std::lock_guard<std::mutex> guard(cacheLock);
+    int32_t deleted;
+
+    if (zidFile == NULL) {
+        return -1;
+    }
+    writePending();
+    if (cacheOps.deleteStaleRemoteZidRange(zidFile, associatedZid, (int64_t)time(NULL), &compactRowid, maxRecords,
+                                           &deleted, errorBuffer) != 0) {
+        return -1;
+    }
+    return deleted;
+}
@@ -33,7 +33,7 @@
 #include <libzrtpcpp/ZIDCacheEmpty.h>
 
 
-static ZIDCacheEmpty* instance;
+static ZIDCache* instance;
 
 /**
  * A poor man's factory.
@@ -50,6 +50,13 @@ ZIDCache* getZidCacheInstance() {
     return instance;
 }
 
+ZIDCache* setZidCacheInstance(ZIDCache* cache) {
+    ZIDCache* previous = instance;
+
+    instance = cache;
+    return previous;
+}
+
 int ZIDCacheEmpty::open(char* name) {
     (void) name;
     return 1;
@@ -61,6 +68,10 @@ ZIDRecord *ZIDCacheEmpty::getRecord(unsigned char *zid) {
     return new ZIDRecordEmpty();
 }
 
+ZIDRecord *ZIDCacheEmpty::getRecordInto(unsigned char *zid, ZIDRecordStorage& storage) {
+    return storage.construct<ZIDRecordEmpty>();
+}
+
 unsigned int ZIDCacheEmpty::saveRecord(ZIDRecord *zidRec) {
     (void) zidRec;
     return 1;
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <string.h>
+
+#include <libzrtpcpp/ZIDCacheExport.h>
+
+static const char magic[4] = {'Z', 'I', 'D', 'X'};
+
+static const size_t headerLength = sizeof(magic) + 4 + IDENTIFIER_LEN;
+static const size_t recordLength = IDENTIFIER_LEN + 4 + 8 + RS_LENGTH + 8 + RS_LENGTH + RS_LENGTH + 8;
+
+static void putUint32(uint8_t** p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        *(*p)++ = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static void putInt64(uint8_t** p, int64_t value) {
+    for (int i = 0; i < 8; i++) {
+        *(*p)++ = (uint8_t)((uint64_t)value >> (8 * i));
+    }
+}
+
+static void putBytes(uint8_t** p, const uint8_t* data, size_t length) {
+    memcpy(*p, data, length);
+    *p += length;
+}
+
+static uint32_t getUint32(const uint8_t** p) {
+    uint32_t value = 0;
+
+    for (int i = 0; i < 4; i++) {
+        value |= (uint32_t)*(*p)++ << (8 * i);
+    }
+    return value;
+}
+
+static int64_t getInt64(const uint8_t** p) {
+    uint64_t value = 0;
+
+    for (int i = 0; i < 8; i++) {
+        value |= (uint64_t)*(*p)++ << (8 * i);
+    }
+    return (int64_t)value;
+}
+
+static void getBytes(const uint8_t** p, uint8_t* data, size_t length) {
+    memcpy(data, *p, length);
+    *p += length;
+}
+
+int32_t ZIDCacheExport::writeHeader(FILE* out, const uint8_t* ownZid) {
+    uint8_t buffer[headerLength];
+    uint8_t* p = buffer;
+
+    putBytes(&p, (const uint8_t*)magic, sizeof(magic));
+    putUint32(&p, Version);
+    putBytes(&p, ownZid, IDENTIFIER_LEN);
+
+    return (fwrite(buffer, sizeof(buffer), 1, out) == 1) ? 0 : -1;
+}
+
+int32_t ZIDCacheExport::readHeader(FILE* in, uint8_t* ownZid) {
+    uint8_t buffer[headerLength];
+    const uint8_t* p = buffer;
+
+    if (fread(buffer, sizeof(buffer), 1, in) != 1 || memcmp(buffer, magic, sizeof(magic)) != 0) {
+        return -1;
+    }
+    p += sizeof(magic);
+    if (getUint32(&p) != Version) {
+        return -1;
+    }
+    getBytes(&p, ownZid, IDENTIFIER_LEN);
+    return 0;
+}
+
+int32_t ZIDCacheExport::writeRecord(FILE* out, const zidExportRecord_t* record) {
+    uint8_t buffer[recordLength];
+    uint8_t* p = buffer;
+
+    putBytes(&p, record->identifier, IDENTIFIER_LEN);
+    putUint32(&p, record->flags & AllFlags);
+    putInt64(&p, record->rs1ValidThru);
+    putBytes(&p, record->rs1, RS_LENGTH);
+    putInt64(&p, record->rs2ValidThru);
+    putBytes(&p, record->rs2, RS_LENGTH);
+    putBytes(&p, record->mitmKey, RS_LENGTH);
+    putInt64(&p, record->secureSince);
+
+    return (fwrite(buffer, sizeof(buffer), 1, out) == 1) ? 0 : -1;
+}
+
+int32_t ZIDCacheExport::readRecord(FILE* in, zidExportRecord_t* record) {
+    uint8_t buffer[recordLength];
+    const uint8_t* p = buffer;
+
+    size_t length = fread(buffer, 1, sizeof(buffer), in);
+    if (length == 0 && feof(in)) {
+        return 0;
+    }
+    if (length != sizeof(buffer)) {
+        return -1;
+    }
+    getBytes(&p, record->identifier, IDENTIFIER_LEN);
+    record->flags = getUint32(&p) & AllFlags;
+    record->rs1ValidThru = getInt64(&p);
+    getBytes(&p, record->rs1, RS_LENGTH);
+    record->rs2ValidThru = getInt64(&p);
+    getBytes(&p, record->rs2, RS_LENGTH);
+    getBytes(&p, record->mitmKey, RS_LENGTH);
+    record->secureSince = getInt64(&p);
+    return 1;
+}
+
+static bool isLive(uint32_t flags, uint32_t validFlag, int64_t validThru, int64_t now) {
+    if ((flags & validFlag) == 0) {
+        return false;
+    }
+    return validThru == -1 || (validThru != 0 && now <= validThru);
+}
+
+bool ZIDCacheExport::isStale(const zidExportRecord_t* record, int64_t now) {
+
+    if ((record->flags & Valid) == 0) {
+        return true;
+    }
+    return !isLive(record->flags, RS1Valid, record->rs1ValidThru, now) &&
+           !isLive(record->flags, RS2Valid, record->rs2ValidThru, now) &&
+           (record->flags & MITMKeyAvailable) == 0;
+}
@@ -20,10 +20,13 @@
 // #define UNIT_TEST
 
 #include <string>
+#include <vector>
 #include <stdlib.h>
+#include <time.h>
 
 #ifdef _MSC_VER
 #include <io.h>
+#define ftruncate _chsize
 #else
 #include <unistd.h>
 #endif
@@ -33,7 +36,7 @@
 #include <libzrtpcpp/ZIDCacheFile.h>
 
 
-static ZIDCacheFile* instance;
+static ZIDCache* instance;
 static int errors = 0;  // maybe we will use as member of ZIDCache later...
 
 
@@ -52,6 +55,13 @@ ZIDCache* getZidCacheInstance() {
     return instance;
 }
 
+ZIDCache* setZidCacheInstance(ZIDCache* cache) {
+    ZIDCache* previous = instance;
+
+    instance = cache;
+    return previous;
+}
+
 
 void ZIDCacheFile::createZIDFile(char* name) {
     zidFile = fopen(name, "wb+");
@@ -186,6 +196,9 @@ int ZIDCacheFile::open(char* name) {
             memcpy(associatedZid, rec.getIdentifier(), IDENTIFIER_LEN);
         }
     }
+    if (zidFile != NULL) {
+        buildIndex();
+    }
     return ((zidFile == NULL) ? -1 : 1);
 }
 
@@ -195,42 +208,67 @@ void ZIDCacheFile::close() {
         fclose(zidFile);
         zidFile = NULL;
     }
+    recordIndex.clear();
+    endPosition = 0;
+    compactPosition = 0;
 }
 
-ZIDRecord *ZIDCacheFile::getRecord(unsigned char *zid) {
-    unsigned long pos;
-    int numRead;
-    //    ZIDRecordFile rec;
-    ZIDRecordFile *zidRecord = new ZIDRecordFile();
+/*
+ * Read all records once and remember the position of each valid peer record.
+ * If the file contains more than one record for a ZID the first one wins, the
+ * same record the sequential search found.
+ */
+void ZIDCacheFile::buildIndex() {
+    ZIDRecordFile rec;
 
-    // set read pointer behind first record (
-    fseek(zidFile, zidRecord->getRecordLength(), SEEK_SET);
+    recordIndex.clear();
+    fseek(zidFile, rec.getRecordLength(), SEEK_SET);
 
-    do {
-        pos = ftell(zidFile);
-        numRead = fread(zidRecord->getRecordData(), zidRecord->getRecordLength(), 1, zidFile);
-        if (numRead == 0) {
-            break;
+    long pos = rec.getRecordLength();
+    while (fread(rec.getRecordData(), rec.getRecordLength(), 1, zidFile) == 1) {
+        if (!rec.isOwnZIDRecord() && rec.isValid()) {
+            recordIndex.emplace(std::string((const char*)rec.getIdentifier(), IDENTIFIER_LEN), pos);
         }
+        pos += rec.getRecordLength();
+    }
+    // A new record overwrites an incomplete record at the end of the file
+    endPosition = pos;
+}
 
-        // skip own ZID record and invalid records
-        if (zidRecord->isOwnZIDRecord() || !zidRecord->isValid()) {
-            continue;
+ZIDRecord *ZIDCacheFile::getRecord(unsigned char *zid) {
+    return lookupRecord(zid, new ZIDRecordFile());
+}
+
+ZIDRecord *ZIDCacheFile::getRecordInto(unsigned char *zid, ZIDRecordStorage& storage) {
+    return lookupRecord(zid, storage.construct<ZIDRecordFile>());
+}
+
+ZIDRecord *ZIDCacheFile::lookupRecord(unsigned char *zid, ZIDRecordFile *zidRecord) {
+    std::string key((const char*)zid, IDENTIFIER_LEN);
+
+    auto it = recordIndex.find(key);
+    if (it != recordIndex.end()) {
+        fseek(zidFile, it->second, SEEK_SET);
+        if (fread(zidRecord->getRecordData(), zidRecord->getRecordLength(), 1, zidFile) == 1) {
+            zidRecord->setPosition(it->second);
+            return zidRecord;
         }
+        ++errors;
+        recordIndex.erase(it);
+        *zidRecord = ZIDRecordFile();
+    }
+    // No record with the ZID found. We need to create a new ZID record.
+    zidRecord->setZid(zid);
+    zidRecord->setValid();
 
-    } while (numRead == 1 &&
-             memcmp(zidRecord->getIdentifier(), zid, IDENTIFIER_LEN) != 0);
-
-    // If we reached end of file, then no record with the ZID
-    // found. We need to create a new ZID record.
-    if (numRead == 0) {
-        // create new record
-        delete(zidRecord);
-        zidRecord = new ZIDRecordFile();
-        zidRecord->setZid(zid);
-        zidRecord->setValid();
-        if (fwrite(zidRecord->getRecordData(), zidRecord->getRecordLength(), 1, zidFile) < 1)
-            ++errors;
+    long pos = endPosition;
+    fseek(zidFile, pos, SEEK_SET);
+    if (fwrite(zidRecord->getRecordData(), zidRecord->getRecordLength(), 1, zidFile) < 1) {
+        ++errors;
+    }
+    else {
+        recordIndex.emplace(key, pos);
+        endPosition = pos + zidRecord->getRecordLength();
     }
     //  remember position of record in file for save operation
     zidRecord->setPosition(pos);
@@ -240,6 +278,17 @@ ZIDRecord *ZIDCacheFile::getRecord(unsigned char *zid) {
 unsigned int ZIDCacheFile::saveRecord(ZIDRecord *zidRec) {
     ZIDRecordFile *zidRecord = reinterpret_cast<ZIDRecordFile *>(zidRec);
 
+    // compact() moves records, the index knows the current position
+    std::string key((const char*)zidRecord->getIdentifier(), IDENTIFIER_LEN);
+    auto it = recordIndex.find(key);
+    if (it != recordIndex.end()) {
+        zidRecord->setPosition(it->second);
+    }
+    else if (zidRecord->getPosition() != 0) {
+        recordIndex.emplace(key, endPosition);
+        zidRecord->setPosition(endPosition);
+        endPosition += zidRecord->getRecordLength();
+    }
     fseek(zidFile, zidRecord->getPosition(), SEEK_SET);
     if (fwrite(zidRecord->getRecordData(), zidRecord->getRecordLength(), 1, zidFile) < 1)
         ++errors;
@@ -254,3 +303,224 @@ int32_t ZIDCacheFile::getPeerName(const uint8_t *peerZid, std::string *name) {
 void ZIDCacheFile::putPeerName(const uint8_t *peerZid, const std::string name) {
     return;
 }
+
+int32_t ZIDCacheFile::exportRecords(FILE* out) {
+    ZIDRecordFile rec;
+    zidExportRecord_t data;
+    int32_t count = 0;
+
+    if (zidFile == NULL || ZIDCacheExport::writeHeader(out, associatedZid) < 0) {
+        return -1;
+    }
+    // Export the records in file order, the index selects the record of a ZID
+    long pos = rec.getRecordLength();
+    fseek(zidFile, pos, SEEK_SET);
+    while (fread(rec.getRecordData(), rec.getRecordLength(), 1, zidFile) == 1) {
+        auto it = recordIndex.find(std::string((const char*)rec.getIdentifier(), IDENTIFIER_LEN));
+        if (it != recordIndex.end() && it->second == pos) {
+            rec.getExportData(&data);
+            if (ZIDCacheExport::writeRecord(out, &data) < 0) {
+                return -1;
+            }
+            count++;
+        }
+        pos += rec.getRecordLength();
+    }
+    return count;
+}
+
+int32_t ZIDCacheFile::importRecords(FILE* in) {
+    ZIDRecordFile rec;
+    zidExportRecord_t data;
+    uint8_t ownZid[IDENTIFIER_LEN];
+    int32_t count = 0;
+    int32_t result;
+
+    if (zidFile == NULL || ZIDCacheExport::readHeader(in, ownZid) < 0) {
+        return -1;
+    }
+    if (memcmp(ownZid, associatedZid, IDENTIFIER_LEN) != 0) {
+        if (!recordIndex.empty()) {
+            return -1;
+        }
+        // A new cache takes over the identity of the exporting cache
+        rec.setZid(ownZid);
+        rec.setOwnZIDRecord();
+        fseek(zidFile, 0L, SEEK_SET);
+        if (fwrite(rec.getRecordData(), rec.getRecordLength(), 1, zidFile) < 1) {
+            return -1;
+        }
+        memcpy(associatedZid, ownZid, IDENTIFIER_LEN);
+        rec.resetOwnZIDRecord();
+    }
+    while ((result = ZIDCacheExport::readRecord(in, &data)) > 0) {
+        std::string key((const char*)data.identifier, IDENTIFIER_LEN);
+        long pos;
+
+        auto it = recordIndex.find(key);
+        if (it != recordIndex.end()) {
+            pos = it->second;
+        }
+        else {
+            pos = endPosition;
+            recordIndex.emplace(key, pos);
+            endPosition += rec.getRecordLength();
+        }
+        rec.setExportData(&data);
+        fseek(zidFile, pos, SEEK_SET);
+        if (fwrite(rec.getRecordData(), rec.getRecordLength(), 1, zidFile) < 1) {
+            result = -1;
+            break;
+        }
+        count++;
+    }
+    fflush(zidFile);
+    return (result < 0) ? -1 : count;
+}
+
+/*
+ * Move the remaining records to the front of the file, block by block, then
+ * truncate the file. A record moves to a lower position only, thus after a
+ * crash the file contains the record of a ZID at least once and the first
+ * record of a ZID wins when the cache opens the file again.
+ */
+int32_t ZIDCacheFile::compact() {
+    const size_t blockRecords = 256;
+    const long recordLength = sizeof(zidrecord2_t);
+    std::vector<zidrecord2_t> block(blockRecords);
+    std::unordered_map<std::string, long> newIndex;
+    ZIDRecordFile rec;
+    int32_t removed = 0;
+
+    if (zidFile == NULL) {
+        return -1;
+    }
+    int64_t now = (int64_t)time(NULL);
+    long readPos = recordLength;
+    long writePos = recordLength;
+
+    for (;;) {
+        fseek(zidFile, readPos, SEEK_SET);
+        size_t numRead = fread(block.data(), recordLength, blockRecords, zidFile);
+        if (numRead == 0) {
+            break;
+        }
+        size_t numKept = 0;
+        for (size_t i = 0; i < numRead; i++) {
+            memcpy(rec.getRecordData(), &block[i], recordLength);
+            if (isRemovable(rec, readPos + (long)i * recordLength, now)) {
+                removed++;
+                continue;
+            }
+            newIndex.emplace(std::string((const char*)rec.getIdentifier(), IDENTIFIER_LEN),
+                             writePos + (long)numKept * recordLength);
+            block[numKept++] = block[i];
+        }
+        if (numKept > 0) {
+            fseek(zidFile, writePos, SEEK_SET);
+            if (fwrite(block.data(), recordLength, numKept, zidFile) != numKept) {
+                ++errors;
+                return -1;
+            }
+        }
+        readPos += (long)numRead * recordLength;
+        writePos += (long)numKept * recordLength;
+    }
+    fflush(zidFile);
+    if (ftruncate(fileno(zidFile), writePos) < 0) {
+        ++errors;
+    }
+    recordIndex.swap(newIndex);
+    endPosition = writePos;
+    return removed;
+}
+
+int32_t ZIDCacheFile::compactStep(int32_t maxRecords) {
+    const long recordLength = sizeof(zidrecord2_t);
+    ZIDRecordFile rec;
+    int32_t removed = 0;
+    int32_t checked = 0;
+
+    if (zidFile == NULL) {
+        return -1;
+    }
+    int64_t now = (int64_t)time(NULL);
+    long oldEnd = endPosition;
+
+    if (compactPosition < recordLength || compactPosition >= endPosition) {
+        compactPosition = recordLength;
+    }
+    while (checked < maxRecords && compactPosition < endPosition) {
+        fseek(zidFile, compactPosition, SEEK_SET);
+        if (fread(rec.getRecordData(), recordLength, 1, zidFile) != 1) {
+            ++errors;
+            return -1;
+        }
+        checked++;
+        if (!isRemovable(rec, compactPosition, now)) {
+            compactPosition += recordLength;
+            continue;
+        }
+        eraseIndex(rec, compactPosition);
+        removed++;
+
+        // Move the last record that stays into the gap and drop the end of the file. If
+        // no record stays the gap becomes the end of the file
+        long last = endPosition - recordLength;
+        while (last > compactPosition) {
+            fseek(zidFile, last, SEEK_SET);
+            if (fread(rec.getRecordData(), recordLength, 1, zidFile) != 1) {
+                ++errors;
+                return -1;
+            }
+            if (!isRemovable(rec, last, now)) {
+                fseek(zidFile, compactPosition, SEEK_SET);
+                if (fwrite(rec.getRecordData(), recordLength, 1, zidFile) != 1) {
+                    ++errors;
+                    return -1;
+                }
+                recordIndex[std::string((const char*)rec.getIdentifier(), IDENTIFIER_LEN)] = compactPosition;
+                compactPosition += recordLength;
+                break;
+            }
+            eraseIndex(rec, last);
+            removed++;
+            last -= recordLength;
+        }
+        endPosition = last;
+    }
+    if (endPosition < oldEnd) {
+        // Write the moved records before the truncation removes their old copies
+        fflush(zidFile);
+        if (ftruncate(fileno(zidFile), endPosition) < 0) {
+            ++errors;
+        }
+    }
+    return removed;
+}
+
+/*
+ * A record is removable if it is stale, or if it is not the indexed record
+ * of its ZID: the own ZID record at a wrong place or a duplicate record.
+ */
+bool ZIDCacheFile::isRemovable(ZIDRecordFile& rec, long position, int64_t now) {
+    zidExportRecord_t data;
+
+    if (rec.isOwnZIDRecord()) {
+        return true;
+    }
+    auto it = recordIndex.find(std::string((const char*)rec.getIdentifier(), IDENTIFIER_LEN));
+    if (it == recordIndex.end() || it->second != position) {
+        return true;
+    }
+    rec.getExportData(&data);
+    return ZIDCacheExport::isStale(&data, now);
+}
+
+void ZIDCacheFile::eraseIndex(ZIDRecordFile& rec, long position) {
+
+    auto it = recordIndex.find(std::string((const char*)rec.getIdentifier(), IDENTIFIER_LEN));
+    if (it != recordIndex.end() && it->second == position) {
+        recordIndex.erase(it);
+    }
+}
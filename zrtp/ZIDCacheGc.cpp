@@ -0,0 +1,125 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <libzrtpcpp/ZIDCacheGc.h>
+#include <libzrtpcpp/ZIDCache.h>
+
+/*
+ * The collector thread. The destructor stops the thread if the application did
+ * not stop the collector before it terminates.
+ */
+class GcWorker {
+public:
+    GcWorker(): batchRecords(0), intervalMs(0), removed(0), running(false) {}
+
+    ~GcWorker() { stop(); }
+
+    void start(int32_t batch, int32_t interval);
+
+    void stop();
+
+    int64_t getRemoved();
+
+private:
+    void run();
+
+    std::mutex lock;
+    std::condition_variable wakeup;
+    std::thread worker;
+    int32_t batchRecords;
+    int32_t intervalMs;
+    int64_t removed;
+    bool running;
+};
+
+void GcWorker::start(int32_t batch, int32_t interval)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    batchRecords = (batch < 1) ? 1 : batch;
+    intervalMs = (interval < 1) ? 1 : interval;
+    if (!running) {
+        running = true;
+        worker = std::thread(&GcWorker::run, this);
+    }
+}
+
+void GcWorker::stop()
+{
+    std::thread stopped;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        running = false;
+        stopped.swap(worker);
+        wakeup.notify_one();
+    }
+    // Join outside of the lock, the worker thread needs the lock to terminate
+    if (stopped.joinable())
+        stopped.join();
+}
+
+int64_t GcWorker::getRemoved()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return removed;
+}
+
+void GcWorker::run()
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    while (running) {
+        if (wakeup.wait_for(guard, std::chrono::milliseconds(intervalMs), [this]() { return !running; }))
+            break;
+        int32_t batch = batchRecords;
+
+        // Check the batch without holding the lock, the cache access may block
+        guard.unlock();
+        ZIDCache* zidCache = getZidCacheInstance();
+        int32_t count = zidCache->isOpen() ? zidCache->compactStep(batch) : 0;
+        guard.lock();
+
+        if (count > 0)
+            removed += count;
+    }
+}
+
+static GcWorker gcWorker;
+
+void ZIDCacheGc::start(int32_t batchRecords, int32_t intervalMs)
+{
+    gcWorker.start(batchRecords, intervalMs);
+}
+
+void ZIDCacheGc::stop()
+{
+    gcWorker.stop();
+}
+
+int64_t ZIDCacheGc::getRemovedRecords()
+{
+    return gcWorker.getRemoved();
+}
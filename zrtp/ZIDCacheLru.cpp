@@ -0,0 +1,251 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <libzrtpcpp/ZIDCacheLru.h>
+
+
+ZIDCacheLru* ZIDCacheLru::install(size_t capacity, bool writeBack) {
+
+    ZIDCacheLru* layer = new ZIDCacheLru(getZidCacheInstance(), capacity, writeBack);
+    setZidCacheInstance(layer);
+    return layer;
+}
+
+ZIDCacheLru::~ZIDCacheLru() {
+    close();
+    delete backend;
+}
+
+void ZIDCacheLru::writeEntry(cacheEntry_t& entry) {
+
+    if (entry.dirty) {
+        backend->saveRecord(entry.record);
+        entry.dirty = false;
+    }
+}
+
+void ZIDCacheLru::writeDirty() {
+
+    for (cacheEntry_t& entry : entries) {
+        writeEntry(entry);
+    }
+}
+
+void ZIDCacheLru::dropEntries() {
+
+    for (cacheEntry_t& entry : entries) {
+        delete entry.record;
+    }
+    entries.clear();
+    entryIndex.clear();
+}
+
+void ZIDCacheLru::flush() {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    writeDirty();
+}
+
+size_t ZIDCacheLru::size() {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    return entries.size();
+}
+
+int ZIDCacheLru::open(char* name) {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    // Records of a previous file are not valid for the new file
+    if (!backend->isOpen()) {
+        dropEntries();
+    }
+    return backend->open(name);
+}
+
+bool ZIDCacheLru::isOpen() {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    return backend->isOpen();
+}
+
+void ZIDCacheLru::close() {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    if (backend->isOpen()) {
+        writeDirty();
+    }
+    dropEntries();
+    backend->close();
+}
+
+ZIDRecord *ZIDCacheLru::getRecord(unsigned char *zid) {
+    return lookupRecord(zid, NULL);
+}
+
+ZIDRecord *ZIDCacheLru::getRecordInto(unsigned char *zid, ZIDRecordStorage& storage) {
+    return lookupRecord(zid, &storage);
+}
+
+ZIDRecord *ZIDCacheLru::readBackend(unsigned char *zid, ZIDRecordStorage *storage) {
+    return (storage != NULL) ? backend->getRecordInto(zid, *storage) : backend->getRecord(zid);
+}
+
+ZIDRecord *ZIDCacheLru::lookupRecord(unsigned char *zid, ZIDRecordStorage *storage) {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    if (capacity == 0) {
+        return readBackend(zid, storage);
+    }
+    std::string key((const char*)zid, IDENTIFIER_LEN);
+
+    auto found = entryIndex.find(key);
+    if (found != entryIndex.end()) {
+        entries.splice(entries.begin(), entries, found->second);
+        ZIDRecord* cached = found->second->record;
+        return (storage != NULL) ? cached->copyTo(*storage) : cached->clone();
+    }
+    ZIDRecord* zidRecord = readBackend(zid, storage);
+
+    // Evict the least recently used record, write it if it was modified
+    if (entries.size() >= capacity) {
+        cacheEntry_t& last = entries.back();
+        writeEntry(last);
+        entryIndex.erase(last.zid);
+        delete last.record;
+        entries.pop_back();
+    }
+    cacheEntry_t entry = {key, zidRecord->clone(), false};
+    entries.push_front(entry);
+    entryIndex[key] = entries.begin();
+
+    return zidRecord;
+}
+
+unsigned int ZIDCacheLru::saveRecord(ZIDRecord *zidRecord) {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    const uint8_t* zid = zidRecord->getIdentifier();
+    if (capacity == 0 || zid == NULL) {
+        return backend->saveRecord(zidRecord);
+    }
+    std::string key((const char*)zid, IDENTIFIER_LEN);
+
+    // A record evicted since getRecord: the caller's record is still valid for the backend
+    auto found = entryIndex.find(key);
+    if (found == entryIndex.end()) {
+        return backend->saveRecord(zidRecord);
+    }
+    cacheEntry_t& entry = *found->second;
+    delete entry.record;
+    entry.record = zidRecord->clone();
+
+    if (!writeBack) {
+        return backend->saveRecord(entry.record);
+    }
+    entry.dirty = true;
+    return 1;
+}
+
+const unsigned char* ZIDCacheLru::getZid() {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    return backend->getZid();
+}
+
+int32_t ZIDCacheLru::getPeerName(const uint8_t *peerZid, std::string *name) {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    return backend->getPeerName(peerZid, name);
+}
+
+void ZIDCacheLru::putPeerName(const uint8_t *peerZid, const std::string name) {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    backend->putPeerName(peerZid, name);
+}
+
+void ZIDCacheLru::cleanup() {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    dropEntries();
+    backend->cleanup();
+}
+
+void *ZIDCacheLru::prepareReadAll() {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    // Read all reads the backend, thus it must contain the modified records
+    writeDirty();
+    return backend->prepareReadAll();
+}
+
+void *ZIDCacheLru::readNextRecord(void *stmt, std::string *output) {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    return backend->readNextRecord(stmt, output);
+}
+
+void ZIDCacheLru::closeOpenStatment(void *stmt) {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    backend->closeOpenStatment(stmt);
+}
+
+void ZIDCacheLru::setCrashSafetyWindow(int32_t milliseconds) {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    backend->setCrashSafetyWindow(milliseconds);
+}
+
+bool ZIDCacheLru::setCacheKey(const uint8_t *key, int32_t keyLength, bool rawKey, int32_t kdfIterations) {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    return backend->setCacheKey(key, keyLength, rawKey, kdfIterations);
+}
+
+int32_t ZIDCacheLru::exportRecords(FILE* out) {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    writeDirty();
+    return backend->exportRecords(out);
+}
+
+int32_t ZIDCacheLru::importRecords(FILE* in) {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    // The import replaces records, write the modified records first
+    writeDirty();
+    dropEntries();
+    return backend->importRecords(in);
+}
+
+int32_t ZIDCacheLru::compact() {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    writeDirty();
+    return backend->compact();
+}
+
+int32_t ZIDCacheLru::compactStep(int32_t maxRecords) {
+    std::lock_guard<std::mutex> guard(cacheLock);
+
+    writeDirty();
+    return backend->compactStep(maxRecords);
+}
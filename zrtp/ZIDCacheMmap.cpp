@@ -0,0 +1,513 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <string>
+#include <stdlib.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <crypto/zrtpDH.h>
+
+#include <libzrtpcpp/ZIDCacheMmap.h>
+
+
+static ZIDCache* instance;
+static int errors = 0;  // maybe we will use as member of ZIDCache later...
+
+static const size_t recordLength = sizeof(zidrecord2_t);
+static const size_t minMappedRecords = 256;
+static const size_t minIndexSize = 1024;
+
+/**
+ * A poor man's factory.
+ *
+ * The build process must not allow two cache file implementation classes linked
+ * into the same library.
+ */
+
+ZIDCache* getZidCacheInstance() {
+
+    if (instance == NULL) {
+        instance = new ZIDCacheMmap();
+    }
+    return instance;
+}
+
+ZIDCache* setZidCacheInstance(ZIDCache* cache) {
+    ZIDCache* previous = instance;
+
+    instance = cache;
+    return previous;
+}
+
+
+ZIDCacheMmap::~ZIDCacheMmap() {
+    close();
+}
+
+int ZIDCacheMmap::open(char* name) {
+    struct stat st;
+
+    // check for an already active ZID file
+    if (zidFd >= 0) {
+        return 0;
+    }
+    if ((zidFd = ::open(name, O_RDWR | O_CREAT, 0666)) < 0) {
+        return -1;
+    }
+    if (fstat(zidFd, &st) < 0) {
+        close();
+        return -1;
+    }
+    numRecords = st.st_size / recordLength;
+
+    // version 1 files have a zero first byte, the class does not migrate them
+    if (numRecords > 0) {
+        zidrecord2_t first;
+        if (pread(zidFd, &first, recordLength, 0) != (ssize_t)recordLength ||
+            first.version == 0 || (first.flags & OwnZIDRecord) == 0) {
+            ::close(zidFd);
+            zidFd = -1;
+            numRecords = 0;
+            return -1;
+        }
+    }
+    size_t count = minMappedRecords;
+    while (count < numRecords) {
+        count *= 2;
+    }
+    if (mapRecords(count) < 0) {
+        close();
+        return -1;
+    }
+    // A new file, generate an associated random ZID and save it as first record
+    if (numRecords == 0) {
+        randomZRTP(associatedZid, IDENTIFIER_LEN);
+
+        ZIDRecordFile rec;
+        rec.setZid(associatedZid);
+        rec.setOwnZIDRecord();
+        memcpy(records, rec.getRecordData(), recordLength);
+        numRecords = 1;
+        msync(records, recordLength, MS_SYNC);
+    }
+    else {
+        memcpy(associatedZid, records[0].identifier, IDENTIFIER_LEN);
+
+        // Skip empty records a previous run left behind the used records
+        while (numRecords > 1 && records[numRecords - 1].version == 0) {
+            numRecords--;
+        }
+        // If the file contains more than one record for a ZID the first one wins
+        for (size_t i = 1; i < numRecords; i++) {
+            if ((records[i].flags & Valid) != 0 && (records[i].flags & OwnZIDRecord) == 0) {
+                insertIndex((uint32_t)i);
+            }
+        }
+    }
+    return 1;
+}
+
+void ZIDCacheMmap::close() {
+
+    if (zidFd >= 0) {
+        if (records != NULL) {
+            msync(records, numRecords * recordLength, MS_SYNC);
+        }
+        unmap();
+        // Remove the unused records to keep the file compatible with ZIDCacheFile
+        if (ftruncate(zidFd, numRecords * recordLength) < 0) {
+            ++errors;
+        }
+        ::close(zidFd);
+        zidFd = -1;
+    }
+    delete[] index;
+    index = NULL;
+    indexSize = 0;
+    indexUsed = 0;
+    numRecords = 0;
+    compactRecord = 0;
+    unflushed = 0;
+}
+
+int ZIDCacheMmap::mapRecords(size_t count) {
+    struct stat st;
+
+    unmap();
+    if (fstat(zidFd, &st) < 0) {
+        return -1;
+    }
+    // Enlarge the file, the new records are zero, thus not valid
+    if ((size_t)st.st_size < count * recordLength && ftruncate(zidFd, count * recordLength) < 0) {
+        return -1;
+    }
+    void* map = mmap(NULL, count * recordLength, PROT_READ | PROT_WRITE, MAP_SHARED, zidFd, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    records = static_cast<zidrecord2_t*>(map);
+    mappedRecords = count;
+    return 0;
+}
+
+void ZIDCacheMmap::unmap() {
+
+    if (records != NULL) {
+        munmap(records, mappedRecords * recordLength);
+        records = NULL;
+        mappedRecords = 0;
+    }
+}
+
+size_t ZIDCacheMmap::findIndex(const unsigned char* zid) {
+    uint64_t key;
+
+    // ZIDs are random, a multiplicative hash of the first bytes spreads them well
+    memcpy(&key, zid, sizeof(key));
+    size_t mask = indexSize - 1;
+    size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+
+    while (index[slot] != 0 && memcmp(records[index[slot] - 1].identifier, zid, IDENTIFIER_LEN) != 0) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void ZIDCacheMmap::insertIndex(uint32_t recordNumber) {
+
+    // Keep the load factor below 0.5
+    if ((indexUsed + 1) * 2 > indexSize) {
+        growIndex();
+    }
+    size_t slot = findIndex(records[recordNumber].identifier);
+    if (index[slot] == 0) {
+        index[slot] = recordNumber + 1;
+        indexUsed++;
+    }
+}
+
+void ZIDCacheMmap::eraseIndex(size_t recordNumber) {
+
+    if (indexSize == 0) {
+        return;
+    }
+    size_t mask = indexSize - 1;
+    size_t slot = findIndex(records[recordNumber].identifier);
+    if (index[slot] != recordNumber + 1) {
+        return;
+    }
+    index[slot] = 0;
+    indexUsed--;
+
+    // A lookup stops at an empty slot, insert the following entries of the probe sequence again
+    for (slot = (slot + 1) & mask; index[slot] != 0; slot = (slot + 1) & mask) {
+        uint32_t entry = index[slot];
+        index[slot] = 0;
+        index[findIndex(records[entry - 1].identifier)] = entry;
+    }
+}
+
+void ZIDCacheMmap::growIndex() {
+    uint32_t* oldIndex = index;
+    size_t oldSize = indexSize;
+
+    indexSize = (oldSize == 0) ? minIndexSize : oldSize * 2;
+    index = new uint32_t[indexSize]();
+
+    for (size_t i = 0; i < oldSize; i++) {
+        if (oldIndex[i] != 0) {
+            index[findIndex(records[oldIndex[i] - 1].identifier)] = oldIndex[i];
+        }
+    }
+    delete[] oldIndex;
+}
+
+void ZIDCacheMmap::flushRecord(size_t recordNumber) {
+
+    switch (flushPolicy) {
+        case FlushEverySave: {
+            // msync requires a page aligned address
+            size_t pageMask = (size_t)sysconf(_SC_PAGESIZE) - 1;
+            size_t start = (recordNumber * recordLength) & ~pageMask;
+            size_t end = (recordNumber + 1) * recordLength;
+            msync((char*)records + start, end - start, MS_SYNC);
+            break;
+        }
+        case FlushBatched:
+            if (++unflushed >= batchSize) {
+                msync(records, numRecords * recordLength, MS_ASYNC);
+                unflushed = 0;
+            }
+            break;
+
+        case FlushOnClose:
+        default:
+            break;
+    }
+}
+
+void ZIDCacheMmap::setFlushPolicy(FlushPolicy policy, int32_t saves) {
+    flushPolicy = policy;
+    batchSize = (saves > 0) ? saves : 1;
+    unflushed = 0;
+}
+
+ZIDRecord *ZIDCacheMmap::getRecord(unsigned char *zid) {
+    return lookupRecord(zid, new ZIDRecordFile());
+}
+
+ZIDRecord *ZIDCacheMmap::getRecordInto(unsigned char *zid, ZIDRecordStorage& storage) {
+    return lookupRecord(zid, storage.construct<ZIDRecordFile>());
+}
+
+ZIDRecord *ZIDCacheMmap::lookupRecord(unsigned char *zid, ZIDRecordFile *zidRecord) {
+
+    if (indexSize > 0) {
+        uint32_t recordNumber = index[findIndex(zid)];
+        if (recordNumber != 0) {
+            memcpy(zidRecord->getRecordData(), &records[recordNumber - 1], recordLength);
+            zidRecord->setPosition((recordNumber - 1) * recordLength);
+            return zidRecord;
+        }
+    }
+    // No record with the ZID found. We need to create a new ZID record.
+    zidRecord->setZid(zid);
+    zidRecord->setValid();
+
+    if (numRecords == mappedRecords && mapRecords(mappedRecords * 2) < 0) {
+        // A position of 0 is the own ZID record, saveRecord does not save this record
+        ++errors;
+        zidRecord->setPosition(0);
+        return zidRecord;
+    }
+    size_t recordNumber = numRecords++;
+    memcpy(&records[recordNumber], zidRecord->getRecordData(), recordLength);
+    insertIndex((uint32_t)recordNumber);
+    flushRecord(recordNumber);
+
+    //  remember position of record in file for save operation
+    zidRecord->setPosition(recordNumber * recordLength);
+    return zidRecord;
+}
+
+unsigned int ZIDCacheMmap::saveRecord(ZIDRecord *zidRec) {
+    ZIDRecordFile *zidRecord = reinterpret_cast<ZIDRecordFile *>(zidRec);
+
+    // A position of 0 is the own ZID record, getRecord could not add the record
+    if (zidRecord->getPosition() == 0 || indexSize == 0) {
+        ++errors;
+        return 1;
+    }
+    // compact() moves records, the index knows the current record number
+    size_t recordNumber = index[findIndex(zidRecord->getIdentifier())];
+    if (recordNumber != 0) {
+        recordNumber--;
+    }
+    else {
+        if (numRecords == mappedRecords && mapRecords(mappedRecords * 2) < 0) {
+            ++errors;
+            return 1;
+        }
+        recordNumber = numRecords++;
+        memcpy(&records[recordNumber], zidRecord->getRecordData(), recordLength);
+        insertIndex((uint32_t)recordNumber);
+    }
+    zidRecord->setPosition(recordNumber * recordLength);
+    memcpy(&records[recordNumber], zidRecord->getRecordData(), recordLength);
+    flushRecord(recordNumber);
+    return 1;
+}
+
+int32_t ZIDCacheMmap::getPeerName(const uint8_t *peerZid, std::string *name) {
+    return 0;
+}
+
+void ZIDCacheMmap::putPeerName(const uint8_t *peerZid, const std::string name) {
+    return;
+}
+
+int32_t ZIDCacheMmap::exportRecords(FILE* out) {
+    ZIDRecordFile rec;
+    zidExportRecord_t data;
+    int32_t count = 0;
+
+    if (zidFd < 0 || ZIDCacheExport::writeHeader(out, associatedZid) < 0) {
+        return -1;
+    }
+    for (size_t i = 1; i < numRecords; i++) {
+        // The index selects the record of a ZID
+        if (indexSize == 0 || index[findIndex(records[i].identifier)] != i + 1) {
+            continue;
+        }
+        memcpy(rec.getRecordData(), &records[i], recordLength);
+        rec.getExportData(&data);
+        if (ZIDCacheExport::writeRecord(out, &data) < 0) {
+            return -1;
+        }
+        count++;
+    }
+    return count;
+}
+
+int32_t ZIDCacheMmap::importRecords(FILE* in) {
+    ZIDRecordFile rec;
+    zidExportRecord_t data;
+    uint8_t ownZid[IDENTIFIER_LEN];
+    int32_t count = 0;
+    int32_t result;
+
+    if (zidFd < 0 || ZIDCacheExport::readHeader(in, ownZid) < 0) {
+        return -1;
+    }
+    if (memcmp(ownZid, associatedZid, IDENTIFIER_LEN) != 0) {
+        if (indexUsed > 0) {
+            return -1;
+        }
+        // A new cache takes over the identity of the exporting cache
+        memcpy(records[0].identifier, ownZid, IDENTIFIER_LEN);
+        memcpy(associatedZid, ownZid, IDENTIFIER_LEN);
+    }
+    while ((result = ZIDCacheExport::readRecord(in, &data)) > 0) {
+        size_t recordNumber = (indexSize > 0) ? index[findIndex(data.identifier)] : 0;
+
+        if (recordNumber != 0) {
+            recordNumber--;
+        }
+        else {
+            if (numRecords == mappedRecords && mapRecords(mappedRecords * 2) < 0) {
+                result = -1;
+                break;
+            }
+            recordNumber = numRecords++;
+            memcpy(records[recordNumber].identifier, data.identifier, IDENTIFIER_LEN);
+            insertIndex((uint32_t)recordNumber);
+        }
+        rec.setExportData(&data);
+        memcpy(&records[recordNumber], rec.getRecordData(), recordLength);
+        count++;
+    }
+    msync(records, numRecords * recordLength, MS_SYNC);
+    return (result < 0) ? -1 : count;
+}
+
+/*
+ * Move the remaining records to the front of the mapping, then clear the
+ * unused records. A record moves to a lower record number only, thus after a
+ * crash the file contains the record of a ZID at least once and the first
+ * record of a ZID wins when the cache opens the file again.
+ */
+int32_t ZIDCacheMmap::compact() {
+    int32_t removed = 0;
+    size_t kept = 1;
+
+    if (zidFd < 0) {
+        return -1;
+    }
+    int64_t now = (int64_t)time(NULL);
+
+    for (size_t i = 1; i < numRecords; i++) {
+        if (isRemovable(i, now)) {
+            removed++;
+            continue;
+        }
+        if (kept != i) {
+            memcpy(&records[kept], &records[i], recordLength);
+        }
+        kept++;
+    }
+    memset(&records[kept], 0, (numRecords - kept) * recordLength);
+    msync(records, numRecords * recordLength, MS_SYNC);
+    numRecords = kept;
+    unflushed = 0;
+
+    // Rebuild the index for the new record numbers
+    if (index != NULL) {
+        memset(index, 0, indexSize * sizeof(uint32_t));
+    }
+    indexUsed = 0;
+    for (size_t i = 1; i < numRecords; i++) {
+        insertIndex((uint32_t)i);
+    }
+    return removed;
+}
+
+int32_t ZIDCacheMmap::compactStep(int32_t maxRecords) {
+    int32_t removed = 0;
+    int32_t checked = 0;
+
+    if (zidFd < 0) {
+        return -1;
+    }
+    int64_t now = (int64_t)time(NULL);
+    size_t oldRecords = numRecords;
+
+    if (compactRecord < 1 || compactRecord >= numRecords) {
+        compactRecord = 1;
+    }
+    while (checked < maxRecords && compactRecord < numRecords) {
+        checked++;
+        if (!isRemovable(compactRecord, now)) {
+            compactRecord++;
+            continue;
+        }
+        eraseIndex(compactRecord);
+        removed++;
+
+        // Move the last record that stays into the gap, if no record stays the gap becomes the end
+        size_t last = numRecords - 1;
+        while (last > compactRecord && isRemovable(last, now)) {
+            eraseIndex(last);
+            removed++;
+            last--;
+        }
+        if (last > compactRecord) {
+            index[findIndex(records[last].identifier)] = (uint32_t)compactRecord + 1;
+            memcpy(&records[compactRecord], &records[last], recordLength);
+            flushRecord(compactRecord);
+            compactRecord++;
+        }
+        numRecords = last;
+    }
+    if (numRecords < oldRecords) {
+        memset(&records[numRecords], 0, (oldRecords - numRecords) * recordLength);
+    }
+    return removed;
+}
+
+/*
+ * A record is removable if it is stale, or if it is not the indexed record
+ * of its ZID: the own ZID record at a wrong place or a duplicate record.
+ */
+bool ZIDCacheMmap::isRemovable(size_t recordNumber, int64_t now) {
+    ZIDRecordFile rec;
+    zidExportRecord_t data;
+
+    memcpy(rec.getRecordData(), &records[recordNumber], recordLength);
+    if (rec.isOwnZIDRecord() || indexSize == 0 || index[findIndex(records[recordNumber].identifier)] != recordNumber + 1) {
+        return true;
+    }
+    rec.getExportData(&data);
+    return ZIDCacheExport::isStale(&data, now);
+}
@@ -0,0 +1,225 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <string.h>
+
+#include <libzrtpcpp/ZIDCacheSharded.h>
+
+/*
+ * Lock order: a shard lock first, then the backend lock. A thread never holds
+ * two shard locks.
+ */
+
+ZIDCacheSharded* ZIDCacheSharded::install(size_t numShards) {
+
+    ZIDCacheSharded* layer = new ZIDCacheSharded(getZidCacheInstance(), numShards);
+    setZidCacheInstance(layer);
+    return layer;
+}
+
+ZIDCacheSharded::ZIDCacheSharded(ZIDCache* backend, size_t numShards): backend(backend) {
+    size_t count = 1;
+
+    while (count < numShards) {
+        count *= 2;
+    }
+    shards = new shard_t[count];
+    shardMask = count - 1;
+}
+
+ZIDCacheSharded::~ZIDCacheSharded() {
+    close();
+    delete[] shards;
+    delete backend;
+}
+
+ZIDCacheSharded::shard_t& ZIDCacheSharded::getShard(const uint8_t* zid) {
+    uint64_t key;
+
+    // ZIDs are random, a multiplicative hash of the first bytes spreads them well
+    memcpy(&key, zid, sizeof(key));
+    return shards[(size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & shardMask];
+}
+
+void ZIDCacheSharded::dropRecords() {
+
+    for (size_t i = 0; i <= shardMask; i++) {
+        std::lock_guard<std::mutex> guard(shards[i].lock);
+
+        for (auto& entry : shards[i].records) {
+            delete entry.second;
+        }
+        shards[i].records.clear();
+    }
+}
+
+int ZIDCacheSharded::open(char* name) {
+
+    // Records of a previous file are not valid for the new file
+    if (!isOpen()) {
+        dropRecords();
+    }
+    std::lock_guard<std::mutex> guard(backendLock);
+    return backend->open(name);
+}
+
+bool ZIDCacheSharded::isOpen() {
+    std::lock_guard<std::mutex> guard(backendLock);
+
+    return backend->isOpen();
+}
+
+void ZIDCacheSharded::close() {
+
+    dropRecords();
+    std::lock_guard<std::mutex> guard(backendLock);
+    backend->close();
+}
+
+ZIDRecord *ZIDCacheSharded::getRecord(unsigned char *zid) {
+    return lookupRecord(zid, NULL);
+}
+
+ZIDRecord *ZIDCacheSharded::getRecordInto(unsigned char *zid, ZIDRecordStorage& storage) {
+    return lookupRecord(zid, &storage);
+}
+
+ZIDRecord *ZIDCacheSharded::lookupRecord(unsigned char *zid, ZIDRecordStorage *storage) {
+    shard_t& shard = getShard(zid);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    std::string key((const char*)zid, IDENTIFIER_LEN);
+
+    auto found = shard.records.find(key);
+    if (found != shard.records.end()) {
+        return (storage != NULL) ? found->second->copyTo(*storage) : found->second->clone();
+    }
+    ZIDRecord* zidRecord;
+    {
+        std::lock_guard<std::mutex> backendGuard(backendLock);
+        zidRecord = (storage != NULL) ? backend->getRecordInto(zid, *storage) : backend->getRecord(zid);
+    }
+    shard.records[key] = zidRecord->clone();
+    return zidRecord;
+}
+
+unsigned int ZIDCacheSharded::saveRecord(ZIDRecord *zidRecord) {
+
+    const uint8_t* zid = zidRecord->getIdentifier();
+    if (zid == NULL) {
+        std::lock_guard<std::mutex> backendGuard(backendLock);
+        return backend->saveRecord(zidRecord);
+    }
+    shard_t& shard = getShard(zid);
+    std::lock_guard<std::mutex> guard(shard.lock);
+
+    std::string key((const char*)zid, IDENTIFIER_LEN);
+
+    ZIDRecord*& cached = shard.records[key];
+    delete cached;
+    cached = zidRecord->clone();
+
+    // Write while holding the shard lock, saves of one peer reach the backend in order
+    std::lock_guard<std::mutex> backendGuard(backendLock);
+    return backend->saveRecord(zidRecord);
+}
+
+const unsigned char* ZIDCacheSharded::getZid() {
+    std::lock_guard<std::mutex> guard(backendLock);
+
+    return backend->getZid();
+}
+
+int32_t ZIDCacheSharded::getPeerName(const uint8_t *peerZid, std::string *name) {
+    std::lock_guard<std::mutex> guard(backendLock);
+
+    return backend->getPeerName(peerZid, name);
+}
+
+void ZIDCacheSharded::putPeerName(const uint8_t *peerZid, const std::string name) {
+    std::lock_guard<std::mutex> guard(backendLock);
+
+    backend->putPeerName(peerZid, name);
+}
+
+void ZIDCacheSharded::cleanup() {
+
+    dropRecords();
+    std::lock_guard<std::mutex> guard(backendLock);
+    backend->cleanup();
+}
+
+void *ZIDCacheSharded::prepareReadAll() {
+    std::lock_guard<std::mutex> guard(backendLock);
+
+    return backend->prepareReadAll();
+}
+
+void *ZIDCacheSharded::readNextRecord(void *stmt, std::string *output) {
+    std::lock_guard<std::mutex> guard(backendLock);
+
+    return backend->readNextRecord(stmt, output);
+}
+
+void ZIDCacheSharded::closeOpenStatment(void *stmt) {
+    std::lock_guard<std::mutex> guard(backendLock);
+
+    backend->closeOpenStatment(stmt);
+}
+
+void ZIDCacheSharded::setCrashSafetyWindow(int32_t milliseconds) {
+    std::lock_guard<std::mutex> guard(backendLock);
+
+    backend->setCrashSafetyWindow(milliseconds);
+}
+
+bool ZIDCacheSharded::setCacheKey(const uint8_t *key, int32_t keyLength, bool rawKey, int32_t kdfIterations) {
+    std::lock_guard<std::mutex> guard(backendLock);
+
+    return backend->setCacheKey(key, keyLength, rawKey, kdfIterations);
+}
+
+int32_t ZIDCacheSharded::exportRecords(FILE* out) {
+    std::lock_guard<std::mutex> guard(backendLock);
+
+    return backend->exportRecords(out);
+}
+
+int32_t ZIDCacheSharded::importRecords(FILE* in) {
+
+    // The import replaces records, drop the copies
+    dropRecords();
+    std::lock_guard<std::mutex> guard(backendLock);
+    return backend->importRecords(in);
+}
+
+int32_t ZIDCacheSharded::compact() {
+
+    // Compaction keeps the content of the remaining records, thus the shards
+    // keep their copies and serve lookups while the backend compacts
+    std::lock_guard<std::mutex> guard(backendLock);
+    return backend->compact();
+}
+
+int32_t ZIDCacheSharded::compactStep(int32_t maxRecords) {
+    std::lock_guard<std::mutex> guard(backendLock);
+
+    return backend->compactStep(maxRecords);
+}
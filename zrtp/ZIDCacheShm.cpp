@@ -0,0 +1,703 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <chrono>
+#include <string>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <crypto/zrtpDH.h>
+
+#include <libzrtpcpp/ZIDCacheShm.h>
+#include <libzrtpcpp/ZIDCacheExport.h>
+
+
+static ZIDCache* instance;
+static int errors = 0;  // maybe we will use as member of ZIDCache later...
+
+static const size_t recordLength = sizeof(zidrecord2_t);
+static const uint32_t segmentMagic = 0x5a494453;    // "ZIDS"
+static const uint32_t segmentLayout = 1;
+static const int attachTimeout = 2000;              // milliseconds to wait for the creator of a segment
+static const size_t headerSize = 2048;              // the records start at this offset
+static const int maxProcesses = 256;                // number of caches that can use a segment
+
+enum {
+    SegmentInitializing = 0,    // a new segment is zero, the creator loads the file
+    SegmentReady,
+    SegmentClosed               // the last cache closed and removed the segment
+};
+
+struct ZIDCacheShm::ShmHeader {
+    uint32_t magic;
+    uint32_t layout;
+    std::atomic<uint32_t> state;
+    uint32_t capacity;
+    uint32_t indexSize;                 // a power of 2, at least twice the capacity
+    std::atomic<uint32_t> numRecords;   // the first record is the own ZID record
+    int32_t attached[maxProcesses];     // process ids of the caches that use the segment, modified with writerLock
+    std::atomic<int32_t> persister;     // process id of the persister, 0 if no process has the role
+    pthread_mutex_t writerLock;
+    unsigned char ownZid[IDENTIFIER_LEN];
+};
+
+struct ZIDCacheShm::ShmRecord {
+    std::atomic<uint32_t> sequence;     // odd while a writer modifies the record
+    std::atomic<uint32_t> dirty;        // the persister did not write the modified record yet
+    zidrecord2_t record;
+};
+
+/**
+ * A poor man's factory.
+ *
+ * The build process must not allow two cache file implementation classes linked
+ * into the same library.
+ */
+
+ZIDCache* getZidCacheInstance() {
+
+    if (instance == NULL) {
+        instance = new ZIDCacheShm();
+    }
+    return instance;
+}
+
+ZIDCache* setZidCacheInstance(ZIDCache* cache) {
+    ZIDCache* previous = instance;
+
+    instance = cache;
+    return previous;
+}
+
+/*
+ * All processes that use the same file must use the same segment, thus the
+ * segment name contains a hash (FNV-1a) of the absolute file name.
+ */
+static std::string segmentNameOf(const char* name) {
+    char path[PATH_MAX];
+    char segment[32];
+
+    const char* fullName = (realpath(name, path) != NULL) ? path : name;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char* p = fullName; *p != '\0'; p++) {
+        hash = (hash ^ (uint8_t)*p) * 0x100000001b3ULL;
+    }
+    snprintf(segment, sizeof(segment), "/zrtpzid-%016llx", (unsigned long long)hash);
+    return segment;
+}
+
+static bool processAlive(int32_t pid) {
+    return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+/*
+ * Remove the attached processes that terminated without closing the cache,
+ * return the number of remaining processes. The caller holds the writer lock.
+ */
+static int pruneAttached(int32_t* attached) {
+    int count = 0;
+
+    for (int i = 0; i < maxProcesses; i++) {
+        if (attached[i] != 0 && !processAlive(attached[i])) {
+            attached[i] = 0;
+        }
+        if (attached[i] != 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+
+ZIDCacheShm::~ZIDCacheShm() {
+    close();
+}
+
+int ZIDCacheShm::open(char* name) {
+
+    // check for an already active ZID file
+    if (segment != NULL) {
+        return 0;
+    }
+    if ((zidFd = ::open(name, O_RDWR | O_CREAT, 0666)) < 0) {
+        return -1;
+    }
+    segmentName = segmentNameOf(name);
+
+    // The segment of a closing cache disappears soon, then create a new segment
+    for (int attempt = 0; attempt < attachTimeout; attempt++) {
+        int result;
+        int fd = shm_open(segmentName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+
+        if (fd >= 0) {
+            result = createSegment(fd);
+        }
+        else if (errno == EEXIST && (fd = shm_open(segmentName.c_str(), O_RDWR, 0666)) >= 0) {
+            result = attachSegment(fd);
+        }
+        else {
+            result = (errno == ENOENT) ? 0 : -1;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        if (result > 0) {
+            memcpy(associatedZid, header->ownZid, IDENTIFIER_LEN);
+            persisterRunning = true;
+            persister = std::thread(&ZIDCacheShm::runPersister, this);
+            return 1;
+        }
+        if (result < 0) {
+            break;
+        }
+        usleep(1000);
+    }
+    ::close(zidFd);
+    zidFd = -1;
+    return -1;
+}
+
+int ZIDCacheShm::createSegment(int fd) {
+    pthread_mutexattr_t attributes;
+
+    static_assert(sizeof(ShmHeader) <= headerSize, "segment header overlaps the records");
+
+    uint32_t indexSize = 1;
+    while (indexSize < 2 * capacity) {
+        indexSize *= 2;
+    }
+    size_t size = headerSize + capacity * sizeof(ShmRecord) + indexSize * sizeof(std::atomic<uint32_t>);
+
+    // The new segment is zero, attaching processes wait until it is ready
+    if (ftruncate(fd, size) < 0 || mapSegment(fd, size) < 0) {
+        shm_unlink(segmentName.c_str());
+        return -1;
+    }
+    header->magic = segmentMagic;
+    header->layout = segmentLayout;
+    header->capacity = capacity;
+    header->indexSize = indexSize;
+    setLayout();
+
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+#if defined(__linux__)
+    // A writer process may terminate while it holds the lock
+    pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+#endif
+    pthread_mutex_init(&header->writerLock, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+
+    if (loadFile() < 0) {
+        detach();
+        shm_unlink(segmentName.c_str());
+        return -1;
+    }
+    header->attached[0] = (int32_t)getpid();
+    header->state.store(SegmentReady, std::memory_order_release);
+    return 1;
+}
+
+int ZIDCacheShm::attachSegment(int fd) {
+    struct stat st;
+
+    // The creator sizes the segment after it created it
+    for (int waited = 0; ; waited++) {
+        if (fstat(fd, &st) < 0 || waited >= attachTimeout) {
+            return -1;
+        }
+        if (st.st_size > 0) {
+            break;
+        }
+        usleep(1000);
+    }
+    if ((size_t)st.st_size < headerSize || mapSegment(fd, st.st_size) < 0) {
+        return -1;
+    }
+    for (int waited = 0; header->state.load(std::memory_order_acquire) == SegmentInitializing; waited++) {
+        if (waited >= attachTimeout) {
+            detach();
+            return -1;
+        }
+        usleep(1000);
+    }
+    if (header->magic != segmentMagic || header->layout != segmentLayout ||
+        segmentSize < headerSize + header->capacity * sizeof(ShmRecord) + header->indexSize * sizeof(std::atomic<uint32_t>)) {
+        detach();
+        return -1;
+    }
+    setLayout();
+
+    lockWriter();
+    bool closed = header->state.load(std::memory_order_relaxed) == SegmentClosed;
+    int slot = -1;
+    if (!closed) {
+        pruneAttached(header->attached);
+        for (int i = 0; i < maxProcesses && slot < 0; i++) {
+            if (header->attached[i] == 0) {
+                header->attached[i] = (int32_t)getpid();
+                slot = i;
+            }
+        }
+    }
+    unlockWriter();
+
+    if (closed || slot < 0) {
+        detach();
+        return closed ? 0 : -1;
+    }
+    return 1;
+}
+
+int ZIDCacheShm::mapSegment(int fd, size_t size) {
+
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    segment = map;
+    segmentSize = size;
+    header = static_cast<ShmHeader*>(map);
+    return 0;
+}
+
+void ZIDCacheShm::setLayout() {
+
+    records = reinterpret_cast<ShmRecord*>(static_cast<char*>(segment) + headerSize);
+    index = reinterpret_cast<std::atomic<uint32_t>*>(records + header->capacity);
+}
+
+void ZIDCacheShm::detach() {
+
+    if (segment != NULL) {
+        munmap(segment, segmentSize);
+    }
+    segment = NULL;
+    segmentSize = 0;
+    header = NULL;
+    records = NULL;
+    index = NULL;
+}
+
+/*
+ * Load the cache file into the new segment. The file has the format of
+ * ZIDCacheFile, the class does not migrate files of the old version 1 format.
+ */
+int ZIDCacheShm::loadFile() {
+    struct stat st;
+
+    if (fstat(zidFd, &st) < 0) {
+        return -1;
+    }
+    size_t fileRecords = st.st_size / recordLength;
+    if (fileRecords > header->capacity) {
+        return -1;
+    }
+    for (size_t i = 0; i < fileRecords; i++) {
+        if (pread(zidFd, &records[i].record, recordLength, i * recordLength) != (ssize_t)recordLength) {
+            return -1;
+        }
+    }
+    if (fileRecords > 0 && (records[0].record.version == 0 || (records[0].record.flags & OwnZIDRecord) == 0)) {
+        return -1;
+    }
+    // Skip empty records a previous run left behind the used records
+    while (fileRecords > 1 && records[fileRecords - 1].record.version == 0) {
+        fileRecords--;
+    }
+    // A new file, generate an associated random ZID and save it as first record
+    if (fileRecords == 0) {
+        ZIDRecordFile rec;
+
+        randomZRTP(header->ownZid, IDENTIFIER_LEN);
+        rec.setZid(header->ownZid);
+        rec.setOwnZIDRecord();
+        memcpy(&records[0].record, rec.getRecordData(), recordLength);
+        if (pwrite(zidFd, &records[0].record, recordLength, 0) != (ssize_t)recordLength) {
+            return -1;
+        }
+        fileRecords = 1;
+    }
+    memcpy(header->ownZid, records[0].record.identifier, IDENTIFIER_LEN);
+    header->numRecords.store((uint32_t)fileRecords, std::memory_order_relaxed);
+
+    // If the file contains more than one record for a ZID the first one wins
+    for (size_t i = 1; i < fileRecords; i++) {
+        if ((records[i].record.flags & Valid) != 0 && (records[i].record.flags & OwnZIDRecord) == 0) {
+            insertIndex((uint32_t)i);
+        }
+    }
+    return 0;
+}
+
+void ZIDCacheShm::close() {
+
+    if (segment == NULL) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(persisterLock);
+        persisterRunning = false;
+        persisterWakeup.notify_one();
+    }
+    if (persister.joinable()) {
+        persister.join();
+    }
+    int32_t pid = (int32_t)getpid();
+
+    lockWriter();
+    for (int i = 0; i < maxProcesses; i++) {
+        if (header->attached[i] == pid) {
+            header->attached[i] = 0;
+            break;
+        }
+    }
+    if (pruneAttached(header->attached) == 0) {
+        // The last cache writes the records and removes the segment
+        persistRecords();
+        header->state.store(SegmentClosed, std::memory_order_release);
+        shm_unlink(segmentName.c_str());
+    }
+    else if (header->persister.load() == pid) {
+        persistRecords();
+    }
+    // Another process takes over the persister role with its next interval
+    header->persister.compare_exchange_strong(pid, 0);
+    unlockWriter();
+
+    detach();
+    ::close(zidFd);
+    zidFd = -1;
+}
+
+void ZIDCacheShm::lockWriter() {
+
+    int rc = pthread_mutex_lock(&header->writerLock);
+#if defined(__linux__)
+    if (rc == EOWNERDEAD) {
+        // A writer terminated while it modified a record, readers must not wait for the record forever
+        uint32_t numRecords = header->numRecords.load(std::memory_order_relaxed);
+        uint32_t last = (numRecords < header->capacity) ? numRecords + 1 : numRecords;
+        for (uint32_t i = 0; i < last; i++) {
+            uint32_t sequence = records[i].sequence.load(std::memory_order_relaxed);
+            if ((sequence & 1) != 0) {
+                records[i].sequence.store(sequence + 1, std::memory_order_release);
+                records[i].dirty.store(1, std::memory_order_release);
+                ++errors;
+            }
+        }
+        pthread_mutex_consistent(&header->writerLock);
+    }
+#else
+    (void)rc;
+#endif
+}
+
+void ZIDCacheShm::unlockWriter() {
+    pthread_mutex_unlock(&header->writerLock);
+}
+
+/*
+ * Readers do not lock. A writer publishes a record before it publishes the
+ * index entry, and it never removes or reuses an index entry. The identifier
+ * of a published record does not change.
+ */
+int64_t ZIDCacheShm::findRecord(const unsigned char* zid) {
+    uint64_t key;
+
+    // ZIDs are random, a multiplicative hash of the first bytes spreads them well
+    memcpy(&key, zid, sizeof(key));
+    size_t mask = header->indexSize - 1;
+    size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+
+    for (;;) {
+        uint32_t entry = index[slot].load(std::memory_order_acquire);
+        if (entry == 0) {
+            return -1;
+        }
+        if (memcmp(records[entry - 1].record.identifier, zid, IDENTIFIER_LEN) == 0) {
+            return entry - 1;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+// The caller holds the writer lock or initializes the segment
+void ZIDCacheShm::insertIndex(uint32_t recordNumber) {
+    uint64_t key;
+
+    memcpy(&key, records[recordNumber].record.identifier, sizeof(key));
+    size_t mask = header->indexSize - 1;
+    size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+
+    for (;;) {
+        uint32_t entry = index[slot].load(std::memory_order_relaxed);
+        if (entry == 0) {
+            index[slot].store(recordNumber + 1, std::memory_order_release);
+            return;
+        }
+        if (memcmp(records[entry - 1].record.identifier, records[recordNumber].record.identifier, IDENTIFIER_LEN) == 0) {
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+/*
+ * Copy a record consistently: repeat the copy if a writer modified the record
+ * meanwhile.
+ */
+void ZIDCacheShm::readRecord(uint32_t recordNumber, zidrecord2_t* data) {
+    ShmRecord& shmRecord = records[recordNumber];
+
+    for (;;) {
+        uint32_t sequence = shmRecord.sequence.load(std::memory_order_acquire);
+        if ((sequence & 1) != 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        memcpy(data, &shmRecord.record, recordLength);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (shmRecord.sequence.load(std::memory_order_relaxed) == sequence) {
+            return;
+        }
+    }
+}
+
+// The caller holds the writer lock
+void ZIDCacheShm::writeRecord(uint32_t recordNumber, const zidrecord2_t* data) {
+    ShmRecord& shmRecord = records[recordNumber];
+
+    uint32_t sequence = shmRecord.sequence.load(std::memory_order_relaxed);
+    shmRecord.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&shmRecord.record, data, recordLength);
+    shmRecord.sequence.store(sequence + 2, std::memory_order_release);
+    shmRecord.dirty.store(1, std::memory_order_release);
+}
+
+// The caller holds the writer lock, the record is not in the index
+int64_t ZIDCacheShm::appendRecord(const zidrecord2_t* data) {
+
+    uint32_t recordNumber = header->numRecords.load(std::memory_order_relaxed);
+    if (recordNumber >= header->capacity) {
+        return -1;
+    }
+    writeRecord(recordNumber, data);
+    insertIndex(recordNumber);
+    header->numRecords.store(recordNumber + 1, std::memory_order_release);
+    return recordNumber;
+}
+
+ZIDRecord *ZIDCacheShm::getRecord(unsigned char *zid) {
+    return lookupRecord(zid, new ZIDRecordFile());
+}
+
+ZIDRecord *ZIDCacheShm::getRecordInto(unsigned char *zid, ZIDRecordStorage& storage) {
+    return lookupRecord(zid, storage.construct<ZIDRecordFile>());
+}
+
+ZIDRecord *ZIDCacheShm::lookupRecord(unsigned char *zid, ZIDRecordFile *zidRecord) {
+
+    int64_t recordNumber = (segment != NULL) ? findRecord(zid) : -1;
+
+    if (recordNumber < 0 && segment != NULL) {
+        lockWriter();
+        // Another process may have added the record meanwhile
+        if ((recordNumber = findRecord(zid)) < 0) {
+            ZIDRecordFile newRecord;
+            newRecord.setZid(zid);
+            newRecord.setValid();
+            recordNumber = appendRecord(newRecord.getRecordData());
+        }
+        unlockWriter();
+    }
+    if (recordNumber < 0) {
+        // A position of 0 is the own ZID record, saveRecord does not save this record
+        ++errors;
+        zidRecord->setZid(zid);
+        zidRecord->setValid();
+        zidRecord->setPosition(0);
+        return zidRecord;
+    }
+    readRecord((uint32_t)recordNumber, zidRecord->getRecordData());
+    zidRecord->setPosition(recordNumber * recordLength);
+    return zidRecord;
+}
+
+unsigned int ZIDCacheShm::saveRecord(ZIDRecord *zidRec) {
+    ZIDRecordFile *zidRecord = reinterpret_cast<ZIDRecordFile *>(zidRec);
+
+    // A position of 0 is the own ZID record, getRecord could not add the record
+    if (zidRecord->getPosition() == 0 || segment == NULL) {
+        ++errors;
+        return 1;
+    }
+    lockWriter();
+    int64_t recordNumber = findRecord(zidRecord->getIdentifier());
+    if (recordNumber >= 0) {
+        writeRecord((uint32_t)recordNumber, zidRecord->getRecordData());
+    }
+    else {
+        recordNumber = appendRecord(zidRecord->getRecordData());
+    }
+    unlockWriter();
+
+    if (recordNumber < 0) {
+        ++errors;
+    }
+    return 1;
+}
+
+const unsigned char* ZIDCacheShm::getZid() {
+    return (header != NULL) ? header->ownZid : associatedZid;
+}
+
+int32_t ZIDCacheShm::getPeerName(const uint8_t *peerZid, std::string *name) {
+    return 0;
+}
+
+void ZIDCacheShm::putPeerName(const uint8_t *peerZid, const std::string name) {
+    return;
+}
+
+int32_t ZIDCacheShm::exportRecords(FILE* out) {
+    ZIDRecordFile rec;
+    zidExportRecord_t data;
+    int32_t count = 0;
+
+    if (segment == NULL || ZIDCacheExport::writeHeader(out, header->ownZid) < 0) {
+        return -1;
+    }
+    uint32_t numRecords = header->numRecords.load(std::memory_order_acquire);
+    for (uint32_t i = 1; i < numRecords; i++) {
+        readRecord(i, rec.getRecordData());
+
+        // The index selects the record of a ZID
+        if (rec.isOwnZIDRecord() || findRecord(rec.getIdentifier()) != i) {
+            continue;
+        }
+        rec.getExportData(&data);
+        if (ZIDCacheExport::writeRecord(out, &data) < 0) {
+            return -1;
+        }
+        count++;
+    }
+    return count;
+}
+
+int32_t ZIDCacheShm::importRecords(FILE* in) {
+    zidExportRecord_t data;
+    zidrecord2_t ownRecord;
+    uint8_t ownZid[IDENTIFIER_LEN];
+    int32_t count = 0;
+    int32_t result;
+
+    if (segment == NULL || ZIDCacheExport::readHeader(in, ownZid) < 0) {
+        return -1;
+    }
+    lockWriter();
+    if (memcmp(ownZid, header->ownZid, IDENTIFIER_LEN) != 0) {
+        if (header->numRecords.load(std::memory_order_relaxed) > 1) {
+            unlockWriter();
+            return -1;
+        }
+        // A new cache takes over the identity of the exporting cache
+        readRecord(0, &ownRecord);
+        memcpy(ownRecord.identifier, ownZid, IDENTIFIER_LEN);
+        writeRecord(0, &ownRecord);
+        memcpy(header->ownZid, ownZid, IDENTIFIER_LEN);
+        memcpy(associatedZid, ownZid, IDENTIFIER_LEN);
+    }
+    while ((result = ZIDCacheExport::readRecord(in, &data)) > 0) {
+        ZIDRecordFile rec;
+
+        rec.setExportData(&data);
+        int64_t recordNumber = findRecord(data.identifier);
+        if (recordNumber >= 0) {
+            writeRecord((uint32_t)recordNumber, rec.getRecordData());
+        }
+        else if (appendRecord(rec.getRecordData()) < 0) {
+            result = -1;
+            break;
+        }
+        count++;
+    }
+    unlockWriter();
+    return (result < 0) ? -1 : count;
+}
+
+void ZIDCacheShm::runPersister() {
+    std::unique_lock<std::mutex> guard(persisterLock);
+    int32_t pid = (int32_t)getpid();
+
+    while (persisterRunning) {
+        if (persisterWakeup.wait_for(guard, std::chrono::milliseconds(persistInterval),
+                                     [this]() { return !persisterRunning; })) {
+            break;
+        }
+        // Take over the role if no process has it or if the persister process terminated
+        int32_t holder = header->persister.load();
+        if (holder != pid && (holder == 0 || !processAlive(holder))) {
+            header->persister.compare_exchange_strong(holder, pid);
+        }
+        if (header->persister.load() == pid) {
+            persistRecords();
+        }
+    }
+}
+
+/*
+ * Write the modified records to the file. The function clears the dirty flag
+ * before it copies the record, thus a record that a writer modifies meanwhile
+ * stays dirty.
+ */
+int32_t ZIDCacheShm::persistRecords() {
+    zidrecord2_t data;
+    int32_t written = 0;
+
+    uint32_t numRecords = header->numRecords.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < numRecords; i++) {
+        if (records[i].dirty.load(std::memory_order_relaxed) == 0 ||
+            records[i].dirty.exchange(0, std::memory_order_acquire) == 0) {
+            continue;
+        }
+        readRecord(i, &data);
+        if (pwrite(zidFd, &data, recordLength, (off_t)i * recordLength) != (ssize_t)recordLength) {
+            ++errors;
+            records[i].dirty.store(1, std::memory_order_relaxed);
+            continue;
+        }
+        written++;
+    }
+    if (written > 0 && fsync(zidFd) < 0) {
+        ++errors;
+    }
+    return written;
+}
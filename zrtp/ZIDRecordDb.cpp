@@ -77,3 +77,27 @@ void ZIDRecordDb::setMiTMData(const unsigned char* data) {
     memcpy(record.mitmKey, data, RS_LENGTH);
     setMITMKeyAvailable();
 }
+
+void ZIDRecordDb::getExportData(zidExportRecord_t* data) {
+    memcpy(data->identifier, record.identifier, IDENTIFIER_LEN);
+    data->flags = record.flags & ZIDCacheExport::AllFlags;
+    data->rs1ValidThru = record.rs1Ttl;
+    memcpy(data->rs1, record.rs1, RS_LENGTH);
+    data->rs2ValidThru = record.rs2Ttl;
+    memcpy(data->rs2, record.rs2, RS_LENGTH);
+    memcpy(data->mitmKey, record.mitmKey, RS_LENGTH);
+    data->secureSince = record.secureSince;
+}
+
+void ZIDRecordDb::setExportData(const zidExportRecord_t* data) {
+    memcpy(record.identifier, data->identifier, IDENTIFIER_LEN);
+    record.flags = (record.flags & ~ZIDCacheExport::AllFlags) | (data->flags & ZIDCacheExport::AllFlags) | Valid;
+    record.rs1Ttl = data->rs1ValidThru;
+    memcpy(record.rs1, data->rs1, RS_LENGTH);
+    record.rs2Ttl = data->rs2ValidThru;
+    memcpy(record.rs2, data->rs2, RS_LENGTH);
+    memcpy(record.mitmKey, data->mitmKey, RS_LENGTH);
+    if (data->secureSince != 0) {
+        record.secureSince = data->secureSince;
+    }
+}
@@ -98,3 +98,24 @@ void ZIDRecordFile::setMiTMData(const unsigned char* data) {
     memcpy(record.mitmKey, data, RS_LENGTH);
     setMITMKeyAvailable();
 }
+
+void ZIDRecordFile::getExportData(zidExportRecord_t* data) {
+    memcpy(data->identifier, record.identifier, IDENTIFIER_LEN);
+    data->flags = (uint32_t)record.flags & ZIDCacheExport::AllFlags;
+    memcpy(&data->rs1ValidThru, record.rs1Interval, TIME_LENGTH);
+    memcpy(data->rs1, record.rs1Data, RS_LENGTH);
+    memcpy(&data->rs2ValidThru, record.rs2Interval, TIME_LENGTH);
+    memcpy(data->rs2, record.rs2Data, RS_LENGTH);
+    memcpy(data->mitmKey, record.mitmKey, RS_LENGTH);
+    data->secureSince = 0;
+}
+
+void ZIDRecordFile::setExportData(const zidExportRecord_t* data) {
+    memcpy(record.identifier, data->identifier, IDENTIFIER_LEN);
+    record.flags = (char)((record.flags & OwnZIDRecord) | (data->flags & ZIDCacheExport::AllFlags) | Valid);
+    memcpy(record.rs1Interval, &data->rs1ValidThru, TIME_LENGTH);
+    memcpy(record.rs1Data, data->rs1, RS_LENGTH);
+    memcpy(record.rs2Interval, &data->rs2ValidThru, TIME_LENGTH);
+    memcpy(record.rs2Data, data->rs2, RS_LENGTH);
+    memcpy(record.mitmKey, data->mitmKey, RS_LENGTH);
+}
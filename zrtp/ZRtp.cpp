@@ -34,9 +34,295 @@
 #include <libzrtpcpp/ZrtpStateClass.h>
 #include <libzrtpcpp/Base32.h>
 #include <libzrtpcpp/EmojiBase32.h>
+#include <libzrtpcpp/ZrtpDHPool.h>
+#include <libzrtpcpp/ZIDCacheAsync.h>
+#include <libzrtpcpp/ZIDRecordFile.h>
+#include <common/MemoryUsage.h>
+#include <common/zrtpProbes.h>
+#include <libzrtpcpp/ZrtpMetrics.h>
+#include <libzrtpcpp/ZrtpTrace.h>
 
 using namespace GnuZrtpCodes;
 
+/*
+ * memset_volatile is a volatile pointer to the memset function.
+ * You can call (*memset_volatile)(buf, val, len) or even
+ * memset_volatile(buf, val, len) just as you would call
+ * memset(buf, val, len), but the use of a volatile pointer
+ * guarantees that the compiler will not optimise the call away.
+ */
+static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
+
+// The DH shared secret uses the allocator of the library
+static uint8_t* newSecret(size_t length)
+{
+    return static_cast<uint8_t*>(zrtpNew(length));
+}
+
+static void deleteSecret(uint8_t* secret, size_t length)
+{
+    zrtpFree(secret, length);
+}
+
+/*
+ * The AEAD authentication lengths work with one cipher only: GC16 requires an
+ * AES cipher, CP16 and the ChaCha20 cipher require each other.
+ */
+static bool isSrtpSuite(AlgorithmEnum* cipher, AlgorithmEnum* authLength)
+{
+    if (authLength->getAlgoId() == AesGcm)
+        return cipher->getAlgoId() == Aes;
+    return (authLength->getAlgoId() == ChaCha20Poly1305) == (cipher->getAlgoId() == ChaCha20);
+}
+
+/*
+ * The nonces of the partner's multi-stream Commits.
+ *
+ * The set keeps the most recent maxNonces nonces in a ring and indexes them
+ * with a small chained hash table. If the ring is full the set forgets the
+ * oldest nonce, thus the set does not grow if an application adds and removes
+ * streams during a long session.
+ */
+class ZRtp::NonceSet {
+public:
+    ZRTP_ALLOCATOR_OPERATORS
+
+    static const int32_t maxNonces = 256;
+    static const int32_t numBuckets = 64;               // a power of 2
+    static const int32_t nonceLength = ZRTP_WORD_SIZE * 4;
+
+    NonceSet(): count(0), head(0) {
+        memset(buckets, 0xff, sizeof(buckets));
+    }
+
+    /*
+     * Insert the nonce, return false if the set contains the nonce already.
+     */
+    bool insert(const uint8_t* nonce) {
+        int16_t* bucket = &buckets[bucketOf(nonce)];
+
+        for (int16_t i = *bucket; i >= 0; i = next[i]) {
+            if (memcmp(nonces[i], nonce, nonceLength) == 0)
+                return false;
+        }
+        if (count == maxNonces)
+            unlink(head);
+        else
+            count++;
+
+        memcpy(nonces[head], nonce, nonceLength);
+        next[head] = *bucket;
+        *bucket = static_cast<int16_t>(head);
+        head = (head + 1) % maxNonces;
+        return true;
+    }
+
+private:
+    // The nonces are random, the first word is a good hash
+    static uint32_t bucketOf(const uint8_t* nonce) {
+        uint32_t word;
+        memcpy(&word, nonce, sizeof(word));
+        return (word ^ (word >> 16)) & (numBuckets - 1);
+    }
+
+    void unlink(int32_t slot) {
+        int16_t* link = &buckets[bucketOf(nonces[slot])];
+
+        while (*link != slot)
+            link = &next[*link];
+        *link = next[slot];
+    }
+
+    uint8_t nonces[maxNonces][nonceLength];
+    int16_t next[maxNonces];
+    int16_t buckets[numBuckets];
+    int32_t count;
+    int32_t head;                           // the slot of the next nonce, the oldest nonce if the ring is full
+};
+
+/*
+ * An asynchronous DH key agreement. The worker thread computes the shared secret,
+ * ZRtp takes the DH context and the shared secret back when it resumes the protocol.
+ * If ZRtp drops the agreement the last owner deletes the data. The ZRtp destructor
+ * waits until all agreements are deleted, thus the worker thread may use the owner.
+ */
+class DhAgreement {
+public:
+    DhAgreement(ZRtp* zrtp, ZrtpDH* dh, uint8_t* secret, const uint8_t* data, size_t length):
+            owner(zrtp), dhContext(dh), DHss(secret), packet(data, data + length), cpuTime(0), done(false), cancelled(false) {
+        std::lock_guard<std::mutex> guard(owner->agreementLock);
+        owner->agreementsRunning++;
+    }
+
+    ~DhAgreement() {
+        if (DHss != nullptr) {
+            memset_volatile(DHss, 0, dhContext->getDhSize());
+            deleteSecret(DHss, dhContext->getDhSize());
+        }
+        delete dhContext;
+
+        std::lock_guard<std::mutex> guard(owner->agreementLock);
+        owner->agreementsRunning--;
+        owner->agreementIdle.notify_all();
+    }
+
+    void run();
+
+    ZRtp* owner;
+    ZrtpDH* dhContext;
+    uint8_t* DHss;
+    std::vector<uint8_t> packet;
+    std::mutex lock;
+    int64_t cpuTime;                        // thread CPU time of the computation, ZRtp adds it to its detail info
+    bool done;
+    bool cancelled;
+};
+
+void DhAgreement::run() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (cancelled)
+            return;
+    }
+    ZrtpPacketDHPart dhPart(packet.data());
+    uint64_t cpuStart = zrtpGetThreadCpuTime();
+    ZRTP_PROBE2(dh_compute_entry, owner, dhContext->getDhSize());
+    dhContext->computeSecretKey(dhPart.getPv(), DHss);
+    ZRTP_PROBE2(dh_compute_return, owner, dhContext->getDhSize());
+    int64_t used = (int64_t)(zrtpGetThreadCpuTime() - cpuStart);
+
+    bool deliver;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        cpuTime = used;
+        done = true;
+        deliver = !cancelled;
+    }
+    if (deliver)
+        owner->keyAgreementReady();
+}
+
+/*
+ * The retained secret ids of recent sessions.
+ *
+ * The ids of rs1, rs2 and the PBX secret depend on the secret and the negotiated
+ * HMAC only, thus concurrent streams and redials to the same peer compute the
+ * same ids. The cache keeps the ids of the most recent maxEntries secrets in a
+ * ring. A secret identifies its own version: after a key update the peer's ZID
+ * record contains a new rs1 that has no entry yet, the old rs1 becomes rs2 and
+ * keeps its entry. The cache wipes the secrets it overwrites.
+ *
+ * The random ids of missing secrets and the auxiliary secret ids, which depend on
+ * the H3 of the session, do not use the cache.
+ */
+class SecretIdCache {
+public:
+    typedef void (*HmacFunction)(const uint8_t* key, uint64_t key_length,
+                                 const uint8_t* data, uint64_t data_length,
+                                 uint8_t* mac, uint32_t* mac_length);
+
+    static const int32_t maxEntries = 32;
+
+    SecretIdCache(): count(0), head(0) {}
+
+    ~SecretIdCache() {
+        memset_volatile(entries, 0, sizeof(entries));
+    }
+
+    /*
+     * Get the Initiator's and the Responder's id of a retained secret.
+     */
+    void getIds(HmacFunction hmac, const uint8_t* peerZid, const uint8_t* secret, uint8_t* idI, uint8_t* idR) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            for (int32_t i = 0; i < count; i++) {
+                Entry& entry = entries[i];
+                if (entry.hmac == hmac && memcmp(entry.zid, peerZid, IDENTIFIER_LEN) == 0 &&
+                    memcmp(entry.secret, secret, RS_LENGTH) == 0) {
+                    memcpy(idI, entry.idI, entry.idLength);
+                    memcpy(idR, entry.idR, entry.idLength);
+                    return;
+                }
+            }
+        }
+        uint32_t macLen;
+        hmac(secret, RS_LENGTH, (uint8_t*)initiator, strlen(initiator), idI, &macLen);
+        hmac(secret, RS_LENGTH, (uint8_t*)responder, strlen(responder), idR, &macLen);
+
+        std::lock_guard<std::mutex> guard(lock);
+        Entry& entry = entries[head];
+        entry.hmac = hmac;
+        memcpy(entry.zid, peerZid, IDENTIFIER_LEN);
+        memcpy(entry.secret, secret, RS_LENGTH);
+        memcpy(entry.idI, idI, macLen);
+        memcpy(entry.idR, idR, macLen);
+        entry.idLength = macLen;
+        head = (head + 1) % maxEntries;
+        if (count < maxEntries)
+            count++;
+    }
+
+private:
+    typedef struct _Entry {
+        HmacFunction hmac;
+        uint8_t zid[IDENTIFIER_LEN];
+        uint8_t secret[RS_LENGTH];
+        uint8_t idI[MAX_DIGEST_LENGTH];
+        uint8_t idR[MAX_DIGEST_LENGTH];
+        uint32_t idLength;
+    } Entry;
+
+    Entry entries[maxEntries];
+    int32_t count;
+    int32_t head;                           // the slot of the next entry, the oldest entry if the ring is full
+    std::mutex lock;
+};
+
+static SecretIdCache secretIdCache;
+
+/*
+ * Sets the trace of an engine as the random hook of the thread while the
+ * engine runs, restores the previous hook at the end of the scope.
+ */
+class TraceScope {
+public:
+    explicit TraceScope(ZrtpTrace* trace): active(trace != nullptr), previous(nullptr) {
+        if (active)
+            previous = ZrtpRandom::setThreadHook(trace);
+    }
+    ~TraceScope() {
+        if (active)
+            ZrtpRandom::setThreadHook(previous);
+    }
+
+private:
+    bool active;
+    ZrtpRandomHook* previous;
+};
+
+/*
+ * Get a DH context with a generated key pair: the speculatively generated one if the
+ * type matches, from the key pair pool if possible.
+ */
+ZrtpDH* ZRtp::createDhContext(const char* type)
+{
+    ZrtpDH* dh = nullptr;
+
+    // A speculative key pair of another type stays pending, the destructor drops it
+    if (speculativeDh.valid() && speculativeType == *(int32_t*)type)
+        dh = speculativeDh.get();
+    // A traced engine generates its key pair itself, thus the trace has the random data
+    if (dh == nullptr && trace == nullptr)
+        dh = ZrtpDHPool::getKeyPair(type);
+    if (dh == nullptr) {
+        uint64_t cpuStart = zrtpGetThreadCpuTime();
+        dh = new ZrtpDH(type);
+        dh->generatePublicKey();
+        detailInfo.cpuTime[CpuDhKeygen] += (int64_t)(zrtpGetThreadCpuTime() - cpuStart);
+    }
+    return dh;
+}
+
 /*
  * This method simplifies detection of libzrtpcpp inside Automake, configure
  * and friends
@@ -52,11 +338,16 @@ extern "C" {
 }
 #endif
 
-ZRtp::ZRtp(uint8_t *myZid, ZrtpCallback *cb, std::string id, ZrtpConfigure* config, bool mitm, bool sasSignSupport):
-        callback(cb), dhContext(nullptr), DHss(nullptr), auxSecret(nullptr), auxSecretLength(0), rs1Valid(false),
+ZRtp::ZRtp(uint8_t *myZid, ZrtpCallback *cb, ZrtpConfigure* config, ZrtpTrace* tr):
+        callback(cb), dhContext(nullptr), DHss(nullptr), asyncKeyAgreement(config->isAsyncKeyAgreement() && tr == nullptr),
+        agreementsRunning(0), asyncSasSignature(config->isAsyncSasSignature() && tr == nullptr),
+        signatureState(SignatureIdle), auxSecret(nullptr), auxSecretLength(0), rs1Valid(false),
         rs2Valid(false), msgShaContext(nullptr), hash(nullptr), cipher(nullptr), pubKey(nullptr), sasType(nullptr), authLength(nullptr),
-        multiStream(false), multiStreamAvailable(false), peerIsEnrolled(false), mitmSeen(false), pbxSecretTmp(nullptr),
-        enrollmentMode(false), configureAlgos(*config), zidRec(nullptr), saveZidRecord(true), signSasSeen(false),
+        exportPending(false), multiStream(false), multiStreamAvailable(false), presharedMode(false), peerIsEnrolled(false), mitmSeen(false), pbxSecretTmp(nullptr),
+        enrollmentMode(false), configureAlgos(*config), trace(tr), zidRec(nullptr),
+        asyncZidCache(config->isAsyncZidCache() && tr == nullptr),
+        speculativeKeyGen(config->isSpeculativeKeyGeneration() && tr == nullptr),
+        speculativeType(0), saveZidRecord(true), signSasSeen(false),
         masterStream(nullptr), peerDisclosureFlagSeen(false) {
 
 #ifdef ZRTP_SAS_RELAY_SUPPORT
@@ -68,7 +359,6 @@ ZRtp::ZRtp(uint8_t *myZid, ZrtpCallback *cb, std::string id, ZrtpConfigure* conf
 
     signatureData = nullptr;
     paranoidMode = config->isParanoidMode();
-    sasSignSupport = config->isSasSignature();
 
     // setup the implicit hash function pointers and length. The casts show that we use different
     // functions
@@ -83,10 +373,22 @@ ZRtp::ZRtp(uint8_t *myZid, ZrtpCallback *cb, std::string id, ZrtpConfigure* conf
      * Generate H0 as a random number (256 bits, 32 bytes) and then
      * the hash chain, refer to chapter 9. Use the implicit hash function.
      */
-    randomZRTP(H0, HASH_IMAGE_SIZE);
+    {
+        TraceScope scope(trace);
+        randomZRTP(H0, HASH_IMAGE_SIZE);
+    }
     sha256(H0, HASH_IMAGE_SIZE, H1);        // hash H0 and generate H1
     sha256(H1, HASH_IMAGE_SIZE, H2);        // H2
     sha256(H2, HASH_IMAGE_SIZE, H3);        // H3
+}
+
+ZRtp::ZRtp(uint8_t *myZid, ZrtpCallback *cb, std::string id, ZrtpConfigure* config, bool mitm, bool sasSignSupport):
+        ZRtp(myZid, cb, config, config->getTrace()) {
+
+    if (trace != nullptr)
+        trace->traceEngine(ownZid, id, configureAlgos, mitm);
+
+    sasSignSupport = config->isSasSignature();
 
     // configure all supported Hello packet versions
     zrtpHello_11.configureHello(&configureAlgos);
@@ -95,18 +397,11 @@ ZRtp::ZRtp(uint8_t *myZid, ZrtpCallback *cb, std::string id, ZrtpConfigure* conf
     zrtpHello_11.setVersion((uint8_t*)zrtpVersion_11);
 
 
-    zrtpHello_12.configureHello(&configureAlgos);
-    zrtpHello_12.setH3(H3);                 // set H3 in Hello, included in helloHash
-    zrtpHello_12.setZid(ownZid);
-    zrtpHello_12.setVersion((uint8_t*)zrtpVersion_12);
-
     if (mitm) {                             // this session acts for a trusted MitM (PBX)
         zrtpHello_11.setMitmMode();
-        zrtpHello_12.setMitmMode();
     }
     if (sasSignSupport) {                   // the application supports SAS signing
         zrtpHello_11.setSasSign();
-        zrtpHello_12.setSasSign();
     }
 
     // Keep array in ascending order (greater index -> greater version)
@@ -114,27 +409,64 @@ ZRtp::ZRtp(uint8_t *myZid, ZrtpCallback *cb, std::string id, ZrtpConfigure* conf
     helloPackets[0].version = zrtpHello_11.getVersionInt();
     setClientId(id, &helloPackets[0]);      // set id, compute HMAC and final helloHash
 
-    helloPackets[1].packet = &zrtpHello_12;
-    helloPackets[1].version = zrtpHello_12.getVersionInt();
-    setClientId(id, &helloPackets[1]);      // set id, compute HMAC and final helloHash
- 
+    // The Hello packets of the versions that the engine does not send are built on request
+    for (int32_t i = 1; i <= MAX_ZRTP_VERSIONS; i++) {
+        helloPackets[i].packet = nullptr;
+    }
+    for (int32_t i = 1; i < SUPPORTED_ZRTP_VERSIONS; i++) {
+        prepareHello(i);
+    }
     currentHelloPacket = helloPackets[SUPPORTED_ZRTP_VERSIONS-1].packet;  // start with highest supported version
-    helloPackets[SUPPORTED_ZRTP_VERSIONS].packet = nullptr;
     peerHelloVersion[0] = 0;
 
     stateEngine = new ZrtpStateClass(this);
+    stateEngine->setFastStart(configureAlgos.isFastStart());
+    resetHandshakeTimes();
+}
+
+// A multi-stream engine derives its keys from the master, it is not traced
+ZRtp::ZRtp(ZrtpCallback *cb, ZRtp* master): ZRtp(master->ownZid, cb, &master->configureAlgos, nullptr) {
+
+    // Copy the configured Hello packet of the master, only H3, HMAC and helloHash differ
+    zrtpHello_11.configureHello(master->zrtpHello_11);
+    zrtpHello_11.setH3(H3);
+
+    helloPackets[0].packet = &zrtpHello_11;
+    helloPackets[0].version = master->helloPackets[0].version;
+    computeHelloHmac(&helloPackets[0]);
+
+    for (int32_t i = 1; i <= MAX_ZRTP_VERSIONS; i++) {
+        helloPackets[i].packet = nullptr;
+    }
+    for (int32_t i = 1; i < SUPPORTED_ZRTP_VERSIONS; i++) {
+        prepareHello(i);
+    }
+    currentHelloPacket = helloPackets[SUPPORTED_ZRTP_VERSIONS-1].packet;  // start with highest supported version
+    peerHelloVersion[0] = 0;
+
+    stateEngine = new ZrtpStateClass(this);
+    stateEngine->setFastStart(configureAlgos.isFastStart());
+
+    // Take the negotiated algorithms and the session key, same as setMultiStrParams
+    if (master->inState(SecureState) && !master->multiStream) {
+        hash = master->hash;
+        setNegotiatedHash(hash);           // sets hashlength
+        authLength = master->authLength;
+        cipher = master->cipher;
+        memcpy(zrtpSession, master->zrtpSession, hashLength);
+
+        multiStream = true;
+        stateEngine->setMultiStream(true);
+        masterStream = master;
+    }
 }
 
 ZRtp::~ZRtp() {
-    stopZrtp();
+    detachCallback();
     if (DHss != nullptr) {
-        delete DHss;
+        deleteSecret(DHss, 0);
         DHss = nullptr;
     }
-    if (stateEngine != nullptr) {
-        delete stateEngine;
-        stateEngine = nullptr;
-    }
     if (dhContext != nullptr) {
         delete dhContext;
         dhContext = nullptr;
@@ -148,9 +480,13 @@ ZRtp::~ZRtp() {
         auxSecret = nullptr;
         auxSecretLength = 0;
     }
-    if (zidRec != nullptr) {
-        delete zidRec;
-        zidRec = nullptr;
+    zidRecStorage.reset();
+    zidRec = nullptr;
+    if (zidRecPrefetch.valid()) {
+        delete zidRecPrefetch.get();
+    }
+    if (speculativeDh.valid()) {
+        delete speculativeDh.get();
     }
     memset(hmacKeyI, 0, MAX_DIGEST_LENGTH);
     memset(hmacKeyR, 0, MAX_DIGEST_LENGTH);
@@ -169,12 +505,40 @@ ZRtp::~ZRtp() {
     memset(srtpSaltR, 0, MAX_DIGEST_LENGTH);
 
     memset(zrtpSession, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(exportSecret, 0, MAX_DIGEST_LENGTH);
+    memset_volatile(zrtpExport, 0, MAX_DIGEST_LENGTH);
 
-    peerNonces.clear();
+    peerNonces.reset();
+}
+
+void ZRtp::detachCallback() {
+    if (callback == nullptr)
+        return;
+
+    // Drop a pending key agreement and wait until the worker released all agreements
+    synchEnter();
+    cancelKeyAgreement();
+    cancelSasSignature();
+    synchLeave();
+    {
+        std::unique_lock<std::mutex> guard(agreementLock);
+        while (agreementsRunning > 0)
+            agreementIdle.wait(guard);
+    }
+    stopZrtp();
+    if (stateEngine != nullptr) {
+        delete stateEngine;
+        stateEngine = nullptr;
+    }
+    callback = nullptr;
 }
 
 void ZRtp::processZrtpMessage(uint8_t *message, uint32_t pSSRC, size_t length) {
     Event ev;
+    TraceScope scope(trace);
+
+    if (trace != nullptr)
+        trace->traceReceived(message, pSSRC, length);
 
     peerSSRC = pSSRC;
     ev.type = ZrtpPacket;
@@ -186,8 +550,49 @@ void ZRtp::processZrtpMessage(uint8_t *message, uint32_t pSSRC, size_t length) {
     }
 }
 
+// Messages the state engine processes under one lock acquisition
+static const int32_t maxMessageBatch = 16;
+
+int32_t ZRtp::processZrtpMessages(uint8_t* const extHeaders[], const size_t lengths[], int32_t count, uint32_t pSSRC) {
+    Event events[maxMessageBatch];
+    int32_t processed = 0;
+    TraceScope scope(trace);
+
+    if (stateEngine == nullptr)
+        return 0;
+
+    peerSSRC = pSSRC;
+    for (int32_t first = 0; first < count; first += maxMessageBatch) {
+        int32_t last = (count - first > maxMessageBatch) ? first + maxMessageBatch : count;
+        int32_t numEvents = 0;
+
+        for (int32_t i = first; i < last; i++) {
+            // The response to the first copy of a resent message is already on its way
+            bool resent = false;
+            for (int32_t j = 0; j < i && !resent; j++)
+                resent = lengths[j] == lengths[i] && lengths[i] > 12 && memcmp(extHeaders[j], extHeaders[i], lengths[i] - 12) == 0;
+            if (resent)
+                continue;
+
+            if (trace != nullptr)
+                trace->traceReceived(extHeaders[i], pSSRC, lengths[i]);
+            events[numEvents].type = ZrtpPacket;
+            events[numEvents].length = lengths[i];
+            events[numEvents].packet = extHeaders[i];
+            numEvents++;
+        }
+        stateEngine->processEvents(events, numEvents);
+        processed += numEvents;
+    }
+    return processed;
+}
+
 void ZRtp::processTimeout() {
     Event ev;
+    TraceScope scope(trace);
+
+    if (trace != nullptr)
+        trace->traceTimeout();
 
     ev.type = Timer;
     if (stateEngine != nullptr) {
@@ -222,17 +627,61 @@ bool ZRtp::handleGoClear(uint8_t *message)
 
 void ZRtp::startZrtpEngine() {
     Event ev;
+    TraceScope scope(trace);
 
     if (stateEngine != nullptr && stateEngine->inState(Initial)) {
+        if (trace != nullptr)
+            trace->traceStart();
+        if (!hs)
+            hs.reset(new Handshake);
+        resetHandshakeTimes();
+        ZrtpMetrics::countHandshakeStarted();
+        startSpeculativeKeyGeneration();
         ev.type = ZrtpInitial;
         stateEngine->processEvent(&ev);
     }
 }
 
+void ZRtp::startSpeculativeKeyGeneration() {
+
+    if (!speculativeKeyGen || multiStream || speculativeDh.valid() || dhContext != nullptr)
+        return;
+
+    // Guess the negotiated algorithm: the preferred one of our own configuration
+    const char* type = nullptr;
+    if (configureAlgos.getSelectionPolicy() == ZrtpConfigure::PreferLowCost) {
+        AlgorithmEnum* algo = findLowestCost(zrtpPubKeys, getConfiguredMask(PubKeyAlgorithm));
+        if (algo != nullptr)
+            type = algo->getName();
+    }
+    for (int i = 0, num = configureAlgos.getNumConfiguredAlgos(PubKeyAlgorithm); type == nullptr && i < num; i++) {
+        const char* name = configureAlgos.getAlgoAt(PubKeyAlgorithm, i).getName();
+        if (*(int32_t*)name != *(int32_t*)mult && *(int32_t*)name != *(int32_t*)prsh) {
+            type = name;
+            break;
+        }
+    }
+    if (type == nullptr || ZrtpDHPool::getAvailable(type) > 0)
+        return;
+
+    std::shared_ptr<std::promise<ZrtpDH*> > result = std::make_shared<std::promise<ZrtpDH*> >();
+    speculativeDh = result->get_future();
+    speculativeType = *(int32_t*)type;
+
+    ZrtpDHWorker::submit([result, type]() {
+        ZrtpDH* dh = new ZrtpDH(type);
+        dh->generatePublicKey();
+        result->set_value(dh);
+    });
+}
+
 void ZRtp::stopZrtp() {
     Event ev;
+    TraceScope scope(trace);
 
     if (stateEngine != nullptr) {
+        if (trace != nullptr)
+            trace->traceStop();
         ev.type = ZrtpClose;
         stateEngine->processEvent(&ev);
     }
@@ -280,7 +729,11 @@ ZrtpPacketCommit* ZRtp::prepareCommit(ZrtpPacketHello *hello, uint32_t* errMsg)
         *errMsg = EqualZIDHello;
         return nullptr;
     }
-    memcpy(peerH3, hello->getH3(), HASH_IMAGE_SIZE);
+    // Read the peer's ZID record while we prepare the key agreement
+    if (asyncZidCache && !multiStream && zidRec == nullptr && !zidRecPrefetch.valid()) {
+        zidRecPrefetch = ZIDCacheAsync::prefetchRecord(peerZid);
+    }
+    memcpy(hs->peerH3, hello->getH3(), HASH_IMAGE_SIZE);
 
     uint32_t helloLen = hello->getLength() * ZRTP_WORD_SIZE;
 
@@ -315,6 +768,18 @@ ZrtpPacketCommit* ZRtp::prepareCommit(ZrtpPacketHello *hello, uint32_t* errMsg)
             cipher = findBestCipher(hello, pubKey);
         if (authLength == nullptr)                         // public key selection may have set the SRTP authLen already
             authLength = findBestAuthLen(hello);
+        if (cipher->getAlgoId() == ChaCha20 && authLength->getAlgoId() != ChaCha20Poly1305) {
+            // ChaCha20 requires the ChaCha20-Poly1305 tag, use it if the peer offers it
+            bool offered = false;
+            for (int i = 0, num = hello->getNumAuth(); i < num && !offered; i++)
+                offered = *(int32_t*)(hello->getAuthLen(i)) == *(int32_t*)cp16;
+            if (offered)
+                authLength = &zrtpAuthLengths.getByName(cp16);
+            else
+                cipher = &zrtpSymCiphers.getByName(mandatoryCipher);
+        }
+        if (!isSrtpSuite(cipher, authLength))           // AEAD tag does not match the cipher
+            authLength = &zrtpAuthLengths.getByName(mandatoryAuthLen_1);
         multiStreamAvailable = checkMultiStream(hello);
     }
     else {
@@ -330,132 +795,206 @@ ZrtpPacketCommit* ZRtp::prepareCommit(ZrtpPacketHello *hello, uint32_t* errMsg)
     }
     setNegotiatedHash(hash);
 
-    // Modify here when introducing new DH key agreement, for example
-    // elliptic curves.
-    dhContext = new ZrtpDH(pubKey->getName());
-    dhContext->generatePublicKey();
+#ifdef ZRTP_SAS_RELAY_SUPPORT
+    // Check if a PBX application set the MitM flag.
+    mitmSeen = hello->isMitmMode();
+#endif
 
-    dhContext->getPubKeyBytes(pubKeyBytes);
-    sendInfo(Info, InfoCommitDHGenerated);
+    signSasSeen = hello->isSasSign();
 
     // Prepare IV data that we will use during confirm packet encryption.
     randomZRTP(randomIV, sizeof(randomIV));
 
+    // Preshared mode needs the peer's retained secret to decide if we can skip
+    // the DH key agreement. Otherwise read the ZID record while we prepare the
+    // DH key, see prepareCommitDH().
+    presharedMode = false;
+    if (checkPreshared(hello)) {
+        readZidRecord();
+        if (canUsePreshared()) {
+            computeSharedSecretSet(zidRec);
+            return prepareCommitPreshared(hello);
+        }
+    }
+    return prepareCommitDH(hello);
+}
+
+ZrtpPacketCommit* ZRtp::prepareCommitDH(ZrtpPacketHello *hello) {
+
+    // Modify here when introducing new DH key agreement, for example
+    // elliptic curves. A Preshared Commit did not prepare a DH context.
+    if (dhContext == nullptr)
+        dhContext = createDhContext(pubKey->getName());
+
+    dhContext->getPubKeyBytes(hs->pubKeyBytes);
+    sendInfo(Info, InfoCommitDHGenerated);
+
     /*
      * Prepare our DHPart2 packet here. Required to compute HVI. If we stay
      * in Initiator role then we reuse this packet later in prepareDHPart2().
      * To create this DH packet we have to compute the retained secret ids,
      * thus get our peer's retained secret data first.
      */
-    zidRec = getZidCacheInstance()->getRecord(peerZid);
+    readZidRecord();
 
     //Compute the Initiator's and Responder's retained secret ids.
     computeSharedSecretSet(zidRec);
 
-#ifdef ZRTP_SAS_RELAY_SUPPORT
-    // Check if a PBX application set the MitM flag.
-    mitmSeen = hello->isMitmMode();
-#endif
-
-    signSasSeen = hello->isSasSign();
-
     // Construct a DHPart2 message (Initiator's DH message). This packet
     // is required to compute the HVI (Hash Value Initiator), refer to
     // chapter 5.4.1.1.
 
     // Fill the values in the DHPart2 packet
-    zrtpDH2.setPubKeyType(pubKey->getName());
-    zrtpDH2.setMessageType((uint8_t*)DHPart2Msg);
-    zrtpDH2.setRs1Id(rs1IDi);
-    zrtpDH2.setRs2Id(rs2IDi);
-    zrtpDH2.setAuxSecretId(auxSecretIDi);
-    zrtpDH2.setPbxSecretId(pbxSecretIDi);
-    zrtpDH2.setPv(pubKeyBytes);
-    zrtpDH2.setH1(H1);
+    hs->zrtpDH2.setPubKeyType(pubKey->getName());
+    hs->zrtpDH2.setMessageType((uint8_t*)DHPart2Msg);
+    hs->zrtpDH2.setRs1Id(hs->rs1IDi);
+    hs->zrtpDH2.setRs2Id(hs->rs2IDi);
+    hs->zrtpDH2.setAuxSecretId(hs->auxSecretIDi);
+    hs->zrtpDH2.setPbxSecretId(hs->pbxSecretIDi);
+    hs->zrtpDH2.setPv(hs->pubKeyBytes);
+    hs->zrtpDH2.setH1(H1);
 
-    uint32_t len = zrtpDH2.getLength() * ZRTP_WORD_SIZE;
+    uint32_t len = hs->zrtpDH2.getLength() * ZRTP_WORD_SIZE;
 
     // Compute HMAC over DH2, excluding the HMAC field (HMAC_SIZE)
     // and store in DH2. Key to HMAC is H0, use HASH_IMAGE_SIZE bytes only.
     // Must use implicit HMAC functions.
     uint8_t hmac[IMPL_MAX_DIGEST_LENGTH];
     uint32_t macLen;
-    hmacFunctionImpl(H0, HASH_IMAGE_SIZE, (uint8_t*)zrtpDH2.getHeaderBase(), len-(HMAC_SIZE), hmac, &macLen);
-    zrtpDH2.setHMAC(hmac);
+    hmacFunctionImpl(H0, HASH_IMAGE_SIZE, (uint8_t*)hs->zrtpDH2.getHeaderBase(), len-(HMAC_SIZE), hmac, &macLen);
+    hs->zrtpDH2.setHMAC(hmac);
 
     // Compute the HVI, refer to chapter 5.4.1.1 of the specification
-    computeHvi(&zrtpDH2, hello);
+    computeHvi(&hs->zrtpDH2, hello);
 
-    zrtpCommit.setZid(ownZid);
-    zrtpCommit.setHashType((uint8_t*)hash->getName());
-    zrtpCommit.setCipherType((uint8_t*)cipher->getName());
-    zrtpCommit.setAuthLen((uint8_t*)authLength->getName());
-    zrtpCommit.setPubKeyType((uint8_t*)pubKey->getName());
-    zrtpCommit.setSasType((uint8_t*)sasType->getName());
-    zrtpCommit.setHvi(hvi);
-    zrtpCommit.setH2(H2);
+    hs->zrtpCommit.setZid(ownZid);
+    hs->zrtpCommit.setHashType((uint8_t*)hash->getName());
+    hs->zrtpCommit.setCipherType((uint8_t*)cipher->getName());
+    hs->zrtpCommit.setAuthLen((uint8_t*)authLength->getName());
+    hs->zrtpCommit.setPubKeyType((uint8_t*)pubKey->getName());
+    hs->zrtpCommit.setSasType((uint8_t*)sasType->getName());
+    hs->zrtpCommit.setHvi(hs->hvi);
+    hs->zrtpCommit.setH2(H2);
 
-    len = zrtpCommit.getLength() * ZRTP_WORD_SIZE;
+    len = hs->zrtpCommit.getLength() * ZRTP_WORD_SIZE;
 
     // Compute HMAC over Commit, excluding the HMAC field (HMAC_SIZE)
     // and store in Hello. Key to HMAC is H1, use HASH_IMAGE_SIZE bytes only.
     // Must use implicit HMAC functions.
-    hmacFunctionImpl(H1, HASH_IMAGE_SIZE, (uint8_t*)zrtpCommit.getHeaderBase(), len-(HMAC_SIZE), hmac, &macLen);
-    zrtpCommit.setHMAC(hmac);
+    hmacFunctionImpl(H1, HASH_IMAGE_SIZE, (uint8_t*)hs->zrtpCommit.getHeaderBase(), len-(HMAC_SIZE), hmac, &macLen);
+    hs->zrtpCommit.setHMAC(hmac);
 
     // hash first messages to produce overall message hash
     // First the Responder's Hello message, second the Commit (always Initator's).
     // Must use negotiated hash.
-    msgShaContext = createHashCtx(msgShaContext);
-    hashCtxFunction(msgShaContext, (unsigned char*)hello->getHeaderBase(), helloLen);
-    hashCtxFunction(msgShaContext, (unsigned char*)zrtpCommit.getHeaderBase(), len);
+    startMsgHash();
+    hashMsg(hello);
+    hashMsg(&hs->zrtpCommit);
 
     // store Hello data temporarily until we can check HMAC after receiving Commit as
     // Responder or DHPart1 as Initiator
     storeMsgTemp(hello);
 
-    return &zrtpCommit;
+    return &hs->zrtpCommit;
+}
+
+ZrtpPacketCommit* ZRtp::prepareCommitPreshared(ZrtpPacketHello *hello) {
+
+    uint8_t keyId[2*ZRTP_WORD_SIZE];
+
+    randomZRTP(hs->hvi, ZRTP_WORD_SIZE*4);  // This is the Preshared NONCE size
+    computePresharedKey(keyId);
+    presharedMode = true;
+
+    hs->zrtpCommit.setZid(ownZid);
+    hs->zrtpCommit.setHashType((uint8_t*)hash->getName());
+    hs->zrtpCommit.setCipherType((uint8_t*)cipher->getName());
+    hs->zrtpCommit.setAuthLen((uint8_t*)authLength->getName());
+    hs->zrtpCommit.setPubKeyType((uint8_t*)prsh);  // this is fixed because of Preshared mode
+    hs->zrtpCommit.setSasType((uint8_t*)sasType->getName());
+    hs->zrtpCommit.setNonce(hs->hvi);
+    hs->zrtpCommit.setKeyId(keyId);
+    hs->zrtpCommit.setH2(H2);
+
+    uint32_t len = hs->zrtpCommit.getLength() * ZRTP_WORD_SIZE;
+
+    // Compute HMAC over Commit, excluding the HMAC field (HMAC_SIZE)
+    // and store in Commit. Key to HMAC is H1, use HASH_IMAGE_SIZE bytes only.
+    // Must use the implicit HMAC function.
+    uint8_t hmac[IMPL_MAX_DIGEST_LENGTH];
+    uint32_t macLen;
+    hmacFunctionImpl(H1, HASH_IMAGE_SIZE, (uint8_t*)hs->zrtpCommit.getHeaderBase(), len-(HMAC_SIZE), hmac, &macLen);
+    hs->zrtpCommit.setHMACPresh(hmac);
+
+    // hash first messages to produce overall message hash
+    // First the Responder's Hello message, second the Commit
+    // (always Initator's).
+    // Must use the negotiated hash.
+    startMsgHash();
+    hashMsg(hello);
+    hashMsg(&hs->zrtpCommit);
+
+    // store Hello data temporarily until we can check HMAC after receiving Commit as
+    // Responder or Confirm1 as Initiator
+    storeMsgTemp(hello);
+
+    return &hs->zrtpCommit;
+}
+
+/*
+ * At this point we received a Preshared Commit but we don't have a matching
+ * preshared key. Answer with a DH Commit, the DH Commit wins the Commit
+ * contention and the peer switches to Responder, refer to RFC 6189, chapter 4.2.
+ */
+ZrtpPacketCommit* ZRtp::prepareCommitDHFallback() {
+
+    // The temporary buffer still holds the peer's Hello, see prepareConfirm1Preshared()
+    uint8_t helloData[sizeof(hs->tempMsgBuffer)];
+    memcpy(helloData, hs->tempMsgBuffer, hs->lengthOfMsgData);
+    ZrtpPacketHello hello(helloData);
+
+    myRole = Initiator;
+    presharedMode = false;
+    return prepareCommitDH(&hello);
 }
 
 ZrtpPacketCommit* ZRtp::prepareCommitMultiStream(ZrtpPacketHello *hello) {
 
-    randomZRTP(hvi, ZRTP_WORD_SIZE*4);  // This is the Multi-Stream NONCE size
+    randomZRTP(hs->hvi, ZRTP_WORD_SIZE*4);  // This is the Multi-Stream NONCE size
 
-    zrtpCommit.setZid(ownZid);
-    zrtpCommit.setHashType((uint8_t*)hash->getName());
-    zrtpCommit.setCipherType((uint8_t*)cipher->getName());
-    zrtpCommit.setAuthLen((uint8_t*)authLength->getName());
-    zrtpCommit.setPubKeyType((uint8_t*)mult);  // this is fixed because of Multi Stream mode
-    zrtpCommit.setSasType((uint8_t*)sasType->getName());
-    zrtpCommit.setNonce(hvi);
-    zrtpCommit.setH2(H2);
+    hs->zrtpCommit.setZid(ownZid);
+    hs->zrtpCommit.setHashType((uint8_t*)hash->getName());
+    hs->zrtpCommit.setCipherType((uint8_t*)cipher->getName());
+    hs->zrtpCommit.setAuthLen((uint8_t*)authLength->getName());
+    hs->zrtpCommit.setPubKeyType((uint8_t*)mult);  // this is fixed because of Multi Stream mode
+    hs->zrtpCommit.setSasType((uint8_t*)sasType->getName());
+    hs->zrtpCommit.setNonce(hs->hvi);
+    hs->zrtpCommit.setH2(H2);
 
-    uint32_t len = zrtpCommit.getLength() * ZRTP_WORD_SIZE;
+    uint32_t len = hs->zrtpCommit.getLength() * ZRTP_WORD_SIZE;
 
     // Compute HMAC over Commit, excluding the HMAC field (HMAC_SIZE)
     // and store in Hello. Key to HMAC is H1, use HASH_IMAGE_SIZE bytes only.
     // Must use the implicit HMAC function.
     uint8_t hmac[IMPL_MAX_DIGEST_LENGTH];
     uint32_t macLen;
-    hmacFunctionImpl(H1, HASH_IMAGE_SIZE, (uint8_t*)zrtpCommit.getHeaderBase(), len-(HMAC_SIZE), hmac, &macLen);
-    zrtpCommit.setHMACMulti(hmac);
+    hmacFunctionImpl(H1, HASH_IMAGE_SIZE, (uint8_t*)hs->zrtpCommit.getHeaderBase(), len-(HMAC_SIZE), hmac, &macLen);
+    hs->zrtpCommit.setHMACMulti(hmac);
 
 
     // hash first messages to produce overall message hash
     // First the Responder's Hello message, second the Commit
     // (always Initator's).
     // Must use the negotiated hash.
-    msgShaContext = createHashCtx(msgShaContext);
-
-    uint32_t helloLen = hello->getLength() * ZRTP_WORD_SIZE;
-    hashCtxFunction(msgShaContext, (unsigned char*)hello->getHeaderBase(), helloLen);
-    hashCtxFunction(msgShaContext, (unsigned char*)zrtpCommit.getHeaderBase(), len);
+    startMsgHash();
+    hashMsg(hello);
+    hashMsg(&hs->zrtpCommit);
 
     // store Hello data temporarily until we can check HMAC after receiving Commit as
     // Responder or DHPart1 as Initiator
     storeMsgTemp(hello);
 
-    return &zrtpCommit;
+    return &hs->zrtpCommit;
 }
 
 /*
@@ -488,10 +1027,10 @@ ZrtpPacketDHPart* ZRtp::prepareDHPart1(ZrtpPacketCommit *commit, uint32_t* errMs
     // The following code checks the hash chain according chapter 10 to detect false ZRTP packets.
     // Must use the implicit hash function.
     uint8_t tmpH3[IMPL_MAX_DIGEST_LENGTH];
-    memcpy(peerH2, commit->getH2(), HASH_IMAGE_SIZE);
-    hashFunctionImpl(peerH2, HASH_IMAGE_SIZE, tmpH3);
+    memcpy(hs->peerH2, commit->getH2(), HASH_IMAGE_SIZE);
+    hashFunctionImpl(hs->peerH2, HASH_IMAGE_SIZE, tmpH3);
 
-    if (memcmp(tmpH3, peerH3, HASH_IMAGE_SIZE) != 0) {
+    if (memcmp(tmpH3, hs->peerH3, HASH_IMAGE_SIZE) != 0) {
         *errMsg = IgnorePacket;
         return nullptr;
     }
@@ -499,7 +1038,7 @@ ZrtpPacketDHPart* ZRtp::prepareDHPart1(ZrtpPacketCommit *commit, uint32_t* errMs
     // Check HMAC of previous Hello packet stored in temporary buffer. The
     // HMAC key of peer's Hello packet is peer's H2 that is contained in the
     // Commit packet. Refer to chapter 9.1.
-    if (!checkMsgHmac(peerH2)) {
+    if (!checkMsgHmac(hs->peerH2)) {
         sendInfo(Severe, SevereHelloHMACFailed);
         *errMsg = CriticalSWError;
         return nullptr;
@@ -515,7 +1054,7 @@ ZrtpPacketDHPart* ZRtp::prepareDHPart1(ZrtpPacketCommit *commit, uint32_t* errMs
 
     // check if we support the commited Authentication length
     cp = &zrtpAuthLengths.getByName((const char*)commit->getAuthLen());
-    if (!cp->isValid()) { // no match - something went wrong
+    if (!cp->isValid() || !isSrtpSuite(cipher, cp)) { // no match - something went wrong
         *errMsg = UnsuppSRTPAuthTag;
         return nullptr;
     }
@@ -559,65 +1098,62 @@ ZrtpPacketDHPart* ZRtp::prepareDHPart1(ZrtpPacketCommit *commit, uint32_t* errMs
     }
     sasType = cp;
 
-    // dhContext cannot be nullptr - always setup during prepareCommit()
+    // dhContext is nullptr if prepareCommit() prepared a Preshared Commit.
     // check if we can use the dhContext prepared by prepareCommit(),
     // if not delete old DH context and generate new one
     // The algorithm names are 4 chars only, thus we can cast to int32_t
-    if (*(int32_t*)(dhContext->getDHtype()) != *(int32_t*)(pubKey->getName())) {
+    if (dhContext == nullptr || *(int32_t*)(dhContext->getDHtype()) != *(int32_t*)(pubKey->getName())) {
         delete dhContext;
-        dhContext = new ZrtpDH(pubKey->getName());
-        dhContext->generatePublicKey();
+        dhContext = createDhContext(pubKey->getName());
     }
+    presharedMode = false;
     sendInfo(Info, InfoDH1DHGenerated);
 
-    dhContext->getPubKeyBytes(pubKeyBytes);
+    dhContext->getPubKeyBytes(hs->pubKeyBytes);
 
     // Re-compute auxSecretIDr because we changed roles *IDr with my H3, *IDi with peer's H3
     // Setup a DHPart1 packet.
     myRole = Responder;
     computeAuxSecretIds();                 // recompute AUX secret ids because we are now Responder, use different H3
 
-    zrtpDH1.setPubKeyType(pubKey->getName());
-    zrtpDH1.setMessageType((uint8_t*)DHPart1Msg);
-    zrtpDH1.setRs1Id(rs1IDr);
-    zrtpDH1.setRs2Id(rs2IDr);
-    zrtpDH1.setAuxSecretId(auxSecretIDr);
-    zrtpDH1.setPbxSecretId(pbxSecretIDr);
-    zrtpDH1.setPv(pubKeyBytes);
-    zrtpDH1.setH1(H1);
+    hs->zrtpDH1.setPubKeyType(pubKey->getName());
+    hs->zrtpDH1.setMessageType((uint8_t*)DHPart1Msg);
+    hs->zrtpDH1.setRs1Id(hs->rs1IDr);
+    hs->zrtpDH1.setRs2Id(hs->rs2IDr);
+    hs->zrtpDH1.setAuxSecretId(hs->auxSecretIDr);
+    hs->zrtpDH1.setPbxSecretId(hs->pbxSecretIDr);
+    hs->zrtpDH1.setPv(hs->pubKeyBytes);
+    hs->zrtpDH1.setH1(H1);
 
-    int32_t len = zrtpDH1.getLength() * ZRTP_WORD_SIZE;
+    int32_t len = hs->zrtpDH1.getLength() * ZRTP_WORD_SIZE;
 
     // Compute HMAC over DHPart1, excluding the HMAC field (HMAC_SIZE)
     // and store in DHPart1.
     // Use implicit Hash function
     uint8_t hmac[IMPL_MAX_DIGEST_LENGTH];
     uint32_t macLen;
-    hmacFunctionImpl(H0, HASH_IMAGE_SIZE, (uint8_t*)zrtpDH1.getHeaderBase(), len-(HMAC_SIZE), hmac, &macLen);
-    zrtpDH1.setHMAC(hmac);
+    hmacFunctionImpl(H0, HASH_IMAGE_SIZE, (uint8_t*)hs->zrtpDH1.getHeaderBase(), len-(HMAC_SIZE), hmac, &macLen);
+    hs->zrtpDH1.setHMAC(hmac);
 
     // We are definitly responder. Save the peer's hvi for later compare.
-    memcpy(peerHvi, commit->getHvi(), HVI_SIZE);
+    memcpy(hs->peerHvi, commit->getHvi(), HVI_SIZE);
 
-    // We are responder. Release the pre-computed SHA context because it was prepared for Initiator.
+    // We are responder. Discard the pre-computed message hash because it was prepared for Initiator.
     // Setup and compute for Responder.
-    if (msgShaContext != nullptr) {
-        closeHashCtx(msgShaContext, nullptr);
-    }
-    msgShaContext = createHashCtx(msgShaContext);
+    startMsgHash();
 
     // Hash messages to produce overall message hash:
     // First the Responder's (my) Hello message, second the Commit (always Initator's), 
     // then the DH1 message (which is always a Responder's message).
     // Must use negotiated hash.
-    hashCtxFunction(msgShaContext, (unsigned char*)currentHelloPacket->getHeaderBase(), currentHelloPacket->getLength() * ZRTP_WORD_SIZE);
-    hashCtxFunction(msgShaContext, (unsigned char*)commit->getHeaderBase(), commit->getLength() * ZRTP_WORD_SIZE);
-    hashCtxFunction(msgShaContext, (unsigned char*)zrtpDH1.getHeaderBase(), zrtpDH1.getLength() * ZRTP_WORD_SIZE);
+    hashMsg(currentHelloPacket);
+    hashMsg(commit);
+    hashMsg(&hs->zrtpDH1);
 
     // store Commit data temporarily until we can check HMAC after we got DHPart2
     storeMsgTemp(commit);
 
-    return &zrtpDH1;
+    return &hs->zrtpDH1;
 }
 
 /*
@@ -625,13 +1161,46 @@ ZrtpPacketDHPart* ZRtp::prepareDHPart1(ZrtpPacketCommit *commit, uint32_t* errMs
  */
 ZrtpPacketDHPart* ZRtp::prepareDHPart2(ZrtpPacketDHPart *dhPart1, uint32_t* errMsg) {
 
+    if (!checkDHPart1(dhPart1, errMsg)) {
+        return nullptr;
+    }
+    uint64_t cpuStart = zrtpGetThreadCpuTime();
+    ZRTP_PROBE2(dh_compute_entry, this, dhContext->getDhSize());
+    dhContext->computeSecretKey(dhPart1->getPv(), DHss);
+    ZRTP_PROBE2(dh_compute_return, this, dhContext->getDhSize());
+    detailInfo.cpuTime[CpuDhAgreement] += (int64_t)(zrtpGetThreadCpuTime() - cpuStart);
+    return finishDHPart2(dhPart1);
+}
+
+bool ZRtp::startDHPart2(ZrtpPacketDHPart *dhPart1, uint32_t* errMsg) {
+
+    if (!checkDHPart1(dhPart1, errMsg)) {
+        return false;
+    }
+    startKeyAgreement(dhPart1);
+    return true;
+}
+
+ZrtpPacketDHPart* ZRtp::resumeDHPart2(uint32_t* errMsg) {
+
+    std::vector<uint8_t> packet;
+    if (!takeKeyAgreement(packet)) {
+        *errMsg = IgnorePacket;
+        return nullptr;
+    }
+    ZrtpPacketDHPart dhPart1(packet.data());
+    return finishDHPart2(&dhPart1);
+}
+
+bool ZRtp::checkDHPart1(ZrtpPacketDHPart *dhPart1, uint32_t* errMsg) {
+
     uint8_t* pvr;
 
     sendInfo(Info, InfoInitDH1Received);
 
     if (!dhPart1->isLengthOk()) {
         *errMsg = CriticalSWError;
-        return nullptr;
+        return false;
     }
     // Because we are initiator the protocol engine didn't receive Commit
     // thus could not store a peer's H2. A two step SHA256 is required to
@@ -639,52 +1208,54 @@ ZrtpPacketDHPart* ZRtp::prepareDHPart2(ZrtpPacketDHPart *dhPart1, uint32_t* errM
     // Must use implicit hash function.
     uint8_t tmpHash[IMPL_MAX_DIGEST_LENGTH];
     hashFunctionImpl(dhPart1->getH1(), HASH_IMAGE_SIZE, tmpHash); // Compute peer's H2
-    memcpy(peerH2, tmpHash, HASH_IMAGE_SIZE);
-    hashFunctionImpl(peerH2, HASH_IMAGE_SIZE, tmpHash);          // Compute peer's H3 (tmpHash)
+    memcpy(hs->peerH2, tmpHash, HASH_IMAGE_SIZE);
+    hashFunctionImpl(hs->peerH2, HASH_IMAGE_SIZE, tmpHash);          // Compute peer's H3 (tmpHash)
 
-    if (memcmp(tmpHash, peerH3, HASH_IMAGE_SIZE) != 0) {
+    if (memcmp(tmpHash, hs->peerH3, HASH_IMAGE_SIZE) != 0) {
         *errMsg = IgnorePacket;
-        return nullptr;
+        return false;
     }
 
     // Check HMAC of previous Hello packet stored in temporary buffer. The
     // HMAC key of the Hello packet is peer's H2 that was computed above.
     // Refer to chapter 9.1 and chapter 10.
-    if (!checkMsgHmac(peerH2)) {
+    if (!checkMsgHmac(hs->peerH2)) {
         sendInfo(Severe, SevereHelloHMACFailed);
         *errMsg = CriticalSWError;
-        return nullptr;
+        return false;
     }
 
     // get memory to store DH result TODO: make it fixed memory
-    DHss = new uint8_t[dhContext->getDhSize()];
+    DHss = newSecret(dhContext->getDhSize());
     if (DHss == nullptr) {
         *errMsg = CriticalSWError;
-        return nullptr;
+        return false;
     }
 
     // get and check Responder's public value, see chap. 5.4.3 in the spec
     pvr = dhPart1->getPv();
     if (pvr == nullptr) {
         *errMsg = IgnorePacket;
-        return nullptr;
+        return false;
     }
     if (!dhContext->checkPubKey(pvr)) {
         *errMsg = DHErrorWrongPV;
-        return nullptr;
+        return false;
     }
-    dhContext->computeSecretKey(pvr, DHss);
+    return true;
+}
+
+ZrtpPacketDHPart* ZRtp::finishDHPart2(ZrtpPacketDHPart *dhPart1) {
 
     // We are Initiator: the Responder's Hello and the Initiator's (our) Commit
     // are already hashed in the context. Now hash the Responder's DH1 and then
     // the Initiator's (our) DH2 in that order.
     // Use the negotiated hash function.
-    hashCtxFunction(msgShaContext, (unsigned char*)dhPart1->getHeaderBase(), dhPart1->getLength() * ZRTP_WORD_SIZE);
-    hashCtxFunction(msgShaContext, (unsigned char*)zrtpDH2.getHeaderBase(), zrtpDH2.getLength() * ZRTP_WORD_SIZE);
+    hashMsg(dhPart1);
+    hashMsg(&hs->zrtpDH2);
 
     // Compute the message Hash
-    closeHashCtx(msgShaContext, messageHash);
-    msgShaContext = nullptr;
+    finishMsgHash();
     // Now compute the S0, all dependend keys and the new RS1. The function
     // also performs sign SAS callback if it's active.
     generateKeysInitiator(dhPart1, zidRec);
@@ -695,7 +1266,7 @@ ZrtpPacketDHPart* ZRtp::prepareDHPart2(ZrtpPacketDHPart *dhPart1, uint32_t* errM
     // TODO: at initiator we can call signSAS at this point, don't delay until confirm1 received
     // store DHPart1 data temporarily until we can check HMAC after receiving Confirm1
     storeMsgTemp(dhPart1);
-    return &zrtpDH2;
+    return &hs->zrtpDH2;
 }
 
 /*
@@ -703,22 +1274,55 @@ ZrtpPacketDHPart* ZRtp::prepareDHPart2(ZrtpPacketDHPart *dhPart1, uint32_t* errM
  */
 ZrtpPacketConfirm* ZRtp::prepareConfirm1(ZrtpPacketDHPart* dhPart2, uint32_t* errMsg) {
 
+    if (!checkDHPart2(dhPart2, errMsg)) {
+        return nullptr;
+    }
+    uint64_t cpuStart = zrtpGetThreadCpuTime();
+    ZRTP_PROBE2(dh_compute_entry, this, dhContext->getDhSize());
+    dhContext->computeSecretKey(dhPart2->getPv(), DHss);
+    ZRTP_PROBE2(dh_compute_return, this, dhContext->getDhSize());
+    detailInfo.cpuTime[CpuDhAgreement] += (int64_t)(zrtpGetThreadCpuTime() - cpuStart);
+    return finishConfirm1(dhPart2, errMsg);
+}
+
+bool ZRtp::startConfirm1(ZrtpPacketDHPart* dhPart2, uint32_t* errMsg) {
+
+    if (!checkDHPart2(dhPart2, errMsg)) {
+        return false;
+    }
+    startKeyAgreement(dhPart2);
+    return true;
+}
+
+ZrtpPacketConfirm* ZRtp::resumeConfirm1(uint32_t* errMsg) {
+
+    std::vector<uint8_t> packet;
+    if (!takeKeyAgreement(packet)) {
+        *errMsg = IgnorePacket;
+        return nullptr;
+    }
+    ZrtpPacketDHPart dhPart2(packet.data());
+    return finishConfirm1(&dhPart2, errMsg);
+}
+
+bool ZRtp::checkDHPart2(ZrtpPacketDHPart* dhPart2, uint32_t* errMsg) {
+
     uint8_t* pvi;
 
     sendInfo(Info, InfoRespDH2Received);
 
     if (!dhPart2->isLengthOk()) {
         *errMsg = CriticalSWError;
-        return nullptr;
+        return false;
     }
     // Because we are responder we received a Commit and stored its H2.
     // Now re-compute H2 from received H1 and compare with stored peer's H2.
     // Use implicit hash function
     uint8_t tmpHash[IMPL_MAX_DIGEST_LENGTH];
     hashFunctionImpl(dhPart2->getH1(), HASH_IMAGE_SIZE, tmpHash);
-    if (memcmp(tmpHash, peerH2, HASH_IMAGE_SIZE) != 0) {
+    if (memcmp(tmpHash, hs->peerH2, HASH_IMAGE_SIZE) != 0) {
         *errMsg = IgnorePacket;
-        return nullptr;
+        return false;
     }
 
     // Check HMAC of Commit packet stored in temporary buffer. The
@@ -727,36 +1331,38 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm1(ZrtpPacketDHPart* dhPart2, uint32_t* er
     if (!checkMsgHmac(dhPart2->getH1())) {
         sendInfo(Severe, SevereCommitHMACFailed);
         *errMsg = CriticalSWError;
-        return nullptr;
+        return false;
     }
     // Now we have the peer's pvi. Because we are responder re-compute my hvi
     // using my Hello packet and the Initiator's DHPart2 and compare with
     // hvi sent in commit packet. If it doesn't macht then a MitM attack
     // may have occured.
     computeHvi(dhPart2, currentHelloPacket);
-    if (memcmp(hvi, peerHvi, HVI_SIZE) != 0) {
+    if (memcmp(hs->hvi, hs->peerHvi, HVI_SIZE) != 0) {
         *errMsg = DHErrorWrongHVI;
-        return nullptr;
+        return false;
     }
-    DHss = new uint8_t[dhContext->getDhSize()];
+    DHss = newSecret(dhContext->getDhSize());
     if (DHss == nullptr) {
         *errMsg = CriticalSWError;
-        return nullptr;
+        return false;
     }
     // Get and check the Initiator's public value, see chap. 5.4.2 of the spec
     pvi = dhPart2->getPv();
     if (!dhContext->checkPubKey(pvi)) {
         *errMsg = DHErrorWrongPV;
-        return nullptr;
+        return false;
     }
-    dhContext->computeSecretKey(pvi, DHss);
+    return true;
+}
+
+ZrtpPacketConfirm* ZRtp::finishConfirm1(ZrtpPacketDHPart* dhPart2, uint32_t* errMsg) {
 
     // Hash the Initiator's DH2 into the message Hash (other messages already prepared, see method prepareDHPart1().
     // Use neotiated hash function
-    hashCtxFunction(msgShaContext, (unsigned char*)dhPart2->getHeaderBase(), dhPart2->getLength() * ZRTP_WORD_SIZE);
+    hashMsg(dhPart2);
 
-    closeHashCtx(msgShaContext, messageHash);
-    msgShaContext = nullptr;
+    finishMsgHash();
     /*
      * The expected shared secret Ids were already computed when we built the
      * DHPart1 packet. Generate s0, all depended keys, and the new RS1 value
@@ -765,23 +1371,47 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm1(ZrtpPacketDHPart* dhPart2, uint32_t* er
      */
     generateKeysResponder(dhPart2, zidRec);
 
-    delete dhContext;
-    dhContext = nullptr;
+    delete dhContext;
+    dhContext = nullptr;
+
+    // store DHPart2 data temporarily until we can check HMAC after receiving Confirm2
+    storeMsgTemp(dhPart2);
+
+    // Confirm1 carries the SAS signature, send it after ZrtpSignatureReady
+    if (!takeSasSignature()) {
+        *errMsg = IgnorePacket;
+        return nullptr;
+    }
+    fillConfirm1();
+    return &hs->zrtpConfirm1;
+}
+
+ZrtpPacketConfirm* ZRtp::resumeSignedConfirm1(uint32_t* errMsg) {
+
+    if (!takeSasSignature()) {
+        *errMsg = IgnorePacket;
+        return nullptr;
+    }
+    fillConfirm1();
+    return &hs->zrtpConfirm1;
+}
+
+void ZRtp::fillConfirm1() {
 
     // Fill in Confirm1 packet.
-    zrtpConfirm1.setMessageType((uint8_t*)Confirm1Msg);
+    hs->zrtpConfirm1.setMessageType((uint8_t*)Confirm1Msg);
 
     // Check if user verfied the SAS in a previous call and thus verfied
     // the retained secret. Don't set the verified flag if paranoidMode is true.
     if (zidRec->isSasVerified() && !paranoidMode) {
-        zrtpConfirm1.setSASFlag();
+        hs->zrtpConfirm1.setSASFlag();
     }
     if (configureAlgos.isDisclosureFlag()) {
-        zrtpConfirm1.setDisclosureFlag();
+        hs->zrtpConfirm1.setDisclosureFlag();
     }
-    zrtpConfirm1.setExpTime(0xFFFFFFFF);
-    zrtpConfirm1.setIv(randomIV);
-    zrtpConfirm1.setHashH0(H0);
+    hs->zrtpConfirm1.setExpTime(0xFFFFFFFF);
+    hs->zrtpConfirm1.setIv(randomIV);
+    hs->zrtpConfirm1.setHashH0(H0);
 
 #ifdef ZRTP_SAS_RELAY_SUPPORT
     // if this runs at PBX user agent enrollment service then set flag in confirm
@@ -794,22 +1424,144 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm1(ZrtpPacketDHPart* dhPart2, uint32_t* er
             zidRec->setMiTMData(pbxSecretTmp);
         }
         // Set flag to enable user's client to ask for confirmation or re-confirmation.
-        zrtpConfirm1.setPBXEnrollment();
+        hs->zrtpConfirm1.setPBXEnrollment();
     }
 #endif
     uint8_t confMac[MAX_DIGEST_LENGTH];
     uint32_t macLen;
 
     // Encrypt and HMAC with Responder's key - we are Responder here
-    uint32_t hmLen = (zrtpConfirm1.getLength() - 9U) * ZRTP_WORD_SIZE;
-    cipher->getEncrypt()(zrtpKeyR, cipher->getKeylen(), randomIV, zrtpConfirm1.getHashH0(), hmLen);
-    hmacFunction(hmacKeyR, hashLength, zrtpConfirm1.getHashH0(), hmLen, confMac, &macLen);
+    uint32_t hmLen = (hs->zrtpConfirm1.getLength() - 9U) * ZRTP_WORD_SIZE;
+    cipher->getEncrypt()(zrtpKeyR, cipher->getKeylen(), randomIV, hs->zrtpConfirm1.getHashH0(), hmLen);
+    hmacFunction(hmacKeyR, hashLength, hs->zrtpConfirm1.getHashH0(), hmLen, confMac, &macLen);
 
-    zrtpConfirm1.setHmac(confMac);
+    hs->zrtpConfirm1.setHmac(confMac);
+}
 
-    // store DHPart2 data temporarily until we can check HMAC after receiving Confirm2
-    storeMsgTemp(dhPart2);
-    return &zrtpConfirm1;
+void ZRtp::startKeyAgreement(ZrtpPacketDHPart* dhPart) {
+
+    std::shared_ptr<DhAgreement> agreement = std::make_shared<DhAgreement>(this, dhContext, DHss,
+            dhPart->getHeaderBase(), dhPart->getLength() * ZRTP_WORD_SIZE);
+    dhContext = nullptr;
+    DHss = nullptr;
+    pendingAgreement = agreement;
+
+    ZrtpDHWorker::submit([agreement]() { agreement->run(); });
+}
+
+bool ZRtp::takeKeyAgreement(std::vector<uint8_t>& packet) {
+
+    if (pendingAgreement == nullptr) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> guard(pendingAgreement->lock);
+        if (!pendingAgreement->done || pendingAgreement->cancelled) {
+            return false;
+        }
+        dhContext = pendingAgreement->dhContext;
+        DHss = pendingAgreement->DHss;
+        detailInfo.cpuTime[CpuDhAgreement] += pendingAgreement->cpuTime;
+        pendingAgreement->dhContext = nullptr;
+        pendingAgreement->DHss = nullptr;
+        packet.swap(pendingAgreement->packet);
+    }
+    pendingAgreement.reset();
+    return true;
+}
+
+void ZRtp::cancelKeyAgreement() {
+
+    if (pendingAgreement == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(pendingAgreement->lock);
+        pendingAgreement->cancelled = true;
+    }
+    pendingAgreement.reset();
+}
+
+void ZRtp::keyAgreementReady() {
+    Event ev;
+
+    if (stateEngine != nullptr) {
+        ev.type = ZrtpKeyReady;
+        stateEngine->processEvent(&ev);
+    }
+}
+
+void ZRtp::startSasSignature() {
+
+    std::lock_guard<std::mutex> guard(signatureLock);
+    signatureState = SignatureRequested;
+    asyncSignature.clear();
+}
+
+bool ZRtp::takeSasSignature() {
+
+    std::lock_guard<std::mutex> guard(signatureLock);
+    switch (signatureState) {
+        case SignatureIdle:
+            return true;
+
+        case SignatureReady:
+            if (!asyncSignature.empty()) {
+                setSignatureData(asyncSignature.data(), static_cast<uint32_t>(asyncSignature.size()));
+            }
+            asyncSignature.clear();
+            signatureState = SignatureIdle;
+            return true;
+
+        default:
+            signatureState = SignatureWaiting;
+            return false;
+    }
+}
+
+void ZRtp::cancelSasSignature() {
+
+    std::lock_guard<std::mutex> guard(signatureLock);
+    signatureState = SignatureIdle;
+    asyncSignature.clear();
+    signatureConfirm1.clear();
+}
+
+bool ZRtp::isSasSignatureWaiting() {
+
+    std::lock_guard<std::mutex> guard(signatureLock);
+    return signatureState == SignatureWaiting;
+}
+
+bool ZRtp::sasSignatureReady(const uint8_t* data, uint32_t length) {
+
+    if ((length % 4) != 0 || (length > 0 && data == nullptr)) {
+        return false;
+    }
+    bool deliver;
+    {
+        std::lock_guard<std::mutex> guard(signatureLock);
+        if (signatureState != SignatureRequested && signatureState != SignatureWaiting) {
+            return false;
+        }
+        asyncSignature.assign(data, data + length);
+        deliver = signatureState == SignatureWaiting;
+        signatureState = SignatureReady;
+    }
+    // If the state engine does not wait yet it takes the signature when it builds the Confirm packet
+    if (deliver) {
+        sasSignatureDelivered();
+    }
+    return true;
+}
+
+void ZRtp::sasSignatureDelivered() {
+    Event ev;
+
+    if (stateEngine != nullptr) {
+        ev.type = ZrtpSignatureReady;
+        stateEngine->processEvent(&ev);
+    }
 }
 
 /*
@@ -827,10 +1579,10 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm1MultiStream(ZrtpPacketCommit* commit, ui
     // false ZRTP packets.
     // Use implicit hash function
     uint8_t tmpH3[IMPL_MAX_DIGEST_LENGTH];
-    memcpy(peerH2, commit->getH2(), HASH_IMAGE_SIZE);
-    hashFunctionImpl(peerH2, HASH_IMAGE_SIZE, tmpH3);
+    memcpy(hs->peerH2, commit->getH2(), HASH_IMAGE_SIZE);
+    hashFunctionImpl(hs->peerH2, HASH_IMAGE_SIZE, tmpH3);
 
-    if (memcmp(tmpH3, peerH3, HASH_IMAGE_SIZE) != 0) {
+    if (memcmp(tmpH3, hs->peerH3, HASH_IMAGE_SIZE) != 0) {
         *errMsg = IgnorePacket;
         return nullptr;
     }
@@ -838,7 +1590,7 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm1MultiStream(ZrtpPacketCommit* commit, ui
     // Check HMAC of previous Hello packet stored in temporary buffer. The
     // HMAC key of peer's Hello packet is peer's H2 that is contained in the
     // Commit packet. Refer to chapter 9.1.
-    if (!checkMsgHmac(peerH2)) {
+    if (!checkMsgHmac(hs->peerH2)) {
         sendInfo(Severe, SevereHelloHMACFailed);
         *errMsg = CriticalSWError;
         return nullptr;
@@ -865,7 +1617,7 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm1MultiStream(ZrtpPacketCommit* commit, ui
 
     // check if we support the commited Authentication length
     cp = &zrtpAuthLengths.getByName((const char*)commit->getAuthLen());
-    if (!cp->isValid()) { // no match - something went wrong
+    if (!cp->isValid() || !isSrtpSuite(cipher, cp)) { // no match - something went wrong
         *errMsg = UnsuppSRTPAuthTag;
         return nullptr;
     }
@@ -886,49 +1638,166 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm1MultiStream(ZrtpPacketCommit* commit, ui
     }
     myRole = Responder;
 
-    // We are responder. Release a possibly pre-computed SHA256 context
-    // because this was prepared for Initiator. Then create a new one.
-    if (msgShaContext != nullptr) {
-        closeHashCtx(msgShaContext, nullptr);
-    }
-    msgShaContext = createHashCtx(msgShaContext);
+    // We are responder. Discard a possibly pre-computed message hash
+    // because this was prepared for Initiator. Then start a new one.
+    startMsgHash();
 
     // Hash messages to produce overall message hash:
     // First the Responder's (my) Hello message, second the Commit
     // (always Initator's)
     // use negotiated hash
-    hashCtxFunction(msgShaContext, (unsigned char*)currentHelloPacket->getHeaderBase(), currentHelloPacket->getLength() * ZRTP_WORD_SIZE);
-    hashCtxFunction(msgShaContext, (unsigned char*)commit->getHeaderBase(), commit->getLength() * ZRTP_WORD_SIZE);
+    hashMsg(currentHelloPacket);
+    hashMsg(commit);
 
-    closeHashCtx(msgShaContext, messageHash);
-    msgShaContext = nullptr;
+    finishMsgHash();
 
     generateKeysMultiStream();
 
     // Fill in Confirm1 packet.
-    zrtpConfirm1.setMessageType((uint8_t*)Confirm1Msg);
+    hs->zrtpConfirm1.setMessageType((uint8_t*)Confirm1Msg);
     if (configureAlgos.isDisclosureFlag()) {
-        zrtpConfirm1.setDisclosureFlag();
+        hs->zrtpConfirm1.setDisclosureFlag();
     }
-    zrtpConfirm1.setExpTime(0xFFFFFFFF);
-    zrtpConfirm1.setIv(randomIV);
-    zrtpConfirm1.setHashH0(H0);
+    hs->zrtpConfirm1.setExpTime(0xFFFFFFFF);
+    hs->zrtpConfirm1.setIv(randomIV);
+    hs->zrtpConfirm1.setHashH0(H0);
 
     uint8_t confMac[MAX_DIGEST_LENGTH];
     uint32_t macLen;
 
     // Encrypt and HMAC with Responder's key - we are Respondere here
-    uint32_t hmLen = (zrtpConfirm1.getLength() - 9U) * ZRTP_WORD_SIZE;
-    cipher->getEncrypt()(zrtpKeyR, cipher->getKeylen(), randomIV, zrtpConfirm1.getHashH0(), hmLen);
+    uint32_t hmLen = (hs->zrtpConfirm1.getLength() - 9U) * ZRTP_WORD_SIZE;
+    cipher->getEncrypt()(zrtpKeyR, cipher->getKeylen(), randomIV, hs->zrtpConfirm1.getHashH0(), hmLen);
 
     // Use negotiated HMAC (hash)
-    hmacFunction(hmacKeyR, hashLength, zrtpConfirm1.getHashH0(), hmLen, confMac, &macLen);
+    hmacFunction(hmacKeyR, hashLength, hs->zrtpConfirm1.getHashH0(), hmLen, confMac, &macLen);
+
+    hs->zrtpConfirm1.setHmac(confMac);
+
+    // Store Commit data temporarily until we can check HMAC after receiving Confirm2
+    storeMsgTemp(commit);
+    return &hs->zrtpConfirm1;
+}
+
+/*
+ * At this point we are Responder.
+ */
+ZrtpPacketConfirm* ZRtp::prepareConfirm1Preshared(ZrtpPacketCommit* commit, uint32_t* errMsg) {
+
+    sendInfo(Info, InfoRespCommitReceived);
+
+    if (!commit->isLengthOk(ZrtpPacketCommit::Preshared)) {
+        *errMsg = CriticalSWError;
+        return nullptr;
+    }
+    // Check if ZID in Commit is the same as we got in Hello
+    if (memcmp(peerZid, commit->getZid(), ZID_SIZE) != 0) {       // ZIDs do not match????
+        sendInfo(Severe, SevereProtocolError);
+        *errMsg = CriticalSWError;
+        return nullptr;
+    }
+    // The following code checks the hash chain according chapter 10 to detect
+    // false ZRTP packets.
+    // Use implicit hash function
+    uint8_t tmpH3[IMPL_MAX_DIGEST_LENGTH];
+    memcpy(hs->peerH2, commit->getH2(), HASH_IMAGE_SIZE);
+    hashFunctionImpl(hs->peerH2, HASH_IMAGE_SIZE, tmpH3);
+
+    if (memcmp(tmpH3, hs->peerH3, HASH_IMAGE_SIZE) != 0) {
+        *errMsg = IgnorePacket;
+        return nullptr;
+    }
+
+    // Check HMAC of previous Hello packet stored in temporary buffer. The
+    // HMAC key of peer's Hello packet is peer's H2 that is contained in the
+    // Commit packet. Refer to chapter 9.1.
+    if (!checkMsgHmac(hs->peerH2)) {
+        sendInfo(Severe, SevereHelloHMACFailed);
+        *errMsg = CriticalSWError;
+        return nullptr;
+    }
+
+    // We offer Preshared mode only if it is configured
+    if (!checkPreshared(currentHelloPacket)) {
+        *errMsg = UnsuppPKExchange;
+        return nullptr;
+    }
+    if (!checkAndSetNonce(commit->getNonce())) {
+        *errMsg = NonceReused;
+        return nullptr;
+    }
+
+    // check if we support the commited cipher, authentication length, and SAS type.
+    // Don't use them before we know that we have a matching preshared key, otherwise
+    // we answer with our own DH Commit.
+    AlgorithmEnum* cp = &zrtpSymCiphers.getByName((const char*)commit->getCipherType());
+    if (!cp->isValid()) { // no match - something went wrong
+        *errMsg = UnsuppCiphertype;
+        return nullptr;
+    }
+    AlgorithmEnum* al = &zrtpAuthLengths.getByName((const char*)commit->getAuthLen());
+    if (!al->isValid() || !isSrtpSuite(cp, al)) { // no match - something went wrong
+        *errMsg = UnsuppSRTPAuthTag;
+        return nullptr;
+    }
+    AlgorithmEnum* st = &zrtpSasTypes.getByName((const char*)commit->getSasType());
+    if (!st->isValid()) { // no match - something went wrong
+        *errMsg = UnsuppSASScheme;
+        return nullptr;
+    }
+    AlgorithmEnum* hp = &zrtpHashes.getByName((const char*)commit->getHashType());
+    if (!hp->isValid()) { // no match - something went wrong
+        *errMsg = UnsuppHashType;
+        return nullptr;
+    }
+    // The preshared key depends on the commited hash. Restore our own hash if
+    // we fall back to a DH Commit.
+    AlgorithmEnum* ownHash = hash;
+    if (*(int32_t*)(hash->getName()) != *(int32_t*)(hp->getName())) {
+        hash = hp;
+        setNegotiatedHash(hash);
+    }
+    uint8_t keyId[2*ZRTP_WORD_SIZE];
+    bool keyMatch = false;
+    readZidRecord();
+    if (canUsePreshared()) {
+        computePresharedKey(keyId);
+        keyMatch = memcmp(keyId, commit->getKeyId(), sizeof(keyId)) == 0;
+    }
+    if (!keyMatch) {
+        memset_volatile(presharedKey, 0, sizeof(presharedKey));
+        if (hash != ownHash) {
+            hash = ownHash;
+            setNegotiatedHash(hash);
+        }
+        *errMsg = NoSharedSecret;
+        return nullptr;
+    }
+    cipher = cp;
+    authLength = al;
+    sasType = st;
+    myRole = Responder;
+    presharedMode = true;
+
+    // We are responder. Discard a possibly pre-computed message hash
+    // because this was prepared for Initiator. Then start a new one.
+    startMsgHash();
+
+    // Hash messages to produce overall message hash:
+    // First the Responder's (my) Hello message, second the Commit
+    // (always Initator's)
+    // use negotiated hash
+    hashMsg(currentHelloPacket);
+    hashMsg(commit);
+
+    finishMsgHash();
 
-    zrtpConfirm1.setHmac(confMac);
+    generateKeysPreshared();
+    fillConfirm1();
 
     // Store Commit data temporarily until we can check HMAC after receiving Confirm2
     storeMsgTemp(commit);
-    return &zrtpConfirm1;
+    return &hs->zrtpConfirm1;
 }
 
 /*
@@ -966,6 +1835,33 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm2(ZrtpPacketConfirm* confirm1, uint32_t*
         *errMsg = CriticalSWError;
         return nullptr;
     }
+    // Confirm2 carries the SAS signature, keep the checked Confirm1 until ZrtpSignatureReady
+    if (!takeSasSignature()) {
+        const uint8_t* packet = confirm1->getHeaderBase();
+        signatureConfirm1.assign(packet, packet + confirm1->getLength() * ZRTP_WORD_SIZE);
+        *errMsg = IgnorePacket;
+        return nullptr;
+    }
+    return finishConfirm2(confirm1);
+}
+
+ZrtpPacketConfirm* ZRtp::resumeSignedConfirm2(uint32_t* errMsg) {
+
+    if (signatureConfirm1.empty() || !takeSasSignature()) {
+        *errMsg = IgnorePacket;
+        return nullptr;
+    }
+    std::vector<uint8_t> packet;
+    packet.swap(signatureConfirm1);
+    ZrtpPacketConfirm confirm1(packet.data());
+    return finishConfirm2(&confirm1);
+}
+
+ZrtpPacketConfirm* ZRtp::finishConfirm2(ZrtpPacketConfirm* confirm1) {
+
+    uint8_t confMac[MAX_DIGEST_LENGTH];
+    uint32_t macLen;
+
     /*
      * The Confirm1 is ok, handle the Retained secret stuff and inform
      * GUI about state.
@@ -987,26 +1883,27 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm2(ZrtpPacketConfirm* confirm1, uint32_t*
 
     signatureLength = confirm1->getSignatureLength();
     if (signSasSeen && signatureLength > 0 && confirm1->isSignatureLengthOk()) {
-        signatureData = confirm1->getSignatureData();
+        signatureData = keepPeerSignature(confirm1->getSignatureData());
         callback->checkSASSignature(sasHash);
         // TODO: error handling if checkSASSignature returns false.
     }
     // now we are ready to save the new RS1 which inherits the verified
     // flag from old RS1
     zidRec->setNewRs1((const uint8_t*)newRs1);
+    zidRec->setPreshCounter(presharedMode ? zidRec->getPreshCounter() + 1 : 0);
 
     // now generate my Confirm2 message
-    zrtpConfirm2.setMessageType((uint8_t*)Confirm2Msg);
-    zrtpConfirm2.setHashH0(H0);
+    hs->zrtpConfirm2.setMessageType((uint8_t*)Confirm2Msg);
+    hs->zrtpConfirm2.setHashH0(H0);
 
     if (sasFlag) {
-        zrtpConfirm2.setSASFlag();
+        hs->zrtpConfirm2.setSASFlag();
     }
     if (configureAlgos.isDisclosureFlag()) {
-        zrtpConfirm2.setDisclosureFlag();
+        hs->zrtpConfirm2.setDisclosureFlag();
     }
-    zrtpConfirm2.setExpTime(0xFFFFFFFF);
-    zrtpConfirm2.setIv(randomIV);
+    hs->zrtpConfirm2.setExpTime(0xFFFFFFFF);
+    hs->zrtpConfirm2.setIv(randomIV);
 
 #ifdef ZRTP_SAS_RELAY_SUPPORT
     // Compute PBX secret if we are in enrollemnt mode (PBX user agent)
@@ -1025,21 +1922,21 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm2(ZrtpPacketConfirm* confirm1, uint32_t*
                 zidRec->setMiTMData(pbxSecretTmp);
             }
             // Set flag to enable user's client to ask for confirmation or re-confirmation.
-            zrtpConfirm2.setPBXEnrollment();
+            hs->zrtpConfirm2.setPBXEnrollment();
         }
     }
 #endif
     if (saveZidRecord)
-        getZidCacheInstance()->saveRecord(zidRec);
+        saveZidRec();
 
     // Encrypt and HMAC with Initiator's key - we are Initiator here
-    hmlen = (zrtpConfirm2.getLength() - (uint)9) * ZRTP_WORD_SIZE;
-    cipher->getEncrypt()(zrtpKeyI, cipher->getKeylen(), randomIV, zrtpConfirm2.getHashH0(), hmlen);
+    uint32_t hmlen = (hs->zrtpConfirm2.getLength() - (uint)9) * ZRTP_WORD_SIZE;
+    cipher->getEncrypt()(zrtpKeyI, cipher->getKeylen(), randomIV, hs->zrtpConfirm2.getHashH0(), hmlen);
 
     // Use negotiated HMAC (hash)
-    hmacFunction(hmacKeyI, hashLength, zrtpConfirm2.getHashH0(), hmlen, confMac, &macLen);
+    hmacFunction(hmacKeyI, hashLength, hs->zrtpConfirm2.getHashH0(), hmlen, confMac, &macLen);
 
-    zrtpConfirm2.setHmac(confMac);
+    hs->zrtpConfirm2.setHmac(confMac);
 
 #ifdef ZRTP_SAS_RELAY_SUPPORT
     // Ask for enrollment only if enabled via configuration and the
@@ -1057,7 +1954,7 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm2(ZrtpPacketConfirm* confirm1, uint32_t*
         }
     }
 #endif
-    return &zrtpConfirm2;
+    return &hs->zrtpConfirm2;
 }
 
 /*
@@ -1077,8 +1974,7 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm2MultiStream(ZrtpPacketConfirm* confirm1,
     uint8_t confMac[MAX_DIGEST_LENGTH];
     uint32_t macLen;
 
-    closeHashCtx(msgShaContext, messageHash);
-    msgShaContext = nullptr;
+    finishMsgHash();
     myRole = Initiator;
 
     generateKeysMultiStream();
@@ -1105,12 +2001,12 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm2MultiStream(ZrtpPacketConfirm* confirm1,
     uint8_t tmpHash[IMPL_MAX_DIGEST_LENGTH];
     hashFunctionImpl(confirm1->getHashH0(), HASH_IMAGE_SIZE, tmpHash); // Compute peer's H1 in tmpHash
     hashFunctionImpl(tmpHash, HASH_IMAGE_SIZE, tmpHash);               // Compute peer's H2 in tmpHash
-    memcpy(peerH2, tmpHash, HASH_IMAGE_SIZE);                          // copy and truncate to peerH2
+    memcpy(hs->peerH2, tmpHash, HASH_IMAGE_SIZE);                          // copy and truncate to peerH2
 
     // Check HMAC of previous Hello packet stored in temporary buffer. The
     // HMAC key of the Hello packet is peer's H2 that was computed above.
     // Refer to chapter 9.1 and chapter 10.
-    if (!checkMsgHmac(peerH2)) {
+    if (!checkMsgHmac(hs->peerH2)) {
         sendInfo(Severe, SevereHelloHMACFailed);
         *errMsg = CriticalSWError;
         return nullptr;
@@ -1119,23 +2015,72 @@ ZrtpPacketConfirm* ZRtp::prepareConfirm2MultiStream(ZrtpPacketConfirm* confirm1,
     peerDisclosureFlagSeen = confirm1->isDisclosureFlag();
 
     // now generate my Confirm2 message
-    zrtpConfirm2.setMessageType((uint8_t*)Confirm2Msg);
+    hs->zrtpConfirm2.setMessageType((uint8_t*)Confirm2Msg);
     if (configureAlgos.isDisclosureFlag()) {
-        zrtpConfirm2.setDisclosureFlag();
+        hs->zrtpConfirm2.setDisclosureFlag();
     }
-    zrtpConfirm2.setHashH0(H0);
-    zrtpConfirm2.setExpTime(0xFFFFFFFF);
-    zrtpConfirm2.setIv(randomIV);
+    hs->zrtpConfirm2.setHashH0(H0);
+    hs->zrtpConfirm2.setExpTime(0xFFFFFFFF);
+    hs->zrtpConfirm2.setIv(randomIV);
 
     // Encrypt and HMAC with Initiator's key - we are Initiator here
-    hmLen = (zrtpConfirm2.getLength() - 9U) * ZRTP_WORD_SIZE;
-    cipher->getEncrypt()(zrtpKeyI, cipher->getKeylen(), randomIV, zrtpConfirm2.getHashH0(), hmLen);
+    hmLen = (hs->zrtpConfirm2.getLength() - 9U) * ZRTP_WORD_SIZE;
+    cipher->getEncrypt()(zrtpKeyI, cipher->getKeylen(), randomIV, hs->zrtpConfirm2.getHashH0(), hmLen);
+
+    // Use negotiated HMAC (hash)
+    hmacFunction(hmacKeyI, hashLength, hs->zrtpConfirm2.getHashH0(), hmLen, confMac, &macLen);
+
+    hs->zrtpConfirm2.setHmac(confMac);
+    return &hs->zrtpConfirm2;
+}
+
+/*
+ * At this point we are Initiator.
+ */
+ZrtpPacketConfirm* ZRtp::prepareConfirm2Preshared(ZrtpPacketConfirm* confirm1, uint32_t* errMsg) {
+
+    sendInfo(Info, InfoInitConf1Received);
+
+    if (!confirm1->isLengthOk()) {
+        *errMsg = CriticalSWError;
+        return nullptr;
+    }
+    uint8_t confMac[MAX_DIGEST_LENGTH];
+    uint32_t macLen;
+
+    finishMsgHash();
+    myRole = Initiator;
+
+    generateKeysPreshared();
+
+    // Use the Responder's keys here because we are Initiator here and
+    // receive packets from Responder
+    uint32_t hmLen = (confirm1->getLength() - 9U) * ZRTP_WORD_SIZE;
 
     // Use negotiated HMAC (hash)
-    hmacFunction(hmacKeyI, hashLength, zrtpConfirm2.getHashH0(), hmLen, confMac, &macLen);
+    hmacFunction(hmacKeyR, hashLength, confirm1->getHashH0(), hmLen, confMac, &macLen);
+
+    if (memcmp(confMac, confirm1->getHmac(), HMAC_SIZE) != 0) {
+        *errMsg = ConfirmHMACWrong;
+        return nullptr;
+    }
+    // Cast away the const for the IV - the standalone AES CFB modifies IV on return
+    cipher->getDecrypt()(zrtpKeyR, cipher->getKeylen(), (uint8_t*)confirm1->getIv(), confirm1->getHashH0(), hmLen);
 
-    zrtpConfirm2.setHmac(confMac);
-    return &zrtpConfirm2;
+    // As in multi-stream mode we did not receive a DHPart1, re-compute the
+    // responder's H2 from H0 to check the HMAC of the responder's Hello packet.
+    // Use implicit hash function.
+    uint8_t tmpHash[IMPL_MAX_DIGEST_LENGTH];
+    hashFunctionImpl(confirm1->getHashH0(), HASH_IMAGE_SIZE, tmpHash); // Compute peer's H1 in tmpHash
+    hashFunctionImpl(tmpHash, HASH_IMAGE_SIZE, tmpHash);               // Compute peer's H2 in tmpHash
+    memcpy(hs->peerH2, tmpHash, HASH_IMAGE_SIZE);                          // copy and truncate to peerH2
+
+    if (!checkMsgHmac(hs->peerH2)) {
+        sendInfo(Severe, SevereHelloHMACFailed);
+        *errMsg = CriticalSWError;
+        return nullptr;
+    }
+    return finishConfirm2(confirm1);
 }
 
 /*
@@ -1166,7 +2111,7 @@ ZrtpPacketConf2Ack* ZRtp::prepareConf2Ack(ZrtpPacketConfirm *confirm2, uint32_t*
     // Cast away the const for the IV - the standalone AES CFB modifies IV on return
     cipher->getDecrypt()(zrtpKeyI, cipher->getKeylen(), (uint8_t*)confirm2->getIv(), confirm2->getHashH0(), hmlen);
 
-    if (!multiStream) {
+    if (!multiStream && !presharedMode) {
         // Check HMAC of DHPart2 packet stored in temporary buffer. The
         // HMAC key of the DHPart2 packet is peer's H0 that is contained in
         // Confirm2. Refer to chapter 9.1 and chapter 10.
@@ -1175,6 +2120,21 @@ ZrtpPacketConf2Ack* ZRtp::prepareConf2Ack(ZrtpPacketConfirm *confirm2, uint32_t*
             *errMsg = CriticalSWError;
             return nullptr;
         }
+    }
+    else {
+        // Check HMAC of Commit packet stored in temporary buffer. The
+        // HMAC key of the Commit packet is initiator's H1
+        // use implicit hash function.
+        uint8_t tmpHash[IMPL_MAX_DIGEST_LENGTH];
+        hashFunctionImpl(confirm2->getHashH0(), HASH_IMAGE_SIZE, tmpHash); // Compute initiator's H1 in tmpHash
+
+        if (!checkMsgHmac(tmpHash)) {
+            sendInfo(Severe, SevereCommitHMACFailed);
+            *errMsg = CriticalSWError;
+            return nullptr;
+        }
+    }
+    if (!multiStream) {
         /*
          * The Confirm2 is ok, handle the Retained secret stuff and inform
          * GUI about state.
@@ -1187,14 +2147,15 @@ ZrtpPacketConf2Ack* ZRtp::prepareConf2Ack(ZrtpPacketConfirm *confirm2, uint32_t*
         }
         signatureLength = confirm2->getSignatureLength();
         if (signSasSeen && signatureLength > 0 && confirm2->isSignatureLengthOk() ) {
-            signatureData = confirm2->getSignatureData();
+            signatureData = keepPeerSignature(confirm2->getSignatureData());
             callback->checkSASSignature(sasHash);
             // TODO: error handling if checkSASSignature returns false.
         }
         // save new RS1, this inherits the verified flag from old RS1
         zidRec->setNewRs1((const uint8_t*)newRs1);
+        zidRec->setPreshCounter(presharedMode ? zidRec->getPreshCounter() + 1 : 0);
         if (saveZidRecord)
-            getZidCacheInstance()->saveRecord(zidRec);
+            saveZidRec();
 
 #ifdef ZRTP_SAS_RELAY_SUPPORT
         // Ask for enrollment only if enabled via configuration and the
@@ -1214,19 +2175,6 @@ ZrtpPacketConf2Ack* ZRtp::prepareConf2Ack(ZrtpPacketConfirm *confirm2, uint32_t*
         }
 #endif
     }
-    else {
-        // Check HMAC of Commit packet stored in temporary buffer. The
-        // HMAC key of the Commit packet is initiator's H1
-        // use implicit hash function.
-        uint8_t tmpHash[IMPL_MAX_DIGEST_LENGTH];
-        hashFunctionImpl(confirm2->getHashH0(), HASH_IMAGE_SIZE, tmpHash); // Compute initiator's H1 in tmpHash
-
-        if (!checkMsgHmac(tmpHash)) {
-            sendInfo(Severe, SevereCommitHMACFailed);
-            *errMsg = CriticalSWError;
-            return nullptr;
-        }
-    }
     // Store the status of the Disclosure flag
     peerDisclosureFlagSeen = confirm2->isDisclosureFlag();
 
@@ -1380,10 +2328,12 @@ ZrtpPacketRelayAck* ZRtp::prepareRelayAck(ZrtpPacketSASrelay* srly, const uint32
         sasBytes[2] = newSasHash[2] & 0xf0;
         sasBytes[3] = 0;
         if (*(int32_t*)b32 == *(int32_t*)(renderAlgo->getName())) {
-            SAS = Base32(sasBytes, 20).getEncoded();
+            char sasText[8];
+            SAS.assign(sasText, Base32::b2a(sasBytes, 20, sasText, sizeof(sasText)));
         }
         else if (*(int32_t*)b32e == *(int32_t*)(renderAlgo->getName())) {
-            SAS = *EmojiBase32::u32StringToUtf8(EmojiBase32(sasBytes, 20).getEncoded());
+            char sasText[20];
+            SAS.assign(sasText, EmojiBase32::b2aUtf8(sasBytes, 20, sasText, sizeof(sasText)));
         }
         else if (*(int32_t*)b10d == *(int32_t*)(renderAlgo->getName())) {
             SAS = sasDigit(sasHash);
@@ -1441,84 +2391,91 @@ ZrtpPacketGoClear* ZRtp::prepareGoClear(uint32_t errMsg) {
  * Key Agreement:       DH3k (3072 Diffie-Helman)  (internal enum Dh3072)
  *
  */
-AlgorithmEnum* ZRtp::findBestHash(ZrtpPacketHello *hello) {
+uint32_t ZRtp::getConfiguredMask(AlgoTypes algoType) {
+    uint32_t mask = 0;
+
+    for (int32_t i = 0, num = configureAlgos.getNumConfiguredAlgos(algoType); i < num; i++) {
+        int32_t ord = configureAlgos.getAlgoAt(algoType, i).getOrdinal();
+        if (ord >= 0)
+            mask |= 1U << ord;
+    }
+    return mask;
+}
 
-    int i;
-    int ii;
-    int numAlgosOffered;
-    AlgorithmEnum* algosOffered[ZrtpConfigure::maxNoOfAlgos+1];
+AlgorithmEnum* ZRtp::findFirstConfigured(EnumBase& algos, AlgoTypes algoType, const uint8_t* offered, int32_t numOffered) {
 
-    int numAlgosConf;
-    AlgorithmEnum* algosConf[ZrtpConfigure::maxNoOfAlgos+1];
+    uint32_t configured = getConfiguredMask(algoType);
 
-    // If Hello does not contain any hash names return Sha256, its mandatory
-    int num = hello->getNumHashes();
-    if (num == 0) {
-        return &zrtpHashes.getByName(mandatoryHash);
+    // The low cost policy selects the cheapest common hash and cipher, regardless of the order
+    if (configureAlgos.getSelectionPolicy() == ZrtpConfigure::PreferLowCost &&
+        (algoType == HashAlgorithm || algoType == CipherAlgorithm)) {
+        uint32_t common = 0;
+        for (int32_t i = 0; i < numOffered; i++) {
+            int ord = algos.getOrdinal(offered + (i * ZRTP_WORD_SIZE));
+            if (ord >= 0)
+                common |= configured & (1U << ord);
+        }
+        AlgorithmEnum* algo = findLowestCost(algos, common);
+        if (algo != nullptr)
+            return algo;
     }
-    // Build list of configured hash algorithm names.
-    numAlgosConf = configureAlgos.getNumConfiguredAlgos(HashAlgorithm);
-    for (i = 0; i < numAlgosConf; i++) {
-        algosConf[i] = &configureAlgos.getAlgoAt(HashAlgorithm, i);
+
+    // Prefer algorithms that appear first in Hello packet (offered).
+    for (int32_t i = 0; i < numOffered; i++) {
+        int ord = algos.getOrdinal(offered + (i * ZRTP_WORD_SIZE));
+        if (ord >= 0 && (configured & (1U << ord)) != 0) {
+            return &algos.getByOrdinal(ord);
+        }
     }
+    return nullptr;
+}
+
+AlgorithmEnum* ZRtp::findLowestCost(EnumBase& algos, uint32_t candidates) {
 
-    // Build list of offered known algos in Hello, append mandatory algos if necessary
-    for (numAlgosOffered = 0, i = 0; i < num; i++) {
-        algosOffered[numAlgosOffered] = &zrtpHashes.getByName((const char*)hello->getHashType(i));
-        if (!algosOffered[numAlgosOffered]->isValid())
+    int32_t minimum = configureAlgos.getMinimumSecurity();
+    AlgorithmEnum* best = nullptr;
+    int32_t bestCost = 0;
+    int32_t bestStrength = 0;
+
+    for (int ord = 0; candidates != 0; ord++, candidates >>= 1) {
+        if ((candidates & 1) == 0)
+            continue;
+        AlgorithmEnum& algo = algos.getByOrdinal(ord);
+        int32_t strength = ZrtpConfigure::getAlgoStrength(algo);
+        int32_t cost = ZrtpConfigure::getAlgoCost(algo);
+        if (strength == 0 || strength < minimum)
             continue;
-        numAlgosOffered++;
+        if (best == nullptr || cost < bestCost || (cost == bestCost && strength > bestStrength)) {
+            best = &algo;
+            bestCost = cost;
+            bestStrength = strength;
+        }
     }
+    return best;
+}
+
+AlgorithmEnum* ZRtp::findBestHash(ZrtpPacketHello *hello) {
 
-    // Lookup offered algos in configured algos.
-    for (i = 0; i < numAlgosOffered; i++) {
-        for (ii = 0; ii < numAlgosConf; ii++) {
-            if (*(int32_t*)(algosOffered[i]->getName()) == *(int32_t*)(algosConf[ii]->getName())) {
-                return algosConf[ii];
-            }
-        }
+    // If Hello does not contain any hash names return Sha256, its mandatory
+    int num = hello->getNumHashes();
+    if (num == 0) {
+        return &zrtpHashes.getByName(mandatoryHash);
     }
-    return &zrtpHashes.getByName(mandatoryHash);
+    AlgorithmEnum* algo = findFirstConfigured(zrtpHashes, HashAlgorithm, hello->getHashType(0), num);
+    return (algo != nullptr) ? algo : &zrtpHashes.getByName(mandatoryHash);
 }
 
 
 AlgorithmEnum* ZRtp::findBestCipher(ZrtpPacketHello *hello, AlgorithmEnum* pk) {
 
-    int i;
-    int ii;
-    int numAlgosOffered;
-    AlgorithmEnum* algosOffered[ZrtpConfigure::maxNoOfAlgos+1];
-
-    int numAlgosConf;
-    AlgorithmEnum* algosConf[ZrtpConfigure::maxNoOfAlgos+1];
-
     int num = hello->getNumCiphers();
     if (num == 0 || (*(int32_t*)(pk->getName()) == *(int32_t*)dh2k)) {
         return &zrtpSymCiphers.getByName(aes1);
     }
+    AlgorithmEnum* algo = findFirstConfigured(zrtpSymCiphers, CipherAlgorithm, hello->getCipherType(0), num);
 
-    // Build list of configured cipher algorithm names.
-    numAlgosConf = configureAlgos.getNumConfiguredAlgos(CipherAlgorithm);
-    for (i = 0; i < numAlgosConf; i++) {
-        algosConf[i] = &configureAlgos.getAlgoAt(CipherAlgorithm, i);
-    }
-    // Build list of offered known algos names in Hello.
-    for (numAlgosOffered = 0, i = 0; i < num; i++) {
-        algosOffered[numAlgosOffered] = &zrtpSymCiphers.getByName((const char*)hello->getCipherType(i));
-        if (!algosOffered[numAlgosOffered]->isValid())
-            continue;
-        numAlgosOffered++;
-    }
-    // Lookup offered algos in configured algos.  Prefer algorithms that appear first in Hello packet (offered).
-    for (i = 0; i < numAlgosOffered; i++) {
-        for (ii = 0; ii < numAlgosConf; ii++) {
-            if (*(int32_t*)(algosOffered[i]->getName()) == *(int32_t*)(algosConf[ii]->getName())) {
-                return algosConf[ii];
-            }
-        }
-    }
     // If we don't have a match - use the mandatory algorithm
-    return &zrtpSymCiphers.getByName(mandatoryCipher);
+    return (algo != nullptr) ? algo : &zrtpSymCiphers.getByName(mandatoryCipher);
 }
 
 // We can have the non-NIST in the list of orderedAlgos even if they are not available
@@ -1528,9 +2485,6 @@ AlgorithmEnum* ZRtp::findBestCipher(ZrtpPacketHello *hello, AlgorithmEnum* pk) {
 //
 AlgorithmEnum* ZRtp::findBestPubkey(ZrtpPacketHello *hello) {
 
-    AlgorithmEnum* peerIntersect[ZrtpConfigure::maxNoOfAlgos+1];
-    AlgorithmEnum* ownIntersect[ZrtpConfigure::maxNoOfAlgos+1];
-
     // Build list of own pubkey algorithm names, must follow the order
     // defined in RFC 6189, chapter 4.1.2.
     const char *orderedAlgos[] = {dh2k, e255, ec25, dh3k, e414, ec38};
@@ -1541,68 +2495,85 @@ AlgorithmEnum* ZRtp::findBestPubkey(ZrtpPacketHello *hello) {
         hash = findBestHash(hello);                    // find a hash algorithm
         return &zrtpPubKeys.getByName(mandatoryPubKey);
     }
-    // Build own list of intersecting algos, keep own order or algorithms
-    // The list must include real public key algorithms only, so skip mult-stream mode, 
+    // Intersection of own and peer's algorithms as bit mask of ordinals. The intersection
+    // must include real public key algorithms only, so skip mult-stream mode,
     // preshared and alike.
-    int numAlgosOwn = configureAlgos.getNumConfiguredAlgos(PubKeyAlgorithm);
-    int numOwnIntersect = 0;
-    for (int i = 0; i < numAlgosOwn; i++) {
-        ownIntersect[numOwnIntersect] = &configureAlgos.getAlgoAt(PubKeyAlgorithm, i);
-        if (*(int32_t*)(ownIntersect[numOwnIntersect]->getName()) == *(int32_t*)mult) {
-            continue;                               // skip multi-stream mode
-        }
-        for (int ii = 0; ii < numAlgosPeer; ii++) {
-            if (*(int32_t*)(ownIntersect[numOwnIntersect]->getName()) == *(int32_t*)(zrtpPubKeys.getByName((const char*)hello->getPubKeyType(ii)).getName())) {
-                numOwnIntersect++;
-                break;
+    uint32_t peerMask = 0;
+    for (int i = 0; i < numAlgosPeer; i++) {
+        int ord = zrtpPubKeys.getOrdinal(hello->getPubKeyType(i));
+        if (ord >= 0)
+            peerMask |= 1U << ord;
+    }
+    uint32_t common = getConfiguredMask(PubKeyAlgorithm) & peerMask;
+    common &= ~(1U << zrtpPubKeys.getByName(mult).getOrdinal());
+    common &= ~(1U << zrtpPubKeys.getByName(prsh).getOrdinal());
+
+    if (common == 0) {                 // If we don't have a common algorithm - use mandatory algorithms
+        hash = findBestHash(hello);
+        return &zrtpPubKeys.getByName(mandatoryPubKey);
+    }
+
+    // The low cost policy drops the algorithms below the minimum security level from the
+    // intersection and takes the cheapest remaining algorithm as own first algorithm. The
+    // peer's first algorithm may still win the RFC6189 selection below.
+    AlgorithmEnum* ownFirst = nullptr;
+    if (configureAlgos.getSelectionPolicy() == ZrtpConfigure::PreferLowCost) {
+        ownFirst = findLowestCost(zrtpPubKeys, common);
+        if (ownFirst != nullptr) {
+            uint32_t strong = 0;
+            for (int ord = 0; (common >> ord) != 0; ord++) {
+                if ((common & (1U << ord)) != 0 &&
+                    ZrtpConfigure::getAlgoStrength(zrtpPubKeys.getByOrdinal(ord)) >= configureAlgos.getMinimumSecurity())
+                    strong |= 1U << ord;
             }
+            common = strong;
         }
     }
-    // Build list of peer's intersecting algos: take own list as input and build a 
-    // list of algorithms that we have in common. The order of the list is according
-    // to peer's Hello packet (peer's preferences). 
-    int numPeerIntersect = 0;
-    for (int i = 0; i < numAlgosPeer; i++) {
-        peerIntersect[numPeerIntersect] = &zrtpPubKeys.getByName((const char*)hello->getPubKeyType(i));
-        for (int ii = 0; ii < numOwnIntersect; ii++) {
-            if (*(int32_t*)(ownIntersect[ii]->getName()) == *(int32_t*)(peerIntersect[numPeerIntersect]->getName())) {
-                numPeerIntersect++;
-                break;
-            }
+
+    // First common algorithm in own order of algorithms and in peer's order (peer's preferences)
+    for (int i = 0, num = configureAlgos.getNumConfiguredAlgos(PubKeyAlgorithm); ownFirst == nullptr && i < num; i++) {
+        AlgorithmEnum& algo = configureAlgos.getAlgoAt(PubKeyAlgorithm, i);
+        if (algo.getOrdinal() >= 0 && (common & (1U << algo.getOrdinal())) != 0) {
+            ownFirst = &algo;
+            break;
         }
     }
-    if (numPeerIntersect == 0) {       // If we don't have a common algorithm - use mandatory algorithms
-        hash = findBestHash(hello);
-        return &zrtpPubKeys.getByName(mandatoryPubKey);
+    AlgorithmEnum* peerFirst = nullptr;
+    for (int i = 0; i < numAlgosPeer; i++) {
+        int ord = zrtpPubKeys.getOrdinal(hello->getPubKeyType(i));
+        if (ord >= 0 && (common & (1U << ord)) != 0) {
+            peerFirst = &zrtpPubKeys.getByOrdinal(ord);
+            break;
+        }
     }
 
     // If we have only one algorithm in common or if the first entry matches - take it.
     // Otherwise determine which algorithm from the intersection lists is first in the 
     // list of ordered algorithms and select it (RFC6189, section 4.1.2).
     AlgorithmEnum* useAlgo;
-    if (numPeerIntersect > 1 && *(int32_t*)(ownIntersect[0]->getName()) != *(int32_t*)(peerIntersect[0]->getName())) {
+    if ((common & (common - 1)) != 0 && ownFirst != peerFirst) {
         int own, peer;
 
-        const int32_t *name = (int32_t*)ownIntersect[0]->getName();
+        const int32_t *name = (int32_t*)ownFirst->getName();
         for (own = 0; own < numOrderedAlgos; own++) {
             if (*name == *(int32_t*)orderedAlgos[own])
                 break;
         }
-        name = (int32_t*)peerIntersect[0]->getName();
+        name = (int32_t*)peerFirst->getName();
         for (peer = 0; peer < numOrderedAlgos; peer++) {
             if (*name == *(int32_t*)orderedAlgos[peer])
                 break;
         }
         if (own < peer) {
-            useAlgo = ownIntersect[0];
+            useAlgo = ownFirst;
         }
         else {
-            useAlgo = peerIntersect[0];
+            useAlgo = peerFirst;
         }
         // find fastest of conf vs intersecting
     }
     else {
-        useAlgo = peerIntersect[0];
+        useAlgo = peerFirst;
     }
     int32_t algoName = *(int32_t*)(useAlgo->getName());
 
@@ -1621,90 +2592,39 @@ AlgorithmEnum* ZRtp::findBestPubkey(ZrtpPacketHello *hello) {
 
 AlgorithmEnum* ZRtp::findBestSASType(ZrtpPacketHello *hello) {
 
-    int  i;
-    int ii;
-    int numAlgosOffered;
-    AlgorithmEnum* algosOffered[ZrtpConfigure::maxNoOfAlgos+1];
-
-    int numAlgosConf;
-    AlgorithmEnum* algosConf[ZrtpConfigure::maxNoOfAlgos+1];
-
     int num = hello->getNumSas();
     if (num == 0) {
         return &zrtpSasTypes.getByName(mandatorySasType);
     }
-    // Build list of configured SAS algorithm names
-    numAlgosConf = configureAlgos.getNumConfiguredAlgos(SasType);
-    for (i = 0; i < numAlgosConf; i++) {
-        algosConf[i] = &configureAlgos.getAlgoAt(SasType, i);
-    }
-    // Build list of offered known algos in Hello,
-    for (numAlgosOffered = 0, i = 0; i < num; i++) {
-        algosOffered[numAlgosOffered] = &zrtpSasTypes.getByName((const char*)hello->getSasType(i));
-        if (!algosOffered[numAlgosOffered]->isValid())
-            continue;
-        numAlgosOffered++;
-    }
-    // Lookup offered algos in configured algos. Prefer algorithms that appear first in Hello packet (offered).
-    for (i = 0; i < numAlgosOffered; i++) {
-        for (ii = 0; ii < numAlgosConf; ii++) {
-            if (*(int32_t*)(algosOffered[i]->getName()) == *(int32_t*)(algosConf[ii]->getName())) {
-                return algosConf[ii];
-            }
-        }
-    }
+    AlgorithmEnum* algo = findFirstConfigured(zrtpSasTypes, SasType, hello->getSasType(0), num);
+
     // If we don't have a match - use the mandatory algorithm
-    return &zrtpSasTypes.getByName(mandatorySasType);
+    return (algo != nullptr) ? algo : &zrtpSasTypes.getByName(mandatorySasType);
 }
 
 AlgorithmEnum* ZRtp::findBestAuthLen(ZrtpPacketHello *hello) {
 
-    int  i;
-    int ii;
-    int numAlgosOffered;
-    AlgorithmEnum* algosOffered[ZrtpConfigure::maxNoOfAlgos+2];
-
-    int numAlgosConf;
-    AlgorithmEnum* algosConf[ZrtpConfigure::maxNoOfAlgos+2];
-
     int num = hello->getNumAuth();
     if (num == 0) {
         return &zrtpAuthLengths.getByName(mandatoryAuthLen_1);
     }
+    AlgorithmEnum* algo = findFirstConfigured(zrtpAuthLengths, AuthLength, hello->getAuthLen(0), num);
 
-    // Build list of configured Authentication tag length algorithm names.
-    numAlgosConf = configureAlgos.getNumConfiguredAlgos(AuthLength);
-    for (i = 0; i < numAlgosConf; i++) {
-        algosConf[i] = &configureAlgos.getAlgoAt(AuthLength, i);
-    }
-
-    // Build list of offered known algos in Hello.
-    for (numAlgosOffered = 0, i = 0; i < num; i++) {
-        algosOffered[numAlgosOffered] = &zrtpAuthLengths.getByName((const char*)hello->getAuthLen(i));
-        if (!algosOffered[numAlgosOffered]->isValid())
-            continue;
-        numAlgosOffered++;
-    }
-
-    // Lookup offered algos in configured algos. Prefer algorithms that appear first in Hello packet (offered).
-    for (i = 0; i < numAlgosOffered; i++) {
-        for (ii = 0; ii < numAlgosConf; ii++) {
-            if (*(int32_t*)(algosOffered[i]->getName()) == *(int32_t*)(algosConf[ii]->getName())) {
-                return algosConf[ii];
-            }
-        }
-    }
     // If we don't have a match - use the mandatory algorithm
-    return &zrtpAuthLengths.getByName(mandatoryAuthLen_1);
+    return (algo != nullptr) ? algo : &zrtpAuthLengths.getByName(mandatoryAuthLen_1);
 }
 
 // The following set of functions implement a 'non-NIST first policy' if nonNist computes 
 // to true. They prefer nonNist algorithms if these are available. Otherwise they use the NIST
 // counterpart or simply call the according findBest*(...) function.
 //
+// The functions take an offered algorithm only if this build implements it, the minimal
+// algorithm profile omits Skein, Twofish and SHA-384, and no build implements 2FS2.
+//
 // Only the findBestPubkey(...) function calls them after it selected the public key algorithm.
 // If the public key algorithm is non-NIST and if the policy is set to PreferNonNist then
-// nonNist becomes true.
+// nonNist becomes true. If the policy is PreferLowCost the functions for the strong
+// algorithms take the cheapest offered algorithm.
 //
 // The functions work according to the RFC6189 spec: the initiator can select every algorithm
 // that both parties support. Thus the Initiator can even select an algorithm the wasn't offered
@@ -1719,14 +2639,26 @@ AlgorithmEnum* ZRtp::getStrongHashOffered(ZrtpPacketHello *hello, int32_t algoNa
     if (nonNist) {
         for (int i = 0; i < numHash; i++) {
             int32_t nm = *(int32_t*)(hello->getHashType(i));
-            if (nm == *(int32_t*)skn3) {
+            if (nm == *(int32_t*)skn3 && zrtpHashes.getOrdinal(hello->getHashType(i)) >= 0) {
                 return &zrtpHashes.getByName((const char*)hello->getHashType(i));
             }
         }
     }
+    if (configureAlgos.getSelectionPolicy() == ZrtpConfigure::PreferLowCost) {
+        uint32_t strong = 0;
+        for (int i = 0; i < numHash; i++) {
+            int32_t nm = *(int32_t*)(hello->getHashType(i));
+            int ord = zrtpHashes.getOrdinal(hello->getHashType(i));
+            if ((nm == *(int32_t*)s384 || nm == *(int32_t*)skn3) && ord >= 0)
+                strong |= 1U << ord;
+        }
+        AlgorithmEnum* algo = findLowestCost(zrtpHashes, strong);
+        if (algo != nullptr)
+            return algo;
+    }
     for (int i = 0; i < numHash; i++) {
         int32_t nm = *(int32_t*)(hello->getHashType(i));
-        if (nm == *(int32_t*)s384 || nm == *(int32_t*)skn3) {
+        if ((nm == *(int32_t*)s384 || nm == *(int32_t*)skn3) && zrtpHashes.getOrdinal(hello->getHashType(i)) >= 0) {
             return &zrtpHashes.getByName((const char*)hello->getHashType(i));
         }
     }
@@ -1741,14 +2673,26 @@ AlgorithmEnum* ZRtp::getStrongCipherOffered(ZrtpPacketHello *hello, int32_t algo
     if (nonNist) {
         for (int i = 0; i < num; i++) {
             int32_t nm = *(int32_t*)(hello->getCipherType(i));
-            if (nm == *(int32_t*)two3) {
+            if (nm == *(int32_t*)two3 && zrtpSymCiphers.getOrdinal(hello->getCipherType(i)) >= 0) {
                 return &zrtpSymCiphers.getByName((const char*)hello->getCipherType(i));
             }
         }
     }
+    if (configureAlgos.getSelectionPolicy() == ZrtpConfigure::PreferLowCost) {
+        uint32_t strong = 0;
+        for (int i = 0; i < num; i++) {
+            int32_t nm = *(int32_t*)(hello->getCipherType(i));
+            int ord = zrtpSymCiphers.getOrdinal(hello->getCipherType(i));
+            if ((nm == *(int32_t*)aes3 || nm == *(int32_t*)two3) && ord >= 0)
+                strong |= 1U << ord;
+        }
+        AlgorithmEnum* algo = findLowestCost(zrtpSymCiphers, strong);
+        if (algo != nullptr)
+            return algo;
+    }
     for (int i = 0; i < num; i++) {
         int32_t nm = *(int32_t*)(hello->getCipherType(i));
-        if (nm == *(int32_t*)aes3 || nm == *(int32_t*)two3) {
+        if ((nm == *(int32_t*)aes3 || nm == *(int32_t*)two3) && zrtpSymCiphers.getOrdinal(hello->getCipherType(i)) >= 0) {
             return &zrtpSymCiphers.getByName((const char*)hello->getCipherType(i));
         }
     }
@@ -1763,7 +2707,7 @@ AlgorithmEnum* ZRtp::getHashOffered(ZrtpPacketHello *hello, int32_t algoName) {
     if (nonNist) {
         for (int i = 0; i < num; i++) {
             int32_t nm = *(int32_t*)(hello->getHashType(i));
-            if (nm == *(int32_t*)skn2 || nm == *(int32_t*)skn3) {
+            if ((nm == *(int32_t*)skn2 || nm == *(int32_t*)skn3) && zrtpHashes.getOrdinal(hello->getHashType(i)) >= 0) {
                 return &zrtpHashes.getByName((const char*)hello->getHashType(i));
             }
         }
@@ -1779,7 +2723,7 @@ AlgorithmEnum* ZRtp::getCipherOffered(ZrtpPacketHello *hello, int32_t algoName)
     if (nonNist) {
         for (int i = 0; i < num; i++) {
             int32_t nm = *(int32_t*)(hello->getCipherType(i));
-            if (nm == *(int32_t*)two2 || nm == *(int32_t*)two3) {
+            if ((nm == *(int32_t*)two2 || nm == *(int32_t*)two3) && zrtpSymCiphers.getOrdinal(hello->getCipherType(i)) >= 0) {
                 return &zrtpSymCiphers.getByName((const char*)hello->getCipherType(i));
             }
         }
@@ -1795,7 +2739,7 @@ AlgorithmEnum* ZRtp::getAuthLenOffered(ZrtpPacketHello *hello, int32_t algoName)
     if (nonNist) {
         for (int i = 0; i < num; i++) {
             int32_t nm = *(int32_t*)(hello->getAuthLen(i));
-            if (nm == *(int32_t*)sk32 || nm == *(int32_t*)sk64) {
+            if ((nm == *(int32_t*)sk32 || nm == *(int32_t*)sk64) && zrtpAuthLengths.getOrdinal(hello->getAuthLen(i)) >= 0) {
                 return &zrtpAuthLengths.getByName((const char*)hello->getAuthLen(i));
             }
         }
@@ -1820,15 +2764,69 @@ bool ZRtp::checkMultiStream(ZrtpPacketHello *hello) {
     return false;
 }
 
+bool ZRtp::checkPreshared(ZrtpPacketHello *hello) {
+
+    uint32_t prshMask = 1U << zrtpPubKeys.getByName(prsh).getOrdinal();
+    if (multiStream || configureAlgos.getPresharedLimit() == 0 || (getConfiguredMask(PubKeyAlgorithm) & prshMask) == 0) {
+        return false;
+    }
+    for (int i = 0, num = hello->getNumPubKeys(); i < num; i++) {
+        if (*(int32_t*)(hello->getPubKeyType(i)) == *(int32_t*)prsh) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ZRtp::canUsePreshared() {
+    // Preshared mode sends the signed Confirm packet in the Commit handling, asynchronous signatures use DH mode
+    if (asyncSasSignature && signSasSeen)
+        return false;
+    return zidRec->isRs1Valid() && zidRec->getPreshCounter() < configureAlgos.getPresharedLimit();
+}
+
+void ZRtp::readZidRecord() {
+    if (zidRec != nullptr)
+        return;
+    uint64_t cpuStart = zrtpGetThreadCpuTime();
+    ZRTP_PROBE1(cache_get_entry, this);
+    if (trace != nullptr)
+        zidRec = zidRecStorage.adopt(trace->getRecord(peerZid));
+    else if (zidRecPrefetch.valid())
+        zidRec = zidRecStorage.adopt(zidRecPrefetch.get());
+    else if (ZIDCacheAsync::waitOpen() >= 0)    // the asynchronous requests run after an openAsync()
+        zidRec = getZidCacheInstance()->getRecordInto(peerZid, zidRecStorage);
+
+    // The background open of the cache failed, the engine keeps the peer's record in memory
+    if (zidRec == nullptr && trace == nullptr) {
+        ZIDRecordFile* record = zidRecStorage.construct<ZIDRecordFile>();
+        record->setZid(peerZid);
+        zidRec = record;
+    }
+    ZRTP_PROBE2(cache_get_return, this, zidRec);
+    ZrtpMetrics::countCacheLookup(zidRec != nullptr && zidRec->isRs1Valid());
+    detailInfo.cpuTime[CpuCache] += (int64_t)(zrtpGetThreadCpuTime() - cpuStart);
+}
+
+bool ZRtp::isPresharedCommit(ZrtpPacketCommit *commit) {
+    return !multiStream && *(int32_t*)(commit->getPubKeysType()) == *(int32_t*)prsh;
+}
+
+ZrtpPacketCommit::commitType ZRtp::getCommitType(ZrtpPacketCommit *commit) {
+    if (multiStream)
+        return ZrtpPacketCommit::MultiStream;
+    return isPresharedCommit(commit) ? ZrtpPacketCommit::Preshared : ZrtpPacketCommit::DhExchange;
+}
+
 bool ZRtp::verifyH2(ZrtpPacketCommit *commit) {
     uint8_t tmpH3[IMPL_MAX_DIGEST_LENGTH];
 
     // packet does not have the correct size, treat H2 verfication as failed.
-    if (!commit->isLengthOk(multiStream ? ZrtpPacketCommit::MultiStream : ZrtpPacketCommit::DhExchange))
+    if (!commit->isLengthOk(getCommitType(commit)))
         return false;
 
     sha256(commit->getH2(), HASH_IMAGE_SIZE, tmpH3);
-    return memcmp(tmpH3, peerH3, HASH_IMAGE_SIZE) == 0;
+    return memcmp(tmpH3, hs->peerH3, HASH_IMAGE_SIZE) == 0;
 }
 
 void ZRtp::computeHvi(ZrtpPacketDHPart* dh, ZrtpPacketHello *hello) {
@@ -1844,7 +2842,7 @@ void ZRtp::computeHvi(ZrtpPacketDHPart* dh, ZrtpPacketHello *hello) {
 
     data.push_back(hello->getHeaderBase());
     length.push_back(hello->getLength() * ZRTP_WORD_SIZE);
-    hashListFunction(data, length, hvi);
+    hashListFunction(data, length, hs->hvi);
 }
 
 void ZRtp:: computeSharedSecretSet(ZIDRecord *zidRec) {
@@ -1859,37 +2857,34 @@ void ZRtp:: computeSharedSecretSet(ZIDRecord *zidRec) {
     detailInfo.secretsCached = 0;
     if (!zidRec->isRs1Valid()) {
         randomZRTP(randBuf, RS_LENGTH);
-        hmacFunction(randBuf, RS_LENGTH, (unsigned char*)initiator, static_cast<uint32_t>(strlen(initiator)), rs1IDi, &macLen);
-        hmacFunction(randBuf, RS_LENGTH, (unsigned char*)responder, static_cast<uint32_t>(strlen(responder)), rs1IDr, &macLen);
+        hmacFunction(randBuf, RS_LENGTH, (unsigned char*)initiator, static_cast<uint32_t>(strlen(initiator)), hs->rs1IDi, &macLen);
+        hmacFunction(randBuf, RS_LENGTH, (unsigned char*)responder, static_cast<uint32_t>(strlen(responder)), hs->rs1IDr, &macLen);
     }
     else {
         rs1Valid = true;
-        hmacFunction((unsigned char*)zidRec->getRs1(), RS_LENGTH, (unsigned char*)initiator, static_cast<uint32_t>(strlen(initiator)), rs1IDi, &macLen);
-        hmacFunction((unsigned char*)zidRec->getRs1(), RS_LENGTH, (unsigned char*)responder, static_cast<uint32_t>(strlen(responder)), rs1IDr, &macLen);
+        secretIdCache.getIds(hmacFunction, peerZid, zidRec->getRs1(), hs->rs1IDi, hs->rs1IDr);
         detailInfo.secretsCached = Rs1;
     }
 
     if (!zidRec->isRs2Valid()) {
         randomZRTP(randBuf, RS_LENGTH);
-        hmacFunction(randBuf, RS_LENGTH, (unsigned char*)initiator, static_cast<uint32_t>(strlen(initiator)), rs2IDi, &macLen);
-        hmacFunction(randBuf, RS_LENGTH, (unsigned char*)responder, static_cast<uint32_t>(strlen(responder)), rs2IDr, &macLen);
+        hmacFunction(randBuf, RS_LENGTH, (unsigned char*)initiator, static_cast<uint32_t>(strlen(initiator)), hs->rs2IDi, &macLen);
+        hmacFunction(randBuf, RS_LENGTH, (unsigned char*)responder, static_cast<uint32_t>(strlen(responder)), hs->rs2IDr, &macLen);
     }
     else {
         rs2Valid = true;
-        hmacFunction((unsigned char*)zidRec->getRs2(), RS_LENGTH, (unsigned char*)initiator, static_cast<uint32_t>(strlen(initiator)), rs2IDi, &macLen);
-        hmacFunction((unsigned char*)zidRec->getRs2(), RS_LENGTH, (unsigned char*)responder, static_cast<uint32_t>(strlen(responder)), rs2IDr, &macLen);
+        secretIdCache.getIds(hmacFunction, peerZid, zidRec->getRs2(), hs->rs2IDi, hs->rs2IDr);
         detailInfo.secretsCached |= Rs2;
     }
 
     if (!zidRec->isMITMKeyAvailable()) {
         randomZRTP(randBuf, RS_LENGTH);
-        hmacFunction(randBuf, RS_LENGTH, (unsigned char*)initiator, static_cast<uint32_t>(strlen(initiator)), pbxSecretIDi, &macLen);
-        hmacFunction(randBuf, RS_LENGTH, (unsigned char*)responder, static_cast<uint32_t>(strlen(responder)), pbxSecretIDr, &macLen);
+        hmacFunction(randBuf, RS_LENGTH, (unsigned char*)initiator, static_cast<uint32_t>(strlen(initiator)), hs->pbxSecretIDi, &macLen);
+        hmacFunction(randBuf, RS_LENGTH, (unsigned char*)responder, static_cast<uint32_t>(strlen(responder)), hs->pbxSecretIDr, &macLen);
 
     }
     else {
-        hmacFunction((unsigned char*)zidRec->getMiTMData(), RS_LENGTH, (unsigned char*)initiator, static_cast<uint32_t>(strlen(initiator)), pbxSecretIDi, &macLen);
-        hmacFunction((unsigned char*)zidRec->getMiTMData(), RS_LENGTH, (unsigned char*)responder, static_cast<uint32_t>(strlen(responder)), pbxSecretIDr, &macLen);
+        secretIdCache.getIds(hmacFunction, peerZid, zidRec->getMiTMData(), hs->pbxSecretIDi, hs->pbxSecretIDr);
         detailInfo.secretsCached |= Pbx;
     }
     computeAuxSecretIds();
@@ -1901,30 +2896,21 @@ void ZRtp::computeAuxSecretIds() {
 
     if (auxSecret == nullptr) {
         randomZRTP(randBuf, RS_LENGTH);
-        hmacFunction(randBuf, RS_LENGTH, H3, HASH_IMAGE_SIZE, auxSecretIDi, &macLen);
-        hmacFunction(randBuf, RS_LENGTH, H3, HASH_IMAGE_SIZE, auxSecretIDr, &macLen);
+        hmacFunction(randBuf, RS_LENGTH, H3, HASH_IMAGE_SIZE, hs->auxSecretIDi, &macLen);
+        hmacFunction(randBuf, RS_LENGTH, H3, HASH_IMAGE_SIZE, hs->auxSecretIDr, &macLen);
     }
     else {
         if (myRole == Initiator) {  // I'm initiator thus use my H3 for initiator's IDi, peerH3 for respnder's IDr
-            hmacFunction(auxSecret, auxSecretLength, H3, HASH_IMAGE_SIZE, auxSecretIDi, &macLen);
-            hmacFunction(auxSecret, auxSecretLength, peerH3, HASH_IMAGE_SIZE, auxSecretIDr, &macLen);
+            hmacFunction(auxSecret, auxSecretLength, H3, HASH_IMAGE_SIZE, hs->auxSecretIDi, &macLen);
+            hmacFunction(auxSecret, auxSecretLength, hs->peerH3, HASH_IMAGE_SIZE, hs->auxSecretIDr, &macLen);
         }
         else {
-            hmacFunction(auxSecret, auxSecretLength, peerH3, HASH_IMAGE_SIZE, auxSecretIDi, &macLen);
-            hmacFunction(auxSecret, auxSecretLength, H3, HASH_IMAGE_SIZE, auxSecretIDr, &macLen);
+            hmacFunction(auxSecret, auxSecretLength, hs->peerH3, HASH_IMAGE_SIZE, hs->auxSecretIDi, &macLen);
+            hmacFunction(auxSecret, auxSecretLength, H3, HASH_IMAGE_SIZE, hs->auxSecretIDr, &macLen);
         }
     }
 }
 
-/*
- * memset_volatile is a volatile pointer to the memset function.
- * You can call (*memset_volatile)(buf, val, len) or even
- * memset_volatile(buf, val, len) just as you would call
- * memset(buf, val, len), but the use of a volatile pointer
- * guarantees that the compiler will not optimise the call away.
- */
-static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
-
 /*
  * The DH packet for this function is DHPart1 and contains the Responder's
  * retained secret ids. Compare them with the expected secret ids (refer
@@ -1938,9 +2924,9 @@ void ZRtp::generateKeysInitiator(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
     setD[0] = setD[1] = setD[2] = nullptr;
 
     detailInfo.secretsMatchedDH = 0;
-    if (memcmp(rs1IDr, dhPart->getRs1Id(), HMAC_SIZE) == 0 || memcmp(rs1IDr, dhPart->getRs2Id(), HMAC_SIZE) == 0)
+    if (memcmp(hs->rs1IDr, dhPart->getRs1Id(), HMAC_SIZE) == 0 || memcmp(hs->rs1IDr, dhPart->getRs2Id(), HMAC_SIZE) == 0)
         detailInfo.secretsMatchedDH |= Rs1;
-    if (memcmp(rs2IDr, dhPart->getRs1Id(), HMAC_SIZE) == 0 || memcmp(rs2IDr, dhPart->getRs2Id(), HMAC_SIZE) == 0)
+    if (memcmp(hs->rs2IDr, dhPart->getRs1Id(), HMAC_SIZE) == 0 || memcmp(hs->rs2IDr, dhPart->getRs2Id(), HMAC_SIZE) == 0)
         detailInfo.secretsMatchedDH |= Rs2;
     /*
      * Select the real secrets into setD. The dhPart is DHpart1 message
@@ -1949,28 +2935,28 @@ void ZRtp::generateKeysInitiator(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
      */
     // Check which RS we shall use for first place (s1)
     detailInfo.secretsMatched = 0;
-    if (memcmp(rs1IDr, dhPart->getRs1Id(), HMAC_SIZE) == 0) {
+    if (memcmp(hs->rs1IDr, dhPart->getRs1Id(), HMAC_SIZE) == 0) {
         setD[0] = zidRec->getRs1();
         rsFound = 0x1;
         detailInfo.secretsMatched = Rs1;
     }
-    else if (memcmp(rs1IDr, dhPart->getRs2Id(), HMAC_SIZE) == 0) {
+    else if (memcmp(hs->rs1IDr, dhPart->getRs2Id(), HMAC_SIZE) == 0) {
         setD[0] = zidRec->getRs1();
         rsFound = 0x2;
         detailInfo.secretsMatched = Rs1;
     }
-    else if (memcmp(rs2IDr, dhPart->getRs1Id(), HMAC_SIZE) == 0) {
+    else if (memcmp(hs->rs2IDr, dhPart->getRs1Id(), HMAC_SIZE) == 0) {
         setD[0] = zidRec->getRs2();
         rsFound = 0x4;
         detailInfo.secretsMatched = Rs2;
     }
-    else if (memcmp(rs2IDr, dhPart->getRs2Id(), HMAC_SIZE) == 0) {
+    else if (memcmp(hs->rs2IDr, dhPart->getRs2Id(), HMAC_SIZE) == 0) {
         setD[0] = zidRec->getRs2();
         rsFound = 0x8;
         detailInfo.secretsMatched = Rs2;
     }
 
-    if (memcmp(auxSecretIDr, dhPart->getAuxSecretId(), 8) == 0) {
+    if (memcmp(hs->auxSecretIDr, dhPart->getAuxSecretId(), 8) == 0) {
         DEBUGOUT((fprintf(stdout, "Initiator: Match for aux secret found\n")));
         setD[1] = auxSecret;
         detailInfo.secretsMatched |= Aux;
@@ -1982,7 +2968,7 @@ void ZRtp::generateKeysInitiator(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
 
 #ifdef ZRTP_SAS_RELAY_SUPPORT
     // check if we have a matching PBX secret and place it third (s3)
-    if (memcmp(pbxSecretIDr, dhPart->getPbxSecretId(), HMAC_SIZE) == 0) {
+    if (memcmp(hs->pbxSecretIDr, dhPart->getPbxSecretId(), HMAC_SIZE) == 0) {
         DEBUGOUT((fprintf(stdout, "%c: Match for Other_secret found\n", zid[0])));
         setD[2] = zidRec->getMiTMData();
         detailInfo.secretsMatched |= Pbx;
@@ -2084,7 +3070,7 @@ void ZRtp::generateKeysInitiator(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
 //  hexdump("S0 I", s0, hashLength);
 
     memset_volatile(DHss, 0, dhContext->getDhSize());
-    delete[] DHss;
+    deleteSecret(DHss, dhContext->getDhSize());
     DHss = nullptr;
 
     computeSRTPKeys();
@@ -2102,9 +3088,9 @@ void ZRtp::generateKeysResponder(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
     setD[0] = setD[1] = setD[2] = nullptr;
 
     detailInfo.secretsMatchedDH = 0;
-    if (memcmp(rs1IDi, dhPart->getRs1Id(), HMAC_SIZE) == 0 || memcmp(rs1IDi, dhPart->getRs2Id(), HMAC_SIZE) == 0)
+    if (memcmp(hs->rs1IDi, dhPart->getRs1Id(), HMAC_SIZE) == 0 || memcmp(hs->rs1IDi, dhPart->getRs2Id(), HMAC_SIZE) == 0)
         detailInfo.secretsMatchedDH |= Rs1;
-    if (memcmp(rs2IDi, dhPart->getRs1Id(), HMAC_SIZE) == 0 || memcmp(rs2IDi, dhPart->getRs2Id(), HMAC_SIZE) == 0)
+    if (memcmp(hs->rs2IDi, dhPart->getRs1Id(), HMAC_SIZE) == 0 || memcmp(hs->rs2IDi, dhPart->getRs2Id(), HMAC_SIZE) == 0)
         detailInfo.secretsMatchedDH |= Rs2;
 
     /*
@@ -2112,28 +3098,28 @@ void ZRtp::generateKeysResponder(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
      */
     // Check which RS we shall use for first place (s1)
     detailInfo.secretsMatched = 0;
-    if (memcmp(rs1IDi, dhPart->getRs1Id(), HMAC_SIZE) == 0) {
+    if (memcmp(hs->rs1IDi, dhPart->getRs1Id(), HMAC_SIZE) == 0) {
         setD[0] = zidRec->getRs1();
         rsFound = 0x1;
         detailInfo.secretsMatched = Rs1;
     }
-    else if (memcmp(rs1IDi, dhPart->getRs2Id(), HMAC_SIZE) == 0) {
+    else if (memcmp(hs->rs1IDi, dhPart->getRs2Id(), HMAC_SIZE) == 0) {
         setD[0] = zidRec->getRs1();
         rsFound = 0x2;
         detailInfo.secretsMatched = Rs1;
     }
-    else if (memcmp(rs2IDi, dhPart->getRs1Id(), HMAC_SIZE) == 0) {
+    else if (memcmp(hs->rs2IDi, dhPart->getRs1Id(), HMAC_SIZE) == 0) {
         setD[0] = zidRec->getRs2();
         rsFound |= 0x4;
         detailInfo.secretsMatched = Rs2;
     }
-    else if (memcmp(rs2IDi, dhPart->getRs2Id(), HMAC_SIZE) == 0) {
+    else if (memcmp(hs->rs2IDi, dhPart->getRs2Id(), HMAC_SIZE) == 0) {
         setD[0] = zidRec->getRs2();
         rsFound |= 0x8;
         detailInfo.secretsMatched = Rs2;
     }
 
-    if (memcmp(auxSecretIDi, dhPart->getAuxSecretId(), 8) == 0) {
+    if (memcmp(hs->auxSecretIDi, dhPart->getAuxSecretId(), 8) == 0) {
         DEBUGOUT((fprintf(stdout, "Responder: Match for aux secret found\n")));
         setD[1] = auxSecret;
         detailInfo.secretsMatched |= Aux;
@@ -2145,7 +3131,7 @@ void ZRtp::generateKeysResponder(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
     }
 
 #ifdef ZRTP_SAS_RELAY_SUPPORT
-    if (memcmp(pbxSecretIDi, dhPart->getPbxSecretId(), 8) == 0) {
+    if (memcmp(hs->pbxSecretIDi, dhPart->getPbxSecretId(), 8) == 0) {
         DEBUGOUT((fprintf(stdout, "%c: Match for PBX secret found\n", ownZid[0])));
         setD[2] = zidRec->getMiTMData();
         detailInfo.secretsMatched |= Pbx;
@@ -2246,7 +3232,7 @@ void ZRtp::generateKeysResponder(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
 //  hexdump("S0 R", s0, hashLength);
 
     memset_volatile(DHss, 0, dhContext->getDhSize());
-    delete[] DHss;
+    deleteSecret(DHss, dhContext->getDhSize());
     DHss = nullptr;
 
     computeSRTPKeys();
@@ -2257,31 +3243,45 @@ void ZRtp::generateKeysResponder(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec) {
 void ZRtp::KDF(uint8_t* key, size_t keyLength, uint8_t* label, size_t labelLength,
                uint8_t* context, size_t contextLength, size_t L, uint8_t* output) {
 
-    std::vector<const uint8_t*>data;
-    std::vector<uint64_t> length;
+    KdfOutput kdfOutput = {label, labelLength, L, output};
+    KDF(key, keyLength, context, contextLength, &kdfOutput, 1);
+}
+
+void ZRtp::KDF(uint8_t* key, size_t keyLength, uint8_t* context, size_t contextLength,
+               const KdfOutput* outputs, size_t count) {
+
+    HmacCtx hmacCtx;
+    const uint8_t* data[4];
+    uint64_t length[4];
     uint32_t macLen = 0;
+    uint64_t cpuStart = zrtpGetThreadCpuTime();
 
     // Very first element is a fixed counter, big endian
     uint32_t counter = 1;
     counter = zrtpHtonl(counter);
-    data.push_back(reinterpret_cast<uint_8t *>(&counter));
-    length.push_back(sizeof(uint32_t));
-
-    // Next element is the label, null terminated, labelLength includes null byte.
-    data.push_back(label);
-    length.push_back(labelLength);
+    data[0] = reinterpret_cast<uint8_t *>(&counter);
+    length[0] = sizeof(uint32_t);
 
     // Next is the KDF context
-    data.push_back(context);
-    length.push_back(contextLength);
+    data[2] = context;
+    length[2] = contextLength;
 
     // last element is HMAC length in bits, big endian
-    uint32_t len = zrtpHtonl(static_cast<uint32_t>(L));
-    data.push_back(reinterpret_cast<uint_8t *>(&len));
-    length.push_back(sizeof(uint32_t));
-
-    // Use negotiated hash.
-    hmacListFunction(key, keyLength, data, length, output, &macLen);
+    uint32_t len = 0;
+    data[3] = reinterpret_cast<uint8_t *>(&len);
+    length[3] = sizeof(uint32_t);
+
+    // Use negotiated hash, prepare the key only once for all outputs.
+    createHmacCtx(&hmacCtx, key, keyLength);
+    for (size_t i = 0; i < count; i++) {
+        // Second element is the label, null terminated, labelLength includes null byte.
+        data[1] = outputs[i].label;
+        length[1] = outputs[i].labelLength;
+        len = zrtpHtonl(static_cast<uint32_t>(outputs[i].L));
+        hmacCtxListFunction(&hmacCtx, data, length, 4, outputs[i].output, &macLen);
+    }
+    memset_volatile(&hmacCtx, 0, sizeof(hmacCtx));
+    detailInfo.cpuTime[CpuKdf] += (int64_t)(zrtpGetThreadCpuTime() - cpuStart);
 }
 
 // Compute the Multi Stream mode s0
@@ -2308,6 +3308,79 @@ void ZRtp::generateKeysMultiStream() {
     computeSRTPKeys();
 }
 
+// Compute the preshared key and its key ID, refer to RFC 6189, chapter 4.4.2
+void ZRtp::computePresharedKey(uint8_t* keyId) {
+
+    /*
+     * preshared_key = hash(len(rs1) | rs1 | len(auxsecret) | auxsecret | \
+     *                      len(pbxsecret) | pbxsecret)
+     *
+     * The lengths are 32 bit big-endian numbers, a missing secret contributes
+     * its zero length only.
+     */
+    std::vector<const uint_8t*> data;
+    std::vector<uint64_t> length;
+
+    const uint8_t* secrets[3] = {zidRec->getRs1(), auxSecret, nullptr};
+    uint32_t secretLengths[3] = {RS_LENGTH, auxSecretLength, RS_LENGTH};
+    uint32_t sLen[3];
+
+    detailInfo.secretsMatched = Rs1;
+    if (auxSecret != nullptr)
+        detailInfo.secretsMatched |= Aux;
+#ifdef ZRTP_SAS_RELAY_SUPPORT
+    if (zidRec->isMITMKeyAvailable()) {
+        secrets[2] = zidRec->getMiTMData();
+        detailInfo.secretsMatched |= Pbx;
+    }
+#endif
+    for (int32_t i = 0; i < 3; i++) {
+        sLen[i] = zrtpHtonl(secrets[i] != nullptr ? secretLengths[i] : 0);
+        data.push_back((unsigned char*)&sLen[i]);
+        length.push_back(sizeof(uint32_t));
+        if (secrets[i] != nullptr) {
+            data.push_back(secrets[i]);
+            length.push_back(secretLengths[i]);
+        }
+    }
+    hashListFunction(data, length, presharedKey);
+
+    // keyID = MAC(preshared_key, "Prsh"), truncated to 64 bits
+    uint8_t mac[MAX_DIGEST_LENGTH];
+    uint32_t macLen;
+    hmacFunction(presharedKey, hashLength, (unsigned char*)prsh, static_cast<uint32_t>(strlen(prsh)), mac, &macLen);
+    memcpy(keyId, mac, 2*ZRTP_WORD_SIZE);
+}
+
+// Compute the Preshared mode s0
+void ZRtp::generateKeysPreshared() {
+
+    // allocate the maximum size, compute real size to use
+    uint8_t KDFcontext[sizeof(peerZid)+sizeof(ownZid)+sizeof(messageHash)];
+    size_t kdfSize = sizeof(peerZid)+sizeof(ownZid)+hashLength;
+
+    if (myRole == Responder) {
+        memcpy(KDFcontext, peerZid, sizeof(peerZid));
+        memcpy(KDFcontext+sizeof(peerZid), ownZid, sizeof(ownZid));
+    }
+    else {
+        memcpy(KDFcontext, ownZid, sizeof(ownZid));
+        memcpy(KDFcontext+sizeof(ownZid), peerZid, sizeof(peerZid));
+    }
+    memcpy(KDFcontext+sizeof(ownZid)+sizeof(peerZid), messageHash, hashLength);
+
+    KDF(presharedKey, hashLength, (unsigned char*)zrtpPsk, strlen(zrtpPsk)+1, KDFcontext, kdfSize, hashLength*8, s0);
+
+    memset_volatile(presharedKey, 0, sizeof(presharedKey));
+    memset(KDFcontext, 0, sizeof(KDFcontext));
+    sendInfo(Info, InfoRSMatchFound);
+
+    // From now on report Preshared as key agreement algorithm
+    pubKey = &zrtpPubKeys.getByName(prsh);
+    computeSRTPKeys();
+    memset(s0, 0, MAX_DIGEST_LENGTH);
+}
+
 void ZRtp::computePBXSecret() {
 #ifdef ZRTP_SAS_RELAY_SUPPORT
     // Construct the KDF context as per ZRTP specification chap 7.3.1:
@@ -2331,13 +3404,7 @@ void ZRtp::computePBXSecret() {
 #endif
 }
 
-void ZRtp::computeSRTPKeys() {
-
-    // allocate the maximum size, compute real size to use
-    uint8_t KDFcontext[sizeof(peerZid)+sizeof(ownZid)+sizeof(messageHash)];
-    size_t kdfSize = sizeof(peerZid)+sizeof(ownZid)+hashLength;
-
-    size_t keyLen = cipher->getKeylen() * 8UL;
+size_t ZRtp::setupKdfContext(uint8_t* KDFcontext) {
 
     if (myRole == Responder) {
         memcpy(KDFcontext, peerZid, sizeof(peerZid));
@@ -2348,38 +3415,59 @@ void ZRtp::computeSRTPKeys() {
         memcpy(KDFcontext+sizeof(ownZid), peerZid, sizeof(peerZid));
     }
     memcpy(KDFcontext+sizeof(ownZid)+sizeof(peerZid), messageHash, hashLength);
+    return sizeof(peerZid)+sizeof(ownZid)+hashLength;
+}
 
-    // Inititiator key and salt
-    KDF(s0, hashLength, (unsigned char*)iniMasterKey, strlen(iniMasterKey)+1, KDFcontext, kdfSize, keyLen, srtpKeyI);
-    KDF(s0, hashLength, (unsigned char*)iniMasterSalt, strlen(iniMasterSalt)+1, KDFcontext, kdfSize, 112, srtpSaltI);
+void ZRtp::computeSRTPKeys() {
 
-    // Responder key and salt
-    KDF(s0, hashLength, (unsigned char*)respMasterKey, strlen(respMasterKey)+1, KDFcontext, kdfSize, keyLen, srtpKeyR);
-    KDF(s0, hashLength, (unsigned char*)respMasterSalt, strlen(respMasterSalt)+1, KDFcontext, kdfSize, 112, srtpSaltR);
+    // allocate the maximum size, compute real size to use
+    uint8_t KDFcontext[sizeof(peerZid)+sizeof(ownZid)+sizeof(messageHash)];
+    size_t kdfSize = setupKdfContext(KDFcontext);
 
-    // The HMAC keys for GoClear
-    KDF(s0, hashLength, (unsigned char*)iniHmacKey, strlen(iniHmacKey)+1, KDFcontext, kdfSize, hashLength*8, hmacKeyI);
-    KDF(s0, hashLength, (unsigned char*)respHmacKey, strlen(respHmacKey)+1, KDFcontext, kdfSize, hashLength*8, hmacKeyR);
+    size_t keyLen = cipher->getKeylen() * 8UL;
+    size_t saltLen = getSrtpSaltLength();
+
+#define KDF_OUTPUT(label, L, output) {(uint8_t*)(label), strlen(label)+1, (L), (output)}
+    KdfOutput outputs[] = {
+        // Inititiator key and salt
+        KDF_OUTPUT(iniMasterKey, keyLen, srtpKeyI),
+        KDF_OUTPUT(iniMasterSalt, saltLen, srtpSaltI),
+
+        // Responder key and salt
+        KDF_OUTPUT(respMasterKey, keyLen, srtpKeyR),
+        KDF_OUTPUT(respMasterSalt, saltLen, srtpSaltR),
+
+        // The HMAC keys for GoClear
+        KDF_OUTPUT(iniHmacKey, hashLength*8, hmacKeyI),
+        KDF_OUTPUT(respHmacKey, hashLength*8, hmacKeyR),
+
+        // The keys for Confirm messages
+        KDF_OUTPUT(iniZrtpKey, keyLen, zrtpKeyI),
+        KDF_OUTPUT(respZrtpKey, keyLen, zrtpKeyR),
+
+        // The following keys only if not in multi-stream mode:
+        // the new Retained Secret, the ZRTP Session Key and the SAS hash.
+        // getExportedKey() derives the exported key on request.
+        KDF_OUTPUT(retainedSec, SHA256_DIGEST_LENGTH*8, newRs1),
+        KDF_OUTPUT(zrtpSessionKey, hashLength*8, zrtpSession),
+        KDF_OUTPUT(sasString, SHA256_DIGEST_LENGTH*8, sasHash)
+    };
+#undef KDF_OUTPUT
+    size_t numOutputs = sizeof(outputs) / sizeof(outputs[0]);
+    KDF(s0, hashLength, KDFcontext, kdfSize, outputs, multiStream ? numOutputs - 3 : numOutputs);
 
-    // The keys for Confirm messages
-    KDF(s0, hashLength, (unsigned char*)iniZrtpKey, strlen(iniZrtpKey)+1, KDFcontext, kdfSize, keyLen, zrtpKeyI);
-    KDF(s0, hashLength, (unsigned char*)respZrtpKey, strlen(respZrtpKey)+1, KDFcontext, kdfSize, keyLen, zrtpKeyR);
+    if (!multiStream) {
+        std::lock_guard<std::mutex> guard(exportLock);
+        memcpy(exportSecret, s0, hashLength);
+        exportPending = true;
+    }
 
     detailInfo.pubKey = detailInfo.sasType = nullptr;
     if (!multiStream) {
-        // Compute the new Retained Secret
-        KDF(s0, hashLength, (unsigned char*)retainedSec, strlen(retainedSec)+1, KDFcontext, kdfSize, SHA256_DIGEST_LENGTH*8, newRs1);
-
-        // Compute the ZRTP Session Key
-        KDF(s0, hashLength, (unsigned char*)zrtpSessionKey, strlen(zrtpSessionKey)+1, KDFcontext, kdfSize, hashLength*8, zrtpSession);
-
-        // Compute the exported Key
-        KDF(s0, hashLength, (unsigned char*)zrtpExportedKey, strlen(zrtpExportedKey)+1, KDFcontext, kdfSize, hashLength*8, zrtpExport);
         // perform  generation according to chapter 5.5 and 8.
         // we don't need a speciai sasValue filed. sasValue are the first
         // (leftmost) 32 bits (4 bytes) of sasHash
         uint8_t sasBytes[4];
-        KDF(s0, hashLength, (unsigned char*)sasString, strlen(sasString)+1, KDFcontext, kdfSize, SHA256_DIGEST_LENGTH*8, sasHash);
 
         // according to chapter 8 only the leftmost 20 bits of sasValue (aka
         //  sasHash) are used to create the character SAS string of type SAS
@@ -2389,10 +3477,12 @@ void ZRtp::computeSRTPKeys() {
         sasBytes[2] = sasHash[2] & static_cast<uint8_t>(0xf0);
         sasBytes[3] = 0;
         if (*(int32_t*)b32 == *(int32_t*)(sasType->getName())) {
-            SAS = Base32(sasBytes, 20).getEncoded();
+            char sasText[8];
+            SAS.assign(sasText, Base32::b2a(sasBytes, 20, sasText, sizeof(sasText)));
         }
         else if (*(int32_t*)b32e == *(int32_t*)(sasType->getName())) {
-            SAS = *EmojiBase32::u32StringToUtf8(EmojiBase32(sasBytes, 20).getEncoded());
+            char sasText[20];
+            SAS.assign(sasText, EmojiBase32::b2aUtf8(sasBytes, 20, sasText, sizeof(sasText)));
         }
         else if (*(int32_t*)b10d == *(int32_t*)(sasType->getName())) {
             SAS = sasDigit(sasHash);
@@ -2404,8 +3494,11 @@ void ZRtp::computeSRTPKeys() {
             SAS.assign(sas256WordsEven[sasBytes[0]]).append(":").append(sas256WordsOdd[sasBytes[1]]);
         }
 
-        if (signSasSeen)
-             callback->signSAS(sasHash);
+        if (signSasSeen) {
+            if (asyncSasSignature)
+                startSasSignature();
+            callback->signSAS(sasHash);
+        }
 
         detailInfo.pubKey = pubKey->getReadable();
         detailInfo.sasType = sasType->getReadable();
@@ -2427,12 +3520,12 @@ bool ZRtp::srtpSecretsReady(EnableSecurity part) {
     sec.keyInitiator = srtpKeyI;
     sec.initKeyLen = cipher->getKeylen() * 8;
     sec.saltInitiator = srtpSaltI;
-    sec.initSaltLen = 112;
+    sec.initSaltLen = getSrtpSaltLength();
 
     sec.keyResponder = srtpKeyR;
     sec.respKeyLen = cipher->getKeylen() * 8;
     sec.saltResponder = srtpSaltR;
-    sec.respSaltLen = 112;
+    sec.respSaltLen = getSrtpSaltLength();
 
     sec.authAlgorithm = authLength->getAlgoId();
     sec.srtpAuthTagLen = authLength->getKeylen();
@@ -2443,24 +3536,27 @@ bool ZRtp::srtpSecretsReady(EnableSecurity part) {
     bool rc = callback->srtpSecretsReady(&sec, part);
 
     // The call state engine calls ForSender always after ForReceiver.
-    if (part == ForSender) {
-        std::string cs(cipher->getReadable());
-        if (!multiStream) {
-            cs.append("/").append(pubKey->getName());
-            if (mitmSeen)
-                cs.append("/EndAtMitM");
-            callback->srtpSecretsOn(cs, SAS, zidRec->isSasVerified());
-        }
-        else {
-            std::string cs1;
-            if (mitmSeen)
-                cs.append("/EndAtMitM");
-            callback->srtpSecretsOn(cs, cs1, true);
-        }
-    }
+    if (part == ForSender)
+        reportSecretsOn();
     return rc;
 }
 
+void ZRtp::reportSecretsOn() {
+    std::string cs(cipher->getReadable());
+    if (!multiStream) {
+        cs.append("/").append(pubKey->getName());
+        if (mitmSeen)
+            cs.append("/EndAtMitM");
+        callback->srtpSecretsOn(cs, SAS, zidRec->isSasVerified());
+    }
+    else {
+        std::string cs1;
+        if (mitmSeen)
+            cs.append("/EndAtMitM");
+        callback->srtpSecretsOn(cs, cs1, true);
+    }
+}
+
 void ZRtp::setNegotiatedHash(AlgorithmEnum* hash) {
     switch (zrtpHashes.getOrdinal(*hash)) {
     case 0:
@@ -2471,12 +3567,15 @@ void ZRtp::setNegotiatedHash(AlgorithmEnum* hash) {
         hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const std::vector<const uint8_t*>&,
                                                 const std::vector<uint64_t>&, uint8_t *, uint32_t *)>(hmacSha256);
 
+        createHmacCtx = initializeSha256HmacContext;
+        hmacCtxListFunction = hmacSha256Ctx;
+
         createHashCtx = initializeSha256Context;
-        msgShaContext = &hashCtx.sha256Ctx;
         closeHashCtx = finalizeSha256Context;
         hashCtxFunction = sha256Ctx;
         break;
 
+#ifndef ZRTP_MINIMAL_ALGORITHMS
     case 1:
         hashLength = SHA384_DIGEST_LENGTH;
         hashListFunction = sha384; // static_cast<void (*) (const std::vector<const uint8_t*>&, const std::vector<uint64_t>&, uint8_t *)>(sha384);
@@ -2485,8 +3584,10 @@ void ZRtp::setNegotiatedHash(AlgorithmEnum* hash) {
         hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const std::vector<const uint8_t*>&,
                                                 const std::vector<uint64_t>&, uint8_t *, uint32_t *)>(hmacSha384);
 
+        createHmacCtx = initializeSha384HmacContext;
+        hmacCtxListFunction = hmacSha384Ctx;
+
         createHashCtx = initializeSha384Context;
-        msgShaContext = &hashCtx.sha384Ctx;
         closeHashCtx = finalizeSha384Context;
         hashCtxFunction = sha384Ctx;
         break;
@@ -2498,8 +3599,10 @@ void ZRtp::setNegotiatedHash(AlgorithmEnum* hash) {
         hmacFunction = macSkein256;
         hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const std::vector<const uint8_t*>&, const std::vector<uint64_t>&, uint8_t *, uint32_t *)>(macSkein256);
 
+        createHmacCtx = initializeMacSkein256Context;
+        hmacCtxListFunction = macSkein256Ctx;
+
         createHashCtx = initializeSkein256Context;
-        msgShaContext = &hashCtx.skeinCtx;
         closeHashCtx = finalizeSkein256Context;
         hashCtxFunction = skein256Ctx;
         break;
@@ -2511,11 +3614,14 @@ void ZRtp::setNegotiatedHash(AlgorithmEnum* hash) {
         hmacFunction = macSkein384;
         hmacListFunction = static_cast<void (*)(const uint8_t*, uint64_t, const std::vector<const uint8_t*>&, const std::vector<uint64_t>&, uint8_t *, uint32_t *)>(macSkein384);
 
+        createHmacCtx = initializeMacSkein384Context;
+        hmacCtxListFunction = macSkein384Ctx;
+
         createHashCtx = initializeSkein384Context;
-        msgShaContext = &hashCtx.skeinCtx;
         closeHashCtx = finalizeSkein384Context;
         hashCtxFunction = skein384Ctx;
         break;
+#endif
 
     default:
         break;
@@ -2527,19 +3633,33 @@ void ZRtp::srtpSecretsOff(EnableSecurity part) {
     callback->srtpSecretsOff(part);
 }
 
+void ZRtp::saveZidRec() {
+
+    uint64_t cpuStart = zrtpGetThreadCpuTime();
+    ZRTP_PROBE2(cache_save_entry, this, asyncZidCache);
+    if (trace != nullptr)
+        trace->saveRecord(zidRec);
+    else if (asyncZidCache)
+        ZIDCacheAsync::saveRecordAsync(zidRec);
+    else if (ZIDCacheAsync::waitOpen() >= 0)   // no save if the background open failed
+        getZidCacheInstance()->saveRecord(zidRec);
+    ZRTP_PROBE1(cache_save_return, this);
+    detailInfo.cpuTime[CpuCache] += (int64_t)(zrtpGetThreadCpuTime() - cpuStart);
+}
+
 void ZRtp::SASVerified() {
     if (paranoidMode)
         return;
 
     zidRec->setSasVerified();
     saveZidRecord = true;
-    getZidCacheInstance()->saveRecord(zidRec);
+    saveZidRec();
 }
 
 void ZRtp::resetSASVerified() {
 
     zidRec->resetSasVerified();
-    getZidCacheInstance()->saveRecord(zidRec);
+    saveZidRec();
 }
 
 bool ZRtp::isSASVerified() {
@@ -2551,7 +3671,7 @@ void ZRtp::setRs2Valid() {
     if (zidRec != nullptr) {
         zidRec->setRs2Valid();
         if (saveZidRecord)
-            getZidCacheInstance()->saveRecord(zidRec);
+            saveZidRec();
     }
 }
 
@@ -2570,12 +3690,20 @@ void ZRtp::sendInfo(GnuZrtpCodes::MessageSeverity severity, int32_t subCode) {
         memset(srtpSaltI, 0, 112/8);
         memset(srtpKeyR, 0, cipher->getKeylen());
         memset(srtpSaltR, 0, 112/8);
+
+        // A multi-stream engine does not negotiate all algorithms
+        AlgorithmEnum* algos[ZrtpMetrics::NumberOfAlgorithmTypes] = {hash, cipher, pubKey, sasType, authLength};
+        int32_t ordinals[ZrtpMetrics::NumberOfAlgorithmTypes];
+        for (int32_t i = 0; i < ZrtpMetrics::NumberOfAlgorithmTypes; i++)
+            ordinals[i] = (algos[i] != nullptr) ? algos[i]->getOrdinal() : -1;
+        ZrtpMetrics::countHandshakeSecure(ordinals, detailInfo.phaseTime[PhaseSecure]);
     }
     callback->sendInfo(severity, subCode);
 }
 
 
 void ZRtp::zrtpNegotiationFailed(GnuZrtpCodes::MessageSeverity severity, int32_t subCode) {
+    ZrtpMetrics::countHandshakeFailed(severity, subCode);
     callback->zrtpNegotiationFailed(severity, subCode);
 }
 
@@ -2583,24 +3711,24 @@ void ZRtp::zrtpNotSuppOther() {
     callback->zrtpNotSuppOther();
 }
 
-void ZRtp::synchEnter() {
-    callback->synchEnter();
-}
-
-void ZRtp::synchLeave() {
-    callback->synchLeave();
-}
-
 int32_t ZRtp::sendPacketZRTP(ZrtpPacketBase *packet) {
-    return ((packet == nullptr) ? 0 :
-            callback->sendDataZRTP(packet->getHeaderBase(), (packet->getLength() * 4) + 4));
+    if (packet == nullptr)
+        return 0;
+    recordMessagePhase(ZrtpStateClass::classifyMessage(packet->getHeaderBase() + 4), true);
+    if (trace != nullptr)
+        trace->traceSent(packet->getHeaderBase(), (packet->getLength() * 4) + 4);
+    return callback->sendDataZRTP(packet->getHeaderBase(), (packet->getLength() * 4) + 4);
 }
 
 int32_t ZRtp::activateTimer(int32_t tm) {
-    return (callback->activateTimer(tm));
+    if (trace != nullptr)
+        trace->traceTimerStart(tm);
+    return (callback->activateTimerSlack(tm, (int32_t)(tm * configureAlgos.getTimerSlack() / 100)));
 }
 
 int32_t ZRtp::cancelTimer() {
+    if (trace != nullptr)
+        trace->traceTimerCancel();
     return (callback->cancelTimer());
 }
 
@@ -2619,6 +3747,10 @@ void ZRtp::setClientId(std::string id, HelloPacketVersion* hpv) {
     tmp[CLIENT_ID_SIZE] = 0;
 
     hpv->packet->setClientId(tmp);
+    computeHelloHmac(hpv);
+}
+
+void ZRtp::computeHelloHmac(HelloPacketVersion* hpv) {
 
     uint32_t len = hpv->packet->getLength() * ZRTP_WORD_SIZE;
 
@@ -2635,22 +3767,67 @@ void ZRtp::setClientId(std::string id, HelloPacketVersion* hpv) {
     hashFunctionImpl((uint8_t*)hpv->packet->getHeaderBase(), len, hpv->helloHash);
 }
 
+// The version 1.2 Hello differs from the version 1.10 Hello in the version, the HMAC and the helloHash
+void ZRtp::prepareHello(int32_t index) {
+
+    if (index != 1)
+        return;
+
+    std::call_once(lazyHelloOnce, [this]() {
+        zrtpHello_12.configureHello(zrtpHello_11);
+        zrtpHello_12.setVersion((uint8_t*)zrtpVersion_12);
+        helloPackets[1].packet = &zrtpHello_12;
+        helloPackets[1].version = zrtpHello_12.getVersionInt();
+        computeHelloHmac(&helloPackets[1]);
+    });
+}
+
 void ZRtp::storeMsgTemp(ZrtpPacketBase* pkt) {
     uint32_t length = pkt->getLength() * ZRTP_WORD_SIZE;
-    length = (length > sizeof(tempMsgBuffer)) ? sizeof(tempMsgBuffer) : length;
-    memset(tempMsgBuffer, 0, sizeof(tempMsgBuffer));
-    memcpy(tempMsgBuffer, (uint8_t*)pkt->getHeaderBase(), length);
-    lengthOfMsgData = length;
+    length = (length > sizeof(hs->tempMsgBuffer)) ? sizeof(hs->tempMsgBuffer) : length;
+    memcpy(hs->tempMsgBuffer, (uint8_t*)pkt->getHeaderBase(), length);
+    hs->lengthOfMsgData = length;
+}
+
+void ZRtp::releaseHandshake() {
+    if (msgShaContext != nullptr) {
+        closeHashCtx(msgShaContext, nullptr);
+        msgShaContext = nullptr;
+    }
+    hs.reset();
+}
+
+void ZRtp::resetHandshakeTimes() {
+    startTime = std::chrono::steady_clock::now();
+    for (int32_t i = 0; i < NumberOfPhases; i++)
+        detailInfo.phaseTime[i] = -1;
+    detailInfo.phaseSent = 0;
+    for (int32_t i = 0; i < NumberOfCpuTimes; i++)
+        detailInfo.cpuTime[i] = 0;
+}
+
+void ZRtp::recordPhase(int32_t phase, bool sent) {
+    if (phase < 0 || phase >= NumberOfPhases || detailInfo.phaseTime[phase] >= 0)
+        return;
+    detailInfo.phaseTime[phase] =
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+    if (sent)
+        detailInfo.phaseSent |= 1U << phase;
+}
+
+void ZRtp::recordMessagePhase(int32_t msgType, bool sent) {
+    if (msgType >= TypeHello && msgType <= TypeConf2Ack)
+        recordPhase(PhaseHello + (msgType - TypeHello), sent);
 }
 
 bool ZRtp::checkMsgHmac(uint8_t* key) {
     uint8_t hmac[IMPL_MAX_DIGEST_LENGTH];
     uint32_t macLen;
-    uint32_t len = lengthOfMsgData-(HMAC_SIZE);  // compute HMAC, but exclude the stored HMAC :-)
+    uint32_t len = hs->lengthOfMsgData-(HMAC_SIZE);  // compute HMAC, but exclude the stored HMAC :-)
 
     // Use the implicit hash function
-    hmacFunctionImpl(key, HASH_IMAGE_SIZE, tempMsgBuffer, len, hmac, &macLen);
-    return memcmp(hmac, tempMsgBuffer + len, (HMAC_SIZE)) == 0;
+    hmacFunctionImpl(key, HASH_IMAGE_SIZE, hs->tempMsgBuffer, len, hmac, &macLen);
+    return memcmp(hmac, hs->tempMsgBuffer + len, (HMAC_SIZE)) == 0;
 }
 
 std::string ZRtp::getHelloHash(int32_t index) {
@@ -2659,6 +3836,7 @@ std::string ZRtp::getHelloHash(int32_t index) {
     if (index < 0 || index >= MAX_ZRTP_VERSIONS)
         return std::string();
 
+    prepareHello(index);
     uint8_t* hp = helloPackets[index].helloHash;
 
     char version[5] = {'\0'};
@@ -2738,6 +3916,115 @@ void ZRtp::setMultiStrParams(std::string parameters, ZRtp *zrtpMaster) {
         masterStream = zrtpMaster;
 }
 
+/*
+ * The secure state: version, flags, the ordinals of hash, cipher, auth length,
+ * public key and SAS type, the peer's ZID and Hello version, the ZRTP session
+ * key, the SAS hash, then the SAS and the peer's client id, each with a length
+ * byte.
+ */
+static const uint8_t secureStateVersion = 1;
+static const int32_t secureStateFixed = 1 + 1 + 5 + IDENTIFIER_LEN + ZRTP_WORD_SIZE;
+
+std::string ZRtp::getSecureState() {
+
+    std::string str;
+
+    if (!inState(SecureState))
+        return str;
+
+    uint8_t flags = (multiStream ? 1 : 0) | (mitmSeen ? 2 : 0) | (myRole == Responder ? 4 : 0);
+    AlgorithmEnum* algos[] = {hash, cipher, authLength, pubKey, sasType};
+    EnumBase* enums[] = {&zrtpHashes, &zrtpSymCiphers, &zrtpAuthLengths, &zrtpPubKeys, &zrtpSasTypes};
+
+    str.push_back(static_cast<char>(secureStateVersion));
+    str.push_back(static_cast<char>(flags));
+    for (int32_t i = 0; i < 5; i++)
+        str.push_back(static_cast<char>(algos[i] != nullptr ? enums[i]->getOrdinal(*algos[i]) : -1));
+    str.append(reinterpret_cast<char*>(peerZid), IDENTIFIER_LEN);
+    str.append(reinterpret_cast<char*>(peerHelloVersion), ZRTP_WORD_SIZE);
+    str.append(reinterpret_cast<char*>(zrtpSession), hashLength);
+    str.append(reinterpret_cast<char*>(sasHash), SHA256_DIGEST_LENGTH);
+    str.push_back(static_cast<char>(SAS.size() & 0xff));
+    str.append(SAS, 0, SAS.size() & 0xff);
+    str.push_back(static_cast<char>(peerClientId.size() & 0xff));
+    str.append(peerClientId, 0, peerClientId.size() & 0xff);
+    return str;
+}
+
+bool ZRtp::setSecureState(const std::string& state) {
+
+    if (stateEngine == nullptr || !stateEngine->inState(Initial))
+        return false;
+    if (state.size() < (size_t)secureStateFixed || (uint8_t)state[0] != secureStateVersion)
+        return false;
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(state.data());
+    const uint8_t* end = p + state.size();
+    uint8_t flags = p[1];
+    EnumBase* enums[] = {&zrtpHashes, &zrtpSymCiphers, &zrtpAuthLengths, &zrtpPubKeys, &zrtpSasTypes};
+    AlgorithmEnum* algos[5];
+
+    for (int32_t i = 0; i < 5; i++) {
+        algos[i] = &enums[i]->getByOrdinal((int8_t)p[2 + i]);
+        // A multi-stream engine does not negotiate the public key and the SAS type
+        if (!algos[i]->isValid() && (i < 3 || (flags & 1) == 0))
+            return false;
+    }
+    p += 7;
+
+    // The hash algorithm defines the length of the session key
+    setNegotiatedHash(algos[0]);
+    if (end - p < (ptrdiff_t)(IDENTIFIER_LEN + ZRTP_WORD_SIZE + hashLength + SHA256_DIGEST_LENGTH + 1))
+        return false;
+
+    const uint8_t* zid = p;
+    const uint8_t* version = p + IDENTIFIER_LEN;
+    const uint8_t* session = version + ZRTP_WORD_SIZE;
+    const uint8_t* sas = session + hashLength;
+    p = sas + SHA256_DIGEST_LENGTH;
+
+    size_t sasLength = *p++;
+    if ((size_t)(end - p) < sasLength + 1)
+        return false;
+    std::string sasString(reinterpret_cast<const char*>(p), sasLength);
+    p += sasLength;
+    size_t clientLength = *p++;
+    if ((size_t)(end - p) < clientLength)
+        return false;
+
+    memcpy(peerZid, zid, IDENTIFIER_LEN);
+    readZidRecord();
+    if (zidRec == nullptr)
+        return false;
+
+    hash = algos[0];
+    cipher = algos[1];
+    authLength = algos[2];
+    pubKey = algos[3]->isValid() ? algos[3] : nullptr;
+    sasType = algos[4]->isValid() ? algos[4] : nullptr;
+    multiStream = (flags & 1) != 0;
+    mitmSeen = (flags & 2) != 0;
+    myRole = (flags & 4) != 0 ? Responder : Initiator;
+    stateEngine->setMultiStream(multiStream);
+
+    memcpy(peerHelloVersion, version, ZRTP_WORD_SIZE);
+    peerHelloVersion[ZRTP_WORD_SIZE] = 0;
+    memcpy(zrtpSession, session, hashLength);
+    memcpy(sasHash, sas, SHA256_DIGEST_LENGTH);
+    SAS = sasString;
+    peerClientId.assign(reinterpret_cast<const char*>(p), clientLength);
+
+    detailInfo.pubKey = (!multiStream && pubKey != nullptr) ? pubKey->getReadable() : nullptr;
+    detailInfo.sasType = (!multiStream && sasType != nullptr) ? sasType->getReadable() : nullptr;
+    detailInfo.authLength = authLength->getReadable();
+    detailInfo.cipher = cipher->getReadable();
+    detailInfo.hash = hash->getReadable();
+
+    stateEngine->nextState(SecureState);
+    reportSecretsOn();
+    return true;
+}
+
 bool ZRtp::isMultiStream() {
     return multiStream;
 }
@@ -2751,12 +4038,12 @@ void ZRtp::acceptEnrollment(bool accepted) {
     if (!accepted) {
         zidRec->resetMITMKeyAvailable();
         callback->zrtpInformEnrollment(EnrollmentCanceled);
-        getZidCacheInstance()->saveRecord(zidRec);
+        saveZidRec();
         return;
     }
     if (pbxSecretTmp != nullptr) {
         zidRec->setMiTMData(pbxSecretTmp);
-        getZidCacheInstance()->saveRecord(zidRec);
+        saveZidRec();
         callback->zrtpInformEnrollment(EnrollmentOk);
     }
     else {
@@ -2768,10 +4055,10 @@ void ZRtp::acceptEnrollment(bool accepted) {
 }
 
 bool ZRtp::setSignatureData(uint8_t* data, uint32_t length) {
-    if ((length % 4) != 0)
+    if ((length % 4) != 0 || !hs)
         return false;
 
-    ZrtpPacketConfirm* cfrm = (myRole == Responder) ? &zrtpConfirm1 : &zrtpConfirm2;
+    ZrtpPacketConfirm* cfrm = (myRole == Responder) ? &hs->zrtpConfirm1 : &hs->zrtpConfirm2;
     cfrm->setSignatureLength(length / 4);
     return cfrm->setSignatureData(data, length);
 }
@@ -2780,6 +4067,15 @@ const uint8_t* ZRtp::getSignatureData() {
     return signatureData;
 }
 
+const uint8_t* ZRtp::keepPeerSignature(const uint8_t* data) {
+    if (!asyncSasSignature)
+        return data;
+
+    // The application checks the signature after checkSASSignature returned
+    peerSignature.assign(data, data + signatureLength * ZRTP_WORD_SIZE);
+    return peerSignature.data();
+}
+
 int32_t ZRtp::getSignatureLength() {
     return signatureLength * ZRTP_WORD_SIZE;
 }
@@ -2797,11 +4093,15 @@ void ZRtp::conf2AckSecure() {
 }
 
 int32_t ZRtp::compareCommit(ZrtpPacketCommit *commit) {
-    // TODO: enhance to compare according to rules defined in chapter 4.2,
-    // but we don't support Preshared.
+    // A DH Commit wins over a Preshared Commit, otherwise compare the hvi or
+    // the nonces, refer to chapter 4.2.
+    bool peerPreshared = isPresharedCommit(commit);
+    if (presharedMode != peerPreshared) {
+        return presharedMode ? -1 : 1;
+    }
     uint32_t len = 0;
-    len = !multiStream ? HVI_SIZE : (4 * ZRTP_WORD_SIZE);
-    return (memcmp(hvi, commit->getHvi(), len));
+    len = (!multiStream && !presharedMode) ? HVI_SIZE : (4 * ZRTP_WORD_SIZE);
+    return (memcmp(hs->hvi, commit->getHvi(), len));
 }
 
 bool ZRtp::isEnrollmentMode() {
@@ -2886,6 +4186,24 @@ std::string ZRtp::getPeerProtcolVersion() {
     return std::string((char*)peerHelloVersion);
 }
 
+void ZRtp::addMemoryUsage(MemoryUsage& usage) {
+    size_t bytes = sizeof(ZRtp) + sizeof(ZrtpStateClass) + auxSecretLength;
+
+    if (peerNonces)
+        bytes += sizeof(NonceSet);
+    if (DHss != nullptr && dhContext != nullptr)
+        bytes += dhContext->getDhSize();
+    usage.add(MemoryUsage::Engine, bytes);
+
+    if (hs)
+        usage.add(MemoryUsage::Handshake, sizeof(Handshake));
+    if (dhContext != nullptr)
+        dhContext->addMemoryUsage(usage);
+    // A record in place is part of the ZRtp object
+    if (zidRec != nullptr && !zidRecStorage.isInPlace())
+        usage.add(MemoryUsage::Cache, zidRec->getMemorySize());
+}
+
 void ZRtp::setT1Resend(int32_t counter) {
     if (counter < 0 || counter > 10)
         stateEngine->setT1Resend(counter);
@@ -2920,6 +4238,18 @@ int ZRtp::getCountersZrtp(int32_t* counters) {
 }
 
 uint8_t* ZRtp::getExportedKey(int32_t *length) {
+    std::lock_guard<std::mutex> guard(exportLock);
+
+    if (exportPending) {
+        uint8_t KDFcontext[sizeof(peerZid)+sizeof(ownZid)+sizeof(messageHash)];
+        size_t kdfSize = setupKdfContext(KDFcontext);
+
+        KDF(exportSecret, hashLength, (unsigned char*)zrtpExportedKey, strlen(zrtpExportedKey)+1, KDFcontext,
+            kdfSize, hashLength*8, zrtpExport);
+        memset_volatile(exportSecret, 0, MAX_DIGEST_LENGTH);
+        memset(KDFcontext, 0, sizeof(KDFcontext));
+        exportPending = false;
+    }
     if (length != nullptr)
         *length = hashLength;
     return zrtpExport;
@@ -2931,16 +4261,10 @@ bool ZRtp::checkAndSetNonce(uint8_t* nonce) {
     if (masterStream == nullptr)
         return true;
 
-    for (const auto& usedNonce : masterStream->peerNonces) {
-        if (memcmp(usedNonce.data(), nonce, ZRTP_WORD_SIZE * 4) == 0) {
-            return false;
-        }
-    }
-    // the string holds the binary nonce
-    std::string str;
-    str.assign((char *)nonce, ZRTP_WORD_SIZE * 4);
-    masterStream->peerNonces.push_back(str);
-    return true;
+    std::lock_guard<std::mutex> guard(masterStream->nonceLock);
+    if (!masterStream->peerNonces)
+        masterStream->peerNonces.reset(new NonceSet());
+    return masterStream->peerNonces->insert(nonce);
 }
 
 /** EMACS **
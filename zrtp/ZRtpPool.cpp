@@ -0,0 +1,228 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <libzrtpcpp/ZRtpPool.h>
+#include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZrtpCallback.h>
+#include <libzrtpcpp/ZrtpConfigure.h>
+
+using namespace GnuZrtpCodes;
+
+/*
+ * Callback of the pooled engines. The engines do not run the protocol while they
+ * are in the pool, only the destructor of an unused engine uses the callback.
+ */
+class IdleCallback : public ZrtpCallback {
+protected:
+    int32_t sendDataZRTP(const uint8_t*, int32_t) { return 0; }
+    int32_t activateTimer(int32_t) { return 0; }
+    int32_t cancelTimer() { return 0; }
+    void sendInfo(MessageSeverity, int32_t) {}
+    bool srtpSecretsReady(SrtpSecret_t*, EnableSecurity) { return false; }
+    void srtpSecretsOff(EnableSecurity) {}
+    void srtpSecretsOn(std::string, std::string, bool) {}
+    void handleGoClear() {}
+    void zrtpNegotiationFailed(MessageSeverity, int32_t) {}
+    void zrtpNotSuppOther() {}
+    void synchEnter() {}
+    void synchLeave() {}
+    void zrtpAskEnrollment(InfoEnrollment) {}
+    void zrtpInformEnrollment(InfoEnrollment) {}
+    void signSAS(uint8_t*) {}
+    bool checkSASSignature(uint8_t*) { return false; }
+};
+
+static IdleCallback idleCallback;
+
+static bool sameConfiguration(ZrtpConfigure& a, ZrtpConfigure& b)
+{
+    return a.getFingerprint() == b.getFingerprint() &&
+           a.isTrustedMitM() == b.isTrustedMitM() &&
+           a.isSasSignature() == b.isSasSignature() &&
+           a.isParanoidMode() == b.isParanoidMode() &&
+           a.isDisclosureFlag() == b.isDisclosureFlag() &&
+           a.isAsyncKeyAgreement() == b.isAsyncKeyAgreement() &&
+           a.isAsyncSasSignature() == b.isAsyncSasSignature() &&
+           a.isAsyncZidCache() == b.isAsyncZidCache() &&
+           a.getSelectionPolicy() == b.getSelectionPolicy() &&
+           a.getMinimumSecurity() == b.getMinimumSecurity();
+}
+
+/*
+ * The pool data and the worker thread. The destructor stops the worker thread if
+ * the application did not disable the pool before it terminates.
+ */
+class EnginePool {
+public:
+    EnginePool(): poolSize(0), running(false), mitmMode(false) { memset(zid, 0, sizeof(zid)); }
+
+    ~EnginePool() { setSize(0, nullptr, std::string(), nullptr, false); }
+
+    void setSize(int32_t size, const uint8_t* myZid, const std::string& id, ZrtpConfigure* config, bool mitm);
+
+    ZRtp* get(const uint8_t* myZid, const std::string& id, ZrtpConfigure* config, bool mitm);
+
+    int32_t available();
+
+private:
+    void run();
+
+    void clear();
+
+    bool sameParameters(const uint8_t* myZid, const std::string& id, ZrtpConfigure* config, bool mitm);
+
+    std::mutex lock;
+    std::condition_variable refill;
+    std::thread worker;
+    std::deque<ZRtp*> engines;
+    int32_t poolSize;
+    bool running;
+
+    // Parameters of the pooled engines
+    uint8_t zid[IDENTIFIER_LEN];
+    std::string clientId;
+    ZrtpConfigure configure;
+    bool mitmMode;
+};
+
+bool EnginePool::sameParameters(const uint8_t* myZid, const std::string& id, ZrtpConfigure* config, bool mitm)
+{
+    return memcmp(zid, myZid, IDENTIFIER_LEN) == 0 && clientId == id && mitmMode == mitm &&
+           sameConfiguration(configure, *config);
+}
+
+void EnginePool::setSize(int32_t size, const uint8_t* myZid, const std::string& id, ZrtpConfigure* config, bool mitm)
+{
+    std::thread stopped;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        // A traced engine must see its own construction, thus a traced configuration is not pooled
+        poolSize = (size < 0 || myZid == nullptr || config == nullptr || config->getTrace() != nullptr) ? 0 : size;
+        if (poolSize == 0 || !sameParameters(myZid, id, config, mitm))
+            clear();
+        if (poolSize > 0) {
+            memcpy(zid, myZid, IDENTIFIER_LEN);
+            clientId = id;
+            configure = *config;
+            configure.freeze();         // the pooled engines share the algorithms
+            mitmMode = mitm;
+        }
+        while (engines.size() > (size_t)poolSize) {
+            delete engines.back();
+            engines.pop_back();
+        }
+        if (poolSize > 0 && !running) {
+            running = true;
+            worker = std::thread(&EnginePool::run, this);
+        }
+        else if (poolSize == 0 && running) {
+            running = false;
+            stopped.swap(worker);
+        }
+        refill.notify_one();
+    }
+    // Join outside of the lock, the worker thread needs the lock to terminate
+    if (stopped.joinable())
+        stopped.join();
+}
+
+void EnginePool::clear()
+{
+    for (ZRtp* engine : engines)
+        delete engine;
+    engines.clear();
+}
+
+ZRtp* EnginePool::get(const uint8_t* myZid, const std::string& id, ZrtpConfigure* config, bool mitm)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (engines.empty() || config->getTrace() != nullptr || !sameParameters(myZid, id, config, mitm))
+        return nullptr;
+
+    ZRtp* engine = engines.front();
+    engines.pop_front();
+    refill.notify_one();
+    return engine;
+}
+
+int32_t EnginePool::available()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return (int32_t)engines.size();
+}
+
+void EnginePool::run()
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    while (running) {
+        if (engines.size() >= (size_t)poolSize) {
+            refill.wait(guard);
+            continue;
+        }
+        // Construct the engine without holding the lock, use a copy of the parameters
+        uint8_t myZid[IDENTIFIER_LEN];
+        memcpy(myZid, zid, IDENTIFIER_LEN);
+        std::string id(clientId);
+        ZrtpConfigure config(configure);
+        bool mitm = mitmMode;
+
+        guard.unlock();
+        ZRtp* engine = new ZRtp(myZid, &idleCallback, id, &config, mitm);
+        guard.lock();
+
+        // Drop the engine if the application changed the parameters meanwhile
+        if (running && engines.size() < (size_t)poolSize && sameParameters(myZid, id, &config, mitm))
+            engines.push_back(engine);
+        else
+            delete engine;
+    }
+}
+
+static EnginePool pool;
+
+void ZRtpPool::setPoolSize(int32_t engines, const uint8_t* myZid, const std::string& id, ZrtpConfigure* config, bool mitm)
+{
+    pool.setSize(engines, myZid, id, config, mitm);
+}
+
+ZRtp* ZRtpPool::getEngine(uint8_t* myZid, ZrtpCallback* cb, const std::string& id, ZrtpConfigure* config,
+                          bool mitm, bool sasSignSupport)
+{
+    ZRtp* engine = pool.get(myZid, id, config, mitm);
+    if (engine == nullptr)
+        return new ZRtp(myZid, cb, id, config, mitm, sasSignSupport);
+
+    engine->callback = cb;
+    return engine;
+}
+
+int32_t ZRtpPool::getAvailable()
+{
+    return pool.available();
+}
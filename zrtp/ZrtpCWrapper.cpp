@@ -21,15 +21,32 @@
 #include <libzrtpcpp/ZrtpCallbackWrapper.h>
 #include <libzrtpcpp/ZrtpCWrapper.h>
 #include <libzrtpcpp/ZrtpCrc32.h>
+#include <common/TimeoutWheel.h>
 
 static int32_t zrtp_initZidFile(const char* zidFilename);
 
+struct zrtpTimer
+{
+    explicit zrtpTimer(ZrtpContext* zrtpContext): zrtpContext(zrtpContext), entry(this, ZrtpTimeoutCommand) {}
+
+    void handleTimeout(int32_t) { zrtp_processTimeout(zrtpContext); }
+
+    ZrtpContext* zrtpContext;
+    TimeoutEntry<int32_t, zrtpTimer*> entry;
+};
+
+struct zrtpTimers
+{
+    TimeoutWheel<int32_t, zrtpTimer*> wheel;
+};
+
 ZrtpContext* zrtp_CreateWrapper() 
 {
     ZrtpContext* zc = new ZrtpContext;
     zc->configure = 0;
     zc->zrtpEngine = 0;
     zc->zrtpCallback = 0;
+    zc->timer = 0;
 
     return zc;
 }
@@ -63,6 +80,10 @@ void zrtp_DestroyWrapper(ZrtpContext* zrtpContext) {
     if (zrtpContext == NULL)
         return;
 
+    // Cancels a pending timeout
+    delete zrtpContext->timer;
+    zrtpContext->timer = NULL;
+
     delete zrtpContext->zrtpEngine;
     zrtpContext->zrtpEngine = NULL;
 
@@ -126,11 +147,57 @@ void zrtp_processZrtpMessage(ZrtpContext* zrtpContext, uint8_t *extHeader, uint3
         zrtpContext->zrtpEngine->processZrtpMessage(extHeader, peerSSRC, length);
 }
 
+int32_t zrtp_processZrtpMessages(ZrtpContext* zrtpContext, uint8_t* const extHeaders[], const size_t lengths[],
+                                 int32_t count, uint32_t peerSSRC) {
+    if (zrtpContext && zrtpContext->zrtpEngine)
+        return zrtpContext->zrtpEngine->processZrtpMessages(extHeaders, lengths, count, peerSSRC);
+    return 0;
+}
+
 void zrtp_processTimeout(ZrtpContext* zrtpContext) {
     if (zrtpContext && zrtpContext->zrtpEngine)
         zrtpContext->zrtpEngine->processTimeout();
 }
 
+ZrtpTimers* zrtp_newTimers() {
+    return new ZrtpTimers;
+}
+
+void zrtp_freeTimers(ZrtpTimers* timers) {
+    delete timers;
+}
+
+int32_t zrtp_requestTimer(ZrtpTimers* timers, ZrtpContext* zrtpContext, int32_t time) {
+    if (timers == NULL || zrtpContext == NULL)
+        return 0;
+
+    if (zrtpContext->timer == NULL)
+        zrtpContext->timer = new ZrtpTimer(zrtpContext);
+    timers->wheel.requestTimeout(time, &zrtpContext->timer->entry);
+    return 1;
+}
+
+int32_t zrtp_cancelTimerRequest(ZrtpTimers* timers, ZrtpContext* zrtpContext) {
+    if (timers == NULL || zrtpContext == NULL)
+        return 0;
+
+    if (zrtpContext->timer != NULL)
+        timers->wheel.cancelRequest(&zrtpContext->timer->entry);
+    return 1;
+}
+
+int32_t zrtp_nextTimeout(ZrtpTimers* timers) {
+    if (timers == NULL)
+        return -1;
+    return timers->wheel.nextTimeoutMs();
+}
+
+int32_t zrtp_runTimers(ZrtpTimers* timers) {
+    if (timers == NULL)
+        return 0;
+    return timers->wheel.runExpired();
+}
+
 //int32_t zrtp_handleGoClear(ZrtpContext* zrtpContext, uint8_t *extHeader)
 //{
 //    if (zrtpContext && zrtpContext->zrtpEngine)
@@ -297,6 +364,13 @@ int32_t zrtp_setSignatureData(ZrtpContext* zrtpContext, uint8_t* data, uint32_t
     return 0;
 }
 
+int32_t zrtp_sasSignatureReady(ZrtpContext* zrtpContext, const uint8_t* data, uint32_t length) {
+    if (zrtpContext && zrtpContext->zrtpEngine)
+        return zrtpContext->zrtpEngine->sasSignatureReady(data, length) ? 1 : 0;
+
+    return 0;
+}
+
 const uint8_t* zrtp_getSignatureData(ZrtpContext* zrtpContext) {
     if (zrtpContext && zrtpContext->zrtpEngine)
         return zrtpContext->zrtpEngine->getSignatureData();
@@ -505,3 +579,16 @@ int32_t zrtp_isSasSignature(ZrtpContext* zrtpContext)
         return zrtpContext->configure->isSasSignature() ? 1 : 0;
     return 0;       /* standard setting: sasSignature is false, thus if zrtp not initialized it's always false */
 }
+
+void zrtp_setAsyncSasSignature(ZrtpContext* zrtpContext, int32_t yesNo)
+{
+    if (zrtpContext && zrtpContext->configure)
+        zrtpContext->configure->setAsyncSasSignature(yesNo ? true : false);
+}
+
+int32_t zrtp_isAsyncSasSignature(ZrtpContext* zrtpContext)
+{
+    if (zrtpContext && zrtpContext->configure)
+        return zrtpContext->configure->isAsyncSasSignature() ? 1 : 0;
+    return 0;
+}
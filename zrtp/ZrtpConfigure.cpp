@@ -19,27 +19,46 @@
  */
 
 #include <crypto/aesCFB.h>
+#ifndef ZRTP_MINIMAL_ALGORITHMS
 #include <crypto/twoCFB.h>
+#include <crypto/chachaStream.h>
+#endif
 #include <libzrtpcpp/ZrtpConfigure.h>
 #include <libzrtpcpp/ZrtpTextData.h>
+#include <common/cpuFeatures.h>
+
+#include <atomic>
+
+/*
+ * Get the first 4 characters of an algorithm name as 32 bit word, the first character
+ * is the most significant byte. Pad shorter names with zero bytes, two names have the
+ * same word if strncmp(a, b, 4) would return 0.
+ */
+static uint32_t nameToTag(const char* name) {
+    uint32_t word = 0;
+    int i = 0;
+
+    for (; i < 4 && name[i] != '\0'; i++)
+        word = (word << 8) | static_cast<uint8_t>(name[i]);
+    for (; i < 4; i++)
+        word <<= 8;
+    return word;
+}
 
 AlgorithmEnum::AlgorithmEnum(const AlgoTypes type, const char* name, 
                              uint32_t klen, const char* ra, encrypt_t en,
                              decrypt_t de, SrtpAlgorithms alId):
-    algoType(type) , algoName(name), keyLen(klen), readable(ra), encrypt(en),
+    ordinal(-1), algoType(type), tag(nameToTag(name)), algoName(), keyLen(klen), readable(ra), encrypt(en),
     decrypt(de), algoId(alId) {
-}
-
-AlgorithmEnum::~AlgorithmEnum()
-{
+    strncpy(algoName, name, sizeof(algoName) - 1);
 }
 
 const char* AlgorithmEnum::getName() {
-    return algoName.c_str(); 
+    return algoName; 
 }
 
 const char* AlgorithmEnum::getReadable() {
-    return readable.c_str();
+    return readable;
 }
     
 uint32_t AlgorithmEnum::getKeylen() {
@@ -66,41 +85,94 @@ bool AlgorithmEnum::isValid() {
     return (algoType != Invalid); 
 }
 
-static AlgorithmEnum invalidAlgo(Invalid, "", 0, "", NULL, NULL, None);
-
+/*
+ * The constant tables of the implemented algorithms, the names are the names
+ * in ZrtpTextData. The AlgorithmEnum functions don't modify the objects, thus
+ * the enumerations may return references to the constant objects.
+ *
+ * The minimal algorithm profile (ZRTP_MINIMAL_ALGORITHMS) builds E255, AES,
+ * HMAC-SHA1 and SHA-256 only. Its tables omit the other algorithms, thus
+ * getByName() returns the invalid algorithm for them and the engine never
+ * offers or accepts them.
+ */
+static constexpr AlgorithmEnum invalidAlgoConst(-1, Invalid, "\0\0\0\0", 0, "", NULL, NULL, None);
+static AlgorithmEnum& invalidAlgo = const_cast<AlgorithmEnum&>(invalidAlgoConst);
 
-EnumBase::EnumBase(AlgoTypes a) : algoType(a) {
-}
+/**
+ * The enumeration list for available hash algorithms
+ */
+static constexpr AlgorithmEnum hashAlgos[] = {
+    AlgorithmEnum(0, HashAlgorithm, "S256", 0, "SHA-256", NULL, NULL, None),
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+    AlgorithmEnum(1, HashAlgorithm, "S384", 0, "SHA-384", NULL, NULL, None),
+    AlgorithmEnum(2, HashAlgorithm, "SKN2", 0, "Skein-256", NULL, NULL, None),
+    AlgorithmEnum(3, HashAlgorithm, "SKN3", 0, "Skein-384", NULL, NULL, None)
+#endif
+};
 
+/**
+ * The enumeration list for available symmetric cipher algorithms
+ */
+static constexpr AlgorithmEnum symCipherAlgos[] = {
+    AlgorithmEnum(0, CipherAlgorithm, "AES3", 32, "AES-256", aesCfbEncrypt, aesCfbDecrypt, Aes),
+    AlgorithmEnum(1, CipherAlgorithm, "AES1", 16, "AES-128", aesCfbEncrypt, aesCfbDecrypt, Aes),
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+    AlgorithmEnum(2, CipherAlgorithm, "2FS3", 32, "Twofish-256", twoCfbEncrypt, twoCfbDecrypt, TwoFish),
+    AlgorithmEnum(3, CipherAlgorithm, "2FS1", 16, "TwoFish-128", twoCfbEncrypt, twoCfbDecrypt, TwoFish),
+    AlgorithmEnum(4, CipherAlgorithm, "CC20", 32, "ChaCha20", chachaEncrypt, chachaDecrypt, ChaCha20)
+#endif
+};
 
-EnumBase::~EnumBase() {
-    std::vector<AlgorithmEnum* >::iterator b = algos.begin();
-    std::vector<AlgorithmEnum* >::iterator e = algos.end();
+/**
+ * The enumeration list for available public key algorithms
+ */
+static constexpr AlgorithmEnum pubKeyAlgos[] = {
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+    AlgorithmEnum(0, PubKeyAlgorithm, "DH2k", 0, "DH-2048", NULL, NULL, None),
+    AlgorithmEnum(1, PubKeyAlgorithm, "EC25", 0, "NIST ECDH-256", NULL, NULL, None),
+    AlgorithmEnum(2, PubKeyAlgorithm, "DH3k", 0, "DH-3072", NULL, NULL, None),
+    AlgorithmEnum(3, PubKeyAlgorithm, "EC38", 0, "NIST ECDH-384", NULL, NULL, None),
+    AlgorithmEnum(4, PubKeyAlgorithm, "Mult", 0, "Multi-stream",  NULL, NULL, None),
+    AlgorithmEnum(5, PubKeyAlgorithm, "Prsh", 0, "Preshared",  NULL, NULL, None),
+#ifdef SUPPORT_NON_NIST
+    AlgorithmEnum(6, PubKeyAlgorithm, "E255", 0, "ECDH-255", NULL, NULL, None),
+    AlgorithmEnum(7, PubKeyAlgorithm, "E414", 0, "ECDH-414", NULL, NULL, None)
+#endif
+#else
+    AlgorithmEnum(0, PubKeyAlgorithm, "E255", 0, "ECDH-255", NULL, NULL, None),
+    AlgorithmEnum(1, PubKeyAlgorithm, "Mult", 0, "Multi-stream",  NULL, NULL, None),
+    AlgorithmEnum(2, PubKeyAlgorithm, "Prsh", 0, "Preshared",  NULL, NULL, None)
+#endif
+};
 
-    for (; b != e; b++) {
-        if (*b) {
-            delete *b;
-        }
-    }
-}
+/**
+ * The enumeration list for available SAS algorithms
+ */
+static constexpr AlgorithmEnum sasTypeAlgos[] = {
+    AlgorithmEnum(0, SasType, "B32 ", 0, "", NULL, NULL, None),
+    AlgorithmEnum(1, SasType, "B256", 0, "", NULL, NULL, None),
+    AlgorithmEnum(2, SasType, "B32E", 0, "", NULL, NULL, None),
+    AlgorithmEnum(3, SasType, "B10D", 0, "", NULL, NULL, None)
+};
 
-void EnumBase::insert(const char* name) {
-    if (!name)
-        return;
-    AlgorithmEnum* e = new AlgorithmEnum(algoType, name, 0, "", NULL, NULL, None);
-    algos.push_back(e);
-}
+/**
+ * The enumeration list for available SRTP authentications
+ */
+static constexpr AlgorithmEnum authLengthAlgos[] = {
+    AlgorithmEnum(0, AuthLength, "HS32", 32, "HMAC-SHA1 32 bit", NULL, NULL, Sha1),
+    AlgorithmEnum(1, AuthLength, "HS80", 80, "HMAC-SHA1 80 bit", NULL, NULL, Sha1),
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+    AlgorithmEnum(2, AuthLength, "SK32", 32, "Skein-MAC 32 bit", NULL, NULL, Skein),
+    AlgorithmEnum(3, AuthLength, "SK64", 64, "Skein-MAC 64 bit", NULL, NULL, Skein),
+    AlgorithmEnum(4, AuthLength, "GC16", 128, "AES-GCM 128 bit tag", NULL, NULL, AesGcm),
+    AlgorithmEnum(5, AuthLength, "CP16", 128, "ChaCha20-Poly1305 128 bit tag", NULL, NULL, ChaCha20Poly1305)
+#endif
+};
 
-void EnumBase::insert(const char* name, uint32_t klen, const char* ra,
-                      encrypt_t enc, decrypt_t dec, SrtpAlgorithms alId) {
-    if (!name)
-        return;
-    AlgorithmEnum* e = new AlgorithmEnum(algoType, name, klen, ra, enc, dec, alId);
-    algos.push_back(e);
-}
+#define TABLE_SIZE(table) static_cast<int32_t>(sizeof(table) / sizeof(table[0]))
 
 size_t EnumBase::getSize() {
-    return algos.size(); 
+    return static_cast<size_t>(numAlgos);
 }
 
 AlgoTypes EnumBase::getAlgoType() {
@@ -108,124 +180,61 @@ AlgoTypes EnumBase::getAlgoType() {
 }
 
 AlgorithmEnum& EnumBase::getByName(const char* name) {
-    std::vector<AlgorithmEnum* >::iterator b = algos.begin();
-    std::vector<AlgorithmEnum* >::iterator e = algos.end();
-
-    for (; b != e; b++) {
-        if (strncmp((*b)->getName(), name, 4) == 0) {
-            return *(*b);
-        }
-    }
-    return invalidAlgo;
+    return getByOrdinal(getOrdinal(reinterpret_cast<const uint8_t*>(name)));
 }
 
 AlgorithmEnum& EnumBase::getByOrdinal(int ord) {
-    std::vector<AlgorithmEnum* >::iterator b = algos.begin();
-    std::vector<AlgorithmEnum* >::iterator e = algos.end();
-
-    for (int i = 0; b != e; ++b) {
-        if (i == ord) {
-            return *(*b);
-        }
-        i++;
-    }
-    return invalidAlgo;
+    if (ord < 0 || ord >= numAlgos)
+        return invalidAlgo;
+    return const_cast<AlgorithmEnum&>(algos[ord]);
 }
 
 int EnumBase::getOrdinal(AlgorithmEnum& algo) {
-    std::vector<AlgorithmEnum* >::iterator b = algos.begin();
-    std::vector<AlgorithmEnum* >::iterator e = algos.end();
+    return getOrdinal(reinterpret_cast<const uint8_t*>(algo.getName()));
+}
 
-    for (int i = 0; b != e; ++b) {
-        if (strncmp((*b)->getName(), algo.getName(), 4) == 0) {
+int EnumBase::getOrdinal(const uint8_t* name) {
+    uint32_t tag = nameToTag(reinterpret_cast<const char*>(name));
+
+    for (int32_t i = 0; i < numAlgos; i++) {
+        if (algos[i].tag == tag)
             return i;
-        }
-        i++;
     }
     return -1;
 }
 
 std::list<std::string>* EnumBase::getAllNames() {
-    std::vector<AlgorithmEnum* >::iterator b = algos.begin();
-    std::vector<AlgorithmEnum* >::iterator e = algos.end();
-
     std::list<std::string>* strg = new std::list<std::string>();
 
-    for (; b != e; b++) {
-        std::string s((*b)->getName());
-        strg->push_back(s);
+    for (int32_t i = 0; i < numAlgos; i++) {
+        strg->push_back(std::string(algos[i].algoName));
     }
     return strg;
 }
 
-
-/**
- * Set up the enumeration list for available hash algorithms
- */
-HashEnum::HashEnum() : EnumBase(HashAlgorithm) {
-    insert(s256, 0, "SHA-256", NULL, NULL, None);
-    insert(s384, 0, "SHA-384", NULL, NULL, None);
-    insert(skn2, 0, "Skein-256", NULL, NULL, None);
-    insert(skn3, 0, "Skein-384", NULL, NULL, None);
+constexpr HashEnum::HashEnum() : EnumBase(HashAlgorithm, hashAlgos, TABLE_SIZE(hashAlgos)) {
+    static_assert(isValidTable(hashAlgos, TABLE_SIZE(hashAlgos)), "invalid hash table");
 }
 
-HashEnum::~HashEnum() {}
-
-/**
- * Set up the enumeration list for available symmetric cipher algorithms
- */
-SymCipherEnum::SymCipherEnum() : EnumBase(CipherAlgorithm) {
-    insert(aes3, 32, "AES-256", aesCfbEncrypt, aesCfbDecrypt, Aes);
-    insert(aes1, 16, "AES-128", aesCfbEncrypt, aesCfbDecrypt, Aes);
-    insert(two3, 32, "Twofish-256", twoCfbEncrypt, twoCfbDecrypt, TwoFish);
-    insert(two1, 16, "TwoFish-128", twoCfbEncrypt, twoCfbDecrypt, TwoFish);
+constexpr SymCipherEnum::SymCipherEnum() : EnumBase(CipherAlgorithm, symCipherAlgos, TABLE_SIZE(symCipherAlgos)) {
+    static_assert(isValidTable(symCipherAlgos, TABLE_SIZE(symCipherAlgos)), "invalid cipher table");
 }
 
-SymCipherEnum::~SymCipherEnum() {}
-
-/**
- * Set up the enumeration list for available public key algorithms
- */
-PubKeyEnum::PubKeyEnum() : EnumBase(PubKeyAlgorithm) {
-    insert(dh2k, 0, "DH-2048", NULL, NULL, None);
-    insert(ec25, 0, "NIST ECDH-256", NULL, NULL, None);
-    insert(dh3k, 0, "DH-3072", NULL, NULL, None);
-    insert(ec38, 0, "NIST ECDH-384", NULL, NULL, None);
-    insert(mult, 0, "Multi-stream",  NULL, NULL, None);
-#ifdef SUPPORT_NON_NIST
-    insert(e255, 0, "ECDH-255", NULL, NULL, None);
-    insert(e414, 0, "ECDH-414", NULL, NULL, None);
-#endif
+constexpr PubKeyEnum::PubKeyEnum() : EnumBase(PubKeyAlgorithm, pubKeyAlgos, TABLE_SIZE(pubKeyAlgos)) {
+    static_assert(isValidTable(pubKeyAlgos, TABLE_SIZE(pubKeyAlgos)), "invalid public key table");
 }
 
-PubKeyEnum::~PubKeyEnum() {}
-
-/**
- * Set up the enumeration list for available SAS algorithms
- */
-SasTypeEnum::SasTypeEnum() : EnumBase(SasType) {
-    insert(b32);
-    insert(b256);
-    insert(b32e);
-    insert(b10d);
+constexpr SasTypeEnum::SasTypeEnum() : EnumBase(SasType, sasTypeAlgos, TABLE_SIZE(sasTypeAlgos)) {
+    static_assert(isValidTable(sasTypeAlgos, TABLE_SIZE(sasTypeAlgos)), "invalid SAS table");
 }
 
-SasTypeEnum::~SasTypeEnum() {}
-
-/**
- * Set up the enumeration list for available SRTP authentications
- */
-AuthLengthEnum::AuthLengthEnum() : EnumBase(AuthLength) {
-    insert(hs32, 32, "HMAC-SHA1 32 bit", NULL, NULL, Sha1);
-    insert(hs80, 80, "HMAC-SHA1 80 bit", NULL, NULL, Sha1);
-    insert(sk32, 32, "Skein-MAC 32 bit", NULL, NULL, Skein);
-    insert(sk64, 64, "Skein-MAC 64 bit", NULL, NULL, Skein);
+constexpr AuthLengthEnum::AuthLengthEnum() : EnumBase(AuthLength, authLengthAlgos, TABLE_SIZE(authLengthAlgos)) {
+    static_assert(isValidTable(authLengthAlgos, TABLE_SIZE(authLengthAlgos)), "invalid authentication length table");
 }
 
-AuthLengthEnum::~AuthLengthEnum() {}
-
 /*
- * Here the global accessible enumerations for all implemented algorithms.
+ * Here the global accessible enumerations for all implemented algorithms. The
+ * constructors are constexpr, the compiler initializes the enumerations.
  */
 HashEnum zrtpHashes;
 SymCipherEnum zrtpSymCiphers;
@@ -236,14 +245,135 @@ AuthLengthEnum zrtpAuthLengths;
 /*
  * The public methods are mainly a facade to the private methods.
  */
+/*
+ * The frozen algorithms of a configuration. The arrays use the algorithm
+ * type minus one as index, the masks hold a bit for each ordinal of the
+ * configured algorithms of a type.
+ */
+class ZrtpConfigure::Profile {
+public:
+    static const int numTypes = AuthLength;
+
+    std::atomic<int32_t> refs;
+    AlgorithmEnum* algos[numTypes][maxNoOfAlgos];
+    int32_t counts[numTypes];
+    uint32_t masks[numTypes];
+    uint64_t fingerprint;
+
+    Profile(): refs(1), counts(), masks(), fingerprint(0) {}
+
+    void retain() { refs.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+};
+
+static inline int typeIndex(AlgoTypes algoType) {
+    return (algoType >= HashAlgorithm && algoType <= AuthLength) ? algoType - 1 : -1;
+}
+
 ZrtpConfigure::ZrtpConfigure(): enableTrustedMitM(false), enableSasSignature(false), enableParanoidMode(false),
-selectionPolicy(Standard){}
+enableDisclosureFlag(false), enableAsyncKeyAgreement(false), enableAsyncSasSignature(false), enableAsyncZidCache(false),
+enableSpeculativeKeyGen(false), enableFastStart(false), presharedLimit(8), timerSlack(0), trace(NULL), fingerprint(0), profile(NULL),
+selectionPolicy(Standard), minimumSecurity(128){}
+
+ZrtpConfigure::ZrtpConfigure(const ZrtpConfigure& other): profile(NULL) {
+    *this = other;
+}
+
+ZrtpConfigure& ZrtpConfigure::operator=(const ZrtpConfigure& other) {
+    if (this == &other)
+        return *this;
+
+    if (other.profile != NULL)
+        other.profile->retain();
+    if (profile != NULL)
+        profile->release();
+    profile = other.profile;
+
+    // A frozen configuration does not use the lists, don't copy them
+    if (profile == NULL) {
+        hashes = other.hashes;
+        symCiphers = other.symCiphers;
+        publicKeyAlgos = other.publicKeyAlgos;
+        sasTypes = other.sasTypes;
+        authLengths = other.authLengths;
+    }
+    else {
+        hashes.clear();
+        symCiphers.clear();
+        publicKeyAlgos.clear();
+        sasTypes.clear();
+        authLengths.clear();
+    }
+    enableTrustedMitM = other.enableTrustedMitM;
+    enableSasSignature = other.enableSasSignature;
+    enableParanoidMode = other.enableParanoidMode;
+    enableDisclosureFlag = other.enableDisclosureFlag;
+    enableAsyncKeyAgreement = other.enableAsyncKeyAgreement;
+    enableAsyncSasSignature = other.enableAsyncSasSignature;
+    enableAsyncZidCache = other.enableAsyncZidCache;
+    enableSpeculativeKeyGen = other.enableSpeculativeKeyGen;
+    enableFastStart = other.enableFastStart;
+    presharedLimit = other.presharedLimit;
+    timerSlack = other.timerSlack;
+    trace = other.trace;
+    fingerprint = other.fingerprint;
+    selectionPolicy = other.selectionPolicy;
+    minimumSecurity = other.minimumSecurity;
+
+    return *this;
+}
+
+ZrtpConfigure::~ZrtpConfigure() {
+    if (profile != NULL)
+        profile->release();
+}
+
+void ZrtpConfigure::freeze() {
+    if (profile != NULL)
+        return;
 
-ZrtpConfigure::~ZrtpConfigure() {}
+    Profile* p = new Profile;
+    for (int t = 0; t < Profile::numTypes; t++) {
+        std::vector<AlgorithmEnum* >& a = getEnum(static_cast<AlgoTypes>(t + 1));
+        for (size_t i = 0; i < a.size() && i < (size_t)maxNoOfAlgos; i++) {
+            p->algos[t][i] = a[i];
+            p->masks[t] |= 1U << (a[i]->getOrdinal() & 31);
+        }
+        p->counts[t] = (int32_t)((a.size() < (size_t)maxNoOfAlgos) ? a.size() : maxNoOfAlgos);
+    }
+    p->fingerprint = getFingerprint();
+
+    hashes.clear();
+    symCiphers.clear();
+    publicKeyAlgos.clear();
+    sasTypes.clear();
+    authLengths.clear();
+    profile = p;
+}
 
 void ZrtpConfigure::setStandardConfig() {
+    if (profile != NULL)
+        return;
     clear();
 
+#ifdef ZRTP_MINIMAL_ALGORITHMS
+    addAlgo(HashAlgorithm, zrtpHashes.getByName(s256));
+
+    addAlgo(CipherAlgorithm, zrtpSymCiphers.getByName(aes3));
+    addAlgo(CipherAlgorithm, zrtpSymCiphers.getByName(aes1));
+
+    addAlgo(PubKeyAlgorithm, zrtpPubKeys.getByName(e255));
+    addAlgo(PubKeyAlgorithm, zrtpPubKeys.getByName(mult));
+
+    addAlgo(SasType, zrtpSasTypes.getByName(b32));
+
+    addAlgo(AuthLength, zrtpAuthLengths.getByName(hs32));
+    addAlgo(AuthLength, zrtpAuthLengths.getByName(hs80));
+#else
     addAlgo(HashAlgorithm, zrtpHashes.getByName(s384));
     addAlgo(HashAlgorithm, zrtpHashes.getByName(s256));
 
@@ -264,16 +394,19 @@ void ZrtpConfigure::setStandardConfig() {
     addAlgo(AuthLength, zrtpAuthLengths.getByName(sk64));
     addAlgo(AuthLength, zrtpAuthLengths.getByName(hs32));
     addAlgo(AuthLength, zrtpAuthLengths.getByName(hs80));
+#endif
 }
 
 void ZrtpConfigure::setMandatoryOnly() {
+    if (profile != NULL)
+        return;
     clear();
 
     addAlgo(HashAlgorithm, zrtpHashes.getByName(s256));
 
     addAlgo(CipherAlgorithm, zrtpSymCiphers.getByName(aes1));
 
-    addAlgo(PubKeyAlgorithm, zrtpPubKeys.getByName(dh3k));
+    addAlgo(PubKeyAlgorithm, zrtpPubKeys.getByName(mandatoryPubKey));
     addAlgo(PubKeyAlgorithm, zrtpPubKeys.getByName(mult));
 
     addAlgo(SasType, zrtpSasTypes.getByName(b32));
@@ -284,48 +417,201 @@ void ZrtpConfigure::setMandatoryOnly() {
 }
 
 void ZrtpConfigure::clear() {
+    if (profile != NULL)
+        return;
     hashes.clear();
     symCiphers.clear();
     publicKeyAlgos.clear();
     sasTypes.clear();
     authLengths.clear();
+    fingerprint = 0;
 }
 
 int32_t ZrtpConfigure::addAlgo(AlgoTypes algoType, AlgorithmEnum& algo) {
 
+    if (profile != NULL)
+        return -1;
     return addAlgo(getEnum(algoType), algo);
 }
 
 int32_t ZrtpConfigure::addAlgoAt(AlgoTypes algoType, AlgorithmEnum& algo, int32_t index) {
 
+    if (profile != NULL)
+        return -1;
     return addAlgoAt(getEnum(algoType), algo, index);
 }
 
 AlgorithmEnum& ZrtpConfigure::getAlgoAt(AlgoTypes algoType, int32_t index) {
 
+    if (profile != NULL) {
+        int t = typeIndex(algoType);
+        if (t < 0)
+            t = 0;
+        if (index < 0 || index >= profile->counts[t])
+            return invalidAlgo;
+        return *profile->algos[t][index];
+    }
     return getAlgoAt(getEnum(algoType), index);
 }
 
 int32_t ZrtpConfigure::removeAlgo(AlgoTypes algoType, AlgorithmEnum& algo) {
 
+    if (profile != NULL)
+        return -1;
     return removeAlgo(getEnum(algoType), algo);
 }
 
 int32_t ZrtpConfigure::getNumConfiguredAlgos(AlgoTypes algoType) {
 
+    if (profile != NULL) {
+        int t = typeIndex(algoType);
+        return profile->counts[(t < 0) ? 0 : t];
+    }
     return getNumConfiguredAlgos(getEnum(algoType));
 }
 
 bool ZrtpConfigure::containsAlgo(AlgoTypes algoType, AlgorithmEnum& algo) {
 
+    if (profile != NULL) {
+        int t = typeIndex(algoType);
+        if (t < 0)
+            t = 0;
+        int32_t ord = algo.getOrdinal();
+        if (!algo.isValid() || algo.getAlgoType() != t + 1 || (profile->masks[t] & (1U << (ord & 31))) == 0)
+            return false;
+        if (ord < 32)
+            return true;
+        // Ordinals above 31 share bits, confirm with the list
+        for (int32_t i = 0; i < profile->counts[t]; i++) {
+            if (profile->algos[t][i]->getOrdinal() == ord)
+                return true;
+        }
+        return false;
+    }
     return containsAlgo(getEnum(algoType), algo);
 }
 
+uint64_t ZrtpConfigure::getFingerprint() {
+    if (profile != NULL)
+        return profile->fingerprint;
+    if (fingerprint != 0)
+        return fingerprint;
+
+    // FNV-1a over number and names of the algorithms, same order as in the Hello packet
+    std::vector<AlgorithmEnum* >* lists[] = {&hashes, &symCiphers, &authLengths, &publicKeyAlgos, &sasTypes};
+    uint64_t fp = 0xcbf29ce484222325ULL;
+
+    for (auto list : lists) {
+        fp = (fp ^ list->size()) * 0x100000001b3ULL;
+        for (auto algo : *list) {
+            for (const char* n = algo->getName(); *n != '\0'; n++)
+                fp = (fp ^ static_cast<uint8_t>(*n)) * 0x100000001b3ULL;
+        }
+    }
+    fingerprint = (fp == 0) ? 1 : fp;
+    return fingerprint;
+}
+
 void ZrtpConfigure::printConfiguredAlgos(AlgoTypes algoType) {
 
+    if (profile != NULL) {
+        for (int32_t i = 0, num = getNumConfiguredAlgos(algoType); i < num; i++)
+            printf("print configured: name: %s\n", getAlgoAt(algoType, i).getName());
+        return;
+    }
     printConfiguredAlgos(getEnum(algoType));
 }
 
+/*
+ * The costs are estimates from measurements with the crypto functions of this
+ * library on x86-64: one key agreement of E255 takes about 40 us, EC25 and
+ * DH2k about ten times, DH3k and EC38 about twenty to thirty times as long.
+ * The hash and cipher costs are relative times per byte with and without the
+ * CPU instructions that the functions use.
+ */
+int32_t ZrtpConfigure::getAlgoCost(AlgorithmEnum& algo) {
+
+    uint32_t features = zrtpCpuFeatures();
+    int32_t name = *(int32_t*)algo.getName();
+
+    switch (algo.getAlgoType()) {
+    case HashAlgorithm:
+        if (name == *(int32_t*)s256)
+            return (features & ZRTP_CPU_SHA256) ? 10 : 30;
+        if (name == *(int32_t*)s384)
+            return (features & ZRTP_CPU_SHA512) ? 18 : 22;
+        if (name == *(int32_t*)skn2)
+            return 24;
+        if (name == *(int32_t*)skn3)
+            return 20;
+        break;
+
+    case CipherAlgorithm:
+        if (name == *(int32_t*)aes1)
+            return (features & ZRTP_CPU_AES) ? 10 : 40;
+        if (name == *(int32_t*)aes3)
+            return (features & ZRTP_CPU_AES) ? 14 : 56;
+        if (name == *(int32_t*)two1 || name == *(int32_t*)two3)
+            return 36;
+        if (name == *(int32_t*)cc20)
+            return (features & ZRTP_CPU_AVX2) ? 12 : 20;
+        break;
+
+    case PubKeyAlgorithm:
+        if (name == *(int32_t*)e255)
+            return 1;
+        if (name == *(int32_t*)ec25)
+            return 8;
+        if (name == *(int32_t*)dh2k)
+            return 9;
+        if (name == *(int32_t*)e414)
+            return 10;
+        if (name == *(int32_t*)dh3k)
+            return 20;
+        if (name == *(int32_t*)ec38)
+            return 26;
+        break;
+
+    default:
+        break;
+    }
+    return 0;
+}
+
+int32_t ZrtpConfigure::getAlgoStrength(AlgorithmEnum& algo) {
+
+    int32_t name = *(int32_t*)algo.getName();
+
+    switch (algo.getAlgoType()) {
+    case HashAlgorithm:
+        if (name == *(int32_t*)s256 || name == *(int32_t*)skn2)
+            return 128;
+        if (name == *(int32_t*)s384 || name == *(int32_t*)skn3)
+            return 192;
+        break;
+
+    case CipherAlgorithm:
+        if (name == *(int32_t*)aes1 || name == *(int32_t*)two1)
+            return 128;
+        if (name == *(int32_t*)aes3 || name == *(int32_t*)two3 || name == *(int32_t*)cc20)
+            return 256;
+        break;
+
+    case PubKeyAlgorithm:
+        if (name == *(int32_t*)dh2k)
+            return 112;
+        if (name == *(int32_t*)ec25 || name == *(int32_t*)dh3k || name == *(int32_t*)e255)
+            return 128;
+        if (name == *(int32_t*)ec38 || name == *(int32_t*)e414)
+            return 192;
+        break;
+
+    default:
+        break;
+    }
+    return 0;
+}
+
 /*
  * The next methods are the private methods that implement the real
  * details.
@@ -348,6 +634,8 @@ AlgorithmEnum& ZrtpConfigure::getAlgoAt(std::vector<AlgorithmEnum* >& a, int32_t
 }
 
 int32_t ZrtpConfigure::addAlgo(std::vector<AlgorithmEnum* >& a, AlgorithmEnum& algo) {
+    fingerprint = 0;
+
     int size = (int)a.size();
     if (size >= maxNoOfAlgos)
         return -1;
@@ -363,6 +651,8 @@ int32_t ZrtpConfigure::addAlgo(std::vector<AlgorithmEnum* >& a, AlgorithmEnum& a
 }
 
 int32_t ZrtpConfigure::addAlgoAt(std::vector<AlgorithmEnum* >& a, AlgorithmEnum& algo, int32_t index) {
+    fingerprint = 0;
+
     if (index >= maxNoOfAlgos)
         return -1;
 
@@ -391,6 +681,7 @@ int32_t ZrtpConfigure::addAlgoAt(std::vector<AlgorithmEnum* >& a, AlgorithmEnum&
 }
 
 int32_t ZrtpConfigure::removeAlgo(std::vector<AlgorithmEnum* >& a, AlgorithmEnum& algo) {
+    fingerprint = 0;
 
     if ((int)a.size() == 0 || !algo.isValid())
         return maxNoOfAlgos;
@@ -493,6 +784,62 @@ bool ZrtpConfigure::isDisclosureFlag() {
     return enableDisclosureFlag;
 }
 
+void ZrtpConfigure::setAsyncKeyAgreement(bool yesNo) {
+    enableAsyncKeyAgreement = yesNo;
+}
+
+bool ZrtpConfigure::isAsyncKeyAgreement() {
+    return enableAsyncKeyAgreement;
+}
+
+void ZrtpConfigure::setAsyncSasSignature(bool yesNo) {
+    enableAsyncSasSignature = yesNo;
+}
+
+bool ZrtpConfigure::isAsyncSasSignature() {
+    return enableAsyncSasSignature;
+}
+
+void ZrtpConfigure::setAsyncZidCache(bool yesNo) {
+    enableAsyncZidCache = yesNo;
+}
+
+bool ZrtpConfigure::isAsyncZidCache() {
+    return enableAsyncZidCache;
+}
+
+void ZrtpConfigure::setSpeculativeKeyGeneration(bool yesNo) {
+    enableSpeculativeKeyGen = yesNo;
+}
+
+bool ZrtpConfigure::isSpeculativeKeyGeneration() {
+    return enableSpeculativeKeyGen;
+}
+
+void ZrtpConfigure::setFastStart(bool yesNo) {
+    enableFastStart = yesNo;
+}
+
+bool ZrtpConfigure::isFastStart() {
+    return enableFastStart;
+}
+
+void ZrtpConfigure::setPresharedLimit(uint32_t limit) {
+    presharedLimit = limit;
+}
+
+uint32_t ZrtpConfigure::getPresharedLimit() {
+    return presharedLimit;
+}
+
+void ZrtpConfigure::setTimerSlack(uint32_t percent) {
+    timerSlack = percent;
+}
+
+uint32_t ZrtpConfigure::getTimerSlack() {
+    return timerSlack;
+}
+
 #if 0
 ZrtpConfigure config;
 
@@ -7,7 +7,23 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <libzrtpcpp/ZrtpCrc32.h>
+#include <common/cpuFeatures.h>
+
+#if !defined(ZRTP_CRC_NO_HW) && (defined(__GNUC__) || defined(__clang__))
+#  if defined(__x86_64__) || defined(__i386__)
+#    define CRC32C_HW_X86
+#  elif defined(__aarch64__) && !defined(__AARCH64EB__) && (defined(__clang__) || __GNUC__ >= 6)
+#    define CRC32C_HW_ARM
+#  endif
+#endif
+
+#if defined(CRC32C_HW_X86)
+#  include <nmmintrin.h>
+#elif defined(CRC32C_HW_ARM)
+#  include <arm_acle.h>
+#endif
 
 #define CRC32C_POLY 0x1EDC6F41
 #define CRC32C(c,d) (c=(c>>8)^crc_c[(c^(d))&0xFF])
@@ -106,17 +122,127 @@ bool zrtpCheckCksum(const uint8_t *buffer, uint16_t length, uint32_t crc32)
     return (crc32 == chksum);
 }
 
+/*
+ * Slice-by-8: the tables contain the CRC of a byte followed by 0 to 7 zero
+ * bytes. The loop reads the bytes individually, thus it does not depend on
+ * the byte order or alignment of the buffer.
+ */
+struct SliceTables {
+    uint32_t t[8][256];
+
+    SliceTables() {
+        for (int i = 0; i < 256; i++) {
+            uint32_t c = crc_c[i];
+            t[0][i] = c;
+            for (int k = 1; k < 8; k++) {
+                c = (c >> 8) ^ crc_c[c & 0xFF];
+                t[k][i] = c;
+            }
+        }
+    }
+};
+
+static uint32_t crc32cSlice8(uint32_t crc32, const uint8_t *buffer, uint32_t length)
+{
+    static const SliceTables sliceTables;
+    const uint32_t (*t)[256] = sliceTables.t;
+
+    for (; length >= 8; length -= 8, buffer += 8) {
+        crc32 ^= (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) |
+                 ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+        crc32 = t[7][crc32 & 0xFF] ^ t[6][(crc32 >> 8) & 0xFF] ^
+                t[5][(crc32 >> 16) & 0xFF] ^ t[4][crc32 >> 24] ^
+                t[3][buffer[4]] ^ t[2][buffer[5]] ^ t[1][buffer[6]] ^ t[0][buffer[7]];
+    }
+    for (; length > 0; length--, buffer++)
+        CRC32C(crc32, *buffer);
+
+    return crc32;
+}
+
+#if defined(CRC32C_HW_X86)
+
+static bool checkCpu()
+{
+    return (zrtpCpuFeatures() & ZRTP_CPU_CRC32C) != 0;
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32cHw(uint32_t crc32, const uint8_t *buffer, uint32_t length)
+{
+#if defined(__x86_64__)
+    uint64_t crc64 = crc32;
+    for (; length >= 8; length -= 8, buffer += 8) {
+        uint64_t word;
+        memcpy(&word, buffer, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc32 = (uint32_t)crc64;
+#endif
+    for (; length >= 4; length -= 4, buffer += 4) {
+        uint32_t word;
+        memcpy(&word, buffer, sizeof(word));
+        crc32 = _mm_crc32_u32(crc32, word);
+    }
+    for (; length > 0; length--, buffer++)
+        crc32 = _mm_crc32_u8(crc32, *buffer);
+
+    return crc32;
+}
+
+#elif defined(CRC32C_HW_ARM)
+
+static bool checkCpu()
+{
+    return (zrtpCpuFeatures() & ZRTP_CPU_CRC32C) != 0;
+}
+
+#if defined(__clang__)
+__attribute__((target("crc")))
+#else
+__attribute__((target("+crc")))
+#endif
+static uint32_t crc32cHw(uint32_t crc32, const uint8_t *buffer, uint32_t length)
+{
+    for (; length >= 8; length -= 8, buffer += 8) {
+        uint64_t word;
+        memcpy(&word, buffer, sizeof(word));
+        crc32 = __crc32cd(crc32, word);
+    }
+    for (; length > 0; length--, buffer++)
+        crc32 = __crc32cb(crc32, *buffer);
+
+    return crc32;
+}
+
+#endif
+
+typedef uint32_t (*Crc32cFunction)(uint32_t crc32, const uint8_t *buffer, uint32_t length);
+
+// Select the implementation once, the hardware instructions compute the same reflected CRC32c
+static Crc32cFunction selectCrc32c()
+{
+#if defined(CRC32C_HW_X86) || defined(CRC32C_HW_ARM)
+    if (checkCpu())
+        return crc32cHw;
+#endif
+    return crc32cSlice8;
+}
+
 uint32_t zrtpGenerateCksum(const uint8_t *buffer, uint16_t length)
 {
-    uint32_t crc32 = ~(uint32_t) 0;
-    uint32_t i;
+    static const Crc32cFunction crc32cUpdate = selectCrc32c();
 
     // fprintf(stderr, "Buffer %xl, length: %d\n", buffer, length);
     /* Calculate the CRC. */
-    for (i = 0; i < length ; i++)
-        CRC32C(crc32, buffer[i]);
+    return crc32cUpdate(~(uint32_t) 0, buffer, length);
+}
 
-    return crc32;
+uint32_t zrtpUpdateCksum(uint32_t crc32, const uint8_t *buffer, uint16_t length)
+{
+    static const Crc32cFunction crc32cUpdate = selectCrc32c();
+
+    return crc32cUpdate(crc32, buffer, length);
 }
 
 uint32_t zrtpEndCksum(uint32_t crc32)
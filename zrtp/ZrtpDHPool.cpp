@@ -0,0 +1,356 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <libzrtpcpp/ZrtpDHPool.h>
+#include <libzrtpcpp/ZrtpTextData.h>
+#include <crypto/zrtpDH.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// The key agreement types the pool supports, the names are 4 chars, see ZrtpTextData.cpp
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+static const char* const poolTypes[] = { e255, ec25, ec38, e414, dh3k };
+#else
+static const char* const poolTypes[] = { e255 };
+#endif
+static const int32_t numPoolTypes = sizeof(poolTypes) / sizeof(poolTypes[0]);
+
+static int32_t typeIndex(const char* type)
+{
+    for (int32_t i = 0; i < numPoolTypes; i++) {
+        if (*(int32_t*)type == *(int32_t*)poolTypes[i])
+            return i;
+    }
+    return -1;
+}
+
+static std::atomic<bool> idlePriority(false);
+
+/*
+ * Switch the scheduling policy of a worker thread if the application changed the
+ * priority, the thread keeps its current policy in @c current.
+ */
+static void applyPriority(bool& current)
+{
+    bool idle = idlePriority.load(std::memory_order_relaxed);
+    if (idle == current)
+        return;
+    current = idle;
+#if defined(__linux__) && defined(SCHED_IDLE)
+    struct sched_param param = {};
+    pthread_setschedparam(pthread_self(), idle ? SCHED_IDLE : SCHED_OTHER, &param);
+#endif
+}
+
+/*
+ * The pool data and the worker thread. The destructor stops the worker thread if
+ * the application did not disable the pool before it terminates.
+ */
+class KeyPairPool {
+public:
+    KeyPairPool(): poolSize(0), running(false) {}
+
+    ~KeyPairPool() { setSize(0); }
+
+    void setSize(int32_t size);
+
+    ZrtpDH* get(int32_t index);
+
+    int32_t available(int32_t index);
+
+private:
+    void run();
+
+    void trim();
+
+    // Key pairs the worker generates at once, the EC types share one inversion
+    static const int32_t maxBatch = 8;
+
+    std::mutex lock;
+    std::condition_variable refill;
+    std::thread worker;
+    std::deque<ZrtpDH*> keys[numPoolTypes];
+    int32_t poolSize;
+    bool running;
+};
+
+void KeyPairPool::setSize(int32_t size)
+{
+    std::thread stopped;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        poolSize = size < 0 ? 0 : size;
+        trim();
+        if (poolSize > 0 && !running) {
+            running = true;
+            worker = std::thread(&KeyPairPool::run, this);
+        }
+        else if (poolSize == 0 && running) {
+            running = false;
+            stopped.swap(worker);
+        }
+        refill.notify_one();
+    }
+    // Join outside of the lock, the worker thread needs the lock to terminate
+    if (stopped.joinable())
+        stopped.join();
+}
+
+void KeyPairPool::trim()
+{
+    for (int32_t i = 0; i < numPoolTypes; i++) {
+        while (keys[i].size() > (size_t)poolSize) {
+            delete keys[i].back();
+            keys[i].pop_back();
+        }
+    }
+}
+
+ZrtpDH* KeyPairPool::get(int32_t index)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (keys[index].empty())
+        return nullptr;
+
+    ZrtpDH* dh = keys[index].front();
+    keys[index].pop_front();
+    refill.notify_one();
+    return dh;
+}
+
+int32_t KeyPairPool::available(int32_t index)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return (int32_t)keys[index].size();
+}
+
+void KeyPairPool::run()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    bool idle = false;
+
+    while (running) {
+        // Fill the type with the fewest key pairs first
+        int32_t index = -1;
+        for (int32_t i = 0; i < numPoolTypes; i++) {
+            if (keys[i].size() < (size_t)poolSize && (index < 0 || keys[i].size() < keys[index].size()))
+                index = i;
+        }
+        if (index < 0) {
+            refill.wait(guard);
+            continue;
+        }
+        // Generate a batch of key pairs without holding the lock
+        ZrtpDH* batch[maxBatch];
+        int32_t count = poolSize - (int32_t)keys[index].size();
+        if (count > maxBatch)
+            count = maxBatch;
+        guard.unlock();
+        applyPriority(idle);
+        count = ZrtpDH::generateKeyPairs(poolTypes[index], batch, count);
+        guard.lock();
+
+        for (int32_t i = 0; i < count; i++) {
+            if (running && keys[index].size() < (size_t)poolSize)
+                keys[index].push_back(batch[i]);
+            else
+                delete batch[i];
+        }
+    }
+}
+
+static KeyPairPool pool;
+
+void ZrtpDHPool::setPoolSize(int32_t keysPerType)
+{
+    pool.setSize(keysPerType);
+}
+
+ZrtpDH* ZrtpDHPool::getKeyPair(const char* type)
+{
+    int32_t index = typeIndex(type);
+    return index < 0 ? nullptr : pool.get(index);
+}
+
+int32_t ZrtpDHPool::getAvailable(const char* type)
+{
+    int32_t index = typeIndex(type);
+    return index < 0 ? 0 : pool.available(index);
+}
+
+/*
+ * The worker thread for asynchronous key agreements. Tasks that are still queued
+ * when the application terminates are discarded, the destructor of a task releases
+ * its data.
+ */
+class AgreementWorker {
+public:
+    AgreementWorker(): running(false) {}
+
+    ~AgreementWorker();
+
+    void submit(std::function<void()> task);
+
+private:
+    void run();
+
+    std::mutex lock;
+    std::condition_variable wakeup;
+    std::thread worker;
+    std::deque<std::function<void()> > tasks;
+    bool running;
+};
+
+AgreementWorker::~AgreementWorker()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        running = false;
+        wakeup.notify_one();
+    }
+    if (worker.joinable())
+        worker.join();
+    tasks.clear();
+}
+
+void AgreementWorker::submit(std::function<void()> task)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    tasks.push_back(std::move(task));
+    if (!running) {
+        running = true;
+        worker = std::thread(&AgreementWorker::run, this);
+    }
+    wakeup.notify_one();
+}
+
+void AgreementWorker::run()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    bool idle = false;
+
+    while (running) {
+        if (tasks.empty()) {
+            wakeup.wait(guard);
+            continue;
+        }
+        std::function<void()> task = std::move(tasks.front());
+        tasks.pop_front();
+
+        // Run the task without holding the lock, the task may submit a new task
+        guard.unlock();
+        applyPriority(idle);
+        task();
+        task = nullptr;
+        guard.lock();
+    }
+}
+
+static AgreementWorker agreementWorker;
+
+void ZrtpDHWorker::submit(std::function<void()> task)
+{
+    agreementWorker.submit(std::move(task));
+}
+
+/*
+ * The admission counters. The limit is a soft bound on the CPU load, relaxed
+ * atomics are sufficient.
+ */
+static std::atomic<int32_t> admissionLimit(0);
+static std::atomic<int32_t> inFlight(0);
+static std::atomic<int32_t> queued(0);
+
+void ZrtpAdmission::setLimit(int32_t handshakesPerCore)
+{
+    int32_t cores = static_cast<int32_t>(std::thread::hardware_concurrency());
+    if (cores <= 0)
+        cores = 1;
+    admissionLimit.store(handshakesPerCore > 0 ? handshakesPerCore * cores : 0, std::memory_order_relaxed);
+}
+
+int32_t ZrtpAdmission::getLimit()
+{
+    return admissionLimit.load(std::memory_order_relaxed);
+}
+
+void ZrtpAdmission::setIdlePriority(bool idle)
+{
+    idlePriority.store(idle, std::memory_order_relaxed);
+}
+
+bool ZrtpAdmission::isSaturated()
+{
+    int32_t limit = admissionLimit.load(std::memory_order_relaxed);
+    return limit > 0 && inFlight.load(std::memory_order_relaxed) >= limit;
+}
+
+bool ZrtpAdmission::tryAdmit()
+{
+    int32_t limit = admissionLimit.load(std::memory_order_relaxed);
+    int32_t current = inFlight.load(std::memory_order_relaxed);
+    do {
+        if (limit > 0 && current >= limit)
+            return false;
+    } while (!inFlight.compare_exchange_weak(current, current + 1, std::memory_order_relaxed));
+    return true;
+}
+
+void ZrtpAdmission::admit()
+{
+    inFlight.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ZrtpAdmission::release()
+{
+    inFlight.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void ZrtpAdmission::enterQueue()
+{
+    queued.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ZrtpAdmission::leaveQueue()
+{
+    queued.fetch_sub(1, std::memory_order_relaxed);
+}
+
+int32_t ZrtpAdmission::getInFlight()
+{
+    return inFlight.load(std::memory_order_relaxed);
+}
+
+int32_t ZrtpAdmission::getQueueDepth()
+{
+    return queued.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <libzrtpcpp/ZrtpDemux.h>
+
+#define D ZrtpDemux::Drop
+#define S ZrtpDemux::Stun
+#define Z ZrtpDemux::Zrtp
+#define T ZrtpDemux::Dtls
+#define C ZrtpDemux::Turn
+#define R ZrtpDemux::Rtp
+
+// RFC 7983, chapter 7, one row per 16 values of the first byte
+const uint8_t ZrtpDemux::firstByteClass[256] = {
+    S, S, S, S, D, D, D, D, D, D, D, D, D, D, D, D,     //   0 ..  15
+    Z, Z, Z, Z, T, T, T, T, T, T, T, T, T, T, T, T,     //  16 ..  31
+    T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T,     //  32 ..  47
+    T, T, T, T, T, T, T, T, T, T, T, T, T, T, T, T,     //  48 ..  63
+    C, C, C, C, C, C, C, C, C, C, C, C, C, C, C, C,     //  64 ..  79
+    D, D, D, D, D, D, D, D, D, D, D, D, D, D, D, D,     //  80 ..  95
+    D, D, D, D, D, D, D, D, D, D, D, D, D, D, D, D,     //  96 .. 111
+    D, D, D, D, D, D, D, D, D, D, D, D, D, D, D, D,     // 112 .. 127
+    R, R, R, R, R, R, R, R, R, R, R, R, R, R, R, R,     // 128 .. 143
+    R, R, R, R, R, R, R, R, R, R, R, R, R, R, R, R,     // 144 .. 159
+    R, R, R, R, R, R, R, R, R, R, R, R, R, R, R, R,     // 160 .. 175
+    R, R, R, R, R, R, R, R, R, R, R, R, R, R, R, R,     // 176 .. 191
+    D, D, D, D, D, D, D, D, D, D, D, D, D, D, D, D,     // 192 .. 207
+    D, D, D, D, D, D, D, D, D, D, D, D, D, D, D, D,     // 208 .. 223
+    D, D, D, D, D, D, D, D, D, D, D, D, D, D, D, D,     // 224 .. 239
+    D, D, D, D, D, D, D, D, D, D, D, D, D, D, D, D      // 240 .. 255
+};
+
+#undef D
+#undef S
+#undef Z
+#undef T
+#undef C
+#undef R
+
+// RFC 5761, chapter 4, the RTCP packet types 192 .. 223 in the second byte
+const uint8_t ZrtpDemux::rtcpType[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     //   0 ..  15
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     //  16 ..  31
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     //  32 ..  47
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     //  48 ..  63
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     //  64 ..  79
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     //  80 ..  95
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     //  96 .. 111
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     // 112 .. 127
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     // 128 .. 143
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     // 144 .. 159
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     // 160 .. 175
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     // 176 .. 191
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // 192 .. 207
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // 208 .. 223
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     // 224 .. 239
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0      // 240 .. 255
+};
+
+// Fixed headers: STUN 20, ZRTP 12 plus the smallest ZRTP message with its CRC,
+// DTLS record 13, TURN channel 4, RTP 12 and RTCP 8 bytes
+const size_t ZrtpDemux::minimumLength[NumberOfClasses] = {
+    0, 20, 12 + sizeof(HelloAckPacket_t), 13, 4, 12, 8
+};
+
+int32_t ZrtpDemux::classifyBatch(const uint8_t* const packets[], const size_t lengths[], int32_t classes[], int32_t count) {
+    int32_t accepted = 0;
+
+    for (int32_t i = 0; i < count; i++) {
+        classes[i] = classify(packets[i], lengths[i]);
+        accepted += (classes[i] != Drop);
+    }
+    return accepted;
+}
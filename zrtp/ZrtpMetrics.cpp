@@ -0,0 +1,649 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+#include <libzrtpcpp/ZrtpMetrics.h>
+#include <libzrtpcpp/ZrtpCodes.h>
+#include <libzrtpcpp/ZrtpConfigure.h>
+#include <libzrtpcpp/ZrtpDHPool.h>
+
+using namespace GnuZrtpCodes;
+
+/*
+ * The ZRTP error codes in the order of their failure indices. The Severe codes
+ * use the indices 0 .. 7, each ZRTP error code uses two indices, the first for
+ * the local error, the second for the error the peer sent.
+ */
+static const int32_t zrtpErrors[] = {
+    MalformedPacket, CriticalSWError, UnsuppZRTPVersion, HelloCompMismatch, UnsuppHashType,
+    UnsuppCiphertype, UnsuppPKExchange, UnsuppSRTPAuthTag, UnsuppSASScheme, NoSharedSecret,
+    DHErrorWrongPV, DHErrorWrongHVI, SASuntrustedMiTM, ConfirmHMACWrong, NonceReused,
+    EqualZIDHello, GoCleatNotAllowed
+};
+static const int32_t numberOfSevere = SevereTooMuchRetries;
+static const int32_t numberOfZrtpErrors = sizeof(zrtpErrors) / sizeof(zrtpErrors[0]);
+static const int32_t otherFailure = ZrtpMetrics::NumberOfFailureCodes - 1;
+
+static_assert(numberOfSevere + 2 * numberOfZrtpErrors + 1 == ZrtpMetrics::NumberOfFailureCodes,
+              "NumberOfFailureCodes does not match the codes");
+
+static const char* encryptionNames[ZrtpMetrics::NumberOfEncryptions] = {
+    "NULL", "AES-CM", "AES-F8", "TWOFISH-CM", "TWOFISH-F8", "AES-GCM-128", "AES-GCM-256", "CHACHA20-POLY1305"
+};
+static const char* authenticationNames[ZrtpMetrics::NumberOfAuthentications] = {
+    "NULL", "HMAC-SHA1", "SKEIN"
+};
+static const char* lockNames[ZrtpMetrics::NumberOfLockCategories] = {
+    "stream", "queue", "timeout", "random"
+};
+static const char* operationNames[ZrtpMetrics::NumberOfLatencyOperations] = {
+    "protect", "unprotect"
+};
+static const char* stageNames[ZrtpMetrics::NumberOfLatencyStages] = {
+    "decode", "replay", "crypto"
+};
+
+/*
+ * Layout of the counters of a block. A flat array keeps the merge of the
+ * blocks simple.
+ */
+enum {
+    StartedIndex = 0,
+    SecureIndex,
+    CacheHitIndex,
+    CacheMissIndex,
+    SecureTimeSumIndex,
+    FailedIndex,
+    NegotiatedIndex = FailedIndex + ZrtpMetrics::NumberOfFailureCodes,
+    SecureTimeIndex = NegotiatedIndex + ZrtpMetrics::NumberOfAlgorithmTypes * ZrtpMetrics::MaxAlgorithms,
+    SrtpIndex = SecureTimeIndex + ZrtpMetrics::NumberOfTimeBuckets,
+    LockIndex = SrtpIndex + ZrtpMetrics::NumberOfSrtpSuites * 4,
+    LockValues = 4 + ZrtpMetrics::NumberOfHoldBuckets,
+    LatencyIndex = LockIndex + ZrtpMetrics::NumberOfLockCategories * LockValues,
+    LatencyValues = ZrtpMetrics::NumberOfLatencyBuckets + 1,
+    StageIndex = LatencyIndex + ZrtpMetrics::NumberOfSrtpSuites * ZrtpMetrics::NumberOfLatencyOperations * LatencyValues,
+    NumberOfValues = StageIndex + ZrtpMetrics::NumberOfLatencyOperations * ZrtpMetrics::NumberOfLatencyStages * LatencyValues
+};
+
+/*
+ * Only the owning thread writes the counters of its block, the snapshot reads
+ * them concurrently.
+ */
+struct MetricsBlock {
+    std::atomic<uint64_t> values[NumberOfValues];
+
+    void increment(int32_t index, uint64_t value) {
+        values[index].store(values[index].load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+};
+
+/*
+ * The blocks of the running threads and the counts of the ended threads. The
+ * registry is never deleted, thus threads that end during the process exit
+ * still find it.
+ */
+struct MetricsRegistry {
+    std::mutex lock;
+    std::vector<MetricsBlock*> blocks;
+    MetricsBlock retired;
+};
+
+static MetricsRegistry& registry() {
+    static MetricsRegistry* metricsRegistry = new MetricsRegistry();
+    return *metricsRegistry;
+}
+
+class ThreadMetrics {
+public:
+    ThreadMetrics() {
+        MetricsRegistry& reg = registry();
+        std::lock_guard<std::mutex> guard(reg.lock);
+        reg.blocks.push_back(&block);
+    }
+
+    ~ThreadMetrics() {
+        MetricsRegistry& reg = registry();
+        std::lock_guard<std::mutex> guard(reg.lock);
+        for (int32_t i = 0; i < NumberOfValues; i++)
+            reg.retired.increment(i, block.values[i].load(std::memory_order_relaxed));
+        reg.blocks.erase(std::remove(reg.blocks.begin(), reg.blocks.end(), &block), reg.blocks.end());
+    }
+
+    MetricsBlock block;     // thread storage, zero initialized
+};
+
+static MetricsBlock& local() {
+    static thread_local ThreadMetrics metrics;
+    return metrics.block;
+}
+
+static inline bool validSuite(int32_t suite) {
+    return suite >= 0 && suite < ZrtpMetrics::NumberOfSrtpSuites;
+}
+
+static std::atomic<uint32_t> latencySampling(ZrtpMetrics::DefaultLatencySampling);
+
+// Bucket of a latency in nanoseconds, the inverse of getLatencyBucketLimit()
+static int32_t latencyBucket(uint64_t latency) {
+    if (latency <= 128)
+        return latency == 0 ? 0 : static_cast<int32_t>((latency - 1) / 32);
+
+    uint64_t value = latency - 1;
+    int32_t exponent = 7;
+    while (exponent < 63 && (value >> (exponent + 1)) != 0)
+        exponent++;
+    int32_t bucket = 4 + (exponent - 7) * 4 + static_cast<int32_t>((value >> (exponent - 2)) & 3);
+    return bucket < ZrtpMetrics::NumberOfLatencyBuckets ? bucket : ZrtpMetrics::NumberOfLatencyBuckets - 1;
+}
+
+static void countHistogram(int32_t index, uint64_t latency) {
+    MetricsBlock& block = local();
+    block.increment(index + latencyBucket(latency), 1);
+    block.increment(index + ZrtpMetrics::NumberOfLatencyBuckets, latency);
+}
+
+static void copyHistogram(const uint64_t* values, ZrtpMetrics::LatencyHistogram& histogram) {
+    for (int32_t bucket = 0; bucket < ZrtpMetrics::NumberOfLatencyBuckets; bucket++)
+        histogram.samples[bucket] = values[bucket];
+    histogram.sum = values[ZrtpMetrics::NumberOfLatencyBuckets];
+}
+
+void ZrtpMetrics::countHandshakeStarted() {
+    local().increment(StartedIndex, 1);
+}
+
+void ZrtpMetrics::countHandshakeSecure(const int32_t ordinals[NumberOfAlgorithmTypes], int64_t timeToSecure) {
+    MetricsBlock& block = local();
+
+    block.increment(SecureIndex, 1);
+    for (int32_t type = 0; type < NumberOfAlgorithmTypes; type++) {
+        if (ordinals[type] >= 0 && ordinals[type] < MaxAlgorithms)
+            block.increment(NegotiatedIndex + type * MaxAlgorithms + ordinals[type], 1);
+    }
+    if (timeToSecure < 0)
+        return;
+
+    int32_t bucket = 0;
+    while (bucket < NumberOfTimeBuckets - 1 && timeToSecure > getTimeBucketLimit(bucket) * 1000)
+        bucket++;
+    block.increment(SecureTimeIndex + bucket, 1);
+    block.increment(SecureTimeSumIndex, static_cast<uint64_t>(timeToSecure));
+}
+
+void ZrtpMetrics::countHandshakeFailed(int32_t severity, int32_t subCode) {
+    local().increment(FailedIndex + getFailureIndex(severity, subCode), 1);
+}
+
+void ZrtpMetrics::countCacheLookup(bool hit) {
+    local().increment(hit ? CacheHitIndex : CacheMissIndex, 1);
+}
+
+void ZrtpMetrics::countSrtpPacket(int32_t suite, size_t length) {
+    if (!validSuite(suite))
+        return;
+    MetricsBlock& block = local();
+    block.increment(SrtpIndex + suite * 4, 1);
+    block.increment(SrtpIndex + suite * 4 + 1, length);
+}
+
+void ZrtpMetrics::countSrtpAuthFailure(int32_t suite) {
+    if (validSuite(suite))
+        local().increment(SrtpIndex + suite * 4 + 2, 1);
+}
+
+void ZrtpMetrics::countSrtpReplayDrop(int32_t suite) {
+    if (validSuite(suite))
+        local().increment(SrtpIndex + suite * 4 + 3, 1);
+}
+
+void ZrtpMetrics::countLockAcquired(int32_t category, bool contended, uint64_t waitTime) {
+    if (category < 0 || category >= NumberOfLockCategories)
+        return;
+    MetricsBlock& block = local();
+    const int32_t index = LockIndex + category * LockValues;
+
+    block.increment(index, 1);
+    if (contended) {
+        block.increment(index + 1, 1);
+        block.increment(index + 2, waitTime);
+    }
+}
+
+void ZrtpMetrics::countLockReleased(int32_t category, uint64_t holdTime) {
+    if (category < 0 || category >= NumberOfLockCategories)
+        return;
+    MetricsBlock& block = local();
+    const int32_t index = LockIndex + category * LockValues;
+
+    int32_t bucket = 0;
+    while (bucket < NumberOfHoldBuckets - 1 && holdTime > static_cast<uint64_t>(getHoldBucketLimit(bucket)) * 1000)
+        bucket++;
+    block.increment(index + 3, holdTime);
+    block.increment(index + 4 + bucket, 1);
+}
+
+void ZrtpMetrics::setLatencySampling(uint32_t interval) {
+    latencySampling.store(interval, std::memory_order_relaxed);
+}
+
+uint32_t ZrtpMetrics::getLatencySampling() {
+    return latencySampling.load(std::memory_order_relaxed);
+}
+
+/*
+ * A fixed interval would sample the same call of a regular pattern, for example
+ * always the protect call if a thread protects and unprotects in turn. Thus the
+ * distance to the next sample is random with the interval as mean value.
+ */
+bool ZrtpMetrics::sampleLatency() {
+    static thread_local uint32_t countdown = 0;
+    static thread_local uint32_t state = 0;
+
+    if (countdown > 1) {
+        countdown--;
+        return false;
+    }
+    uint32_t interval = latencySampling.load(std::memory_order_relaxed);
+    if (interval == 0) {
+        countdown = 0;
+        return false;
+    }
+    if (state == 0)
+        state = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&state)) | 1;
+    state ^= state << 13;               // xorshift32, no need for a cryptographic random
+    state ^= state >> 17;
+    state ^= state << 5;
+    bool sample = countdown == 1;
+    countdown = 1 + static_cast<uint32_t>(state % (2 * static_cast<uint64_t>(interval) - 1));
+    return sample;
+}
+
+void ZrtpMetrics::countLatency(int32_t suite, int32_t operation, uint64_t latency) {
+    if (!validSuite(suite) || operation < 0 || operation >= NumberOfLatencyOperations)
+        return;
+    countHistogram(LatencyIndex + (suite * NumberOfLatencyOperations + operation) * LatencyValues, latency);
+}
+
+void ZrtpMetrics::countStageLatency(int32_t operation, int32_t stage, uint64_t latency) {
+    if (operation < 0 || operation >= NumberOfLatencyOperations || stage < 0 || stage >= NumberOfLatencyStages)
+        return;
+    countHistogram(StageIndex + (operation * NumberOfLatencyStages + stage) * LatencyValues, latency);
+}
+
+int64_t ZrtpMetrics::getLatencyBucketLimit(int32_t bucket) {
+    if (bucket < 0 || bucket >= NumberOfLatencyBuckets - 1)
+        return -1;
+    if (bucket < 4)
+        return (bucket + 1) * 32;
+
+    int32_t exponent = 7 + (bucket - 4) / 4;
+    return (static_cast<int64_t>(1) << exponent) + (((bucket - 4) % 4 + 1) * (static_cast<int64_t>(1) << (exponent - 2)));
+}
+
+const char* ZrtpMetrics::getLockName(int32_t category) {
+    if (category < 0 || category >= NumberOfLockCategories)
+        return "";
+    return lockNames[category];
+}
+
+int64_t ZrtpMetrics::getHoldBucketLimit(int32_t bucket) {
+    if (bucket < 0 || bucket >= NumberOfHoldBuckets - 1)
+        return -1;
+    return static_cast<int64_t>(1) << bucket;
+}
+
+int32_t ZrtpMetrics::getSrtpSuite(int32_t ealg, int32_t aalg, bool control) {
+    if (ealg < 0 || ealg >= NumberOfEncryptions || aalg < 0 || aalg >= NumberOfAuthentications)
+        return -1;
+    return ((control ? 1 : 0) * NumberOfEncryptions + ealg) * NumberOfAuthentications + aalg;
+}
+
+bool ZrtpMetrics::getSrtpSuiteNames(int32_t suite, const char** encryption, const char** authentication) {
+    if (!validSuite(suite)) {
+        *encryption = *authentication = "";
+        return false;
+    }
+    *authentication = authenticationNames[suite % NumberOfAuthentications];
+    suite /= NumberOfAuthentications;
+    *encryption = encryptionNames[suite % NumberOfEncryptions];
+    return suite >= NumberOfEncryptions;
+}
+
+int32_t ZrtpMetrics::getFailureIndex(int32_t severity, int32_t subCode) {
+    if (severity == Severe && subCode >= 1 && subCode <= numberOfSevere)
+        return subCode - 1;
+
+    if (severity == ZrtpError) {
+        int32_t code = subCode < 0 ? -subCode : subCode;
+        for (int32_t i = 0; i < numberOfZrtpErrors; i++) {
+            if (zrtpErrors[i] == code)
+                return numberOfSevere + 2 * i + (subCode < 0 ? 1 : 0);
+        }
+    }
+    return otherFailure;
+}
+
+bool ZrtpMetrics::getFailureCode(int32_t index, int32_t* severity, int32_t* subCode) {
+    if (index >= 0 && index < numberOfSevere) {
+        *severity = Severe;
+        *subCode = index + 1;
+        return true;
+    }
+    index -= numberOfSevere;
+    if (index >= 0 && index < 2 * numberOfZrtpErrors) {
+        *severity = ZrtpError;
+        *subCode = (index & 1) ? -zrtpErrors[index / 2] : zrtpErrors[index / 2];
+        return true;
+    }
+    *severity = *subCode = 0;
+    return false;
+}
+
+int64_t ZrtpMetrics::getTimeBucketLimit(int32_t bucket) {
+    if (bucket < 0 || bucket >= NumberOfTimeBuckets - 1)
+        return -1;
+    return static_cast<int64_t>(1) << bucket;
+}
+
+void ZrtpMetrics::getSnapshot(Snapshot* snapshot) {
+    uint64_t values[NumberOfValues];
+    MetricsRegistry& reg = registry();
+    {
+        std::lock_guard<std::mutex> guard(reg.lock);
+
+        for (int32_t i = 0; i < NumberOfValues; i++)
+            values[i] = reg.retired.values[i].load(std::memory_order_relaxed);
+        for (MetricsBlock* block : reg.blocks) {
+            for (int32_t i = 0; i < NumberOfValues; i++)
+                values[i] += block->values[i].load(std::memory_order_relaxed);
+        }
+    }
+    snapshot->handshakesStarted = values[StartedIndex];
+    snapshot->handshakesSecure = values[SecureIndex];
+    snapshot->cacheHits = values[CacheHitIndex];
+    snapshot->cacheMisses = values[CacheMissIndex];
+    snapshot->secureTimeSum = values[SecureTimeSumIndex];
+    snapshot->admissionInFlight = static_cast<uint64_t>(ZrtpAdmission::getInFlight());
+    snapshot->admissionQueued = static_cast<uint64_t>(ZrtpAdmission::getQueueDepth());
+
+    for (int32_t i = 0; i < NumberOfFailureCodes; i++)
+        snapshot->handshakesFailed[i] = values[FailedIndex + i];
+    for (int32_t type = 0; type < NumberOfAlgorithmTypes; type++) {
+        for (int32_t i = 0; i < MaxAlgorithms; i++)
+            snapshot->negotiated[type][i] = values[NegotiatedIndex + type * MaxAlgorithms + i];
+    }
+    for (int32_t i = 0; i < NumberOfTimeBuckets; i++)
+        snapshot->secureTime[i] = values[SecureTimeIndex + i];
+    for (int32_t i = 0; i < NumberOfSrtpSuites; i++) {
+        snapshot->srtp[i].packets = values[SrtpIndex + i * 4];
+        snapshot->srtp[i].bytes = values[SrtpIndex + i * 4 + 1];
+        snapshot->srtp[i].authFailures = values[SrtpIndex + i * 4 + 2];
+        snapshot->srtp[i].replayDrops = values[SrtpIndex + i * 4 + 3];
+    }
+    for (int32_t i = 0; i < NumberOfLockCategories; i++) {
+        const uint64_t* lock = values + LockIndex + i * LockValues;
+        LockCounters& counters = snapshot->locks[i];
+
+        counters.acquisitions = lock[0];
+        counters.contended = lock[1];
+        counters.waitTimeSum = lock[2];
+        counters.holdTimeSum = lock[3];
+        for (int32_t bucket = 0; bucket < NumberOfHoldBuckets; bucket++)
+            counters.holdTime[bucket] = lock[4 + bucket];
+    }
+    for (int32_t i = 0; i < NumberOfSrtpSuites; i++) {
+        for (int32_t operation = 0; operation < NumberOfLatencyOperations; operation++)
+            copyHistogram(values + LatencyIndex + (i * NumberOfLatencyOperations + operation) * LatencyValues,
+                          snapshot->srtpLatency[i][operation]);
+    }
+    for (int32_t operation = 0; operation < NumberOfLatencyOperations; operation++) {
+        for (int32_t stage = 0; stage < NumberOfLatencyStages; stage++)
+            copyHistogram(values + StageIndex + (operation * NumberOfLatencyStages + stage) * LatencyValues,
+                          snapshot->stageLatency[operation][stage]);
+    }
+}
+
+// The name of an algorithm ordinal, without the trailing blanks of SAS names
+static std::string algorithmName(int32_t type, int32_t ordinal) {
+    EnumBase* enums[ZrtpMetrics::NumberOfAlgorithmTypes] = {
+        &zrtpHashes, &zrtpSymCiphers, &zrtpPubKeys, &zrtpSasTypes, &zrtpAuthLengths
+    };
+    if (ordinal >= static_cast<int32_t>(enums[type]->getSize()))
+        return std::string();
+
+    std::string name(enums[type]->getByOrdinal(ordinal).getName());
+    name.erase(name.find_last_not_of(' ') + 1);
+    return name;
+}
+
+static void appendMetric(std::string& text, const char* name, const char* labels, uint64_t value) {
+    char line[256];
+
+    if (labels != NULL && *labels != '\0')
+        snprintf(line, sizeof(line), "%s{%s} %llu\n", name, labels, (unsigned long long)value);
+    else
+        snprintf(line, sizeof(line), "%s %llu\n", name, (unsigned long long)value);
+    text.append(line);
+}
+
+static void appendHeader(std::string& text, const char* name, const char* type, const char* help) {
+    text.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    text.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+// The buckets, sum and count of a latency histogram, labels without the le label
+static void appendLatency(std::string& text, const char* name, const char* labels,
+                          const ZrtpMetrics::LatencyHistogram& histogram) {
+    std::string metric(name);
+    char line[160];
+
+    uint64_t cumulative = 0;
+    for (int32_t bucket = 0; bucket < ZrtpMetrics::NumberOfLatencyBuckets; bucket++) {
+        cumulative += histogram.samples[bucket];
+        int64_t limit = ZrtpMetrics::getLatencyBucketLimit(bucket);
+        if (limit >= 0)
+            snprintf(line, sizeof(line), "%s,le=\"%g\"", labels, limit / 1000000000.0);
+        else
+            snprintf(line, sizeof(line), "%s,le=\"+Inf\"", labels);
+        appendMetric(text, (metric + "_bucket").c_str(), line, cumulative);
+    }
+    snprintf(line, sizeof(line), "%g\n", histogram.sum / 1000000000.0);
+    text.append(metric).append("_sum{").append(labels).append("} ").append(line);
+    appendMetric(text, (metric + "_count").c_str(), labels, cumulative);
+}
+
+static uint64_t latencySamples(const ZrtpMetrics::LatencyHistogram& histogram) {
+    uint64_t samples = 0;
+    for (int32_t bucket = 0; bucket < ZrtpMetrics::NumberOfLatencyBuckets; bucket++)
+        samples += histogram.samples[bucket];
+    return samples;
+}
+
+std::string ZrtpMetrics::formatPrometheus(const Snapshot& snapshot) {
+    static const char* typeNames[NumberOfAlgorithmTypes] = {"hash", "cipher", "pubkey", "sas", "authlength"};
+    std::string text;
+    char labels[128];
+
+    appendHeader(text, "zrtp_handshakes_started_total", "counter", "Started ZRTP engines.");
+    appendMetric(text, "zrtp_handshakes_started_total", NULL, snapshot.handshakesStarted);
+    appendHeader(text, "zrtp_handshakes_secure_total", "counter", "ZRTP handshakes that reached the secure state.");
+    appendMetric(text, "zrtp_handshakes_secure_total", NULL, snapshot.handshakesSecure);
+
+    appendHeader(text, "zrtp_handshakes_failed_total", "counter", "Failed ZRTP negotiations by severity and sub-code.");
+    for (int32_t i = 0; i < NumberOfFailureCodes; i++) {
+        int32_t severity, subCode;
+
+        if (snapshot.handshakesFailed[i] == 0)
+            continue;
+        if (getFailureCode(i, &severity, &subCode))
+            snprintf(labels, sizeof(labels), "severity=\"%s\",code=\"%d\"", severity == Severe ? "severe" : "zrtp", subCode);
+        else
+            snprintf(labels, sizeof(labels), "severity=\"other\",code=\"other\"");
+        appendMetric(text, "zrtp_handshakes_failed_total", labels, snapshot.handshakesFailed[i]);
+    }
+
+    appendHeader(text, "zrtp_negotiated_total", "counter", "Negotiated algorithms of the secure ZRTP handshakes.");
+    for (int32_t type = 0; type < NumberOfAlgorithmTypes; type++) {
+        for (int32_t i = 0; i < MaxAlgorithms; i++) {
+            if (snapshot.negotiated[type][i] == 0)
+                continue;
+            snprintf(labels, sizeof(labels), "type=\"%s\",algorithm=\"%s\"", typeNames[type], algorithmName(type, i).c_str());
+            appendMetric(text, "zrtp_negotiated_total", labels, snapshot.negotiated[type][i]);
+        }
+    }
+
+    appendHeader(text, "zrtp_time_to_secure_seconds", "histogram", "Time from the ZRTP engine start to the secure state.");
+    uint64_t cumulative = 0;
+    for (int32_t i = 0; i < NumberOfTimeBuckets; i++) {
+        cumulative += snapshot.secureTime[i];
+        int64_t limit = getTimeBucketLimit(i);
+        if (limit >= 0)
+            snprintf(labels, sizeof(labels), "le=\"%g\"", limit / 1000.0);
+        else
+            snprintf(labels, sizeof(labels), "le=\"+Inf\"");
+        appendMetric(text, "zrtp_time_to_secure_seconds_bucket", labels, cumulative);
+    }
+    snprintf(labels, sizeof(labels), "zrtp_time_to_secure_seconds_sum %g\n", snapshot.secureTimeSum / 1000000.0);
+    text.append(labels);
+    appendMetric(text, "zrtp_time_to_secure_seconds_count", NULL, cumulative);
+
+    appendHeader(text, "zrtp_cache_lookups_total", "counter", "ZID cache lookups of the ZRTP engines.");
+    appendMetric(text, "zrtp_cache_lookups_total", "result=\"hit\"", snapshot.cacheHits);
+    appendMetric(text, "zrtp_cache_lookups_total", "result=\"miss\"", snapshot.cacheMisses);
+
+    appendHeader(text, "zrtp_admission_in_flight", "gauge", "DH computations of the ZRTP handshakes in flight.");
+    appendMetric(text, "zrtp_admission_in_flight", NULL, snapshot.admissionInFlight);
+    appendHeader(text, "zrtp_admission_queue_depth", "gauge", "ZRTP handshakes that wait for the admission.");
+    appendMetric(text, "zrtp_admission_queue_depth", NULL, snapshot.admissionQueued);
+
+    static const char* srtpNames[4] = {
+        "srtp_packets_total", "srtp_bytes_total", "srtp_auth_failures_total", "srtp_replay_drops_total"
+    };
+    static const char* srtpHelp[4] = {
+        "Protected and unprotected SRTP and SRTCP packets.", "Bytes of the SRTP and SRTCP packets.",
+        "SRTP and SRTCP packets with a wrong authentication tag.", "SRTP and SRTCP packets dropped by the replay check."
+    };
+    for (int32_t counter = 0; counter < 4; counter++) {
+        appendHeader(text, srtpNames[counter], "counter", srtpHelp[counter]);
+        for (int32_t i = 0; i < NumberOfSrtpSuites; i++) {
+            const SrtpSuiteCounters& suite = snapshot.srtp[i];
+            const uint64_t values[4] = {suite.packets, suite.bytes, suite.authFailures, suite.replayDrops};
+            const char *encryption, *authentication;
+
+            if (suite.packets == 0 && suite.authFailures == 0 && suite.replayDrops == 0)
+                continue;
+            bool control = getSrtpSuiteNames(i, &encryption, &authentication);
+            snprintf(labels, sizeof(labels), "protocol=\"%s\",encryption=\"%s\",authentication=\"%s\"",
+                     control ? "srtcp" : "srtp", encryption, authentication);
+            appendMetric(text, srtpNames[counter], labels, values[counter]);
+        }
+    }
+
+    // The latency histograms of the suites and stages that have samples
+    bool sampled = false;
+    for (int32_t i = 0; i < NumberOfSrtpSuites; i++) {
+        for (int32_t operation = 0; operation < NumberOfLatencyOperations; operation++)
+            sampled |= latencySamples(snapshot.srtpLatency[i][operation]) != 0;
+    }
+
+    if (sampled) {
+        appendHeader(text, "srtp_latency_seconds", "histogram", "Sampled latency of the SRTP and SRTCP protect and unprotect calls.");
+        for (int32_t i = 0; i < NumberOfSrtpSuites; i++) {
+            const char *encryption, *authentication;
+            bool control = getSrtpSuiteNames(i, &encryption, &authentication);
+
+            for (int32_t operation = 0; operation < NumberOfLatencyOperations; operation++) {
+                if (latencySamples(snapshot.srtpLatency[i][operation]) == 0)
+                    continue;
+                snprintf(labels, sizeof(labels), "protocol=\"%s\",encryption=\"%s\",authentication=\"%s\",operation=\"%s\"",
+                         control ? "srtcp" : "srtp", encryption, authentication, operationNames[operation]);
+                appendLatency(text, "srtp_latency_seconds", labels, snapshot.srtpLatency[i][operation]);
+            }
+        }
+        appendHeader(text, "srtp_stage_latency_seconds", "histogram", "Sampled latency of the stages of the SRTP protect and unprotect calls.");
+        for (int32_t operation = 0; operation < NumberOfLatencyOperations; operation++) {
+            for (int32_t stage = 0; stage < NumberOfLatencyStages; stage++) {
+                if (latencySamples(snapshot.stageLatency[operation][stage]) == 0)
+                    continue;
+                snprintf(labels, sizeof(labels), "operation=\"%s\",stage=\"%s\"", operationNames[operation], stageNames[stage]);
+                appendLatency(text, "srtp_stage_latency_seconds", labels, snapshot.stageLatency[operation][stage]);
+            }
+        }
+    }
+
+    // Only a library built with lock profiling counts lock acquisitions, the metrics contain the used locks
+    bool profiled = false;
+    for (int32_t i = 0; i < NumberOfLockCategories; i++)
+        profiled |= snapshot.locks[i].acquisitions != 0;
+    if (!profiled)
+        return text;
+
+    appendHeader(text, "zrtp_lock_acquisitions_total", "counter", "Acquisitions of the ZRTP locks.");
+    for (int32_t i = 0; i < NumberOfLockCategories; i++) {
+        if (snapshot.locks[i].acquisitions == 0)
+            continue;
+        snprintf(labels, sizeof(labels), "lock=\"%s\"", lockNames[i]);
+        appendMetric(text, "zrtp_lock_acquisitions_total", labels, snapshot.locks[i].acquisitions);
+    }
+    appendHeader(text, "zrtp_lock_contended_total", "counter", "Acquisitions of the ZRTP locks that waited for another thread.");
+    for (int32_t i = 0; i < NumberOfLockCategories; i++) {
+        if (snapshot.locks[i].acquisitions == 0)
+            continue;
+        snprintf(labels, sizeof(labels), "lock=\"%s\"", lockNames[i]);
+        appendMetric(text, "zrtp_lock_contended_total", labels, snapshot.locks[i].contended);
+    }
+    appendHeader(text, "zrtp_lock_wait_seconds_total", "counter", "Time the threads waited for the ZRTP locks.");
+    for (int32_t i = 0; i < NumberOfLockCategories; i++) {
+        if (snapshot.locks[i].acquisitions == 0)
+            continue;
+        snprintf(labels, sizeof(labels), "zrtp_lock_wait_seconds_total{lock=\"%s\"} %g\n", lockNames[i],
+                 snapshot.locks[i].waitTimeSum / 1000000000.0);
+        text.append(labels);
+    }
+    appendHeader(text, "zrtp_lock_hold_seconds", "histogram", "Time the threads held the ZRTP locks.");
+    for (int32_t i = 0; i < NumberOfLockCategories; i++) {
+        const LockCounters& lock = snapshot.locks[i];
+
+        if (lock.acquisitions == 0)
+            continue;
+        cumulative = 0;
+        for (int32_t bucket = 0; bucket < NumberOfHoldBuckets; bucket++) {
+            cumulative += lock.holdTime[bucket];
+            int64_t limit = getHoldBucketLimit(bucket);
+            if (limit >= 0)
+                snprintf(labels, sizeof(labels), "lock=\"%s\",le=\"%g\"", lockNames[i], limit / 1000000.0);
+            else
+                snprintf(labels, sizeof(labels), "lock=\"%s\",le=\"+Inf\"", lockNames[i]);
+            appendMetric(text, "zrtp_lock_hold_seconds_bucket", labels, cumulative);
+        }
+        snprintf(labels, sizeof(labels), "zrtp_lock_hold_seconds_sum{lock=\"%s\"} %g\n", lockNames[i],
+                 lock.holdTimeSum / 1000000000.0);
+        text.append(labels);
+        snprintf(labels, sizeof(labels), "lock=\"%s\"", lockNames[i]);
+        appendMetric(text, "zrtp_lock_hold_seconds_count", labels, cumulative);
+    }
+    return text;
+}
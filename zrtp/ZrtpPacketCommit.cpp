@@ -31,11 +31,35 @@ ZrtpPacketCommit::ZrtpPacketCommit() {
     setMessageType((uint8_t*)CommitMsg);
 }
 
+bool ZrtpPacketCommit::isLengthOk(commitType type) {
+    int32_t len = getLength();
+
+    switch (type) {
+    case DhExchange:
+        return len == COMMIT_DH_EX;
+    case MultiStream:
+        return len == COMMIT_MULTI;
+    case Preshared:
+        return len == COMMIT_PRSH;
+    }
+    return false;
+}
+
+// The setters of the HVI, nonce, and key ID set the length of the Commit, a ZRtp
+// object may prepare a DH Commit after a Preshared Commit.
+void ZrtpPacketCommit::setHvi(uint8_t* text) {
+    memcpy(commitHeader->hvi, text, sizeof(data.commit.hvi));
+    setLength(COMMIT_DH_EX);
+}
+
 void ZrtpPacketCommit::setNonce(uint8_t* text) {
     memcpy(commitHeader->hvi, text, sizeof(data.commit.hvi)-4*ZRTP_WORD_SIZE);
-    uint16_t len = getLength();
-    len -= 4;
-    setLength(len);
+    setLength(COMMIT_MULTI);
+}
+
+void ZrtpPacketCommit::setKeyId(uint8_t* text) {
+    memcpy(commitHeader->hvi+4*ZRTP_WORD_SIZE, text, 2*ZRTP_WORD_SIZE);
+    setLength(COMMIT_PRSH);
 }
 
 ZrtpPacketCommit::ZrtpPacketCommit(uint8_t *data) {
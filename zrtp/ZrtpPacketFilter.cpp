@@ -0,0 +1,173 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <cstring>
+
+#include <crypto/sha256.h>
+#include <libzrtpcpp/ZrtpPacketFilter.h>
+#include <libzrtpcpp/ZrtpStateClass.h>
+#include <common/zrtpByteOrder.h>
+
+// Fixed header of the ZRTP packet and the ZRTP message header
+static const size_t packetHeaderLength = 12;
+static const size_t messageHeaderLength = sizeof(zrtpPacketHeader_t);
+
+ZrtpPacketFilter::ZrtpPacketFilter(int32_t sourceRate, int32_t sourceBurst, int32_t keyRate, int32_t keyBurst):
+        sourceRate(sourceRate), sourceBurst(sourceBurst), keyRate(keyRate), keyBurst(keyBurst) {
+    reset();
+}
+
+void ZrtpPacketFilter::reset() {
+    for (int32_t i = 0; i < NumberOfSources; i++)
+        sources[i].used = false;
+    keyPackets.tokens = (int64_t)keyBurst * 1000;
+    keyPackets.last = std::chrono::steady_clock::now();
+    helloSeen = false;
+    memset(peerH3, 0, sizeof(peerH3));
+    memset(counters, 0, sizeof(counters));
+}
+
+int32_t ZrtpPacketFilter::getCounters(int32_t* buffer) {
+    memcpy(buffer, counters, sizeof(counters));
+    return NumberOfCounters;
+}
+
+bool ZrtpPacketFilter::takeToken(Bucket& bucket, int32_t rate, int32_t burst, TimePoint now) {
+
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - bucket.last).count();
+    if (elapsed > 0) {
+        bucket.tokens += elapsed * rate;              // rate per second is rate/1000 tokens per ms
+        if (bucket.tokens > (int64_t)burst * 1000)
+            bucket.tokens = (int64_t)burst * 1000;
+        bucket.last = now;
+    }
+    if (bucket.tokens < 1000)
+        return false;
+    bucket.tokens -= 1000;
+    return true;
+}
+
+/*
+ * Find the bucket of a source, a new source replaces the least recently active one.
+ */
+ZrtpPacketFilter::Bucket& ZrtpPacketFilter::sourceBucket(uint64_t source, TimePoint now) {
+
+    Bucket* oldest = &sources[0];
+    for (int32_t i = 0; i < NumberOfSources; i++) {
+        Bucket& bucket = sources[i];
+        if (!bucket.used) {
+            oldest = &bucket;
+            break;
+        }
+        if (bucket.source == source)
+            return bucket;
+        if (bucket.last < oldest->last)
+            oldest = &bucket;
+    }
+    oldest->source = source;
+    oldest->tokens = (int64_t)sourceBurst * 1000;
+    oldest->last = now;
+    oldest->used = true;
+    return *oldest;
+}
+
+bool ZrtpPacketFilter::checkPacket(const uint8_t* packet, size_t length, uint64_t source) {
+
+    // Structure: fixed header with ZRTP magic, message preamble, known type and a
+    // message length that matches the datagram
+    if (length < packetHeaderLength + sizeof(HelloAckPacket_t) || (packet[0] & 0xf0) != 0x10) {
+        counters[DroppedMalformed]++;
+        return false;
+    }
+    uint16_t words = zrtpLoadBe16(packet + packetHeaderLength + 2);
+
+    ZrtpMessageType type = ZrtpStateClass::classifyMessage(packet + packetHeaderLength + 4);
+    if (zrtpPacketMagic(packet) != ZRTP_MAGIC || zrtpLoadBe16(packet + packetHeaderLength) != 0x505a ||
+        type == TypeUnknown) {
+        counters[DroppedMalformed]++;
+        return false;
+    }
+    // The engine accepts Error and ErrorAck packets with a wrong length, see ZrtpStateClass::processEvent()
+    if (type != TypeError && type != TypeErrorAck &&
+        packetHeaderLength + words * ZRTP_WORD_SIZE + CRC_SIZE != length) {
+        counters[DroppedMalformed]++;
+        return false;
+    }
+
+    // Rate: of the source, and of the packets that cause DH computations
+    TimePoint now = std::chrono::steady_clock::now();
+    if (!takeToken(sourceBucket(source, now), sourceRate, sourceBurst, now)) {
+        counters[DroppedRate]++;
+        return false;
+    }
+    if ((type == TypeHello || type == TypeCommit || type == TypeDHPart1 || type == TypeDHPart2) &&
+        !takeToken(keyPackets, keyRate, keyBurst, now)) {
+        counters[DroppedRate]++;
+        return false;
+    }
+    return true;
+}
+
+bool ZrtpPacketFilter::checkBinding(const uint8_t* packet, size_t length) {
+
+    const uint8_t* message = packet + packetHeaderLength;
+    size_t messageLength = length - packetHeaderLength - CRC_SIZE;
+    uint8_t image[HASH_IMAGE_SIZE];
+    uint8_t h2[HASH_IMAGE_SIZE];
+
+    // RFC 6189, chapter 9: H3 = hash(H2), H2 = hash(H1), the hash chain uses SHA-256
+    switch (ZrtpStateClass::classifyMessage(message + 4)) {
+        case TypeHello: {
+            if (messageLength < messageHeaderLength + sizeof(Hello_t))
+                break;
+            const uint8_t* h3 = message + messageHeaderLength + ZRTP_WORD_SIZE + CLIENT_ID_SIZE;
+            if (!helloSeen) {
+                memcpy(peerH3, h3, HASH_IMAGE_SIZE);
+                helloSeen = true;
+                return true;
+            }
+            if (memcmp(peerH3, h3, HASH_IMAGE_SIZE) == 0)
+                return true;
+            break;
+        }
+        case TypeCommit:
+            if (!helloSeen || messageLength < messageHeaderLength + HASH_IMAGE_SIZE)
+                break;
+            sha256(message + messageHeaderLength, HASH_IMAGE_SIZE, image);
+            if (memcmp(peerH3, image, HASH_IMAGE_SIZE) == 0)
+                return true;
+            break;
+
+        case TypeDHPart1:
+        case TypeDHPart2:
+            if (!helloSeen || messageLength < messageHeaderLength + HASH_IMAGE_SIZE)
+                break;
+            sha256(message + messageHeaderLength, HASH_IMAGE_SIZE, h2);
+            sha256(h2, HASH_IMAGE_SIZE, image);
+            if (memcmp(peerH3, image, HASH_IMAGE_SIZE) == 0)
+                return true;
+            break;
+
+        default:
+            return true;
+    }
+    counters[DroppedBinding]++;
+    return false;
+}
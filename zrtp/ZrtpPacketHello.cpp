@@ -19,14 +19,37 @@
  */
 
 #include <ctype.h>
+#include <mutex>
 #include <libzrtpcpp/ZrtpPacketHello.h>
 
+/*
+ * Hello packet templates of recently used configurations. Sessions with the same
+ * configuration copy the template instead of building the packet again.
+ */
+#define HELLO_TEMPLATES 8
+
+static std::mutex templateLock;
+static ZrtpPacketHello helloTemplates[HELLO_TEMPLATES];
+static uint64_t templateFingerprints[HELLO_TEMPLATES];
+static int32_t numTemplates = 0;
+
 
 ZrtpPacketHello::ZrtpPacketHello() {
     DEBUGOUT((fprintf(stdout, "Creating Hello packet without data\n")));
 }
 
 void ZrtpPacketHello::configureHello(ZrtpConfigure* config) {
+    uint64_t fingerprint = config->getFingerprint();
+    {
+        std::lock_guard<std::mutex> guard(templateLock);
+        for (int32_t i = 0; i < numTemplates; i++) {
+            if (templateFingerprints[i] == fingerprint) {
+                configureHello(helloTemplates[i]);
+                return;
+            }
+        }
+    }
+
     // The NumSupported* data is in ZrtpTextData.h 
     nHash = config->getNumConfiguredAlgos(HashAlgorithm);
     nCipher = config->getNumConfiguredAlgos(CipherAlgorithm);
@@ -91,7 +114,39 @@ void ZrtpPacketHello::configureHello(ZrtpConfigure* config) {
         AlgorithmEnum& sas = config->getAlgoAt(SasType, i);
         setSasType(i, (int8_t*)sas.getName());
     }
-    *((uint32_t*)&helloHeader->flags) = zrtpHtonl(lenField);
+    zrtpStoreBe32(reinterpret_cast<uint8_t*>(&helloHeader->flags), lenField);
+
+    std::lock_guard<std::mutex> guard(templateLock);
+    for (int32_t i = 0; i < numTemplates; i++) {
+        if (templateFingerprints[i] == fingerprint)
+            return;
+    }
+    if (numTemplates < HELLO_TEMPLATES) {
+        helloTemplates[numTemplates].configureHello(*this);
+        templateFingerprints[numTemplates] = fingerprint;
+        numTemplates++;
+    }
+}
+
+void ZrtpPacketHello::configureHello(const ZrtpPacketHello& hello) {
+    nHash = hello.nHash;
+    nCipher = hello.nCipher;
+    nPubkey = hello.nPubkey;
+    nSas = hello.nSas;
+    nAuth = hello.nAuth;
+
+    oHash = hello.oHash;
+    oCipher = hello.oCipher;
+    oAuth = hello.oAuth;
+    oPubkey = hello.oPubkey;
+    oSas = hello.oSas;
+    oHmac = hello.oHmac;
+
+    void* allocated = &data;
+    memcpy(allocated, hello.data, sizeof(data));
+
+    zrtpHeader = (zrtpPacketHeader_t *)&((HelloPacket_t *)allocated)->hdr;	// the standard header
+    helloHeader = (Hello_t *)&((HelloPacket_t *)allocated)->hello;
 }
 
 ZrtpPacketHello::ZrtpPacketHello(uint8_t *data) {
@@ -106,8 +161,7 @@ ZrtpPacketHello::ZrtpPacketHello(uint8_t *data) {
         return;
     }
 
-    uint32_t t = *((uint32_t*)&helloHeader->flags);
-    uint32_t temp = zrtpNtohl(t);
+    uint32_t temp = zrtpLoadBe32(reinterpret_cast<const uint8_t*>(&helloHeader->flags));
 
     nHash = (temp & (0xf << 16)) >> 16;
     nHash &= 0x7;                              // restrict to max 7 algorithms
@@ -30,11 +30,7 @@
 #include <srtp/CryptoContextCtrl.h>
 #include <cryptcommon/ZrtpRandom.h>
 #include <crypto/hmac384.h>
-
-
-#if defined(_WIN32) || defined(_WIN64)
-# define snprintf _snprintf
-#endif
+#include <common/MemoryUsage.h>
 
 // SRTP authentication tag length is 80 bits = 10 bytes
 #define ZRTP_TUNNEL_AUTH_LEN  10
@@ -48,27 +44,9 @@
  */
 
 /*
- * Buffer size for names and other strings inside the crypto string. The parse
- * format below restricts parsing to 99 char to provide space for the @c nul byte.
- */
-#define MAX_INNER_LEN 100
-
-/*
- * This format scans a received SDES crypto attribute string according to the
- * grammer shown above but without a "a=crypto:" prefix.
- *
- * The format string parses:
- * - %d - the tag as decimal value
- * - %s - the crypto suite name, limited to 99 chars (see MAX_INNER_LEN)
- * - %s - the key parameters, limited to 99 chars
- * - %n - the number of parsed characters to far. The pointer to the session
- *   parameters is: cryptoString + numParsedChars.
+ * The maximum number of digits of the tag.
  */
-static const char parseCrypto[] = "%d %99s %99s %n";
-
-// static const int64_t maxTagValue = 999999999; For some later use
-
-static const int minElementsCrypto = 3;
+static const int maxTagDigits = 9;
 
 /*
  * The ABNF grammar for the key-param (from RFC 4568):
@@ -84,23 +62,13 @@ static const int minElementsCrypto = 3;
  *  srtp-key-info       = key-salt ["|" lifetime] ["|" mki]
  *
  */
+static const char keyMethod[] = "inline:";
 
-/*
- * This format parses the key parameter string which is never longer than
- * 99 chars (see parse string above):
- * - the fixed string "inline:"
- * - %[A-Za-z0-9+/=] - base 64 characters of master key||master salt
- * - the fixed separator character '|'
- * - %[0-9^] - the lifetime infomration as string that contains digits and ^
- * - the fixed separator character '|'
- * - %[0-9]:%d - parses and strore MKI value and MKI length, separated by ':'
- *
- * If the key parameter string does not contain the optional fields lifetime
- * and MKI information the respective parameters are not filled.
- */
-static const char parseKeyParam[] = " inline:%[A-Za-z0-9+/=]|%[0-9^]|%[0-9]:%d";
+static inline bool isWsp(char c) { return c == ' ' || c == '\t'; }
 
-static const int minElementsKeyParam = 1;
+static inline bool isB64Char(char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '+' || c == '/' || c == '=';
+}
 
 typedef struct _cryptoMix {
     const char* name;
@@ -139,6 +107,36 @@ static suiteParam knownSuites[] = {
     {(ZrtpSdesStream::sdesSuites)0, nullptr, 0, 0, 0, nullptr, nullptr, 0, 0, 0}
 };
 
+static suiteParam* findSuite(const char* name, size_t length) {
+    for (suiteParam* sp = knownSuites; sp->name != nullptr; sp++) {
+        if (strlen(sp->name) == length && memcmp(sp->name, name, length) == 0)
+            return sp;
+    }
+    return nullptr;
+}
+
+/*
+ * Append a string to a bounded output buffer, the functions always leave room
+ * for the terminating nul byte.
+ */
+static bool appendString(char* out, size_t maxLen, size_t* pos, const char* str, size_t length) {
+    if (*pos + length >= maxLen)
+        return false;
+    memcpy(out + *pos, str, length);
+    *pos += length;
+    return true;
+}
+
+static bool appendDecimal(char* out, size_t maxLen, size_t* pos, uint32_t value) {
+    char digits[10];
+    size_t n = 0;
+    do {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    return appendString(out, maxLen, pos, &digits[sizeof(digits) - n], n);
+}
+
 ZrtpSdesStream::ZrtpSdesStream(const sdesSuites s) :
     state(STREAM_INITALIZED), suite(s), recvSrtp(nullptr), recvSrtcp(nullptr), sendSrtp(nullptr),
     sendSrtcp(nullptr), srtcpIndex(0), recvZrtpTunnel(nullptr), sendZrtpTunnel(nullptr), cryptoMixHashLength(0),
@@ -157,16 +155,20 @@ void ZrtpSdesStream::close() {
     recvSrtp = nullptr;
 
     delete sendSrtcp;
-    sendSrtp = nullptr;
+    sendSrtcp = nullptr;
 
     delete recvSrtcp;
-    recvSrtp = nullptr;
+    recvSrtcp = nullptr;
 
     delete recvZrtpTunnel;
     recvZrtpTunnel = nullptr;
 
     delete sendZrtpTunnel;
     sendZrtpTunnel = nullptr;
+
+    // The keys of tunnel contexts that were not created yet
+    memset(localKeySalt, 0, sizeof(localKeySalt));
+    memset(remoteKeySalt, 0, sizeof(remoteKeySalt));
 }
 
 bool ZrtpSdesStream::createSdes(char *cryptoString, size_t *maxLen, bool sipInvite) {
@@ -256,12 +258,33 @@ int ZrtpSdesStream::incomingRtp(uint8_t *packet, size_t length, size_t *newLengt
 }
 
 
+bool ZrtpSdesStream::outgoingRtpTwice(CryptoContext* outer, uint8_t *packet, size_t length, size_t *newLength) {
+
+    if (state != SDES_SRTP_ACTIVE || sendSrtp == nullptr) {
+        return SrtpHandler::protect(outer, packet, length, newLength);
+    }
+    return SrtpHandler::protectTwice(sendSrtp, outer, packet, length, newLength);
+}
+
+int ZrtpSdesStream::incomingRtpTwice(CryptoContext* outer, uint8_t *packet, size_t length, size_t *newLength,
+                                     bool* outerDone, SrtpErrorData* errorData) {
+
+    if (state != SDES_SRTP_ACTIVE || recvSrtp == nullptr) {
+        int32_t rc = SrtpHandler::unprotect(outer, packet, length, newLength, errorData);
+        *outerDone = (rc == 1);
+        return rc;
+    }
+    return SrtpHandler::unprotectTwice(outer, recvSrtp, packet, length, newLength, outerDone, errorData);
+}
+
 bool ZrtpSdesStream::outgoingZrtpTunnel(uint8_t *packet, size_t length, size_t *newLength) {
 
-    if (state != SDES_SRTP_ACTIVE || sendZrtpTunnel == nullptr) {
+    if (state != SDES_SRTP_ACTIVE || sendSrtp == nullptr) {
         *newLength = length;
         return true;
     }
+    if (sendZrtpTunnel == nullptr)
+        createZrtpTunnel(true);
     bool rc = SrtpHandler::protect(sendZrtpTunnel, packet, length, newLength);
     if (rc)
         ;//protect++;
@@ -269,10 +292,12 @@ bool ZrtpSdesStream::outgoingZrtpTunnel(uint8_t *packet, size_t length, size_t *
 }
 
 int ZrtpSdesStream::incomingZrtpTunnel(uint8_t *packet, size_t length, size_t *newLength, SrtpErrorData* errorData) {
-    if (state != SDES_SRTP_ACTIVE || recvZrtpTunnel == nullptr) {    // SRTP inactive, just return with newLength set
+    if (state != SDES_SRTP_ACTIVE || recvSrtp == nullptr) {    // SRTP inactive, just return with newLength set
         *newLength = length;
         return 1;
     }
+    if (recvZrtpTunnel == nullptr)
+        createZrtpTunnel(false);
     int32_t rc = SrtpHandler::unprotect(recvZrtpTunnel, packet, length, newLength, errorData);
     if (rc == 1) {
 //            unprotect++
@@ -310,6 +335,20 @@ const char* ZrtpSdesStream::getAuthAlgo() {
         return "HMAC-SHA1 32 bit";
 }
 
+void ZrtpSdesStream::addMemoryUsage(MemoryUsage& usage) const {
+    usage.add(MemoryUsage::Session, sizeof(ZrtpSdesStream));
+
+    CryptoContext* contexts[] = {recvSrtp, sendSrtp, recvZrtpTunnel, sendZrtpTunnel};
+    for (CryptoContext* context : contexts) {
+        if (context != NULL)
+            context->addMemoryUsage(usage);
+    }
+    if (recvSrtcp != NULL)
+        recvSrtcp->addMemoryUsage(usage);
+    if (sendSrtcp != NULL)
+        sendSrtcp->addMemoryUsage(usage);
+}
+
 size_t ZrtpSdesStream::getCryptoMixAttribute(char *algoNames, size_t length) {
 
     if (length < MIX_HMAC_STRING_MIN_LEN)
@@ -335,38 +374,28 @@ size_t ZrtpSdesStream::getCryptoMixAttribute(char *algoNames, size_t length) {
 
 bool ZrtpSdesStream::setCryptoMixAttribute(const char *algoNames) {
 
-    size_t len = strlen(algoNames);
-    if (len == 0)
-        return false;
-
-    std::string algoIn(algoNames);
-    algoIn += ' ';
-
-    // split input name string and lookup if we support one of the offered algorithms
-    // We take the first match.
-    std::string delimiters = " ";
-    size_t current;
-    size_t next = 0;
-
-    do {
-        current = next;
-        next = algoIn.find_first_of(delimiters, current);
-        if (next == std::string::npos)
-            break;
-
-        std::string tmps = algoIn.substr(current, next - current);
-        next++;                             // Skip delimiter
-        const char* nm = tmps.c_str();
+    // Split the input names at blanks and lookup if we support one of the
+    // offered algorithms. We take the first match.
+    const char* nm = algoNames;
+    while (*nm != '\0') {
+        if (*nm == ' ') {
+            nm++;
+            continue;
+        }
+        size_t len = 0;
+        while (nm[len] != '\0' && nm[len] != ' ')
+            len++;
 
         for (cryptoMix* cp = knownMixAlgos; cp->name != nullptr; cp++) {
-            if (strncmp(cp->name, nm, strlen(cp->name)) == 0) {
+            size_t nameLen = strlen(cp->name);
+            if (len >= nameLen && memcmp(cp->name, nm, nameLen) == 0) {
                 cryptoMixHashLength = cp->hashLength;
                 cryptoMixHashType = cp->hashType;
                 return true;
             }
         }
-    } while (true);
-
+        nm += len;
+    }
     return false;
 }
 
@@ -393,26 +422,15 @@ static int _random(unsigned char *output, size_t len)
 }
 #endif
 
+// The buffer codecs do not use lookup tables, the run time does not depend on the keys
 static int b64Encode(const uint8_t *binData, int32_t binLength, char *b64Data, int32_t b64Length)
 {
-    base64_encodestate _state = {};
-    int codelength;
-
-    base64_init_encodestate(&_state, 0);
-    codelength = base64_encode_block(binData, binLength, b64Data, &_state);
-    codelength += base64_encode_blockend(b64Data+codelength, &_state);
-
-    return codelength;
+    return base64_encode_buffer(binData, binLength, b64Data, b64Length);
 }
 
 static int b64Decode(const char *b64Data, int32_t b64length, uint8_t *binData, int32_t binLength)
 {
-    base64_decodestate _state = {};
-    int codelength;
-
-    base64_init_decodestate(&_state);
-    codelength = base64_decode_block(b64Data, b64length, binData, &_state);
-    return codelength;
+    return base64_decode_buffer(b64Data, b64length, binData, binLength);
 }
 
 void* createSha384HmacContext(const uint8_t* key, uint64_t keyLength);
@@ -564,24 +582,6 @@ void ZrtpSdesStream::createSrtpContexts(bool sipInvite) {
                                  localTagLength);            // authentication tag len
     sendSrtp->deriveSrtpKeys(0L);
 
-    sendZrtpTunnel = new CryptoContext(0,                     // SSRC (used for lookup)
-                                 0,                     // Roll-Over-Counter (ROC)
-                                 0L,                    // keyderivation << 48,
-                                 localCipher,                // encryption algo
-                                 localAuthn,                 // authtentication algo
-                                 localKeySalt,               // Master Key
-                                 localKeyLenBytes,           // Master Key length
-                                 &localKeySalt[localKeyLenBytes], // Master Salt
-                                 localSaltLenBytes,          // Master Salt length
-                                 localKeyLenBytes,           // encryption keylen
-                                 localAuthKeyLen,            // authentication key len (HMAC key lenght)
-                                 localSaltLenBytes,          // session salt len
-                                 ZRTP_TUNNEL_AUTH_LEN);      // authentication tag len
-
-    sendZrtpTunnel->setLabelbase(ZRTP_TUNNEL_LABEL);
-    sendZrtpTunnel->deriveSrtpKeys(0L);
-    memset(localKeySalt, 0, sizeof(localKeySalt));
-
     recvSrtp = new CryptoContext(0,                     // SSRC (used for lookup)
                                  0,                     // Roll-Over-Counter (ROC)
                                  0L,                    // keyderivation << 48,
@@ -597,6 +597,32 @@ void ZrtpSdesStream::createSrtpContexts(bool sipInvite) {
                                  remoteTagLength);            // authentication tag len
     recvSrtp->deriveSrtpKeys(0L);
 
+    // Most calls do not tunnel ZRTP, thus keep the keys and create the tunnel
+    // contexts with the first tunneled packet, see createZrtpTunnel().
+}
+
+void ZrtpSdesStream::createZrtpTunnel(bool sender) {
+
+    if (sender) {
+        sendZrtpTunnel = new CryptoContext(0,                     // SSRC (used for lookup)
+                                     0,                     // Roll-Over-Counter (ROC)
+                                     0L,                    // keyderivation << 48,
+                                     localCipher,                // encryption algo
+                                     localAuthn,                 // authtentication algo
+                                     localKeySalt,               // Master Key
+                                     localKeyLenBytes,           // Master Key length
+                                     &localKeySalt[localKeyLenBytes], // Master Salt
+                                     localSaltLenBytes,          // Master Salt length
+                                     localKeyLenBytes,           // encryption keylen
+                                     localAuthKeyLen,            // authentication key len (HMAC key lenght)
+                                     localSaltLenBytes,          // session salt len
+                                     ZRTP_TUNNEL_AUTH_LEN);      // authentication tag len
+
+        sendZrtpTunnel->setLabelbase(ZRTP_TUNNEL_LABEL);
+        sendZrtpTunnel->deriveSrtpKeys(0L);
+        memset(localKeySalt, 0, sizeof(localKeySalt));
+        return;
+    }
     recvZrtpTunnel = new CryptoContext(0,                     // SSRC (used for lookup)
                                  0,                     // Roll-Over-Counter (ROC)
                                  0L,                    // keyderivation << 48,
@@ -618,7 +644,6 @@ void ZrtpSdesStream::createSrtpContexts(bool sipInvite) {
 
 bool ZrtpSdesStream::createSdesProfile(char *cryptoString, size_t *maxLen) {
 
-    char b64keySalt[(MAX_KEY_LEN + MAX_SALT_LEN) * 2] = {'\0'};
     uint32_t sidx;
     int32_t b64Len;
 
@@ -647,29 +672,32 @@ bool ZrtpSdesStream::createSdesProfile(char *cryptoString, size_t *maxLen) {
     if (tag == -1)
         tag = 1;
 
-    // Get B64 code for master key and master salt and then construct the SDES crypto string
-    b64Len = b64Encode(localKeySalt, localKeyLenBytes + localSaltLenBytes, b64keySalt, sizeof(b64keySalt));
-    b64keySalt[b64Len] = '\0';
-    memset(cryptoString, 0, *maxLen);
-    *maxLen = snprintf(cryptoString, *maxLen-1, "%d %s inline:%s", tag, pSuite->name, b64keySalt);
+    // Construct the SDES crypto string, the B64 code of master key and master salt goes
+    // directly into the output buffer
+    if (*maxLen == 0)
+        return false;
+    size_t pos = 0;
+    if (!appendDecimal(cryptoString, *maxLen, &pos, (uint32_t)tag) ||
+        !appendString(cryptoString, *maxLen, &pos, " ", 1) ||
+        !appendString(cryptoString, *maxLen, &pos, pSuite->name, strlen(pSuite->name)) ||
+        !appendString(cryptoString, *maxLen, &pos, " ", 1) ||
+        !appendString(cryptoString, *maxLen, &pos, keyMethod, sizeof(keyMethod) - 1)) {
+        cryptoString[0] = '\0';
+        return false;
+    }
+    b64Len = b64Encode(localKeySalt, localKeyLenBytes + localSaltLenBytes, cryptoString + pos, (int32_t)(*maxLen - pos - 1));
+    if (b64Len < 0) {
+        cryptoString[0] = '\0';
+        return false;
+    }
+    pos += b64Len;
+    cryptoString[pos] = '\0';
+    *maxLen = pos;
 
     return true;
 }
 
 bool ZrtpSdesStream::parseCreateSdesProfile(const char *cryptoStr, size_t length, sdesSuites *parsedSuite, int32_t *outTag) {
-    int elements,  i;
-    int charsScanned;
-    int mkiLength = 0;
-    uint32_t sidx;
-
-    char cryptoString[MAX_CRYPT_STRING_LEN+1] = {'\0'};
-
-    /* Parsed strings */
-    char suiteName[MAX_INNER_LEN]  = {'\0'};
-    char keyParams[MAX_INNER_LEN]  = {'\0'};
-    char keySaltB64[MAX_INNER_LEN] = {'\0'};
-    char lifetime[MAX_INNER_LEN]   = {'\0'};
-    char mkiVal[MAX_INNER_LEN]     = {'\0'};
 
     if (length == 0)
         length = strlen(cryptoStr);
@@ -677,41 +705,64 @@ bool ZrtpSdesStream::parseCreateSdesProfile(const char *cryptoStr, size_t length
     if (length > MAX_CRYPT_STRING_LEN) {
         return false;
     }
-    memcpy(cryptoString, cryptoStr, length);   // make own copy, null terminated
+    const char* end = (const char*)memchr(cryptoStr, '\0', length);
+    if (end == nullptr)
+        end = cryptoStr + length;
 
-    *outTag = -1;
-    elements = sscanf(cryptoString, parseCrypto, outTag, suiteName, keyParams, &charsScanned);
+    // Parse "tag 1*WSP crypto-suite 1*WSP key-params", the session parameters
+    // after the key parameters are not used
+    const char* cp = cryptoStr;
+    while (cp < end && isWsp(*cp))
+        cp++;
 
-    if (elements < minElementsCrypto) {        // Do we have enough elements in the string
-        return false;
+    int32_t tagValue = 0;
+    int digits = 0;
+    while (cp < end && *cp >= '0' && *cp <= '9') {
+        if (++digits > maxTagDigits)
+            return false;
+        tagValue = tagValue * 10 + (*cp++ - '0');
     }
+    *outTag = -1;
+    if (digits == 0 || cp == end || !isWsp(*cp))
+        return false;
+    *outTag = tagValue;
 
-    for (sidx = 0; knownSuites[sidx].name != nullptr; sidx++) {  // Lookup crypto suite
-        if (!strcmp(knownSuites[sidx].name, suiteName))
-            break;
-    }
-    if (sidx >= sizeof(knownSuites)/sizeof(struct _suite)) {
+    while (cp < end && isWsp(*cp))
+        cp++;
+    const char* suiteName = cp;
+    while (cp < end && !isWsp(*cp))
+        cp++;
+
+    suiteParam *pSuite = findSuite(suiteName, (size_t)(cp - suiteName));
+    if (pSuite == nullptr) {
         return false;
     }
-    suiteParam *pSuite = &knownSuites[sidx];
+    if (cp == end || !isWsp(*cp))
+        return false;
     *parsedSuite = pSuite->suite;
 
-    /* Now scan the key parameters */
-    elements = sscanf(keyParams, parseKeyParam, keySaltB64, lifetime, mkiVal, &mkiLength);
+    /* Now scan the key parameters, currently we only accept the key||salt B64 string */
+    while (cp < end && isWsp(*cp))
+        cp++;
+    if ((size_t)(end - cp) < sizeof(keyMethod) - 1 || memcmp(cp, keyMethod, sizeof(keyMethod) - 1) != 0)
+        return false;
+    cp += sizeof(keyMethod) - 1;
 
-    if (elements != minElementsKeyParam) {     // Currently we only accept key||salt B64 string, no other parameters 
+    const char* keySaltB64 = cp;
+    while (cp < end && isB64Char(*cp))
+        cp++;
+    if (cp < end && !isWsp(*cp))        // lifetime, MKI or invalid characters
         return false;
-    }
 
     remoteKeyLenBytes = pSuite->keyLength / 8;
     remoteSaltLenBytes = pSuite->saltLength / 8;
 
-    if (strlen(keySaltB64) != pSuite->b64length) {  // Check if key||salt B64 string hast the correct length
+    if ((size_t)(cp - keySaltB64) != pSuite->b64length) {  // Check if key||salt B64 string hast the correct length
         return false;
     }
-    i = b64Decode(keySaltB64, pSuite->b64length, remoteKeySalt, remoteKeyLenBytes + remoteSaltLenBytes);
+    int32_t i = b64Decode(keySaltB64, pSuite->b64length, remoteKeySalt, remoteKeyLenBytes + remoteSaltLenBytes);
 
-    if (i != (remoteKeyLenBytes + remoteSaltLenBytes)) {  // Did the B64 decode delivered enough data for key||salt
+    if (i != (int32_t)(remoteKeyLenBytes + remoteSaltLenBytes)) {  // Did the B64 decode delivered enough data for key||salt
         return false;
     }
 
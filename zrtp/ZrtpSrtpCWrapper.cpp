@@ -0,0 +1,187 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <stddef.h>
+
+#include <srtp/CryptoContext.h>
+#include <srtp/CryptoContextCtrl.h>
+#include <srtp/SrtpHandler.h>
+
+// ZrtpCWrapper.h defines macros that clash with the C++ enums, include it last
+#include <libzrtpcpp/ZrtpSrtpCWrapper.h>
+
+static_assert(sizeof(zrtp_SrtpPacket) == sizeof(PacketSpan) &&
+              offsetof(zrtp_SrtpPacket, newLength) == offsetof(PacketSpan, newLength) &&
+              offsetof(zrtp_SrtpPacket, result) == offsetof(PacketSpan, result),
+              "zrtp_SrtpPacket must have the layout of PacketSpan");
+
+struct zrtpSrtpContext
+{
+    CryptoContext* srtp;
+    CryptoContextCtrl* srtcp;
+};
+
+ZrtpSrtpContext* zrtp_newSrtpContext(const C_SrtpSecret_t* secrets, int32_t part)
+{
+    int32_t cipher;
+    int32_t authn;
+    int32_t authKeyLen;
+
+    if (secrets == NULL || (part != ForSender && part != ForReceiver))
+        return NULL;
+
+    switch (secrets->authAlgorithm) {
+        case zrtp_Sha1:
+            authn = SrtpAuthenticationSha1Hmac;
+            authKeyLen = 20;
+            break;
+        case zrtp_Skein:
+            authn = SrtpAuthenticationSkeinHmac;
+            authKeyLen = 32;
+            break;
+        case zrtp_AesGcm:
+        case zrtp_ChaCha20Poly1305:
+            authn = SrtpAuthenticationNull;
+            authKeyLen = 0;
+            break;
+        default:
+            return NULL;
+    }
+    switch (secrets->symEncAlgorithm) {
+        case zrtp_Aes:
+            cipher = SrtpEncryptionAESCM;
+            break;
+        case zrtp_TwoFish:
+            cipher = SrtpEncryptionTWOCM;
+            break;
+        case zrtp_ChaCha20:
+            cipher = SrtpEncryptionCHACHA20POLY1305;
+            break;
+        default:
+            return NULL;
+    }
+
+    // The sender uses the keys of its own role, the receiver uses the keys of
+    // the peer's role
+    bool initiatorKeys = (secrets->role == Initiator) == (part == ForSender);
+    uint8_t* key = (uint8_t*)(initiatorKeys ? secrets->keyInitiator : secrets->keyResponder);
+    int32_t keyLen = (initiatorKeys ? secrets->initKeyLen : secrets->respKeyLen) / 8;
+    uint8_t* salt = (uint8_t*)(initiatorKeys ? secrets->saltInitiator : secrets->saltResponder);
+    int32_t saltLen = (initiatorKeys ? secrets->initSaltLen : secrets->respSaltLen) / 8;
+
+    // AES-GCM: the cipher mode authenticates, no separate authentication
+    if (secrets->authAlgorithm == zrtp_AesGcm)
+        cipher = (keyLen == 16) ? SrtpEncryptionAESGCM128 : SrtpEncryptionAESGCM256;
+    if (secrets->authAlgorithm == zrtp_ChaCha20Poly1305)
+        cipher = SrtpEncryptionCHACHA20POLY1305;
+
+    ZrtpSrtpContext* srtpContext = new ZrtpSrtpContext;
+    srtpContext->srtp = new CryptoContext(0, 0, 0L, cipher, authn, key, keyLen, salt, saltLen,
+                                          keyLen, authKeyLen, saltLen, secrets->srtpAuthTagLen / 8);
+    srtpContext->srtcp = new CryptoContextCtrl(0, cipher, authn, key, keyLen, salt, saltLen,
+                                               keyLen, authKeyLen, saltLen, secrets->srtpAuthTagLen / 8);
+    srtpContext->srtp->deriveSrtpKeys(0L, srtpContext->srtcp);
+
+    return srtpContext;
+}
+
+void zrtp_freeSrtpContext(ZrtpSrtpContext* srtpContext)
+{
+    if (srtpContext == NULL)
+        return;
+
+    delete srtpContext->srtp;
+    delete srtpContext->srtcp;
+    delete srtpContext;
+}
+
+int32_t zrtp_protectSrtp(ZrtpSrtpContext* srtpContext, uint8_t* buffer, size_t length, size_t* newLength)
+{
+    if (srtpContext == NULL)
+        return 0;
+    return SrtpHandler::protect(srtpContext->srtp, buffer, length, newLength) ? 1 : 0;
+}
+
+int32_t zrtp_unprotectSrtp(ZrtpSrtpContext* srtpContext, uint8_t* buffer, size_t length, size_t* newLength)
+{
+    if (srtpContext == NULL)
+        return 0;
+    return SrtpHandler::unprotect(srtpContext->srtp, buffer, length, newLength);
+}
+
+int32_t zrtp_protectSrtpBatch(ZrtpSrtpContext* srtpContext, zrtp_SrtpPacket packets[], int32_t count)
+{
+    if (srtpContext == NULL)
+        return 0;
+    return SrtpHandler::protectBatch(srtpContext->srtp, reinterpret_cast<PacketSpan*>(packets), count);
+}
+
+// Number of packets per call of SrtpHandler::protectMulti
+static const int32_t multiPackets = 16;
+
+int32_t zrtp_protectSrtpMulti(ZrtpSrtpContext* srtpContexts[], zrtp_SrtpPacket packets[], int32_t count)
+{
+    CryptoContext* contexts[multiPackets];
+    int32_t done = 0;
+
+    for (int32_t base = 0; base < count; base += multiPackets) {
+        int32_t number = (count - base < multiPackets) ? count - base : multiPackets;
+
+        for (int32_t i = 0; i < number; i++)
+            contexts[i] = (srtpContexts[base + i] != NULL) ? srtpContexts[base + i]->srtp : NULL;
+        done += SrtpHandler::protectMulti(contexts, reinterpret_cast<PacketSpan*>(packets + base), number);
+    }
+    return done;
+}
+
+int32_t zrtp_unprotectSrtpBatch(ZrtpSrtpContext* srtpContext, zrtp_SrtpPacket packets[], int32_t count)
+{
+    if (srtpContext == NULL)
+        return 0;
+    return SrtpHandler::unprotectBatch(srtpContext->srtp, reinterpret_cast<PacketSpan*>(packets), count);
+}
+
+int32_t zrtp_protectSrtcp(ZrtpSrtpContext* srtpContext, uint8_t* buffer, size_t length, size_t* newLength)
+{
+    if (srtpContext == NULL)
+        return 0;
+    return SrtpHandler::protectCtrl(srtpContext->srtcp, buffer, length, newLength) ? 1 : 0;
+}
+
+int32_t zrtp_unprotectSrtcp(ZrtpSrtpContext* srtpContext, uint8_t* buffer, size_t length, size_t* newLength)
+{
+    if (srtpContext == NULL)
+        return 0;
+    return SrtpHandler::unprotectCtrl(srtpContext->srtcp, buffer, length, newLength);
+}
+
+int32_t zrtp_protectSrtcpBatch(ZrtpSrtpContext* srtpContext, zrtp_SrtpPacket packets[], int32_t count)
+{
+    if (srtpContext == NULL)
+        return 0;
+    return SrtpHandler::protectCtrlBatch(srtpContext->srtcp, reinterpret_cast<PacketSpan*>(packets), count);
+}
+
+int32_t zrtp_unprotectSrtcpBatch(ZrtpSrtpContext* srtpContext, zrtp_SrtpPacket packets[], int32_t count)
+{
+    if (srtpContext == NULL)
+        return 0;
+    return SrtpHandler::unprotectCtrlBatch(srtpContext->srtcp, reinterpret_cast<PacketSpan*>(packets), count);
+}
@@ -20,10 +20,14 @@
 
 #include <iostream>
 #include <cstdlib>
-#include <ctype.h>
+#include <cstring>
 
 #include <libzrtpcpp/ZRtp.h>
 #include <libzrtpcpp/ZrtpStateClass.h>
+#include <libzrtpcpp/ZrtpDHPool.h>
+#include <cryptcommon/ZrtpRandom.h>
+#include <common/zrtpProbes.h>
+#include <common/zrtpByteOrder.h>
 
 using namespace std;
 using namespace GnuZrtpCodes;
@@ -45,8 +49,9 @@ state_t states[numberOfStates] = {
 };
 
 
-ZrtpStateClass::ZrtpStateClass(ZRtp *p) : parent(p), commitPkt(NULL), t1Resend(20), t1ResendExtend(60), t2Resend(10),
-                                          multiStream(false), secSubstate(Normal), sentVersion(0) {
+ZrtpStateClass::ZrtpStateClass(ZRtp *p) : parent(p), msgType(TypeUnknown), commitPkt(NULL), t1Resend(20), t1ResendExtend(60), t2Resend(10),
+                                          multiStream(false), fastStart(false), secSubstate(Normal), sentVersion(0), sentTime(0), srtt(-1), rttvar(0),
+                                          admitted(false), admissionQueued(false), commitDelayed(false), deferredPackets(0) {
 
     engine = new ZrtpStates(states, numberOfStates, Initial);
     memset(retryCounters, 0, sizeof(retryCounters));
@@ -59,6 +64,11 @@ ZrtpStateClass::ZrtpStateClass(ZRtp *p) : parent(p), commitPkt(NULL), t1Resend(2
     T2.start = 150;
     T2.maxResend = t2Resend;
     T2.capping = 1200;
+
+    // Retry the admission of a delayed Commit for about five seconds
+    TA.start = 100;
+    TA.maxResend = 6;
+    TA.capping = 1600;
 }
 
 ZrtpStateClass::~ZrtpStateClass(void) {
@@ -74,40 +84,104 @@ ZrtpStateClass::~ZrtpStateClass(void) {
         event = &ev;
         engine->processEvent(*this);
     }
+    releaseAdmission();
     delete engine;
 }
 
+/*
+ * Build the lower case value of a 4 character message type word. Or-ing 0x20 maps
+ * upper case letters to lower case and keeps digits and spaces unchanged.
+ */
+static constexpr uint32_t typeWord(const char* w) {
+    return ((uint32_t)(w[0] | 0x20) << 24) | ((uint32_t)(w[1] | 0x20) << 16) |
+           ((uint32_t)(w[2] | 0x20) << 8) | (uint32_t)(w[3] | 0x20);
+}
+
+void ZrtpStateClass::nextState(int32_t state) {
+    ZRTP_PROBE4(zrtp_state, parent, engine->getState(), state, msgType);
+    engine->nextState(state);
+
+    if (state != AckSent)
+        commitDelayed = false;
+
+    // The handshake passed the DH states or stopped
+    if ((admitted || admissionQueued) && state != AckSent && state != AckDetected && state != WaitCommit &&
+        state != CommitSent && state != WaitDHPart2)
+        releaseAdmission();
+}
+
+ZrtpMessageType ZrtpStateClass::classifyMessage(const uint8_t* msgTypeBlock) {
+
+    uint32_t w0 = zrtpLoadBe32(msgTypeBlock) | 0x20202020;
+    uint32_t w1 = zrtpLoadBe32(msgTypeBlock + sizeof(uint32_t)) | 0x20202020;
+
+    switch (w0) {
+        case typeWord("hell"):
+            return w1 == typeWord("o   ") ? TypeHello : w1 == typeWord("oack") ? TypeHelloAck : TypeUnknown;
+        case typeWord("comm"):
+            return w1 == typeWord("it  ") ? TypeCommit : TypeUnknown;
+        case typeWord("dhpa"):
+            return w1 == typeWord("rt1 ") ? TypeDHPart1 : w1 == typeWord("rt2 ") ? TypeDHPart2 : TypeUnknown;
+        case typeWord("conf"):
+            return w1 == typeWord("irm1") ? TypeConfirm1 : w1 == typeWord("irm2") ? TypeConfirm2 :
+                   w1 == typeWord("2ack") ? TypeConf2Ack : TypeUnknown;
+        case typeWord("erro"):
+            return w1 == typeWord("r   ") ? TypeError : w1 == typeWord("rack") ? TypeErrorAck : TypeUnknown;
+        case typeWord("gocl"):
+            return w1 == typeWord("ear ") ? TypeGoClear : TypeUnknown;
+        case typeWord("clea"):
+            return w1 == typeWord("rack") ? TypeClearAck : TypeUnknown;
+        case typeWord("ping"):
+            return w1 == typeWord("    ") ? TypePing : w1 == typeWord("ack ") ? TypePingAck : TypeUnknown;
+        case typeWord("sasr"):
+            return w1 == typeWord("elay") ? TypeSASrelay : TypeUnknown;
+        case typeWord("rela"):
+            return w1 == typeWord("yack") ? TypeRelayAck : TypeUnknown;
+        default:
+            return TypeUnknown;
+    }
+}
+
 void ZrtpStateClass::processEvent(Event *ev) {
 
-    char *msg, first, middle, last;
-    uint8_t *pkt;
+    parent->synchEnter();
+    handleEvent(ev);
+    parent->synchLeave();
+}
+
+void ZrtpStateClass::processEvents(Event *events, int32_t count) {
 
     parent->synchEnter();
+    for (int32_t i = 0; i < count; i++)
+        handleEvent(&events[i]);
+    parent->synchLeave();
+}
+
+void ZrtpStateClass::handleEvent(Event *ev) {
+
+    uint8_t *pkt;
 
     event = ev;
+    msgType = TypeUnknown;
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
-        first = tolower(*msg);
-        middle = tolower(*(msg+4));
-        last = tolower(*(msg+7));
+        msgType = classifyMessage(pkt + 4);
 
         // Sanity check of packet size for all states except WaitErrorAck.
         if (!inState(WaitErrorAck)) {
-            uint16_t totalLength = *(uint16_t*)(pkt+2);
-            totalLength = zrtpNtohs(totalLength) * ZRTP_WORD_SIZE;
+            uint16_t totalLength = zrtpLoadBe16(pkt + 2) * ZRTP_WORD_SIZE;
             totalLength += 12 + sizeof(uint32_t);           // 12 bytes is fixed header, uint32_t is CRC
 
             if (totalLength != ev->length) {
                 fprintf(stderr, "Total length does not match received length: %d - %ld\n", totalLength, (long int)(ev->length & 0xffff));
                 sendErrorPacket(MalformedPacket);
-                parent->synchLeave();
                 return;
             }
         }
+        parent->recordMessagePhase(msgType, false);
 
         // Check if this is an Error packet.
-        if (first == 'e' && middle =='r' && last == ' ') {
+        if (msgType == TypeError) {
             /*
              * Process a received Error packet.
              *
@@ -122,21 +196,19 @@ void ZrtpStateClass::processEvent(Event *ev) {
             parent->sendPacketZRTP(static_cast<ZrtpPacketBase *>(eapkt));
             event->type = ErrorPkt;
         }
-        else if (first == 'p' && middle == ' ' && last == ' ') {
+        else if (msgType == TypePing) {
             ZrtpPacketPing ppkt(pkt);
             ZrtpPacketPingAck* ppktAck = parent->preparePingAck(&ppkt);
             if (ppktAck != NULL) {          // ACK only to valid PING packet, otherwise ignore it
                 parent->sendPacketZRTP(static_cast<ZrtpPacketBase *>(ppktAck));
             }
-            parent->synchLeave();
             return;
         }
-        else if (first == 's' && last == 'y') {
+        else if (msgType == TypeSASrelay) {
             uint32_t errorCode = 0;
-            ZrtpPacketSASrelay* srly = new ZrtpPacketSASrelay(pkt);
-            ZrtpPacketRelayAck* rapkt = parent->prepareRelayAck(srly, &errorCode);
+            ZrtpPacketSASrelay srly(pkt);
+            ZrtpPacketRelayAck* rapkt = parent->prepareRelayAck(&srly, &errorCode);
             parent->sendPacketZRTP(static_cast<ZrtpPacketBase *>(rapkt));
-            parent->synchLeave();
             return;
         }
     }
@@ -147,8 +219,21 @@ void ZrtpStateClass::processEvent(Event *ev) {
     else if (event->type == ZrtpClose) {
         cancelTimer();
     }
+    /*
+     * Only the states that started an asynchronous key agreement handle its ready
+     * event, ignore an outdated ready event in all other states.
+     */
+    else if (event->type == ZrtpKeyReady && !inState(CommitSent) && !inState(WaitDHPart2)) {
+        return;
+    }
+    /*
+     * Only the states that send a signed Confirm packet wait for an asynchronous
+     * SAS signature.
+     */
+    else if (event->type == ZrtpSignatureReady && !inState(WaitDHPart2) && !inState(WaitConfirm1)) {
+        return;
+    }
     engine->processEvent(*this);
-    parent->synchLeave();
 }
 
 
@@ -219,7 +304,6 @@ void ZrtpStateClass::evDetect(void) {
 
     DEBUGOUT((cout << "Checking for match in Detect.\n"));
 
-    char *msg, first, last;
     uint8_t *pkt;
     uint32_t errorCode = 0;
 
@@ -229,10 +313,7 @@ void ZrtpStateClass::evDetect(void) {
      */
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
 
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
         /*
          * HelloAck:
          * - our peer acknowledged our Hello packet, we have not seen the peer's Hello yet
@@ -241,7 +322,8 @@ void ZrtpStateClass::evDetect(void) {
          * 
          * When we receive an HelloAck this also means that our partner accepted our protocol version.
          */
-        if (first == 'h' && last =='k') {
+        if (msgType == TypeHelloAck) {
+            rttSample(&T1);
             cancelTimer();
             sentPacket = NULL;
             nextState(AckDetected);
@@ -258,7 +340,7 @@ void ZrtpStateClass::evDetect(void) {
          *   peer acknowledges this
          * - Don't clear sentPacket, points to Hello
          */
-        if (first == 'h' && last ==' ') {
+        if (msgType == TypeHello) {
             ZrtpPacketHello hpkt(pkt);
 
             cancelTimer();
@@ -405,7 +487,6 @@ void ZrtpStateClass::evAckSent(void) {
 
     DEBUGOUT((cout << "Checking for match in AckSent.\n"));
 
-    char *msg, first, last;
     uint8_t *pkt;
     uint32_t errorCode = 0;
 
@@ -415,10 +496,6 @@ void ZrtpStateClass::evAckSent(void) {
      */
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
-
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
 
         /*
          * HelloAck:
@@ -426,24 +503,25 @@ void ZrtpStateClass::evAckSent(void) {
          * and try Initiator mode. The requirement defined in chapter 4.1 to
          * have a complete Hello/HelloAck is fulfilled.
          * - stop Hello timer T1
+         * - while all DH slots are taken delay the Commit, start timer TA
          * - send own Commit message
          * - switch state to CommitSent, start Commit timer, assume Initiator
          */
-        if (first == 'h' && last =='k') {
+        if (msgType == TypeHelloAck) {
+            if (commitDelayed) {                 // the Commit is already delayed
+                return;
+            }
             cancelTimer();
 
-            // remember packet for easy resend in case timer triggers
-            // Timer trigger received in new state CommitSend
-            sentPacket = static_cast<ZrtpPacketBase *>(commitPkt);
-            commitPkt = NULL;                    // now stored in sentPacket
-            nextState(CommitSent);
-            if (!parent->sendPacketZRTP(sentPacket)) {
-                sendFailed();             // returns to state Initial
+            // Delay the Commit while all DH slots are taken, timer TA retries
+            if (!parent->isPresharedCommit(commitPkt) && !admitHandshake(false)) {
+                commitDelayed = true;
+                if (admissionTimer(true) <= 0) {
+                    timerFailed(SevereNoTimer);  // returns to state Initial
+                }
                 return;
             }
-            if (startTimer(&T2) <= 0) {
-                timerFailed(SevereNoTimer);  // returns to state Initial
-            }
+            sendCommit();
             return;
         }
         /*
@@ -458,7 +536,7 @@ void ZrtpStateClass::evAckSent(void) {
          * timeout sends the following Hello.
          */
 
-        if (first == 'h' && last ==' ') {
+        if (msgType == TypeHello) {
             ZrtpPacketHelloAck* helloAck = parent->prepareHelloAck();
 
             if (!parent->sendPacketZRTP(static_cast<ZrtpPacketBase *>(helloAck))) {
@@ -471,15 +549,24 @@ void ZrtpStateClass::evAckSent(void) {
          * Commit:
          * The peer answers with Commit to HelloAck/Hello, thus switch to
          * responder mode.
-         * - stop timer T1
+         * - ignore a DH Commit while all DH slots are taken, the peer resends it
+         * - stop timer T1 (or TA if our Commit is delayed)
          * - prepare and send our DHPart1
          * - switch to state WaitDHPart2 and wait for peer's DHPart2
          * - don't start timer, we are responder
          */
-        if (first == 'c' && last == ' ') {
-            cancelTimer();
+        if (msgType == TypeCommit) {
             ZrtpPacketCommit cpkt(pkt);
 
+            if (!parent->isPresharedCommit(&cpkt) && !admitPacket(false)) {
+                return;
+            }
+            cancelTimer();
+
+            if (parent->isPresharedCommit(&cpkt)) {
+                presharedCommit(&cpkt);
+                return;
+            }
             if (!multiStream) {
                 ZrtpPacketDHPart* dhPart1 = parent->prepareDHPart1(&cpkt, &errorCode);
 
@@ -514,12 +601,30 @@ void ZrtpStateClass::evAckSent(void) {
     }
     /*
      * Timer:
+     * - timer TA if our Commit is delayed: retry the admission, send the
+     *   Commit if a DH slot is free or if the repeat counter triggers
      * - resend Hello packet, stay in state, restart timer until repeat
      *   counter triggers
      * - if repeat counter triggers switch to state Detect, con't clear
      *   sentPacket, Detect requires it to point to own Hello message
      */
     else if (event->type == Timer) {
+        if (commitDelayed) {
+            if (!admitHandshake(false)) {
+                int32_t rc = admissionTimer(false);
+                if (rc > 0) {
+                    return;
+                }
+                if (rc == 0) {
+                    timerFailed(SevereNoTimer);  // returns to state Initial
+                    return;
+                }
+                forceAdmission(false);  // delay the handshake, but don't fail it
+            }
+            commitDelayed = false;
+            sendCommit();
+            return;
+        }
         if (!parent->sendPacketZRTP(sentPacket)) {
             return sendFailed();      // returns to state Initial
         }
@@ -558,35 +663,32 @@ void ZrtpStateClass::evAckSent(void) {
  * Hello: we have to choices
  *  1) we can acknowledge the peer's Hello with a HelloAck
  *  2) we can acknowledge the peer's Hello with a Commit
- *  Both choices are implemented and may be enabled by setting a compile
- *  time #if (see code below). Currently we use choice 1) here because
- *  it's more aligned to the ZRTP specification
+ *  By default we use choice 1) here because it's more aligned to the ZRTP
+ *  specification. The fast start mode uses choice 2), the Commit acts as an
+ *  implicit HelloAck and the handshake saves one round trip. A Commit clash
+ *  is resolved in state CommitSent as usual.
  */
 void ZrtpStateClass::evAckDetected(void) {
 
     DEBUGOUT((cout << "Checking for match in AckDetected.\n"));
 
-    char *msg, first, last;
     uint8_t *pkt;
     uint32_t errorCode = 0;
 
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
 
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
-
-#if 1
         /*
-         * Implementation for choice 1)
          * Hello:
-         * - Acknowledge peer's Hello, sending HelloACK (F4)
-         * - switch to state WaitCommit, wait for peer's Commit
-         * - we are going to be in the Responder role
+         * - choice 1): Acknowledge peer's Hello, sending HelloACK (F4)
+         *   -- switch to state WaitCommit, wait for peer's Commit
+         *   -- we are going to be in the Responder role
+         * - choice 2): Acknowledge peer's Hello by sending Commit (F5)
+         *   instead of HelloAck (F4)
+         *   -- switch to state CommitSent
+         *   -- Initiator role, thus start timer T2 to monitor timeout for Commit
          */
-
-        if (first == 'h' && last ==' ') {
+        if (msgType == TypeHello) {
             // Parse Hello packet and build an own Commit packet even if the
             // Commit is not send to the peer. We need to do this to check the
             // Hello packet and prepare the shared secret stuff.
@@ -599,6 +701,22 @@ void ZrtpStateClass::evAckDetected(void) {
                 sendErrorPacket(errorCode);
                 return;
             }
+            // While all DH slots are taken let the peer send the Commit
+            if (fastStart && (parent->isPresharedCommit(commit) || admitHandshake(false))) {
+                nextState(CommitSent);
+
+                // remember packet for easy resend in case timer triggers
+                // Timer trigger received in new state CommitSend
+                sentPacket = static_cast<ZrtpPacketBase *>(commit);
+                if (!parent->sendPacketZRTP(sentPacket)) {
+                    sendFailed();
+                    return;
+                }
+                if (startTimer(&T2) <= 0) {
+                    timerFailed(SevereNoTimer);
+                }
+                return;
+            }
             ZrtpPacketHelloAck *helloAck = parent->prepareHelloAck();
             nextState(WaitCommit);
 
@@ -608,39 +726,6 @@ void ZrtpStateClass::evAckDetected(void) {
                 sendFailed();
             }
         }
-#else
-        /*
-         * Implementation for choice 2)
-         * Hello:
-         * - Acknowledge peer's Hello by sending Commit (F5)
-         *   instead of HelloAck (F4)
-         * - switch to state CommitSent
-         * - Initiator role, thus start timer T2 to monitor timeout for Commit
-         */
-
-        if (first == 'h' && last == ' ') {
-            // Parse peer's packet data into a Hello packet
-            ZrtpPacketHello hpkt(pkt);
-            ZrtpPacketCommit* commit = parent->prepareCommit(&hpkt, &errorCode);
-            // Something went wrong during processing of the Hello packet  
-            if (commit == NULL) {
-                sendErrorPacket(errorCode);
-                return;
-            }
-            nextState(CommitSent);
-
-            // remember packet for easy resend in case timer triggers
-            // Timer trigger received in new state CommitSend
-            sentPacket = static_cast<ZrtpPacketBase *>(commit);
-            if (!parent->sendPacketZRTP(sentPacket)) {
-                sendFailed();
-                return;
-            }
-            if (startTimer(&T2) <= 0) {
-                timerFailed(SevereNoTimer);
-            }
-        }
-#endif
     }
     else {  // unknown Event type for this state (covers Error and ZrtpClose)
         if (event->type != ZrtpClose) {
@@ -653,7 +738,8 @@ void ZrtpStateClass::evAckDetected(void) {
 /*
  * WaitCommit state.
  *
- * This state is only used if we use choice 1) in AckDetected.
+ * This state is only used if we use choice 1) in AckDetected, thus not in
+ * fast start mode.
  *
  * When entering this transition function
  * - instance variable sentPacket contains a HelloAck packet
@@ -668,22 +754,18 @@ void ZrtpStateClass::evWaitCommit(void) {
 
     DEBUGOUT((cout << "Checking for match in WaitCommit.\n"));
 
-    char *msg, first, last;
     uint8_t *pkt;
     uint32_t errorCode = 0;
 
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
 
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
         /*
          * Hello:
          * - resend HelloAck
          * - stay in WaitCommit
          */
-        if (first == 'h' && last == ' ') {
+        if (msgType == TypeHello) {
             if (!parent->sendPacketZRTP(sentPacket)) {
                 sendFailed();       // returns to state Initial
             }
@@ -691,14 +773,22 @@ void ZrtpStateClass::evWaitCommit(void) {
         }
         /*
          * Commit:
-         * - prepare DH1Part packet or Confirm1 if multi stream mode
+         * - ignore a DH Commit while all DH slots are taken, the peer resends it
+         * - prepare DH1Part packet or Confirm1 if multi stream or Preshared mode
          * - send it to peer
-         * - switch state to WaitDHPart2 or WaitConfirm2 if multi stream mode
+         * - switch state to WaitDHPart2 or WaitConfirm2 if multi stream or Preshared mode
          * - don't start timer, we are responder
          */
-        if (first == 'c' && last == ' ') {
+        if (msgType == TypeCommit) {
             ZrtpPacketCommit cpkt(pkt);
 
+            if (!parent->isPresharedCommit(&cpkt) && !admitPacket(false)) {
+                return;
+            }
+            if (parent->isPresharedCommit(&cpkt)) {
+                presharedCommit(&cpkt);
+                return;
+            }
             if (!multiStream) {
                 ZrtpPacketDHPart* dhPart1 = parent->prepareDHPart1(&cpkt, &errorCode);
 
@@ -764,18 +854,11 @@ void ZrtpStateClass::evCommitSent(void) {
 
     DEBUGOUT((cout << "Checking for match in CommitSend.\n"));
 
-    char *msg, first, middle, last, secondLast;
     uint8_t *pkt;
     uint32_t errorCode = 0;
 
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
-
-        first = tolower(*msg);
-        middle = tolower(*(msg+4));
-        last = tolower(*(msg+7));
-        secondLast = tolower(*(msg+6));
 
         /*
          * HelloAck or Hello:
@@ -783,7 +866,15 @@ void ZrtpStateClass::evCommitSent(void) {
          *   ignore it
          * - no switch in state, leave timer as it is
          */
-        if (first == 'h' && middle == 'o' && (last =='k' || last == ' ')) {
+        if (msgType == TypeHello || msgType == TypeHelloAck) {
+            return;
+        }
+
+        /*
+         * Asynchronous key agreement for a DHPart1 is pending, ignore all
+         * packets until ZrtpKeyReady
+         */
+        if (parent->isKeyAgreementPending()) {
             return;
         }
 
@@ -800,7 +891,7 @@ void ZrtpStateClass::evCommitSent(void) {
          *   - prepare and send DH1Packt,
          *   - switch to state WaitDHPart2, implies Responder path
          */
-        if (first == 'c' && last == ' ') {
+        if (msgType == TypeCommit) {
             ZrtpPacketCommit zpCo(pkt);
 
             if (!parent->verifyH2(&zpCo)) {
@@ -808,7 +899,7 @@ void ZrtpStateClass::evCommitSent(void) {
             }
             cancelTimer();         // this cancels the Commit timer T2
 
-            if (!zpCo.isLengthOk(multiStream ? ZrtpPacketCommit::MultiStream : ZrtpPacketCommit::DhExchange)) {
+            if (!zpCo.isLengthOk(parent->getCommitType(&zpCo))) {
                 sendErrorPacket(CriticalSWError);
                 return;
             }
@@ -818,6 +909,10 @@ void ZrtpStateClass::evCommitSent(void) {
             // necessary
             //
             if (parent->compareCommit(&zpCo) < 0) {
+                if (parent->isPresharedCommit(&zpCo)) {
+                    presharedCommit(&zpCo);
+                    return;
+                }
                 if (!multiStream) {
                     ZrtpPacketDHPart* dhPart1 = parent->prepareDHPart1(&zpCo, &errorCode);
 
@@ -860,53 +955,52 @@ void ZrtpStateClass::evCommitSent(void) {
 
         /*
          * DHPart1:
+         * - ignore it if we get no DH slot, the Commit timer resends the Commit
+         *   and the peer repeats its DHPart1
          * - switch off resending Commit
          * - Prepare and send DHPart2
          * - switch to WaitConfirm1
          * - start timer to resend DHPart2 if necessary, we are Initiator
          */
-        if (first == 'd' && secondLast == '1') {
+        if (msgType == TypeDHPart1 && !parent->presharedMode) {
+            if (!admitPacket(true)) {
+                return;
+            }
+            rttSample(&T2);
             cancelTimer();
             sentPacket = NULL;
             ZrtpPacketDHPart dpkt(pkt);
-            ZrtpPacketDHPart* dhPart2 = parent->prepareDHPart2(&dpkt, &errorCode);
 
-            // Something went wrong during processing of the DHPart1 packet
-            if (dhPart2 == NULL) {
-                if (errorCode != IgnorePacket) {
-                    sendErrorPacket(errorCode);
-                }
-                else {
-                    if (startTimer(&T2) <= 0) {
-                        timerFailed(SevereNoTimer);       // switches to state Initial
-                    }
+            // Asynchronous key agreement: send DHPart2 after ZrtpKeyReady
+            if (parent->isAsyncKeyAgreement()) {
+                if (!parent->startDHPart2(&dpkt, &errorCode)) {
+                    dhPart1Failed(errorCode);
                 }
-
                 return;
             }
-            sentPacket = static_cast<ZrtpPacketBase *>(dhPart2);
-            nextState(WaitConfirm1);
+            ZrtpPacketDHPart* dhPart2 = parent->prepareDHPart2(&dpkt, &errorCode);
 
-            if (!parent->sendPacketZRTP(sentPacket)) {
-                sendFailed();       // returns to state Initial
+            // Something went wrong during processing of the DHPart1 packet
+            if (dhPart2 == NULL) {
+                dhPart1Failed(errorCode);
                 return;
             }
-            if (startTimer(&T2) <= 0) {
-                timerFailed(SevereNoTimer);       // switches to state Initial
-            }
+            sendDHPart2(dhPart2);
             return;
         }
 
         /*
-         * Confirm1 and multi-stream mode
+         * Confirm1 and multi-stream or Preshared mode
          * - switch off resending commit
          * - prepare Confirm2
          */
-        if (multiStream && (first == 'c' && last == '1')) {
+        if ((multiStream || parent->presharedMode) && msgType == TypeConfirm1) {
+            rttSample(&T2);
             cancelTimer();
             ZrtpPacketConfirm cpkt(pkt);
 
-            ZrtpPacketConfirm* confirm = parent->prepareConfirm2MultiStream(&cpkt, &errorCode);
+            ZrtpPacketConfirm* confirm = multiStream ? parent->prepareConfirm2MultiStream(&cpkt, &errorCode) :
+                                                       parent->prepareConfirm2Preshared(&cpkt, &errorCode);
 
             // Something went wrong during processing of the Confirm1 packet
             if (confirm == NULL) {
@@ -946,15 +1040,49 @@ void ZrtpStateClass::evCommitSent(void) {
             timerFailed(SevereTooMuchRetries);       // returns to state Initial
         }
     }
+    // Asynchronous key agreement for DHPart1 is ready, send DHPart2
+    else if (event->type == ZrtpKeyReady) {
+        releaseAdmission();
+        ZrtpPacketDHPart* dhPart2 = parent->resumeDHPart2(&errorCode);
+        if (dhPart2 != NULL) {
+            sendDHPart2(dhPart2);
+        }
+    }
     else {  // unknown Event type for this state (covers Error and ZrtpClose)
         if (event->type != ZrtpClose) {
             parent->zrtpNegotiationFailed(Severe, SevereProtocolError);
         }
+        parent->cancelKeyAgreement();
         sentPacket = NULL;
         nextState(Initial);
     }
 }
 
+void ZrtpStateClass::dhPart1Failed(uint32_t errorCode) {
+    releaseAdmission();
+    if (errorCode != IgnorePacket) {
+        sendErrorPacket(errorCode);
+    }
+    else {
+        if (startTimer(&T2) <= 0) {
+            timerFailed(SevereNoTimer);       // switches to state Initial
+        }
+    }
+}
+
+void ZrtpStateClass::sendDHPart2(ZrtpPacketDHPart* dhPart2) {
+    sentPacket = static_cast<ZrtpPacketBase *>(dhPart2);
+    nextState(WaitConfirm1);
+
+    if (!parent->sendPacketZRTP(sentPacket)) {
+        sendFailed();       // returns to state Initial
+        return;
+    }
+    if (startTimer(&T2) <= 0) {
+        timerFailed(SevereNoTimer);       // switches to state Initial
+    }
+}
+
 /*
  * WaitDHPart2 state.
  *
@@ -969,28 +1097,25 @@ void ZrtpStateClass::evCommitSent(void) {
  *   Just repeat our DHPart1.
  * - DHPart2: start second half of DH key agreement. Perpare and send own Confirm1
  *   and switch to state WaitConfirm2.
+ * - ZrtpSignatureReady: the asynchronous SAS signature is ready, send the
+ *   signed Confirm1 and switch to state WaitConfirm2.
  */
 void ZrtpStateClass::evWaitDHPart2(void) {
 
     DEBUGOUT((cout << "Checking for match in DHPart2.\n"));
 
-    char *msg, first, secondLast, last;
     uint8_t *pkt;
     uint32_t errorCode = 0;
 
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
 
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
-        secondLast = tolower(*(msg+6));
         /*
          * Commit:
          * - resend DHPart1
          * - stay in state
          */
-        if (first == 'c' && last == ' ') {
+        if (msgType == TypeCommit) {
             if (!parent->sendPacketZRTP(sentPacket)) {
                 return sendFailed();       // returns to state Initial
             }
@@ -1002,32 +1127,103 @@ void ZrtpStateClass::evWaitDHPart2(void) {
          * - switch to WaitConfirm2
          * - No timer, we are responder
          */
-        if (first == 'd' && secondLast == '2') {
+        if (msgType == TypeDHPart2) {
+            // Ignore a repeated DHPart2 while the asynchronous key agreement or SAS signature is pending
+            if (parent->isKeyAgreementPending() || parent->isSasSignatureWaiting()) {
+                return;
+            }
+            // Ignore it if we get no DH slot, the peer resends its DHPart2
+            if (!admitPacket(true)) {
+                return;
+            }
             ZrtpPacketDHPart dpkt(pkt);
+
+            // Asynchronous key agreement: send Confirm1 after ZrtpKeyReady
+            if (parent->isAsyncKeyAgreement()) {
+                if (!parent->startConfirm1(&dpkt, &errorCode)) {
+                    releaseAdmission();
+                    if (errorCode != IgnorePacket) {
+                        sendErrorPacket(errorCode);
+                    }
+                }
+                return;
+            }
             ZrtpPacketConfirm* confirm = parent->prepareConfirm1(&dpkt, &errorCode);
 
             if (confirm == NULL) {
+                releaseAdmission();
                 if (errorCode != IgnorePacket) {
                     sendErrorPacket(errorCode);
                 }
                 return;
             }
-            nextState(WaitConfirm2);
-            sentPacket = static_cast<ZrtpPacketBase *>(confirm);
-            if (!parent->sendPacketZRTP(sentPacket)) {
-                sendFailed();       // returns to state Initial
-            }
+            sendConfirm1(confirm);
+        }
+    }
+    // Asynchronous key agreement for DHPart2 is ready, send Confirm1
+    else if (event->type == ZrtpKeyReady) {
+        releaseAdmission();
+        ZrtpPacketConfirm* confirm = parent->resumeConfirm1(&errorCode);
+        if (confirm != NULL) {
+            sendConfirm1(confirm);
+        }
+    }
+    // Asynchronous SAS signature is ready, send the signed Confirm1
+    else if (event->type == ZrtpSignatureReady) {
+        ZrtpPacketConfirm* confirm = parent->resumeSignedConfirm1(&errorCode);
+        if (confirm != NULL) {
+            sendConfirm1(confirm);
         }
     }
     else {  // unknown Event type for this state (covers Error and ZrtpClose)
         if (event->type != ZrtpClose) {
             parent->zrtpNegotiationFailed(Severe, SevereProtocolError);
         }
+        parent->cancelKeyAgreement();
+        parent->cancelSasSignature();
         sentPacket = NULL;
         nextState(Initial);
     }
 }
 
+void ZrtpStateClass::sendConfirm1(ZrtpPacketConfirm* confirm) {
+    nextState(WaitConfirm2);
+    sentPacket = static_cast<ZrtpPacketBase *>(confirm);
+    if (!parent->sendPacketZRTP(sentPacket)) {
+        sendFailed();       // returns to state Initial
+    }
+}
+
+void ZrtpStateClass::presharedCommit(ZrtpPacketCommit* commit) {
+    uint32_t errorCode = 0;
+
+    ZrtpPacketConfirm* confirm = parent->prepareConfirm1Preshared(commit, &errorCode);
+    if (confirm != NULL) {
+        commitPkt = NULL;
+        sendConfirm1(confirm);
+        return;
+    }
+    if (errorCode != NoSharedSecret) {
+        if (errorCode != IgnorePacket) {
+            sendErrorPacket(errorCode);
+        }
+        return;
+    }
+    // No matching preshared key: answer with a DH Commit, it wins the Commit
+    // contention and the peer switches to Responder (RFC 6189, chapter 4.2)
+    commitPkt = NULL;
+    sentPacket = static_cast<ZrtpPacketBase *>(parent->prepareCommitDHFallback());
+    nextState(CommitSent);
+
+    if (!parent->sendPacketZRTP(sentPacket)) {
+        sendFailed();       // returns to state Initial
+        return;
+    }
+    if (startTimer(&T2) <= 0) {
+        timerFailed(SevereNoTimer);       // returns to state Initial
+    }
+}
+
 /*
  * WaitConirm1 state.
  *
@@ -1046,22 +1242,20 @@ void ZrtpStateClass::evWaitDHPart2(void) {
  * - timeout for sent DHPart2 packet: causes a resend check and repeat sending
  *   of DHPart2 packet.
  * - Confirm1: Check Confirm1 message. If it is ok then prepare and send own
- *   Confirm2 packet and switch to state WaitConfAck.
+ *   Confirm2 packet and switch to state WaitConfAck. If an asynchronous SAS
+ *   signature is not ready keep the Confirm1 and stay in state.
+ * - ZrtpSignatureReady: the asynchronous SAS signature is ready, send the
+ *   signed Confirm2 and switch to state WaitConfAck.
  */
 void ZrtpStateClass::evWaitConfirm1(void) {
 
     DEBUGOUT((cout << "Checking for match in WaitConfirm1.\n"));
 
-    char *msg, first, last;
     uint8_t *pkt;
     uint32_t errorCode = 0;
 
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
-
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
 
         /*
          * Confirm1:
@@ -1070,35 +1264,32 @@ void ZrtpStateClass::evWaitConfirm1(void) {
          * - switch to state WaitConfAck
          * - set timer to monitor Confirm2 packet, we are initiator
          */
-        if (first == 'c' && last == '1') {
+        if (msgType == TypeConfirm1) {
+            // Ignore a repeated Confirm1 while the asynchronous SAS signature is pending
+            if (parent->isSasSignatureWaiting()) {
+                return;
+            }
             cancelTimer();
             ZrtpPacketConfirm cpkt(pkt);
 
             ZrtpPacketConfirm* confirm = parent->prepareConfirm2(&cpkt, &errorCode);
 
-            // Something went wrong during processing of the Confirm1 packet
+            // Something went wrong during processing of the Confirm1 packet,
+            // or send Confirm2 after ZrtpSignatureReady
             if (confirm == NULL) {
-                sendErrorPacket(errorCode);
-                return;
-            }
-            // according to chap 5.8: after sending Confirm2 the Initiator must
-            // be ready to receive SRTP data. SRTP sender will be enabled in WaitConfAck
-            // state.
-            if (!parent->srtpSecretsReady(ForReceiver)) {
-                parent->sendInfo(Severe, CriticalSWError);
-                sendErrorPacket(CriticalSWError);
-                return;
-            }
-            nextState(WaitConfAck);
-            sentPacket = static_cast<ZrtpPacketBase *>(confirm);
-
-            if (!parent->sendPacketZRTP(sentPacket)) {
-                sendFailed();         // returns to state Initial
+                if (errorCode != IgnorePacket) {
+                    sendErrorPacket(errorCode);
+                }
                 return;
             }
-            if (startTimer(&T2) <= 0) {
-                timerFailed(SevereNoTimer);  // returns to state Initial
-            }
+            sendConfirm2(confirm);
+        }
+    }
+    // Asynchronous SAS signature is ready, send the signed Confirm2
+    else if (event->type == ZrtpSignatureReady) {
+        ZrtpPacketConfirm* confirm = parent->resumeSignedConfirm2(&errorCode);
+        if (confirm != NULL) {
+            sendConfirm2(confirm);
         }
     }
     else if (event->type == Timer) {
@@ -1116,11 +1307,33 @@ void ZrtpStateClass::evWaitConfirm1(void) {
         if (event->type != ZrtpClose) {
             parent->zrtpNegotiationFailed(Severe, SevereProtocolError);
         }
+        parent->cancelSasSignature();
         sentPacket = NULL;
         nextState(Initial);
     }
 }
 
+void ZrtpStateClass::sendConfirm2(ZrtpPacketConfirm* confirm) {
+    // according to chap 5.8: after sending Confirm2 the Initiator must
+    // be ready to receive SRTP data. SRTP sender will be enabled in WaitConfAck
+    // state.
+    if (!parent->srtpSecretsReady(ForReceiver)) {
+        parent->sendInfo(Severe, CriticalSWError);
+        sendErrorPacket(CriticalSWError);
+        return;
+    }
+    nextState(WaitConfAck);
+    sentPacket = static_cast<ZrtpPacketBase *>(confirm);
+
+    if (!parent->sendPacketZRTP(sentPacket)) {
+        sendFailed();         // returns to state Initial
+        return;
+    }
+    if (startTimer(&T2) <= 0) {
+        timerFailed(SevereNoTimer);  // returns to state Initial
+    }
+}
+
 /*
  * WaitConfirm2 state.
  *
@@ -1145,24 +1358,18 @@ void ZrtpStateClass::evWaitConfirm2(void) {
 
     DEBUGOUT((cout << "Checking for match in WaitConfirm2.\n"));
 
-    char *msg, first, secondLast, last;
     uint8_t *pkt;
     uint32_t errorCode = 0;
 
     if (event->type == ZrtpPacket) {
         pkt = event->packet;
-        msg = (char *)pkt + 4;
-
-        first = tolower(*msg);
-        secondLast = tolower(*(msg+6));
-        last = tolower(*(msg+7));
 
         /*
-         * DHPart2 or Commit in multi stream mode:
+         * DHPart2 or Commit in multi stream or Preshared mode:
          * - resend Confirm1 packet
          * - stay in state
          */
-        if ((first == 'd' && secondLast == '2') || (multiStream && (first == 'c' && last == ' '))) {
+        if (msgType == TypeDHPart2 || ((multiStream || parent->presharedMode) && msgType == TypeCommit)) {
             if (!parent->sendPacketZRTP(sentPacket)) {
                 sendFailed();             // returns to state Initial
             }
@@ -1174,7 +1381,7 @@ void ZrtpStateClass::evWaitConfirm2(void) {
          * - switch on security (SRTP)
          * - switch to SecureState
          */
-        if (first == 'c' && last == '2') {
+        if (msgType == TypeConfirm2) {
             ZrtpPacketConfirm cpkt(pkt);
             ZrtpPacketConf2Ack* confack = parent->prepareConf2Ack(&cpkt, &errorCode);
 
@@ -1195,7 +1402,9 @@ void ZrtpStateClass::evWaitConfirm2(void) {
                 return;
             }
             nextState(SecureState);
+            parent->recordPhase(ZRtp::PhaseSecure, false);
             parent->sendInfo(Info, InfoSecureStateOn);
+            parent->releaseHandshake();
         }
     }
     else {  // unknown Event type for this state (covers Error and ZrtpClose)
@@ -1228,21 +1437,13 @@ void ZrtpStateClass::evWaitConfAck(void) {
 
     DEBUGOUT((cout << "Checking for match in WaitConfAck.\n"));
 
-    char *msg, first, last;
-    uint8_t *pkt;
-
     if (event->type == ZrtpPacket) {
-        pkt = event->packet;
-        msg = (char *)pkt + 4;
-
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
          /*
          * ConfAck:
          * - Switch off resending Confirm2
          * - switch to SecureState
          */
-        if (first == 'c' && last == 'k') {
+        if (msgType == TypeConf2Ack) {
             cancelTimer();
             sentPacket = NULL;
             // Receiver was already enabled after sending Confirm2 packet
@@ -1253,8 +1454,10 @@ void ZrtpStateClass::evWaitConfAck(void) {
                 return;
             }
             nextState(SecureState);
+            parent->recordPhase(ZRtp::PhaseSecure, false);
             // TODO: call parent to clear signature data at initiator
             parent->sendInfo(Info, InfoSecureStateOn);
+            parent->releaseHandshake();
         }
     }
     else if (event->type == Timer) {
@@ -1311,22 +1514,13 @@ void ZrtpStateClass::evWaitClearAck(void) {
 void ZrtpStateClass::evWaitErrorAck(void) {
     DEBUGOUT((cout << "Checking for match in ErrorAck.\n"));
 
-    char *msg, first, last;
-    uint8_t *pkt;
-
     if (event->type == ZrtpPacket) {
-        pkt = event->packet;
-        msg = (char *)pkt + 4;
-
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
-
         /*
          * Errorck:
          * - stop resending Error,
          * - switch to state Initial
          */
-        if (first == 'e' && last =='k') {
+        if (msgType == TypeErrorAck) {
             cancelTimer();
             sentPacket = NULL;
             nextState(Initial);
@@ -1357,9 +1551,6 @@ void ZrtpStateClass::evSecureState(void) {
 
     DEBUGOUT((cout << "Checking for match in SecureState.\n"));
 
-    char *msg, first, last;
-    uint8_t *pkt;
-
     /*
      * Handle a possible substate. If substate handling was ok just return.
      */
@@ -1369,18 +1560,12 @@ void ZrtpStateClass::evSecureState(void) {
     }
 
     if (event->type == ZrtpPacket) {
-        pkt = event->packet;
-        msg = (char *)pkt + 4;
-
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
-
         /*
          * Confirm2:
          * - resend Conf2Ack packet
          * - stay in state
          */
-        if (first == 'c' && last == '2') {
+        if (msgType == TypeConfirm2) {
             if (sentPacket != NULL && !parent->sendPacketZRTP(sentPacket)) {
                 sentPacket = NULL;
                 nextState(Initial);
@@ -1393,8 +1578,8 @@ void ZrtpStateClass::evSecureState(void) {
         /*
          * GoClear received, handle it. TODO fix go clear handling
          *
-        if (first == 'g' && last == 'r') {
-            ZrtpPacketGoClear gpkt(pkt);
+        if (msgType == TypeGoClear) {
+            ZrtpPacketGoClear gpkt(event->packet);
             ZrtpPacketClearAck* clearAck = parent->prepareClearAck(&gpkt);
 
             if (!parent->sendPacketZRTP(static_cast<ZrtpPacketBase *>(clearAck))) {
@@ -1426,25 +1611,16 @@ void ZrtpStateClass::evSecureState(void) {
 }
 
 bool ZrtpStateClass::subEvWaitRelayAck() {
-    char *msg, first, last;
-    uint8_t* pkt;
-
     /*
      * First check the general event type, then discrimnate the real event.
      */
     if  (event->type == ZrtpPacket) {
-        pkt = event->packet;
-        msg = (char *)pkt + 4;
-
-        first = tolower(*msg);
-        last = tolower(*(msg+7));
-
         /*
          * SAS relayAck:
          * - stop resending SASRelay,
          * - switch to secure substate Normal
          */
-        if (first == 'r' && last =='k') {
+        if (msgType == TypeRelayAck) {
             cancelTimer();
             secSubstate = Normal;
             sentPacket = NULL;
@@ -1471,11 +1647,13 @@ int32_t ZrtpStateClass::startTimer(zrtpTimer_t *t) {
 
     t->time = t->start;
     t->counter = 0;
+    sentTime = zrtpGetMonotonicTime();
     return parent->activateTimer(t->time);
 }
 
 int32_t ZrtpStateClass::nextTimer(zrtpTimer_t *t) {
 
+    sentTime = zrtpGetMonotonicTime();
     t->time += t->time;
     t->time = (t->time > t->capping)? t->capping : t->time;
     if (t->maxResend > 0) {
@@ -1487,6 +1665,132 @@ int32_t ZrtpStateClass::nextTimer(zrtpTimer_t *t) {
     return parent->activateTimer(t->time);
 }
 
+int32_t ZrtpStateClass::admissionTimer(bool first) {
+
+    if (first) {
+        TA.time = TA.start;
+        TA.counter = 0;
+    }
+    else {
+        TA.time += TA.time;
+        TA.time = (TA.time > TA.capping)? TA.capping : TA.time;
+        if (++TA.counter > TA.maxResend) {
+            return -1;
+        }
+    }
+    // Add up to 50% jitter, the handshakes of a registration storm shall not retry in lock step
+    uint8_t jitter = 0;
+    ZrtpRandom::getRandomData(&jitter, sizeof(jitter));
+    return parent->activateTimer(TA.time + (TA.time / 2) * jitter / 255);
+}
+
+// Number of packets a state engine ignores before it proceeds without admission
+static const int32_t maxDeferredPackets = 4;
+
+bool ZrtpStateClass::admitHandshake(bool compute) {
+
+    if (admitted || multiStream)
+        return true;
+
+    if (compute ? ZrtpAdmission::tryAdmit() : !ZrtpAdmission::isSaturated()) {
+        admitted = compute;
+        deferredPackets = 0;
+        if (admissionQueued) {
+            admissionQueued = false;
+            ZrtpAdmission::leaveQueue();
+        }
+        return true;
+    }
+    if (!admissionQueued) {
+        admissionQueued = true;
+        ZrtpAdmission::enterQueue();
+    }
+    return false;
+}
+
+bool ZrtpStateClass::admitPacket(bool compute) {
+
+    if (admitHandshake(compute))
+        return true;
+
+    if (++deferredPackets < maxDeferredPackets)
+        return false;
+    forceAdmission(compute);
+    return true;
+}
+
+void ZrtpStateClass::forceAdmission(bool compute) {
+
+    if (compute && !admitted) {
+        ZrtpAdmission::admit();
+        admitted = true;
+    }
+    if (admissionQueued) {
+        admissionQueued = false;
+        ZrtpAdmission::leaveQueue();
+    }
+    deferredPackets = 0;
+}
+
+void ZrtpStateClass::releaseAdmission() {
+
+    if (admitted) {
+        admitted = false;
+        ZrtpAdmission::release();
+    }
+    if (admissionQueued) {
+        admissionQueued = false;
+        ZrtpAdmission::leaveQueue();
+    }
+    deferredPackets = 0;
+}
+
+void ZrtpStateClass::sendCommit() {
+
+    // remember packet for easy resend in case timer triggers
+    // Timer trigger received in new state CommitSend
+    sentPacket = static_cast<ZrtpPacketBase *>(commitPkt);
+    commitPkt = NULL;                    // now stored in sentPacket
+    nextState(CommitSent);
+    if (!parent->sendPacketZRTP(sentPacket)) {
+        sendFailed();             // returns to state Initial
+        return;
+    }
+    if (startTimer(&T2) <= 0) {
+        timerFailed(SevereNoTimer);  // returns to state Initial
+    }
+}
+
+// Lower bounds of the timer start values. T1 uses the start value of RFC 6189, chapter 6.
+// Some T2 responses, for example Confirm1, need a DH computation of the peer.
+static const int32_t minT1Start = 50;
+static const int32_t minT2Start = 100;
+
+void ZrtpStateClass::rttSample(zrtpTimer_t *t) {
+
+    int32_t rtt = (int32_t)(zrtpGetMonotonicTime() - sentTime);
+
+    // The response to a resent packet may belong to an earlier transmission, the
+    // time since the last transmission then underestimates the round trip time. The
+    // response did not arrive within the previous timeout, use it as lower bound.
+    if (t->counter > 0 && rtt < t->time / 2)
+        rtt = t->time / 2;
+
+    if (srtt < 0) {
+        srtt = rtt;
+        rttvar = rtt / 2;
+    }
+    else {
+        int32_t delta = (srtt > rtt) ? srtt - rtt : rtt - srtt;
+        rttvar = (3 * rttvar + delta) / 4;
+        srtt = (7 * srtt + rtt) / 8;
+    }
+    int32_t rto = srtt + ((4 * rttvar > 1) ? 4 * rttvar : 1);
+
+    T1.start = (rto < minT1Start) ? minT1Start : (rto > T1.capping) ? T1.capping : rto;
+    T2.start = (rto < minT2Start) ? minT2Start : (rto > T2.capping) ? T2.capping : rto;
+}
+
 void ZrtpStateClass::sendErrorPacket(uint32_t errorCode) {
     cancelTimer();
 
@@ -64,6 +64,7 @@ char zrtpSessionKey[] = "ZRTP Session Key";
 char zrtpExportedKey[] = "Exported key";
 
 char zrtpMsk[] = "ZRTP MSK";
+char zrtpPsk[] = "ZRTP PSK";
 char zrtpTrustedMitm[] = "Trusted MiTM key";
 
 char s256[] = "S256";
@@ -78,6 +79,7 @@ char aes1[] = "AES1";
 char two3[] = "2FS3";
 char two2[] = "2FS2";
 char two1[] = "2FS1";
+char cc20[] = "CC20";
 const char* mandatoryCipher = aes1;
 
 char dh2k[] = "DH2k";
@@ -87,7 +89,12 @@ char ec38[] = "EC38";
 char e255[] = "E255";
 char e414[] = "E414";
 char mult[] = "Mult";
+char prsh[] = "Prsh";
+#ifndef ZRTP_MINIMAL_ALGORITHMS
 const char* mandatoryPubKey = dh3k;
+#else
+const char* mandatoryPubKey = e255;     // the minimal profile does not build DH3k
+#endif
 
 char b32[] =  "B32 ";
 char b256[] = "B256";
@@ -100,6 +107,8 @@ char hs32[] = "HS32";
 char hs80[] = "HS80";
 char sk32[] = "SK32";
 char sk64[] = "SK64";
+char gc16[] = "GC16";
+char cp16[] = "CP16";
 const char* mandatoryAuthLen_1 = hs32;
 const char* mandatoryAuthLen_2 = hs80;
 
@@ -0,0 +1,544 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+
+#include <libzrtpcpp/ZrtpTrace.h>
+#include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZIDCache.h>
+#include <libzrtpcpp/ZIDRecordFile.h>
+
+static const char traceMagic[] = "ZRTPTRC1";
+static const size_t traceMagicLength = 8;
+
+// Flags of the Engine record
+static const uint8_t EngineMitm = 1;
+static const uint8_t EngineTrustedMitm = 2;
+static const uint8_t EngineSasSignature = 4;
+static const uint8_t EngineParanoid = 8;
+static const uint8_t EngineDisclosure = 16;
+static const uint8_t EngineFastStart = 32;
+
+// Flags of the Cache record
+static const uint8_t CacheRs1Valid = 1;
+static const uint8_t CacheRs1NotExpired = 2;
+static const uint8_t CacheRs2Valid = 4;
+static const uint8_t CacheRs2NotExpired = 8;
+static const uint8_t CacheMitmKey = 16;
+static const uint8_t CacheSasVerified = 32;
+static const size_t cacheRecordLength = 2 + 3 * RS_LENGTH;
+
+static const AlgoTypes algoTypes[] = { HashAlgorithm, CipherAlgorithm, PubKeyAlgorithm, SasType, AuthLength };
+
+static void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static bool getVarint(const uint8_t*& in, const uint8_t* end, uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (in >= end)
+            return false;
+        uint8_t byte = *in++;
+        *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+static void putUint32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static uint32_t getUint32(const uint8_t* in) {
+    return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+           (static_cast<uint32_t>(in[2]) << 8) | in[3];
+}
+
+/*
+ * The length of a sent packet includes the CRC, the sender computes it after
+ * sendDataZRTP. The trace contains the packet without the CRC.
+ */
+static size_t sentLength(int32_t length) {
+    return length > 4 ? static_cast<size_t>(length) - 4 : 0;
+}
+
+static uint64_t microSeconds() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static EnumBase& getAlgoEnum(AlgoTypes type) {
+    switch (type) {
+        case HashAlgorithm:
+            return zrtpHashes;
+        case CipherAlgorithm:
+            return zrtpSymCiphers;
+        case PubKeyAlgorithm:
+            return zrtpPubKeys;
+        case SasType:
+            return zrtpSasTypes;
+        default:
+            return zrtpAuthLengths;
+    }
+}
+
+/*
+ * ZrtpTrace, the default functions
+ */
+void ZrtpTrace::traceEngine(const uint8_t* zid, const std::string& clientId, ZrtpConfigure& config, bool mitm) {
+    (void)zid; (void)clientId; (void)config; (void)mitm;
+}
+
+void ZrtpTrace::traceReceived(const uint8_t* message, uint32_t ssrc, size_t length) {
+    (void)message; (void)ssrc; (void)length;
+}
+
+void ZrtpTrace::traceSent(const uint8_t* data, int32_t length) {
+    (void)data; (void)length;
+}
+
+void ZrtpTrace::traceTimerStart(int32_t time) {
+    (void)time;
+}
+
+ZIDRecord* ZrtpTrace::getRecord(uint8_t* peerZid) {
+    return getZidCacheInstance()->getRecord(peerZid);
+}
+
+void ZrtpTrace::saveRecord(ZIDRecord* record) {
+    getZidCacheInstance()->saveRecord(record);
+}
+
+/*
+ * ZrtpTraceRecorder
+ */
+ZrtpTraceRecorder::ZrtpTraceRecorder(const char* fileName): lastTime(0) {
+    file = fopen(fileName, "wb");
+    if (file != NULL && fwrite(traceMagic, 1, traceMagicLength, file) != traceMagicLength) {
+        fclose(file);
+        file = NULL;
+    }
+}
+
+ZrtpTraceRecorder::~ZrtpTraceRecorder() {
+    if (file != NULL)
+        fclose(file);
+}
+
+void ZrtpTraceRecorder::writeRecord(RecordType type, const uint8_t* payload, size_t length) {
+    if (file == NULL)
+        return;
+
+    uint64_t now = microSeconds();
+    std::vector<uint8_t> header;
+    header.push_back(static_cast<uint8_t>(type));
+    putVarint(header, lastTime == 0 ? 0 : now - lastTime);
+    putVarint(header, length);
+    lastTime = now;
+
+    fwrite(&header[0], 1, header.size(), file);
+    if (length > 0)
+        fwrite(payload, 1, length, file);
+}
+
+void ZrtpTraceRecorder::traceEngine(const uint8_t* zid, const std::string& clientId, ZrtpConfigure& config, bool mitm) {
+    std::vector<uint8_t> payload(zid, zid + IDENTIFIER_LEN);
+
+    uint8_t flags = 0;
+    if (mitm)
+        flags |= EngineMitm;
+    if (config.isTrustedMitM())
+        flags |= EngineTrustedMitm;
+    if (config.isSasSignature())
+        flags |= EngineSasSignature;
+    if (config.isParanoidMode())
+        flags |= EngineParanoid;
+    if (config.isDisclosureFlag())
+        flags |= EngineDisclosure;
+    if (config.isFastStart())
+        flags |= EngineFastStart;
+    payload.push_back(flags);
+    payload.push_back(static_cast<uint8_t>(config.getSelectionPolicy()));
+    putUint32(payload, config.getPresharedLimit());
+
+    payload.push_back(static_cast<uint8_t>(clientId.size()));
+    payload.insert(payload.end(), clientId.begin(), clientId.begin() + (clientId.size() & 0xff));
+
+    for (size_t t = 0; t < sizeof(algoTypes) / sizeof(algoTypes[0]); t++) {
+        int32_t num = config.getNumConfiguredAlgos(algoTypes[t]);
+        payload.push_back(static_cast<uint8_t>(num));
+        for (int32_t i = 0; i < num; i++) {
+            const char* name = config.getAlgoAt(algoTypes[t], i).getName();
+            payload.insert(payload.end(), name, name + 4);
+        }
+    }
+    writeRecord(Engine, &payload[0], payload.size());
+}
+
+void ZrtpTraceRecorder::traceStart() {
+    writeRecord(Start, NULL, 0);
+}
+
+void ZrtpTraceRecorder::traceReceived(const uint8_t* message, uint32_t ssrc, size_t length) {
+    // The message follows the 12 byte RTP like header, the length includes this header
+    size_t messageLength = length > 12 ? length - 12 : 0;
+    std::vector<uint8_t> payload;
+    putUint32(payload, ssrc);
+    putUint32(payload, static_cast<uint32_t>(length));
+    payload.insert(payload.end(), message, message + messageLength);
+    writeRecord(Received, &payload[0], payload.size());
+}
+
+void ZrtpTraceRecorder::traceSent(const uint8_t* data, int32_t length) {
+    writeRecord(Sent, data, sentLength(length));
+}
+
+void ZrtpTraceRecorder::traceTimerStart(int32_t time) {
+    std::vector<uint8_t> payload;
+    putUint32(payload, static_cast<uint32_t>(time));
+    writeRecord(TimerStart, &payload[0], payload.size());
+}
+
+void ZrtpTraceRecorder::traceTimerCancel() {
+    writeRecord(TimerCancel, NULL, 0);
+}
+
+void ZrtpTraceRecorder::traceTimeout() {
+    writeRecord(Timeout, NULL, 0);
+}
+
+void ZrtpTraceRecorder::traceStop() {
+    writeRecord(Stop, NULL, 0);
+    if (file != NULL)
+        fflush(file);
+}
+
+ZIDRecord* ZrtpTraceRecorder::getRecord(uint8_t* peerZid) {
+    ZIDRecord* record = ZrtpTrace::getRecord(peerZid);
+    if (record == NULL) {
+        writeRecord(Cache, NULL, 0);
+        return record;
+    }
+    uint8_t payload[cacheRecordLength];
+    uint8_t flags = 0;
+    if (record->isRs1Valid())
+        flags |= CacheRs1Valid;
+    if (record->isRs1NotExpired())
+        flags |= CacheRs1NotExpired;
+    if (record->isRs2Valid())
+        flags |= CacheRs2Valid;
+    if (record->isRs2NotExpired())
+        flags |= CacheRs2NotExpired;
+    if (record->isMITMKeyAvailable())
+        flags |= CacheMitmKey;
+    if (record->isSasVerified())
+        flags |= CacheSasVerified;
+    payload[0] = flags;
+    payload[1] = static_cast<uint8_t>(record->getPreshCounter() > 255 ? 255 : record->getPreshCounter());
+    memcpy(payload + 2, record->getRs1(), RS_LENGTH);
+    memcpy(payload + 2 + RS_LENGTH, record->getRs2(), RS_LENGTH);
+    if (record->isMITMKeyAvailable())
+        memcpy(payload + 2 + 2 * RS_LENGTH, record->getMiTMData(), RS_LENGTH);
+    else
+        memset(payload + 2 + 2 * RS_LENGTH, 0, RS_LENGTH);
+    writeRecord(Cache, payload, sizeof(payload));
+    return record;
+}
+
+void ZrtpTraceRecorder::randomDrawn(const uint8_t* buffer, uint32_t length) {
+    writeRecord(Random, buffer, length);
+}
+
+/*
+ * ZrtpTraceReplayer
+ */
+ZrtpTraceReplayer::ZrtpTraceReplayer(): mitm(false), cache(NULL), current(NULL), secure(false), failed(false) {
+    memset(zid, 0, sizeof(zid));
+}
+
+bool ZrtpTraceReplayer::load(const char* fileName) {
+    records.clear();
+    error.clear();
+
+    FILE* file = fopen(fileName, "rb");
+    if (file == NULL) {
+        error = "cannot open the trace file";
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        data.insert(data.end(), chunk, chunk + read);
+    fclose(file);
+
+    if (data.size() < traceMagicLength || memcmp(&data[0], traceMagic, traceMagicLength) != 0) {
+        error = "not a ZRTP trace file";
+        return false;
+    }
+    const uint8_t* in = &data[0] + traceMagicLength;
+    const uint8_t* end = &data[0] + data.size();
+    bool engineSeen = false;
+
+    while (in < end) {
+        Record record;
+        uint64_t length;
+
+        record.type = *in++;
+        if (!getVarint(in, end, &record.delta) || !getVarint(in, end, &length) ||
+            length > static_cast<uint64_t>(end - in)) {
+            error = "truncated trace record";
+            records.clear();
+            return false;
+        }
+        record.payload.assign(in, in + length);
+        in += length;
+
+        if (record.type == Engine) {
+            if (engineSeen || !parseEngine(record.payload)) {
+                if (error.empty())
+                    error = "more than one Engine record";
+                records.clear();
+                return false;
+            }
+            engineSeen = true;
+        }
+        records.push_back(record);
+    }
+    if (!engineSeen) {
+        error = "the trace has no Engine record";
+        records.clear();
+        return false;
+    }
+    return true;
+}
+
+bool ZrtpTraceReplayer::parseEngine(const std::vector<uint8_t>& payload) {
+    const uint8_t* in = payload.empty() ? NULL : &payload[0];
+    const uint8_t* end = in + payload.size();
+
+    if (payload.size() < IDENTIFIER_LEN + 7) {
+        error = "short Engine record";
+        return false;
+    }
+    memcpy(zid, in, IDENTIFIER_LEN);
+    in += IDENTIFIER_LEN;
+    uint8_t flags = *in++;
+    uint8_t policy = *in++;
+    uint32_t presharedLimit = getUint32(in);
+    in += 4;
+    size_t idLength = *in++;
+    if (idLength > static_cast<size_t>(end - in)) {
+        error = "short Engine record";
+        return false;
+    }
+    clientId.assign(reinterpret_cast<const char*>(in), idLength);
+    in += idLength;
+
+    mitm = (flags & EngineMitm) != 0;
+    configure = ZrtpConfigure();
+    configure.setTrustedMitM((flags & EngineTrustedMitm) != 0);
+    configure.setSasSignature((flags & EngineSasSignature) != 0);
+    configure.setParanoidMode((flags & EngineParanoid) != 0);
+    configure.setDisclosureFlag((flags & EngineDisclosure) != 0);
+    configure.setFastStart((flags & EngineFastStart) != 0);
+    configure.setSelectionPolicy(static_cast<ZrtpConfigure::Policy>(policy));
+    configure.setPresharedLimit(presharedLimit);
+
+    for (size_t t = 0; t < sizeof(algoTypes) / sizeof(algoTypes[0]); t++) {
+        if (in >= end) {
+            error = "short Engine record";
+            return false;
+        }
+        size_t num = *in++;
+        if (num * 4 > static_cast<size_t>(end - in)) {
+            error = "short Engine record";
+            return false;
+        }
+        for (size_t i = 0; i < num; i++, in += 4) {
+            char name[5];
+            memcpy(name, in, 4);
+            name[4] = '\0';
+            AlgorithmEnum& algo = getAlgoEnum(algoTypes[t]).getByName(name);
+            if (!algo.isValid()) {
+                error = std::string("unknown algorithm ") + name;
+                return false;
+            }
+            configure.addAlgo(algoTypes[t], algo);
+        }
+    }
+    return true;
+}
+
+bool ZrtpTraceReplayer::replay(Result* result) {
+    if (records.empty())
+        return false;
+
+    memset(result, 0, sizeof(Result));
+    current = result;
+    secure = false;
+    failed = false;
+    cache = NULL;
+    randoms.clear();
+    outputs.clear();
+    for (size_t i = 0; i < records.size(); i++) {
+        const Record* record = &records[i];
+        if (i > 0)
+            result->recordedTime += static_cast<int64_t>(record->delta);
+        if (record->type == Random)
+            randoms.push_back(record);
+        else if (record->type == Sent || record->type == TimerStart || record->type == TimerCancel)
+            outputs.push_back(record);
+        else if (record->type == Cache && cache == NULL)
+            cache = record;
+    }
+
+    ZrtpConfigure traced(configure);
+    traced.setTrace(this);
+
+    uint64_t wallStart = microSeconds();
+    uint64_t cpuStart = zrtpGetThreadCpuTime();
+
+    ZRtp* engine = new ZRtp(zid, this, clientId, &traced, mitm);
+    std::vector<uint8_t> buffer;
+
+    for (size_t i = 0; i < records.size(); i++) {
+        const Record& record = records[i];
+        switch (record.type) {
+            case Start:
+                engine->startZrtpEngine();
+                break;
+
+            case Received: {
+                if (record.payload.size() < 8)
+                    break;
+                uint32_t ssrc = getUint32(&record.payload[0]);
+                uint32_t length = getUint32(&record.payload[4]);
+                // processZrtpMessage expects the message behind the 12 byte RTP like header
+                buffer.assign(12 + record.payload.size() - 8, 0);
+                memcpy(&buffer[12], &record.payload[8], record.payload.size() - 8);
+                engine->processZrtpMessage(&buffer[12], ssrc, length);
+                break;
+            }
+            case Timeout:
+                engine->processTimeout();
+                break;
+
+            case Stop:
+                engine->stopZrtp();
+                break;
+
+            default:
+                continue;
+        }
+        result->events++;
+    }
+    // The trace has the stop of the destructor already, don't compare its outputs again
+    current = NULL;
+    delete engine;
+
+    result->cpuTime = static_cast<int64_t>(zrtpGetThreadCpuTime() - cpuStart);
+    result->wallTime = static_cast<int64_t>(microSeconds() - wallStart);
+    result->mismatches += static_cast<int32_t>(outputs.size());
+    result->secure = secure;
+    result->failed = failed;
+    return true;
+}
+
+void ZrtpTraceReplayer::checkOutput(RecordType type, const uint8_t* data, size_t length) {
+    if (current == NULL)
+        return;
+
+    current->outputs++;
+    if (outputs.empty()) {
+        current->mismatches++;
+        return;
+    }
+    const Record* expected = outputs.front();
+    outputs.pop_front();
+    if (expected->type != type || expected->payload.size() != length ||
+        (length > 0 && memcmp(&expected->payload[0], data, length) != 0)) {
+        current->mismatches++;
+    }
+}
+
+void ZrtpTraceReplayer::traceSent(const uint8_t* data, int32_t length) {
+    checkOutput(Sent, data, sentLength(length));
+}
+
+void ZrtpTraceReplayer::traceTimerStart(int32_t time) {
+    std::vector<uint8_t> payload;
+    putUint32(payload, static_cast<uint32_t>(time));
+    checkOutput(TimerStart, &payload[0], payload.size());
+}
+
+void ZrtpTraceReplayer::traceTimerCancel() {
+    checkOutput(TimerCancel, NULL, 0);
+}
+
+bool ZrtpTraceReplayer::provideRandom(uint8_t* buffer, uint32_t length) {
+    if (randoms.empty() || randoms.front()->payload.size() != length) {
+        if (current != NULL)
+            current->randomMismatches++;
+        return false;
+    }
+    memcpy(buffer, &randoms.front()->payload[0], length);
+    randoms.pop_front();
+    return true;
+}
+
+ZIDRecord* ZrtpTraceReplayer::getRecord(uint8_t* peerZid) {
+    if (cache == NULL || cache->payload.size() != cacheRecordLength) {
+        return NULL;
+    }
+    const uint8_t* in = &cache->payload[0];
+    uint8_t flags = in[0];
+
+    // setNewRs1 shifts RS1 to RS2, thus set RS2 first
+    ZIDRecordFile* record = new ZIDRecordFile();
+    record->setZid(peerZid);
+    record->setNewRs1(in + 2 + RS_LENGTH, (flags & CacheRs2NotExpired) ? -1 : 0);
+    record->setNewRs1(in + 2, (flags & CacheRs1NotExpired) ? -1 : 0);
+    if (flags & CacheRs1Valid)
+        record->setRs1Valid();
+    else
+        record->resetRs1Valid();
+    if (flags & CacheRs2Valid)
+        record->setRs2Valid();
+    else
+        record->resetRs2Valid();
+    if (flags & CacheMitmKey)
+        record->setMiTMData(in + 2 + 2 * RS_LENGTH);
+    if (flags & CacheSasVerified)
+        record->setSasVerified();
+    record->setPreshCounter(in[1]);
+    return record;
+}
@@ -23,36 +23,46 @@
 #include <zrtp/crypto/aesCFB.h>
 #include <cryptcommon/aescpp.h>
 
-void aesCfbEncrypt(uint8_t *key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength)
+/*
+ * Each Confirm key encrypts or decrypts exactly one message per endpoint, thus
+ * a cached key schedule would not be reused. The functions keep the key
+ * schedule on the stack and clear it after use, the AES functions use the
+ * hardware backend if the CPU supports it.
+ */
+static bool setCfbKey(AESencrypt& saAes, const uint8_t* key, int32_t keyLength)
 {
-    auto* saAes = new AESencrypt();
-
     if (keyLength == 16)
-        saAes->key128(key);
+        saAes.key128(key);
     else if (keyLength == 32)
-        saAes->key256(key);
+        saAes.key256(key);
     else
+        return false;
+    return true;
+}
+
+void aesCfbEncrypt(uint8_t *key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength)
+{
+    AESencrypt saAes;
+
+    if (!setCfbKey(saAes, key, keyLength))
         return;
 
     // Note: maybe copy IV to an internal array if we encounter strange things.
     // the cfb encrypt modifies the IV on return. Same for output data (inplace encryption)
-    saAes->cfb_encrypt(data, data, dataLength, IV);
-    delete saAes;
+    saAes.cfb_encrypt(data, data, dataLength, IV);
+    memset(saAes.cx, 0, sizeof(saAes.cx));
 }
 
 
 void aesCfbDecrypt(uint8_t *key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength)
 {
-    auto* saAes = new AESencrypt();
-    if (keyLength == 16)
-        saAes->key128(key);
-    else if (keyLength == 32)
-        saAes->key256(key);
-    else
+    AESencrypt saAes;
+
+    if (!setCfbKey(saAes, key, keyLength))
         return;
 
     // Note: maybe copy IV to an internal array if we encounter strange things.
     // the cfb encrypt modifies the IV on return. Same for output data (inplace encryption)
-    saAes->cfb_decrypt(data, data, dataLength, IV);
-    delete saAes;
+    saAes.cfb_decrypt(data, data, dataLength, IV);
+    memset(saAes.cx, 0, sizeof(saAes.cx));
 }
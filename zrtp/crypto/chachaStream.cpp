@@ -0,0 +1,41 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#include <zrtp/crypto/chachaStream.h>
+#include <cryptcommon/chacha20.h>
+
+static void chachaStream(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength)
+{
+    if (keyLength != CHACHA20_KEY_SIZE || dataLength <= 0)
+        return;
+
+    uint32_t counter = (uint32_t)IV[0] | ((uint32_t)IV[1] << 8) | ((uint32_t)IV[2] << 16) | ((uint32_t)IV[3] << 24);
+    chacha20_xor(key, IV + 4, counter, data, data, (size_t)dataLength);
+}
+
+void chachaEncrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength)
+{
+    chachaStream(key, keyLength, IV, data, dataLength);
+}
+
+void chachaDecrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength)
+{
+    chachaStream(key, keyLength, IV, data, dataLength);
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#ifndef _CHACHASTREAM_H__
+#define _CHACHASTREAM_H__
+
+#include <cstdint>
+
+/**
+ * @file chachaStream.h
+ * @brief Function that provide ChaCha20 support for the ZRTP Confirm packets
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+/**
+ * Encrypt data with ChaCha20.
+ *
+ * This function takes one data chunk and encrypts it with ChaCha20. The
+ * 16 byte IV of the Confirm packet forms the block counter (first 4 bytes,
+ * little endian) and the nonce (remaining 12 bytes) of the cipher.
+ *
+ * @param key
+ *    Points to the key bytes.
+ * @param keyLength
+ *    Length of the key in bytes, must be 32
+ * @param IV
+ *    The initialization vector which must be 16 bytes.
+ * @param data
+ *    Points to a buffer that contains and receives the computed
+ *    the data (in-place encryption).
+ * @param dataLength
+ *    Length of the data in bytes
+ */
+
+void chachaEncrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength);
+
+/**
+ * Decrypt data with ChaCha20.
+ *
+ * ChaCha20 is a stream cipher, thus decryption is the same operation as
+ * encryption.
+ *
+ * @param key
+ *    Points to the key bytes.
+ * @param keyLength
+ *    Length of the key in bytes, must be 32
+ * @param IV
+ *    The initialization vector which must be 16 bytes.
+ * @param data
+ *    Points to a buffer that contains and receives the computed
+ *    the data (in-place decryption).
+ * @param dataLength
+ *    Length of the data in bytes
+ */
+
+void chachaDecrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data, int32_t dataLength);
+/**
+ * @}
+ */
+#endif
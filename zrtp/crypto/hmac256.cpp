@@ -27,12 +27,6 @@
 #pragma clang diagnostic push
 #pragma ide diagnostic ignored "OCUnusedGlobalDeclarationInspection"
 
-typedef struct _hmacSha256Context {
-    sha256_ctx ctx;
-    sha256_ctx innerCtx;
-    sha256_ctx outerCtx;
-} hmacSha256Context;
-
 static int32_t hmacSha256Init(hmacSha256Context *ctx, const uint8_t *key, uint64_t kLength)
 {
     int32_t i;
@@ -152,6 +146,29 @@ void hmacSha256Ctx(void* ctx, const uint8_t* data, uint64_t dataLength,
     *macLength = SHA256_DIGEST_SIZE;
 }
 
+void* initializeSha256HmacContext(void* ctx, const uint8_t* key, uint64_t keyLength)
+{
+    auto *pctx = (hmacSha256Context*)ctx;
+
+    if (pctx == nullptr || hmacSha256Init(pctx, key, keyLength) == 0) {
+        return nullptr;
+    }
+    return pctx;
+}
+
+void hmacSha256Ctx(void* ctx, const uint8_t* const data[], const uint64_t dataLength[], size_t count,
+                   uint8_t* mac, uint32_t* macLength)
+{
+    auto *pctx = (hmacSha256Context*)ctx;
+
+    hmacSha256Reset(pctx);
+    for (size_t i = 0; i < count; i++) {
+        hmacSha256Update(pctx, data[i], dataLength[i]);
+    }
+    hmacSha256Final(pctx, mac);
+    *macLength = SHA256_DIGEST_SIZE;
+}
+
 void hmacSha256Ctx(void* ctx,
                    const std::vector<const uint8_t*>& data,
                    const std::vector<uint64_t>& dataLength,
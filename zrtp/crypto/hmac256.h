@@ -32,11 +32,25 @@
 
 #include <cstdint>
 #include <vector>
+#include "zrtp/crypto/sha2.h"
 
 #ifndef SHA256_DIGEST_LENGTH
 #define SHA256_DIGEST_LENGTH 32
 #endif
 
+/**
+ * @brief Context of a keyed SHA256 HMAC.
+ *
+ * The context holds the prepared inner and outer hash states of a key. An
+ * application may allocate the context on the stack or as a member and
+ * initialize it with initializeSha256HmacContext().
+ */
+typedef struct _hmacSha256Context {
+    sha256_ctx ctx;
+    sha256_ctx innerCtx;
+    sha256_ctx outerCtx;
+} hmacSha256Context;
+
 /**
  * Compute SHA256 HMAC.
  *
@@ -86,6 +100,44 @@ void hmacSha256(const uint8_t* key, uint64_t key_length,
                 const std::vector<const uint8_t*>& data,
                 const std::vector<uint64_t>& dataLength,
                 uint8_t* mac, uint32_t* mac_length);
+
+/**
+ * @brief Initialize a SHA256 HMAC context with a key.
+ *
+ * The function does not allocate memory. The application may use the context
+ * for several HMAC computations with the same key, it should clear the context
+ * after use because it contains data derived from the key.
+ *
+ * @param ctx
+ *    Points to a hmacSha256Context.
+ * @param key
+ *    The MAC key.
+ * @param keyLength
+ *    Length of the MAC key in bytes
+ * @return
+ *    Pointer to the initialized context, @c NULL if @c key is @c NULL.
+ */
+void* initializeSha256HmacContext(void* ctx, const uint8_t* key, uint64_t keyLength);
+
+/**
+ * @brief Compute SHA256 HMAC over an array of data chunks with a prepared context.
+ *
+ * @param ctx
+ *    Points to a context that was initialized with initializeSha256HmacContext().
+ * @param data
+ *    Array of pointers that point to the data chunks.
+ * @param dataLength
+ *    Array of integers that hold the length of each data chunk.
+ * @param count
+ *    Number of data chunks.
+ * @param mac
+ *    Points to a buffer that receives the computed digest. This
+ *    buffer must have a size of at least 32 bytes (SHA256_DIGEST_LENGTH).
+ * @param macLength
+ *    Point to an integer that receives the length of the computed HMAC.
+ */
+void hmacSha256Ctx(void* ctx, const uint8_t* const data[], const uint64_t dataLength[], size_t count,
+                   uint8_t* mac, uint32_t* macLength);
 /**
  * @}
  */
@@ -24,12 +24,6 @@
 #include "zrtp/crypto/sha2.h"
 #include "zrtp/crypto/hmac384.h"
 
-typedef struct _hmacSha384Context {
-    sha384_ctx ctx;
-    sha384_ctx innerCtx;
-    sha384_ctx outerCtx;
-} hmacSha384Context;
-
 static int32_t hmacSha384Init(hmacSha384Context *ctx, const uint8_t *key, uint64_t kLength)
 {
     int32_t i;
@@ -149,6 +143,29 @@ void hmacSha384Ctx(void* ctx, const uint8_t* data, uint64_t dataLength,
     *macLength = SHA384_DIGEST_SIZE;
 }
 
+void* initializeSha384HmacContext(void* ctx, const uint8_t* key, uint64_t keyLength)
+{
+    auto *pctx = (hmacSha384Context*)ctx;
+
+    if (pctx == nullptr || hmacSha384Init(pctx, key, keyLength) == 0) {
+        return nullptr;
+    }
+    return pctx;
+}
+
+void hmacSha384Ctx(void* ctx, const uint8_t* const data[], const uint64_t dataLength[], size_t count,
+                   uint8_t* mac, uint32_t* macLength)
+{
+    auto *pctx = (hmacSha384Context*)ctx;
+
+    hmacSha384Reset(pctx);
+    for (size_t i = 0; i < count; i++) {
+        hmacSha384Update(pctx, data[i], dataLength[i]);
+    }
+    hmacSha384Final(pctx, mac);
+    *macLength = SHA384_DIGEST_SIZE;
+}
+
 void hmacSha384Ctx(void* ctx,
                    const std::vector<const uint8_t*>& data,
                    const std::vector<uint64_t>& dataLength,
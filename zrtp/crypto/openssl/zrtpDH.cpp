@@ -26,6 +26,7 @@
 
 #include <zrtp/crypto/zrtpDH.h>
 #include <zrtp/libzrtpcpp/ZrtpTextData.h>
+#include <common/MemoryUsage.h>
 
 // extern void initializeOpenSSL();
 
@@ -387,6 +388,80 @@ int32_t ZrtpDH::checkPubKey(uint8_t *pubKeyBytes) const
     return 1;
 }
 
+// OpenSSL has no batch key generation, generate each key pair on its own
+int32_t ZrtpDH::generateKeyPairs(const char* type, ZrtpDH* keyPairs[], int32_t count)
+{
+    for (int32_t i = 0; i < count; i++) {
+        keyPairs[i] = new ZrtpDH(type);
+        keyPairs[i]->generatePublicKey();
+    }
+    return count < 0 ? 0 : count;
+}
+
+int32_t ZrtpDH::checkPubKeys(const char* type, const uint8_t* const pubKeys[], int32_t count, int32_t valid[])
+{
+    int32_t numValid = 0;
+    int nid = 0;
+    const uint8_t* prime = nullptr;
+    int32_t length = 0;
+
+    if (*(int32_t*)type == *(int32_t*)dh2k) {
+        prime = P2048;
+        length = sizeof(P2048);
+    }
+    else if (*(int32_t*)type == *(int32_t*)dh3k) {
+        prime = P3072;
+        length = sizeof(P3072);
+    }
+    else if (*(int32_t*)type == *(int32_t*)ec25) {
+        nid = NID_X9_62_prime256v1;
+        length = 64;
+    }
+    else if (*(int32_t*)type == *(int32_t*)ec38) {
+        nid = NID_secp384r1;
+        length = 96;
+    }
+    if (length == 0) {
+        for (int32_t i = 0; i < count; i++)
+            valid[i] = 0;
+        return 0;
+    }
+
+    // Use one group and point for all public keys of the batch
+    if (nid != 0) {
+        uint8_t buffer[97];
+        EC_GROUP* group = EC_GROUP_new_by_curve_name(nid);
+        EC_POINT* point = EC_POINT_new(group);
+
+        buffer[0] = POINT_CONVERSION_UNCOMPRESSED;
+        for (int32_t i = 0; i < count; i++) {
+            memcpy(buffer+1, pubKeys[i], length);
+            valid[i] = EC_POINT_oct2point(group, point, buffer, length+1, nullptr) == 1 &&
+                       EC_POINT_is_on_curve(group, point, nullptr) == 1 &&
+                       EC_POINT_is_at_infinity(group, point) == 0;
+            numValid += valid[i];
+        }
+        EC_POINT_free(point);
+        EC_GROUP_free(group);
+        return numValid;
+    }
+
+    // The public value must not be 1 or p - 1, p - 1 differs from p in the last byte
+    for (int32_t i = 0; i < count; i++) {
+        const uint8_t* key = pubKeys[i];
+        bool one = key[length - 1] == 1;
+        bool minusOne = key[length - 1] == (uint8_t)(prime[length - 1] - 1);
+
+        for (int32_t k = 0; k < length - 1; k++) {
+            one = one && key[k] == 0;
+            minusOne = minusOne && key[k] == prime[k];
+        }
+        valid[i] = !one && !minusOne;
+        numValid += valid[i];
+    }
+    return numValid;
+}
+
 const char* ZrtpDH::getDHtype()
 {
     switch (pkType) {
@@ -403,6 +478,15 @@ const char* ZrtpDH::getDHtype()
     }
 }
 
+/*
+ * OpenSSL does not publish the size of its DH and EC_KEY structures, thus the
+ * report contains the size of the object only.
+ */
+void ZrtpDH::addMemoryUsage(MemoryUsage& usage) const
+{
+    usage.add(MemoryUsage::KeyAgreement, sizeof(ZrtpDH));
+}
+
 /** EMACS **
  * Local variables:
  * mode: c++
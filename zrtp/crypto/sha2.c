@@ -80,6 +80,8 @@
 #include <string.h>     /* for memcpy() etc.        */
 
 #include "sha2.h"
+#include "sha256_hw.h"
+#include "sha512_hw.h"
 
 #include <cryptcommon/brg_endian.h>
 
@@ -189,7 +191,7 @@ const uint_32t k256[64] =
 /* in the ORIGINAL byte stream will go into the high end of */
 /* words on BOTH big and little endian systems              */
 
-VOID_RETURN sha256_compile(sha256_ctx ctx[1])
+static void sha256_compile_c(sha256_ctx ctx[1])
 {
 #if !defined(UNROLL_SHA2)
 
@@ -298,6 +300,14 @@ VOID_RETURN sha256_compile(sha256_ctx ctx[1])
 #endif
 }
 
+VOID_RETURN sha256_compile(sha256_ctx ctx[1])
+{
+    if (sha256_hw_available())
+        sha256_hw_compile(ctx->hash, ctx->wbuf);
+    else
+        sha256_compile_c(ctx);
+}
+
 /* SHA256 hash data in an array of bytes into hash buffer   */
 /* and call the hash_compile function as required.          */
 
@@ -511,7 +521,7 @@ const uint_64t  k512[80] =
 /* in the ORIGINAL byte stream will go into the high end of */
 /* words on BOTH big and little endian systems              */
 
-VOID_RETURN sha512_compile(sha512_ctx ctx[1])
+static void sha512_compile_c(sha512_ctx ctx[1])
 {   uint_64t    v[8], *p = ctx->wbuf;
     uint_32t    j;
 
@@ -535,6 +545,14 @@ VOID_RETURN sha512_compile(sha512_ctx ctx[1])
     ctx->hash[6] += v[6]; ctx->hash[7] += v[7];
 }
 
+VOID_RETURN sha512_compile(sha512_ctx ctx[1])
+{
+    if (sha512_hw_available())
+        sha512_hw_compile(ctx->hash, ctx->wbuf);
+    else
+        sha512_compile_c(ctx);
+}
+
 /* Compile 128 bytes of hash data into SHA256 digest value  */
 /* NOTE: this routine assumes that the byte order in the    */
 /* ctx->wbuf[] at this point is in such an order that low   */
@@ -19,6 +19,7 @@
  */
 
 #include <zrtp/crypto/sha2.h>
+#include <zrtp/crypto/sha256_hw.h>
 #include <zrtp/crypto/sha256.h>
 
 void sha256(const uint8_t *data, uint64_t dataLength, uint8_t *digest )
@@ -41,6 +42,11 @@ void sha256(const std::vector<const uint8_t*>& data, const std::vector<uint64_t>
     sha256_end(digest, &ctx);
 }
 
+void sha256Multi(const uint8_t* const data[], uint64_t dataLength, uint8_t* const digest[], size_t count)
+{
+    sha256_multi(data, (unsigned long)dataLength, digest, (unsigned int)count);
+}
+
 void* createSha256Context()
 {
     auto *ctx = reinterpret_cast<sha256_ctx*>(malloc(sizeof(sha256_ctx)));
@@ -75,6 +75,26 @@ void sha256(const uint8_t *data,
  */
 void sha256(const std::vector<const uint8_t*>& data, const std::vector<uint64_t >& dataLength, uint8_t *digest);
 
+/**
+ * Compute the SHA256 digests of several data chunks of the same length.
+ *
+ * This functions computes one digest for each data chunk. If the CPU has no
+ * SHA instructions the function computes up to four digests in parallel in
+ * the lanes of the SIMD registers, for example the hash chains of several
+ * new ZRTP sessions.
+ *
+ * @param data
+ *    Array of pointers that point to the data chunks.
+ * @param dataLength
+ *    Length of each data chunk in bytes.
+ * @param digest
+ *    Array of pointers to buffers that receive the computed digests. Each
+ *    buffer must have a size of at least 32 bytes (SHA256_DIGEST_LENGTH).
+ * @param count
+ *    Number of data chunks.
+ */
+void sha256Multi(const uint8_t* const data[], uint64_t dataLength, uint8_t* const digest[], size_t count);
+
 /**
  * Create and initialize a SHA256 context.
  *
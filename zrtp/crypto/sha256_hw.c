@@ -0,0 +1,267 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Hardware SHA256 compression for x86 (SHA extensions) and AArch64 (ARMv8
+ * Crypto Extensions), multi-buffer SHA256 with four SIMD lanes.
+ *
+ * sha256_compile gets the message words already converted to host byte
+ * order, thus the functions load the words without a byte swap. The
+ * functions use the target attribute to enable the instructions only for
+ * the functions that use them.
+ */
+
+#include <string.h>
+
+#include "sha2.h"
+#include "sha256_hw.h"
+
+#include <common/cpuFeatures.h>
+
+/* Round constants and initial hash values, defined in sha2.c */
+extern const uint_32t k256[64];
+extern const uint_32t i256[8];
+
+#if !defined(SHA256_NO_HW) && (defined(__GNUC__) || defined(__clang__))
+#  if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || __GNUC__ >= 5)
+#    define SHA256_HW_X86
+#  elif defined(__aarch64__) && !defined(__AARCH64EB__) && (defined(__clang__) || __GNUC__ >= 6)
+#    define SHA256_HW_ARM
+#  endif
+#endif
+
+#if defined(SHA256_HW_X86)
+
+#include <immintrin.h>
+
+#define SHA256_HW_TARGET __attribute__((target("sha,sse4.1")))
+
+static int checkCpu(void)
+{
+    return (zrtpCpuFeatures() & ZRTP_CPU_SHA256) ? 1 : 0;
+}
+
+SHA256_HW_TARGET
+void sha256_hw_compile(uint_32t hash[8], const uint_32t wbuf[16])
+{
+    __m128i state0, state1, save0, save1, tmp, msg[4];
+    int g;
+
+    /* SHA256 instructions use the state words in the order ABEF and CDGH */
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)hash), 0xb1);
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(hash + 4)), 0x1b);
+    state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+    save0 = state0;
+    save1 = state1;
+
+    for (g = 0; g < 4; g++)
+        msg[g] = _mm_loadu_si128((const __m128i*)(wbuf + 4 * g));
+
+    /* 16 groups of four rounds, compute the message words of group g + 4 */
+    for (g = 0; g < 16; g++) {
+        tmp = _mm_add_epi32(msg[g & 3], _mm_loadu_si128((const __m128i*)(k256 + 4 * g)));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, tmp);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(tmp, 0x0e));
+        if (g < 12) {
+            tmp = _mm_sha256msg1_epu32(msg[g & 3], msg[(g + 1) & 3]);
+            tmp = _mm_add_epi32(tmp, _mm_alignr_epi8(msg[(g + 3) & 3], msg[(g + 2) & 3], 4));
+            msg[g & 3] = _mm_sha256msg2_epu32(tmp, msg[(g + 3) & 3]);
+        }
+    }
+    state0 = _mm_add_epi32(state0, save0);
+    state1 = _mm_add_epi32(state1, save1);
+
+    tmp = _mm_shuffle_epi32(state0, 0x1b);
+    state1 = _mm_shuffle_epi32(state1, 0xb1);
+    _mm_storeu_si128((__m128i*)hash, _mm_blend_epi16(tmp, state1, 0xf0));
+    _mm_storeu_si128((__m128i*)(hash + 4), _mm_alignr_epi8(state1, tmp, 8));
+}
+
+#elif defined(SHA256_HW_ARM)
+
+#include <arm_neon.h>
+
+#if defined(__clang__)
+#  define SHA256_HW_TARGET __attribute__((target("crypto")))
+#else
+#  define SHA256_HW_TARGET __attribute__((target("+crypto")))
+#endif
+
+static int checkCpu(void)
+{
+    return (zrtpCpuFeatures() & ZRTP_CPU_SHA256) ? 1 : 0;
+}
+
+SHA256_HW_TARGET
+void sha256_hw_compile(uint_32t hash[8], const uint_32t wbuf[16])
+{
+    uint32x4_t abcd, efgh, abcdSave, efghSave, abcdPrev, tmp, msg[4];
+    int g;
+
+    abcd = vld1q_u32(hash);
+    efgh = vld1q_u32(hash + 4);
+    abcdSave = abcd;
+    efghSave = efgh;
+
+    for (g = 0; g < 4; g++)
+        msg[g] = vld1q_u32(wbuf + 4 * g);
+
+    /* 16 groups of four rounds, compute the message words of group g + 4 */
+    for (g = 0; g < 16; g++) {
+        tmp = vaddq_u32(msg[g & 3], vld1q_u32(k256 + 4 * g));
+        abcdPrev = abcd;
+        abcd = vsha256hq_u32(abcd, efgh, tmp);
+        efgh = vsha256h2q_u32(efgh, abcdPrev, tmp);
+        if (g < 12)
+            msg[g & 3] = vsha256su1q_u32(vsha256su0q_u32(msg[g & 3], msg[(g + 1) & 3]),
+                                         msg[(g + 2) & 3], msg[(g + 3) & 3]);
+    }
+    vst1q_u32(hash, vaddq_u32(abcd, abcdSave));
+    vst1q_u32(hash + 4, vaddq_u32(efgh, efghSave));
+}
+
+#else
+
+static int checkCpu(void)
+{
+    return 0;
+}
+
+void sha256_hw_compile(uint_32t hash[8], const uint_32t wbuf[16])
+{
+    (void)hash;
+    (void)wbuf;
+}
+
+#endif
+
+int sha256_hw_available(void)
+{
+    return checkCpu();
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+
+/*
+ * Four SHA256 computations in the lanes of a vector, the compiler maps the
+ * vector type to SSE2 on x86 and to NEON on ARM.
+ */
+#define SHA256_LANES 4
+
+typedef uint_32t v4u32 __attribute__((vector_size(16)));
+
+#define vsplat(x)     ((v4u32){(x), (x), (x), (x)})
+#define vrotr(x, n)   (((x) >> (n)) | ((x) << (32 - (n))))
+#define vs_0(x)       (vrotr((x),  2) ^ vrotr((x), 13) ^ vrotr((x), 22))
+#define vs_1(x)       (vrotr((x),  6) ^ vrotr((x), 11) ^ vrotr((x), 25))
+#define vg_0(x)       (vrotr((x),  7) ^ vrotr((x), 18) ^ ((x) >>  3))
+#define vg_1(x)       (vrotr((x), 17) ^ vrotr((x), 19) ^ ((x) >> 10))
+#define vch(x, y, z)  ((z) ^ ((x) & ((y) ^ (z))))
+#define vmaj(x, y, z) (((x) & (y)) | ((z) & ((x) ^ (y))))
+
+#define load_be32(p)  (((uint_32t)(p)[0] << 24) | ((uint_32t)(p)[1] << 16) | \
+                       ((uint_32t)(p)[2] << 8) | (uint_32t)(p)[3])
+
+static void sha256_compile_x4(v4u32 hash[8], const unsigned char* const block[SHA256_LANES])
+{
+    v4u32 v[8], w[16], t1, t2;
+    int j;
+
+    for (j = 0; j < 16; j++)
+        w[j] = (v4u32){load_be32(block[0] + 4 * j), load_be32(block[1] + 4 * j),
+                       load_be32(block[2] + 4 * j), load_be32(block[3] + 4 * j)};
+
+    memcpy(v, hash, sizeof(v));
+    for (j = 0; j < 64; j++) {
+        if (j >= 16)
+            w[j & 15] += vg_1(w[(j + 14) & 15]) + w[(j + 9) & 15] + vg_0(w[(j + 1) & 15]);
+        t1 = v[7] + vs_1(v[4]) + vch(v[4], v[5], v[6]) + vsplat(k256[j]) + w[j & 15];
+        t2 = vs_0(v[0]) + vmaj(v[0], v[1], v[2]);
+        v[7] = v[6]; v[6] = v[5]; v[5] = v[4]; v[4] = v[3] + t1;
+        v[3] = v[2]; v[2] = v[1]; v[1] = v[0]; v[0] = t1 + t2;
+    }
+    for (j = 0; j < 8; j++)
+        hash[j] += v[j];
+}
+
+/* Hash up to four messages of the same length, unused lanes repeat the last message */
+static void sha256_x4(const unsigned char* const data[], unsigned long len, unsigned char* const hval[], unsigned int n)
+{
+    v4u32 hash[8];
+    uint_32t lanes[SHA256_LANES];
+    unsigned char tail[SHA256_LANES][2 * SHA256_BLOCK_SIZE];
+    const unsigned char* block[SHA256_LANES];
+    unsigned long blocks = len / SHA256_BLOCK_SIZE, offset;
+    unsigned int rest = (unsigned int)(len % SHA256_BLOCK_SIZE);
+    unsigned int tailLen = rest < SHA256_BLOCK_SIZE - 8 ? SHA256_BLOCK_SIZE : 2 * SHA256_BLOCK_SIZE;
+    uint_64t bits = (uint_64t)len << 3;
+    unsigned int i, l;
+
+    for (i = 0; i < 8; i++)
+        hash[i] = vsplat(i256[i]);
+
+    for (offset = 0; blocks > 0; blocks--, offset += SHA256_BLOCK_SIZE) {
+        for (l = 0; l < SHA256_LANES; l++)
+            block[l] = data[l < n ? l : n - 1] + offset;
+        sha256_compile_x4(hash, block);
+    }
+
+    /* Padding: 0x80, zero bytes, message length in bits as 64 bit big endian */
+    for (l = 0; l < SHA256_LANES; l++) {
+        memcpy(tail[l], data[l < n ? l : n - 1] + offset, rest);
+        tail[l][rest] = 0x80;
+        memset(tail[l] + rest + 1, 0, tailLen - rest - 1);
+        for (i = 0; i < 8; i++)
+            tail[l][tailLen - 1 - i] = (unsigned char)(bits >> (8 * i));
+    }
+    for (offset = 0; offset < tailLen; offset += SHA256_BLOCK_SIZE) {
+        for (l = 0; l < SHA256_LANES; l++)
+            block[l] = tail[l] + offset;
+        sha256_compile_x4(hash, block);
+    }
+
+    for (i = 0; i < 8; i++) {
+        memcpy(lanes, &hash[i], sizeof(lanes));
+        for (l = 0; l < n; l++) {
+            hval[l][4 * i] = (unsigned char)(lanes[l] >> 24);
+            hval[l][4 * i + 1] = (unsigned char)(lanes[l] >> 16);
+            hval[l][4 * i + 2] = (unsigned char)(lanes[l] >> 8);
+            hval[l][4 * i + 3] = (unsigned char)lanes[l];
+        }
+    }
+}
+
+#endif
+
+void sha256_multi(const unsigned char* const data[], unsigned long len, unsigned char* const hval[], unsigned int count)
+{
+    unsigned int i = 0;
+
+#if defined(SHA256_LANES)
+    unsigned int n;
+
+    /* One SHA instruction stream is faster than four SIMD lanes */
+    if (!sha256_hw_available()) {
+        for (; count - i >= 2; i += n) {
+            n = count - i < SHA256_LANES ? count - i : SHA256_LANES;
+            sha256_x4(data + i, len, hval + i, n);
+        }
+    }
+#endif
+    for (; i < count; i++)
+        sha256_zrtp(hval[i], data[i], len);
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SHA256_HW_H
+#define _SHA256_HW_H
+
+/**
+ * @file sha256_hw.h
+ * @brief Hardware SHA256 compression function and multi-buffer SHA256
+ *
+ * The compression function uses the SHA extensions (SHA-NI) on x86 and the
+ * ARMv8 Crypto Extensions on AArch64. The standard @c sha256_compile function
+ * dispatches to the hardware function at runtime if the CPU supports the
+ * instructions.
+ *
+ * The multi-buffer function hashes several messages of the same length. If
+ * the CPU has no SHA instructions it runs four messages in the lanes of the
+ * SIMD registers.
+ *
+ * Define @c SHA256_NO_HW to disable the hardware support at compile time.
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <cryptcommon/brg_types.h>
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/**
+ * @brief Check if the CPU supports the SHA256 instructions.
+ *
+ * The function checks the CPU features only once and caches the result.
+ *
+ * @return 1 if hardware SHA256 is available, 0 otherwise
+ */
+int sha256_hw_available(void);
+
+/**
+ * @brief Compress one 64 byte block into the SHA256 chaining state.
+ *
+ * Call this function only if @c sha256_hw_available() returned 1.
+ *
+ * @param hash the eight 32 bit words of the SHA256 chaining state
+ * @param wbuf the 16 message words of the block in host byte order, as
+ *        prepared for @c sha256_compile
+ */
+void sha256_hw_compile(uint_32t hash[8], const uint_32t wbuf[16]);
+
+/**
+ * @brief Compute the SHA256 digests of several messages of the same length.
+ *
+ * @param data pointers to the messages
+ * @param len length of each message in bytes
+ * @param hval pointers to the buffers that receive the 32 byte digests
+ * @param count number of messages
+ */
+void sha256_multi(const unsigned char* const data[], unsigned long len, unsigned char* const hval[], unsigned int count);
+
+#if defined(__cplusplus)
+}
+#endif
+
+/**
+ * @}
+ */
+#endif
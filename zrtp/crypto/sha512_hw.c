@@ -0,0 +1,141 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * SHA384/SHA512 compression for x86-64 with AVX2 and BMI2.
+ *
+ * The SHA512 message schedule depends on the word two positions back, thus
+ * a vector of four words needs two steps: the first computes the sums that
+ * do not depend on the new words for all four lanes, the second adds the
+ * sigma1 terms, first for the lower two and then for the upper two lanes.
+ * The rounds run in scalar registers, BMI2 provides rotate instructions that
+ * do not modify the flags. The function uses the target attribute to enable
+ * the instructions only for this function.
+ */
+
+#include "sha2.h"
+#include "sha512_hw.h"
+
+#include <common/cpuFeatures.h>
+
+/* Round constants, defined in sha2.c */
+extern const uint_64t k512[80];
+
+#if !defined(SHA512_NO_HW) && (defined(__GNUC__) || defined(__clang__))
+#  if defined(__x86_64__) && (defined(__clang__) || __GNUC__ >= 5)
+#    define SHA512_HW_X86
+#  endif
+#endif
+
+#if defined(SHA512_HW_X86)
+
+#include <immintrin.h>
+
+#define SHA512_HW_TARGET __attribute__((target("avx2,bmi2")))
+
+static int checkCpu(void)
+{
+    return (zrtpCpuFeatures() & ZRTP_CPU_SHA512) ? 1 : 0;
+}
+
+#define vrotr256(x, n)  _mm256_or_si256(_mm256_srli_epi64((x), (n)), _mm256_slli_epi64((x), 64 - (n)))
+#define vrotr128(x, n)  _mm_or_si128(_mm_srli_epi64((x), (n)), _mm_slli_epi64((x), 64 - (n)))
+
+#define vg_0(x)  _mm256_xor_si256(_mm256_xor_si256(vrotr256((x), 1), vrotr256((x), 8)), _mm256_srli_epi64((x), 7))
+#define vg_1(x)  _mm_xor_si128(_mm_xor_si128(vrotr128((x), 19), vrotr128((x), 61)), _mm_srli_epi64((x), 6))
+
+#define rotr64(x, n)   (((x) >> (n)) | ((x) << (64 - (n))))
+#define s_0(x)         (rotr64((x), 28) ^ rotr64((x), 34) ^ rotr64((x), 39))
+#define s_1(x)         (rotr64((x), 14) ^ rotr64((x), 18) ^ rotr64((x), 41))
+#define ch(x, y, z)    ((z) ^ ((x) & ((y) ^ (z))))
+#define maj(x, y, z)   (((x) & (y)) | ((z) & ((x) ^ (y))))
+
+#define round512(a, b, c, d, e, f, g, h, i)                        \
+    {   uint_64t t1 = h + s_1(e) + ch(e, f, g) + wk[i];             \
+        d += t1;                                                   \
+        h = t1 + s_0(a) + maj(a, b, c);                            \
+    }
+
+/* The next four message words from the last 16 words in x0 (oldest) to x3 */
+#define schedule512(x0, x1, x2, x3)                                                             \
+    {   __m256i w15 = _mm256_alignr_epi8(_mm256_permute2x128_si256(x0, x1, 0x21), x0, 8);       \
+        __m256i w7 = _mm256_alignr_epi8(_mm256_permute2x128_si256(x2, x3, 0x21), x2, 8);        \
+        __m256i sum = _mm256_add_epi64(_mm256_add_epi64(x0, vg_0(w15)), w7);                    \
+        __m128i low = _mm_add_epi64(_mm256_castsi256_si128(sum),                                \
+                                    vg_1(_mm256_extracti128_si256(x3, 1)));                     \
+        __m128i high = _mm_add_epi64(_mm256_extracti128_si256(sum, 1), vg_1(low));              \
+        x0 = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);                     \
+    }
+
+/* Four rounds with the message words x, computes the message words for four rounds later */
+#define rounds512(x, x1, x2, x3, i)                                                             \
+    {   _mm256_store_si256((__m256i*)wk, _mm256_add_epi64(x, _mm256_loadu_si256((const __m256i*)(k512 + (i))))); \
+        if ((i) < 64)                                                                           \
+            schedule512(x, x1, x2, x3);                                                         \
+        round512(a, b, c, d, e, f, g, h, 0);                                                    \
+        round512(h, a, b, c, d, e, f, g, 1);                                                    \
+        round512(g, h, a, b, c, d, e, f, 2);                                                    \
+        round512(f, g, h, a, b, c, d, e, 3);                                                    \
+        t = a; a = e; e = t; t = b; b = f; f = t;                                               \
+        t = c; c = g; g = t; t = d; d = h; h = t;                                               \
+    }
+
+SHA512_HW_TARGET
+void sha512_hw_compile(uint_64t hash[8], const uint_64t wbuf[16])
+{
+    uint_64t wk[4] __attribute__((aligned(32)));
+    uint_64t a, b, c, d, e, f, g, h, t;
+    __m256i x0, x1, x2, x3;
+    int i;
+
+    x0 = _mm256_loadu_si256((const __m256i*)wbuf);
+    x1 = _mm256_loadu_si256((const __m256i*)(wbuf + 4));
+    x2 = _mm256_loadu_si256((const __m256i*)(wbuf + 8));
+    x3 = _mm256_loadu_si256((const __m256i*)(wbuf + 12));
+
+    a = hash[0]; b = hash[1]; c = hash[2]; d = hash[3];
+    e = hash[4]; f = hash[5]; g = hash[6]; h = hash[7];
+
+    for (i = 0; i < 80; i += 16) {
+        rounds512(x0, x1, x2, x3, i);
+        rounds512(x1, x2, x3, x0, i + 4);
+        rounds512(x2, x3, x0, x1, i + 8);
+        rounds512(x3, x0, x1, x2, i + 12);
+    }
+
+    hash[0] += a; hash[1] += b; hash[2] += c; hash[3] += d;
+    hash[4] += e; hash[5] += f; hash[6] += g; hash[7] += h;
+}
+
+#else
+
+static int checkCpu(void)
+{
+    return 0;
+}
+
+void sha512_hw_compile(uint_64t hash[8], const uint_64t wbuf[16])
+{
+    (void)hash;
+    (void)wbuf;
+}
+
+#endif
+
+int sha512_hw_available(void)
+{
+    return checkCpu();
+}
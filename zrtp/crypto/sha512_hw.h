@@ -0,0 +1,69 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SHA512_HW_H
+#define _SHA512_HW_H
+
+/**
+ * @file sha512_hw.h
+ * @brief SIMD SHA384/SHA512 compression function
+ *
+ * The compression function computes the message schedule with AVX2 and the
+ * rounds with the BMI2 rotate instructions on x86-64. The standard
+ * @c sha512_compile function dispatches to this function at runtime if the
+ * CPU supports the instructions.
+ *
+ * Define @c SHA512_NO_HW to disable the SIMD support at compile time.
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <cryptcommon/brg_types.h>
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/**
+ * @brief Check if the CPU supports the SIMD SHA512 compression function.
+ *
+ * The function checks the CPU features only once and caches the result.
+ *
+ * @return 1 if the SIMD function is available, 0 otherwise
+ */
+int sha512_hw_available(void);
+
+/**
+ * @brief Compress one 128 byte block into the SHA512 chaining state.
+ *
+ * Call this function only if @c sha512_hw_available() returned 1.
+ *
+ * @param hash the eight 64 bit words of the SHA512 chaining state
+ * @param wbuf the 16 message words of the block in host byte order, as
+ *        prepared for @c sha512_compile
+ */
+void sha512_hw_compile(uint_64t hash[8], const uint_64t wbuf[16]);
+
+#if defined(__cplusplus)
+}
+#endif
+
+/**
+ * @}
+ */
+#endif
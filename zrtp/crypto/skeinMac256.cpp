@@ -57,6 +57,18 @@ void macSkein256Ctx(void* ctx, const std::vector<const uint8_t*>& data,
     *macLength = SKEIN256_DIGEST_LENGTH;
 }
 
+void* initializeMacSkein256Context(void* ctx, const uint8_t* key, uint64_t keyLength)
+{
+    return initializeSkeinMacContext(ctx, key, keyLength, SKEIN256_DIGEST_LENGTH*8, SKEIN_SIZE);
+}
+
+void macSkein256Ctx(void* ctx, const uint8_t* const data[], const uint64_t dataLength[], size_t count,
+                    uint8_t* mac, uint32_t* macLength)
+{
+    macSkeinCtx(ctx, data, dataLength, count, mac);
+    *macLength = SKEIN256_DIGEST_LENGTH;
+}
+
 void freeMacSkein256Context(void* ctx)
 {
     freeSkeinMacContext(ctx);
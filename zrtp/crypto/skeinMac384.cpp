@@ -59,6 +59,18 @@ void macSkein384Ctx(void* ctx,
     *macLength = SKEIN384_DIGEST_LENGTH;
 }
 
+void* initializeMacSkein384Context(void* ctx, const uint8_t* key, uint64_t keyLength)
+{
+    return initializeSkeinMacContext(ctx, key, keyLength, SKEIN384_DIGEST_LENGTH*8, SKEIN_SIZE);
+}
+
+void macSkein384Ctx(void* ctx, const uint8_t* const data[], const uint64_t dataLength[], size_t count,
+                    uint8_t* mac, uint32_t* macLength)
+{
+    macSkeinCtx(ctx, data, dataLength, count, mac);
+    *macLength = SKEIN384_DIGEST_LENGTH;
+}
+
 void freeMacSkein384Context(void* ctx)
 {
     freeSkeinMacContext(ctx);
@@ -87,6 +87,43 @@ void macSkein384(const uint8_t* key, uint64_t keyLength,
                  const std::vector<const uint8_t*>& data,
                  const std::vector<uint64_t>& dataLength,
                  uint8_t* mac, uint32_t* mac_length);
+
+/**
+ * Initialize a Skein384 MAC context with a key.
+ *
+ * The function does not allocate memory, the context must have the size of a
+ * @c SkeinCtx_t. The application should clear the context after use.
+ *
+ * @param ctx
+ *    Points to the Skein MAC context.
+ * @param key
+ *    The MAC key.
+ * @param keyLength
+ *    Length of the MAC key in bytes
+ * @return
+ *    Pointer to the initialized context.
+ */
+void* initializeMacSkein384Context(void* ctx, const uint8_t* key, uint64_t keyLength);
+
+/**
+ * Compute Skein384 MAC over an array of data chunks with a prepared context.
+ *
+ * @param ctx
+ *    Points to a context that was initialized with initializeMacSkein384Context().
+ * @param data
+ *    Array of pointers that point to the data chunks.
+ * @param dataLength
+ *    Array of integers that hold the length of each data chunk.
+ * @param count
+ *    Number of data chunks.
+ * @param mac
+ *    Points to a buffer that receives the computed digest. This
+ *    buffer must have a size of at least 48 bytes (SKEIN384_DIGEST_LENGTH).
+ * @param macLength
+ *    Pointer to an uint32_t that receives the length of the computed HMAC.
+ */
+void macSkein384Ctx(void* ctx, const uint8_t* const data[], const uint64_t dataLength[], size_t count,
+                    uint8_t* mac, uint32_t* macLength);
 /**
  * @}
  */
@@ -41,6 +41,7 @@ void twoCfbEncrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data,
 
     Twofish_cfb128_encrypt(&keyCtx, (Twofish_Byte*)data, (Twofish_Byte*)data,
 			   (size_t)dataLength, (Twofish_Byte*)IV, &usedBytes);
+    memset(&keyCtx, 0, sizeof(Twofish_key));
 }
 
 
@@ -59,4 +60,5 @@ void twoCfbDecrypt(uint8_t* key, int32_t keyLength, uint8_t* IV, uint8_t *data,
 
     Twofish_cfb128_decrypt(&keyCtx, (Twofish_Byte*)data, (Twofish_Byte*)data, 
 			   (size_t)dataLength, (Twofish_Byte*)IV, &usedBytes);
+    memset(&keyCtx, 0, sizeof(Twofish_key));
 }
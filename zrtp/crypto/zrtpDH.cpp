@@ -23,6 +23,8 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <mutex>
+#include <vector>
 
 #include <bn.h>
 #include <bnprint.h>
@@ -32,8 +34,13 @@
 #include <zrtp/libzrtpcpp/ZrtpTextData.h>
 #include <cryptcommon/aes.h>
 #include <cryptcommon/ZrtpRandom.h>
+#include <common/MemoryUsage.h>
 
-
+/*
+ * The minimal algorithm profile (ZRTP_MINIMAL_ALGORITHMS) builds E255 only, it
+ * omits the MODP groups and the NIST and Curve3617 key agreements.
+ */
+#ifndef ZRTP_MINIMAL_ALGORITHMS
 static BigNum bnP2048 = {0};
 static BigNum bnP3072 = {0};
 
@@ -42,20 +49,78 @@ static BigNum bnP3072MinusOne = {0};
 
 static BigNum two = {0};
 
-static uint8_t dhinit = 0;
+#endif
+
+/*
+ * The key pair pool generates key pairs in a worker thread, thus initialize the
+ * parameters only once, also the constants of the EC module (see ec.c).
+ */
+static std::once_flag dhInitOnce;
+
+/*
+ * Precomputed powers of the generator 2 for the DH2K and DH3K public keys, built once
+ * per process when the application generates the first public key of the type. The
+ * private keys have 256 bits, see ZrtpDH constructor.
+ */
+#define DH_PRIVATE_KEY_BITS 256
+
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+static struct BnBasePrecomp precomp2048;
+static struct BnBasePrecomp precomp3072;
+static int32_t precomp2048Ok = 0;
+static int32_t precomp3072Ok = 0;
+static std::once_flag precomp2048Once;
+static std::once_flag precomp3072Once;
+
+static void initPrecomp2048()
+{
+    precomp2048Ok = bnBasePrecompBegin(&precomp2048, &two, &bnP2048, DH_PRIVATE_KEY_BITS) == 0;
+}
+
+static void initPrecomp3072()
+{
+    precomp3072Ok = bnBasePrecompBegin(&precomp3072, &two, &bnP3072, DH_PRIVATE_KEY_BITS) == 0;
+}
+
+/*
+ * Compute 2^privKey mod p, use the precomputed table if available.
+ */
+static void generatorExpMod(BigNum* pubKey, const BigNum* privKey, const BigNum* mod,
+                            const struct BnBasePrecomp* precomp, int32_t precompOk)
+{
+    if (precompOk && bnBits(privKey) <= DH_PRIVATE_KEY_BITS && bnBasePrecompExpMod(pubKey, precomp, privKey, mod) == 0)
+        return;
+    bnExpMod(pubKey, &two, privKey, mod);
+}
+#endif
 
 typedef struct _dhCtx {
     BigNum privKey;
     BigNum pubKey;
+    struct BnExpModCT expCtx;   // workspace of the constant time DH agreement
     EcCurve curve;
     EcPoint pubPoint;
+    uint8_t privKey25519[32];   // E255 uses the little endian byte arrays of curve25519_donna directly
+    uint8_t pubKey25519[32];
+
+    ZRTP_ALLOCATOR_OPERATORS
 } dhCtx;
 
+/*
+ * memset_volatile is a volatile pointer to the memset function.
+ * You can call (*memset_volatile)(buf, val, len) or even
+ * memset_volatile(buf, val, len) just as you would call
+ * memset(buf, val, len), but the use of a volatile pointer
+ * guarantees that the compiler will not optimise the call away.
+ */
+static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
+
 void randomZRTP(uint8_t *buf, int32_t length)
 {
     ZrtpRandom::getRandomData(buf, length);
 }
 
+#ifndef ZRTP_MINIMAL_ALGORITHMS
 static const uint8_t P2048[] =
 {
     0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xC9, 0x0F, 0xDA, 0xA2,
@@ -166,8 +231,37 @@ static const uint8_t P4096[] =
 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
 };
 *************** */
+#endif
+
+static void initDhParameters()
+{
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+    bnBegin(&two);
+    bnSetQ(&two, 2);
 
-ZrtpDH::ZrtpDH(const char* type) {
+    bnBegin(&bnP2048);
+    bnInsertBigBytes(&bnP2048, P2048, 0, sizeof(P2048));
+    bnBegin(&bnP3072);
+    bnInsertBigBytes(&bnP3072, P3072, 0, sizeof(P3072));
+
+    bnBegin(&bnP2048MinusOne);
+    bnCopy(&bnP2048MinusOne, &bnP2048);
+    bnSubQ(&bnP2048MinusOne, 1);
+
+    bnBegin(&bnP3072MinusOne);
+    bnCopy(&bnP3072MinusOne, &bnP3072);
+    bnSubQ(&bnP3072MinusOne, 1);
+#endif
+
+    EcCurve curve;
+    ecGetCurvesCurve(Curve25519, &curve);
+    ecFreeCurvesCurve(&curve);
+}
+
+ZrtpDH::ZrtpDH(const char* type) : ZrtpDH(type, true) {
+}
+
+ZrtpDH::ZrtpDH(const char* type, bool privateKey) {
 
     uint8_t random[64];
 
@@ -175,7 +269,11 @@ ZrtpDH::ZrtpDH(const char* type) {
     ctx = static_cast<void*>(tmpCtx);
 
     // Well - the algo type is only 4 char thus cast to int32 and compare
-    if (*(int32_t*)type == *(int32_t*)dh2k) {
+    if (*(int32_t*)type == *(int32_t*)e255) {
+        pkType = E255;
+    }
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+    else if (*(int32_t*)type == *(int32_t*)dh2k) {
         pkType = DH2K;
     }
     else if (*(int32_t*)type == *(int32_t*)dh3k) {
@@ -187,66 +285,62 @@ ZrtpDH::ZrtpDH(const char* type) {
     else if (*(int32_t*)type == *(int32_t*)ec38) {
         pkType = EC38;
     }
-    else if (*(int32_t*)type == *(int32_t*)e255) {
-        pkType = E255;
-    }
     else if (*(int32_t*)type == *(int32_t*)e414) {
         pkType = E414;
     }
+#endif
     else {
+        // unknown or not built, the destructor and the checks of the caller see a NULL context
+        delete tmpCtx;
+        ctx = NULL;
         return;
     }
 
     randomZRTP(random, sizeof(random));
 
-    if (!dhinit) {
-        bnBegin(&two);
-        bnSetQ(&two, 2);
-
-        bnBegin(&bnP2048);
-        bnInsertBigBytes(&bnP2048, P2048, 0, sizeof(P2048));
-        bnBegin(&bnP3072);
-        bnInsertBigBytes(&bnP3072, P3072, 0, sizeof(P3072));
-
-        bnBegin(&bnP2048MinusOne);
-        bnCopy(&bnP2048MinusOne, &bnP2048);
-        bnSubQ(&bnP2048MinusOne, 1);
-
-        bnBegin(&bnP3072MinusOne);
-        bnCopy(&bnP3072MinusOne, &bnP3072);
-        bnSubQ(&bnP3072MinusOne, 1);
-
-        dhinit = 1;
-    }
+    std::call_once(dhInitOnce, initDhParameters);
 
     bnBegin(&tmpCtx->privKey);
+    bnBegin(&tmpCtx->pubKey);
     INIT_EC_POINT(&tmpCtx->pubPoint);
 
     switch (pkType) {
+#ifndef ZRTP_MINIMAL_ALGORITHMS
     case DH2K:
     case DH3K:
-        bnInsertBigBytes(&tmpCtx->privKey, random, 0, 256/8);
+        bnInsertBigBytes(&tmpCtx->privKey, random, 0, DH_PRIVATE_KEY_BITS/8);
+        // If this fails computeSecretKey falls back to bnExpMod
+        bnExpModCTBegin(&tmpCtx->expCtx, pkType == DH2K ? &bnP2048 : &bnP3072, DH_PRIVATE_KEY_BITS);
         break;
 
     case EC25:
         ecGetCurveNistECp(NIST256P, &tmpCtx->curve);
-        ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
+        if (privateKey)
+            ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
         break;
 
     case EC38:
         ecGetCurveNistECp(NIST384P, &tmpCtx->curve);
-        ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
+        if (privateKey)
+            ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
         break;
+#endif
 
     case E255:
         ecGetCurvesCurve(Curve25519, &tmpCtx->curve);
-        ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
+        memcpy(tmpCtx->privKey25519, random, sizeof(tmpCtx->privKey25519));
+        tmpCtx->privKey25519[0] &= 248;
+        tmpCtx->privKey25519[31] &= 127;
+        tmpCtx->privKey25519[31] |= 64;
         break;
 
+#ifndef ZRTP_MINIMAL_ALGORITHMS
     case E414:
         ecGetCurvesCurve(Curve3617, &tmpCtx->curve);
-        ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
+        if (privateKey)
+            ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
         break;
+#endif
     }
 }
 
@@ -262,6 +356,7 @@ ZrtpDH::~ZrtpDH() {
     case DH2K:
     case DH3K:
         bnEnd(&tmpCtx->pubKey);
+        bnExpModCTEnd(&tmpCtx->expCtx);
         break;
 
     case EC25:
@@ -270,6 +365,10 @@ ZrtpDH::~ZrtpDH() {
         break;
 
     case E255:
+        memset_volatile(tmpCtx->privKey25519, 0, sizeof(tmpCtx->privKey25519));
+        ecFreeCurvesCurve(&tmpCtx->curve);
+        break;
+
     case E414:
         ecFreeCurvesCurve(&tmpCtx->curve);
         break;
@@ -284,23 +383,24 @@ int32_t ZrtpDH::computeSecretKey(uint8_t *pubKeyBytes, uint8_t *secret) {
 
     int32_t length = getDhSize();
 
-    BigNum sec;
+    if (pkType == E255) {
+        /* Generate agreement for responder: secret = pub * privKey, no BigNum conversion */
+        curve25519_donna(secret, tmpCtx->privKey25519, pubKeyBytes);
+        return length;
+    }
+#ifndef ZRTP_MINIMAL_ALGORITHMS
     if (pkType == DH2K || pkType == DH3K) {
+        BigNum sec;
         BigNum pubKeyOther;
         bnBegin(&pubKeyOther);
         bnBegin(&sec);
 
         bnInsertBigBytes(&pubKeyOther, pubKeyBytes, 0, length);
 
-        if (pkType == DH2K) {
-            bnExpMod(&sec, &pubKeyOther, &tmpCtx->privKey, &bnP2048);
-        }
-        else if (pkType == DH3K) {
-            bnExpMod(&sec, &pubKeyOther, &tmpCtx->privKey, &bnP3072);
-        }
-        else {
-            return 0;
-        }
+        // The private key is secret: use the constant time exponentiation
+        const BigNum* mod = pkType == DH2K ? &bnP2048 : &bnP3072;
+        if (bnExpModCT(&sec, &pubKeyOther, &tmpCtx->privKey, mod, &tmpCtx->expCtx) != 0)
+            bnExpMod(&sec, &pubKeyOther, &tmpCtx->privKey, mod);
         bnEnd(&pubKeyOther);
         bnExtractBigBytes(&sec, secret, 0, length);
         bnEnd(&sec);
@@ -309,41 +409,11 @@ int32_t ZrtpDH::computeSecretKey(uint8_t *pubKeyBytes, uint8_t *secret) {
     }
 
     if (pkType == EC25 || pkType == EC38 || pkType == E414) {
-        int32_t len = getPubKeySize() / 2;
-        EcPoint pub;
-
-        bnBegin(&sec);
-        INIT_EC_POINT(&pub);
-        bnSetQ(pub.z, 1);               // initialze Z to one, these are affine coords
-
-        bnInsertBigBytes(pub.x, pubKeyBytes, 0, len);
-        bnInsertBigBytes(pub.y, pubKeyBytes+len, 0, len);
-
-        /* Generate agreement for responder: sec = pub * privKey */
-        ecdhComputeAgreement(&tmpCtx->curve, &sec, &pub, &tmpCtx->privKey);
-        bnExtractBigBytes(&sec, secret, 0, length);
-        bnEnd(&sec);
-        FREE_EC_POINT(&pub);
-
-        return length;
-    }
-    if (pkType == E255) {
-        int32_t len = getPubKeySize();
-        EcPoint pub;
-
-        bnBegin(&sec);
-        INIT_EC_POINT(&pub);
-
-        bnInsertLittleBytes(pub.x, pubKeyBytes, 0, len);
-
-        /* Generate agreement for responder: sec = pub * privKey */
-        ecdhComputeAgreement(&tmpCtx->curve, &sec, &pub, &tmpCtx->privKey);
-        bnExtractLittleBytes(&sec, secret, 0, length);
-        bnEnd(&sec);
-        FREE_EC_POINT(&pub);
-
+        /* Generate agreement for responder: sec = pub * privKey, the public key bytes feed the field arithmetic */
+        ecdhComputeAgreementBytes(&tmpCtx->curve, secret, pubKeyBytes, length, &tmpCtx->privKey);
         return length;
     }
+#endif
     return -1;
 }
 
@@ -353,20 +423,27 @@ int32_t ZrtpDH::generatePublicKey()
 
     bnBegin(&tmpCtx->pubKey);
     switch (pkType) {
+    case E255:
+        curve25519_donna_basepoint(tmpCtx->pubKey25519, tmpCtx->privKey25519);
+        break;
+
+#ifndef ZRTP_MINIMAL_ALGORITHMS
     case DH2K:
-        bnExpMod(&tmpCtx->pubKey, &two, &tmpCtx->privKey, &bnP2048);
+        std::call_once(precomp2048Once, initPrecomp2048);
+        generatorExpMod(&tmpCtx->pubKey, &tmpCtx->privKey, &bnP2048, &precomp2048, precomp2048Ok);
         break;
 
     case DH3K:
-        bnExpMod(&tmpCtx->pubKey, &two, &tmpCtx->privKey, &bnP3072);
+        std::call_once(precomp3072Once, initPrecomp3072);
+        generatorExpMod(&tmpCtx->pubKey, &tmpCtx->privKey, &bnP3072, &precomp3072, precomp3072Ok);
         break;
 
     case EC25:
     case EC38:
-    case E255:
     case E414:
         while (!ecdhGeneratePublic(&tmpCtx->curve, &tmpCtx->pubPoint, &tmpCtx->privKey))
             ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
+#endif
     }
     return 0;
 }
@@ -437,58 +514,152 @@ int32_t ZrtpDH::getPubKeyBytes(uint8_t *buf) const
     }
     if (pkType == E255) {
         int32_t len = getPubKeySize();
-        bnExtractLittleBytes(tmpCtx->pubPoint.x, buf, 0, len);
+        memcpy(buf, tmpCtx->pubKey25519, len);
         return len;
     }
     return 0;
 }
 
-int32_t ZrtpDH::checkPubKey(uint8_t *pubKeyBytes) const
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+/*
+ * Compare the DH public value with 1 and p - 1, RFC 6189, chapter 4.4.1.4. The
+ * MODP primes end with 64 one bits, thus p - 1 differs from p in the last byte
+ * only. Returns 1 if the value is neither 1 nor p - 1.
+ */
+static int32_t checkDhValue(const uint8_t* prime, int32_t length, const uint8_t* pubKeyBytes)
 {
+    uint32_t diffMinusOne = 0;
+    uint32_t diffOne = 0;
 
-    /* ECC validation (partial), NIST SP800-56A, section 5.6.2.6 */
-    if (pkType == EC25 || pkType == EC38 || pkType == E414) {
+    for (int32_t i = 0; i < length - 1; i++) {
+        diffMinusOne |= pubKeyBytes[i] ^ prime[i];
+        diffOne |= pubKeyBytes[i];
+    }
+    diffMinusOne |= pubKeyBytes[length - 1] ^ (uint8_t)(prime[length - 1] - 1);
+    diffOne |= pubKeyBytes[length - 1] ^ 1;
 
-        dhCtx* tmpCtx = static_cast<dhCtx*>(ctx);
-        EcPoint pub;
+    // Both differences are non-zero for a valid value, the difference bytes are < 256
+    return (int32_t)((((diffMinusOne + 0xff) & (diffOne + 0xff)) >> 8) & 1);
+}
+#endif
 
-        INIT_EC_POINT(&pub);
-        int32_t len = getPubKeySize() / 2;
+/*
+ * Validate a public key of the type without BigNum or EC point allocations. The
+ * EC checks use the fixed width field arithmetic, ECC partial validation according
+ * to NIST SP800-56A, section 5.6.2.6.
+ */
+static int32_t checkPubKeyOfType(int32_t pkType, const uint8_t* pubKeyBytes)
+{
+    switch (pkType) {
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+    case DH2K:
+        return checkDhValue(P2048, sizeof(P2048), pubKeyBytes);
 
-        bnInsertBigBytes(pub.x, pubKeyBytes, 0, len);
-        bnInsertBigBytes(pub.y, pubKeyBytes+len, 0, len);
+    case DH3K:
+        return checkDhValue(P3072, sizeof(P3072), pubKeyBytes);
 
-        return ecCheckPubKey(&tmpCtx->curve, &pub);
-    }
+    case EC25:
+        return ecCheckPubKeyBytes(NIST256P, pubKeyBytes, pubKeyBytes + 32, 32) == 1;
 
-    if (pkType == E255) {
+    case EC38:
+        return ecCheckPubKeyBytes(NIST384P, pubKeyBytes, pubKeyBytes + 48, 48) == 1;
+
+    case E414:
+        return ecCheckPubKeyBytes(Curve3617, pubKeyBytes, pubKeyBytes + 52, 52) == 1;
+#endif
+
+    // According to http://cr.yp.to/ecdh.html#validate Curve25519 needs no validation
+    case E255:
         return 1;
+
+    default:
+        return 0;
     }
+}
 
-    BigNum pubKeyOther;
-    bnBegin(&pubKeyOther);
-    bnInsertBigBytes(&pubKeyOther, pubKeyBytes, 0, getDhSize());
+int32_t ZrtpDH::checkPubKey(uint8_t *pubKeyBytes) const
+{
+    return checkPubKeyOfType(pkType, pubKeyBytes);
+}
 
-    if (pkType == DH2K) {
-        if (bnCmp(&bnP2048MinusOne, &pubKeyOther) == 0) {
-            return 0;
-        }
+int32_t ZrtpDH::checkPubKeys(const char* type, const uint8_t* const pubKeys[], int32_t count, int32_t valid[])
+{
+    int32_t pkType;
+    int32_t numValid = 0;
+
+    if (*(int32_t*)type == *(int32_t*)e255)
+        pkType = E255;
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+    else if (*(int32_t*)type == *(int32_t*)dh2k)
+        pkType = DH2K;
+    else if (*(int32_t*)type == *(int32_t*)dh3k)
+        pkType = DH3K;
+    else if (*(int32_t*)type == *(int32_t*)ec25)
+        pkType = EC25;
+    else if (*(int32_t*)type == *(int32_t*)ec38)
+        pkType = EC38;
+    else if (*(int32_t*)type == *(int32_t*)e414)
+        pkType = E414;
+#endif
+    else
+        pkType = -1;
+
+    for (int32_t i = 0; i < count; i++) {
+        valid[i] = checkPubKeyOfType(pkType, pubKeys[i]);
+        numValid += valid[i];
     }
-    else if (pkType == DH3K) {
-        if (bnCmp(&bnP3072MinusOne, &pubKeyOther) == 0) {
-            return 0;
+    return numValid;
+}
 
+int32_t ZrtpDH::generateKeyPairs(const char* type, ZrtpDH* keyPairs[], int32_t count)
+{
+    if (count <= 0)
+        return 0;
+
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+    if (*(int32_t*)type != *(int32_t*)ec25 && *(int32_t*)type != *(int32_t*)ec38 &&
+        *(int32_t*)type != *(int32_t*)e414)
+#endif
+    {
+        for (int32_t i = 0; i < count; i++) {
+            keyPairs[i] = new ZrtpDH(type);
+            keyPairs[i]->generatePublicKey();
         }
+        return count;
     }
-    else {
-        return 0;
+#ifndef ZRTP_MINIMAL_ALGORITHMS
+
+    for (int32_t i = 0; i < count; i++)
+        keyPairs[i] = new ZrtpDH(type, false);
+
+    // All key pairs use the shared parameters of the same curve
+    const EcCurve* curve = &static_cast<dhCtx*>(keyPairs[0]->ctx)->curve;
+    std::vector<EcPoint> points(count);
+    std::vector<BigNum> keys(count);
+
+    for (int32_t i = 0; i < count; i++) {
+        INIT_EC_POINT(&points[i]);
+        bnBegin(&keys[i]);
     }
-    if (bnCmpQ(&pubKeyOther, 1) == 0) {
-        return 0;
+    bool generated = ecdhGeneratePublicBatch(curve, count, points.data(), keys.data()) != 0;
+
+    for (int32_t i = 0; i < count; i++) {
+        dhCtx* tmpCtx = static_cast<dhCtx*>(keyPairs[i]->ctx);
+        if (generated) {
+            bnCopy(&tmpCtx->privKey, &keys[i]);
+            bnCopy(tmpCtx->pubPoint.x, points[i].x);
+            bnCopy(tmpCtx->pubPoint.y, points[i].y);
+            bnCopy(tmpCtx->pubPoint.z, points[i].z);
+        }
+        else {
+            ecGenerateRandomNumber(&tmpCtx->curve, &tmpCtx->privKey);
+            keyPairs[i]->generatePublicKey();
+        }
+        FREE_EC_POINT(&points[i]);
+        bnEnd(&keys[i]);
     }
-
-    bnEnd(&pubKeyOther);
-    return 1;
+    return count;
+#endif
 }
 
 const char* ZrtpDH::getDHtype()
@@ -510,6 +681,40 @@ const char* ZrtpDH::getDHtype()
     return NULL;
 }
 
+/*
+ * The curves share their parameters, thus the BigNums of the parameters in the
+ * curve structure are empty and only the scratch pad variables count.
+ */
+static size_t curveAllocated(const EcCurve* curve)
+{
+    const BigNum* bigNums[] = {&curve->_p, &curve->_n, &curve->_SEED, &curve->_c, &curve->_a, &curve->_b,
+                               &curve->_Gx, &curve->_Gy, &curve->_S1, &curve->_U1, &curve->_H, &curve->_R,
+                               &curve->_t0, &curve->_t1, &curve->_t2, &curve->_t3};
+    size_t bytes = 0;
+
+    for (const BigNum* bn : bigNums)
+        bytes += bnAllocated(bn);
+    return bytes;
+}
+
+void ZrtpDH::addMemoryUsage(MemoryUsage& usage) const
+{
+    size_t bytes = sizeof(ZrtpDH);
+
+    if (ctx != NULL) {
+        dhCtx* tmpCtx = static_cast<dhCtx*>(ctx);
+
+        bytes += sizeof(dhCtx);
+        bytes += bnAllocated(&tmpCtx->privKey) + bnAllocated(&tmpCtx->pubKey);
+        bytes += bnAllocated(tmpCtx->pubPoint.x) + bnAllocated(tmpCtx->pubPoint.y) + bnAllocated(tmpCtx->pubPoint.z);
+        if (pkType != DH2K && pkType != DH3K)
+            bytes += curveAllocated(&tmpCtx->curve);
+        else
+            bytes += tmpCtx->expCtx.size;
+    }
+    usage.add(MemoryUsage::KeyAgreement, bytes);
+}
+
 /** EMACS **
  * Local variables:
  * mode: c++
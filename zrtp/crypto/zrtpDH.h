@@ -53,6 +53,7 @@ void randomZRTP(uint8_t *buf, int32_t length);
 #if defined(__cplusplus)
 
 #include <libzrtpcpp/ZrtpConfigure.h>
+#include <common/ZrtpAllocator.h>
 
 const int32_t DH2K = 0;
 const int32_t DH3K = 1;
@@ -73,12 +74,23 @@ const int32_t E414 = 5;
  * @author Werner Dittmann <Werner.Dittmann@t-online.de>
  */
 
+class MemoryUsage;
+
 class ZrtpDH {
 
+public:
+    ZRTP_ALLOCATOR_OPERATORS
+
 private:
     void* ctx;      ///< Context the DH
     int pkType;     ///< Which type of DH to use
 
+    /**
+     * Create a key agreement algorithm, without a private key of the EC
+     * types if @c privateKey is false, see generateKeyPairs.
+     */
+    ZrtpDH(const char* type, bool privateKey);
+
 public:
     /**
      * Create a Diffie-Helman key agreement algorithm
@@ -155,6 +167,48 @@ public:
      */
     int32_t checkPubKey(uint8_t* pubKeyBytes) const;
 
+    /**
+     * Check and validate several public keys of the same type.
+     *
+     * A server uses this function to validate the public keys of the DHPart
+     * packets of many peers in one call. The function performs the same checks
+     * as @c checkPubKey, it does not need a DH context and does not allocate
+     * memory.
+     *
+     * @param type
+     *     Name of the DH algorithm, for example "EC25".
+     * @param pubKeys
+     *     Pointers to the peers' public key bytes. Must be in big endian order.
+     * @param count
+     *     Number of public keys.
+     * @param valid
+     *     Receives 1 for each valid public key and 0 for each invalid public key.
+     *
+     * @return the number of valid public keys.
+     */
+    static int32_t checkPubKeys(const char* type, const uint8_t* const pubKeys[], int32_t count, int32_t valid[]);
+
+    /**
+     * Generate several key pairs of the same type.
+     *
+     * The key pair pool uses this function to refill its key pairs. For the
+     * EC25, EC38 and E414 types the function draws all private keys with one
+     * call of the random generator and converts all public keys to affine
+     * coordinates with one inversion, see @c ecdhGeneratePublicBatch. The
+     * other types generate each key pair as @c generatePublicKey does.
+     *
+     * @param type
+     *     Name of the DH algorithm, for example "EC25".
+     * @param keyPairs
+     *     Receives @c count new ZrtpDH objects with generated public keys,
+     *     the caller owns the objects.
+     * @param count
+     *     Number of key pairs.
+     *
+     * @return the number of generated key pairs.
+     */
+    static int32_t generateKeyPairs(const char* type, ZrtpDH* keyPairs[], int32_t count);
+
     /**
      * Get type of DH algorithm.
      * 
@@ -162,6 +216,18 @@ public:
      *     Pointer to DH algorithm name
      */
     const char* getDHtype();
+
+    /**
+     * Add the memory of this key agreement to a footprint report.
+     *
+     * The function adds the size of the object, of its context and of the
+     * BigNum storage of the keys and the curve to the category
+     * MemoryUsage::KeyAgreement.
+     *
+     * @param usage
+     *     The footprint report
+     */
+    void addMemoryUsage(MemoryUsage& usage) const;
 };
 #endif /*__cpluscplus */
 #endif
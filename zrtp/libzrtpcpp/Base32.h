@@ -138,6 +138,26 @@ class Base32 {
     static size_t const b2alen(const size_t lengthInBits) {
 	return divceil(lengthInBits, 5); };
 
+    /**
+     * Encode binary data into a caller supplied buffer.
+     *
+     * The function produces the same encoding as @c getEncoded
+     * and does not allocate memory, for example to render the SAS.
+     *
+     * @param data
+     *      Pointer to the data to encode.
+     * @param noOfBits
+     *      Number of bits to encode, starting with the most significant
+     *      bit of the first byte.
+     * @param buffer
+     *      Receives the nul terminated encoded string.
+     * @param bufferLength
+     *      Size of the buffer, at least <code>b2alen(noOfBits) + 1</code>.
+     * @return
+     *      The number of characters without the nul, -1 if the buffer is too small.
+     */
+    static int b2a(const unsigned char* data, int noOfBits, char* buffer, size_t bufferLength);
+
  private:
 
     /**
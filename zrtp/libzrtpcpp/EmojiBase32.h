@@ -94,6 +94,23 @@ public:
      */
     static shared_ptr<string> u32StringToUtf8(const u32string& in);
 
+    /**
+     * @brief Encode binary data as UTF-8 emojis into a caller supplied buffer.
+     *
+     * The function produces the same string as @c u32StringToUtf8 of the
+     * @c getEncoded result and does not allocate memory, for example to
+     * render the SAS.
+     *
+     * @param data pointer to the data to encode
+     * @param noOfBits number of bits to encode, starting with the most
+     *        significant bit of the first byte
+     * @param buffer receives the nul terminated UTF-8 string
+     * @param bufferLength size of the buffer, 4 bytes per emoji plus the nul
+     *        are always enough
+     * @return the length of the UTF-8 string in bytes, -1 if the buffer is too small
+     */
+    static int b2aUtf8(const unsigned char* data, size_t noOfBits, char* buffer, size_t bufferLength);
+
 private:
 
     void b2a_l(const unsigned char* cs, size_t len, const size_t noOfBits);
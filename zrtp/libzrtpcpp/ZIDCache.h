@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <stdio.h>
 #include <string>
 
 #include "ZIDRecord.h"
@@ -45,6 +46,19 @@ class ZIDCache;
 
 __EXPORT ZIDCache* getZidCacheInstance();
 
+/**
+ * @brief Replace the ZID cache instance.
+ *
+ * After this call @c getZidCacheInstance returns @c cache. Applications use
+ * this to install a cache layer, for example @c ZIDCacheLru, that wraps the
+ * backend instance. If @c cache is @c NULL the next @c getZidCacheInstance
+ * call creates a new backend instance.
+ *
+ * @param cache the new ZID cache instance
+ * @return the previous instance, the caller owns it
+ */
+__EXPORT ZIDCache* setZidCacheInstance(ZIDCache* cache);
+
 
 class __EXPORT ZIDCache {
 
@@ -103,6 +117,22 @@ public:
      */
     virtual ZIDRecord *getRecord(unsigned char *zid) =0;
 
+    /**
+     * @brief Get a ZID record into a caller owned storage.
+     *
+     * Same as @c getRecord, the cache backends construct the record in the
+     * storage and do not allocate it. The default implementation stores the
+     * record that @c getRecord allocates.
+     *
+     * @param zid is the ZRTP id of the peer
+     * @param storage receives the record, replaces the record it holds
+     * @return pointer to the ZID record in the storage, the storage owns
+     *         the record
+     */
+    virtual ZIDRecord *getRecordInto(unsigned char *zid, ZIDRecordStorage& storage) {
+        return storage.adopt(getRecord(zid));
+    }
+
     /**
      * @brief Save a ZID record into the active ZID file.
      *
@@ -230,6 +260,100 @@ public:
 
     virtual void closeOpenStatment(void *stmt) =0;
 
+    /**
+     * @brief Set the crash safety window - only for ZID cache with Sqlite3 backend.
+     *
+     * If the window is zero, the default, @c saveRecord writes the record to
+     * the database before it returns. Otherwise @c saveRecord only queues the
+     * record and a background writer stores the queued records in one
+     * transaction at most @c milliseconds later. If the application crashes
+     * it loses the records saved during this window.
+     *
+     * @param milliseconds the crash safety window in milliseconds
+     */
+    virtual void setCrashSafetyWindow(int32_t milliseconds) =0;
+
+    /**
+     * @brief Set the key of an encrypted cache - only for ZID cache with SQLCipher backend.
+     *
+     * Call this function before @c open. SQLCipher derives the database key
+     * from a passphrase with PBKDF2 on every open, this takes noticeable time
+     * on mobile devices. An application that stores a raw 32 byte key, for
+     * example in the platform keystore, avoids the key derivation. Append the
+     * 16 byte salt of the database to the raw key to skip reading the salt.
+     *
+     * The cache forgets the key after @c open, set it again before the next
+     * @c open.
+     *
+     * @param key the passphrase or the raw key
+     * @param keyLength length of the key in bytes, 32 or 48 for a raw key
+     * @param rawKey if true then @c key is the raw database key
+     * @param kdfIterations the PBKDF2 iterations of a passphrase, 0 uses the
+     *        SQLCipher default
+     * @return
+     *    false if the cache does not support encryption
+     */
+    virtual bool setCacheKey(const uint8_t *key, int32_t keyLength, bool rawKey, int32_t kdfIterations) =0;
+
+    /**
+     * @brief Write all peer records to a stream.
+     *
+     * The function writes the own ZID and the peer records in the binary
+     * export format, see @c ZIDCacheExport.h. The stream contains the raw
+     * retained secrets, the application must protect it.
+     *
+     * @param out the stream, opened for binary write
+     * @return
+     *    number of exported records, -1 if the cache is not open or on an error
+     */
+    virtual int32_t exportRecords(FILE* out) =0;
+
+    /**
+     * @brief Read peer records from a stream.
+     *
+     * The function reads a stream that @c exportRecords wrote. An imported
+     * record replaces the cache record of the same peer.
+     *
+     * The peer records belong to the own ZID of the exporting cache. If the
+     * cache does not contain peer records yet it takes over this own ZID,
+     * thus importing into a new cache moves the ZRTP identity to another
+     * host. Otherwise the own ZIDs must be equal.
+     *
+     * @param in the stream, opened for binary read
+     * @return
+     *    number of imported records, -1 if the cache is not open, on an error,
+     *    or if the own ZIDs differ
+     */
+    virtual int32_t importRecords(FILE* in) =0;
+
+    /**
+     * @brief Remove stale records from the cache.
+     *
+     * The function removes invalid records, duplicate records, and records
+     * without a valid and not expired RS1 or RS2 and without a trusted PBX
+     * key, see ZIDCacheExport::isStale().
+     *
+     * @return
+     *    number of removed records, -1 if the cache is not open or on an error
+     */
+    virtual int32_t compact() =0;
+
+    /**
+     * @brief Remove stale records, incremental version.
+     *
+     * The function checks at most @c maxRecords records and removes the
+     * stale records among them, see compact(). The next call continues
+     * with the record behind the last checked record, after the last record
+     * it starts again with the first record. Thus repeated calls with a small
+     * number of records scan the whole cache without a long running compaction,
+     * ZIDCacheGc uses this function.
+     *
+     * @param maxRecords the number of records to check
+     * @return
+     *    number of removed records, -1 if the cache is not open or on an error
+     */
+    virtual int32_t compactStep(int32_t maxRecords) =0;
+
 };
 
 /**
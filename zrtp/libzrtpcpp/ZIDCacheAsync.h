@@ -0,0 +1,127 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#ifndef _ZIDCACHEASYNC_H_
+#define _ZIDCACHEASYNC_H_
+
+/**
+ * @file ZIDCacheAsync.h
+ * @brief Non-blocking access to the ZID cache
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <functional>
+#include <future>
+#include <string>
+#include <common/osSpecifics.h>
+
+class ZIDRecord;
+
+/**
+ * @brief I/O worker for non-blocking ZID cache requests.
+ *
+ * The worker thread runs the requests in order on the instance that
+ * @c getZidCacheInstance returns, thus a record read after a save contains
+ * the saved data. The worker starts its thread on the first request.
+ *
+ * If the application enables the asynchronous ZID cache, see
+ * ZrtpConfigure::setAsyncZidCache(), ZRtp prefetches the peer's record as
+ * soon as it receives the peer's Hello and saves the records with
+ * saveRecordAsync(). The application then shares the cache instance with the
+ * worker thread, it must use a thread safe cache, for example @c ZIDCacheDb
+ * or a cache wrapped by @c ZIDCacheSharded. Call flush() before closing the
+ * cache.
+ *
+ * All functions are thread safe.
+ */
+class __EXPORT ZIDCacheAsync {
+public:
+    /**
+     * @brief Read a ZID record in the worker thread.
+     *
+     * @param zid
+     *    The peer's ZID, the function copies it.
+     * @param callback
+     *    The worker thread calls the callback with the record, the callback
+     *    owns the record. The callback must not throw an exception.
+     */
+    static void getRecordAsync(const uint8_t* zid, std::function<void(ZIDRecord*)> callback);
+
+    /**
+     * @brief Read a ZID record in the worker thread.
+     *
+     * @param zid
+     *    The peer's ZID, the function copies it.
+     * @return
+     *    A future that provides the record, the caller owns the record.
+     */
+    static std::future<ZIDRecord*> prefetchRecord(const uint8_t* zid);
+
+    /**
+     * @brief Save a ZID record in the worker thread.
+     *
+     * The function queues a copy of the record and returns, the caller keeps
+     * the ownership of the record.
+     *
+     * @param zidRecord
+     *    The ZID record to save.
+     */
+    static void saveRecordAsync(ZIDRecord* zidRecord);
+
+    /**
+     * @brief Wait until the worker thread ran all queued requests.
+     */
+    static void flush();
+
+    /**
+     * @brief Open the ZID cache in the worker thread.
+     *
+     * Opening a cache may read, index or convert a large file or database.
+     * The function queues the open and returns, thus the application
+     * starts without waiting for the cache. The requests queued after the
+     * open run after it. ZRtp waits for the open only before it reads or
+     * saves a record without the worker thread.
+     *
+     * @param name
+     *    The name of the cache file or database, see ZIDCache::open().
+     */
+    static void openAsync(const std::string& name);
+
+    /**
+     * @brief Check if an open queued by openAsync() did not yet finish.
+     */
+    static bool isOpenPending();
+
+    /**
+     * @brief Wait until an open queued by openAsync() finished.
+     *
+     * @return
+     *    The result of ZIDCache::open(), 1 if the application did not call
+     *    openAsync().
+     */
+    static int32_t waitOpen();
+};
+
+/**
+ * @}
+ */
+#endif // _ZIDCACHEASYNC_H_
@@ -16,6 +16,12 @@
 
 #include <stdio.h>
 
+#include <map>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
 #include <libzrtpcpp/ZIDCache.h>
 #include <libzrtpcpp/ZIDRecordDb.h>
 #include <libzrtpcpp/zrtpCacheDbBackend.h>
@@ -42,6 +48,25 @@
  * The interface defintion @c ZIDCache.h contains the method documentation.
  * The ZID cache file holds information about peers.
  *
+ * If the application sets a crash safety window the class switches the
+ * database to a write ahead log (WAL) and queues the saved records, a
+ * background writer stores the queued records in one transaction. Reading a
+ * record returns the queued data if the record is not stored yet. All
+ * methods are thread safe.
+ *
+ * The class keeps a Bloom filter of the peer ZIDs in the database, built when
+ * the application opens the cache. If the filter does not contain a ZID then
+ * @c getRecord creates the new record without looking it up in the database
+ * first. Removed records stay in the filter, they just cost a lookup. Only
+ * this instance should add records to the database while it is open.
+ *
+ * In the connection pool mode the class opens additional SQLite connections
+ * without mutex, each with its own prepared statements, and switches the
+ * database to a write ahead log. Record and name lookups of known peers take
+ * an idle connection of the pool and do not hold the cache lock while they
+ * read the database, thus the lookups of several threads run in parallel.
+ * Writes still use the main connection.
+ *
  * @author: Werner Dittmann <Werner.Dittmann@t-online.de>
  */
 
@@ -56,12 +81,52 @@ private:
 
     char errorBuffer[DB_CACHE_ERR_BUFF_SIZE];
 
+    std::mutex cacheLock;                   ///< serializes the database access
+    std::condition_variable writerCondition;
+    std::thread writer;
+    bool writerRunning;
+    int32_t safetyWindow;                   ///< crash safety window in milliseconds, 0 writes synchronously
+    int32_t synchronousLevel;               ///< SQLite synchronous level if the window is not zero
+    std::map<std::string, remoteZidRecord_t> pendingRecords;   ///< queued records, key is the peer ZID
+    int64_t compactRowid;                   ///< row id of the last record compactStep checked
+    std::vector<uint64_t> zidFilter;        ///< Bloom filter of the peer ZIDs, a power of 2 bits
+    std::vector<uint8_t> cacheKey;          ///< key for the next open, empty if the cache is not encrypted
+    bool rawCacheKey;                       ///< cacheKey is the raw database key
+    int32_t kdfIterations;                  ///< PBKDF2 iterations of a passphrase, 0 for the default
+    size_t filterCount;                     ///< ZIDs added to the filter
+    std::map<std::string, std::string> accountZids;            ///< local ZIDs of the accounts, key is the account
+    int32_t poolSize;                       ///< connections of the pool mode, 0 disables the pool
+
+    std::mutex poolLock;                    ///< protects the connections of the pool
+    std::condition_variable poolCondition;
+    std::vector<void*> connections;         ///< the connections of the pool
+    std::vector<void*> idleConnections;     ///< connections that no thread uses
+
     void createZIDFile(char* name);
     void formatOutput(remoteZidRecord_t *remZid, const char *nameBuffer, std::string *output);
 
+    // The caller holds cacheLock
+    void startWriter();
+    void writePending();
+    void buildFilter(size_t minimumZids);
+    void addToFilter(const uint8_t *zid);
+    bool mayContain(const uint8_t *zid);
+    void loadAccountZids();
+    bool readPending(unsigned char *zid, ZIDRecordDb *zidRecord);
+    void openPool(char *name);
+
+    // The caller must not hold cacheLock
+    ZIDRecord *lookupRecord(unsigned char *zid, ZIDRecordDb *zidRecord);
+    void stopWriter();
+    void runWriter();
+    void closePool();
+    void *acquireConnection();
+    void releaseConnection(void *connection);
+
 public:
 
-    ZIDCacheDb(): zidFile(NULL) {
+    ZIDCacheDb(): zidFile(NULL), writerRunning(false), safetyWindow(0), synchronousLevel(1), compactRowid(0), rawCacheKey(false),
+                  kdfIterations(0), filterCount(0), poolSize(0) {
         getDbCacheOps(&cacheOps);
     };
 
@@ -75,6 +140,8 @@ public:
 
     ZIDRecord *getRecord(unsigned char *zid);
 
+    ZIDRecord *getRecordInto(unsigned char *zid, ZIDRecordStorage& storage);
+
     unsigned int saveRecord(ZIDRecord *zidRecord);
 
     const unsigned char* getZid() { return associatedZid; };
@@ -90,6 +157,60 @@ public:
     void *readNextRecord(void *stmt, std::string *name);
 
     void closeOpenStatment(void *stmt);
+
+    void setCrashSafetyWindow(int32_t milliseconds);
+
+    bool setCacheKey(const uint8_t *key, int32_t keyLength, bool rawKey, int32_t kdfIterations);
+
+    int32_t exportRecords(FILE* out);
+
+    int32_t importRecords(FILE* in);
+
+    int32_t compact();
+
+    int32_t compactStep(int32_t maxRecords);
+
+    /**
+     * @brief Set the SQLite synchronous level for a crash safety window.
+     *
+     * The class uses this level if the crash safety window is not zero.
+     *
+     * @param level
+     *    0 (OFF), 1 (NORMAL, the default), 2 (FULL) or 3 (EXTRA).
+     */
+    void setSynchronousLevel(int32_t level);
+
+    /**
+     * @brief Enable the connection pool mode.
+     *
+     * Use one connection per thread that looks up records at the same time,
+     * a thread waits if all connections are in use. The setting takes
+     * effect when the application opens the cache, call it before open().
+     *
+     * @param numConnections
+     *    Number of additional connections, 0 (the default) disables the pool.
+     */
+    void setConnectionPool(int32_t numConnections);
+
+    /**
+     * @brief Get the local ZID of an account.
+     *
+     * The class reads the local ZIDs of all accounts when the application
+     * opens the cache and keeps them in memory, thus only the first call
+     * for a new account accesses the database. This call creates and stores
+     * a new local ZID for the account. The records that the cache reads and
+     * saves always belong to the local ZID of the standard account, see
+     * getZid().
+     *
+     * @param account
+     *    The account information string, an empty string selects the
+     *    standard account.
+     * @param zid
+     *    Buffer of at least @c IDENTIFIER_LEN bytes, gets the local ZID.
+     * @return
+     *    1 on success, -1 if the cache is not open or the database failed.
+     */
+    int32_t getAccountZid(const std::string& account, uint8_t *zid);
 };
 
 /**
@@ -60,6 +60,8 @@ public:
 
     ZIDRecord *getRecord(unsigned char *zid) override;
 
+    ZIDRecord *getRecordInto(unsigned char *zid, ZIDRecordStorage& storage) override;
+
     unsigned int saveRecord(ZIDRecord *zidRecord) override;
 
     const unsigned char* getZid() override { return nullptr; };
@@ -73,6 +75,14 @@ public:
     void *prepareReadAll() override { return nullptr; };
     void *readNextRecord(void *stmt, std::string *output) override { return nullptr; };
     void closeOpenStatment(void *stmt) override {}
+    void setCrashSafetyWindow(int32_t milliseconds) override {}
+
+    bool setCacheKey(const uint8_t *key, int32_t keyLength, bool rawKey, int32_t kdfIterations) override { return false; }
+    int32_t exportRecords(FILE* out) override { return -1; }
+    int32_t importRecords(FILE* in) override { return -1; }
+    int32_t compact() override { return 0; }
+
+    int32_t compactStep(int32_t maxRecords) override { return 0; }
 
 
 };
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#ifndef _ZIDCACHEEXPORT_H_
+#define _ZIDCACHEEXPORT_H_
+
+/**
+ * @file ZIDCacheExport.h
+ * @brief Binary export format of the ZID cache
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <libzrtpcpp/ZIDRecord.h>
+
+/**
+ * @brief A peer record in the export format.
+ *
+ * The flags use the bits of the ZID records: Valid 0x1, SASVerified 0x2,
+ * RS1Valid 0x4, RS2Valid 0x8 and MITMKeyAvailable 0x10. The valid-thru
+ * times are Unix epoch seconds, -1 means valid for ever and 0 means expired.
+ */
+typedef struct {
+    uint8_t  identifier[IDENTIFIER_LEN];  ///< the peer's ZID
+    uint32_t flags;
+    int64_t  rs1ValidThru;
+    uint8_t  rs1[RS_LENGTH];
+    int64_t  rs2ValidThru;
+    uint8_t  rs2[RS_LENGTH];
+    uint8_t  mitmKey[RS_LENGTH];
+    int64_t  secureSince;                 ///< 0 if the cache does not store the time
+} zidExportRecord_t;
+
+/**
+ * @brief Read and write the binary export format of the ZID cache.
+ *
+ * The export stream starts with a header: the four characters @c ZIDX, the
+ * format version as 32 bit value and the own ZID of the exporting cache.
+ * Fixed size peer records follow up to the end of the stream. The format
+ * stores all numbers in little endian byte order, thus it is portable
+ * between hosts and between the cache backends.
+ *
+ * The cache backends implement ZIDCache::exportRecords(),
+ * ZIDCache::importRecords() and ZIDCache::compact() with these functions.
+ */
+class __EXPORT ZIDCacheExport {
+public:
+    static const uint32_t Version = 1;
+
+    static const uint32_t Valid            = 0x1;
+    static const uint32_t SASVerified      = 0x2;
+    static const uint32_t RS1Valid         = 0x4;
+    static const uint32_t RS2Valid         = 0x8;
+    static const uint32_t MITMKeyAvailable = 0x10;
+    static const uint32_t AllFlags         = 0x1f;
+
+    /**
+     * @brief Write the header of an export stream.
+     *
+     * @return 0 on success, -1 on a write error
+     */
+    static int32_t writeHeader(FILE* out, const uint8_t* ownZid);
+
+    /**
+     * @brief Read the header of an export stream.
+     *
+     * @param ownZid gets the own ZID of the exporting cache
+     * @return 0 on success, -1 if the stream does not start with a valid header
+     */
+    static int32_t readHeader(FILE* in, uint8_t* ownZid);
+
+    /**
+     * @brief Write a peer record.
+     *
+     * @return 0 on success, -1 on a write error
+     */
+    static int32_t writeRecord(FILE* out, const zidExportRecord_t* record);
+
+    /**
+     * @brief Read a peer record.
+     *
+     * @return 1 if the function read a record, 0 at the end of the stream,
+     *         -1 on a read error or an incomplete record
+     */
+    static int32_t readRecord(FILE* in, zidExportRecord_t* record);
+
+    /**
+     * @brief Check if a record is stale.
+     *
+     * A record is stale if it is not valid or if it has neither a valid and
+     * not expired RS1 or RS2 nor a trusted PBX key. Compaction removes stale
+     * records, ZRTP handles a peer without a record as a new peer.
+     *
+     * @param record the record to check
+     * @param now the current time in Unix epoch seconds
+     */
+    static bool isStale(const zidExportRecord_t* record, int64_t now);
+};
+
+/**
+ * @}
+ */
+#endif // _ZIDCACHEEXPORT_H_
@@ -15,6 +15,8 @@
  */
 
 #include <stdio.h>
+#include <string>
+#include <unordered_map>
 
 #include <libzrtpcpp/ZIDCache.h>
 #include <libzrtpcpp/ZIDRecordFile.h>
@@ -41,6 +43,11 @@
  * The interface defintion @c ZIDCache.h contains the method documentation.
  * The ZID cache file holds information about peers.
  *
+ * The class keeps an index that maps the peer ZIDs to the file positions of
+ * their records. The @c open method builds the index, @c getRecord reads
+ * the record at the indexed position or appends a new record and adds it
+ * to the index.
+ *
  * @author: Werner Dittmann <Werner.Dittmann@t-online.de>
  */
 
@@ -51,12 +58,20 @@ private:
     FILE* zidFile;
     unsigned char associatedZid[IDENTIFIER_LEN];
 
+    std::unordered_map<std::string, long> recordIndex;  ///< peer ZID to file position of its record
+    long endPosition;                                  ///< position behind the last complete record
+    long compactPosition;                              ///< position of the next record compactStep checks
+
     void createZIDFile(char* name);
+    ZIDRecord *lookupRecord(unsigned char *zid, ZIDRecordFile *zidRecord);
     void checkDoMigration(char* name);
+    void buildIndex();
+    bool isRemovable(ZIDRecordFile& rec, long position, int64_t now);
+    void eraseIndex(ZIDRecordFile& rec, long position);
 
 public:
 
-    ZIDCacheFile(): zidFile(NULL) {};
+    ZIDCacheFile(): zidFile(NULL), endPosition(0), compactPosition(0) {};
 
     ~ZIDCacheFile();
 
@@ -68,6 +83,8 @@ public:
 
     ZIDRecord *getRecord(unsigned char *zid);
 
+    ZIDRecord *getRecordInto(unsigned char *zid, ZIDRecordStorage& storage);
+
     unsigned int saveRecord(ZIDRecord *zidRecord);
 
     const unsigned char* getZid() { return associatedZid; };
@@ -76,11 +93,22 @@ public:
 
     void putPeerName(const uint8_t *peerZid, const std::string name);
 
+    int32_t exportRecords(FILE* out);
+
+    int32_t importRecords(FILE* in);
+
+    int32_t compact();
+
+    int32_t compactStep(int32_t maxRecords);
+
     // Not implemented for file based cache
     void cleanup() {};
     void *prepareReadAll() { return NULL; };
     void *readNextRecord(void *stmt, std::string *output) { return NULL; };
     void closeOpenStatment(void *stmt) {}
+    void setCrashSafetyWindow(int32_t milliseconds) {}
+
+    bool setCacheKey(const uint8_t *key, int32_t keyLength, bool rawKey, int32_t kdfIterations) { return false; }
 
 
 };
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#ifndef _ZIDCACHEGC_H_
+#define _ZIDCACHEGC_H_
+
+/**
+ * @file ZIDCacheGc.h
+ * @brief Incremental removal of stale ZID cache records
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <common/osSpecifics.h>
+
+/**
+ * @brief Background collector of stale ZID cache records.
+ *
+ * Records without a valid and not expired retained secret and without a
+ * trusted PBX key stay in the cache until a compaction removes them, see
+ * ZIDCache::compact(). The collector thread removes these records
+ * incrementally: it wakes up once per interval and checks a batch of records
+ * of the instance that @c getZidCacheInstance returns, see
+ * ZIDCache::compactStep(). The batch size and the interval limit the cache
+ * I/O of the collector, an application may use a small budget during busy
+ * hours and a larger one otherwise.
+ *
+ * The collector shares the cache instance with the application threads, the
+ * application must use a thread safe cache, for example @c ZIDCacheDb or a
+ * cache wrapped by @c ZIDCacheSharded or @c ZIDCacheLru. The collector skips
+ * its steps while the cache is closed.
+ *
+ * All functions are thread safe.
+ */
+class __EXPORT ZIDCacheGc {
+public:
+    /**
+     * @brief Start the collector or change its budget.
+     *
+     * A new budget takes effect after the current interval.
+     *
+     * @param batchRecords
+     *    Number of records to check per interval.
+     * @param intervalMs
+     *    Interval between two batches in milliseconds.
+     */
+    static void start(int32_t batchRecords = 100, int32_t intervalMs = 1000);
+
+    /**
+     * @brief Stop the collector.
+     *
+     * The function returns after the collector finished its current batch.
+     */
+    static void stop();
+
+    /**
+     * @brief Get the number of records the collector removed since it started first.
+     */
+    static int64_t getRemovedRecords();
+};
+
+/**
+ * @}
+ */
+#endif // _ZIDCACHEGC_H_
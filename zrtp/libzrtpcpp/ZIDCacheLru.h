@@ -0,0 +1,169 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <libzrtpcpp/ZIDCache.h>
+
+#ifndef _ZIDCACHELRU_H_
+#define _ZIDCACHELRU_H_
+
+
+/**
+ * @file ZIDCacheLru.h
+ * @brief In-memory LRU layer in front of a ZID cache backend
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+/**
+ * This class keeps the most recently used ZID records in memory.
+ *
+ * The class implements the @c ZIDCache interface and wraps the backend
+ * instance, for example @c ZIDCacheFile or @c ZIDCacheDb. The interface
+ * defintion @c ZIDCache.h contains the method documentation.
+ *
+ * @c getRecord returns a copy of a cached record and reads the record from the
+ * backend only if it is not in memory. In write back mode @c saveRecord only
+ * updates the cached record, the class writes a modified record to the backend
+ * if it evicts the record, on @c flush and on @c close. Thus several saves
+ * of the same record result in one backend write. A process crash loses the
+ * records saved since the last write, use write through mode if this is not
+ * acceptable.
+ *
+ * The class owns the backend and deletes it in the destructor. All methods
+ * are thread safe.
+ */
+
+class __EXPORT ZIDCacheLru: public ZIDCache {
+
+private:
+    typedef struct {
+        std::string zid;
+        ZIDRecord* record;
+        bool dirty;
+    } cacheEntry_t;
+
+    typedef std::list<cacheEntry_t> EntryList;
+
+    ZIDCache* backend;
+    size_t capacity;
+    bool writeBack;
+
+    std::mutex cacheLock;
+    EntryList entries;                  ///< most recently used entry first
+    std::unordered_map<std::string, EntryList::iterator> entryIndex;
+
+    void writeEntry(cacheEntry_t& entry);
+    void writeDirty();
+    void dropEntries();
+
+    // A NULL storage allocates the record
+    ZIDRecord *lookupRecord(unsigned char *zid, ZIDRecordStorage *storage);
+    ZIDRecord *readBackend(unsigned char *zid, ZIDRecordStorage *storage);
+
+public:
+
+    /**
+     * @brief Create the cache layer.
+     *
+     * @param backend
+     *    The backend cache instance, the layer takes ownership.
+     * @param capacity
+     *    Maximum number of records in memory, zero disables the layer and it
+     *    passes all calls to the backend.
+     * @param writeBack
+     *    If @c true @c saveRecord writes the records to the backend lazily,
+     *    otherwise it writes each record immediately.
+     */
+    ZIDCacheLru(ZIDCache* backend, size_t capacity, bool writeBack = true):
+        backend(backend), capacity(capacity), writeBack(writeBack) {};
+
+    ~ZIDCacheLru();
+
+    /**
+     * @brief Install the cache layer in front of the ZID cache instance.
+     *
+     * Wraps the instance that @c getZidCacheInstance returns and installs the
+     * layer as new instance. Call this function during initialization, before
+     * the application opens the cache and before it starts ZRTP sessions.
+     *
+     * @param capacity
+     *    Maximum number of records in memory.
+     * @param writeBack
+     *    See constructor.
+     * @return
+     *    The installed layer.
+     */
+    static ZIDCacheLru* install(size_t capacity, bool writeBack = true);
+
+    /**
+     * @brief Write all modified records to the backend.
+     */
+    void flush();
+
+    /**
+     * @brief Get the number of records in memory.
+     */
+    size_t size();
+
+    int open(char *name);
+
+    bool isOpen();
+
+    void close();
+
+    ZIDRecord *getRecord(unsigned char *zid);
+
+    ZIDRecord *getRecordInto(unsigned char *zid, ZIDRecordStorage& storage);
+
+    unsigned int saveRecord(ZIDRecord *zidRecord);
+
+    const unsigned char* getZid();
+
+    int32_t getPeerName(const uint8_t *peerZid, std::string *name);
+
+    void putPeerName(const uint8_t *peerZid, const std::string name);
+
+    void cleanup();
+
+    void *prepareReadAll();
+
+    void *readNextRecord(void *stmt, std::string *output);
+
+    void closeOpenStatment(void *stmt);
+
+    void setCrashSafetyWindow(int32_t milliseconds);
+
+    bool setCacheKey(const uint8_t *key, int32_t keyLength, bool rawKey, int32_t kdfIterations);
+
+    int32_t exportRecords(FILE* out);
+
+    int32_t importRecords(FILE* in);
+
+    int32_t compact();
+
+    int32_t compactStep(int32_t maxRecords);
+};
+
+/**
+ * @}
+ */
+#endif
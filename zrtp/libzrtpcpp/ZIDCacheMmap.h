@@ -0,0 +1,150 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <libzrtpcpp/ZIDCache.h>
+#include <libzrtpcpp/ZIDRecordFile.h>
+
+#ifndef _ZIDCACHEMMAP_H_
+#define _ZIDCACHEMMAP_H_
+
+
+/**
+ * @file ZIDCacheMmap.h
+ * @brief ZID cache management with a memory mapped file
+ *
+ * The memory mapped cache uses the same file format as @c ZIDCacheFile.
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+/**
+ * This class implements a ZID (ZRTP Identifiers) cache in a memory mapped file.
+ *
+ * The interface defintion @c ZIDCache.h contains the method documentation.
+ * The file contains the same fixed size records as the file of @c ZIDCacheFile,
+ * thus both backends can use the same file. The class does not migrate files
+ * of the old version 1 format, open such a file once with @c ZIDCacheFile.
+ *
+ * An open addressing hash table indexes the mapped records by the peer ZID,
+ * @c getRecord copies the record from the mapping and @c saveRecord writes
+ * the record in place. To add records the class enlarges the file and the
+ * mapping in steps, @c close truncates the file to the used records.
+ *
+ * The flush policy controls when the class calls @c msync to write the
+ * modified records to disk.
+ */
+
+class __EXPORT ZIDCacheMmap: public ZIDCache {
+
+public:
+    /**
+     * @brief When to write the modified records to disk.
+     */
+    typedef enum {
+        FlushOnClose = 1,   ///< Let the kernel write back the records, sync on close only
+        FlushBatched,       ///< Schedule an asynchronous write after a number of saved records
+        FlushEverySave      ///< Write each saved record synchronously
+    } FlushPolicy;
+
+private:
+
+    int zidFd;
+    unsigned char associatedZid[IDENTIFIER_LEN];
+
+    zidrecord2_t* records;      ///< the mapped records, the first record is the own ZID record
+    size_t numRecords;          ///< number of used records
+    size_t mappedRecords;       ///< number of mapped records
+
+    uint32_t* index;            ///< record number + 1 of peer records, 0 is an empty slot
+    size_t indexSize;           ///< number of slots, a power of 2
+    size_t indexUsed;
+    size_t compactRecord;       ///< number of the next record compactStep checks
+
+    FlushPolicy flushPolicy;
+    int32_t batchSize;
+    int32_t unflushed;
+
+    int mapRecords(size_t count);
+    void unmap();
+    void insertIndex(uint32_t recordNumber);
+    void growIndex();
+    size_t findIndex(const unsigned char* zid);
+    ZIDRecord *lookupRecord(unsigned char *zid, ZIDRecordFile *zidRecord);
+    void eraseIndex(size_t recordNumber);
+    bool isRemovable(size_t recordNumber, int64_t now);
+    void flushRecord(size_t recordNumber);
+
+public:
+
+    ZIDCacheMmap(): zidFd(-1), records(NULL), numRecords(0), mappedRecords(0), index(NULL), indexSize(0),
+                    indexUsed(0), compactRecord(0), flushPolicy(FlushBatched), batchSize(64), unflushed(0) {};
+
+    ~ZIDCacheMmap();
+
+    int open(char *name);
+
+    bool isOpen() { return (zidFd >= 0); };
+
+    void close();
+
+    ZIDRecord *getRecord(unsigned char *zid);
+
+    ZIDRecord *getRecordInto(unsigned char *zid, ZIDRecordStorage& storage);
+
+    unsigned int saveRecord(ZIDRecord *zidRecord);
+
+    const unsigned char* getZid() { return associatedZid; };
+
+    int32_t getPeerName(const uint8_t *peerZid, std::string *name);
+
+    void putPeerName(const uint8_t *peerZid, const std::string name);
+
+    /**
+     * @brief Set the flush policy.
+     *
+     * The default policy is @c FlushBatched with a batch of 64 saved records.
+     *
+     * @param policy
+     *    The flush policy.
+     * @param saves
+     *    Number of saved records before an asynchronous write, used with
+     *    @c FlushBatched only.
+     */
+    void setFlushPolicy(FlushPolicy policy, int32_t saves = 64);
+
+    int32_t exportRecords(FILE* out);
+
+    int32_t importRecords(FILE* in);
+
+    int32_t compact();
+
+    int32_t compactStep(int32_t maxRecords);
+
+    // Not implemented for memory mapped cache
+    void cleanup() {};
+    void *prepareReadAll() { return NULL; };
+    void *readNextRecord(void *stmt, std::string *output) { return NULL; };
+    void closeOpenStatment(void *stmt) {}
+    void setCrashSafetyWindow(int32_t milliseconds) {}
+
+    bool setCacheKey(const uint8_t *key, int32_t keyLength, bool rawKey, int32_t kdfIterations) { return false; }
+};
+
+/**
+ * @}
+ */
+#endif
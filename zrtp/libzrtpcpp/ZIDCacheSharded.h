@@ -0,0 +1,142 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <libzrtpcpp/ZIDCache.h>
+
+#ifndef _ZIDCACHESHARDED_H_
+#define _ZIDCACHESHARDED_H_
+
+
+/**
+ * @file ZIDCacheSharded.h
+ * @brief Thread safe ZID cache layer with per shard locks
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+/**
+ * This class makes a ZID cache backend usable by concurrent ZRTP sessions.
+ *
+ * The class implements the @c ZIDCache interface and wraps the backend
+ * instance, for example @c ZIDCacheFile or @c ZIDCacheDb. The interface
+ * defintion @c ZIDCache.h contains the method documentation.
+ *
+ * The class keeps a copy of each record it read in memory. The copies are
+ * distributed to shards by the peer ZID, each shard has its own lock. Thus
+ * @c getRecord calls for peers in different shards run in parallel and do not
+ * access the backend if the record is in memory. One backend lock serializes
+ * the backend accesses, that is reading a record the first time and
+ * @c saveRecord, which writes each record to the backend immediately.
+ *
+ * The class owns the backend and deletes it in the destructor.
+ */
+
+class __EXPORT ZIDCacheSharded: public ZIDCache {
+
+private:
+    typedef struct {
+        std::mutex lock;
+        std::unordered_map<std::string, ZIDRecord*> records;
+    } shard_t;
+
+    ZIDCache* backend;
+    std::mutex backendLock;
+
+    shard_t* shards;
+    size_t shardMask;
+
+    shard_t& getShard(const uint8_t* zid);
+    void dropRecords();
+
+    // A NULL storage allocates the record
+    ZIDRecord *lookupRecord(unsigned char *zid, ZIDRecordStorage *storage);
+
+public:
+
+    /**
+     * @brief Create the cache layer.
+     *
+     * @param backend
+     *    The backend cache instance, the layer takes ownership.
+     * @param numShards
+     *    Number of shards, the class rounds it up to a power of 2.
+     */
+    ZIDCacheSharded(ZIDCache* backend, size_t numShards = 16);
+
+    ~ZIDCacheSharded();
+
+    /**
+     * @brief Install the cache layer in front of the ZID cache instance.
+     *
+     * Wraps the instance that @c getZidCacheInstance returns and installs the
+     * layer as new instance. Call this function during initialization, before
+     * the application opens the cache and before it starts ZRTP sessions.
+     *
+     * @param numShards
+     *    Number of shards, use about the number of cores or more.
+     * @return
+     *    The installed layer.
+     */
+    static ZIDCacheSharded* install(size_t numShards = 16);
+
+    int open(char *name);
+
+    bool isOpen();
+
+    void close();
+
+    ZIDRecord *getRecord(unsigned char *zid);
+
+    ZIDRecord *getRecordInto(unsigned char *zid, ZIDRecordStorage& storage);
+
+    unsigned int saveRecord(ZIDRecord *zidRecord);
+
+    const unsigned char* getZid();
+
+    int32_t getPeerName(const uint8_t *peerZid, std::string *name);
+
+    void putPeerName(const uint8_t *peerZid, const std::string name);
+
+    void cleanup();
+
+    void *prepareReadAll();
+
+    void *readNextRecord(void *stmt, std::string *output);
+
+    void closeOpenStatment(void *stmt);
+
+    void setCrashSafetyWindow(int32_t milliseconds);
+
+    bool setCacheKey(const uint8_t *key, int32_t keyLength, bool rawKey, int32_t kdfIterations);
+
+    int32_t exportRecords(FILE* out);
+
+    int32_t importRecords(FILE* in);
+
+    int32_t compact();
+
+    int32_t compactStep(int32_t maxRecords);
+};
+
+/**
+ * @}
+ */
+#endif
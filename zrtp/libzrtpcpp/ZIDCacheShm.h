@@ -0,0 +1,181 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <libzrtpcpp/ZIDCache.h>
+#include <libzrtpcpp/ZIDRecordFile.h>
+
+#ifndef _ZIDCACHESHM_H_
+#define _ZIDCACHESHM_H_
+
+
+/**
+ * @file ZIDCacheShm.h
+ * @brief ZID cache management in a POSIX shared memory segment
+ *
+ * The shared memory cache persists the records in a file with the format of
+ * @c ZIDCacheFile.
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+/**
+ * This class implements a ZID (ZRTP Identifiers) cache that several processes share.
+ *
+ * The interface defintion @c ZIDCache.h contains the method documentation.
+ * All processes that open the same cache file attach the same POSIX shared
+ * memory segment, the segment name derives from the absolute file name. The
+ * segment contains the records and an open addressing hash table that indexes
+ * the records by the peer ZID. The first process loads the cache file into
+ * the segment, the last process that closes the cache writes the records back
+ * and removes the segment. A segment serves up to 256 processes, the class
+ * ignores processes that terminated without closing the cache.
+ *
+ * Readers do not lock: a record carries a sequence number that a writer makes
+ * odd while it modifies the record, @c getRecord copies a record and repeats
+ * the copy if the sequence number was odd or changed. Index entries and
+ * records are never removed, thus a reader always finds a published record.
+ * Writers serialize on a process shared, robust mutex in the segment.
+ *
+ * One of the processes is the persister: a background thread writes the
+ * modified records to the cache file. If the persister process terminates
+ * another process takes over the persister role. Only the persister and
+ * the last closing process write the file.
+ *
+ * The segment has a fixed capacity that the first process sets, see
+ * setCapacity(). If the segment is full @c getRecord returns a record that
+ * @c saveRecord does not store. The class does not remove records from
+ * the segment, @c compact and @c compactStep return 0. Compact the cache file
+ * with @c ZIDCacheFile while no process uses it.
+ *
+ * All methods are thread safe.
+ */
+
+class __EXPORT ZIDCacheShm: public ZIDCache {
+
+private:
+    struct ShmHeader;
+    struct ShmRecord;
+
+    int zidFd;
+    unsigned char associatedZid[IDENTIFIER_LEN];
+    std::string segmentName;
+    void* segment;
+    size_t segmentSize;
+
+    ShmHeader* header;
+    ShmRecord* records;
+    std::atomic<uint32_t>* index;
+    uint32_t capacity;
+
+    std::thread persister;
+    std::mutex persisterLock;
+    std::condition_variable persisterWakeup;
+    bool persisterRunning;
+    int32_t persistInterval;
+
+    int createSegment(int fd);
+    int attachSegment(int fd);
+    int mapSegment(int fd, size_t size);
+    void setLayout();
+    int loadFile();
+    void detach();
+
+    void lockWriter();
+    void unlockWriter();
+
+    int64_t findRecord(const unsigned char* zid);
+    ZIDRecord *lookupRecord(unsigned char *zid, ZIDRecordFile *zidRecord);
+    void readRecord(uint32_t recordNumber, zidrecord2_t* data);
+    void writeRecord(uint32_t recordNumber, const zidrecord2_t* data);
+    int64_t appendRecord(const zidrecord2_t* data);
+    void insertIndex(uint32_t recordNumber);
+
+    void runPersister();
+    int32_t persistRecords();
+
+public:
+
+    ZIDCacheShm(): zidFd(-1), segment(NULL), segmentSize(0), header(NULL), records(NULL), index(NULL),
+                   capacity(65536), persisterRunning(false), persistInterval(1000) {};
+
+    ~ZIDCacheShm();
+
+    /**
+     * @brief Set the number of records the shared memory segment can hold.
+     *
+     * Only the process that creates the segment sets its capacity, call this
+     * function before @c open. The default capacity is 65536 records.
+     *
+     * @param records
+     *    Maximum number of records, including the own ZID record.
+     */
+    void setCapacity(uint32_t records) { capacity = (records < 2) ? 2 : records; };
+
+    /**
+     * @brief Set the interval of the persister thread.
+     *
+     * @param milliseconds
+     *    Time between two writes of the modified records, the default is 1000.
+     */
+    void setPersistInterval(int32_t milliseconds) { persistInterval = (milliseconds < 1) ? 1 : milliseconds; };
+
+    int open(char *name);
+
+    bool isOpen() { return (segment != NULL); };
+
+    void close();
+
+    ZIDRecord *getRecord(unsigned char *zid);
+
+    ZIDRecord *getRecordInto(unsigned char *zid, ZIDRecordStorage& storage);
+
+    unsigned int saveRecord(ZIDRecord *zidRecord);
+
+    const unsigned char* getZid();
+
+    int32_t getPeerName(const uint8_t *peerZid, std::string *name);
+
+    void putPeerName(const uint8_t *peerZid, const std::string name);
+
+    int32_t exportRecords(FILE* out);
+
+    int32_t importRecords(FILE* in);
+
+    int32_t compact() { return 0; };
+
+    int32_t compactStep(int32_t maxRecords) { return 0; };
+
+    // Not implemented for shared memory cache
+    void cleanup() {};
+    void *prepareReadAll() { return NULL; };
+    void *readNextRecord(void *stmt, std::string *output) { return NULL; };
+    void closeOpenStatment(void *stmt) {}
+    void setCrashSafetyWindow(int32_t milliseconds) {}
+
+    bool setCacheKey(const uint8_t *key, int32_t keyLength, bool rawKey, int32_t kdfIterations) { return false; }
+};
+
+/**
+ * @}
+ */
+#endif
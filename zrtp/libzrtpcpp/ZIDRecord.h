@@ -18,7 +18,13 @@
 #define _ZIDRECORD_H_
 
 #include <stdint.h>
+#include <stddef.h>
 #include <common/osSpecifics.h>
+#if defined(__cplusplus)
+#include <new>
+#include <utility>
+#include <common/ZrtpAllocator.h>
+#endif
 /**
  * @file ZIDRecord.h
  * @brief ZID cache record management
@@ -41,6 +47,8 @@
 #define SQLITE_TYPE_RECORD  2
 
 #if defined(__cplusplus)
+class ZIDRecordStorage;
+
 /**
  * Interface for classes that implement a ZID cache record.
  *
@@ -53,6 +61,8 @@
 class __EXPORT ZIDRecord {
 
 public:
+    ZRTP_ALLOCATOR_OPERATORS
+
     /**
      * @brief Destructor.
      * Define a virtual destructor to enable cleanup in derived classes.
@@ -220,6 +230,160 @@ public:
      * uses the unixepoch.
      */
     virtual int64_t getSecureSince() =0;
+
+    /**
+     * @brief Get the Preshared counter.
+     *
+     * The counter holds the number of consecutive Preshared key agreements
+     * with this peer since the last DH key agreement.
+     */
+    virtual uint32_t getPreshCounter() =0;
+
+    /**
+     * @brief Set the Preshared counter.
+     *
+     * ZRtp increments the counter after a Preshared key agreement and resets
+     * it after a DH key agreement.
+     */
+    virtual void setPreshCounter(uint32_t counter) =0;
+
+    /**
+     * @brief Create a copy of this record.
+     *
+     * Cache layers use this to hand out copies of the records they keep. The
+     * caller must @c delete the copy if it is not longer used.
+     */
+    virtual ZIDRecord* clone() =0;
+
+    /**
+     * @brief Get the number of bytes of this record.
+     *
+     * The size includes the memory the record owns, see MemoryUsage.
+     */
+    virtual size_t getMemorySize() const =0;
+
+    /**
+     * @brief Copy this record into a caller owned storage.
+     *
+     * The default implementation stores a @c clone of the record, the record
+     * classes of the cache backends construct their copy in the storage.
+     *
+     * @return the copy in the storage
+     */
+    virtual ZIDRecord* copyTo(ZIDRecordStorage& storage);
+};
+
+/**
+ * @brief Caller owned storage for one ZID record.
+ *
+ * The storage has room for the record of each cache backend, the backends
+ * construct the record in the storage instead of allocating it, see
+ * ZIDCache::getRecordInto(). The storage can also own a record that someone
+ * else allocated, for example the record of a cache layer that does not
+ * support the storage.
+ *
+ * The storage destroys its record when it gets a new record, on @c reset and
+ * in its destructor. Moving a storage moves its record.
+ *
+ * @author: Werner Dittmann <Werner.Dittmann@t-online.de>
+ */
+class __EXPORT ZIDRecordStorage {
+
+public:
+    /// The size of the largest record class that the storage holds in place
+    static const size_t capacity = 256;
+
+    ZIDRecordStorage(): record(nullptr), inPlace(false) {}
+
+    ~ZIDRecordStorage() { reset(); }
+
+    ZIDRecordStorage(ZIDRecordStorage&& other): record(nullptr), inPlace(false) {
+        *this = std::move(other);
+    }
+
+    ZIDRecordStorage& operator=(ZIDRecordStorage&& other) {
+        if (this == &other)
+            return *this;
+        reset();
+        if (other.inPlace) {
+            other.record->copyTo(*this);
+            other.reset();
+        }
+        else {
+            record = other.record;
+            other.record = nullptr;
+        }
+        return *this;
+    }
+
+    ZIDRecordStorage(const ZIDRecordStorage&) = delete;
+    ZIDRecordStorage& operator=(const ZIDRecordStorage&) = delete;
+
+    /**
+     * @brief Construct a record in the storage.
+     *
+     * Replaces the current record, the arguments go to the constructor of
+     * the record class.
+     *
+     * @return the new record
+     */
+    template <class Record, class... Args>
+    Record* construct(Args&&... args) {
+        static_assert(sizeof(Record) <= capacity, "ZID record class is too large for ZIDRecordStorage");
+        static_assert(alignof(Record) <= alignof(Buffer), "ZID record class needs a larger alignment");
+        reset();
+        Record* newRecord = ::new (buffer.data) Record(std::forward<Args>(args)...);
+        record = newRecord;
+        inPlace = true;
+        return newRecord;
+    }
+
+    /**
+     * @brief Take the ownership of an allocated record.
+     *
+     * Replaces the current record, the storage deletes the record later.
+     *
+     * @return the record
+     */
+    ZIDRecord* adopt(ZIDRecord* allocated) {
+        reset();
+        record = allocated;
+        return record;
+    }
+
+    /// @brief Destroy the record.
+    void reset() {
+        if (record == nullptr)
+            return;
+        if (inPlace)
+            record->~ZIDRecord();
+        else
+            delete record;
+        record = nullptr;
+        inPlace = false;
+    }
+
+    /// @brief Get the record, @c nullptr if the storage is empty.
+    ZIDRecord* get() const { return record; }
+
+    /// @brief Check if the record lives in the storage, not on the heap.
+    bool isInPlace() const { return inPlace; }
+
+private:
+    typedef union {
+        double alignDouble;
+        int64_t alignInt;
+        void* alignPointer;
+        unsigned char data[capacity];
+    } Buffer;
+
+    Buffer buffer;
+    ZIDRecord* record;
+    bool inPlace;
 };
+
+inline ZIDRecord* ZIDRecord::copyTo(ZIDRecordStorage& storage) {
+    return storage.adopt(clone());
+}
 #endif /* (__cplusplus) */
 #endif
@@ -88,6 +88,8 @@ typedef struct {
 } zidNameRecord_t;
 
 #if defined(__cplusplus)
+#include <libzrtpcpp/ZIDCacheExport.h>
+
 /**
  * This class implements the ZID record.
  *
@@ -275,6 +277,28 @@ public:
     int getRecordType() {return SQLITE_TYPE_RECORD; }
 
     int64_t getSecureSince() { return record.secureSince; }
+
+    uint32_t getPreshCounter() { return record.preshCounter; }
+
+    void setPreshCounter(uint32_t counter) { record.preshCounter = counter; }
+
+    ZIDRecord* clone() { return new ZIDRecordDb(*this); }
+
+    size_t getMemorySize() const { return sizeof(ZIDRecordDb); }
+
+    ZIDRecord* copyTo(ZIDRecordStorage& storage) { return storage.construct<ZIDRecordDb>(*this); }
+
+    /**
+     * @brief Copy the record data to the export format.
+     */
+    void getExportData(zidExportRecord_t* data);
+
+    /**
+     * @brief Set the record data from the export format.
+     *
+     * The function sets the @c Valid flag and does not modify the own ZID flag.
+     */
+    void setExportData(const zidExportRecord_t* data);
 };
 #endif /* (__cplusplus) */
 
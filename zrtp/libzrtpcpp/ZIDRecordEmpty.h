@@ -213,6 +213,16 @@ public:
      * 
      */
     int64_t getSecureSince() override { return 0; }
+
+    uint32_t getPreshCounter() override { return 0; }
+
+    void setPreshCounter(uint32_t counter) override { (void)counter; }
+
+    ZIDRecord* clone() override { return new ZIDRecordEmpty(*this); }
+
+    size_t getMemorySize() const override { return sizeof(ZIDRecordEmpty); }
+
+    ZIDRecord* copyTo(ZIDRecordStorage& storage) override { return storage.construct<ZIDRecordEmpty>(*this); }
 };
 
 #endif // ZIDRECORDSMALL
@@ -33,6 +33,7 @@
 #include <string.h>
 #include <stdint.h>
 #include <libzrtpcpp/ZIDRecord.h>
+#include <libzrtpcpp/ZIDCacheExport.h>
 
 #define TIME_LENGTH      8      // 64 bit, can hold time on 64 bit systems
 
@@ -56,7 +57,7 @@ typedef struct zidrecord1 {
 typedef struct zidrecord2 {
     char version;   ///< version number of file format, this is #2
     char flags;     ///< bit field holding various flags, see below
-    char filler1;   ///< round up to next 32 bit
+    char preshCounter; ///< consecutive Preshared key agreements, saturates at 255
     char filler2;   ///< round up to next 32 bit
     unsigned char identifier[IDENTIFIER_LEN]; ///< the peer's ZID or own ZID
     unsigned char rs1Interval[TIME_LENGTH];   ///< expiration time of RS1; -1 means indefinite
@@ -87,6 +88,8 @@ static const int OwnZIDRecord     = 0x20;
  */
 class __EXPORT ZIDRecordFile: public ZIDRecord {
     friend class ZIDCacheFile;
+    friend class ZIDCacheMmap;
+    friend class ZIDCacheShm;
 
 private:
     zidrecord2_t record;
@@ -110,7 +113,7 @@ public:
     /*
      * @brief The default constructor,
      */
-    ZIDRecordFile() {
+    ZIDRecordFile(): position(0) {
         memset(&record, 0, sizeof(zidrecord2_t));
         record.version = 2;
     }
@@ -276,6 +279,33 @@ public:
      * 
      */
     int64_t getSecureSince() { return 0; }
+
+    /**
+     * Get the Preshared counter.
+     *
+     * The file based cache stores the counter in one byte of the record.
+     */
+    uint32_t getPreshCounter() { return static_cast<uint8_t>(record.preshCounter); }
+
+    void setPreshCounter(uint32_t counter) { record.preshCounter = static_cast<char>(counter > 255 ? 255 : counter); }
+
+    ZIDRecord* clone() { return new ZIDRecordFile(*this); }
+
+    size_t getMemorySize() const { return sizeof(ZIDRecordFile); }
+
+    ZIDRecord* copyTo(ZIDRecordStorage& storage) { return storage.construct<ZIDRecordFile>(*this); }
+
+    /**
+     * @brief Copy the record data to the export format.
+     */
+    void getExportData(zidExportRecord_t* data);
+
+    /**
+     * @brief Set the record data from the export format.
+     *
+     * The function sets the @c Valid flag and does not modify the own ZID flag.
+     */
+    void setExportData(const zidExportRecord_t* data);
 };
 
 #endif // ZIDRECORDSMALL
@@ -24,6 +24,11 @@
  */
 
 #include <cstdlib>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 
 #include <libzrtpcpp/ZrtpPacketHello.h>
 #include <libzrtpcpp/ZrtpPacketHelloAck.h>
@@ -41,8 +46,11 @@
 #include <libzrtpcpp/ZrtpPacketRelayAck.h>
 #include <libzrtpcpp/ZrtpCallback.h>
 #include <libzrtpcpp/ZIDCache.h>
+#include <common/ZrtpAllocator.h>
 
 #include <cryptcommon/skeinApi.h>
+#include <zrtp/crypto/hmac256.h>
+#include <zrtp/crypto/hmac384.h>
 #ifdef ZRTP_OPENSSL
 #include <openssl/crypto.h>
 #include <openssl/sha.h>
@@ -69,7 +77,10 @@
 
 class __EXPORT ZrtpStateClass;
 class ZrtpDH;
+class MemoryUsage;
 class ZRtp;
+class DhAgreement;
+class ZrtpTrace;
 
 /**
  * The main ZRTP class.
@@ -107,6 +118,8 @@ class __EXPORT ZRtp {
 
     public:
 
+    ZRTP_ALLOCATOR_OPERATORS
+
     typedef enum _secrets {
         Rs1 = 1,
         Rs2 = 2,
@@ -114,6 +127,36 @@ class __EXPORT ZRtp {
         Aux = 8
     } secrets;
 
+    /**
+     * The handshake phases, the index into zrtpInfo::phaseTime.
+     *
+     * The first phases follow the order of the ZRTP message types, the phase
+     * of a message is the time the engine sent or received it first.
+     */
+    typedef enum _handshakePhases {
+        PhaseHello = 0,     //!< first Hello sent or received
+        PhaseHelloAck,      //!< first HelloACK
+        PhaseCommit,        //!< first Commit
+        PhaseDHPart1,       //!< first DHPart1
+        PhaseDHPart2,       //!< first DHPart2
+        PhaseConfirm1,      //!< first Confirm1
+        PhaseConfirm2,      //!< first Confirm2
+        PhaseConf2Ack,      //!< first Conf2ACK
+        PhaseSecure,        //!< engine entered SecureState
+        NumberOfPhases
+    } handshakePhases;
+
+    /**
+     * The handshake computations, the index into zrtpInfo::cpuTime.
+     */
+    typedef enum _cpuTimes {
+        CpuDhKeygen = 0,    //!< DH key generation during the handshake
+        CpuDhAgreement,     //!< DH secret computation
+        CpuKdf,             //!< key derivation of the SRTP keys and the session key
+        CpuCache,           //!< read and save of the ZID cache record
+        NumberOfCpuTimes
+    } cpuTimes;
+
     typedef struct _zrtpInfo {
         int32_t secretsCached;
         int32_t secretsMatched;
@@ -123,6 +166,9 @@ class __EXPORT ZRtp {
         const char *pubKey;
         const char *sasType;
         const char *authLength;
+        int64_t phaseTime[NumberOfPhases];  //!< microseconds since startZrtpEngine(), -1 if phase not reached
+        uint32_t phaseSent;                 //!< bit (1 << phase) is set if this engine sent the message of the phase
+        int64_t cpuTime[NumberOfCpuTimes];  //!< thread CPU time in microseconds, 0 if the platform does not support it
     } zrtpInfo;
 
     /**
@@ -141,6 +187,28 @@ class __EXPORT ZRtp {
     ZRtp(uint8_t* myZid, ZrtpCallback* cb, std::string id,
          ZrtpConfigure* config, bool mitm = false, bool sasSignSupport= false);
 
+    /**
+     * Constructor for an additional stream of a multi-stream session.
+     *
+     * The new instance takes the ZID, the configuration and the Hello
+     * packets (client id, offered algorithms, MitM and SAS sign flags) of
+     * the master stream and gets its own hash chain. If the master stream
+     * is in secure state and not a multi-stream itself the constructor also
+     * takes the negotiated algorithms and the ZRTP session key of the master,
+     * the same as setMultiStrParams(), and the new stream starts in
+     * multi-stream mode without further setup. Otherwise the new stream
+     * works as a normal stream and the application may use
+     * setMultiStrParams() later.
+     *
+     * The master stream must not be deleted before the new stream.
+     *
+     * @param cb
+     *     The callback of the new stream.
+     * @param master
+     *     The master stream of the session.
+     */
+    ZRtp(ZrtpCallback* cb, ZRtp* master);
+
     /**
      * Destructor cleans up.
      */
@@ -155,12 +223,40 @@ class __EXPORT ZRtp {
      */
     void startZrtpEngine();
 
+    /**
+     * Start to generate the DH key pair of the next key agreement.
+     *
+     * If speculative key generation is enabled, see
+     * ZrtpConfigure::setSpeculativeKeyGeneration(), the worker thread of
+     * ZrtpDHWorker generates the key pair for the first configured public
+     * key algorithm while the Hello/HelloAck discovery runs. The Commit or
+     * DHPart1 uses this key pair if the negotiated algorithm matches.
+     * startZrtpEngine() calls this method, an application that learns about
+     * the peer via signaling, for example the @c a=zrtp-hash attribute, may
+     * call it earlier.
+     *
+     * The method does nothing if the key pair generation already started, in
+     * multi-stream mode, or if the key pair pool has a key pair of this type.
+     */
+    void startSpeculativeKeyGeneration();
+
     /**
      * Stop ZRTP security.
      *
      */
     void stopZrtp();
 
+    /**
+     * Stop the engine and disconnect it from its callback.
+     *
+     * Waits for a pending asynchronous key agreement, stops ZRTP security and
+     * deletes the state engine. After this call the engine does not call its
+     * callback anymore and the application may delete it on another thread,
+     * see ZrtpReclaimer. The destructor calls this method if the application
+     * did not.
+     */
+    void detachCallback();
+
     /**
      * Process ZRTP message.
      *
@@ -181,6 +277,29 @@ class __EXPORT ZRtp {
      */
     void processZrtpMessage(uint8_t *extHeader, uint32_t peerSSRC, size_t length);
 
+    /**
+     * Process a sequence of ZRTP messages of the peer.
+     *
+     * Processes the messages like processZrtpMessage() in their order, but the
+     * state engine enters its synchronization lock only once. A message that
+     * repeats an earlier message of the sequence byte for byte is a resent
+     * packet, the state engine already handled it. The method drops such a
+     * message before the state engine. It's the caller's duty to check the ZRTP
+     * CRC and the ZRTP magic cookie of each message.
+     *
+     * @param extHeaders
+     *    Pointers to the first byte of the ZRTP messages.
+     * @param lengths
+     *    Lengths of the received data packets, see processZrtpMessage().
+     * @param count
+     *    Number of messages.
+     * @param peerSSRC
+     *    The peer's SSRC.
+     * @return
+     *    Number of messages the state engine processed.
+     */
+    int32_t processZrtpMessages(uint8_t* const extHeaders[], const size_t lengths[], int32_t count, uint32_t peerSSRC);
+
     /**
      * Process a timeout event.
      *
@@ -369,6 +488,48 @@ class __EXPORT ZRtp {
      */
     void setMultiStrParams(std::string parameters, ZRtp* zrtpMaster);
 
+    /**
+     * Get the secure state of this ZRTP session.
+     *
+     * Use this method to move an established call to another engine, for
+     * example on another media node. The state contains the negotiated
+     * algorithms, the peer's ZID, the ZRTP session key, the SAS and the SAS
+     * hash, thus the other engine can verify the SAS and provide the
+     * multi-stream parameters. The state does not contain the SRTP keys, the
+     * application moves the SRTP contexts separately.
+     *
+     * The state contains the ZRTP session key. Keep it as secret as the
+     * keys of the session itself.
+     *
+     * @return
+     *    a string that contains the secure state. The application must not
+     *    modify the contents of this string, it is opaque data. If ZRTP is
+     *    not in secure state the method returns an empty string.
+     *
+     * @see setSecureState()
+     */
+    std::string getSecureState();
+
+    /**
+     * Restore the secure state of a ZRTP session.
+     *
+     * The engine must not run: the application creates the engine, sets the
+     * state instead of starting the engine and then processes the media with
+     * the moved SRTP contexts. The engine reads the ZID record of the peer,
+     * enters the secure state and reports the cipher and SAS with
+     * ZrtpCallback::srtpSecretsOn(), it does not call
+     * ZrtpCallback::srtpSecretsReady(). The engine does not send any ZRTP
+     * packet, if it gets a Confirm2 retransmission it ignores it.
+     *
+     * @param state
+     *     A string that getSecureState() returned.
+     * @return
+     *     false if the engine runs or if the state is not valid.
+     *
+     * @see getSecureState()
+     */
+    bool setSecureState(const std::string& state);
+
     /**
      * Check if this ZRTP session is a Multi-stream session.
      *
@@ -501,6 +662,8 @@ class __EXPORT ZRtp {
      * The returned pointer points to volatile data that is valid only during the
      * <code>checkSASSignature()</code> callback funtion. The application must copy
      * the signature data if it will be used after the callback function returns.
+     * With asynchronous SAS signatures, see ZrtpConfigure::setAsyncSasSignature(),
+     * the data stays valid until the next ZRTP handshake of this stream.
      *
      * The signature data can be retrieved after ZRTP enters secure state.
      * <code>start()</code>.
@@ -522,6 +685,31 @@ class __EXPORT ZRtp {
      */
     int32_t getSignatureLength();
 
+    /**
+     * Complete an asynchronous SAS signature.
+     *
+     * With asynchronous SAS signatures, see ZrtpConfigure::setAsyncSasSignature(),
+     * the application calls this method when the signature that it started
+     * in the <code>signSAS()</code> callback is ready. The application may call
+     * the method from any thread, also during the <code>signSAS()</code>
+     * callback. If the state engine already waits for the signature the
+     * calling thread sends the Confirm packet, thus it calls the ZrtpCallback
+     * methods while holding the <code>synchEnter</code> lock.
+     *
+     * If the signature failed the application calls the method with a
+     * length of zero, ZRtp then sends the Confirm packet without signature.
+     *
+     * @param data
+     *    The signature data including the signature type block, the method
+     *    copies the data.
+     * @param length
+     *    The length of the signature data in bytes. This length must be
+     *    multiple of 4.
+     * @return
+     *    True if ZRtp requested a signature and took the data, false otherwise.
+     */
+    bool sasSignatureReady(const uint8_t* data, uint32_t length);
+
     /**
      * Emulate a Conf2Ack packet.
      *
@@ -557,6 +745,12 @@ class __EXPORT ZRtp {
       *
       * This structure contains some detailed information about the negotiated
       * algorithms, the chached and matched shared secrets.
+      *
+      * The engine also records the time of each handshake phase and the CPU
+      * time of the DH, KDF and cache computations, refer to handshakePhases and
+      * cpuTimes. The phase times use a monotonic clock. A CPU time does not
+      * include key generation the engine did before the handshake, for
+      * example with a key pool or the speculative key generation.
       */
      const zrtpInfo *getDetailInfo();
 
@@ -679,7 +873,7 @@ class __EXPORT ZRtp {
       * @brief Get the computed ZRTP exported key.
       * 
       * Returns a pointer to the computed exported key. The application should copy
-      * the data it needs.
+      * the data it needs. The first call after the key agreement derives the key.
       * 
       * @param length pointer to an int, gets the length of the exported key.
       * @return pointer to the exported key data.
@@ -696,6 +890,23 @@ class __EXPORT ZRtp {
       */
      bool isPeerDisclosureFlag(){ return peerDisclosureFlagSeen; }
 
+     /**
+      * @brief Add the memory of this engine to a footprint report.
+      *
+      * The engine adds its own size and the size of the state engine to the
+      * category MemoryUsage::Engine, the handshake data to the category
+      * MemoryUsage::Handshake, the DH context to MemoryUsage::KeyAgreement
+      * and the ZID cache record to MemoryUsage::Cache. A key agreement that a
+      * worker thread computes right now is not part of the report.
+      *
+      * The application must call this function on the thread that runs the
+      * ZRTP protocol, or hold the lock that serializes the protocol steps.
+      *
+      * @param usage
+      *    The footprint report
+      */
+     void addMemoryUsage(MemoryUsage& usage);
+
 private:
      typedef union _hashCtx {
          SkeinCtx_t  skeinCtx;
@@ -708,7 +919,25 @@ private:
 #endif
      } HashCtx;
 
+     typedef union _hmacCtx {
+         SkeinCtx_t         skeinCtx;
+         hmacSha256Context  sha256Ctx;
+         hmacSha384Context  sha384Ctx;
+     } HmacCtx;
+
+     /**
+      * One output of a batched KDF computation, see KDF().
+      */
+     typedef struct _kdfOutput {
+         const uint8_t* label;     //!< KDF label, null terminated
+         size_t labelLength;       //!< length of label including the null byte
+         size_t L;                 //!< length of the derived key in bits
+         uint8_t* output;          //!< receives the derived key, at least MAX_DIGEST_LENGTH bytes
+     } KdfOutput;
+
      friend class ZrtpStateClass;
+     friend class DhAgreement;
+     friend class ZRtpPool;
 
     /**
      * The state engine takes care of protocol processing.
@@ -742,9 +971,62 @@ private:
     uint8_t* DHss;
 
     /**
-     * My computed public key
+     * If true compute the DH shared secret asynchronously, see ZrtpConfigure::setAsyncKeyAgreement()
      */
-    uint8_t pubKeyBytes[1000];
+    bool asyncKeyAgreement;
+
+    /**
+     * The pending asynchronous key agreement, owns the DH context and the shared secret
+     * until the protocol resumes
+     */
+    std::shared_ptr<DhAgreement> pendingAgreement;
+
+    /**
+     * Number of existing DhAgreement objects, the destructor waits until all are gone
+     */
+    int32_t agreementsRunning;
+    std::mutex agreementLock;
+    std::condition_variable agreementIdle;
+
+    /**
+     * If true the signSAS callback returns before the signature is ready, see
+     * ZrtpConfigure::setAsyncSasSignature()
+     */
+    bool asyncSasSignature;
+
+    /**
+     * State of an asynchronous SAS signature
+     */
+    enum SasSignatureState {
+        SignatureIdle,                  ///< no signature requested or it is already in the Confirm packet
+        SignatureRequested,             ///< signSAS called, the signature is not ready
+        SignatureReady,                 ///< the application delivered the signature
+        SignatureWaiting                ///< the state engine waits for the signature
+    };
+    SasSignatureState signatureState;
+
+    /**
+     * The delivered signature data until ZRtp copies it into the Confirm packet
+     */
+    std::vector<uint8_t> asyncSignature;
+
+    /**
+     * Protects signatureState and asyncSignature, sasSignatureReady() does not
+     * hold the synchEnter lock
+     */
+    std::mutex signatureLock;
+
+    /**
+     * Copy of the peer's signature data with asynchronous SAS signatures
+     */
+    std::vector<uint8_t> peerSignature;
+
+    /**
+     * The checked and decrypted Confirm1 packet while the Initiator waits for
+     * its signature
+     */
+    std::vector<uint8_t> signatureConfirm1;
+
     /**
      * Length off public key
      */
@@ -764,18 +1046,6 @@ private:
      * 4.5 and 7 how sasHash, sasValue and the SAS string are derived.
      */
     uint8_t sasHash[MAX_DIGEST_LENGTH];
-    /**
-     * The ids for the retained and other shared secrets
-     */
-    uint8_t rs1IDr[MAX_DIGEST_LENGTH];
-    uint8_t rs2IDr[MAX_DIGEST_LENGTH];
-    uint8_t auxSecretIDr[MAX_DIGEST_LENGTH];
-    uint8_t pbxSecretIDr[MAX_DIGEST_LENGTH];
-
-    uint8_t rs1IDi[MAX_DIGEST_LENGTH];
-    uint8_t rs2IDi[MAX_DIGEST_LENGTH];
-    uint8_t auxSecretIDi[MAX_DIGEST_LENGTH];
-    uint8_t pbxSecretIDi[MAX_DIGEST_LENGTH];
 
     /**
      * pointers to aux secret storage and length of aux secret
@@ -789,19 +1059,10 @@ private:
      */
     bool rs1Valid;
     bool rs2Valid;
-    /**
-     * My hvi
-     */
-    uint8_t hvi[MAX_DIGEST_LENGTH];
-
-    /**
-     * The peer's hvi
-     */
-    uint8_t peerHvi[8*ZRTP_WORD_SIZE];
 
     /**
-     * Context to compute the SHA256 hash of selected messages.
-     * Used to compute the s0, refer to chapter 4.4.1.4
+     * Context to compute the SHA256 hash of selected messages, points into
+     * the handshake data. Used to compute the s0, refer to chapter 4.4.1.4
      */
     void* msgShaContext;
     /**
@@ -833,12 +1094,6 @@ private:
     uint8_t peerHelloHash[IMPL_MAX_DIGEST_LENGTH];
     uint8_t peerHelloVersion[ZRTP_WORD_SIZE + 1];   // +1 for nul byte
 
-    // We get the peer's H? from the message where length is defined as 8 words
-    uint8_t peerH0[8*ZRTP_WORD_SIZE];
-    uint8_t peerH1[8*ZRTP_WORD_SIZE];
-    uint8_t peerH2[8*ZRTP_WORD_SIZE];
-    uint8_t peerH3[8*ZRTP_WORD_SIZE];
-
     /**
      * The SHA256 hash over selected messages
      */
@@ -878,8 +1133,6 @@ private:
     uint8_t zrtpKeyI[MAX_DIGEST_LENGTH];
     uint8_t zrtpKeyR[MAX_DIGEST_LENGTH];
 
-    HashCtx hashCtx;
-
     /**
      * Pointers to negotiated hash and HMAC functions
      */
@@ -898,6 +1151,15 @@ private:
 
     void* (*createHashCtx)(void* ctx);
 
+    /**
+     * Pointers to negotiated HMAC functions that use a prepared key context,
+     * the KDF uses them to derive several keys from the same key.
+     */
+    void* (*createHmacCtx)(void* ctx, const uint8_t* key, uint64_t keyLength);
+
+    void (*hmacCtxListFunction)(void* ctx, const uint8_t* const data[], const uint64_t dataLength[], size_t count,
+                                uint8_t* mac, uint32_t* macLength);
+
     void (*closeHashCtx)(void* ctx, uint_8t* digest);
 
     void (*hashCtxFunction)(void* ctx, const uint8_t* data, uint64_t dataLength);
@@ -927,6 +1189,15 @@ private:
      */
     uint8_t zrtpExport[MAX_DIGEST_LENGTH];
 
+    /**
+     * Copy of s0 for the exported key. Most applications never get the
+     * exported key, thus computeSRTPKeys() does not derive it but keeps s0
+     * here until getExportedKey() derives the key or the instance ends.
+     */
+    uint8_t exportSecret[MAX_DIGEST_LENGTH];
+    bool exportPending;         ///< exportSecret holds s0, zrtpExport is not derived yet
+    std::mutex exportLock;      ///< the application may get the exported key in any thread
+
     /**
      * True if this ZRTP instance uses multi-stream mode.
      */
@@ -937,6 +1208,17 @@ private:
      */
     bool multiStreamAvailable;
 
+    /**
+     * True if the current key agreement uses Preshared mode, refer to
+     * RFC 6189, chapter 4.4.2.
+     */
+    bool presharedMode;
+
+    /**
+     * The preshared key, ZRtp clears it after it computed s0.
+     */
+    uint8_t presharedKey[MAX_DIGEST_LENGTH];
+
     /**
      * Enable MitM (PBX) enrollment
      * 
@@ -976,6 +1258,12 @@ private:
      * Configuration data which algorithms to use.
      */
     ZrtpConfigure configureAlgos;
+
+    /**
+     * The trace of this engine, see ZrtpConfigure::setTrace(), nullptr if not traced
+     */
+    ZrtpTrace* trace;
+
     /**
      * Pre-initialized packets.
      */
@@ -988,16 +1276,12 @@ private:
     ZrtpPacketGoClear  zrtpGoClear;
     ZrtpPacketError    zrtpError;
     ZrtpPacketErrorAck zrtpErrorAck;
-    ZrtpPacketDHPart   zrtpDH1;
-    ZrtpPacketDHPart   zrtpDH2;
-    ZrtpPacketCommit   zrtpCommit;
-    ZrtpPacketConfirm  zrtpConfirm1;
-    ZrtpPacketConfirm  zrtpConfirm2;
     ZrtpPacketPingAck  zrtpPingAck;
     ZrtpPacketSASrelay zrtpSasRelay;
     ZrtpPacketRelayAck zrtpRelayAck;
 
     HelloPacketVersion helloPackets[MAX_ZRTP_VERSIONS + 1];
+    std::once_flag lazyHelloOnce;   ///< prepares the Hello of version 1.2, see prepareHello()
     int32_t highestZrtpVersion;
 
     /// Pointer to Hello packet sent to partner, initialized in ZRtp, modified by ZrtpStateClass
@@ -1008,6 +1292,35 @@ private:
      */
     ZIDRecord *zidRec;
 
+    /**
+     * Owns the ZID cache record, the cache backends construct the record in
+     * the storage
+     */
+    ZIDRecordStorage zidRecStorage;
+
+    /**
+     * If true read and save the ZID record in the worker of ZIDCacheAsync, see
+     * ZrtpConfigure::setAsyncZidCache()
+     */
+    bool asyncZidCache;
+
+    /**
+     * The prefetched ZID record, pending after the Hello of the peer arrived
+     */
+    std::future<ZIDRecord*> zidRecPrefetch;
+
+    /**
+     * If true generate the DH key pair before the Hello of the peer arrives, see
+     * ZrtpConfigure::setSpeculativeKeyGeneration()
+     */
+    bool speculativeKeyGen;
+
+    /**
+     * The speculatively generated DH key pair and its public key algorithm name
+     */
+    std::future<ZrtpDH*> speculativeDh;
+    int32_t speculativeType;
+
     /**
      * Save record
      * 
@@ -1019,8 +1332,59 @@ private:
      */
     uint8_t randomIV[16];
 
-    uint8_t tempMsgBuffer[1024];
-    uint32_t lengthOfMsgData;
+    /**
+     * The data that only the key negotiation uses. A call keeps the engine
+     * for a long time after it reached SecureState, thus the engine allocates
+     * this data when it starts and releases it when it enters SecureState.
+     */
+    struct Handshake {
+        ZRTP_ALLOCATOR_OPERATORS
+
+        ZrtpPacketDHPart   zrtpDH1;
+        ZrtpPacketDHPart   zrtpDH2;
+        ZrtpPacketCommit   zrtpCommit;
+        ZrtpPacketConfirm  zrtpConfirm1;
+        ZrtpPacketConfirm  zrtpConfirm2;
+
+        /**
+         * My computed public key
+         */
+        uint8_t pubKeyBytes[1000];
+
+        /**
+         * Copy of the last received message, see storeMsgTemp()
+         */
+        uint8_t tempMsgBuffer[1024];
+        uint32_t lengthOfMsgData;
+
+        /**
+         * The ids for the retained and other shared secrets
+         */
+        uint8_t rs1IDr[MAX_DIGEST_LENGTH];
+        uint8_t rs2IDr[MAX_DIGEST_LENGTH];
+        uint8_t auxSecretIDr[MAX_DIGEST_LENGTH];
+        uint8_t pbxSecretIDr[MAX_DIGEST_LENGTH];
+
+        uint8_t rs1IDi[MAX_DIGEST_LENGTH];
+        uint8_t rs2IDi[MAX_DIGEST_LENGTH];
+        uint8_t auxSecretIDi[MAX_DIGEST_LENGTH];
+        uint8_t pbxSecretIDi[MAX_DIGEST_LENGTH];
+
+        /**
+         * My hvi and the peer's hvi
+         */
+        uint8_t hvi[MAX_DIGEST_LENGTH];
+        uint8_t peerHvi[8*ZRTP_WORD_SIZE];
+
+        // We get the peer's H? from the message where length is defined as 8 words
+        uint8_t peerH0[8*ZRTP_WORD_SIZE];
+        uint8_t peerH1[8*ZRTP_WORD_SIZE];
+        uint8_t peerH2[8*ZRTP_WORD_SIZE];
+        uint8_t peerH3[8*ZRTP_WORD_SIZE];
+
+        HashCtx hashCtx;
+    };
+    std::unique_ptr<Handshake> hs;
 
     /**
      * Variables to store signature data. Includes the signature type block
@@ -1037,11 +1401,14 @@ private:
 
     zrtpInfo detailInfo;         // filled with some more detailded information if application would like to know
 
+    std::chrono::steady_clock::time_point startTime;  // base of the phase times in detailInfo
+
     std::string peerClientId;    // store the peer's client Id
 
     ZRtp* masterStream;                    // This is the master stream in case this is a multi-stream
-    std::vector<std::string> peerNonces;   // Store nonces we got from our partner. Using std::string
-                                           // just simplifies memnory management, nonces are binary data, not strings :-)
+    class NonceSet;
+    std::unique_ptr<NonceSet> peerNonces;  // The master stores the nonces of the partner's multi-stream Commits
+    std::mutex nonceLock;                  // The streams of a master check their nonces concurrently
     /**
      * Enable or disable paranoid mode.
      *
@@ -1155,6 +1522,46 @@ private:
      */
     AlgorithmEnum* findBestAuthLen(ZrtpPacketHello* hello);
 
+    /**
+     * Get a bit mask of the configured algorithms of a type.
+     *
+     * Bit @c n of the mask is set if the algorithm with ordinal @c n of
+     * the type's enumeration is configured.
+     */
+    uint32_t getConfiguredMask(AlgoTypes algoType);
+
+    /**
+     * Find the first offered algorithm that is also configured.
+     *
+     * @param algos
+     *    The enumeration of the algorithm type.
+     * @param algoType
+     *    The algorithm type.
+     * @param offered
+     *    Pointer to the first offered algorithm name in the Hello packet.
+     * @param numOffered
+     *    Number of offered algorithm names.
+     * @return
+     *    The Enum of the algorithm, @c nullptr if no offered algorithm is configured.
+     */
+    AlgorithmEnum* findFirstConfigured(EnumBase& algos, AlgoTypes algoType, const uint8_t* offered, int32_t numOffered);
+
+    /**
+     * Find the algorithm with the lowest cost for the @c PreferLowCost policy.
+     *
+     * Takes only algorithms that reach the configured minimum security
+     * level. If two algorithms have the same cost take the stronger one.
+     *
+     * @param algos
+     *    The enumeration of the algorithm type.
+     * @param candidates
+     *    Bit mask of the ordinals of the candidate algorithms.
+     * @return
+     *    The Enum of the algorithm, @c nullptr if no candidate reaches the
+     *    minimum security level.
+     */
+    AlgorithmEnum* findLowestCost(EnumBase& algos, uint32_t candidates);
+
     /**
      * Check if MultiStream mode is offered in Hello.
      *
@@ -1168,6 +1575,46 @@ private:
      */
     bool checkMultiStream(ZrtpPacketHello* hello);
 
+    /**
+     * Check if we can offer or use Preshared mode.
+     *
+     * Preshared mode requires @c Prsh in the configured public key algorithms,
+     * a Preshared limit greater than 0, and a Hello packet that offers @c Prsh.
+     * Multi-stream sessions never use Preshared mode.
+     *
+     * @param hello
+     *    The Hello packet.
+     * @return
+     *    True if Preshared mode is available, false otherwise.
+     */
+    bool checkPreshared(ZrtpPacketHello* hello);
+
+    /**
+     * Check if the peer's ZID record allows a Preshared key agreement.
+     *
+     * The ZID record must contain a valid RS1 and the number of consecutive
+     * Preshared key agreements must be below the configured limit.
+     */
+    bool canUsePreshared();
+
+    /**
+     * Read the peer's ZID record if we did not read it yet.
+     */
+    void readZidRecord();
+
+    /**
+     * Check if a Commit packet requests Preshared mode.
+     */
+    bool isPresharedCommit(ZrtpPacketCommit* commit);
+
+    /**
+     * Get the type of a received Commit packet.
+     *
+     * A multi-stream session expects multi-stream Commits only, otherwise
+     * the key agreement type of the Commit selects the type.
+     */
+    ZrtpPacketCommit::commitType getCommitType(ZrtpPacketCommit* commit);
+
     /**
      * Checks if Hello packet contains a strong (384bit) hash based on selection policy.
      * 
@@ -1251,23 +1698,71 @@ private:
 
     void computeSharedSecretSet(ZIDRecord *zidRec);
 
+    /**
+     * Save the ZID record, in the worker of ZIDCacheAsync if enabled.
+     */
+    void saveZidRec();
+
     void computeAuxSecretIds();
 
     void computeSRTPKeys();
 
+    /**
+     * Setup the KDF context ZIDi || ZIDr || total_hash, refer to RFC 6189,
+     * chapter 4.5.1.
+     *
+     * @param KDFcontext
+     *    Buffer of at least 2 * IDENTIFIER_LEN + MAX_DIGEST_LENGTH bytes.
+     * @return
+     *    Length of the context in bytes.
+     */
+    size_t setupKdfContext(uint8_t* KDFcontext);
+
+    /**
+     * Get the SRTP master salt length in bits: 96 bits for AES-GCM (RFC 7714)
+     * and ChaCha20-Poly1305, 112 bits otherwise.
+     */
+    size_t getSrtpSaltLength() {
+        return (authLength->getAlgoId() == AesGcm || authLength->getAlgoId() == ChaCha20Poly1305) ? 96 : 112;
+    }
+
     void KDF(uint8_t* key, size_t keyLength, uint8_t* label, size_t labelLength,
                uint8_t* context, size_t contextLength, size_t L, uint8_t* output);
 
+    /**
+     * Compute several KDF outputs with the same key and context.
+     *
+     * The function prepares the HMAC key context only once for all outputs and
+     * does not allocate memory.
+     */
+    void KDF(uint8_t* key, size_t keyLength, uint8_t* context, size_t contextLength,
+             const KdfOutput* outputs, size_t count);
+
     void generateKeysInitiator(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec);
 
     void generateKeysResponder(ZrtpPacketDHPart *dhPart, ZIDRecord *zidRec);
 
     void generateKeysMultiStream();
 
+    /**
+     * Compute the preshared key and the key ID of Preshared mode.
+     *
+     * @param keyId
+     *    Points to a buffer of 8 bytes that gets the key ID.
+     */
+    void computePresharedKey(uint8_t* keyId);
+
+    void generateKeysPreshared();
+
     void computePBXSecret();
 
     void setNegotiatedHash(AlgorithmEnum* hash);
 
+    /**
+     * Report the cipher, the SAS and the verify flag with ZrtpCallback::srtpSecretsOn().
+     */
+    void reportSecretsOn();
+
     /*
      * The following methods are helper functions for ZrtpStateClass.
      * ZrtpStateClass calls them to prepare packets, send data, report
@@ -1356,6 +1851,41 @@ private:
      */
     ZrtpPacketCommit* prepareCommitMultiStream(ZrtpPacketHello *hello);
 
+    /**
+     * Prepare a Commit packet for DH mode.
+     *
+     * Prepares the DH context, the DHPart2 packet and the hvi, then the Commit
+     * packet. The algorithms are already selected.
+     *
+     * @param hello
+     *    Points to the received Hello packet
+     * @return
+     *    A pointer to the prepared Commit packet for DH mode
+     */
+    ZrtpPacketCommit* prepareCommitDH(ZrtpPacketHello *hello);
+
+    /**
+     * Prepare a Commit packet for Preshared mode.
+     *
+     * @param hello
+     *    Points to the received Hello packet
+     * @return
+     *    A pointer to the prepared Commit packet for Preshared mode
+     */
+    ZrtpPacketCommit* prepareCommitPreshared(ZrtpPacketHello *hello);
+
+    /**
+     * Prepare a DH Commit packet as answer to a Preshared Commit.
+     *
+     * The state engine calls this method if prepareConfirm1Preshared() did
+     * not find a matching preshared key. The DH Commit wins the Commit
+     * contention, thus the peer switches to the Responder role.
+     *
+     * @return
+     *    A pointer to the prepared Commit packet for DH mode
+     */
+    ZrtpPacketCommit* prepareCommitDHFallback();
+
     /**
      * Prepare the DHPart1 packet.
      *
@@ -1391,6 +1921,176 @@ private:
      */
     ZrtpPacketConfirm* prepareConfirm1(ZrtpPacketDHPart* dhPart2, uint32_t* errMsg);
 
+    /**
+     * Check a DHPart1 packet and its public value, we are Initiator.
+     *
+     * Helper for prepareDHPart2() and startDHPart2().
+     */
+    bool checkDHPart1(ZrtpPacketDHPart* dhPart1, uint32_t* errMsg);
+
+    /**
+     * Hash the DHPart packets, compute the keys and return the DHPart2 packet.
+     *
+     * Helper for prepareDHPart2() and resumeDHPart2(), the DH shared secret is
+     * available in DHss.
+     */
+    ZrtpPacketDHPart* finishDHPart2(ZrtpPacketDHPart* dhPart1);
+
+    /**
+     * Check a DHPart2 packet and its public value, we are Responder.
+     *
+     * Helper for prepareConfirm1() and startConfirm1().
+     */
+    bool checkDHPart2(ZrtpPacketDHPart* dhPart2, uint32_t* errMsg);
+
+    /**
+     * Hash the DHPart2 packet, compute the keys and return the Confirm1 packet.
+     *
+     * Helper for prepareConfirm1() and resumeConfirm1(), the DH shared secret is
+     * available in DHss.
+     */
+    ZrtpPacketConfirm* finishConfirm1(ZrtpPacketDHPart* dhPart2, uint32_t* errMsg);
+
+    /**
+     * Start the asynchronous variant of prepareDHPart2().
+     *
+     * The method checks the DHPart1 packet and submits the computation of the
+     * DH shared secret to the ZrtpDHWorker. The state engine receives a
+     * ZrtpKeyReady event if the shared secret is ready.
+     *
+     * @return
+     *    true if the key agreement is pending, false if the packet check failed,
+     *    <code>errMsg</code> contains the error code.
+     */
+    bool startDHPart2(ZrtpPacketDHPart* dhPart1, uint32_t* errMsg);
+
+    /**
+     * Resume the asynchronous variant of prepareDHPart2() after ZrtpKeyReady.
+     *
+     * @return
+     *    The DHPart2 packet or nullptr if no key agreement is ready, in this
+     *    case <code>errMsg</code> is IgnorePacket.
+     */
+    ZrtpPacketDHPart* resumeDHPart2(uint32_t* errMsg);
+
+    /**
+     * Start the asynchronous variant of prepareConfirm1().
+     *
+     * @see startDHPart2()
+     */
+    bool startConfirm1(ZrtpPacketDHPart* dhPart2, uint32_t* errMsg);
+
+    /**
+     * Resume the asynchronous variant of prepareConfirm1() after ZrtpKeyReady.
+     *
+     * @see resumeDHPart2()
+     */
+    ZrtpPacketConfirm* resumeConfirm1(uint32_t* errMsg);
+
+    /**
+     * Hand the DH context, the shared secret buffer and a copy of the peer's
+     * DHPart packet to a new DhAgreement and submit it to the worker thread.
+     */
+    void startKeyAgreement(ZrtpPacketDHPart* dhPart);
+
+    /**
+     * Take the DH context, the shared secret and the peer's DHPart packet back
+     * from a finished key agreement.
+     *
+     * @return
+     *    false if no key agreement is pending or it is not finished yet
+     */
+    bool takeKeyAgreement(std::vector<uint8_t>& packet);
+
+    /**
+     * Drop a pending key agreement, the worker discards its result.
+     */
+    void cancelKeyAgreement();
+
+    /**
+     * Get a DH context with a generated key pair.
+     *
+     * Takes the speculatively generated key pair if its type matches, then
+     * tries the key pair pool and generates the key pair inline otherwise.
+     *
+     * @param type
+     *    Name of the public key algorithm.
+     * @return
+     *    The DH context, the caller owns it.
+     */
+    ZrtpDH* createDhContext(const char* type);
+
+    /**
+     * The worker thread calls this method if the shared secret is ready.
+     */
+    void keyAgreementReady();
+
+    /**
+     * Check if asynchronous key agreement is enabled.
+     *
+     * The worker thread resumes the protocol, thus a callback without
+     * synchronization always uses the synchronous key agreement.
+     */
+    bool isAsyncKeyAgreement() { return asyncKeyAgreement && callback->synchRequired; }
+
+    /**
+     * Check if an asynchronous key agreement is pending.
+     */
+    bool isKeyAgreementPending() { return pendingAgreement != nullptr; }
+
+    /**
+     * Request an asynchronous SAS signature before the signSAS callback.
+     */
+    void startSasSignature();
+
+    /**
+     * Copy a delivered asynchronous SAS signature into my Confirm packet.
+     *
+     * @return
+     *    true if no signature is outstanding, false if the signature is not ready,
+     *    the state engine then waits for the ZrtpSignatureReady event.
+     */
+    bool takeSasSignature();
+
+    /**
+     * Drop an outstanding asynchronous SAS signature.
+     */
+    void cancelSasSignature();
+
+    /**
+     * Check if the state engine waits for an asynchronous SAS signature.
+     */
+    bool isSasSignatureWaiting();
+
+    /**
+     * Send the Confirm1 packet after ZrtpSignatureReady.
+     *
+     * @return
+     *    The Confirm1 packet or nullptr if the signature is not ready, in this
+     *    case <code>errMsg</code> is IgnorePacket.
+     */
+    ZrtpPacketConfirm* resumeSignedConfirm1(uint32_t* errMsg);
+
+    /**
+     * Send the Confirm2 packet after ZrtpSignatureReady.
+     *
+     * @see resumeSignedConfirm1()
+     */
+    ZrtpPacketConfirm* resumeSignedConfirm2(uint32_t* errMsg);
+
+    /**
+     * The application calls sasSignatureReady() while the state engine waits.
+     */
+    void sasSignatureDelivered();
+
+    /**
+     * Copy the peer's signature data if asynchronous SAS signatures are enabled.
+     *
+     * @return
+     *    The signature data that getSignatureData() returns.
+     */
+    const uint8_t* keepPeerSignature(const uint8_t* data);
+
     /**
      * Prepare the Confirm1 packet in multi stream mode.
      *
@@ -1402,6 +2102,22 @@ private:
      */
     ZrtpPacketConfirm* prepareConfirm1MultiStream(ZrtpPacketCommit* commit, uint32_t* errMsg);
 
+    /**
+     * Prepare the Confirm1 packet in Preshared mode.
+     *
+     * This method prepares the Confirm1 packet. The state engine calls this method
+     * if it received a Preshared Commit packet. Here we are in the role of the
+     * Responder.
+     *
+     * If we don't have a matching preshared key the method returns NULL and
+     * sets <code>errMsg</code> to <code>NoSharedSecret</code>, the state engine
+     * then answers with a DH Commit, see prepareCommitDHFallback().
+     */
+    ZrtpPacketConfirm* prepareConfirm1Preshared(ZrtpPacketCommit* commit, uint32_t* errMsg);
+
+    /// Fill in, encrypt and MAC the Confirm1 packet of a DH or Preshared key agreement
+    void fillConfirm1();
+
     /**
      * Prepare the Confirm2 packet.
      *
@@ -1422,6 +2138,19 @@ private:
      */
     ZrtpPacketConfirm* prepareConfirm2MultiStream(ZrtpPacketConfirm* confirm1, uint32_t* errMsg);
 
+    /**
+     * Prepare the Confirm2 packet in Preshared mode.
+     *
+     * The state engine calls this method if Preshared mode is active and in state
+     * CommitSent. The input to this method is the Confirm1 packet received from
+     * our peer as response of our Preshared Commit packet.
+     * Here we are in the role of the Initiator
+     */
+    ZrtpPacketConfirm* prepareConfirm2Preshared(ZrtpPacketConfirm* confirm1, uint32_t* errMsg);
+
+    /// Handle the retained secrets and prepare the Confirm2 packet of a DH or Preshared key agreement
+    ZrtpPacketConfirm* finishConfirm2(ZrtpPacketConfirm* confirm1);
+
     /**
      * Prepare the Conf2Ack packet.
      *
@@ -1588,22 +2317,94 @@ private:
      * ZRTP state engine calls these methods to enter or leave its
      * synchronization mutex.
      */
-    void synchEnter();
+    void synchEnter() {
+        if (callback->synchRequired)
+            callback->synchEnter();
+    }
 
-    void synchLeave();
+    void synchLeave() {
+        if (callback->synchRequired)
+            callback->synchLeave();
+    }
 
     /**
      * Helper function to store ZRTP message data in a temporary buffer
      *
-     * This functions first clears the temporary buffer, then stores
-     * the packet's data to it. We use this to check the packet's HMAC
-     * after we received the HMAC key in to following packet.
+     * This functions copies the packet's data to the temporary buffer. We
+     * use this to check the packet's HMAC after we received the HMAC key in
+     * the following packet. The receive buffer of the packet is not valid
+     * anymore at this time, thus we need the copy.
      *
      * @param data
      *    Pointer to the packet's ZRTP message
     */
      void storeMsgTemp(ZrtpPacketBase* pkt);
 
+     /**
+      * Release the handshake data.
+      *
+      * The state engine calls this function when it enters SecureState. A
+      * new start of the engine allocates the data again, see startZrtpEngine().
+      */
+     void releaseHandshake();
+
+     /**
+      * Reset the phase and CPU times of the detail information.
+      *
+      * Called by the constructors and startZrtpEngine(), sets the base time of
+      * the phase times.
+      */
+     void resetHandshakeTimes();
+
+     /**
+      * Record the time of a handshake phase if the phase has no time yet.
+      *
+      * @param phase
+      *    The handshake phase, see handshakePhases
+      * @param sent
+      *    True if this engine sent the message of the phase
+      */
+     void recordPhase(int32_t phase, bool sent);
+
+     /**
+      * Record the handshake phase of a ZRTP message.
+      *
+      * Ignores messages that are not part of the key agreement, for example
+      * Ping or Error.
+      *
+      * @param msgType
+      *    The ZRTP message type as returned by ZrtpStateClass::classifyMessage()
+      * @param sent
+      *    True if this engine sends the message
+      */
+     void recordMessagePhase(int32_t msgType, bool sent);
+
+     /**
+      * Start the running message hash.
+      *
+      * Initializes the negotiated hash context in @c hashCtx and discards
+      * any previously hashed messages.
+      */
+     void startMsgHash() { msgShaContext = createHashCtx(&hs->hashCtx); }
+
+     /**
+      * Add a ZRTP message to the running message hash.
+      *
+      * @param pkt
+      *    The ZRTP message, hashed in place with its full length.
+      */
+     void hashMsg(ZrtpPacketBase* pkt) {
+         hashCtxFunction(msgShaContext, (const uint8_t*)pkt->getHeaderBase(), pkt->getLength() * ZRTP_WORD_SIZE);
+     }
+
+     /**
+      * Finish the running message hash and store the result in @c messageHash.
+      */
+     void finishMsgHash() {
+         closeHashCtx(msgShaContext, messageHash);
+         msgShaContext = nullptr;
+     }
+
      /**
       * Helper function to check a ZRTP message HMAC
       *
@@ -1638,12 +2439,43 @@ private:
       *     Pointer to hello packet version structure.
       */
      void setClientId(std::string id, HelloPacketVersion* hpv);
+
+     /**
+      * Compute the HMAC and the final helloHash of a Hello packet.
+      *
+      * @param hpv
+      *     Pointer to hello packet version structure.
+      */
+     void computeHelloHmac(HelloPacketVersion* hpv);
+
+     /**
+      * Prepare a Hello packet that the engine does not send.
+      *
+      * The engine sends the Hello packets of the supported versions only,
+      * refer to SUPPORTED_ZRTP_VERSIONS. It builds the other Hello packets from
+      * the Hello of version 1.10 when getHelloHash() requests their hash the
+      * first time.
+      *
+      * @param index
+      *     Index of the Hello packet in @c helloPackets.
+      */
+     void prepareHello(int32_t index);
+
+     /**
+      * Common part of the constructors.
+      *
+      * Initializes the data and computes the hash chain but does not set up
+      * the Hello packets and the state engine. A traced engine uses the
+      * synchronous key agreement and ZID cache.
+      */
+     ZRtp(uint8_t* myZid, ZrtpCallback* cb, ZrtpConfigure* config, ZrtpTrace* tr);
      
      /**
       * Check and set a nonce.
       * 
       * The function first checks if the nonce is already in use (was seen) in this ZRTP
-      * session. Refer to 4.4.3.1.
+      * session. Refer to 4.4.3.1. The master stream keeps the most recent nonces only,
+      * see NonceSet.
       * 
       * @param nonce
       *     The nonce to check and to store if not already seen.
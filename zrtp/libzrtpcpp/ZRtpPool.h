@@ -0,0 +1,106 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#ifndef _ZRTPPOOL_H_
+#define _ZRTPPOOL_H_
+
+/**
+ * @file ZRtpPool.h
+ * @brief Pool of pre-constructed ZRTP engines
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <string>
+#include <common/osSpecifics.h>
+
+class ZRtp;
+class ZrtpCallback;
+class ZrtpConfigure;
+
+/**
+ * @brief Pool of pre-constructed ZRtp engines.
+ *
+ * Constructing a ZRtp engine creates the state engine, the random H0 and the
+ * hash chain, and the Hello packets with their HMAC. If the application
+ * enables the pool, a worker thread constructs engines for one ZID, client
+ * id and configuration in the background. getEngine() takes a ready engine
+ * from the pool and the worker thread refills the pool asynchronously. If
+ * the pool is disabled, empty or prepared for different parameters,
+ * getEngine() constructs the engine inline as before.
+ *
+ * Each pooled engine has its own fresh H0, the pool hands out each engine
+ * only once. The caller owns the ZRtp object and deletes it after use.
+ *
+ * The pool is disabled by default. All functions are thread safe.
+ */
+class __EXPORT ZRtpPool {
+public:
+    /**
+     * @brief Set the number of pre-constructed engines and their parameters.
+     *
+     * A size greater than zero enables the pool and starts the worker thread,
+     * zero disables the pool, stops the worker thread and deletes all pooled
+     * engines. If the parameters differ from the previous call the pool deletes
+     * the engines prepared for the previous parameters.
+     *
+     * @param engines
+     *    Number of engines the pool keeps ready.
+     * @param myZid
+     *    The ZID of the engines, required if @c engines is greater than zero.
+     * @param id
+     *    The client id of the engines, see ZRtp::ZRtp().
+     * @param config
+     *    The configuration of the engines, the pool keeps a copy. Required if
+     *    @c engines is greater than zero.
+     * @param mitm
+     *    The engines act as trusted MitM, see ZRtp::ZRtp().
+     */
+    static void setPoolSize(int32_t engines, const uint8_t* myZid = nullptr, const std::string& id = std::string(),
+                            ZrtpConfigure* config = nullptr, bool mitm = false);
+
+    /**
+     * @brief Get a ZRtp engine.
+     *
+     * The parameters are the same as for the ZRtp::ZRtp() constructor. If the
+     * pool has an engine for the same ZID, client id, configuration and MitM
+     * mode the function returns this engine, otherwise it constructs a new
+     * engine.
+     *
+     * @return
+     *    A ZRtp engine that uses @c cb, the caller owns the object.
+     */
+    static ZRtp* getEngine(uint8_t* myZid, ZrtpCallback* cb, const std::string& id, ZrtpConfigure* config,
+                           bool mitm = false, bool sasSignSupport = false);
+
+    /**
+     * @brief Get the number of available pre-constructed engines.
+     *
+     * @return
+     *    number of pooled engines.
+     */
+    static int32_t getAvailable();
+};
+
+/**
+ * @}
+ */
+#endif // _ZRTPPOOL_H_
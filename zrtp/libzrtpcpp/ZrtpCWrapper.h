@@ -215,7 +215,10 @@ typedef enum {
     zrtp_Aes = 1,        /*!< Use AES as symmetrical cipher algorithm */
     zrtp_TwoFish,        /*!< Use TwoFish as symmetrical cipher algorithm */
     zrtp_Sha1,           /*!< Use Sha1 as authentication algorithm */
-    zrtp_Skein           /*!< Use Skein as authentication algorithm */
+    zrtp_Skein,          /*!< Use Skein as authentication algorithm */
+    zrtp_AesGcm,         /*!< Use AES-GCM, the cipher mode authenticates (AEAD) */
+    zrtp_ChaCha20,       /*!< Use ChaCha20 as symmetrical cipher algorithm */
+    zrtp_ChaCha20Poly1305 /*!< Use ChaCha20-Poly1305, the cipher mode authenticates (AEAD) */
 } zrtp_SrtpAlgorithms;
 
 /**
@@ -264,6 +267,12 @@ extern "C"
     typedef struct ZrtpConfigure ZrtpConfigure;
 #endif
 
+    /** Opaque structure that holds the timer entry of a ZrtpContext. */
+    typedef struct zrtpTimer ZrtpTimer;
+
+    /** Opaque structure of a timer wheel that drives the timers of several ZrtpContexts. */
+    typedef struct zrtpTimers ZrtpTimers;
+
     typedef struct zrtpContext
     {
         ZRtp* zrtpEngine;                   /*!< Holds the real ZRTP engine */
@@ -271,6 +280,7 @@ extern "C"
         ZrtpConfigure* configure;           /*!< Optional configuration data */
         ZRtp* zrtpMaster;                   /*!< Holds the master ZRTP stream in case this is a multi-stream */
         void* userData;                     /*!< User data, set by application */
+        ZrtpTimer* timer;                   /*!< Timer entry, used with zrtp_requestTimer */
     } ZrtpContext;
 
     /**
@@ -700,6 +710,32 @@ extern "C"
      */
     void zrtp_processZrtpMessage(ZrtpContext* zrtpContext, uint8_t *extHeader, uint32_t peerSSRC, size_t length);
 
+    /**
+     * Process a sequence of ZRTP messages of the peer.
+     *
+     * Processes the messages under one lock acquisition of the state engine
+     * and drops resent copies of a message, see ZRtp::processZrtpMessages().
+     *
+     * <b>NOTE: An application shall never call this method directly. Only
+     * the module that implements the RTP binding shall use this method</b>
+     *
+     * @param zrtpContext
+     *    Pointer to the opaque ZrtpContext structure.
+     * @param extHeaders
+     *    Pointers to the first byte of the ZRTP message parts.
+     * @param lengths
+     *    Lengths of the received data packets - used to do santity checks.
+     * @param count
+     *    Number of messages.
+     * @param peerSSRC
+     *    The peer's SSRC.
+     *
+     * @return
+     *    Number of messages the state engine processed.
+     */
+    int32_t zrtp_processZrtpMessages(ZrtpContext* zrtpContext, uint8_t* const extHeaders[], const size_t lengths[],
+                                     int32_t count, uint32_t peerSSRC);
+
     /**
      * Process a timeout event.
      *
@@ -714,6 +750,81 @@ extern "C"
      */
     void zrtp_processTimeout(ZrtpContext* zrtpContext);
 
+    /**
+     * Create a timer wheel.
+     *
+     * An application that does not have own timers uses a timer wheel to
+     * drive the timers of its ZrtpContexts. Its @c zrtp_activateTimer and
+     * @c zrtp_cancelTimer callbacks call @c zrtp_requestTimer and
+     * @c zrtp_cancelTimerRequest, its event loop waits at most the time that
+     * @c zrtp_nextTimeout returns and then calls @c zrtp_runTimers. Requesting
+     * and cancelling a timer does not allocate memory after the first request.
+     *
+     * @return
+     *    The new timer wheel.
+     */
+    ZrtpTimers* zrtp_newTimers(void);
+
+    /**
+     * Free a timer wheel.
+     *
+     * Destroy the ZrtpContexts that use the wheel first.
+     *
+     * @param timers
+     *    The timer wheel, may be @c NULL.
+     */
+    void zrtp_freeTimers(ZrtpTimers* timers);
+
+    /**
+     * Request a timeout for a ZrtpContext, a pending timeout of the context is replaced.
+     *
+     * @param timers
+     *    The timer wheel.
+     * @param zrtpContext
+     *    Pointer to the opaque ZrtpContext structure.
+     * @param time
+     *    The timeout in milli-seconds.
+     * @return
+     *    1 if the timer wheel accepted the request, 0 otherwise.
+     */
+    int32_t zrtp_requestTimer(ZrtpTimers* timers, ZrtpContext* zrtpContext, int32_t time);
+
+    /**
+     * Cancel the pending timeout of a ZrtpContext.
+     *
+     * @param timers
+     *    The timer wheel.
+     * @param zrtpContext
+     *    Pointer to the opaque ZrtpContext structure.
+     * @return
+     *    1 if the function succeeded, 0 otherwise.
+     */
+    int32_t zrtp_cancelTimerRequest(ZrtpTimers* timers, ZrtpContext* zrtpContext);
+
+    /**
+     * Get the time until the next timeout of the wheel expires.
+     *
+     * @param timers
+     *    The timer wheel.
+     * @return
+     *    Milli-seconds until the next timeout expires, 0 if a timeout expired
+     *    already, -1 if no timeout is pending.
+     */
+    int32_t zrtp_nextTimeout(ZrtpTimers* timers);
+
+    /**
+     * Process the expired timeouts of the wheel.
+     *
+     * The function calls @c zrtp_processTimeout for each ZrtpContext with an
+     * expired timeout in the caller's thread.
+     *
+     * @param timers
+     *    The timer wheel.
+     * @return
+     *    Number of expired timeouts.
+     */
+    int32_t zrtp_runTimers(ZrtpTimers* timers);
+
     /*
      * Check for and handle GoClear ZRTP packet header.
      *
@@ -1020,6 +1131,26 @@ extern "C"
      */
     int32_t zrtp_setSignatureData(ZrtpContext* zrtpContext, uint8_t* data, int32_t length);
 
+    /**
+     * Complete an asynchronous SAS signature
+     *
+     * With asynchronous SAS signatures the <code>zrtp_signSAS</code> callback
+     * only starts the signature, the application calls this function from any
+     * thread when the signature is ready. A length of zero sends the Confirm
+     * packet without signature, refer to zrtp_setAsyncSasSignature().
+     *
+     * @param zrtpContext
+     *    Pointer to the opaque ZrtpContext structure.
+     * @param data
+     *    The signature data including the signature type block.
+     * @param length
+     *    The length of the signature data in bytes. This length must be
+     *    multiple of 4.
+     * @return
+     *    1 if ZRTP requested a signature and took the data, 0 otherwise.
+     */
+    int32_t zrtp_sasSignatureReady(ZrtpContext* zrtpContext, const uint8_t* data, uint32_t length);
+
     /**
      * Get signature data
      *
@@ -1370,6 +1501,29 @@ extern "C"
      */
     int32_t zrtp_isSasSignature(ZrtpContext* zrtpContext);
 
+    /**
+     * Enables or disables asynchronous SAS signatures.
+     *
+     * For further details refer to ZrtpConfigure::setAsyncSasSignature() and
+     * zrtp_sasSignatureReady().
+     *
+     * @param zrtpContext
+     *    Pointer to the opaque ZrtpContext structure.
+     * @param yesNo
+     *    If true then asynchronous SAS signatures are enabled.
+     */
+    void zrtp_setAsyncSasSignature(ZrtpContext* zrtpContext, int32_t yesNo);
+
+    /**
+     * Check status of asynchronous SAS signatures.
+     *
+     * @param zrtpContext
+     *    Pointer to the opaque ZrtpContext structure.
+     * @return
+     *    Returns true if asynchronous SAS signatures are enabled.
+     */
+    int32_t zrtp_isAsyncSasSignature(ZrtpContext* zrtpContext);
+
 #ifdef __cplusplus
 }
 #ifdef __GNUC__ 
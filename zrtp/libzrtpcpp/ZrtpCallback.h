@@ -56,7 +56,10 @@ typedef enum {
     Aes = 1,        ///< Use AES as symmetrical cipher algorithm
     TwoFish,        ///< Use TwoFish as symmetrical cipher algorithm
     Sha1,           ///< Use Sha1 as authentication algorithm
-    Skein           ///< Use Skein as authentication algorithm
+    Skein,          ///< Use Skein as authentication algorithm
+    AesGcm,         ///< Use AES-GCM, the cipher mode authenticates (AEAD)
+    ChaCha20,       ///< Use ChaCha20 as symmetrical cipher algorithm
+    ChaCha20Poly1305 ///< Use ChaCha20-Poly1305, the cipher mode authenticates (AEAD)
 } SrtpAlgorithms;
 
 /**
@@ -137,6 +140,24 @@ protected:
      */
     virtual int32_t activateTimer(int32_t time) =0;
 
+    /**
+     * Activate timer with slack.
+     *
+     * The timer may expire up to @c slack ms later than @c time. A timeout
+     * provider may expire timers whose slack overlaps with one wakeup.
+     * ZRTP calls this method instead of activateTimer, the default
+     * implementation ignores the slack and calls activateTimer.
+     *
+     * @param time
+     *    The time in ms for the timer
+     * @param slack
+     *    The time in ms the timer may expire later, refer to
+     *    ZrtpConfigure::setTimerSlack
+     * @return
+     *    zero if activation failed, one if timer was activated
+     */
+    virtual int32_t activateTimerSlack(int32_t time, int32_t slack) { return activateTimer(time); }
+
     /**
      * Cancel the active timer.
      *
@@ -309,6 +330,10 @@ protected:
      * enable signature transmission to the other peer. Refer to
      * chapter 8.2 of ZRTP specification.
      *
+     * If ZrtpConfigure::setAsyncSasSignature() is enabled the method only
+     * starts the signature and returns, the client then copies the SAS hash
+     * and calls ZRtp::sasSignatureReady() when the signature is ready.
+     *
      * <b>Note:</b> SAS signing is not yet fully supported by GNU
      * ZRTP.
      *
@@ -331,6 +356,10 @@ protected:
      * this case ZRTP signals an error to the other peer and terminates
      * the ZRTP handshake.
      *
+     * If ZrtpConfigure::setAsyncSasSignature() is enabled the signature data
+     * stays valid after the method returns, thus the client may start the
+     * check and return true, the handshake does not wait for the check.
+     *
      * <b>Note:</b> SAS signing is not yet fully supported by GNU
      * ZRTP.
      *
@@ -341,6 +370,15 @@ protected:
      *
      */
     virtual bool checkSASSignature(uint8_t* sasHash) =0;
+
+    /**
+     * If false ZRTP does not call synchEnter and synchLeave.
+     *
+     * A callback that never runs ZRTP concurrently, for example a single
+     * threaded host, clears it and saves two virtual calls per ZRTP packet
+     * and timeout, see ZrtpCallbackBinding.
+     */
+    bool synchRequired = true;
 };
 
 #endif // ZRTPCALLBACK
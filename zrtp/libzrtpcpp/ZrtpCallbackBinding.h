@@ -0,0 +1,212 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#ifndef _ZRTPCALLBACKBINDING_H_
+#define _ZRTPCALLBACKBINDING_H_
+
+/**
+ * @file ZrtpCallbackBinding.h
+ * @brief Bind a host class with a fixed type to the ZRTP engine
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <mutex>
+
+#include <libzrtpcpp/ZrtpCallback.h>
+
+/**
+ * @brief Lock policy of a single threaded host.
+ *
+ * ZRTP does not call synchEnter and synchLeave of a binding with this lock.
+ */
+class ZrtpNoLock {
+public:
+    void lock() {}
+    void unlock() {}
+};
+
+/**
+ * @brief Tells the binding if its lock policy synchronizes anything.
+ *
+ * Specialize it with @c required false for own lock policies without
+ * any effect.
+ */
+template <class Lock>
+struct ZrtpLockTraits {
+    static const bool required = true;
+};
+
+template <>
+struct ZrtpLockTraits<ZrtpNoLock> {
+    static const bool required = false;
+};
+
+/**
+ * @brief Static binding of a host class to the ZRTP callback interface.
+ *
+ * The ZRTP engine calls the host through the virtual functions of
+ * ZrtpCallback. A host that implements ZrtpCallback itself often
+ * forwards the calls once more, for example ZrtpCallbackWrapper forwards
+ * them to C function pointers. The binding instead implements the
+ * virtual functions with calls of the non-virtual functions of the host
+ * class, thus the compiler inlines the host's send, timer and information
+ * functions into the one virtual call the engine makes.
+ *
+ * The host class does not derive from ZrtpCallback and implements the
+ * functions of ZrtpCallback with the same names and signatures, except
+ * @c synchEnter and @c synchLeave. @c activateTimerSlack is optional, the
+ * binding calls @c activateTimer if the host does not implement it.
+ *
+ * The binding implements @c synchEnter and @c synchLeave with the lock
+ * policy @c Lock, any class with @c lock and @c unlock functions. With
+ * ZrtpNoLock the engine does not call them at all, see
+ * ZrtpCallback::synchRequired, and computes the DH key agreement in the
+ * calling thread even if ZrtpConfigure enables the asynchronous key
+ * agreement.
+ *
+ * @code
+ * class MyStream {
+ * public:
+ *     int32_t sendDataZRTP(const uint8_t* data, int32_t length);
+ *     int32_t activateTimer(int32_t time);
+ *     ...
+ * };
+ *
+ * MyStream stream;
+ * ZrtpCallbackBinding<MyStream, ZrtpNoLock> binding(stream);
+ * ZRtp engine(zid, &binding, "my client", config);
+ * @endcode
+ */
+template <class Host, class Lock = std::recursive_mutex>
+class ZrtpCallbackBinding final : public ZrtpCallback {
+public:
+    /**
+     * @brief Bind a host to the ZRTP engine.
+     *
+     * @param host
+     *    The host, it must live longer than the ZRTP engine that uses the
+     *    binding.
+     */
+    explicit ZrtpCallbackBinding(Host& host): host(host) {
+        synchRequired = ZrtpLockTraits<Lock>::required;
+    }
+
+    /**
+     * @brief Get the host of the binding.
+     */
+    Host& getHost() { return host; }
+
+    /**
+     * @brief Get the lock that synchronizes the ZRTP engine.
+     *
+     * The host may use it to synchronize own calls of the engine.
+     */
+    Lock& getLock() { return synchLock; }
+
+protected:
+    int32_t sendDataZRTP(const uint8_t* data, int32_t length) override {
+        return host.sendDataZRTP(data, length);
+    }
+
+    int32_t activateTimer(int32_t time) override {
+        return host.activateTimer(time);
+    }
+
+    int32_t activateTimerSlack(int32_t time, int32_t slack) override {
+        return timerSlack(host, time, slack, 0);
+    }
+
+    int32_t cancelTimer() override {
+        return host.cancelTimer();
+    }
+
+    void sendInfo(GnuZrtpCodes::MessageSeverity severity, int32_t subCode) override {
+        host.sendInfo(severity, subCode);
+    }
+
+    bool srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part) override {
+        return host.srtpSecretsReady(secrets, part);
+    }
+
+    void srtpSecretsOff(EnableSecurity part) override {
+        host.srtpSecretsOff(part);
+    }
+
+    void srtpSecretsOn(std::string c, std::string s, bool verified) override {
+        host.srtpSecretsOn(c, s, verified);
+    }
+
+    void handleGoClear() override {
+        host.handleGoClear();
+    }
+
+    void zrtpNegotiationFailed(GnuZrtpCodes::MessageSeverity severity, int32_t subCode) override {
+        host.zrtpNegotiationFailed(severity, subCode);
+    }
+
+    void zrtpNotSuppOther() override {
+        host.zrtpNotSuppOther();
+    }
+
+    void synchEnter() override {
+        synchLock.lock();
+    }
+
+    void synchLeave() override {
+        synchLock.unlock();
+    }
+
+    void zrtpAskEnrollment(GnuZrtpCodes::InfoEnrollment info) override {
+        host.zrtpAskEnrollment(info);
+    }
+
+    void zrtpInformEnrollment(GnuZrtpCodes::InfoEnrollment info) override {
+        host.zrtpInformEnrollment(info);
+    }
+
+    void signSAS(uint8_t* sasHash) override {
+        host.signSAS(sasHash);
+    }
+
+    bool checkSASSignature(uint8_t* sasHash) override {
+        return host.checkSASSignature(sasHash);
+    }
+
+private:
+    // Use the host's activateTimerSlack if it has one, activateTimer otherwise
+    template <class H>
+    static auto timerSlack(H& h, int32_t time, int32_t slack, int) -> decltype(h.activateTimerSlack(time, slack)) {
+        return h.activateTimerSlack(time, slack);
+    }
+
+    template <class H>
+    static int32_t timerSlack(H& h, int32_t time, int32_t, long) {
+        return h.activateTimer(time);
+    }
+
+    Host& host;
+    Lock synchLock;
+};
+
+/**
+ * @}
+ */
+#endif // _ZRTPCALLBACKBINDING_H_
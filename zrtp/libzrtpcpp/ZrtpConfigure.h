@@ -37,6 +37,8 @@
 
 #include <libzrtpcpp/ZrtpCallback.h>
 
+class ZrtpTrace;
+
 /**
  * This enumerations list all configurable algorithm types.
  */
@@ -66,12 +68,14 @@ public:
      * @param type
      *    Defines the algorithm type
      * @param name
-     *    Set the names of the algorithm. The name is copied
-     *    and the call may reuse the space.
+     *    Set the names of the algorithm. The function copies the first
+     *    4 characters of the name and the call may reuse the space.
      * @param klen
      *    The key length for this algorihm in byte, for example 16 or 32
      * @param ra
-     *    A human readable short string that describes the algorihm.
+     *    A human readable short string that describes the algorihm. The
+     *    function does not copy this string, it must stay valid for the
+     *    life time of the object.
      * @param en
      *    Pointer to the encryption function of this algorithn
      * @param de
@@ -86,9 +90,22 @@ public:
                   const char* ra, encrypt_t en, decrypt_t de, SrtpAlgorithms alId);
 
     /**
-     * AlgorithmEnum destructor
+     * Create a constant AlgorithmEnum object.
+     *
+     * The enumerations use this constructor to build their constant tables
+     * at compile time.
+     *
+     * @param ord
+     *    The ordinal of the algorithm, its position in the table.
+     * @param name
+     *    The 4 character name as string literal.
+     *
+     * The other parameters are the same as above.
      */
-    ~AlgorithmEnum();
+    constexpr AlgorithmEnum(int32_t ord, AlgoTypes type, const char (&name)[5], uint32_t klen,
+                            const char* ra, encrypt_t en, decrypt_t de, SrtpAlgorithms alId):
+        ordinal(ord), algoType(type), tag(nameTag(name)), algoName{name[0], name[1], name[2], name[3], '\0'},
+        keyLen(klen), readable(ra), encrypt(en), decrypt(de), algoId(alId) {}
 
     /**
      * Get the algorihm's name
@@ -157,11 +174,34 @@ public:
      */
     bool isValid();
 
+    /**
+     * Get the ordinal of the algorithm in its enumeration.
+     *
+     * @return
+     *    the ordinal, -1 for the invalid algorithm.
+     */
+    int32_t getOrdinal()    { return ordinal; }
+
 private:
+    friend class EnumBase;
+
+    /*
+     * The 4 character name as 32 bit word, the first character is the most
+     * significant byte.
+     */
+    static constexpr uint32_t nameTag(const char (&name)[5]) {
+        return static_cast<uint32_t>(static_cast<uint8_t>(name[0])) << 24 |
+               static_cast<uint32_t>(static_cast<uint8_t>(name[1])) << 16 |
+               static_cast<uint32_t>(static_cast<uint8_t>(name[2])) << 8  |
+               static_cast<uint32_t>(static_cast<uint8_t>(name[3]));
+    }
+
+    int32_t ordinal;
     AlgoTypes algoType;
-    std::string algoName;
+    uint32_t tag;
+    char algoName[5];
     uint32_t   keyLen;
-    std::string readable;
+    const char* readable;
     encrypt_t encrypt;
     decrypt_t decrypt;
     SrtpAlgorithms   algoId;
@@ -174,6 +214,10 @@ private:
  * An application shall use the get / check methods to retrieve information
  * from the preset Algorithm Enumerations.
  *
+ * The enumerations are constant tables that the compiler builds, the global
+ * enumerations need no initialization when the library loads. The lookup
+ * functions compare the 4 character names as 32 bit words.
+ *
  * @see AlgoTypes
  * @see zrtpHashes
  * @see zrtpSymCiphers
@@ -241,16 +285,40 @@ public:
      */
     int getOrdinal(AlgorithmEnum& algo);
 
+    /**
+     * Get the ordinal of an algorithm name.
+     *
+     * The enumeration stores the 4 character names as 32 bit words, the lookup
+     * does not compare strings.
+     *
+     * @param name
+     *    Pointer to the 4 character algorithm name, for example in a Hello packet.
+     * @return
+     *    the ordinal, -1 if the name is unknown.
+     */
+    int getOrdinal(const uint8_t* name);
+
 protected:
-    EnumBase(AlgoTypes algo);
-    ~EnumBase();
-    void insert(const char* name);
-    void insert(const char* name, uint32_t klen,
-                const char* ra, encrypt_t en, decrypt_t de, SrtpAlgorithms alId);
+    constexpr EnumBase(AlgoTypes algo, const AlgorithmEnum* table, int32_t size):
+        algoType(algo), algos(table), numAlgos(size) {}
+
+    /*
+     * Check at compile time that the ordinals of a table match the positions
+     * and that the table contains no duplicate names.
+     */
+    static constexpr bool isValidTable(const AlgorithmEnum* table, int32_t size, int32_t i = 0) {
+        return i >= size || (table[i].ordinal == i && table[i].tag != 0 &&
+                             !containsTag(table, i, table[i].tag) && isValidTable(table, size, i + 1));
+    }
+
+    static constexpr bool containsTag(const AlgorithmEnum* table, int32_t size, uint32_t tag) {
+        return size > 0 && (table[size - 1].tag == tag || containsTag(table, size - 1, tag));
+    }
 
 private:
     AlgoTypes algoType;
-    std::vector <AlgorithmEnum* > algos;
+    const AlgorithmEnum* algos;         ///< the constant table of the algorithms
+    int32_t numAlgos;
 };
 
 /**
@@ -258,32 +326,27 @@ private:
  */
 class __EXPORT HashEnum : public EnumBase {
 public:
-    HashEnum();
-    ~HashEnum();
+    constexpr HashEnum();
 };
 
 class __EXPORT SymCipherEnum : public EnumBase {
 public:
-    SymCipherEnum();
-    ~SymCipherEnum();
+    constexpr SymCipherEnum();
 };
 
 class __EXPORT PubKeyEnum : public EnumBase {
 public:
-    PubKeyEnum();
-    ~PubKeyEnum();
+    constexpr PubKeyEnum();
 };
 
 class __EXPORT SasTypeEnum : public EnumBase {
 public:
-    SasTypeEnum();
-    ~SasTypeEnum();
+    constexpr SasTypeEnum();
 };
 
 class __EXPORT AuthLengthEnum : public EnumBase {
 public:
-    AuthLengthEnum();
-    ~AuthLengthEnum();
+    constexpr AuthLengthEnum();
 };
 
 extern __EXPORT HashEnum zrtpHashes;
@@ -307,18 +370,34 @@ extern __EXPORT AuthLengthEnum zrtpAuthLengths;
  * in its Hello message and uses mandatory algorithms only.
  *
  * An application can configure implemented algorithms only.
+ *
+ * ZRTP copies the configuration for each session. An application that
+ * uses the same configuration for many sessions calls @c freeze after it
+ * set the algorithms. A frozen configuration holds the algorithms in an
+ * immutable, reference counted profile and its copies share this profile,
+ * thus a copy does not allocate or copy the algorithm lists.
  */
 class __EXPORT ZrtpConfigure {
 public:
     ZrtpConfigure();         /* Creates Configuration data */
+    ZrtpConfigure(const ZrtpConfigure& other);
+    ZrtpConfigure& operator=(const ZrtpConfigure& other);
     ~ZrtpConfigure();
 
     /**
      * Define the algorithm selection policies.
+     *
+     * @c PreferLowCost selects the hash, the symmetric cipher and the public
+     * key algorithm with the lowest estimated cost on the local CPU among the
+     * algorithms that both parties support, see getAlgoCost(). The policy
+     * does not select an algorithm weaker than the minimum security level,
+     * see setMinimumSecurity(). If no common algorithm reaches this level
+     * the engine selects as with the @c Standard policy.
      */
     typedef enum _policies {
         Standard = 1,
-        PreferNonNist = 2
+        PreferNonNist = 2,
+        PreferLowCost = 3
     } Policy;
 
     /**
@@ -457,6 +536,43 @@ public:
      */
     bool containsAlgo(AlgoTypes algoType, AlgorithmEnum& algo);
 
+    /**
+     * Get a fingerprint of the configured algorithms.
+     *
+     * Configurations with the same algorithms in the same order have the
+     * same fingerprint. ZRTP uses the fingerprint to share Hello packet
+     * templates between sessions. The function computes the fingerprint only
+     * once and recomputes it after the application changed the algorithms.
+     *
+     * @return
+     *    The fingerprint, never 0.
+     */
+    uint64_t getFingerprint();
+
+    /**
+     * Freeze the configured algorithms.
+     *
+     * The function compiles the algorithm lists into an immutable profile.
+     * Afterwards the functions that change the algorithms (@c addAlgo,
+     * @c addAlgoAt, @c removeAlgo, @c clear, @c setStandardConfig,
+     * @c setMandatoryOnly) do not change the configuration and @c addAlgo,
+     * @c addAlgoAt and @c removeAlgo return -1. The flags, for example
+     * @c setParanoidMode, remain settable for each copy.
+     *
+     * Copies of a frozen configuration share the profile, the function
+     * is not thread safe but the copies of a frozen configuration may be
+     * used concurrently.
+     */
+    void freeze();
+
+    /**
+     * Check if the algorithms are frozen, see @c freeze.
+     *
+     * @return
+     *    True if the configuration is frozen.
+     */
+    bool isFrozen()                     { return profile != NULL; }
+
     /**
      * Enables or disables trusted MitM processing.
      *
@@ -532,12 +648,263 @@ public:
      */
     bool isDisclosureFlag();
 
+    /**
+     * Enables or disables asynchronous key agreement.
+     *
+     * If enabled the ZRTP state engine does not compute the DH shared secret in
+     * the thread that processes the DHPart1 or DHPart2 packet. ZRtp hands the
+     * computation to the worker thread of ZrtpDHWorker and resumes the protocol
+     * when the shared secret is ready. The worker thread then runs the rest of
+     * the protocol step, thus it calls the ZrtpCallback methods, for example
+     * <code>sendDataZRTP</code>, while holding the <code>synchEnter</code> lock.
+     *
+     * Asynchronous key agreement is disabled by default.
+     *
+     * @param yesNo
+     *    If set to true then asynchronous key agreement is enabled.
+     */
+    void setAsyncKeyAgreement(bool yesNo);
+
+    /**
+     * Check status of asynchronous key agreement.
+     *
+     * @return
+     *    Returns true if asynchronous key agreement is enabled.
+     */
+    bool isAsyncKeyAgreement();
+
+    /**
+     * Enables or disables asynchronous SAS signatures.
+     *
+     * If enabled the <code>signSAS</code> callback only starts the signature
+     * and returns, it must not block. The application completes the signature
+     * later with ZRtp::sasSignatureReady(), from any thread. If the Confirm
+     * packet that carries the signature is due before the signature is
+     * ready, the state engine waits and sends the Confirm packet when ZRtp
+     * receives the signature. The state engine does not wait for the
+     * <code>checkSASSignature</code> callback, ZRtp keeps a copy of the
+     * peer's signature data, thus the application may check the signature
+     * after the callback returned.
+     *
+     * With asynchronous SAS signatures ZRtp does not use Preshared mode if
+     * the peer requests SAS signatures, the Commit uses DH mode instead.
+     *
+     * Asynchronous SAS signatures are disabled by default.
+     *
+     * @param yesNo
+     *    If set to true then asynchronous SAS signatures are enabled.
+     */
+    void setAsyncSasSignature(bool yesNo);
+
+    /**
+     * Check status of asynchronous SAS signatures.
+     *
+     * @return
+     *    Returns true if asynchronous SAS signatures are enabled.
+     */
+    bool isAsyncSasSignature();
+
+    /**
+     * Enables or disables the asynchronous ZID cache.
+     *
+     * If enabled ZRtp reads the peer's ZID record in the worker thread of
+     * ZIDCacheAsync as soon as it receives the peer's Hello, and it saves the
+     * ZID record in the worker thread. The application must use a thread safe
+     * ZID cache, refer to ZIDCacheAsync.
+     *
+     * The asynchronous ZID cache is disabled by default.
+     *
+     * @param yesNo
+     *    If set to true then the asynchronous ZID cache is enabled.
+     */
+    void setAsyncZidCache(bool yesNo);
+
+    /**
+     * Check status of the asynchronous ZID cache.
+     *
+     * @return
+     *    Returns true if the asynchronous ZID cache is enabled.
+     */
+    bool isAsyncZidCache();
+
+    /**
+     * Enables or disables speculative key generation.
+     *
+     * If enabled ZRtp generates the DH key pair for its preferred public key
+     * algorithm in the worker thread of ZrtpDHWorker as soon as it starts the
+     * protocol engine, see ZRtp::startSpeculativeKeyGeneration(). The key pair
+     * generation overlaps with the Hello/HelloAck discovery, the Commit or
+     * DHPart1 does not wait for the full key generation if the peer negotiates
+     * this algorithm.
+     *
+     * Speculative key generation is disabled by default.
+     *
+     * @param yesNo
+     *    If set to true then speculative key generation is enabled.
+     */
+    void setSpeculativeKeyGeneration(bool yesNo);
+
+    /**
+     * Check status of speculative key generation.
+     *
+     * @return
+     *    Returns true if speculative key generation is enabled.
+     */
+    bool isSpeculativeKeyGeneration();
+
+    /**
+     * Enables or disables the fast start.
+     *
+     * RFC 6189, chapter 4.1, allows to send a Commit instead of the HelloAck
+     * that acknowledges the peer's Hello if the peer already acknowledged our
+     * Hello. The Commit acts as an implicit HelloAck and the discovery needs
+     * one round trip less. If both peers send a Commit the usual Commit
+     * contention rules apply.
+     *
+     * The fast start is disabled by default.
+     *
+     * @param yesNo
+     *    If set to true then ZRTP sends the Commit as implicit HelloAck.
+     */
+    void setFastStart(bool yesNo);
+
+    /**
+     * Check status of the fast start.
+     *
+     * @return
+     *    Returns true if the fast start is enabled.
+     */
+    bool isFastStart();
+
+    /**
+     * Set the number of consecutive Preshared key agreements.
+     *
+     * If the public key algorithms contain @c Prsh then ZRtp offers Preshared
+     * mode (RFC 6189, chapter 4.4.2) and uses it with a peer that offers it
+     * too and that shares a valid retained secret with us. Preshared mode skips
+     * the DH key agreement. After @c limit consecutive Preshared key agreements
+     * with the same peer ZRtp performs a DH key agreement again, this restores
+     * forward secrecy. The ZID record of the peer counts the Preshared key
+     * agreements.
+     *
+     * The default limit is 8.
+     *
+     * @param limit
+     *    The number of consecutive Preshared key agreements, 0 disables
+     *    Preshared mode.
+     */
+    void setPresharedLimit(uint32_t limit);
+
+    /**
+     * Get the number of consecutive Preshared key agreements.
+     *
+     * @return
+     *    The number of consecutive Preshared key agreements.
+     */
+    uint32_t getPresharedLimit();
+
+    /**
+     * Set the slack of the ZRTP timers.
+     *
+     * The retransmission timers of ZRtp may expire up to @c percent percent
+     * of their time later. The timeout provider of the client may expire
+     * timers of several streams whose slack overlaps with one wakeup, this
+     * saves power on mobile devices, refer to ZrtpCallback::activateTimerSlack.
+     *
+     * The default slack is 0, the timers expire at their time.
+     *
+     * @param percent
+     *    The slack in percent of the timer's time.
+     */
+    void setTimerSlack(uint32_t percent);
+
+    /**
+     * Get the slack of the ZRTP timers.
+     *
+     * @return
+     *    The slack in percent of the timer's time.
+     */
+    uint32_t getTimerSlack();
+
+    /**
+     * Set the trace of the ZRtp engines.
+     *
+     * A ZRtp engine created with this configuration reports its messages,
+     * timer events, random data and ZID cache records to the trace, refer to
+     * ZrtpTrace. A trace belongs to one engine only, thus an application uses
+     * a copy of the configuration for each traced engine. A traced engine
+     * runs the key agreement synchronously, does not use the asynchronous
+     * ZID cache and does not use pre-generated key pairs or pooled engines.
+     *
+     * The configuration does not own the trace. No trace is set by default.
+     *
+     * @param trace
+     *    The trace or @c NULL to disable tracing.
+     */
+    void setTrace(ZrtpTrace* trace)     {this->trace = trace;}
+
+    /**
+     * Get the trace of the ZRtp engines.
+     *
+     * @return
+     *    The trace or @c NULL if tracing is disabled.
+     */
+    ZrtpTrace* getTrace()               {return trace;}
+
     /// Helper function to print some internal data
     void printConfiguredAlgos(AlgoTypes algoTyp);
 
     Policy getSelectionPolicy()         {return selectionPolicy;}
     void setSelectionPolicy(Policy pol) {selectionPolicy = pol;}
 
+    /**
+     * Set the minimum security level of the @c PreferLowCost policy.
+     *
+     * The policy takes only algorithms whose security strength, see
+     * getAlgoStrength(), is at least this level. The default level is 128
+     * bits, thus the policy does not select DH-2048.
+     *
+     * @param bits
+     *    The minimum security strength in bits.
+     */
+    void setMinimumSecurity(int32_t bits) {minimumSecurity = bits;}
+
+    /**
+     * Get the minimum security level of the @c PreferLowCost policy.
+     */
+    int32_t getMinimumSecurity()        {return minimumSecurity;}
+
+    /**
+     * Get the estimated cost of an algorithm on the local CPU.
+     *
+     * The cost is a relative number, smaller is cheaper. It compares
+     * algorithms of the same type only: the time of a key agreement for the
+     * public key algorithms, the time per byte for the hashes and the
+     * ciphers. The estimate considers the CPU features that the crypto
+     * functions use, refer to zrtpCpuFeatures(), thus AES is cheaper than
+     * Twofish if the CPU has AES instructions and SHA-256 is cheaper than
+     * Skein if the CPU has SHA instructions.
+     *
+     * @param algo
+     *    The algorithm.
+     * @return
+     *    The cost, 0 for the other algorithm types and unknown algorithms.
+     */
+    static int32_t getAlgoCost(AlgorithmEnum& algo);
+
+    /**
+     * Get the security strength of an algorithm in bits.
+     *
+     * Refer to NIST SP 800-57 for the strength of the public key algorithms
+     * and hashes.
+     *
+     * @param algo
+     *    The algorithm.
+     * @return
+     *    The strength, 0 for the other algorithm types and unknown algorithms.
+     */
+    static int32_t getAlgoStrength(AlgorithmEnum& algo);
+
   private:
     std::vector<AlgorithmEnum* > hashes;
     std::vector<AlgorithmEnum* > symCiphers;
@@ -549,6 +916,19 @@ public:
     bool enableSasSignature;
     bool enableParanoidMode;
     bool enableDisclosureFlag;
+    bool enableAsyncKeyAgreement;
+    bool enableAsyncSasSignature;
+    bool enableAsyncZidCache;
+    bool enableSpeculativeKeyGen;
+    bool enableFastStart;
+    uint32_t presharedLimit;
+    uint32_t timerSlack;
+    ZrtpTrace* trace;
+
+    uint64_t fingerprint;   ///< fingerprint of configured algorithms, 0 if not computed
+
+    class Profile;
+    Profile* profile;       ///< the frozen algorithms, NULL if the configuration is not frozen
 
 
     AlgorithmEnum& getAlgoAt(std::vector<AlgorithmEnum* >& a, int32_t index);
@@ -562,6 +942,7 @@ public:
     void printConfiguredAlgos(std::vector<AlgorithmEnum* >& a);
 
     Policy selectionPolicy;
+    int32_t minimumSecurity;
 
   protected:
 
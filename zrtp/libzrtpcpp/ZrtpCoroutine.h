@@ -0,0 +1,794 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPCOROUTINE_H_
+#define _ZRTPCOROUTINE_H_
+
+/**
+ * @file ZrtpCoroutine.h
+ * @brief C++20 coroutine interface of the ZRTP engine
+ * @ingroup GNU_ZRTP
+ * @{
+ *
+ * The library itself uses C++11, this header is an optional interface for
+ * applications that use C++20 coroutines. It implements the ZrtpCallback on
+ * top of an executor and provides awaitable operations, thus a coroutine
+ * starts a handshake and waits for its result without blocking a thread:
+ *
+ @verbatim
+ ZrtpTask<> call(MySession* session) {
+     session->start();
+     ZrtpSecureResult result = co_await session->secure();
+     if (result.secure)
+         showSas(result.sas);
+ }
+ ...
+ ZrtpLoopExecutor executor(4);
+ MySession session(executor, config, zid);    // derived from ZrtpCoroutineSession
+ call(&session).start();
+ @endverbatim
+ *
+ * The engine runs its key agreement and its ZID cache access in worker
+ * threads if the configuration enables them, see
+ * ZrtpConfigure::setAsyncKeyAgreement() and ZrtpConfigure::setAsyncZidCache(),
+ * thus a few executor threads drive many concurrent handshakes. The header
+ * is header only, it needs no additional library code.
+ */
+
+#if !(defined(__cpp_impl_coroutine) && __has_include(<coroutine>))
+#error "ZrtpCoroutine.h requires a C++20 compiler with coroutine support"
+#endif
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <libzrtpcpp/ZRtp.h>
+#include <libzrtpcpp/ZrtpCallback.h>
+#include <libzrtpcpp/ZrtpConfigure.h>
+#include <libzrtpcpp/ZrtpDHPool.h>
+#include <libzrtpcpp/ZIDCacheAsync.h>
+#include <libzrtpcpp/ZIDRecord.h>
+
+/**
+ * @brief Executor hook of the coroutine interface.
+ *
+ * The coroutine sessions run all engine calls and resume the awaiting
+ * coroutines through an executor. An application that has an event loop
+ * implements this interface on top of its loop, otherwise it uses
+ * ZrtpLoopExecutor. All functions must be thread safe, the tasks must not run
+ * inside the calling function.
+ */
+class ZrtpExecutor {
+public:
+    virtual ~ZrtpExecutor() {}
+
+    /**
+     * @brief Run a task as soon as possible.
+     */
+    virtual void post(std::function<void()> task) =0;
+
+    /**
+     * @brief Run a task after a delay.
+     *
+     * @param delayMs
+     *    The delay in milli-seconds.
+     * @param task
+     *    The task to run.
+     * @return
+     *    An identifier of the task for cancel(), not zero.
+     */
+    virtual uint64_t postDelayed(int32_t delayMs, std::function<void()> task) =0;
+
+    /**
+     * @brief Cancel a delayed task that did not yet start.
+     *
+     * @param id
+     *    The identifier that postDelayed() returned, unknown identifiers are
+     *    ignored.
+     */
+    virtual void cancel(uint64_t id) =0;
+};
+
+/**
+ * @brief An executor with its own threads.
+ *
+ * The threads run the posted tasks in order and the delayed tasks at their
+ * deadlines. The destructor stops the threads and drops the tasks that did
+ * not yet start, thus the application stops its sessions before.
+ */
+class ZrtpLoopExecutor : public ZrtpExecutor {
+    typedef std::chrono::steady_clock Clock;
+
+public:
+    /**
+     * @brief Create the executor and start its threads.
+     *
+     * @param threads
+     *    Number of threads, at least one.
+     */
+    explicit ZrtpLoopExecutor(int32_t threads = 1): nextId(1), stopped(false) {
+        for (int32_t i = 0; i < (threads > 0 ? threads : 1); i++)
+            workers.push_back(std::thread(&ZrtpLoopExecutor::run, this));
+    }
+
+    ~ZrtpLoopExecutor() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopped = true;
+        }
+        wakeup.notify_all();
+        for (size_t i = 0; i < workers.size(); i++)
+            workers[i].join();
+    }
+
+    void post(std::function<void()> task) override {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            ready.push_back(std::move(task));
+        }
+        wakeup.notify_one();
+    }
+
+    uint64_t postDelayed(int32_t delayMs, std::function<void()> task) override {
+        Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(delayMs > 0 ? delayMs : 0);
+        uint64_t id;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            id = nextId++;
+            timers[id] = Timer{deadline, std::move(task)};
+            deadlines.insert(std::make_pair(deadline, id));
+        }
+        wakeup.notify_one();
+        return id;
+    }
+
+    void cancel(uint64_t id) override {
+        std::lock_guard<std::mutex> guard(lock);
+
+        auto found = timers.find(id);
+        if (found == timers.end())
+            return;
+        deadlines.erase(std::make_pair(found->second.deadline, id));
+        timers.erase(found);
+    }
+
+private:
+    struct Timer {
+        Clock::time_point deadline;
+        std::function<void()> task;
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> guard(lock);
+
+        while (!stopped) {
+            // Move the expired timers to the ready tasks
+            Clock::time_point now = Clock::now();
+            while (!deadlines.empty() && deadlines.begin()->first <= now) {
+                uint64_t id = deadlines.begin()->second;
+                deadlines.erase(deadlines.begin());
+                auto found = timers.find(id);
+                ready.push_back(std::move(found->second.task));
+                timers.erase(found);
+            }
+            if (!ready.empty()) {
+                std::function<void()> task = std::move(ready.front());
+                ready.pop_front();
+                guard.unlock();
+                task();
+                guard.lock();
+                continue;
+            }
+            if (deadlines.empty()) {
+                wakeup.wait(guard);
+            }
+            else {
+                // Another thread may remove the timer while this thread waits
+                Clock::time_point next = deadlines.begin()->first;
+                wakeup.wait_until(guard, next);
+            }
+        }
+    }
+
+    std::mutex lock;
+    std::condition_variable wakeup;
+    std::deque<std::function<void()> > ready;
+    std::map<uint64_t, Timer> timers;
+    std::set<std::pair<Clock::time_point, uint64_t> > deadlines;
+    std::vector<std::thread> workers;
+    uint64_t nextId;
+    bool stopped;
+};
+
+template <typename T> class ZrtpTaskPromise;
+
+/**
+ * @brief Common part of the promises of ZrtpTask.
+ */
+class ZrtpTaskPromiseBase {
+public:
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept {
+            ZrtpTaskPromiseBase& promise = handle.promise();
+            if (promise.detached) {
+                // Nobody reads the result of a started task, do not hide its exception
+                if (promise.exception)
+                    std::terminate();
+                handle.destroy();
+                return std::noop_coroutine();
+            }
+            return promise.continuation ? promise.continuation : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return std::suspend_always(); }
+
+    FinalAwaiter final_suspend() noexcept { return FinalAwaiter(); }
+
+    void unhandled_exception() { exception = std::current_exception(); }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+    bool detached = false;
+};
+
+/**
+ * @brief A coroutine that returns a value of type @c T.
+ *
+ * The task starts when a coroutine awaits it or when the application calls
+ * start(). The awaiting coroutine resumes in the thread that completes the
+ * task and gets the value or the exception of the task.
+ */
+template <typename T = void>
+class ZrtpTask {
+public:
+    typedef ZrtpTaskPromise<T> promise_type;
+
+    explicit ZrtpTask(std::coroutine_handle<promise_type> handle): handle(handle) {}
+
+    ZrtpTask(ZrtpTask&& other) noexcept: handle(other.handle) { other.handle = nullptr; }
+
+    ZrtpTask& operator=(ZrtpTask&& other) noexcept {
+        if (this != &other) {
+            if (handle)
+                handle.destroy();
+            handle = other.handle;
+            other.handle = nullptr;
+        }
+        return *this;
+    }
+
+    ZrtpTask(const ZrtpTask&) = delete;
+    ZrtpTask& operator=(const ZrtpTask&) = delete;
+
+    ~ZrtpTask() {
+        if (handle)
+            handle.destroy();
+    }
+
+    /**
+     * @brief Start the task without awaiting it.
+     *
+     * The task runs in the calling thread until it suspends the first time
+     * and deletes itself when it finishes.
+     */
+    void start() {
+        std::coroutine_handle<promise_type> started = handle;
+        handle = nullptr;
+        started.promise().detached = true;
+        started.resume();
+    }
+
+    bool await_ready() const noexcept { return !handle || handle.done(); }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    T await_resume() { return handle.promise().result(); }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+template <typename T>
+class ZrtpTaskPromise : public ZrtpTaskPromiseBase {
+public:
+    ZrtpTask<T> get_return_object() {
+        return ZrtpTask<T>(std::coroutine_handle<ZrtpTaskPromise<T> >::from_promise(*this));
+    }
+
+    void return_value(T result) { value.emplace(std::move(result)); }
+
+    T result() {
+        if (exception)
+            std::rethrow_exception(exception);
+        return std::move(*value);
+    }
+
+private:
+    std::optional<T> value;
+};
+
+template <>
+class ZrtpTaskPromise<void> : public ZrtpTaskPromiseBase {
+public:
+    ZrtpTask<void> get_return_object() {
+        return ZrtpTask<void>(std::coroutine_handle<ZrtpTaskPromise<void> >::from_promise(*this));
+    }
+
+    void return_void() {}
+
+    void result() {
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+};
+
+/**
+ * @brief Awaitable that continues the coroutine in an executor thread.
+ */
+class ZrtpResumeOn {
+public:
+    explicit ZrtpResumeOn(ZrtpExecutor& executor): executor(executor) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> awaiting) {
+        executor.post([awaiting]() { awaiting.resume(); });
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    ZrtpExecutor& executor;
+};
+
+/**
+ * @brief Awaitable timer, the coroutine continues after a delay.
+ */
+class ZrtpSleep {
+public:
+    ZrtpSleep(ZrtpExecutor& executor, int32_t delayMs): executor(executor), delayMs(delayMs) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> awaiting) {
+        executor.postDelayed(delayMs, [awaiting]() { awaiting.resume(); });
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    ZrtpExecutor& executor;
+    int32_t delayMs;
+};
+
+/**
+ * @brief Awaitable that runs a function in the key agreement worker.
+ *
+ * The worker thread of ZrtpDHWorker runs the function, for example a DH or a
+ * signature computation of the application, and the coroutine continues in
+ * an executor thread with the result of the function.
+ */
+template <typename F>
+class ZrtpWorkerCall {
+    typedef typename std::invoke_result<F>::type Result;
+    typedef typename std::conditional<std::is_void<Result>::value, char, Result>::type Storage;
+
+public:
+    ZrtpWorkerCall(ZrtpExecutor& executor, F function): executor(executor), function(std::move(function)) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> awaiting) {
+        ZrtpDHWorker::submit([this, awaiting]() {
+            try {
+                if constexpr (std::is_void<Result>::value)
+                    function();
+                else
+                    result.emplace(function());
+            }
+            catch (...) {
+                exception = std::current_exception();
+            }
+            executor.post([awaiting]() { awaiting.resume(); });
+        });
+    }
+
+    Result await_resume() {
+        if (exception)
+            std::rethrow_exception(exception);
+        if constexpr (!std::is_void<Result>::value)
+            return std::move(*result);
+    }
+
+private:
+    ZrtpExecutor& executor;
+    F function;
+    std::optional<Storage> result;
+    std::exception_ptr exception;
+};
+
+/**
+ * @brief Run a function in the key agreement worker, see ZrtpWorkerCall.
+ */
+template <typename F>
+ZrtpWorkerCall<F> zrtpRunInWorker(ZrtpExecutor& executor, F function) {
+    return ZrtpWorkerCall<F>(executor, std::move(function));
+}
+
+/**
+ * @brief Awaitable that reads a ZID record in the worker of ZIDCacheAsync.
+ *
+ * The coroutine continues in an executor thread and owns the record.
+ */
+class ZrtpCacheRead {
+public:
+    ZrtpCacheRead(ZrtpExecutor& executor, const uint8_t* zid): executor(executor) {
+        memcpy(this->zid, zid, IDENTIFIER_LEN);
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> awaiting) {
+        ZIDCacheAsync::getRecordAsync(zid, [this, awaiting](ZIDRecord* read) {
+            record.reset(read);
+            executor.post([awaiting]() { awaiting.resume(); });
+        });
+    }
+
+    std::unique_ptr<ZIDRecord> await_resume() { return std::move(record); }
+
+private:
+    ZrtpExecutor& executor;
+    uint8_t zid[IDENTIFIER_LEN];
+    std::unique_ptr<ZIDRecord> record;
+};
+
+/**
+ * @brief The result of a ZRTP handshake.
+ */
+typedef struct _ZrtpSecureResult {
+    bool secure;                                //!< true if the handshake succeeded
+    std::string cipher;                         //!< the cipher information of srtpSecretsOn()
+    std::string sas;                            //!< the SAS, empty if the session uses no SAS
+    bool verified;                              //!< true if the peer's SAS was verified before
+    GnuZrtpCodes::MessageSeverity severity;     //!< severity of the failure
+    int32_t subCode;                            //!< sub code of the failure
+} ZrtpSecureResult;
+
+/**
+ * @brief A ZRTP stream that coroutines drive.
+ *
+ * The session owns a ZRtp engine and implements its callback: the engine
+ * timer uses the executor, the awaitable secure() completes when the
+ * handshake succeeds or fails. All engine calls run in executor threads or
+ * in the key agreement worker while the session holds its lock, thus the
+ * application may call receive() from its network thread.
+ *
+ * The application derives its session class, implements sendDataZRTP() to
+ * send the ZRTP packets and srtpSecretsReady(), srtpSecretsOff() to set up
+ * SRTP. It may override the other callback methods, the defaults ignore the
+ * information. If the configuration enables SAS signatures and asynchronous
+ * SAS signatures, see ZrtpConfigure::setSasSignature() and
+ * ZrtpConfigure::setAsyncSasSignature(), the session awaits signSasAsync()
+ * and completes the signature with ZRtp::sasSignatureReady().
+ *
+ * The application calls close() before it deletes the executor and deletes
+ * the session only when no coroutine awaits it. A session is not a
+ * multi-stream session.
+ */
+class ZrtpCoroutineSession : public ZrtpCallback {
+public:
+    /**
+     * @brief Create the session and its engine, the engine does not start.
+     *
+     * @param executor
+     *    The executor that runs the engine calls and the awaiting coroutines.
+     * @param config
+     *    The configuration of the engine, the session does not copy it.
+     * @param zid
+     *    The own ZID.
+     * @param clientId
+     *    The client identifier of the Hello packet.
+     */
+    ZrtpCoroutineSession(ZrtpExecutor& executor, ZrtpConfigure* config, const uint8_t* zid,
+                         const std::string& clientId = "GNU ZRTP"):
+        executor(executor), config(config), guard(std::make_shared<Guard>()), timerId(0),
+        timerGeneration(0), done(false) {
+        guard->session = this;
+        result.secure = false;
+        result.verified = false;
+        result.severity = GnuZrtpCodes::Info;
+        result.subCode = 0;
+        synchRequired = true;
+        engine = new ZRtp(const_cast<uint8_t*>(zid), this, clientId, config);
+    }
+
+    virtual ~ZrtpCoroutineSession() { close(); }
+
+    /**
+     * @brief Start the engine in an executor thread.
+     */
+    void start() {
+        dispatch([](ZrtpCoroutineSession* session) { session->engine->startZrtpEngine(); });
+    }
+
+    /**
+     * @brief Process a received ZRTP packet in an executor thread.
+     *
+     * The transport checks the CRC of the packet, the function copies it.
+     *
+     * @param packet
+     *    The packet including the RTP like header and the CRC.
+     * @param length
+     *    Length of the packet in bytes.
+     * @param peerSsrc
+     *    The SSRC of the peer.
+     */
+    void receive(const uint8_t* packet, size_t length, uint32_t peerSsrc) {
+        if (length <= rtpHeaderLength)
+            return;
+        std::shared_ptr<std::vector<uint8_t> > copy = std::make_shared<std::vector<uint8_t> >(packet, packet + length);
+        dispatch([copy, peerSsrc](ZrtpCoroutineSession* session) {
+            session->engine->processZrtpMessage(&(*copy)[rtpHeaderLength], peerSsrc, copy->size());
+        });
+    }
+
+    /**
+     * @brief Await the result of the handshake.
+     *
+     * The awaiting coroutine continues in an executor thread, at once if the
+     * handshake already finished.
+     */
+    class SecureAwaiter {
+    public:
+        explicit SecureAwaiter(ZrtpCoroutineSession* session): session(session) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> awaiting) {
+            std::lock_guard<std::recursive_mutex> lock(session->guard->lock);
+            if (session->done)
+                return false;
+            session->waiters.push_back(awaiting);
+            return true;
+        }
+
+        ZrtpSecureResult await_resume() {
+            std::lock_guard<std::recursive_mutex> lock(session->guard->lock);
+            return session->result;
+        }
+
+    private:
+        ZrtpCoroutineSession* session;
+    };
+
+    SecureAwaiter secure() { return SecureAwaiter(this); }
+
+    /**
+     * @brief Stop the engine and delete it.
+     *
+     * The function waits until an engine call of another thread returns, the
+     * session then ignores the received packets and the timer. It does not
+     * resume the awaiting coroutines.
+     */
+    void close() {
+        std::lock_guard<std::recursive_mutex> lock(guard->lock);
+
+        if (guard->session == nullptr)
+            return;
+        guard->session = nullptr;
+        timerGeneration++;
+        if (timerId != 0) {
+            executor.cancel(timerId);
+            timerId = 0;
+        }
+        delete engine;
+        engine = nullptr;
+    }
+
+    /**
+     * @brief Get the engine, for example to read the SAS or to verify it.
+     *
+     * The application calls the engine in the executor threads only or
+     * holds the session lock, see synchEnter().
+     */
+    ZRtp* getEngine() { return engine; }
+
+    ZrtpExecutor& getExecutor() { return executor; }
+
+    /**
+     * @brief Sign the SAS hash asynchronously.
+     *
+     * The session calls this function from signSAS() if the configuration
+     * enables asynchronous SAS signatures. The engine sends the signature
+     * data that the task returns, see ZRtp::sasSignatureReady(). The default
+     * returns no data, the engine then sends no signature.
+     *
+     * @param sasHash
+     *    The SAS hash to sign.
+     */
+    virtual ZrtpTask<std::vector<uint8_t> > signSasAsync(std::vector<uint8_t> sasHash) {
+        (void)sasHash;
+        co_return std::vector<uint8_t>();
+    }
+
+    int32_t activateTimer(int32_t time) override {
+        std::lock_guard<std::recursive_mutex> lock(guard->lock);
+
+        if (timerId != 0)
+            executor.cancel(timerId);
+        // A timer task that already started when the engine cancelled it sees a newer generation
+        uint64_t generation = ++timerGeneration;
+        std::weak_ptr<Guard> weak = guard;
+        timerId = executor.postDelayed(time, [weak, generation]() {
+            std::shared_ptr<Guard> alive = weak.lock();
+            if (!alive)
+                return;
+            std::lock_guard<std::recursive_mutex> timerLock(alive->lock);
+            ZrtpCoroutineSession* session = alive->session;
+            if (session == nullptr || session->timerGeneration != generation)
+                return;
+            session->timerId = 0;
+            session->engine->processTimeout();
+        });
+        return 1;
+    }
+
+    int32_t cancelTimer() override {
+        std::lock_guard<std::recursive_mutex> lock(guard->lock);
+
+        timerGeneration++;
+        if (timerId != 0) {
+            executor.cancel(timerId);
+            timerId = 0;
+        }
+        return 1;
+    }
+
+    void sendInfo(GnuZrtpCodes::MessageSeverity severity, int32_t subCode) override {
+        (void)severity;
+        (void)subCode;
+    }
+
+    void srtpSecretsOn(std::string c, std::string s, bool verified) override {
+        result.cipher = c;
+        result.sas = s;
+        result.verified = verified;
+        finish(true, GnuZrtpCodes::Info, 0);
+    }
+
+    void handleGoClear() override {}
+
+    void zrtpNegotiationFailed(GnuZrtpCodes::MessageSeverity severity, int32_t subCode) override {
+        finish(false, severity, subCode);
+    }
+
+    void zrtpNotSuppOther() override {
+        finish(false, GnuZrtpCodes::Severe, GnuZrtpCodes::SevereTooMuchRetries);
+    }
+
+    void synchEnter() override { guard->lock.lock(); }
+
+    void synchLeave() override { guard->lock.unlock(); }
+
+    void zrtpAskEnrollment(GnuZrtpCodes::InfoEnrollment info) override { (void)info; }
+
+    void zrtpInformEnrollment(GnuZrtpCodes::InfoEnrollment info) override { (void)info; }
+
+    void signSAS(uint8_t* sasHash) override {
+        if (!config->isAsyncSasSignature())
+            return;
+        runSignature(guard, signSasAsync(std::vector<uint8_t>(sasHash, sasHash + sasHashLength))).start();
+    }
+
+    bool checkSASSignature(uint8_t* sasHash) override {
+        (void)sasHash;
+        return true;
+    }
+
+private:
+    static const size_t rtpHeaderLength = 12;
+    static const size_t sasHashLength = 32;         //!< RFC 6189, chapter 4.5.2: the sashash has 256 bits
+
+    /*
+     * The tasks of the executor and of the workers hold the guard, thus they
+     * notice a closed or deleted session.
+     */
+    struct Guard {
+        std::recursive_mutex lock;
+        ZrtpCoroutineSession* session = nullptr;
+    };
+
+    template <typename F>
+    void dispatch(F call) {
+        std::weak_ptr<Guard> weak = guard;
+        executor.post([weak, call]() {
+            std::shared_ptr<Guard> alive = weak.lock();
+            if (!alive)
+                return;
+            std::lock_guard<std::recursive_mutex> lock(alive->lock);
+            if (alive->session != nullptr)
+                call(alive->session);
+        });
+    }
+
+    static ZrtpTask<> runSignature(std::shared_ptr<Guard> guard, ZrtpTask<std::vector<uint8_t> > signature) {
+        std::weak_ptr<Guard> weak = guard;
+        guard.reset();
+
+        std::vector<uint8_t> data = co_await std::move(signature);
+        std::shared_ptr<Guard> alive = weak.lock();
+        if (!alive)
+            co_return;
+        std::lock_guard<std::recursive_mutex> lock(alive->lock);
+        if (alive->session != nullptr)
+            alive->session->engine->sasSignatureReady(data.data(), static_cast<uint32_t>(data.size()));
+    }
+
+    // Called by the engine while the session holds its lock
+    void finish(bool secure, GnuZrtpCodes::MessageSeverity severity, int32_t subCode) {
+        if (done)
+            return;
+        done = true;
+        result.secure = secure;
+        result.severity = severity;
+        result.subCode = subCode;
+        for (size_t i = 0; i < waiters.size(); i++) {
+            std::coroutine_handle<> awaiting = waiters[i];
+            executor.post([awaiting]() { awaiting.resume(); });
+        }
+        waiters.clear();
+    }
+
+    ZrtpExecutor& executor;
+    ZrtpConfigure* config;
+    ZRtp* engine;
+    std::shared_ptr<Guard> guard;
+    uint64_t timerId;
+    uint64_t timerGeneration;
+    bool done;
+    ZrtpSecureResult result;
+    std::vector<std::coroutine_handle<> > waiters;
+};
+
+/**
+ * @}
+ */
+#endif // _ZRTPCOROUTINE_H_
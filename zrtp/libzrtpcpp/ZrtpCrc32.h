@@ -21,6 +21,10 @@
  *
  * @file ZrtpCrc32.h
  * @brief Methods to compute the CRC32 checksum for ZRTP packets
+ *
+ * The functions use the SSE4.2 or ARMv8 CRC32c instructions if the CPU
+ * supports them, otherwise a slice-by-8 table lookup. Define
+ * @c ZRTP_CRC_NO_HW to disable the instructions at compile time.
  * 
  * @ingroup GNU_ZRTP
  * @{
@@ -57,6 +61,21 @@ bool zrtpCheckCksum(const uint8_t *buffer, uint16_t length, uint32_t crc32);
  */
 uint32_t zrtpGenerateCksum(const uint8_t *buffer, uint16_t length);
 
+/**
+ * Continue a CRC32 checksum with the next part of the data
+ *
+ * @param crc32
+ *    A preliminary CRC32 checksum of the previous data.
+ * @param buffer
+ *    Pointer to the buffer.
+ * @param length
+ *     Lenght of the buffer in bytes.
+ *
+ * @return
+ *    A preliminary CRC32 checksum
+ */
+uint32_t zrtpUpdateCksum(uint32_t crc32, const uint8_t *buffer, uint16_t length);
+
 /**
  * Close CRC32 computation.
  * 
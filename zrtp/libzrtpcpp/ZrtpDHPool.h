@@ -0,0 +1,235 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#ifndef _ZRTPDHPOOL_H_
+#define _ZRTPDHPOOL_H_
+
+/**
+ * @file ZrtpDHPool.h
+ * @brief Pool of pre-generated DH and ECDH key pairs, worker for DH key agreements,
+ *        admission control of the DH handshakes
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <functional>
+#include <common/osSpecifics.h>
+
+class ZrtpDH;
+
+/**
+ * @brief Pool of pre-generated ephemeral DH and ECDH key pairs.
+ *
+ * ZRtp::prepareCommit() and ZRtp::prepareDHPart1() need a new key pair for each
+ * ZRTP handshake. Generating the key pair inline adds the full key generation time
+ * to the handshake. If the application enables the pool, a worker thread generates
+ * key pairs in the background and keeps a number of key pairs for each of the key
+ * agreement types E255, EC25, EC38, E414 and DH3K ready. ZRtp takes a key pair
+ * from the pool and the worker thread refills the pool asynchronously. If the pool
+ * has no key pair of the requested type ZRtp generates the key pair inline as before.
+ *
+ * The pool hands out each key pair only once, the caller owns the ZrtpDH object
+ * and deletes it after use.
+ *
+ * The pool is disabled by default. All functions are thread safe.
+ */
+class __EXPORT ZrtpDHPool {
+public:
+    /**
+     * @brief Set the number of key pairs per key agreement type.
+     *
+     * A size greater than zero enables the pool and starts the worker thread, zero
+     * disables the pool, stops the worker thread and deletes all pooled key pairs.
+     *
+     * @param keysPerType
+     *    Number of key pairs the pool keeps ready for each key agreement type.
+     */
+    static void setPoolSize(int32_t keysPerType);
+
+    /**
+     * @brief Get a key pair from the pool.
+     *
+     * @param type
+     *    Name of the key agreement type, for example @c e255.
+     * @return
+     *    A ZrtpDH object with a generated public key, the caller owns the object.
+     *    @c nullptr if the pool is disabled, does not support the type, or has no
+     *    key pair of this type available.
+     */
+    static ZrtpDH* getKeyPair(const char* type);
+
+    /**
+     * @brief Get the number of available key pairs of a type.
+     *
+     * @param type
+     *    Name of the key agreement type.
+     * @return
+     *    number of pooled key pairs of this type.
+     */
+    static int32_t getAvailable(const char* type);
+};
+
+/**
+ * @brief Worker thread for asynchronous DH and ECDH key agreements.
+ *
+ * If the application enables asynchronous key agreement, see
+ * ZrtpConfigure::setAsyncKeyAgreement(), ZRtp submits the computation of the DH
+ * shared secret to this worker. The worker thread runs the submitted tasks in
+ * order, the ZRTP state engine thread does not block on the bignum computation.
+ *
+ * The worker starts its thread on the first submitted task. All functions are
+ * thread safe.
+ */
+class __EXPORT ZrtpDHWorker {
+public:
+    /**
+     * @brief Submit a task to the worker thread.
+     *
+     * The task must not throw an exception.
+     *
+     * @param task
+     *    The task to run.
+     */
+    static void submit(std::function<void()> task);
+};
+
+/**
+ * @brief Admission control of the DH handshakes.
+ *
+ * If many calls start at the same time, for example after a restart of a PBX,
+ * the DH computations of their handshakes compete with the SRTP processing of
+ * the established calls. If the application sets a limit, the ZRTP state engines
+ * compute only this number of DH results per CPU core at the same time. A state
+ * engine takes a slot before it computes the DH result of a received DHPart1 or
+ * DHPart2 packet and releases it if the result is ready. Without a slot it
+ * ignores the packet, the peer resends it.
+ *
+ * While all slots are taken the state engines also delay new handshakes:
+ *
+ * - as Initiator the state engine delays its Commit and retries with a
+ *   randomized, exponentially growing timeout,
+ * - as Responder it ignores a Commit, the peer resends the Commit with its
+ *   own timer.
+ *
+ * A state engine never holds a slot while it waits for the peer, thus two
+ * peers that use admission control do not block each other. If a handshake
+ * waits too long the state engine proceeds anyway, the controller delays but
+ * never fails a handshake. Multi-stream and Preshared handshakes do not compute
+ * a DH result and bypass the controller.
+ *
+ * The worker threads of ZrtpDHWorker and ZrtpDHPool may run with idle priority,
+ * see setIdlePriority(). The DH computations of synchronous key agreements run
+ * on the thread that processes the ZRTP packets, its priority is up to the
+ * application.
+ *
+ * The controller is disabled by default and counts the handshakes anyway. All
+ * functions are thread safe.
+ */
+class __EXPORT ZrtpAdmission {
+public:
+    /**
+     * @brief Set the number of DH computations per CPU core.
+     *
+     * @param handshakesPerCore
+     *    Number of DH computations per core in flight at the same time, zero
+     *    disables the admission control.
+     */
+    static void setLimit(int32_t handshakesPerCore);
+
+    /**
+     * @brief Get the number of DH computations in flight at the same time.
+     *
+     * @return
+     *    The limit for all cores, zero if the admission control is disabled.
+     */
+    static int32_t getLimit();
+
+    /**
+     * @brief Run the DH worker threads with idle priority.
+     *
+     * On Linux the worker threads of ZrtpDHWorker and ZrtpDHPool use the
+     * scheduling policy @c SCHED_IDLE and run only if no other thread, for
+     * example a SRTP media thread, is ready to run. The threads switch the
+     * policy before their next task. Without effect on other systems.
+     *
+     * @param idle
+     *    If true run the worker threads with idle priority.
+     */
+    static void setIdlePriority(bool idle);
+
+    /**
+     * @brief Check if all slots are taken.
+     *
+     * @return
+     *    true if the limit is reached, false if the admission control is disabled.
+     */
+    static bool isSaturated();
+
+    /**
+     * @brief Try to get a slot for a DH computation.
+     *
+     * @return
+     *    true if the caller got a slot, false if the limit is reached.
+     */
+    static bool tryAdmit();
+
+    /**
+     * @brief Get a slot for a DH computation even if the limit is reached.
+     */
+    static void admit();
+
+    /**
+     * @brief Release the slot of a DH computation.
+     */
+    static void release();
+
+    /**
+     * @brief Count a handshake that waits for a slot.
+     */
+    static void enterQueue();
+
+    /**
+     * @brief Remove a handshake from the waiting handshakes.
+     */
+    static void leaveQueue();
+
+    /**
+     * @brief Get the number of DH computations in flight.
+     *
+     * @return
+     *    number of taken slots.
+     */
+    static int32_t getInFlight();
+
+    /**
+     * @brief Get the number of handshakes that wait for the admission.
+     *
+     * @return
+     *    number of delayed Commits and of state engines that ignored a Commit,
+     *    DHPart1 or DHPart2 packet.
+     */
+    static int32_t getQueueDepth();
+};
+
+/**
+ * @}
+ */
+#endif // _ZRTPDHPOOL_H_
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#ifndef _ZRTPDEMUX_H_
+#define _ZRTPDEMUX_H_
+
+/**
+ * @file ZrtpDemux.h
+ * @brief Classify the packets that share one port
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <libzrtpcpp/zrtpPacket.h>
+#include <common/osSpecifics.h>
+
+/**
+ * @brief Demultiplexer for RTP, RTCP, ZRTP, STUN, DTLS and TURN packets.
+ *
+ * RFC 7983 demultiplexes the packets on one port by their first byte:
+ *
+ * - 0..3     STUN
+ * - 16..19   ZRTP
+ * - 20..63   DTLS
+ * - 64..79   TURN channel
+ * - 128..191 RTP and RTCP
+ *
+ * RFC 5761 separates RTCP from RTP by the second byte, RTCP packet types
+ * are in the range 192..223.
+ *
+ * classify() looks up the first byte in a 256 entry table, the second byte
+ * in another table and the minimum length of the class, thus the caller
+ * dispatches a packet with one switch instead of a chain of checks. A ZRTP
+ * packet must also have the ZRTP magic cookie. The functions only read the
+ * packet.
+ */
+class __EXPORT ZrtpDemux {
+public:
+    /**
+     * @brief The packet classes.
+     *
+     * @c Rtcp immediately follows @c Rtp, classify() depends on this.
+     */
+    typedef enum {
+        Drop = 0,               //!< unknown, malformed or too short, drop the packet
+        Stun,                   //!< STUN packet
+        Zrtp,                   //!< ZRTP packet
+        Dtls,                   //!< DTLS record
+        Turn,                   //!< TURN channel data
+        Rtp,                    //!< RTP or SRTP packet
+        Rtcp,                   //!< RTCP or SRTCP packet
+        NumberOfClasses
+    } PacketClass;
+
+    /**
+     * @brief Classify a received packet.
+     *
+     * @param packet
+     *    The received datagram.
+     * @param length
+     *    Length of the datagram.
+     * @return
+     *    The class of the packet, see PacketClass.
+     */
+    static inline int32_t classify(const uint8_t* packet, size_t length) {
+        if (packet == NULL || length < 2)
+            return Drop;
+
+        int32_t packetClass = firstByteClass[packet[0]];
+        packetClass += (packetClass == Rtp) & rtcpType[packet[1]];
+
+        if (length < minimumLength[packetClass])
+            return Drop;
+
+        // The ZRTP magic cookie occupies the RTP timestamp field
+        if (packetClass == Zrtp &&
+            ((uint32_t)packet[4] << 24 | (uint32_t)packet[5] << 16 | (uint32_t)packet[6] << 8 | packet[7]) != ZRTP_MAGIC)
+            return Drop;
+
+        return packetClass;
+    }
+
+    /**
+     * @brief Classify a batch of received packets.
+     *
+     * @param packets
+     *    Array of pointers to the received datagrams.
+     * @param lengths
+     *    Array of the datagram lengths.
+     * @param classes
+     *    Array that receives the class of each packet.
+     * @param count
+     *    Number of packets in the arrays.
+     * @return
+     *    Number of packets that are not classified as @c Drop.
+     */
+    static int32_t classifyBatch(const uint8_t* const packets[], const size_t lengths[], int32_t classes[], int32_t count);
+
+private:
+    static const uint8_t firstByteClass[256];
+    static const uint8_t rtcpType[256];
+    static const size_t minimumLength[NumberOfClasses];
+};
+
+/**
+ * @}
+ */
+#endif // _ZRTPDEMUX_H_
@@ -0,0 +1,384 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPMETRICS_H_
+#define _ZRTPMETRICS_H_
+
+/**
+ * @file ZrtpMetrics.h
+ * @brief Process wide ZRTP and SRTP metrics
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#include <common/osSpecifics.h>
+
+/**
+ * @brief Process wide counters of the ZRTP engines and the SRTP contexts.
+ *
+ * The ZRTP engines count the started, secure and failed handshakes, the
+ * negotiated algorithms, the time to reach the secure state and the ZID cache
+ * lookups. The SRTP and SRTCP crypto contexts count the packets, bytes,
+ * authentication failures and replay drops per SRTP suite. The metrics are
+ * always on, an application reads them with getSnapshot().
+ *
+ * Each thread updates its own block of counters, thus a count is a relaxed
+ * load and store of a thread local counter and needs no lock and no atomic
+ * read-modify-write. A thread registers its block when it counts the first
+ * time. When the thread ends its counts move to a common block. A snapshot
+ * adds the blocks of all threads, its counters are consistent each but not
+ * with each other.
+ *
+ * If the library is built with @c ZRTP_LOCK_PROFILING (cmake option
+ * @c LOCK_PROFILING) the stream, queue, timeout and random locks count their
+ * acquisitions, contended acquisitions, wait and hold times, see
+ * ZrtpProfiledMutex. Otherwise these counters stay zero.
+ *
+ * SrtpHandler measures the latency of about one in @c DefaultLatencySampling calls
+ * of the single packet protect and unprotect functions, see
+ * setLatencySampling(). A sampled call reads the steady clock at the start,
+ * after each stage and at the end. The histograms have four linear buckets per
+ * power of two, per SRTP suite and operation for the whole call and per
+ * operation for the stages. The batch functions are not sampled.
+ *
+ @verbatim
+ ZrtpMetrics::Snapshot snapshot;
+ ZrtpMetrics::getSnapshot(&snapshot);
+ std::string text = ZrtpMetrics::formatPrometheus(snapshot);
+ @endverbatim
+ */
+class __EXPORT ZrtpMetrics {
+public:
+    static const int32_t MaxAlgorithms = 8;             ///< ordinals per algorithm type
+    static const int32_t NumberOfFailureCodes = 43;     ///< see getFailureIndex()
+    static const int32_t NumberOfTimeBuckets = 16;      ///< see getTimeBucketLimit()
+    static const int32_t NumberOfEncryptions = 8;       ///< SrtpEncryptionNull ... SrtpEncryptionCHACHA20POLY1305
+    static const int32_t NumberOfAuthentications = 3;   ///< SrtpAuthenticationNull ... SrtpAuthenticationSkeinHmac
+    static const int32_t NumberOfSrtpSuites = NumberOfEncryptions * NumberOfAuthentications * 2;
+    static const int32_t NumberOfHoldBuckets = 16;      ///< see getHoldBucketLimit()
+    static const int32_t NumberOfLatencyBuckets = 48;   ///< see getLatencyBucketLimit()
+    static const uint32_t DefaultLatencySampling = 128; ///< see setLatencySampling()
+
+    /**
+     * The algorithm types of Snapshot::negotiated.
+     */
+    typedef enum {
+        Hash = 0,
+        Cipher,
+        PubKey,
+        Sas,
+        AuthLength,
+        NumberOfAlgorithmTypes
+    } AlgorithmType;
+
+    /**
+     * The lock categories of Snapshot::locks.
+     */
+    typedef enum {
+        StreamLock = 0,             //!< synchLock of the client streams, CtZrtpStream
+        QueueLock,                  //!< synchLock of ZrtpQueue
+        TimeoutLock,                //!< synchLock of the timeout providers
+        RandomLock,                 //!< lock of the ZrtpRandom main pool
+        NumberOfLockCategories
+    } LockCategory;
+
+    /**
+     * The operations of Snapshot::srtpLatency and Snapshot::stageLatency.
+     */
+    typedef enum {
+        ProtectLatency = 0,         //!< protect an outgoing SRTP or SRTCP packet
+        UnprotectLatency,           //!< unprotect an incoming SRTP or SRTCP packet
+        NumberOfLatencyOperations
+    } LatencyOperation;
+
+    /**
+     * The stages of a SRTP operation, the stages of Snapshot::stageLatency.
+     */
+    typedef enum {
+        DecodeStage = 0,            //!< check and decode the RTP header
+        ReplayStage,                //!< guess the index and check the replay window, unprotect only
+        CryptoStage,                //!< cipher and MAC, one fused transform of the crypto context
+        NumberOfLatencyStages
+    } LatencyStage;
+
+    /**
+     * A latency histogram.
+     */
+    typedef struct _LatencyHistogram {
+        uint64_t samples[NumberOfLatencyBuckets];   //!< samples per latency bucket, not cumulative
+        uint64_t sum;                               //!< sum of the latencies in nanoseconds
+    } LatencyHistogram;
+
+    /**
+     * Counters of a lock category.
+     */
+    typedef struct _LockCounters {
+        uint64_t acquisitions;                      //!< acquisitions of the locks
+        uint64_t contended;                         //!< acquisitions that waited for another thread
+        uint64_t waitTimeSum;                       //!< sum of the wait times in nanoseconds
+        uint64_t holdTimeSum;                       //!< sum of the hold times in nanoseconds
+        uint64_t holdTime[NumberOfHoldBuckets];     //!< releases per hold time bucket, not cumulative
+    } LockCounters;
+
+    /**
+     * Counters of a SRTP suite.
+     */
+    typedef struct _SrtpSuiteCounters {
+        uint64_t packets;           //!< protected or unprotected packets
+        uint64_t bytes;             //!< bytes of these packets, without SRTP/SRTCP trailer
+        uint64_t authFailures;      //!< packets with a wrong authentication tag
+        uint64_t replayDrops;       //!< packets dropped by the replay check
+    } SrtpSuiteCounters;
+
+    /**
+     * A snapshot of the process wide counters.
+     */
+    typedef struct _Snapshot {
+        uint64_t handshakesStarted;                         //!< started engines
+        uint64_t handshakesSecure;                          //!< engines that reached the secure state
+        uint64_t handshakesFailed[NumberOfFailureCodes];    //!< failed negotiations, see getFailureCode()
+        uint64_t negotiated[NumberOfAlgorithmTypes][MaxAlgorithms]; //!< secure handshakes per algorithm ordinal
+        uint64_t secureTime[NumberOfTimeBuckets];           //!< secure handshakes per time bucket, not cumulative
+        uint64_t secureTimeSum;                             //!< sum of the times to secure in microseconds
+        uint64_t cacheHits;                                 //!< cache lookups that found a valid RS1 of the peer
+        uint64_t cacheMisses;                               //!< cache lookups without a valid RS1
+        SrtpSuiteCounters srtp[NumberOfSrtpSuites];         //!< counters per SRTP suite, see getSrtpSuite()
+        LockCounters locks[NumberOfLockCategories];         //!< counters per lock category, see LockCategory
+        uint64_t admissionInFlight;                         //!< DH computations in flight, see ZrtpAdmission
+        uint64_t admissionQueued;                           //!< handshakes that wait for the admission
+        LatencyHistogram srtpLatency[NumberOfSrtpSuites][NumberOfLatencyOperations]; //!< sampled calls per suite
+        LatencyHistogram stageLatency[NumberOfLatencyOperations][NumberOfLatencyStages]; //!< sampled stages of SRTP
+    } Snapshot;
+
+    /// @brief Count a start of a ZRTP engine.
+    static void countHandshakeStarted();
+
+    /**
+     * @brief Count a handshake that reached the secure state.
+     *
+     * @param ordinals
+     *    The ordinals of the negotiated algorithms, indexed by AlgorithmType.
+     * @param timeToSecure
+     *    Microseconds from the engine start to the secure state, negative if unknown.
+     */
+    static void countHandshakeSecure(const int32_t ordinals[NumberOfAlgorithmTypes], int64_t timeToSecure);
+
+    /**
+     * @brief Count a failed negotiation.
+     *
+     * @param severity
+     *    The GnuZrtpCodes::MessageSeverity of the failure
+     * @param subCode
+     *    The sub-code of the failure
+     */
+    static void countHandshakeFailed(int32_t severity, int32_t subCode);
+
+    /**
+     * @brief Count a ZID cache lookup of an engine.
+     *
+     * @param hit
+     *    True if the cache has a valid RS1 of the peer.
+     */
+    static void countCacheLookup(bool hit);
+
+    /// @brief Count a protected or unprotected packet of a SRTP suite.
+    static void countSrtpPacket(int32_t suite, size_t length);
+
+    /// @brief Count an authentication failure of a SRTP suite.
+    static void countSrtpAuthFailure(int32_t suite);
+
+    /// @brief Count a replay drop of a SRTP suite.
+    static void countSrtpReplayDrop(int32_t suite);
+
+    /**
+     * @brief Count an acquisition of a lock.
+     *
+     * @param category
+     *    The LockCategory of the lock
+     * @param contended
+     *    True if the lock was held by another thread
+     * @param waitTime
+     *    Nanoseconds the thread waited for the lock
+     */
+    static void countLockAcquired(int32_t category, bool contended, uint64_t waitTime);
+
+    /**
+     * @brief Count a release of a lock.
+     *
+     * @param category
+     *    The LockCategory of the lock
+     * @param holdTime
+     *    Nanoseconds the thread held the lock
+     */
+    static void countLockReleased(int32_t category, uint64_t holdTime);
+
+    /**
+     * @brief Set the sampling interval of the SRTP latency histograms.
+     *
+     * Each thread samples one in @c interval calls on average, the distance
+     * of two samples is random. A new interval takes effect after the next
+     * sample of a thread.
+     *
+     * @param interval
+     *    The interval, 0 disables the sampling. The default is DefaultLatencySampling.
+     */
+    static void setLatencySampling(uint32_t interval);
+
+    /// @brief Get the sampling interval of the SRTP latency histograms.
+    static uint32_t getLatencySampling();
+
+    /**
+     * @brief Check if the thread samples the latency of the current call.
+     *
+     * @return
+     *    True about once per sampling interval of the thread.
+     */
+    static bool sampleLatency();
+
+    /**
+     * @brief Count the latency of a sampled SRTP operation.
+     *
+     * @param suite
+     *    The SRTP suite, see getSrtpSuite()
+     * @param operation
+     *    The LatencyOperation
+     * @param latency
+     *    Nanoseconds the operation took
+     */
+    static void countLatency(int32_t suite, int32_t operation, uint64_t latency);
+
+    /**
+     * @brief Count the latency of a stage of a sampled SRTP operation.
+     *
+     * @param operation
+     *    The LatencyOperation
+     * @param stage
+     *    The LatencyStage
+     * @param latency
+     *    Nanoseconds the stage took
+     */
+    static void countStageLatency(int32_t operation, int32_t stage, uint64_t latency);
+
+    /**
+     * @brief Get the upper limit of a latency bucket in nano-seconds.
+     *
+     * The first four buckets have a width of 32ns, then each power of two
+     * from 128ns on has four buckets of equal width. Bucket @c i counts the
+     * samples of at most the limit and more than the limit of the bucket
+     * before.
+     *
+     * @return
+     *    The limit, -1 for the last bucket which has no limit.
+     */
+    static int64_t getLatencyBucketLimit(int32_t bucket);
+
+    /// @brief Get the name of a lock category, for example "stream".
+    static const char* getLockName(int32_t category);
+
+    /**
+     * @brief Get the upper limit of a hold time bucket in micro-seconds.
+     *
+     * Bucket @c i counts the releases of locks held at most @c 2^i us and
+     * longer than the limit of the bucket before.
+     *
+     * @return
+     *    The limit, -1 for the last bucket which has no limit.
+     */
+    static int64_t getHoldBucketLimit(int32_t bucket);
+
+    /**
+     * @brief Get the SRTP suite of a crypto context.
+     *
+     * @param ealg
+     *    The encryption algorithm, for example SrtpEncryptionAESCM
+     * @param aalg
+     *    The authentication algorithm, for example SrtpAuthenticationSha1Hmac
+     * @param control
+     *    True for a SRTCP context
+     * @return
+     *    The suite, the index of Snapshot::srtp, or -1 for unknown algorithms.
+     */
+    static int32_t getSrtpSuite(int32_t ealg, int32_t aalg, bool control);
+
+    /**
+     * @brief Get the names of a SRTP suite.
+     *
+     * @param suite
+     *    The suite
+     * @param encryption
+     *    Receives the name of the encryption algorithm, for example "AES-CM"
+     * @param authentication
+     *    Receives the name of the authentication algorithm, for example "HMAC-SHA1"
+     * @return
+     *    True for a SRTCP suite.
+     */
+    static bool getSrtpSuiteNames(int32_t suite, const char** encryption, const char** authentication);
+
+    /**
+     * @brief Get the failure index of a severity and sub-code.
+     *
+     * The Severe sub-codes, the ZRTP error codes (positive if this engine
+     * detected the error, negative if the peer sent an Error packet) and one
+     * index for all other codes.
+     *
+     * @return
+     *    The index of Snapshot::handshakesFailed.
+     */
+    static int32_t getFailureIndex(int32_t severity, int32_t subCode);
+
+    /**
+     * @brief Get the severity and sub-code of a failure index.
+     *
+     * @return
+     *    False for the index of the other codes, the function sets both values
+     *    to zero in this case.
+     */
+    static bool getFailureCode(int32_t index, int32_t* severity, int32_t* subCode);
+
+    /**
+     * @brief Get the upper limit of a time bucket in milli-seconds.
+     *
+     * Bucket @c i counts the handshakes that took at most @c 2^i ms and more
+     * than the limit of the bucket before.
+     *
+     * @return
+     *    The limit, -1 for the last bucket which has no limit.
+     */
+    static int64_t getTimeBucketLimit(int32_t bucket);
+
+    /**
+     * @brief Get a snapshot of the process wide counters.
+     *
+     * The function may run at any time in any thread.
+     */
+    static void getSnapshot(Snapshot* snapshot);
+
+    /**
+     * @brief Format a snapshot in the Prometheus text exposition format.
+     *
+     * The SRTP metrics contain the suites that have a non-zero counter only.
+     */
+    static std::string formatPrometheus(const Snapshot& snapshot);
+};
+
+/**
+ * @}
+ */
+#endif
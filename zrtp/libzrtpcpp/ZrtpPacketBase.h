@@ -38,6 +38,7 @@
 #include <stdlib.h>
 
 #include <common/osSpecifics.h>
+#include <common/zrtpByteOrder.h>
 
 #include <libzrtpcpp/zrtpPacket.h>
 #include <libzrtpcpp/ZrtpTextData.h>
@@ -64,6 +65,10 @@ const uint16_t zrtpId = 0x505a;
  * allocation only that line in the subclasses must be changed and the destructors
  * should take care of memory management.
  *
+ * The constructors that take received data do not copy or allocate, they only
+ * set the header pointers into the receive buffer. The state engine creates these
+ * objects on the stack, they are valid only as long as the receive buffer.
+ *
  * @author Werner Dittmann <Werner.Dittmann@t-online.de>
  */
 
@@ -95,7 +100,7 @@ class __EXPORT ZrtpPacketBase {
      * @return
      *     @c true if check was ok
      */
-    bool isZrtpPacket()            { return (zrtpNtohs(zrtpHeader->zrtpId) == zrtpId); };
+    bool isZrtpPacket()            { return (zrtpBe16(zrtpHeader->zrtpId) == zrtpId); };
 
     /**
      * Get the length in words of the ZRTP message
@@ -103,7 +108,7 @@ class __EXPORT ZrtpPacketBase {
      * @return
      *     The length in words
      */
-    uint16_t getLength()           { return zrtpNtohs(zrtpHeader->length); };
+    uint16_t getLength()           { return zrtpBe16(zrtpHeader->length); };
 
     /**
      * Return pointer to fixed length message type ASCII data
@@ -119,7 +124,7 @@ class __EXPORT ZrtpPacketBase {
      * @param len
      *     The length of the ZRTP message in words, host order
      */
-    void setLength(uint16_t len)  { zrtpHeader->length = zrtpHtons(len); };
+    void setLength(uint16_t len)  { zrtpHeader->length = zrtpBe16(len); };
 
     /**
      * Copy the message type ASCII data to ZRTP message type field
@@ -133,7 +138,7 @@ class __EXPORT ZrtpPacketBase {
     /**
      * Initializes the ZRTP Id field
      */
-    void setZrtpId()              { zrtpHeader->zrtpId = zrtpHtons(zrtpId); }
+    void setZrtpId()              { zrtpHeader->zrtpId = zrtpBe16(zrtpId); }
 };
 
 /**
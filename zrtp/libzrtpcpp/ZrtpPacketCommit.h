@@ -30,7 +30,6 @@
 
 #include <libzrtpcpp/ZrtpPacketBase.h>
 
-// PRSH here only for completeness. We don't support PRSH in the other ZRTP parts.
 #define COMMIT_DH_EX      29
 #define COMMIT_MULTI      25
 #define COMMIT_PRSH       27
@@ -54,7 +53,8 @@ class __EXPORT ZrtpPacketCommit : public ZrtpPacketBase {
  public:
     typedef enum _commitType {
         DhExchange =  1,
-        MultiStream = 2
+        MultiStream = 2,
+        Preshared =   3
     } commitType;
 
     /// Creates a Commit packet with default data
@@ -90,6 +90,9 @@ class __EXPORT ZrtpPacketCommit : public ZrtpPacketBase {
     /// Get pointer to NONCE field, a fixed length byte array, overlaps HVI field
     uint8_t* getNonce()       { return commitHeader->hvi; };
 
+    /// Get pointer to key ID field during Preshared mode, a fixed length byte array, overlaps HVI field
+    uint8_t* getKeyId()       { return commitHeader->hvi+4*ZRTP_WORD_SIZE; };
+
     /// Get pointer to hashH2 field, a fixed length byte array
     uint8_t* getH2()          { return commitHeader->hashH2; };
 
@@ -99,9 +102,11 @@ class __EXPORT ZrtpPacketCommit : public ZrtpPacketBase {
     /// Get pointer to MAC field during multi-stream mode, a fixed length byte array
     uint8_t* getHMACMulti()   { return commitHeader->hmac-4*ZRTP_WORD_SIZE; };
 
+    /// Get pointer to MAC field during Preshared mode, a fixed length byte array
+    uint8_t* getHMACPresh()   { return commitHeader->hmac-2*ZRTP_WORD_SIZE; };
+
     /// Check if packet length makes sense.
-    bool isLengthOk(commitType type)   {int32_t len = getLength(); 
-                                        return ((type == DhExchange) ? len == COMMIT_DH_EX : len == COMMIT_MULTI);}
+    bool isLengthOk(commitType type);
 
     /// Set hash algorithm type field, fixed length character field
     void setHashType(uint8_t* text)    { memcpy(commitHeader->hash, text, ZRTP_WORD_SIZE); };
@@ -122,11 +127,14 @@ class __EXPORT ZrtpPacketCommit : public ZrtpPacketBase {
     void setZid(uint8_t* text)         { memcpy(commitHeader->zid, text, sizeof(commitHeader->zid)); };
 
     /// Set HVI field, a fixed length byte array
-    void setHvi(uint8_t* text)         { memcpy(commitHeader->hvi, text, sizeof(commitHeader->hvi)); };
+    void setHvi(uint8_t* text);
 
     /// Set conce field, a fixed length byte array, overlapping HVI field
     void setNonce(uint8_t* text);
 
+    /// Set key ID field during Preshared mode, a fixed length byte array, follows the nonce field
+    void setKeyId(uint8_t* text);
+
     /// Set hashH2 field, a fixed length byte array
     void setH2(uint8_t* hash)          { memcpy(commitHeader->hashH2, hash, sizeof(commitHeader->hashH2)); };
 
@@ -136,6 +144,9 @@ class __EXPORT ZrtpPacketCommit : public ZrtpPacketBase {
     /// Set MAC field during multi-stream mode, a fixed length byte array
     void setHMACMulti(uint8_t* hash)   { memcpy(commitHeader->hmac-4*ZRTP_WORD_SIZE, hash, sizeof(commitHeader->hmac)); };
 
+    /// Set MAC field during Preshared mode, a fixed length byte array
+    void setHMACPresh(uint8_t* hash)   { memcpy(commitHeader->hmac-2*ZRTP_WORD_SIZE, hash, sizeof(commitHeader->hmac)); };
+
  private:
      CommitPacket_t data;
 };
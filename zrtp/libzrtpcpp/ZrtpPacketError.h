@@ -51,10 +51,10 @@ class __EXPORT ZrtpPacketError : public ZrtpPacketBase {
     virtual ~ZrtpPacketError();
 
     /// Get the error code from Error message
-    uint32_t getErrorCode() { return zrtpNtohl(errorHeader->errorCode); };
+    uint32_t getErrorCode() { return zrtpBe32(errorHeader->errorCode); };
 
     /// Set error code in Error message
-    void setErrorCode(uint32_t code) {errorHeader->errorCode = zrtpHtonl(code); };
+    void setErrorCode(uint32_t code) {errorHeader->errorCode = zrtpBe32(code); };
 
  private:
      ErrorPacket_t data;
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#ifndef _ZRTPPACKETFILTER_H_
+#define _ZRTPPACKETFILTER_H_
+
+/**
+ * @file ZrtpPacketFilter.h
+ * @brief Cheap checks of received ZRTP packets before the ZRTP engine processes them
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <chrono>
+
+#include <libzrtpcpp/zrtpPacket.h>
+#include <common/osSpecifics.h>
+
+/**
+ * @brief Pre-filter for received ZRTP packets.
+ *
+ * A Hello, Commit or DHPart packet makes the ZRTP engine generate a DH key
+ * pair or compute a DH key agreement. A flood of spoofed or replayed packets
+ * thus costs a lot of CPU time. The client calls the filter with the received
+ * datagram before it checks the CRC and processes the packet:
+ *
+ * - checkPacket() checks the structure of the packet and limits the packet
+ *   rate per source and the rate of the expensive packets of all sources.
+ *   The client calls it before the CRC check.
+ * - checkBinding() checks that the hash image in a Commit or DHPart packet
+ *   belongs to the hash chain of the peer's Hello, refer to RFC 6189,
+ *   chapter 9. The client calls it after the CRC check.
+ *
+ * Both functions only read the packet and don't allocate memory. The filter
+ * counts the dropped packets, see getCounters().
+ *
+ * The client owns one filter per stream and calls reset() if the stream
+ * starts a new ZRTP engine. The filter is not thread safe.
+ */
+class __EXPORT ZrtpPacketFilter {
+public:
+    /**
+     * @brief Create a packet filter.
+     *
+     * @param sourceRate
+     *    Number of packets per second a source may send.
+     * @param sourceBurst
+     *    Number of packets a source may send at once.
+     * @param keyRate
+     *    Number of Hello, Commit and DHPart packets per second of all sources.
+     * @param keyBurst
+     *    Number of Hello, Commit and DHPart packets of all sources at once.
+     */
+    ZrtpPacketFilter(int32_t sourceRate = 16, int32_t sourceBurst = 32, int32_t keyRate = 8, int32_t keyBurst = 16);
+
+    /**
+     * @brief Check the structure and the rate of a received packet.
+     *
+     * @param packet
+     *    The received datagram, starts with the 12 byte ZRTP packet header
+     *    and ends with the CRC.
+     * @param length
+     *    Length of the datagram.
+     * @param source
+     *    Identifies the sender, for example its address and port or the SSRC.
+     * @return
+     *    false if the client must drop the packet.
+     */
+    bool checkPacket(const uint8_t* packet, size_t length, uint64_t source);
+
+    /**
+     * @brief Check that the packet belongs to the hash chain of the peer's Hello.
+     *
+     * The filter remembers the H3 of the first Hello and drops a Hello with
+     * another H3 and Commit or DHPart packets whose hash image does not lead
+     * to this H3.
+     *
+     * @param packet
+     *    The received datagram after its CRC check, see checkPacket().
+     * @param length
+     *    Length of the datagram.
+     * @return
+     *    false if the client must drop the packet.
+     */
+    bool checkBinding(const uint8_t* packet, size_t length);
+
+    /**
+     * @brief Forget the peer's Hello, the sources and the counters.
+     */
+    void reset();
+
+    /**
+     * @brief Get the number of 32-bit counters of the filter.
+     */
+    int32_t getNumberOfCounters() { return NumberOfCounters; }
+
+    /**
+     * @brief Read the counters of dropped packets.
+     *
+     * The counters are in this order: malformed packets, packets that exceed
+     * the rate limits, packets that do not belong to the peer's hash chain.
+     *
+     * @param counters
+     *    Pointer to a buffer that holds at least getNumberOfCounters() integers.
+     * @return
+     *    Number of counters copied to the buffer.
+     */
+    int32_t getCounters(int32_t* counters);
+
+private:
+    enum Counters {
+        DroppedMalformed,
+        DroppedRate,
+        DroppedBinding,
+        NumberOfCounters
+    };
+
+    static const int32_t NumberOfSources = 8;
+
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    /// Token bucket, the tokens are in units of 1/1000 packet
+    struct Bucket {
+        uint64_t source;
+        int64_t tokens;
+        TimePoint last;
+        bool used;
+    };
+
+    bool takeToken(Bucket& bucket, int32_t rate, int32_t burst, TimePoint now);
+    Bucket& sourceBucket(uint64_t source, TimePoint now);
+
+    int32_t sourceRate;
+    int32_t sourceBurst;
+    int32_t keyRate;
+    int32_t keyBurst;
+
+    Bucket sources[NumberOfSources];
+    Bucket keyPackets;
+
+    bool helloSeen;
+    uint8_t peerH3[HASH_IMAGE_SIZE];
+
+    int32_t counters[NumberOfCounters];
+};
+
+/**
+ * @}
+ */
+#endif // _ZRTPPACKETFILTER_H_
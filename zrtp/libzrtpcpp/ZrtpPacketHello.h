@@ -76,11 +76,27 @@ class __EXPORT ZrtpPacketHello : public ZrtpPacketBase {
      * objects created with the standard constructor (with default data)
      * before the application can use most of the getter and setter methods.
      *
+     * The function keeps a template of the Hello message for the first few
+     * configurations it sees and copies the template for a configuration with
+     * the same fingerprint, see ZrtpConfigure::getFingerprint().
+     *
      * @param config
      *    Pointer to ZrtpConfigure data.
      */
     void configureHello(ZrtpConfigure* config);
 
+    /**
+     * Populate Hello message data as a copy of a configured Hello message.
+     *
+     * Copies the offered algorithm names, offsets, flags, version and client id
+     * of a Hello message that was set up with configureHello(ZrtpConfigure*)
+     * before. The application must set the H3 hash and the MAC of the copy.
+     *
+     * @param hello
+     *    The configured Hello message.
+     */
+    void configureHello(const ZrtpPacketHello& hello);
+
     /// Get version number from Hello message, fixed ASCII character array
     uint8_t* getVersion()  { return helloHeader->version; };
 
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Authors: the ZRTPCPP contributors
+ */
+
+#ifndef _ZRTPPROFILEDMUTEX_H_
+#define _ZRTPPROFILEDMUTEX_H_
+
+/**
+ * @file ZrtpProfiledMutex.h
+ * @brief A mutex that records its acquisitions in the ZRTP metrics
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdint.h>
+#include <chrono>
+
+#include <libzrtpcpp/ZrtpMetrics.h>
+
+/**
+ * @brief Mutex that counts acquisitions, contention, wait and hold times.
+ *
+ * The class wraps a mutex with @c lock, @c try_lock and @c unlock, for
+ * example @c std::mutex or @c std::recursive_mutex, and counts in the lock
+ * category @c Category of ZrtpMetrics. An acquisition is contended if
+ * @c try_lock fails, then the mutex measures the time until @c lock returns.
+ * The hold time runs from the outermost acquisition to its release.
+ *
+ * The library uses this class instead of the plain locks if it is built
+ * with @c ZRTP_LOCK_PROFILING. Each acquisition reads the steady clock twice,
+ * thus profiling is not for production builds.
+ *
+ * @c enter and @c leave are the names of the ccRTP mutex functions. Use
+ * @c std::condition_variable_any to wait on this mutex.
+ */
+template <class Mutex, int32_t Category>
+class ZrtpProfiledMutex {
+public:
+    void lock() {
+        if (mutex.try_lock()) {
+            acquired(false, 0);
+            return;
+        }
+        uint64_t start = now();
+        mutex.lock();
+        acquired(true, now() - start);
+    }
+
+    bool try_lock() {
+        if (!mutex.try_lock())
+            return false;
+        acquired(false, 0);
+        return true;
+    }
+
+    void unlock() {
+        // Only the owner changes depth and since, the release of the outermost lock counts the hold time
+        if (--depth == 0)
+            ZrtpMetrics::countLockReleased(Category, now() - since);
+        mutex.unlock();
+    }
+
+    void enter() { lock(); }
+
+    void leave() { unlock(); }
+
+private:
+    static uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void acquired(bool contended, uint64_t waitTime) {
+        if (depth++ == 0)
+            since = now();
+        ZrtpMetrics::countLockAcquired(Category, contended, waitTime);
+    }
+
+    Mutex mutex;
+    int32_t depth = 0;
+    uint64_t since = 0;
+};
+
+/**
+ * @}
+ */
+#endif // _ZRTPPROFILEDMUTEX_H_
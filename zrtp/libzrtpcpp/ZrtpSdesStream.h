@@ -88,6 +88,7 @@
 
 class CryptoContext;
 class CryptoContextCtrl;
+class MemoryUsage;
 
 /*
  * These functions support 256 bit encryption algorithms.
@@ -328,6 +329,33 @@ public:
      */
     int incomingRtp(uint8_t *packet, size_t length, size_t *newLength, SrtpErrorData* errorData=NULL);
 
+    /**
+     * @brief Process an outgoing RTP packet with SDES and a second SRTP layer
+     *
+     * The function protects the packet with the SDES keys first and then with
+     * the @c outer context, for example the ZRTP context of a stream that must
+     * protect twice. Both layers run in one pass, see
+     * @c SrtpHandler::protectTwice. If SDES is not active the function
+     * protects with the @c outer context only.
+     *
+     * @return
+     *  - @c true if encryption is successful, app shall send packet to the recipient.
+     *  - @c false if there was an error during encryption, don't send the packet.
+     */
+    bool outgoingRtpTwice(CryptoContext* outer, uint8_t *packet, size_t length, size_t *newLength);
+
+    /**
+     * @brief Process an incoming SRTP packet with a second SRTP layer and SDES
+     *
+     * The reverse of @c outgoingRtpTwice, see @c SrtpHandler::unprotectTwice.
+     *
+     * @param outerDone set to @c true if the @c outer layer was unprotected.
+     *
+     * @return the same values as @c incomingRtp
+     */
+    int incomingRtpTwice(CryptoContext* outer, uint8_t *packet, size_t length, size_t *newLength, bool* outerDone,
+                         SrtpErrorData* errorData=NULL);
+
     /**
      * @brief Process an incoming RTCP or SRTCP packet
      *
@@ -414,6 +442,16 @@ public:
      */
     const char* getAuthAlgo();
 
+    /**
+     * @brief Add the memory of this SDES stream to a footprint report.
+     *
+     * The SDES stream adds its own size to the category MemoryUsage::Session,
+     * its crypto contexts add their memory to MemoryUsage::Srtp and
+     * MemoryUsage::Cipher.
+     *
+     * @param usage the footprint report
+     */
+    void addMemoryUsage(MemoryUsage& usage) const;
 
     /*
      * ******** Lower layer functions
@@ -508,6 +546,19 @@ private:
      */
     void createSrtpContexts(bool sipInvite);
 
+    /**
+     * @brief Create a SRTP context of the ZRTP tunnel.
+     *
+     * @c createSrtpContexts keeps the key material of the tunnel, the stream
+     * creates the tunnel context of a direction only if it tunnels a ZRTP
+     * packet in this direction. The function clears the key material of the
+     * direction.
+     *
+     * @param sender if @c true create the context for outgoing packets, for
+     *               incoming packets otherwise.
+     */
+    void createZrtpTunnel(bool sender);
+
     /**
      * @brief Compute the mixed keys if SDES mixing attribute is set.
      *
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ZRTPSRTPCWRAPPER_H
+#define ZRTPSRTPCWRAPPER_H
+
+/**
+ *
+ * @file ZrtpSrtpCWrapper.h
+ * @brief The GNU ZRTP C-to-C++ wrapper of the SRTP functions.
+ *
+ * A C application creates the SRTP contexts with the secrets that it gets
+ * in its @c zrtp_srtpSecretsReady callback and protects or unprotects its
+ * RTP and RTCP packets with the functions of this file. The functions
+ * process the packets in the buffers of the caller, the batch functions
+ * process several packets with one call.
+ *
+ * @ingroup GNU_ZRTP
+ * @{
+ *
+ * @see SrtpHandler
+ */
+
+#include <stddef.h>
+#include <libzrtpcpp/ZrtpCWrapper.h>
+
+/**
+ * Describes one packet of a batch.
+ *
+ * Keep the layout in sync with PacketSpan in SrtpHandler.h.
+ */
+typedef struct zrtp_SrtpPacket
+{
+    uint8_t* buffer;                    /*!< the RTP/SRTP packet data */
+    size_t   length;                    /*!< length of the packet data in bytes */
+    size_t   newLength;                 /*!< length of the resulting packet data in bytes */
+    int32_t  result;                    /*!< result code of the packet */
+} zrtp_SrtpPacket;
+
+#ifdef __cplusplus
+#ifdef __GNUC__
+#pragma GCC visibility push(default)
+#endif
+extern "C"
+{
+#endif
+
+    /** Opaque structure that holds the SRTP and SRTCP context of one direction. */
+    typedef struct zrtpSrtpContext ZrtpSrtpContext;
+
+    /**
+     * Create the SRTP and SRTCP contexts of one direction.
+     *
+     * The function selects the keys according to the role and the direction,
+     * derives the session keys and does not keep a pointer to the secrets.
+     *
+     * @param secrets
+     *    The secrets that the @c zrtp_srtpSecretsReady callback got.
+     * @param part
+     *    @c ForSender or @c ForReceiver.
+     * @return
+     *    The new context or @c NULL if the algorithms are not supported.
+     */
+    ZrtpSrtpContext* zrtp_newSrtpContext(const C_SrtpSecret_t* secrets, int32_t part);
+
+    /**
+     * Free the SRTP and SRTCP contexts.
+     *
+     * @param srtpContext
+     *    The context, may be @c NULL.
+     */
+    void zrtp_freeSrtpContext(ZrtpSrtpContext* srtpContext);
+
+    /**
+     * Protect an RTP packet in place.
+     *
+     * The buffer must have room for the authentication tag.
+     *
+     * @param srtpContext
+     *    The sender context.
+     * @param buffer
+     *    The RTP packet.
+     * @param length
+     *    Length of the RTP packet.
+     * @param newLength
+     *    Gets the length of the SRTP packet.
+     * @return
+     *    1 if the packet was protected, 0 otherwise.
+     */
+    int32_t zrtp_protectSrtp(ZrtpSrtpContext* srtpContext, uint8_t* buffer, size_t length, size_t* newLength);
+
+    /**
+     * Unprotect an SRTP packet in place.
+     *
+     * @param srtpContext
+     *    The receiver context.
+     * @param buffer
+     *    The SRTP packet.
+     * @param length
+     *    Length of the SRTP packet.
+     * @param newLength
+     *    Gets the length of the RTP packet.
+     * @return
+     *    1 if the packet was unprotected, 0 if the packet is malformed,
+     *    -1 if the authentication failed, -2 if the replay check failed.
+     */
+    int32_t zrtp_unprotectSrtp(ZrtpSrtpContext* srtpContext, uint8_t* buffer, size_t length, size_t* newLength);
+
+    /**
+     * Protect a batch of RTP packets in place.
+     *
+     * The function sets the @c result and @c newLength of each packet as
+     * @c zrtp_protectSrtp does.
+     *
+     * @return
+     *    Number of protected packets.
+     */
+    int32_t zrtp_protectSrtpBatch(ZrtpSrtpContext* srtpContext, zrtp_SrtpPacket packets[], int32_t count);
+
+    /**
+     * Protect a batch of RTP packets of different sender contexts in place.
+     *
+     * Packet @c i uses the context @c srtpContexts[i], refer to
+     * @c SrtpHandler::protectMulti. The packets of a context must be in
+     * sending order. The function sets the @c result and @c newLength of each
+     * packet as @c zrtp_protectSrtp does.
+     *
+     * @return
+     *    Number of protected packets.
+     */
+    int32_t zrtp_protectSrtpMulti(ZrtpSrtpContext* srtpContexts[], zrtp_SrtpPacket packets[], int32_t count);
+
+    /**
+     * Unprotect a batch of SRTP packets in place.
+     *
+     * The function processes the packets in array order, thus the array should
+     * contain the packets in the order as received. It sets the @c result and
+     * @c newLength of each packet as @c zrtp_unprotectSrtp does.
+     *
+     * @return
+     *    Number of unprotected packets.
+     */
+    int32_t zrtp_unprotectSrtpBatch(ZrtpSrtpContext* srtpContext, zrtp_SrtpPacket packets[], int32_t count);
+
+    /**
+     * Protect an RTCP packet in place.
+     *
+     * The buffer must have room for the SRTCP index and the authentication tag.
+     *
+     * @return
+     *    1 if the packet was protected, 0 otherwise.
+     */
+    int32_t zrtp_protectSrtcp(ZrtpSrtpContext* srtpContext, uint8_t* buffer, size_t length, size_t* newLength);
+
+    /**
+     * Unprotect an SRTCP packet in place.
+     *
+     * @return
+     *    1 if the packet was unprotected, 0 if the packet is malformed,
+     *    -1 if the authentication failed, -2 if the replay check failed.
+     */
+    int32_t zrtp_unprotectSrtcp(ZrtpSrtpContext* srtpContext, uint8_t* buffer, size_t length, size_t* newLength);
+
+    /**
+     * Protect a batch of RTCP packets in place.
+     *
+     * @return
+     *    Number of protected packets.
+     */
+    int32_t zrtp_protectSrtcpBatch(ZrtpSrtpContext* srtpContext, zrtp_SrtpPacket packets[], int32_t count);
+
+    /**
+     * Unprotect a batch of SRTCP packets in place.
+     *
+     * @return
+     *    Number of unprotected packets.
+     */
+    int32_t zrtp_unprotectSrtcpBatch(ZrtpSrtpContext* srtpContext, zrtp_SrtpPacket packets[], int32_t count);
+
+#ifdef __cplusplus
+}
+#ifdef __GNUC__
+#pragma GCC visibility pop
+#endif
+#endif
+
+/**
+ * @}
+ */
+#endif
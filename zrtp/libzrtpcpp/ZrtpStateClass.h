@@ -25,6 +25,7 @@
  * @{
  */
 
+
 #include <libzrtpcpp/ZRtp.h>
 #include <libzrtpcpp/ZrtpStates.h>
 #include <libzrtpcpp/ZrtpPacketBase.h>
@@ -63,7 +64,35 @@ enum EventDataType {
     ZrtpClose,          ///< Close event, shut down state engine
     ZrtpPacket,         ///< Normal ZRTP message event, process according to state
     Timer,              ///< Timer event
-    ErrorPkt            ///< Error packet event
+    ErrorPkt,           ///< Error packet event
+    ZrtpKeyReady,       ///< Asynchronous DH key agreement is ready, resume protocol
+    ZrtpSignatureReady  ///< Asynchronous SAS signature is ready, resume protocol
+};
+
+/**
+ * The ZRTP message types.
+ *
+ * ZrtpStateClass::processEvent classifies the message type block of a received
+ * ZRTP message once, the state handlers check this type.
+ */
+enum ZrtpMessageType {
+    TypeUnknown = 0,    ///< Not a ZRTP message type or no ZRTP message event
+    TypeHello,          ///< Hello
+    TypeHelloAck,       ///< HelloACK
+    TypeCommit,         ///< Commit
+    TypeDHPart1,        ///< DHPart1
+    TypeDHPart2,        ///< DHPart2
+    TypeConfirm1,       ///< Confirm1
+    TypeConfirm2,       ///< Confirm2
+    TypeConf2Ack,       ///< Conf2ACK
+    TypeError,          ///< Error
+    TypeErrorAck,       ///< ErrorACK
+    TypeGoClear,        ///< GoClear
+    TypeClearAck,       ///< ClearACK
+    TypePing,           ///< Ping
+    TypePingAck,        ///< PingACK
+    TypeSASrelay,       ///< SASrelay
+    TypeRelayAck        ///< RelayACK
 };
 
 enum SecureSubStates {
@@ -122,6 +151,7 @@ private:
     ZRtp* parent;           ///< The ZRTP implementation
     ZrtpStates* engine;     ///< The state switching engine
     Event* event;           ///< Current event to process
+    ZrtpMessageType msgType;  ///< Message type of the current ZrtpPacket event
 
     /**
      * The last packet that was sent.
@@ -149,6 +179,12 @@ private:
      */
     bool multiStream;
 
+    /*
+     * If this is set to true the protocol engine acknowledges the peer's Hello
+     * with a Commit in state AckDetected, see ZrtpConfigure::setFastStart().
+     */
+    bool fastStart;
+
     // Secure substate to handle SAS relay packets
     SecureSubStates secSubstate;
 
@@ -175,7 +211,35 @@ private:
     
     int32_t retryCounters[ErrorRetry+1];  // TODO adjust
 
+    /**
+     * Round trip time estimation, refer to RFC 6298.
+     *
+     * The state engine measures the round trip time of the Hello/HelloAck and
+     * Commit/DHPart1 (or Confirm1) exchanges and derives the start value of
+     * the timers T1 and T2 from it.
+     */
+    uint64_t sentTime;      ///< Monotonic time in ms of the last sent packet that runs a timer
+    int32_t srtt;           ///< Smoothed round trip time in ms, -1 if no sample yet
+    int32_t rttvar;         ///< Round trip time variation in ms
+
+    /**
+     * Admission control of the DH handshakes, see ZrtpAdmission.
+     *
+     * The state engine holds a slot while it computes a DH result, nextState()
+     * also releases the slot if the handshake leaves the DH states.
+     */
+    bool admitted;          ///< The state engine holds a slot
+    bool admissionQueued;   ///< The handshake is counted as waiting for the admission
+    bool commitDelayed;     ///< Initiator in AckSent delays its Commit, timer TA active
+    int32_t deferredPackets; ///< Packets ignored while waiting for the admission
+    zrtpTimer_t TA;         ///< Timer to retry the admission of the delayed Commit
+
+    /// Process an event, the caller holds the synchronization lock
+    void handleEvent(Event *ev);
+
 public:
+    ZRTP_ALLOCATOR_OPERATORS
+
     /// Create a ZrtpStateClass
     ZrtpStateClass(ZRtp *p);
     ~ZrtpStateClass();
@@ -184,11 +248,34 @@ public:
     bool inState(const int32_t state) { return engine->inState(state); };
 
     /// Switch to the specified state
-    void nextState(int32_t state)        { engine->nextState(state); };
+    void nextState(int32_t state);
 
     /// Process an event, the main entry point into the state engine
     void processEvent(Event *ev);
 
+    /**
+     * Process a sequence of events under one acquisition of the synchronization lock.
+     *
+     * @param events
+     *    The events in the order of their arrival.
+     * @param count
+     *    Number of events.
+     */
+    void processEvents(Event *events, int32_t count);
+
+    /**
+     * Classify the message type block of a ZRTP message.
+     *
+     * Reads the 8 byte message type block as two 32-bit words and compares
+     * them case insensitive with the ZRTP message types.
+     *
+     * @param msgTypeBlock
+     *    Pointer to the message type block, 4 bytes after start of the ZRTP message
+     * @return
+     *    The message type or @c TypeUnknown.
+     */
+    static ZrtpMessageType classifyMessage(const uint8_t* msgTypeBlock);
+
     /**
      * The state event handling methods.
      *
@@ -256,6 +343,21 @@ public:
      */
     int32_t nextTimer(zrtpTimer_t *t);
 
+    /**
+     * Take a round trip time sample and adjust the timer start values.
+     *
+     * The state engine calls this method if it receives the response to the
+     * packet that the active timer monitors. If the timer resent the packet
+     * the response may belong to an earlier transmission. Karn's algorithm
+     * would drop such a sample, but then a long round trip never gets a
+     * sample at all. The method uses the previous timeout as lower bound of
+     * the sample instead.
+     *
+     * @param t
+     *    The ZRTP timer structure of the active timer.
+     */
+    void rttSample(zrtpTimer_t *t);
+
     /**
      * Cancel the active timer.
      *
@@ -296,6 +398,92 @@ public:
      */
     void timerFailed(int32_t subCode);
 
+    /**
+     * Handle a failed check of a received DHPart1 packet, we are Initiator.
+     *
+     * Sends an Error packet or restarts the Commit timer if the packet was ignored.
+     */
+    void dhPart1Failed(uint32_t errorCode);
+
+    /**
+     * Check the admission of a DH handshake step, see ZrtpAdmission.
+     *
+     * Counts the handshake as waiting if the step is not admitted. Multi-stream
+     * handshakes are always admitted.
+     *
+     * @param compute
+     *    true to take a slot for a DH computation, false to check if the state
+     *    engine may start a new handshake with a Commit.
+     * @return
+     *    true if the step is admitted.
+     */
+    bool admitHandshake(bool compute);
+
+    /**
+     * Check the admission of a received Commit, DHPart1 or DHPart2 packet.
+     *
+     * Without admission the state engine ignores the packet and the peer resends
+     * it. After some ignored packets the state engine processes the packet anyway.
+     *
+     * @param compute
+     *    true if the packet needs a DH computation, see admitHandshake().
+     * @return
+     *    true if the state engine processes the packet.
+     */
+    bool admitPacket(bool compute);
+
+    /**
+     * Admit the step even if the limit is reached.
+     *
+     * @param compute
+     *    true to take a slot for a DH computation.
+     */
+    void forceAdmission(bool compute);
+
+    /**
+     * Release the slot and remove the handshake from the waiting handshakes.
+     */
+    void releaseAdmission();
+
+    /**
+     * Start or restart the admission timer TA with a random jitter.
+     *
+     * @param first
+     *    true to start the timer, false to double the timeout.
+     * @return
+     *    1 timer was activated, 0 activation failed, -1 resend counter exceeded
+     */
+    int32_t admissionTimer(bool first);
+
+    /**
+     * Send the prepared Commit packet, switch to state CommitSent and start the Commit timer.
+     */
+    void sendCommit();
+
+    /**
+     * Send the DHPart2 packet, switch to state WaitConfirm1 and start the DHPart2 timer.
+     */
+    void sendDHPart2(ZrtpPacketDHPart* dhPart2);
+
+    /**
+     * Send the Confirm1 packet and switch to state WaitConfirm2.
+     */
+    void sendConfirm1(ZrtpPacketConfirm* confirm);
+
+    /**
+     * Enable the SRTP receiver, send the Confirm2 packet and switch to state WaitConfAck.
+     */
+    void sendConfirm2(ZrtpPacketConfirm* confirm);
+
+    /**
+     * Handle a Preshared Commit packet, we are Responder.
+     *
+     * Sends Confirm1 and switches to state WaitConfirm2. If we don't have a
+     * matching preshared key then sends a DH Commit, switches to state
+     * CommitSent and starts the Commit timer.
+     */
+    void presharedCommit(ZrtpPacketCommit* commit);
+
     /**
      * Set multi-stream mode flag.
      *
@@ -358,6 +546,11 @@ public:
      */
     void setT2Capping(int32_t capping) {T2.capping = capping;}
 
+    /**
+     * Enable or disable the fast start, see ZrtpConfigure::setFastStart().
+     */
+    void setFastStart(bool yesNo) {fastStart = yesNo;}
+
     /**
      * @brief Get required buffer size to get all 32-bit retry counters
      *
@@ -34,6 +34,8 @@
 #include <assert.h>
 #include <stdint.h>
 
+#include <common/ZrtpAllocator.h>
+
 class __EXPORT ZrtpStateClass;
 /**
  * This structure hold the state name as enum (int) number and the pointer to
@@ -55,6 +57,7 @@ typedef struct  {
 
 class __EXPORT ZrtpStates {
  public:
+    ZRTP_ALLOCATOR_OPERATORS
 
     /// Create an initialize state switching
     ZrtpStates(state_t* const zstates,
@@ -74,6 +77,9 @@ class __EXPORT ZrtpStates {
     /// Set the next state
     void nextState(int32_t s)        { state = s; }
 
+    /// Get the current state
+    int32_t getState() const         { return state; }
+
  private:
     const int32_t numStates;
     const state_t* states;
@@ -86,6 +86,7 @@ extern char KDFString[];
 extern char zrtpSessionKey[];
 extern char zrtpExportedKey[];
 extern char zrtpMsk[];
+extern char zrtpPsk[];
 extern char zrtpTrustedMitm[];
 
 
@@ -101,6 +102,7 @@ extern char aes1[];
 extern char two3[];
 extern char two2[];
 extern char two1[];
+extern char cc20[];
 
 extern const char* mandatoryCipher;
 
@@ -112,6 +114,7 @@ extern char e255[];
 extern char e414[];
 
 extern char mult[];
+extern char prsh[];
 
 extern const char* mandatoryPubKey;
 
@@ -125,6 +128,8 @@ extern char hs32[];
 extern char hs80[];
 extern char sk32[];
 extern char sk64[];
+extern char gc16[];
+extern char cp16[];
 extern const char* mandatoryAuthLen_1;
 extern const char* mandatoryAuthLen_2;
 
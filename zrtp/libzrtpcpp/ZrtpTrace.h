@@ -0,0 +1,302 @@
+/*
+ * Copyright 2026, the ZRTPCPP contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ZRTPTRACE_H_
+#define _ZRTPTRACE_H_
+
+/**
+ * @file ZrtpTrace.h
+ * @brief Record and replay the events of a ZRTP engine
+ * @ingroup GNU_ZRTP
+ * @{
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <deque>
+
+#include <common/osSpecifics.h>
+#include <cryptcommon/ZrtpRandom.h>
+#include <libzrtpcpp/ZrtpCallback.h>
+#include <libzrtpcpp/ZrtpConfigure.h>
+#include <libzrtpcpp/ZIDRecord.h>
+
+/**
+ * @brief The trace interface of a ZRtp engine.
+ *
+ * A ZRtp engine reports its events to the trace of its configuration, refer
+ * to ZrtpConfigure::setTrace: the received ZRTP messages, the sent ZRTP
+ * packets, the timer requests and timeouts, the random data it draws and the
+ * ZID cache record of the peer. The engine sets the trace as the random hook
+ * of its thread while it runs, thus the trace sees all random data of the
+ * engine, see ZrtpRandom::setThreadHook.
+ *
+ * The engine reads and saves the ZID record of the peer through the trace,
+ * the default functions use the ZID cache instance.
+ *
+ * The default functions of the trace events do nothing.
+ */
+class __EXPORT ZrtpTrace : public ZrtpRandomHook {
+public:
+    /**
+     * The record types of a trace file.
+     */
+    typedef enum {
+        Engine = 1,         //!< own ZID, client id and configuration of the engine
+        Start,              //!< startZrtpEngine
+        Received,           //!< processZrtpMessage: SSRC, length and the message
+        Sent,               //!< sendDataZRTP: the packet without the CRC
+        TimerStart,         //!< activateTimer: the time in ms
+        TimerCancel,        //!< cancelTimer
+        Timeout,            //!< processTimeout
+        Random,             //!< random data the engine drew
+        Cache,              //!< the ZID record of the peer when the engine read it
+        Stop                //!< stopZrtp
+    } RecordType;
+
+    virtual ~ZrtpTrace() {}
+
+    /**
+     * @brief A ZRtp engine was created.
+     *
+     * @param zid the own ZID of the engine
+     * @param clientId the client id of the engine
+     * @param config the configuration of the engine
+     * @param mitm true if the engine acts as trusted MitM
+     */
+    virtual void traceEngine(const uint8_t* zid, const std::string& clientId, ZrtpConfigure& config, bool mitm);
+
+    /// @brief The application started the engine.
+    virtual void traceStart() {}
+
+    /**
+     * @brief The engine received a ZRTP message.
+     *
+     * The parameters are the parameters of ZRtp::processZrtpMessage, the
+     * message follows the 12 byte RTP like header.
+     */
+    virtual void traceReceived(const uint8_t* message, uint32_t ssrc, size_t length);
+
+    /// @brief The engine sent a ZRTP packet, the parameters of ZrtpCallback::sendDataZRTP.
+    virtual void traceSent(const uint8_t* data, int32_t length);
+
+    /// @brief The engine started its timer.
+    virtual void traceTimerStart(int32_t time);
+
+    /// @brief The engine cancelled its timer.
+    virtual void traceTimerCancel() {}
+
+    /// @brief The timer of the engine expired.
+    virtual void traceTimeout() {}
+
+    /// @brief The application stopped the engine.
+    virtual void traceStop() {}
+
+    /**
+     * @brief Read the ZID record of the peer.
+     *
+     * The default function reads the record from the ZID cache instance.
+     *
+     * @return the record, the engine owns it
+     */
+    virtual ZIDRecord* getRecord(uint8_t* peerZid);
+
+    /**
+     * @brief Save the ZID record of the peer.
+     *
+     * The default function saves the record in the ZID cache instance.
+     */
+    virtual void saveRecord(ZIDRecord* record);
+};
+
+/**
+ * @brief Record the events of a ZRtp engine in a trace file.
+ *
+ * The trace file is a compact binary file. It starts with the magic bytes
+ * @c ZRTPTRC1, each record follows as
+ *
+ @verbatim
+ type (1 byte) | time delta (varint) | payload length (varint) | payload
+ @endverbatim
+ *
+ * The time delta is the number of micro-seconds since the record before, a
+ * varint is an unsigned LEB128 number, integers in the payload are in
+ * network order.
+ *
+ * The trace file contains the random data, the retained secrets and thus all
+ * keys of the session. Keep it as secret as the keys of the session itself.
+ *
+ @verbatim
+ ZrtpTraceRecorder recorder("call.trace");
+ ZrtpConfigure traced(config);
+ traced.setTrace(&recorder);
+ ZRtp* engine = new ZRtp(zid, callback, clientId, &traced);
+ @endverbatim
+ *
+ * The recorder must live as long as the engine.
+ */
+class __EXPORT ZrtpTraceRecorder : public ZrtpTrace {
+public:
+    /**
+     * @brief Create the trace file.
+     *
+     * @param fileName name of the trace file, an existing file is overwritten
+     */
+    explicit ZrtpTraceRecorder(const char* fileName);
+
+    ~ZrtpTraceRecorder();
+
+    /// @brief Check if the recorder could create the trace file.
+    bool isOpen() { return file != NULL; }
+
+    void traceEngine(const uint8_t* zid, const std::string& clientId, ZrtpConfigure& config, bool mitm) override;
+    void traceStart() override;
+    void traceReceived(const uint8_t* message, uint32_t ssrc, size_t length) override;
+    void traceSent(const uint8_t* data, int32_t length) override;
+    void traceTimerStart(int32_t time) override;
+    void traceTimerCancel() override;
+    void traceTimeout() override;
+    void traceStop() override;
+    ZIDRecord* getRecord(uint8_t* peerZid) override;
+    void randomDrawn(const uint8_t* buffer, uint32_t length) override;
+
+private:
+    void writeRecord(RecordType type, const uint8_t* payload, size_t length);
+
+    FILE* file;
+    uint64_t lastTime;
+};
+
+/**
+ * @brief Drive a ZRtp engine from a trace file.
+ *
+ * The replayer creates an engine with the own ZID, client id and
+ * configuration of the trace, provides the recorded random data and the
+ * recorded ZID record of the peer, and feeds the recorded start, received
+ * messages, timeouts and stop to the engine. The engine runs as fast as
+ * possible and works in the same way as the recorded engine did: it sends
+ * the same packets and requests the same timers. The replayer compares these
+ * outputs with the recorded ones, a mismatch shows that the engine behaves
+ * differently than the engine that wrote the trace.
+ *
+ * The replayer does not use and does not change the ZID cache.
+ *
+ * Only the random data of the ZRTP random generator is in the trace. If the
+ * engine uses another generator, for example the OpenSSL crypto backend, or
+ * the application draws random data in a callback of the recorded engine,
+ * the replay does not match.
+ */
+class __EXPORT ZrtpTraceReplayer : public ZrtpTrace, public ZrtpCallback {
+public:
+    /**
+     * The result of a replay.
+     */
+    typedef struct _Result {
+        int64_t recordedTime;       //!< micro-seconds from the first to the last record of the trace
+        int64_t wallTime;           //!< micro-seconds of the replay
+        int64_t cpuTime;            //!< thread CPU time of the replay in micro-seconds
+        int32_t events;             //!< events fed to the engine
+        int32_t outputs;            //!< sent packets and timer requests of the engine
+        int32_t mismatches;         //!< outputs that differ from the recorded ones
+        int32_t randomMismatches;   //!< random requests without matching recorded data
+        bool secure;                //!< the engine reached the secure state
+        bool failed;                //!< the negotiation failed
+    } Result;
+
+    ZrtpTraceReplayer();
+
+    /**
+     * @brief Load a trace file.
+     *
+     * @param fileName name of the trace file
+     * @return false if the file does not exist or is not a valid trace, see getError
+     */
+    bool load(const char* fileName);
+
+    /**
+     * @brief Replay the loaded trace once.
+     *
+     * Each replay creates a new engine, thus a benchmark calls it repeatedly.
+     *
+     * @param result receives the result of the replay
+     * @return false if no trace is loaded
+     */
+    bool replay(Result* result);
+
+    /// @brief Get the reason why load failed.
+    const std::string& getError() { return error; }
+
+    // ZrtpTrace
+    ZIDRecord* getRecord(uint8_t* peerZid) override;
+    void saveRecord(ZIDRecord* record) override {}
+    void traceSent(const uint8_t* data, int32_t length) override;
+    void traceTimerStart(int32_t time) override;
+    void traceTimerCancel() override;
+    bool provideRandom(uint8_t* buffer, uint32_t length) override;
+
+    // ZrtpCallback, the engine of the replay uses the replayer as callback
+    int32_t sendDataZRTP(const uint8_t* data, int32_t length) override { return 1; }
+    int32_t activateTimer(int32_t time) override { return 1; }
+    int32_t cancelTimer() override { return 1; }
+    void sendInfo(GnuZrtpCodes::MessageSeverity severity, int32_t subCode) override {}
+    bool srtpSecretsReady(SrtpSecret_t* secrets, EnableSecurity part) override { return true; }
+    void srtpSecretsOff(EnableSecurity part) override {}
+    void srtpSecretsOn(std::string c, std::string s, bool verified) override { secure = true; }
+    void handleGoClear() override {}
+    void zrtpNegotiationFailed(GnuZrtpCodes::MessageSeverity severity, int32_t subCode) override { failed = true; }
+    void zrtpNotSuppOther() override { failed = true; }
+    void synchEnter() override {}
+    void synchLeave() override {}
+    void zrtpAskEnrollment(GnuZrtpCodes::InfoEnrollment info) override {}
+    void zrtpInformEnrollment(GnuZrtpCodes::InfoEnrollment info) override {}
+    void signSAS(uint8_t* sasHash) override {}
+    bool checkSASSignature(uint8_t* sasHash) override { return true; }
+
+private:
+    typedef struct _Record {
+        uint8_t type;
+        uint64_t delta;
+        std::vector<uint8_t> payload;
+    } Record;
+
+    bool parseEngine(const std::vector<uint8_t>& payload);
+    void checkOutput(RecordType type, const uint8_t* data, size_t length);
+
+    std::vector<Record> records;
+    std::string error;
+
+    // The engine parameters of the trace
+    uint8_t zid[IDENTIFIER_LEN];
+    std::string clientId;
+    bool mitm;
+    ZrtpConfigure configure;
+
+    // The state of the running replay
+    std::deque<const Record*> randoms;
+    std::deque<const Record*> outputs;
+    const Record* cache;
+    Result* current;
+    bool secure;
+    bool failed;
+};
+
+/**
+ * @}
+ */
+#endif
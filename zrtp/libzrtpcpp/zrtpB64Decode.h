@@ -32,6 +32,14 @@ int base64_decode_value(char value_in);
 
 int base64_decode_block(const char* code_in, const int length_in, uint8_t *plaintext_out, base64_decodestate* state_in);
 
+/*
+ * Decode a buffer in one call. The function skips characters that are not base64
+ * characters (padding, line breaks) like base64_decode_block. It does not use
+ * lookup tables and does not write beyond length_out bytes. Returns the number of
+ * decoded bytes or -1 if plaintext_out is too small.
+ */
+int base64_decode_buffer(const char *code_in, int length_in, uint8_t *plaintext_out, int length_out);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -35,6 +35,14 @@ char base64_encode_value(const int8_t value_in);
 int base64_encode_block(const uint8_t *plaintext_in, int length_in, char* code_out, base64_encodestate* state_in);
 
 int base64_encode_blockend(char *code_out, base64_encodestate* state_in);
+
+/*
+ * Encode a buffer in one call, with padding and without line breaks. The function
+ * does not use lookup tables, its run time depends on the length only. It does not
+ * terminate the string. Returns the number of characters or -1 if code_out is too
+ * small, it needs 4 characters for each 3 (or less) bytes.
+ */
+int base64_encode_buffer(const uint8_t *plaintext_in, int length_in, char *code_out, int length_out);
 #if defined(__cplusplus)
 }
 #endif
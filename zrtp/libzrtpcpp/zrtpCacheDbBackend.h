@@ -67,6 +67,35 @@ typedef struct {
      */
     int (*openCache)(const char* name, void **pdb, char *errString);
 
+    /**
+     * @brief Open an encrypted cache.
+     *
+     * The function keys the database before it reads the first table. With
+     * a passphrase the database derives the key with PBKDF2 on every open,
+     * a raw key avoids this. The database reads the salt from the file if
+     * the raw key does not contain it.
+     *
+     * @param name String that identifies the database or data storage.
+     *
+     * @param pdb Pointer to an internal structure that the database
+     *            implementation requires.
+     *
+     * @param key the passphrase or the raw key, no key if @c NULL
+     *
+     * @param keyLength length of the key in bytes, a raw key has 32 bytes or
+     *                  48 bytes with the salt appended
+     *
+     * @param rawKey if not zero then @c key is the raw database key
+     *
+     * @param kdfIterations the PBKDF2 iterations of a passphrase, 0 uses
+     *                      the database default
+     *
+     * @param errString Pointer to a character buffer, see implementation
+     *                  notes above.
+     */
+    int (*openCacheKeyed)(const char* name, void **pdb, const uint8_t *key, int32_t keyLength,
+                          int32_t rawKey, int32_t kdfIterations, char *errString);
+
     /**
      * Close the cache.
      *
@@ -359,6 +388,211 @@ typedef struct {
      * @param stmt a void pointer to a sqlite3 statement (SQL cursor)
      */
     void (*closeStatement)(void *vstmt);
+
+    /**
+     * @brief Begin a transaction.
+     *
+     * The database stores all changes up to the next @c commitTransaction
+     * in one transaction.
+     *
+     * @param db Pointer to an internal structure that the database
+     *           implementation requires.
+     *
+     * @param errString Pointer to a character buffer, see implementation
+     *                  notes above.
+     */
+    int (*beginTransaction)(void *db, char* errString);
+
+    /**
+     * @brief Commit a transaction.
+     *
+     * @param db Pointer to an internal structure that the database
+     *           implementation requires.
+     *
+     * @param errString Pointer to a character buffer, see implementation
+     *                  notes above.
+     */
+    int (*commitTransaction)(void *db, char* errString);
+
+    /**
+     * @brief Set the journal mode and the synchronous level of the database.
+     *
+     * @param db Pointer to an internal structure that the database
+     *           implementation requires.
+     *
+     * @param writeAheadLog If not zero use a write ahead log (WAL), otherwise
+     *                      the standard rollback journal.
+     *
+     * @param synchronous The SQLite synchronous level: 0 (OFF), 1 (NORMAL),
+     *                    2 (FULL) or 3 (EXTRA).
+     *
+     * @param errString Pointer to a character buffer, see implementation
+     *                  notes above.
+     */
+    int (*configureJournal)(void *db, int32_t writeAheadLog, int32_t synchronous, char* errString);
+
+    /**
+     * @brief Prepare a SQL cursor to read the remote ZID records of a local ZID.
+     *
+     * Same as @c prepareReadAllZid, but the cursor returns only the records
+     * that belong to @c localZid. Use @c readNextZidRecord to read the records.
+     *
+     * @param db Pointer to an internal structure that the database
+     *           implementation requires.
+     *
+     * @param localZid the local ZID of the records
+     *
+     * @param errString Pointer to a character buffer, see implementation
+     *                  notes above.
+     *
+     * @return a void pointer to the sqlite3 statment (SQL cursor) or @c NULL
+     */
+    void *(*prepareReadLocalZid)(void *db, const uint8_t *localZid, char *errString);
+
+    /**
+     * @brief Delete stale remote ZID records.
+     *
+     * A record is stale if it is not valid or if it has neither a valid and
+     * not expired RS1 or RS2 nor a trusted PBX key.
+     *
+     * @param db Pointer to an internal structure that the database
+     *           implementation requires.
+     *
+     * @param localZid the local ZID of the records
+     *
+     * @param now the current time, seconds since Unix epoch
+     *
+     * @param limit the function deletes at most this number of records
+     *
+     * @param deleted gets the number of deleted records
+     *
+     * @param errString Pointer to a character buffer, see implementation
+     *                  notes above.
+     */
+    int (*deleteStaleRemoteZidRecords)(void *db, const uint8_t *localZid, int64_t now, int32_t limit,
+                                       int32_t *deleted, char *errString);
+
+    /**
+     * @brief Replace the local ZID of an account.
+     *
+     * @param db Pointer to an internal structure that the database
+     *           implementation requires.
+     *
+     * @param localZid the new local ZID
+     *
+     * @param accountInfo the account, @c NULL for the standard account, see
+     *                    @c readLocalZid
+     *
+     * @param errString Pointer to a character buffer, see implementation
+     *                  notes above.
+     */
+    int (*writeLocalZid)(void *db, const uint8_t *localZid, const char *accountInfo, char *errString);
+
+    /**
+     * @brief Delete stale remote ZID records in a range of records.
+     *
+     * The function checks at most @c limit records in row id order, starting
+     * behind the record that @c rowid refers to, and deletes the stale
+     * records of this range, see @c deleteStaleRemoteZidRecords. Repeated
+     * calls scan the table incrementally.
+     *
+     * @param db Pointer to an internal structure that the database
+     *           implementation requires.
+     *
+     * @param localZid the local ZID of the records
+     *
+     * @param now the current time, seconds since Unix epoch
+     *
+     * @param rowid on input the row id of the last record that the previous
+     *              call checked, 0 to start with the first record. On output
+     *              the row id of the last checked record, 0 if the function
+     *              reached the end of the table
+     *
+     * @param limit the function checks at most this number of records
+     *
+     * @param deleted gets the number of deleted records
+     *
+     * @param errString Pointer to a character buffer, see implementation
+     *                  notes above.
+     */
+    int (*deleteStaleRemoteZidRange)(void *db, const uint8_t *localZid, int64_t now, int64_t *rowid,
+                                     int32_t limit, int32_t *deleted, char *errString);
+
+    /**
+     * @brief Prepare a SQL cursor to read the local ZIDs of all accounts.
+     *
+     * The cursor returns the local ZIDs that @c readLocalZid stored for an
+     * account, not the local ZID of the standard account. Use
+     * @c readNextAccountZid to read the ZIDs.
+     *
+     * @param db Pointer to an internal structure that the database
+     *           implementation requires.
+     *
+     * @param errString Pointer to a character buffer, see implementation
+     *                  notes above.
+     *
+     * @return a void pointer to the sqlite3 statment (SQL cursor) or @c NULL
+     */
+    void *(*prepareReadAccountZids)(void *db, char *errString);
+
+    /**
+     * @brief Read the next local ZID and its account from an SQL cursor.
+     *
+     * Same as @c readNextZidRecord, the function closes the cursor and
+     * returns @c NULL if no more ZID is available or it got an error.
+     *
+     * @param db Pointer to an internal structure that the database
+     *           implementation requires.
+     *
+     * @param stmt a void pointer to a sqlite3 statement (SQL cursor)
+     *
+     * @param localZid Pointer to a buffer of at least @c IDENTIFIER_LEN @c
+     *                 bytes, gets the local ZID.
+     *
+     * @param accountInfo Pointer to a buffer that gets the account
+     *                    information string, the function skips accounts
+     *                    that do not fit into the buffer.
+     *
+     * @param accountLength Length of the @c accountInfo buffer in bytes.
+     *
+     * @param errString Pointer to a character buffer, see implementation
+     *                  notes above.
+     *
+     * @return void pointer to statment if successful, this is the same pointer as
+     *         the @c stmt input parameter, @c NULL otherwise.
+     */
+    void *(*readNextAccountZid)(void *db, void *stmt, uint8_t *localZid, char *accountInfo, int32_t accountLength,
+                                char *errString);
+
+    /**
+     * @brief Open another connection to a cache.
+     *
+     * The connection has its own prepared statements and no mutex, only
+     * one thread at a time may use it. The function neither creates nor
+     * upgrades the tables, open the cache with @c openCache or @c
+     * openCacheKeyed first. With a write ahead log (see @c
+     * configureJournal) reads on several connections run in parallel.
+     * Close the connection with @c closeCache.
+     *
+     * @param name String that identifies the database or data storage.
+     *
+     * @param pdb Pointer to an internal structure that the database
+     *            implementation requires.
+     *
+     * @param key the passphrase or the raw key of an encrypted cache, no key if @c NULL
+     *
+     * @param keyLength length of the key in bytes
+     *
+     * @param rawKey if not zero then @c key is the raw database key
+     *
+     * @param kdfIterations the PBKDF2 iterations of a passphrase, 0 uses
+     *                      the database default
+     *
+     * @param errString Pointer to a character buffer, see implementation
+     *                  notes above.
+     */
+    int (*openCacheConnection)(const char* name, void **pdb, const uint8_t *key, int32_t keyLength,
+                               int32_t rawKey, int32_t kdfIterations, char *errString);
 } dbCacheOps_t;
 
 void getDbCacheOps(dbCacheOps_t *ops);
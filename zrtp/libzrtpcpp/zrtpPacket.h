@@ -110,7 +110,7 @@ typedef struct HelloAckPacket {
  * has a fixed size. The data structure defines the maximum
  * Commit message. During the ZRTP protocol the implementation
  * uses fileds according to the use case (DH handshake,
- * Multi-stream handshake) and adjusts the length.
+ * Multi-stream handshake, Preshared handshake) and adjusts the length.
  */
 typedef struct Commit {
     uint8_t hashH2[HASH_IMAGE_SIZE];        ///< The second hash of the hash chain (chap. 9)
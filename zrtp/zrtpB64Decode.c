@@ -12,7 +12,7 @@ int base64_decode_value(char value_in)
     static const char decoding[] = {62,-1,-1,-1,63,52,53,54,55,56,57,58,59,60,61,-1,-1,-1,-2,-1,-1,-1,0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,-1,-1,-1,-1,-1,-1,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40,41,42,43,44,45,46,47,48,49,50,51};
     static const char decoding_size = sizeof(decoding);
     value_in -= 43;
-    if (value_in < 0 || value_in > decoding_size) return -1;
+    if (value_in < 0 || value_in >= decoding_size) return -1;
     return decoding[(int)value_in];
 }
 
@@ -86,3 +86,55 @@ int base64_decode_block(const char* code_in, const int length_in, uint8_t *plain
     return plainchar - plaintext_out;
 }
 
+/*
+ * Map a base64 character to its 6 bit value without a table lookup, returns -1
+ * if the character is not a base64 character. Each range check produces a mask
+ * that is all ones if the character is inside the range.
+ */
+static int decode_sextet(int c)
+{
+    int result = -1;
+
+    result += (((0x40 - c) & (c - 0x5b)) >> 8) & (c - 64);  /* 'A'..'Z' -> 0..25 */
+    result += (((0x60 - c) & (c - 0x7b)) >> 8) & (c - 70);  /* 'a'..'z' -> 26..51 */
+    result += (((0x2f - c) & (c - 0x3a)) >> 8) & (c + 5);   /* '0'..'9' -> 52..61 */
+    result += (((0x2a - c) & (c - 0x2c)) >> 8) & 63;        /* '+' -> 62 */
+    result += (((0x2e - c) & (c - 0x30)) >> 8) & 64;        /* '/' -> 63 */
+    return result;
+}
+
+int base64_decode_buffer(const char *code_in, int length_in, uint8_t *plaintext_out, int length_out)
+{
+    uint32_t word = 0;
+    int sextets = 0;
+    int length = 0;
+    int i;
+
+    for (i = 0; i < length_in; i++) {
+        int value = decode_sextet((unsigned char)code_in[i]);
+
+        /* skip padding and other characters, as base64_decode_block does */
+        if (value < 0)
+            continue;
+        word = (word << 6) | (uint32_t)value;
+        if (++sextets == 4) {
+            if (length + 3 > length_out)
+                return -1;
+            plaintext_out[length++] = (uint8_t)(word >> 16);
+            plaintext_out[length++] = (uint8_t)(word >> 8);
+            plaintext_out[length++] = (uint8_t)word;
+            sextets = 0;
+            word = 0;
+        }
+    }
+    /* 2 sextets hold one byte, 3 sextets two bytes */
+    if (sextets >= 2) {
+        if (length + sextets - 1 > length_out)
+            return -1;
+        word <<= 6 * (4 - sextets);
+        plaintext_out[length++] = (uint8_t)(word >> 16);
+        if (sextets == 3)
+            plaintext_out[length++] = (uint8_t)(word >> 8);
+    }
+    return length;
+}
@@ -114,3 +114,49 @@ int base64_encode_blockend(char* code_out, base64_encodestate* state_in)
     return codechar - code_out;
 }
 
+/*
+ * Map a 6 bit value to its base64 character without a table lookup. The masks
+ * are all ones if the value is larger than the limit, thus the run time and the
+ * memory accesses do not depend on the data, for example the SDES keys.
+ */
+static char encode_sextet(int value)
+{
+    int result = value + 'A';
+
+    result += ((25 - value) >> 8) & 6;      /* 26..51 -> 'a'..'z' */
+    result -= ((51 - value) >> 8) & 75;     /* 52..61 -> '0'..'9' */
+    result -= ((61 - value) >> 8) & 15;     /* 62 -> '+' */
+    result += ((62 - value) >> 8) & 3;      /* 63 -> '/' */
+    return (char)result;
+}
+
+int base64_encode_buffer(const uint8_t *plaintext_in, int length_in, char *code_out, int length_out)
+{
+    char *codechar = code_out;
+    int i;
+
+    if (length_in < 0 || length_out < ((length_in + 2) / 3) * 4)
+        return -1;
+
+    for (i = 0; i + 3 <= length_in; i += 3) {
+        uint32_t word = ((uint32_t)plaintext_in[i] << 16) | ((uint32_t)plaintext_in[i+1] << 8) | plaintext_in[i+2];
+
+        codechar[0] = encode_sextet((word >> 18) & 0x3f);
+        codechar[1] = encode_sextet((word >> 12) & 0x3f);
+        codechar[2] = encode_sextet((word >> 6) & 0x3f);
+        codechar[3] = encode_sextet(word & 0x3f);
+        codechar += 4;
+    }
+    if (i < length_in) {
+        uint32_t word = (uint32_t)plaintext_in[i] << 16;
+
+        if (i + 1 < length_in)
+            word |= (uint32_t)plaintext_in[i+1] << 8;
+        codechar[0] = encode_sextet((word >> 18) & 0x3f);
+        codechar[1] = encode_sextet((word >> 12) & 0x3f);
+        codechar[2] = (i + 1 < length_in) ? encode_sextet((word >> 6) & 0x3f) : '=';
+        codechar[3] = '=';
+        codechar += 4;
+    }
+    return codechar - code_out;
+}
@@ -33,7 +33,6 @@
 
 #include <crypto/zrtpDH.h>
 
-#include <libzrtpcpp/zrtpB64Encode.h>
 #include <libzrtpcpp/zrtpB64Decode.h>
 
 #include <libzrtpcpp/zrtpCacheDbBackend.h>
@@ -51,10 +50,16 @@
 # define snprintf _snprintf
 #endif
 
-#ifdef TRANSACTIONS
+#ifdef SQL_CIPHER
+/*
+ * memset_volatile is a volatile pointer to the memset function, the
+ * compiler does not optimise the call away that clears the hex raw key.
+ */
+static void * (*volatile memset_volatile)(void *, int, size_t) = memset;
+#endif
+
 static const char *beginTransactionSql  = "BEGIN TRANSACTION;";
 static const char *commitTransactionSql = "COMMIT;";
-#endif
 
 /*
  * The database backend uses the following definitions if it implements the localZid storage.
@@ -67,6 +72,17 @@ static const int32_t localZidWithAccount      = 2;
 /* Default data for account info if none specified */
 static const char *defaultAccountString = "_STANDARD_";
 
+/*
+ * Version of the ZRTP cache tables, stored in the SQLite user_version.
+ *
+ * Version 0 tables store the ZIDs as base64 text and have no index. Version 1
+ * tables store the ZIDs as 12 byte BLOBs and have unique indexes on the ZIDs.
+ */
+static const int32_t cacheSchemaVersion = 1;
+
+/* Busy timeout of the additional connections in milliseconds */
+static const int connectionBusyTimeout = 1000;
+
 
 /* *****************************************************************************
  * The SQLite master table.
@@ -82,10 +98,12 @@ static char *lookupTables = "SELECT name FROM sqlite_master WHERE type='table' A
 static const char *dropZrtpIdOwn =      "DROP TABLE zrtpIdOwn;";
 
 /* SQLite doesn't care about the VARCHAR length. */
-static char *createZrtpIdOwn = "CREATE TABLE zrtpIdOwn(localZid CHAR(18), type INTEGER, accountInfo VARCHAR(1000));";
+static char *createZrtpIdOwn = "CREATE TABLE zrtpIdOwn(localZid BLOB(12), type INTEGER, accountInfo VARCHAR(1000));";
 
 static char *selectZrtpIdOwn = "SELECT localZid FROM zrtpIdOwn WHERE type = ?1 AND accountInfo = ?2;";
 static char *insertZrtpIdOwn = "INSERT INTO zrtpIdOwn (localZid, type, accountInfo) VALUES (?1, ?2, ?3);";
+static char *updateZrtpIdOwn = "UPDATE zrtpIdOwn SET localZid = ?1 WHERE type = ?2 AND accountInfo = ?3;";
+static char *selectZrtpIdOwnAccounts = "SELECT localZid, accountInfo FROM zrtpIdOwn WHERE type = ?1 ORDER BY rowid;";
 
 
 /* *****************************************************************************
@@ -95,11 +113,14 @@ static const char *dropZrtpIdRemote =      "DROP TABLE zrtpIdRemote;";
 
 static const char *createZrtpIdRemote = 
     "CREATE TABLE zrtpIdRemote "
-    "(remoteZid CHAR(16),  localZid CHAR(16), flags INTEGER,"
+    "(remoteZid BLOB(12),  localZid BLOB(12), flags INTEGER,"
     "rs1 BLOB(32), rs1LastUsed TIMESTAMP, rs1TimeToLive TIMESTAMP," 
     "rs2 BLOB(32), rs2LastUsed TIMESTAMP, rs2TimeToLive TIMESTAMP,"
     "mitmKey BLOB(32), mitmLastUsed TIMESTAMP, secureSince TIMESTAMP, preshCounter INTEGER);";
 
+static const char *createZrtpIdRemoteIndex =
+    "CREATE UNIQUE INDEX IF NOT EXISTS zrtpIdRemoteZids ON zrtpIdRemote (remoteZid, localZid);";
+
 static const char *selectZrtpIdRemoteAll = 
     "SELECT flags,"
     "rs1, strftime('%s', rs1LastUsed, 'unixepoch'), strftime('%s', rs1TimeToLive, 'unixepoch'),"
@@ -137,6 +158,32 @@ static const char *selectZrtpIdRemoteAllNoCondition =
     "preshCounter, remoteZid "
     "FROM zrtpIdRemote ORDER BY secureSince DESC;";
 
+static const char *selectZrtpIdRemoteLocal =
+    "SELECT flags,"
+    "rs1, strftime('%s', rs1LastUsed, 'unixepoch'), strftime('%s', rs1TimeToLive, 'unixepoch'),"
+    "rs2, strftime('%s', rs2LastUsed, 'unixepoch'), strftime('%s', rs2TimeToLive, 'unixepoch'),"
+    "mitmKey, strftime('%s', mitmLastUsed, 'unixepoch'), strftime('%s', secureSince, 'unixepoch'),"
+    "preshCounter, remoteZid "
+    "FROM zrtpIdRemote WHERE localZid=?1;";
+
+/* Stale: not valid (0x1) or no trusted PBX key (0x10) and neither a live RS1 (0x4) nor a live RS2 (0x8) */
+#define STALE_ZRTP_ID_REMOTE \
+    "((flags & 1) = 0 OR ((flags & 16) = 0 AND " \
+    "NOT ((flags & 4) != 0 AND (rs1TimeToLive = -1 OR (rs1TimeToLive != 0 AND rs1TimeToLive >= ?2))) AND " \
+    "NOT ((flags & 8) != 0 AND (rs2TimeToLive = -1 OR (rs2TimeToLive != 0 AND rs2TimeToLive >= ?2)))))"
+
+static const char *deleteStaleZrtpIdRemote =
+    "DELETE FROM zrtpIdRemote WHERE rowid IN (SELECT rowid FROM zrtpIdRemote WHERE localZid=?1 AND "
+    STALE_ZRTP_ID_REMOTE " LIMIT ?3);";
+
+/* The last row id and the number of records of the range that starts behind row id ?2 */
+static const char *selectZrtpIdRemoteRange =
+    "SELECT MAX(rowid), COUNT(*) FROM (SELECT rowid FROM zrtpIdRemote WHERE localZid=?1 AND rowid > ?2 "
+    "ORDER BY rowid LIMIT ?3);";
+
+static const char *deleteStaleZrtpIdRemoteRange =
+    "DELETE FROM zrtpIdRemote WHERE localZid=?1 AND rowid > ?3 AND rowid <= ?4 AND " STALE_ZRTP_ID_REMOTE ";";
+
 
 /* *****************************************************************************
  * SQL statements to process the name table.
@@ -148,9 +195,12 @@ static const char *dropZrtpNames = "DROP TABLE zrtpNames;";
 
 static const char *createZrtpNames =
     "CREATE TABLE zrtpNames "
-    "(remoteZid CHAR(16), localZid CHAR(16), flags INTEGER, "
+    "(remoteZid BLOB(12), localZid BLOB(12), flags INTEGER, "
     "lastUpdate TIMESTAMP, accountInfo VARCHAR(1000), name VARCHAR(1000));";
 
+static const char *createZrtpNamesIndex =
+    "CREATE UNIQUE INDEX IF NOT EXISTS zrtpNamesZids ON zrtpNames (remoteZid, localZid, accountInfo);";
+
 static const char *selectZrtpNames =
     "SELECT flags, strftime('%s', lastUpdate, 'unixepoch'), name "
     "FROM zrtpNames "
@@ -169,6 +219,65 @@ static const char *updateZrtpNames =
     "WHERE remoteZid=?1 AND localZid=?2 AND accountInfo=?3;";
 
 
+/* *****************************************************************************
+ * SQL statements to upgrade version 0 tables.
+ *
+ * The upgrade converts the base64 ZIDs to BLOBs in place and keeps the first row
+ * of duplicate rows, the unique indexes do not allow duplicates.
+ */
+static const char *selectTextZidsOwn =
+    "SELECT rowid, localZid FROM zrtpIdOwn WHERE typeof(localZid)='text';";
+static const char *updateBlobZidsOwn =
+    "UPDATE zrtpIdOwn SET localZid=?1 WHERE rowid=?2;";
+
+static const char *selectTextZidsRemote =
+    "SELECT rowid, remoteZid, localZid FROM zrtpIdRemote WHERE typeof(remoteZid)='text';";
+static const char *updateBlobZidsRemote =
+    "UPDATE zrtpIdRemote SET remoteZid=?1, localZid=?2 WHERE rowid=?3;";
+
+static const char *selectTextZidsNames =
+    "SELECT rowid, remoteZid, localZid FROM zrtpNames WHERE typeof(remoteZid)='text';";
+static const char *updateBlobZidsNames =
+    "UPDATE zrtpNames SET remoteZid=?1, localZid=?2 WHERE rowid=?3;";
+
+static const char *deleteDuplicateRemote =
+    "DELETE FROM zrtpIdRemote WHERE rowid NOT IN "
+    "(SELECT MIN(rowid) FROM zrtpIdRemote GROUP BY remoteZid, localZid);";
+static const char *deleteDuplicateNames =
+    "DELETE FROM zrtpNames WHERE rowid NOT IN "
+    "(SELECT MIN(rowid) FROM zrtpNames GROUP BY remoteZid, localZid, accountInfo);";
+
+static const char *beginUpgradeSql    = "BEGIN TRANSACTION;";
+static const char *commitUpgradeSql   = "COMMIT;";
+static const char *rollbackUpgradeSql = "ROLLBACK;";
+
+static const char *selectUserVersion = "PRAGMA user_version;";
+
+
+/* *****************************************************************************
+ * The prepared statements of an open cache.
+ *
+ * The functions prepare a statement when they use it the first time and reset it
+ * after use. closeCache and clearCache finalize the statements.
+ */
+typedef enum {
+    StmtSelectIdOwn = 0,
+    StmtInsertIdOwn,
+    StmtSelectIdRemote,
+    StmtInsertIdRemote,
+    StmtUpdateIdRemote,
+    StmtSelectNames,
+    StmtInsertNames,
+    StmtUpdateNames,
+    NumberOfStatements
+} cacheStatement_t;
+
+typedef struct {
+    sqlite3 *db;
+    sqlite3_stmt *statements[NumberOfStatements];
+} sqliteCache_t;
+
+
 /* *****************************************************************************
  * A few helping macros. 
  * These macros require some names/patterns in the methods that use these 
@@ -193,31 +302,61 @@ static const char *updateZrtpNames =
         }                                                               \
     }
 
-static int b64Encode(const uint8_t *binData, int32_t binLength, char *b64Data, int32_t b64Length)
+static int b64Decode(const char *b64Data, int32_t b64length, uint8_t *binData, int32_t binLength)
 {
-    base64_encodestate _state;
-    int codelength;
+    return base64_decode_buffer(b64Data, b64length, binData, binLength);
+}
 
-    base64_init_encodestate(&_state, 0);
-    codelength = base64_encode_block(binData, binLength, b64Data, &_state);
-    codelength += base64_encode_blockend(b64Data+codelength, &_state);
+/*
+ * Get a prepared statement of the cache, prepare it if the cache does not have it yet.
+ */
+static int prepareStatement(sqliteCache_t *cache, cacheStatement_t id, const char *sql, sqlite3_stmt **stmt)
+{
+    int rc = SQLITE_OK;
 
-    return codelength;
+    if (cache->statements[id] == NULL) {
+        rc = SQLITE_PREPARE(cache->db, sql, strlen(sql)+1, &cache->statements[id], NULL);
+    }
+    *stmt = cache->statements[id];
+    return rc;
 }
 
-static int b64Decode(const char *b64Data, int32_t b64length, uint8_t *binData, int32_t binLength)
+static void finalizeStatements(sqliteCache_t *cache)
 {
-    base64_decodestate _state;
-    int codelength;
+    int i;
+
+    for (i = 0; i < NumberOfStatements; i++) {
+        sqlite3_finalize(cache->statements[i]);
+        cache->statements[i] = NULL;
+    }
+}
 
-    base64_init_decodestate(&_state);
-    codelength = base64_decode_block(b64Data, b64length, binData, &_state);
-    return codelength;
+/*
+ * Execute a SQL statement that returns no data or data the caller does not need.
+ */
+static int executeSql(sqlite3 *db, const char *sql, char *errString)
+{
+    sqlite3_stmt *stmt;
+    int rc;
+
+    SQLITE_CHK(SQLITE_PREPARE(db, sql, strlen(sql)+1, &stmt, NULL));
+
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE && rc != SQLITE_ROW) {
+        ERRMSG;
+        return rc;
+    }
+    return SQLITE_OK;
+
+ cleanup:
+    sqlite3_finalize(stmt);
+    return rc;
 }
 
-#ifdef TRANSACTIONS
-static int beginTransaction(sqlite3 *db, char* errString)
+static int beginTransaction(void *vdb, char* errString)
 {
+    sqlite3 *db = ((sqliteCache_t*)vdb)->db;
     sqlite3_stmt *stmt;
     int rc;
 
@@ -236,8 +375,9 @@ static int beginTransaction(sqlite3 *db, char* errString)
     return rc;
 }
 
-static int commitTransaction(sqlite3 *db, char* errString)
+static int commitTransaction(void *vdb, char* errString)
 {
+    sqlite3 *db = ((sqliteCache_t*)vdb)->db;
     sqlite3_stmt *stmt;
     int rc;
 
@@ -255,7 +395,23 @@ static int commitTransaction(sqlite3 *db, char* errString)
     sqlite3_finalize(stmt);
     return rc;
 }
-#endif
+
+/*
+ * Switch between the WAL and the standard rollback journal and set the synchronous level.
+ */
+static int configureJournal(void *vdb, int32_t writeAheadLog, int32_t synchronous, char* errString)
+{
+    sqlite3 *db = ((sqliteCache_t*)vdb)->db;
+    char sql[64];
+    int rc;
+
+    rc = executeSql(db, writeAheadLog ? "PRAGMA journal_mode=WAL;" : "PRAGMA journal_mode=DELETE;", errString);
+    if (rc != SQLITE_OK)
+        return rc;
+
+    snprintf(sql, sizeof(sql), "PRAGMA synchronous=%d;", synchronous);
+    return executeSql(db, sql, errString);
+}
 
 /**
  * Initialize remote ZID and remote name tables.
@@ -295,6 +451,8 @@ static int initializeRemoteTables(sqlite3 *db, char* errString)
         ERRMSG;
         return rc;
     }
+    SQLITE_CHK(executeSql(db, createZrtpIdRemoteIndex, errString));
+    SQLITE_CHK(executeSql(db, createZrtpNamesIndex, errString));
     return 0;
 
  cleanup:
@@ -302,6 +460,113 @@ static int initializeRemoteTables(sqlite3 *db, char* errString)
     return rc;
 
 }
+static int readSchemaVersion(sqlite3 *db, int32_t *version, char* errString)
+{
+    sqlite3_stmt *stmt;
+    int rc;
+
+    SQLITE_CHK(SQLITE_PREPARE(db, selectUserVersion, strlen(selectUserVersion)+1, &stmt, NULL));
+
+    rc = sqlite3_step(stmt);
+    *version = (rc == SQLITE_ROW) ? sqlite3_column_int(stmt, 0) : 0;
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_ROW) {
+        ERRMSG;
+        return rc;
+    }
+    return SQLITE_OK;
+
+ cleanup:
+    sqlite3_finalize(stmt);
+    return rc;
+}
+
+static int writeSchemaVersion(sqlite3 *db, char* errString)
+{
+    char sql[64];
+
+    snprintf(sql, sizeof(sql), "PRAGMA user_version = %d;", cacheSchemaVersion);
+    return executeSql(db, sql, errString);
+}
+
+/*
+ * Convert the base64 ZIDs in the rows that the select statement returns to BLOBs.
+ *
+ * The select statement returns the rowid and the ZID columns, the update statement
+ * binds the BLOBs to the first parameters and the rowid to the last parameter.
+ */
+static int convertZids(sqlite3 *db, const char *selectSql, const char *updateSql, int zids, char* errString)
+{
+    sqlite3_stmt *select = NULL;
+    sqlite3_stmt *update = NULL;
+    uint8_t zidData[2][IDENTIFIER_LEN];
+    int rc;
+    int i;
+
+    SQLITE_CHK(SQLITE_PREPARE(db, selectSql, strlen(selectSql)+1, &select, NULL));
+    SQLITE_CHK(SQLITE_PREPARE(db, updateSql, strlen(updateSql)+1, &update, NULL));
+
+    while ((rc = sqlite3_step(select)) == SQLITE_ROW) {
+        for (i = 0; i < zids; i++) {
+            const char *zidBase64Text = (const char *)sqlite3_column_text(select, i + 1);
+
+            /* A base64 ZID has 16 characters, ignore damaged data */
+            memset(zidData[i], 0, IDENTIFIER_LEN);
+            if (zidBase64Text != NULL && strlen(zidBase64Text) <= IDENTIFIER_LEN + IDENTIFIER_LEN/3)
+                b64Decode(zidBase64Text, strlen(zidBase64Text), zidData[i], IDENTIFIER_LEN);
+            SQLITE_CHK(sqlite3_bind_blob(update, i + 1, zidData[i], IDENTIFIER_LEN, SQLITE_STATIC));
+        }
+        SQLITE_CHK(sqlite3_bind_int64(update, zids + 1, sqlite3_column_int64(select, 0)));
+
+        rc = sqlite3_step(update);
+        sqlite3_reset(update);
+        if (rc != SQLITE_DONE) {
+            ERRMSG;
+            goto cleanup;
+        }
+    }
+    if (rc != SQLITE_DONE) {
+        ERRMSG;
+    }
+    else {
+        rc = SQLITE_OK;
+    }
+
+ cleanup:
+    sqlite3_finalize(select);
+    sqlite3_finalize(update);
+    return rc;
+}
+
+/**
+ * Upgrade version 0 cache tables.
+ *
+ * Convert the ZIDs to BLOBs, remove duplicate rows and create the unique indexes.
+ * The upgrade runs in one transaction, if it fails the tables stay unchanged.
+ */
+static int upgradeTables(sqlite3 *db, char* errString)
+{
+    int rc;
+
+    rc = executeSql(db, beginUpgradeSql, errString);
+    if (rc != SQLITE_OK)
+        return rc;
+
+    if ((rc = convertZids(db, selectTextZidsOwn, updateBlobZidsOwn, 1, errString)) != SQLITE_OK ||
+        (rc = convertZids(db, selectTextZidsRemote, updateBlobZidsRemote, 2, errString)) != SQLITE_OK ||
+        (rc = convertZids(db, selectTextZidsNames, updateBlobZidsNames, 2, errString)) != SQLITE_OK ||
+        (rc = executeSql(db, deleteDuplicateRemote, errString)) != SQLITE_OK ||
+        (rc = executeSql(db, deleteDuplicateNames, errString)) != SQLITE_OK ||
+        (rc = executeSql(db, createZrtpIdRemoteIndex, errString)) != SQLITE_OK ||
+        (rc = executeSql(db, createZrtpNamesIndex, errString)) != SQLITE_OK ||
+        (rc = writeSchemaVersion(db, errString)) != SQLITE_OK ||
+        (rc = executeSql(db, commitUpgradeSql, errString)) != SQLITE_OK) {
+        executeSql(db, rollbackUpgradeSql, NULL);
+        return rc;
+    }
+    return SQLITE_OK;
+}
+
 /**
  * Create ZRTP cache tables in database.
  *
@@ -322,7 +587,10 @@ static int createTables(sqlite3 *db, char* errString)
         ERRMSG;
         return rc;
     }
-    return initializeRemoteTables(db, errString);
+    rc = initializeRemoteTables(db, errString);
+    if (rc)
+        return rc;
+    return writeSchemaVersion(db, errString);
 
  cleanup:
     sqlite3_finalize(stmt);
@@ -332,24 +600,16 @@ static int createTables(sqlite3 *db, char* errString)
 static int insertRemoteZidRecord(void *vdb, const uint8_t *remoteZid, const uint8_t *localZid, 
                                  const remoteZidRecord_t *remZid, char* errString)
 {
-    sqlite3 *db = (sqlite3*)vdb;
+    sqliteCache_t *cache = (sqliteCache_t*)vdb;
+    sqlite3 *db = cache->db;
     sqlite3_stmt *stmt;
     int rc = 0;
 
-    char b64RemoteZid[IDENTIFIER_LEN*2] = {0};
-    char b64LocalZid[IDENTIFIER_LEN*2] = {0};
-
-    /* Get B64 code for remoteZid first */
-    b64Encode(remoteZid, IDENTIFIER_LEN, b64RemoteZid, IDENTIFIER_LEN*2);
-
-    /* Get B64 code for localZid now */
-    b64Encode(localZid, IDENTIFIER_LEN, b64LocalZid, IDENTIFIER_LEN*2);
-
-    SQLITE_CHK(SQLITE_PREPARE(db, insertZrtpIdRemote, strlen(insertZrtpIdRemote)+1, &stmt, NULL));
+    SQLITE_CHK(prepareStatement(cache, StmtInsertIdRemote, insertZrtpIdRemote, &stmt));
 
     /* For *_bind_* methods: column index starts with 1 (one), not zero */
-    SQLITE_CHK(sqlite3_bind_text(stmt,   1, b64RemoteZid, strlen(b64RemoteZid), SQLITE_STATIC));
-    SQLITE_CHK(sqlite3_bind_text(stmt,  12, b64LocalZid, strlen(b64LocalZid), SQLITE_STATIC));
+    SQLITE_CHK(sqlite3_bind_blob(stmt,   1, remoteZid, IDENTIFIER_LEN, SQLITE_STATIC));
+    SQLITE_CHK(sqlite3_bind_blob(stmt,  12, localZid, IDENTIFIER_LEN, SQLITE_STATIC));
     SQLITE_CHK(sqlite3_bind_int(stmt,    2, remZid->flags));
     SQLITE_CHK(sqlite3_bind_blob(stmt,   3, remZid->rs1, RS_LENGTH, SQLITE_STATIC));
     SQLITE_CHK(sqlite3_bind_int64(stmt,  4, remZid->rs1LastUse));
@@ -363,7 +623,7 @@ static int insertRemoteZidRecord(void *vdb, const uint8_t *remoteZid, const uint
     SQLITE_CHK(sqlite3_bind_int(stmt,   13, remZid->preshCounter));
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     if (rc != SQLITE_DONE) {
         ERRMSG;
         return rc;
@@ -371,7 +631,7 @@ static int insertRemoteZidRecord(void *vdb, const uint8_t *remoteZid, const uint
     return SQLITE_OK;
 
  cleanup:
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return rc;
 
 }
@@ -379,25 +639,17 @@ static int insertRemoteZidRecord(void *vdb, const uint8_t *remoteZid, const uint
 static int updateRemoteZidRecord(void *vdb, const uint8_t *remoteZid, const uint8_t *localZid, 
                                  const remoteZidRecord_t *remZid, char* errString)
 {
-    sqlite3 *db = (sqlite3*)vdb;
+    sqliteCache_t *cache = (sqliteCache_t*)vdb;
+    sqlite3 *db = cache->db;
     sqlite3_stmt *stmt;
     int rc;
 
-    char b64RemoteZid[IDENTIFIER_LEN*2] = {0};
-    char b64LocalZid[IDENTIFIER_LEN*2] = {0};
-
-    /* Get B64 code for remoteZid first */
-    b64Encode(remoteZid, IDENTIFIER_LEN, b64RemoteZid, IDENTIFIER_LEN*2);
-
-    /* Get B64 code for localZid now */
-    b64Encode(localZid, IDENTIFIER_LEN, b64LocalZid, IDENTIFIER_LEN*2);
-
-    SQLITE_CHK(SQLITE_PREPARE(db, updateZrtpIdRemote, strlen(updateZrtpIdRemote)+1, &stmt, NULL));
+    SQLITE_CHK(prepareStatement(cache, StmtUpdateIdRemote, updateZrtpIdRemote, &stmt));
 
     /* For *_bind_* methods: column index starts with 1 (one), not zero */
     /* Select for update with the following keys */
-    SQLITE_CHK(sqlite3_bind_text(stmt,   1, b64RemoteZid, strlen(b64RemoteZid), SQLITE_STATIC));
-    SQLITE_CHK(sqlite3_bind_text(stmt,  12, b64LocalZid, strlen(b64LocalZid), SQLITE_STATIC));
+    SQLITE_CHK(sqlite3_bind_blob(stmt,   1, remoteZid, IDENTIFIER_LEN, SQLITE_STATIC));
+    SQLITE_CHK(sqlite3_bind_blob(stmt,  12, localZid, IDENTIFIER_LEN, SQLITE_STATIC));
 
     /* Update the following values */
     SQLITE_CHK(sqlite3_bind_int(stmt,    2, remZid->flags));
@@ -413,38 +665,33 @@ static int updateRemoteZidRecord(void *vdb, const uint8_t *remoteZid, const uint
     SQLITE_CHK(sqlite3_bind_int(stmt,   13, remZid->preshCounter));
 
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     if (rc != SQLITE_DONE) {
         ERRMSG;
         return rc;
     }
+    /* The cache compaction may have deleted the record since it was read */
+    if (sqlite3_changes(db) == 0)
+        return insertRemoteZidRecord(vdb, remoteZid, localZid, remZid, errString);
     return SQLITE_OK;
 
  cleanup:
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return rc;
 }
 
 static int readRemoteZidRecord(void *vdb, const uint8_t *remoteZid, const uint8_t *localZid, 
                                remoteZidRecord_t *remZid, char* errString)
 {
-    sqlite3 *db = (sqlite3*)vdb;
+    sqliteCache_t *cache = (sqliteCache_t*)vdb;
+    sqlite3 *db = cache->db;
     sqlite3_stmt *stmt;
     int rc;
     int found = 0;
 
-    char b64RemoteZid[IDENTIFIER_LEN*2] = {0};
-    char b64LocalZid[IDENTIFIER_LEN*2] = {0};
-
-    /* Get B64 code for remoteZid */
-    b64Encode(remoteZid, IDENTIFIER_LEN, b64RemoteZid, IDENTIFIER_LEN*2);
-
-    /* Get B64 code for localZid */
-    b64Encode(localZid, IDENTIFIER_LEN, b64LocalZid, IDENTIFIER_LEN*2);
-
-    SQLITE_CHK(SQLITE_PREPARE(db, selectZrtpIdRemoteAll, strlen(selectZrtpIdRemoteAll)+1, &stmt, NULL));
-    SQLITE_CHK(sqlite3_bind_text(stmt, 1, b64RemoteZid, strlen(b64RemoteZid), SQLITE_STATIC));
-    SQLITE_CHK(sqlite3_bind_text(stmt, 2, b64LocalZid, strlen(b64LocalZid), SQLITE_STATIC));
+    SQLITE_CHK(prepareStatement(cache, StmtSelectIdRemote, selectZrtpIdRemoteAll, &stmt));
+    SQLITE_CHK(sqlite3_bind_blob(stmt, 1, remoteZid, IDENTIFIER_LEN, SQLITE_STATIC));
+    SQLITE_CHK(sqlite3_bind_blob(stmt, 2, localZid, IDENTIFIER_LEN, SQLITE_STATIC));
 
     /* Getting data from result set: column index starts with 0 (zero), not one */
     while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
@@ -461,7 +708,7 @@ static int readRemoteZidRecord(void *vdb, const uint8_t *remoteZid, const uint8_
         remZid->preshCounter =  sqlite3_column_int(stmt,   10);
         found++;
     }
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
 
     if (rc != SQLITE_DONE) {
         ERRMSG;
@@ -478,16 +725,16 @@ static int readRemoteZidRecord(void *vdb, const uint8_t *remoteZid, const uint8_
     return SQLITE_OK;
 
  cleanup:
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return rc;
 }
 
 
 static int readLocalZid(void *vdb, uint8_t *localZid, const char *accountInfo, char *errString)
 {
-    sqlite3 *db = (sqlite3*)vdb;
+    sqliteCache_t *cache = (sqliteCache_t*)vdb;
+    sqlite3 *db = cache->db;
     sqlite3_stmt *stmt;
-    char *zidBase64Text;
     int rc = 0;
     int found = 0;
     int type = localZidWithAccount;
@@ -498,20 +745,19 @@ static int readLocalZid(void *vdb, uint8_t *localZid, const char *accountInfo, c
     }
 
     /* Find a localZid record for this combination */
-    SQLITE_CHK(SQLITE_PREPARE(db, selectZrtpIdOwn, strlen(selectZrtpIdOwn)+1, &stmt, NULL));
+    SQLITE_CHK(prepareStatement(cache, StmtSelectIdOwn, selectZrtpIdOwn, &stmt));
 
     SQLITE_CHK(sqlite3_bind_int(stmt,  1, type));
     SQLITE_CHK(sqlite3_bind_text(stmt, 2, accountInfo, strlen(accountInfo), SQLITE_STATIC));
 
     /* Loop over result set and count it. However, use only the localZid of first row */
     while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
-        if (found == 0) {
-            zidBase64Text = (char *)sqlite3_column_text(stmt, 0);
-            b64Decode(zidBase64Text, strlen(zidBase64Text), localZid, IDENTIFIER_LEN);
+        if (found == 0 && sqlite3_column_bytes(stmt, 0) == IDENTIFIER_LEN) {
+            memcpy(localZid, sqlite3_column_blob(stmt, 0), IDENTIFIER_LEN);
         }
         found++;
     }
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
 
     if (rc != SQLITE_DONE) {
         ERRMSG;
@@ -519,21 +765,17 @@ static int readLocalZid(void *vdb, uint8_t *localZid, const char *accountInfo, c
     }
     /* No matching record found, create new local ZID for this combination and store in DB */
     if (found == 0) {
-        char b64zid[IDENTIFIER_LEN+IDENTIFIER_LEN] = {0};
-        int b64len = 0;
-
-        /* create a 12 byte random value, convert to base 64, insert in zrtpIdOwn table */
+        /* create a 12 byte random value, insert in zrtpIdOwn table */
         randomZRTP(localZid, IDENTIFIER_LEN);
-        b64len = b64Encode(localZid, IDENTIFIER_LEN, b64zid, IDENTIFIER_LEN+IDENTIFIER_LEN);
 
-        SQLITE_CHK(SQLITE_PREPARE(db, insertZrtpIdOwn, strlen(insertZrtpIdOwn)+1, &stmt, NULL));
+        SQLITE_CHK(prepareStatement(cache, StmtInsertIdOwn, insertZrtpIdOwn, &stmt));
 
-        SQLITE_CHK(sqlite3_bind_text(stmt, 1, b64zid, b64len, SQLITE_STATIC));
+        SQLITE_CHK(sqlite3_bind_blob(stmt, 1, localZid, IDENTIFIER_LEN, SQLITE_STATIC));
         SQLITE_CHK(sqlite3_bind_int(stmt,  2, type));
         SQLITE_CHK(sqlite3_bind_text(stmt, 3, accountInfo, strlen(accountInfo), SQLITE_STATIC));
 
         rc = sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
+        sqlite3_reset(stmt);
         if (rc != SQLITE_DONE) {
             ERRMSG;
             return rc;
@@ -548,7 +790,7 @@ static int readLocalZid(void *vdb, uint8_t *localZid, const char *accountInfo, c
     return SQLITE_OK;
 
  cleanup:
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return rc;
 }
 
@@ -564,23 +806,110 @@ static int readLocalZid(void *vdb, uint8_t *localZid, const char *accountInfo, c
  * );
  */
 
-static int openCache(const char* name, void **vpdb, char *errString)
+/*
+ * Set the key of the database, SQLCipher derives a passphrase with PBKDF2 when
+ * it reads the first page. A raw key is in the SQLCipher blob format x'...',
+ * 64 hex digits for the key and optionally 32 hex digits for the salt.
+ */
+static int keyDatabase(sqlite3 *db, const uint8_t *key, int32_t keyLength, int32_t rawKey,
+                       int32_t kdfIterations, char *errString)
 {
-    sqlite3_stmt *stmt;
-    int found = 0;
-    sqlite3 **pdb = (sqlite3**)vpdb;
-    sqlite3 *db;
+#ifdef SQL_CIPHER
+    static const char hexDigits[] = "0123456789abcdef";
+    char hexKey[2 + 2*48 + 2];
+    char pragma[64];
+    int32_t i;
+    int rc;
+
+    if (rawKey) {
+        if (keyLength != 32 && keyLength != 48) {
+            if (errString) snprintf(errString, (size_t)DB_CACHE_ERR_BUFF_SIZE,
+                                    "SQLite3 error: raw key length %d, expected 32 or 48 bytes\n", keyLength);
+            return SQLITE_MISUSE;
+        }
+        hexKey[0] = 'x';
+        hexKey[1] = '\'';
+        for (i = 0; i < keyLength; i++) {
+            hexKey[2 + 2*i] = hexDigits[key[i] >> 4];
+            hexKey[3 + 2*i] = hexDigits[key[i] & 0xf];
+        }
+        hexKey[2 + 2*keyLength] = '\'';
+        rc = sqlite3_key(db, hexKey, 3 + 2*keyLength);
+        memset_volatile(hexKey, 0, sizeof(hexKey));
+    }
+    else {
+        rc = sqlite3_key(db, key, keyLength);
+    }
+    if (rc != SQLITE_OK) {
+        ERRMSG;
+        return rc;
+    }
+    /* A raw key skips the key derivation, SQLCipher ignores the iterations */
+    if (!rawKey && kdfIterations > 0) {
+        snprintf(pragma, sizeof(pragma), "PRAGMA kdf_iter = %d;", kdfIterations);
+        rc = sqlite3_exec(db, pragma, NULL, NULL, NULL);
+        if (rc != SQLITE_OK) {
+            ERRMSG;
+        }
+    }
+    return rc;
+#else
+    (void)db; (void)key; (void)keyLength; (void)rawKey; (void)kdfIterations;
+    if (errString) snprintf(errString, (size_t)DB_CACHE_ERR_BUFF_SIZE,
+                            "SQLite3 error: the cache is not built with SQLCipher, cannot set a key\n");
+    return SQLITE_MISUSE;
+#endif
+}
+
+/*
+ * Open a database connection with the open flags and set its key.
+ */
+static int openDatabase(const char* name, sqlite3 **pdb, int flags, const uint8_t *key, int32_t keyLength,
+                        int32_t rawKey, int32_t kdfIterations, char *errString)
+{
+    sqlite3 *db = NULL;
 
 #ifdef SQLITE_USE_V2
-    int rc = sqlite3_open_v2(name, pdb, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, NULL);
+    int rc = sqlite3_open_v2(name, &db, flags, NULL);
 #else
-    int rc = sqlite3_open(name, pdb);
+    int rc = sqlite3_open(name, &db);
+    (void)flags;
 #endif
-    db = *pdb;
+    *pdb = NULL;
     if (rc) {
         ERRMSG;
+        sqlite3_close(db);
         return(rc);
     }
+    if (key != NULL && (rc = keyDatabase(db, key, keyLength, rawKey, kdfIterations, errString)) != SQLITE_OK) {
+        sqlite3_close(db);
+        return rc;
+    }
+    *pdb = db;
+    return SQLITE_OK;
+}
+
+static int openCacheKeyed(const char* name, void **vpdb, const uint8_t *key, int32_t keyLength,
+                          int32_t rawKey, int32_t kdfIterations, char *errString)
+{
+    sqlite3_stmt *stmt;
+    int found = 0;
+    int32_t version = 0;
+    sqliteCache_t *cache;
+    sqlite3 *db;
+
+    int rc = openDatabase(name, &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX,
+                          key, keyLength, rawKey, kdfIterations, errString);
+    *vpdb = NULL;
+    if (rc != SQLITE_OK)
+        return rc;
+
+    if ((cache = (sqliteCache_t*)calloc(1, sizeof(sqliteCache_t))) == NULL) {
+        sqlite3_close(db);
+        return SQLITE_NOMEM;
+    }
+    cache->db = db;
+    *vpdb = cache;
 
     /* check if ZRTP cache tables are already available, look if zrtpIdOwn is available */
     SQLITE_CHK(SQLITE_PREPARE(db, lookupTables, strlen(lookupTables)+1, &stmt, NULL));
@@ -600,6 +929,13 @@ static int openCache(const char* name, void **vpdb, char *errString)
         if (rc)
             return rc;
     }
+    else {
+        rc = readSchemaVersion(db, &version, errString);
+        if (rc == SQLITE_OK && version < cacheSchemaVersion)
+            rc = upgradeTables(db, errString);
+        if (rc)
+            return rc;
+    }
     return SQLITE_OK;
 
  cleanup:
@@ -607,21 +943,58 @@ static int openCache(const char* name, void **vpdb, char *errString)
     return rc;
 }
 
+static int openCache(const char* name, void **vpdb, char *errString)
+{
+    return openCacheKeyed(name, vpdb, NULL, 0, 0, 0, errString);
+}
+
+static int openCacheConnection(const char* name, void **vpdb, const uint8_t *key, int32_t keyLength,
+                               int32_t rawKey, int32_t kdfIterations, char *errString)
+{
+    sqliteCache_t *cache;
+    sqlite3 *db;
+
+    int rc = openDatabase(name, &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX,
+                          key, keyLength, rawKey, kdfIterations, errString);
+    *vpdb = NULL;
+    if (rc != SQLITE_OK)
+        return rc;
+
+    /* A reader of the write ahead log waits only while another connection recovers the log */
+    sqlite3_busy_timeout(db, connectionBusyTimeout);
+    if ((cache = (sqliteCache_t*)calloc(1, sizeof(sqliteCache_t))) == NULL) {
+        sqlite3_close(db);
+        return SQLITE_NOMEM;
+    }
+    cache->db = db;
+    *vpdb = cache;
+    return SQLITE_OK;
+}
+
 static int closeCache(void *vdb)
 {
 
-    sqlite3 *db = (sqlite3*)vdb;
-    sqlite3_close(db);
+    sqliteCache_t *cache = (sqliteCache_t*)vdb;
+
+    if (cache == NULL)
+        return SQLITE_OK;
+    finalizeStatements(cache);
+    sqlite3_close(cache->db);
+    free(cache);
     return SQLITE_OK;
 }
 
 static int clearCache(void *vdb, char *errString)
 {
 
-    sqlite3 *db = (sqlite3*)vdb;
+    sqliteCache_t *cache = (sqliteCache_t*)vdb;
+    sqlite3 *db = cache->db;
     sqlite3_stmt * stmt;
     int rc;
 
+    /* The prepared statements refer to the tables, prepare them again after re-creating the tables */
+    finalizeStatements(cache);
+
     rc = SQLITE_PREPARE(db, dropZrtpIdOwn, strlen(dropZrtpIdOwn)+1, &stmt, NULL);
     rc = sqlite3_step(stmt);
     sqlite3_finalize(stmt);
@@ -635,27 +1008,20 @@ static int clearCache(void *vdb, char *errString)
 static int insertZidNameRecord(void *vdb, const uint8_t *remoteZid, const uint8_t *localZid,
                                const char *accountInfo, zidNameRecord_t *zidName, char* errString)
 {
-    sqlite3 *db = (sqlite3*)vdb;
+    sqliteCache_t *cache = (sqliteCache_t*)vdb;
+    sqlite3 *db = cache->db;
     sqlite3_stmt *stmt;
     int rc = 0;
-    char b64RemoteZid[IDENTIFIER_LEN*2] = {0};
-    char b64LocalZid[IDENTIFIER_LEN*2] = {0};
 
     if (accountInfo == NULL) {
         accountInfo = defaultAccountString;
     }
 
-    /* Get B64 code for remoteZid */
-    b64Encode(remoteZid, IDENTIFIER_LEN, b64RemoteZid, IDENTIFIER_LEN*2);
-
-    /* Get B64 code for localZid */
-    b64Encode(localZid, IDENTIFIER_LEN, b64LocalZid, IDENTIFIER_LEN*2);
-
-    SQLITE_CHK(SQLITE_PREPARE(db, insertZrtpNames, strlen(insertZrtpNames)+1, &stmt, NULL));
+    SQLITE_CHK(prepareStatement(cache, StmtInsertNames, insertZrtpNames, &stmt));
 
     /* For *_bind_* methods: column index starts with 1 (one), not zero */
-    SQLITE_CHK(sqlite3_bind_text(stmt,  1, b64RemoteZid, strlen(b64RemoteZid), SQLITE_STATIC));
-    SQLITE_CHK(sqlite3_bind_text(stmt,  2, b64LocalZid, strlen(b64LocalZid), SQLITE_STATIC));
+    SQLITE_CHK(sqlite3_bind_blob(stmt,  1, remoteZid, IDENTIFIER_LEN, SQLITE_STATIC));
+    SQLITE_CHK(sqlite3_bind_blob(stmt,  2, localZid, IDENTIFIER_LEN, SQLITE_STATIC));
     SQLITE_CHK(sqlite3_bind_text(stmt,  3, accountInfo, strlen(accountInfo), SQLITE_STATIC));
     SQLITE_CHK(sqlite3_bind_int(stmt,   4, zidName->flags));
     SQLITE_CHK(sqlite3_bind_int64(stmt, 5, (int64_t)time(NULL)));
@@ -666,7 +1032,7 @@ static int insertZidNameRecord(void *vdb, const uint8_t *remoteZid, const uint8_
         SQLITE_CHK(sqlite3_bind_text(stmt,   6, "_NO_NAME_", 9, SQLITE_STATIC));
     }
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     if (rc != SQLITE_DONE) {
         ERRMSG;
         return rc;
@@ -674,7 +1040,7 @@ static int insertZidNameRecord(void *vdb, const uint8_t *remoteZid, const uint8_
     return SQLITE_OK;
 
  cleanup:
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return rc;
 
 }
@@ -683,28 +1049,21 @@ static int insertZidNameRecord(void *vdb, const uint8_t *remoteZid, const uint8_
 static int updateZidNameRecord(void *vdb, const uint8_t *remoteZid, const uint8_t *localZid,
                                const char *accountInfo, zidNameRecord_t *zidName, char* errString)
 {
-    sqlite3 *db = (sqlite3*)vdb;
+    sqliteCache_t *cache = (sqliteCache_t*)vdb;
+    sqlite3 *db = cache->db;
     sqlite3_stmt *stmt;
     int rc = 0;
-    char b64RemoteZid[IDENTIFIER_LEN*2] = {0};
-    char b64LocalZid[IDENTIFIER_LEN*2] = {0};
 
     if (accountInfo == NULL) {
         accountInfo = defaultAccountString;
     }
 
-    /* Get B64 code for remoteZid */
-    b64Encode(remoteZid, IDENTIFIER_LEN, b64RemoteZid, IDENTIFIER_LEN*2);
-
-    /* Get B64 code for localZid */
-    b64Encode(localZid, IDENTIFIER_LEN, b64LocalZid, IDENTIFIER_LEN*2);
-
-    SQLITE_CHK(SQLITE_PREPARE(db, updateZrtpNames, strlen(updateZrtpNames)+1, &stmt, NULL));
+    SQLITE_CHK(prepareStatement(cache, StmtUpdateNames, updateZrtpNames, &stmt));
 
     /* For *_bind_* methods: column index starts with 1 (one), not zero */
     /* Select for update with the following values */
-    SQLITE_CHK(sqlite3_bind_text(stmt,   1, b64RemoteZid, strlen(b64RemoteZid), SQLITE_STATIC));
-    SQLITE_CHK(sqlite3_bind_text(stmt,   2, b64LocalZid, strlen(b64LocalZid), SQLITE_STATIC));
+    SQLITE_CHK(sqlite3_bind_blob(stmt,   1, remoteZid, IDENTIFIER_LEN, SQLITE_STATIC));
+    SQLITE_CHK(sqlite3_bind_blob(stmt,   2, localZid, IDENTIFIER_LEN, SQLITE_STATIC));
     SQLITE_CHK(sqlite3_bind_text(stmt,   3, accountInfo, strlen(accountInfo), SQLITE_STATIC));
 
     /* Update the following vaulues */
@@ -717,7 +1076,7 @@ static int updateZidNameRecord(void *vdb, const uint8_t *remoteZid, const uint8_
         SQLITE_CHK(sqlite3_bind_text(stmt,   6, "_NO_NAME_", 9, SQLITE_STATIC));
     }
     rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     if (rc != SQLITE_DONE) {
         ERRMSG;
         return rc;
@@ -725,7 +1084,7 @@ static int updateZidNameRecord(void *vdb, const uint8_t *remoteZid, const uint8_
     return SQLITE_OK;
 
  cleanup:
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return rc;
 
 }
@@ -733,27 +1092,19 @@ static int updateZidNameRecord(void *vdb, const uint8_t *remoteZid, const uint8_
 static int readZidNameRecord(void *vdb, const uint8_t *remoteZid, const uint8_t *localZid,
                              const char *accountInfo, zidNameRecord_t *zidName, char* errString)
 {
-    sqlite3 *db = (sqlite3*)vdb;
+    sqliteCache_t *cache = (sqliteCache_t*)vdb;
+    sqlite3 *db = cache->db;
     sqlite3_stmt *stmt;
     int rc;
     int found = 0;
 
-    char b64RemoteZid[IDENTIFIER_LEN*2] = {0};
-    char b64LocalZid[IDENTIFIER_LEN*2] = {0};
-
     if (accountInfo == NULL) {
         accountInfo = defaultAccountString;
     }
-    /* Get B64 code for remoteZid */
-    b64Encode(remoteZid, IDENTIFIER_LEN, b64RemoteZid, IDENTIFIER_LEN*2);
-
-    /* Get B64 code for localZid */
-    b64Encode(localZid, IDENTIFIER_LEN, b64LocalZid, IDENTIFIER_LEN*2);
-
-    SQLITE_CHK(SQLITE_PREPARE(db, selectZrtpNames, strlen(selectZrtpNames)+1, &stmt, NULL));
+    SQLITE_CHK(prepareStatement(cache, StmtSelectNames, selectZrtpNames, &stmt));
 
-    SQLITE_CHK(sqlite3_bind_text(stmt, 1, b64RemoteZid, strlen(b64RemoteZid), SQLITE_STATIC));
-    SQLITE_CHK(sqlite3_bind_text(stmt, 2, b64LocalZid, strlen(b64LocalZid), SQLITE_STATIC));
+    SQLITE_CHK(sqlite3_bind_blob(stmt, 1, remoteZid, IDENTIFIER_LEN, SQLITE_STATIC));
+    SQLITE_CHK(sqlite3_bind_blob(stmt, 2, localZid, IDENTIFIER_LEN, SQLITE_STATIC));
     SQLITE_CHK(sqlite3_bind_text(stmt, 3, accountInfo, strlen(accountInfo), SQLITE_STATIC));
 
     /* Getting data from result set: column index starts with 0 (zero), not one */
@@ -763,7 +1114,7 @@ static int readZidNameRecord(void *vdb, const uint8_t *remoteZid, const uint8_t
         zidName->nameLength = sqlite3_column_bytes(stmt, 2);    /* Return number of bytes in string */
         found++;
     }
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
 
     if (rc != SQLITE_DONE) {
         ERRMSG;
@@ -779,13 +1130,13 @@ static int readZidNameRecord(void *vdb, const uint8_t *remoteZid, const uint8_t
     return SQLITE_OK;
 
  cleanup:
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
     return rc;
 }
 
 static void *prepareReadAllZid(void *vdb, char *errString)
 {
-    sqlite3 *db = (sqlite3*)vdb;
+    sqlite3 *db = ((sqliteCache_t*)vdb)->db;
     sqlite3_stmt *stmt;
     int rc;
 
@@ -799,9 +1150,8 @@ static void *prepareReadAllZid(void *vdb, char *errString)
 
 static void *readNextZidRecord(void *vdb, void *vstmt, remoteZidRecord_t *remZid, char* errString)
 {
-    sqlite3 *db = (sqlite3*)vdb;
+    sqlite3 *db = ((sqliteCache_t*)vdb)->db;
     sqlite3_stmt *stmt;
-    char *zidBase64Text;
     int rc;
 
     if (vstmt == NULL)
@@ -821,8 +1171,174 @@ static void *readNextZidRecord(void *vdb, void *vstmt, remoteZidRecord_t *remZid
         remZid->mitmLastUse =   sqlite3_column_int64(stmt,  8);
         remZid->secureSince =   sqlite3_column_int64(stmt,  9);
         remZid->preshCounter =  sqlite3_column_int(stmt,   10);
-        zidBase64Text = (char *)sqlite3_column_text(stmt,  11);
-        b64Decode(zidBase64Text, strlen(zidBase64Text), remZid->identifier, IDENTIFIER_LEN);
+        if (sqlite3_column_bytes(stmt, 11) == IDENTIFIER_LEN)
+            memcpy(remZid->identifier, sqlite3_column_blob(stmt, 11), IDENTIFIER_LEN);
+        return stmt;
+    }
+    sqlite3_finalize(stmt);
+
+    if (rc != SQLITE_DONE)
+        ERRMSG;
+    return NULL;
+}
+
+static void *prepareReadLocalZid(void *vdb, const uint8_t *localZid, char *errString)
+{
+    sqlite3 *db = ((sqliteCache_t*)vdb)->db;
+    sqlite3_stmt *stmt;
+    int rc;
+
+    SQLITE_CHK(SQLITE_PREPARE(db, selectZrtpIdRemoteLocal, strlen(selectZrtpIdRemoteLocal)+1, &stmt, NULL));
+    SQLITE_CHK(sqlite3_bind_blob(stmt, 1, localZid, IDENTIFIER_LEN, SQLITE_TRANSIENT));
+    return stmt;
+
+  cleanup:
+    sqlite3_finalize(stmt);
+    return NULL;
+}
+
+static int deleteStaleRemoteZidRecords(void *vdb, const uint8_t *localZid, int64_t now, int32_t limit,
+                                       int32_t *deleted, char *errString)
+{
+    sqlite3 *db = ((sqliteCache_t*)vdb)->db;
+    sqlite3_stmt *stmt;
+    int rc;
+
+    *deleted = 0;
+    SQLITE_CHK(SQLITE_PREPARE(db, deleteStaleZrtpIdRemote, strlen(deleteStaleZrtpIdRemote)+1, &stmt, NULL));
+    SQLITE_CHK(sqlite3_bind_blob(stmt,  1, localZid, IDENTIFIER_LEN, SQLITE_STATIC));
+    SQLITE_CHK(sqlite3_bind_int64(stmt, 2, now));
+    SQLITE_CHK(sqlite3_bind_int(stmt,   3, limit));
+
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        ERRMSG;
+        return rc;
+    }
+    *deleted = sqlite3_changes(db);
+    return SQLITE_OK;
+
+  cleanup:
+    sqlite3_finalize(stmt);
+    return rc;
+}
+
+static int deleteStaleRemoteZidRange(void *vdb, const uint8_t *localZid, int64_t now, int64_t *rowid,
+                                     int32_t limit, int32_t *deleted, char *errString)
+{
+    sqlite3 *db = ((sqliteCache_t*)vdb)->db;
+    sqlite3_stmt *stmt;
+    int rc;
+    int64_t first = *rowid;
+    int64_t last;
+    int32_t count;
+
+    *deleted = 0;
+    SQLITE_CHK(SQLITE_PREPARE(db, selectZrtpIdRemoteRange, strlen(selectZrtpIdRemoteRange)+1, &stmt, NULL));
+    SQLITE_CHK(sqlite3_bind_blob(stmt,  1, localZid, IDENTIFIER_LEN, SQLITE_STATIC));
+    SQLITE_CHK(sqlite3_bind_int64(stmt, 2, first));
+    SQLITE_CHK(sqlite3_bind_int(stmt,   3, limit));
+
+    rc = sqlite3_step(stmt);
+    if (rc != SQLITE_ROW) {
+        ERRMSG;
+        sqlite3_finalize(stmt);
+        return rc;
+    }
+    last = sqlite3_column_int64(stmt, 0);
+    count = sqlite3_column_int(stmt, 1);
+    sqlite3_finalize(stmt);
+
+    /* Start again with the first record if the range reaches the end of the table */
+    *rowid = (count < limit) ? 0 : last;
+    if (count == 0)
+        return SQLITE_OK;
+
+    SQLITE_CHK(SQLITE_PREPARE(db, deleteStaleZrtpIdRemoteRange, strlen(deleteStaleZrtpIdRemoteRange)+1, &stmt, NULL));
+    SQLITE_CHK(sqlite3_bind_blob(stmt,  1, localZid, IDENTIFIER_LEN, SQLITE_STATIC));
+    SQLITE_CHK(sqlite3_bind_int64(stmt, 2, now));
+    SQLITE_CHK(sqlite3_bind_int64(stmt, 3, first));
+    SQLITE_CHK(sqlite3_bind_int64(stmt, 4, last));
+
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        ERRMSG;
+        return rc;
+    }
+    *deleted = sqlite3_changes(db);
+    return SQLITE_OK;
+
+  cleanup:
+    sqlite3_finalize(stmt);
+    return rc;
+}
+
+static int writeLocalZid(void *vdb, const uint8_t *localZid, const char *accountInfo, char *errString)
+{
+    sqlite3 *db = ((sqliteCache_t*)vdb)->db;
+    sqlite3_stmt *stmt;
+    int rc;
+    int type = localZidWithAccount;
+
+    if (accountInfo == NULL || !strcmp(accountInfo, defaultAccountString)) {
+        accountInfo = defaultAccountString;
+        type = localZidStandard;
+    }
+    SQLITE_CHK(SQLITE_PREPARE(db, updateZrtpIdOwn, strlen(updateZrtpIdOwn)+1, &stmt, NULL));
+    SQLITE_CHK(sqlite3_bind_blob(stmt, 1, localZid, IDENTIFIER_LEN, SQLITE_STATIC));
+    SQLITE_CHK(sqlite3_bind_int(stmt,  2, type));
+    SQLITE_CHK(sqlite3_bind_text(stmt, 3, accountInfo, strlen(accountInfo), SQLITE_STATIC));
+
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        ERRMSG;
+        return rc;
+    }
+    return SQLITE_OK;
+
+  cleanup:
+    sqlite3_finalize(stmt);
+    return rc;
+}
+
+static void *prepareReadAccountZids(void *vdb, char *errString)
+{
+    sqlite3 *db = ((sqliteCache_t*)vdb)->db;
+    sqlite3_stmt *stmt;
+    int rc;
+
+    SQLITE_CHK(SQLITE_PREPARE(db, selectZrtpIdOwnAccounts, strlen(selectZrtpIdOwnAccounts)+1, &stmt, NULL));
+    SQLITE_CHK(sqlite3_bind_int(stmt, 1, localZidWithAccount));
+    return stmt;
+
+  cleanup:
+    sqlite3_finalize(stmt);
+    return NULL;
+}
+
+static void *readNextAccountZid(void *vdb, void *vstmt, uint8_t *localZid, char *accountInfo, int32_t accountLength,
+                                char *errString)
+{
+    sqlite3 *db = ((sqliteCache_t*)vdb)->db;
+    sqlite3_stmt *stmt;
+    const char *account;
+    int rc;
+
+    if (vstmt == NULL)
+        return NULL;
+    stmt = (sqlite3_stmt*)vstmt;
+
+    /* Skip malformed rows, readLocalZid ignores them too */
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        account = (const char*)sqlite3_column_text(stmt, 1);
+        if (sqlite3_column_bytes(stmt, 0) != IDENTIFIER_LEN || account == NULL ||
+            sqlite3_column_bytes(stmt, 1) >= accountLength)
+            continue;
+        memcpy(localZid, sqlite3_column_blob(stmt, 0), IDENTIFIER_LEN);
+        strcpy(accountInfo, account);
         return stmt;
     }
     sqlite3_finalize(stmt);
@@ -845,6 +1361,7 @@ static void closeStatement(void *vstmt)
 void getDbCacheOps(dbCacheOps_t *ops)
 {
     ops->openCache = openCache;
+    ops->openCacheKeyed = openCacheKeyed;
     ops->closeCache = closeCache;
     ops->cleanCache = clearCache;
 
@@ -861,5 +1378,17 @@ void getDbCacheOps(dbCacheOps_t *ops)
     ops->prepareReadAllZid = prepareReadAllZid;
     ops->readNextZidRecord = readNextZidRecord;
     ops->closeStatement = closeStatement;
+
+    ops->beginTransaction = beginTransaction;
+    ops->commitTransaction = commitTransaction;
+    ops->configureJournal = configureJournal;
+
+    ops->prepareReadLocalZid = prepareReadLocalZid;
+    ops->deleteStaleRemoteZidRecords = deleteStaleRemoteZidRecords;
+    ops->writeLocalZid = writeLocalZid;
+    ops->deleteStaleRemoteZidRange = deleteStaleRemoteZidRange;
+    ops->prepareReadAccountZids = prepareReadAccountZids;
+    ops->readNextAccountZid = readNextAccountZid;
+    ops->openCacheConnection = openCacheConnection;
 }
 